@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,7 @@
 
 #include "cuda_stub.hpp"  // cudaStream_t
 
+#include <map>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -120,6 +121,34 @@ class ANN : public AnnBase {
   // and should not release dataset before searching is finished.
   virtual void set_search_dataset(const T* /*dataset*/, size_t /*nrow*/){};
 
+  // Optional support of the streaming workloads; the algorithms that don't support them throw.
+  //
+  // extend() adds `nrow` vectors with the given ids to the index. `dataset` should be in the
+  // memory of AlgoProperty::dataset_memory_type and `ids` in the memory of
+  // AlgoProperty::query_memory_type. If SearchParam::needs_dataset() is true, the added vectors
+  // should directly follow the search dataset, and the client code should call
+  // set_search_dataset() with the grown dataset after extending the index.
+  virtual void extend(const T* /*dataset*/,
+                      const size_t* /*ids*/,
+                      size_t /*nrow*/,
+                      cudaStream_t /*stream*/ = 0)
+  {
+    throw std::runtime_error("This algorithm does not support adding vectors to the index.");
+  }
+  // remove() excludes the vectors with the given ids (in the memory of
+  // AlgoProperty::query_memory_type) from the search results.
+  virtual void remove(const size_t* /*ids*/, size_t /*n*/, cudaStream_t /*stream*/ = 0)
+  {
+    throw std::runtime_error("This algorithm does not support removing vectors from the index.");
+  }
+
+  // Optional per-phase GPU timing of the search (e.g. the coarse search, the scan and the select-k
+  // of IVF-PQ). After enable_phase_times(), collect_phase_times() returns the total GPU time (in
+  // seconds) of each phase of the searches since the previous call; the algorithms that are not
+  // instrumented return nothing. The timing is per wrapper copy.
+  virtual void enable_phase_times() {}
+  virtual auto collect_phase_times() -> std::map<std::string, double> { return {}; }
+
   /**
    * Make a shallow copy of the ANN wrapper that shares the resources and ensures thread-safe access
    * to them. */
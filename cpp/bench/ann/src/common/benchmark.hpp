@@ -18,6 +18,7 @@
 #include "ann_types.hpp"
 #include "conf.hpp"
 #include "dataset.hpp"
+#include "nvml_power.hpp"
 #include "util.hpp"
 
 #include <benchmark/benchmark.h>
@@ -29,13 +30,19 @@
 #include <cmath>
 #include <condition_variable>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <numeric>
+#include <optional>
+#include <random>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <unistd.h>
 #include <vector>
 namespace raft::bench::ann {
@@ -44,6 +51,24 @@ std::mutex init_mutex;
 std::condition_variable cond_var;
 std::atomic_int processed_threads{0};
 
+// Per-request latencies of the open-loop benchmark, merged across the benchmark threads.
+std::mutex latency_mutex;
+std::vector<double> latency_samples;
+int latency_threads{0};
+
+// The throughput of the throughput-mode search benchmark, merged across the threads searching the
+// one loaded index. The run of each case with the fewest threads is the baseline of its scaling.
+std::mutex thread_scaling_mutex;
+std::size_t thread_scaling_queries{0};
+double thread_scaling_duration{0};
+int thread_scaling_threads{0};
+std::map<std::string, std::tuple<int, double>> thread_scaling_baseline{};
+
+// Whether the search benchmarks report the GPU time of the algorithm phases (`--phase_times`).
+bool phase_times_enabled{false};
+// Whether the build and search benchmarks report the power and the energy of the GPU (`--power`).
+bool power_enabled{false};
+
 static inline std::unique_ptr<AnnBase> current_algo{nullptr};
 static inline std::unique_ptr<AlgoProperty> current_algo_props{nullptr};
 
@@ -109,6 +134,112 @@ inline void dump_parameters(::benchmark::State& state, nlohmann::json params)
   if (!label_empty) { state.SetLabel(label); }
 }
 
+/** Nearest-rank percentile `p` (0 < p <= 100) of a sorted non-empty sample. */
+inline auto percentile(const std::vector<double>& sorted, double p) -> double
+{
+  auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+  return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+/**
+ * Merge the per-request latencies of the benchmark threads; the last thread to finish reports the
+ * percentiles of all of them.
+ */
+inline void report_latency_percentiles(::benchmark::State& state, std::vector<double>& latencies)
+{
+  std::lock_guard<std::mutex> lock(latency_mutex);
+  latency_samples.insert(latency_samples.end(), latencies.begin(), latencies.end());
+  if (++latency_threads < state.threads()) { return; }
+  if (!latency_samples.empty()) {
+    std::sort(latency_samples.begin(), latency_samples.end());
+    state.counters.insert({{"latency_p50", percentile(latency_samples, 50)},
+                           {"latency_p90", percentile(latency_samples, 90)},
+                           {"latency_p99", percentile(latency_samples, 99)},
+                           {"latency_p99.9", percentile(latency_samples, 99.9)}});
+  }
+  latency_samples.clear();
+  latency_threads = 0;
+}
+
+/**
+ * Merge the throughput of the threads of the throughput-mode search benchmark; the last thread to
+ * finish reports the aggregate QPS and the scaling efficiency relative to the run of the same case
+ * with the fewest threads (the first of a `--threads` range).
+ */
+inline void report_thread_scaling(::benchmark::State& state,
+                                  const std::string& case_key,
+                                  std::size_t queries_processed,
+                                  double duration)
+{
+  std::lock_guard<std::mutex> lock(thread_scaling_mutex);
+  thread_scaling_queries += queries_processed;
+  thread_scaling_duration = std::max(thread_scaling_duration, duration);
+  if (++thread_scaling_threads < state.threads()) { return; }
+  double qps = thread_scaling_duration > 0
+                 ? static_cast<double>(thread_scaling_queries) / thread_scaling_duration
+                 : 0;
+  state.counters.insert({{"aggregate_qps", qps}});
+  auto baseline = thread_scaling_baseline.find(case_key);
+  if (baseline == thread_scaling_baseline.end() ||
+      std::get<0>(baseline->second) >= state.threads()) {
+    thread_scaling_baseline[case_key] = {state.threads(), qps};
+  } else if (std::get<1>(baseline->second) > 0) {
+    auto [base_threads, base_qps] = baseline->second;
+    state.counters.insert(
+      {{"thread_scaling_efficiency",
+        qps * base_threads / (static_cast<double>(state.threads()) * base_qps)}});
+  }
+  thread_scaling_queries  = 0;
+  thread_scaling_duration = 0;
+  thread_scaling_threads  = 0;
+}
+
+/**
+ * Count the neighbors found by a search benchmark thread that are in the ground truth.
+ *
+ * The thread has searched the query batches starting at `first_batch_offset`, then advancing by
+ * `queries_stride` (modulo `query_set_size`), and stored their `rows` results contiguously.
+ */
+template <typename T>
+auto count_recall_matches(const Dataset<T>& dataset,
+                          const std::size_t* neighbors,
+                          std::uint32_t k,
+                          std::size_t n_queries,
+                          std::size_t rows,
+                          std::size_t first_batch_offset,
+                          std::size_t queries_stride,
+                          std::size_t query_set_size) -> std::size_t
+{
+  const std::int32_t* gt    = dataset.gt_set();
+  const std::uint32_t max_k = dataset.max_k();
+  std::size_t match_count   = 0;
+
+  // We go through the groundtruth with same stride as the benchmark loop.
+  size_t out_offset   = 0;
+  size_t batch_offset = first_batch_offset;
+  while (out_offset < rows) {
+    for (std::size_t i = 0; i < n_queries; i++) {
+      size_t i_orig_idx = batch_offset + i;
+      size_t i_out_idx  = out_offset + i;
+      if (i_out_idx < rows) {
+        for (std::uint32_t j = 0; j < k; j++) {
+          auto act_idx = std::int32_t(neighbors[i_out_idx * k + j]);
+          for (std::uint32_t l = 0; l < k; l++) {
+            auto exp_idx = gt[i_orig_idx * max_k + l];
+            if (act_idx == exp_idx) {
+              match_count++;
+              break;
+            }
+          }
+        }
+      }
+    }
+    out_offset += n_queries;
+    batch_offset = (batch_offset + queries_stride) % query_set_size;
+  }
+  return match_count;
+}
+
 inline auto parse_algo_property(AlgoProperty prop, const nlohmann::json& conf) -> AlgoProperty
 {
   if (conf.contains("dataset_memory_type")) {
@@ -120,6 +251,23 @@ inline auto parse_algo_property(AlgoProperty prop, const nlohmann::json& conf) -
   return prop;
 };
 
+/**
+ * Stop a power meter and report the average power of the GPU (W) and the energy per iteration (J);
+ * with a positive number of queries processed during the measurement, also report the energy per
+ * query (J) and the queries per joule (`qps_per_watt`).
+ */
+inline void report_power(::benchmark::State& state, power_meter& meter, std::size_t n_queries)
+{
+  auto [energy, duration] = meter.stop();
+  if (!meter.found() || duration <= 0) { return; }
+  state.counters.insert({{"power", energy / duration},
+                         {"energy", {energy, benchmark::Counter::kAvgIterations}}});
+  if (n_queries > 0 && energy > 0) {
+    state.counters.insert({{"energy_per_query", energy / n_queries},
+                           {"qps_per_watt", n_queries / energy}});
+  }
+}
+
 template <typename T>
 void bench_build(::benchmark::State& state,
                  std::shared_ptr<const Dataset<T>> dataset,
@@ -152,6 +300,7 @@ void bench_build(::benchmark::State& state,
   cuda_timer gpu_timer;
   {
     nvtx_case nvtx{state.name()};
+    power_meter power{power_enabled};
     for (auto _ : state) {
       [[maybe_unused]] auto ntx_lap = nvtx.lap();
       [[maybe_unused]] auto gpu_lap = gpu_timer.lap();
@@ -161,6 +310,7 @@ void bench_build(::benchmark::State& state,
         state.SkipWithError(std::string(e.what()));
       }
     }
+    report_power(state, power, 0);
   }
   state.counters.insert(
     {{"GPU", gpu_timer.total_time() / state.iterations()}, {"index_size", index_size}});
@@ -175,7 +325,8 @@ void bench_search(::benchmark::State& state,
                   Configuration::Index index,
                   std::size_t search_param_ix,
                   std::shared_ptr<const Dataset<T>> dataset,
-                  Objective metric_objective)
+                  Objective metric_objective,
+                  double target_qps)
 {
   std::size_t queries_processed = 0;
 
@@ -290,22 +441,47 @@ void bench_search(::benchmark::State& state,
   {
     nvtx_case nvtx{state.name()};
 
-    auto algo  = dynamic_cast<ANN<T>*>(current_algo.get())->copy();
-    auto start = std::chrono::high_resolution_clock::now();
+    // Open-loop mode: the batches arrive as a Poisson process at the target rate split evenly
+    // between the threads, regardless of how fast the previous ones are served; the latency of a
+    // request is measured from its scheduled arrival, so it includes the time spent in the queue.
+    const bool open_loop = target_qps > 0;
+    std::vector<double> latencies{};
+    std::mt19937_64 rng{static_cast<std::uint64_t>(state.thread_index()) + 1};
+    std::exponential_distribution<double> inter_arrival{
+      open_loop ? target_qps / static_cast<double>(n_queries * state.threads()) : 1.0};
+
+    auto algo = dynamic_cast<ANN<T>*>(current_algo.get())->copy();
+    if (phase_times_enabled) { algo->enable_phase_times(); }
+    // the power is that of the whole device: the first thread measures it for all of them
+    power_meter power{power_enabled && state.thread_index() == 0};
+    auto start   = std::chrono::high_resolution_clock::now();
+    auto arrival = start;
     for (auto _ : state) {
-      [[maybe_unused]] auto ntx_lap = nvtx.lap();
-      [[maybe_unused]] auto gpu_lap = gpu_timer.lap();
-
-      // run the search
-      try {
-        algo->search(query_set + batch_offset * dataset->dim(),
-                     n_queries,
-                     k,
-                     neighbors->data + out_offset * k,
-                     distances->data + out_offset * k,
-                     gpu_timer.stream());
-      } catch (const std::exception& e) {
-        state.SkipWithError(std::string(e.what()));
+      if (open_loop) {
+        arrival += std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+          std::chrono::duration<double>(inter_arrival(rng)));
+        std::this_thread::sleep_until(arrival);
+      }
+      {
+        [[maybe_unused]] auto ntx_lap = nvtx.lap();
+        [[maybe_unused]] auto gpu_lap = gpu_timer.lap();
+
+        // run the search
+        try {
+          algo->search(query_set + batch_offset * dataset->dim(),
+                       n_queries,
+                       k,
+                       neighbors->data + out_offset * k,
+                       distances->data + out_offset * k,
+                       gpu_timer.stream());
+        } catch (const std::exception& e) {
+          state.SkipWithError(std::string(e.what()));
+        }
+      }
+      // the GPU lap has waited for the completion of the search on the stream
+      if (open_loop) {
+        auto done = std::chrono::high_resolution_clock::now();
+        latencies.push_back(std::chrono::duration<double>(done - arrival).count());
       }
 
       // advance to the next batch
@@ -317,7 +493,22 @@ void bench_search(::benchmark::State& state,
     auto end      = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
     if (state.thread_index() == 0) { state.counters.insert({{"end_to_end", duration}}); }
+    // all the threads run the same number of iterations of the same batch size
+    report_power(state, power, queries_processed * state.threads());
     state.counters.insert({"Latency", {duration, benchmark::Counter::kAvgIterations}});
+    // the breakdown of the "GPU" time by the phases of the algorithm
+    for (const auto& [phase, seconds] : algo->collect_phase_times()) {
+      state.counters.insert({"GPU/" + phase, {seconds, benchmark::Counter::kAvgIterations}});
+    }
+    if (open_loop) {
+      if (state.thread_index() == 0) { state.counters.insert({{"target_qps", target_qps}}); }
+      report_latency_percentiles(state, latencies);
+    }
+    // All threads search the same index object, each through its own copy of the wrapper.
+    if (!open_loop && metric_objective == Objective::THROUGHPUT) {
+      report_thread_scaling(
+        state, index.name + "/" + std::to_string(search_param_ix), queries_processed, duration);
+    }
   }
 
   state.SetItemsProcessed(queries_processed);
@@ -337,39 +528,772 @@ void bench_search(::benchmark::State& state,
   // Each thread calculates recall on their partition of queries.
   // evaluate recall
   if (dataset->max_k() >= k) {
-    const std::int32_t* gt          = dataset->gt_set();
-    const std::uint32_t max_k       = dataset->max_k();
     buf<std::size_t> neighbors_host = neighbors->move(MemoryType::Host);
     std::size_t rows                = std::min(queries_processed, query_set_size);
-    std::size_t match_count         = 0;
     std::size_t total_count         = rows * static_cast<size_t>(k);
+    std::size_t first_batch         = (state.thread_index() * n_queries) % query_set_size;
+    std::size_t match_count         = count_recall_matches(*dataset,
+                                                           neighbors_host.data,
+                                                           k,
+                                                           n_queries,
+                                                           rows,
+                                                           first_batch,
+                                                           queries_stride,
+                                                           query_set_size);
+    double actual_recall = static_cast<double>(match_count) / static_cast<double>(total_count);
+    state.counters.insert({"Recall", {actual_recall, benchmark::Counter::kAvgThreads}});
+  }
+}
+
+/** Parameters of the multi-GPU benchmarks (`--devices`). */
+struct MultiGpuConfig {
+  std::vector<int> devices{};  // empty: the single-device benchmarks
+  bool sharded = false;        // one shard of the index per device instead of a full replica
+
+  [[nodiscard]] auto enabled() const -> bool { return !devices.empty(); }
+};
+
+/** The index file of a shard (a single shard is the whole index). */
+inline auto shard_index_file(const std::string& index_file,
+                             std::size_t shard,
+                             std::size_t n_shards) -> std::string
+{
+  if (n_shards == 1) { return index_file; }
+  return index_file + ".shard" + std::to_string(shard) + "of" + std::to_string(n_shards);
+}
+
+/** The first row and the number of rows of a shard; the shards split the base set evenly. */
+inline auto shard_rows(std::size_t n_rows, std::size_t shard, std::size_t n_shards)
+  -> std::tuple<std::size_t, std::size_t>
+{
+  std::size_t begin = n_rows * shard / n_shards;
+  std::size_t end   = n_rows * (shard + 1) / n_shards;
+  return {begin, end - begin};
+}
+
+/** Copy a host array to a new buffer of the given memory type (on the current device). */
+template <typename T>
+auto copy_to(MemoryType memory_type, const T* host_data, std::size_t size)
+  -> std::unique_ptr<buf<T>>
+{
+  auto r = std::make_unique<buf<T>>(memory_type, size);
+#ifndef BUILD_CPU_ONLY
+  if (memory_type == MemoryType::Device) {
+    cudaMemcpy(r->data, host_data, size * sizeof(T), cudaMemcpyDefault);
+    return r;
+  }
+#endif
+  std::memcpy(r->data, host_data, size * sizeof(T));
+  return r;
+}
+
+/** Wait for the work submitted to a stream of the current device. */
+inline void sync_stream(cudaStream_t stream)
+{
+#ifndef BUILD_CPU_ONLY
+  cudaStreamSynchronize(stream);
+#endif
+}
+
+template <typename T>
+void bench_build_shards(::benchmark::State& state,
+                        std::shared_ptr<const Dataset<T>> dataset,
+                        Configuration::Index index,
+                        bool force_overwrite,
+                        std::vector<int> devices)
+{
+  dump_parameters(state, index.build_param);
+  const std::size_t n_shards = devices.size();
+  std::vector<std::string> files{};
+  bool all_exist = true;
+  for (std::size_t i = 0; i < n_shards; i++) {
+    files.push_back(shard_index_file(index.file, i, n_shards));
+    all_exist = all_exist && file_exists(files.back());
+  }
+  if (all_exist) {
+    if (force_overwrite) {
+      log_info("Overwriting the shards of: %s", index.file.c_str());
+    } else {
+      return state.SkipWithMessage(
+        "Index shard files already exist (use --force to overwrite the index).");
+    }
+  }
+
+  // The per-device state; released on its device after the benchmark.
+  std::vector<std::unique_ptr<ANN<T>>> algos(n_shards);
+  std::vector<std::unique_ptr<buf<T>>> shard_copies(n_shards);
+  std::vector<std::unique_ptr<cuda_timer>> gpu_timers(n_shards);
+  std::vector<const T*> shard_data(n_shards, nullptr);
+  std::vector<std::size_t> shard_size(n_shards, 0);
+  auto release = [&]() {
+    for (std::size_t i = 0; i < n_shards; i++) {
+      device_scope scope(devices[i]);
+      algos[i].reset();
+      shard_copies[i].reset();
+      gpu_timers[i].reset();
+    }
+  };
+
+  try {
+    for (std::size_t i = 0; i < n_shards; i++) {
+      device_scope scope(devices[i]);
+      algos[i] = ann::create_algo<T>(
+        index.algo, dataset->distance(), dataset->dim(), index.build_param, index.dev_list);
+      gpu_timers[i] = std::make_unique<cuda_timer>();
+    }
+  } catch (const std::exception& e) {
+    release();
+    return state.SkipWithError("Failed to create an algo: " + std::string(e.what()));
+  }
+
+  const auto algo_property = parse_algo_property(algos[0]->get_preference(), index.build_param);
+  const auto dim           = static_cast<std::size_t>(dataset->dim());
+  for (std::size_t i = 0; i < n_shards; i++) {
+    auto [offset, size] = shard_rows(dataset->base_set_size(), i, n_shards);
+    shard_size[i]       = size;
+    if (algo_property.dataset_memory_type == MemoryType::Device) {
+      device_scope scope(devices[i]);
+      shard_copies[i] = copy_to(
+        MemoryType::Device, dataset->base_set(MemoryType::HostMmap) + offset * dim, size * dim);
+      shard_data[i] = shard_copies[i]->data;
+    } else {
+      shard_data[i] = dataset->base_set(algo_property.dataset_memory_type) + offset * dim;
+    }
+  }
+
+  {
+    nvtx_case nvtx{state.name()};
+    for (auto _ : state) {
+      [[maybe_unused]] auto ntx_lap = nvtx.lap();
+      // The shards are built concurrently, a host thread per device.
+      std::vector<std::string> errors(n_shards);
+      std::vector<std::thread> workers{};
+      for (std::size_t i = 0; i < n_shards; i++) {
+        workers.emplace_back([&, i]() {
+          device_scope scope(devices[i]);
+          try {
+            [[maybe_unused]] auto gpu_lap = gpu_timers[i]->lap();
+            algos[i]->build(shard_data[i], shard_size[i], gpu_timers[i]->stream());
+          } catch (const std::exception& e) {
+            errors[i] = e.what();
+          }
+        });
+      }
+      for (auto& worker : workers) {
+        worker.join();
+      }
+      for (const auto& error : errors) {
+        if (!error.empty()) { state.SkipWithError(error); }
+      }
+    }
+  }
+  // The build time is that of the slowest shard.
+  double gpu_time = 0;
+  for (const auto& timer : gpu_timers) {
+    gpu_time = std::max(gpu_time, timer->total_time());
+  }
+  state.counters.insert({{"GPU", gpu_time / state.iterations()},
+                         {"index_size", dataset->base_set_size()},
+                         {"shards", n_shards}});
+
+  if (!state.skipped()) {
+    for (std::size_t i = 0; i < n_shards; i++) {
+      device_scope scope(devices[i]);
+      make_sure_parent_dir_exists(files[i]);
+      algos[i]->save(files[i]);
+    }
+  }
+  release();
+}
+
+/** An index loaded on one of the devices of the multi-GPU search benchmark. */
+template <typename T>
+struct device_replica {
+  int device;
+  std::size_t offset = 0;  // the first row of the shard in the base set
+  std::size_t size   = 0;  // the number of rows of the shard
+  std::unique_ptr<ANN<T>> algo{};
+  AlgoProperty props{};
+  const T* queries = nullptr;  // the query set in the memory of `props.query_memory_type`
+  std::unique_ptr<buf<T>> query_copy{};
+  std::unique_ptr<buf<T>> base_copy{};
+
+  explicit device_replica(int device) : device(device) {}
+  ~device_replica() noexcept
+  {
+    // the resources of the algorithm must be released on its device
+    device_scope scope(device);
+    algo.reset();
+    query_copy.reset();
+    base_copy.reset();
+  }
+};
+
+// The indices of the multi-GPU search benchmark, cached between the search runs of the same index.
+template <typename T>
+inline std::vector<std::unique_ptr<device_replica<T>>> device_replicas{};
+inline std::string device_replicas_key{};
+inline std::string device_replicas_error{};
+
+// The throughput of the multi-GPU search benchmark, merged across the benchmark threads. The
+// throughput on a single device of each case is the baseline of its scaling efficiency.
+std::mutex scaling_mutex;
+std::size_t scaling_queries{0};
+double scaling_duration{0};
+int scaling_threads{0};
+std::map<std::string, double> single_device_qps{};
+
+/**
+ * Load the index on each device of the multi-GPU benchmark (the whole index or a shard of it),
+ * then set the search parameters and the per-device copies of the data on them.
+ */
+template <typename T>
+void load_device_replicas(const Configuration::Index& index,
+                          const nlohmann::json& sp_json,
+                          const Dataset<T>& dataset,
+                          Objective metric_objective,
+                          const MultiGpuConfig& multi_gpu)
+{
+  auto& replicas             = device_replicas<T>;
+  const std::size_t n_shards = multi_gpu.sharded ? multi_gpu.devices.size() : 1;
+  const auto dim             = static_cast<std::size_t>(dataset.dim());
+  std::stringstream key;
+  key << index.file << (multi_gpu.sharded ? "/sharded:" : "/replicated:");
+  for (auto device : multi_gpu.devices) {
+    key << device << ",";
+  }
+  if (key.str() != device_replicas_key) {
+    replicas.clear();
+    device_replicas_key.clear();
+    for (std::size_t i = 0; i < multi_gpu.devices.size(); i++) {
+      auto replica = std::make_unique<device_replica<T>>(multi_gpu.devices[i]);
+      device_scope scope(replica->device);
+      std::tie(replica->offset, replica->size) =
+        shard_rows(dataset.base_set_size(), n_shards == 1 ? 0 : i, n_shards);
+      auto file = shard_index_file(index.file, n_shards == 1 ? 0 : i, n_shards);
+      if (!file_exists(file)) {
+        throw std::runtime_error("Index file '" + file +
+                                 "' is missing. Run the benchmark in the build mode first.");
+      }
+      replica->algo = ann::create_algo<T>(
+        index.algo, dataset.distance(), dataset.dim(), index.build_param, index.dev_list);
+      replica->algo->load(file);
+      replicas.push_back(std::move(replica));
+    }
+    device_replicas_key = key.str();
+  }
+
+  for (auto& replica : replicas) {
+    device_scope scope(replica->device);
+    auto search_param              = ann::create_search_param<T>(index.algo, sp_json);
+    search_param->metric_objective = metric_objective;
+    replica->props = parse_algo_property(replica->algo->get_preference(), sp_json);
+    if (search_param->needs_dataset()) {
+      const T* base_set = nullptr;
+      if (replica->props.dataset_memory_type == MemoryType::Device) {
+        if (!replica->base_copy) {
+          const T* shard     = dataset.base_set(MemoryType::HostMmap) + replica->offset * dim;
+          replica->base_copy = copy_to(MemoryType::Device, shard, replica->size * dim);
+        }
+        base_set = replica->base_copy->data;
+      } else {
+        base_set = dataset.base_set(replica->props.dataset_memory_type) + replica->offset * dim;
+      }
+      replica->algo->set_search_dataset(base_set, replica->size);
+    }
+    replica->algo->set_search_param(*search_param);
+    if (replica->props.query_memory_type == MemoryType::Device) {
+      if (!replica->query_copy) {
+        replica->query_copy =
+          copy_to(MemoryType::Device, dataset.query_set(), dataset.query_set_size() * dim);
+      }
+      replica->queries = replica->query_copy->data;
+    } else {
+      replica->queries = dataset.query_set(replica->props.query_memory_type);
+    }
+  }
+}
+
+/**
+ * Merge the neighbors of a query batch found in the shards of the index: offset the neighbor ids by
+ * the first row of their shard and select the `k` best of the `n_shards * k` candidates.
+ *
+ * @param shards the host pointers to the neighbors, the distances and the first row of each shard
+ */
+inline void merge_shard_results(
+  const std::vector<std::tuple<const std::size_t*, const float*, std::size_t>>& shards,
+  std::size_t n_queries,
+  std::uint32_t k,
+  bool select_min,
+  std::size_t* neighbors,
+  float* distances)
+{
+  constexpr auto kInvalid = std::numeric_limits<std::size_t>::max();
+  std::vector<std::tuple<float, std::size_t>> candidates(shards.size() * k);
+  for (std::size_t q = 0; q < n_queries; q++) {
+    std::size_t c = 0;
+    for (const auto& [ids, dists, offset] : shards) {
+      for (std::uint32_t j = 0; j < k; j++, c++) {
+        auto id       = ids[q * k + j];
+        candidates[c] = {dists[q * k + j], id == kInvalid ? kInvalid : id + offset};
+      }
+    }
+    auto better = [select_min](const auto& a, const auto& b) {
+      return select_min ? std::get<0>(a) < std::get<0>(b) : std::get<0>(a) > std::get<0>(b);
+    };
+    std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(), better);
+    for (std::uint32_t j = 0; j < k; j++) {
+      distances[q * k + j] = std::get<0>(candidates[j]);
+      neighbors[q * k + j] = std::get<1>(candidates[j]);
+    }
+  }
+}
+
+/**
+ * Merge the throughput of the threads of the multi-GPU benchmark; the last thread to finish
+ * reports the aggregate QPS and the scaling efficiency relative to the same case on one device.
+ */
+inline void report_multi_gpu_scaling(::benchmark::State& state,
+                                     const std::string& case_key,
+                                     std::size_t n_devices,
+                                     std::size_t queries_processed,
+                                     double duration)
+{
+  std::lock_guard<std::mutex> lock(scaling_mutex);
+  scaling_queries += queries_processed;
+  scaling_duration = std::max(scaling_duration, duration);
+  if (++scaling_threads < state.threads()) { return; }
+  double qps = scaling_duration > 0 ? static_cast<double>(scaling_queries) / scaling_duration : 0;
+  state.counters.insert({{"devices", n_devices}, {"aggregate_qps", qps}});
+  if (n_devices == 1) { single_device_qps[case_key] = qps; }
+  auto baseline = single_device_qps.find(case_key);
+  if (baseline != single_device_qps.end() && baseline->second > 0) {
+    state.counters.insert(
+      {{"scaling_efficiency", qps / (static_cast<double>(n_devices) * baseline->second)}});
+  }
+  scaling_queries  = 0;
+  scaling_duration = 0;
+  scaling_threads  = 0;
+}
+
+template <typename T>
+void bench_search_multi_gpu(::benchmark::State& state,
+                            Configuration::Index index,
+                            std::size_t search_param_ix,
+                            std::shared_ptr<const Dataset<T>> dataset,
+                            Objective metric_objective,
+                            std::string case_name,
+                            MultiGpuConfig multi_gpu)
+{
+  std::size_t queries_processed = 0;
+
+  const auto& sp_json = index.search_params[search_param_ix];
 
-    // We go through the groundtruth with same stride as the benchmark loop.
-    size_t out_offset   = 0;
-    size_t batch_offset = (state.thread_index() * n_queries) % query_set_size;
-    while (out_offset < rows) {
-      for (std::size_t i = 0; i < n_queries; i++) {
-        size_t i_orig_idx = batch_offset + i;
-        size_t i_out_idx  = out_offset + i;
-        if (i_out_idx < rows) {
-          for (std::uint32_t j = 0; j < k; j++) {
-            auto act_idx = std::int32_t(neighbors_host.data[i_out_idx * k + j]);
-            for (std::uint32_t l = 0; l < k; l++) {
-              auto exp_idx = gt[i_orig_idx * max_k + l];
-              if (act_idx == exp_idx) {
-                match_count++;
-                break;
-              }
+  if (state.thread_index() == 0) { dump_parameters(state, sp_json); }
+
+  // NB: `k` and `n_queries` are guaranteed to be populated in conf.cpp
+  const std::uint32_t k            = sp_json["k"];
+  const std::size_t n_queries      = sp_json["n_queries"];
+  const std::size_t query_set_size = (dataset->query_set_size() / n_queries) * n_queries;
+  const std::size_t n_devices      = multi_gpu.devices.size();
+  const auto dim                   = static_cast<std::size_t>(dataset->dim());
+
+  if (dataset->query_set_size() < n_queries) {
+    std::stringstream msg;
+    msg << "Not enough queries in benchmark set. Expected " << n_queries << ", actual "
+        << dataset->query_set_size();
+    return state.SkipWithError(msg.str());
+  }
+
+  // The same initialization protocol as in `bench_search`: the first thread loads the indices.
+  if (state.thread_index() == 0) {
+    std::unique_lock lk(init_mutex);
+    cond_var.wait(lk, [] { return processed_threads.load(std::memory_order_acquire) == 0; });
+    device_replicas_error.clear();
+    try {
+      load_device_replicas<T>(index, sp_json, *dataset, metric_objective, multi_gpu);
+    } catch (const std::exception& e) {
+      device_replicas_error = e.what();
+      device_replicas<T>.clear();
+      device_replicas_key.clear();
+    }
+    processed_threads.store(state.threads(), std::memory_order_acq_rel);
+    cond_var.notify_all();
+  } else {
+    std::unique_lock lk(init_mutex);
+    cond_var.wait(lk, [&state] {
+      return processed_threads.load(std::memory_order_acquire) == state.threads();
+    });
+  }
+  if (!device_replicas_error.empty()) {
+    auto error = device_replicas_error;
+    if (--processed_threads == 0) { cond_var.notify_all(); }
+    return state.SkipWithError("Failed to load the index: " + error);
+  }
+
+  // Replicated: the threads are assigned to the devices round-robin; each searches its replica.
+  // Sharded: each thread searches every shard and merges the results on the host.
+  struct target {
+    device_replica<T>* replica;
+    std::unique_ptr<ANN<T>> algo;
+    std::unique_ptr<cuda_timer> gpu_timer;
+    std::unique_ptr<buf<std::size_t>> neighbors;
+    std::unique_ptr<buf<float>> distances;
+    std::vector<std::size_t> neighbors_host{};
+    std::vector<float> distances_host{};
+  };
+  std::vector<target> targets{};
+  const std::size_t out_rows = multi_gpu.sharded ? n_queries : query_set_size;
+  for (std::size_t i = 0; i < n_devices; i++) {
+    if (!multi_gpu.sharded && i != static_cast<std::size_t>(state.thread_index()) % n_devices) {
+      continue;
+    }
+    auto* replica = device_replicas<T>[i].get();
+    device_scope scope(replica->device);
+    auto mem_type = replica->props.query_memory_type;
+    targets.push_back(target{replica,
+                             replica->algo->copy(),
+                             std::make_unique<cuda_timer>(),
+                             std::make_unique<buf<std::size_t>>(mem_type, k * out_rows),
+                             std::make_unique<buf<float>>(mem_type, k * out_rows)});
+    if (multi_gpu.sharded && mem_type == MemoryType::Device) {
+      targets.back().neighbors_host.resize(k * out_rows);
+      targets.back().distances_host.resize(k * out_rows);
+    }
+  }
+  // The merged results of the sharded search.
+  std::vector<std::size_t> merged_neighbors(multi_gpu.sharded ? k * query_set_size : 0);
+  std::vector<float> merged_distances(multi_gpu.sharded ? k * query_set_size : 0);
+  const bool select_min = dataset->distance() != "inner_product";
+
+  std::ptrdiff_t batch_offset   = (state.thread_index() * n_queries) % query_set_size;
+  std::ptrdiff_t queries_stride = state.threads() * n_queries;
+  std::ptrdiff_t out_offset     = 0;
+  double merge_time             = 0;
+  {
+    nvtx_case nvtx{state.name()};
+    // The replicated search runs on a single device for the whole benchmark.
+    std::optional<device_scope> thread_device{std::nullopt};
+    if (!multi_gpu.sharded) { thread_device.emplace(targets[0].replica->device); }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto _ : state) {
+      [[maybe_unused]] auto ntx_lap = nvtx.lap();
+      try {
+        if (!multi_gpu.sharded) {
+          auto& t                       = targets[0];
+          [[maybe_unused]] auto gpu_lap = t.gpu_timer->lap();
+          t.algo->search(t.replica->queries + batch_offset * dim,
+                         n_queries,
+                         k,
+                         t.neighbors->data + out_offset * k,
+                         t.distances->data + out_offset * k,
+                         t.gpu_timer->stream());
+        } else {
+          // submit the batch to all the shards, then wait for all of them
+          for (auto& t : targets) {
+            device_scope scope(t.replica->device);
+            t.algo->search(t.replica->queries + batch_offset * dim,
+                           n_queries,
+                           k,
+                           t.neighbors->data,
+                           t.distances->data,
+                           t.gpu_timer->stream());
+          }
+          for (auto& t : targets) {
+            device_scope scope(t.replica->device);
+            sync_stream(t.gpu_timer->stream());
+          }
+          auto merge_start = std::chrono::high_resolution_clock::now();
+          std::vector<std::tuple<const std::size_t*, const float*, std::size_t>> shards{};
+          for (auto& t : targets) {
+            if (t.neighbors_host.empty()) {
+              shards.emplace_back(t.neighbors->data, t.distances->data, t.replica->offset);
+              continue;
             }
+            // gather the results of the shards on the host
+            device_scope scope(t.replica->device);
+            auto n_results = static_cast<std::size_t>(k) * n_queries;
+#ifndef BUILD_CPU_ONLY
+            cudaMemcpy(t.neighbors_host.data(),
+                       t.neighbors->data,
+                       n_results * sizeof(std::size_t),
+                       cudaMemcpyDefault);
+            cudaMemcpy(t.distances_host.data(),
+                       t.distances->data,
+                       n_results * sizeof(float),
+                       cudaMemcpyDefault);
+#endif
+            shards.emplace_back(
+              t.neighbors_host.data(), t.distances_host.data(), t.replica->offset);
           }
+          merge_shard_results(shards,
+                              n_queries,
+                              k,
+                              select_min,
+                              merged_neighbors.data() + out_offset * k,
+                              merged_distances.data() + out_offset * k);
+          merge_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() -
+                                                      merge_start)
+                          .count();
         }
+      } catch (const std::exception& e) {
+        state.SkipWithError(std::string(e.what()));
       }
-      out_offset += n_queries;
+
+      // advance to the next batch
       batch_offset = (batch_offset + queries_stride) % query_set_size;
+      out_offset   = (out_offset + n_queries) % query_set_size;
+
+      queries_processed += n_queries;
+    }
+    auto end      = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+    if (state.thread_index() == 0) { state.counters.insert({{"end_to_end", duration}}); }
+    state.counters.insert({"Latency", {duration, benchmark::Counter::kAvgIterations}});
+
+    // the threads per device, to compare the runs with the same load of each device
+    auto threads_per_device = multi_gpu.sharded ? state.threads() : state.threads() / n_devices;
+    auto case_key = case_name + "/threads_per_device:" + std::to_string(threads_per_device);
+    report_multi_gpu_scaling(state, case_key, n_devices, queries_processed, duration);
+  }
+
+  state.SetItemsProcessed(queries_processed);
+  if (multi_gpu.sharded) {
+    // the gathering of the shard results on the host and their merge
+    state.counters.insert({"merge", {merge_time, benchmark::Counter::kAvgIterations}});
+  } else if (cudart.found()) {
+    state.counters.insert(
+      {"GPU", {targets[0].gpu_timer->total_time(), benchmark::Counter::kAvgIterations}});
+  }
+
+  // This will be the total number of queries across all threads
+  state.counters.insert({{"total_queries", queries_processed}});
+
+  // Evaluate the recall before releasing the per-thread resources on their devices.
+  if (!state.skipped() && dataset->max_k() >= k) {
+    std::size_t rows        = std::min(queries_processed, query_set_size);
+    std::size_t total_count = rows * static_cast<size_t>(k);
+    std::size_t first_batch = (state.thread_index() * n_queries) % query_set_size;
+    std::size_t match_count = 0;
+    if (multi_gpu.sharded) {
+      match_count = count_recall_matches(*dataset,
+                                         merged_neighbors.data(),
+                                         k,
+                                         n_queries,
+                                         rows,
+                                         first_batch,
+                                         queries_stride,
+                                         query_set_size);
+    } else {
+      device_scope scope(targets[0].replica->device);
+      buf<std::size_t> neighbors_host = targets[0].neighbors->move(MemoryType::Host);
+      match_count                     = count_recall_matches(*dataset,
+                                         neighbors_host.data,
+                                         k,
+                                         n_queries,
+                                         rows,
+                                         first_batch,
+                                         queries_stride,
+                                         query_set_size);
     }
     double actual_recall = static_cast<double>(match_count) / static_cast<double>(total_count);
     state.counters.insert({"Recall", {actual_recall, benchmark::Counter::kAvgThreads}});
   }
+
+  for (auto& t : targets) {
+    device_scope scope(t.replica->device);
+    t.algo.reset();
+    t.gpu_timer.reset();
+    t.neighbors.reset();
+    t.distances.reset();
+  }
+  if (--processed_threads == 0) { cond_var.notify_all(); }
+}
+
+/** Parameters of the streaming ingest scenario (`--mode=ingest`). */
+struct IngestConfig {
+  bool enabled = false;
+  // the fraction of the base set indexed before the ingestion starts
+  double start_fraction = 0.5;
+  // the number of rows added per iteration
+  std::size_t batch_rows = 10000;
+};
+
+/**
+ * The streaming ingest scenario: build the index on the first part of the base set, then
+ * interleave the ingestion of the remaining rows (one `extend` batch per iteration) with the
+ * search of a query batch. Reports the ingest throughput, the search latency under ingest, and
+ * the final recall compared to that of the index built on the whole base set (`recall_drift`).
+ */
+template <typename T>
+void bench_ingest(::benchmark::State& state,
+                  Configuration::Index index,
+                  std::size_t search_param_ix,
+                  std::shared_ptr<const Dataset<T>> dataset,
+                  IngestConfig ingest)
+{
+  const auto& sp_json = index.search_params[search_param_ix];
+  dump_parameters(state, sp_json);
+
+  // NB: `k` and `n_queries` are guaranteed to be populated in conf.cpp
+  const std::uint32_t k       = sp_json["k"];
+  const std::size_t n_queries = sp_json["n_queries"];
+  if (dataset->query_set_size() < n_queries) {
+    std::stringstream msg;
+    msg << "Not enough queries in benchmark set. Expected " << n_queries << ", actual "
+        << dataset->query_set_size();
+    return state.SkipWithError(msg.str());
+  }
+  const std::size_t query_set_size = (dataset->query_set_size() / n_queries) * n_queries;
+  const std::size_t n_rows         = dataset->base_set_size();
+  std::size_t n_indexed            = static_cast<std::size_t>(ingest.start_fraction * n_rows);
+
+  // This benchmark modifies its index, so it cannot use the cached one; release it to save memory.
+  current_algo.reset();
+  std::unique_ptr<ANN<T>> algo;
+  std::unique_ptr<typename ANN<T>::AnnSearchParam> search_param;
+  try {
+    algo = ann::create_algo<T>(
+      index.algo, dataset->distance(), dataset->dim(), index.build_param, index.dev_list);
+    search_param                   = ann::create_search_param<T>(index.algo, sp_json);
+    search_param->metric_objective = Objective::LATENCY;
+  } catch (const std::exception& e) {
+    return state.SkipWithError("Failed to create an algo: " + std::string(e.what()));
+  }
+  auto props         = parse_algo_property(algo->get_preference(), sp_json);
+  const T* base_set  = dataset->base_set(props.dataset_memory_type);
+  const T* query_set = dataset->query_set(props.query_memory_type);
+
+  cuda_timer eval_timer;
+  try {
+    {
+      [[maybe_unused]] auto lap = eval_timer.lap();
+      algo->build(base_set, n_indexed, eval_timer.stream());
+    }
+    if (search_param->needs_dataset()) { algo->set_search_dataset(base_set, n_indexed); }
+    algo->set_search_param(*search_param);
+  } catch (const std::exception& e) {
+    return state.SkipWithError("Failed to build the initial index: " + std::string(e.what()));
+  }
+
+  buf<float> distances{props.query_memory_type, k * query_set_size};
+  buf<std::size_t> neighbors{props.query_memory_type, k * query_set_size};
+  buf<std::size_t> ids{MemoryType::Host, ingest.batch_rows};
+  std::vector<double> search_latencies{};
+  double ingest_time          = 0;
+  std::size_t ingested_rows   = 0;
+  std::size_t batch_offset    = 0;
+  std::size_t queries_written = 0;
+  {
+    nvtx_case nvtx{state.name()};
+    cuda_timer ingest_timer;
+    cuda_timer search_timer;
+    for (auto _ : state) {
+      [[maybe_unused]] auto ntx_lap = nvtx.lap();
+      try {
+        auto batch = std::min(ingest.batch_rows, n_rows - n_indexed);
+        if (batch > 0) {
+          std::iota(ids.data, ids.data + batch, n_indexed);
+          // copied to the device, or the host buffer is handed over
+          auto batch_ids    = ids.move(props.query_memory_type);
+          auto ingest_start = std::chrono::high_resolution_clock::now();
+          {
+            [[maybe_unused]] auto lap = ingest_timer.lap();
+            algo->extend(
+              base_set + n_indexed * dataset->dim(), batch_ids.data, batch, ingest_timer.stream());
+          }
+          std::chrono::duration<double> ingest_duration =
+            std::chrono::high_resolution_clock::now() - ingest_start;
+          ingest_time += ingest_duration.count();
+          n_indexed += batch;
+          ingested_rows += batch;
+          if (search_param->needs_dataset()) { algo->set_search_dataset(base_set, n_indexed); }
+        }
+
+        auto search_start = std::chrono::high_resolution_clock::now();
+        {
+          [[maybe_unused]] auto lap = search_timer.lap();
+          algo->search(query_set + batch_offset * dataset->dim(),
+                       n_queries,
+                       k,
+                       neighbors.data + batch_offset * k,
+                       distances.data + batch_offset * k,
+                       search_timer.stream());
+        }
+        std::chrono::duration<double> search_duration =
+          std::chrono::high_resolution_clock::now() - search_start;
+        search_latencies.push_back(search_duration.count());
+      } catch (const std::exception& e) {
+        state.SkipWithError(std::string(e.what()));
+        break;
+      }
+      batch_offset = (batch_offset + n_queries) % query_set_size;
+      queries_written += n_queries;
+    }
+  }
+  if (state.skipped()) { return; }
+
+  state.SetItemsProcessed(queries_written);
+  state.counters.insert({{"ingested_rows", ingested_rows}});
+  if (ingest_time > 0) {
+    state.counters.insert({{"ingest_rows_per_second", ingested_rows / ingest_time}});
+  }
+  std::sort(search_latencies.begin(), search_latencies.end());
+  if (!search_latencies.empty()) {
+    state.counters.insert({{"latency_p50", percentile(search_latencies, 50)},
+                           {"latency_p99", percentile(search_latencies, 99)}});
+  }
+
+  // Search the whole query set with the final index and compare the recall to that of the index
+  // built in one go (if available).
+  if (dataset->max_k() < k) { return; }
+  auto evaluate_recall = [&](const ANN<T>& a) {
+    {
+      [[maybe_unused]] auto lap = eval_timer.lap();
+      for (std::size_t i = 0; i < query_set_size; i += n_queries) {
+        a.search(query_set + i * dataset->dim(),
+                 n_queries,
+                 k,
+                 neighbors.data + i * k,
+                 distances.data + i * k,
+                 eval_timer.stream());
+      }
+    }
+    const std::int32_t* gt          = dataset->gt_set();
+    const std::uint32_t max_k       = dataset->max_k();
+    buf<std::size_t> neighbors_host = neighbors.move(MemoryType::Host);
+    std::size_t match_count         = 0;
+    for (std::size_t i = 0; i < query_set_size; i++) {
+      for (std::uint32_t j = 0; j < k; j++) {
+        auto act_idx = std::int32_t(neighbors_host.data[i * k + j]);
+        for (std::uint32_t l = 0; l < k; l++) {
+          if (act_idx == gt[i * max_k + l]) {
+            match_count++;
+            break;
+          }
+        }
+      }
+    }
+    return static_cast<double>(match_count) / static_cast<double>(query_set_size * k);
+  };
+
+  try {
+    auto recall = evaluate_recall(*algo);
+    state.counters.insert({{"Recall", recall}});
+    algo.reset();
+    if (!file_exists(index.file)) { return; }
+    auto full_build = ann::create_algo<T>(
+      index.algo, dataset->distance(), dataset->dim(), index.build_param, index.dev_list);
+    full_build->load(index.file);
+    if (search_param->needs_dataset()) { full_build->set_search_dataset(base_set, n_rows); }
+    full_build->set_search_param(*search_param);
+    auto full_recall = evaluate_recall(*full_build);
+    state.counters.insert(
+      {{"Recall_full_build", full_recall}, {"recall_drift", full_recall - recall}});
+  } catch (const std::exception& e) {
+    log_warn("Failed to evaluate the recall after ingest: %s", e.what());
+  }
 }
 
 inline void printf_usage()
@@ -381,8 +1305,14 @@ inline void printf_usage()
           "          [--data_prefix=<prefix>]\n"
           "          [--index_prefix=<prefix>]\n"
           "          [--override_kv=<key:value1:value2:...:valueN>]\n"
-          "          [--mode=<latency|throughput>\n"
+          "          [--mode=<latency|throughput|open_loop|ingest|load>\n"
           "          [--threads=min[:max]]\n"
+          "          [--target_qps=<qps1:qps2:...:qpsN>]\n"
+          "          [--ingest_start=<fraction>] [--ingest_batch=<rows>]\n"
+          "          [--tune=<target_recall>]\n"
+          "          [--phase_times]\n"
+          "          [--power]\n"
+          "          [--devices=<d1:d2:...:dN|all>] [--sharding=<replicated|sharded>]\n"
           "          <conf>.json\n"
           "\n"
           "Note the non-standard benchmark parameters:\n"
@@ -400,59 +1330,444 @@ inline void printf_usage()
           " override a build/search key one or more times multiplying the number of configurations;"
           " you can use this parameter multiple times to get the Cartesian product of benchmark"
           " configs.\n"
-          "  --mode=<latency|throughput>"
+          "  --mode=<latency|throughput|open_loop|ingest|load>"
           " run the benchmarks in latency (accumulate times spent in each batch) or "
-          " throughput (pipeline batches and measure end-to-end) mode\n"
-          "  --threads=min[:max] specify the number threads to use for throughput benchmark."
-          " Power of 2 values between 'min' and 'max' will be used. If only 'min' is specified,"
-          " then a single test is run with 'min' threads. By default min=1, max=<num hyper"
-          " threads>.\n");
+          " throughput (pipeline batches and measure end-to-end) or open_loop (issue batches"
+          " at a target rate and report the percentiles of the request latency) or ingest (build"
+          " the index on a part of the base set, then interleave adding the rest of it with"
+          " searching) or load (load the index file and search the first batch, reporting the"
+          " load time and bandwidth and the time to the first query) mode\n"
+          "  --threads=min[:max] specify the number threads to use for throughput and open_loop"
+          " benchmarks. Power of 2 values between 'min' and 'max' will be used. If only 'min' is"
+          " specified, then a single test is run with 'min' threads. By default min=1, max=<num"
+          " hyper threads>.\n"
+          "  --target_qps=<qps1:qps2:...:qpsN> the target rates (queries per second) of the"
+          " open_loop benchmark; each value is a separate test, which gives the latency"
+          " percentiles as a function of the offered load.\n"
+          "  --ingest_start=<fraction> the fraction of the base set indexed before the ingest"
+          " benchmark starts adding vectors (default = 0.5).\n"
+          "  --ingest_batch=<rows> the number of vectors added per iteration of the ingest"
+          " benchmark (default = 10000).\n"
+          "  --tune=<target_recall> instead of running all the search configurations, look for the"
+          " fastest ones reaching the target recall by successive halving (short runs of all of"
+          " them, then longer runs of the best third, and so on) and run the Pareto frontier"
+          " (recall vs QPS) of the measured configurations.\n"
+          "  --phase_times report the GPU time of the phases of the instrumented algorithms"
+          " (e.g. the coarse search, scan, select-k and refine of IVF-PQ) as the 'GPU/<phase>'"
+          " counters of the search benchmarks.\n"
+          "  --power sample the power of the GPU through NVML during the build and search"
+          " benchmarks, reporting the average 'power' (W), the 'energy' per iteration (J) and, for"
+          " the search, the 'energy_per_query' (J) and 'qps_per_watt'.\n"
+          "  --devices=<d1:d2:...:dN|all> run the search on several GPUs concurrently: each case is"
+          " run on the first device, then on all of them, reporting the aggregate QPS and the"
+          " scaling efficiency.\n"
+          "  --sharding=<replicated|sharded> with --devices, load the whole index on each device and"
+          " split the queries between them (replicated, default), or build and load a shard of the"
+          " index per device, search all of them and merge the results (sharded).\n");
 }
 
 template <typename T>
 void register_build(std::shared_ptr<const Dataset<T>> dataset,
                     std::vector<Configuration::Index> indices,
-                    bool force_overwrite)
+                    bool force_overwrite,
+                    const MultiGpuConfig& multi_gpu)
 {
+  // The sharded multi-GPU search needs an index per shard (and the whole index for the baseline).
+  const bool shards = multi_gpu.sharded && multi_gpu.devices.size() > 1;
   for (auto index : indices) {
     auto suf      = static_cast<std::string>(index.build_param["override_suffix"]);
     auto file_suf = suf;
     index.build_param.erase("override_suffix");
     std::replace(file_suf.begin(), file_suf.end(), '/', '-');
     index.file += file_suf;
-    auto* b = ::benchmark::RegisterBenchmark(
-      index.name + suf, bench_build<T>, dataset, index, force_overwrite);
+    ::benchmark::internal::Benchmark* b = nullptr;
+    if (shards) {
+      auto name = index.name + suf + "/shards:" + std::to_string(multi_gpu.devices.size());
+      b         = ::benchmark::RegisterBenchmark(
+        name, bench_build_shards<T>, dataset, index, force_overwrite, multi_gpu.devices);
+    } else {
+      b = ::benchmark::RegisterBenchmark(
+        index.name + suf, bench_build<T>, dataset, index, force_overwrite);
+    }
     b->Unit(benchmark::kSecond);
     b->MeasureProcessCPUTime();
     b->UseRealTime();
   }
 }
 
+template <typename T>
+auto register_search_case(std::shared_ptr<const Dataset<T>> dataset,
+                          const Configuration::Index& index,
+                          std::size_t search_param_ix,
+                          const std::string& name,
+                          Objective metric_objective,
+                          const std::vector<int>& threads,
+                          double target_qps) -> ::benchmark::internal::Benchmark*
+{
+  auto* b = ::benchmark::RegisterBenchmark(
+              name, bench_search<T>, index, search_param_ix, dataset, metric_objective, target_qps)
+              ->Unit(benchmark::kMillisecond)
+              /**
+               * The following are important for getting accuracy QPS measurements on both CPU
+               * and GPU These make sure that
+               *   - `end_to_end` ~ (`Time` * `Iterations`)
+               *   - `items_per_second` ~ (`total_queries` / `end_to_end`)
+               *   - Throughput = `items_per_second`
+               */
+              ->MeasureProcessCPUTime()
+              ->UseRealTime();
+
+  if (metric_objective == Objective::THROUGHPUT) { b->ThreadRange(threads[0], threads[1]); }
+  return b;
+}
+
 template <typename T>
 void register_search(std::shared_ptr<const Dataset<T>> dataset,
                      std::vector<Configuration::Index> indices,
                      Objective metric_objective,
-                     const std::vector<int>& threads)
+                     const std::vector<int>& threads,
+                     const std::vector<double>& target_qps)
 {
+  // A zero target QPS denotes the closed-loop benchmark.
+  auto qps_list = target_qps.empty() ? std::vector<double>{0.0} : target_qps;
   for (auto index : indices) {
     for (std::size_t i = 0; i < index.search_params.size(); i++) {
       auto suf = static_cast<std::string>(index.search_params[i]["override_suffix"]);
       index.search_params[i].erase("override_suffix");
 
-      auto* b = ::benchmark::RegisterBenchmark(
-                  index.name + suf, bench_search<T>, index, i, dataset, metric_objective)
-                  ->Unit(benchmark::kMillisecond)
-                  /**
-                   * The following are important for getting accuracy QPS measurements on both CPU
-                   * and GPU These make sure that
-                   *   - `end_to_end` ~ (`Time` * `Iterations`)
-                   *   - `items_per_second` ~ (`total_queries` / `end_to_end`)
-                   *   - Throughput = `items_per_second`
-                   */
-                  ->MeasureProcessCPUTime()
-                  ->UseRealTime();
+      for (auto qps : qps_list) {
+        auto name = index.name + suf;
+        if (qps > 0) {
+          std::stringstream qps_suf;
+          qps_suf << "/target_qps:" << qps;
+          name += qps_suf.str();
+        }
+        register_search_case<T>(dataset, index, i, name, metric_objective, threads, qps);
+      }
+    }
+  }
+}
 
-      if (metric_objective == Objective::THROUGHPUT) { b->ThreadRange(threads[0], threads[1]); }
+template <typename T>
+void register_search_multi_gpu(std::shared_ptr<const Dataset<T>> dataset,
+                               std::vector<Configuration::Index> indices,
+                               Objective metric_objective,
+                               const std::vector<int>& threads,
+                               const MultiGpuConfig& multi_gpu)
+{
+  // The run on the first device is the baseline of the scaling efficiency of each case.
+  std::vector<std::size_t> device_counts{1};
+  if (multi_gpu.devices.size() > 1) { device_counts.push_back(multi_gpu.devices.size()); }
+  for (auto index : indices) {
+    for (std::size_t i = 0; i < index.search_params.size(); i++) {
+      auto suf = static_cast<std::string>(index.search_params[i]["override_suffix"]);
+      index.search_params[i].erase("override_suffix");
+
+      for (auto n_devices : device_counts) {
+        auto config = multi_gpu;
+        config.devices.resize(n_devices);
+        auto case_name = index.name + suf;
+        auto name      = case_name + "/devices:" + std::to_string(n_devices);
+        auto* b        = ::benchmark::RegisterBenchmark(name,
+                                                        bench_search_multi_gpu<T>,
+                                                        index,
+                                                        i,
+                                                        dataset,
+                                                        metric_objective,
+                                                        case_name,
+                                                        config);
+        b->Unit(benchmark::kMillisecond)->MeasureProcessCPUTime()->UseRealTime();
+        // Replicated: each device is driven by its own group of `threads` threads.
+        int group = multi_gpu.sharded ? 1 : static_cast<int>(n_devices);
+        for (int t = threads[0];; t = std::min(t * 2, threads[1])) {
+          b->Threads(t * group);
+          if (t >= threads[1]) { break; }
+        }
+      }
+    }
+  }
+}
+
+/** Parameters of the search parameter tuner (`--tune`). */
+struct TuneConfig {
+  bool enabled = false;
+  // the recall the tuner looks for the fastest search parameters for
+  double target_recall = 0.95;
+  // the minimum benchmark time per search parameter set in the first round (seconds)
+  double min_time = 0.05;
+  // each round keeps 1/reduction of the candidates and runs them reduction times longer
+  std::size_t reduction = 3;
+};
+
+/** A search parameter set evaluated by the tuner. */
+struct TunePoint {
+  Configuration::Index index;
+  std::size_t search_param_ix;
+  std::string name;
+  double recall = -1;
+  double qps    = 0;
+};
+
+/** Records the recall and QPS of the runs, while displaying them as usual. */
+class TuneReporter : public ::benchmark::ConsoleReporter {
+ public:
+  explicit TuneReporter(std::vector<TunePoint>& points) : points_(points) {}
+
+  void ReportRuns(const std::vector<Run>& runs) override
+  {
+    for (const auto& run : runs) {
+      if (run.run_type != Run::RT_Iteration || run.skipped) { continue; }
+      auto recall = run.counters.find("Recall");
+      auto qps    = run.counters.find("items_per_second");
+      if (recall == run.counters.end() || qps == run.counters.end()) { continue; }
+      for (auto& p : points_) {
+        // keep the best of the thread counts of a throughput benchmark
+        if (p.name == run.run_name.function_name && qps->second.value >= p.qps) {
+          p.recall = recall->second.value;
+          p.qps    = qps->second.value;
+        }
+      }
+    }
+    ConsoleReporter::ReportRuns(runs);
+  }
+
+ private:
+  std::vector<TunePoint>& points_;
+};
+
+/** The points that no other point beats in both the recall and the QPS, by increasing recall. */
+inline auto pareto_frontier(std::vector<TunePoint> points) -> std::vector<TunePoint>
+{
+  std::sort(points.begin(), points.end(), [](const TunePoint& a, const TunePoint& b) {
+    return a.recall > b.recall || (a.recall == b.recall && a.qps > b.qps);
+  });
+  std::vector<TunePoint> frontier;
+  for (auto& p : points) {
+    if (p.recall < 0) { continue; }
+    if (frontier.empty() || p.qps > frontier.back().qps) { frontier.push_back(p); }
+  }
+  std::reverse(frontier.begin(), frontier.end());
+  return frontier;
+}
+
+/**
+ * Search the search parameter space for the fastest configurations reaching the target recall,
+ * by successive halving: all the candidates are benchmarked briefly, then each round reruns only
+ * the most promising fraction of them for longer. The promising candidates are those reaching the
+ * target recall, by decreasing QPS, followed by the others, by decreasing recall.
+ *
+ * The Pareto frontier (recall vs QPS) of all the measurements is registered for the final,
+ * regular benchmark run.
+ */
+template <typename T>
+void tune_search(std::shared_ptr<const Dataset<T>> dataset,
+                 std::vector<Configuration::Index> indices,
+                 Objective metric_objective,
+                 const std::vector<int>& threads,
+                 TuneConfig tune)
+{
+  std::vector<TunePoint> points;
+  for (auto index : indices) {
+    for (std::size_t i = 0; i < index.search_params.size(); i++) {
+      auto suf = static_cast<std::string>(index.search_params[i]["override_suffix"]);
+      index.search_params[i].erase("override_suffix");
+      points.push_back(TunePoint{index, i, index.name + suf});
+    }
+  }
+
+  auto promising = [&tune](const TunePoint& a, const TunePoint& b) {
+    bool a_ok = a.recall >= tune.target_recall;
+    bool b_ok = b.recall >= tune.target_recall;
+    if (a_ok != b_ok) { return a_ok; }
+    return a_ok ? a.qps > b.qps : a.recall > b.recall;
+  };
+
+  std::vector<TunePoint> measured;
+  auto candidates = points;
+  double min_time = tune.min_time;
+  for (int round = 0; !candidates.empty(); round++) {
+    log_info("Tuning round %d: %zu candidates, min time %g s", round, candidates.size(), min_time);
+    for (const auto& p : candidates) {
+      register_search_case<T>(
+        dataset, p.index, p.search_param_ix, p.name, metric_objective, threads, 0.0)
+        ->MinTime(min_time);
+    }
+    TuneReporter reporter{candidates};
+    ::benchmark::RunSpecifiedBenchmarks(&reporter);
+    ::benchmark::ClearRegisteredBenchmarks();
+
+    // the later (longer) measurements replace the earlier ones
+    for (const auto& p : candidates) {
+      auto it = std::find_if(
+        measured.begin(), measured.end(), [&p](const TunePoint& m) { return m.name == p.name; });
+      if (it == measured.end()) {
+        measured.push_back(p);
+      } else {
+        *it = p;
+      }
+    }
+    if (candidates.size() <= 1) { break; }
+    candidates.erase(std::remove_if(candidates.begin(),
+                                    candidates.end(),
+                                    [](const TunePoint& p) { return p.recall < 0; }),
+                     candidates.end());
+    std::sort(candidates.begin(), candidates.end(), promising);
+    candidates.resize(std::min(candidates.size(),
+                               (candidates.size() + tune.reduction - 1) / tune.reduction));
+    min_time *= tune.reduction;
+  }
+
+  auto frontier = pareto_frontier(measured);
+  if (frontier.empty()) {
+    log_warn("The tuner did not get any recall measurements (is the ground truth available?)");
+    return;
+  }
+  log_info("Pareto frontier of %zu search parameter sets (target recall %g):",
+           frontier.size(),
+           tune.target_recall);
+  for (const auto& p : frontier) {
+    log_info("  recall %.4f, QPS %.1f: %s", p.recall, p.qps, p.name.c_str());
+    register_search_case<T>(
+      dataset, p.index, p.search_param_ix, p.name, metric_objective, threads, 0.0);
+  }
+}
+
+/**
+ * The cold start of a search service: load the index from its file into a new algorithm instance
+ * and search the first query batch, once per iteration. Reports the time to read the file
+ * (`read_time`, which also brings it into the page cache), the time of the `load` proper from the
+ * cached file (deserialization and upload to the device, `load_time`) and the corresponding
+ * `load_bandwidth`, the latency of the first batch (`first_query_time`, which includes the lazy
+ * initialization of the algorithm) and the total `time_to_first_query`.
+ */
+template <typename T>
+void bench_load(::benchmark::State& state,
+                Configuration::Index index,
+                std::size_t search_param_ix,
+                std::shared_ptr<const Dataset<T>> dataset)
+{
+  const auto& sp_json = index.search_params[search_param_ix];
+  dump_parameters(state, sp_json);
+
+  // NB: `k` and `n_queries` are guaranteed to be populated in conf.cpp
+  const std::uint32_t k       = sp_json["k"];
+  const std::size_t n_queries = sp_json["n_queries"];
+  if (dataset->query_set_size() < n_queries) {
+    std::stringstream msg;
+    msg << "Not enough queries in benchmark set. Expected " << n_queries << ", actual "
+        << dataset->query_set_size();
+    return state.SkipWithError(msg.str());
+  }
+  if (!file_exists(index.file)) {
+    return state.SkipWithError("Index file is missing. Run the benchmark in the build mode first.");
+  }
+
+  // Every iteration loads its own instance of the index; release the cached one to save memory.
+  current_algo.reset();
+  std::vector<char> read_buf(std::size_t{1} << 24);
+  std::size_t file_size = 0;
+  double read_time      = 0;
+  double load_time      = 0;
+  double first_time     = 0;
+  cuda_timer gpu_timer;
+  {
+    nvtx_case nvtx{state.name()};
+    for (auto _ : state) {
+      [[maybe_unused]] auto ntx_lap = nvtx.lap();
+      std::unique_ptr<ANN<T>> algo;
+      std::unique_ptr<typename ANN<T>::AnnSearchParam> search_param;
+      try {
+        algo = ann::create_algo<T>(
+          index.algo, dataset->distance(), dataset->dim(), index.build_param, index.dev_list);
+        search_param                   = ann::create_search_param<T>(index.algo, sp_json);
+        search_param->metric_objective = Objective::LATENCY;
+      } catch (const std::exception& e) {
+        return state.SkipWithError("Failed to create an algo: " + std::string(e.what()));
+      }
+      const auto props = parse_algo_property(algo->get_preference(), sp_json);
+      buf<float> distances{props.query_memory_type, k * n_queries};
+      buf<std::size_t> neighbors{props.query_memory_type, k * n_queries};
+      const T* queries = dataset->query_set(props.query_memory_type);
+
+      auto read_start = std::chrono::high_resolution_clock::now();
+      {
+        std::ifstream is(index.file, std::ios::in | std::ios::binary);
+        file_size = 0;
+        while (is.read(read_buf.data(), read_buf.size()) || is.gcount() > 0) {
+          file_size += is.gcount();
+        }
+      }
+      auto load_start = std::chrono::high_resolution_clock::now();
+      try {
+        algo->load(index.file);
+        if (search_param->needs_dataset()) {
+          algo->set_search_dataset(dataset->base_set(props.dataset_memory_type),
+                                   dataset->base_set_size());
+        }
+#ifndef BUILD_CPU_ONLY
+        // the upload may still be in flight on the streams of the algorithm
+        cudaDeviceSynchronize();
+#endif
+        auto load_end = std::chrono::high_resolution_clock::now();
+        algo->set_search_param(*search_param);
+        algo->search(queries, n_queries, k, neighbors.data, distances.data, gpu_timer.stream());
+        sync_stream(gpu_timer.stream());
+        auto first_end = std::chrono::high_resolution_clock::now();
+        read_time += std::chrono::duration<double>(load_start - read_start).count();
+        load_time += std::chrono::duration<double>(load_end - load_start).count();
+        first_time += std::chrono::duration<double>(first_end - load_end).count();
+        state.SetIterationTime(std::chrono::duration<double>(first_end - load_start).count());
+      } catch (const std::exception& e) {
+        return state.SkipWithError(std::string(e.what()));
+      }
+    }
+  }
+  const auto n_iters = static_cast<double>(state.iterations());
+  state.counters.insert({{"index_file_size", file_size},
+                         {"read_time", read_time / n_iters},
+                         {"load_time", load_time / n_iters},
+                         {"load_bandwidth", n_iters * file_size / load_time},
+                         {"first_query_time", first_time / n_iters},
+                         {"time_to_first_query", (load_time + first_time) / n_iters}});
+}
+
+template <typename T>
+void register_ingest(std::shared_ptr<const Dataset<T>> dataset,
+                     std::vector<Configuration::Index> indices,
+                     IngestConfig ingest)
+{
+  auto n_rows    = dataset->base_set_size();
+  auto n_initial = static_cast<std::size_t>(ingest.start_fraction * n_rows);
+  auto n_batches = (n_rows - n_initial + ingest.batch_rows - 1) / ingest.batch_rows;
+  for (auto index : indices) {
+    for (std::size_t i = 0; i < index.search_params.size(); i++) {
+      auto suf = static_cast<std::string>(index.search_params[i]["override_suffix"]);
+      index.search_params[i].erase("override_suffix");
+
+      ::benchmark::RegisterBenchmark(
+        index.name + suf + "/ingest", bench_ingest<T>, index, i, dataset, ingest)
+        ->Unit(benchmark::kMillisecond)
+        // one iteration per ingest batch
+        ->Iterations(std::max<std::size_t>(n_batches, 1))
+        ->MeasureProcessCPUTime()
+        ->UseRealTime();
+    }
+  }
+}
+
+template <typename T>
+void register_load(std::shared_ptr<const Dataset<T>> dataset,
+                   std::vector<Configuration::Index> indices)
+{
+  for (auto index : indices) {
+    for (std::size_t i = 0; i < index.search_params.size(); i++) {
+      auto suf = static_cast<std::string>(index.search_params[i]["override_suffix"]);
+      index.search_params[i].erase("override_suffix");
+
+      ::benchmark::RegisterBenchmark(index.name + suf + "/load", bench_load<T>, index, i, dataset)
+        ->Unit(benchmark::kMillisecond)
+        // the time of an iteration is that of the load and the first query only
+        ->UseManualTime();
     }
   }
 }
@@ -462,11 +1777,16 @@ void dispatch_benchmark(const Configuration& conf,
                         bool force_overwrite,
                         bool build_mode,
                         bool search_mode,
+                        bool load_mode,
                         std::string data_prefix,
                         std::string index_prefix,
                         kv_series override_kv,
                         Objective metric_objective,
-                        const std::vector<int>& threads)
+                        const std::vector<int>& threads,
+                        const std::vector<double>& target_qps,
+                        IngestConfig ingest,
+                        TuneConfig tune,
+                        MultiGpuConfig multi_gpu)
 {
   if (cudart.found()) {
     for (auto [key, value] : cuda_info()) {
@@ -487,6 +1807,14 @@ void dispatch_benchmark(const Configuration& conf,
                                                  gt_file);
   ::benchmark::AddCustomContext("dataset", dataset_conf.name);
   ::benchmark::AddCustomContext("distance", dataset_conf.distance);
+  if (multi_gpu.enabled()) {
+    std::stringstream devices;
+    for (std::size_t i = 0; i < multi_gpu.devices.size(); i++) {
+      devices << (i > 0 ? ":" : "") << multi_gpu.devices[i];
+    }
+    ::benchmark::AddCustomContext("devices", devices.str());
+    ::benchmark::AddCustomContext("sharding", multi_gpu.sharded ? "sharded" : "replicated");
+  }
   std::vector<Configuration::Index> indices = conf.get_indices();
   if (build_mode) {
     if (file_exists(base_file)) {
@@ -506,7 +1834,7 @@ void dispatch_benchmark(const Configuration& conf,
         more_indices.push_back(modified_index);
       }
     }
-    register_build<T>(dataset, more_indices, force_overwrite);
+    register_build<T>(dataset, more_indices, force_overwrite, multi_gpu);
   } else if (search_mode) {
     if (file_exists(query_file)) {
       log_info("Using the query file '%s'", query_file.c_str());
@@ -535,7 +1863,20 @@ void dispatch_benchmark(const Configuration& conf,
       index.search_params = apply_overrides(index.search_params, override_kv);
       index.file          = combine_path(index_prefix, index.file);
     }
-    register_search<T>(dataset, indices, metric_objective, threads);
+    if (load_mode) {
+      register_load<T>(dataset, indices);
+    } else if (multi_gpu.enabled()) {
+      register_search_multi_gpu<T>(dataset, indices, metric_objective, threads, multi_gpu);
+    } else if (tune.enabled) {
+      tune_search<T>(dataset, indices, metric_objective, threads, tune);
+    } else if (!ingest.enabled) {
+      register_search<T>(dataset, indices, metric_objective, threads, target_qps);
+    } else if (file_exists(base_file)) {
+      register_ingest<T>(dataset, indices, ingest);
+    } else {
+      log_warn("Dataset file '%s' does not exist; benchmarking ingest is impossible.",
+               base_file.c_str());
+    }
   }
 }
 
@@ -569,6 +1910,16 @@ inline auto run_main(int argc, char** argv) -> int
   std::string mode            = "latency";
   std::string threads_arg_txt = "";
   std::vector<int> threads    = {1, -1};  // min_thread, max_thread
+  std::string target_qps_txt  = "";
+  std::vector<double> target_qps{};
+  std::string ingest_start_txt = "";
+  std::string ingest_batch_txt = "";
+  IngestConfig ingest{};
+  std::string tune_txt = "";
+  TuneConfig tune{};
+  std::string devices_txt  = "";
+  std::string sharding_txt = "replicated";
+  MultiGpuConfig multi_gpu{};
   std::string log_level_str   = "";
   int raft_log_level          = raft::logger::get(RAFT_NAME).get_level();
   kv_series override_kv{};
@@ -591,11 +1942,19 @@ inline auto run_main(int argc, char** argv) -> int
     if (parse_bool_flag(argv[i], "--force", force_overwrite) ||
         parse_bool_flag(argv[i], "--build", build_mode) ||
         parse_bool_flag(argv[i], "--search", search_mode) ||
+        parse_bool_flag(argv[i], "--phase_times", phase_times_enabled) ||
+        parse_bool_flag(argv[i], "--power", power_enabled) ||
         parse_string_flag(argv[i], "--data_prefix", data_prefix) ||
         parse_string_flag(argv[i], "--index_prefix", index_prefix) ||
         parse_string_flag(argv[i], "--mode", mode) ||
         parse_string_flag(argv[i], "--override_kv", new_override_kv) ||
         parse_string_flag(argv[i], "--threads", threads_arg_txt) ||
+        parse_string_flag(argv[i], "--target_qps", target_qps_txt) ||
+        parse_string_flag(argv[i], "--ingest_start", ingest_start_txt) ||
+        parse_string_flag(argv[i], "--ingest_batch", ingest_batch_txt) ||
+        parse_string_flag(argv[i], "--tune", tune_txt) ||
+        parse_string_flag(argv[i], "--devices", devices_txt) ||
+        parse_string_flag(argv[i], "--sharding", sharding_txt) ||
         parse_string_flag(argv[i], "--raft_log_level", log_level_str)) {
       if (!log_level_str.empty()) {
         raft_log_level = std::stoi(log_level_str);
@@ -611,6 +1970,25 @@ inline auto run_main(int argc, char** argv) -> int
         }
         threads_arg_txt = "";
       }
+      if (!tune_txt.empty()) {
+        tune.enabled       = true;
+        tune.target_recall = std::stod(tune_txt);
+        tune_txt           = "";
+      }
+      if (!ingest_start_txt.empty()) {
+        ingest.start_fraction = std::stod(ingest_start_txt);
+        ingest_start_txt      = "";
+      }
+      if (!ingest_batch_txt.empty()) {
+        ingest.batch_rows = std::stoull(ingest_batch_txt);
+        ingest_batch_txt  = "";
+      }
+      if (!target_qps_txt.empty()) {
+        for (const auto& qps : split(target_qps_txt, ':')) {
+          target_qps.push_back(std::stod(qps));
+        }
+        target_qps_txt = "";
+      }
       if (!new_override_kv.empty()) {
         auto kvv = split(new_override_kv, ':');
         auto key = kvv[0];
@@ -632,7 +2010,71 @@ inline auto run_main(int argc, char** argv) -> int
   raft::logger::get(RAFT_NAME).set_level(raft_log_level);
 
   Objective metric_objective = Objective::LATENCY;
-  if (mode == "throughput") { metric_objective = Objective::THROUGHPUT; }
+  // The open-loop clients run concurrently, like in the throughput mode.
+  if (mode == "throughput" || mode == "open_loop") { metric_objective = Objective::THROUGHPUT; }
+
+  if (mode == "open_loop") {
+    auto min_qps =
+      target_qps.empty() ? 0.0 : *std::min_element(target_qps.begin(), target_qps.end());
+    if (min_qps <= 0) {
+      log_error("The open-loop mode requires positive --target_qps values");
+      printf_usage();
+      return -1;
+    }
+  } else if (!target_qps.empty()) {
+    log_warn("--target_qps is only used in the open-loop mode; ignoring it.");
+    target_qps.clear();
+  }
+
+  const bool load_mode = mode == "load";
+  if (tune.enabled && (mode == "open_loop" || mode == "ingest" || load_mode)) {
+    log_error("--tune is only supported in the latency and throughput modes");
+    printf_usage();
+    return -1;
+  }
+
+  if (!devices_txt.empty()) {
+    if (devices_txt == "all") {
+      for (int d = 0; d < device_count(); d++) {
+        multi_gpu.devices.push_back(d);
+      }
+    } else {
+      for (const auto& d : split(devices_txt, ':')) {
+        multi_gpu.devices.push_back(std::stoi(d));
+      }
+    }
+    auto n_visible = device_count();
+    for (auto d : multi_gpu.devices) {
+      if (d < 0 || d >= n_visible) {
+        log_error("--devices: device %d is not visible (%d visible devices)", d, n_visible);
+        return -1;
+      }
+    }
+    if (multi_gpu.devices.empty()) {
+      log_error("--devices: no visible devices");
+      return -1;
+    }
+    if (sharding_txt != "replicated" && sharding_txt != "sharded") {
+      log_error("--sharding must be either 'replicated' or 'sharded'");
+      printf_usage();
+      return -1;
+    }
+    multi_gpu.sharded = sharding_txt == "sharded";
+    if (tune.enabled || mode == "open_loop" || mode == "ingest" || load_mode) {
+      log_error("--devices is only supported in the latency and throughput modes without --tune");
+      printf_usage();
+      return -1;
+    }
+  }
+
+  if (mode == "ingest") {
+    ingest.enabled = true;
+    if (ingest.start_fraction <= 0 || ingest.start_fraction > 1 || ingest.batch_rows == 0) {
+      log_error("The ingest mode requires --ingest_start in (0, 1] and a positive --ingest_batch");
+      printf_usage();
+      return -1;
+    }
+  }
 
   int max_threads =
     (metric_objective == Objective::THROUGHPUT) ? std::thread::hardware_concurrency() : 1;
@@ -660,6 +2102,10 @@ inline auto run_main(int argc, char** argv) -> int
     log_warn("cudart library is not found, GPU-based indices won't work.");
   }
 
+  // The google benchmark flags are needed already when tuning the search parameters.
+  ::benchmark::Initialize(&argc, argv, printf_usage);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return -1;
+
   Configuration conf(conf_stream);
   std::string dtype = conf.get_dataset_conf().dtype;
 
@@ -668,38 +2114,51 @@ inline auto run_main(int argc, char** argv) -> int
                               force_overwrite,
                               build_mode,
                               search_mode,
+                              load_mode,
                               data_prefix,
                               index_prefix,
                               override_kv,
                               metric_objective,
-                              threads);
+                              threads,
+                              target_qps,
+                              ingest,
+                              tune,
+                              multi_gpu);
   } else if (dtype == "uint8") {
     dispatch_benchmark<std::uint8_t>(conf,
                                      force_overwrite,
                                      build_mode,
                                      search_mode,
+                                     load_mode,
                                      data_prefix,
                                      index_prefix,
                                      override_kv,
                                      metric_objective,
-                                     threads);
+                                     threads,
+                                     target_qps,
+                                     ingest,
+                                     tune,
+                                     multi_gpu);
   } else if (dtype == "int8") {
     dispatch_benchmark<std::int8_t>(conf,
                                     force_overwrite,
                                     build_mode,
                                     search_mode,
+                                    load_mode,
                                     data_prefix,
                                     index_prefix,
                                     override_kv,
                                     metric_objective,
-                                    threads);
+                                    threads,
+                                    target_qps,
+                                    ingest,
+                                    tune,
+                                    multi_gpu);
   } else {
     log_error("datatype '%s' is not supported", dtype.c_str());
     return -1;
   }
 
-  ::benchmark::Initialize(&argc, argv, printf_usage);
-  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return -1;
   ::benchmark::RunSpecifiedBenchmarks();
   ::benchmark::Shutdown();
   // Release a possibly cached ANN object, so that it cannot be alive longer than the handle
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -186,6 +186,12 @@ namespace stub {
   *device = 0;
   return cudaSuccess;
 };
+[[gnu::weak, gnu::noinline]] cudaError_t cudaSetDevice(int device) { return cudaSuccess; };
+[[gnu::weak, gnu::noinline]] cudaError_t cudaGetDeviceCount(int* count)
+{
+  *count = 0;
+  return cudaSuccess;
+};
 [[gnu::weak, gnu::noinline]] cudaError_t cudaDriverGetVersion(int* driver)
 {
   *driver = 0;
@@ -224,6 +230,8 @@ RAFT_DECLARE_CUDART(cudaEventSynchronize);
 RAFT_DECLARE_CUDART(cudaEventElapsedTime);
 RAFT_DECLARE_CUDART(cudaEventDestroy);
 RAFT_DECLARE_CUDART(cudaGetDevice);
+RAFT_DECLARE_CUDART(cudaSetDevice);
+RAFT_DECLARE_CUDART(cudaGetDeviceCount);
 RAFT_DECLARE_CUDART(cudaDriverGetVersion);
 RAFT_DECLARE_CUDART(cudaRuntimeGetVersion);
 RAFT_DECLARE_CUDART(cudaGetDeviceProperties);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -15,6 +15,7 @@
  */
 #pragma once
 
+#include "host_prefetch.hpp"
 #include "util.hpp"
 
 #ifndef BUILD_CPU_ONLY
@@ -27,6 +28,7 @@ typedef uint16_t half;
 #include <sys/mman.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
@@ -108,7 +110,7 @@ class BinFile {
                                std::string(strerror(errno)));
     }
     return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(mapped_ptr_) + 2 * sizeof(uint32_t) +
-                                subset_first_row_ * ndims_ * sizeof(T));
+                                static_cast<size_t>(subset_first_row_) * ndims_ * sizeof(T));
   }
 
   void unmap() const
@@ -337,9 +339,26 @@ const T* Dataset<T>::base_set_on_gpu() const
 {
 #ifndef BUILD_CPU_ONLY
   if (!d_base_set_) {
-    base_set();
-    cudaMalloc((void**)&d_base_set_, base_set_size() * dim() * sizeof(T));
-    cudaMemcpy(d_base_set_, base_set_, base_set_size() * dim() * sizeof(T), cudaMemcpyHostToDevice);
+    size_t total_bytes = base_set_size() * dim() * sizeof(T);
+    cudaMalloc((void**)&d_base_set_, total_bytes);
+    if (base_set_) {
+      cudaMemcpy(d_base_set_, base_set_, total_bytes, cudaMemcpyHostToDevice);
+    } else {
+      // Copy from the memory-mapped file chunk by chunk, reading ahead the next chunk, rather than
+      // loading the whole base set to the host memory first (it may not fit there).
+      auto src = reinterpret_cast<const uint8_t*>(mapped_base_set());
+      auto dst = reinterpret_cast<uint8_t*>(d_base_set_);
+      prefetch_host_pages(src, std::min(kHostChunkBytes, total_bytes));
+      for (size_t offset = 0; offset < total_bytes; offset += kHostChunkBytes) {
+        auto chunk_bytes = std::min(kHostChunkBytes, total_bytes - offset);
+        auto next_offset = offset + chunk_bytes;
+        if (next_offset < total_bytes) {
+          prefetch_host_pages(src + next_offset,
+                              std::min(kHostChunkBytes, total_bytes - next_offset));
+        }
+        cudaMemcpy(dst + offset, src + offset, chunk_bytes, cudaMemcpyHostToDevice);
+      }
+    }
   }
 #endif
   return d_base_set_;
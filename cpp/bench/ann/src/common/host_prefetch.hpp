@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace raft::bench::ann {
+
+/**
+ * The size of the chunks in which the large host (memory-mapped) datasets are processed: big
+ * enough to amortize the per-chunk overheads, small enough to keep the read-ahead in memory.
+ */
+constexpr std::size_t kHostChunkBytes = std::size_t{1} << 30;
+
+/**
+ * Ask the OS to read ahead the pages of a host buffer, typically the next chunk of a
+ * memory-mapped dataset, so that they are resident by the time they are accessed.
+ *
+ * The read-ahead is asynchronous; this is a cheap no-op for the pages that are already resident.
+ */
+inline void prefetch_host_pages(const void* ptr, std::size_t bytes)
+{
+  if (ptr == nullptr || bytes == 0) { return; }
+  static const auto page_size = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto begin                  = reinterpret_cast<std::uintptr_t>(ptr) / page_size * page_size;
+  auto end                    = reinterpret_cast<std::uintptr_t>(ptr) + bytes;
+  // Only a hint: ignore the errors (e.g. for the memory not backed by a file)
+  madvise(reinterpret_cast<void*>(begin), end - begin, MADV_WILLNEED);
+}
+
+}  // namespace raft::bench::ann
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "cuda_stub.hpp"
+
+#include <dlfcn.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <tuple>
+
+namespace raft::bench::ann {
+
+/**
+ * The few NVML functions needed to measure the power draw of a GPU.
+ *
+ * NVML is a part of the driver rather than of the CUDA toolkit, so it is loaded at runtime: the
+ * benchmarks neither link against it nor need its headers, and the power is not reported where it
+ * is missing.
+ */
+struct nvml_lib {
+  using device_t = void*;  // nvmlDevice_t
+  using return_t = int;    // nvmlReturn_t, NVML_SUCCESS = 0
+
+  return_t (*init)()                                       = nullptr;  // nvmlInit_v2
+  return_t (*shutdown)()                                   = nullptr;  // nvmlShutdown
+  return_t (*device_by_pci_bus_id)(const char*, device_t*) = nullptr;
+  return_t (*power_usage)(device_t, unsigned int*)         = nullptr;  // milliwatts
+  return_t (*total_energy)(device_t, unsigned long long*)  = nullptr;  // millijoules
+
+  nvml_lib()
+  {
+    handle_ = dlopen("libnvidia-ml.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (handle_ == nullptr) { return; }
+    init                 = sym<decltype(init)>("nvmlInit_v2");
+    shutdown             = sym<decltype(shutdown)>("nvmlShutdown");
+    device_by_pci_bus_id = sym<decltype(device_by_pci_bus_id)>("nvmlDeviceGetHandleByPciBusId_v2");
+    power_usage          = sym<decltype(power_usage)>("nvmlDeviceGetPowerUsage");
+    // optional: not all the devices have the energy counter (Volta and newer)
+    total_energy = sym<decltype(total_energy)>("nvmlDeviceGetTotalEnergyConsumption");
+    initialized_ = init != nullptr && shutdown != nullptr && device_by_pci_bus_id != nullptr &&
+                   power_usage != nullptr && init() == 0;
+  }
+  ~nvml_lib() noexcept
+  {
+    if (initialized_) { shutdown(); }
+    if (handle_ != nullptr) { dlclose(handle_); }
+  }
+  nvml_lib(const nvml_lib&)                    = delete;
+  auto operator=(const nvml_lib&) -> nvml_lib& = delete;
+
+  /** Whether NVML is found and initialized. */
+  [[nodiscard]] inline auto found() const -> bool { return initialized_; }
+
+ private:
+  void* handle_{nullptr};
+  bool initialized_{false};
+
+  template <typename Symbol>
+  auto sym(const char* name) -> Symbol
+  {
+    return reinterpret_cast<Symbol>(dlsym(handle_, name));
+  }
+};
+
+inline auto nvml() -> nvml_lib&
+{
+  static nvml_lib lib{};
+  return lib;
+}
+
+/**
+ * The energy drawn by the current GPU from the construction of the meter until `stop()`.
+ *
+ * It is the difference of the total energy counter of the device if it has one; otherwise, a
+ * background thread samples the power every `kSamplePeriod` and integrates it. The power is that of
+ * the whole device, including the work of the other processes.
+ */
+class power_meter {
+ public:
+  static constexpr auto kSamplePeriod = std::chrono::milliseconds(10);
+
+  /** Start measuring, unless disabled or the power of the device cannot be measured. */
+  explicit power_meter(bool enabled = true)
+  {
+#ifndef BUILD_CPU_ONLY
+    if (!enabled || !cudart.found() || !nvml().found()) { return; }
+    int dev_id = 0;
+    cudaDeviceProp prop{};
+    if (cudaGetDevice(&dev_id) != cudaSuccess ||
+        cudaGetDeviceProperties(&prop, dev_id) != cudaSuccess) {
+      return;
+    }
+    char bus_id[32];  // NOLINT
+    std::snprintf(bus_id,
+                  sizeof(bus_id),
+                  "%08x:%02x:%02x.0",
+                  prop.pciDomainID,
+                  prop.pciBusID,
+                  prop.pciDeviceID);
+    if (nvml().device_by_pci_bus_id(bus_id, &device_) != 0) { return; }
+    unsigned int power_mw = 0;
+    if (nvml().power_usage(device_, &power_mw) != 0) { return; }
+    found_ = true;
+    start_ = std::chrono::high_resolution_clock::now();
+    if (nvml().total_energy != nullptr && nvml().total_energy(device_, &start_energy_mj_) == 0) {
+      return;
+    }
+    sampler_ = std::thread([this, power_mw]() {
+      auto last_time  = start_;
+      double last_pow = power_mw * 1e-3;
+      while (!stopping_.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(kSamplePeriod);
+        unsigned int mw = 0;
+        if (nvml().power_usage(device_, &mw) != 0) { continue; }
+        auto now   = std::chrono::high_resolution_clock::now();
+        double pow = mw * 1e-3;
+        double dt  = std::chrono::duration<double>(now - last_time).count();
+        sampled_energy_ += 0.5 * (last_pow + pow) * dt;
+        last_time = now;
+        last_pow  = pow;
+      }
+    });
+#endif
+  }
+  ~power_meter() noexcept { stop(); }
+  power_meter(const power_meter&)                    = delete;
+  auto operator=(const power_meter&) -> power_meter& = delete;
+
+  /** Whether the power of the device is measured. */
+  [[nodiscard]] inline auto found() const -> bool { return found_; }
+
+  /** Stop measuring (once); return the energy in joules and the duration in seconds. */
+  auto stop() -> std::tuple<double, double>
+  {
+    if (!found_ || stopped_) { return {energy_, duration_}; }
+    stopped_  = true;
+    auto end  = std::chrono::high_resolution_clock::now();
+    duration_ = std::chrono::duration<double>(end - start_).count();
+    if (sampler_.joinable()) {
+      stopping_.store(true, std::memory_order_relaxed);
+      sampler_.join();
+      energy_ = sampled_energy_;
+    } else {
+      unsigned long long energy_mj = 0;
+      nvml().total_energy(device_, &energy_mj);
+      energy_ = (energy_mj - start_energy_mj_) * 1e-3;
+    }
+    return {energy_, duration_};
+  }
+
+ private:
+  nvml_lib::device_t device_{nullptr};
+  bool found_{false};
+  bool stopped_{false};
+  std::chrono::high_resolution_clock::time_point start_{};
+  unsigned long long start_energy_mj_{0};
+  std::thread sampler_{};
+  std::atomic<bool> stopping_{false};
+  double sampled_energy_{0};
+  double energy_{0};
+  double duration_{0};
+};
+
+}  // namespace raft::bench::ann
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -15,30 +15,175 @@
  */
 #pragma once
 
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
 #include <atomic>
+#include <cstdio>
 #include <future>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <omp.h>
 #include <stdexcept>
+#include <string>
 #include <thread>
+#include <tuple>
 #include <utility>
+#include <vector>
+
+/**
+ * The placement of the threads of a FixedThreadPool on the CPU cores.
+ *
+ * Unpinned threads migrate between the cores (and the NUMA nodes) at the discretion of the OS,
+ * which makes the CPU baselines vary from run to run; pinning them makes the runs reproducible.
+ */
+struct ThreadAffinity {
+  enum class Mode {
+    /** Do not pin the threads (the OS schedules them). */
+    kNone,
+    /** Fill the cores of a NUMA node before moving to the next one. */
+    kCompact,
+    /** Distribute the threads round-robin across the NUMA nodes. */
+    kScatter,
+  };
+  Mode mode = Mode::kNone;
+  /** Restrict the threads to the cores of this NUMA node (-1: all nodes). */
+  int numa_node = -1;
+  /** Use the hyperthread siblings (after all the physical cores are taken). */
+  bool hyperthreads = true;
+
+  auto operator==(const ThreadAffinity& other) const -> bool
+  {
+    return mode == other.mode && numa_node == other.numa_node &&
+           hyperthreads == other.hyperthreads;
+  }
+  auto operator!=(const ThreadAffinity& other) const -> bool { return !(*this == other); }
+
+  static auto parse_mode(const std::string& mode) -> Mode
+  {
+    if (mode == "none") { return Mode::kNone; }
+    if (mode == "compact") { return Mode::kCompact; }
+    if (mode == "scatter") { return Mode::kScatter; }
+    throw std::runtime_error("invalid cpu affinity: '" + mode +
+                             "', should be one of 'none', 'compact', 'scatter'");
+  }
+
+  /**
+   * The CPUs (of the ones available to the process) to pin the threads to, in the order of the
+   * threads. Without pinning, this is just the available CPUs (respecting `numa_node` and
+   * `hyperthreads`), which can be used to size the pool to the full core count.
+   */
+  auto cpus() const -> std::vector<int>
+  {
+    struct cpu_info {
+      int node, package, core, cpu;
+    };
+    cpu_set_t available;
+    CPU_ZERO(&available);
+    if (sched_getaffinity(0, sizeof(available), &available) != 0) { return {}; }
+    std::vector<cpu_info> infos;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (!CPU_ISSET(cpu, &available)) { continue; }
+      auto topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+      cpu_info info{node_of(topology),
+                    read_int(topology + "/topology/physical_package_id"),
+                    read_int(topology + "/topology/core_id"),
+                    cpu};
+      if (info.core < 0) { info.core = cpu; }
+      if (numa_node >= 0 && info.node != numa_node) { continue; }
+      infos.push_back(info);
+    }
+    std::sort(infos.begin(), infos.end(), [](const cpu_info& a, const cpu_info& b) {
+      return std::tie(a.node, a.package, a.core, a.cpu) <
+             std::tie(b.node, b.package, b.core, b.cpu);
+    });
+
+    // The physical cores go first: the hyperthread rank is 0 for the first CPU of every core, 1
+    // for its first sibling etc. Within a rank, compact keeps the (node, package, core) order,
+    // scatter interleaves the nodes.
+    struct ranked_cpu {
+      int rank, position, node, cpu;
+    };
+    std::map<std::tuple<int, int, int>, int> siblings;
+    std::map<std::pair<int, int>, int> node_positions;
+    std::vector<ranked_cpu> ranked;
+    for (auto& info : infos) {
+      int rank = siblings[{info.node, info.package, info.core}]++;
+      if (rank > 0 && !hyperthreads) { continue; }
+      int position = mode == Mode::kScatter ? node_positions[{info.node, rank}]++ : 0;
+      ranked.push_back({rank, position, info.node, info.cpu});
+    }
+    std::stable_sort(ranked.begin(), ranked.end(), [](const ranked_cpu& a, const ranked_cpu& b) {
+      return std::tie(a.rank, a.position) < std::tie(b.rank, b.position);
+    });
+    std::vector<int> out;
+    out.reserve(ranked.size());
+    for (auto& r : ranked) {
+      out.push_back(r.cpu);
+    }
+    return out;
+  }
+
+ private:
+  static auto read_int(const std::string& path) -> int
+  {
+    int value = -1;
+    if (FILE* f = fopen(path.c_str(), "r"); f != nullptr) {
+      if (fscanf(f, "%d", &value) != 1) { value = -1; }
+      fclose(f);
+    }
+    return value;
+  }
+
+  /** The NUMA node of a CPU: the `nodeN` entry of its sysfs directory (node 0 if none). */
+  static auto node_of(const std::string& cpu_dir) -> int
+  {
+    int node = 0;
+    if (DIR* dir = opendir(cpu_dir.c_str()); dir != nullptr) {
+      while (auto* entry = readdir(dir)) {
+        if (sscanf(entry->d_name, "node%d", &node) == 1) { break; }
+      }
+      closedir(dir);
+    }
+    return node;
+  }
+};
 
 class FixedThreadPool {
  public:
-  FixedThreadPool(int num_threads)
+  /**
+   * @param num_threads the number of the threads of the pool (or 0 for one thread per CPU allowed
+   *        by the affinity)
+   * @param affinity the placement of the threads on the CPU cores
+   */
+  explicit FixedThreadPool(int num_threads, const ThreadAffinity& affinity = {})
+    : affinity_(affinity)
   {
+    auto cpus = affinity.cpus();
+    if (num_threads == 0) { num_threads = std::max<int>(1, cpus.size()); }
     if (num_threads < 1) {
       throw std::runtime_error("num_threads must >= 1");
     } else if (num_threads == 1) {
       return;
     }
+    if (affinity.mode == ThreadAffinity::Mode::kNone || cpus.empty()) { cpus.clear(); }
 
     tasks_ = new Task_[num_threads];
 
     threads_.reserve(num_threads);
     for (int i = 0; i < num_threads; ++i) {
-      threads_.emplace_back([&, i] {
+      int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+      threads_.emplace_back([&, i, cpu] {
+        if (cpu >= 0) {
+          // best effort: an unpinned thread only loses the reproducibility
+          cpu_set_t set;
+          CPU_ZERO(&set);
+          CPU_SET(cpu, &set);
+          pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
         auto& task = tasks_[i];
         while (true) {
           std::unique_lock<std::mutex> lock(task.mtx);
@@ -69,8 +214,18 @@ class FixedThreadPool {
     delete[] tasks_;
   }
 
+  /** The number of the threads running the tasks (zero: the tasks run in the calling thread). */
+  auto size() const -> int { return threads_.size(); }
+  auto affinity() const -> const ThreadAffinity& { return affinity_; }
+
+  /**
+   * Run `f(i)` for every `i` in `[0, len)` on the threads of the pool and wait for the completion.
+   *
+   * Every thread starts with an equal contiguous share of the items; the rest is distributed
+   * dynamically in the chunks of `grain` contiguous items.
+   */
   template <typename Func, typename IdxT>
-  void submit(Func f, IdxT len)
+  void submit(Func f, IdxT len, IdxT grain = 1)
   {
     // Run functions in main thread if thread pool has no threads
     if (threads_.empty()) {
@@ -92,9 +247,11 @@ class FixedThreadPool {
       }
 
       while (true) {
-        IdxT i = cnt.fetch_add(1, std::memory_order_relaxed);
+        IdxT i = cnt.fetch_add(grain, std::memory_order_relaxed);
         if (i >= len) { break; }
-        f(i);
+        for (IdxT j = i; j < std::min<IdxT>(i + grain, len); ++j) {
+          f(j);
+        }
       }
     };
 
@@ -127,6 +284,7 @@ class FixedThreadPool {
     std::packaged_task<void()> task;
   };
 
+  ThreadAffinity affinity_;
   Task_* tasks_;
   std::vector<std::thread> threads_;
   std::atomic<bool> finished_{false};
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,9 +22,14 @@
 #include <nvtx3/nvToolsExt.h>
 #endif
 
+#ifndef BUILD_CPU_ONLY
+#include <raft/core/device_topology.hpp>
+#endif
+
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <array>
 #include <chrono>
 #include <cstdio>
 #include <cstring>
@@ -155,6 +160,39 @@ struct cuda_timer {
   }
 };
 
+/** RAII: make a device current in this thread for the lifetime of the object. */
+struct device_scope {
+ private:
+  int prev_{0};
+
+ public:
+  explicit device_scope(int device)
+  {
+#ifndef BUILD_CPU_ONLY
+    cudaGetDevice(&prev_);
+    cudaSetDevice(device);
+#endif
+  }
+  ~device_scope() noexcept
+  {
+#ifndef BUILD_CPU_ONLY
+    cudaSetDevice(prev_);
+#endif
+  }
+  device_scope(const device_scope&)            = delete;
+  device_scope& operator=(const device_scope&) = delete;
+};
+
+/** The number of the visible GPUs (zero in the CPU-only packages or without CUDA). */
+inline auto device_count() -> int
+{
+  int count = 0;
+#ifndef BUILD_CPU_ONLY
+  if (cudaGetDeviceCount(&count) != cudaSuccess) { count = 0; }
+#endif
+  return count;
+}
+
 inline auto cuda_info()
 {
   std::vector<std::tuple<std::string, std::string>> props;
@@ -177,6 +215,17 @@ inline auto cuda_info()
                      std::to_string(driver / 1000) + "." + std::to_string((driver % 100) / 10));
   props.emplace_back("gpu_runtime_version",
                      std::to_string(runtime / 1000) + "." + std::to_string((runtime % 100) / 10));
+
+  std::array<char, 16> pci_bus_id{0};
+  std::snprintf(pci_bus_id.data(),
+                pci_bus_id.size(),
+                "%04x:%02x:%02x.0",
+                device_prop.pciDomainID,
+                device_prop.pciBusID,
+                device_prop.pciDeviceID);
+  auto topology = raft::get_pci_topology(pci_bus_id.data());
+  props.emplace_back("gpu_pci_bus_id", topology.pci_bus_id);
+  props.emplace_back("gpu_numa_node", std::to_string(topology.numa_node));
 #endif
   return props;
 }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -37,6 +37,11 @@ void parse_build_param(const nlohmann::json& conf,
   param.ef_construction = conf.at("efConstruction");
   param.M               = conf.at("M");
   if (conf.contains("numThreads")) { param.num_threads = conf.at("numThreads"); }
+  if (conf.contains("cpu_affinity")) {
+    param.affinity.mode = ThreadAffinity::parse_mode(conf.at("cpu_affinity"));
+  }
+  if (conf.contains("numa_node")) { param.affinity.numa_node = conf.at("numa_node"); }
+  if (conf.contains("hyperthreads")) { param.affinity.hyperthreads = conf.at("hyperthreads"); }
 }
 
 template <typename T>
@@ -45,6 +50,12 @@ void parse_search_param(const nlohmann::json& conf,
 {
   param.ef = conf.at("ef");
   if (conf.contains("numThreads")) { param.num_threads = conf.at("numThreads"); }
+  if (conf.contains("cpu_affinity")) {
+    param.affinity.mode = ThreadAffinity::parse_mode(conf.at("cpu_affinity"));
+  }
+  if (conf.contains("numa_node")) { param.affinity.numa_node = conf.at("numa_node"); }
+  if (conf.contains("hyperthreads")) { param.affinity.hyperthreads = conf.at("hyperthreads"); }
+  if (conf.contains("batch_parallel")) { param.batch_parallel = conf.at("batch_parallel"); }
 }
 
 template <typename T, template <typename> class Algo>
@@ -65,12 +65,21 @@ class HnswLib : public ANN<T> {
     int M;
     int ef_construction;
     int num_threads = omp_get_num_procs();
+    ThreadAffinity affinity;
   };
 
   using typename ANN<T>::AnnSearchParam;
   struct SearchParam : public AnnSearchParam {
     int ef;
+    /** The number of the search threads (0: one per CPU allowed by the affinity). */
     int num_threads = 1;
+    ThreadAffinity affinity;
+    /**
+     * Split every batch across the thread pool also in the throughput mode (by default, the pool is
+     * used only in the latency mode, and the throughput comes from the concurrent benchmark
+     * threads, which are not pinned).
+     */
+    bool batch_parallel = false;
   };
 
   HnswLib(Metric metric, int dim, const BuildParam& param);
@@ -110,8 +119,17 @@ class HnswLib : public ANN<T> {
   int ef_construction_;
   int m_;
   int num_threads_;
+  ThreadAffinity build_affinity_;
+  ThreadAffinity search_affinity_;
+  bool batch_parallel_ = false;
   std::shared_ptr<FixedThreadPool> thread_pool_;
   Objective metric_objective_;
+
+  auto use_pool() const -> bool
+  {
+    return (metric_objective_ == Objective::LATENCY || batch_parallel_) && num_threads_ != 1 &&
+           thread_pool_ && thread_pool_->size() > 1;
+  }
 };
 
 template <typename T>
@@ -128,6 +146,7 @@ HnswLib<T>::HnswLib(Metric metric, int dim, const BuildParam& param) : ANN<T>(me
   ef_construction_ = param.ef_construction;
   m_               = param.M;
   num_threads_     = param.num_threads;
+  build_affinity_  = param.affinity;
 }
 
 template <typename T>
@@ -146,8 +165,8 @@ void HnswLib<T>::build(const T* dataset, size_t nrow, cudaStream_t)
   appr_alg_ = std::make_shared<hnswlib::HierarchicalNSW<typename hnsw_dist_t<T>::type>>(
     space_.get(), nrow, m_, ef_construction_);
 
-  thread_pool_                  = std::make_shared<FixedThreadPool>(num_threads_);
-  const size_t items_per_thread = nrow / (num_threads_ + 1);
+  thread_pool_                  = std::make_shared<FixedThreadPool>(num_threads_, build_affinity_);
+  const size_t items_per_thread = nrow / (std::max(thread_pool_->size(), 1) + 1);
 
   thread_pool_->submit(
     [&](size_t i) {
@@ -171,10 +190,17 @@ void HnswLib<T>::set_search_param(const AnnSearchParam& param_)
   appr_alg_->ef_    = param.ef;
   metric_objective_ = param.metric_objective;
   num_threads_      = param.num_threads;
-
-  // Create a pool if multiple query threads have been set and the pool hasn't been created already
-  bool create_pool = (metric_objective_ == Objective::LATENCY && num_threads_ > 1 && !thread_pool_);
-  if (create_pool) { thread_pool_ = std::make_shared<FixedThreadPool>(num_threads_); }
+  search_affinity_  = param.affinity;
+  batch_parallel_   = param.batch_parallel;
+
+  // Create a pool if multiple query threads have been set, unless a matching one exists already
+  bool needs_pool =
+    (metric_objective_ == Objective::LATENCY || batch_parallel_) && num_threads_ != 1;
+  bool create_pool = needs_pool && (!thread_pool_ || thread_pool_->affinity() != search_affinity_ ||
+                                    (num_threads_ > 0 && thread_pool_->size() != num_threads_));
+  if (create_pool) {
+    thread_pool_ = std::make_shared<FixedThreadPool>(num_threads_, search_affinity_);
+  }
 }
 
 template <typename T>
@@ -185,8 +211,10 @@ void HnswLib<T>::search(
     // hnsw can only handle a single vector at a time.
     get_search_knn_results_(query + i * dim_, k, indices + i * k, distances + i * k);
   };
-  if (metric_objective_ == Objective::LATENCY && num_threads_ > 1) {
-    thread_pool_->submit(f, batch_size);
+  if (use_pool()) {
+    // contiguous chunks of queries keep the load balanced with little contention on the counter
+    int grain = batch_parallel_ ? std::max(1, batch_size / (thread_pool_->size() * 8)) : 1;
+    thread_pool_->submit(f, batch_size, grain);
   } else {
     for (int i = 0; i < batch_size; i++) {
       f(i);
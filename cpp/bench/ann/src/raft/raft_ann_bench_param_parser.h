@@ -46,6 +46,9 @@ extern template class raft::bench::ann::RaftCagra<float, uint32_t>;
 extern template class raft::bench::ann::RaftCagra<uint8_t, uint32_t>;
 extern template class raft::bench::ann::RaftCagra<int8_t, uint32_t>;
 #endif
+#if defined(RAFT_ANN_BENCH_USE_RAFT_IVF_PQ) || defined(RAFT_ANN_BENCH_USE_RAFT_CAGRA)
+#include "raft_refine_wrapper.h"
+#endif
 
 #ifdef RAFT_ANN_BENCH_USE_RAFT_IVF_FLAT
 template <typename T, typename IdxT>
@@ -76,6 +79,8 @@ void parse_build_param(const nlohmann::json& conf,
   if (conf.contains("ratio")) { param.kmeans_trainset_fraction = 1.0 / (double)conf.at("ratio"); }
   if (conf.contains("pq_bits")) { param.pq_bits = conf.at("pq_bits"); }
   if (conf.contains("pq_dim")) { param.pq_dim = conf.at("pq_dim"); }
+  if (conf.contains("opq_niter")) { param.opq_n_iters = conf.at("opq_niter"); }
+  if (conf.contains("mapped_file")) { param.mapped_file = conf.at("mapped_file"); }
   if (conf.contains("codebook_kind")) {
     std::string kind = conf.at("codebook_kind");
     if (kind == "cluster") {
@@ -183,7 +188,7 @@ void parse_build_param(const nlohmann::json& conf,
   }
   nlohmann::json ivf_pq_build_conf = collect_conf_with_prefix(conf, "ivf_pq_build_");
   if (!ivf_pq_build_conf.empty()) {
-    raft::neighbors::ivf_pq::index_params bparam;
+    typename raft::bench::ann::RaftIvfPQ<T, IdxT>::BuildParam bparam;
     parse_build_param<T, IdxT>(ivf_pq_build_conf, bparam);
     param.ivf_pq_build_params = bparam;
   }
@@ -250,3 +255,24 @@ void parse_search_param(const nlohmann::json& conf,
   }
 }
 #endif
+
+#if defined(RAFT_ANN_BENCH_USE_RAFT_IVF_PQ) || defined(RAFT_ANN_BENCH_USE_RAFT_CAGRA)
+template <typename T, typename IdxT, typename Upstream>
+void parse_refine_search_param(
+  const nlohmann::json& conf,
+  typename raft::bench::ann::RaftRefine<T, Upstream>::SearchParam& param)
+{
+  // the refinement is done by the pipeline, not by the candidate generator
+  auto upstream_conf = conf;
+  upstream_conf.erase("refine_ratio");
+  upstream_conf.erase("refine_memory_type");
+  parse_search_param<T, IdxT>(upstream_conf, param.upstream);
+  if (conf.contains("refine_ratio")) {
+    param.refine_ratio = conf.at("refine_ratio");
+    if (param.refine_ratio < 1.0f) { throw std::runtime_error("refine_ratio should be >= 1.0"); }
+  }
+  if (conf.contains("refine_memory_type")) {
+    param.refine_memory_type = raft::bench::ann::parse_memory_type(conf.at("refine_memory_type"));
+  }
+}
+#endif
@@ -18,6 +18,9 @@
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/device_resources.hpp>
 #include <raft/core/logger.hpp>
+#include <raft/core/pinned_pool_resource.hpp>
+#include <raft/core/resource/phase_timer.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/util/cudart_utils.hpp>
 
@@ -27,6 +30,7 @@
 #include <cassert>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <stdexcept>
@@ -63,8 +67,11 @@ class configured_raft_resources {
    * This constructor has the shared state passed unmodified but creates the local state anew.
    * It's used by the copy constructor.
    */
-  explicit configured_raft_resources(const std::shared_ptr<device_mr_t>& mr)
+  explicit configured_raft_resources(
+    const std::shared_ptr<device_mr_t>& mr,
+    const std::shared_ptr<rmm::mr::host_memory_resource>& pinned_mr)
     : mr_{mr},
+      pinned_mr_{pinned_mr},
       sync_{[]() {
               auto* ev = new cudaEvent_t;
               RAFT_CUDA_TRY(cudaEventCreate(ev, cudaEventDisableTiming));
@@ -76,6 +83,7 @@ class configured_raft_resources {
             }},
       res_{cudaStreamPerThread}
   {
+    raft::resource::set_pinned_memory_resource(res_, pinned_mr_);
   }
 
   /** Default constructor creates all resources anew. */
@@ -99,7 +107,8 @@ class configured_raft_resources {
              rmm::mr::set_current_device_resource(mr->get_upstream());
            }
            delete mr;
-         }}}
+         }},
+        std::make_shared<raft::mr::pinned_pool_resource>(1024 * 1024 * 1024ull)}
   {
   }
 
@@ -107,12 +116,14 @@ class configured_raft_resources {
   configured_raft_resources& operator=(configured_raft_resources&&) = default;
   ~configured_raft_resources()                                      = default;
   configured_raft_resources(const configured_raft_resources& res)
-    : configured_raft_resources{res.mr_}
+    : configured_raft_resources{res.mr_, res.pinned_mr_}
   {
   }
   configured_raft_resources& operator=(const configured_raft_resources& other)
   {
-    this->mr_ = other.mr_;
+    this->mr_        = other.mr_;
+    this->pinned_mr_ = other.pinned_mr_;
+    raft::resource::set_pinned_memory_resource(res_, pinned_mr_);
     return *this;
   }
 
@@ -129,6 +140,16 @@ class configured_raft_resources {
   /** Get the internal sync event (which otherwise used only in `stream_wait`). */
   cudaEvent_t get_sync_event() const { return *sync_; }
 
+  /** Start timing the phases of the RAFT algorithms run with this resource (not its copies). */
+  void enable_phase_times() const { raft::resource::get_phase_timer(res_); }
+
+  /** The GPU time of the phases since the previous call (nothing unless the timing is enabled). */
+  auto collect_phase_times() const -> std::map<std::string, double>
+  {
+    if (!res_.has_resource_factory(raft::resource::resource_type::PHASE_TIMER)) { return {}; }
+    return raft::resource::get_phase_timer(res_).collect();
+  }
+
  private:
   /**
    * This pool is set as the RMM current device, hence its shared among all users of RMM resources.
@@ -136,6 +157,8 @@ class configured_raft_resources {
    * used by anyone directly.
    */
   std::shared_ptr<device_mr_t> mr_;
+  /** The pinned staging buffers of all the copies are cached in this pool. */
+  std::shared_ptr<rmm::mr::host_memory_resource> pinned_mr_;
   /** Each benchmark wrapper must have its own copy of the synchronization event. */
   std::unique_ptr<cudaEvent_t, std::function<void(cudaEvent_t*)>> sync_;
   /**
@@ -70,6 +70,12 @@ std::unique_ptr<raft::bench::ann::ANN<T>> create_algo(const std::string& algo,
     parse_build_param<T, int64_t>(conf, param);
     ann = std::make_unique<raft::bench::ann::RaftIvfPQ<T, int64_t>>(metric, dim, param);
   }
+  if (algo == "raft_ivf_pq_refine") {
+    using algo_t = raft::bench::ann::RaftRefine<T, raft::bench::ann::RaftIvfPQ<T, int64_t>>;
+    typename algo_t::BuildParam param;
+    parse_build_param<T, int64_t>(conf, param);
+    ann = std::make_unique<algo_t>(metric, dim, param);
+  }
 #endif
 #ifdef RAFT_ANN_BENCH_USE_RAFT_CAGRA
   if (algo == "raft_cagra") {
@@ -77,6 +83,12 @@ std::unique_ptr<raft::bench::ann::ANN<T>> create_algo(const std::string& algo,
     parse_build_param<T, uint32_t>(conf, param);
     ann = std::make_unique<raft::bench::ann::RaftCagra<T, uint32_t>>(metric, dim, param);
   }
+  if (algo == "raft_cagra_refine") {
+    using algo_t = raft::bench::ann::RaftRefine<T, raft::bench::ann::RaftCagra<T, uint32_t>>;
+    typename algo_t::BuildParam param;
+    parse_build_param<T, uint32_t>(conf, param);
+    ann = std::make_unique<algo_t>(metric, dim, param);
+  }
 #endif
 
   if (!ann) { throw std::runtime_error("invalid algo: '" + algo + "'"); }
@@ -108,6 +120,13 @@ std::unique_ptr<typename raft::bench::ann::ANN<T>::AnnSearchParam> create_search
     parse_search_param<T, int64_t>(conf, *param);
     return param;
   }
+  if (algo == "raft_ivf_pq_refine") {
+    using upstream_t = raft::bench::ann::RaftIvfPQ<T, int64_t>;
+    auto param =
+      std::make_unique<typename raft::bench::ann::RaftRefine<T, upstream_t>::SearchParam>();
+    parse_refine_search_param<T, int64_t, upstream_t>(conf, *param);
+    return param;
+  }
 #endif
 #ifdef RAFT_ANN_BENCH_USE_RAFT_CAGRA
   if (algo == "raft_cagra") {
@@ -115,6 +134,13 @@ std::unique_ptr<typename raft::bench::ann::ANN<T>::AnnSearchParam> create_search
     parse_search_param<T, uint32_t>(conf, *param);
     return param;
   }
+  if (algo == "raft_cagra_refine") {
+    using upstream_t = raft::bench::ann::RaftCagra<T, uint32_t>;
+    auto param =
+      std::make_unique<typename raft::bench::ann::RaftRefine<T, upstream_t>::SearchParam>();
+    parse_refine_search_param<T, uint32_t, upstream_t>(conf, *param);
+    return param;
+  }
 #endif
 
   // else
@@ -32,6 +32,12 @@ void parse_search_param(const nlohmann::json& conf,
 {
   param.ef = conf.at("ef");
   if (conf.contains("numThreads")) { param.num_threads = conf.at("numThreads"); }
+  if (conf.contains("cpu_affinity")) {
+    param.affinity.mode = ThreadAffinity::parse_mode(conf.at("cpu_affinity"));
+  }
+  if (conf.contains("numa_node")) { param.affinity.numa_node = conf.at("numa_node"); }
+  if (conf.contains("hyperthreads")) { param.affinity.hyperthreads = conf.at("hyperthreads"); }
+  if (conf.contains("batch_parallel")) { param.batch_parallel = conf.at("batch_parallel"); }
 }
 
 template <typename T>
@@ -50,7 +56,17 @@ std::unique_ptr<raft::bench::ann::ANN<T>> create_algo(const std::string& algo,
   if constexpr (std::is_same_v<T, float> or std::is_same_v<T, std::uint8_t>) {
     if (algo == "raft_cagra_hnswlib") {
       typename raft::bench::ann::RaftCagraHnswlib<T, uint32_t>::BuildParam param;
-      parse_build_param<T, uint32_t>(conf, param);
+      parse_build_param<T, uint32_t>(conf, param.cagra);
+      if (conf.contains("hierarchy")) {
+        std::string hierarchy = conf.at("hierarchy");
+        if (hierarchy == "none") {
+          param.hierarchy = raft::neighbors::hnsw::HnswHierarchy::NONE;
+        } else if (hierarchy == "gpu") {
+          param.hierarchy = raft::neighbors::hnsw::HnswHierarchy::GPU;
+        } else {
+          throw std::runtime_error("hierarchy should be either 'none' or 'gpu'");
+        }
+      }
       ann = std::make_unique<raft::bench::ann::RaftCagraHnswlib<T, uint32_t>>(metric, dim, param);
     }
   }
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -25,12 +25,18 @@ template <typename T, typename IdxT>
 class RaftCagraHnswlib : public ANN<T> {
  public:
   using typename ANN<T>::AnnSearchParam;
-  using BuildParam  = typename RaftCagra<T, IdxT>::BuildParam;
   using SearchParam = typename HnswLib<T>::SearchParam;
 
+  struct BuildParam {
+    typename RaftCagra<T, IdxT>::BuildParam cagra;
+    /** Whether the upper HNSW layers are built on the GPU or the index is base-layer-only. */
+    raft::neighbors::hnsw::HnswHierarchy hierarchy = raft::neighbors::hnsw::HnswHierarchy::NONE;
+  };
+
   RaftCagraHnswlib(Metric metric, int dim, const BuildParam& param, int concurrent_searches = 1)
     : ANN<T>(metric, dim),
-      cagra_build_{metric, dim, param, concurrent_searches},
+      cagra_build_{metric, dim, param.cagra, concurrent_searches},
+      hierarchy_{param.hierarchy},
       // HnswLib param values don't matter since we don't build with HnswLib
       hnswlib_search_{metric, dim, typename HnswLib<T>::BuildParam{50, 100}}
   {
@@ -67,6 +73,7 @@ class RaftCagraHnswlib : public ANN<T> {
 
  private:
   RaftCagra<T, IdxT> cagra_build_;
+  raft::neighbors::hnsw::HnswHierarchy hierarchy_;
   HnswLib<T> hnswlib_search_;
 };
 
@@ -85,14 +92,17 @@ void RaftCagraHnswlib<T, IdxT>::set_search_param(const AnnSearchParam& param_)
 template <typename T, typename IdxT>
 void RaftCagraHnswlib<T, IdxT>::save(const std::string& file) const
 {
-  cagra_build_.save_to_hnswlib(file);
+  cagra_build_.save_to_hnswlib(file, hierarchy_);
 }
 
 template <typename T, typename IdxT>
 void RaftCagraHnswlib<T, IdxT>::load(const std::string& file)
 {
   hnswlib_search_.load(file);
-  hnswlib_search_.set_base_layer_only();
+  // a hierarchical index is searched from its entry point through the upper layers
+  if (hierarchy_ == raft::neighbors::hnsw::HnswHierarchy::NONE) {
+    hnswlib_search_.set_base_layer_only();
+  }
 }
 
 template <typename T, typename IdxT>
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,10 +18,12 @@
 #include <cassert>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <optional>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/device_resources.hpp>
+#include <raft/core/host_mdspan.hpp>
 #include <raft/core/logger.hpp>
 #include <raft/core/operators.hpp>
 #include <raft/distance/distance_types.hpp>
@@ -30,6 +32,7 @@
 #include <raft/neighbors/cagra_serialize.cuh>
 #include <raft/neighbors/cagra_types.hpp>
 #include <raft/neighbors/detail/cagra/cagra_build.cuh>
+#include <raft/neighbors/hnsw_types.hpp>
 #include <raft/neighbors/ivf_pq_types.hpp>
 #include <raft/neighbors/nn_descent_types.hpp>
 #include <raft/util/cudart_utils.hpp>
@@ -91,6 +94,9 @@ class RaftCagra : public ANN<T> {
   }
 
   void build(const T* dataset, size_t nrow, cudaStream_t stream) final;
+  // The new vectors get the ids following the current ones; `ids` should be consecutive.
+  void extend(const T* dataset, const size_t* ids, size_t nrow, cudaStream_t stream) override;
+  void remove(const size_t* ids, size_t n, cudaStream_t stream) override;
 
   void set_search_param(const AnnSearchParam& param) override;
 
@@ -115,9 +121,17 @@ class RaftCagra : public ANN<T> {
   }
   void save(const std::string& file) const override;
   void load(const std::string&) override;
-  void save_to_hnswlib(const std::string& file) const;
+  void save_to_hnswlib(const std::string& file,
+                       raft::neighbors::hnsw::HnswHierarchy hierarchy =
+                         raft::neighbors::hnsw::HnswHierarchy::NONE) const;
   std::unique_ptr<ANN<T>> copy() override;
 
+  void enable_phase_times() override { handle_.enable_phase_times(); }
+  auto collect_phase_times() -> std::map<std::string, double> override
+  {
+    return handle_.collect_phase_times();
+  }
+
  private:
   // handle_ must go first to make sure it dies last and all memory allocated in pool
   configured_raft_resources handle_{};
@@ -164,6 +178,29 @@ void RaftCagra<T, IdxT>::build(const T* dataset, size_t nrow, cudaStream_t strea
   handle_.stream_wait(stream);  // RAFT stream -> bench stream
 }
 
+template <typename T, typename IdxT>
+void RaftCagra<T, IdxT>::extend(const T* dataset, const size_t*, size_t nrow, cudaStream_t stream)
+{
+  // The extended index owns a device copy of the whole dataset and graph.
+  auto new_vectors = raft::make_host_matrix_view<const T, int64_t>(dataset, nrow, dimension_);
+  raft::neighbors::cagra::extend(
+    handle_, raft::neighbors::cagra::extend_params{}, new_vectors, *index_);
+  handle_.stream_wait(stream);  // RAFT stream -> bench stream
+}
+
+template <typename T, typename IdxT>
+void RaftCagra<T, IdxT>::remove(const size_t* ids, size_t n, cudaStream_t stream)
+{
+  rmm::device_uvector<IdxT> ids_IdxT(n, resource::get_cuda_stream(handle_));
+  raft::linalg::unaryOp(
+    ids_IdxT.data(), ids, n, raft::cast_op<IdxT>(), raft::resource::get_cuda_stream(handle_));
+  raft::neighbors::cagra::remove(
+    handle_,
+    *index_,
+    raft::make_device_vector_view<const IdxT, int64_t>(ids_IdxT.data(), int64_t(n)));
+  handle_.stream_wait(stream);  // RAFT stream -> bench stream
+}
+
 inline std::string allocator_to_string(AllocatorType mem_type)
 {
   if (mem_type == AllocatorType::Device) {
@@ -244,9 +281,10 @@ void RaftCagra<T, IdxT>::save(const std::string& file) const
 }
 
 template <typename T, typename IdxT>
-void RaftCagra<T, IdxT>::save_to_hnswlib(const std::string& file) const
+void RaftCagra<T, IdxT>::save_to_hnswlib(const std::string& file,
+                                         raft::neighbors::hnsw::HnswHierarchy hierarchy) const
 {
-  raft::neighbors::cagra::serialize_to_hnswlib<T, IdxT>(handle_, file, *index_);
+  raft::neighbors::cagra::serialize_to_hnswlib<T, IdxT>(handle_, file, *index_, hierarchy);
 }
 
 template <typename T, typename IdxT>
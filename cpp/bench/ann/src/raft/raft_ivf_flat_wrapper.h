@@ -58,6 +58,7 @@ class RaftIvfFlatGpu : public ANN<T> {
   }
 
   void build(const T* dataset, size_t nrow, cudaStream_t stream) final;
+  void extend(const T* dataset, const size_t* ids, size_t nrow, cudaStream_t stream) override;
 
   void set_search_param(const AnnSearchParam& param) override;
 
@@ -100,6 +101,18 @@ void RaftIvfFlatGpu<T, IdxT>::build(const T* dataset, size_t nrow, cudaStream_t
   handle_.stream_wait(stream);  // RAFT stream -> bench stream
 }
 
+template <typename T, typename IdxT>
+void RaftIvfFlatGpu<T, IdxT>::extend(const T* dataset,
+                                     const size_t* ids,
+                                     size_t nrow,
+                                     cudaStream_t stream)
+{
+  static_assert(sizeof(size_t) == sizeof(IdxT), "IdxT is incompatible with size_t");
+  raft::neighbors::ivf_flat::extend(
+    handle_, index_.get(), dataset, reinterpret_cast<const IdxT*>(ids), IdxT(nrow));
+  handle_.stream_wait(stream);  // RAFT stream -> bench stream
+}
+
 template <typename T, typename IdxT>
 void RaftIvfFlatGpu<T, IdxT>::set_search_param(const AnnSearchParam& param)
 {
@@ -16,6 +16,7 @@
 #pragma once
 
 #include "../common/ann_types.hpp"
+#include "../common/host_prefetch.hpp"
 #include "raft_ann_bench_utils.h"
 
 #include <raft/core/device_mdarray.hpp>
@@ -24,9 +25,14 @@
 #include <raft/core/host_mdarray.hpp>
 #include <raft/core/host_mdspan.hpp>
 #include <raft/core/logger.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/pinned_mdarray.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/phase_timer.hpp>
 #include <raft/distance/distance_types.hpp>
+#include <raft/linalg/map.cuh>
 #include <raft/linalg/unary_op.cuh>
+#include <raft/neighbors/ivf_pq_serialize.cuh>
 #include <raft/neighbors/ivf_pq_types.hpp>
 #include <raft/util/cudart_utils.hpp>
 #include <raft_runtime/neighbors/ivf_pq.hpp>
@@ -35,6 +41,9 @@
 #include <rmm/device_uvector.hpp>
 #include <rmm/mr/device/device_memory_resource.hpp>
 
+#include <algorithm>
+#include <map>
+#include <string>
 #include <type_traits>
 
 namespace raft::bench::ann {
@@ -51,7 +60,13 @@ class RaftIvfPQ : public ANN<T> {
     auto needs_dataset() const -> bool override { return refine_ratio > 1.0f; }
   };
 
-  using BuildParam = raft::neighbors::ivf_pq::index_params;
+  struct BuildParam : public raft::neighbors::ivf_pq::index_params {
+    /**
+     * Save the index in the page-aligned layout and load it by memory-mapping the file, the lists
+     * being copied to the device straight from the mapping (`ivf_pq::serialize_mapped`).
+     */
+    bool mapped_file = false;
+  };
 
   RaftIvfPQ(Metric metric, int dim, const BuildParam& param)
     : ANN<T>(metric, dim), index_params_(param), dimension_(dim)
@@ -60,6 +75,7 @@ class RaftIvfPQ : public ANN<T> {
   }
 
   void build(const T* dataset, size_t nrow, cudaStream_t stream) final;
+  void extend(const T* dataset, const size_t* ids, size_t nrow, cudaStream_t stream) override;
 
   void set_search_param(const AnnSearchParam& param) override;
   void set_search_dataset(const T* dataset, size_t nrow) override;
@@ -77,7 +93,7 @@ class RaftIvfPQ : public ANN<T> {
   AlgoProperty get_preference() const override
   {
     AlgoProperty property;
-    property.dataset_memory_type = MemoryType::Host;
+    property.dataset_memory_type = MemoryType::HostMmap;
     property.query_memory_type   = MemoryType::Device;
     return property;
   }
@@ -85,6 +101,12 @@ class RaftIvfPQ : public ANN<T> {
   void load(const std::string&) override;
   std::unique_ptr<ANN<T>> copy() override;
 
+  void enable_phase_times() override { handle_.enable_phase_times(); }
+  auto collect_phase_times() -> std::map<std::string, double> override
+  {
+    return handle_.collect_phase_times();
+  }
+
  private:
   // handle_ must go first to make sure it dies last and all memory allocated in pool
   configured_raft_resources handle_{};
@@ -99,12 +121,22 @@ class RaftIvfPQ : public ANN<T> {
 template <typename T, typename IdxT>
 void RaftIvfPQ<T, IdxT>::save(const std::string& file) const
 {
-  raft::runtime::neighbors::ivf_pq::serialize(handle_, file, *index_);
+  if (index_params_.mapped_file) {
+    raft::neighbors::ivf_pq::serialize_mapped(handle_, file, *index_);
+  } else {
+    raft::runtime::neighbors::ivf_pq::serialize(handle_, file, *index_);
+  }
 }
 
 template <typename T, typename IdxT>
 void RaftIvfPQ<T, IdxT>::load(const std::string& file)
 {
+  if (index_params_.mapped_file) {
+    std::make_shared<raft::neighbors::ivf_pq::index<IdxT>>(
+      std::move(raft::neighbors::ivf_pq::deserialize_mapped<IdxT>(handle_, file)))
+      .swap(index_);
+    return;
+  }
   std::make_shared<raft::neighbors::ivf_pq::index<IdxT>>(handle_, index_params_, dimension_)
     .swap(index_);
   raft::runtime::neighbors::ivf_pq::deserialize(handle_, file, index_.get());
@@ -114,10 +146,42 @@ void RaftIvfPQ<T, IdxT>::load(const std::string& file)
 template <typename T, typename IdxT>
 void RaftIvfPQ<T, IdxT>::build(const T* dataset, size_t nrow, cudaStream_t stream)
 {
-  auto dataset_v = raft::make_device_matrix_view<const T, IdxT>(dataset, IdxT(nrow), dim_);
+  auto dataset_v  = raft::make_device_matrix_view<const T, IdxT>(dataset, IdxT(nrow), dim_);
+  auto chunk_rows = std::max<size_t>(kHostChunkBytes / (sizeof(T) * dim_), 1);
+  if (raft::get_device_for_address(dataset) >= 0 || nrow <= chunk_rows ||
+      !index_params_.add_data_on_build) {
+    std::make_shared<raft::neighbors::ivf_pq::index<IdxT>>(
+      std::move(raft::runtime::neighbors::ivf_pq::build(handle_, index_params_, dataset_v)))
+      .swap(index_);
+    handle_.stream_wait(stream);  // RAFT stream -> bench stream
+    return;
+  }
+
+  // A large host (typically memory-mapped) dataset: train the index on a subsample of it, then
+  // add it chunk by chunk, reading ahead the next chunk from the file while the current one is
+  // processed.
+  auto params              = index_params_;
+  params.add_data_on_build = false;
   std::make_shared<raft::neighbors::ivf_pq::index<IdxT>>(
-    std::move(raft::runtime::neighbors::ivf_pq::build(handle_, index_params_, dataset_v)))
+    std::move(raft::runtime::neighbors::ivf_pq::build(handle_, params, dataset_v)))
     .swap(index_);
+  auto ids = raft::make_device_vector<IdxT, IdxT>(handle_, IdxT(chunk_rows));
+  prefetch_host_pages(dataset, chunk_rows * dim_ * sizeof(T));
+  for (size_t offset = 0; offset < nrow; offset += chunk_rows) {
+    auto n_rows      = std::min(chunk_rows, nrow - offset);
+    auto next_offset = offset + n_rows;
+    if (next_offset < nrow) {
+      prefetch_host_pages(dataset + next_offset * dim_,
+                          std::min(chunk_rows, nrow - next_offset) * dim_ * sizeof(T));
+    }
+    auto ids_v = raft::make_device_vector_view<IdxT, IdxT>(ids.data_handle(), IdxT(n_rows));
+    raft::linalg::map_offset(handle_, ids_v, raft::add_const_op<IdxT>(IdxT(offset)));
+    raft::runtime::neighbors::ivf_pq::extend(
+      handle_,
+      raft::make_device_matrix_view<const T, IdxT>(dataset + offset * dim_, IdxT(n_rows), dim_),
+      raft::make_const_mdspan(ids_v),
+      index_.get());
+  }
   handle_.stream_wait(stream);  // RAFT stream -> bench stream
 }
 
@@ -127,6 +191,20 @@ std::unique_ptr<ANN<T>> RaftIvfPQ<T, IdxT>::copy()
   return std::make_unique<RaftIvfPQ<T, IdxT>>(*this);  // use copy constructor
 }
 
+template <typename T, typename IdxT>
+void RaftIvfPQ<T, IdxT>::extend(const T* dataset,
+                                const size_t* ids,
+                                size_t nrow,
+                                cudaStream_t stream)
+{
+  static_assert(sizeof(size_t) == sizeof(IdxT), "IdxT is incompatible with size_t");
+  auto new_vectors = raft::make_device_matrix_view<const T, IdxT>(dataset, IdxT(nrow), dim_);
+  auto new_indices = raft::make_device_vector_view<const IdxT, IdxT>(
+    reinterpret_cast<const IdxT*>(ids), IdxT(nrow));
+  raft::runtime::neighbors::ivf_pq::extend(handle_, new_vectors, new_indices, index_.get());
+  handle_.stream_wait(stream);  // RAFT stream -> bench stream
+}
+
 template <typename T, typename IdxT>
 void RaftIvfPQ<T, IdxT>::set_search_param(const AnnSearchParam& param)
 {
@@ -160,6 +238,7 @@ void RaftIvfPQ<T, IdxT>::search(const T* queries,
     raft::runtime::neighbors::ivf_pq::search(
       handle_, search_params_, *index_, queries_v, candidates.view(), distances_tmp.view());
 
+    resource::scoped_phase refine_phase(handle_, "ivf_pq::refine");
     if (raft::get_device_for_address(dataset_.data_handle()) >= 0) {
       auto queries_v =
         raft::make_device_matrix_view<const T, IdxT>(queries, batch_size, index_->dim());
@@ -175,10 +254,11 @@ void RaftIvfPQ<T, IdxT>::search(const T* queries,
                                        index_->metric());
       handle_.stream_wait(stream);  // RAFT stream -> bench stream
     } else {
-      auto queries_host    = raft::make_host_matrix<T, IdxT>(batch_size, index_->dim());
-      auto candidates_host = raft::make_host_matrix<IdxT, IdxT>(batch_size, k0);
-      auto neighbors_host  = raft::make_host_matrix<IdxT, IdxT>(batch_size, k);
-      auto distances_host  = raft::make_host_matrix<float, IdxT>(batch_size, k);
+      // pinned staging buffers (reused from the pool of handle_ across the calls)
+      auto queries_host    = raft::make_pinned_matrix<T, IdxT>(handle_, batch_size, index_->dim());
+      auto candidates_host = raft::make_pinned_matrix<IdxT, IdxT>(handle_, batch_size, k0);
+      auto neighbors_host  = raft::make_pinned_matrix<IdxT, IdxT>(handle_, batch_size, k);
+      auto distances_host  = raft::make_pinned_matrix<float, IdxT>(handle_, batch_size, k);
 
       raft::copy(queries_host.data_handle(), queries, queries_host.size(), stream);
       raft::copy(candidates_host.data_handle(),
@@ -193,16 +273,22 @@ void RaftIvfPQ<T, IdxT>::search(const T* queries,
       RAFT_CUDA_TRY(cudaEventRecord(handle_.get_sync_event(), resource::get_cuda_stream(handle_)));
       RAFT_CUDA_TRY(cudaEventRecord(handle_.get_sync_event(), stream));
       RAFT_CUDA_TRY(cudaEventSynchronize(handle_.get_sync_event()));
-      raft::runtime::neighbors::refine(handle_,
-                                       dataset_v,
-                                       queries_host.view(),
-                                       candidates_host.view(),
-                                       neighbors_host.view(),
-                                       distances_host.view(),
-                                       index_->metric());
+      raft::runtime::neighbors::refine(
+        handle_,
+        dataset_v,
+        raft::make_host_matrix_view<const T, IdxT>(
+          queries_host.data_handle(), batch_size, index_->dim()),
+        raft::make_host_matrix_view<const IdxT, IdxT>(
+          candidates_host.data_handle(), batch_size, k0),
+        raft::make_host_matrix_view<IdxT, IdxT>(neighbors_host.data_handle(), batch_size, k),
+        raft::make_host_matrix_view<float, IdxT>(distances_host.data_handle(), batch_size, k),
+        index_->metric());
 
       raft::copy(neighbors, (size_t*)neighbors_host.data_handle(), neighbors_host.size(), stream);
       raft::copy(distances, distances_host.data_handle(), distances_host.size(), stream);
+      // the copies from the pinned buffers are asynchronous: finish them before the buffers are
+      // returned to the pool
+      RAFT_CUDA_TRY(cudaStreamSynchronize(stream));
     }
   } else {
     auto queries_v =
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "../common/ann_types.hpp"
+#include "raft_ann_bench_utils.h"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/pinned_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/phase_timer.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/util/cudart_utils.hpp>
+#include <raft_runtime/neighbors/refine.hpp>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace raft::bench::ann {
+
+/**
+ * A two-stage search pipeline: a cheap candidate generator (e.g. IVF-PQ on the compressed vectors,
+ * or CAGRA) retrieves `refine_ratio * k` candidates, which are re-ranked by the exact distances to
+ * the full-precision vectors with `raft::neighbors::refine`.
+ *
+ * The full vectors are kept either in the device memory (fast refinement, at the cost of the
+ * memory footprint of the whole dataset) or in the host memory (the refinement runs on the CPU
+ * and only the candidates cross the PCIe bus); the placement is a search parameter.
+ *
+ * @tparam Upstream the wrapper of the candidate generator; its build and search parameters are
+ *         those of the pipeline.
+ */
+template <typename T, typename Upstream>
+class RaftRefine : public ANN<T> {
+ public:
+  using typename ANN<T>::AnnSearchParam;
+  using BuildParam = typename Upstream::BuildParam;
+
+  struct SearchParam : public AnnSearchParam {
+    typename Upstream::SearchParam upstream;
+    float refine_ratio = 2.0f;
+    /** Where the full vectors used in the refinement reside: Device or Host. */
+    MemoryType refine_memory_type = MemoryType::Device;
+    auto needs_dataset() const -> bool override { return true; }
+  };
+
+  RaftRefine(Metric metric, int dim, const BuildParam& param)
+    : ANN<T>(metric, dim),
+      upstream_(metric, dim, param),
+      metric_(parse_metric_type(metric)),
+      dataset_(nullptr, 0, 0),
+      device_dataset_(std::make_shared<raft::device_matrix<T, int64_t, row_major>>(
+        make_device_matrix<T, int64_t>(handle_, 0, 0)))
+  {
+  }
+
+  void build(const T* dataset, size_t nrow, cudaStream_t stream) final
+  {
+    upstream_.build(dataset, nrow, stream);
+  }
+  void extend(const T* dataset, const size_t* ids, size_t nrow, cudaStream_t stream) override
+  {
+    upstream_.extend(dataset, ids, nrow, stream);
+  }
+  void remove(const size_t* ids, size_t n, cudaStream_t stream) override
+  {
+    upstream_.remove(ids, n, stream);
+  }
+
+  void set_search_param(const AnnSearchParam& param) override;
+  void set_search_dataset(const T* dataset, size_t nrow) override;
+
+  void search(const T* queries,
+              int batch_size,
+              int k,
+              size_t* neighbors,
+              float* distances,
+              cudaStream_t stream = 0) const override;
+
+  AlgoProperty get_preference() const override
+  {
+    // the full vectors are read from the host (mmap) and copied to the device only if requested
+    auto property                = upstream_.get_preference();
+    property.dataset_memory_type = MemoryType::HostMmap;
+    property.query_memory_type   = MemoryType::Device;
+    return property;
+  }
+  void save(const std::string& file) const override { upstream_.save(file); }
+  void load(const std::string& file) override { upstream_.load(file); }
+  std::unique_ptr<ANN<T>> copy() override
+  {
+    return std::make_unique<RaftRefine<T, Upstream>>(*this);  // use copy constructor
+  }
+
+  void enable_phase_times() override
+  {
+    upstream_.enable_phase_times();
+    handle_.enable_phase_times();
+  }
+  auto collect_phase_times() -> std::map<std::string, double> override
+  {
+    auto times = upstream_.collect_phase_times();
+    for (auto& [name, t] : handle_.collect_phase_times()) {
+      times[name] += t;
+    }
+    return times;
+  }
+
+ private:
+  // handle_ must go first to make sure it dies last and all memory allocated in pool
+  configured_raft_resources handle_{};
+  Upstream upstream_;
+  raft::distance::DistanceType metric_;
+  float refine_ratio_            = 2.0f;
+  MemoryType refine_memory_type_ = MemoryType::Device;
+  bool need_dataset_update_      = true;
+  raft::host_matrix_view<const T, int64_t, row_major> dataset_;
+  // shared by the copies of the wrapper (the search threads)
+  std::shared_ptr<raft::device_matrix<T, int64_t, row_major>> device_dataset_;
+};
+
+template <typename T, typename Upstream>
+void RaftRefine<T, Upstream>::set_search_dataset(const T* dataset, size_t nrow)
+{
+  if (dataset_.data_handle() != dataset || static_cast<size_t>(dataset_.extent(0)) != nrow) {
+    dataset_             = raft::make_host_matrix_view<const T, int64_t>(dataset, nrow, this->dim_);
+    need_dataset_update_ = true;
+  }
+  upstream_.set_search_dataset(dataset, nrow);
+}
+
+template <typename T, typename Upstream>
+void RaftRefine<T, Upstream>::set_search_param(const AnnSearchParam& param)
+{
+  auto search_param = dynamic_cast<const SearchParam&>(param);
+  upstream_.set_search_param(search_param.upstream);
+  refine_ratio_ = search_param.refine_ratio;
+  if (search_param.refine_memory_type != MemoryType::Device &&
+      search_param.refine_memory_type != MemoryType::Host) {
+    throw std::runtime_error("refine_memory_type should be either 'device' or 'host'");
+  }
+  if (search_param.refine_memory_type != refine_memory_type_) {
+    refine_memory_type_  = search_param.refine_memory_type;
+    need_dataset_update_ = true;
+  }
+  if (!need_dataset_update_) { return; }
+
+  // Only keep the device copy of the full vectors if the refinement runs on the device
+  *device_dataset_ = make_device_matrix<T, int64_t>(handle_, 0, 0);
+  if (refine_memory_type_ == MemoryType::Device) {
+    RAFT_LOG_INFO("copying the refinement dataset to the device memory");
+    *device_dataset_ =
+      make_device_matrix<T, int64_t>(handle_, dataset_.extent(0), dataset_.extent(1));
+    raft::copy(device_dataset_->data_handle(),
+               dataset_.data_handle(),
+               dataset_.size(),
+               resource::get_cuda_stream(handle_));
+    resource::sync_stream(handle_);
+  }
+  need_dataset_update_ = false;
+}
+
+template <typename T, typename Upstream>
+void RaftRefine<T, Upstream>::search(const T* queries,
+                                     int batch_size,
+                                     int k,
+                                     size_t* neighbors,
+                                     float* distances,
+                                     cudaStream_t stream) const
+{
+  static_assert(sizeof(size_t) == sizeof(int64_t), "int64_t is incompatible with size_t");
+  int k0                   = std::max(k, static_cast<int>(refine_ratio_ * k));
+  auto candidates          = raft::make_device_matrix<int64_t, int64_t>(handle_, batch_size, k0);
+  auto candidate_distances = raft::make_device_matrix<float, int64_t>(handle_, batch_size, k0);
+  upstream_.search(queries,
+                   batch_size,
+                   k0,
+                   reinterpret_cast<size_t*>(candidates.data_handle()),
+                   candidate_distances.data_handle(),
+                   stream);
+  // the upstream results are ready in `stream`
+  RAFT_CUDA_TRY(cudaEventRecord(handle_.get_sync_event(), stream));
+  RAFT_CUDA_TRY(cudaStreamWaitEvent(resource::get_cuda_stream(handle_), handle_.get_sync_event()));
+
+  resource::scoped_phase refine_phase(handle_, "refine");
+  int64_t dim = this->dim_;
+  if (refine_memory_type_ == MemoryType::Device) {
+    raft::runtime::neighbors::refine(
+      handle_,
+      make_const_mdspan(device_dataset_->view()),
+      raft::make_device_matrix_view<const T, int64_t>(queries, batch_size, dim),
+      make_const_mdspan(candidates.view()),
+      raft::make_device_matrix_view<int64_t, int64_t>(
+        reinterpret_cast<int64_t*>(neighbors), batch_size, k),
+      raft::make_device_matrix_view<float, int64_t>(distances, batch_size, k),
+      metric_);
+    handle_.stream_wait(stream);  // RAFT stream -> bench stream
+    return;
+  }
+
+  // pinned staging buffers (reused from the pool of handle_ across the calls)
+  auto queries_host    = raft::make_pinned_matrix<T, int64_t>(handle_, batch_size, dim);
+  auto candidates_host = raft::make_pinned_matrix<int64_t, int64_t>(handle_, batch_size, k0);
+  auto neighbors_host  = raft::make_pinned_matrix<int64_t, int64_t>(handle_, batch_size, k);
+  auto distances_host  = raft::make_pinned_matrix<float, int64_t>(handle_, batch_size, k);
+  raft::copy(queries_host.data_handle(), queries, queries_host.size(), stream);
+  raft::copy(candidates_host.data_handle(), candidates.data_handle(), candidates.size(), stream);
+  RAFT_CUDA_TRY(cudaStreamSynchronize(stream));
+
+  raft::runtime::neighbors::refine(
+    handle_,
+    dataset_,
+    raft::make_host_matrix_view<const T, int64_t>(queries_host.data_handle(), batch_size, dim),
+    raft::make_host_matrix_view<const int64_t, int64_t>(
+      candidates_host.data_handle(), batch_size, k0),
+    raft::make_host_matrix_view<int64_t, int64_t>(neighbors_host.data_handle(), batch_size, k),
+    raft::make_host_matrix_view<float, int64_t>(distances_host.data_handle(), batch_size, k),
+    metric_);
+
+  raft::copy(neighbors,
+             reinterpret_cast<const size_t*>(neighbors_host.data_handle()),
+             neighbors_host.size(),
+             stream);
+  raft::copy(distances, distances_host.data_handle(), distances_host.size(), stream);
+  // the copies from the pinned buffers are asynchronous: finish them before the buffers are
+  // returned to the pool
+  RAFT_CUDA_TRY(cudaStreamSynchronize(stream));
+}
+
+}  // namespace raft::bench::ann
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace raft::bench {
+
+/**
+ * The options of the regression-tracking mode of the benchmarks:
+ *
+ *   --baseline=<file.json>          compare the run against a stored google benchmark JSON output
+ *                                   (e.g. produced with `--benchmark_out=<file.json>`)
+ *   --regression_threshold=<pct>    the slowdown (in percent of the baseline time) above which a
+ *                                   benchmark is reported as a regression (default: 5)
+ */
+struct baseline_options {
+  std::string file;
+  double threshold_pct = 5.0;
+
+  /** Parse and remove the baseline flags from the command line (before benchmark::Initialize). */
+  static auto parse(int* argc, char** argv) -> baseline_options
+  {
+    constexpr const char* kBaselineFlag  = "--baseline=";
+    constexpr const char* kThresholdFlag = "--regression_threshold=";
+    baseline_options opts;
+    int j = 1;
+    for (int i = 1; i < *argc; ++i) {
+      if (strncmp(argv[i], kBaselineFlag, strlen(kBaselineFlag)) == 0) {
+        opts.file = argv[i] + strlen(kBaselineFlag);
+      } else if (strncmp(argv[i], kThresholdFlag, strlen(kThresholdFlag)) == 0) {
+        opts.threshold_pct = std::atof(argv[i] + strlen(kThresholdFlag));
+      } else {
+        argv[j++] = argv[i];
+      }
+    }
+    *argc = j;
+    return opts;
+  }
+};
+
+namespace detail {
+
+inline auto time_unit_seconds(const std::string& unit) -> double
+{
+  if (unit == "ns") { return 1e-9; }
+  if (unit == "us") { return 1e-6; }
+  if (unit == "ms") { return 1e-3; }
+  return 1.0;
+}
+
+/** The value of a `"key": value` line of the JSON written by google benchmark. */
+inline auto json_field(const std::string& line, const char* key, std::string* value) -> bool
+{
+  auto quoted_key = std::string{"\""} + key + "\":";
+  auto pos        = line.find(quoted_key);
+  if (pos == std::string::npos || line.find_first_not_of(" \t") != pos) { return false; }
+  auto begin = line.find_first_not_of(" \t\"", pos + quoted_key.size());
+  auto end   = line.find_last_not_of(" \t,\"\r");
+  if (begin == std::string::npos || end < begin) { return false; }
+  *value = line.substr(begin, end - begin + 1);
+  return true;
+}
+
+}  // namespace detail
+
+/**
+ * Load the real time [s] of every benchmark run stored in a google benchmark JSON output.
+ *
+ * The parser relies on the layout of the files written by google benchmark (one field per line),
+ * which keeps the benchmarks free of a JSON library dependency.
+ */
+inline auto load_baseline(const std::string& path) -> std::map<std::string, double>
+{
+  std::ifstream in(path);
+  if (!in) {
+    fprintf(stderr, "Cannot open the baseline file '%s'\n", path.c_str());
+    std::exit(1);
+  }
+  std::map<std::string, double> times;
+  std::string line, value, name, real_time;
+  bool in_benchmarks = false;
+  while (std::getline(in, line)) {
+    if (!in_benchmarks) {
+      in_benchmarks = line.find("\"benchmarks\":") != std::string::npos;
+      continue;
+    }
+    if (detail::json_field(line, "name", &value)) {
+      name = value;
+      real_time.clear();
+    } else if (detail::json_field(line, "real_time", &value)) {
+      real_time = value;
+    } else if (detail::json_field(line, "time_unit", &value) && !name.empty() &&
+               !real_time.empty()) {
+      times[name] = std::atof(real_time.c_str()) * detail::time_unit_seconds(value);
+    }
+  }
+  return times;
+}
+
+/**
+ * A console reporter that also compares the runs against a stored baseline; the summary of the
+ * regressions (and the improvements) is printed by `report`.
+ */
+class baseline_reporter : public ::benchmark::ConsoleReporter {
+ public:
+  explicit baseline_reporter(const baseline_options& opts)
+    : opts_(opts), baseline_(load_baseline(opts.file))
+  {
+  }
+
+  void ReportRuns(const std::vector<Run>& reports) override
+  {
+    for (const auto& run : reports) {
+      if (run.skipped) { continue; }
+      auto it = baseline_.find(run.benchmark_name());
+      if (it == baseline_.end() || it->second <= 0) { continue; }
+      double time = run.GetAdjustedRealTime() / ::benchmark::GetTimeUnitMultiplier(run.time_unit);
+      double change_pct = 100.0 * (time / it->second - 1.0);
+      if (change_pct > opts_.threshold_pct) {
+        regressions_.push_back({run.benchmark_name(), it->second, time, change_pct});
+      } else if (change_pct < -opts_.threshold_pct) {
+        improvements_.push_back({run.benchmark_name(), it->second, time, change_pct});
+      }
+      compared_++;
+    }
+    ConsoleReporter::ReportRuns(reports);
+  }
+
+  /** Print the comparison summary; returns the number of regressions. */
+  auto report() const -> int
+  {
+    printf("\nCompared %d benchmarks against the baseline '%s' (threshold: %.1f%%)\n",
+           compared_,
+           opts_.file.c_str(),
+           opts_.threshold_pct);
+    print("Improvements", improvements_);
+    print("Regressions", regressions_);
+    return static_cast<int>(regressions_.size());
+  }
+
+ private:
+  struct change {
+    std::string name;
+    double baseline_s;
+    double current_s;
+    double change_pct;
+  };
+
+  baseline_options opts_;
+  std::map<std::string, double> baseline_;
+  std::vector<change> regressions_;
+  std::vector<change> improvements_;
+  int compared_ = 0;
+
+  static void print(const char* title, const std::vector<change>& changes)
+  {
+    if (changes.empty()) { return; }
+    printf("%s:\n", title);
+    for (const auto& c : changes) {
+      printf("  %-60s %12.6f ms -> %12.6f ms (%+.1f%%)\n",
+             c.name.c_str(),
+             c.baseline_s * 1e3,
+             c.current_s * 1e3,
+             c.change_pct);
+    }
+  }
+};
+
+/**
+ * Run the registered benchmarks (after benchmark::Initialize), comparing them against the
+ * baseline if one is given.
+ *
+ * @return the exit code of the benchmark executable: non-zero if any benchmark regressed.
+ */
+inline auto run_benchmarks(const baseline_options& opts) -> int
+{
+  if (opts.file.empty()) {
+    ::benchmark::RunSpecifiedBenchmarks();
+    ::benchmark::Shutdown();
+    return 0;
+  }
+  baseline_reporter reporter(opts);
+  ::benchmark::RunSpecifiedBenchmarks(&reporter);
+  ::benchmark::Shutdown();
+  return reporter.report() > 0 ? 1 : 0;
+}
+
+}  // namespace raft::bench
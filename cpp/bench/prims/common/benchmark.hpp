@@ -16,13 +16,11 @@
 
 #pragma once
 
-#include <memory>
-#include <raft/core/resource/cuda_stream.hpp>
-
 #include <raft/core/detail/macros.hpp>
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/device_resources.hpp>
 #include <raft/core/interruptible.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
 #include <raft/random/make_blobs.cuh>
 #include <raft/util/cudart_utils.hpp>
 
@@ -35,8 +33,72 @@
 #include <rmm/mr/device/per_device_resource.hpp>
 #include <rmm/mr/device/pool_memory_resource.hpp>
 
+#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+
 namespace raft::bench {
 
+/**
+ * The theoretical peak throughput of a device, the reference for the roofline metrics.
+ *
+ * The peaks are derived from the device attributes: the memory bandwidth is exact (DDR memory
+ * clock times the bus width), the compute peaks assume one FMA (two flops) per lane per cycle at
+ * the base clock, with the number of lanes per SM taken from the compute capability.
+ */
+struct device_peak {
+  /** DRAM bandwidth [bytes/s]. */
+  double bytes_per_second;
+  /** Single precision FMA throughput [flop/s]. */
+  double fp32_flops;
+  /** Double precision FMA throughput [flop/s]. */
+  double fp64_flops;
+
+  /** The peak of the current device (queried once per device). */
+  static auto current() -> const device_peak&
+  {
+    static std::mutex mutex;
+    static std::map<int, device_peak> cache;
+    int device_id = 0;
+    RAFT_CUDA_TRY(cudaGetDevice(&device_id));
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(device_id);
+    if (it == cache.end()) { it = cache.emplace(device_id, query(device_id)).first; }
+    return it->second;
+  }
+
+ private:
+  static auto query(int device_id) -> device_peak
+  {
+    auto attr = [device_id](cudaDeviceAttr a) {
+      int v = 0;
+      RAFT_CUDA_TRY(cudaDeviceGetAttribute(&v, a, device_id));
+      return static_cast<double>(v);
+    };
+    // clock rates are in kHz, the bus width in bits
+    double mem_clock = attr(cudaDevAttrMemoryClockRate) * 1e3;
+    double bus_width = attr(cudaDevAttrGlobalMemoryBusWidth);
+    double sm_clock  = attr(cudaDevAttrClockRate) * 1e3;
+    double sm_count  = attr(cudaDevAttrMultiProcessorCount);
+    int major        = static_cast<int>(attr(cudaDevAttrComputeCapabilityMajor));
+    int minor        = static_cast<int>(attr(cudaDevAttrComputeCapabilityMinor));
+
+    // FP32 / FP64 lanes per SM: the data center parts (x.0) have the full-rate FP64 units
+    double fp32_lanes = 128;
+    double fp64_lanes = 2;
+    if (minor == 0 && major >= 6) {
+      fp32_lanes = major >= 9 ? 128 : 64;
+      fp64_lanes = fp32_lanes / 2;
+    } else if (major == 7) {
+      fp32_lanes = 64;
+    }
+    return device_peak{2.0 * mem_clock * bus_width / 8.0,
+                       2.0 * sm_clock * sm_count * fp32_lanes,
+                       2.0 * sm_clock * sm_count * fp64_lanes};
+  }
+};
+
 /**
  * RAII way to temporary set the pooling memory allocator in rmm.
  * This may be useful for benchmarking functions that do some memory allocations.
@@ -153,6 +215,35 @@ class fixture {
     RAFT_CUDA_TRY(cudaMemsetAsync(scratch_buf_.data(), 0, scratch_buf_.size(), stream));
   }
 
+  /**
+   * The helper to be used inside `generate_metrics` (or at the end of `run_benchmark`) to report
+   * the roofline metrics of a benchmark: the achieved memory bandwidth and compute throughput both
+   * in absolute terms ("BW", "FLOP/s") and as a percentage of the device peak ("BW %peak",
+   * "FLOP %peak"). The inputs are the per-iteration totals; the rates are derived from the
+   * iteration time.
+   *
+   * @tparam MathT the type of the arithmetic (selects the FP64 or FP32 peak)
+   * @param state the benchmark state
+   * @param bytes the minimal number of bytes read and written by one iteration
+   * @param flops the number of floating-point operations of one iteration (zero to skip)
+   */
+  template <typename MathT = float>
+  void report_roofline(::benchmark::State& state, double bytes, double flops = 0)
+  {
+    using ::benchmark::Counter;
+    auto& peak = device_peak::current();
+    state.counters["BW"] =
+      Counter(bytes, Counter::kIsIterationInvariantRate, Counter::OneK::kIs1024);
+    state.counters["BW %peak"] =
+      Counter(100.0 * bytes / peak.bytes_per_second, Counter::kIsIterationInvariantRate);
+    if (flops <= 0) { return; }
+    double peak_flops = std::is_same_v<MathT, double> ? peak.fp64_flops : peak.fp32_flops;
+    state.counters["FLOP/s"] =
+      Counter(flops, Counter::kIsIterationInvariantRate, Counter::OneK::kIs1000);
+    state.counters["FLOP %peak"] =
+      Counter(100.0 * flops / peak_flops, Counter::kIsIterationInvariantRate);
+  }
+
   /**
    * The helper to be used inside `run_benchmark`, to loop over the state and record time using the
    * cuda_event_timer.
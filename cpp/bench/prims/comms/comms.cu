@@ -0,0 +1,394 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/benchmark.hpp>
+#include <raft/comms/detail/util.hpp>
+#include <raft/comms/std_comms.hpp>
+#include <raft/core/device_resources.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <nccl.h>
+#include <ucp/api/ucp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace raft::bench::comms {
+
+/** The operations of `raft::comms::comms_t` measured by the benchmark. */
+enum class comms_op {
+  ALLREDUCE,
+  BCAST,
+  REDUCE,
+  ALLGATHER,
+  ALLGATHERV,
+  GATHER,
+  GATHERV,
+  REDUCESCATTER,
+  /** Ring exchange: every rank sends to the next one and receives from the previous one. */
+  DEVICE_SENDRECV,
+  /** All-to-all exchange: every rank sends an equal share of its buffer to every rank. */
+  DEVICE_MULTICAST_SENDRECV,
+  /**
+   * The ring exchange of DEVICE_SENDRECV with the host-driven UCX isend/irecv/waitall (of device
+   * buffers: UCX must be built with CUDA support).
+   */
+  ISEND_IRECV
+};
+
+inline auto to_string(comms_op op) -> std::string
+{
+  switch (op) {
+    case comms_op::ALLREDUCE: return "allreduce";
+    case comms_op::BCAST: return "bcast";
+    case comms_op::REDUCE: return "reduce";
+    case comms_op::ALLGATHER: return "allgather";
+    case comms_op::ALLGATHERV: return "allgatherv";
+    case comms_op::GATHER: return "gather";
+    case comms_op::GATHERV: return "gatherv";
+    case comms_op::REDUCESCATTER: return "reducescatter";
+    case comms_op::DEVICE_SENDRECV: return "device_sendrecv";
+    case comms_op::DEVICE_MULTICAST_SENDRECV: return "device_multicast_sendrecv";
+    case comms_op::ISEND_IRECV: return "isend_irecv";
+  }
+  return "";
+}
+
+/**
+ * The inputs of a case. As in nccl-tests, `bytes` is the size of the largest buffer of a rank:
+ * the sent (or received) vector of allreduce, bcast, reduce and the p2p exchanges, the gathered
+ * vector of the gathers and the scattered vector of reducescatter.
+ */
+struct comms_inputs {
+  int n_ranks;
+  comms_op op;
+  size_t bytes;
+};
+
+/**
+ * The factor between the algorithm bandwidth (bytes / time) and the bus bandwidth of an
+ * operation, i.e. the bandwidth of the links of a ring implementation, which is comparable across
+ * the operations and the rank counts with the peak bandwidth of the interconnect.
+ */
+inline auto bus_bandwidth_factor(comms_op op, int n_ranks) -> double
+{
+  double n = n_ranks;
+  switch (op) {
+    case comms_op::ALLREDUCE: return 2 * (n - 1) / n;
+    case comms_op::ALLGATHER:
+    case comms_op::ALLGATHERV:
+    case comms_op::GATHER:
+    case comms_op::GATHERV:
+    case comms_op::REDUCESCATTER:
+    case comms_op::DEVICE_MULTICAST_SENDRECV: return (n - 1) / n;
+    default: return 1;
+  }
+}
+
+/**
+ * A clique of ranks within this process, one per device, every one with its raft::resources
+ * holding a std_comms over NCCL (collectives and device p2p) and UCX (host p2p). The operations
+ * of the ranks are issued by one thread per rank, as they would be by the processes of a
+ * distributed run.
+ */
+class clique {
+ public:
+  explicit clique(int n_ranks)
+    : n_ranks_(n_ranks),
+      nccl_comms_(n_ranks),
+      ucp_contexts_(n_ranks),
+      ucp_workers_(n_ranks),
+      ucp_eps_(n_ranks, std::vector<size_t>(n_ranks, 0))
+  {
+    std::vector<int> devices(n_ranks);
+    std::iota(devices.begin(), devices.end(), 0);
+    RAFT_NCCL_TRY(ncclCommInitAll(nccl_comms_.data(), n_ranks, devices.data()));
+
+    ucp_config_t* config;
+    RAFT_EXPECTS(ucp_config_read(nullptr, nullptr, &config) == UCS_OK, "ucp_config_read failed");
+    ucp_params_t params;
+    params.field_mask = UCP_PARAM_FIELD_FEATURES;
+    params.features   = UCP_FEATURE_TAG;
+    ucp_worker_params_t worker_params;
+    worker_params.field_mask  = UCP_WORKER_PARAM_FIELD_THREAD_MODE;
+    worker_params.thread_mode = UCS_THREAD_MODE_SERIALIZED;
+    std::vector<ucp_address_t*> addresses(n_ranks);
+    for (int r = 0; r < n_ranks; r++) {
+      RAFT_CUDA_TRY(cudaSetDevice(r));
+      RAFT_EXPECTS(ucp_init(&params, config, &ucp_contexts_[r]) == UCS_OK, "ucp_init failed");
+      RAFT_EXPECTS(
+        ucp_worker_create(ucp_contexts_[r], &worker_params, &ucp_workers_[r]) == UCS_OK,
+        "ucp_worker_create failed");
+      size_t length;
+      RAFT_EXPECTS(ucp_worker_get_address(ucp_workers_[r], &addresses[r], &length) == UCS_OK,
+                   "ucp_worker_get_address failed");
+    }
+    ucp_config_release(config);
+    for (int r = 0; r < n_ranks; r++) {
+      for (int p = 0; p < n_ranks; p++) {
+        if (p == r) { continue; }
+        ucp_ep_params_t ep_params;
+        ep_params.field_mask = UCP_EP_PARAM_FIELD_REMOTE_ADDRESS;
+        ep_params.address    = addresses[p];
+        ucp_ep_h ep;
+        RAFT_EXPECTS(ucp_ep_create(ucp_workers_[r], &ep_params, &ep) == UCS_OK,
+                     "ucp_ep_create failed");
+        ucp_eps_[r][p] = reinterpret_cast<size_t>(ep);
+      }
+    }
+    for (int r = 0; r < n_ranks; r++) {
+      ucp_worker_release_address(ucp_workers_[r], addresses[r]);
+    }
+
+    for (int r = 0; r < n_ranks; r++) {
+      RAFT_CUDA_TRY(cudaSetDevice(r));
+      handles_.emplace_back(std::make_unique<raft::device_resources>());
+      raft::comms::build_comms_nccl_ucx(
+        handles_[r].get(), nccl_comms_[r], ucp_workers_[r], ucp_eps_[r].data(), n_ranks, r);
+    }
+    RAFT_CUDA_TRY(cudaSetDevice(0));
+  }
+
+  ~clique()
+  {
+    for (int r = 0; r < n_ranks_; r++) {
+      RAFT_CUDA_TRY_NO_THROW(cudaSetDevice(r));
+      handles_[r].reset();
+      for (size_t ep : ucp_eps_[r]) {
+        if (ep == 0) { continue; }
+        auto request = ucp_ep_close_nb(reinterpret_cast<ucp_ep_h>(ep), UCP_EP_CLOSE_MODE_FORCE);
+        if (UCS_PTR_IS_PTR(request)) {
+          while (ucp_request_check_status(request) == UCS_INPROGRESS) {
+            ucp_worker_progress(ucp_workers_[r]);
+          }
+          ucp_request_free(request);
+        }
+      }
+      ucp_worker_destroy(ucp_workers_[r]);
+      ucp_cleanup(ucp_contexts_[r]);
+      RAFT_NCCL_TRY_NO_THROW(ncclCommDestroy(nccl_comms_[r]));
+    }
+    RAFT_CUDA_TRY_NO_THROW(cudaSetDevice(0));
+  }
+
+  [[nodiscard]] auto size() const -> int { return n_ranks_; }
+
+  /** Run f(rank, resources of the rank) in one thread per rank, on the device of the rank. */
+  template <typename Func>
+  void run(Func f)
+  {
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(n_ranks_);
+    for (int r = 0; r < n_ranks_; r++) {
+      threads.emplace_back([this, &f, &errors, r]() {
+        try {
+          RAFT_CUDA_TRY(cudaSetDevice(r));
+          f(r, *handles_[r]);
+        } catch (...) {
+          errors[r] = std::current_exception();
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    for (auto& e : errors) {
+      if (e) { std::rethrow_exception(e); }
+    }
+  }
+
+  /**
+   * The clique of n_ranks ranks. Creating the communicators is expensive, so the last clique is
+   * cached between the cases (which are registered with the rank counts outermost).
+   */
+  static auto get(int n_ranks) -> clique&
+  {
+    static std::unique_ptr<clique> cached;
+    if (!cached || cached->size() != n_ranks) {
+      cached.reset();
+      cached = std::make_unique<clique>(n_ranks);
+    }
+    return *cached;
+  }
+
+ private:
+  int n_ranks_;
+  std::vector<ncclComm_t> nccl_comms_;
+  std::vector<ucp_context_h> ucp_contexts_;
+  std::vector<ucp_worker_h> ucp_workers_;
+  std::vector<std::vector<size_t>> ucp_eps_;
+  std::vector<std::unique_ptr<raft::device_resources>> handles_;
+};
+
+struct comms_bench : public fixture {
+  explicit comms_bench(const comms_inputs& p) : params_(p) {}
+
+  void run_benchmark(::benchmark::State& state) override
+  {
+    int n_devices;
+    RAFT_CUDA_TRY(cudaGetDeviceCount(&n_devices));
+    if (params_.n_ranks > n_devices) {
+      state.SkipWithError("not enough devices for the number of ranks");
+      return;
+    }
+    state.SetLabel(to_string(params_.op) + "/" + std::to_string(params_.n_ranks) + " ranks/" +
+                   std::to_string(params_.bytes) + " bytes");
+    auto& ranks = clique::get(params_.n_ranks);
+    std::vector<double> seconds(params_.n_ranks);
+    for (auto _ : state) {
+      ranks.run([this, &seconds](int rank, raft::resources const& res) {
+        seconds[rank] = run_rank(rank, res);
+      });
+      // the operations complete when the slowest rank does
+      state.SetIterationTime(*std::max_element(seconds.begin(), seconds.end()) / kOpsPerIteration);
+    }
+
+    double algbw = params_.bytes;
+    state.counters["algbw"] = ::benchmark::Counter(
+      algbw, ::benchmark::Counter::kIsIterationInvariantRate, ::benchmark::Counter::OneK::kIs1000);
+    state.counters["busbw"] =
+      ::benchmark::Counter(algbw * bus_bandwidth_factor(params_.op, params_.n_ranks),
+                           ::benchmark::Counter::kIsIterationInvariantRate,
+                           ::benchmark::Counter::OneK::kIs1000);
+  }
+
+ private:
+  /** The operations are timed by batches, so that the time of a synchronization is amortized. */
+  static constexpr int kOpsPerIteration = 20;
+
+  /** Issue a batch of operations from the thread of a rank, return the wall time of the batch. */
+  auto run_rank(int rank, raft::resources const& res) -> double
+  {
+    const auto& comm = resource::get_comms(res);
+    auto stream      = resource::get_cuda_stream(res);
+    int n            = params_.n_ranks;
+    size_t count     = params_.bytes / sizeof(float);
+    size_t share     = count / n;
+    int next         = (rank + 1) % n;
+    int prev         = (rank + n - 1) % n;
+    rmm::device_uvector<float> send(count, stream);
+    rmm::device_uvector<float> recv(count, stream);
+    RAFT_CUDA_TRY(cudaMemsetAsync(send.data(), 0, send.size() * sizeof(float), stream));
+
+    std::vector<size_t> counts(n, share);
+    std::vector<size_t> offsets(n);
+    std::vector<int> peers(n);
+    for (int r = 0; r < n; r++) {
+      offsets[r] = r * share;
+      peers[r]   = r;
+    }
+    std::vector<raft::comms::request_t> requests(2);
+
+    auto op = [&]() {
+      switch (params_.op) {
+        case comms_op::ALLREDUCE:
+          comm.allreduce(send.data(), recv.data(), count, raft::comms::op_t::SUM, stream);
+          break;
+        case comms_op::BCAST: comm.bcast(send.data(), count, 0, stream); break;
+        case comms_op::REDUCE:
+          comm.reduce(send.data(), recv.data(), count, raft::comms::op_t::SUM, 0, stream);
+          break;
+        case comms_op::ALLGATHER:
+          comm.allgather(send.data() + offsets[rank], recv.data(), share, stream);
+          break;
+        case comms_op::ALLGATHERV:
+          comm.allgatherv(
+            send.data() + offsets[rank], recv.data(), counts.data(), offsets.data(), stream);
+          break;
+        case comms_op::GATHER:
+          comm.gather(send.data() + offsets[rank], recv.data(), share, 0, stream);
+          break;
+        case comms_op::GATHERV:
+          comm.gatherv(send.data() + offsets[rank],
+                       recv.data(),
+                       share,
+                       counts.data(),
+                       offsets.data(),
+                       0,
+                       stream);
+          break;
+        case comms_op::REDUCESCATTER:
+          comm.reducescatter(send.data(), recv.data(), share, raft::comms::op_t::SUM, stream);
+          break;
+        case comms_op::DEVICE_SENDRECV:
+          comm.device_sendrecv(send.data(), count, next, recv.data(), count, prev, stream);
+          break;
+        case comms_op::DEVICE_MULTICAST_SENDRECV:
+          comm.device_multicast_sendrecv(
+            send.data(), counts, offsets, peers, recv.data(), counts, offsets, peers, stream);
+          break;
+        case comms_op::ISEND_IRECV:
+          comm.irecv(recv.data(), count, prev, 0, &requests[0]);
+          comm.isend(send.data(), count, next, 0, &requests[1]);
+          comm.waitall(requests.size(), requests.data());
+          break;
+      }
+    };
+
+    // warm up (and connect the peers), then time a batch between two synchronizations
+    op();
+    RAFT_EXPECTS(comm.sync_stream(stream) == raft::comms::status_t::SUCCESS,
+                 "comms_bench: the warm-up failed");
+    comm.barrier();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kOpsPerIteration; i++) {
+      op();
+    }
+    RAFT_EXPECTS(comm.sync_stream(stream) == raft::comms::status_t::SUCCESS,
+                 "comms_bench: the operations failed");
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+  }
+
+  comms_inputs params_;
+};  // struct comms_bench
+
+/** The cases: rank counts outermost (see clique::get), then the operations and the sizes. */
+inline auto make_comms_inputs() -> std::vector<comms_inputs>
+{
+  std::vector<comms_inputs> inputs;
+  for (int n_ranks : {2, 4, 8}) {
+    for (auto op : {comms_op::ALLREDUCE,
+                    comms_op::BCAST,
+                    comms_op::REDUCE,
+                    comms_op::ALLGATHER,
+                    comms_op::ALLGATHERV,
+                    comms_op::GATHER,
+                    comms_op::GATHERV,
+                    comms_op::REDUCESCATTER,
+                    comms_op::DEVICE_SENDRECV,
+                    comms_op::DEVICE_MULTICAST_SENDRECV,
+                    comms_op::ISEND_IRECV}) {
+      for (size_t bytes = size_t{1} << 10; bytes <= size_t{1} << 30; bytes <<= 2) {
+        inputs.push_back({n_ranks, op, bytes});
+      }
+    }
+  }
+  return inputs;
+}
+
+RAFT_BENCH_REGISTER(comms_bench, "", make_comms_inputs());
+
+}  // namespace raft::bench::comms
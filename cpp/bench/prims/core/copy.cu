@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -365,6 +365,56 @@ using copy_bench_host_device_3d_diff_dtype_same_layout        = CopyBench<float,
                                                                    memory_type::device,
                                                                    3>;
 
+// Padded rows (copied with cudaMemcpy2DAsync)
+using copy_bench_device_device_2d_padded_to_compact = CopyBench<float,
+                                                                float,
+                                                                int,
+                                                                layout_right_padded<float>,
+                                                                layout_c_contiguous,
+                                                                memory_type::device,
+                                                                memory_type::device,
+                                                                2>;
+using copy_bench_device_device_2d_compact_to_padded = CopyBench<float,
+                                                                float,
+                                                                int,
+                                                                layout_c_contiguous,
+                                                                layout_right_padded<float>,
+                                                                memory_type::device,
+                                                                memory_type::device,
+                                                                2>;
+using copy_bench_host_device_2d_padded_to_compact   = CopyBench<float,
+                                                                float,
+                                                                int,
+                                                                layout_right_padded<float>,
+                                                                layout_c_contiguous,
+                                                                memory_type::host,
+                                                                memory_type::device,
+                                                                2>;
+using copy_bench_host_device_2d_compact_to_padded   = CopyBench<float,
+                                                                float,
+                                                                int,
+                                                                layout_c_contiguous,
+                                                                layout_right_padded<float>,
+                                                                memory_type::host,
+                                                                memory_type::device,
+                                                                2>;
+using copy_bench_device_host_2d_padded_to_compact   = CopyBench<float,
+                                                                float,
+                                                                int,
+                                                                layout_right_padded<float>,
+                                                                layout_c_contiguous,
+                                                                memory_type::device,
+                                                                memory_type::host,
+                                                                2>;
+using copy_bench_device_host_2d_compact_to_padded   = CopyBench<float,
+                                                                float,
+                                                                int,
+                                                                layout_c_contiguous,
+                                                                layout_right_padded<float>,
+                                                                memory_type::device,
+                                                                memory_type::host,
+                                                                2>;
+
 // COPY_REGISTER(copy_bench_same_dtype_1d_host_host);
 COPY_REGISTER(copy_bench_device_device_1d_same_dtype_same_layout);
 COPY_REGISTER(copy_bench_device_device_1d_same_dtype_diff_layout);
@@ -398,4 +448,11 @@ COPY_REGISTER(copy_bench_host_device_2d_same_dtype_diff_layout_cublas);
 COPY_REGISTER(copy_bench_host_device_3d_diff_dtype_same_layout);
 COPY_REGISTER(copy_bench_host_device_3d_diff_dtype_diff_layout);
 
+COPY_REGISTER(copy_bench_device_device_2d_padded_to_compact);
+COPY_REGISTER(copy_bench_device_device_2d_compact_to_padded);
+COPY_REGISTER(copy_bench_host_device_2d_padded_to_compact);
+COPY_REGISTER(copy_bench_host_device_2d_compact_to_padded);
+COPY_REGISTER(copy_bench_device_host_2d_padded_to_compact);
+COPY_REGISTER(copy_bench_device_host_2d_compact_to_padded);
+
 }  // namespace raft::bench::core
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -59,6 +59,13 @@ struct distance : public fixture {
     });
   }
 
+  void generate_metrics(::benchmark::State& state) override
+  {
+    // the GEMM-like core of the pairwise distances: one FMA per (row of x, row of y, feature)
+    double flops = 2.0 * params.m * params.n * params.k;
+    report_roofline<T>(state, (x.size() + y.size() + out.size()) * sizeof(T), flops);
+  }
+
  private:
   distance_params params;
   rmm::device_uvector<T> x, y, out;
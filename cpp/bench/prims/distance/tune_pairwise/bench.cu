@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -35,8 +35,8 @@
 // recompiled.
 //
 // RE 2, benchmarks with intent: this file contains a benchmark to check the
-// maximal throughput of a kernel. Measuring other things, like performance on
-// skinny or wide matrices is not yet implemented.
+// maximal throughput of a kernel, and one to check the throughput of the
+// CUTLASS-based (tensor core) kernel for a few shapes in both layouts.
 
 #include "kernel.cuh"                                       // launch_kernel
 #include <algorithm>                                        // std::min
@@ -121,10 +121,8 @@ struct throughput_bench : public fixture {
     // Run benchmark
     loop_on_state(state, [&]() { launch_kernel(kparams, grid, stream); });
 
-    // Report metrics. We don't report flop/s because we do not know for each
-    // distance operation how many flops it costs. For L2_unexp and l1, we can
-    // double this number to get the flop/s. For l2 expanded, core_ops/s should
-    // equal flop/s (modulo the sqrt and subtracting from the norm).
+    // Report metrics. The flops per core op are given by the tuned distance
+    // operation (see kernel.cu).
     size_t num_core_ops = m * n * k;
     size_t read_elts    = n * k + m * k;
     size_t write_elts   = m * n;
@@ -140,6 +138,10 @@ struct throughput_bench : public fixture {
                                                       benchmark::Counter::kIsIterationInvariantRate,
                                                       benchmark::Counter::OneK::kIs1000);
 
+    state.counters["flop/s"] = benchmark::Counter(num_core_ops * get_flops_per_core_op(),
+                                                  benchmark::Counter::kIsIterationInvariantRate,
+                                                  benchmark::Counter::OneK::kIs1000);
+
     state.counters["BW"] = benchmark::Counter(write_elts * sizeof(OutT) + read_elts * sizeof(DataT),
                                               benchmark::Counter::kIsIterationInvariantRate,
                                               benchmark::Counter::OneK::kIs1000);
@@ -148,4 +150,91 @@ struct throughput_bench : public fixture {
 
 RAFT_BENCH_REGISTER(throughput_bench, "", throughput_params);
 
+// Tensor core throughput benchmark.
+//
+// Goal: Measure the flop/s of the CUTLASS-based kernel (expanded L2 distance)
+// for a given shape and layout. Only runs on SM80 and later.
+struct cutlass_param {
+  size_t m;
+  size_t n;
+  size_t k;
+  bool row_major;
+};
+
+const std::vector<cutlass_param> cutlass_params{
+  {4096, 4096, 64, true},
+  {4096, 4096, 64, false},
+  {4096, 4096, 512, true},
+  {4096, 4096, 512, false},
+  {16384, 16384, 128, true},
+  {16384, 16384, 128, false},
+  {1024, 65536, 1024, true},
+  {1024, 65536, 1024, false},
+};
+
+struct cutlass_throughput_bench : public fixture {
+  const cutlass_param p;
+
+  cutlass_throughput_bench(const cutlass_param& p_) : p(p_) {}
+
+  void run_benchmark(::benchmark::State& state) override
+  {
+    int dev, cc_major;
+    RAFT_CUDA_TRY(cudaGetDevice(&dev));
+    RAFT_CUDA_TRY(cudaDeviceGetAttribute(&cc_major, cudaDevAttrComputeCapabilityMajor, dev));
+    if (cc_major < 8) {
+      state.SkipWithError("The CUTLASS-based kernel requires SM80 or later");
+      return;
+    }
+    const size_t m = p.m, n = p.n, k = p.k;
+
+    rmm::device_uvector<DataT> x_vec(m * k, stream);
+    rmm::device_uvector<DataT> y_vec(n * k, stream);
+    rmm::device_uvector<DataT> x_norm_vec(m, stream);
+    rmm::device_uvector<DataT> y_norm_vec(n, stream);
+    rmm::device_uvector<OutT> out_vec(m * n, stream);
+    FinOpT fin_op{};
+
+    IdxT ldx    = p.row_major ? k : m;
+    IdxT ldy    = p.row_major ? k : n;
+    IdxT ld_out = p.row_major ? n : m;
+
+    pairwise_matrix_params kparams{IdxT(m),
+                                   IdxT(n),
+                                   IdxT(k),
+                                   ldx,
+                                   ldy,
+                                   ld_out,
+                                   x_vec.data(),
+                                   y_vec.data(),
+                                   x_norm_vec.data(),
+                                   y_norm_vec.data(),
+                                   out_vec.data(),
+                                   fin_op,
+                                   p.row_major};
+    if (!kparams.is_row_major) { kparams.flip_x_and_y(); }
+
+    loop_on_state(state, [&]() { launch_cutlass_kernel(kparams, stream); });
+
+    size_t read_elts  = n * k + m * k;
+    size_t write_elts = m * n;
+
+    state.counters["m"]         = benchmark::Counter(m);
+    state.counters["n"]         = benchmark::Counter(n);
+    state.counters["k"]         = benchmark::Counter(k);
+    state.counters["row_major"] = benchmark::Counter(p.row_major);
+
+    // One multiply-add per element of the GEMM; the epilogue is not counted.
+    state.counters["flop/s"] = benchmark::Counter(2.0 * m * n * k,
+                                                  benchmark::Counter::kIsIterationInvariantRate,
+                                                  benchmark::Counter::OneK::kIs1000);
+
+    state.counters["BW"] = benchmark::Counter(write_elts * sizeof(OutT) + read_elts * sizeof(DataT),
+                                              benchmark::Counter::kIsIterationInvariantRate,
+                                              benchmark::Counter::OneK::kIs1000);
+  }
+};
+
+RAFT_BENCH_REGISTER(cutlass_throughput_bench, "", cutlass_params);
+
 }  // namespace raft::bench::distance::tune
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -73,6 +73,9 @@ void* get_kernel_ptr()
   return reinterpret_cast<void*>(kernel);
 }
 
+// |x - y|, its power and the accumulation
+double get_flops_per_core_op() { return 3.0; }
+
 int get_max_occupancy()
 {
   void* kernel_ptr = get_kernel_ptr();
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -41,4 +41,11 @@ void get_block_size(int& m, int& n, int& k);
 
 int get_max_occupancy();
 
+// The number of flops of one call to the core function of the tuned distance op
+double get_flops_per_core_op();
+
+// Launches the CUTLASS-based (SM80+) kernel of the expanded L2 distance. The layout is given by
+// params.is_row_major.
+void launch_cutlass_kernel(pairwise_matrix_params, cudaStream_t);
+
 }  // namespace raft::bench::distance::tune
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kernel.cuh"
+
+#include <raft/distance/detail/distance_ops/l2_exp.cuh>           // l2_exp_distance_op
+#include <raft/distance/detail/pairwise_matrix/dispatch_sm80.cuh>  // pairwise_matrix_sm80_dispatch
+#include <raft/util/arch.cuh>                                      // raft::util::arch::SM_range
+
+namespace raft::bench::distance::tune {
+
+// The CUTLASS (tensor core) kernel is benchmarked with the expanded L2 distance, which is a GEMM
+// with a fused epilogue.
+void launch_cutlass_kernel(pairwise_matrix_params params, cudaStream_t stream)
+{
+  raft::distance::detail::ops::l2_exp_distance_op<DataT, AccT, IdxT> distance_op{false};
+  namespace arch       = raft::util::arch;
+  auto sm_compat_range = arch::SM_range(arch::SM_80(), arch::SM_future());
+  raft::distance::detail::pairwise_matrix_sm80_dispatch(
+    distance_op, params, sm_compat_range, stream);
+}
+
+}  // namespace raft::bench::distance::tune
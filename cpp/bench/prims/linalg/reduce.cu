@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -41,6 +41,13 @@ struct reduce : public fixture {
     });
   }
 
+  void generate_metrics(::benchmark::State& state) override
+  {
+    // one addition per input element; the input is read once, the output written once
+    report_roofline<T>(
+      state, (in.size() + out.size()) * sizeof(T), static_cast<double>(in.size()));
+  }
+
  private:
   bool along_rows;
   input_size input_size;
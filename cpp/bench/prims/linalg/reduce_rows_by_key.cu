@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,11 +20,16 @@
 
 #include <rmm/device_uvector.hpp>
 
+#include <thrust/execution_policy.h>
+#include <thrust/sort.h>
+
 namespace raft::bench::linalg {
 
 struct rrbk_params {
   int64_t rows, cols;
   int64_t keys;
+  // Whether the rows are ordered by key (e.g. the records of the IVF lists)
+  bool sorted_keys;
 };
 
 template <typename T, typename KeyT>
@@ -38,6 +43,9 @@ struct reduce_rows_by_key : public fixture {
   {
     raft::random::RngState rng{42};
     raft::random::uniformInt(handle, rng, keys.data(), p.rows, (KeyT)0, (KeyT)p.keys);
+    if (p.sorted_keys) {
+      thrust::sort(thrust::cuda::par.on(stream), keys.data(), keys.data() + p.rows);
+    }
   }
 
   void run_benchmark(::benchmark::State& state) override
@@ -64,22 +72,33 @@ struct reduce_rows_by_key : public fixture {
 };  // struct reduce_rows_by_key
 
 const std::vector<rrbk_params> kInputSizes{
-  {10000, 128, 64},
-  {100000, 128, 64},
-  {1000000, 128, 64},
-  {10000000, 128, 64},
-  {10000, 128, 256},
-  {100000, 128, 256},
-  {1000000, 128, 256},
-  {10000000, 128, 256},
-  {10000, 128, 1024},
-  {100000, 128, 1024},
-  {1000000, 128, 1024},
-  {10000000, 128, 1024},
-  {10000, 128, 4096},
-  {100000, 128, 4096},
-  {1000000, 128, 4096},
-  {10000000, 128, 4096},
+  {10000, 128, 64, false},
+  {100000, 128, 64, false},
+  {1000000, 128, 64, false},
+  {10000000, 128, 64, false},
+  {10000, 128, 256, false},
+  {100000, 128, 256, false},
+  {1000000, 128, 256, false},
+  {10000000, 128, 256, false},
+  {10000, 128, 1024, false},
+  {100000, 128, 1024, false},
+  {1000000, 128, 1024, false},
+  {10000000, 128, 1024, false},
+  {10000, 128, 4096, false},
+  {100000, 128, 4096, false},
+  {1000000, 128, 4096, false},
+  {10000000, 128, 4096, false},
+  // Few keys and columns: the sums are privatized in shared memory
+  {1000000, 16, 64, false},
+  {1000000, 16, 512, false},
+  {10000000, 16, 512, false},
+  // Many keys (e.g. the centers of the IVF lists), in random order or sorted
+  {1000000, 128, 16384, false},
+  {1000000, 128, 16384, true},
+  {1000000, 128, 131072, false},
+  {1000000, 128, 131072, true},
+  {10000000, 128, 131072, false},
+  {10000000, 128, 131072, true},
 };
 
 RAFT_BENCH_REGISTER((reduce_rows_by_key<float, uint32_t>), "", kInputSizes);
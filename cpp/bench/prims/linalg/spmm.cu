@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <common/benchmark.hpp>
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_resources.hpp>
+#include <raft/sparse/linalg/spmm.hpp>
+#include <raft/util/itertools.hpp>
+
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+
+#include <cuda_fp16.h>
+
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace raft::bench::linalg {
+
+struct SpmmBenchParams {
+  int m;
+  int k;
+  int n;
+  int batch_count;
+  float density;
+};
+
+/** A batch of products with a shared sparse matrix: one strided-batch call, or one call each. */
+enum SpmmAlg { Batched, Looped };
+
+inline auto operator<<(std::ostream& os, const SpmmBenchParams& params) -> std::ostream&
+{
+  os << " m*k*n=" << params.m << "*" << params.k << "*" << params.n
+     << "\tbatch=" << params.batch_count << "\tdensity=" << params.density;
+  return os;
+}
+
+template <typename ValueType, SpmmAlg Alg>
+struct SpmmBench : public fixture {
+  SpmmBench(const SpmmBenchParams& p)
+    : fixture(true),
+      params(p),
+      handle(stream),
+      x_indptr_d(0, stream),
+      x_indices_d(0, stream),
+      x_data_d(0, stream),
+      y_data_d(0, stream),
+      z_data_d(0, stream)
+  {
+    std::mt19937 gen(2024);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    std::bernoulli_distribution coin(params.density);
+
+    std::vector<int> indptr(params.m + 1, 0);
+    std::vector<int> indices;
+    for (int i = 0; i < params.m; i++) {
+      for (int j = 0; j < params.k; j++) {
+        if (coin(gen)) { indices.push_back(j); }
+      }
+      indptr[i + 1] = indices.size();
+    }
+    nnz = indices.size();
+
+    std::vector<ValueType> values(nnz);
+    for (auto& v : values) {
+      v = ValueType(dis(gen));
+    }
+    std::vector<ValueType> y(size_t(params.k) * params.n * params.batch_count);
+    for (auto& v : y) {
+      v = ValueType(dis(gen));
+    }
+
+    x_indptr_d.resize(indptr.size(), stream);
+    x_indices_d.resize(nnz, stream);
+    x_data_d.resize(nnz, stream);
+    y_data_d.resize(y.size(), stream);
+    z_data_d.resize(size_t(params.m) * params.n * params.batch_count, stream);
+
+    update_device(x_indptr_d.data(), indptr.data(), indptr.size(), stream);
+    update_device(x_indices_d.data(), indices.data(), nnz, stream);
+    update_device(x_data_d.data(), values.data(), nnz, stream);
+    update_device(y_data_d.data(), y.data(), y.size(), stream);
+  }
+
+  void run_benchmark(::benchmark::State& state) override
+  {
+    std::ostringstream label_stream;
+    label_stream << params;
+    state.SetLabel(label_stream.str());
+
+    auto structure = raft::make_device_compressed_structure_view<int, int, int>(
+      x_indptr_d.data(), x_indices_d.data(), params.m, params.k, nnz);
+    auto x = raft::make_device_csr_matrix_view<const ValueType, int, int, int>(x_data_d.data(),
+                                                                                structure);
+    size_t y_size = size_t(params.k) * params.n;
+    size_t z_size = size_t(params.m) * params.n;
+
+    loop_on_state(state, [this, &x, y_size, z_size]() {
+      float alpha = 1.0f;
+      float beta  = 0.0f;
+      if constexpr (Alg == SpmmAlg::Batched) {
+        auto y = raft::make_device_matrix_view<const ValueType, int, row_major>(
+          y_data_d.data(), params.k, params.n);
+        auto z = raft::make_device_matrix_view<ValueType, int, row_major>(
+          z_data_d.data(), params.m, params.n);
+        raft::sparse::linalg::spmm_batched(
+          handle, false, false, &alpha, x, y, &beta, z, params.batch_count);
+      } else {
+        for (int b = 0; b < params.batch_count; b++) {
+          auto y = raft::make_device_matrix_view<const ValueType, int, row_major>(
+            y_data_d.data() + b * y_size, params.k, params.n);
+          auto z = raft::make_device_matrix_view<ValueType, int, row_major>(
+            z_data_d.data() + b * z_size, params.m, params.n);
+          raft::sparse::linalg::spmm(handle, false, false, &alpha, x, y, &beta, z);
+        }
+      }
+      resource::sync_stream(handle);
+    });
+  }
+
+ private:
+  const raft::device_resources handle;
+  SpmmBenchParams params;
+
+  size_t nnz = 0;
+  rmm::device_uvector<int> x_indptr_d;
+  rmm::device_uvector<int> x_indices_d;
+  rmm::device_uvector<ValueType> x_data_d;
+  rmm::device_uvector<ValueType> y_data_d;
+  rmm::device_uvector<ValueType> z_data_d;
+};
+
+static std::vector<SpmmBenchParams> getInputs()
+{
+  return raft::util::itertools::product<SpmmBenchParams>(
+    {1024, 16 * 1024}, {1024, 16 * 1024}, {16, 128}, {1, 8, 64}, {0.001f, 0.01f});
+}
+
+RAFT_BENCH_REGISTER((SpmmBench<float, SpmmAlg::Batched>), "", getInputs());
+RAFT_BENCH_REGISTER((SpmmBench<float, SpmmAlg::Looped>), "", getInputs());
+RAFT_BENCH_REGISTER((SpmmBench<half, SpmmAlg::Batched>), "", getInputs());
+RAFT_BENCH_REGISTER((SpmmBench<half, SpmmAlg::Looped>), "", getInputs());
+
+}  // namespace raft::bench::linalg
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <common/benchmark.hpp>
+#include <raft/linalg/transpose.cuh>
+#include <raft/random/rng.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+namespace raft::bench::linalg {
+
+struct transpose_inputs {
+  int batch_size, rows, cols;
+};
+
+inline auto operator<<(std::ostream& os, const transpose_inputs& p) -> std::ostream&
+{
+  os << p.batch_size << "#" << p.rows << "#" << p.cols;
+  return os;
+}
+
+enum class transpose_algo {
+  /** One out-of-place cuBLAS geam per matrix. */
+  kGeam,
+  /** The out-of-place tiled kernel, one launch for the whole batch. */
+  kTiled,
+  /** The in-place transpose, one per matrix. */
+  kInPlace
+};
+
+template <typename T, transpose_algo Algo>
+struct transpose : public fixture {
+  transpose(const transpose_inputs& p)
+    : params(p),
+      in(size_t(p.batch_size) * p.rows * p.cols, stream),
+      out(Algo == transpose_algo::kInPlace ? 0 : in.size(), stream)
+  {
+    raft::random::RngState rng{1234};
+    raft::random::uniform(handle, rng, in.data(), in.size(), T(-1.0), T(1.0));
+  }
+
+  void run_benchmark(::benchmark::State& state) override
+  {
+    std::ostringstream label_stream;
+    label_stream << params;
+    state.SetLabel(label_stream.str());
+
+    size_t mat_size = size_t(params.rows) * params.cols;
+    loop_on_state(state, [this, mat_size]() {
+      if constexpr (Algo == transpose_algo::kTiled) {
+        raft::linalg::batched_transpose(
+          handle,
+          raft::make_mdspan<const T, int, raft::row_major, false, true>(
+            in.data(), raft::make_extents<int>(params.batch_size, params.rows, params.cols)),
+          raft::make_mdspan<T, int, raft::row_major, false, true>(
+            out.data(), raft::make_extents<int>(params.batch_size, params.cols, params.rows)));
+      } else {
+        for (int b = 0; b < params.batch_size; b++) {
+          auto in_view = raft::make_device_matrix_view<T, int, raft::row_major>(
+            in.data() + b * mat_size, params.rows, params.cols);
+          if constexpr (Algo == transpose_algo::kGeam) {
+            raft::linalg::transpose(
+              handle,
+              in_view,
+              raft::make_device_matrix_view<T, int, raft::row_major>(
+                out.data() + b * mat_size, params.cols, params.rows));
+          } else {
+            // every other iteration transposes the matrices back
+            raft::linalg::transpose_inplace(
+              handle,
+              raft::make_device_matrix_view<T, int, raft::row_major>(
+                in.data() + b * mat_size, in_place_rows(), in_place_cols()));
+          }
+        }
+        if constexpr (Algo == transpose_algo::kInPlace) { transposed = !transposed; }
+      }
+    });
+  }
+
+ private:
+  [[nodiscard]] auto in_place_rows() const -> int { return transposed ? params.cols : params.rows; }
+  [[nodiscard]] auto in_place_cols() const -> int { return transposed ? params.rows : params.cols; }
+
+  transpose_inputs params;
+  rmm::device_uvector<T> in, out;
+  bool transposed = false;
+};  // struct transpose
+
+const std::vector<transpose_inputs> transpose_inputs_single{{1, 4096, 4096},
+                                                            {1, 1000000, 96},
+                                                            {1, 1000000, 128},
+                                                            {1, 100000, 1000}};
+const std::vector<transpose_inputs> transpose_inputs_batched{
+  {10000, 32, 32}, {1000, 96, 128}, {100, 1000, 64}};
+
+RAFT_BENCH_REGISTER((transpose<float, transpose_algo::kGeam>), "", transpose_inputs_single);
+RAFT_BENCH_REGISTER((transpose<float, transpose_algo::kTiled>), "", transpose_inputs_single);
+RAFT_BENCH_REGISTER((transpose<float, transpose_algo::kInPlace>), "", transpose_inputs_single);
+RAFT_BENCH_REGISTER((transpose<float, transpose_algo::kGeam>), "", transpose_inputs_batched);
+RAFT_BENCH_REGISTER((transpose<float, transpose_algo::kTiled>), "", transpose_inputs_batched);
+RAFT_BENCH_REGISTER((transpose<double, transpose_algo::kTiled>), "", transpose_inputs_batched);
+
+}  // namespace raft::bench::linalg
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -14,6 +14,14 @@
  * limitations under the License.
  */
 
+#include <common/baseline.hpp>
+
 #include <benchmark/benchmark.h>  // NOLINT
 
-BENCHMARK_MAIN();
+int main(int argc, char** argv)
+{
+  auto baseline = raft::bench::baseline_options::parse(&argc, argv);
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  return raft::bench::run_benchmarks(baseline);
+}
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -14,15 +14,29 @@
  * limitations under the License.
  */
 
+#include <common/baseline.hpp>
+
 #include <benchmark/benchmark.h>
+
 #include <cstring>
+#include <string>
 
 namespace raft::matrix {
 void add_select_k_dataset_benchmarks();
-}
+void run_select_k_autotune(const std::string& path);
+}  // namespace raft::matrix
 
 int main(int argc, char** argv)
 {
+  // if we're passed a 'select_k_autotune=<file>' flag, only tune select_k for the current device
+  constexpr const char* kAutotuneFlag = "--select_k_autotune=";
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], kAutotuneFlag, strlen(kAutotuneFlag)) == 0) {
+      raft::matrix::run_select_k_autotune(argv[i] + strlen(kAutotuneFlag));
+      return 0;
+    }
+  }
+
   // if we're passed a 'select_k_dataset' flag, add in extra benchmarks
   for (int i = 1; i < argc; ++i) {
     if (strcmp(argv[i], "--select_k_dataset") == 0) {
@@ -35,7 +49,8 @@ int main(int argc, char** argv)
       break;
     }
   }
+  auto baseline = raft::bench::baseline_options::parse(&argc, argv);
   benchmark::Initialize(&argc, argv);
   if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
-  benchmark::RunSpecifiedBenchmarks();
+  return raft::bench::run_benchmarks(baseline);
 }
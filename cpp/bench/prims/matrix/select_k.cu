@@ -27,12 +27,17 @@
 #include <raft/matrix/detail/select_radix.cuh>
 #include <raft/matrix/detail/select_warpsort.cuh>
 #include <raft/matrix/select_k.cuh>
+#include <raft/matrix/select_k_tuning.hpp>
 
 #include <rmm/device_uvector.hpp>
 #include <rmm/mr/device/per_device_resource.hpp>
 
 #include <cstdint>
 #include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
 #include <type_traits>
 
 namespace raft::matrix {
@@ -343,4 +348,119 @@ void add_select_k_dataset_benchmarks()
     SELECTION_REGISTER_INPUT(float, uint32_t, input);
   }
 }
+
+/**
+ * Measure all the select-k algorithms on the current device over a grid of (batch_size, len, k),
+ * and store the fastest one of every grid point in the tuning file `path`.
+ *
+ * The tables of the other devices already in the file are kept, the table of a device like the
+ * current one is replaced. The measurements use float keys and uint32_t indices.
+ */
+void run_select_k_autotune(const std::string& path)
+{
+  using KeyT = float;
+  using IdxT = uint32_t;
+
+  int dev;
+  cudaDeviceProp prop;
+  RAFT_CUDA_TRY(cudaGetDevice(&dev));
+  RAFT_CUDA_TRY(cudaGetDeviceProperties(&prop, dev));
+
+  select_k_tuning_table table;
+  table.device_name = prop.name;
+  table.cc_major    = prop.major;
+  table.cc_minor    = prop.minor;
+  table.sm_count    = prop.multiProcessorCount;
+  table.batch_size  = {0, 2, 7};   // 1 .. 4096
+  table.len         = {8, 2, 9};   // 256 .. 16M
+  table.k           = {0, 1, 12};  // 1 .. 2048
+  table.algos.resize(size_t(table.batch_size.count) * table.len.count * table.k.count,
+                     SelectAlgo::kAuto);
+
+  // the inputs of all the grid points are views of the same random buffer
+  constexpr size_t kMaxElements = size_t{1} << 28;
+  raft::device_resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+  rmm::device_uvector<KeyT> in_dists(kMaxElements, stream);
+  rmm::device_uvector<KeyT> out_dists(table.batch_size.value_at(table.batch_size.count - 1) *
+                                        table.k.value_at(table.k.count - 1),
+                                      stream);
+  rmm::device_uvector<IdxT> out_ids(out_dists.size(), stream);
+  raft::random::RngState state{42};
+  raft::random::uniform(handle, state, in_dists.data(), in_dists.size(), KeyT(-1), KeyT(1));
+
+  const SelectAlgo candidates[] = {SelectAlgo::kRadix8bits,
+                                   SelectAlgo::kRadix11bits,
+                                   SelectAlgo::kRadix11bitsExtraPass,
+                                   SelectAlgo::kWarpImmediate,
+                                   SelectAlgo::kWarpFiltered,
+                                   SelectAlgo::kWarpDistributed,
+                                   SelectAlgo::kWarpDistributedShm};
+  constexpr int kRepeats = 5;
+  cudaEvent_t start, stop;
+  RAFT_CUDA_TRY(cudaEventCreate(&start));
+  RAFT_CUDA_TRY(cudaEventCreate(&stop));
+
+  for (int ib = 0; ib < table.batch_size.count; ib++) {
+    for (int il = 0; il < table.len.count; il++) {
+      for (int ik = 0; ik < table.k.count; ik++) {
+        const size_t batch_size = table.batch_size.value_at(ib);
+        const size_t len        = table.len.value_at(il);
+        const int k             = table.k.value_at(ik);
+        if (size_t(k) > len || batch_size * len > kMaxElements) { continue; }
+
+        auto in_view =
+          make_device_matrix_view<const KeyT, int64_t>(in_dists.data(), batch_size, len);
+        auto val_view = make_device_matrix_view<KeyT, int64_t>(out_dists.data(), batch_size, k);
+        auto idx_view = make_device_matrix_view<IdxT, int64_t>(out_ids.data(), batch_size, k);
+
+        float best_time = std::numeric_limits<float>::max();
+        auto& best_algo = table.algos[(size_t(ib) * table.len.count + il) * table.k.count + ik];
+        for (auto algo : candidates) {
+          if (algo >= SelectAlgo::kWarpAuto &&
+              k > raft::matrix::detail::select::warpsort::kMaxCapacity) {
+            continue;
+          }
+          try {
+            // warm-up, then the timed runs
+            matrix::select_k<KeyT, IdxT>(
+              handle, in_view, std::nullopt, val_view, idx_view, true, false, algo);
+            RAFT_CUDA_TRY(cudaEventRecord(start, stream));
+            for (int r = 0; r < kRepeats; r++) {
+              matrix::select_k<KeyT, IdxT>(
+                handle, in_view, std::nullopt, val_view, idx_view, true, false, algo);
+            }
+            RAFT_CUDA_TRY(cudaEventRecord(stop, stream));
+            RAFT_CUDA_TRY(cudaEventSynchronize(stop));
+          } catch (raft::exception& e) {
+            continue;
+          }
+          float time_ms = 0;
+          RAFT_CUDA_TRY(cudaEventElapsedTime(&time_ms, start, stop));
+          if (time_ms < best_time) {
+            best_time = time_ms;
+            best_algo = algo;
+          }
+        }
+        std::cout << batch_size << "#" << len << "#" << k << ": " << best_algo << " ("
+                  << best_time / kRepeats << " ms)" << std::endl;
+      }
+    }
+  }
+  RAFT_CUDA_TRY(cudaEventDestroy(start));
+  RAFT_CUDA_TRY(cudaEventDestroy(stop));
+
+  // keep the tables of the other devices
+  std::stringstream others;
+  if (std::ifstream is(path); is) {
+    while ((is >> std::ws).peek() != std::char_traits<char>::eof()) {
+      auto other = select_k_tuning_table::load(is);
+      if (!other.matches(prop)) { other.save(others); }
+    }
+  }
+  std::ofstream os(path);
+  RAFT_EXPECTS(os, "Cannot write the select_k tuning file '%s'", path.c_str());
+  os << others.str();
+  table.save(os);
+}
 }  // namespace raft::matrix
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+/*
+ * The benchmarks of the individual stages of the index builds (the graph optimization of CAGRA,
+ * the nn-descent iterations, the IVF-PQ codebook training and encoding), so that the build-time
+ * optimizations can be measured in isolation from the end-to-end build.
+ */
+
+#include <common/benchmark.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/neighbors/cagra.cuh>
+#include <raft/neighbors/ivf_pq.cuh>
+#include <raft/neighbors/nn_descent.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/itertools.hpp>
+
+#include <optional>
+
+namespace raft::bench::neighbors {
+
+/** Fill a device buffer with the uniformly distributed random values. */
+template <typename T, typename IdxT>
+void fill_random(raft::resources const& handle, T* data, IdxT size, uint64_t seed)
+{
+  raft::random::RngState rng{seed};
+  constexpr T kRangeMax = std::is_integral_v<T> ? std::numeric_limits<T>::max() : T(1);
+  constexpr T kRangeMin = std::is_integral_v<T> ? std::numeric_limits<T>::min() : T(-1);
+  if constexpr (std::is_integral_v<T>) {
+    raft::random::uniformInt(handle, rng, data, size, kRangeMin, kRangeMax);
+  } else {
+    raft::random::uniform(handle, rng, data, size, kRangeMin, kRangeMax);
+  }
+}
+
+struct cagra_optimize_params {
+  size_t n_rows;
+  /** The degree of the input kNN graph. */
+  int intermediate_degree;
+  /** The degree of the optimized graph. */
+  int graph_degree;
+};
+
+/** The rank-based pruning and the reverse edges of `cagra::optimize` (graph_core.cuh). */
+template <typename IdxT>
+struct cagra_optimize : public fixture {
+  explicit cagra_optimize(const cagra_optimize_params& ps)
+    : fixture(true),
+      params_(ps),
+      knn_graph_(make_host_matrix<IdxT, int64_t>(ps.n_rows, ps.intermediate_degree)),
+      new_graph_(make_host_matrix<IdxT, int64_t>(ps.n_rows, ps.graph_degree))
+  {
+    // a random graph: the optimization does not depend on the quality of the input edges
+    auto graph_d = make_device_matrix<IdxT, int64_t>(handle, ps.n_rows, ps.intermediate_degree);
+    raft::random::RngState rng{42};
+    raft::random::uniformInt<IdxT>(
+      handle, rng, graph_d.data_handle(), graph_d.size(), 0, ps.n_rows - 1);
+    raft::copy(knn_graph_.data_handle(), graph_d.data_handle(), graph_d.size(), stream);
+    resource::sync_stream(handle, stream);
+  }
+
+  void run_benchmark(::benchmark::State& state) override
+  {
+    loop_on_state(state, [this]() {
+      raft::neighbors::cagra::optimize(handle, knn_graph_.view(), new_graph_.view());
+    });
+    state.counters["n_rows"]              = params_.n_rows;
+    state.counters["intermediate_degree"] = params_.intermediate_degree;
+    state.counters["graph_degree"]        = params_.graph_degree;
+  }
+
+ private:
+  const cagra_optimize_params params_;
+  raft::host_matrix<IdxT, int64_t> knn_graph_;
+  raft::host_matrix<IdxT, int64_t> new_graph_;
+};
+
+struct nn_descent_params {
+  size_t n_rows;
+  int dim;
+  int graph_degree;
+  int intermediate_degree;
+  /** The number of the nn-descent iterations (the early termination is disabled). */
+  int iterations;
+};
+
+/** The kNN graph construction of `nn_descent::build` for a fixed number of iterations. */
+template <typename T, typename IdxT>
+struct nn_descent_build : public fixture {
+  explicit nn_descent_build(const nn_descent_params& ps)
+    : fixture(true),
+      params_(ps),
+      dataset_(make_device_matrix<T, int64_t>(handle, ps.n_rows, ps.dim))
+  {
+    fill_random(handle, dataset_.data_handle(), dataset_.size(), 42);
+    resource::sync_stream(handle, stream);
+  }
+
+  void run_benchmark(::benchmark::State& state) override
+  {
+    raft::neighbors::experimental::nn_descent::index_params index_params;
+    index_params.graph_degree              = params_.graph_degree;
+    index_params.intermediate_graph_degree = params_.intermediate_degree;
+    index_params.max_iterations            = params_.iterations;
+    index_params.termination_threshold     = 0;
+    auto dataset_v                         = make_const_mdspan(dataset_.view());
+    loop_on_state(state, [&]() {
+      auto index = raft::neighbors::experimental::nn_descent::build<T, IdxT>(
+        handle, index_params, dataset_v);
+    });
+    state.counters["n_rows"]              = params_.n_rows;
+    state.counters["n_cols"]              = params_.dim;
+    state.counters["graph_degree"]        = params_.graph_degree;
+    state.counters["intermediate_degree"] = params_.intermediate_degree;
+    state.counters["iterations"]          = params_.iterations;
+  }
+
+ private:
+  const nn_descent_params params_;
+  raft::device_matrix<T, int64_t, row_major> dataset_;
+};
+
+/** The stage of the IVF-PQ build to measure. */
+enum class ivf_pq_build_stage {
+  /** The coarse (balanced k-means) clustering and the codebook training (no data added). */
+  kTrain,
+  /** The encoding of the dataset into a trained index (`extend`). */
+  kEncode,
+};
+
+struct ivf_pq_build_params {
+  size_t n_rows;
+  int dim;
+  uint32_t n_lists;
+  uint32_t pq_dim;
+  uint32_t pq_bits;
+  raft::neighbors::ivf_pq::codebook_gen codebook_kind;
+  ivf_pq_build_stage stage;
+};
+
+/** The codebook training and the encoding of `ivf_pq::build` (ivf_pq_build.cuh). */
+template <typename T, typename IdxT>
+struct ivf_pq_build : public fixture {
+  explicit ivf_pq_build(const ivf_pq_build_params& ps)
+    : fixture(true), params_(ps), dataset_(make_device_matrix<T, IdxT>(handle, ps.n_rows, ps.dim))
+  {
+    fill_random(handle, dataset_.data_handle(), dataset_.size(), 42);
+    index_params_.n_lists                  = ps.n_lists;
+    index_params_.pq_dim                   = ps.pq_dim;
+    index_params_.pq_bits                  = ps.pq_bits;
+    index_params_.codebook_kind            = ps.codebook_kind;
+    index_params_.kmeans_trainset_fraction = 0.1;
+    index_params_.add_data_on_build        = false;
+    if (ps.stage == ivf_pq_build_stage::kEncode) {
+      trained_.emplace(raft::neighbors::ivf_pq::build<T, IdxT>(
+        handle, index_params_, make_const_mdspan(dataset_.view())));
+    }
+    resource::sync_stream(handle, stream);
+  }
+
+  void run_benchmark(::benchmark::State& state) override
+  {
+    auto dataset_v = make_const_mdspan(dataset_.view());
+    if (params_.stage == ivf_pq_build_stage::kTrain) {
+      loop_on_state(state, [&]() {
+        auto index = raft::neighbors::ivf_pq::build<T, IdxT>(handle, index_params_, dataset_v);
+      });
+    } else {
+      loop_on_state(state, [&]() {
+        auto index = raft::neighbors::ivf_pq::extend<T, IdxT>(
+          handle, dataset_v, std::nullopt, *trained_);
+      });
+    }
+    state.SetLabel(params_.stage == ivf_pq_build_stage::kTrain ? "train" : "encode");
+    state.counters["n_rows"]  = params_.n_rows;
+    state.counters["n_cols"]  = params_.dim;
+    state.counters["n_lists"] = params_.n_lists;
+    state.counters["pq_dim"]  = params_.pq_dim;
+    state.counters["pq_bits"] = params_.pq_bits;
+    state.counters["per_cluster"] =
+      params_.codebook_kind == raft::neighbors::ivf_pq::codebook_gen::PER_CLUSTER;
+  }
+
+ private:
+  const ivf_pq_build_params params_;
+  raft::neighbors::ivf_pq::index_params index_params_;
+  raft::device_matrix<T, IdxT, row_major> dataset_;
+  std::optional<raft::neighbors::ivf_pq::index<IdxT>> trained_;
+};
+
+const std::vector<cagra_optimize_params> kCagraOptimizeInputs =
+  raft::util::itertools::product<cagra_optimize_params>({100000ull, 1000000ull},  // n_rows
+                                                        {64, 128},  // intermediate_degree
+                                                        {32, 64}    // graph_degree
+  );
+
+const std::vector<nn_descent_params> kNnDescentInputs =
+  raft::util::itertools::product<nn_descent_params>({100000ull, 1000000ull},  // n_rows
+                                                    {96, 256},                // dim
+                                                    {64},                     // graph_degree
+                                                    {128},                    // intermediate_degree
+                                                    {1, 5, 20}                // iterations
+  );
+
+const std::vector<ivf_pq_build_params> kIvfPqBuildInputs =
+  raft::util::itertools::product<ivf_pq_build_params>(
+    {1000000ull},     // n_rows
+    {128},            // dim
+    {1024u, 16384u},  // n_lists
+    {32u, 64u},       // pq_dim
+    {8u},             // pq_bits
+    {raft::neighbors::ivf_pq::codebook_gen::PER_SUBSPACE,
+     raft::neighbors::ivf_pq::codebook_gen::PER_CLUSTER},       // codebook_kind
+    {ivf_pq_build_stage::kTrain, ivf_pq_build_stage::kEncode}  // stage
+  );
+
+}  // namespace raft::bench::neighbors
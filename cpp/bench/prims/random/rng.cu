@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -40,34 +40,29 @@ struct rng_inputs {
   RandomType type;
   raft::random::GeneratorType gtype;
   T start, end;
+  /** the elements skipped at the beginning of the buffer (which makes the output unaligned) */
+  int offset = 0;
 };  // struct rng_inputs
 
 template <typename T>
 struct rng : public fixture {
-  rng(const rng_inputs<T>& p) : params(p), ptr(p.len, stream) {}
+  rng(const rng_inputs<T>& p) : params(p), ptr(p.len + p.offset, stream) {}
 
   void run_benchmark(::benchmark::State& state) override
   {
     raft::random::RngState r(123456ULL, params.gtype);
-    loop_on_state(state, [this, &r]() {
+    T* out = ptr.data() + params.offset;
+    loop_on_state(state, [this, &r, out]() {
       switch (params.type) {
-        case RNG_Normal: normal(handle, r, ptr.data(), params.len, params.start, params.end); break;
-        case RNG_LogNormal:
-          lognormal(handle, r, ptr.data(), params.len, params.start, params.end);
-          break;
-        case RNG_Uniform:
-          uniform(handle, r, ptr.data(), params.len, params.start, params.end);
-          break;
-        case RNG_Gumbel: gumbel(handle, r, ptr.data(), params.len, params.start, params.end); break;
-        case RNG_Logistic:
-          logistic(handle, r, ptr.data(), params.len, params.start, params.end);
-          break;
-        case RNG_Exp: exponential(handle, r, ptr.data(), params.len, params.start); break;
-        case RNG_Rayleigh: rayleigh(handle, r, ptr.data(), params.len, params.start); break;
-        case RNG_Laplace:
-          laplace(handle, r, ptr.data(), params.len, params.start, params.end);
-          break;
-        case RNG_Fill: fill(handle, r, ptr.data(), params.len, params.start); break;
+        case RNG_Normal: normal(handle, r, out, params.len, params.start, params.end); break;
+        case RNG_LogNormal: lognormal(handle, r, out, params.len, params.start, params.end); break;
+        case RNG_Uniform: uniform(handle, r, out, params.len, params.start, params.end); break;
+        case RNG_Gumbel: gumbel(handle, r, out, params.len, params.start, params.end); break;
+        case RNG_Logistic: logistic(handle, r, out, params.len, params.start, params.end); break;
+        case RNG_Exp: exponential(handle, r, out, params.len, params.start); break;
+        case RNG_Rayleigh: rayleigh(handle, r, out, params.len, params.start); break;
+        case RNG_Laplace: laplace(handle, r, out, params.len, params.start, params.end); break;
+        case RNG_Fill: fill(handle, r, out, params.len, params.start); break;
       };
     });
   }
@@ -111,6 +106,13 @@ static std::vector<rng_inputs<T>> get_rng_input_vecs()
     {1024 * 1024 + 1, RNG_Fill, GenPhilox, T(-1.0), T(1.0)},
     {32 * 1024 * 1024 + 1, RNG_Fill, GenPhilox, T(-1.0), T(1.0)},
     {1024 * 1024 * 1024 + 1, RNG_Fill, GenPhilox, T(-1.0), T(1.0)},
+
+    // two outputs per call, and unaligned outputs (the vectorized stores start after a head)
+    {32 * 1024 * 1024, RNG_Normal, GenPhilox, T(0.0), T(1.0)},
+    {32 * 1024 * 1024, RNG_Normal, GenPC, T(0.0), T(1.0)},
+    {32 * 1024 * 1024 + 1, RNG_Normal, GenPhilox, T(0.0), T(1.0), 1},
+    {32 * 1024 * 1024, RNG_Uniform, GenPhilox, T(-1.0), T(1.0), 1},
+    {32 * 1024 * 1024, RNG_Uniform, GenPC, T(-1.0), T(1.0), 1},
   };
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,9 +17,17 @@
 #include <stdio.h>
 
 #include <common/benchmark.hpp>
+#include <raft/core/device_coo_matrix.hpp>
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/sparse/convert/csr.cuh>
+#include <raft/sparse/coo.hpp>
+#include <raft/sparse/op/filter.cuh>
+#include <raft/sparse/op/sort.cuh>
 #include <rmm/device_uvector.hpp>
 
+#include <random>
+#include <vector>
+
 namespace raft::bench::sparse {
 
 template <typename index_t>
@@ -134,4 +142,91 @@ const std::vector<bench_param<int64_t>> bench_params = {
 
 RAFT_BENCH_REGISTER(bench_base<int64_t>, "", bench_params);
 
+struct coo_bench_param {
+  int num_rows;
+  int num_cols;
+  int nnz;
+};
+
+/** Unsorted COO with duplicates to CSR: the fused pipeline, or the separate passes. */
+enum class coo_to_csr_alg { fused, separate };
+
+template <coo_to_csr_alg Alg>
+struct coo_to_csr_bench : public fixture {
+  coo_to_csr_bench(const coo_bench_param& p)
+    : params(p),
+      handle(stream),
+      rows(p.nnz, stream),
+      cols(p.nnz, stream),
+      vals(p.nnz, stream),
+      rows_tmp(p.nnz, stream),
+      cols_tmp(p.nnz, stream),
+      vals_tmp(p.nnz, stream),
+      csr(raft::make_device_csr_matrix<float, int, int, int>(handle, p.num_rows, p.num_cols, p.nnz))
+  {
+    std::mt19937 gen(2024);
+    std::uniform_int_distribution<int> row_dis(0, p.num_rows - 1);
+    std::uniform_int_distribution<int> col_dis(0, p.num_cols - 1);
+    std::uniform_real_distribution<float> val_dis(0.0f, 1.0f);
+    std::vector<int> rows_h(p.nnz), cols_h(p.nnz);
+    std::vector<float> vals_h(p.nnz);
+    for (int i = 0; i < p.nnz; i++) {
+      rows_h[i] = row_dis(gen);
+      cols_h[i] = col_dis(gen);
+      vals_h[i] = i % 10 == 0 ? 0.0f : val_dis(gen);
+    }
+    raft::update_device(rows.data(), rows_h.data(), p.nnz, stream);
+    raft::update_device(cols.data(), cols_h.data(), p.nnz, stream);
+    raft::update_device(vals.data(), vals_h.data(), p.nnz, stream);
+  }
+
+  void run_benchmark(::benchmark::State& state) override
+  {
+    loop_on_state(state, [this]() {
+      if constexpr (Alg == coo_to_csr_alg::fused) {
+        // the conversion consumes its input
+        raft::copy(rows_tmp.data(), rows.data(), params.nnz, stream);
+        raft::copy(cols_tmp.data(), cols.data(), params.nnz, stream);
+        raft::copy(vals_tmp.data(), vals.data(), params.nnz, stream);
+        auto structure = raft::make_device_coordinate_structure_view<int, int, int>(
+          rows_tmp.data(), cols_tmp.data(), params.num_rows, params.num_cols, params.nnz);
+        raft::sparse::convert::coo_to_sorted_csr(
+          handle, raft::make_device_coo_matrix_view<float>(vals_tmp.data(), structure), csr);
+      } else {
+        // sort, filter (without summing the duplicates) and build the row offsets
+        raft::sparse::COO<float> in(stream, params.nnz, params.num_rows, params.num_cols);
+        raft::copy(in.rows(), rows.data(), params.nnz, stream);
+        raft::copy(in.cols(), cols.data(), params.nnz, stream);
+        raft::copy(in.vals(), vals.data(), params.nnz, stream);
+        raft::sparse::op::coo_sort(&in, stream);
+        raft::sparse::COO<float> out(stream);
+        raft::sparse::op::coo_remove_zeros(&in, &out, stream);
+        rmm::device_uvector<int> indptr(params.num_rows, stream);
+        raft::sparse::convert::sorted_coo_to_csr(&out, indptr.data(), stream);
+      }
+    });
+
+    state.counters["nnz"]  = benchmark::Counter(params.nnz);
+    state.counters["Rows"] = benchmark::Counter(params.num_rows);
+  }
+
+ protected:
+  raft::device_resources handle;
+  coo_bench_param params;
+  rmm::device_uvector<int> rows, cols;
+  rmm::device_uvector<float> vals;
+  rmm::device_uvector<int> rows_tmp, cols_tmp;
+  rmm::device_uvector<float> vals_tmp;
+  raft::device_csr_matrix<float, int, int, int> csr;
+};
+
+const std::vector<coo_bench_param> coo_bench_params = {
+  {1 << 10, 1 << 10, 1 << 16},
+  {1 << 16, 1 << 16, 1 << 22},
+  {1 << 20, 1 << 14, 1 << 24},
+};
+
+RAFT_BENCH_REGISTER(coo_to_csr_bench<coo_to_csr_alg::fused>, "", coo_bench_params);
+RAFT_BENCH_REGISTER(coo_to_csr_bench<coo_to_csr_alg::separate>, "", coo_bench_params);
+
 }  // namespace raft::bench::sparse
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,9 +21,12 @@
 #include <raft/core/resources.hpp>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
+#include <raft/util/device_atomics.cuh>
 
+#include <rmm/device_scalar.hpp>
 #include <rmm/device_uvector.hpp>
 
+#include <thrust/copy.h>
 #include <thrust/device_ptr.h>
 #include <thrust/execution_policy.h>
 #include <thrust/extrema.h>
@@ -32,10 +35,13 @@
 #include <thrust/functional.h>
 #include <thrust/iterator/counting_iterator.h>
 #include <thrust/iterator/zip_iterator.h>
+#include <thrust/sequence.h>
 #include <thrust/sort.h>
+#include <thrust/transform.h>
 #include <thrust/tuple.h>
 
 #include <cstddef>
+#include <cstdint>
 
 namespace raft::cluster::detail {
 template <typename value_idx, typename value_t>
@@ -80,15 +86,9 @@ class UnionFind {
 };
 
 /**
- * Agglomerative labeling on host. This has not been found to be a bottleneck
- * in the algorithm. A parallel version of this can be done using a parallel
- * variant of Kruskal's MST algorithm
- * (ref http://cucis.ece.northwestern.edu/publications/pdf/HenPat12.pdf),
- * which breaks apart the sorted MST results into overlapping subsets and
- * independently runs Kruskal's algorithm on each subset, merging them back
- * together into a single hierarchy when complete. Unfortunately,
- * this is nontrivial and the speedup wouldn't be useful until this
- * becomes a bottleneck.
+ * Agglomerative labeling on host, with a sequential union-find over the sorted
+ * MST edges. See `build_dendrogram_device` for the parallel version, which
+ * produces the same dendrogram.
  *
  * @tparam value_idx
  * @tparam value_t
@@ -154,6 +154,299 @@ void build_dendrogram_host(raft::resources const& handle,
   raft::update_device(out_delta, out_delta_h.data(), n_edges, stream);
 }
 
+/** Whether an edge is in the lower half of its block of `2 * half` edges. */
+template <typename value_idx>
+struct dendrogram_lower_half {
+  size_t half;
+
+  __host__ __device__ bool operator()(value_idx i) const
+  {
+    return (static_cast<size_t>(i) / half) % 2 == 0;
+  }
+};
+
+/**
+ * The entries of the lower edges (one per endpoint) keyed by the block of the edge and the
+ * endpoint; the entry `2 * e + side` is the source (side 0) or destination (side 1) of edge e.
+ */
+template <typename value_idx>
+RAFT_KERNEL dendrogram_entries_kernel(const value_idx* lower,
+                                      size_t n_lower,
+                                      const value_idx* src,
+                                      const value_idx* dst,
+                                      size_t block_size,
+                                      uint64_t n_nodes,
+                                      uint64_t* keys,
+                                      value_idx* entries)
+{
+  size_t k = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (k < n_lower) {
+    value_idx e        = lower[k];
+    uint64_t block     = static_cast<size_t>(e) / block_size;
+    keys[2 * k]        = block * n_nodes + src[e];
+    keys[2 * k + 1]    = block * n_nodes + dst[e];
+    entries[2 * k]     = 2 * e;
+    entries[2 * k + 1] = 2 * e + 1;
+  }
+}
+
+template <typename value_idx>
+__device__ value_idx dendrogram_find(const value_idx* comp, value_idx e)
+{
+  while (comp[e] != e)
+    e = comp[e];
+  return e;
+}
+
+/** Hooks the components of the lower edges sharing an endpoint (consecutive sorted entries). */
+template <typename value_idx>
+RAFT_KERNEL dendrogram_hook_kernel(const uint64_t* keys,
+                                   const value_idx* entries,
+                                   size_t n_entries,
+                                   value_idx* comp,
+                                   bool* changed)
+{
+  size_t k = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (k > 0 && k < n_entries && keys[k] == keys[k - 1]) {
+    value_idx ru = dendrogram_find(comp, entries[k] / 2);
+    value_idx rw = dendrogram_find(comp, entries[k - 1] / 2);
+    if (ru != rw) {
+      atomicMin(&comp[max(ru, rw)], min(ru, rw));
+      *changed = true;
+    }
+  }
+}
+
+/** Points each lower edge to the root of its component, and resets the component statistics. */
+template <typename value_idx>
+RAFT_KERNEL dendrogram_shortcut_kernel(const value_idx* lower,
+                                       size_t n_lower,
+                                       value_idx* comp,
+                                       value_idx* comp_max,
+                                       value_idx* comp_size)
+{
+  size_t k = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (k < n_lower) {
+    value_idx e  = lower[k];
+    comp[e]      = dendrogram_find(comp, e);
+    comp_max[e]  = -1;
+    comp_size[e] = 0;
+  }
+}
+
+/**
+ * The last edge of each component (whose node is the root of the component in the dendrogram),
+ * and the number of leaves under it: the sum of the sizes of its distinct endpoints.
+ */
+template <typename value_idx>
+RAFT_KERNEL dendrogram_stats_kernel(const uint64_t* keys,
+                                    const value_idx* entries,
+                                    size_t n_entries,
+                                    const value_idx* comp,
+                                    const value_idx* src_size,
+                                    const value_idx* dst_size,
+                                    value_idx* comp_max,
+                                    value_idx* comp_size)
+{
+  size_t k = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (k < n_entries) {
+    value_idx e    = entries[k] / 2;
+    bool is_dst    = entries[k] % 2;
+    value_idx root = comp[e];
+    if (!is_dst) { atomicMax(&comp_max[root], e); }
+    if (k == 0 || keys[k] != keys[k - 1]) {
+      atomicAdd(&comp_size[root], is_dst ? dst_size[e] : src_size[e]);
+    }
+  }
+}
+
+/**
+ * Replaces the endpoints of the upper edges of each block by the roots of their components among
+ * the lower edges of the block.
+ */
+template <typename value_idx>
+RAFT_KERNEL dendrogram_relabel_kernel(const uint64_t* keys,
+                                      const value_idx* entries,
+                                      size_t n_entries,
+                                      const value_idx* comp,
+                                      const value_idx* comp_max,
+                                      const value_idx* comp_size,
+                                      size_t nnz,
+                                      size_t half,
+                                      uint64_t n_nodes,
+                                      value_idx n_leaves,
+                                      value_idx* src,
+                                      value_idx* dst,
+                                      value_idx* src_size,
+                                      value_idx* dst_size)
+{
+  size_t i = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (i >= nnz || (i / half) % 2 == 0) { return; }
+  uint64_t block = i / (2 * half);
+  auto relabel   = [&](value_idx& node, value_idx& size) {
+    uint64_t key = block * n_nodes + node;
+    size_t lo    = 0;
+    size_t hi    = n_entries;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (keys[mid] < key) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo < n_entries && keys[lo] == key) {
+      value_idx root = comp[entries[lo] / 2];
+      node           = n_leaves + comp_max[root];
+      size           = comp_size[root];
+    }
+  };
+  relabel(src[i], src_size[i]);
+  relabel(dst[i], dst_size[i]);
+}
+
+template <typename value_idx>
+RAFT_KERNEL dendrogram_output_kernel(const value_idx* src,
+                                     const value_idx* dst,
+                                     const value_idx* src_size,
+                                     const value_idx* dst_size,
+                                     size_t nnz,
+                                     value_idx* children,
+                                     value_idx* out_size)
+{
+  size_t i = static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (i < nnz) {
+    children[2 * i]     = src[i];
+    children[2 * i + 1] = dst[i];
+    out_size[i]         = src_size[i] + dst_size[i];
+  }
+}
+
+/**
+ * Agglomerative labeling on device. This produces the same dendrogram as `build_dendrogram_host`:
+ * the merge i joins the roots of the components of its endpoints in the forest of the edges
+ * before it, i.e. the nodes `n_leaves + (the last edge of the component)` (or the endpoints
+ * themselves, when no edge before i touches them).
+ *
+ * The roots are found by a divide and conquer over the sorted edges, all the blocks of a level at
+ * once: for the blocks of `2 * half` edges, the connected components of the lower half of each
+ * block are found (hook and shortcut over the edges sharing an endpoint), and the endpoints of the
+ * upper half are replaced by the roots of their components. The lower halves of the upper levels
+ * cover exactly the edges before a block, so after the last level (`half = 1`) the endpoints of
+ * each edge are the children of its merge. The sizes of the merges are carried along with the
+ * endpoints. There are `log2(nnz)` levels.
+ *
+ * @tparam value_idx
+ * @tparam value_t
+ * @tparam tpb the threads per block of the kernels
+ * @param[in] handle the raft handle
+ * @param[in] rows src edges of the sorted MST
+ * @param[in] cols dst edges of the sorted MST
+ * @param[in] data weights of the sorted MST
+ * @param[in] nnz the number of edges in the sorted MST
+ * @param[out] children children of output [nnz, 2]
+ * @param[out] out_delta distances of output
+ * @param[out] out_size cluster sizes of output
+ */
+template <typename value_idx, typename value_t, int tpb = 256>
+void build_dendrogram_device(raft::resources const& handle,
+                             const value_idx* rows,
+                             const value_idx* cols,
+                             const value_t* data,
+                             size_t nnz,
+                             value_idx* children,
+                             value_t* out_delta,
+                             value_idx* out_size)
+{
+  auto stream        = resource::get_cuda_stream(handle);
+  auto thrust_policy = resource::get_thrust_policy(handle);
+  if (nnz == 0) { return; }
+
+  value_idx n_leaves = nnz + 1;
+  uint64_t n_nodes   = 2 * nnz + 1;
+
+  rmm::device_uvector<value_idx> src(nnz, stream);
+  rmm::device_uvector<value_idx> dst(nnz, stream);
+  rmm::device_uvector<value_idx> src_size(nnz, stream);
+  rmm::device_uvector<value_idx> dst_size(nnz, stream);
+  raft::copy_async(src.data(), rows, nnz, stream);
+  raft::copy_async(dst.data(), cols, nnz, stream);
+  thrust::fill(thrust_policy, src_size.begin(), src_size.end(), 1);
+  thrust::fill(thrust_policy, dst_size.begin(), dst_size.end(), 1);
+
+  rmm::device_uvector<value_idx> lower(nnz, stream);
+  rmm::device_uvector<uint64_t> keys(2 * nnz, stream);
+  rmm::device_uvector<value_idx> entries(2 * nnz, stream);
+  rmm::device_uvector<value_idx> comp(nnz, stream);
+  rmm::device_uvector<value_idx> comp_max(nnz, stream);
+  rmm::device_uvector<value_idx> comp_size(nnz, stream);
+  rmm::device_scalar<bool> changed(stream);
+
+  size_t top_half = 1;
+  while (2 * top_half < nnz) {
+    top_half *= 2;
+  }
+  value_idx nnz_blocks = ceildiv(nnz, static_cast<size_t>(tpb));
+  for (size_t half = nnz > 1 ? top_half : 0; half > 0; half /= 2) {
+    auto first     = thrust::make_counting_iterator<value_idx>(0);
+    auto lower_end = thrust::copy_if(
+      thrust_policy, first, first + nnz, lower.data(), dendrogram_lower_half<value_idx>{half});
+
+    size_t n_lower      = lower_end - lower.data();
+    size_t n_entries    = 2 * n_lower;
+    size_t lower_blocks = ceildiv(n_lower, static_cast<size_t>(tpb));
+    size_t entry_blocks = ceildiv(n_entries, static_cast<size_t>(tpb));
+
+    dendrogram_entries_kernel<<<lower_blocks, tpb, 0, stream>>>(lower.data(),
+                                                                n_lower,
+                                                                src.data(),
+                                                                dst.data(),
+                                                                2 * half,
+                                                                n_nodes,
+                                                                keys.data(),
+                                                                entries.data());
+    thrust::sort_by_key(thrust_policy, keys.data(), keys.data() + n_entries, entries.data());
+
+    // connected components of the lower edges of each block
+    thrust::sequence(thrust_policy, comp.begin(), comp.end(), 0);
+    do {
+      changed.set_value_to_zero_async(stream);
+      dendrogram_hook_kernel<<<entry_blocks, tpb, 0, stream>>>(
+        keys.data(), entries.data(), n_entries, comp.data(), changed.data());
+      dendrogram_shortcut_kernel<<<lower_blocks, tpb, 0, stream>>>(
+        lower.data(), n_lower, comp.data(), comp_max.data(), comp_size.data());
+    } while (changed.value(stream));
+
+    dendrogram_stats_kernel<<<entry_blocks, tpb, 0, stream>>>(keys.data(),
+                                                              entries.data(),
+                                                              n_entries,
+                                                              comp.data(),
+                                                              src_size.data(),
+                                                              dst_size.data(),
+                                                              comp_max.data(),
+                                                              comp_size.data());
+    dendrogram_relabel_kernel<<<nnz_blocks, tpb, 0, stream>>>(keys.data(),
+                                                              entries.data(),
+                                                              n_entries,
+                                                              comp.data(),
+                                                              comp_max.data(),
+                                                              comp_size.data(),
+                                                              nnz,
+                                                              half,
+                                                              n_nodes,
+                                                              n_leaves,
+                                                              src.data(),
+                                                              dst.data(),
+                                                              src_size.data(),
+                                                              dst_size.data());
+  }
+
+  dendrogram_output_kernel<<<nnz_blocks, tpb, 0, stream>>>(
+    src.data(), dst.data(), src_size.data(), dst_size.data(), nnz, children, out_size);
+  raft::copy_async(out_delta, data, nnz, stream);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
 template <typename value_idx>
 RAFT_KERNEL write_levels_kernel(const value_idx* children, value_idx* parents, value_idx n_vertices)
 {
@@ -166,46 +459,30 @@ RAFT_KERNEL write_levels_kernel(const value_idx* children, value_idx* parents, v
 }
 
 /**
- * Instead of propagating a label from roots to children,
- * the children each iterate up the tree until they find
- * the label of their parent. This increases the potential
- * parallelism.
+ * Instead of propagating a label from roots to children, each node below the cut jumps up the
+ * tree until it finds a labeled ancestor: its pointer skips to the pointer of its (unlabeled)
+ * target, so the distance to the labeled ancestor halves every round, and `log2(depth)` rounds
+ * label all the nodes, whatever the shape of the dendrogram. The pointers never skip a labeled
+ * node, so the nodes above the cut are never reached.
+ *
  * @tparam value_idx
- * @param children
- * @param parents
- * @param n_leaves
- * @param labels
+ * @param[inout] pointers an ancestor of each node below the cut (initially the parent)
+ * @param[inout] labels the labels of the nodes (-1: not yet known)
+ * @param[in] n_nodes the number of nodes below the cut
  */
 template <typename value_idx>
-RAFT_KERNEL inherit_labels(const value_idx* children,
-                           const value_idx* levels,
-                           std::size_t n_leaves,
-                           value_idx* labels,
-                           int cut_level,
-                           value_idx n_vertices)
+RAFT_KERNEL inherit_labels(value_idx* pointers, value_idx* labels, value_idx n_nodes)
 {
   value_idx tid = blockDim.x * blockIdx.x + threadIdx.x;
 
-  if (tid < n_vertices) {
-    value_idx node      = children[tid];
-    value_idx cur_level = tid / 2;
-
-    /**
-     * Any roots above the cut level should be ignored.
-     * Any leaves at the cut level should already be labeled
-     */
-    if (cur_level > cut_level) return;
-
-    value_idx cur_parent = node;
-    value_idx label      = labels[cur_parent];
-
-    while (label == -1) {
-      cur_parent = cur_level + n_leaves;
-      cur_level  = levels[cur_parent];
-      label      = labels[cur_parent];
+  if (tid < n_nodes && labels[tid] == -1) {
+    value_idx target = pointers[tid];
+    value_idx label  = labels[target];
+    if (label != -1) {
+      labels[tid] = label;
+    } else {
+      pointers[tid] = pointers[target];
     }
-
-    labels[node] = label;
   }
 }
 
@@ -310,15 +587,29 @@ void extract_flattened_clusters(raft::resources const& handle,
       thrust_policy, z_iter, z_iter + n_clusters, init_label_roots<value_idx>(tmp_labels.data()));
 
     /**
-     * Step 2: Propagate labels by having children iterate through their parents
-     *     1. Initialize labels to -1
-     *     2. For each element in levels array, propagate until parent's
-     *        label is !=-1
+     * Step 2: Propagate labels by having children jump through their ancestors
+     *     1. Turn the levels array into the parents of the nodes below the cut
+     *     2. Jump until the ancestor's label is !=-1 (log2(n_nodes) rounds)
      */
     value_idx cut_level = (n_edges / 2) - (n_clusters - 1);
-
-    inherit_labels<<<n_blocks, tpb, 0, stream>>>(
-      children, levels.data(), n_leaves, tmp_labels.data(), cut_level, n_vertices);
+    value_idx n_nodes   = n_leaves + cut_level;
+
+    // the parent of a child at a level is the node of that level
+    thrust::transform(thrust_policy,
+                      levels.data(),
+                      levels.data() + n_nodes,
+                      levels.data(),
+                      [n_leaves] __device__(value_idx level) -> value_idx {
+                        return level + static_cast<value_idx>(n_leaves);
+                      });
+    int n_rounds = 2;
+    for (int64_t d = 1; d < n_nodes; d *= 2) {
+      n_rounds++;
+    }
+    value_idx n_node_blocks = ceildiv(n_nodes, (value_idx)tpb);
+    for (int r = 0; r < n_rounds; r++) {
+      inherit_labels<<<n_node_blocks, tpb, 0, stream>>>(levels.data(), tmp_labels.data(), n_nodes);
+    }
 
     // copy tmp labels to actual labels
     raft::copy_async(labels, tmp_labels.data(), n_leaves, stream);
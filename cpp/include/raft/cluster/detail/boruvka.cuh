@@ -0,0 +1,432 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/kvp.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/distance/masked_nn.cuh>
+#include <raft/linalg/map.cuh>
+#include <raft/linalg/norm.cuh>
+#include <raft/matrix/gather.cuh>
+#include <raft/sparse/convert/csr.cuh>
+#include <raft/spatial/knn/knn.cuh>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/fast_int_div.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/functional.h>
+#include <thrust/gather.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/reduce.h>
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
+#include <thrust/tuple.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace raft::cluster::detail {
+
+/**
+ * Reduction op of the cross-component 1-nn of the Borůvka rounds. With core distances, the
+ * distance d(a, b) is replaced by the mutual reachability distance
+ * max(core(a), core(b), d(a, b)) of HDBSCAN; the transformation is idempotent, so it is safely
+ * applied again to the partially reduced pairs.
+ *
+ * `core_x` holds the core distances of the (batch of) rows and `core_y` those of the columns;
+ * both are null for the plain distances.
+ */
+template <typename value_idx, typename value_t>
+struct mutual_reachability_min_op {
+  const value_t* core_x;
+  const value_t* core_y;
+  value_idx m;
+
+  typedef typename raft::KeyValuePair<value_idx, value_t> KVP;
+
+  // default constructor for cutlass
+  DI mutual_reachability_min_op() : core_x(nullptr), core_y(nullptr), m(0) {}
+
+  mutual_reachability_min_op(const value_t* core_x_, const value_t* core_y_, value_idx m_)
+    : core_x(core_x_), core_y(core_y_), m(m_)
+  {
+  }
+
+  DI value_t reach(value_idx rit, const KVP& p) const
+  {
+    if (core_x == nullptr || p.key < 0) { return p.value; }
+    return raft::max(p.value, raft::max(core_x[rit], core_y[p.key]));
+  }
+
+  DI void operator()(value_idx rit, KVP* out, const KVP& other) const
+  {
+    if (rit < m) {
+      auto v = reach(rit, other);
+      if (v < out->value) {
+        out->key   = other.key;
+        out->value = v;
+      }
+    }
+  }
+
+  DI KVP operator()(value_idx rit, const KVP& a, const KVP& b) const
+  {
+    if (rit >= m) { return b; }
+    KVP ra(a.key, reach(rit, a));
+    KVP rb(b.key, reach(rit, b));
+    return ra.value < rb.value ? ra : rb;
+  }
+
+  DI void init(value_t* out, value_t maxVal) const { *out = maxVal; }
+  DI void init(KVP* out, value_t maxVal) const
+  {
+    out->key   = -1;
+    out->value = maxVal;
+  }
+
+  DI void init_key(value_t& out, value_idx idx) const { return; }
+  DI void init_key(KVP& out, value_idx idx) const { out.key = idx; }
+
+  DI value_t get_value(KVP& out) const { return out.value; }
+  DI value_t get_value(value_t& out) const { return out; }
+};
+
+/** The lighter of two (weight, src, dst) edges; the ties are broken by the vertex ids. */
+template <typename value_idx, typename value_t>
+struct min_edge_op {
+  using edge_t = thrust::tuple<value_t, value_idx, value_idx>;
+
+  __host__ __device__ auto operator()(const edge_t& a, const edge_t& b) const -> edge_t
+  {
+    auto wa = thrust::get<0>(a);
+    auto wb = thrust::get<0>(b);
+    if (wa != wb) { return wa < wb ? a : b; }
+    auto a_lo = raft::min(thrust::get<1>(a), thrust::get<2>(a));
+    auto b_lo = raft::min(thrust::get<1>(b), thrust::get<2>(b));
+    if (a_lo != b_lo) { return a_lo < b_lo ? a : b; }
+    auto a_hi = raft::max(thrust::get<1>(a), thrust::get<2>(a));
+    auto b_hi = raft::max(thrust::get<1>(b), thrust::get<2>(b));
+    return a_hi <= b_hi ? a : b;
+  }
+};
+
+/**
+ * Core distances of HDBSCAN: the distance of every point to its `min_samples`-th nearest
+ * neighbor (the point itself included).
+ *
+ * @param[in] handle raft handle
+ * @param[in] X dense input matrix in row-major layout [m, n]
+ * @param[in] m number of rows in X
+ * @param[in] n number of columns in X
+ * @param[in] min_samples the number of neighbors defining the core distance
+ * @param[in] metric L2 distance metric
+ * @param[out] core_dists the core distance of every point [m]
+ */
+template <typename value_idx, typename value_t>
+void core_distances(raft::resources const& handle,
+                    const value_t* X,
+                    size_t m,
+                    size_t n,
+                    int min_samples,
+                    raft::distance::DistanceType metric,
+                    value_t* core_dists)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  size_t k    = std::min<size_t>(std::max(min_samples, 1), m);
+
+  rmm::device_uvector<int64_t> knn_indices(m * k, stream);
+  rmm::device_uvector<value_t> knn_dists(m * k, stream);
+
+  std::vector<value_t*> inputs;
+  inputs.push_back(const_cast<value_t*>(X));
+  std::vector<size_t> sizes;
+  sizes.push_back(m);
+
+  raft::spatial::knn::brute_force_knn<int64_t, value_t, size_t>(handle,
+                                                                inputs,
+                                                                sizes,
+                                                                n,
+                                                                const_cast<value_t*>(X),
+                                                                m,
+                                                                knn_indices.data(),
+                                                                knn_dists.data(),
+                                                                k,
+                                                                true,
+                                                                true,
+                                                                nullptr,
+                                                                metric);
+
+  auto dists = knn_dists.data();
+  raft::linalg::map_offset(handle,
+                           raft::make_device_vector_view<value_t, size_t>(core_dists, m),
+                           [dists, k] __device__(size_t i) { return dists[i * k + k - 1]; });
+}
+
+/**
+ * Exact minimum spanning tree of the complete graph of the points of X by Borůvka's algorithm,
+ * with the edges sorted by weight.
+ *
+ * Every round finds the lightest edge leaving each component: the points are ordered by
+ * component, so that a masked 1-nn (`masked_l2_nn`, with the own component of every point masked
+ * out) gives the nearest point of another component of every point, and a segmented reduction
+ * gives the lightest of them per component. The components joined by these edges are then merged
+ * on the host (a union-find over the components, which also drops the cycles of equal-weight
+ * edges). At least half of the components are merged every round, hence at most log2(m) rounds,
+ * every one of O(m^2 n) work and O(m n) memory: no distance matrix or kNN graph is built.
+ *
+ * @tparam value_idx
+ * @tparam value_t
+ * @param[in] handle raft handle
+ * @param[in] X dense input matrix in row-major layout [m, n]
+ * @param[in] m number of rows in X
+ * @param[in] n number of columns in X
+ * @param[in] metric L2Expanded or L2SqrtExpanded (or their unexpanded variants)
+ * @param[in] core_dists (optional) core distances [m]: when given, the edges are weighted by the
+ *            mutual reachability distance of HDBSCAN.
+ * @param[out] mst_src output src edges [m - 1]
+ * @param[out] mst_dst output dst edges [m - 1]
+ * @param[out] mst_weight output weights (distances) [m - 1]
+ */
+template <typename value_idx, typename value_t>
+void build_sorted_mst_boruvka(raft::resources const& handle,
+                              const value_t* X,
+                              size_t m,
+                              size_t n,
+                              raft::distance::DistanceType metric,
+                              const value_t* core_dists,
+                              value_idx* mst_src,
+                              value_idx* mst_dst,
+                              value_t* mst_weight)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("boruvka_mst(%zu, %zu)", m, n);
+  RAFT_EXPECTS(metric == raft::distance::DistanceType::L2Expanded ||
+                 metric == raft::distance::DistanceType::L2SqrtExpanded ||
+                 metric == raft::distance::DistanceType::L2Unexpanded ||
+                 metric == raft::distance::DistanceType::L2SqrtUnexpanded,
+               "The Borůvka MST supports only the L2 distances");
+  if (m < 2) { return; }
+
+  auto stream      = resource::get_cuda_stream(handle);
+  auto exec_policy = resource::get_thrust_policy(handle);
+
+  const bool apply_sqrt = metric == raft::distance::DistanceType::L2SqrtExpanded ||
+                          metric == raft::distance::DistanceType::L2SqrtUnexpanded;
+
+  using KVP    = raft::KeyValuePair<value_idx, value_t>;
+  using red_op = mutual_reachability_min_op<value_idx, value_t>;
+  using ParamT = raft::distance::masked_l2_nn_params<red_op, red_op>;
+
+  // The component of every point, in [0, n_components)
+  rmm::device_uvector<value_idx> colors(m, stream);
+  thrust::sequence(exec_policy, colors.begin(), colors.end(), value_idx(0));
+
+  rmm::device_uvector<value_idx> colors_sorted(m, stream);
+  rmm::device_uvector<value_idx> sort_plan(m, stream);
+  rmm::device_uvector<value_idx> group_idxs(m + 1, stream);
+  rmm::device_uvector<value_t> X_sorted(m * n, stream);
+  rmm::device_uvector<value_t> x_norm(m, stream);
+  rmm::device_uvector<value_t> core_sorted(core_dists != nullptr ? m : 0, stream);
+  rmm::device_uvector<KVP> kvp(m, stream);
+  rmm::device_uvector<value_t> edge_w(m, stream);
+  rmm::device_uvector<value_idx> edge_src(m, stream);
+  rmm::device_uvector<value_idx> edge_dst(m, stream);
+  rmm::device_uvector<value_idx> edge_color(m, stream);
+  rmm::device_uvector<value_idx> dst_color(m, stream);
+  rmm::device_uvector<value_idx> new_colors(m, stream);
+
+  std::vector<value_idx> h_src, h_dst;
+  std::vector<value_t> h_weight;
+  h_src.reserve(m - 1);
+  h_dst.reserve(m - 1);
+  h_weight.reserve(m - 1);
+
+  auto X_sorted_view =
+    raft::make_device_matrix_view<const value_t, value_idx>(X_sorted.data(), m, n);
+  size_t n_components = m;
+  while (n_components > 1) {
+    // 1. order the points by component
+    thrust::sequence(exec_policy, sort_plan.begin(), sort_plan.end(), value_idx(0));
+    raft::copy(colors_sorted.data(), colors.data(), m, stream);
+    thrust::stable_sort_by_key(
+      exec_policy, colors_sorted.begin(), colors_sorted.end(), sort_plan.begin());
+    raft::sparse::convert::sorted_coo_to_csr(
+      colors_sorted.data(), m, group_idxs.data(), n_components + 1, stream);
+    raft::matrix::gather(X, n, m, sort_plan.data(), m, X_sorted.data(), stream);
+    raft::linalg::rowNorm(
+      x_norm.data(), X_sorted.data(), n, m, raft::linalg::L2Norm, true, stream);
+    if (core_dists != nullptr) {
+      thrust::gather(
+        exec_policy, sort_plan.begin(), sort_plan.end(), core_dists, core_sorted.begin());
+    }
+
+    // 2. the nearest point of another component of every point; the mask of a batch of rows is
+    // [row_batch_size, n_components], so the batches shrink when there are many components.
+    const size_t row_batch_size =
+      std::min(m, std::max<size_t>(64, (size_t(1) << 28) / n_components));
+
+    auto adj = raft::make_device_matrix<bool, value_idx>(handle, row_batch_size, n_components);
+
+    auto group_idxs_view = raft::make_device_vector_view<const value_idx, value_idx>(
+      group_idxs.data() + 1, n_components);
+
+    auto x_norm_view = raft::make_device_vector_view<const value_t, value_idx>(x_norm.data(), m);
+    for (size_t batch_offset = 0; batch_offset < m; batch_offset += row_batch_size) {
+      size_t rows_per_batch = std::min(row_batch_size, m - batch_offset);
+
+      auto mask_op = [colors = colors_sorted.data(),
+                      n_groups = raft::util::FastIntDiv(n_components),
+                      batch_offset] __device__(value_idx idx) {
+        value_idx row = idx / n_groups;
+        value_idx col = idx % n_groups;
+        return colors[batch_offset + row] != col;
+      };
+      raft::linalg::map_offset(handle,
+                               raft::make_device_vector_view<bool, value_idx>(
+                                 adj.data_handle(), rows_per_batch * n_components),
+                               mask_op);
+
+      red_op op(core_dists != nullptr ? core_sorted.data() + batch_offset : nullptr,
+                core_dists != nullptr ? core_sorted.data() : nullptr,
+                value_idx(rows_per_batch));
+      ParamT params{op, op, apply_sqrt, true};
+      raft::distance::masked_l2_nn<value_t, KVP, value_idx, red_op, red_op>(
+        handle,
+        params,
+        raft::make_device_matrix_view<const value_t, value_idx>(
+          X_sorted.data() + batch_offset * n, rows_per_batch, n),
+        X_sorted_view,
+        raft::make_device_vector_view<const value_t, value_idx>(x_norm.data() + batch_offset,
+                                                                rows_per_batch),
+        x_norm_view,
+        raft::make_device_matrix_view<const bool, value_idx>(
+          adj.data_handle(), rows_per_batch, n_components),
+        group_idxs_view,
+        raft::make_device_vector_view<KVP, value_idx>(kvp.data() + batch_offset, rows_per_batch));
+    }
+
+    // 3. the lightest edge leaving every component
+    auto plan = sort_plan.data();
+    thrust::transform(exec_policy,
+                      thrust::make_counting_iterator<value_idx>(0),
+                      thrust::make_counting_iterator<value_idx>(m),
+                      kvp.begin(),
+                      thrust::make_zip_iterator(
+                        thrust::make_tuple(edge_w.begin(), edge_src.begin(), edge_dst.begin())),
+                      [plan] __device__(value_idx r, const KVP& nn) {
+                        return thrust::make_tuple(
+                          nn.value, plan[r], nn.key < 0 ? value_idx(-1) : plan[nn.key]);
+                      });
+    auto edges   = thrust::make_zip_iterator(
+      thrust::make_tuple(edge_w.begin(), edge_src.begin(), edge_dst.begin()));
+    auto reduced = thrust::reduce_by_key(exec_policy,
+                                         colors_sorted.begin(),
+                                         colors_sorted.end(),
+                                         edges,
+                                         edge_color.begin(),
+                                         edges,
+                                         thrust::equal_to<value_idx>(),
+                                         min_edge_op<value_idx, value_t>());
+    RAFT_EXPECTS(size_t(reduced.first - edge_color.begin()) == n_components,
+                 "Borůvka: unexpected number of components");
+    thrust::transform(exec_policy,
+                      edge_dst.begin(),
+                      edge_dst.begin() + n_components,
+                      dst_color.begin(),
+                      [colors = colors.data()] __device__(value_idx v) {
+                        return v < 0 ? value_idx(-1) : colors[v];
+                      });
+
+    // 4. merge the components joined by these edges (lightest first)
+    std::vector<value_t> h_w(n_components);
+    std::vector<value_idx> h_s(n_components), h_d(n_components), h_dc(n_components);
+    raft::update_host(h_w.data(), edge_w.data(), n_components, stream);
+    raft::update_host(h_s.data(), edge_src.data(), n_components, stream);
+    raft::update_host(h_d.data(), edge_dst.data(), n_components, stream);
+    raft::update_host(h_dc.data(), dst_color.data(), n_components, stream);
+    resource::sync_stream(handle, stream);
+
+    std::vector<size_t> order(n_components);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(
+      order.begin(), order.end(), [&h_w](size_t a, size_t b) { return h_w[a] < h_w[b]; });
+
+    std::vector<size_t> parent(n_components);
+    std::iota(parent.begin(), parent.end(), 0);
+    auto find = [&parent](size_t c) {
+      while (parent[c] != c) {
+        parent[c] = parent[parent[c]];
+        c         = parent[c];
+      }
+      return c;
+    };
+    for (auto c : order) {
+      RAFT_EXPECTS(h_dc[c] >= 0, "Borůvka: no edge leaves the component %zu", c);
+      auto a = find(c);
+      auto b = find(static_cast<size_t>(h_dc[c]));
+      if (a == b) { continue; }
+      parent[std::max(a, b)] = std::min(a, b);
+      h_src.push_back(h_s[c]);
+      h_dst.push_back(h_d[c]);
+      h_weight.push_back(h_w[c]);
+    }
+
+    // 5. relabel the components in [0, n_merged)
+    std::vector<value_idx> h_labels(n_components);
+    size_t n_merged = 0;
+    for (size_t c = 0; c < n_components; c++) {
+      if (find(c) == c) { h_labels[c] = static_cast<value_idx>(n_merged++); }
+    }
+    for (size_t c = 0; c < n_components; c++) {
+      h_labels[c] = h_labels[find(c)];
+    }
+    RAFT_EXPECTS(n_merged < n_components, "Borůvka: a round did not merge any component");
+    raft::update_device(new_colors.data(), h_labels.data(), n_components, stream);
+    thrust::gather(exec_policy, colors.begin(), colors.end(), new_colors.begin(), colors.begin());
+    n_components = n_merged;
+  }
+
+  // The dendrogram construction needs the edges sorted by weight
+  std::vector<size_t> order(h_weight.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&h_weight](size_t a, size_t b) {
+    return h_weight[a] < h_weight[b];
+  });
+  std::vector<value_idx> s_src(order.size()), s_dst(order.size());
+  std::vector<value_t> s_weight(order.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    s_src[i]    = h_src[order[i]];
+    s_dst[i]    = h_dst[order[i]];
+    s_weight[i] = h_weight[order[i]];
+  }
+  raft::update_device(mst_src, s_src.data(), s_src.size(), stream);
+  raft::update_device(mst_dst, s_dst.data(), s_dst.size(), stream);
+  raft::update_device(mst_weight, s_weight.data(), s_weight.size(), stream);
+  resource::sync_stream(handle, stream);
+}
+
+};  // namespace raft::cluster::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,6 +20,7 @@
 #include <cstdio>
 #include <ctime>
 #include <optional>
+#include <raft/core/resource/cancellation_token.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
 #include <random>
@@ -28,6 +29,7 @@
 #include <thrust/fill.h>
 #include <thrust/transform.h>
 
+#include <raft/cluster/detail/kmeans_bounds.cuh>
 #include <raft/cluster/detail/kmeans_common.cuh>
 #include <raft/cluster/kmeans_types.hpp>
 #include <raft/common/nvtx.hpp>
@@ -365,7 +367,9 @@ void kmeans_fit_main(raft::resources const& handle,
                      raft::device_matrix_view<DataT, IndexT> centroidsRawData,
                      raft::host_scalar_view<DataT> inertia,
                      raft::host_scalar_view<IndexT> n_iter,
-                     rmm::device_uvector<char>& workspace)
+                     rmm::device_uvector<char>& workspace,
+                     std::optional<raft::device_vector_view<const DataT, IndexT>> l2norm_x =
+                       std::nullopt)
 {
   common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_fit_main");
   logger::get(RAFT_NAME).set_level(params.verbosity);
@@ -395,13 +399,13 @@ void kmeans_fit_main(raft::resources const& handle,
 
   rmm::device_scalar<DataT> clusterCostD(stream);
 
-  // L2 norm of X: ||x||^2
-  auto L2NormX = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
-  auto l2normx_view =
-    raft::make_device_vector_view<const DataT, IndexT>(L2NormX.data_handle(), n_samples);
+  // L2 norm of X: ||x||^2 (unless the caller shares a precomputed one)
+  auto L2NormX      = raft::make_device_vector<DataT, IndexT>(handle, l2norm_x ? 0 : n_samples);
+  auto l2normx_view = l2norm_x.value_or(
+    raft::make_device_vector_view<const DataT, IndexT>(L2NormX.data_handle(), n_samples));
 
-  if (metric == raft::distance::DistanceType::L2Expanded ||
-      metric == raft::distance::DistanceType::L2SqrtExpanded) {
+  if (!l2norm_x && (metric == raft::distance::DistanceType::L2Expanded ||
+                    metric == raft::distance::DistanceType::L2SqrtExpanded)) {
     raft::linalg::rowNorm(L2NormX.data_handle(),
                           X.data_handle(),
                           X.extent(1),
@@ -411,6 +415,13 @@ void kmeans_fit_main(raft::resources const& handle,
                           stream);
   }
 
+  // the bounds carried over the iterations to skip the distance computations
+  std::optional<hamerly_bounds<DataT, IndexT>> bounds;
+  if (params.hamerly_bounds && (metric == raft::distance::DistanceType::L2Expanded ||
+                                metric == raft::distance::DistanceType::L2SqrtExpanded)) {
+    bounds.emplace(handle, n_samples);
+  }
+
   RAFT_LOG_DEBUG(
     "Calling KMeans.fit with %d samples of input data and the initialized "
     "cluster centers",
@@ -418,6 +429,7 @@ void kmeans_fit_main(raft::resources const& handle,
 
   DataT priorClusteringCost = 0;
   for (n_iter[0] = 1; n_iter[0] <= params.max_iter; ++n_iter[0]) {
+    raft::resource::check_cancellation(handle);
     RAFT_LOG_DEBUG(
       "KMeans.fit: Iteration-%d: fitting the model using the initialized "
       "cluster centers",
@@ -431,16 +443,26 @@ void kmeans_fit_main(raft::resources const& handle,
     //   'key' is index to a sample in 'centroids' (index of the nearest
     //   centroid) and 'value' is the distance between the sample 'X[i]' and the
     //   'centroid[key]'
-    detail::minClusterAndDistanceCompute<DataT, IndexT>(handle,
-                                                        X,
-                                                        centroids,
-                                                        minClusterAndDistance.view(),
-                                                        l2normx_view,
-                                                        L2NormBuf_OR_DistBuf,
-                                                        params.metric,
-                                                        params.batch_samples,
-                                                        params.batch_centroids,
-                                                        workspace);
+    if (bounds.has_value()) {
+      detail::hamerly_assign<DataT, IndexT>(handle,
+                                            params,
+                                            X,
+                                            raft::make_const_mdspan(centroids),
+                                            *bounds,
+                                            minClusterAndDistance.view(),
+                                            workspace);
+    } else {
+      detail::minClusterAndDistanceCompute<DataT, IndexT>(handle,
+                                                          X,
+                                                          centroids,
+                                                          minClusterAndDistance.view(),
+                                                          l2normx_view,
+                                                          L2NormBuf_OR_DistBuf,
+                                                          params.metric,
+                                                          params.batch_samples,
+                                                          params.batch_centroids,
+                                                          workspace);
+    }
 
     // Using TransformInputIteratorT to dereference an array of
     // raft::KeyValuePair and converting them to just return the Key to be used
@@ -474,6 +496,11 @@ void kmeans_fit_main(raft::resources const& handle,
     DataT sqrdNormError = 0;
     raft::copy(&sqrdNormError, sqrdNorm.data_handle(), sqrdNorm.size(), stream);
 
+    if (bounds.has_value()) {
+      bounds->max_shift = detail::max_centroid_shift<DataT, IndexT>(
+        handle, raft::make_const_mdspan(centroids), raft::make_const_mdspan(newCentroids.view()));
+    }
+
     raft::copy(
       centroidsRawData.data_handle(), newCentroids.data_handle(), newCentroids.size(), stream);
 
@@ -991,7 +1018,9 @@ void kmeans_predict(raft::resources const& handle,
                     raft::device_matrix_view<const DataT, IndexT> centroids,
                     raft::device_vector_view<IndexT, IndexT> labels,
                     bool normalize_weight,
-                    raft::host_scalar_view<DataT> inertia)
+                    raft::host_scalar_view<DataT> inertia,
+                    std::optional<raft::device_vector_view<const DataT, IndexT>> l2norm_x =
+                      std::nullopt)
 {
   common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_predict");
   auto n_samples      = X.extent(0);
@@ -1031,10 +1060,10 @@ void kmeans_predict(raft::resources const& handle,
     raft::make_device_vector<raft::KeyValuePair<IndexT, DataT>, IndexT>(handle, n_samples);
   rmm::device_uvector<DataT> L2NormBuf_OR_DistBuf(0, stream);
 
-  // L2 norm of X: ||x||^2
-  auto L2NormX = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
-  if (metric == raft::distance::DistanceType::L2Expanded ||
-      metric == raft::distance::DistanceType::L2SqrtExpanded) {
+  // L2 norm of X: ||x||^2 (unless the caller shares a precomputed one)
+  auto L2NormX = raft::make_device_vector<DataT, IndexT>(handle, l2norm_x ? 0 : n_samples);
+  if (!l2norm_x && (metric == raft::distance::DistanceType::L2Expanded ||
+                    metric == raft::distance::DistanceType::L2SqrtExpanded)) {
     raft::linalg::rowNorm(L2NormX.data_handle(),
                           X.data_handle(),
                           X.extent(1),
@@ -1049,8 +1078,8 @@ void kmeans_predict(raft::resources const& handle,
   //   'key' is index to a sample in 'centroids' (index of the nearest
   //   centroid) and 'value' is the distance between the sample 'X[i]' and the
   //   'centroid[key]'
-  auto l2normx_view =
-    raft::make_device_vector_view<const DataT, IndexT>(L2NormX.data_handle(), n_samples);
+  auto l2normx_view = l2norm_x.value_or(
+    raft::make_device_vector_view<const DataT, IndexT>(L2NormX.data_handle(), n_samples));
   detail::minClusterAndDistanceCompute<DataT, IndexT>(handle,
                                                       X,
                                                       centroids,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,7 +17,11 @@
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/host_mdarray.hpp>
+#include <raft/core/resource/cublas_handle.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <thrust/fill.h>
 #include <thrust/host_vector.h>
 
 #include <raft/core/logger.hpp>
@@ -27,43 +31,166 @@
 #include <raft/core/error.hpp>
 
 #include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/linalg/norm.cuh>
 #include <raft/stats/dispersion.cuh>
 
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <vector>
+
 namespace raft::cluster::detail {
 
+/** The k-means fit of `find_k` for one candidate number of clusters. */
+template <typename value_t, typename idx_t>
+struct find_k_fit {
+  rmm::device_uvector<value_t> centroids;
+  /** The sizes of the clusters, kept on the host to split the largest ones when warm-starting. */
+  std::vector<idx_t> cluster_sizes;
+  value_t residual;
+  idx_t n_iter;
+  value_t dispersion;
+};
+
+/**
+ * The initial centroids of a warm-started fit: the centroids of a fit with fewer clusters, followed
+ * by the copies of its largest clusters moved by `eps` towards a random sample of the data, which
+ * the Lloyd iterations then pull apart (LBG splitting).
+ */
+template <typename value_t, typename idx_t>
+struct find_k_split_op {
+  const value_t* X;
+  const value_t* centroids;
+  const idx_t* split_clusters;
+  const idx_t* split_samples;
+  idx_t k_from;
+  idx_t d;
+  value_t eps;
+
+  HDI auto operator()(int64_t i) const -> value_t
+  {
+    const int64_t row = i / d;
+    const int64_t col = i % d;
+    if (row < k_from) { return centroids[i]; }
+    const value_t c = centroids[int64_t(split_clusters[row - k_from]) * d + col];
+    return c + eps * (X[int64_t(split_samples[row - k_from]) * d + col] - c);
+  }
+};
+
+/**
+ * Fit k-means with `k` clusters and evaluate the fit for `find_k`.
+ *
+ * The centroids are initialized with k-means++ as in `kmeans_fit` (so the fit does not depend on
+ * the order the candidates are fitted in), or, if `warm_from` is given, by splitting the largest
+ * clusters of that fit with fewer clusters.
+ *
+ * @param[in] handle the resources the fit runs on
+ * @param[in] params the k-means parameters (the number of clusters is replaced by `k`)
+ * @param[in] X the input observations [n, d]
+ * @param[in] weight the sample weights shared by all fits, normalized to sum up to n
+ * @param[in] l2norm_x the norms of X shared by all fits (std::nullopt: computed by the fit)
+ * @param[in] k the number of clusters
+ * @param[in] warm_from the fit whose clusters are split, or nullptr
+ */
 template <typename value_t, typename idx_t>
-void compute_dispersion(raft::resources const& handle,
-                        raft::device_matrix_view<const value_t, idx_t> X,
-                        KMeansParams& params,
-                        raft::device_matrix_view<value_t, idx_t> centroids_view,
-                        raft::device_vector_view<idx_t> labels,
-                        raft::device_vector_view<idx_t> clusterSizes,
-                        rmm::device_uvector<char>& workspace,
-                        raft::host_vector_view<value_t> clusterDispertionView,
-                        raft::host_vector_view<value_t> resultsView,
-                        raft::host_scalar_view<value_t> residual,
-                        raft::host_scalar_view<idx_t> n_iter,
-                        int val,
-                        idx_t n,
-                        idx_t d)
+auto fit_candidate(raft::resources const& handle,
+                   const KMeansParams& params,
+                   raft::device_matrix_view<const value_t, idx_t> X,
+                   raft::device_vector_view<const value_t, idx_t> weight,
+                   std::optional<raft::device_vector_view<const value_t, idx_t>> l2norm_x,
+                   idx_t k,
+                   const find_k_fit<value_t, idx_t>* warm_from) -> find_k_fit<value_t, idx_t>
 {
-  auto centroids_const_view =
-    raft::make_device_matrix_view<const value_t, idx_t>(centroids_view.data_handle(), val, d);
+  auto stream = resource::get_cuda_stream(handle);
+  idx_t n     = X.extent(0);
+  idx_t d     = X.extent(1);
 
-  idx_t* clusterSizes_ptr = clusterSizes.data_handle();
-  auto cluster_sizes_view =
-    raft::make_device_vector_view<const idx_t, idx_t>(clusterSizes_ptr, val);
+  KMeansParams iter_params = params;
+  iter_params.n_clusters   = k;
+  std::mt19937 gen(params.rng_state.seed);
+  iter_params.rng_state.seed = gen();
+
+  find_k_fit<value_t, idx_t> fit{
+    rmm::device_uvector<value_t>(size_t(k) * d, stream), std::vector<idx_t>(k), 0, 0, 0};
+  auto centroids = raft::make_device_matrix_view<value_t, idx_t>(fit.centroids.data(), k, d);
+  rmm::device_uvector<char> workspace(0, stream);
 
-  params.n_clusters = val;
+  if (warm_from != nullptr) {
+    // Split the largest clusters first (they are split more than once if k > 2 * k_from)
+    idx_t k_from = warm_from->cluster_sizes.size();
+    std::vector<idx_t> order(k_from);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [warm_from](idx_t a, idx_t b) {
+      return warm_from->cluster_sizes[a] > warm_from->cluster_sizes[b];
+    });
+    std::uniform_int_distribution<idx_t> sample(0, n - 1);
+    std::vector<idx_t> split(2 * (k - k_from));
+    for (idx_t j = 0; j < k - k_from; j++) {
+      split[j]              = order[j % k_from];
+      split[k - k_from + j] = sample(gen);
+    }
+    rmm::device_uvector<idx_t> split_buf(split.size(), stream);
+    raft::copy(split_buf.data(), split.data(), split.size(), stream);
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<value_t, int64_t>(fit.centroids.data(), fit.centroids.size()),
+      find_k_split_op<value_t, idx_t>{X.data_handle(),
+                                      warm_from->centroids.data(),
+                                      split_buf.data(),
+                                      split_buf.data() + (k - k_from),
+                                      k_from,
+                                      d,
+                                      value_t(0.01)});
+    iter_params.init = KMeansParams::InitMethod::Array;
+  } else if (iter_params.oversampling_factor == 0) {
+    detail::kmeansPlusPlus<value_t, idx_t>(handle, iter_params, X, centroids, workspace);
+  } else {
+    detail::initScalableKMeansPlusPlus<value_t, idx_t>(
+      handle, iter_params, X, centroids, workspace);
+  }
 
-  raft::cluster::detail::kmeans_fit_predict<value_t, idx_t>(
-    handle, params, X, std::nullopt, std::make_optional(centroids_view), labels, residual, n_iter);
+  detail::kmeans_fit_main<value_t, idx_t>(handle,
+                                          iter_params,
+                                          X,
+                                          weight,
+                                          centroids,
+                                          raft::make_host_scalar_view<value_t>(&fit.residual),
+                                          raft::make_host_scalar_view<idx_t>(&fit.n_iter),
+                                          workspace,
+                                          l2norm_x);
 
-  detail::countLabels(handle, labels.data_handle(), clusterSizes.data_handle(), n, val, workspace);
+  auto centroids_const_view =
+    raft::make_device_matrix_view<const value_t, idx_t>(fit.centroids.data(), k, d);
+  auto labels = raft::make_device_vector<idx_t, idx_t>(handle, n);
+  detail::kmeans_predict<value_t, idx_t>(handle,
+                                         iter_params,
+                                         X,
+                                         std::nullopt,
+                                         centroids_const_view,
+                                         labels.view(),
+                                         true,
+                                         raft::make_host_scalar_view<value_t>(&fit.residual),
+                                         l2norm_x);
 
-  resultsView[val]           = residual[0];
-  clusterDispertionView[val] = raft::stats::cluster_dispersion(
+  auto clusterSizes = raft::make_device_vector<idx_t, idx_t>(handle, k);
+  detail::countLabels(handle, labels.data_handle(), clusterSizes.data_handle(), n, k, workspace);
+  auto cluster_sizes_view =
+    raft::make_device_vector_view<const idx_t, idx_t>(clusterSizes.data_handle(), k);
+  fit.dispersion = raft::stats::cluster_dispersion(
     handle, centroids_const_view, cluster_sizes_view, std::nullopt, n);
+  raft::copy(fit.cluster_sizes.data(), clusterSizes.data_handle(), k, stream);
+  resource::sync_stream(handle, stream);
+  return fit;
 }
 
 template <typename idx_t, typename value_t>
@@ -73,9 +200,10 @@ void find_k(raft::resources const& handle,
             raft::host_scalar_view<value_t> residual,
             raft::host_scalar_view<idx_t> n_iter,
             idx_t kmax,
-            idx_t kmin    = 1,
-            idx_t maxiter = 100,
-            value_t tol   = 1e-2)
+            idx_t kmin      = 1,
+            idx_t maxiter   = 100,
+            value_t tol     = 1e-2,
+            bool warm_start = false)
 {
   idx_t n = X.extent(0);
   idx_t d = X.extent(1);
@@ -86,16 +214,106 @@ void find_k(raft::resources const& handle,
   RAFT_EXPECTS(kmax <= n, "kmax must be <= number of data samples in X");
   RAFT_EXPECTS(tol >= 0, "tolerance must be >= 0");
   RAFT_EXPECTS(maxiter >= 0, "maxiter must be >= 0");
-  // Allocate memory
-  // Device memory
 
-  auto centroids    = raft::make_device_matrix<value_t, idx_t>(handle, kmax, X.extent(1));
-  auto clusterSizes = raft::make_device_vector<idx_t>(handle, kmax);
-  auto labels       = raft::make_device_vector<idx_t>(handle, n);
+  cudaStream_t stream = resource::get_cuda_stream(handle);
 
-  rmm::device_uvector<char> workspace(0, resource::get_cuda_stream(handle));
+  KMeansParams params;
+  params.max_iter = maxiter;
+  params.tol      = tol;
 
-  idx_t* clusterSizes_ptr = clusterSizes.data_handle();
+  // The norms of X and the (unit) sample weights are computed once and shared by all fits
+  std::optional<raft::device_vector_view<const value_t, idx_t>> l2norm_x;
+  auto L2NormX = raft::make_device_vector<value_t, idx_t>(handle, n);
+  if (params.metric == raft::distance::DistanceType::L2Expanded ||
+      params.metric == raft::distance::DistanceType::L2SqrtExpanded) {
+    raft::linalg::rowNorm(
+      L2NormX.data_handle(), X.data_handle(), d, n, raft::linalg::L2Norm, true, stream);
+    l2norm_x = raft::make_device_vector_view<const value_t, idx_t>(L2NormX.data_handle(), n);
+  }
+  rmm::device_uvector<char> workspace(0, stream);
+  auto weight = raft::make_device_vector<value_t, idx_t>(handle, n);
+  thrust::fill(resource::get_thrust_policy(handle),
+               weight.data_handle(),
+               weight.data_handle() + weight.size(),
+               1);
+  checkWeight<value_t>(handle, weight.view(), workspace);
+  auto weight_view = raft::make_device_vector_view<const value_t, idx_t>(weight.data_handle(), n);
+
+  // With a stream pool, the candidates the binary search may visit next are fitted concurrently,
+  // one host thread per stream (k-means synchronizes every iteration). Each stream gets its own
+  // cublas handle and thrust policy, since the two of the main resources are bound to its stream.
+  size_t n_streams = 1;
+  if (handle.has_resource_factory(resource::resource_type::CUDA_STREAM_POOL)) {
+    n_streams = std::max<size_t>(resource::get_stream_pool_size(handle), 1);
+  }
+  std::vector<std::unique_ptr<raft::resources>> stream_handles;
+  if (n_streams > 1) {
+    for (size_t s = 0; s < n_streams; s++) {
+      auto fit_stream = resource::get_stream_from_stream_pool(handle, s);
+      stream_handles.push_back(std::make_unique<raft::resources>(handle));
+      resource::set_cuda_stream(*stream_handles.back(), fit_stream);
+      stream_handles.back()->add_resource_factory(
+        std::make_shared<resource::cublas_resource_factory>(fit_stream));
+      stream_handles.back()->add_resource_factory(
+        std::make_shared<resource::thrust_policy_resource_factory>(fit_stream));
+    }
+    resource::wait_stream_pool_on_stream(handle);
+  }
+
+  // The fits are deterministic, so they are kept per number of clusters
+  std::map<idx_t, find_k_fit<value_t, idx_t>> fits;
+  auto fit_batch = [&](std::vector<idx_t> ks) {
+    std::vector<idx_t> todo;
+    for (auto k : ks) {
+      if (fits.count(k) == 0 && std::find(todo.begin(), todo.end(), k) == todo.end()) {
+        todo.push_back(k);
+      }
+    }
+    // Warm-start from the fit with the most clusters among the smaller ones fitted so far
+    std::vector<const find_k_fit<value_t, idx_t>*> warm_from(todo.size(), nullptr);
+    if (warm_start) {
+      for (size_t i = 0; i < todo.size(); i++) {
+        auto it = fits.lower_bound(todo[i]);
+        if (it != fits.begin()) { warm_from[i] = &std::prev(it)->second; }
+      }
+    }
+    std::vector<std::optional<find_k_fit<value_t, idx_t>>> batch(todo.size());
+    std::vector<std::exception_ptr> errors(todo.size());
+    for (size_t first = 0; first < todo.size(); first += n_streams) {
+      const int count = std::min(n_streams, todo.size() - first);
+#pragma omp parallel for num_threads(count)
+      for (int j = 0; j < count; j++) {
+        const auto& fit_res = n_streams > 1 ? *stream_handles[j] : handle;
+        try {
+          batch[first + j].emplace(fit_candidate<value_t, idx_t>(
+            fit_res, params, X, weight_view, l2norm_x, todo[first + j], warm_from[first + j]));
+        } catch (...) {
+          errors[first + j] = std::current_exception();
+        }
+      }
+    }
+    for (auto& error : errors) {
+      if (error) { std::rethrow_exception(error); }
+    }
+    for (size_t i = 0; i < todo.size(); i++) {
+      fits.emplace(todo[i], std::move(batch[i].value()));
+    }
+  };
+  // Fit the candidates `ks` along with the mids of the next levels of the binary search from `mid`
+  // splitting [left, right], breadth-first up to a fit per stream (only some are visited).
+  auto prefetch = [&](std::vector<idx_t> ks, int left, int mid, int right) {
+    if (n_streams == 1) { return; }
+    std::deque<std::array<int, 3>> intervals{{left, mid, right}};
+    while (!intervals.empty() && ks.size() < n_streams) {
+      auto [l, m, r] = intervals.front();
+      intervals.pop_front();
+      if (l >= r - 1) { continue; }
+      if (fits.count(m) == 0) { ks.push_back(m); }
+      intervals.push_back({l, int(((unsigned int)l + (unsigned int)m) >> 1), m});
+      intervals.push_back({m, int(((unsigned int)m + (unsigned int)r) >> 1), r});
+    }
+    fit_batch(std::move(ks));
+  };
 
   // Host memory
   auto results           = raft::make_host_vector<value_t>(kmax + 1);
@@ -104,6 +322,13 @@ void find_k(raft::resources const& handle,
   auto clusterDispertionView = clusterDispersion.view();
   auto resultsView           = results.view();
 
+  auto evaluate = [&](idx_t k) {
+    if (fits.count(k) == 0) { fit_batch({k}); }
+    const auto& fit          = fits.at(k);
+    resultsView[k]           = fit.residual;
+    clusterDispertionView[k] = fit.dispersion;
+  };
+
   // Loop to find *best* k
   // Perform k-means in binary search
   int left   = kmin;  // must be at least 2
@@ -114,72 +339,20 @@ void find_k(raft::resources const& handle,
   double objective[3];      // 0= left of mid, 1= right of mid
   if (left == 1) left = 2;  // at least do 2 clusters
 
-  KMeansParams params;
-  params.max_iter = maxiter;
-  params.tol      = tol;
+  prefetch({left, right}, left, mid, right);
+  evaluate(left);
 
-  auto centroids_view =
-    raft::make_device_matrix_view<value_t, idx_t>(centroids.data_handle(), left, d);
-  compute_dispersion<value_t, idx_t>(handle,
-                                     X,
-                                     params,
-                                     centroids_view,
-                                     labels.view(),
-                                     clusterSizes.view(),
-                                     workspace,
-                                     clusterDispertionView,
-                                     resultsView,
-                                     residual,
-                                     n_iter,
-                                     left,
-                                     n,
-                                     d);
-
-  // eval right edge0
-  resultsView[right] = 1e20;
-  while (resultsView[right] > resultsView[left] && tests < 3) {
-    centroids_view =
-      raft::make_device_matrix_view<value_t, idx_t>(centroids.data_handle(), right, d);
-    compute_dispersion<value_t, idx_t>(handle,
-                                       X,
-                                       params,
-                                       centroids_view,
-                                       labels.view(),
-                                       clusterSizes.view(),
-                                       workspace,
-                                       clusterDispertionView,
-                                       resultsView,
-                                       residual,
-                                       n_iter,
-                                       right,
-                                       n,
-                                       d);
-
-    tests += 1;
-  }
+  // eval right edge0 (a fit is not repeated, since it would give the same result)
+  evaluate(right);
 
   objective[0] = (n - left) / (left - 1) * clusterDispertionView[left] / resultsView[left];
   objective[1] = (n - right) / (right - 1) * clusterDispertionView[right] / resultsView[right];
   while (left < right - 1) {
+    prefetch({}, left, mid, right);
     resultsView[mid] = 1e20;
     tests            = 0;
     while (resultsView[mid] > resultsView[left] && tests < 3) {
-      centroids_view =
-        raft::make_device_matrix_view<value_t, idx_t>(centroids.data_handle(), mid, d);
-      compute_dispersion<value_t, idx_t>(handle,
-                                         X,
-                                         params,
-                                         centroids_view,
-                                         labels.view(),
-                                         clusterSizes.view(),
-                                         workspace,
-                                         clusterDispertionView,
-                                         resultsView,
-                                         residual,
-                                         n_iter,
-                                         mid,
-                                         n,
-                                         d);
+      evaluate(mid);
 
       if (resultsView[mid] > resultsView[left] && (mid + 1) < right) {
         mid += 1;
@@ -213,21 +386,9 @@ void find_k(raft::resources const& handle,
   objective[1] = (n - oldmid) / (oldmid - 1) * clusterDispertionView[oldmid] / resultsView[oldmid];
   if (objective[1] < objective[0]) { best_k[0] = left; }
 
-  // if best_k isn't what we just ran, re-run to get correct centroids and dist data on return->
-  // this saves memory
-  if (best_k[0] != oldmid) {
-    auto centroids_view =
-      raft::make_device_matrix_view<value_t, idx_t>(centroids.data_handle(), best_k[0], d);
-
-    params.n_clusters = best_k[0];
-    raft::cluster::detail::kmeans_fit_predict<value_t, idx_t>(handle,
-                                                              params,
-                                                              X,
-                                                              std::nullopt,
-                                                              std::make_optional(centroids_view),
-                                                              labels.view(),
-                                                              residual,
-                                                              n_iter);
-  }
+  // the residual and the iterations of the best k are those of its (kept) fit
+  if (fits.count(best_k[0]) == 0) { fit_batch({best_k[0]}); }
+  residual[0] = fits.at(best_k[0]).residual;
+  n_iter[0]   = fits.at(best_k[0]).n_iter;
 }
-}  // namespace raft::cluster::detail
\ No newline at end of file
+}  // namespace raft::cluster::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,8 +17,12 @@
 #pragma once
 
 #include <limits>
+#include <raft/core/resource/cancellation_token.hpp>
+#include <raft/core/resource/cublas_handle.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
 #include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/device_properties.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
 #include <type_traits>
 
@@ -40,9 +44,11 @@
 #include <raft/linalg/unary_op.cuh>
 #include <raft/matrix/argmin.cuh>
 #include <raft/matrix/gather.cuh>
+#include <raft/random/detail/sample_indices.cuh>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/device_atomics.cuh>
 #include <raft/util/integer_utils.hpp>
+#include <raft/util/reduction.cuh>
 
 #include <raft/core/resource/device_memory_resource.hpp>
 #include <rmm/cuda_stream_view.hpp>
@@ -55,7 +61,12 @@
 #include <thrust/gather.h>
 #include <thrust/transform.h>
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
 #include <tuple>
+#include <vector>
 
 namespace raft::cluster::detail {
 
@@ -81,6 +92,8 @@ constexpr static inline float kAdjustCentersWeight = 7.0f;
  * @param[in] n_rows Number samples in the `dataset`
  * @param[out] labels Output predictions [n_rows]
  * @param[inout] mr (optional) Memory resource to use for temporary allocations
+ * @param[in] centers_norm (optional) Pre-computed norms of the centers (for L2 metrics only)
+ *   [n_clusters]
  */
 template <typename MathT, typename IdxT, typename LabelT>
 inline std::enable_if_t<std::is_floating_point_v<MathT>> predict_core(
@@ -93,7 +106,8 @@ inline std::enable_if_t<std::is_floating_point_v<MathT>> predict_core(
   const MathT* dataset_norm,
   IdxT n_rows,
   LabelT* labels,
-  rmm::mr::device_memory_resource* mr)
+  rmm::mr::device_memory_resource* mr,
+  const MathT* centers_norm = nullptr)
 {
   auto stream = resource::get_cuda_stream(handle);
   switch (params.metric) {
@@ -110,17 +124,25 @@ inline std::enable_if_t<std::is_floating_point_v<MathT>> predict_core(
                    minClusterAndDistance.data_handle() + minClusterAndDistance.size(),
                    initial_value);
 
-      auto centroidsNorm =
-        raft::make_device_mdarray<MathT, IdxT>(handle, mr, make_extents<IdxT>(n_clusters));
-      raft::linalg::rowNorm<MathT, IdxT>(
-        centroidsNorm.data_handle(), centers, dim, n_clusters, raft::linalg::L2Norm, true, stream);
+      auto centroidsNorm = raft::make_device_mdarray<MathT, IdxT>(
+        handle, mr, make_extents<IdxT>(centers_norm == nullptr ? n_clusters : 0));
+      if (centers_norm == nullptr) {
+        raft::linalg::rowNorm<MathT, IdxT>(centroidsNorm.data_handle(),
+                                           centers,
+                                           dim,
+                                           n_clusters,
+                                           raft::linalg::L2Norm,
+                                           true,
+                                           stream);
+        centers_norm = centroidsNorm.data_handle();
+      }
 
       raft::distance::fusedL2NNMinReduce<MathT, raft::KeyValuePair<IdxT, MathT>, IdxT>(
         minClusterAndDistance.data_handle(),
         dataset,
         centers,
         dataset_norm,
-        centroidsNorm.data_handle(),
+        centers_norm,
         n_rows,
         n_clusters,
         dim,
@@ -367,6 +389,8 @@ void compute_norm(const raft::resources& handle,
  * @param[in] mapping_op Mapping operation from T to MathT
  * @param[inout] mr (optional) memory resource to use for temporary allocations
  * @param[in] dataset_norm (optional) Pre-computed norms of each row in the dataset [n_rows]
+ * @param[in] centers_norm (optional) Pre-computed norms of the centers (for L2 metrics only)
+ *   [n_clusters]
  */
 template <typename T, typename MathT, typename IdxT, typename LabelT, typename MappingOpT>
 void predict(const raft::resources& handle,
@@ -379,7 +403,8 @@ void predict(const raft::resources& handle,
              LabelT* labels,
              MappingOpT mapping_op,
              rmm::mr::device_memory_resource* mr = nullptr,
-             const MathT* dataset_norm           = nullptr)
+             const MathT* dataset_norm           = nullptr,
+             const MathT* centers_norm           = nullptr)
 {
   auto stream = resource::get_cuda_stream(handle);
   common::nvtx::range<common::nvtx::domain::raft> fun_scope(
@@ -424,8 +449,220 @@ void predict(const raft::resources& handle,
                  dataset_norm_ptr,
                  minibatch_size,
                  labels + offset,
-                 mr);
+                 mr,
+                 centers_norm);
+  }
+}
+
+/** The block size of `predict_small_batch_kernel`. */
+constexpr static inline uint32_t kSmallBatchBlockDim = 256;
+/** The minimum number of centers searched by a block of `predict_small_batch_kernel`. */
+constexpr static inline uint32_t kSmallBatchMinClustersPerSplit = 64;
+/** The largest (mapped) row staged in the shared memory by `predict_small_batch_kernel`. */
+constexpr static inline size_t kSmallBatchMaxRowBytes = 16 * 1024;
+
+/**
+ * Find the closest center to a row among a part of the centers: a block per (row, part), a warp
+ * per center. The distance is `|c|^2 - 2 <x, c>` for the L2 metrics (the norm of the row does not
+ * change the order) and `-<x, c>` for the inner product.
+ */
+template <typename T, typename MathT, typename IdxT, typename MappingOpT>
+RAFT_KERNEL __launch_bounds__(kSmallBatchBlockDim)
+  predict_small_batch_kernel(const T* dataset,
+                             IdxT dim,
+                             const MathT* centers,
+                             const MathT* centers_norm,  // nullptr for the inner product
+                             IdxT n_clusters,
+                             IdxT clusters_per_split,
+                             raft::KeyValuePair<IdxT, MathT>* best,  // [n_rows, gridDim.y]
+                             MappingOpT mapping_op)
+{
+  constexpr uint32_t kWarps = kSmallBatchBlockDim / WarpSize;
+  extern __shared__ __align__(256) uint8_t small_batch_smem[];
+  __shared__ MathT warp_dists[kWarps];
+  __shared__ IdxT warp_labels[kWarps];
+  auto* row       = reinterpret_cast<MathT*>(small_batch_smem);
+  const IdxT r    = blockIdx.x;
+  const IdxT from = IdxT(blockIdx.y) * clusters_per_split;
+  const IdxT to   = from + clusters_per_split < n_clusters ? from + clusters_per_split : n_clusters;
+  for (IdxT j = threadIdx.x; j < dim; j += blockDim.x) {
+    row[j] = mapping_op(dataset[size_t(r) * size_t(dim) + j]);
+  }
+  __syncthreads();
+
+  const uint32_t warp = threadIdx.x / WarpSize;
+  const uint32_t lane = threadIdx.x % WarpSize;
+  MathT best_dist     = std::numeric_limits<MathT>::max();
+  IdxT best_label     = n_clusters;
+  for (IdxT c = from + warp; c < to; c += kWarps) {
+    const MathT* center = centers + size_t(c) * size_t(dim);
+    MathT dot           = 0;
+    for (IdxT j = lane; j < dim; j += WarpSize) {
+      dot += row[j] * center[j];
+    }
+    dot              = raft::warpReduce(dot, raft::add_op{});
+    const MathT dist = centers_norm == nullptr ? -dot : centers_norm[c] - 2 * dot;
+    // the centers of a warp are visited in order: the first of the equal ones is kept
+    if (dist < best_dist) {
+      best_dist  = dist;
+      best_label = c;
+    }
+  }
+  if (lane == 0) {
+    warp_dists[warp]  = best_dist;
+    warp_labels[warp] = best_label;
+  }
+  __syncthreads();
+  if (threadIdx.x == 0) {
+    for (uint32_t w = 1; w < kWarps; w++) {
+      const MathT d = warp_dists[w];
+      const IdxT l  = warp_labels[w];
+      if (d < best_dist || (d == best_dist && l < best_label)) {
+        best_dist  = d;
+        best_label = l;
+      }
+    }
+    best[size_t(r) * gridDim.y + blockIdx.y] = {best_label, best_dist};
+  }
+}
+
+/** Pick the closest of the best centers of the parts for every row: a thread per row. */
+template <typename MathT, typename IdxT, typename LabelT>
+RAFT_KERNEL select_small_batch_kernel(const raft::KeyValuePair<IdxT, MathT>* best,
+                                      IdxT n_rows,
+                                      uint32_t n_splits,
+                                      LabelT* labels)
+{
+  const IdxT r = threadIdx.x + IdxT(blockDim.x) * IdxT(blockIdx.x);
+  if (r >= n_rows) { return; }
+  auto b = best[size_t(r) * n_splits];
+  // the parts are ordered by the labels: the first of the equal ones is kept
+  for (uint32_t s = 1; s < n_splits; s++) {
+    const auto x = best[size_t(r) * n_splits + s];
+    if (x.value < b.value) { b = x; }
+  }
+  labels[r] = static_cast<LabelT>(b.key);
+}
+
+/**
+ * The number of the parts of the centers searched in parallel for a row of a small batch by a
+ * predictor; zero when the rows do not fit the shared memory of `predict_small_batch_kernel`.
+ */
+template <typename MathT, typename IdxT>
+auto small_batch_splits(const raft::resources& handle, IdxT n_clusters, IdxT dim) -> uint32_t
+{
+  if (size_t(dim) * sizeof(MathT) > kSmallBatchMaxRowBytes || n_clusters == 0) { return 0; }
+  const auto n_sms = uint32_t(resource::get_device_properties(handle).multiProcessorCount);
+  const auto n_parts = div_rounding_up_safe<uint64_t>(n_clusters, kSmallBatchMinClustersPerSplit);
+  return static_cast<uint32_t>(std::clamp<uint64_t>(n_parts, 1, 2 * n_sms));
+}
+
+/**
+ * @brief Predict the labels of a small batch (up to `predictor::kMaxSmallBatch` rows) in two
+ * kernels without allocations: the closest center among every part of the centers by a block,
+ * then the closest of the parts.
+ *
+ * The parts are as many as it takes to have about two blocks per SM, up to the
+ * `small_batch_splits` of the workspace.
+ */
+template <typename T, typename MathT, typename IdxT, typename LabelT, typename MappingOpT>
+void predict_small_batch(const raft::resources& handle,
+                         const kmeans_balanced::predictor<MathT, IdxT>& predictor,
+                         const T* dataset,
+                         IdxT n_rows,
+                         LabelT* labels,
+                         MappingOpT mapping_op)
+{
+  auto stream      = resource::get_cuda_stream(handle);
+  auto centers     = predictor.centroids();
+  IdxT n_clusters  = centers.extent(0);
+  IdxT dim         = centers.extent(1);
+  const auto n_sms = uint32_t(resource::get_device_properties(handle).multiProcessorCount);
+  auto n_splits    = static_cast<uint32_t>(std::clamp<uint64_t>(
+    div_rounding_up_safe<uint64_t>(2 * n_sms, n_rows), 1, predictor.small_batch_splits()));
+  // no empty parts
+  const IdxT clusters_per_split = div_rounding_up_safe<IdxT>(n_clusters, IdxT(n_splits));
+  n_splits = uint32_t(div_rounding_up_safe<IdxT>(n_clusters, clusters_per_split));
+
+  const MathT* centers_norm = predictor.metric() == raft::distance::DistanceType::InnerProduct
+                                ? nullptr
+                                : predictor.centroids_norm().data_handle();
+  const dim3 grid_dim(n_rows, n_splits);
+  predict_small_batch_kernel<<<grid_dim, kSmallBatchBlockDim, dim * sizeof(MathT), stream>>>(
+    dataset,
+    dim,
+    centers.data_handle(),
+    centers_norm,
+    n_clusters,
+    clusters_per_split,
+    predictor.workspace(),
+    mapping_op);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  select_small_batch_kernel<<<1, predictor.kMaxSmallBatch, 0, stream>>>(
+    predictor.workspace(), n_rows, n_splits, labels);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/** See the public interface `kmeans_balanced::make_predictor`. */
+template <typename MathT, typename IdxT>
+auto make_predictor(const raft::resources& handle,
+                    const kmeans_balanced_params& params,
+                    raft::device_matrix_view<const MathT, IdxT> centers)
+  -> kmeans_balanced::predictor<MathT, IdxT>
+{
+  RAFT_EXPECTS(params.metric == raft::distance::DistanceType::L2Expanded ||
+                 params.metric == raft::distance::DistanceType::L2SqrtExpanded ||
+                 params.metric == raft::distance::DistanceType::InnerProduct,
+               "The chosen distance metric is not supported (%d)",
+               int(params.metric));
+  kmeans_balanced::predictor<MathT, IdxT> predictor(
+    handle,
+    params.metric,
+    centers,
+    small_batch_splits<MathT>(handle, centers.extent(0), centers.extent(1)));
+  if (predictor.metric() != raft::distance::DistanceType::InnerProduct) {
+    raft::linalg::rowNorm<MathT, IdxT>(predictor.centroids_norm().data_handle(),
+                                       centers.data_handle(),
+                                       centers.extent(1),
+                                       centers.extent(0),
+                                       raft::linalg::L2Norm,
+                                       true,
+                                       resource::get_cuda_stream(handle));
+  }
+  return predictor;
+}
+
+/** See the public interface `kmeans_balanced::predict` with a predictor. */
+template <typename T, typename MathT, typename IdxT, typename LabelT, typename MappingOpT>
+void predict(const raft::resources& handle,
+             const kmeans_balanced::predictor<MathT, IdxT>& predictor,
+             const T* dataset,
+             IdxT n_rows,
+             LabelT* labels,
+             MappingOpT mapping_op)
+{
+  if (n_rows == 0) { return; }
+  if (n_rows <= IdxT(predictor.kMaxSmallBatch) && predictor.small_batch_splits() > 0) {
+    return predict_small_batch(handle, predictor, dataset, n_rows, labels, mapping_op);
   }
+  kmeans_balanced_params params;
+  params.metric             = predictor.metric();
+  auto centers              = predictor.centroids();
+  const MathT* centers_norm = predictor.metric() == raft::distance::DistanceType::InnerProduct
+                                ? nullptr
+                                : predictor.centroids_norm().data_handle();
+  predict(handle,
+          params,
+          centers.data_handle(),
+          centers.extent(0),
+          centers.extent(1),
+          dataset,
+          n_rows,
+          labels,
+          mapping_op,
+          nullptr,
+          nullptr,
+          centers_norm);
 }
 
 template <uint32_t BlockDimY,
@@ -635,6 +872,7 @@ void balancing_em_iters(const raft::resources& handle,
   auto stream                = resource::get_cuda_stream(handle);
   uint32_t balancing_counter = balancing_pullback;
   for (uint32_t iter = 0; iter < n_iters; iter++) {
+    resource::check_cancellation(handle);
     // Balancing step - move the centers around to equalize cluster sizes
     // (but not on the first iteration)
     if (iter > 0 && adjust_centers(cluster_centers,
@@ -817,22 +1055,37 @@ inline auto arrange_fine_clusters(IdxT n_clusters,
                          std::move(fine_clusters_csum));
 }
 
+template <typename T, typename MathT, typename IdxT, typename MappingOpT>
+void build_hierarchical(const raft::resources& handle,
+                        const kmeans_balanced_params& params,
+                        IdxT dim,
+                        const T* dataset,
+                        IdxT n_rows,
+                        MathT* cluster_centers,
+                        IdxT n_clusters,
+                        MappingOpT mapping_op);
+
 /**
  *  Given the (coarse) mesoclusters and the distribution of fine clusters within them,
  *  build the fine clusters.
  *
- *  Processing one mesocluster at a time:
+ *  The training points of all the mesoclusters are first bucketed in a single pass over the
+ *  labels. Then, processing one mesocluster at a time:
  *   1. Copy mesocluster data into a separate buffer
  *   2. Predict fine cluster
  *   3. Refince the fine cluster centers
  *
+ *  When the handle has a stream pool, the mesoclusters are distributed over its streams, so that
+ *  the (small) fine clusterings run concurrently. When `params.hierarchy_levels > 2`, the fine
+ *  clusters of a mesocluster are themselves built hierarchically, with one level less.
+ *
  *  As a result, the fine clusters are what is returned by `build_hierarchical`;
  *  this function returns the total number of fine clusters, which can be checked to be
  *  the same as the requested number of clusters.
  *
- *  Note: this function uses at most `fine_clusters_nums_max` points per mesocluster for training;
- *  if one of the clusters is larger than that (as given by `mesocluster_sizes`), the extra data
- *  is ignored and a warning is reported.
+ *  Note: this function uses at most `mesocluster_size_max` points per mesocluster for training
+ *  (and at most `params.max_train_points_per_cluster` points per fine cluster, if set); if one of
+ *  the clusters is larger than that (as given by `mesocluster_sizes`), the extra data is ignored.
  */
 template <typename T,
           typename MathT,
@@ -855,37 +1108,82 @@ auto build_fine_clusters(const raft::resources& handle,
                          IdxT fine_clusters_nums_max,
                          MathT* cluster_centers,
                          MappingOpT mapping_op,
-                         rmm::mr::device_memory_resource* managed_memory,
                          rmm::mr::device_memory_resource* device_memory) -> IdxT
 {
   auto stream = resource::get_cuda_stream(handle);
-  rmm::device_uvector<IdxT> mc_trainset_ids_buf(mesocluster_size_max, stream, managed_memory);
-  rmm::device_uvector<MathT> mc_trainset_buf(mesocluster_size_max * dim, stream, device_memory);
-  rmm::device_uvector<MathT> mc_trainset_norm_buf(mesocluster_size_max, stream, device_memory);
-  auto mc_trainset_ids  = mc_trainset_ids_buf.data();
-  auto mc_trainset      = mc_trainset_buf.data();
-  auto mc_trainset_norm = mc_trainset_norm_buf.data();
+
+  // Bucket the training points by mesocluster: a counting sort of the row ids, keeping at most
+  // `mc_limits[i]` first rows of the mesocluster `i`.
+  std::vector<IdxT> mc_limits(n_mesoclusters);
+  std::vector<IdxT> mc_offsets(n_mesoclusters + 1, 0);
+  for (IdxT i = 0; i < n_mesoclusters; i++) {
+    IdxT limit = mesocluster_size_max;
+    if (params.max_train_points_per_cluster > 0) {
+      limit = std::min<IdxT>(limit, params.max_train_points_per_cluster * fine_clusters_nums[i]);
+    }
+    mc_limits[i]      = std::min<IdxT>(limit, static_cast<IdxT>(mesocluster_sizes[i]));
+    mc_offsets[i + 1] = mc_offsets[i] + mc_limits[i];
+  }
+  std::vector<IdxT> mc_counts(n_mesoclusters, 0);
+  std::vector<IdxT> mc_trainset_ids_host(mc_offsets[n_mesoclusters]);
+  for (IdxT j = 0; j < n_rows; j++) {
+    auto i = static_cast<IdxT>(labels_mptr[j]);
+    if (i >= n_mesoclusters) { continue; }
+    if (mc_counts[i] < mc_limits[i]) { mc_trainset_ids_host[mc_offsets[i] + mc_counts[i]] = j; }
+    mc_counts[i]++;
+  }
+  rmm::device_uvector<IdxT> mc_trainset_ids_buf(
+    mc_trainset_ids_host.size(), stream, device_memory);
+  raft::copy(
+    mc_trainset_ids_buf.data(), mc_trainset_ids_host.data(), mc_trainset_ids_host.size(), stream);
+
+  // With a stream pool, every stream trains its share of the mesoclusters in its own buffers;
+  // the streams share the cublas handle of the main resources, which is created here not to
+  // create one per stream.
+  size_t n_streams = 1;
+  if (handle.has_resource_factory(resource::resource_type::CUDA_STREAM_POOL)) {
+    n_streams = std::clamp<size_t>(
+      resource::get_stream_pool_size(handle), 1, std::max<size_t>(n_mesoclusters, 1));
+  }
+  if (n_streams > 1) { resource::get_cublas_handle(handle); }
+  std::vector<std::unique_ptr<raft::resources>> stream_handles;
+  for (size_t s = 0; s < n_streams; s++) {
+    stream_handles.push_back(std::make_unique<raft::resources>(handle));
+    if (n_streams > 1) {
+      resource::set_cuda_stream(*stream_handles.back(),
+                                resource::get_stream_from_stream_pool(handle, s));
+    }
+  }
+
+  // The buffers are allocated on the main stream and released after the pool is synchronized.
+  const size_t trainset_size_max = *std::max_element(mc_limits.begin(), mc_limits.end());
+  rmm::device_uvector<MathT> mc_trainset_buf(
+    n_streams * trainset_size_max * dim, stream, device_memory);
+  rmm::device_uvector<MathT> mc_trainset_norm_buf(
+    n_streams * trainset_size_max, stream, device_memory);
 
   // label (cluster ID) of each vector
-  rmm::device_uvector<LabelT> mc_trainset_labels(mesocluster_size_max, stream, device_memory);
+  rmm::device_uvector<LabelT> mc_trainset_labels_buf(
+    n_streams * trainset_size_max, stream, device_memory);
 
-  rmm::device_uvector<MathT> mc_trainset_ccenters(
-    fine_clusters_nums_max * dim, stream, device_memory);
+  rmm::device_uvector<MathT> mc_trainset_ccenters_buf(
+    n_streams * fine_clusters_nums_max * dim, stream, device_memory);
   // number of vectors in each cluster
-  rmm::device_uvector<CounterT> mc_trainset_csizes_tmp(
-    fine_clusters_nums_max, stream, device_memory);
+  rmm::device_uvector<CounterT> mc_trainset_csizes_buf(
+    n_streams * fine_clusters_nums_max, stream, device_memory);
+
+  // Make the streams of the pool wait for the buffers and the ids prepared on the main stream
+  if (n_streams > 1) { resource::wait_stream_pool_on_stream(handle); }
 
   // Training clusters in each meso-cluster
   IdxT n_clusters_done = 0;
+  size_t n_mc_done     = 0;
   for (IdxT i = 0; i < n_mesoclusters; i++) {
-    IdxT k = 0;
-    for (IdxT j = 0; j < n_rows && k < mesocluster_size_max; j++) {
-      if (labels_mptr[j] == LabelT(i)) { mc_trainset_ids[k++] = j; }
-    }
-    if (k != static_cast<IdxT>(mesocluster_sizes[i]))
+    IdxT k = mc_limits[i];
+    if (mc_counts[i] != static_cast<IdxT>(mesocluster_sizes[i]))
       RAFT_LOG_WARN("Incorrect mesocluster size at %d. %zu vs %zu",
                     static_cast<int>(i),
-                    static_cast<size_t>(k),
+                    static_cast<size_t>(mc_counts[i]),
                     static_cast<size_t>(mesocluster_sizes[i]));
     if (k == 0) {
       RAFT_LOG_DEBUG("Empty cluster %d", i);
@@ -898,37 +1196,68 @@ auto build_fine_clusters(const raft::resources& handle,
                    "Number of fine clusters must be non-zero for a non-empty mesocluster");
     }
 
+    const size_t s            = n_mc_done++ % n_streams;
+    const auto& mc_res        = *stream_handles[s];
+    auto mc_stream            = resource::get_cuda_stream(mc_res);
+    auto mc_trainset_ids      = mc_trainset_ids_buf.data() + mc_offsets[i];
+    auto mc_trainset          = mc_trainset_buf.data() + s * trainset_size_max * dim;
+    auto mc_trainset_norm     = mc_trainset_norm_buf.data() + s * trainset_size_max;
+    auto mc_trainset_labels   = mc_trainset_labels_buf.data() + s * trainset_size_max;
+    auto mc_trainset_ccenters = mc_trainset_ccenters_buf.data() + s * fine_clusters_nums_max * dim;
+    auto mc_trainset_csizes   = mc_trainset_csizes_buf.data() + s * fine_clusters_nums_max;
+
     cub::TransformInputIterator<MathT, MappingOpT, const T*> mapping_itr(dataset_mptr, mapping_op);
-    raft::matrix::gather(mapping_itr, dim, n_rows, mc_trainset_ids, k, mc_trainset, stream);
+    raft::matrix::gather(mapping_itr, dim, n_rows, mc_trainset_ids, k, mc_trainset, mc_stream);
     if (params.metric == raft::distance::DistanceType::L2Expanded ||
         params.metric == raft::distance::DistanceType::L2SqrtExpanded) {
-      thrust::gather(resource::get_thrust_policy(handle),
+      thrust::gather(resource::get_thrust_policy(mc_res),
                      mc_trainset_ids,
                      mc_trainset_ids + k,
                      dataset_norm_mptr,
                      mc_trainset_norm);
     }
 
-    build_clusters(handle,
-                   params,
-                   dim,
-                   mc_trainset,
-                   k,
-                   fine_clusters_nums[i],
-                   mc_trainset_ccenters.data(),
-                   mc_trainset_labels.data(),
-                   mc_trainset_csizes_tmp.data(),
-                   mapping_op,
-                   device_memory,
-                   mc_trainset_norm);
+    if (params.hierarchy_levels > 2 && fine_clusters_nums[i] > 1) {
+      // The mesocluster data is already mapped to MathT
+      auto sub_params             = params;
+      sub_params.hierarchy_levels = params.hierarchy_levels - 1;
+      build_hierarchical(mc_res,
+                         sub_params,
+                         dim,
+                         static_cast<const MathT*>(mc_trainset),
+                         k,
+                         mc_trainset_ccenters,
+                         fine_clusters_nums[i],
+                         raft::identity_op());
+    } else {
+      build_clusters(mc_res,
+                     params,
+                     dim,
+                     mc_trainset,
+                     k,
+                     fine_clusters_nums[i],
+                     mc_trainset_ccenters,
+                     mc_trainset_labels,
+                     mc_trainset_csizes,
+                     mapping_op,
+                     device_memory,
+                     mc_trainset_norm);
+    }
 
     raft::copy(cluster_centers + (dim * fine_clusters_csum[i]),
-               mc_trainset_ccenters.data(),
+               mc_trainset_ccenters,
                fine_clusters_nums[i] * dim,
-               stream);
-    resource::sync_stream(handle, stream);
+               mc_stream);
     n_clusters_done += fine_clusters_nums[i];
   }
+
+  if (n_streams > 1) {
+    std::vector<std::size_t> stream_indices(n_streams);
+    std::iota(stream_indices.begin(), stream_indices.end(), 0);
+    resource::sync_stream_pool(handle, stream_indices);
+  } else {
+    resource::sync_stream(handle, stream);
+  }
   return n_clusters_done;
 }
 
@@ -968,8 +1297,13 @@ void build_hierarchical(const raft::resources& handle,
   common::nvtx::range<common::nvtx::domain::raft> fun_scope(
     "build_hierarchical(%zu, %u)", static_cast<size_t>(n_rows), n_clusters);
 
-  IdxT n_mesoclusters = std::min(n_clusters, static_cast<IdxT>(std::sqrt(n_clusters) + 0.5));
-  RAFT_LOG_DEBUG("build_hierarchical: n_mesoclusters: %u", n_mesoclusters);
+  // Every level trains about n_clusters^(1 / n_levels) clusters.
+  const uint32_t n_levels = std::max<uint32_t>(params.hierarchy_levels, 2);
+  IdxT n_mesoclusters     = std::min(
+    n_clusters, static_cast<IdxT>(std::pow(double(n_clusters), 1.0 / n_levels) + 0.5));
+  n_mesoclusters = std::max<IdxT>(n_mesoclusters, 1);
+  RAFT_LOG_DEBUG(
+    "build_hierarchical: n_levels: %u, n_mesoclusters: %u", n_levels, n_mesoclusters);
 
   // TODO: Remove the explicit managed memory- we shouldn't be creating this on the user's behalf.
   rmm::mr::managed_memory_resource managed_memory;
@@ -1006,18 +1340,76 @@ void build_hierarchical(const raft::resources& handle,
   rmm::device_uvector<CounterT> mesocluster_sizes_buf(n_mesoclusters, stream, &managed_memory);
   {
     rmm::device_uvector<MathT> mesocluster_centers_buf(n_mesoclusters * dim, stream, device_memory);
-    build_clusters(handle,
-                   params,
-                   dim,
-                   dataset,
-                   n_rows,
-                   n_mesoclusters,
-                   mesocluster_centers_buf.data(),
-                   mesocluster_labels_buf.data(),
-                   mesocluster_sizes_buf.data(),
-                   mapping_op,
-                   device_memory,
-                   dataset_norm);
+    const size_t n_train_max = size_t(params.max_train_points_per_cluster) * n_mesoclusters;
+    if (n_train_max > 0 && n_train_max < size_t(n_rows)) {
+      // Train the mesoclusters on a random subsample of the dataset, then assign all the rows to
+      // them (which also updates the centers with all the data).
+      const auto n_train = static_cast<IdxT>(n_train_max);
+      rmm::device_uvector<IdxT> train_ids(n_train, stream, device_memory);
+      rmm::device_uvector<T> trainset(size_t(n_train) * dim, stream, device_memory);
+      rmm::device_uvector<MathT> trainset_norm(0, stream, device_memory);
+      rmm::device_uvector<LabelT> trainset_labels(n_train, stream, device_memory);
+      raft::random::RngState random_state{137};
+      raft::random::detail::sample_indices_without_replacement(
+        handle, random_state, train_ids.data(), n_train, n_rows);
+      raft::matrix::gather(
+        dataset, dim, n_rows, train_ids.data(), n_train, trainset.data(), stream);
+      if (dataset_norm != nullptr) {
+        trainset_norm.resize(n_train, stream);
+        thrust::gather(resource::get_thrust_policy(handle),
+                       train_ids.data(),
+                       train_ids.data() + n_train,
+                       dataset_norm,
+                       trainset_norm.data());
+      }
+      build_clusters(handle,
+                     params,
+                     dim,
+                     static_cast<const T*>(trainset.data()),
+                     n_train,
+                     n_mesoclusters,
+                     mesocluster_centers_buf.data(),
+                     trainset_labels.data(),
+                     mesocluster_sizes_buf.data(),
+                     mapping_op,
+                     device_memory,
+                     dataset_norm != nullptr ? trainset_norm.data() : nullptr);
+      predict(handle,
+              params,
+              mesocluster_centers_buf.data(),
+              n_mesoclusters,
+              dim,
+              dataset,
+              n_rows,
+              mesocluster_labels_buf.data(),
+              mapping_op,
+              device_memory,
+              dataset_norm);
+      calc_centers_and_sizes(handle,
+                             mesocluster_centers_buf.data(),
+                             mesocluster_sizes_buf.data(),
+                             n_mesoclusters,
+                             dim,
+                             dataset,
+                             n_rows,
+                             mesocluster_labels_buf.data(),
+                             true,
+                             mapping_op,
+                             device_memory);
+    } else {
+      build_clusters(handle,
+                     params,
+                     dim,
+                     dataset,
+                     n_rows,
+                     n_mesoclusters,
+                     mesocluster_centers_buf.data(),
+                     mesocluster_labels_buf.data(),
+                     mesocluster_sizes_buf.data(),
+                     mapping_op,
+                     device_memory,
+                     dataset_norm);
+    }
   }
 
   auto mesocluster_sizes  = mesocluster_sizes_buf.data();
@@ -1059,7 +1451,6 @@ void build_hierarchical(const raft::resources& handle,
                                              fine_clusters_nums_max,
                                              cluster_centers,
                                              mapping_op,
-                                             &managed_memory,
                                              device_memory);
   RAFT_EXPECTS(n_clusters_done == n_clusters, "Didn't process all clusters.");
 
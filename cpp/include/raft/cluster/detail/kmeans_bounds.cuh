@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/cluster/detail/kmeans_common.cuh>
+#include <raft/cluster/kmeans_types.hpp>
+#include <raft/common/nvtx.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/kvp.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/math.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/matrix/gather.cuh>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/reduction.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/copy.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/reduce.h>
+#include <thrust/sequence.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace raft::cluster::detail {
+
+// =========================================================
+// Hamerly's bounds ("Making k-means even faster", G. Hamerly, SDM 2010)
+// =========================================================
+//
+// Every sample keeps a lower bound `l` on the distance to its second closest centroid. After the
+// centroids move by at most `max_shift`, `l - max_shift` is still a lower bound; the distance `u`
+// to the assigned centroid is recomputed exactly (O(n_features) per sample). The assignment
+// cannot change if `u <= max(l, s)`, `s` being half the distance from the assigned centroid to
+// its nearest other centroid; only the samples failing this test are compared with all the
+// centroids.
+
+constexpr int kBoundsBlockSize = 256;  // one row per warp
+
+/** The nearest and second nearest column of a row (all the lanes get the result). */
+template <typename DataT, typename IndexT>
+struct top2_t {
+  DataT best;
+  DataT second;
+  IndexT best_idx;
+
+  DI void add(DataT v, IndexT i)
+  {
+    if (v < best || (v == best && i < best_idx)) {
+      second   = best;
+      best     = v;
+      best_idx = i;
+    } else if (v < second) {
+      second = v;
+    }
+  }
+
+  DI void warp_merge()
+  {
+    for (int stride = WarpSize / 2; stride > 0; stride /= 2) {
+      DataT o_best    = shfl_xor(best, stride);
+      DataT o_second  = shfl_xor(second, stride);
+      IndexT o_idx    = shfl_xor(best_idx, stride);
+      const bool mine = best < o_best || (best == o_best && best_idx < o_idx);
+      second          = mine ? raft::min(second, o_best) : raft::min(o_second, best);
+      best            = mine ? best : o_best;
+      best_idx        = mine ? best_idx : o_idx;
+    }
+  }
+};
+
+template <typename DataT, typename IndexT>
+DI auto row_top2(const DataT* row, IndexT n_cols) -> top2_t<DataT, IndexT>
+{
+  top2_t<DataT, IndexT> r{upper_bound<DataT>(), upper_bound<DataT>(), IndexT(0)};
+  for (IndexT j = laneId(); j < n_cols; j += WarpSize) {
+    r.add(row[j], j);
+  }
+  r.warp_merge();
+  return r;
+}
+
+/**
+ * Assign the rows of a tile of (squared L2) distances to their nearest centroid and reset the
+ * lower bounds of the corresponding samples.
+ */
+template <typename DataT, typename IndexT>
+RAFT_KERNEL hamerly_assign_kernel(const DataT* dist,
+                                  IndexT n_rows,
+                                  IndexT n_clusters,
+                                  const IndexT* sample_ids,
+                                  bool sqrt_out,
+                                  raft::KeyValuePair<IndexT, DataT>* min_cluster_and_dist,
+                                  DataT* lower)
+{
+  const IndexT row = (IndexT(blockIdx.x) * blockDim.x + threadIdx.x) / WarpSize;
+  if (row >= n_rows) { return; }
+  auto r = row_top2(dist + size_t(row) * n_clusters, n_clusters);
+  if (laneId() == 0) {
+    const IndexT i = sample_ids[row];
+    const DataT d2 = raft::max(r.best, DataT(0));
+    raft::KeyValuePair<IndexT, DataT> kvp;
+    kvp.key                 = r.best_idx;
+    kvp.value               = sqrt_out ? raft::sqrt(d2) : d2;
+    min_cluster_and_dist[i] = kvp;
+    lower[i]                = raft::sqrt(raft::max(r.second, DataT(0)));
+  }
+}
+
+/** Half the distance from every centroid to its nearest other centroid. */
+template <typename DataT, typename IndexT>
+RAFT_KERNEL half_separation_kernel(const DataT* dist, IndexT n_clusters, DataT* half_sep)
+{
+  const IndexT row = (IndexT(blockIdx.x) * blockDim.x + threadIdx.x) / WarpSize;
+  if (row >= n_clusters) { return; }
+  // the nearest centroid is the centroid itself
+  auto r = row_top2(dist + size_t(row) * n_clusters, n_clusters);
+  if (laneId() == 0) { half_sep[row] = DataT(0.5) * raft::sqrt(raft::max(r.second, DataT(0))); }
+}
+
+/**
+ * Recompute the exact distance of every sample to its assigned centroid, relax its lower bound,
+ * and flag the samples whose assignment may have changed.
+ */
+template <typename DataT, typename IndexT>
+RAFT_KERNEL hamerly_filter_kernel(const DataT* X,
+                                  const DataT* centroids,
+                                  IndexT n_samples,
+                                  IndexT n_features,
+                                  const DataT* half_sep,
+                                  DataT max_shift,
+                                  bool sqrt_out,
+                                  raft::KeyValuePair<IndexT, DataT>* min_cluster_and_dist,
+                                  DataT* lower,
+                                  uint8_t* active)
+{
+  const IndexT row = (IndexT(blockIdx.x) * blockDim.x + threadIdx.x) / WarpSize;
+  if (row >= n_samples) { return; }
+  const IndexT a = min_cluster_and_dist[row].key;
+  const DataT* x = X + size_t(row) * n_features;
+  const DataT* c = centroids + size_t(a) * n_features;
+  DataT d2       = 0;
+  for (IndexT j = laneId(); j < n_features; j += WarpSize) {
+    const DataT diff = x[j] - c[j];
+    d2 += diff * diff;
+  }
+  d2 = raft::warpReduce(d2);
+  if (laneId() == 0) {
+    const DataT u                   = raft::sqrt(d2);
+    const DataT l                   = lower[row] - max_shift;
+    lower[row]                      = l;
+    min_cluster_and_dist[row].value = sqrt_out ? u : d2;
+    active[row]                     = u > raft::max(half_sep[a], l);
+  }
+}
+
+/** The distance every centroid moved by. */
+template <typename DataT, typename IndexT>
+RAFT_KERNEL centroid_shift_kernel(const DataT* old_centroids,
+                                  const DataT* new_centroids,
+                                  IndexT n_clusters,
+                                  IndexT n_features,
+                                  DataT* shift)
+{
+  const IndexT row = (IndexT(blockIdx.x) * blockDim.x + threadIdx.x) / WarpSize;
+  if (row >= n_clusters) { return; }
+  DataT d2 = 0;
+  for (IndexT j = laneId(); j < n_features; j += WarpSize) {
+    const DataT diff = new_centroids[size_t(row) * n_features + j] -
+                       old_centroids[size_t(row) * n_features + j];
+    d2 += diff * diff;
+  }
+  d2 = raft::warpReduce(d2);
+  if (laneId() == 0) { shift[row] = raft::sqrt(d2); }
+}
+
+template <typename IndexT>
+inline auto bounds_grid(IndexT n_rows) -> dim3
+{
+  constexpr IndexT kRowsPerBlock = kBoundsBlockSize / WarpSize;
+  return dim3(static_cast<unsigned>(raft::ceildiv<IndexT>(n_rows, kRowsPerBlock)));
+}
+
+/** The state of the bounded assignment, carried over the iterations of kmeans_fit_main. */
+template <typename DataT, typename IndexT>
+struct hamerly_bounds {
+  /** A lower bound on the distance of every sample to its second nearest centroid. */
+  raft::device_vector<DataT, IndexT> lower;
+  raft::device_vector<uint8_t, IndexT> active;
+  raft::device_vector<IndexT, IndexT> active_ids;
+  /** The largest centroid move since the last assignment. */
+  DataT max_shift  = 0;
+  bool initialized = false;
+
+  hamerly_bounds(raft::resources const& handle, IndexT n_samples)
+    : lower(raft::make_device_vector<DataT, IndexT>(handle, n_samples)),
+      active(raft::make_device_vector<uint8_t, IndexT>(handle, n_samples)),
+      active_ids(raft::make_device_vector<IndexT, IndexT>(handle, n_samples))
+  {
+  }
+};
+
+/**
+ * @brief Computes minClusterAndDistance like minClusterAndDistanceCompute (L2 metrics only),
+ *   skipping the samples whose assignment provably did not change since the previous call.
+ *
+ * The first call compares all the samples with all the centroids and initializes the bounds;
+ * bounds.max_shift must be set to the largest centroid move before every following call.
+ */
+template <typename DataT, typename IndexT>
+void hamerly_assign(
+  raft::resources const& handle,
+  const KMeansParams& params,
+  raft::device_matrix_view<const DataT, IndexT> X,
+  raft::device_matrix_view<const DataT, IndexT> centroids,
+  hamerly_bounds<DataT, IndexT>& bounds,
+  raft::device_vector_view<raft::KeyValuePair<IndexT, DataT>, IndexT> minClusterAndDistance,
+  rmm::device_uvector<char>& workspace)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("hamerly_assign");
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_samples      = X.extent(0);
+  auto n_features     = X.extent(1);
+  auto n_clusters     = centroids.extent(0);
+  const bool sqrt_out = params.metric == raft::distance::DistanceType::L2SqrtExpanded;
+
+  IndexT n_active = n_samples;
+  if (!bounds.initialized) {
+    thrust::sequence(resource::get_thrust_policy(handle),
+                     bounds.active_ids.data_handle(),
+                     bounds.active_ids.data_handle() + n_samples);
+    bounds.initialized = true;
+  } else {
+    auto half_sep = raft::make_device_vector<DataT, IndexT>(handle, n_clusters);
+    auto cdist    = raft::make_device_matrix<DataT, IndexT>(handle, n_clusters, n_clusters);
+    detail::pairwise_distance_kmeans<DataT, IndexT>(handle,
+                                                    centroids,
+                                                    centroids,
+                                                    cdist.view(),
+                                                    workspace,
+                                                    raft::distance::DistanceType::L2Expanded);
+    half_separation_kernel<<<bounds_grid(n_clusters), kBoundsBlockSize, 0, stream>>>(
+      cdist.data_handle(), n_clusters, half_sep.data_handle());
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+    hamerly_filter_kernel<<<bounds_grid(n_samples), kBoundsBlockSize, 0, stream>>>(
+      X.data_handle(),
+      centroids.data_handle(),
+      n_samples,
+      n_features,
+      half_sep.data_handle(),
+      bounds.max_shift,
+      sqrt_out,
+      minClusterAndDistance.data_handle(),
+      bounds.lower.data_handle(),
+      bounds.active.data_handle());
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+    const uint8_t* active = bounds.active.data_handle();
+    auto end = thrust::copy_if(resource::get_thrust_policy(handle),
+                               thrust::make_counting_iterator<IndexT>(0),
+                               thrust::make_counting_iterator<IndexT>(n_samples),
+                               bounds.active_ids.data_handle(),
+                               [active] __device__(IndexT i) { return active[i] != 0; });
+    n_active = end - bounds.active_ids.data_handle();
+  }
+  RAFT_LOG_DEBUG("KMeans.fit: %d of %d samples compared with all the centroids",
+                 static_cast<int>(n_active),
+                 static_cast<int>(n_samples));
+  if (n_active == 0) { return; }
+
+  // the samples left are compared with all the centroids, in tiles of batch_samples rows
+  auto tile_size = getDataBatchSize(params.batch_samples, n_active);
+  auto rows      = raft::make_device_matrix<DataT, IndexT>(handle, tile_size, n_features);
+  auto dist      = raft::make_device_matrix<DataT, IndexT>(handle, tile_size, n_clusters);
+  for (IndexT offset = 0; offset < n_active; offset += tile_size) {
+    auto len          = std::min<IndexT>(tile_size, n_active - offset);
+    const IndexT* ids = bounds.active_ids.data_handle() + offset;
+    raft::matrix::gather(
+      X.data_handle(), n_features, n_samples, ids, len, rows.data_handle(), stream);
+    detail::pairwise_distance_kmeans<DataT, IndexT>(
+      handle,
+      raft::make_device_matrix_view<const DataT, IndexT>(rows.data_handle(), len, n_features),
+      centroids,
+      raft::make_device_matrix_view<DataT, IndexT>(dist.data_handle(), len, n_clusters),
+      workspace,
+      raft::distance::DistanceType::L2Expanded);
+    hamerly_assign_kernel<<<bounds_grid(len), kBoundsBlockSize, 0, stream>>>(
+      dist.data_handle(),
+      len,
+      n_clusters,
+      ids,
+      sqrt_out,
+      minClusterAndDistance.data_handle(),
+      bounds.lower.data_handle());
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+}
+
+/** The largest distance a centroid moved by between two iterations. */
+template <typename DataT, typename IndexT>
+DataT max_centroid_shift(raft::resources const& handle,
+                         raft::device_matrix_view<const DataT, IndexT> old_centroids,
+                         raft::device_matrix_view<const DataT, IndexT> new_centroids)
+{
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_clusters     = old_centroids.extent(0);
+  auto shift          = raft::make_device_vector<DataT, IndexT>(handle, n_clusters);
+  centroid_shift_kernel<<<bounds_grid(n_clusters), kBoundsBlockSize, 0, stream>>>(
+    old_centroids.data_handle(),
+    new_centroids.data_handle(),
+    n_clusters,
+    old_centroids.extent(1),
+    shift.data_handle());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  return thrust::reduce(resource::get_thrust_policy(handle),
+                        shift.data_handle(),
+                        shift.data_handle() + n_clusters,
+                        DataT(0),
+                        raft::max_op{});
+}
+
+}  // namespace raft::cluster::detail
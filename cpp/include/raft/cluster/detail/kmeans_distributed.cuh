@@ -0,0 +1,732 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/cluster/detail/kmeans.cuh>
+#include <raft/cluster/detail/kmeans_common.cuh>
+#include <raft/cluster/kmeans_types.hpp>
+#include <raft/common/nvtx.hpp>
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/kvp.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map_then_reduce.cuh>
+#include <raft/linalg/matrix_vector_op.cuh>
+#include <raft/linalg/norm.cuh>
+#include <raft/linalg/reduce_cols_by_key.cuh>
+#include <raft/linalg/reduce_rows_by_key.cuh>
+#include <raft/linalg/unary_op.cuh>
+#include <raft/matrix/gather.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/fill.h>
+#include <thrust/transform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace raft::cluster::detail {
+
+/** The sum of a host value over all the ranks of the communicator. */
+template <typename T>
+T allreduce_sum(raft::resources const& handle, T value)
+{
+  const auto& comms = resource::get_comms(handle);
+  auto stream       = resource::get_cuda_stream(handle);
+  auto buf          = raft::make_device_scalar<T>(handle, value);
+  comms.allreduce(buf.data_handle(), buf.data_handle(), 1, raft::comms::op_t::SUM, stream);
+  T res = 0;
+  raft::copy(&res, buf.data_handle(), 1, stream);
+  resource::sync_stream(handle, stream);
+  return res;
+}
+
+/** A host value of every rank, in rank order. */
+template <typename T>
+std::vector<T> allgather_values(raft::resources const& handle, T value)
+{
+  const auto& comms = resource::get_comms(handle);
+  auto stream       = resource::get_cuda_stream(handle);
+  auto send         = raft::make_device_scalar<T>(handle, value);
+  auto recv         = raft::make_device_vector<T, int>(handle, comms.get_size());
+  comms.allgather(send.data_handle(), recv.data_handle(), 1, stream);
+  std::vector<T> res(comms.get_size());
+  raft::copy(res.data(), recv.data_handle(), res.size(), stream);
+  resource::sync_stream(handle, stream);
+  return res;
+}
+
+/**
+ * Gather the rows sampled by every rank into `out` (in rank order); `counts[r]` is the number of
+ * rows rank r contributes.
+ */
+template <typename DataT, typename IndexT>
+void allgather_rows(raft::resources const& handle,
+                    const DataT* local_rows,
+                    const std::vector<IndexT>& counts,
+                    IndexT n_features,
+                    DataT* out)
+{
+  const auto& comms = resource::get_comms(handle);
+  std::vector<size_t> recvcounts(counts.size());
+  std::vector<size_t> displs(counts.size());
+  size_t offset = 0;
+  for (size_t r = 0; r < counts.size(); r++) {
+    recvcounts[r] = size_t(counts[r]) * n_features;
+    displs[r]     = offset;
+    offset += recvcounts[r];
+  }
+  comms.allgatherv(
+    local_rows, out, recvcounts.data(), displs.data(), resource::get_cuda_stream(handle));
+}
+
+/** Scale the local weights so that the weights of all the ranks sum up to the global n_samples. */
+template <typename DataT, typename IndexT>
+void checkWeightDistributed(raft::resources const& handle,
+                            raft::device_vector_view<DataT, IndexT> weight,
+                            IndexT n_global_samples)
+{
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto wt_aggr        = raft::make_device_scalar<DataT>(handle, 0);
+  raft::linalg::mapThenSumReduce(
+    wt_aggr.data_handle(), weight.extent(0), raft::identity_op{}, stream, weight.data_handle());
+  DataT local_sum = 0;
+  raft::copy(&local_sum, wt_aggr.data_handle(), 1, stream);
+  resource::sync_stream(handle, stream);
+  auto wt_sum = allreduce_sum(handle, local_sum);
+
+  if (wt_sum != n_global_samples) {
+    RAFT_LOG_DEBUG(
+      "[Warning!] KMeans: normalizing the user provided sample weight to "
+      "sum up to %d samples",
+      static_cast<int>(n_global_samples));
+
+    auto scale = static_cast<DataT>(n_global_samples) / wt_sum;
+    raft::linalg::unaryOp(weight.data_handle(),
+                          weight.data_handle(),
+                          weight.extent(0),
+                          raft::mul_const_op<DataT>{scale},
+                          stream);
+  }
+}
+
+/**
+ * @brief Draw `centroids.extent(0)` distinct samples uniformly from the union of the partitions.
+ *
+ * All the ranks draw the same global sample ids (same seed), so every rank knows which of its
+ * rows to contribute, and the rows are then allgathered.
+ */
+template <typename DataT, typename IndexT>
+void initRandomDistributed(raft::resources const& handle,
+                           const KMeansParams& params,
+                           raft::device_matrix_view<const DataT, IndexT> X,
+                           raft::device_matrix_view<DataT, IndexT> centroids)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("initRandomDistributed");
+  const auto& comms   = resource::get_comms(handle);
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  const int rank      = comms.get_rank();
+  auto n_features     = X.extent(1);
+  auto n_clusters     = centroids.extent(0);
+
+  auto local_sizes = allgather_values<IndexT>(handle, X.extent(0));
+  std::vector<IndexT> rank_offsets(local_sizes.size() + 1, 0);
+  for (size_t r = 0; r < local_sizes.size(); r++) {
+    rank_offsets[r + 1] = rank_offsets[r] + local_sizes[r];
+  }
+  RAFT_EXPECTS(rank_offsets.back() >= n_clusters,
+               "invalid parameter (the total number of samples is smaller than n_clusters)");
+
+  std::mt19937 gen(params.rng_state.seed);
+  std::uniform_int_distribution<IndexT> dis(0, rank_offsets.back() - 1);
+  std::unordered_set<IndexT> chosen;
+  std::vector<IndexT> counts(local_sizes.size(), 0);
+  std::vector<IndexT> h_local_ids;
+  while (IndexT(chosen.size()) < n_clusters) {
+    auto id = dis(gen);
+    if (!chosen.insert(id).second) { continue; }
+    int r =
+      std::upper_bound(rank_offsets.begin(), rank_offsets.end(), id) - rank_offsets.begin() - 1;
+    counts[r]++;
+    if (r == rank) { h_local_ids.push_back(id - rank_offsets[r]); }
+  }
+
+  auto local_ids = raft::make_device_vector<IndexT, IndexT>(handle, h_local_ids.size());
+  raft::copy(local_ids.data_handle(), h_local_ids.data(), h_local_ids.size(), stream);
+  auto local_rows =
+    raft::make_device_matrix<DataT, IndexT>(handle, IndexT(h_local_ids.size()), n_features);
+  raft::matrix::gather(handle, X, raft::make_const_mdspan(local_ids.view()), local_rows.view());
+  allgather_rows(handle, local_rows.data_handle(), counts, n_features, centroids.data_handle());
+}
+
+/**
+ * @brief Distributed scalable k-means++ (k-means||) initialization.
+ *
+ * The same algorithm as initScalableKMeansPlusPlus: every rank samples the candidate centroids
+ * from its own partition with the probability computed from the global cost, and the candidates
+ * of all the ranks are allgathered. The weighted candidates are reclustered on rank 0 and the
+ * result is broadcast.
+ */
+template <typename DataT, typename IndexT>
+void initScalableKMeansPlusPlusDistributed(raft::resources const& handle,
+                                           const KMeansParams& params,
+                                           raft::device_matrix_view<const DataT, IndexT> X,
+                                           raft::device_matrix_view<DataT, IndexT> centroidsRawData,
+                                           rmm::device_uvector<char>& workspace)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "initScalableKMeansPlusPlusDistributed");
+  const auto& comms   = resource::get_comms(handle);
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  const int rank      = comms.get_rank();
+  auto n_samples      = X.extent(0);
+  auto n_features     = X.extent(1);
+  auto n_clusters     = params.n_clusters;
+  auto metric         = params.metric;
+
+  // every rank draws its own candidates
+  raft::random::RngState rng(params.rng_state.seed + rank, params.rng_state.type);
+
+  // <<<< Step-1 >>> : C <- sample a point uniformly at random from X
+  auto local_sizes = allgather_values<IndexT>(handle, n_samples);
+  std::vector<IndexT> rank_offsets(local_sizes.size() + 1, 0);
+  for (size_t r = 0; r < local_sizes.size(); r++) {
+    rank_offsets[r + 1] = rank_offsets[r] + local_sizes[r];
+  }
+  std::mt19937 gen(params.rng_state.seed);
+  std::uniform_int_distribution<IndexT> dis(0, rank_offsets.back() - 1);
+  auto cIdx  = dis(gen);
+  int cOwner = std::upper_bound(rank_offsets.begin(), rank_offsets.end(), cIdx) -
+               rank_offsets.begin() - 1;
+
+  auto isSampleCentroid = raft::make_device_vector<uint8_t, IndexT>(handle, n_samples);
+  thrust::fill(resource::get_thrust_policy(handle),
+               isSampleCentroid.data_handle(),
+               isSampleCentroid.data_handle() + n_samples,
+               0);
+
+  rmm::device_uvector<DataT> centroidsBuf(n_features, stream);
+  if (rank == cOwner) {
+    auto local_idx = cIdx - rank_offsets[rank];
+    uint8_t flag   = 1;
+    raft::copy(isSampleCentroid.data_handle() + local_idx, &flag, 1, stream);
+    raft::copy(centroidsBuf.data(), X.data_handle() + local_idx * n_features, n_features, stream);
+  }
+  comms.bcast(centroidsBuf.data(), n_features, cOwner, stream);
+
+  auto potentialCentroids =
+    raft::make_device_matrix_view<DataT, IndexT>(centroidsBuf.data(), 1, n_features);
+  // <<< End of Step-1 >>>
+
+  rmm::device_uvector<DataT> L2NormBuf_OR_DistBuf(0, stream);
+
+  auto L2NormX = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
+  if (metric == raft::distance::DistanceType::L2Expanded ||
+      metric == raft::distance::DistanceType::L2SqrtExpanded) {
+    raft::linalg::rowNorm(L2NormX.data_handle(),
+                          X.data_handle(),
+                          X.extent(1),
+                          X.extent(0),
+                          raft::linalg::L2Norm,
+                          true,
+                          stream);
+  }
+
+  auto minClusterDistanceVec = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
+  auto uniformRands          = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
+  rmm::device_scalar<DataT> clusterCost(stream);
+
+  // the global cost phi_X(C): the local costs summed over the ranks
+  auto global_cost = [&]() {
+    detail::minClusterDistanceCompute<DataT, IndexT>(handle,
+                                                     X,
+                                                     potentialCentroids,
+                                                     minClusterDistanceVec.view(),
+                                                     L2NormX.view(),
+                                                     L2NormBuf_OR_DistBuf,
+                                                     params.metric,
+                                                     params.batch_samples,
+                                                     params.batch_centroids,
+                                                     workspace);
+    detail::computeClusterCost(handle,
+                               minClusterDistanceVec.view(),
+                               workspace,
+                               raft::make_device_scalar_view(clusterCost.data()),
+                               raft::identity_op{},
+                               raft::add_op{});
+    comms.allreduce(
+      clusterCost.data(), clusterCost.data(), 1, raft::comms::op_t::SUM, stream);
+    return clusterCost.value(stream);
+  };
+
+  // <<< Step-2 >>>: psi <- phi_X (C)
+  auto psi  = global_cost();
+  int niter = std::min(8, (int)ceil(log(psi)));
+  RAFT_LOG_DEBUG("KMeans||: psi = %g, log(psi) = %g, niter = %d ", psi, log(psi), niter);
+
+  // <<<< Step-3 >>> : for O( log(psi) ) times do
+  for (int iter = 0; iter < niter; ++iter) {
+    RAFT_LOG_DEBUG("KMeans|| - Iteration %d: # potential centroids sampled - %d",
+                   iter,
+                   potentialCentroids.extent(0));
+
+    psi = global_cost();
+
+    // <<<< Step-4 >>> : Sample each point x in X independently and identify new
+    // potentialCentroids
+    raft::random::uniform(
+      handle, rng, uniformRands.data_handle(), uniformRands.extent(0), (DataT)0, (DataT)1);
+
+    detail::SamplingOp<DataT, IndexT> select_op(psi,
+                                                params.oversampling_factor,
+                                                n_clusters,
+                                                uniformRands.data_handle(),
+                                                isSampleCentroid.data_handle());
+
+    rmm::device_uvector<DataT> inRankCp(0, stream);
+    detail::sampleCentroids<DataT, IndexT>(handle,
+                                           X,
+                                           minClusterDistanceVec.view(),
+                                           isSampleCentroid.view(),
+                                           select_op,
+                                           inRankCp,
+                                           workspace);
+    /// <<<< End of Step-4 >>>>
+
+    /// <<<< Step-5 >>> : C = C U C', C' being the candidates of all the ranks
+    auto counts = allgather_values<IndexT>(handle, IndexT(inRankCp.size() / n_features));
+    IndexT n_new = 0;
+    for (auto c : counts) {
+      n_new += c;
+    }
+    IndexT n_old = potentialCentroids.extent(0);
+    centroidsBuf.resize((n_old + n_new) * n_features, stream);
+    allgather_rows(
+      handle, inRankCp.data(), counts, n_features, centroidsBuf.data() + n_old * n_features);
+
+    potentialCentroids =
+      raft::make_device_matrix_view<DataT, IndexT>(centroidsBuf.data(), n_old + n_new, n_features);
+    /// <<<< End of Step-5 >>>
+  }  /// <<<< Step-6 >>>
+
+  RAFT_LOG_DEBUG("KMeans||: total # potential centroids sampled - %d",
+                 potentialCentroids.extent(0));
+
+  if ((int)potentialCentroids.extent(0) > n_clusters) {
+    // <<< Step-7 >>>: For x in C, set w_x to be the number of pts closest to X
+    auto weight = raft::make_device_vector<DataT, IndexT>(handle, potentialCentroids.extent(0));
+    detail::countSamplesInCluster<DataT, IndexT>(
+      handle, params, X, L2NormX.view(), potentialCentroids, workspace, weight.view());
+    comms.allreduce(
+      weight.data_handle(), weight.data_handle(), weight.size(), raft::comms::op_t::SUM, stream);
+    // <<< end of Step-7 >>>
+
+    // Step-8: Recluster the weighted points in C into k clusters (on rank 0, whose result is
+    // broadcast, so that all the ranks start from the same centroids)
+    if (rank == 0) {
+      detail::kmeansPlusPlus<DataT, IndexT>(
+        handle, params, potentialCentroids, centroidsRawData, workspace);
+
+      auto inertia = make_host_scalar<DataT>(0);
+      auto n_iter  = make_host_scalar<IndexT>(0);
+      KMeansParams default_params;
+      default_params.n_clusters = params.n_clusters;
+
+      detail::kmeans_fit_main<DataT, IndexT>(handle,
+                                             default_params,
+                                             raft::make_const_mdspan(potentialCentroids),
+                                             raft::make_const_mdspan(weight.view()),
+                                             centroidsRawData,
+                                             inertia.view(),
+                                             n_iter.view(),
+                                             workspace);
+    }
+    comms.bcast(centroidsRawData.data_handle(), centroidsRawData.size(), 0, stream);
+
+  } else if ((int)potentialCentroids.extent(0) < n_clusters) {
+    // supplement with random
+    auto n_random_clusters = n_clusters - potentialCentroids.extent(0);
+
+    RAFT_LOG_DEBUG(
+      "[Warning!] KMeans||: found fewer than %d centroids during "
+      "initialization (found %d centroids, remaining %d centroids will be "
+      "chosen randomly from input samples)",
+      n_clusters,
+      potentialCentroids.extent(0),
+      n_random_clusters);
+
+    initRandomDistributed<DataT, IndexT>(
+      handle,
+      params,
+      X,
+      raft::make_device_matrix_view<DataT, IndexT>(
+        centroidsRawData.data_handle(), n_random_clusters, n_features));
+
+    raft::copy(centroidsRawData.data_handle() + n_random_clusters * n_features,
+               potentialCentroids.data_handle(),
+               potentialCentroids.size(),
+               stream);
+  } else {
+    // found the required n_clusters
+    raft::copy(centroidsRawData.data_handle(),
+               potentialCentroids.data_handle(),
+               potentialCentroids.size(),
+               stream);
+  }
+}
+
+/**
+ * @brief The Lloyd iterations over the partitions of all the ranks.
+ *
+ * Every rank assigns its samples to the (replicated) centroids and computes the per-cluster sums
+ * and weights of its partition; these are allreduced, so that all the ranks compute the same new
+ * centroids and take the same convergence decisions.
+ */
+template <typename DataT, typename IndexT>
+void kmeans_fit_main_distributed(raft::resources const& handle,
+                                 const KMeansParams& params,
+                                 raft::device_matrix_view<const DataT, IndexT> X,
+                                 raft::device_vector_view<const DataT, IndexT> weight,
+                                 raft::device_matrix_view<DataT, IndexT> centroidsRawData,
+                                 raft::host_scalar_view<DataT> inertia,
+                                 raft::host_scalar_view<IndexT> n_iter,
+                                 rmm::device_uvector<char>& workspace)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_fit_main_distributed");
+  logger::get(RAFT_NAME).set_level(params.verbosity);
+  const auto& comms   = resource::get_comms(handle);
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_samples      = X.extent(0);
+  auto n_features     = X.extent(1);
+  auto n_clusters     = params.n_clusters;
+  auto metric         = params.metric;
+
+  auto minClusterAndDistance =
+    raft::make_device_vector<raft::KeyValuePair<IndexT, DataT>, IndexT>(handle, n_samples);
+  rmm::device_uvector<DataT> L2NormBuf_OR_DistBuf(0, stream);
+  auto newCentroids = raft::make_device_matrix<DataT, IndexT>(handle, n_clusters, n_features);
+  auto wtInCluster  = raft::make_device_vector<DataT, IndexT>(handle, n_clusters);
+  rmm::device_scalar<DataT> clusterCostD(stream);
+
+  // L2 norm of X: ||x||^2
+  auto L2NormX = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
+  auto l2normx_view =
+    raft::make_device_vector_view<const DataT, IndexT>(L2NormX.data_handle(), n_samples);
+  if (metric == raft::distance::DistanceType::L2Expanded ||
+      metric == raft::distance::DistanceType::L2SqrtExpanded) {
+    raft::linalg::rowNorm(L2NormX.data_handle(),
+                          X.data_handle(),
+                          X.extent(1),
+                          X.extent(0),
+                          raft::linalg::L2Norm,
+                          true,
+                          stream);
+  }
+
+  DataT priorClusteringCost = 0;
+  for (n_iter[0] = 1; n_iter[0] <= params.max_iter; ++n_iter[0]) {
+    RAFT_LOG_DEBUG("KMeans.fit (distributed): Iteration-%d", n_iter[0]);
+
+    auto centroids = raft::make_device_matrix_view<DataT, IndexT>(
+      centroidsRawData.data_handle(), n_clusters, n_features);
+
+    detail::minClusterAndDistanceCompute<DataT, IndexT>(handle,
+                                                        X,
+                                                        centroids,
+                                                        minClusterAndDistance.view(),
+                                                        l2normx_view,
+                                                        L2NormBuf_OR_DistBuf,
+                                                        params.metric,
+                                                        params.batch_samples,
+                                                        params.batch_centroids,
+                                                        workspace);
+
+    detail::KeyValueIndexOp<IndexT, DataT> conversion_op;
+    cub::TransformInputIterator<IndexT,
+                                detail::KeyValueIndexOp<IndexT, DataT>,
+                                raft::KeyValuePair<IndexT, DataT>*>
+      itr(minClusterAndDistance.data_handle(), conversion_op);
+
+    // the weighted sums of the samples of this partition assigned to each cluster...
+    workspace.resize(n_samples, stream);
+    raft::linalg::reduce_rows_by_key((DataT*)X.data_handle(),
+                                     X.extent(1),
+                                     itr,
+                                     weight.data_handle(),
+                                     workspace.data(),
+                                     X.extent(0),
+                                     X.extent(1),
+                                     n_clusters,
+                                     newCentroids.data_handle(),
+                                     stream);
+    raft::linalg::reduce_cols_by_key(weight.data_handle(),
+                                     itr,
+                                     wtInCluster.data_handle(),
+                                     (IndexT)1,
+                                     (IndexT)weight.extent(0),
+                                     (IndexT)n_clusters,
+                                     stream);
+
+    // ...summed over all the ranks
+    comms.allreduce(newCentroids.data_handle(),
+                    newCentroids.data_handle(),
+                    newCentroids.size(),
+                    raft::comms::op_t::SUM,
+                    stream);
+    comms.allreduce(wtInCluster.data_handle(),
+                    wtInCluster.data_handle(),
+                    wtInCluster.size(),
+                    raft::comms::op_t::SUM,
+                    stream);
+
+    // new_centroids[i] = new_centroids[i] / weight_per_cluster[i], reset to 0 for empty clusters
+    raft::linalg::matrixVectorOp(newCentroids.data_handle(),
+                                 newCentroids.data_handle(),
+                                 wtInCluster.data_handle(),
+                                 newCentroids.extent(1),
+                                 newCentroids.extent(0),
+                                 true,
+                                 false,
+                                 raft::div_checkzero_op{},
+                                 stream);
+
+    // copy centroids[i] to new_centroids[i] when weight_per_cluster[i] is 0
+    cub::ArgIndexInputIterator<DataT*> itr_wt(wtInCluster.data_handle());
+    raft::matrix::gather_if(
+      centroids.data_handle(),
+      static_cast<int>(centroids.extent(1)),
+      static_cast<int>(centroids.extent(0)),
+      itr_wt,
+      itr_wt,
+      static_cast<int>(wtInCluster.size()),
+      newCentroids.data_handle(),
+      [=] __device__(raft::KeyValuePair<ptrdiff_t, DataT> map) { return map.value == 0; },
+      raft::key_op{},
+      stream);
+
+    // the centroids are replicated, so every rank computes the same shift
+    auto sqrdNorm = raft::make_device_scalar(handle, DataT(0));
+    raft::linalg::mapThenSumReduce(sqrdNorm.data_handle(),
+                                   newCentroids.size(),
+                                   raft::sqdiff_op{},
+                                   stream,
+                                   centroids.data_handle(),
+                                   newCentroids.data_handle());
+
+    DataT sqrdNormError = 0;
+    raft::copy(&sqrdNormError, sqrdNorm.data_handle(), sqrdNorm.size(), stream);
+
+    raft::copy(
+      centroidsRawData.data_handle(), newCentroids.data_handle(), newCentroids.size(), stream);
+
+    bool done = false;
+    if (params.inertia_check) {
+      detail::computeClusterCost(handle,
+                                 minClusterAndDistance.view(),
+                                 workspace,
+                                 raft::make_device_scalar_view(clusterCostD.data()),
+                                 raft::value_op{},
+                                 raft::add_op{});
+      comms.allreduce(
+        clusterCostD.data(), clusterCostD.data(), 1, raft::comms::op_t::SUM, stream);
+
+      DataT curClusteringCost = clusterCostD.value(stream);
+
+      ASSERT(curClusteringCost != (DataT)0.0,
+             "Too few points and centroids being found is getting 0 cost from "
+             "centers");
+
+      if (n_iter[0] > 1) {
+        DataT delta = curClusteringCost / priorClusteringCost;
+        if (delta > 1 - params.tol) done = true;
+      }
+      priorClusteringCost = curClusteringCost;
+    }
+
+    resource::sync_stream(handle, stream);
+    if (sqrdNormError < params.tol) done = true;
+
+    if (done) {
+      RAFT_LOG_DEBUG("Threshold triggered after %d iterations. Terminating early.", n_iter[0]);
+      break;
+    }
+  }
+
+  auto centroids = raft::make_device_matrix_view<DataT, IndexT>(
+    centroidsRawData.data_handle(), n_clusters, n_features);
+
+  detail::minClusterAndDistanceCompute<DataT, IndexT>(handle,
+                                                      X,
+                                                      centroids,
+                                                      minClusterAndDistance.view(),
+                                                      l2normx_view,
+                                                      L2NormBuf_OR_DistBuf,
+                                                      params.metric,
+                                                      params.batch_samples,
+                                                      params.batch_centroids,
+                                                      workspace);
+
+  thrust::transform(resource::get_thrust_policy(handle),
+                    minClusterAndDistance.data_handle(),
+                    minClusterAndDistance.data_handle() + minClusterAndDistance.size(),
+                    weight.data_handle(),
+                    minClusterAndDistance.data_handle(),
+                    [=] __device__(const raft::KeyValuePair<IndexT, DataT> kvp, DataT wt) {
+                      raft::KeyValuePair<IndexT, DataT> res;
+                      res.value = kvp.value * wt;
+                      res.key   = kvp.key;
+                      return res;
+                    });
+
+  detail::computeClusterCost(handle,
+                             minClusterAndDistance.view(),
+                             workspace,
+                             raft::make_device_scalar_view(clusterCostD.data()),
+                             raft::value_op{},
+                             raft::add_op{});
+  comms.allreduce(clusterCostD.data(), clusterCostD.data(), 1, raft::comms::op_t::SUM, stream);
+
+  inertia[0] = clusterCostD.value(stream);
+
+  RAFT_LOG_DEBUG("KMeans.fit (distributed): completed after %d iterations with %f inertia[0] ",
+                 n_iter[0] > params.max_iter ? n_iter[0] - 1 : n_iter[0],
+                 inertia[0]);
+}
+
+/**
+ * @brief k-means over a dataset partitioned by rows across the ranks of the communicator.
+ *
+ * The arguments are the ones of kmeans_fit, X and sample_weight being the partition of this
+ * rank; the centroids, inertia and n_iter are the same on all the ranks on return.
+ */
+template <typename DataT, typename IndexT>
+void kmeans_fit_distributed(
+  raft::resources const& handle,
+  const KMeansParams& params,
+  raft::device_matrix_view<const DataT, IndexT> X,
+  std::optional<raft::device_vector_view<const DataT, IndexT>> sample_weight,
+  raft::device_matrix_view<DataT, IndexT> centroids,
+  raft::host_scalar_view<DataT> inertia,
+  raft::host_scalar_view<IndexT> n_iter)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_fit_distributed");
+  auto n_samples      = X.extent(0);
+  auto n_features     = X.extent(1);
+  auto n_clusters     = params.n_clusters;
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  RAFT_EXPECTS(resource::comms_initialized(handle),
+               "the distributed k-means requires a communicator in the resources");
+  if (sample_weight.has_value())
+    RAFT_EXPECTS(sample_weight.value().extent(0) == n_samples,
+                 "invalid parameter (sample_weight!=n_samples)");
+  RAFT_EXPECTS(n_clusters > 0, "invalid parameter (n_clusters<=0)");
+  RAFT_EXPECTS(params.tol > 0, "invalid parameter (tol<=0)");
+  RAFT_EXPECTS(params.mini_batch_size == 0,
+               "the distributed k-means does not support the mini-batch mode");
+  RAFT_EXPECTS(params.init != KMeansParams::InitMethod::KMeansPlusPlus ||
+                 params.oversampling_factor > 0,
+               "the distributed k-means initializes with k-means|| (oversampling_factor > 0)");
+  RAFT_EXPECTS((int)centroids.extent(0) == params.n_clusters,
+               "invalid parameter (centroids.extent(0) != n_clusters)");
+  RAFT_EXPECTS(centroids.extent(1) == n_features,
+               "invalid parameter (centroids.extent(1) != n_features)");
+
+  logger::get(RAFT_NAME).set_level(params.verbosity);
+
+  rmm::device_uvector<char> workspace(0, stream);
+  auto weight = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
+  if (sample_weight.has_value())
+    raft::copy(weight.data_handle(), sample_weight.value().data_handle(), n_samples, stream);
+  else
+    thrust::fill(resource::get_thrust_policy(handle),
+                 weight.data_handle(),
+                 weight.data_handle() + weight.size(),
+                 1);
+
+  // the weights of all the ranks sum up to the global number of samples
+  checkWeightDistributed<DataT, IndexT>(handle, weight.view(), allreduce_sum(handle, n_samples));
+
+  auto centroidsRawData = raft::make_device_matrix<DataT, IndexT>(handle, n_clusters, n_features);
+
+  auto n_init = params.n_init;
+  if (params.init == KMeansParams::InitMethod::Array && n_init != 1) {
+    RAFT_LOG_DEBUG(
+      "Explicit initial center position passed: performing only one init in "
+      "k-means instead of n_init=%d",
+      n_init);
+    n_init = 1;
+  }
+
+  // the same seeds on all the ranks
+  std::mt19937 gen(params.rng_state.seed);
+  inertia[0] = std::numeric_limits<DataT>::max();
+
+  for (auto seed_iter = 0; seed_iter < n_init; ++seed_iter) {
+    KMeansParams iter_params   = params;
+    iter_params.rng_state.seed = gen();
+
+    DataT iter_inertia    = std::numeric_limits<DataT>::max();
+    IndexT n_current_iter = 0;
+    if (iter_params.init == KMeansParams::InitMethod::Random) {
+      initRandomDistributed<DataT, IndexT>(handle, iter_params, X, centroidsRawData.view());
+    } else if (iter_params.init == KMeansParams::InitMethod::KMeansPlusPlus) {
+      initScalableKMeansPlusPlusDistributed<DataT, IndexT>(
+        handle, iter_params, X, centroidsRawData.view(), workspace);
+    } else if (iter_params.init == KMeansParams::InitMethod::Array) {
+      raft::copy(
+        centroidsRawData.data_handle(), centroids.data_handle(), n_clusters * n_features, stream);
+    } else {
+      THROW("unknown initialization method to select initial centers");
+    }
+
+    kmeans_fit_main_distributed<DataT, IndexT>(handle,
+                                               iter_params,
+                                               X,
+                                               weight.view(),
+                                               centroidsRawData.view(),
+                                               raft::make_host_scalar_view<DataT>(&iter_inertia),
+                                               raft::make_host_scalar_view<IndexT>(&n_current_iter),
+                                               workspace);
+    if (iter_inertia < inertia[0]) {
+      inertia[0] = iter_inertia;
+      n_iter[0]  = n_current_iter;
+      raft::copy(
+        centroids.data_handle(), centroidsRawData.data_handle(), n_clusters * n_features, stream);
+    }
+    RAFT_LOG_DEBUG("KMeans.fit (distributed) after iteration-%d/%d: inertia - %f, n_iter[0] - %d",
+                   seed_iter + 1,
+                   n_init,
+                   inertia[0],
+                   n_iter[0]);
+  }
+}
+
+}  // namespace raft::cluster::detail
@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/cluster/detail/kmeans.cuh>
+#include <raft/cluster/detail/kmeans_common.cuh>
+#include <raft/cluster/detail/kmeans_minibatch.cuh>
+#include <raft/cluster/kmeans_types.hpp>
+#include <raft/common/nvtx.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/kvp.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/linalg/map_then_reduce.cuh>
+#include <raft/linalg/matrix_vector_op.cuh>
+#include <raft/linalg/reduce_cols_by_key.cuh>
+#include <raft/linalg/reduce_rows_by_key.cuh>
+#include <raft/matrix/gather.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <cub/cub.cuh>
+#include <thrust/fill.h>
+#include <thrust/reduce.h>
+#include <thrust/transform.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <random>
+
+namespace raft::cluster::detail {
+
+/*
+ * k-means on data stored in a narrower type than the centroids (e.g. half or int8 embeddings
+ * clustered with float centroids).
+ *
+ * The dataset is never converted as a whole: every pass over it maps one chunk of
+ * params.batch_samples rows to MathT (with mapping_op), assigns the chunk to the centroids, and
+ * accumulates the weighted sums of the chunk into the MathT centroid sums. The extra device
+ * memory is thus bounded by one chunk, whatever the size of the dataset.
+ */
+
+/** The number of rows of X converted to MathT at a time. */
+template <typename IndexT>
+IndexT mapped_chunk_rows(const KMeansParams& params, IndexT n_samples)
+{
+  return std::min<IndexT>(n_samples, std::max<IndexT>(params.batch_samples, 1));
+}
+
+/** rows = mapping_op(X[offset : offset + rows.extent(0)]) */
+template <typename DataT, typename MathT, typename IndexT, typename MappingOpT>
+void map_rows(raft::resources const& handle,
+              raft::device_matrix_view<const DataT, IndexT> X,
+              IndexT offset,
+              raft::device_matrix_view<MathT, IndexT> rows,
+              MappingOpT mapping_op)
+{
+  auto n_elems = static_cast<IndexT>(rows.extent(0) * rows.extent(1));
+  raft::linalg::map(handle,
+                    raft::make_device_vector_view<MathT, IndexT>(rows.data_handle(), n_elems),
+                    mapping_op,
+                    raft::make_device_vector_view<const DataT, IndexT>(
+                      X.data_handle() + size_t(offset) * X.extent(1), n_elems));
+}
+
+/**
+ * @brief Initialize the centroids with params.init on a random sample of X mapped to MathT.
+ *
+ * The sample has max(params.batch_samples, 3 * n_clusters) rows (at most n_samples).
+ */
+template <typename DataT, typename MathT, typename IndexT, typename MappingOpT>
+void kmeans_init_mapped(raft::resources const& handle,
+                        const KMeansParams& params,
+                        raft::device_matrix_view<const DataT, IndexT> X,
+                        raft::device_matrix_view<MathT, IndexT> centroids,
+                        MappingOpT mapping_op,
+                        rmm::device_uvector<char>& workspace)
+{
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_samples      = X.extent(0);
+  auto n_features     = X.extent(1);
+  auto n_init_rows    = std::min<IndexT>(
+    n_samples, std::max<IndexT>(mapped_chunk_rows(params, n_samples), 3 * params.n_clusters));
+
+  raft::random::RngState rng(params.rng_state.seed, params.rng_state.type);
+  auto indices = raft::make_device_vector<IndexT, IndexT>(handle, n_init_rows);
+  auto sample  = raft::make_device_matrix<MathT, IndexT>(handle, n_init_rows, n_features);
+  if (n_init_rows == n_samples) {
+    map_rows(handle, X, IndexT(0), sample.view(), mapping_op);
+  } else {
+    raft::random::uniformInt(handle, rng, indices.view(), IndexT(0), n_samples);
+    cub::TransformInputIterator<MathT, MappingOpT, const DataT*> mapping_itr(X.data_handle(),
+                                                                             mapping_op);
+    raft::matrix::gather(mapping_itr,
+                         n_features,
+                         n_samples,
+                         indices.data_handle(),
+                         n_init_rows,
+                         sample.data_handle(),
+                         stream);
+  }
+  minibatch_init<MathT, IndexT>(
+    handle, params, raft::make_const_mdspan(sample.view()), centroids, workspace);
+}
+
+/**
+ * @brief The weighted inertia of X w.r.t. the centroids, and optionally the labels of X;
+ * the chunks of X are mapped to MathT one at a time.
+ */
+template <typename DataT, typename MathT, typename IndexT, typename MappingOpT>
+MathT kmeans_assign_mapped(raft::resources const& handle,
+                           const KMeansParams& params,
+                           raft::device_matrix_view<const DataT, IndexT> X,
+                           raft::device_vector_view<const MathT, IndexT> weight,
+                           raft::device_matrix_view<const MathT, IndexT> centroids,
+                           std::optional<raft::device_vector_view<IndexT, IndexT>> labels,
+                           MappingOpT mapping_op,
+                           rmm::device_uvector<char>& workspace)
+{
+  auto n_samples  = X.extent(0);
+  auto n_features = X.extent(1);
+  auto chunk_rows = mapped_chunk_rows(params, n_samples);
+  auto n_chunks   = raft::ceildiv<IndexT>(n_samples, chunk_rows);
+
+  auto chunk = raft::make_device_matrix<MathT, IndexT>(handle, chunk_rows, n_features);
+  auto minClusterAndDistance =
+    raft::make_device_vector<raft::KeyValuePair<IndexT, MathT>, IndexT>(handle, chunk_rows);
+  auto chunk_costs = raft::make_device_vector<MathT, IndexT>(handle, n_chunks);
+
+  for (IndexT c = 0; c < n_chunks; c++) {
+    auto offset = c * chunk_rows;
+    auto rows   = std::min<IndexT>(chunk_rows, n_samples - offset);
+    auto chunk_view =
+      raft::make_device_matrix_view<MathT, IndexT>(chunk.data_handle(), rows, n_features);
+    map_rows(handle, X, offset, chunk_view, mapping_op);
+    minibatch_assign<MathT, IndexT>(
+      handle,
+      params,
+      raft::make_const_mdspan(chunk_view),
+      raft::make_device_vector_view<const MathT, IndexT>(weight.data_handle() + offset, rows),
+      centroids,
+      raft::make_device_vector_view<raft::KeyValuePair<IndexT, MathT>, IndexT>(
+        minClusterAndDistance.data_handle(), rows),
+      raft::make_device_scalar_view(chunk_costs.data_handle() + c),
+      workspace);
+    if (labels.has_value()) {
+      thrust::transform(resource::get_thrust_policy(handle),
+                        minClusterAndDistance.data_handle(),
+                        minClusterAndDistance.data_handle() + rows,
+                        labels->data_handle() + offset,
+                        raft::key_op{});
+    }
+  }
+  return thrust::reduce(resource::get_thrust_policy(handle),
+                        chunk_costs.data_handle(),
+                        chunk_costs.data_handle() + n_chunks,
+                        MathT(0));
+}
+
+/**
+ * @brief Lloyd iterations over the mapped chunks of X, from the given centroids.
+ *
+ * Every iteration accumulates the weighted sums of the chunks into their nearest centroid; a
+ * centroid is then moved to the weighted mean of its samples (kept as is if it has none).
+ */
+template <typename DataT, typename MathT, typename IndexT, typename MappingOpT>
+void kmeans_fit_main_mapped(raft::resources const& handle,
+                            const KMeansParams& params,
+                            raft::device_matrix_view<const DataT, IndexT> X,
+                            raft::device_vector_view<const MathT, IndexT> weight,
+                            raft::device_matrix_view<MathT, IndexT> centroids,
+                            raft::host_scalar_view<MathT> inertia,
+                            raft::host_scalar_view<IndexT> n_iter,
+                            MappingOpT mapping_op,
+                            rmm::device_uvector<char>& workspace)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_fit_main_mapped");
+  logger::get(RAFT_NAME).set_level(params.verbosity);
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_samples      = X.extent(0);
+  auto n_features     = X.extent(1);
+  auto n_clusters     = params.n_clusters;
+  auto chunk_rows     = mapped_chunk_rows(params, n_samples);
+  auto n_chunks       = raft::ceildiv<IndexT>(n_samples, chunk_rows);
+
+  auto chunk = raft::make_device_matrix<MathT, IndexT>(handle, chunk_rows, n_features);
+  auto minClusterAndDistance =
+    raft::make_device_vector<raft::KeyValuePair<IndexT, MathT>, IndexT>(handle, chunk_rows);
+  auto newCentroids = raft::make_device_matrix<MathT, IndexT>(handle, n_clusters, n_features);
+  auto wtInCluster  = raft::make_device_vector<MathT, IndexT>(handle, n_clusters);
+  auto chunk_costs  = raft::make_device_vector<MathT, IndexT>(handle, n_chunks);
+  rmm::device_uvector<char> keys_workspace(0, stream);
+
+  MathT priorClusteringCost = 0;
+  for (n_iter[0] = 1; n_iter[0] <= params.max_iter; ++n_iter[0]) {
+    RAFT_LOG_DEBUG("KMeans.fit (mapped input): Iteration-%d", n_iter[0]);
+
+    for (IndexT c = 0; c < n_chunks; c++) {
+      auto offset = c * chunk_rows;
+      auto rows   = std::min<IndexT>(chunk_rows, n_samples - offset);
+      auto chunk_view =
+        raft::make_device_matrix_view<MathT, IndexT>(chunk.data_handle(), rows, n_features);
+      auto chunk_weight = weight.data_handle() + offset;
+      map_rows(handle, X, offset, chunk_view, mapping_op);
+      minibatch_assign<MathT, IndexT>(
+        handle,
+        params,
+        raft::make_const_mdspan(chunk_view),
+        raft::make_device_vector_view<const MathT, IndexT>(chunk_weight, rows),
+        raft::make_const_mdspan(centroids),
+        raft::make_device_vector_view<raft::KeyValuePair<IndexT, MathT>, IndexT>(
+          minClusterAndDistance.data_handle(), rows),
+        raft::make_device_scalar_view(chunk_costs.data_handle() + c),
+        workspace);
+
+      detail::KeyValueIndexOp<IndexT, MathT> conversion_op;
+      cub::TransformInputIterator<IndexT,
+                                  detail::KeyValueIndexOp<IndexT, MathT>,
+                                  raft::KeyValuePair<IndexT, MathT>*>
+        itr(minClusterAndDistance.data_handle(), conversion_op);
+
+      // accumulate the weighted sums of the chunk samples assigned to each cluster
+      keys_workspace.resize(rows, stream);
+      raft::linalg::reduce_rows_by_key(chunk_view.data_handle(),
+                                       n_features,
+                                       itr,
+                                       chunk_weight,
+                                       keys_workspace.data(),
+                                       rows,
+                                       n_features,
+                                       (IndexT)n_clusters,
+                                       newCentroids.data_handle(),
+                                       stream,
+                                       c == 0);
+      raft::linalg::reduce_cols_by_key(chunk_weight,
+                                       itr,
+                                       wtInCluster.data_handle(),
+                                       (IndexT)1,
+                                       rows,
+                                       (IndexT)n_clusters,
+                                       stream,
+                                       c == 0);
+    }
+
+    // new_centroids[i] = new_centroids[i] / weight_per_cluster[i], reset to 0 for empty clusters
+    raft::linalg::matrixVectorOp(newCentroids.data_handle(),
+                                 newCentroids.data_handle(),
+                                 wtInCluster.data_handle(),
+                                 newCentroids.extent(1),
+                                 newCentroids.extent(0),
+                                 true,
+                                 false,
+                                 raft::div_checkzero_op{},
+                                 stream);
+
+    // copy centroids[i] to new_centroids[i] when weight_per_cluster[i] is 0
+    cub::ArgIndexInputIterator<MathT*> itr_wt(wtInCluster.data_handle());
+    raft::matrix::gather_if(
+      centroids.data_handle(),
+      static_cast<int>(centroids.extent(1)),
+      static_cast<int>(centroids.extent(0)),
+      itr_wt,
+      itr_wt,
+      static_cast<int>(wtInCluster.size()),
+      newCentroids.data_handle(),
+      [=] __device__(raft::KeyValuePair<ptrdiff_t, MathT> map) { return map.value == 0; },
+      raft::key_op{},
+      stream);
+
+    // compute the squared norm between the new and the old centroids
+    auto sqrdNorm = raft::make_device_scalar(handle, MathT(0));
+    raft::linalg::mapThenSumReduce(sqrdNorm.data_handle(),
+                                   newCentroids.size(),
+                                   raft::sqdiff_op{},
+                                   stream,
+                                   centroids.data_handle(),
+                                   newCentroids.data_handle());
+
+    MathT sqrdNormError = 0;
+    raft::copy(&sqrdNormError, sqrdNorm.data_handle(), sqrdNorm.size(), stream);
+
+    raft::copy(centroids.data_handle(), newCentroids.data_handle(), newCentroids.size(), stream);
+
+    bool done = false;
+    if (params.inertia_check) {
+      MathT curClusteringCost = thrust::reduce(resource::get_thrust_policy(handle),
+                                               chunk_costs.data_handle(),
+                                               chunk_costs.data_handle() + n_chunks,
+                                               MathT(0));
+
+      ASSERT(curClusteringCost != (MathT)0.0,
+             "Too few points and centroids being found is getting 0 cost from "
+             "centers");
+
+      if (n_iter[0] > 1) {
+        MathT delta = curClusteringCost / priorClusteringCost;
+        if (delta > 1 - params.tol) done = true;
+      }
+      priorClusteringCost = curClusteringCost;
+    }
+
+    resource::sync_stream(handle, stream);
+    if (sqrdNormError < params.tol) done = true;
+
+    if (done) {
+      RAFT_LOG_DEBUG("Threshold triggered after %d iterations. Terminating early.", n_iter[0]);
+      break;
+    }
+  }
+
+  inertia[0] = kmeans_assign_mapped<DataT, MathT, IndexT>(handle,
+                                                          params,
+                                                          X,
+                                                          weight,
+                                                          raft::make_const_mdspan(centroids),
+                                                          std::nullopt,
+                                                          mapping_op,
+                                                          workspace);
+  RAFT_LOG_DEBUG("KMeans.fit (mapped input): completed after %d iterations with %f inertia",
+                 n_iter[0] > params.max_iter ? n_iter[0] - 1 : n_iter[0],
+                 inertia[0]);
+}
+
+/**
+ * @brief k-means fit of a dataset of type DataT with centroids of type MathT.
+ *
+ * Same as kmeans_fit (including the n_init restarts), except that the dataset is mapped to MathT
+ * one chunk at a time, and the k-means++ / random initialization runs on a random sample of it.
+ */
+template <typename DataT, typename MathT, typename IndexT, typename MappingOpT>
+void kmeans_fit_mapped(raft::resources const& handle,
+                       const KMeansParams& params,
+                       raft::device_matrix_view<const DataT, IndexT> X,
+                       std::optional<raft::device_vector_view<const MathT, IndexT>> sample_weight,
+                       raft::device_matrix_view<MathT, IndexT> centroids,
+                       raft::host_scalar_view<MathT> inertia,
+                       raft::host_scalar_view<IndexT> n_iter,
+                       MappingOpT mapping_op)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_fit_mapped");
+  auto n_samples      = X.extent(0);
+  auto n_features     = X.extent(1);
+  auto n_clusters     = params.n_clusters;
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  // Check that parameters are valid
+  if (sample_weight.has_value())
+    RAFT_EXPECTS(sample_weight.value().extent(0) == n_samples,
+                 "invalid parameter (sample_weight!=n_samples)");
+  RAFT_EXPECTS(n_clusters > 0, "invalid parameter (n_clusters<=0)");
+  RAFT_EXPECTS(params.tol > 0, "invalid parameter (tol<=0)");
+  RAFT_EXPECTS(params.oversampling_factor >= 0, "invalid parameter (oversampling_factor<0)");
+  RAFT_EXPECTS((int)centroids.extent(0) == params.n_clusters,
+               "invalid parameter (centroids.extent(0) != n_clusters)");
+  RAFT_EXPECTS(centroids.extent(1) == n_features,
+               "invalid parameter (centroids.extent(1) != n_features)");
+  RAFT_EXPECTS(params.mini_batch_size == 0,
+               "k-means on mapped input data does not support the mini-batch mode");
+
+  logger::get(RAFT_NAME).set_level(params.verbosity);
+
+  // Allocate memory
+  rmm::device_uvector<char> workspace(0, stream);
+  auto weight = raft::make_device_vector<MathT, IndexT>(handle, n_samples);
+  if (sample_weight.has_value())
+    raft::copy(weight.data_handle(), sample_weight.value().data_handle(), n_samples, stream);
+  else
+    thrust::fill(resource::get_thrust_policy(handle),
+                 weight.data_handle(),
+                 weight.data_handle() + weight.size(),
+                 1);
+
+  // check if weights sum up to n_samples
+  checkWeight<MathT>(handle, weight.view(), workspace);
+
+  auto centroidsRawData = raft::make_device_matrix<MathT, IndexT>(handle, n_clusters, n_features);
+
+  auto n_init = params.n_init;
+  if (params.init == KMeansParams::InitMethod::Array && n_init != 1) {
+    RAFT_LOG_DEBUG(
+      "Explicit initial center position passed: performing only one init in "
+      "k-means instead of n_init=%d",
+      n_init);
+    n_init = 1;
+  }
+
+  std::mt19937 gen(params.rng_state.seed);
+  inertia[0] = std::numeric_limits<MathT>::max();
+
+  for (auto seed_iter = 0; seed_iter < n_init; ++seed_iter) {
+    KMeansParams iter_params   = params;
+    iter_params.rng_state.seed = gen();
+
+    MathT iter_inertia    = std::numeric_limits<MathT>::max();
+    IndexT n_current_iter = 0;
+    if (iter_params.init == KMeansParams::InitMethod::Array) {
+      raft::copy(
+        centroidsRawData.data_handle(), centroids.data_handle(), n_clusters * n_features, stream);
+    } else {
+      kmeans_init_mapped<DataT, MathT, IndexT>(
+        handle, iter_params, X, centroidsRawData.view(), mapping_op, workspace);
+    }
+
+    kmeans_fit_main_mapped<DataT, MathT, IndexT>(
+      handle,
+      iter_params,
+      X,
+      raft::make_const_mdspan(weight.view()),
+      centroidsRawData.view(),
+      raft::make_host_scalar_view<MathT>(&iter_inertia),
+      raft::make_host_scalar_view<IndexT>(&n_current_iter),
+      mapping_op,
+      workspace);
+    if (iter_inertia < inertia[0]) {
+      inertia[0] = iter_inertia;
+      n_iter[0]  = n_current_iter;
+      raft::copy(
+        centroids.data_handle(), centroidsRawData.data_handle(), n_clusters * n_features, stream);
+    }
+    RAFT_LOG_DEBUG("KMeans.fit after iteration-%d/%d: inertia - %f, n_iter[0] - %d",
+                   seed_iter + 1,
+                   n_init,
+                   inertia[0],
+                   n_iter[0]);
+  }
+}
+
+/**
+ * @brief k-means predict for a dataset of type DataT with centroids of type MathT; the dataset
+ * is mapped to MathT one chunk at a time.
+ */
+template <typename DataT, typename MathT, typename IndexT, typename MappingOpT>
+void kmeans_predict_mapped(
+  raft::resources const& handle,
+  const KMeansParams& params,
+  raft::device_matrix_view<const DataT, IndexT> X,
+  std::optional<raft::device_vector_view<const MathT, IndexT>> sample_weight,
+  raft::device_matrix_view<const MathT, IndexT> centroids,
+  raft::device_vector_view<IndexT, IndexT> labels,
+  bool normalize_weight,
+  raft::host_scalar_view<MathT> inertia,
+  MappingOpT mapping_op)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_predict_mapped");
+  auto n_samples      = X.extent(0);
+  auto n_features     = X.extent(1);
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  // Check that parameters are valid
+  if (sample_weight.has_value())
+    RAFT_EXPECTS(sample_weight.value().extent(0) == n_samples,
+                 "invalid parameter (sample_weight!=n_samples)");
+  RAFT_EXPECTS(params.n_clusters > 0, "invalid parameter (n_clusters<=0)");
+  RAFT_EXPECTS((int)centroids.extent(0) == params.n_clusters,
+               "invalid parameter (centroids.extent(0) != n_clusters)");
+  RAFT_EXPECTS(centroids.extent(1) == n_features,
+               "invalid parameter (centroids.extent(1) != n_features)");
+  RAFT_EXPECTS(labels.extent(0) == n_samples, "invalid parameter (labels.extent(0)!=n_samples)");
+
+  logger::get(RAFT_NAME).set_level(params.verbosity);
+
+  rmm::device_uvector<char> workspace(0, stream);
+  auto weight = raft::make_device_vector<MathT, IndexT>(handle, n_samples);
+  if (sample_weight.has_value())
+    raft::copy(weight.data_handle(), sample_weight.value().data_handle(), n_samples, stream);
+  else
+    thrust::fill(resource::get_thrust_policy(handle),
+                 weight.data_handle(),
+                 weight.data_handle() + weight.size(),
+                 1);
+
+  // check if weights sum up to n_samples
+  if (normalize_weight) checkWeight(handle, weight.view(), workspace);
+
+  inertia[0] = kmeans_assign_mapped<DataT, MathT, IndexT>(handle,
+                                                          params,
+                                                          X,
+                                                          raft::make_const_mdspan(weight.view()),
+                                                          centroids,
+                                                          labels,
+                                                          mapping_op,
+                                                          workspace);
+}
+
+}  // namespace raft::cluster::detail
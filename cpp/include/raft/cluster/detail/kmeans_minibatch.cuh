@@ -0,0 +1,538 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/cluster/detail/kmeans.cuh>
+#include <raft/cluster/detail/kmeans_common.cuh>
+#include <raft/cluster/kmeans_types.hpp>
+#include <raft/common/nvtx.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/kvp.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/linalg/map_then_reduce.cuh>
+#include <raft/linalg/norm.cuh>
+#include <raft/matrix/gather.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/fill.h>
+#include <thrust/transform.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace raft::cluster::detail {
+
+/**
+ * Draws the mini-batches (uniformly, with replacement) from a dataset in device memory, and
+ * slices it in contiguous chunks for the final inertia pass.
+ */
+template <typename DataT, typename IndexT>
+struct device_batch_source {
+  raft::device_matrix_view<const DataT, IndexT> X;
+  std::optional<raft::device_vector_view<const DataT, IndexT>> sample_weight;
+
+  void sample(raft::resources const& handle,
+              raft::random::RngState& rng,
+              raft::device_matrix_view<DataT, IndexT> rows,
+              raft::device_vector_view<DataT, IndexT> weights)
+  {
+    auto n_rows  = rows.extent(0);
+    auto indices = raft::make_device_vector<IndexT, IndexT>(handle, n_rows);
+    raft::random::uniformInt(handle, rng, indices.view(), IndexT(0), X.extent(0));
+    raft::matrix::gather(handle, X, raft::make_const_mdspan(indices.view()), rows);
+    if (sample_weight.has_value()) {
+      auto w = raft::make_device_matrix_view<const DataT, IndexT>(
+        sample_weight->data_handle(), sample_weight->extent(0), 1);
+      raft::matrix::gather(
+        handle,
+        w,
+        raft::make_const_mdspan(indices.view()),
+        raft::make_device_matrix_view<DataT, IndexT>(weights.data_handle(), n_rows, 1));
+    } else {
+      thrust::fill(resource::get_thrust_policy(handle),
+                   weights.data_handle(),
+                   weights.data_handle() + n_rows,
+                   DataT(1));
+    }
+  }
+
+  void slice(raft::resources const& handle,
+             IndexT offset,
+             raft::device_matrix_view<DataT, IndexT> rows,
+             raft::device_vector_view<DataT, IndexT> weights)
+  {
+    auto stream = resource::get_cuda_stream(handle);
+    raft::copy(rows.data_handle(), X.data_handle() + offset * X.extent(1), rows.size(), stream);
+    if (sample_weight.has_value()) {
+      raft::copy(
+        weights.data_handle(), sample_weight->data_handle() + offset, weights.size(), stream);
+    } else {
+      thrust::fill(resource::get_thrust_policy(handle),
+                   weights.data_handle(),
+                   weights.data_handle() + weights.size(),
+                   DataT(1));
+    }
+  }
+};
+
+/**
+ * Draws the mini-batches (uniformly, with replacement) from a dataset in host memory: the rows of
+ * a batch are packed on the host and copied to the device, so only one batch resides on the GPU.
+ */
+template <typename DataT, typename IndexT>
+struct host_batch_source {
+  raft::host_matrix_view<const DataT, IndexT> X;
+  std::optional<raft::host_vector_view<const DataT, IndexT>> sample_weight;
+  std::mt19937 gen;
+  std::vector<DataT> rows_buf{};
+  std::vector<DataT> weights_buf{};
+
+  void sample(raft::resources const& handle,
+              raft::random::RngState&,
+              raft::device_matrix_view<DataT, IndexT> rows,
+              raft::device_vector_view<DataT, IndexT> weights)
+  {
+    auto n_rows     = rows.extent(0);
+    auto n_features = X.extent(1);
+    std::uniform_int_distribution<IndexT> dist(0, X.extent(0) - 1);
+    rows_buf.resize(rows.size());
+    weights_buf.resize(n_rows);
+    for (IndexT i = 0; i < n_rows; i++) {
+      auto j = dist(gen);
+      std::copy(X.data_handle() + size_t(j) * n_features,
+                X.data_handle() + size_t(j + 1) * n_features,
+                rows_buf.data() + size_t(i) * n_features);
+      weights_buf[i] = sample_weight.has_value() ? (*sample_weight)(j) : DataT(1);
+    }
+    upload(handle, rows, weights);
+  }
+
+  void slice(raft::resources const& handle,
+             IndexT offset,
+             raft::device_matrix_view<DataT, IndexT> rows,
+             raft::device_vector_view<DataT, IndexT> weights)
+  {
+    rows_buf.assign(X.data_handle() + size_t(offset) * X.extent(1),
+                    X.data_handle() + size_t(offset) * X.extent(1) + rows.size());
+    weights_buf.resize(weights.size());
+    for (IndexT i = 0; i < weights.extent(0); i++) {
+      weights_buf[i] = sample_weight.has_value() ? (*sample_weight)(offset + i) : DataT(1);
+    }
+    upload(handle, rows, weights);
+  }
+
+ private:
+  void upload(raft::resources const& handle,
+              raft::device_matrix_view<DataT, IndexT> rows,
+              raft::device_vector_view<DataT, IndexT> weights)
+  {
+    auto stream = resource::get_cuda_stream(handle);
+    raft::copy(rows.data_handle(), rows_buf.data(), rows.size(), stream);
+    raft::copy(weights.data_handle(), weights_buf.data(), weights.size(), stream);
+    // the host buffers are reused by the next batch
+    resource::sync_stream(handle, stream);
+  }
+};
+
+/**
+ * @brief The weighted sum of the distances of the samples of X to their nearest centroid.
+ *
+ * On return, minClusterAndDistance holds the nearest centroid of every sample and its weighted
+ * distance.
+ */
+template <typename DataT, typename IndexT>
+void minibatch_assign(
+  raft::resources const& handle,
+  const KMeansParams& params,
+  raft::device_matrix_view<const DataT, IndexT> X,
+  raft::device_vector_view<const DataT, IndexT> weight,
+  raft::device_matrix_view<const DataT, IndexT> centroids,
+  raft::device_vector_view<raft::KeyValuePair<IndexT, DataT>, IndexT> minClusterAndDistance,
+  raft::device_scalar_view<DataT> cost,
+  rmm::device_uvector<char>& workspace)
+{
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_samples      = X.extent(0);
+
+  rmm::device_uvector<DataT> L2NormBuf_OR_DistBuf(0, stream);
+  auto L2NormX = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
+  if (params.metric == raft::distance::DistanceType::L2Expanded ||
+      params.metric == raft::distance::DistanceType::L2SqrtExpanded) {
+    raft::linalg::rowNorm(L2NormX.data_handle(),
+                          X.data_handle(),
+                          X.extent(1),
+                          n_samples,
+                          raft::linalg::L2Norm,
+                          true,
+                          stream);
+  }
+
+  detail::minClusterAndDistanceCompute<DataT, IndexT>(handle,
+                                                      X,
+                                                      centroids,
+                                                      minClusterAndDistance,
+                                                      raft::make_const_mdspan(L2NormX.view()),
+                                                      L2NormBuf_OR_DistBuf,
+                                                      params.metric,
+                                                      params.batch_samples,
+                                                      params.batch_centroids,
+                                                      workspace);
+
+  thrust::transform(resource::get_thrust_policy(handle),
+                    minClusterAndDistance.data_handle(),
+                    minClusterAndDistance.data_handle() + n_samples,
+                    weight.data_handle(),
+                    minClusterAndDistance.data_handle(),
+                    [=] __device__(const raft::KeyValuePair<IndexT, DataT> kvp, DataT wt) {
+                      raft::KeyValuePair<IndexT, DataT> res;
+                      res.value = kvp.value * wt;
+                      res.key   = kvp.key;
+                      return res;
+                    });
+
+  detail::computeClusterCost(
+    handle, minClusterAndDistance, workspace, cost, raft::value_op{}, raft::add_op{});
+}
+
+/**
+ * @brief One mini-batch k-means step (Sculley, "Web-scale k-means clustering", 2010).
+ *
+ * Every centroid moves towards the mean of the batch samples assigned to it, with the per-center
+ * learning rate `w_batch / (w_seen + w_batch)`, where `w_seen` is the total weight the center
+ * was assigned over all the previous batches (`cluster_weights`, updated in place).
+ *
+ * @return the weighted inertia of the batch w.r.t. the centroids before the update.
+ */
+template <typename DataT, typename IndexT>
+DataT minibatch_step(raft::resources const& handle,
+                     const KMeansParams& params,
+                     raft::device_matrix_view<const DataT, IndexT> X,
+                     raft::device_vector_view<const DataT, IndexT> weight,
+                     raft::device_matrix_view<DataT, IndexT> centroids,
+                     raft::device_vector_view<DataT, IndexT> cluster_weights,
+                     rmm::device_uvector<char>& workspace)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("minibatch_step");
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_clusters     = centroids.extent(0);
+  auto n_features     = centroids.extent(1);
+
+  auto minClusterAndDistance =
+    raft::make_device_vector<raft::KeyValuePair<IndexT, DataT>, IndexT>(handle, X.extent(0));
+  auto batchMeans  = raft::make_device_matrix<DataT, IndexT>(handle, n_clusters, n_features);
+  auto wtInCluster = raft::make_device_vector<DataT, IndexT>(handle, n_clusters);
+  rmm::device_scalar<DataT> clusterCostD(stream);
+
+  minibatch_assign(handle,
+                   params,
+                   X,
+                   weight,
+                   raft::make_const_mdspan(centroids),
+                   minClusterAndDistance.view(),
+                   raft::make_device_scalar_view(clusterCostD.data()),
+                   workspace);
+
+  detail::KeyValueIndexOp<IndexT, DataT> conversion_op;
+  cub::TransformInputIterator<IndexT,
+                              detail::KeyValueIndexOp<IndexT, DataT>,
+                              raft::KeyValuePair<IndexT, DataT>*>
+    itr(minClusterAndDistance.data_handle(), conversion_op);
+
+  // batchMeans[i] is the weighted mean of the batch samples assigned to centroid i
+  // (centroid i itself when none is)
+  update_centroids(handle,
+                   X,
+                   weight,
+                   raft::make_const_mdspan(centroids),
+                   itr,
+                   wtInCluster.view(),
+                   batchMeans.view(),
+                   workspace);
+
+  auto flat_centroids =
+    raft::make_device_vector_view<DataT, IndexT>(centroids.data_handle(), centroids.size());
+  auto flat_means = raft::make_device_vector_view<const DataT, IndexT>(batchMeans.data_handle(),
+                                                                       batchMeans.size());
+  const DataT* wb = wtInCluster.data_handle();
+  const DataT* cw = cluster_weights.data_handle();
+  raft::linalg::map_offset(
+    handle,
+    flat_centroids,
+    [=] __device__(IndexT i, DataT c, DataT mean) {
+      auto k       = i / n_features;
+      DataT w_next = cw[k] + wb[k];
+      return w_next > DataT(0) ? c + (wb[k] / w_next) * (mean - c) : c;
+    },
+    raft::make_const_mdspan(flat_centroids),
+    flat_means);
+
+  raft::linalg::map(handle,
+                    cluster_weights,
+                    raft::add_op{},
+                    raft::make_const_mdspan(cluster_weights),
+                    raft::make_const_mdspan(wtInCluster.view()));
+
+  return clusterCostD.value(stream);
+}
+
+/**
+ * @brief Initialize the centroids with params.init on the given (device) sample of the data.
+ */
+template <typename DataT, typename IndexT>
+void minibatch_init(raft::resources const& handle,
+                    const KMeansParams& params,
+                    raft::device_matrix_view<const DataT, IndexT> X,
+                    raft::device_matrix_view<DataT, IndexT> centroids,
+                    rmm::device_uvector<char>& workspace)
+{
+  RAFT_EXPECTS(X.extent(0) >= centroids.extent(0),
+               "mini-batch k-means needs at least n_clusters samples to initialize the centroids");
+  if (params.init == KMeansParams::InitMethod::Random) {
+    initRandom<DataT, IndexT>(handle, params, X, centroids);
+  } else if (params.init == KMeansParams::InitMethod::KMeansPlusPlus) {
+    if (params.oversampling_factor == 0)
+      detail::kmeansPlusPlus<DataT, IndexT>(handle, params, X, centroids, workspace);
+    else
+      detail::initScalableKMeansPlusPlus<DataT, IndexT>(handle, params, X, centroids, workspace);
+  } else {
+    THROW("unknown initialization method to select initial centers");
+  }
+}
+
+/**
+ * @brief Mini-batch k-means over a batch source (device_batch_source or host_batch_source).
+ *
+ * The centroids are initialized on a random sample of 3 * max(mini_batch_size, n_clusters) rows
+ * (unless init is InitMethod::Array); then every iteration draws a random batch of
+ * mini_batch_size rows and runs minibatch_step on it. The fit stops after max_iter batches, or
+ * when the smoothed batch inertia has not improved during max_no_improvement batches. The
+ * inertia reported is the one of the whole dataset, computed by a final pass over it.
+ */
+template <typename DataT, typename IndexT, typename BatchSourceT>
+void kmeans_fit_minibatch(raft::resources const& handle,
+                          const KMeansParams& params,
+                          BatchSourceT& source,
+                          IndexT n_samples,
+                          raft::device_matrix_view<DataT, IndexT> centroids,
+                          raft::host_scalar_view<DataT> inertia,
+                          raft::host_scalar_view<IndexT> n_iter)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_fit_minibatch");
+  logger::get(RAFT_NAME).set_level(params.verbosity);
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_features     = centroids.extent(1);
+  auto n_clusters     = params.n_clusters;
+  RAFT_EXPECTS(n_clusters > 0, "invalid parameter (n_clusters<=0)");
+  RAFT_EXPECTS(params.mini_batch_size > 0, "invalid parameter (mini_batch_size<=0)");
+  RAFT_EXPECTS((int)centroids.extent(0) == n_clusters,
+               "invalid parameter (centroids.extent(0) != n_clusters)");
+  if (params.n_init != 1) {
+    RAFT_LOG_DEBUG("mini-batch k-means performs only one init instead of n_init=%d",
+                   params.n_init);
+  }
+
+  rmm::device_uvector<char> workspace(0, stream);
+  raft::random::RngState rng(params.rng_state.seed);
+  auto batch_size = std::min<IndexT>(params.mini_batch_size, n_samples);
+
+  if (params.init != KMeansParams::InitMethod::Array) {
+    auto init_size =
+      std::min<IndexT>(n_samples, 3 * std::max<IndexT>(batch_size, IndexT(n_clusters)));
+    auto init_rows    = raft::make_device_matrix<DataT, IndexT>(handle, init_size, n_features);
+    auto init_weights = raft::make_device_vector<DataT, IndexT>(handle, init_size);
+    source.sample(handle, rng, init_rows.view(), init_weights.view());
+    minibatch_init(handle, params, raft::make_const_mdspan(init_rows.view()), centroids, workspace);
+  }
+
+  auto cluster_weights = raft::make_device_vector<DataT, IndexT>(handle, n_clusters);
+  thrust::fill(resource::get_thrust_policy(handle),
+               cluster_weights.data_handle(),
+               cluster_weights.data_handle() + n_clusters,
+               DataT(0));
+  auto rows    = raft::make_device_matrix<DataT, IndexT>(handle, batch_size, n_features);
+  auto weights = raft::make_device_vector<DataT, IndexT>(handle, batch_size);
+
+  // exponentially weighted average of the per-sample batch inertia, as in scikit-learn
+  const double alpha = std::min(1.0, 2.0 * batch_size / (double(n_samples) + 1));
+  double ewa_inertia = 0;
+  double best_ewa    = std::numeric_limits<double>::max();
+  int no_improvement = 0;
+  for (n_iter[0] = 1; n_iter[0] <= params.max_iter; ++n_iter[0]) {
+    source.sample(handle, rng, rows.view(), weights.view());
+    DataT batch_inertia = minibatch_step(handle,
+                                         params,
+                                         raft::make_const_mdspan(rows.view()),
+                                         raft::make_const_mdspan(weights.view()),
+                                         centroids,
+                                         cluster_weights.view(),
+                                         workspace);
+
+    double per_sample = double(batch_inertia) / batch_size;
+    ewa_inertia = n_iter[0] == 1 ? per_sample : ewa_inertia * (1 - alpha) + per_sample * alpha;
+    RAFT_LOG_DEBUG("KMeans.fit (mini-batch): batch-%d inertia %f, smoothed %f",
+                   n_iter[0],
+                   per_sample,
+                   ewa_inertia);
+    if (ewa_inertia < best_ewa) {
+      best_ewa       = ewa_inertia;
+      no_improvement = 0;
+    } else if (params.max_no_improvement > 0 && ++no_improvement >= params.max_no_improvement) {
+      RAFT_LOG_DEBUG("No improvement of the smoothed inertia during %d batches. Terminating.",
+                     no_improvement);
+      break;
+    }
+  }
+  if (n_iter[0] > params.max_iter) { n_iter[0] = params.max_iter; }
+
+  // the inertia of the whole dataset, one batch at a time
+  auto minClusterAndDistance =
+    raft::make_device_vector<raft::KeyValuePair<IndexT, DataT>, IndexT>(handle, batch_size);
+  rmm::device_scalar<DataT> clusterCostD(stream);
+  inertia[0] = 0;
+  for (IndexT offset = 0; offset < n_samples; offset += batch_size) {
+    auto len = std::min<IndexT>(batch_size, n_samples - offset);
+    auto chunk_rows =
+      raft::make_device_matrix_view<DataT, IndexT>(rows.data_handle(), len, n_features);
+    auto chunk_weights = raft::make_device_vector_view<DataT, IndexT>(weights.data_handle(), len);
+    source.slice(handle, offset, chunk_rows, chunk_weights);
+    minibatch_assign(handle,
+                     params,
+                     raft::make_const_mdspan(chunk_rows),
+                     raft::make_const_mdspan(chunk_weights),
+                     raft::make_const_mdspan(centroids),
+                     raft::make_device_vector_view<raft::KeyValuePair<IndexT, DataT>, IndexT>(
+                       minClusterAndDistance.data_handle(), len),
+                     raft::make_device_scalar_view(clusterCostD.data()),
+                     workspace);
+    inertia[0] += clusterCostD.value(stream);
+  }
+  RAFT_LOG_DEBUG("KMeans.fit (mini-batch): completed after %d batches with %f inertia",
+                 n_iter[0],
+                 inertia[0]);
+}
+
+template <typename DataT, typename IndexT>
+void kmeans_fit_minibatch(
+  raft::resources const& handle,
+  const KMeansParams& params,
+  raft::device_matrix_view<const DataT, IndexT> X,
+  std::optional<raft::device_vector_view<const DataT, IndexT>> sample_weight,
+  raft::device_matrix_view<DataT, IndexT> centroids,
+  raft::host_scalar_view<DataT> inertia,
+  raft::host_scalar_view<IndexT> n_iter)
+{
+  if (sample_weight.has_value())
+    RAFT_EXPECTS(sample_weight.value().extent(0) == X.extent(0),
+                 "invalid parameter (sample_weight!=n_samples)");
+  RAFT_EXPECTS(centroids.extent(1) == X.extent(1),
+               "invalid parameter (centroids.extent(1) != n_features)");
+  device_batch_source<DataT, IndexT> source{X, sample_weight};
+  kmeans_fit_minibatch(handle, params, source, X.extent(0), centroids, inertia, n_iter);
+}
+
+template <typename DataT, typename IndexT>
+void kmeans_fit_minibatch(
+  raft::resources const& handle,
+  const KMeansParams& params,
+  raft::host_matrix_view<const DataT, IndexT> X,
+  std::optional<raft::host_vector_view<const DataT, IndexT>> sample_weight,
+  raft::device_matrix_view<DataT, IndexT> centroids,
+  raft::host_scalar_view<DataT> inertia,
+  raft::host_scalar_view<IndexT> n_iter)
+{
+  if (sample_weight.has_value())
+    RAFT_EXPECTS(sample_weight.value().extent(0) == X.extent(0),
+                 "invalid parameter (sample_weight!=n_samples)");
+  RAFT_EXPECTS(centroids.extent(1) == X.extent(1),
+               "invalid parameter (centroids.extent(1) != n_features)");
+  host_batch_source<DataT, IndexT> source{X, sample_weight, std::mt19937(params.rng_state.seed)};
+  kmeans_fit_minibatch(handle, params, source, X.extent(0), centroids, inertia, n_iter);
+}
+
+/**
+ * @brief Update the model with one batch of a stream of data.
+ *
+ * When cluster_weights are all zero (a new model) and init is not InitMethod::Array, the
+ * centroids are first initialized from the batch.
+ */
+template <typename DataT, typename IndexT>
+void kmeans_partial_fit(raft::resources const& handle,
+                        const KMeansParams& params,
+                        raft::device_matrix_view<const DataT, IndexT> X,
+                        std::optional<raft::device_vector_view<const DataT, IndexT>> sample_weight,
+                        raft::device_matrix_view<DataT, IndexT> centroids,
+                        raft::device_vector_view<DataT, IndexT> cluster_weights,
+                        raft::host_scalar_view<DataT> inertia)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("kmeans_partial_fit");
+  cudaStream_t stream = resource::get_cuda_stream(handle);
+  auto n_samples      = X.extent(0);
+  if (sample_weight.has_value())
+    RAFT_EXPECTS(sample_weight.value().extent(0) == n_samples,
+                 "invalid parameter (sample_weight!=n_samples)");
+  RAFT_EXPECTS((int)centroids.extent(0) == params.n_clusters,
+               "invalid parameter (centroids.extent(0) != n_clusters)");
+  RAFT_EXPECTS(centroids.extent(1) == X.extent(1),
+               "invalid parameter (centroids.extent(1) != n_features)");
+  RAFT_EXPECTS(cluster_weights.extent(0) == centroids.extent(0),
+               "invalid parameter (cluster_weights.extent(0) != n_clusters)");
+
+  rmm::device_uvector<char> workspace(0, stream);
+  if (params.init != KMeansParams::InitMethod::Array) {
+    auto seen = raft::make_device_scalar(handle, DataT(0));
+    raft::linalg::mapThenSumReduce(seen.data_handle(),
+                                   cluster_weights.size(),
+                                   raft::identity_op{},
+                                   stream,
+                                   cluster_weights.data_handle());
+    DataT seen_h = 0;
+    raft::copy(&seen_h, seen.data_handle(), 1, stream);
+    resource::sync_stream(handle, stream);
+    if (seen_h == DataT(0)) { minibatch_init(handle, params, X, centroids, workspace); }
+  }
+
+  auto weight = raft::make_device_vector<DataT, IndexT>(handle, n_samples);
+  if (sample_weight.has_value())
+    raft::copy(weight.data_handle(), sample_weight.value().data_handle(), n_samples, stream);
+  else
+    thrust::fill(resource::get_thrust_policy(handle),
+                 weight.data_handle(),
+                 weight.data_handle() + n_samples,
+                 DataT(1));
+
+  inertia[0] = minibatch_step(handle,
+                              params,
+                              X,
+                              raft::make_const_mdspan(weight.view()),
+                              centroids,
+                              cluster_weights,
+                              workspace);
+}
+
+}  // namespace raft::cluster::detail
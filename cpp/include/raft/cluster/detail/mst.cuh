@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -64,6 +64,8 @@ void merge_msts(sparse::solver::Graph_COO<value_idx, value_idx, value_t>& coo1,
  * @param[in] m number of rows in X
  * @param[in] n number of columns in X
  * @param[inout] color the color labels array returned from the mst invocation
+ * @param[in] metric distance metric
+ * @param[inout] state the cross-component nearest neighbors kept between the calls (nullptr: none)
  * @return updated MST edge list
  */
 template <typename value_idx, typename value_t, typename red_op>
@@ -75,7 +77,8 @@ void connect_knn_graph(
   size_t n,
   value_idx* color,
   red_op reduction_op,
-  raft::distance::DistanceType metric = raft::distance::DistanceType::L2SqrtExpanded)
+  raft::distance::DistanceType metric,
+  raft::sparse::neighbors::cross_component_nn_state<value_idx, value_t>* state)
 {
   auto stream = resource::get_cuda_stream(handle);
 
@@ -86,15 +89,28 @@ void connect_knn_graph(
   static constexpr size_t default_row_batch_size = 4096;
   static constexpr size_t default_col_batch_size = 16;
 
-  raft::sparse::neighbors::cross_component_nn<value_idx, value_t>(handle,
-                                                                  connected_edges,
-                                                                  X,
-                                                                  color,
-                                                                  m,
-                                                                  n,
-                                                                  reduction_op,
-                                                                  min(m, default_row_batch_size),
-                                                                  min(n, default_col_batch_size));
+  if (state == nullptr) {
+    raft::sparse::neighbors::cross_component_nn<value_idx, value_t>(handle,
+                                                                    connected_edges,
+                                                                    X,
+                                                                    color,
+                                                                    m,
+                                                                    n,
+                                                                    reduction_op,
+                                                                    min(m, default_row_batch_size),
+                                                                    min(n, default_col_batch_size));
+  } else {
+    raft::sparse::neighbors::cross_component_nn<value_idx, value_t>(handle,
+                                                                    connected_edges,
+                                                                    X,
+                                                                    color,
+                                                                    m,
+                                                                    n,
+                                                                    reduction_op,
+                                                                    *state,
+                                                                    min(m, default_row_batch_size),
+                                                                    min(n, default_col_batch_size));
+  }
 
   rmm::device_uvector<value_idx> indptr2(m + 1, stream);
   raft::sparse::convert::sorted_coo_to_csr(
@@ -168,8 +184,12 @@ void build_sorted_mst(
   int iters        = 1;
   int n_components = raft::sparse::neighbors::get_n_components(color, m, stream);
 
+  // The nearest neighbors out of the components are kept between the iterations, so that only
+  // the points whose neighbor has been merged into their component are searched again.
+  raft::sparse::neighbors::cross_component_nn_state<value_idx, value_t> cc_state(m, stream);
   while (n_components > 1 && iters < max_iter) {
-    connect_knn_graph<value_idx, value_t>(handle, X, mst_coo, m, n, color, reduction_op);
+    connect_knn_graph<value_idx, value_t>(
+      handle, X, mst_coo, m, n, color, reduction_op, metric, &cc_state);
 
     iters++;
 
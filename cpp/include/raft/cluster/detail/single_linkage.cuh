@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,6 +21,7 @@
 #include <rmm/device_uvector.hpp>
 
 #include <raft/cluster/detail/agglomerative.cuh>
+#include <raft/cluster/detail/boruvka.cuh>
 #include <raft/cluster/detail/connectivities.cuh>
 #include <raft/cluster/detail/mst.cuh>
 #include <raft/cluster/single_linkage_types.hpp>
@@ -33,7 +34,8 @@ static const size_t EMPTY = 0;
  * Single-linkage clustering, capable of constructing a KNN graph to
  * scale the algorithm beyond the n^2 memory consumption of implementations
  * that use the fully-connected graph of pairwise distances by connecting
- * a knn graph when k is not large enough to connect it.
+ * a knn graph when k is not large enough to connect it. With `LinkageDistance::BORUVKA`, the
+ * exact MST is built directly on the points by Borůvka's algorithm, without any graph.
 
  * @tparam value_idx
  * @tparam value_t
@@ -46,7 +48,7 @@ static const size_t EMPTY = 0;
  * @param[out] out struct containing output dendrogram and cluster assignments
  * @param[in] c a constant used when constructing connectivities from knn graph. Allows the indirect
  control
- *            of k. The algorithm will set `k = log(n) + c`
+ *            of k. The algorithm will set `k = log(n) + c` (ignored by `BORUVKA`)
  * @param[in] n_clusters number of clusters to assign data samples
  */
 template <typename value_idx, typename value_t, LinkageDistance dist_type>
@@ -63,41 +65,47 @@ void single_linkage(raft::resources const& handle,
 
   auto stream = resource::get_cuda_stream(handle);
 
-  rmm::device_uvector<value_idx> indptr(EMPTY, stream);
-  rmm::device_uvector<value_idx> indices(EMPTY, stream);
-  rmm::device_uvector<value_t> pw_dists(EMPTY, stream);
-
-  /**
-   * 1. Construct distance graph
-   */
-  detail::get_distance_graph<value_idx, value_t, dist_type>(
-    handle, X, m, n, metric, indptr, indices, pw_dists, c);
-
   rmm::device_uvector<value_idx> mst_rows(m - 1, stream);
   rmm::device_uvector<value_idx> mst_cols(m - 1, stream);
   rmm::device_uvector<value_t> mst_data(m - 1, stream);
 
-  /**
-   * 2. Construct MST, sorted by weights
-   */
-  rmm::device_uvector<value_idx> color(m, stream);
-  raft::sparse::neighbors::FixConnectivitiesRedOp<value_idx, value_t> op(m);
-  detail::build_sorted_mst<value_idx, value_t>(handle,
-                                               X,
-                                               indptr.data(),
-                                               indices.data(),
-                                               pw_dists.data(),
-                                               m,
-                                               n,
-                                               mst_rows.data(),
-                                               mst_cols.data(),
-                                               mst_data.data(),
-                                               color.data(),
-                                               indices.size(),
-                                               op,
-                                               metric);
-
-  pw_dists.release();
+  if constexpr (dist_type == LinkageDistance::BORUVKA) {
+    /**
+     * 1. Construct the MST directly, sorted by weights
+     */
+    detail::build_sorted_mst_boruvka<value_idx, value_t>(
+      handle, X, m, n, metric, nullptr, mst_rows.data(), mst_cols.data(), mst_data.data());
+  } else {
+    rmm::device_uvector<value_idx> indptr(EMPTY, stream);
+    rmm::device_uvector<value_idx> indices(EMPTY, stream);
+    rmm::device_uvector<value_t> pw_dists(EMPTY, stream);
+
+    /**
+     * 1. Construct distance graph
+     */
+    detail::get_distance_graph<value_idx, value_t, dist_type>(
+      handle, X, m, n, metric, indptr, indices, pw_dists, c);
+
+    /**
+     * 2. Construct MST, sorted by weights
+     */
+    rmm::device_uvector<value_idx> color(m, stream);
+    raft::sparse::neighbors::FixConnectivitiesRedOp<value_idx, value_t> op(m);
+    detail::build_sorted_mst<value_idx, value_t>(handle,
+                                                 X,
+                                                 indptr.data(),
+                                                 indices.data(),
+                                                 pw_dists.data(),
+                                                 m,
+                                                 n,
+                                                 mst_rows.data(),
+                                                 mst_cols.data(),
+                                                 mst_data.data(),
+                                                 color.data(),
+                                                 indices.size(),
+                                                 op,
+                                                 metric);
+  }
 
   /**
    * Perform hierarchical labeling
@@ -107,14 +115,14 @@ void single_linkage(raft::resources const& handle,
   rmm::device_uvector<value_t> out_delta(n_edges, stream);
   rmm::device_uvector<value_idx> out_size(n_edges, stream);
   // Create dendrogram
-  detail::build_dendrogram_host<value_idx, value_t>(handle,
-                                                    mst_rows.data(),
-                                                    mst_cols.data(),
-                                                    mst_data.data(),
-                                                    n_edges,
-                                                    out->children,
-                                                    out_delta.data(),
-                                                    out_size.data());
+  detail::build_dendrogram_device<value_idx, value_t>(handle,
+                                                      mst_rows.data(),
+                                                      mst_cols.data(),
+                                                      mst_data.data(),
+                                                      n_edges,
+                                                      out->children,
+                                                      out_delta.data(),
+                                                      out_size.data());
   detail::extract_flattened_clusters(handle, out->labels, out->children, n_clusters, m);
 
   out->m                      = m;
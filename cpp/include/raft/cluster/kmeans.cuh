@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,11 +18,14 @@
 #include <optional>
 #include <raft/cluster/detail/kmeans.cuh>
 #include <raft/cluster/detail/kmeans_auto_find_k.cuh>
+#include <raft/cluster/detail/kmeans_mapped.cuh>
+#include <raft/cluster/detail/kmeans_minibatch.cuh>
 #include <raft/cluster/kmeans_types.hpp>
 #include <raft/core/kvp.hpp>
 #include <raft/core/mdarray.hpp>
 #include <raft/core/operators.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <type_traits>
 
 namespace raft::cluster::kmeans {
 
@@ -82,7 +85,8 @@ using KeyValueIndexOp = detail::KeyValueIndexOp<IndexT, DataT>;
  *                              [dim = n_clusters x n_features]
  * @param[out]    inertia       Sum of squared distances of samples to their
  *                              closest cluster center.
- * @param[out]    n_iter        Number of iterations run.
+ * @param[out]    n_iter        Number of iterations run (the number of batches
+ *                              when params.mini_batch_size > 0).
  */
 template <typename DataT, typename IndexT>
 void fit(raft::resources const& handle,
@@ -93,7 +97,116 @@ void fit(raft::resources const& handle,
          raft::host_scalar_view<DataT> inertia,
          raft::host_scalar_view<IndexT> n_iter)
 {
-  detail::kmeans_fit<DataT, IndexT>(handle, params, X, sample_weight, centroids, inertia, n_iter);
+  if (params.mini_batch_size > 0) {
+    detail::kmeans_fit_minibatch<DataT, IndexT>(
+      handle, params, X, sample_weight, centroids, inertia, n_iter);
+  } else {
+    detail::kmeans_fit<DataT, IndexT>(handle, params, X, sample_weight, centroids, inertia, n_iter);
+  }
+}
+
+/**
+ * @brief Find clusters with mini-batch k-means, on a dataset in host memory.
+ *
+ * Every iteration copies a random batch of params.mini_batch_size samples to the device, so the
+ * dataset does not need to fit in device memory.
+ *
+ * @code{.cpp}
+ *   raft::cluster::KMeansParams params;
+ *   params.mini_batch_size = 1 << 16;
+ *   auto centroids = raft::make_device_matrix<float, int64_t>(handle, params.n_clusters, dim);
+ *
+ *   kmeans::fit(handle,
+ *               params,
+ *               raft::make_host_matrix_view<const float, int64_t>(X_host, n_samples, dim),
+ *               std::nullopt,
+ *               centroids.view(),
+ *               raft::make_host_scalar_view(&inertia),
+ *               raft::make_host_scalar_view(&n_iter));
+ * @endcode
+ *
+ * @tparam DataT the type of data used for weights, distances.
+ * @tparam IndexT the type of data used for indexing.
+ * @param[in]     handle        The raft handle.
+ * @param[in]     params        Parameters for KMeans model (params.mini_batch_size > 0).
+ * @param[in]     X             Training instances to cluster, in host memory.
+ *                              [dim = n_samples x n_features]
+ * @param[in]     sample_weight Optional weights for each observation in X.
+ *                              [len = n_samples]
+ * @param[inout]  centroids     [in] When init is InitMethod::Array, use
+ *                              centroids as the initial cluster centers.
+ *                              [out] The generated centroids.
+ *                              [dim = n_clusters x n_features]
+ * @param[out]    inertia       Sum of squared distances of samples to their
+ *                              closest cluster center.
+ * @param[out]    n_iter        Number of batches run.
+ */
+template <typename DataT, typename IndexT>
+void fit(raft::resources const& handle,
+         const KMeansParams& params,
+         raft::host_matrix_view<const DataT, IndexT> X,
+         std::optional<raft::host_vector_view<const DataT, IndexT>> sample_weight,
+         raft::device_matrix_view<DataT, IndexT> centroids,
+         raft::host_scalar_view<DataT> inertia,
+         raft::host_scalar_view<IndexT> n_iter)
+{
+  RAFT_EXPECTS(params.mini_batch_size > 0,
+               "k-means on host data requires the mini-batch mode (params.mini_batch_size > 0)");
+  detail::kmeans_fit_minibatch<DataT, IndexT>(
+    handle, params, X, sample_weight, centroids, inertia, n_iter);
+}
+
+/**
+ * @brief Update a k-means model with one batch of a stream of data (mini-batch k-means step).
+ *
+ * Every centroid moves towards the mean of the batch samples it is nearest to, with a per-center
+ * learning rate `w / (w_seen + w)` (w: the batch weight assigned to the center, w_seen: the
+ * weight it was assigned by all the previous calls, kept in `cluster_weights`).
+ *
+ * @code{.cpp}
+ *   auto centroids       = raft::make_device_matrix<float, int>(handle, params.n_clusters, dim);
+ *   auto cluster_weights = raft::make_device_vector<float, int>(handle, params.n_clusters);
+ *   raft::matrix::fill(handle, cluster_weights.view(), 0.0f);
+ *   for (auto batch : stream_of_batches) {
+ *     kmeans::partial_fit(handle,
+ *                         params,
+ *                         batch,
+ *                         std::nullopt,
+ *                         centroids.view(),
+ *                         cluster_weights.view(),
+ *                         raft::make_host_scalar_view(&batch_inertia));
+ *   }
+ * @endcode
+ *
+ * @tparam DataT the type of data used for weights, distances.
+ * @tparam IndexT the type of data used for indexing.
+ * @param[in]     handle          The raft handle.
+ * @param[in]     params          Parameters for KMeans model.
+ * @param[in]     X               A batch of training instances, in row-major format.
+ *                                [dim = batch_size x n_features]
+ * @param[in]     sample_weight   Optional weights for each observation in X.
+ *                                [len = batch_size]
+ * @param[inout]  centroids       The cluster centers. When all the cluster_weights
+ *                                are zero (first call) and init is not
+ *                                InitMethod::Array, they are initialized from X.
+ *                                [dim = n_clusters x n_features]
+ * @param[inout]  cluster_weights The total weight assigned to each center so far;
+ *                                zero-initialized before the first call.
+ *                                [len = n_clusters]
+ * @param[out]    inertia         The inertia of the batch (w.r.t. the centroids
+ *                                before the update).
+ */
+template <typename DataT, typename IndexT>
+void partial_fit(raft::resources const& handle,
+                 const KMeansParams& params,
+                 raft::device_matrix_view<const DataT, IndexT> X,
+                 std::optional<raft::device_vector_view<const DataT, IndexT>> sample_weight,
+                 raft::device_matrix_view<DataT, IndexT> centroids,
+                 raft::device_vector_view<DataT, IndexT> cluster_weights,
+                 raft::host_scalar_view<DataT> inertia)
+{
+  detail::kmeans_partial_fit<DataT, IndexT>(
+    handle, params, X, sample_weight, centroids, cluster_weights, inertia);
 }
 
 /**
@@ -162,6 +275,117 @@ void predict(raft::resources const& handle,
     handle, params, X, sample_weight, centroids, labels, normalize_weight, inertia);
 }
 
+/**
+ * @brief Find clusters with k-means algorithm, on a dataset stored in a narrower type than the
+ * centroids (e.g. half or int8 embeddings clustered with float centroids).
+ *
+ * The samples are converted to MathT with `mapping_op` one chunk of params.batch_samples rows at
+ * a time, and the centroids are accumulated in MathT; no MathT copy of the whole dataset is
+ * made. The k-means++ and random initializations run on a random sample of
+ * max(params.batch_samples, 3 * n_clusters) rows. The mini-batch mode is not supported.
+ *
+ * @code{.cpp}
+ *   auto X         = raft::make_device_matrix<half, int64_t>(handle, n_samples, dim);
+ *   auto centroids = raft::make_device_matrix<float, int64_t>(handle, params.n_clusters, dim);
+ *   float inertia;
+ *   int64_t n_iter;
+ *
+ *   kmeans::fit<half, float, int64_t>(handle,
+ *                                     params,
+ *                                     raft::make_const_mdspan(X.view()),
+ *                                     std::nullopt,
+ *                                     centroids.view(),
+ *                                     raft::make_host_scalar_view(&inertia),
+ *                                     raft::make_host_scalar_view(&n_iter));
+ * @endcode
+ *
+ * @tparam DataT the type of the input data (e.g. half, int8_t, uint8_t).
+ * @tparam MathT the type of the centroids, weights, distances (float or double).
+ * @tparam IndexT the type of data used for indexing.
+ * @tparam MappingOpT the type of the conversion functor.
+ * @param[in]     handle        The raft handle.
+ * @param[in]     params        Parameters for KMeans model.
+ * @param[in]     X             Training instances to cluster. The data must
+ *                              be in row-major format.
+ *                              [dim = n_samples x n_features]
+ * @param[in]     sample_weight Optional weights for each observation in X.
+ *                              [len = n_samples]
+ * @param[inout]  centroids     [in] When init is InitMethod::Array, use
+ *                              centroids as the initial cluster centers.
+ *                              [out] The generated centroids.
+ *                              [dim = n_clusters x n_features]
+ * @param[out]    inertia       Sum of squared distances of samples to their
+ *                              closest cluster center.
+ * @param[out]    n_iter        Number of iterations run.
+ * @param[in]     mapping_op    (optional) Functor converting DataT to MathT (a plain cast by
+ *                              default).
+ */
+template <typename DataT,
+          typename MathT,
+          typename IndexT,
+          typename MappingOpT = raft::cast_op<MathT>>
+std::enable_if_t<!std::is_same_v<DataT, MathT>> fit(
+  raft::resources const& handle,
+  const KMeansParams& params,
+  raft::device_matrix_view<const DataT, IndexT> X,
+  std::optional<raft::device_vector_view<const MathT, IndexT>> sample_weight,
+  raft::device_matrix_view<MathT, IndexT> centroids,
+  raft::host_scalar_view<MathT> inertia,
+  raft::host_scalar_view<IndexT> n_iter,
+  MappingOpT mapping_op = raft::cast_op<MathT>())
+{
+  detail::kmeans_fit_mapped<DataT, MathT, IndexT>(
+    handle, params, X, sample_weight, centroids, inertia, n_iter, mapping_op);
+}
+
+/**
+ * @brief Predict the closest cluster each sample in X belongs to, for a dataset stored in a
+ * narrower type than the centroids.
+ *
+ * The samples are converted to MathT with `mapping_op` one chunk of params.batch_samples rows at
+ * a time.
+ *
+ * @tparam DataT the type of the input data (e.g. half, int8_t, uint8_t).
+ * @tparam MathT the type of the centroids, weights, distances (float or double).
+ * @tparam IndexT the type of data used for indexing.
+ * @tparam MappingOpT the type of the conversion functor.
+ * @param[in]     handle           The raft handle.
+ * @param[in]     params           Parameters for KMeans model.
+ * @param[in]     X                New data to predict.
+ *                                 [dim = n_samples x n_features]
+ * @param[in]     sample_weight    Optional weights for each observation in X.
+ *                                 [len = n_samples]
+ * @param[in]     centroids        Cluster centroids. The data must be in
+ *                                 row-major format.
+ *                                 [dim = n_clusters x n_features]
+ * @param[out]    labels           Index of the cluster each sample in X
+ *                                 belongs to.
+ *                                 [len = n_samples]
+ * @param[in]     normalize_weight True if the weights should be normalized
+ * @param[out]    inertia          Sum of squared distances of samples to
+ *                                 their closest cluster center.
+ * @param[in]     mapping_op       (optional) Functor converting DataT to MathT (a plain cast by
+ *                                 default).
+ */
+template <typename DataT,
+          typename MathT,
+          typename IndexT,
+          typename MappingOpT = raft::cast_op<MathT>>
+std::enable_if_t<!std::is_same_v<DataT, MathT>> predict(
+  raft::resources const& handle,
+  const KMeansParams& params,
+  raft::device_matrix_view<const DataT, IndexT> X,
+  std::optional<raft::device_vector_view<const MathT, IndexT>> sample_weight,
+  raft::device_matrix_view<const MathT, IndexT> centroids,
+  raft::device_vector_view<IndexT, IndexT> labels,
+  bool normalize_weight,
+  raft::host_scalar_view<MathT> inertia,
+  MappingOpT mapping_op = raft::cast_op<MathT>())
+{
+  detail::kmeans_predict_mapped<DataT, MathT, IndexT>(
+    handle, params, X, sample_weight, centroids, labels, normalize_weight, inertia, mapping_op);
+}
+
 /**
  * @brief Compute k-means clustering and predicts cluster index for each sample
  * in the input.
@@ -221,8 +445,26 @@ void fit_predict(raft::resources const& handle,
                  raft::host_scalar_view<DataT> inertia,
                  raft::host_scalar_view<IndexT> n_iter)
 {
-  detail::kmeans_fit_predict<DataT, IndexT>(
-    handle, params, X, sample_weight, centroids, labels, inertia, n_iter);
+  if (params.mini_batch_size > 0) {
+    std::optional<raft::device_matrix<DataT, IndexT>> centroids_matrix;
+    if (!centroids.has_value()) {
+      centroids_matrix.emplace(
+        raft::make_device_matrix<DataT, IndexT>(handle, params.n_clusters, X.extent(1)));
+      centroids = centroids_matrix->view();
+    }
+    fit<DataT, IndexT>(handle, params, X, sample_weight, centroids.value(), inertia, n_iter);
+    detail::kmeans_predict<DataT, IndexT>(handle,
+                                          params,
+                                          X,
+                                          sample_weight,
+                                          raft::make_const_mdspan(centroids.value()),
+                                          labels,
+                                          true,
+                                          inertia);
+  } else {
+    detail::kmeans_fit_predict<DataT, IndexT>(
+      handle, params, X, sample_weight, centroids, labels, inertia, n_iter);
+  }
 }
 
 /**
@@ -302,6 +544,13 @@ void transform(raft::resources const& handle,
  * @param kmin minimum k to try in search (should be >= 1)
  * @param maxiter maximum number of iterations to run
  * @param tol tolerance for early stopping convergence
+ * @param warm_start initialize the fit of a candidate k by splitting the largest clusters of the
+ *   fit with the closest smaller k instead of k-means++ (fewer iterations, but the result may then
+ *   depend on the order the candidates are fitted in)
+ *
+ * If the handle has a stream pool (see raft::resource::set_cuda_stream_pool), the candidates the
+ * binary search may visit next are fitted concurrently, one per stream of the pool. The norms of
+ * X are computed once for all the fits.
  */
 template <typename idx_t, typename value_t>
 void find_k(raft::resources const& handle,
@@ -310,11 +559,12 @@ void find_k(raft::resources const& handle,
             raft::host_scalar_view<value_t> inertia,
             raft::host_scalar_view<idx_t> n_iter,
             idx_t kmax,
-            idx_t kmin    = 1,
-            idx_t maxiter = 100,
-            value_t tol   = 1e-3)
+            idx_t kmin      = 1,
+            idx_t maxiter   = 100,
+            value_t tol     = 1e-3,
+            bool warm_start = false)
 {
-  detail::find_k(handle, X, best_k, inertia, n_iter, kmax, kmin, maxiter, tol);
+  detail::find_k(handle, X, best_k, inertia, n_iter, kmax, kmin, maxiter, tol, warm_start);
 }
 
 /**
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -40,7 +40,10 @@ namespace raft::cluster::kmeans_balanced {
  *
  * The number of mesoclusters is chosen by rounding the square root of the number of clusters. E.g
  * for 512 clusters, we would have 23 mesoclusters. The number of fine clusters per mesocluster is
- * chosen proportionally to the number of points in each mesocluster.
+ * chosen proportionally to the number of points in each mesocluster. With
+ * `params.hierarchy_levels > 2`, the fine clusters of each mesocluster are built hierarchically
+ * in turn, and `params.max_train_points_per_cluster` bounds the training set of every level.
+ * When the handle has a stream pool, the mesoclusters are refined concurrently on its streams.
  *
  * This variant of k-means uses random initialization and a fixed number of iterations, though
  * iterations can be repeated if the balancing step moved the centroids.
@@ -160,6 +163,89 @@ void predict(const raft::resources& handle,
                   mapping_op);
 }
 
+/**
+ * @brief Prepare the prediction of the labels by a fixed set of centroids for many calls.
+ *
+ * The predictor caches the norms of the centroids and the workspace of the small batches, so that
+ * `predict` with a predictor neither recomputes nor allocates anything for the batches of up to
+ * `predictor::kMaxSmallBatch` rows (e.g. routing single requests). The larger batches use the same
+ * path as `predict` with the parameters, minus the norms of the centroids.
+ *
+ * @code{.cpp}
+ *   #include <raft/cluster/kmeans_balanced.cuh>
+ *   ...
+ *   raft::cluster::kmeans_balanced_params params;
+ *   auto centroids = raft::make_device_matrix<float, int>(handle, n_clusters, n_features);
+ *   raft::cluster::kmeans_balanced::fit(handle, params, X, centroids.view());
+ *   auto predictor = raft::cluster::kmeans_balanced::make_predictor(
+ *     handle, params, raft::make_const_mdspan(centroids.view()));
+ *   // serve the requests
+ *   raft::cluster::kmeans_balanced::predict(handle, predictor, query, label);
+ * @endcode
+ *
+ * @tparam MathT Type of the centroids and mapped data.
+ * @tparam IndexT Type used for indexing.
+ * @param[in]  handle     The raft resources
+ * @param[in]  params     Structure containing the hyper-parameters (only the metric is used)
+ * @param[in]  centroids  The centroids [dim = n_clusters x n_features]; not copied, they must
+ *                        outlive the predictor
+ * @return the predictor
+ */
+template <typename MathT, typename IndexT>
+auto make_predictor(const raft::resources& handle,
+                    kmeans_balanced_params const& params,
+                    raft::device_matrix_view<const MathT, IndexT> centroids)
+  -> predictor<MathT, IndexT>
+{
+  return detail::make_predictor(handle, params, centroids);
+}
+
+/**
+ * @brief Predict the closest cluster each sample in X belongs to, by a prepared predictor.
+ *
+ * The batches of up to `predictor::kMaxSmallBatch` rows are labeled by a kernel searching a few
+ * parts of the centroids per row in parallel (a warp per centroid), without any allocation; the
+ * rows must have at most 16KB (as MathT) for this path. The calls sharing a predictor must be
+ * ordered (e.g. on one stream), as they share its workspace.
+ *
+ * @tparam DataT Type of the input data.
+ * @tparam MathT Type of the centroids and mapped data.
+ * @tparam IndexT Type used for indexing.
+ * @tparam LabelT Type of the output labels.
+ * @tparam MappingOpT Type of the mapping function.
+ * @param[in]  handle     The raft resources
+ * @param[in]  pred       The predictor made by `make_predictor`
+ * @param[in]  X          Dataset for which to infer the closest clusters.
+ *                        [dim = n_samples x n_features]
+ * @param[out] labels     The output labels [dim = n_samples]
+ * @param[in]  mapping_op (optional) Functor to convert from the input datatype to the arithmetic
+ *                        datatype. If DataT == MathT, this must be the identity.
+ */
+template <typename DataT,
+          typename MathT,
+          typename IndexT,
+          typename LabelT,
+          typename MappingOpT = raft::identity_op>
+void predict(const raft::resources& handle,
+             const predictor<MathT, IndexT>& pred,
+             raft::device_matrix_view<const DataT, IndexT> X,
+             raft::device_vector_view<LabelT, IndexT> labels,
+             MappingOpT mapping_op = raft::identity_op())
+{
+  RAFT_EXPECTS(X.extent(0) == labels.extent(0),
+               "Number of rows in dataset and labels are different");
+  RAFT_EXPECTS(X.extent(1) == pred.centroids().extent(1),
+               "Number of features in dataset and centroids are different");
+  RAFT_EXPECTS(static_cast<uint64_t>(X.extent(0)) * static_cast<uint64_t>(X.extent(1)) <=
+                 static_cast<uint64_t>(std::numeric_limits<IndexT>::max()),
+               "The chosen index type cannot represent all indices for the given dataset");
+  RAFT_EXPECTS(static_cast<uint64_t>(pred.centroids().extent(0)) <=
+                 static_cast<uint64_t>(std::numeric_limits<LabelT>::max()),
+               "The chosen label type cannot represent all cluster labels");
+
+  detail::predict(handle, pred, X.data_handle(), X.extent(0), labels.data_handle(), mapping_op);
+}
+
 /**
  * @brief Compute hierarchical balanced k-means clustering and predict cluster index for each sample
  * in the input.
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,10 +17,15 @@
 #pragma once
 
 #include <raft/cluster/kmeans_types.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/kvp.hpp>
 #include <raft/core/logger.hpp>
+#include <raft/core/resources.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/random/rng_state.hpp>
 
+#include <cstdint>
+
 namespace raft::cluster::kmeans_balanced {
 
 /**
@@ -36,6 +41,105 @@ struct kmeans_balanced_params : kmeans_base_params {
    * Number of training iterations
    */
   uint32_t n_iters = 20;
+  /**
+   * Number of levels of the hierarchical build used by `fit`.
+   *
+   * Every level trains about `n_clusters^(1 / hierarchy_levels)` clusters within each cluster of
+   * the level above: two levels (the default) train about `sqrt(n_clusters)` mesoclusters and
+   * then the fine clusters within each of them. More levels keep every clustering small when the
+   * number of clusters is very large (millions).
+   */
+  uint32_t hierarchy_levels = 2;
+  /**
+   * Maximum number of training points per cluster at each level of the hierarchical build
+   * (0 means no limit).
+   *
+   * The mesoclusters are trained on an evenly strided subsample of at most
+   * `max_train_points_per_cluster * n_mesoclusters` rows, to which all the rows are then
+   * assigned; the fine clusters of a mesocluster are trained on at most
+   * `max_train_points_per_cluster` of its points per fine cluster.
+   */
+  uint32_t max_train_points_per_cluster = 0;
+};
+
+/**
+ * @brief The state of the prediction of the labels by a fixed set of centroids, prepared once by
+ * `kmeans_balanced::make_predictor` to serve many small calls of `kmeans_balanced::predict`.
+ *
+ * It caches the norms of the centroids and the workspace of the batches of up to
+ * `kMaxSmallBatch` rows, which are labeled by a dedicated kernel instead of the distance tiles
+ * tuned for large batches. The centroids are not copied: they must outlive the predictor. The
+ * calls sharing a predictor share its workspace, so they must be ordered (e.g. on one stream).
+ *
+ * @tparam MathT Type of the centroids and mapped data.
+ * @tparam IndexT Type used for indexing.
+ */
+template <typename MathT, typename IndexT>
+struct predictor {
+  /** The batches of up to this many rows take the low-latency path. */
+  static constexpr uint32_t kMaxSmallBatch = 64;
+
+  /**
+   * Allocate a predictor for the centroids, filled by `kmeans_balanced::make_predictor`.
+   *
+   * @param[in] res raft resources
+   * @param[in] metric the distance metric
+   * @param[in] centroids the centroids [n_clusters, n_features]
+   * @param[in] small_batch_splits the number of the parts of the centroids searched in parallel
+   *   for a row of a small batch (zero disables the low-latency path)
+   */
+  predictor(const raft::resources& res,
+            raft::distance::DistanceType metric,
+            raft::device_matrix_view<const MathT, IndexT> centroids,
+            uint32_t small_batch_splits)
+    : metric_(metric),
+      centroids_(centroids),
+      small_batch_splits_(small_batch_splits),
+      centroids_norm_(raft::make_device_vector<MathT, IndexT>(
+        res, metric == raft::distance::DistanceType::InnerProduct ? 0 : centroids.extent(0))),
+      workspace_(raft::make_device_vector<raft::KeyValuePair<IndexT, MathT>, IndexT>(
+        res, IndexT(kMaxSmallBatch) * IndexT(small_batch_splits)))
+  {
+  }
+
+  /** The distance metric. */
+  [[nodiscard]] inline auto metric() const noexcept -> raft::distance::DistanceType
+  {
+    return metric_;
+  }
+  /** The centroids [n_clusters, n_features]. */
+  [[nodiscard]] inline auto centroids() const noexcept
+    -> raft::device_matrix_view<const MathT, IndexT>
+  {
+    return centroids_;
+  }
+  /** The squared norms of the centroids [n_clusters] (empty for the inner product). */
+  [[nodiscard]] inline auto centroids_norm() noexcept -> raft::device_vector_view<MathT, IndexT>
+  {
+    return centroids_norm_.view();
+  }
+  [[nodiscard]] inline auto centroids_norm() const noexcept
+    -> raft::device_vector_view<const MathT, IndexT>
+  {
+    return centroids_norm_.view();
+  }
+  /** The number of the parts of the centroids searched in parallel for a row of a small batch. */
+  [[nodiscard]] inline auto small_batch_splits() const noexcept -> uint32_t
+  {
+    return small_batch_splits_;
+  }
+  /** The best centroid of every part for every row of a small batch [kMaxSmallBatch, splits]. */
+  [[nodiscard]] inline auto workspace() const noexcept -> raft::KeyValuePair<IndexT, MathT>*
+  {
+    return workspace_.data_handle();
+  }
+
+ private:
+  raft::distance::DistanceType metric_;
+  raft::device_matrix_view<const MathT, IndexT> centroids_;
+  uint32_t small_batch_splits_;
+  raft::device_vector<MathT, IndexT> centroids_norm_;
+  mutable raft::device_vector<raft::KeyValuePair<IndexT, MathT>, IndexT> workspace_;
 };
 
 }  // namespace raft::cluster::kmeans_balanced
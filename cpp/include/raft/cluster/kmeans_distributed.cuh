@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <optional>
+#include <raft/cluster/detail/kmeans_distributed.cuh>
+#include <raft/cluster/kmeans_types.hpp>
+#include <raft/core/mdarray.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resources.hpp>
+
+namespace raft::cluster::kmeans {
+
+/**
+ * @brief Find clusters with k-means algorithm, the dataset being partitioned by rows across the
+ *   ranks of the communicator of the resources (e.g. one rank per GPU of a cluster).
+ *
+ *   Every iteration, each rank assigns its samples to the nearest centroids and computes the
+ *   per-cluster sums and weights of its partition, which are reduced with `allreduce`; all the
+ *   ranks hold the same centroids. InitMethod::KMeansPlusPlus runs the distributed k-means||
+ *   (`oversampling_factor > 0`); InitMethod::Random draws the centroids uniformly from all the
+ *   partitions.
+ *
+ * @code{.cpp}
+ *   #include <raft/cluster/kmeans_distributed.cuh>
+ *   ...
+ *   // the resources must carry the communicator, see raft::resource::set_comms
+ *   raft::cluster::KMeansParams params;
+ *   auto centroids = raft::make_device_matrix<float, int>(handle, params.n_clusters, n_features);
+ *
+ *   kmeans::fit_distributed(handle,
+ *                           params,
+ *                           X_local,
+ *                           std::nullopt,
+ *                           centroids.view(),
+ *                           raft::make_host_scalar_view(&inertia),
+ *                           raft::make_host_scalar_view(&n_iter));
+ * @endcode
+ *
+ * @tparam DataT the type of data used for weights, distances.
+ * @tparam IndexT the type of data used for indexing.
+ * @param[in]     handle        The raft handle, with the communicator set.
+ * @param[in]     params        Parameters for KMeans model, the same on all the ranks.
+ * @param[in]     X             The partition of the training instances held by
+ *                              this rank, in row-major format.
+ *                              [dim = n_local_samples x n_features]
+ * @param[in]     sample_weight Optional weights for each observation in X.
+ *                              [len = n_local_samples]
+ * @param[inout]  centroids     [in] When init is InitMethod::Array, use
+ *                              centroids as the initial cluster centers
+ *                              (the same on all the ranks).
+ *                              [out] The generated centroids, the same on all
+ *                              the ranks.
+ *                              [dim = n_clusters x n_features]
+ * @param[out]    inertia       Sum of squared distances of all the samples to
+ *                              their closest cluster center.
+ * @param[out]    n_iter        Number of iterations run.
+ */
+template <typename DataT, typename IndexT>
+void fit_distributed(raft::resources const& handle,
+                     const KMeansParams& params,
+                     raft::device_matrix_view<const DataT, IndexT> X,
+                     std::optional<raft::device_vector_view<const DataT, IndexT>> sample_weight,
+                     raft::device_matrix_view<DataT, IndexT> centroids,
+                     raft::host_scalar_view<DataT> inertia,
+                     raft::host_scalar_view<IndexT> n_iter)
+{
+  detail::kmeans_fit_distributed<DataT, IndexT>(
+    handle, params, X, sample_weight, centroids, inertia, n_iter);
+}
+
+}  // namespace raft::cluster::kmeans
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -111,6 +111,31 @@ struct KMeansParams : kmeans_base_params {
   int batch_centroids = 0;  //
 
   bool inertia_check = false;
+
+  /**
+   * Skip the distance computations that cannot change the assignment of a sample, using
+   * Hamerly's triangle-inequality bounds (L2 metrics only; ignored otherwise).
+   *
+   * Every iteration then computes the distance of each sample to its assigned centroid, and
+   * compares only the samples whose bounds do not prove the assignment with all the centroids.
+   * This costs two vectors of n_samples elements, and pays off most for large n_clusters.
+   */
+  bool hamerly_bounds = false;
+
+  /**
+   * Number of samples of a mini-batch; 0 (default) runs the full-batch (Lloyd) k-means.
+   *
+   * When positive, `fit` runs mini-batch k-means: every iteration moves the centroids towards
+   * a random batch of `mini_batch_size` samples, `max_iter` is the number of batches and `tol`
+   * is not used. This allows clustering datasets that do not fit in device memory.
+   */
+  int mini_batch_size = 0;
+
+  /**
+   * Mini-batch k-means only: stop when the smoothed batch inertia has not improved during this
+   * many consecutive batches (0 disables the check).
+   */
+  int max_no_improvement = 10;
 };
 
 }  // namespace raft::cluster::kmeans
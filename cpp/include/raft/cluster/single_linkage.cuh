@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,9 @@
 #include <raft/cluster/detail/single_linkage.cuh>
 #include <raft/cluster/single_linkage_types.hpp>
 #include <raft/core/device_mdspan.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+
+#include <rmm/device_uvector.hpp>
 
 namespace raft::cluster {
 
@@ -109,4 +112,66 @@ void single_linkage(raft::resources const& handle,
     c.has_value() ? c.value() : DEFAULT_CONST_C,
     n_clusters);
 }
+
+/**
+ * Exact minimum spanning tree of the complete graph of the points of X by Borůvka's algorithm,
+ * optionally on the mutual reachability distances of HDBSCAN. Every round connects each
+ * component to its nearest other component by a masked 1-nn over the points, so that the MST is
+ * found in at most log2(n_rows) rounds without building a distance matrix or a knn graph.
+ *
+ * @code{.cpp}
+ *   auto src = raft::make_device_vector<int>(handle, n_rows - 1);
+ *   auto dst = raft::make_device_vector<int>(handle, n_rows - 1);
+ *   auto w   = raft::make_device_vector<float>(handle, n_rows - 1);
+ *   // MST of the mutual reachability graph with 5-nn core distances
+ *   raft::cluster::hierarchy::build_mst(handle, X, src.view(), dst.view(), w.view(),
+ *                                       raft::distance::DistanceType::L2SqrtExpanded, 5);
+ * @endcode
+ *
+ * @tparam value_t
+ * @tparam idx_t
+ * @param[in] handle raft handle
+ * @param[in] X dense input matrix in row-major layout [n_rows, n_cols]
+ * @param[out] mst_src source vertices of the edges, sorted by weight [n_rows - 1]
+ * @param[out] mst_dst destination vertices of the edges [n_rows - 1]
+ * @param[out] mst_weights weights of the edges [n_rows - 1]
+ * @param[in] metric L2Expanded or L2SqrtExpanded (or their unexpanded variants)
+ * @param[in] min_samples when positive, the edges are weighted by the mutual reachability
+ *            distance max(core(a), core(b), d(a, b)), where core() is the distance to the
+ *            `min_samples`-th nearest neighbor (the point itself included)
+ */
+template <typename value_t, typename idx_t>
+void build_mst(raft::resources const& handle,
+               raft::device_matrix_view<const value_t, idx_t, row_major> X,
+               raft::device_vector_view<idx_t, idx_t> mst_src,
+               raft::device_vector_view<idx_t, idx_t> mst_dst,
+               raft::device_vector_view<value_t, idx_t> mst_weights,
+               raft::distance::DistanceType metric = raft::distance::DistanceType::L2SqrtExpanded,
+               int min_samples                     = 0)
+{
+  auto m = static_cast<std::size_t>(X.extent(0));
+  auto n = static_cast<std::size_t>(X.extent(1));
+  RAFT_EXPECTS(m > 0, "The input must not be empty");
+  RAFT_EXPECTS(static_cast<std::size_t>(mst_src.extent(0)) == m - 1 &&
+                 static_cast<std::size_t>(mst_dst.extent(0)) == m - 1 &&
+                 static_cast<std::size_t>(mst_weights.extent(0)) == m - 1,
+               "The MST outputs must have n_rows - 1 elements");
+
+  rmm::device_uvector<value_t> core_dists(min_samples > 0 ? m : 0,
+                                          resource::get_cuda_stream(handle));
+  if (min_samples > 0) {
+    raft::cluster::detail::core_distances<idx_t, value_t>(
+      handle, X.data_handle(), m, n, min_samples, metric, core_dists.data());
+  }
+  raft::cluster::detail::build_sorted_mst_boruvka<idx_t, value_t>(
+    handle,
+    X.data_handle(),
+    m,
+    n,
+    metric,
+    min_samples > 0 ? core_dists.data() : nullptr,
+    mst_src.data_handle(),
+    mst_dst.data_handle(),
+    mst_weights.data_handle());
+}
 };  // namespace raft::cluster::hierarchy
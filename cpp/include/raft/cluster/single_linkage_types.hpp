@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -36,7 +36,14 @@ enum LinkageDistance {
    * edges if the mst does not converge. This is slower but scales
    * to very large datasets.
    */
-  KNN_GRAPH = 1
+  KNN_GRAPH = 1,
+
+  /**
+   * Build the exact MST directly on the points by Borůvka's algorithm, with a masked
+   * (cross-component) 1-nn per round: neither the pairwise distances nor a knn graph are stored.
+   * Supports only the L2 distances.
+   */
+  BORUVKA = 2
 };
 
 };  // end namespace raft::cluster::hierarchy
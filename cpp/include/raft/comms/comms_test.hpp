@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -156,6 +156,42 @@ bool test_pointToPoint_device_multicast_sendrecv(raft::resources const& h, int n
   return detail::test_pointToPoint_device_multicast_sendrecv(h, numTrials);
 }
 
+/**
+ * A simple sanity check that a batch of tagged device transfers matches the messages by tag,
+ * whatever the order the sends and the receives were posted in.
+ *
+ * @param h the raft handle to use. This is expected to already have an
+ *        initialized comms instance.
+ * @param numTrials number of iterations of send or receive messaging to perform
+ */
+bool test_pointToPoint_device_p2p_batch(raft::resources const& h, int numTrials)
+{
+  return detail::test_pointToPoint_device_p2p_batch(h, numTrials);
+}
+
+/**
+ * A simple sanity check of the hierarchical (intra-node / inter-node) collectives.
+ *
+ * @param h the raft handle to use. This is expected to already have an
+ *        initialized comms instance.
+ */
+bool test_hierarchical_collectives(raft::resources const& h)
+{
+  return detail::test_hierarchical_collectives(h);
+}
+
+/**
+ * A simple sanity check of the allreduce, allgather and reducescatter of half and bfloat16
+ * buffers.
+ *
+ * @param h the raft handle to use. This is expected to already have an
+ *        initialized comms instance.
+ */
+bool test_collective_low_precision(raft::resources const& h)
+{
+  return detail::test_collective_low_precision(h);
+}
+
 /**
  * A simple test that the comms can be split into 2 separate subcommunicators
  *
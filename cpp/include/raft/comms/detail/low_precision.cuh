@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/comms.hpp>
+#include <raft/util/cuda_dev_essentials.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+namespace raft::comms::detail {
+
+/** Casts `n` elements of `in` to the type of `out` (zero-filling the `n_padded - n` last ones). */
+template <typename out_t, typename in_t>
+RAFT_KERNEL cast_kernel(const in_t* in, out_t* out, size_t n, size_t n_padded)
+{
+  for (size_t i = size_t(blockIdx.x) * blockDim.x + threadIdx.x; i < n_padded;
+       i += size_t(blockDim.x) * gridDim.x) {
+    out[i] = i < n ? static_cast<out_t>(static_cast<float>(in[i])) : out_t(0.0f);
+  }
+}
+
+template <typename out_t, typename in_t>
+void cast(const in_t* in, out_t* out, size_t n, size_t n_padded, cudaStream_t stream)
+{
+  if (n_padded == 0) { return; }
+  constexpr int kTpb = 256;
+  auto n_blocks      = std::min<size_t>(raft::ceildiv<size_t>(n_padded, kTpb), 65535);
+  cast_kernel<<<n_blocks, kTpb, 0, stream>>>(in, out, n, n_padded);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/**
+ * Reduces the `n_chunks` chunks of `chunk` low-precision elements of `in` (one per rank), in
+ * fp32 (or in `value_t` for wider types), into `out`.
+ */
+template <typename value_t, typename wire_t>
+RAFT_KERNEL accumulate_chunks_kernel(
+  const wire_t* in, value_t* out, size_t chunk, size_t n_out, int n_chunks, op_t op)
+{
+  using acc_t = std::conditional_t<(sizeof(value_t) > sizeof(float)), value_t, float>;
+  for (size_t i = size_t(blockIdx.x) * blockDim.x + threadIdx.x; i < n_out;
+       i += size_t(blockDim.x) * gridDim.x) {
+    acc_t acc = static_cast<float>(in[i]);
+    for (int c = 1; c < n_chunks; c++) {
+      acc_t v = static_cast<float>(in[c * chunk + i]);
+      switch (op) {
+        case op_t::SUM: acc += v; break;
+        case op_t::PROD: acc *= v; break;
+        case op_t::MIN: acc = v < acc ? v : acc; break;
+        case op_t::MAX: acc = v > acc ? v : acc; break;
+      }
+    }
+    out[i] = static_cast<value_t>(acc);
+  }
+}
+
+/**
+ * Reduce-scatter of `chunk` elements per rank with a low-precision exchange: the input is cast
+ * to `wire_t`, the chunk r of every rank is sent to the rank r (an all-to-all, which moves the
+ * same number of bytes as a ring reduce-scatter) and the received chunks are accumulated in
+ * full precision into `out` (`n_out <= chunk` elements).
+ */
+template <typename wire_t, typename value_t>
+void reducescatter_low_precision(const comms_t& comms,
+                                 const value_t* in,
+                                 size_t n_in,
+                                 value_t* out,
+                                 size_t chunk,
+                                 size_t n_out,
+                                 op_t op,
+                                 cudaStream_t stream)
+{
+  int size = comms.get_size();
+  rmm::device_uvector<wire_t> wire_send(size * chunk, stream);
+  rmm::device_uvector<wire_t> wire_recv(size * chunk, stream);
+  cast(in, wire_send.data(), n_in, size * chunk, stream);
+
+  std::vector<size_t> sizes(size, chunk), offsets(size);
+  std::vector<int> ranks(size);
+  for (int r = 0; r < size; r++) {
+    offsets[r] = r * chunk;
+  }
+  std::iota(ranks.begin(), ranks.end(), 0);
+  comms.device_multicast_sendrecv(
+    wire_send.data(), sizes, offsets, ranks, wire_recv.data(), sizes, offsets, ranks, stream);
+
+  if (n_out == 0) { return; }
+  constexpr int kTpb = 256;
+  auto n_blocks      = std::min<size_t>(raft::ceildiv<size_t>(n_out, kTpb), 65535);
+  accumulate_chunks_kernel<<<n_blocks, kTpb, 0, stream>>>(
+    wire_recv.data(), out, chunk, n_out, size, op);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+}  // namespace raft::comms::detail
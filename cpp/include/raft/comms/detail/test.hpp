@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,6 +19,7 @@
 #include <raft/comms/comms.hpp>
 #include <raft/core/resource/comms.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/sub_comms.hpp>
 #include <raft/core/resources.hpp>
 #include <rmm/device_scalar.hpp>
 #include <rmm/device_uvector.hpp>
@@ -515,6 +516,65 @@ bool test_pointToPoint_device_multicast_sendrecv(raft::resources const& h, int n
   return ret;
 }
 
+/**
+ * A simple sanity check that a batch of tagged device transfers matches the messages by tag,
+ * whatever the order the sends and the receives were posted in.
+ *
+ * @param h the raft handle to use. This is expected to already have an
+ *        initialized comms instance.
+ * @param numTrials number of iterations of send or receive messaging to perform
+ */
+bool test_pointToPoint_device_p2p_batch(raft::resources const& h, int numTrials)
+{
+  comms_t const& communicator = resource::get_comms(h);
+  int const rank              = communicator.get_rank();
+  int const size              = communicator.get_size();
+  cudaStream_t stream         = resource::get_cuda_stream(h);
+  int const n_tags            = 2;
+
+  bool ret = true;
+  for (int i = 0; i < numTrials; i++) {
+    if (communicator.get_rank() == 0) {
+      std::cout << "=========================" << std::endl;
+      std::cout << "Trial " << i << std::endl;
+    }
+
+    // message (rank, tag) holds rank * n_tags + tag
+    std::vector<int> h_sent_data(n_tags);
+    std::iota(h_sent_data.begin(), h_sent_data.end(), rank * n_tags);
+    rmm::device_uvector<int> sent_data(n_tags, stream);
+    raft::update_device(sent_data.data(), h_sent_data.data(), n_tags, stream);
+    rmm::device_uvector<int> received_data(size * n_tags, stream);
+
+    // the sends are posted in decreasing and the receives in increasing tag order
+    device_p2p_batch batch(communicator);
+    for (int peer = 0; peer < size; peer++) {
+      for (int tag = n_tags - 1; tag >= 0; tag--) {
+        batch.send(sent_data.data() + tag, 1, peer, tag);
+      }
+    }
+    for (int peer = 0; peer < size; peer++) {
+      for (int tag = 0; tag < n_tags; tag++) {
+        batch.recv(received_data.data() + peer * n_tags + tag, 1, peer, tag);
+      }
+    }
+    batch.execute(stream);
+
+    communicator.sync_stream(stream);
+
+    std::vector<int> h_received_data(size * n_tags);
+    raft::update_host(h_received_data.data(), received_data.data(), received_data.size(), stream);
+    resource::sync_stream(h, stream);
+    for (int j = 0; j < size * n_tags; ++j) {
+      if (h_received_data[j] != j) { ret = false; }
+    }
+
+    if (communicator.get_rank() == 0) { std::cout << "=========================" << std::endl; }
+  }
+
+  return ret;
+}
+
 /**
  * A simple test that the comms can be split into 2 separate subcommunicators
  *
@@ -541,6 +601,141 @@ bool test_commsplit(raft::resources const& h, int n_colors)
   return test_collective_allreduce(new_handle, 0);
 }
 
+/**
+ * A simple sanity check of the hierarchical (intra-node / inter-node) collectives.
+ *
+ * @param h the raft handle to use. This is expected to already have an
+ *        initialized comms instance.
+ */
+bool test_hierarchical_collectives(raft::resources const& h)
+{
+  comms_t const& communicator = resource::get_comms(h);
+  int const rank              = communicator.get_rank();
+  int const size              = communicator.get_size();
+  cudaStream_t stream         = resource::get_cuda_stream(h);
+
+  resource::init_hierarchical_comms(h);
+  auto const& hier = resource::get_hierarchical_comms(h);
+
+  // allreduce: the sum of the ranks
+  rmm::device_scalar<int> reduced(rank, stream);
+  hier.allreduce(reduced.data(), reduced.data(), 1, op_t::SUM, stream);
+
+  // allgather: the ranks in order
+  rmm::device_scalar<int> own(rank, stream);
+  rmm::device_uvector<int> gathered(size, stream);
+  hier.allgather(own.data(), gathered.data(), 1, stream);
+
+  // reducescatter: the block r of the rank s holds s + r
+  std::vector<int> h_blocks(size);
+  std::iota(h_blocks.begin(), h_blocks.end(), rank);
+  rmm::device_uvector<int> blocks(size, stream);
+  raft::update_device(blocks.data(), h_blocks.data(), size, stream);
+  rmm::device_scalar<int> scattered(0, stream);
+  hier.reducescatter(blocks.data(), scattered.data(), 1, op_t::SUM, stream);
+
+  communicator.sync_stream(stream);
+
+  std::vector<int> h_gathered(size);
+  raft::update_host(h_gathered.data(), gathered.data(), size, stream);
+  int h_reduced   = reduced.value(stream);
+  int h_scattered = scattered.value(stream);
+  resource::sync_stream(h, stream);
+
+  int rank_sum = size * (size - 1) / 2;
+  bool ret     = h_reduced == rank_sum && h_scattered == rank_sum + size * rank;
+  for (int r = 0; r < size; r++) {
+    ret = ret && h_gathered[r] == r;
+  }
+  return ret;
+}
+
+/** The host conversions of the 16-bit floating point types sent on the wire. */
+template <typename T>
+struct wire_type;
+
+template <>
+struct wire_type<half> {
+  static auto from_float(float v) -> half { return __float2half(v); }
+  static auto to_float(half v) -> float { return __half2float(v); }
+};
+
+template <>
+struct wire_type<nv_bfloat16> {
+  static auto from_float(float v) -> nv_bfloat16 { return __float2bfloat16(v); }
+  static auto to_float(nv_bfloat16 v) -> float { return __bfloat162float(v); }
+};
+
+/**
+ * The allreduce, allgather and reducescatter of the comms with 16-bit floating point buffers.
+ * The values are small integers and halves, exact in both half and bfloat16.
+ */
+template <typename T>
+bool test_collectives_of_type(raft::resources const& h)
+{
+  comms_t const& communicator = resource::get_comms(h);
+  int const rank              = communicator.get_rank();
+  int const size              = communicator.get_size();
+  cudaStream_t stream         = resource::get_cuda_stream(h);
+  auto from_float             = wire_type<T>::from_float;
+  auto to_float               = wire_type<T>::to_float;
+
+  // allreduce: the element i of the rank s holds s + i
+  std::vector<T> h_reduced(size);
+  for (int i = 0; i < size; i++) {
+    h_reduced[i] = from_float(rank + i);
+  }
+  rmm::device_uvector<T> reduced(size, stream);
+  raft::update_device(reduced.data(), h_reduced.data(), size, stream);
+  communicator.allreduce(reduced.data(), reduced.data(), size, op_t::SUM, stream);
+
+  // allgather: the rank s sends s and s + 0.5
+  std::vector<T> h_own{from_float(rank), from_float(rank + 0.5f)};
+  rmm::device_uvector<T> own(2, stream);
+  rmm::device_uvector<T> gathered(2 * size, stream);
+  raft::update_device(own.data(), h_own.data(), 2, stream);
+  communicator.allgather(own.data(), gathered.data(), 2, stream);
+
+  // reducescatter: the block r of the rank s holds s + r
+  rmm::device_uvector<T> blocks(size, stream);
+  raft::update_device(blocks.data(), h_reduced.data(), size, stream);
+  rmm::device_uvector<T> scattered(1, stream);
+  communicator.reducescatter(blocks.data(), scattered.data(), 1, op_t::SUM, stream);
+
+  communicator.sync_stream(stream);
+
+  std::vector<T> h_gathered(2 * size);
+  T h_scattered;
+  raft::update_host(h_reduced.data(), reduced.data(), size, stream);
+  raft::update_host(h_gathered.data(), gathered.data(), 2 * size, stream);
+  raft::update_host(&h_scattered, scattered.data(), 1, stream);
+  resource::sync_stream(h, stream);
+  communicator.barrier();
+
+  float rank_sum = size * (size - 1) / 2;
+  bool ret       = to_float(h_scattered) == rank_sum + size * rank;
+  for (int r = 0; r < size; r++) {
+    ret = ret && to_float(h_reduced[r]) == rank_sum + size * r;
+    ret = ret && to_float(h_gathered[2 * r]) == r && to_float(h_gathered[2 * r + 1]) == r + 0.5f;
+  }
+  return ret;
+}
+
+/**
+ * A simple sanity check of the collectives with half and bfloat16 buffers.
+ *
+ * @param h the raft handle to use. This is expected to already have an
+ *        initialized comms instance.
+ */
+bool test_collective_low_precision(raft::resources const& h)
+{
+  bool ret = test_collectives_of_type<half>(h);
+  std::cout << "half collectives: " << ret << std::endl;
+  bool ret_bf16 = test_collectives_of_type<nv_bfloat16>(h);
+  std::cout << "bfloat16 collectives: " << ret_bf16 << std::endl;
+  return ret && ret_bf16;
+}
+
 }  // namespace detail
 }  // namespace comms
 };  // namespace raft
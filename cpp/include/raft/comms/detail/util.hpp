@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2022, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -76,6 +76,8 @@ constexpr size_t get_datatype_size(const datatype_t datatype)
     case datatype_t::UINT64: return sizeof(uint64_t);
     case datatype_t::FLOAT32: return sizeof(float);
     case datatype_t::FLOAT64: return sizeof(double);
+    case datatype_t::FLOAT16: return sizeof(half);
+    case datatype_t::BFLOAT16: return sizeof(nv_bfloat16);
     default: throw "Unsupported datatype";
   }
 }
@@ -91,6 +93,10 @@ constexpr ncclDataType_t get_nccl_datatype(const datatype_t datatype)
     case datatype_t::UINT64: return ncclUint64;
     case datatype_t::FLOAT32: return ncclFloat;
     case datatype_t::FLOAT64: return ncclDouble;
+    case datatype_t::FLOAT16: return ncclHalf;
+#if NCCL_VERSION_CODE >= NCCL_VERSION(2, 10, 0)
+    case datatype_t::BFLOAT16: return ncclBfloat16;
+#endif
     default: throw "Unsupported datatype";
   }
 }
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/comms/detail/low_precision.cuh>
+#include <raft/core/comms.hpp>
+
+namespace raft::comms {
+
+/**
+ * @defgroup comms_low_precision Collectives with a low-precision exchange
+ *
+ * The collectives below exchange `half` or `nv_bfloat16` data (`wire_t`) instead of `value_t`
+ * (float or double), which halves (or quarters) the bytes sent over the interconnect for the
+ * algorithms tolerating the rounding, e.g. the updates of large centroid or codebook buffers.
+ * The casts are done on the stream before and after the NCCL calls. The reductions are not
+ * done by NCCL in the low precision: the chunks are exchanged with an all-to-all and
+ * accumulated in fp32 (or in `value_t` when it is wider) by their receiver, which moves the
+ * same number of bytes as the ring algorithm.
+ *
+ * They need a communicator supporting the device point-to-point operations, and allocate the
+ * low-precision staging buffers on the stream.
+ * @{
+ */
+
+/**
+ * Reduce the arrays of `count` elements of every rank and write the result in `recvbuff`
+ * of every rank. The result is rounded to `wire_t` (once, after the fp32 accumulation), so it
+ * is identical on all the ranks.
+ *
+ * @tparam wire_t the type of the exchanged data (half or nv_bfloat16)
+ * @tparam value_t datatype of the buffers
+ * @param comms the communicator
+ * @param sendbuff data to reduce
+ * @param recvbuff buffer to hold the reduced result (may be sendbuff)
+ * @param count number of elements in sendbuff
+ * @param op reduction operation to perform
+ * @param stream CUDA stream to synchronize operation
+ */
+template <typename wire_t = half, typename value_t>
+void allreduce_low_precision(const comms_t& comms,
+                             const value_t* sendbuff,
+                             value_t* recvbuff,
+                             size_t count,
+                             op_t op,
+                             cudaStream_t stream)
+{
+  int size     = comms.get_size();
+  int rank     = comms.get_rank();
+  size_t chunk = raft::ceildiv<size_t>(count, size);
+  size_t begin = std::min(count, rank * chunk);
+  size_t n_own = std::min(count, begin + chunk) - begin;
+
+  // reduce-scatter in full precision, then allgather of the rounded chunks
+  rmm::device_uvector<value_t> reduced(chunk, stream);
+  detail::reducescatter_low_precision<wire_t>(
+    comms, sendbuff, count, reduced.data(), chunk, n_own, op, stream);
+  rmm::device_uvector<wire_t> wire(size * chunk, stream);
+  detail::cast(reduced.data(), wire.data() + rank * chunk, n_own, chunk, stream);
+  comms.allgather(wire.data() + rank * chunk, wire.data(), chunk, stream);
+  detail::cast(wire.data(), recvbuff, count, count, stream);
+}
+
+/**
+ * Gathers `sendcount` elements of every rank into `recvbuff` of every rank, in the order of
+ * the ranks, exchanging them rounded to `wire_t`.
+ *
+ * @tparam wire_t the type of the exchanged data (half or nv_bfloat16)
+ * @tparam value_t datatype of the buffers
+ * @param comms the communicator
+ * @param sendbuff data to send
+ * @param recvbuff buffer of size * sendcount elements to hold the gathered data
+ * @param sendcount number of elements in sendbuff
+ * @param stream CUDA stream to synchronize operation
+ */
+template <typename wire_t = half, typename value_t>
+void allgather_low_precision(const comms_t& comms,
+                             const value_t* sendbuff,
+                             value_t* recvbuff,
+                             size_t sendcount,
+                             cudaStream_t stream)
+{
+  int size = comms.get_size();
+  int rank = comms.get_rank();
+  rmm::device_uvector<wire_t> wire(size * sendcount, stream);
+  detail::cast(sendbuff, wire.data() + rank * sendcount, sendcount, sendcount, stream);
+  comms.allgather(wire.data() + rank * sendcount, wire.data(), sendcount, stream);
+  detail::cast(wire.data(), recvbuff, size * sendcount, size * sendcount, stream);
+}
+
+/**
+ * Reduces the arrays of `size * recvcount` elements of every rank and scatters the result: the
+ * block r of `recvcount` elements goes to the rank r. The inputs are exchanged rounded to
+ * `wire_t` and accumulated in fp32 (or in `value_t` when it is wider).
+ *
+ * @tparam wire_t the type of the exchanged data (half or nv_bfloat16)
+ * @tparam value_t datatype of the buffers
+ * @param comms the communicator
+ * @param sendbuff data to reduce (size * recvcount elements)
+ * @param recvbuff buffer of recvcount elements to hold the reduced block of this rank
+ * @param recvcount number of elements in recvbuff
+ * @param op reduction operation to perform
+ * @param stream CUDA stream to synchronize operation
+ */
+template <typename wire_t = half, typename value_t>
+void reducescatter_low_precision(const comms_t& comms,
+                                 const value_t* sendbuff,
+                                 value_t* recvbuff,
+                                 size_t recvcount,
+                                 op_t op,
+                                 cudaStream_t stream)
+{
+  detail::reducescatter_low_precision<wire_t>(comms,
+                                              sendbuff,
+                                              comms.get_size() * recvcount,
+                                              recvbuff,
+                                              recvcount,
+                                              recvcount,
+                                              op,
+                                              stream);
+}
+
+/**
+ * @}
+ */
+
+}  // namespace raft::comms
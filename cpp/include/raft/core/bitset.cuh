@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <raft/core/detail/bitset_ops.cuh>
 #include <raft/core/detail/mdspan_util.cuh>  // native_popc
 #include <raft/core/device_container_policy.hpp>
 #include <raft/core/device_mdarray.hpp>
@@ -26,6 +27,9 @@
 #include <raft/util/device_atomics.cuh>
 #include <thrust/for_each.h>
 
+#include <type_traits>
+#include <vector>
+
 namespace raft::core {
 /**
  * @defgroup bitset Bitset
@@ -59,6 +63,14 @@ struct bitset_view {
     : bitset_ptr_{bitset_span.data_handle()}, bitset_len_{bitset_len}
   {
   }
+  /**
+   * @brief Convert to a read-only view of the same bitset.
+   */
+  template <typename T = bitset_t, typename = std::enable_if_t<!std::is_const_v<T>>>
+  _RAFT_HOST_DEVICE operator bitset_view<const T, index_t>() const
+  {
+    return bitset_view<const T, index_t>(bitset_ptr_, bitset_len_);
+  }
   /**
    * @brief Device function to test if a given index is set in the bitset.
    *
@@ -323,7 +335,8 @@ struct bitset {
    * @param[in] res RAFT resources
    * @param[out] count_gpu_scalar Device scalar to store the count
    */
-  void count(const raft::resources& res, raft::device_scalar_view<index_t> count_gpu_scalar)
+  void count(const raft::resources& res,
+             raft::device_scalar_view<index_t> count_gpu_scalar) const
   {
     auto n_elements_ = n_elements();
     auto count_gpu =
@@ -363,7 +376,7 @@ struct bitset {
    * @param res RAFT resources
    * @return index_t Number of bits set to true
    */
-  auto count(const raft::resources& res) -> index_t
+  auto count(const raft::resources& res) const -> index_t
   {
     auto count_gpu_scalar = raft::make_device_scalar<index_t>(res, 0.0);
     count(res, count_gpu_scalar.view());
@@ -389,10 +402,149 @@ struct bitset {
    */
   bool none(const raft::resources& res) { return count(res) == 0; }
 
+  /**
+   * @brief Write the indices of the bits set to true, in increasing order (select).
+   *
+   * Converts a sparse bitset to the compact list of ids it admits, e.g. for a brute-force search
+   * over the few rows passing a filter.
+   *
+   * @param[in] res RAFT resources
+   * @param[out] indices the indices of the bits set; those past its size are dropped
+   * @param[out] n_indices the number of bits set (which may exceed the size of indices)
+   */
+  void to_indices(const raft::resources& res,
+                  raft::device_vector_view<index_t, index_t> indices,
+                  raft::device_scalar_view<index_t> n_indices) const
+  {
+    auto offsets = raft::make_device_vector<index_t, index_t>(res, n_elements() + 1);
+    detail::bitset_select(res,
+                          bitset_.data(),
+                          bitset_len_,
+                          offsets.data_handle(),
+                          indices.data_handle(),
+                          indices.extent(0),
+                          n_indices.data_handle());
+  }
+  /**
+   * @brief Returns the indices of the bits set to true, in increasing order.
+   *
+   * @param res RAFT resources
+   * @return device vector of the indices
+   */
+  auto to_indices(const raft::resources& res) const -> raft::device_vector<index_t, index_t>
+  {
+    auto n       = count(res);
+    auto indices = raft::make_device_vector<index_t, index_t>(res, n);
+    auto n_gpu   = raft::make_device_scalar<index_t>(res, 0);
+    to_indices(res, indices.view(), n_gpu.view());
+    return indices;
+  }
+  /**
+   * @brief Number of bits set to true before each of a list of indices (rank).
+   *
+   * @tparam output_t Output type of the rank
+   * @param res RAFT resources
+   * @param queries List of indices
+   * @param output List of ranks: the position of each query in to_indices() when it is set
+   */
+  template <typename output_t = index_t>
+  void rank(const raft::resources& res,
+            raft::device_vector_view<const index_t, index_t> queries,
+            raft::device_vector_view<output_t, index_t> output) const
+  {
+    RAFT_EXPECTS(output.extent(0) == queries.extent(0), "Output and queries must be same size");
+    auto offsets = raft::make_device_vector<index_t, index_t>(res, n_elements() + 1);
+    detail::bitset_rank(res,
+                        bitset_.data(),
+                        bitset_len_,
+                        offsets.data_handle(),
+                        queries.data_handle(),
+                        queries.extent(0),
+                        output.data_handle());
+  }
+
  private:
   raft::device_uvector<bitset_t> bitset_;
   index_t bitset_len_;
 };
 
+/**
+ * @brief Combine bitsets of the same size in one pass: output = ((in[0] op[0] in[1]) op[1] ...).
+ *
+ * For example, the filter of a search over the rows of a tenant, within a time range, and not
+ * deleted:
+ * @code{.cpp}
+ *   raft::core::bitset_combine(res,
+ *                              {tenant.view(), time_range.view(), deleted.view()},
+ *                              {bitset_op::AND, bitset_op::AND_NOT},
+ *                              filter.view());
+ * @endcode
+ * The bitsets are read by 16-byte vectors when all of them are aligned. The output may be one of
+ * the inputs.
+ *
+ * @param[in] res RAFT resources
+ * @param[in] inputs between 1 and 8 bitsets
+ * @param[in] ops the inputs.size() - 1 operations
+ * @param[out] output the combination
+ */
+template <typename bitset_t, typename index_t>
+void bitset_combine(const raft::resources& res,
+                    const std::vector<bitset_view<const bitset_t, index_t>>& inputs,
+                    const std::vector<bitset_op>& ops,
+                    bitset_view<bitset_t, index_t> output)
+{
+  detail::bitset_combine<bitset_t, index_t>(
+    res, inputs, ops, output.size(), output.data(), static_cast<index_t*>(nullptr));
+}
+
+/**
+ * @brief Count the bits set in a combination of bitsets (see bitset_combine) without writing it.
+ *
+ * @param[in] res RAFT resources
+ * @param[in] inputs between 1 and 8 bitsets of the same size
+ * @param[in] ops the inputs.size() - 1 operations
+ * @param[out] count_gpu_scalar Device scalar to store the count
+ */
+template <typename bitset_t, typename index_t>
+void bitset_count(const raft::resources& res,
+                  const std::vector<bitset_view<const bitset_t, index_t>>& inputs,
+                  const std::vector<bitset_op>& ops,
+                  raft::device_scalar_view<index_t> count_gpu_scalar)
+{
+  RAFT_EXPECTS(!inputs.empty(), "At least one bitset must be given");
+  detail::bitset_combine<bitset_t, index_t>(res,
+                                            inputs,
+                                            ops,
+                                            inputs.front().size(),
+                                            static_cast<bitset_t*>(nullptr),
+                                            count_gpu_scalar.data_handle());
+}
+
+/**
+ * @brief Estimate the bits set in a combination of bitsets from a sample of its elements.
+ *
+ * The popcount of `n_samples` elements spread evenly over the bitsets, extrapolated to their
+ * size: a single small kernel and no synchronization, for the selectivity of a filter when
+ * planning a search (e.g. to fall back to a brute-force search over to_indices() when few
+ * rows pass). The estimate is exact when n_samples is at least the number of elements.
+ *
+ * @param[in] res RAFT resources
+ * @param[in] inputs between 1 and 8 bitsets of the same size
+ * @param[in] ops the inputs.size() - 1 operations
+ * @param[out] count_gpu_scalar Device scalar to store the estimate
+ * @param[in] n_samples the number of elements sampled
+ */
+template <typename bitset_t, typename index_t>
+void bitset_estimate_count(const raft::resources& res,
+                           const std::vector<bitset_view<const bitset_t, index_t>>& inputs,
+                           const std::vector<bitset_op>& ops,
+                           raft::device_scalar_view<index_t> count_gpu_scalar,
+                           index_t n_samples = 4096)
+{
+  RAFT_EXPECTS(!inputs.empty(), "At least one bitset must be given");
+  detail::bitset_estimate_count<bitset_t, index_t>(
+    res, inputs, ops, inputs.front().size(), n_samples, count_gpu_scalar.data_handle());
+}
+
 /** @} */
 }  // end namespace raft::core
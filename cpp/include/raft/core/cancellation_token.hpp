@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/detail/macros.hpp>
+#include <raft/core/interruptible.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <cuda_runtime_api.h>
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+
+namespace raft {
+
+/**
+ * @addtogroup interruptible
+ * @{
+ */
+
+/**
+ * @brief Exception thrown at a cancellation point when the deadline of the work has passed.
+ */
+struct deadline_exceeded_exception : public interrupted_exception {
+  using interrupted_exception::interrupted_exception;
+};
+
+/**
+ * @brief A device-visible cancellation flag with an optional deadline.
+ *
+ * Unlike `raft::interruptible`, which only interrupts the host-side waiting, the flag of the token
+ * lives in mapped pinned memory, so that it is visible both to the host loops of the long-running
+ * algorithms (which check it between their kernel launches, see
+ * `raft::resource::check_cancellation`) and to the designated kernels, which can poll it with
+ * `raft::is_cancelled(flag)` and exit early.
+ *
+ * The token can be cancelled from any thread. The deadline is checked at the host-side
+ * cancellation points: once it has passed, the flag is raised for the kernels as well.
+ */
+class cancellation_token {
+ public:
+  using clock_type = std::chrono::steady_clock;
+
+  cancellation_token()
+  {
+    void* host_ptr   = nullptr;
+    void* device_ptr = nullptr;
+    RAFT_CUDA_TRY(cudaHostAlloc(&host_ptr, sizeof(int), cudaHostAllocMapped));
+    host_flag_  = static_cast<volatile int*>(host_ptr);
+    *host_flag_ = 0;
+    RAFT_CUDA_TRY(cudaHostGetDevicePointer(&device_ptr, host_ptr, 0));
+    device_flag_ = static_cast<volatile int*>(device_ptr);
+  }
+  ~cancellation_token() { RAFT_CUDA_TRY_NO_THROW(cudaFreeHost(const_cast<int*>(host_flag_))); }
+
+  cancellation_token(cancellation_token const&)            = delete;
+  cancellation_token(cancellation_token&&)                 = delete;
+  cancellation_token& operator=(cancellation_token const&) = delete;
+  cancellation_token& operator=(cancellation_token&&)      = delete;
+
+  /** Request the cancellation of the work (thread-safe). */
+  void cancel() noexcept { *host_flag_ = 1; }
+
+  /** Clear the cancellation request and the deadline, to reuse the token for new work. */
+  void reset() noexcept
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deadline_.reset();
+    deadline_passed_ = false;
+    *host_flag_      = 0;
+  }
+
+  /** Cancel the work if it is still running at `deadline`. */
+  void set_deadline(clock_type::time_point deadline)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deadline_ = deadline;
+  }
+  /** Cancel the work if it is still running after `timeout` from now. */
+  template <typename Rep, typename Period>
+  void set_timeout(std::chrono::duration<Rep, Period> timeout)
+  {
+    set_deadline(clock_type::now() + std::chrono::duration_cast<clock_type::duration>(timeout));
+  }
+  /** Remove the deadline (keeping any cancellation request). */
+  void clear_deadline()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deadline_.reset();
+  }
+  /** The current deadline, if any. */
+  [[nodiscard]] auto deadline() const -> std::optional<clock_type::time_point>
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deadline_;
+  }
+
+  /**
+   * Whether the work is cancelled: either `cancel` was called or the deadline has passed (in that
+   * case, the flag is raised for the kernels too).
+   */
+  [[nodiscard]] auto is_cancelled() -> bool
+  {
+    if (*host_flag_ != 0) { return true; }
+    if (check_deadline()) {
+      cancel();
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * A cancellation point: throw if the work is cancelled.
+   *
+   * @throw raft::deadline_exceeded_exception if the deadline has passed.
+   * @throw raft::interrupted_exception if `cancel` was called.
+   */
+  void check()
+  {
+    if (!is_cancelled()) { return; }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (deadline_passed_) {
+      throw deadline_exceeded_exception("The deadline of the work in this thread has passed.");
+    }
+    throw interrupted_exception("The work in this thread was cancelled.");
+  }
+
+  /**
+   * The device pointer to the flag, to pass to the kernels polling it with `raft::is_cancelled`.
+   * The flag is non-zero when the work is cancelled.
+   */
+  [[nodiscard]] auto device_flag() const noexcept -> const volatile int* { return device_flag_; }
+
+ private:
+  // the flag is written by any host thread and read by the host and the device
+  volatile int* host_flag_{nullptr};
+  volatile int* device_flag_{nullptr};
+  mutable std::mutex mutex_;
+  std::optional<clock_type::time_point> deadline_{std::nullopt};
+  bool deadline_passed_{false};
+
+  auto check_deadline() -> bool
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!deadline_.has_value() || clock_type::now() < *deadline_) { return false; }
+    deadline_passed_ = true;
+    return true;
+  }
+};
+
+/**
+ * @brief Check in a kernel whether the work of a `raft::cancellation_token` is cancelled.
+ *
+ * @param flag the device flag of the token (or nullptr for non-cancellable work)
+ */
+RAFT_INLINE_FUNCTION auto is_cancelled(const volatile int* flag) -> bool
+{
+  return flag != nullptr && *flag != 0;
+}
+
+/**
+ * @}
+ */
+
+}  // namespace raft
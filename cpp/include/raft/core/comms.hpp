@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,9 +16,14 @@
 
 #pragma once
 
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
 #include <cuda_runtime.h>
-#include <memory>
 #include <raft/core/error.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <tuple>
 #include <vector>
 
 namespace raft {
@@ -30,7 +35,18 @@ namespace comms {
  */
 
 typedef unsigned int request_t;
-enum class datatype_t { CHAR, UINT8, INT32, UINT32, INT64, UINT64, FLOAT32, FLOAT64 };
+enum class datatype_t {
+  CHAR,
+  UINT8,
+  INT32,
+  UINT32,
+  INT64,
+  UINT64,
+  FLOAT32,
+  FLOAT64,
+  FLOAT16,
+  BFLOAT16
+};
 enum class op_t { SUM, PROD, MIN, MAX };
 
 /**
@@ -111,6 +127,22 @@ get_type<double>()
   return datatype_t::FLOAT64;
 }
 
+template <>
+constexpr datatype_t
+
+get_type<half>()
+{
+  return datatype_t::FLOAT16;
+}
+
+template <>
+constexpr datatype_t
+
+get_type<nv_bfloat16>()
+{
+  return datatype_t::BFLOAT16;
+}
+
 /**
  * @}
  */
@@ -671,6 +703,105 @@ class comms_t {
   std::unique_ptr<comms_iface> impl_;
 };
 
+/**
+ * @brief A batch of tagged point-to-point transfers, executed on a CUDA stream.
+ *
+ * Unlike `isend`/`irecv`, which go through host-side requests that must be polled with
+ * `waitall` (and require synchronizing the stream around every exchange), the transfers of a
+ * batch are enqueued on the stream as a single group of `device_send`/`device_recv` operations
+ * (a NCCL group), so that they stay on the GPU timeline and overlap with the work of the other
+ * streams. No `request_t` is involved: the completion of the transfers is ordered on the stream.
+ *
+ * The device point-to-point operations have no tags: the sends and the receives between two
+ * ranks are matched in the order they are issued. The batch recovers the tag semantics by
+ * issuing them ordered by (peer, tag), the transfers with the same peer and tag keeping the
+ * order they were posted in. Hence both ranks of a pair must post the same tags in a batch,
+ * in any order, and a message is received by the receive of the same tag.
+ *
+ * @code{.cpp}
+ * raft::comms::device_p2p_batch batch(comms);
+ * batch.send(halo_left, n, left, 0);
+ * batch.send(halo_right, n, right, 1);
+ * batch.recv(ghost_right, n, right, 0);
+ * batch.recv(ghost_left, n, left, 1);
+ * batch.execute(stream);  // asynchronous with respect to the host
+ * @endcode
+ */
+class device_p2p_batch {
+ public:
+  explicit device_p2p_batch(const comms_t& comms) : comms_(comms) {}
+
+  /**
+   * Posts the send of `size` elements of `buf` to rank `dest`
+   *
+   * @tparam value_t the type of data to send
+   * @param buf pointer to array of data to send (must stay valid until the batch is executed)
+   * @param size number of elements in buf
+   * @param dest destination rank
+   * @param tag message tag, matched with the tag of the receive on `dest`
+   */
+  template <typename value_t>
+  void send(const value_t* buf, size_t size, int dest, int tag)
+  {
+    ops_.push_back(
+      {const_cast<value_t*>(buf), size * sizeof(value_t), dest, tag, true, ops_.size()});
+  }
+
+  /**
+   * Posts the receive of `size` elements into `buf` from rank `source`
+   *
+   * @tparam value_t the type of data to be received
+   * @param buf pointer to (initialized) array that will hold received data
+   * @param size number of elements in buf
+   * @param source source rank
+   * @param tag message tag, matched with the tag of the send on `source`
+   */
+  template <typename value_t>
+  void recv(value_t* buf, size_t size, int source, int tag)
+  {
+    ops_.push_back({buf, size * sizeof(value_t), source, tag, false, ops_.size()});
+  }
+
+  /** The number of transfers posted since the last execution. */
+  [[nodiscard]] auto size() const -> size_t { return ops_.size(); }
+
+  /**
+   * Enqueues all the posted transfers on `stream` as one group and clears the batch. The call
+   * does not synchronize the stream.
+   *
+   * @param stream CUDA stream to order the transfers on
+   */
+  void execute(cudaStream_t stream)
+  {
+    std::sort(ops_.begin(), ops_.end(), [](const p2p_op& a, const p2p_op& b) {
+      return std::tie(a.peer, a.tag, a.order) < std::tie(b.peer, b.tag, b.order);
+    });
+    comms_.group_start();
+    for (const auto& op : ops_) {
+      if (op.is_send) {
+        comms_.device_send(static_cast<const char*>(op.buf), op.bytes, op.peer, stream);
+      } else {
+        comms_.device_recv(static_cast<char*>(op.buf), op.bytes, op.peer, stream);
+      }
+    }
+    comms_.group_end();
+    ops_.clear();
+  }
+
+ private:
+  struct p2p_op {
+    void* buf;
+    size_t bytes;
+    int peer;
+    int tag;
+    bool is_send;
+    size_t order;
+  };
+
+  const comms_t& comms_;
+  std::vector<p2p_op> ops_;
+};
+
 /**
  * @}
  */
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -38,6 +38,10 @@ namespace raft {
  * straightforward cudaMemcpy. Any necessary device operations will be stream-ordered via the CUDA
  * stream provided by the `raft::resources` argument.
  *
+ * Matrices and 3-D arrays of the same data type whose rows (or columns) are contiguous in both
+ * mdspans, e.g. rows padded for alignment copied to or from compact rows, are copied with
+ * cudaMemcpy2DAsync/cudaMemcpy3DAsync whichever memory types they have (except host-to-host).
+ *
  * Limitations: Currently this function does not support copying directly
  * between two arbitrary mdspans on different CUDA devices. It is assumed that the caller sets the
  * correct CUDA device. Furthermore, host-to-host copies that require a transformation of the
@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/device_atomics.cuh>
+
+#include <cub/cub.cuh>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/scan.h>
+#include <thrust/transform.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace raft::core {
+
+/** The operation applying a bitset to the combination of the previous ones. */
+enum class bitset_op {
+  /** acc & x: the bits set in all the bitsets (e.g. tenant ∩ time range) */
+  AND,
+  /** acc | x */
+  OR,
+  /** acc & ~x: the bits of the accumulator not set in x (e.g. minus the deleted rows) */
+  AND_NOT,
+  /** acc ^ x */
+  XOR
+};
+
+namespace detail {
+
+/** The largest number of bitsets combined by one kernel. */
+constexpr int kBitsetMaxOperands = 8;
+constexpr int kBitsetThreads     = 256;
+
+/** The bitsets of a fused combination, passed by value to the kernels. */
+template <typename bitset_t>
+struct bitset_operands {
+  const bitset_t* data[kBitsetMaxOperands];
+  /** ops[k] applies data[k] to the combination of data[0..k); ops[0] is unused */
+  bitset_op ops[kBitsetMaxOperands];
+  int n;
+};
+
+template <typename T>
+__device__ inline auto bitset_apply(bitset_op op, T acc, T x) -> T
+{
+  switch (op) {
+    case bitset_op::AND: return acc & x;
+    case bitset_op::OR: return acc | x;
+    case bitset_op::AND_NOT: return acc & ~x;
+    default: return acc ^ x;
+  }
+}
+
+__device__ inline auto bitset_apply(bitset_op op, uint4 acc, uint4 x) -> uint4
+{
+  return uint4{bitset_apply(op, acc.x, x.x),
+               bitset_apply(op, acc.y, x.y),
+               bitset_apply(op, acc.z, x.z),
+               bitset_apply(op, acc.w, x.w)};
+}
+
+template <typename T>
+__device__ inline auto bitset_popc(T w) -> uint32_t
+{
+  if constexpr (sizeof(T) == sizeof(uint64_t)) {
+    return uint32_t(__popcll(uint64_t(w)));
+  } else {
+    return uint32_t(__popc(uint32_t(w)));
+  }
+}
+
+/** The combination of the element `e` of every operand. */
+template <typename bitset_t>
+__device__ inline auto bitset_combined(const bitset_operands<bitset_t>& in, size_t e) -> bitset_t
+{
+  bitset_t acc = in.data[0][e];
+  for (int k = 1; k < in.n; k++) {
+    acc = bitset_apply(in.ops[k], acc, in.data[k][e]);
+  }
+  return acc;
+}
+
+/** The mask of the valid bits of the last element of a bitset of `bitset_len` bits. */
+template <typename bitset_t, typename index_t>
+constexpr auto bitset_last_mask(index_t bitset_len) -> bitset_t
+{
+  constexpr index_t element_size = sizeof(bitset_t) * 8;
+  auto n_last                    = bitset_len % element_size;
+  return n_last ? bitset_t((bitset_t{1} << n_last) - bitset_t{1}) : bitset_t(~bitset_t{0});
+}
+
+/**
+ * The fused combination of the operands, written to `out` and/or counted into `count` (the bits
+ * past the length excluded). All but the last element go by 16-byte vectors when `vectorized`.
+ */
+template <typename bitset_t, typename index_t>
+RAFT_KERNEL bitset_combine_kernel(bitset_operands<bitset_t> in,
+                                  index_t n_elements,
+                                  bitset_t last_mask,
+                                  bool vectorized,
+                                  bitset_t* out,
+                                  index_t* count)
+{
+  using reduce_t = cub::BlockReduce<uint64_t, kBitsetThreads>;
+  __shared__ typename reduce_t::TempStorage temp;
+  constexpr index_t kPerVec = sizeof(uint4) / sizeof(bitset_t);
+  const index_t n_vec       = vectorized ? (n_elements - 1) / kPerVec : 0;
+  const index_t tid         = index_t(blockIdx.x) * blockDim.x + threadIdx.x;
+  const index_t stride      = index_t(blockDim.x) * gridDim.x;
+  uint64_t local            = 0;
+
+  for (index_t v = tid; v < n_vec; v += stride) {
+    uint4 acc = reinterpret_cast<const uint4*>(in.data[0])[v];
+    for (int k = 1; k < in.n; k++) {
+      acc = bitset_apply(in.ops[k], acc, reinterpret_cast<const uint4*>(in.data[k])[v]);
+    }
+    if (out != nullptr) { reinterpret_cast<uint4*>(out)[v] = acc; }
+    if (count != nullptr) {
+      local += __popc(acc.x) + __popc(acc.y) + __popc(acc.z) + __popc(acc.w);
+    }
+  }
+  for (index_t e = n_vec * kPerVec + tid; e < n_elements; e += stride) {
+    bitset_t acc = bitset_combined(in, e);
+    if (out != nullptr) { out[e] = acc; }
+    if (count != nullptr) { local += bitset_popc(e == n_elements - 1 ? acc & last_mask : acc); }
+  }
+  if (count != nullptr) {
+    uint64_t block_sum = reduce_t(temp).Sum(local);
+    if (threadIdx.x == 0 && block_sum > 0) { atomicAdd(count, index_t(block_sum)); }
+  }
+}
+
+/**
+ * An estimate of the number of bits set in the combination, from the popcount of `n_samples`
+ * elements spread evenly over the bitsets (exact when n_samples covers all the elements); one
+ * block.
+ */
+template <typename bitset_t, typename index_t>
+RAFT_KERNEL bitset_estimate_kernel(bitset_operands<bitset_t> in,
+                                   index_t n_elements,
+                                   index_t bitset_len,
+                                   bitset_t last_mask,
+                                   index_t n_samples,
+                                   index_t* count)
+{
+  using reduce_t = cub::BlockReduce<uint64_t, kBitsetThreads>;
+  __shared__ typename reduce_t::TempStorage temp;
+  uint64_t local = 0;
+  for (index_t i = threadIdx.x; i < n_samples; i += kBitsetThreads) {
+    auto e       = index_t(uint64_t(i) * uint64_t(n_elements) / uint64_t(n_samples));
+    bitset_t acc = bitset_combined(in, e);
+    local += bitset_popc(e == n_elements - 1 ? acc & last_mask : acc);
+  }
+  uint64_t sum = reduce_t(temp).Sum(local);
+  if (threadIdx.x == 0) {
+    double estimate = double(sum) * double(n_elements) / double(n_samples);
+    *count          = index_t(estimate < double(bitset_len) ? estimate + 0.5 : bitset_len);
+  }
+}
+
+/** Write the index of every bit set, each element at the offset of its bits in `indices`. */
+template <typename bitset_t, typename index_t>
+RAFT_KERNEL bitset_select_kernel(const bitset_t* data,
+                                 index_t n_elements,
+                                 bitset_t last_mask,
+                                 const index_t* offsets,
+                                 index_t* indices,
+                                 index_t capacity)
+{
+  constexpr index_t element_size = sizeof(bitset_t) * 8;
+  for (index_t e = index_t(blockIdx.x) * blockDim.x + threadIdx.x; e < n_elements;
+       e += index_t(blockDim.x) * gridDim.x) {
+    bitset_t w   = e == n_elements - 1 ? bitset_t(data[e] & last_mask) : data[e];
+    index_t pos  = offsets[e];
+    index_t base = e * element_size;
+    while (w != 0 && pos < capacity) {
+      int bit;
+      if constexpr (sizeof(bitset_t) == sizeof(uint64_t)) {
+        bit = __ffsll(static_cast<long long>(w)) - 1;
+      } else {
+        bit = __ffs(static_cast<int>(uint32_t(w))) - 1;
+      }
+      indices[pos++] = base + index_t(bit);
+      w &= w - 1;
+    }
+  }
+}
+
+/** The number of blocks of a grid-stride kernel over `n` items. */
+template <typename index_t>
+inline auto bitset_grid(index_t n) -> uint32_t
+{
+  return uint32_t(std::max<index_t>(1, std::min<index_t>(raft::ceildiv<index_t>(n, kBitsetThreads),
+                                                         index_t(4096))));
+}
+
+/** Check and pack the operands of a combination; returns the number of elements. */
+template <typename bitset_t, typename index_t, typename view_t>
+auto make_bitset_operands(const std::vector<view_t>& inputs,
+                          const std::vector<bitset_op>& ops,
+                          index_t bitset_len,
+                          bitset_operands<bitset_t>& operands) -> index_t
+{
+  RAFT_EXPECTS(!inputs.empty() && inputs.size() <= size_t(kBitsetMaxOperands),
+               "Between 1 and %d bitsets can be combined, got %zu",
+               kBitsetMaxOperands,
+               inputs.size());
+  RAFT_EXPECTS(ops.size() + 1 == inputs.size(),
+               "Expected %zu operations for %zu bitsets, got %zu",
+               inputs.size() - 1,
+               inputs.size(),
+               ops.size());
+  operands.n = int(inputs.size());
+  for (size_t k = 0; k < inputs.size(); k++) {
+    RAFT_EXPECTS(inputs[k].size() == bitset_len, "The bitsets must all have the same size");
+    operands.data[k] = inputs[k].data();
+    operands.ops[k]  = k == 0 ? bitset_op::OR : ops[k - 1];
+  }
+  return raft::ceildiv<index_t>(bitset_len, index_t(sizeof(bitset_t) * 8));
+}
+
+template <typename bitset_t>
+inline auto bitset_aligned(const bitset_operands<bitset_t>& in, const bitset_t* out) -> bool
+{
+  auto aligned = [](const void* p) { return reinterpret_cast<uintptr_t>(p) % sizeof(uint4) == 0; };
+  bool result  = out == nullptr || aligned(out);
+  for (int k = 0; k < in.n; k++) {
+    result = result && aligned(in.data[k]);
+  }
+  return result;
+}
+
+template <typename bitset_t, typename index_t, typename view_t>
+void bitset_combine(const raft::resources& res,
+                    const std::vector<view_t>& inputs,
+                    const std::vector<bitset_op>& ops,
+                    index_t bitset_len,
+                    bitset_t* out,
+                    index_t* count)
+{
+  auto stream = resource::get_cuda_stream(res);
+  if (count != nullptr) { RAFT_CUDA_TRY(cudaMemsetAsync(count, 0, sizeof(index_t), stream)); }
+  bitset_operands<bitset_t> operands{};
+  auto n_elements = make_bitset_operands(inputs, ops, bitset_len, operands);
+  if (n_elements == 0) { return; }
+  bool vectorized = bitset_aligned(operands, out);
+  auto n_work     = vectorized ? n_elements / index_t(sizeof(uint4) / sizeof(bitset_t)) + 1
+                               : n_elements;
+  bitset_combine_kernel<bitset_t, index_t>
+    <<<bitset_grid(n_work), kBitsetThreads, 0, stream>>>(operands,
+                                                         n_elements,
+                                                         bitset_last_mask<bitset_t>(bitset_len),
+                                                         vectorized,
+                                                         out,
+                                                         count);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+template <typename bitset_t, typename index_t, typename view_t>
+void bitset_estimate_count(const raft::resources& res,
+                           const std::vector<view_t>& inputs,
+                           const std::vector<bitset_op>& ops,
+                           index_t bitset_len,
+                           index_t n_samples,
+                           index_t* count)
+{
+  auto stream = resource::get_cuda_stream(res);
+  bitset_operands<bitset_t> operands{};
+  auto n_elements = make_bitset_operands(inputs, ops, bitset_len, operands);
+  if (n_elements == 0) {
+    RAFT_CUDA_TRY(cudaMemsetAsync(count, 0, sizeof(index_t), stream));
+    return;
+  }
+  n_samples = std::max<index_t>(1, std::min<index_t>(n_samples, n_elements));
+  bitset_estimate_kernel<bitset_t, index_t><<<1, kBitsetThreads, 0, stream>>>(
+    operands, n_elements, bitset_len, bitset_last_mask<bitset_t>(bitset_len), n_samples, count);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/**
+ * The exclusive prefix sums of the popcounts of the elements, [n_elements + 1]: offsets[e] is the
+ * rank of the first bit of the element e, offsets[n_elements] the number of bits set.
+ */
+template <typename bitset_t, typename index_t>
+void bitset_offsets(const raft::resources& res,
+                    const bitset_t* data,
+                    index_t bitset_len,
+                    index_t* offsets)
+{
+  auto n_elements = raft::ceildiv<index_t>(bitset_len, index_t(sizeof(bitset_t) * 8));
+  auto last_mask  = bitset_last_mask<bitset_t>(bitset_len);
+  thrust::transform_exclusive_scan(
+    resource::get_thrust_policy(res),
+    thrust::make_counting_iterator<index_t>(0),
+    thrust::make_counting_iterator<index_t>(n_elements + 1),
+    offsets,
+    [data, n_elements, last_mask] __device__(index_t e) -> index_t {
+      if (e >= n_elements) { return 0; }
+      return index_t(bitset_popc(e == n_elements - 1 ? bitset_t(data[e] & last_mask) : data[e]));
+    },
+    index_t{0},
+    thrust::plus<index_t>{});
+}
+
+template <typename bitset_t, typename index_t>
+void bitset_select(const raft::resources& res,
+                   const bitset_t* data,
+                   index_t bitset_len,
+                   index_t* offsets,
+                   index_t* indices,
+                   index_t capacity,
+                   index_t* n_indices)
+{
+  auto stream     = resource::get_cuda_stream(res);
+  auto n_elements = raft::ceildiv<index_t>(bitset_len, index_t(sizeof(bitset_t) * 8));
+  bitset_offsets(res, data, bitset_len, offsets);
+  if (n_elements > 0) {
+    bitset_select_kernel<bitset_t, index_t>
+      <<<bitset_grid(n_elements), kBitsetThreads, 0, stream>>>(
+        data, n_elements, bitset_last_mask<bitset_t>(bitset_len), offsets, indices, capacity);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+  raft::copy(n_indices, offsets + n_elements, 1, stream);
+}
+
+/** The number of bits set before every query index, from the offsets of bitset_offsets. */
+template <typename bitset_t, typename index_t, typename output_t>
+void bitset_rank(const raft::resources& res,
+                 const bitset_t* data,
+                 index_t bitset_len,
+                 index_t* offsets,
+                 const index_t* queries,
+                 index_t n_queries,
+                 output_t* output)
+{
+  constexpr index_t element_size = sizeof(bitset_t) * 8;
+  bitset_offsets(res, data, bitset_len, offsets);
+  thrust::transform(resource::get_thrust_policy(res),
+                    queries,
+                    queries + n_queries,
+                    output,
+                    [data, offsets] __device__(index_t q) {
+                      index_t e     = q / element_size;
+                      bitset_t mask = bitset_t((bitset_t{1} << (q % element_size)) - bitset_t{1});
+                      return output_t(offsets[e] + index_t(bitset_popc(bitset_t(data[e] & mask))));
+                    });
+}
+
+}  // namespace detail
+}  // namespace raft::core
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/mr/host/host_memory_resource.hpp>
+
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace raft::detail::chunked_serializer {
+
+/** The default size of the chunks staged through pinned memory. */
+constexpr std::size_t kDefaultChunkBytes = std::size_t{32} << 20;
+/** The chunks in flight: one copied by the GPU while the other is written or read by the host. */
+constexpr int kInFlight = 2;
+
+/**
+ * The Fletcher-64 checksum of a chunk (over its 32-bit words, the trailing bytes padded with
+ * zeros); cheap enough to keep up with the file I/O.
+ */
+inline auto chunk_checksum(const char* data, std::size_t bytes) -> std::uint64_t
+{
+  constexpr std::uint64_t kMod = 0xffffffffULL;
+  // the sums cannot overflow within a block of 2^16 words: reduce once per block
+  constexpr std::size_t kBlockWords = std::size_t{1} << 16;
+  std::uint64_t a                   = 0;
+  std::uint64_t b                   = 0;
+  std::size_t n_words               = (bytes + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t);
+  for (std::size_t first = 0; first < n_words; first += kBlockWords) {
+    std::size_t last = std::min(n_words, first + kBlockWords);
+    for (std::size_t i = first; i < last; i++) {
+      std::uint32_t w   = 0;
+      std::size_t begin = i * sizeof(std::uint32_t);
+      std::memcpy(&w, data + begin, std::min(sizeof(w), bytes - begin));
+      a += w;
+      b += a;
+    }
+    a %= kMod;
+    b %= kMod;
+  }
+  return (b << 32) | a;
+}
+
+/**
+ * The pinned buffers of the pipeline and the events of the copies in flight. The destructor
+ * waits for the stream, so that an exception thrown by the stream I/O never frees a buffer still
+ * being copied.
+ */
+class staging {
+ public:
+  staging(const raft::resources& handle, std::size_t chunk_bytes)
+    : stream_(resource::get_cuda_stream(handle)),
+      mr_(resource::get_pinned_memory_resource(handle)),
+      chunk_bytes_(chunk_bytes)
+  {
+    for (int i = 0; i < kInFlight; i++) {
+      buffers_[i] = static_cast<char*>(mr_->allocate(chunk_bytes_));
+      RAFT_CUDA_TRY(cudaEventCreateWithFlags(&events_[i], cudaEventDisableTiming));
+    }
+  }
+  staging(const staging&)                    = delete;
+  auto operator=(const staging&) -> staging& = delete;
+  ~staging()
+  {
+    cudaStreamSynchronize(stream_);
+    for (int i = 0; i < kInFlight; i++) {
+      cudaEventDestroy(events_[i]);
+      mr_->deallocate(buffers_[i], chunk_bytes_);
+    }
+  }
+
+  [[nodiscard]] auto buffer(int i) const -> char* { return buffers_[i]; }
+  [[nodiscard]] auto event(int i) const -> cudaEvent_t { return events_[i]; }
+  [[nodiscard]] auto stream() const -> cudaStream_t { return stream_; }
+
+ private:
+  cudaStream_t stream_;
+  rmm::mr::host_memory_resource* mr_;
+  std::size_t chunk_bytes_;
+  std::array<char*, kInFlight> buffers_{};
+  std::array<cudaEvent_t, kInFlight> events_{};
+};
+
+/**
+ * Write `n_rows` rows of `row_bytes` of device memory, `pitch_bytes` apart, to a stream chunk by
+ * chunk: the copy of the next chunk to pinned memory overlaps the write of the current one, and
+ * the host memory used is kInFlight * chunk_bytes whatever the size of the data. A chunk holds
+ * whole rows (at least one).
+ *
+ * @param[out] checksums when given, the checksum of every chunk is appended to it
+ */
+inline void write_device_rows(const raft::resources& handle,
+                              std::ostream& os,
+                              const void* d_data,
+                              std::size_t n_rows,
+                              std::size_t row_bytes,
+                              std::size_t pitch_bytes,
+                              std::size_t chunk_bytes               = kDefaultChunkBytes,
+                              std::vector<std::uint64_t>* checksums = nullptr)
+{
+  if (n_rows == 0 || row_bytes == 0) { return; }
+  RAFT_EXPECTS(chunk_bytes > 0, "The chunks must not be empty");
+  RAFT_EXPECTS(pitch_bytes >= row_bytes, "The rows must not overlap");
+  auto chunk_rows = std::min(n_rows, std::max<std::size_t>(1, chunk_bytes / row_bytes));
+  auto n_chunks   = (n_rows + chunk_rows - 1) / chunk_rows;
+  auto rows_of    = [&](std::size_t c) { return std::min(chunk_rows, n_rows - c * chunk_rows); };
+  const auto* src = static_cast<const char*>(d_data);
+  staging buffers(handle, chunk_rows * row_bytes);
+  auto issue = [&](std::size_t c) {
+    int b            = int(c % kInFlight);
+    const char* from = src + c * chunk_rows * pitch_bytes;
+    if (pitch_bytes == row_bytes) {
+      RAFT_CUDA_TRY(cudaMemcpyAsync(buffers.buffer(b),
+                                    from,
+                                    rows_of(c) * row_bytes,
+                                    cudaMemcpyDeviceToHost,
+                                    buffers.stream()));
+    } else {
+      RAFT_CUDA_TRY(cudaMemcpy2DAsync(buffers.buffer(b),
+                                      row_bytes,
+                                      from,
+                                      pitch_bytes,
+                                      row_bytes,
+                                      rows_of(c),
+                                      cudaMemcpyDeviceToHost,
+                                      buffers.stream()));
+    }
+    RAFT_CUDA_TRY(cudaEventRecord(buffers.event(b), buffers.stream()));
+  };
+
+  for (std::size_t c = 0; c < std::min<std::size_t>(n_chunks, kInFlight); c++) {
+    issue(c);
+  }
+  for (std::size_t c = 0; c < n_chunks; c++) {
+    int b        = int(c % kInFlight);
+    auto bytes_c = rows_of(c) * row_bytes;
+    RAFT_CUDA_TRY(cudaEventSynchronize(buffers.event(b)));
+    if (checksums != nullptr) { checksums->push_back(chunk_checksum(buffers.buffer(b), bytes_c)); }
+    os.write(buffers.buffer(b), bytes_c);
+    RAFT_EXPECTS(os.good(), "Error writing chunk %zu of %zu", c, n_chunks);
+    if (c + kInFlight < n_chunks) { issue(c + kInFlight); }
+  }
+}
+
+/**
+ * Write `bytes` of contiguous device memory to a stream, in chunks of `chunk_bytes`; see
+ * write_device_rows.
+ */
+inline void write_device(const raft::resources& handle,
+                         std::ostream& os,
+                         const void* d_data,
+                         std::size_t bytes,
+                         std::size_t chunk_bytes               = kDefaultChunkBytes,
+                         std::vector<std::uint64_t>* checksums = nullptr)
+{
+  write_device_rows(handle, os, d_data, bytes, 1, 1, chunk_bytes, checksums);
+}
+
+/**
+ * Read `bytes` from a stream into device memory, chunk by chunk: the read of the next chunk
+ * overlaps the copy of the current one to the device.
+ *
+ * @param[in] checksums when not empty, the expected checksums of the chunks (as given by
+ *   write_device with the same chunk_bytes); a mismatch throws
+ */
+inline void read_device(const raft::resources& handle,
+                        std::istream& is,
+                        void* d_data,
+                        std::size_t bytes,
+                        std::size_t chunk_bytes                     = kDefaultChunkBytes,
+                        const std::vector<std::uint64_t>* checksums = nullptr)
+{
+  if (bytes == 0) { return; }
+  RAFT_EXPECTS(chunk_bytes > 0, "The chunks must not be empty");
+  chunk_bytes   = std::min(chunk_bytes, bytes);
+  auto n_chunks = (bytes + chunk_bytes - 1) / chunk_bytes;
+  bool verify   = checksums != nullptr && !checksums->empty();
+  RAFT_EXPECTS(!verify || checksums->size() == n_chunks,
+               "Expected %zu checksums but got %zu",
+               n_chunks,
+               verify ? checksums->size() : std::size_t{0});
+  auto* dst = static_cast<char*>(d_data);
+  staging buffers(handle, chunk_bytes);
+
+  for (std::size_t c = 0; c < n_chunks; c++) {
+    int b               = int(c % kInFlight);
+    std::size_t bytes_c = std::min(chunk_bytes, bytes - c * chunk_bytes);
+    // the previous copy out of this buffer must be done before it is overwritten
+    if (c >= kInFlight) { RAFT_CUDA_TRY(cudaEventSynchronize(buffers.event(b))); }
+    is.read(buffers.buffer(b), bytes_c);
+    RAFT_EXPECTS(is.good(), "Error reading chunk %zu of %zu", c, n_chunks);
+    RAFT_EXPECTS(!verify || chunk_checksum(buffers.buffer(b), bytes_c) == (*checksums)[c],
+                 "Checksum mismatch in chunk %zu of %zu",
+                 c,
+                 n_chunks);
+    RAFT_CUDA_TRY(cudaMemcpyAsync(
+      dst + c * chunk_bytes, buffers.buffer(b), bytes_c, cudaMemcpyHostToDevice, buffers.stream()));
+    RAFT_CUDA_TRY(cudaEventRecord(buffers.event(b), buffers.stream()));
+  }
+  RAFT_CUDA_TRY(cudaStreamSynchronize(buffers.stream()));
+}
+
+}  // namespace raft::detail::chunked_serializer
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -28,7 +28,9 @@
 #ifndef RAFT_DISABLE_CUDA
 #include <raft/core/cudart_utils.hpp>
 #include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
 #include <raft/core/resource/cublas_handle.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
 #include <raft/linalg/detail/cublas_wrappers.hpp>
 #ifdef __CUDACC__
 #include <raft/util/cuda_dev_essentials.cuh>
@@ -195,6 +197,26 @@ struct mdspan_copyable<true,
     std::conjunction_v<std::bool_constant<can_use_device>,
                        std::bool_constant<!(can_use_raft_copy || can_use_cublas)>>;
 
+  // Matrices and 3-D arrays of strided layouts (e.g. padded rows) which cudaMemcpy2DAsync or
+  // cudaMemcpy3DAsync can copy if one dimension is contiguous in both (checked at runtime, falling
+  // back to the copy paths above otherwise). Host-to-host copies are left to the host.
+  auto static constexpr const can_try_pitched_memcpy =
+    std::conjunction_v<std::bool_constant<CUDA_ENABLED>,
+                       std::bool_constant<same_dtype>,
+                       std::bool_constant<compatible_rank>,
+                       std::bool_constant<(dst_rank == 2 || dst_rank == 3)>,
+                       std::bool_constant<dst_type::is_always_strided()>,
+                       std::bool_constant<src_type::is_always_strided()>,
+                       std::bool_constant<!can_use_raft_copy>,
+                       std::bool_constant<!both_host_accessible>>;
+
+  // Layout for an intermediate copy on the host, if the strided side of a copy between host and
+  // device is on the host
+  using host_intermediate_layout_type =
+    std::conditional_t<src_contiguous,
+                       src_layout_type,
+                       std::conditional_t<dst_contiguous, dst_layout_type, layout_c_contiguous>>;
+
   auto static constexpr const custom_kernel_not_allowed = !custom_kernel_allowed;
   auto static constexpr const custom_kernel_required =
     std::conjunction_v<std::bool_constant<!can_use_host>,
@@ -399,6 +421,71 @@ RAFT_KERNEL mdspan_copy_kernel(DstType dst, SrcType src)
 }
 #endif
 
+#ifndef RAFT_DISABLE_CUDA
+/*
+ * Copy a matrix or a 3-D array of the same value type with cudaMemcpy2DAsync or
+ * cudaMemcpy3DAsync, if both mdspans have the same contiguous dimension (the last for row-major,
+ * the first for column-major) and their other strides are pitches of it: e.g. rows padded for
+ * alignment to or from compact rows, on either side of the host/device boundary. Returns false
+ * without copying anything otherwise.
+ */
+template <typename DstType, typename SrcType>
+auto copy_pitched(resources const& res, DstType const& dst, SrcType const& src) -> bool
+{
+  using value_type             = typename DstType::value_type;
+  auto constexpr const rank    = DstType::rank();
+  auto constexpr const elem_sz = sizeof(value_type);
+  if (dst.size() == 0) { return true; }
+
+  // The contiguous (inner) dimension, then the rows (middle) and slices (outer) dimensions
+  auto const inner = dst.stride(rank - 1) == 1 && src.stride(rank - 1) == 1 ? rank - 1
+                     : dst.stride(0) == 1 && src.stride(0) == 1             ? 0
+                                                                            : rank;
+  if (inner == rank) { return false; }
+  auto const middle = inner == 0 ? 1 : rank - 2;
+
+  // The pitch of a (single) row is irrelevant
+  auto const pitch = [&](auto const& md) -> std::size_t {
+    return md.extent(middle) == 1 ? md.extent(inner) : md.stride(middle);
+  };
+  auto const width = static_cast<std::size_t>(dst.extent(inner));
+  if (pitch(dst) < width || pitch(src) < width) { return false; }
+
+  if constexpr (rank == 2) {
+    RAFT_CUDA_TRY(cudaMemcpy2DAsync(dst.data_handle(),
+                                    pitch(dst) * elem_sz,
+                                    src.data_handle(),
+                                    pitch(src) * elem_sz,
+                                    width * elem_sz,
+                                    dst.extent(middle),
+                                    cudaMemcpyDefault,
+                                    resource::get_cuda_stream(res)));
+  } else {
+    // The slices of 3-D pitched memory are a whole number of (padded) rows apart
+    auto const outer        = inner == 0 ? rank - 1 : 0;
+    auto const slice_height = [&](auto const& md) -> std::size_t {
+      if (md.extent(outer) == 1) { return md.extent(middle); }
+      auto const slice_pitch = static_cast<std::size_t>(md.stride(outer));
+      return slice_pitch % pitch(md) == 0 ? slice_pitch / pitch(md) : 0;
+    };
+    auto const height = static_cast<std::size_t>(dst.extent(middle));
+    if (slice_height(dst) < height || slice_height(src) < height) { return false; }
+
+    cudaMemcpy3DParms params = {};
+    params.srcPtr = make_cudaPitchedPtr(const_cast<value_type*>(src.data_handle()),
+                                        pitch(src) * elem_sz,
+                                        width * elem_sz,
+                                        slice_height(src));
+    params.dstPtr = make_cudaPitchedPtr(
+      dst.data_handle(), pitch(dst) * elem_sz, width * elem_sz, slice_height(dst));
+    params.extent = make_cudaExtent(width * elem_sz, height, dst.extent(outer));
+    params.kind   = cudaMemcpyDefault;
+    RAFT_CUDA_TRY(cudaMemcpy3DAsync(&params, resource::get_cuda_stream(res)));
+  }
+  return true;
+}
+#endif
+
 template <typename DstType, typename SrcType>
 mdspan_copyable_t<DstType, SrcType> copy(resources const& res, DstType&& dst, SrcType&& src)
 {
@@ -407,7 +494,43 @@ mdspan_copyable_t<DstType, SrcType> copy(resources const& res, DstType&& dst, Sr
     RAFT_EXPECTS(src.extent(i) == dst.extent(i), "Must copy between mdspans of the same shape");
   }
 
-  if constexpr (config::use_intermediate_src) {
+#ifndef RAFT_DISABLE_CUDA
+  if constexpr (config::can_try_pitched_memcpy) {
+    if (copy_pitched(res, dst, src)) { return; }
+  }
+#endif
+
+  if constexpr (config::use_intermediate_src && !config::src_contiguous) {
+#ifndef RAFT_DISABLE_CUDA
+    // Gather the strided source into contiguous memory on host first
+    using mdarray_t   = host_mdarray<typename config::src_value_type,
+                                   typename config::src_extents_type,
+                                   typename config::host_intermediate_layout_type>;
+    auto intermediate = mdarray_t(res,
+                                  typename mdarray_t::mapping_type{src.extents()},
+                                  typename mdarray_t::container_policy_type{});
+    detail::copy(res, intermediate.view(), src);
+    detail::copy(res, dst, intermediate.view());
+#else
+    // Not possible to reach this due to enable_ifs. Included for safety.
+    throw(raft::non_cuda_build_error("Copying to device in non-CUDA build"));
+#endif
+  } else if constexpr (config::use_intermediate_dst && !config::dst_contiguous) {
+#ifndef RAFT_DISABLE_CUDA
+    // Copy to contiguous memory on host first, then scatter it into the strided destination
+    using mdarray_t   = host_mdarray<typename config::dst_value_type,
+                                   typename config::dst_extents_type,
+                                   typename config::host_intermediate_layout_type>;
+    auto intermediate = mdarray_t(res,
+                                  typename mdarray_t::mapping_type{dst.extents()},
+                                  typename mdarray_t::container_policy_type{});
+    detail::copy(res, intermediate.view(), src);
+    resource::sync_stream(res);
+    detail::copy(res, dst, intermediate.view());
+#else
+    throw(raft::non_cuda_build_error("Copying from device in non-CUDA build"));
+#endif
+  } else if constexpr (config::use_intermediate_src) {
 #ifndef RAFT_DISABLE_CUDA
     // Copy to intermediate source on device, then perform necessary
     // changes in layout on device, directly into final destination
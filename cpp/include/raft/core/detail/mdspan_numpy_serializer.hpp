@@ -20,6 +20,8 @@
 #include <raft/core/host_mdspan.hpp>
 #include <raft/core/resources.hpp>
 
+#include <cuda_fp16.h>
+
 #include <algorithm>
 #include <complex>
 #include <cstdint>
@@ -139,6 +141,13 @@ inline dtype_t get_numpy_dtype()
   return {endian_char, 'u', sizeof(T)};
 }
 
+// fp16, the 'f2' of numpy
+template <typename T, typename std::enable_if_t<std::is_same_v<T, half>, bool> = true>
+inline dtype_t get_numpy_dtype()
+{
+  return {RAFT_NUMPY_HOST_ENDIAN_CHAR, 'f', sizeof(T)};
+}
+
 template <typename T, typename std::enable_if_t<is_complex<T>{}, bool> = true>
 inline dtype_t get_numpy_dtype()
 {
@@ -385,6 +394,47 @@ inline header_t read_header(std::istream& is)
   return {descr, fortran_order, shape};
 }
 
+/** The header of a contiguous mdspan of the given extents. */
+template <typename ElementType, typename LayoutPolicy, typename Extents>
+inline header_t make_mdspan_header(const Extents& extents)
+{
+  const auto dtype         = get_numpy_dtype<ElementType>();
+  const bool fortran_order = std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>;
+  std::vector<ndarray_len_t> shape;
+  for (typename Extents::rank_type i = 0; i < extents.rank(); ++i) {
+    shape.push_back(extents.extent(i));
+  }
+  return {dtype, fortran_order, shape};
+}
+
+/** Check that a header read from a stream matches a contiguous mdspan of the given extents. */
+template <typename ElementType, typename LayoutPolicy, typename Extents>
+inline void check_mdspan_header(const header_t& header, const Extents& extents)
+{
+  // Check if given dtype and fortran_order are compatible with the mdspan
+  const auto expected_dtype         = get_numpy_dtype<ElementType>();
+  const bool expected_fortran_order = std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>;
+  RAFT_EXPECTS(header.dtype == expected_dtype,
+               "Expected dtype %s but got %s instead",
+               header.dtype.to_string().c_str(),
+               expected_dtype.to_string().c_str());
+  RAFT_EXPECTS(header.fortran_order == expected_fortran_order,
+               "Wrong matrix layout; expected %s but got a different layout",
+               (expected_fortran_order ? "Fortran layout" : "C layout"));
+
+  // Check if dimensions are correct
+  RAFT_EXPECTS(extents.rank() == header.shape.size(),
+               "Incorrect rank: expected %zu but got %zu",
+               extents.rank(),
+               header.shape.size());
+  for (typename Extents::rank_type i = 0; i < extents.rank(); ++i) {
+    RAFT_EXPECTS(static_cast<ndarray_len_t>(extents.extent(i)) == header.shape[i],
+                 "Incorrect dimension: expected %zu but got %zu",
+                 static_cast<ndarray_len_t>(extents.extent(i)),
+                 header.shape[i]);
+  }
+}
+
 template <typename ElementType, typename Extents, typename LayoutPolicy, typename AccessorPolicy>
 inline void serialize_host_mdspan(
   std::ostream& os,
@@ -394,16 +444,7 @@ inline void serialize_host_mdspan(
                   std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>,
                 "The serializer only supports row-major and column-major layouts");
 
-  using obj_t = raft::host_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>;
-
-  const auto dtype         = get_numpy_dtype<ElementType>();
-  const bool fortran_order = std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>;
-  std::vector<ndarray_len_t> shape;
-  for (typename obj_t::rank_type i = 0; i < obj.rank(); ++i) {
-    shape.push_back(obj.extent(i));
-  }
-  const header_t header = {dtype, fortran_order, shape};
-  write_header(os, header);
+  write_header(os, make_mdspan_header<ElementType, LayoutPolicy>(obj.extents()));
 
   // For contiguous layouts, size() == product of dimensions
   os.write(reinterpret_cast<const char*>(obj.data_handle()), obj.size() * sizeof(ElementType));
@@ -431,31 +472,7 @@ inline void deserialize_host_mdspan(
                   std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>,
                 "The serializer only supports row-major and column-major layouts");
 
-  using obj_t = raft::host_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>;
-
-  // Check if given dtype and fortran_order are compatible with the mdspan
-  const auto expected_dtype         = get_numpy_dtype<ElementType>();
-  const bool expected_fortran_order = std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>;
-  header_t header                   = read_header(is);
-  RAFT_EXPECTS(header.dtype == expected_dtype,
-               "Expected dtype %s but got %s instead",
-               header.dtype.to_string().c_str(),
-               expected_dtype.to_string().c_str());
-  RAFT_EXPECTS(header.fortran_order == expected_fortran_order,
-               "Wrong matrix layout; expected %s but got a different layout",
-               (expected_fortran_order ? "Fortran layout" : "C layout"));
-
-  // Check if dimensions are correct
-  RAFT_EXPECTS(obj.rank() == header.shape.size(),
-               "Incorrect rank: expected %zu but got %zu",
-               obj.rank(),
-               header.shape.size());
-  for (typename obj_t::rank_type i = 0; i < obj.rank(); ++i) {
-    RAFT_EXPECTS(static_cast<ndarray_len_t>(obj.extent(i)) == header.shape[i],
-                 "Incorrect dimension: expected %zu but got %zu",
-                 static_cast<ndarray_len_t>(obj.extent(i)),
-                 header.shape[i]);
-  }
+  check_mdspan_header<ElementType, LayoutPolicy>(read_header(is), obj.extents());
 
   // For contiguous layouts, size() == product of dimensions
   is.read(reinterpret_cast<char*>(obj.data_handle()), obj.size() * sizeof(ElementType));
@@ -16,10 +16,17 @@
 
 #pragma once
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <memory>
 #include <optional>
 #include <raft/core/device_resources.hpp>
 #include <raft/core/device_setter.hpp>
+#include <raft/core/device_topology.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
+#include <raft/core/resource/stream_priority.hpp>
+#include <raft/core/workspace_arena_resource.hpp>
 #include <rmm/cuda_device.hpp>
 #include <rmm/cuda_stream.hpp>
 #include <rmm/cuda_stream_pool.hpp>
@@ -73,6 +80,13 @@ namespace raft {
  * exactly once per device when calling `get_device_resources`. Subsequent calls
  * will still be thread-safe but will not require a lock.
  *
+ * Latency-critical and batch work sharing a device can be kept apart by
+ * retrieving their resources from separate quality-of-service lanes, e.g.
+ * `get_device_resources(raft::stream_priority::high)` in the threads serving
+ * the online searches and `get_device_resources(raft::stream_priority::low)` in
+ * the threads building or extending the indices in the background (see
+ * `set_priority_streams_per_device`).
+ *
  * All public methods of the `device_resources_manager` are static. Please see
  * documentation of those methods for additional usage information.
  *
@@ -127,10 +141,41 @@ struct device_resources_manager {
     // device. The integer in each pair indicates the device for this memory
     // resource.
     std::vector<std::pair<std::shared_ptr<rmm::mr::device_memory_resource>, int>> workspace_mrs{};
+    // If set, every host thread gets its own workspace arena of (initially)
+    // this size in bytes, taken from the workspace memory resource above
+    std::optional<std::size_t> workspace_arena_size{std::nullopt};
+    // If true, bind every host thread to the CPUs closest to the first device
+    // it retrieves resources for
+    bool numa_affinity{false};
+    // If set, the pinned host allocations for each device go through a pool
+    // caching up to this many bytes of freed pinned memory
+    std::optional<std::size_t> pinned_mem_pool_size{std::nullopt};
+    // The number of streams of each of the high and low priority lanes
+    std::size_t priority_stream_count{1};
+    // The pause of the low priority lane at every batch boundary of the
+    // long-running algorithms
+    std::chrono::microseconds low_priority_batch_pause{0};
 
     auto get_workspace_memory_resource(int device_id) {}
   } params_;
 
+  // A CUDA stream created with a priority, which `rmm::cuda_stream` does not
+  // support
+  struct priority_stream {
+    explicit priority_stream(int priority)
+    {
+      RAFT_CUDA_TRY(cudaStreamCreateWithPriority(&stream_, cudaStreamNonBlocking, priority));
+    }
+    ~priority_stream() { RAFT_CUDA_TRY_NO_THROW(cudaStreamDestroy(stream_)); }
+    priority_stream(priority_stream const&)            = delete;
+    priority_stream& operator=(priority_stream const&) = delete;
+
+    [[nodiscard]] auto view() const { return rmm::cuda_stream_view{stream_}; }
+
+   private:
+    cudaStream_t stream_{};
+  };
+
   // This struct stores the underlying resources to be shared among
   // `device_resources` objects returned by this manager.
   struct resource_components {
@@ -147,6 +192,22 @@ struct device_resources_manager {
           }
           return result;
         }()},
+        priority_streams_{[&params, this]() {
+          auto scoped_device = device_setter{device_id_};
+          auto result        = std::array<std::vector<std::unique_ptr<priority_stream>>, 2>{};
+          if (params.priority_stream_count != 0) {
+            // The greatest priority is the numerically lowest one
+            auto least_priority    = 0;
+            auto greatest_priority = 0;
+            RAFT_CUDA_TRY(cudaDeviceGetStreamPriorityRange(&least_priority, &greatest_priority));
+            for (auto i = std::size_t{}; i < params.priority_stream_count; ++i) {
+              result[0].push_back(std::make_unique<priority_stream>(greatest_priority));
+              result[1].push_back(std::make_unique<priority_stream>(least_priority));
+            }
+          }
+          return result;
+        }()},
+        low_priority_batch_pause_{params.low_priority_batch_pause},
         pools_{[&params, this]() {
           auto scoped_device = device_setter{device_id_};
           auto result        = std::vector<std::shared_ptr<rmm::cuda_stream_pool>>{};
@@ -190,6 +251,18 @@ struct device_resources_manager {
                                    [this](auto&& pair) { return pair.second == device_id_; });
           if (iter != std::end(params.workspace_mrs)) { result = iter->first; }
           return result;
+        }()},
+        workspace_allocation_limit_{params.workspace_allocation_limit},
+        workspace_arena_size_{params.workspace_arena_size},
+        numa_affinity_{params.numa_affinity},
+        pinned_mr_{[&params]() {
+          auto result = std::shared_ptr<rmm::mr::host_memory_resource>{nullptr};
+          if (params.pinned_mem_pool_size) {
+            result = std::make_shared<raft::mr::pinned_pool_resource>(
+              *params.pinned_mem_pool_size,
+              resource::pinned_memory_resource_factory::default_plain_resource());
+          }
+          return result;
         }()}
     {
     }
@@ -213,6 +286,21 @@ struct device_resources_manager {
       if (stream_count() != 0) { result = streams_->get_stream(get_thread_id() % stream_count()); }
       return result;
     }
+    // Get the stream of the given lane assigned to this host thread. The
+    // normal lane, and the other lanes if no priority streams were requested,
+    // use the primary streams.
+    [[nodiscard]] auto get_stream(stream_priority lane) const
+    {
+      auto result = get_stream();
+      if (lane != stream_priority::normal) {
+        auto const& streams = priority_streams_[lane == stream_priority::high ? 0 : 1];
+        if (!streams.empty()) { result = streams[get_thread_id() % streams.size()]->view(); }
+      }
+      return result;
+    }
+    // Return the pause of the low priority lane between the batches of the
+    // long-running algorithms
+    [[nodiscard]] auto low_priority_batch_pause() const { return low_priority_batch_pause_; }
     // Get the total number of stream pools available for this
     // application
     [[nodiscard]] auto pool_count() const { return pools_.size(); }
@@ -238,14 +326,39 @@ struct device_resources_manager {
     // be used for workspace allocations by `device_resources` returned from
     // this manager
     [[nodiscard]] auto get_workspace_memory_resource() { return workspace_mr_; }
+    // Return the memory resource for the workspace allocations of the calling
+    // host thread: its own arena on top of the workspace memory resource if
+    // an arena size was requested, or the shared workspace memory resource
+    [[nodiscard]] auto get_thread_workspace_memory_resource()
+      -> std::shared_ptr<rmm::mr::device_memory_resource>
+    {
+      if (!workspace_arena_size_) { return workspace_mr_; }
+      auto upstream = workspace_mr_;
+      if (!upstream) { upstream = resource::workspace_resource_factory::default_plain_resource(); }
+      return std::make_shared<raft::mr::workspace_arena_resource>(std::move(upstream),
+                                                                   *workspace_arena_size_);
+    }
+
+    // Return whether host threads should be bound to the CPUs closest to
+    // this device
+    [[nodiscard]] auto numa_affinity() const { return numa_affinity_; }
+    // Return a (possibly null) shared_ptr to the pinned memory pool created
+    // for this device by the manager
+    [[nodiscard]] auto get_pinned_memory_resource() const { return pinned_mr_; }
 
    private:
     int device_id_;
     std::unique_ptr<rmm::cuda_stream_pool> streams_;
+    // The streams of the high (0) and low (1) priority lanes
+    std::array<std::vector<std::unique_ptr<priority_stream>>, 2> priority_streams_;
+    std::chrono::microseconds low_priority_batch_pause_{0};
     std::vector<std::shared_ptr<rmm::cuda_stream_pool>> pools_;
     std::shared_ptr<rmm::mr::pool_memory_resource<rmm::mr::cuda_memory_resource>> pool_mr_;
     std::shared_ptr<rmm::mr::device_memory_resource> workspace_mr_;
     std::optional<std::size_t> workspace_allocation_limit_{std::nullopt};
+    std::optional<std::size_t> workspace_arena_size_{std::nullopt};
+    bool numa_affinity_{false};
+    std::shared_ptr<rmm::mr::host_memory_resource> pinned_mr_;
   };
 
   // Mutex used to lock access to shared data until after the first
@@ -262,18 +375,25 @@ struct device_resources_manager {
   [[nodiscard]] auto get_lock() const { return std::unique_lock{manager_mutex_}; }
 
   // Retrieve the underlying resources to be shared across the
-  // application for the indicated device. This method acquires a lock the
-  // first time it is called in each thread for a specific device to ensure that the
-  // underlying resources have been correctly initialized exactly once across
+  // application for the indicated device and lane. This method acquires a lock the
+  // first time it is called in each thread for a specific device and lane to ensure
+  // that the underlying resources have been correctly initialized exactly once across
   // all host threads.
-  auto const& get_device_resources_(int device_id)
+  auto const& get_device_resources_(int device_id, stream_priority lane = stream_priority::normal)
   {
-    thread_local auto thread_resources = std::vector<std::optional<raft::device_resources>>([]() {
+    thread_local auto device_count = []() {
       auto result = 0;
       RAFT_CUDA_TRY(cudaGetDeviceCount(&result));
       RAFT_EXPECTS(result != 0, "No CUDA devices found");
       return result;
-    }());
+    }();
+    // One device_resources per device for each lane
+    thread_local auto lane_resources =
+      std::array<std::vector<std::optional<raft::device_resources>>, 3>{
+        std::vector<std::optional<raft::device_resources>>(device_count),
+        std::vector<std::optional<raft::device_resources>>(device_count),
+        std::vector<std::optional<raft::device_resources>>(device_count)};
+    auto& thread_resources = lane_resources[static_cast<int>(lane)];
     if (!thread_resources[device_id]) {
       // Only lock if we have not previously accessed this device on this
       // thread
@@ -296,13 +416,30 @@ struct device_resources_manager {
         per_device_components_.emplace_back(device_id, params_);
         component_iter = std::prev(std::end(per_device_components_));
       }
+      // Bind the thread to its first device, before it allocates anything,
+      // so that its host memory is placed on the NUMA node of the device
+      thread_local auto thread_bound = false;
+      if (!thread_bound && component_iter->numa_affinity()) {
+        bind_thread_to_cpus(raft::get_device_topology(device_id).cpus);
+        thread_bound = true;
+      }
       auto scoped_device = device_setter(device_id);
       // Build the device_resources object for this thread out of shared
       // components
-      thread_resources[device_id].emplace(component_iter->get_stream(),
+      thread_resources[device_id].emplace(component_iter->get_stream(lane),
                                           component_iter->get_pool(),
-                                          component_iter->get_workspace_memory_resource(),
+                                          component_iter->get_thread_workspace_memory_resource(),
                                           component_iter->get_workspace_allocation_limit());
+      if (auto pinned_mr = component_iter->get_pinned_memory_resource()) {
+        resource::set_pinned_memory_resource(thread_resources[device_id].value(), pinned_mr);
+      }
+      if (lane != stream_priority::normal) {
+        resource::set_stream_priority(thread_resources[device_id].value(),
+                                      lane,
+                                      lane == stream_priority::low
+                                        ? component_iter->low_priority_batch_pause()
+                                        : std::chrono::microseconds{});
+      }
     }
 
     return thread_resources[device_id].value();
@@ -348,6 +485,72 @@ struct device_resources_manager {
     }
   }
 
+  // Thread-safe setter for the size of the per-thread workspace arenas
+  void set_workspace_arena_size_(std::optional<std::size_t> arena_size)
+  {
+    auto lock = get_lock();
+    if (params_finalized_) {
+      RAFT_LOG_WARN(
+        "Attempted to set device_resources_manager properties after resources have already been "
+        "retrieved");
+    } else {
+      params_.workspace_arena_size = arena_size;
+    }
+  }
+
+  // Thread-safe setter for the binding of host threads to the CPUs closest to
+  // their device
+  void set_numa_affinity_(bool enable)
+  {
+    auto lock = get_lock();
+    if (params_finalized_) {
+      RAFT_LOG_WARN(
+        "Attempted to set device_resources_manager properties after resources have already been "
+        "retrieved");
+    } else {
+      params_.numa_affinity = enable;
+    }
+  }
+
+  // Thread-safe setter for the size of the pinned host memory pool
+  void set_pinned_mem_pool_(std::optional<std::size_t> max_cached_size)
+  {
+    auto lock = get_lock();
+    if (params_finalized_) {
+      RAFT_LOG_WARN(
+        "Attempted to set device_resources_manager properties after resources have already been "
+        "retrieved");
+    } else {
+      params_.pinned_mem_pool_size = max_cached_size;
+    }
+  }
+
+  // Thread-safe setter for the number of streams of the priority lanes
+  void set_priority_streams_per_device_(std::size_t num_streams)
+  {
+    auto lock = get_lock();
+    if (params_finalized_) {
+      RAFT_LOG_WARN(
+        "Attempted to set device_resources_manager properties after resources have already been "
+        "retrieved");
+    } else {
+      params_.priority_stream_count = num_streams;
+    }
+  }
+
+  // Thread-safe setter for the pause of the low priority lane between batches
+  void set_low_priority_batch_pause_(std::chrono::microseconds pause)
+  {
+    auto lock = get_lock();
+    if (params_finalized_) {
+      RAFT_LOG_WARN(
+        "Attempted to set device_resources_manager properties after resources have already been "
+        "retrieved");
+    } else {
+      params_.low_priority_batch_pause = pause;
+    }
+  }
+
   // Thread-safe setter for the maximum memory pool size
   void set_max_mem_pool_size_(std::optional<std::size_t> memory_limit)
   {
@@ -434,6 +637,48 @@ struct device_resources_manager {
     return get_manager().get_device_resources_(device_id);
   }
 
+  /**
+   * @brief Retrieve device_resources of a quality-of-service lane
+   *
+   * The `device_resources` of the `high` and `low` lanes use the streams of the
+   * highest and lowest priority of the device (see
+   * `set_priority_streams_per_device`), so that the GPU schedules the thread
+   * blocks of the latency-critical work ahead of those of the batch work
+   * running at the same time. The resources of the `low` lane also make the
+   * long-running algorithms (e.g. `ivf_pq::extend`, `cagra::build`) drain their
+   * stream and yield the host thread between their batches (see
+   * `raft::resource::yield_between_batches`), so that they never queue more
+   * than one batch of kernels ahead of the online work. The `normal` lane is
+   * that of `get_device_resources(int)`.
+   *
+   * The stream pool, workspace and memory resources are those of the other
+   * lanes, and the same guarantees hold per lane: repeated calls from the same
+   * host thread return a `device_resources` with the same underlying stream.
+   *
+   * @code
+   * void serve_query() {
+   *   auto const& res = raft::device_resources_manager::get_device_resources(
+   *     raft::stream_priority::high);
+   *   raft::neighbors::cagra::search(res, search_params, index, queries, neighbors, distances);
+   * }
+   *
+   * void background_ingest() {
+   *   auto const& res = raft::device_resources_manager::get_device_resources(
+   *     raft::stream_priority::low);
+   *   raft::neighbors::ivf_pq::extend(res, new_vectors, new_indices, &index);
+   * }
+   * @endcode
+   *
+   * @param lane the lane of the work submitted with the returned resources
+   * @param device_id int If provided, the device for which resources should
+   * be returned. Defaults to active CUDA device.
+   */
+  static auto const& get_device_resources(stream_priority lane,
+                                          int device_id = device_setter::get_current_device())
+  {
+    return get_manager().get_device_resources_(device_id, lane);
+  }
+
   /**
    * @brief Set the total number of CUDA streams to be used per device
    *
@@ -477,6 +722,44 @@ struct device_resources_manager {
   {
     get_manager().set_stream_pools_per_device_(num_pools, num_streams);
   }
+  /**
+   * @brief Set the number of CUDA streams of each priority lane per device
+   *
+   * The `device_resources` returned by
+   * `get_device_resources(raft::stream_priority::high)` (respectively `low`)
+   * draw their streams from `num_streams` streams of the highest (respectively
+   * lowest) priority of the device, in the same round-robin fashion as the
+   * primary streams. Defaults to one stream per lane. If set to 0, no priority
+   * streams are created and the lanes use the primary streams (the `low` lane
+   * still yields between the batches of the long-running algorithms).
+   *
+   * If called after the first call to
+   * `raft::device_resources_manager::get_device_resources`, no change will be made,
+   * and a warning will be emitted.
+   */
+  static void set_priority_streams_per_device(std::size_t num_streams)
+  {
+    get_manager().set_priority_streams_per_device_(num_streams);
+  }
+
+  /**
+   * @brief Set the pause of the low priority lane between batches
+   *
+   * At every batch boundary of the long-running algorithms, the work submitted
+   * with the `device_resources` of the `low` lane waits for its stream and then
+   * sleeps for `pause` (or, if zero, just yields the host thread). A non-zero
+   * pause leaves the device idle for the latency-critical work between the
+   * batches, at the cost of a slower build.
+   *
+   * If called after the first call to
+   * `raft::device_resources_manager::get_device_resources`, no change will be made,
+   * and a warning will be emitted.
+   */
+  static void set_low_priority_batch_pause(std::chrono::microseconds pause)
+  {
+    get_manager().set_low_priority_batch_pause_(pause);
+  }
+
   /**
    * @brief Set the maximum size of temporary RAFT workspaces
    *
@@ -494,6 +777,81 @@ struct device_resources_manager {
     get_manager().set_workspace_allocation_limit_(memory_limit);
   }
 
+  /**
+   * @brief Give every host thread its own workspace arena
+   *
+   * If set, the workspace memory resource of every `device_resources` returned
+   * by `get_device_resources` is a `raft::mr::workspace_arena_resource` owned by
+   * the calling host thread, on top of the workspace memory resource of the
+   * device (or the current RMM device memory resource). The temporary buffers
+   * of the RAFT calls are then carved from the arena without taking any lock,
+   * and the arena is reused once they are released, so that after warmup the
+   * workspace allocations in hot loops (e.g. repeated `cagra::search` or
+   * `ivf_pq::search` calls) cost nothing. The arena grows to the peak
+   * workspace usage of the thread; it starts with `arena_size` bytes. If set to
+   * nullopt, no arena is used.
+   *
+   * If called after the first call to
+   * `raft::device_resources_manager::get_device_resources`, no change will be made,
+   * and a warning will be emitted.
+   */
+  static void set_workspace_arena_size(std::optional<std::size_t> arena_size)
+  {
+    get_manager().set_workspace_arena_size_(arena_size);
+  }
+
+  /**
+   * @brief Bind host threads to the CPUs closest to their device
+   *
+   * If enabled, the first call to `get_device_resources` in each host thread
+   * restricts the thread to the CPUs of the NUMA node closest to the requested
+   * device (as reported by `raft::get_device_topology`). The host memory the
+   * thread allocates afterwards, such as the pinned staging buffers of
+   * `ivf_pq::extend` or of the host-side refinement, is then placed on that
+   * NUMA node, which avoids crossing the socket interconnect on the
+   * host-to-device transfers. Only the first device a thread requests
+   * determines its affinity, so host threads should be dedicated to one
+   * device each. This has no effect if the topology is not available (e.g. on
+   * non-Linux systems).
+   *
+   * If called after the first call to
+   * `raft::device_resources_manager::get_device_resources`, no change will be made,
+   * and a warning will be emitted.
+   */
+  static void set_numa_affinity(bool enable = true) { get_manager().set_numa_affinity_(enable); }
+
+  /**
+   * @brief Cache the pinned host allocations
+   *
+   * If set, the pinned mdarrays and the pinned staging buffers (e.g. of
+   * `ivf_pq::extend`) of the `device_resources` returned by
+   * `get_device_resources` are allocated from a pool shared by all the host
+   * threads using the same device (see `raft::mr::pinned_pool_resource`). The
+   * pool keeps up to `max_cached_size` bytes of released pinned memory for
+   * reuse, so that the staging buffers of repeated calls avoid the slow
+   * `cudaMallocHost`. If set to nullopt, every pinned allocation goes to
+   * `cudaMallocHost`.
+   *
+   * If called after the first call to
+   * `raft::device_resources_manager::get_device_resources`, no change will be made,
+   * and a warning will be emitted.
+   */
+  static void set_pinned_mem_pool(std::optional<std::size_t> max_cached_size)
+  {
+    get_manager().set_pinned_mem_pool_(max_cached_size);
+  }
+
+  /**
+   * @brief Get the PCIe address, and the NUMA node and CPUs closest to a device
+   *
+   * This lets applications place their own host-side work next to the
+   * device (e.g. with `raft::cpu_affinity_setter`).
+   */
+  static auto get_device_topology(int device_id) -> device_topology
+  {
+    return raft::get_device_topology(device_id);
+  }
+
   /**
    * @brief Set the maximum size of the device memory pool
    *
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#ifndef RAFT_DISABLE_CUDA
+#include <cuda_runtime_api.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace raft {
+
+/**
+ * @brief The host-side placement of a device: its PCIe address, and the NUMA node and CPUs
+ * closest to it.
+ *
+ * On multi-socket hosts, the host threads and the pinned staging buffers of a device should live
+ * on its NUMA node: crossing the socket interconnect can halve the host-to-device bandwidth.
+ */
+struct device_topology {
+  /** The CUDA device id (-1 if the topology was queried by PCIe address) */
+  int device_id{-1};
+  /** The PCIe address of the device, as `domain:bus:device.function` */
+  std::string pci_bus_id{};
+  /** The NUMA node closest to the device (-1 if unknown or not a NUMA host) */
+  int numa_node{-1};
+  /** The CPUs closest to the device (empty if unknown) */
+  std::vector<int> cpus{};
+};
+
+namespace detail {
+
+inline auto read_sysfs_line(std::string const& path) -> std::optional<std::string>
+{
+  std::ifstream file(path);
+  std::string line;
+  if (!file || !std::getline(file, line)) { return std::nullopt; }
+  return line;
+}
+
+/** Parse a Linux CPU list, such as "0-3,8-11,16". */
+inline auto parse_cpu_list(std::string const& list) -> std::vector<int>
+{
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty()) { continue; }
+    auto dash = range.find('-');
+    try {
+      int first = std::stoi(range.substr(0, dash));
+      int last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+      for (int cpu = first; cpu <= last; cpu++) {
+        cpus.push_back(cpu);
+      }
+    } catch (std::exception const&) {
+      return {};
+    }
+  }
+  return cpus;
+}
+
+}  // namespace detail
+
+/**
+ * @brief Get the topology of a PCIe device from the Linux sysfs.
+ *
+ * This does not need CUDA; on other systems, or if the information is not available, the NUMA
+ * node is -1 and the list of CPUs is empty.
+ *
+ * @param pci_bus_id the PCIe address of the device, as `domain:bus:device.function`
+ */
+inline auto get_pci_topology(std::string pci_bus_id) -> device_topology
+{
+  std::transform(pci_bus_id.begin(), pci_bus_id.end(), pci_bus_id.begin(), [](unsigned char c) {
+    return std::tolower(c);
+  });
+  device_topology result{};
+  result.pci_bus_id = pci_bus_id;
+#ifdef __linux__
+  auto device_path = "/sys/bus/pci/devices/" + pci_bus_id;
+  if (auto node = detail::read_sysfs_line(device_path + "/numa_node"); node.has_value()) {
+    try {
+      result.numa_node = std::max(std::stoi(*node), -1);
+    } catch (std::exception const&) {
+    }
+  }
+  if (auto cpus = detail::read_sysfs_line(device_path + "/local_cpulist"); cpus.has_value()) {
+    result.cpus = detail::parse_cpu_list(*cpus);
+  } else if (result.numa_node >= 0) {
+    auto node_path = "/sys/devices/system/node/node" + std::to_string(result.numa_node);
+    if (auto node_cpus = detail::read_sysfs_line(node_path + "/cpulist"); node_cpus.has_value()) {
+      result.cpus = detail::parse_cpu_list(*node_cpus);
+    }
+  }
+#endif
+  return result;
+}
+
+#ifndef RAFT_DISABLE_CUDA
+/**
+ * @brief Get the topology of a CUDA device (cached after the first query).
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   auto topology = raft::get_device_topology(device_id);
+ *   // Run the host-side work for the device close to it
+ *   auto scoped_affinity = raft::cpu_affinity_setter{topology.cpus};
+ * @endcode
+ *
+ * @param device_id the CUDA device id
+ */
+inline auto get_device_topology(int device_id) -> device_topology
+{
+  static std::mutex mutex;
+  static std::map<int, device_topology> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (auto it = cache.find(device_id); it != cache.end()) { return it->second; }
+  std::array<char, 32> bus_id{};
+  if (cudaDeviceGetPCIBusId(bus_id.data(), bus_id.size(), device_id) != cudaSuccess) {
+    // Leave the error state clean; the topology is only a placement hint
+    cudaGetLastError();
+    return device_topology{device_id};
+  }
+  auto result      = get_pci_topology(bus_id.data());
+  result.device_id = device_id;
+  return cache.emplace(device_id, result).first->second;
+}
+#endif
+
+/**
+ * @brief Restrict the CPUs the calling thread can run on (permanently).
+ *
+ * @param cpus the CPUs to run on; nothing is done if empty
+ * @return whether the affinity of the thread was changed
+ */
+inline auto bind_thread_to_cpus(std::vector<int> const& cpus) -> bool
+{
+#ifdef __linux__
+  if (cpus.empty()) { return false; }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) { CPU_SET(cpu, &set); }
+  }
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+  return false;
+#endif
+}
+
+/**
+ * @brief RAII: restrict the CPUs the calling thread can run on, and restore its previous
+ * affinity when the object goes out of scope.
+ *
+ * Since the OS places the pages of a new host allocation on the NUMA node of the CPU touching
+ * them first, pinned host buffers allocated within this scope land next to the chosen CPUs.
+ */
+class cpu_affinity_setter {
+ public:
+  explicit cpu_affinity_setter(std::vector<int> const& cpus)
+  {
+#ifdef __linux__
+    if (cpus.empty()) { return; }
+    if (sched_getaffinity(0, sizeof(prev_), &prev_) != 0) { return; }
+    active_ = bind_thread_to_cpus(cpus);
+#endif
+  }
+  ~cpu_affinity_setter()
+  {
+#ifdef __linux__
+    if (active_) { sched_setaffinity(0, sizeof(prev_), &prev_); }
+#endif
+  }
+  cpu_affinity_setter(cpu_affinity_setter const&)            = delete;
+  cpu_affinity_setter& operator=(cpu_affinity_setter const&) = delete;
+
+ private:
+#ifdef __linux__
+  cpu_set_t prev_{};
+  bool active_{false};
+#endif
+};
+
+}  // namespace raft
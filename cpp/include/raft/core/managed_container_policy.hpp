@@ -14,6 +14,48 @@
  * limitations under the License.
  */
 #pragma once
+
+namespace raft {
+
+/**
+ * Where the pages of a managed allocation preferably reside (`cudaMemAdviseSetPreferredLocation`).
+ */
+enum class managed_memory_location {
+  /** No preference: the pages migrate to the processor accessing them. */
+  NONE,
+  /** The current device at the time of the allocation. */
+  DEVICE,
+  /** The host: the pages migrate to a device only when prefetched (or read-mostly). */
+  HOST
+};
+
+/**
+ * @brief The hints given to the unified memory driver for a managed allocation.
+ *
+ * By default, the pages of a managed allocation migrate on the page faults of the processor
+ * accessing them; an allocation larger than the device memory (e.g. an oversubscribed dataset of
+ * an index build) then thrashes. Keeping such a dataset read-mostly (or preferably on the host)
+ * and prefetching the batches before they are processed makes it usable out-of-core.
+ */
+struct managed_memory_advice {
+  /**
+   * `cudaMemAdviseSetReadMostly`: the devices reading the pages get read-only copies of them, and
+   * the host copy stays valid (the copies are invalidated by a write).
+   */
+  bool read_mostly = false;
+  /** `cudaMemAdviseSetPreferredLocation` */
+  managed_memory_location preferred_location = managed_memory_location::NONE;
+  /**
+   * `cudaMemAdviseSetAccessedBy` the current device: its page table maps the pages wherever they
+   * reside, so that it reads them over the interconnect rather than faulting.
+   */
+  bool accessed_by_device = false;
+  /** Prefetch the allocation to the current device, in the stream of the resources, on creation. */
+  bool prefetch_on_create = false;
+};
+
+}  // namespace raft
+
 #ifndef RAFT_DISABLE_CUDA
 #include <raft/core/device_container_policy.hpp>
 #include <raft/core/device_mdspan.hpp>
@@ -24,11 +66,105 @@
 
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/device_memory_resource.hpp>
+
+#include <rmm/cuda_device.hpp>
 #include <rmm/mr/device/managed_memory_resource.hpp>
 
 namespace raft {
+
+/**
+ * @brief Whether the pointer is a managed allocation which can be prefetched from the current
+ * device (the device supports concurrent managed access).
+ */
+inline auto is_prefetchable_managed_ptr(const void* ptr) -> bool
+{
+  if (ptr == nullptr) { return false; }
+  cudaPointerAttributes attr;
+  if (cudaPointerGetAttributes(&attr, ptr) != cudaSuccess) {
+    // reset the error status of the thread
+    cudaGetLastError();
+    return false;
+  }
+  if (attr.type != cudaMemoryTypeManaged) { return false; }
+  int concurrent = 0;
+  RAFT_CUDA_TRY(cudaDeviceGetAttribute(
+    &concurrent, cudaDevAttrConcurrentManagedAccess, rmm::get_current_cuda_device().value()));
+  return concurrent != 0;
+}
+
+/**
+ * @brief Asynchronously migrate a range of managed memory to a device (or to the host with
+ *   `cudaCpuDeviceId`) in a stream.
+ *
+ * This is a no-op if the range is not managed memory or cannot be prefetched, so that batched
+ * algorithms can call it on any input: prefetching the next batch while the current one is
+ * processed replaces the page faults by bulk migrations.
+ *
+ * @param[in] ptr the start of the range
+ * @param[in] bytes the size of the range
+ * @param[in] device the destination
+ * @param[in] stream the stream ordering the migration
+ * @return whether the prefetch was issued
+ */
+inline auto managed_prefetch_async(const void* ptr,
+                                   size_t bytes,
+                                   int device,
+                                   rmm::cuda_stream_view stream) -> bool
+{
+  if (bytes == 0 || !is_prefetchable_managed_ptr(ptr)) { return false; }
+  RAFT_CUDA_TRY(cudaMemPrefetchAsync(ptr, bytes, device, stream));
+  return true;
+}
+
+/**
+ * @brief Asynchronously migrate a range of managed memory to the current device, in the stream of
+ *   the resources (a no-op if the range is not managed memory; see the overload above).
+ */
+inline auto managed_prefetch_async(raft::resources const& res, const void* ptr, size_t bytes)
+  -> bool
+{
+  return managed_prefetch_async(
+    ptr, bytes, rmm::get_current_cuda_device().value(), resource::get_cuda_stream(res));
+}
+
+/**
+ * @brief Apply the hints to a range of managed memory for the device (a no-op if the range is not
+ *   managed memory).
+ */
+inline void managed_advise(const void* ptr,
+                           size_t bytes,
+                           managed_memory_advice const& advice,
+                           int device)
+{
+  if (bytes == 0 || !is_prefetchable_managed_ptr(ptr)) { return; }
+  if (advice.read_mostly) {
+    RAFT_CUDA_TRY(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetReadMostly, device));
+  }
+  switch (advice.preferred_location) {
+    case managed_memory_location::DEVICE:
+      RAFT_CUDA_TRY(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetPreferredLocation, device));
+      break;
+    case managed_memory_location::HOST:
+      RAFT_CUDA_TRY(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetPreferredLocation, cudaCpuDeviceId));
+      break;
+    default: break;
+  }
+  if (advice.accessed_by_device) {
+    RAFT_CUDA_TRY(cudaMemAdvise(ptr, bytes, cudaMemAdviseSetAccessedBy, device));
+  }
+}
+
 /**
  * @brief A container policy for managed mdarray.
+ *
+ * The policy can be given the hints of its allocations to the unified memory driver, e.g.
+ *
+ * @code{.cpp}
+ * raft::managed_memory_advice advice;
+ * advice.read_mostly        = true;
+ * advice.preferred_location = raft::managed_memory_location::HOST;
+ * auto dataset = raft::make_managed_matrix<float, int64_t>(res, n_rows, dim, advice);
+ * @endcode
  */
 template <typename ElementType>
 class managed_uvector_policy {
@@ -43,11 +179,23 @@ class managed_uvector_policy {
   using accessor_policy       = std::experimental::default_accessor<element_type>;
   using const_accessor_policy = std::experimental::default_accessor<element_type const>;
 
+  managed_uvector_policy() = default;
+  explicit managed_uvector_policy(managed_memory_advice const& advice) : advice_{advice} {}
+
   auto create(raft::resources const& res, size_t n) -> container_type
   {
-    return container_type(n, resource::get_cuda_stream(res), mr_);
+    auto stream = resource::get_cuda_stream(res);
+    auto c      = container_type(n, stream, mr_);
+    auto bytes  = n * sizeof(element_type);
+    auto device = rmm::get_current_cuda_device().value();
+    managed_advise(c.data(), bytes, advice_, device);
+    if (advice_.prefetch_on_create) { managed_prefetch_async(c.data(), bytes, device, stream); }
+    return c;
   }
 
+  /** The hints given for the allocations of this policy. */
+  [[nodiscard]] auto advice() const noexcept -> managed_memory_advice const& { return advice_; }
+
   [[nodiscard]] constexpr auto access(container_type& c, size_t n) const noexcept -> reference
   {
     return c[n];
@@ -68,6 +216,7 @@ class managed_uvector_policy {
     return &result;
   }
   rmm::mr::managed_memory_resource* mr_{get_default_memory_resource()};
+  managed_memory_advice advice_{};
 };
 
 }  // namespace raft
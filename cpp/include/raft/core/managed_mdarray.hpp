@@ -91,6 +91,32 @@ auto make_managed_mdarray(raft::resources const& handle, extents<IndexType, Exte
   return mdarray_t{handle, layout, policy};
 }
 
+/**
+ * @brief Create a managed mdarray with the hints of its allocation to the unified memory driver.
+ * @tparam ElementType the data type of the matrix elements
+ * @tparam IndexType the index type of the extents
+ * @tparam LayoutPolicy policy for strides and layout ordering
+ * @param handle raft::resources
+ * @param exts dimensionality of the array (series of integers)
+ * @param advice the hints of the allocation (read-mostly, preferred location, prefetch)
+ * @return raft::managed_mdarray
+ */
+template <typename ElementType,
+          typename IndexType    = std::uint32_t,
+          typename LayoutPolicy = layout_c_contiguous,
+          size_t... Extents>
+auto make_managed_mdarray(raft::resources const& handle,
+                          extents<IndexType, Extents...> exts,
+                          managed_memory_advice const& advice)
+{
+  using mdarray_t = managed_mdarray<ElementType, decltype(exts), LayoutPolicy>;
+
+  typename mdarray_t::mapping_type layout{exts};
+  typename mdarray_t::container_policy_type policy{advice};
+
+  return mdarray_t{handle, layout, policy};
+}
+
 /**
  * @brief Create a 2-dim c-contiguous managed mdarray.
  *
@@ -111,6 +137,31 @@ auto make_managed_matrix(raft::resources const& handle, IndexType n_rows, IndexT
     handle, make_extents<IndexType>(n_rows, n_cols));
 }
 
+/**
+ * @brief Create a 2-dim c-contiguous managed mdarray with the hints of its allocation to the
+ * unified memory driver (e.g. an out-of-core dataset).
+ *
+ * @tparam ElementType the data type of the matrix elements
+ * @tparam IndexType the index type of the extents
+ * @tparam LayoutPolicy policy for strides and layout ordering
+ * @param[in] handle raft handle for managing expensive resources
+ * @param[in] n_rows number or rows in matrix
+ * @param[in] n_cols number of columns in matrix
+ * @param[in] advice the hints of the allocation (read-mostly, preferred location, prefetch)
+ * @return raft::managed_matrix
+ */
+template <typename ElementType,
+          typename IndexType    = std::uint32_t,
+          typename LayoutPolicy = layout_c_contiguous>
+auto make_managed_matrix(raft::resources const& handle,
+                         IndexType n_rows,
+                         IndexType n_cols,
+                         managed_memory_advice const& advice)
+{
+  return make_managed_mdarray<ElementType, IndexType, LayoutPolicy>(
+    handle, make_extents<IndexType>(n_rows, n_cols), advice);
+}
+
 /**
  * @brief Create a managed scalar from v.
  *
@@ -149,4 +200,26 @@ auto make_managed_vector(raft::resources const& handle, IndexType n)
                                                                     make_extents<IndexType>(n));
 }
 
+/**
+ * @brief Create a 1-dim managed mdarray with the hints of its allocation to the unified memory
+ * driver.
+ * @tparam ElementType the data type of the vector elements
+ * @tparam IndexType the index type of the extents
+ * @tparam LayoutPolicy policy for strides and layout ordering
+ * @param[in] handle raft handle for managing expensive cuda resources
+ * @param[in] n number of elements in vector
+ * @param[in] advice the hints of the allocation (read-mostly, preferred location, prefetch)
+ * @return raft::managed_vector
+ */
+template <typename ElementType,
+          typename IndexType    = std::uint32_t,
+          typename LayoutPolicy = layout_c_contiguous>
+auto make_managed_vector(raft::resources const& handle,
+                         IndexType n,
+                         managed_memory_advice const& advice)
+{
+  return make_managed_mdarray<ElementType, IndexType, LayoutPolicy>(
+    handle, make_extents<IndexType>(n), advice);
+}
+
 }  // end namespace raft
@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/error.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <cuda_runtime_api.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace raft {
+
+/** The counters of one call of an instrumented API function. */
+struct call_record {
+  /** The position of the call in the sequence of the calls recorded by the sink. */
+  uint64_t seq;
+  /** The name of the API function (a string literal, e.g. "ivf_pq::search"). */
+  const char* api;
+  /** The algorithm chosen by the call (e.g. the SelectAlgo of select_k), empty if none. */
+  char algo[32];
+  /** The number of the rows (queries) processed by the call, or -1. */
+  int64_t batch_size;
+  /** The largest workspace usage observed during the call, above the usage at its start. */
+  std::size_t workspace_bytes;
+  /** The GPU time of the call on the stream of its resources, in ms; negative if not timed. */
+  float gpu_time_ms;
+};
+
+/**
+ * @brief A fixed-size ring buffer of the call records of the instrumented API functions.
+ *
+ * The recording calls (`begin` / `end`) are lock-free: a call claims the slot at the write
+ * position with a compare-and-swap and publishes it with an atomic store, so the instrumented
+ * functions never wait for each other. When the buffer is full, the oldest unread records are
+ * overwritten (and counted as dropped); a call whose slot is still taken by a call in progress
+ * is not recorded at all. A call waits for the reader only when its slot is being copied out by
+ * a scrape at that moment.
+ *
+ * The GPU time is measured with a pair of CUDA events per slot (created once with the sink), so
+ * recording does not synchronize the stream; the events are resolved by `scrape`, which is meant
+ * to be called periodically by a monitoring thread. The calls made while the stream is being
+ * captured into a CUDA graph are recorded without the GPU time.
+ *
+ * The events are created on the device current at the construction of the sink, hence a sink
+ * must be used on one device only.
+ */
+class metrics_sink {
+ public:
+  /** The handle of a call started with `begin`; pass it to `end`. */
+  using call_id = uint64_t;
+  /** The id returned by `begin` for the calls that are not recorded. */
+  static constexpr call_id kNotRecorded = ~call_id{0};
+
+  /**
+   * @param capacity the number of the call records kept until they are scraped
+   */
+  explicit metrics_sink(std::size_t capacity = 4096)
+    : slots_(capacity), head_(capacity), tail_(capacity)
+  {
+    RAFT_EXPECTS(capacity > 0, "The capacity of the metrics sink must be positive");
+    // the positions start at `capacity`, so that the initial (free) slots are behind them
+    for (std::size_t i = 0; i < capacity; i++) {
+      slots_[i].state.store(make_state(i, kFree));
+      RAFT_CUDA_TRY(cudaEventCreate(&slots_[i].start));
+      RAFT_CUDA_TRY(cudaEventCreate(&slots_[i].stop));
+    }
+  }
+  ~metrics_sink()
+  {
+    for (auto& s : slots_) {
+      RAFT_CUDA_TRY_NO_THROW(cudaEventDestroy(s.start));
+      RAFT_CUDA_TRY_NO_THROW(cudaEventDestroy(s.stop));
+    }
+  }
+
+  metrics_sink(metrics_sink const&)            = delete;
+  metrics_sink(metrics_sink&&)                 = delete;
+  metrics_sink& operator=(metrics_sink const&) = delete;
+  metrics_sink& operator=(metrics_sink&&)      = delete;
+
+  [[nodiscard]] auto capacity() const -> std::size_t { return slots_.size(); }
+  /** The number of the calls not recorded or overwritten before they were scraped. */
+  [[nodiscard]] auto dropped() const -> uint64_t { return dropped_.load(); }
+
+  /** Start recording a call of `api` (a string literal) on the stream. */
+  auto begin(const char* api, cudaStream_t stream) noexcept -> call_id
+  {
+    uint64_t seq;
+    uint64_t st;
+    while (true) {
+      seq     = head_.load(std::memory_order_acquire);
+      auto& s = slot_of(seq);
+      st      = s.state.load(std::memory_order_acquire);
+      // the position is claimed by another call: help it advance the write position
+      if (seq_of(st) == seq) {
+        head_.compare_exchange_weak(seq, seq + 1);
+        continue;
+      }
+      // the slot is still taken by a call started `capacity` calls before
+      if (tag_of(st) == kWriting) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return kNotRecorded;
+      }
+      // the slot is being copied out by a scrape
+      if (tag_of(st) == kReading) { continue; }
+      if (s.state.compare_exchange_weak(st, make_state(seq, kWriting))) {
+        auto expected = seq;
+        head_.compare_exchange_strong(expected, seq + 1);
+        break;
+      }
+    }
+    // an unread record is overwritten
+    if (tag_of(st) == kPublished) { dropped_.fetch_add(1, std::memory_order_relaxed); }
+    auto& s           = slot_of(seq);
+    s.rec             = call_record{};
+    s.rec.seq         = seq - slots_.size();
+    s.rec.api         = api;
+    s.rec.batch_size  = -1;
+    s.rec.gpu_time_ms = -1;
+    cudaStreamCaptureStatus status;
+    s.timed = cudaStreamIsCapturing(stream, &status) == cudaSuccess &&
+              status == cudaStreamCaptureStatusNone &&
+              cudaEventRecord(s.start, stream) == cudaSuccess;
+    return seq;
+  }
+
+  /** The record of a call in progress (between `begin` and `end`), or nullptr. */
+  auto current(call_id id) noexcept -> call_record*
+  {
+    return id == kNotRecorded ? nullptr : &slot_of(id).rec;
+  }
+
+  /** Finish recording a call on the stream (the same stream as the `begin`). */
+  void end(call_id id, cudaStream_t stream) noexcept
+  {
+    if (id == kNotRecorded) { return; }
+    auto& s = slot_of(id);
+    if (s.timed) { s.timed = cudaEventRecord(s.stop, stream) == cudaSuccess; }
+    s.state.store(make_state(id, kPublished), std::memory_order_release);
+  }
+
+  /**
+   * Move the published records to `out`, in the order of the calls, and return their number.
+   *
+   * The reading stops at the first call still in progress or, unless `wait`, at the first call
+   * whose GPU work is not complete yet; those are returned by the next scrape. With `wait`, the
+   * GPU work of the recorded calls is waited for. The scrapes are serialized with a mutex, which
+   * the recording calls never take.
+   */
+  auto scrape(std::vector<call_record>& out, bool wait = false) -> std::size_t
+  {
+    std::lock_guard<std::mutex> lock(scrape_mutex_);
+    auto head = head_.load(std::memory_order_acquire);
+    // the records older than `capacity` calls have been overwritten
+    if (head - tail_ > slots_.size()) { tail_ = head - slots_.size(); }
+    std::size_t n = 0;
+    for (; tail_ < head; tail_++) {
+      auto& s = slot_of(tail_);
+      auto st = s.state.load(std::memory_order_acquire);
+      // still in progress
+      if (st == make_state(tail_, kWriting)) { break; }
+      // overwritten by a newer call
+      if (st != make_state(tail_, kPublished)) { continue; }
+      if (!s.state.compare_exchange_strong(st, make_state(tail_, kReading))) { continue; }
+      if (s.timed && !wait && cudaEventQuery(s.stop) == cudaErrorNotReady) {
+        s.state.store(st, std::memory_order_release);
+        break;
+      }
+      auto rec = s.rec;
+      float ms = 0;
+      if (s.timed && cudaEventSynchronize(s.stop) == cudaSuccess &&
+          cudaEventElapsedTime(&ms, s.start, s.stop) == cudaSuccess) {
+        rec.gpu_time_ms = ms;
+      }
+      s.state.store(make_state(tail_, kFree), std::memory_order_release);
+      out.push_back(rec);
+      n++;
+    }
+    return n;
+  }
+
+ private:
+  // the state of a slot: the sequence number of its call and a two-bit tag
+  static constexpr uint64_t kFree      = 0;
+  static constexpr uint64_t kWriting   = 1;
+  static constexpr uint64_t kPublished = 2;
+  static constexpr uint64_t kReading   = 3;
+  static constexpr auto make_state(uint64_t seq, uint64_t tag) -> uint64_t
+  {
+    return (seq << 2) | tag;
+  }
+  static constexpr auto tag_of(uint64_t state) -> uint64_t { return state & 3; }
+  static constexpr auto seq_of(uint64_t state) -> uint64_t { return state >> 2; }
+
+  struct slot {
+    std::atomic<uint64_t> state{kFree};
+    call_record rec{};
+    bool timed{false};
+    cudaEvent_t start{nullptr};
+    cudaEvent_t stop{nullptr};
+  };
+
+  std::vector<slot> slots_;
+  std::atomic<uint64_t> head_;
+  std::atomic<uint64_t> dropped_{0};
+  std::mutex scrape_mutex_;
+  uint64_t tail_;
+
+  auto slot_of(uint64_t seq) noexcept -> slot& { return slots_[seq % slots_.size()]; }
+};
+
+/** Copy an algorithm name into a call record (truncated to fit). */
+inline void set_call_algo(call_record& rec, const char* name) noexcept
+{
+  std::strncpy(rec.algo, name, sizeof(rec.algo) - 1);
+  rec.algo[sizeof(rec.algo) - 1] = '\0';
+}
+
+}  // namespace raft
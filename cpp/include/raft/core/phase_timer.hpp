@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/util/cudart_utils.hpp>
+
+#include <cuda_runtime_api.h>
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace raft {
+
+/**
+ * @brief Accumulates the GPU time of the named phases of the algorithms.
+ *
+ * A phase is delimited by a pair of CUDA events recorded on the stream of the work, so the timing
+ * does not synchronize the stream. The events are resolved (waited on) only in `collect`, which
+ * returns the total GPU time per phase since the previous call.
+ *
+ * The phases recorded while the stream is being captured into a CUDA graph are ignored, as the
+ * elapsed time between the captured events cannot be queried.
+ *
+ * The timer is thread-safe; the same phase name can be recorded by several threads or streams,
+ * in which case the times add up.
+ */
+class phase_timer {
+ public:
+  /** The handle of a phase started with `start`; pass it to `stop`. */
+  using phase_id = std::size_t;
+  /** The id returned by `start` for the phases that are not timed. */
+  static constexpr phase_id kNotTimed = ~phase_id{0};
+
+  phase_timer() = default;
+  ~phase_timer()
+  {
+    for (auto& p : pending_) {
+      release(p.start);
+      if (p.stop != nullptr) { release(p.stop); }
+    }
+    for (auto e : free_events_) {
+      RAFT_CUDA_TRY_NO_THROW(cudaEventDestroy(e));
+    }
+  }
+
+  phase_timer(phase_timer const&)            = delete;
+  phase_timer(phase_timer&&)                 = delete;
+  phase_timer& operator=(phase_timer const&) = delete;
+  phase_timer& operator=(phase_timer&&)      = delete;
+
+  /** Record the start of a phase on the stream. */
+  auto start(const std::string& name, cudaStream_t stream) -> phase_id
+  {
+    cudaStreamCaptureStatus status;
+    RAFT_CUDA_TRY(cudaStreamIsCapturing(stream, &status));
+    if (status != cudaStreamCaptureStatusNone) { return kNotTimed; }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto start_event = acquire();
+    RAFT_CUDA_TRY(cudaEventRecord(start_event, stream));
+    pending_.push_back(pending_phase{name, start_event, nullptr});
+    return pending_.size() - 1;
+  }
+
+  /** Record the end of a phase on the stream (the same stream as the start). */
+  void stop(phase_id id, cudaStream_t stream) noexcept
+  {
+    if (id == kNotTimed) { return; }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= pending_.size() || pending_[id].stop != nullptr) { return; }
+    cudaEvent_t stop_event;
+    if (free_events_.empty()) {
+      if (cudaEventCreate(&stop_event) != cudaSuccess) { return; }
+    } else {
+      stop_event = free_events_.back();
+      free_events_.pop_back();
+    }
+    // called from the destructors: an unrecorded stop event only drops the phase
+    if (cudaEventRecord(stop_event, stream) != cudaSuccess) {
+      release(stop_event);
+      return;
+    }
+    pending_[id].stop = stop_event;
+  }
+
+  /**
+   * Wait for the recorded phases to complete and return the total GPU time of each phase (in
+   * seconds) recorded since the previous call. The phases that were started but not stopped yet
+   * are discarded.
+   */
+  auto collect() -> std::map<std::string, double>
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<std::string, double> totals;
+    for (auto& p : pending_) {
+      if (p.stop != nullptr) {
+        float ms = 0;
+        RAFT_CUDA_TRY(cudaEventSynchronize(p.stop));
+        RAFT_CUDA_TRY(cudaEventElapsedTime(&ms, p.start, p.stop));
+        totals[p.name] += static_cast<double>(ms) * 1e-3;
+        release(p.stop);
+      }
+      release(p.start);
+    }
+    pending_.clear();
+    return totals;
+  }
+
+ private:
+  struct pending_phase {
+    std::string name;
+    cudaEvent_t start;
+    cudaEvent_t stop;
+  };
+
+  std::mutex mutex_;
+  std::vector<pending_phase> pending_;
+  // the events are reused across the phases to avoid creating them on the hot path
+  std::vector<cudaEvent_t> free_events_;
+
+  auto acquire() -> cudaEvent_t
+  {
+    if (free_events_.empty()) {
+      cudaEvent_t e;
+      RAFT_CUDA_TRY(cudaEventCreate(&e));
+      return e;
+    }
+    auto e = free_events_.back();
+    free_events_.pop_back();
+    return e;
+  }
+  void release(cudaEvent_t e) { free_events_.push_back(e); }
+};
+
+}  // namespace raft
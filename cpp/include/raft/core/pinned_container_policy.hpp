@@ -18,9 +18,15 @@
 #include <raft/core/mdspan_types.hpp>
 #include <raft/core/resources.hpp>
 #ifndef RAFT_DISABLE_CUDA
-#include <thrust/host_vector.h>
-#include <thrust/mr/allocator.h>
-#include <thrust/system/cuda/memory_resource.h>
+#include <raft/core/device_topology.hpp>
+#include <raft/core/resource/device_id.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
+
+#include <rmm/mr/host/host_memory_resource.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
 #else
 #include <raft/core/detail/fail_container_policy.hpp>
 #endif
@@ -29,23 +35,15 @@ namespace raft {
 #ifndef RAFT_DISABLE_CUDA
 
 /**
- * @brief A thin wrapper over thrust::host_vector for implementing the pinned mdarray container
- * policy.
+ * @brief A pinned host memory buffer allocated from an RMM host memory resource, for implementing
+ * the pinned mdarray container policy.
  *
+ * The elements are value-initialized.
  */
 template <typename T>
 struct pinned_container {
   using value_type = T;
-  using allocator_type =
-    thrust::mr::stateless_resource_allocator<value_type,
-                                             thrust::cuda::universal_host_pinned_memory_resource>;
-
- private:
-  using underlying_container_type = thrust::host_vector<value_type, allocator_type>;
-  underlying_container_type data_;
-
- public:
-  using size_type = std::size_t;
+  using size_type  = std::size_t;
 
   using reference       = value_type&;
   using const_reference = value_type const&;
@@ -56,21 +54,61 @@ struct pinned_container {
   using iterator       = pointer;
   using const_iterator = const_pointer;
 
-  ~pinned_container()                           = default;
-  pinned_container(pinned_container&&) noexcept = default;
-  pinned_container(pinned_container const& that) : data_{that.data_} {}
+ private:
+  static constexpr std::size_t kAlignment = std::max(alignof(T), alignof(std::max_align_t));
+
+  rmm::mr::host_memory_resource* mr_;
+  size_type size_;
+  pointer data_;
 
-  auto operator=(pinned_container<T> const& that) -> pinned_container<T>&
+  [[nodiscard]] auto allocate(size_type size) const -> pointer
   {
-    data_ = underlying_container_type{that.data_};
-    return *this;
+    if (size == 0) { return nullptr; }
+    return static_cast<pointer>(mr_->allocate(size * sizeof(value_type), kAlignment));
+  }
+  void release() noexcept
+  {
+    if (data_ == nullptr) { return; }
+    std::destroy_n(data_, size_);
+    mr_->deallocate(data_, size_ * sizeof(value_type), kAlignment);
+    data_ = nullptr;
+    size_ = 0;
   }
-  auto operator=(pinned_container<T>&& that) noexcept -> pinned_container<T>& = default;
 
+ public:
   /**
-   * @brief Ctor that accepts a size.
+   * @brief Ctor that accepts a size and the memory resource to allocate from.
    */
-  explicit pinned_container(std::size_t size, allocator_type const& alloc) : data_{size, alloc} {}
+  explicit pinned_container(std::size_t size, rmm::mr::host_memory_resource* mr)
+    : mr_{mr}, size_{size}, data_{allocate(size)}
+  {
+    std::uninitialized_value_construct_n(data_, size_);
+  }
+
+  ~pinned_container() { release(); }
+  pinned_container(pinned_container&& that) noexcept
+    : mr_{that.mr_}, size_{std::exchange(that.size_, 0)}, data_{std::exchange(that.data_, nullptr)}
+  {
+  }
+  pinned_container(pinned_container const& that)
+    : mr_{that.mr_}, size_{that.size_}, data_{allocate(that.size_)}
+  {
+    std::uninitialized_copy_n(that.data_, size_, data_);
+  }
+
+  auto operator=(pinned_container<T> const& that) -> pinned_container<T>&
+  {
+    if (this != &that) { *this = pinned_container<T>{that}; }
+    return *this;
+  }
+  auto operator=(pinned_container<T>&& that) noexcept -> pinned_container<T>&
+  {
+    std::swap(mr_, that.mr_);
+    std::swap(size_, that.size_);
+    std::swap(data_, that.data_);
+    return *this;
+  }
+
   /**
    * @brief Index operator that returns a reference to the actual data.
    */
@@ -88,10 +126,21 @@ struct pinned_container {
     return data_[i];
   }
 
-  void resize(size_type size) { data_.resize(size, data_.stream()); }
+  void resize(size_type size)
+  {
+    if (size == size_) { return; }
+    auto resized  = pinned_container<T>{0, mr_};
+    resized.data_ = allocate(size);
+    resized.size_ = size;
+    auto n_kept   = std::min(size, size_);
+    std::uninitialized_move_n(data_, n_kept, resized.data_);
+    std::uninitialized_value_construct_n(resized.data_ + n_kept, size - n_kept);
+    *this = std::move(resized);
+  }
 
-  [[nodiscard]] auto data() noexcept -> pointer { return data_.data().get(); }
-  [[nodiscard]] auto data() const noexcept -> const_pointer { return data_.data().get(); }
+  [[nodiscard]] auto size() const noexcept -> size_type { return size_; }
+  [[nodiscard]] auto data() noexcept -> pointer { return data_; }
+  [[nodiscard]] auto data() const noexcept -> const_pointer { return data_; }
 };
 
 /**
@@ -101,7 +150,6 @@ template <typename ElementType>
 struct pinned_vector_policy {
   using element_type          = ElementType;
   using container_type        = pinned_container<element_type>;
-  using allocator_type        = typename container_type::allocator_type;
   using pointer               = typename container_type::pointer;
   using const_pointer         = typename container_type::const_pointer;
   using reference             = typename container_type::reference;
@@ -109,15 +157,17 @@ struct pinned_vector_policy {
   using accessor_policy       = std::experimental::default_accessor<element_type>;
   using const_accessor_policy = std::experimental::default_accessor<element_type const>;
 
-  auto create(raft::resources const&, size_t n) -> container_type
+  auto create(raft::resources const& res, size_t n) -> container_type
   {
-    return container_type(n, allocator_);
+    // The pages are placed (on the first touch of their pinning) on the NUMA node of the
+    // allocating thread: allocate them from the CPUs closest to the device of the resources.
+    auto scoped_affinity =
+      cpu_affinity_setter{get_device_topology(resource::get_device_id(res)).cpus};
+    return container_type(n, resource::get_pinned_memory_resource(res));
   }
 
-  constexpr pinned_vector_policy() noexcept(std::is_nothrow_default_constructible_v<ElementType>)
-    : allocator_{}
-  {
-  }
+  constexpr pinned_vector_policy() noexcept(std::is_nothrow_default_constructible_v<ElementType>) =
+    default;
 
   [[nodiscard]] constexpr auto access(container_type& c, size_t n) const noexcept -> reference
   {
@@ -131,9 +181,6 @@ struct pinned_vector_policy {
 
   [[nodiscard]] auto make_accessor_policy() noexcept { return accessor_policy{}; }
   [[nodiscard]] auto make_accessor_policy() const noexcept { return const_accessor_policy{}; }
-
- private:
-  allocator_type allocator_;
 };
 #else
 template <typename ElementType>
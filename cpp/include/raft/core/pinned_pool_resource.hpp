@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/error.hpp>
+
+#include <rmm/mr/host/host_memory_resource.hpp>
+#include <rmm/mr/host/pinned_memory_resource.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace raft::mr {
+
+/**
+ * @brief A thread-safe cache of pinned host memory blocks.
+ *
+ * Allocating pinned memory (`cudaMallocHost`) takes milliseconds and serializes the driver, which
+ * makes short-lived pinned staging buffers very expensive. This resource keeps the released
+ * blocks and hands them out again to the requests of up to twice smaller size, so that after
+ * warmup the staging buffers of repeated calls cost a map lookup.
+ *
+ * At most `max_cached_size` bytes of free blocks are kept; the blocks exceeding it are released
+ * to the upstream resource.
+ *
+ * @note Unlike `cudaFreeHost`, releasing a block does not synchronize the device: the caller must
+ *   make sure that no pending asynchronous copy accesses a buffer when it is destroyed.
+ */
+class pinned_pool_resource final : public rmm::mr::host_memory_resource {
+ public:
+  /** The alignment of all the blocks. */
+  static constexpr std::size_t kAlignment = 256;
+
+  /**
+   * @param max_cached_size the maximum total size of the cached free blocks in bytes
+   * @param upstream the resource the blocks are taken from (`cudaMallocHost` by default)
+   */
+  explicit pinned_pool_resource(std::size_t max_cached_size,
+                                std::shared_ptr<rmm::mr::host_memory_resource> upstream =
+                                  std::make_shared<rmm::mr::pinned_memory_resource>())
+    : upstream_(std::move(upstream)), max_cached_size_(max_cached_size)
+  {
+    RAFT_EXPECTS(upstream_ != nullptr, "The upstream memory resource must not be null");
+  }
+
+  ~pinned_pool_resource() override { release(); }
+
+  pinned_pool_resource(pinned_pool_resource const&)            = delete;
+  pinned_pool_resource(pinned_pool_resource&&)                 = delete;
+  pinned_pool_resource& operator=(pinned_pool_resource const&) = delete;
+  pinned_pool_resource& operator=(pinned_pool_resource&&)      = delete;
+
+  /** The upstream resource. */
+  [[nodiscard]] auto get_upstream() const noexcept -> rmm::mr::host_memory_resource*
+  {
+    return upstream_.get();
+  }
+  /** The maximum total size of the cached free blocks in bytes. */
+  [[nodiscard]] auto max_cached_size() const noexcept -> std::size_t { return max_cached_size_; }
+  /** The total size of the cached free blocks in bytes. */
+  [[nodiscard]] auto cached_bytes() const -> std::size_t
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cached_bytes_;
+  }
+  /** The number of blocks taken from the upstream resource so far. */
+  [[nodiscard]] auto upstream_allocation_count() const -> std::size_t
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return upstream_allocation_count_;
+  }
+
+  /** Release all the cached free blocks to the upstream resource. */
+  void release()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto [size, p] : free_blocks_) {
+      upstream_->deallocate(p, size, kAlignment);
+    }
+    free_blocks_.clear();
+    cached_bytes_ = 0;
+  }
+
+ private:
+  std::shared_ptr<rmm::mr::host_memory_resource> upstream_;
+  std::size_t max_cached_size_;
+  mutable std::mutex mutex_;
+  // free blocks by size
+  std::multimap<std::size_t, void*> free_blocks_;
+  // the sizes of the blocks in use
+  std::unordered_map<void*, std::size_t> used_blocks_;
+  std::size_t cached_bytes_{0};
+  std::size_t upstream_allocation_count_{0};
+
+  static constexpr auto align_up(std::size_t bytes) -> std::size_t
+  {
+    return (bytes + kAlignment - 1) / kAlignment * kAlignment;
+  }
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override
+  {
+    RAFT_EXPECTS(alignment <= kAlignment,
+                 "pinned_pool_resource: the alignment must not exceed %zu",
+                 kAlignment);
+    bytes = align_up(std::max<std::size_t>(bytes, 1));
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto it = free_blocks_.lower_bound(bytes);
+        it != free_blocks_.end() && it->first <= 2 * bytes) {
+      auto [size, p] = *it;
+      free_blocks_.erase(it);
+      cached_bytes_ -= size;
+      used_blocks_.emplace(p, size);
+      return p;
+    }
+    void* p = upstream_->allocate(bytes, kAlignment);
+    upstream_allocation_count_++;
+    used_blocks_.emplace(p, bytes);
+    return p;
+  }
+
+  void do_deallocate(void* p, std::size_t, std::size_t) override
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = used_blocks_.find(p);
+    RAFT_EXPECTS(it != used_blocks_.end(), "pinned_pool_resource: unknown pointer");
+    auto size = it->second;
+    used_blocks_.erase(it);
+    if (cached_bytes_ + size <= max_cached_size_) {
+      free_blocks_.emplace(size, p);
+      cached_bytes_ += size;
+    } else {
+      upstream_->deallocate(p, size, kAlignment);
+    }
+  }
+
+  [[nodiscard]] bool do_is_equal(host_memory_resource const& other) const noexcept override
+  {
+    return this == &other;
+  }
+};
+
+}  // namespace raft::mr
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/cancellation_token.hpp>
+#include <raft/core/interruptible.hpp>
+#include <raft/core/resource/resource_types.hpp>
+#include <raft/core/resource/stream_priority.hpp>
+#include <raft/core/resources.hpp>
+
+#include <chrono>
+#include <memory>
+
+namespace raft::resource {
+
+/**
+ * @defgroup resource_cancellation Cancellation token resource functions
+ * @{
+ */
+
+class cancellation_token_resource : public resource {
+ public:
+  cancellation_token_resource() : token_(std::make_shared<cancellation_token>()) {}
+  void* get_resource() override { return token_.get(); }
+
+  ~cancellation_token_resource() override = default;
+
+ private:
+  std::shared_ptr<cancellation_token> token_;
+};
+
+/**
+ * Factory that knows how to construct a specific raft::resource to populate
+ * the res_t.
+ */
+class cancellation_token_resource_factory : public resource_factory {
+ public:
+  resource_type get_resource_type() override { return resource_type::CANCELLATION_TOKEN; }
+  resource* make_resource() override { return new cancellation_token_resource(); }
+};
+
+/**
+ * Load the cancellation token of a resources instance (and populate it on the res if needed).
+ *
+ * The token is shared by the copies of the resources instance; cancel it from another thread to
+ * stop the work submitted with them at their next cancellation point.
+ *
+ * @param res raft resources object for managing resources
+ * @return the cancellation token
+ */
+inline auto get_cancellation_token(resources const& res) -> cancellation_token&
+{
+  if (!res.has_resource_factory(resource_type::CANCELLATION_TOKEN)) {
+    res.add_resource_factory(std::make_shared<cancellation_token_resource_factory>());
+  }
+  return *res.get_resource<cancellation_token>(resource_type::CANCELLATION_TOKEN);
+};
+
+/**
+ * A cancellation point of the long-running algorithms, called between their kernel launches.
+ *
+ * This does nothing (and does not create the token) unless a cancellation token was requested on
+ * the resources; it also serves as an `interruptible::yield` point, and as a batch boundary where
+ * the work of the `low` stream priority lane yields (see `yield_between_batches`).
+ *
+ * @param res raft resources object for managing resources
+ *
+ * @throw raft::deadline_exceeded_exception if the deadline of the token has passed.
+ * @throw raft::interrupted_exception if the token or the thread was cancelled.
+ */
+inline void check_cancellation(resources const& res)
+{
+  interruptible::yield();
+  if (res.has_resource_factory(resource_type::CANCELLATION_TOKEN)) {
+    get_cancellation_token(res).check();
+  }
+  yield_between_batches(res);
+}
+
+/**
+ * The device flag of the cancellation token of a resources instance, for the kernels polling it
+ * with `raft::is_cancelled`, or nullptr if no token was requested on the resources.
+ */
+inline auto get_cancellation_flag(resources const& res) -> const volatile int*
+{
+  if (!res.has_resource_factory(resource_type::CANCELLATION_TOKEN)) { return nullptr; }
+  return get_cancellation_token(res).device_flag();
+}
+
+/**
+ * @brief RAII: set a deadline on the cancellation token of a resources instance for the duration
+ * of a scope (e.g. of a latency-bounded search request).
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   try {
+ *     raft::resource::scoped_deadline deadline(res, std::chrono::milliseconds(5));
+ *     cagra::search(res, params, index, queries, neighbors, distances);
+ *   } catch (const raft::deadline_exceeded_exception&) {
+ *     // the request took too long
+ *   }
+ * @endcode
+ *
+ * On the exit from the scope, the token is reset (the deadline and any cancellation are cleared).
+ */
+class scoped_deadline {
+ public:
+  template <typename Rep, typename Period>
+  scoped_deadline(resources const& res, std::chrono::duration<Rep, Period> timeout)
+    : token_(get_cancellation_token(res))
+  {
+    token_.reset();
+    token_.set_timeout(timeout);
+  }
+  ~scoped_deadline() { token_.reset(); }
+
+  scoped_deadline(scoped_deadline const&)            = delete;
+  scoped_deadline& operator=(scoped_deadline const&) = delete;
+
+ private:
+  cancellation_token& token_;
+};
+
+/**
+ * @}
+ */
+
+}  // namespace raft::resource
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/resource_types.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/core/workspace_arena_resource.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <cuda_runtime.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+namespace raft::resource {
+
+/**
+ * @defgroup resource_cuda_graph CUDA graph capture and replay resource functions
+ * @{
+ */
+
+/**
+ * A captured and instantiated CUDA graph, with the resources it was captured with (the workspace
+ * memory and the library handles its kernels use).
+ */
+class cuda_graph_entry {
+ public:
+  cuda_graph_entry(cudaGraphExec_t exec, std::unique_ptr<resources> res)
+    : exec_(exec), res_(std::move(res))
+  {
+  }
+  ~cuda_graph_entry() { RAFT_CUDA_TRY_NO_THROW(cudaGraphExecDestroy(exec_)); }
+
+  cuda_graph_entry(cuda_graph_entry const&)            = delete;
+  cuda_graph_entry& operator=(cuda_graph_entry const&) = delete;
+
+  void launch(rmm::cuda_stream_view stream) const
+  {
+    RAFT_CUDA_TRY(cudaGraphLaunch(exec_, stream));
+  }
+
+ private:
+  cudaGraphExec_t exec_;
+  // The temporaries and the handles of the captured calls live here, as long as the graph
+  std::unique_ptr<resources> res_;
+};
+
+/** The graphs captured on a resources instance, by user-defined key. */
+using cuda_graph_cache = std::unordered_map<std::uint64_t, std::unique_ptr<cuda_graph_entry>>;
+
+class cuda_graph_resource : public resource {
+ public:
+  cuda_graph_resource() = default;
+  void* get_resource() override { return &graphs_; }
+
+  ~cuda_graph_resource() override = default;
+
+ private:
+  cuda_graph_cache graphs_;
+};
+
+/**
+ * Factory that knows how to construct a specific raft::resource to populate
+ * the res_t.
+ */
+class cuda_graph_resource_factory : public resource_factory {
+ public:
+  resource_type get_resource_type() override { return resource_type::CUDA_GRAPH; }
+  resource* make_resource() override { return new cuda_graph_resource(); }
+};
+
+/**
+ * Load the cache of the CUDA graphs captured on a resources instance (and populate it on the res
+ * if needed).
+ *
+ * @param res raft resources object for managing resources
+ * @return the graphs by key
+ */
+inline auto get_cuda_graph_cache(resources const& res) -> cuda_graph_cache&
+{
+  if (!res.has_resource_factory(resource_type::CUDA_GRAPH)) {
+    res.add_resource_factory(std::make_shared<cuda_graph_resource_factory>());
+  }
+  return *res.get_resource<cuda_graph_cache>(resource_type::CUDA_GRAPH);
+};
+
+/** Whether the main stream of the resources is being captured into a CUDA graph. */
+inline auto is_stream_capturing(resources const& res) -> bool
+{
+  cudaStreamCaptureStatus status;
+  RAFT_CUDA_TRY(cudaStreamIsCapturing(get_cuda_stream(res), &status));
+  return status != cudaStreamCaptureStatusNone;
+}
+
+/** Destroy all the CUDA graphs captured on a resources instance. */
+inline void clear_cuda_graphs(resources const& res) { get_cuda_graph_cache(res).clear(); }
+
+/**
+ * @brief Run a fixed sequence of RAFT calls as a CUDA graph.
+ *
+ * The first time a key is seen, `fn` is run eagerly (which produces its results and sizes its
+ * workspace), and then captured into a CUDA graph stored on `res` under `key`. Every later call
+ * with the same key only replays the graph on the main stream of `res`, with a single
+ * `cudaGraphLaunch`, skipping all the host-side work of the calls (parameter checks, plan
+ * creation, kernel configuration and launches).
+ *
+ * `fn` receives the resources to run with; it must pass them to the RAFT calls instead of `res`.
+ * They are a copy of `res` kept alive with the graph, whose workspace resource is an arena owned
+ * by the graph, so that the temporaries of the calls stay valid for the replays and are not
+ * shared with anything else.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   // queries, neighbors and distances are persistent buffers of a fixed shape
+ *   auto key = n_queries;
+ *   raft::resource::run_as_cuda_graph(res, key, [&](raft::resources const& graph_res) {
+ *     ivf_pq::search(graph_res, search_params, index, queries, neighbors, distances);
+ *   });
+ * @endcode
+ *
+ * @note The graph replays exactly the captured kernels with the captured arguments: the key must
+ *   identify the shapes, the parameters and the pointers of the inputs and outputs (use
+ *   persistent buffers and copy the new inputs into them before each call).
+ *
+ * @note `fn` must be graph-capture-safe: only stream-ordered work on the main stream, no host
+ *   synchronization, no host-to-device copy from pageable memory and no allocation outside of the
+ *   workspace resource. `ivf_pq::search`, `cagra::search` and `brute_force::search` are.
+ *
+ * @param res raft resources object for managing resources
+ * @param key the user-defined identifier of the call sequence
+ * @param fn the call sequence, a callable taking `raft::resources const&`
+ */
+template <typename Fn>
+void run_as_cuda_graph(resources const& res, std::uint64_t key, Fn&& fn)
+{
+  auto& graphs = get_cuda_graph_cache(res);
+  auto stream  = get_cuda_stream(res);
+  if (auto it = graphs.find(key); it != graphs.end()) {
+    it->second->launch(stream);
+    return;
+  }
+
+  auto workspace = std::make_shared<raft::mr::workspace_arena_resource>(
+    workspace_resource_factory::default_plain_resource());
+  auto graph_res = std::make_unique<resources>(res);
+  set_workspace_resource(*graph_res, workspace, get_workspace_total_bytes(res));
+  // the copy must not hold the cache which is going to hold it
+  graph_res->add_resource_factory(std::make_shared<cuda_graph_resource_factory>());
+
+  // The eager run produces the results of this call and the size of the workspace
+  fn(std::as_const(*graph_res));
+  workspace->reserve(0, stream);
+  auto n_overflows = workspace->overflow_count();
+
+  cudaGraph_t graph;
+  RAFT_CUDA_TRY(cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal));
+  try {
+    fn(std::as_const(*graph_res));
+  } catch (...) {
+    if (cudaStreamEndCapture(stream, &graph) == cudaSuccess) { cudaGraphDestroy(graph); }
+    throw;
+  }
+  RAFT_CUDA_TRY(cudaStreamEndCapture(stream, &graph));
+  if (workspace->overflow_count() != n_overflows) {
+    RAFT_CUDA_TRY_NO_THROW(cudaGraphDestroy(graph));
+    RAFT_FAIL("The workspace of the captured calls differs from the one of their eager run");
+  }
+  cudaGraphExec_t exec;
+  auto status = cudaGraphInstantiateWithFlags(&exec, graph, 0);
+  RAFT_CUDA_TRY_NO_THROW(cudaGraphDestroy(graph));
+  RAFT_CUDA_TRY(status);
+  graphs.emplace(key, std::make_unique<cuda_graph_entry>(exec, std::move(graph_res)));
+}
+
+/**
+ * @}
+ */
+
+}  // namespace raft::resource
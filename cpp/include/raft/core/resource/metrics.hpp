@@ -0,0 +1,172 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/metrics.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/resource_types.hpp>
+#include <raft/core/resources.hpp>
+
+#include <algorithm>
+#include <memory>
+
+namespace raft::resource {
+
+/**
+ * @defgroup resource_metrics Metrics sink resource functions
+ * @{
+ */
+
+class metrics_sink_resource : public resource {
+ public:
+  explicit metrics_sink_resource(std::shared_ptr<metrics_sink> sink) : sink_(std::move(sink)) {}
+  void* get_resource() override { return sink_.get(); }
+
+  ~metrics_sink_resource() override = default;
+
+ private:
+  std::shared_ptr<metrics_sink> sink_;
+};
+
+/**
+ * Factory that knows how to construct a specific raft::resource to populate
+ * the res_t.
+ */
+class metrics_sink_resource_factory : public resource_factory {
+ public:
+  explicit metrics_sink_resource_factory(std::shared_ptr<metrics_sink> sink = nullptr)
+    : sink_(sink != nullptr ? std::move(sink) : std::make_shared<metrics_sink>())
+  {
+  }
+  resource_type get_resource_type() override { return resource_type::METRICS_SINK; }
+  resource* make_resource() override { return new metrics_sink_resource(sink_); }
+
+ private:
+  // held by the factory, so that the copies of the resources instance share the sink
+  std::shared_ptr<metrics_sink> sink_;
+};
+
+/**
+ * Set the metrics sink of a resources instance, which enables the recording of the calls.
+ *
+ * The same sink can be set on several resources instances (e.g. one per worker thread), so that
+ * a monitoring thread scrapes all of them at once.
+ *
+ * @param res raft resources object for managing resources
+ * @param sink the sink of the call records
+ */
+inline void set_metrics_sink(resources const& res, std::shared_ptr<metrics_sink> sink)
+{
+  res.add_resource_factory(std::make_shared<metrics_sink_resource_factory>(std::move(sink)));
+}
+
+/**
+ * Load the metrics sink of a resources instance (and populate it with a sink of the default
+ * capacity if needed).
+ *
+ * Once a sink is set or requested, the instrumented API functions (e.g. the searches of the ANN
+ * indexes and `matrix::select_k`) record a `call_record` of every call; read them with
+ * `metrics_sink::scrape`.
+ *
+ * @param res raft resources object for managing resources
+ * @return the metrics sink
+ */
+inline auto get_metrics_sink(resources const& res) -> metrics_sink&
+{
+  if (!res.has_resource_factory(resource_type::METRICS_SINK)) {
+    res.add_resource_factory(std::make_shared<metrics_sink_resource_factory>());
+  }
+  return *res.get_resource<metrics_sink>(resource_type::METRICS_SINK);
+};
+
+/**
+ * @brief RAII: record a call of an API function on the stream of a resources instance.
+ *
+ * This does nothing (and does not create the sink) unless a metrics sink was set on the
+ * resources, so the instrumentation costs only a check of the resources by default.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   raft::resource::scoped_call call(res, "ivf_pq::search");
+ *   call.set_batch_size(n_queries);
+ *   ...
+ *   call.note_workspace();  // where the temporary buffers are allocated
+ * @endcode
+ */
+class scoped_call {
+ public:
+  scoped_call(resources const& res, const char* api)
+  {
+    if (!res.has_resource_factory(resource_type::METRICS_SINK)) { return; }
+    res_    = &res;
+    sink_   = &get_metrics_sink(res);
+    stream_ = get_cuda_stream(res);
+    id_     = sink_->begin(api, stream_);
+    if (id_ != metrics_sink::kNotRecorded) { workspace_start_ = get_workspace_used_bytes(res); }
+  }
+  ~scoped_call()
+  {
+    if (sink_ != nullptr) { sink_->end(id_, stream_); }
+  }
+
+  scoped_call(scoped_call const&)            = delete;
+  scoped_call& operator=(scoped_call const&) = delete;
+
+  /** Whether the call is recorded (i.e. the setters below have an effect). */
+  [[nodiscard]] auto enabled() const noexcept -> bool { return record() != nullptr; }
+
+  /** Set the number of the rows (queries) processed by the call. */
+  void set_batch_size(int64_t n) noexcept
+  {
+    if (auto* r = record(); r != nullptr) { r->batch_size = n; }
+  }
+
+  /** Set the name of the algorithm chosen by the call. */
+  void set_algo(const char* name) noexcept
+  {
+    if (auto* r = record(); r != nullptr) { set_call_algo(*r, name); }
+  }
+
+  /** Sample the workspace usage (call it while the temporary buffers of the call are alive). */
+  void note_workspace()
+  {
+    if (auto* r = record(); r != nullptr) {
+      auto used = get_workspace_used_bytes(*res_);
+      if (used > workspace_start_) {
+        r->workspace_bytes = std::max(r->workspace_bytes, used - workspace_start_);
+      }
+    }
+  }
+
+ private:
+  resources const* res_{nullptr};
+  metrics_sink* sink_{nullptr};
+  cudaStream_t stream_{nullptr};
+  metrics_sink::call_id id_{metrics_sink::kNotRecorded};
+  std::size_t workspace_start_{0};
+
+  [[nodiscard]] auto record() const noexcept -> call_record*
+  {
+    return sink_ == nullptr ? nullptr : sink_->current(id_);
+  }
+};
+
+/**
+ * @}
+ */
+
+}  // namespace raft::resource
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/phase_timer.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/resource_types.hpp>
+#include <raft/core/resources.hpp>
+
+#include <memory>
+
+namespace raft::resource {
+
+/**
+ * @defgroup resource_phase_timer Phase timer resource functions
+ * @{
+ */
+
+class phase_timer_resource : public resource {
+ public:
+  explicit phase_timer_resource(std::shared_ptr<phase_timer> timer) : timer_(std::move(timer)) {}
+  void* get_resource() override { return timer_.get(); }
+
+  ~phase_timer_resource() override = default;
+
+ private:
+  std::shared_ptr<phase_timer> timer_;
+};
+
+/**
+ * Factory that knows how to construct a specific raft::resource to populate
+ * the res_t.
+ */
+class phase_timer_resource_factory : public resource_factory {
+ public:
+  phase_timer_resource_factory() : timer_(std::make_shared<phase_timer>()) {}
+  resource_type get_resource_type() override { return resource_type::PHASE_TIMER; }
+  resource* make_resource() override { return new phase_timer_resource(timer_); }
+
+ private:
+  // held by the factory, so that the copies of the resources instance share the timer
+  std::shared_ptr<phase_timer> timer_;
+};
+
+/**
+ * Load the phase timer of a resources instance (and populate it on the res if needed).
+ *
+ * Once the timer is requested, the instrumented algorithms record the GPU time of their phases
+ * (e.g. the coarse search, the scan and the select-k of IVF-PQ); read it with
+ * `phase_timer::collect`.
+ *
+ * @param res raft resources object for managing resources
+ * @return the phase timer
+ */
+inline auto get_phase_timer(resources const& res) -> phase_timer&
+{
+  if (!res.has_resource_factory(resource_type::PHASE_TIMER)) {
+    res.add_resource_factory(std::make_shared<phase_timer_resource_factory>());
+  }
+  return *res.get_resource<phase_timer>(resource_type::PHASE_TIMER);
+};
+
+/**
+ * @brief RAII: time a phase of an algorithm on the stream of a resources instance.
+ *
+ * This does nothing (and does not create the timer) unless a phase timer was requested on the
+ * resources, so the instrumentation costs nothing by default.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   {
+ *     raft::resource::scoped_phase phase(res, "select_k");
+ *     matrix::select_k(res, ...);
+ *   }
+ * @endcode
+ */
+class scoped_phase {
+ public:
+  scoped_phase(resources const& res, const char* name)
+  {
+    if (!res.has_resource_factory(resource_type::PHASE_TIMER)) { return; }
+    timer_  = &get_phase_timer(res);
+    stream_ = get_cuda_stream(res);
+    id_     = timer_->start(name, stream_);
+  }
+  ~scoped_phase()
+  {
+    if (timer_ != nullptr) { timer_->stop(id_, stream_); }
+  }
+
+  scoped_phase(scoped_phase const&)            = delete;
+  scoped_phase& operator=(scoped_phase const&) = delete;
+
+ private:
+  phase_timer* timer_{nullptr};
+  cudaStream_t stream_{nullptr};
+  phase_timer::phase_id id_{phase_timer::kNotTimed};
+};
+
+/**
+ * @}
+ */
+
+}  // namespace raft::resource
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/pinned_pool_resource.hpp>
+#include <raft/core/resource/resource_types.hpp>
+#include <raft/core/resources.hpp>
+
+#include <rmm/mr/host/host_memory_resource.hpp>
+#include <rmm/mr/host/pinned_memory_resource.hpp>
+
+#include <cstddef>
+#include <memory>
+
+namespace raft::resource {
+
+/**
+ * \defgroup pinned_memory_resource Pinned host memory resources
+ * @{
+ */
+
+class pinned_memory_resource : public resource {
+ public:
+  explicit pinned_memory_resource(std::shared_ptr<rmm::mr::host_memory_resource> mr)
+    : mr_(std::move(mr))
+  {
+  }
+
+  auto get_resource() -> void* override { return mr_.get(); }
+
+  ~pinned_memory_resource() override = default;
+
+ private:
+  std::shared_ptr<rmm::mr::host_memory_resource> mr_;
+};
+
+/**
+ * Factory that knows how to construct a specific raft::resource to populate
+ * the resources instance.
+ */
+class pinned_memory_resource_factory : public resource_factory {
+ public:
+  explicit pinned_memory_resource_factory(
+    std::shared_ptr<rmm::mr::host_memory_resource> mr = {nullptr})
+    : mr_(mr ? mr : default_plain_resource())
+  {
+  }
+
+  auto get_resource_type() -> resource_type override
+  {
+    return resource_type::PINNED_MEMORY_RESOURCE;
+  }
+  auto make_resource() -> resource* override { return new pinned_memory_resource(mr_); }
+
+  /** The process-wide plain (`cudaMallocHost`) pinned memory resource. */
+  static inline auto default_plain_resource() -> std::shared_ptr<rmm::mr::host_memory_resource>
+  {
+    static auto mr = std::make_shared<rmm::mr::pinned_memory_resource>();
+    return mr;
+  }
+
+ private:
+  std::shared_ptr<rmm::mr::host_memory_resource> mr_;
+};
+
+/**
+ * Load the pinned host memory resource used for the pinned mdarrays and the staging buffers from
+ * a resources instance (and populate it on the res if needed).
+ *
+ * By default, this is a plain `cudaMallocHost` resource; use `set_pinned_memory_pool` to cache
+ * the pinned allocations.
+ *
+ * @param res raft resources object for managing resources
+ * @return host memory resource object
+ */
+inline auto get_pinned_memory_resource(resources const& res) -> rmm::mr::host_memory_resource*
+{
+  if (!res.has_resource_factory(resource_type::PINNED_MEMORY_RESOURCE)) {
+    res.add_resource_factory(std::make_shared<pinned_memory_resource_factory>());
+  }
+  return res.get_resource<rmm::mr::host_memory_resource>(resource_type::PINNED_MEMORY_RESOURCE);
+};
+
+/**
+ * Set the pinned host memory resource on a resources instance.
+ *
+ * @param res raft resources object for managing resources
+ * @param mr an optional RMM host_memory_resource allocating pinned memory
+ */
+inline void set_pinned_memory_resource(
+  resources const& res, std::shared_ptr<rmm::mr::host_memory_resource> mr = {nullptr})
+{
+  res.add_resource_factory(std::make_shared<pinned_memory_resource_factory>(mr));
+};
+
+/**
+ * Use a pool of pinned host memory on a resources instance.
+ *
+ * Allocating pinned memory is slow and serializes the driver; with the pool, the pinned
+ * mdarrays and staging buffers of repeated calls reuse the blocks released by the previous ones
+ * (see `raft::mr::pinned_pool_resource`).
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   raft::device_resources res;
+ *   // keep up to 1 GiB of pinned memory for reuse
+ *   raft::resource::set_pinned_memory_pool(res, 1024ull * 1024ull * 1024ull);
+ *   auto staging = raft::make_pinned_matrix<float, int64_t>(res, n_rows, dim);
+ * @endcode
+ *
+ * @param res raft resources object for managing resources
+ * @param max_cached_size the maximum total size of the cached free blocks in bytes
+ */
+inline void set_pinned_memory_pool(resources const& res, std::size_t max_cached_size)
+{
+  auto upstream = pinned_memory_resource_factory::default_plain_resource();
+  set_pinned_memory_resource(
+    res, std::make_shared<raft::mr::pinned_pool_resource>(max_cached_size, upstream));
+};
+
+/**
+ * @}
+ */
+
+}  // namespace raft::resource
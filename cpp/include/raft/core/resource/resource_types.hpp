@@ -45,6 +45,13 @@ enum resource_type {
   WORKSPACE_RESOURCE,      // rmm device memory resource
   CUBLASLT_HANDLE,         // cublasLt handle
   CUSTOM,                  // runtime-shared default-constructible resource
+  HIER_COMMUNICATOR,       // raft two-level (intra-/inter-node) communicator
+  CUDA_GRAPH,              // cuda graphs captured for replay
+  PINNED_MEMORY_RESOURCE,  // rmm host memory resource for pinned buffers
+  CANCELLATION_TOKEN,      // device-visible cancellation flag and deadline
+  PHASE_TIMER,             // GPU time of the named phases of the algorithms
+  METRICS_SINK,            // ring buffer of the per-call counters of the API functions
+  STREAM_PRIORITY,         // quality-of-service lane of the submitted work
 
   LAST_KEY  // reserved for the last key
 };
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/resource_types.hpp>
+#include <raft/core/resources.hpp>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace raft {
+
+/**
+ * @brief The quality-of-service lane of the work submitted with a resources instance.
+ *
+ * The latency-critical work (e.g. the online searches) goes to the `high` lane and the batch work
+ * (e.g. the index builds and extensions running in the background) to the `low` lane; see
+ * `raft::device_resources_manager::get_device_resources(stream_priority, int)`.
+ */
+enum class stream_priority { high, normal, low };
+
+}  // namespace raft
+
+namespace raft::resource {
+
+/**
+ * @defgroup resource_stream_priority Stream priority resource functions
+ * @{
+ */
+
+/** The lane of a resources instance and how its batch work yields to the other lanes. */
+struct stream_priority_settings {
+  stream_priority priority{stream_priority::normal};
+  // The time the `low` lane sleeps at every batch boundary of the long-running algorithms
+  std::chrono::microseconds batch_pause{0};
+};
+
+class stream_priority_resource : public resource {
+ public:
+  stream_priority_resource() : settings_(std::make_shared<stream_priority_settings>()) {}
+  void* get_resource() override { return settings_.get(); }
+
+  ~stream_priority_resource() override = default;
+
+ private:
+  std::shared_ptr<stream_priority_settings> settings_;
+};
+
+/**
+ * Factory that knows how to construct a specific raft::resource to populate
+ * the res_t.
+ */
+class stream_priority_resource_factory : public resource_factory {
+ public:
+  resource_type get_resource_type() override { return resource_type::STREAM_PRIORITY; }
+  resource* make_resource() override { return new stream_priority_resource(); }
+};
+
+/**
+ * Load the stream priority settings of a resources instance (and populate them on the res if
+ * needed).
+ *
+ * @param res raft resources object for managing resources
+ * @return the settings, shared by the copies of the resources instance
+ */
+inline auto get_stream_priority_settings(resources const& res) -> stream_priority_settings&
+{
+  if (!res.has_resource_factory(resource_type::STREAM_PRIORITY)) {
+    res.add_resource_factory(std::make_shared<stream_priority_resource_factory>());
+  }
+  return *res.get_resource<stream_priority_settings>(resource_type::STREAM_PRIORITY);
+};
+
+/**
+ * The lane of a resources instance: `normal` unless set with `set_stream_priority`.
+ *
+ * Note that this is the lane the work is accounted to, not the priority of the stream itself,
+ * which is fixed when the stream is created.
+ *
+ * @param res raft resources object for managing resources
+ */
+inline auto get_stream_priority(resources const& res) -> stream_priority
+{
+  if (!res.has_resource_factory(resource_type::STREAM_PRIORITY)) {
+    return stream_priority::normal;
+  }
+  return get_stream_priority_settings(res).priority;
+}
+
+/**
+ * Set the lane of a resources instance (and of its copies).
+ *
+ * In the `low` lane, the long-running algorithms (e.g. `ivf_pq::extend`, `cagra::build`) drain
+ * their stream at every batch boundary and then give up the host thread for `batch_pause`, so
+ * that they never queue more than one batch of kernels ahead of the latency-critical work.
+ *
+ * @param res raft resources object for managing resources
+ * @param priority the lane
+ * @param batch_pause the pause of the `low` lane at every batch boundary
+ */
+inline void set_stream_priority(resources const& res,
+                                stream_priority priority,
+                                std::chrono::microseconds batch_pause = {})
+{
+  auto& settings       = get_stream_priority_settings(res);
+  settings.priority    = priority;
+  settings.batch_pause = batch_pause;
+}
+
+/**
+ * A batch boundary of the long-running algorithms, where the work of the `low` lane yields to
+ * the other lanes. Does nothing in the other lanes.
+ *
+ * @param res raft resources object for managing resources
+ */
+inline void yield_between_batches(resources const& res)
+{
+  if (get_stream_priority(res) != stream_priority::low) { return; }
+  sync_stream(res);
+  const auto pause = get_stream_priority_settings(res).batch_pause;
+  if (pause.count() > 0) {
+    std::this_thread::sleep_for(pause);
+  } else {
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * @}
+ */
+
+}  // namespace raft::resource
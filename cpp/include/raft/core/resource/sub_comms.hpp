@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,8 +16,178 @@
 #pragma once
 
 #include <raft/core/comms.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/resource_types.hpp>
 #include <raft/core/resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace raft::comms {
+
+/**
+ * @brief A two-level view of a communicator: the ranks of every node (host) form an intra-node
+ * communicator, over which the traffic goes through NVLink / PCIe, and the first rank of every
+ * node (its leader) joins an inter-node communicator.
+ *
+ * The collectives reduce (or gather) within the nodes first, exchange one message per node
+ * across the nodes, and then broadcast within the nodes, so that only the leaders use the
+ * network. The node locality is detected from the host names. `allgather` and `reducescatter`
+ * need the ranks of every node to be contiguous (and the nodes to be of equal size for
+ * `reducescatter`); for other layouts they fall back to the flat collectives.
+ *
+ * The construction is collective over `comms` and creates the sub-communicators with
+ * `comm_split`.
+ */
+class hierarchical_comms {
+ public:
+  hierarchical_comms(const comms_t& comms, cudaStream_t stream) : comms_(comms)
+  {
+    int rank = comms.get_rank();
+    int size = comms.get_size();
+
+    char hostname[HOST_NAME_MAX + 1] = {};
+    RAFT_EXPECTS(gethostname(hostname, HOST_NAME_MAX) == 0, "Failed to get the host name");
+    uint64_t host = std::hash<std::string>{}(std::string(hostname));
+
+    rmm::device_uvector<uint64_t> d_hosts(size, stream);
+    raft::update_device(d_hosts.data() + rank, &host, 1, stream);
+    comms.allgather(d_hosts.data() + rank, d_hosts.data(), 1, stream);
+    std::vector<uint64_t> hosts(size);
+    raft::update_host(hosts.data(), d_hosts.data(), size, stream);
+    comms.sync_stream(stream);
+
+    // the nodes are numbered in the order of their first rank
+    std::vector<int> node_of(size), local_rank_of(size);
+    std::vector<uint64_t> node_hosts;
+    for (int r = 0; r < size; r++) {
+      auto it    = std::find(node_hosts.begin(), node_hosts.end(), hosts[r]);
+      node_of[r] = it - node_hosts.begin();
+      if (it == node_hosts.end()) {
+        node_hosts.push_back(hosts[r]);
+        node_sizes_.push_back(0);
+      }
+      local_rank_of[r] = node_sizes_[node_of[r]]++;
+    }
+    node_offsets_.assign(node_sizes_.size(), 0);
+    for (size_t n = 1; n < node_sizes_.size(); n++) {
+      node_offsets_[n] = node_offsets_[n - 1] + node_sizes_[n - 1];
+    }
+    contiguous_ = true;
+    for (int r = 0; r < size; r++) {
+      contiguous_ = contiguous_ && r == int(node_offsets_[node_of[r]]) + local_rank_of[r];
+    }
+    uniform_ = std::all_of(
+      node_sizes_.begin(), node_sizes_.end(), [&](size_t s) { return s == node_sizes_[0]; });
+    node_ = node_of[rank];
+
+    intra_ = std::make_shared<comms_t>(comms.comm_split(node_of[rank], rank));
+    inter_ = std::make_shared<comms_t>(comms.comm_split(local_rank_of[rank], node_of[rank]));
+  }
+
+  /** The communicator of the ranks of this node */
+  [[nodiscard]] auto intra_node() const -> const comms_t& { return *intra_; }
+
+  /**
+   * The communicator of the ranks with the same local rank on every node; for the leaders
+   * (`is_leader()`), the communicator of the nodes.
+   */
+  [[nodiscard]] auto inter_node() const -> const comms_t& { return *inter_; }
+
+  /** Whether this rank is the first of its node */
+  [[nodiscard]] auto is_leader() const -> bool { return intra_->get_rank() == 0; }
+
+  /** The number of nodes */
+  [[nodiscard]] auto get_n_nodes() const -> int { return node_sizes_.size(); }
+
+  /** The node of this rank */
+  [[nodiscard]] auto get_node() const -> int { return node_; }
+
+  /**
+   * Reduce data arrays of length count in sendbuff and write the result in recvbuff of every
+   * rank: reduced within the nodes to their leaders, across the leaders, and broadcast.
+   */
+  template <typename value_t>
+  void allreduce(
+    const value_t* sendbuff, value_t* recvbuff, size_t count, op_t op, cudaStream_t stream) const
+  {
+    intra_->reduce(sendbuff, recvbuff, count, op, 0, stream);
+    if (is_leader()) { inter_->allreduce(recvbuff, recvbuff, count, op, stream); }
+    intra_->bcast(recvbuff, count, 0, stream);
+  }
+
+  /**
+   * Gathers sendcount elements of every rank into recvbuff of every rank, in the order of the
+   * ranks: gathered within the nodes, exchanged across the leaders and broadcast.
+   */
+  template <typename value_t>
+  void allgather(const value_t* sendbuff,
+                 value_t* recvbuff,
+                 size_t sendcount,
+                 cudaStream_t stream) const
+  {
+    if (!contiguous_) { return comms_.allgather(sendbuff, recvbuff, sendcount, stream); }
+    intra_->allgather(sendbuff, recvbuff + node_offsets_[node_] * sendcount, sendcount, stream);
+    if (is_leader()) {
+      std::vector<size_t> recvcounts(node_sizes_.size()), displs(node_sizes_.size());
+      for (size_t n = 0; n < node_sizes_.size(); n++) {
+        recvcounts[n] = node_sizes_[n] * sendcount;
+        displs[n]     = node_offsets_[n] * sendcount;
+      }
+      inter_->allgatherv(
+        recvbuff + displs[node_], recvbuff, recvcounts.data(), displs.data(), stream);
+    }
+    intra_->bcast(recvbuff, comms_.get_size() * sendcount, 0, stream);
+  }
+
+  /**
+   * Reduces the data arrays of length recvcount * size of every rank and scatters the result,
+   * the block r of recvcount elements to the rank r: reduced within the nodes to their leaders,
+   * reduce-scattered across the leaders by node and broadcast within the nodes.
+   */
+  template <typename value_t>
+  void reducescatter(const value_t* sendbuff,
+                     value_t* recvbuff,
+                     size_t recvcount,
+                     op_t op,
+                     cudaStream_t stream) const
+  {
+    if (!contiguous_ || !uniform_) {
+      return comms_.reducescatter(sendbuff, recvbuff, recvcount, op, stream);
+    }
+    size_t node_count = node_sizes_[node_] * recvcount;
+    rmm::device_uvector<value_t> reduced(is_leader() ? comms_.get_size() * recvcount : 0, stream);
+    rmm::device_uvector<value_t> node_block(node_count, stream);
+    intra_->reduce(sendbuff, reduced.data(), comms_.get_size() * recvcount, op, 0, stream);
+    if (is_leader()) {
+      inter_->reducescatter(reduced.data(), node_block.data(), node_count, op, stream);
+    }
+    intra_->bcast(node_block.data(), node_count, 0, stream);
+    raft::copy(recvbuff, node_block.data() + intra_->get_rank() * recvcount, recvcount, stream);
+  }
+
+ private:
+  const comms_t& comms_;
+  std::shared_ptr<comms_t> intra_;
+  std::shared_ptr<comms_t> inter_;
+  std::vector<size_t> node_sizes_;
+  std::vector<size_t> node_offsets_;
+  bool contiguous_;
+  bool uniform_;
+  int node_;
+};
+
+}  // namespace raft::comms
 
 namespace raft::resource {
 class sub_comms_resource : public resource {
@@ -75,6 +245,62 @@ inline void set_subcomm(resources const& res,
   sub_comms->insert(std::make_pair(key, subcomm));
 }
 
+/**
+ * @}
+ */
+
+class hierarchical_comms_resource : public resource {
+ public:
+  hierarchical_comms_resource() : comms_() {}
+  void* get_resource() override { return &comms_; }
+
+  ~hierarchical_comms_resource() override {}
+
+ private:
+  std::shared_ptr<comms::hierarchical_comms> comms_;
+};
+
+/**
+ * Factory that knows how to construct a
+ * specific raft::resource to populate
+ * the res_t.
+ */
+class hierarchical_comms_resource_factory : public resource_factory {
+ public:
+  resource_type get_resource_type() override { return resource_type::HIER_COMMUNICATOR; }
+  resource* make_resource() override { return new hierarchical_comms_resource(); }
+};
+
+/**
+ * @defgroup resource_hierarchical_comms Hierarchical communicator resource functions
+ * @{
+ */
+
+/**
+ * Builds the hierarchical (intra-node / inter-node) view of the communicator of `res`; this is
+ * collective over that communicator.
+ */
+inline void init_hierarchical_comms(resources const& res)
+{
+  if (!res.has_resource_factory(resource_type::HIER_COMMUNICATOR)) {
+    res.add_resource_factory(std::make_shared<hierarchical_comms_resource_factory>());
+  }
+  auto hier_comms =
+    res.get_resource<std::shared_ptr<comms::hierarchical_comms>>(resource_type::HIER_COMMUNICATOR);
+  *hier_comms = std::make_shared<comms::hierarchical_comms>(get_comms(res), get_cuda_stream(res));
+}
+
+inline const comms::hierarchical_comms& get_hierarchical_comms(resources const& res)
+{
+  RAFT_EXPECTS(res.has_resource_factory(resource_type::HIER_COMMUNICATOR),
+               "ERROR: Hierarchical communicator was not initialized");
+  auto hier_comms =
+    res.get_resource<std::shared_ptr<comms::hierarchical_comms>>(resource_type::HIER_COMMUNICATOR);
+  RAFT_EXPECTS(nullptr != hier_comms->get(),
+               "ERROR: Hierarchical communicator was not initialized");
+  return **hier_comms;
+}
+
 /**
  * @}
  */
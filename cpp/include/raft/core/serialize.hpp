@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <raft/core/detail/chunked_serializer.hpp>
 #include <raft/core/detail/mdspan_numpy_serializer.hpp>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/host_mdspan.hpp>
@@ -23,6 +24,7 @@
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
 
+#include <cstdint>
 #include <iostream>
 #include <vector>
 
@@ -41,28 +43,75 @@ inline void serialize_mdspan(
   detail::numpy_serializer::serialize_host_mdspan(os, obj);
 }
 
+/**
+ * @brief Serialize a device mdspan in the NumPy format, staging it through a few pinned chunks
+ * (the copy of the next chunk overlaps the write of the current one) instead of a full-size host
+ * copy.
+ *
+ * @param[in] handle the raft handle
+ * @param[out] os the output stream
+ * @param[in] obj the row-major or column-major mdspan
+ * @param[out] chunk_checksums the checksums of the chunks of the data are appended to it (to check
+ *   the data when deserializing)
+ * @param[in] chunk_bytes the size of the chunks
+ */
 template <typename ElementType, typename Extents, typename LayoutPolicy, typename AccessorPolicy>
 inline void serialize_mdspan(
   const raft::resources& handle,
   std::ostream& os,
-  const raft::device_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>& obj)
+  const raft::device_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>& obj,
+  std::vector<std::uint64_t>& chunk_checksums,
+  std::size_t chunk_bytes = detail::chunked_serializer::kDefaultChunkBytes)
 {
   static_assert(std::is_same_v<LayoutPolicy, raft::layout_c_contiguous> ||
                   std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>,
                 "The serializer only supports row-major and column-major layouts");
-  using obj_t = raft::device_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>;
+  detail::numpy_serializer::write_header(
+    os, detail::numpy_serializer::make_mdspan_header<ElementType, LayoutPolicy>(obj.extents()));
+  // For contiguous layouts, size() == product of dimensions
+  detail::chunked_serializer::write_device(
+    handle, os, obj.data_handle(), obj.size() * sizeof(ElementType), chunk_bytes, &chunk_checksums);
+}
 
-  // Copy to host before serializing
+template <typename ElementType, typename Extents, typename LayoutPolicy, typename AccessorPolicy>
+inline void serialize_mdspan(
+  const raft::resources& handle,
+  std::ostream& os,
+  const raft::device_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>& obj)
+{
+  static_assert(std::is_same_v<LayoutPolicy, raft::layout_c_contiguous> ||
+                  std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>,
+                "The serializer only supports row-major and column-major layouts");
+  detail::numpy_serializer::write_header(
+    os, detail::numpy_serializer::make_mdspan_header<ElementType, LayoutPolicy>(obj.extents()));
   // For contiguous layouts, size() == product of dimensions
-  std::vector<typename obj_t::value_type> tmp(obj.size());
-  cudaStream_t stream = resource::get_cuda_stream(handle);
-  raft::update_host(tmp.data(), obj.data_handle(), obj.size(), stream);
-  resource::sync_stream(handle);
-  using inner_accessor_type = typename obj_t::accessor_type::accessor_type;
-  auto tmp_mdspan =
-    raft::host_mdspan<ElementType, Extents, LayoutPolicy, raft::host_accessor<inner_accessor_type>>(
-      tmp.data(), obj.extents());
-  detail::numpy_serializer::serialize_host_mdspan(os, tmp_mdspan);
+  detail::chunked_serializer::write_device(
+    handle, os, obj.data_handle(), obj.size() * sizeof(ElementType));
+}
+
+/**
+ * @brief Serialize a strided device matrix whose rows are contiguous (e.g. padded rows) as a
+ * row-major matrix, without the padding, staging the rows through a few pinned chunks.
+ */
+template <typename ElementType, typename Extents, typename AccessorPolicy>
+inline void serialize_mdspan(
+  const raft::resources& handle,
+  std::ostream& os,
+  const raft::device_mdspan<ElementType, Extents, raft::layout_stride, AccessorPolicy>& obj)
+{
+  static_assert(Extents::rank() == 2, "The strided serializer only supports matrices");
+  RAFT_EXPECTS(obj.extent(1) <= 1 || obj.stride(1) == 1,
+               "The strided serializer only supports contiguous rows");
+  detail::numpy_serializer::write_header(
+    os,
+    detail::numpy_serializer::make_mdspan_header<ElementType, raft::layout_c_contiguous>(
+      obj.extents()));
+  detail::chunked_serializer::write_device_rows(handle,
+                                                os,
+                                                obj.data_handle(),
+                                                obj.extent(0),
+                                                obj.extent(1) * sizeof(ElementType),
+                                                obj.stride(0) * sizeof(ElementType));
 }
 
 template <typename ElementType, typename Extents, typename LayoutPolicy, typename AccessorPolicy>
@@ -88,29 +137,49 @@ inline void deserialize_mdspan(
   detail::numpy_serializer::deserialize_host_mdspan(is, obj);
 }
 
+/**
+ * @brief Deserialize a device mdspan in the NumPy format, staging it through a few pinned chunks
+ * (the read of the next chunk overlaps the copy of the current one to the device), and check the
+ * data against the checksums given by serialize_mdspan with the same chunk size.
+ *
+ * @param[in] handle the raft handle
+ * @param[in] is the input stream
+ * @param[out] obj the row-major or column-major mdspan of the serialized extents
+ * @param[in] chunk_checksums the expected checksums of the chunks; none to skip the check
+ * @param[in] chunk_bytes the size of the chunks
+ */
 template <typename ElementType, typename Extents, typename LayoutPolicy, typename AccessorPolicy>
 inline void deserialize_mdspan(
   const raft::resources& handle,
   std::istream& is,
-  raft::device_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>& obj)
+  raft::device_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>& obj,
+  const std::vector<std::uint64_t>& chunk_checksums,
+  std::size_t chunk_bytes = detail::chunked_serializer::kDefaultChunkBytes)
 {
   static_assert(std::is_same_v<LayoutPolicy, raft::layout_c_contiguous> ||
                   std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>,
                 "The serializer only supports row-major and column-major layouts");
-  using obj_t = raft::device_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>;
-
-  // Copy to device after serializing
+  detail::numpy_serializer::check_mdspan_header<ElementType, LayoutPolicy>(
+    detail::numpy_serializer::read_header(is), obj.extents());
   // For contiguous layouts, size() == product of dimensions
-  std::vector<typename obj_t::value_type> tmp(obj.size());
-  using inner_accessor_type = typename obj_t::accessor_type::accessor_type;
-  auto tmp_mdspan =
-    raft::host_mdspan<ElementType, Extents, LayoutPolicy, raft::host_accessor<inner_accessor_type>>(
-      tmp.data(), obj.extents());
-  detail::numpy_serializer::deserialize_host_mdspan(is, tmp_mdspan);
+  detail::chunked_serializer::read_device(
+    handle, is, obj.data_handle(), obj.size() * sizeof(ElementType), chunk_bytes, &chunk_checksums);
+}
 
-  cudaStream_t stream = resource::get_cuda_stream(handle);
-  raft::update_device(obj.data_handle(), tmp.data(), obj.size(), stream);
-  resource::sync_stream(handle);
+template <typename ElementType, typename Extents, typename LayoutPolicy, typename AccessorPolicy>
+inline void deserialize_mdspan(
+  const raft::resources& handle,
+  std::istream& is,
+  raft::device_mdspan<ElementType, Extents, LayoutPolicy, AccessorPolicy>& obj)
+{
+  static_assert(std::is_same_v<LayoutPolicy, raft::layout_c_contiguous> ||
+                  std::is_same_v<LayoutPolicy, raft::layout_f_contiguous>,
+                "The serializer only supports row-major and column-major layouts");
+  detail::numpy_serializer::check_mdspan_header<ElementType, LayoutPolicy>(
+    detail::numpy_serializer::read_header(is), obj.extents());
+  // For contiguous layouts, size() == product of dimensions
+  detail::chunked_serializer::read_device(
+    handle, is, obj.data_handle(), obj.size() * sizeof(ElementType));
 }
 
 template <typename ElementType, typename Extents, typename LayoutPolicy, typename AccessorPolicy>
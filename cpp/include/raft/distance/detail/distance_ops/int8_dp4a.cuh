@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/util/cuda_dev_essentials.cuh>  // DI
+
+#include <cstdint>
+
+namespace raft::distance::detail::ops {
+
+/** The dot product of two words of four packed int8 values, added to `acc`. */
+DI int32_t dot_int8x4(int32_t x, int32_t y, int32_t acc)
+{
+#if __CUDA_ARCH__ >= 610
+  return __dp4a(x, y, acc);
+#else
+#pragma unroll
+  for (int i = 0; i < 32; i += 8) {
+    acc += int32_t(int8_t(x >> i)) * int32_t(int8_t(y >> i));
+  }
+  return acc;
+#endif
+}
+
+/**
+ * @brief the expanded euclidean distance matrix calculation over int8 inputs
+ *
+ * Every element of the inputs packs four int8 values, and the norms hold the squared L2 norms
+ * of the rows. The whole computation is exact in int32:
+ *
+ *   c_ij = ||x_i||^2 + ||y_j||^2 - 2 sum_k x_ik * y_jk
+ */
+template <typename DataType, typename AccType, typename IdxType>
+struct int8_l2_exp_distance_op {
+  using DataT = DataType;
+  using AccT  = AccType;
+  using IdxT  = IdxType;
+
+  // Load norms of input data
+  static constexpr bool use_norms = true;
+  // Whether the core function requires so many instructions that it makes sense
+  // to reduce loop unrolling, etc. We do this to keep compile times in check.
+  static constexpr bool expensive_inner_loop = false;
+
+  // Size of shared memory. This is normally decided by the kernel policy, but
+  // some ops such as correlation_distance_op use more.
+  template <typename Policy>
+  static constexpr size_t shared_mem_size()
+  {
+    return Policy::SmemSize + ((Policy::Mblk + Policy::Nblk) * sizeof(DataT));
+  }
+
+  DI void core(AccT& acc, DataT& x, DataT& y) const { acc = dot_int8x4(x, y, acc); };
+
+  template <typename Policy>
+  DI void epilog(AccT acc[Policy::AccRowsPerTh][Policy::AccColsPerTh],
+                 DataT* regxn,
+                 DataT* regyn,
+                 IdxT gridStrideX,
+                 IdxT gridStrideY) const
+  {
+#pragma unroll
+    for (int i = 0; i < Policy::AccRowsPerTh; ++i) {
+#pragma unroll
+      for (int j = 0; j < Policy::AccColsPerTh; ++j) {
+        acc[i][j] = regxn[i] + regyn[j] - 2 * acc[i][j];
+      }
+    }
+  }
+};
+
+/**
+ * @brief the inner product matrix calculation over int8 inputs
+ *
+ * Every element of the inputs packs four int8 values:
+ *
+ *   c_ij = sum_k x_ik * y_jk
+ */
+template <typename DataType, typename AccType, typename IdxType>
+struct int8_inner_product_op {
+  using DataT = DataType;
+  using AccT  = AccType;
+  using IdxT  = IdxType;
+
+  // Load norms of input data
+  static constexpr bool use_norms = false;
+  // Whether the core function requires so many instructions that it makes sense
+  // to reduce loop unrolling, etc. We do this to keep compile times in check.
+  static constexpr bool expensive_inner_loop = false;
+
+  // Size of shared memory. This is normally decided by the kernel policy, but
+  // some ops such as correlation_distance_op use more.
+  template <typename Policy>
+  static constexpr size_t shared_mem_size()
+  {
+    return Policy::SmemSize;
+  }
+
+  DI void core(AccT& acc, DataT& x, DataT& y) const { acc = dot_int8x4(x, y, acc); };
+
+  template <typename Policy>
+  DI void epilog(AccT acc[Policy::AccRowsPerTh][Policy::AccColsPerTh],
+                 DataT* regxn,
+                 DataT* regyn,
+                 IdxT gridStrideX,
+                 IdxT gridStrideY) const
+  {
+    return;
+  }
+};
+
+}  // namespace raft::distance::detail::ops
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -86,6 +86,59 @@ struct MinReduceOpImpl {
   DI void init(DataT* out, DataT maxVal) { *out = maxVal; }
 };
 
+/**
+ * The minimum reduction of `MinAndDistanceReduceOpImpl` skipping the keys already selected for the
+ * row, i.e. the `n_selected` leading neighbors of the row in `selected` [m, ld]. This lets the
+ * fused kernel find the next nearest neighbor without materializing the distances.
+ */
+template <typename LabelT, typename DataT>
+struct MinAndDistanceExcludeReduceOpImpl : public MinAndDistanceReduceOpImpl<LabelT, DataT> {
+  typedef typename raft::KeyValuePair<LabelT, DataT> KVP;
+  const KVP* selected = nullptr;
+  LabelT m            = 0;
+  int ld              = 0;
+  int n_selected      = 0;
+
+  MinAndDistanceExcludeReduceOpImpl() = default;
+  MinAndDistanceExcludeReduceOpImpl(const KVP* selected, LabelT m, int ld, int n_selected)
+    : selected(selected), m(m), ld(ld), n_selected(n_selected)
+  {
+  }
+
+  DI bool is_selected(LabelT rid, LabelT key) const
+  {
+    // The rows past `m` may be visited by the incomplete tiles.
+    if (rid >= m) { return false; }
+    const KVP* row = selected + static_cast<size_t>(rid) * ld;
+    for (int j = 0; j < n_selected; j++) {
+      if (row[j].key == key) { return true; }
+    }
+    return false;
+  }
+
+  using MinAndDistanceReduceOpImpl<LabelT, DataT>::operator();
+  DI void operator()(LabelT rid, KVP* out, const KVP& other) const
+  {
+    if (other.value < out->value && !is_selected(rid, other.key)) {
+      out->key   = other.key;
+      out->value = other.value;
+    }
+  }
+};
+
+/** The key-value pair counterpart of `MinAndDistanceExcludeReduceOpImpl`. */
+template <typename LabelT, typename DataT>
+struct KVPMinExcludeReduceImpl {
+  typedef raft::KeyValuePair<LabelT, DataT> KVP;
+  MinAndDistanceExcludeReduceOpImpl<LabelT, DataT> exclude;
+
+  DI KVP operator()(LabelT rit, const KVP& a, const KVP& b)
+  {
+    return b.value < a.value || exclude.is_selected(rit, a.key) ? b : a;
+  }
+  DI KVP operator()(const KVP& a, const KVP& b) { return b.value < a.value ? b : a; }
+};
+
 template <typename DataT, typename OutT, typename IdxT, typename ReduceOpT>
 RAFT_KERNEL initKernel(OutT* min, IdxT m, DataT maxVal, ReduceOpT redOp)
 {
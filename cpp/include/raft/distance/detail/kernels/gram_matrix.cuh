@@ -25,8 +25,17 @@
 #include <raft/sparse/distance/distance.cuh>
 #include <raft/sparse/linalg/spmm.hpp>
 
+#include <raft/core/resource/cublas_handle.hpp>
 #include <raft/linalg/detail/cublas_wrappers.hpp>
 #include <raft/linalg/gemm.cuh>
+#include <raft/linalg/map.cuh>
+#include <raft/linalg/norm.cuh>
+#include <raft/sparse/linalg/norm.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
 
 namespace raft::distance::kernels::detail {
 
@@ -122,6 +131,86 @@ class GramMatrixBase {
     evaluate(handle, x1, x2, out, norm_x1, norm_x2);
   }
 
+  /** The default bound of the number of elements of a tile in `evaluate_times_vector`. */
+  static constexpr size_t kTimesVectorTileElements = size_t(1) << 22;
+
+  /** Evaluate the product of the Gram matrix of two vector sets with a vector,
+   *  out = K(x1, x2) * alpha, without materializing the Gram matrix.
+   *
+   *  The Gram matrix is evaluated tile by tile (of at most max_tile_elements elements) and every
+   *  tile is reduced against alpha right away, so the temporary memory is O(max_tile_elements)
+   *  instead of O(n1 * n2); e.g. the decision function of an SVM, with the support vectors in x2
+   *  and the dual coefficients in alpha.
+   *
+   * @param [in] handle raft handle
+   * @param [in] x1 dense device matrix view, size [n1*n_cols]
+   * @param [in] x2 dense device matrix view, size [n2*n_cols]
+   * @param [in] alpha dense device vector view, size [n2]
+   * @param [out] out dense device vector view, size [n1]
+   * @param norm_x1 optional L2-norm of x1's rows for computation within RBF.
+   * @param norm_x2 optional L2-norm of x2's rows for computation within RBF.
+   * @param max_tile_elements the bound of the number of elements of a tile of the Gram matrix
+   */
+  void evaluate_times_vector(raft::resources const& handle,
+                             dense_input_matrix_view_t<math_t> x1,
+                             dense_input_matrix_view_t<math_t> x2,
+                             raft::device_vector_view<const math_t, int> alpha,
+                             raft::device_vector_view<math_t, int> out,
+                             math_t* norm_x1          = nullptr,
+                             math_t* norm_x2          = nullptr,
+                             size_t max_tile_elements = kTimesVectorTileElements)
+  {
+    times_vector(handle, x1, x2, alpha, out, norm_x1, norm_x2, max_tile_elements);
+  }
+
+  /** Evaluate the product of the Gram matrix of two vector sets with a vector,
+   *  out = K(x1, x2) * alpha, without materializing the Gram matrix.
+   *
+   * @param [in] handle raft handle
+   * @param [in] x1 csr device matrix view, size [n1*n_cols]
+   * @param [in] x2 dense device matrix view, size [n2*n_cols]
+   * @param [in] alpha dense device vector view, size [n2]
+   * @param [out] out dense device vector view, size [n1]
+   * @param norm_x1 optional L2-norm of x1's rows for computation within RBF.
+   * @param norm_x2 optional L2-norm of x2's rows for computation within RBF.
+   * @param max_tile_elements the bound of the number of elements of a tile of the Gram matrix
+   */
+  void evaluate_times_vector(raft::resources const& handle,
+                             csr_input_matrix_view_t<math_t> x1,
+                             dense_input_matrix_view_t<math_t> x2,
+                             raft::device_vector_view<const math_t, int> alpha,
+                             raft::device_vector_view<math_t, int> out,
+                             math_t* norm_x1          = nullptr,
+                             math_t* norm_x2          = nullptr,
+                             size_t max_tile_elements = kTimesVectorTileElements)
+  {
+    times_vector(handle, x1, x2, alpha, out, norm_x1, norm_x2, max_tile_elements);
+  }
+
+  /** Evaluate the product of the Gram matrix of two vector sets with a vector,
+   *  out = K(x1, x2) * alpha, without materializing the Gram matrix.
+   *
+   * @param [in] handle raft handle
+   * @param [in] x1 csr device matrix view, size [n1*n_cols]
+   * @param [in] x2 csr device matrix view, size [n2*n_cols]
+   * @param [in] alpha dense device vector view, size [n2]
+   * @param [out] out dense device vector view, size [n1]
+   * @param norm_x1 optional L2-norm of x1's rows for computation within RBF.
+   * @param norm_x2 optional L2-norm of x2's rows for computation within RBF.
+   * @param max_tile_elements the bound of the number of elements of a tile of the Gram matrix
+   */
+  void evaluate_times_vector(raft::resources const& handle,
+                             csr_input_matrix_view_t<math_t> x1,
+                             csr_input_matrix_view_t<math_t> x2,
+                             raft::device_vector_view<const math_t, int> alpha,
+                             raft::device_vector_view<math_t, int> out,
+                             math_t* norm_x1          = nullptr,
+                             math_t* norm_x2          = nullptr,
+                             size_t max_tile_elements = kTimesVectorTileElements)
+  {
+    times_vector(handle, x1, x2, alpha, out, norm_x1, norm_x2, max_tile_elements);
+  }
+
   // unfortunately, 'evaluate' cannot be templatized as it needs to be virtual
 
   /** Evaluate the Gram matrix for two vector sets using simple dot product.
@@ -315,6 +404,174 @@ class GramMatrixBase {
   }
 
  protected:
+  /** Whether the kernel is a function of the L2-norms of the rows (e.g. RBF), which
+   *  `evaluate_times_vector` then computes once for the whole vector sets if not given. */
+  virtual bool uses_row_norms() const { return false; }
+
+  int get_n_rows(dense_input_matrix_view_t<math_t> matrix) { return matrix.extent(0); }
+
+  int get_n_rows(csr_input_matrix_view_t<math_t> matrix)
+  {
+    return matrix.structure_view().get_n_rows();
+  }
+
+  /** The (squared) L2-norms of the rows of a dense matrix without padding. */
+  void row_norms_l2(raft::resources const& handle,
+                    dense_input_matrix_view_t<math_t> matrix,
+                    math_t* target)
+  {
+    bool is_row_major = get_is_row_major(matrix);
+    int minor         = is_row_major ? matrix.extent(1) : matrix.extent(0);
+    int ld            = is_row_major ? matrix.stride(0) : matrix.stride(1);
+    ASSERT(ld == minor, "GramMatrix rowNorm compute does not support ld parameter");
+    raft::linalg::rowNorm(target,
+                          matrix.data_handle(),
+                          matrix.extent(1),
+                          matrix.extent(0),
+                          raft::linalg::NormType::L2Norm,
+                          is_row_major,
+                          resource::get_cuda_stream(handle));
+  }
+
+  /** The (squared) L2-norms of the rows of a csr matrix. */
+  void row_norms_l2(raft::resources const& handle,
+                    csr_input_matrix_view_t<math_t> matrix,
+                    math_t* target)
+  {
+    auto matrix_structure = matrix.structure_view();
+    raft::sparse::linalg::rowNormCsr(handle,
+                                     matrix_structure.get_indptr().data(),
+                                     matrix.get_elements().data(),
+                                     matrix_structure.get_nnz(),
+                                     matrix_structure.get_n_rows(),
+                                     target,
+                                     raft::linalg::NormType::L2Norm);
+  }
+
+  /** The rows [row, row + n_rows) of a dense matrix, with the same strides. */
+  dense_input_matrix_view_t<math_t> slice_rows(raft::resources const&,
+                                               dense_input_matrix_view_t<math_t> matrix,
+                                               int row,
+                                               int n_rows,
+                                               rmm::device_uvector<int>&)
+  {
+    auto layout = raft::make_strided_layout(
+      raft::matrix_extent<int>{n_rows, matrix.extent(1)},
+      std::array<int, 2>{int(matrix.stride(0)), int(matrix.stride(1))});
+    return dense_input_matrix_view_t<math_t>{
+      matrix.data_handle() + size_t(row) * matrix.stride(0), layout};
+  }
+
+  /** The rows [row, row + n_rows) of a csr matrix; the offsets of the rows are rebased into
+   *  `indptr` [n_rows + 1]. */
+  csr_input_matrix_view_t<math_t> slice_rows(raft::resources const& handle,
+                                             csr_input_matrix_view_t<math_t> matrix,
+                                             int row,
+                                             int n_rows,
+                                             rmm::device_uvector<int>& indptr)
+  {
+    auto stream           = resource::get_cuda_stream(handle);
+    auto matrix_structure = matrix.structure_view();
+    const int* src        = matrix_structure.get_indptr().data() + row;
+    int bounds[2];
+    raft::update_host(bounds, src, 1, stream);
+    raft::update_host(bounds + 1, src + n_rows, 1, stream);
+    indptr.resize(n_rows + 1, stream);
+    raft::linalg::map_offset(handle,
+                             raft::make_device_vector_view<int, int>(indptr.data(), n_rows + 1),
+                             [src] __device__(int i) { return src[i] - src[0]; });
+    resource::sync_stream(handle, stream);
+    int nnz        = bounds[1] - bounds[0];
+    auto structure = raft::make_device_compressed_structure_view<int, int, int>(
+      indptr.data(),
+      matrix_structure.get_indices().data() + bounds[0],
+      n_rows,
+      matrix_structure.get_n_cols(),
+      nnz);
+    return raft::make_device_csr_matrix_view<const math_t, int, int, int>(
+      matrix.get_elements().data() + bounds[0], structure);
+  }
+
+  bool get_is_row_major(csr_input_matrix_view_t<math_t>) { return true; }
+
+  /** Tiled evaluation of out = K(x1, x2) * alpha, see `evaluate_times_vector`. */
+  template <typename x1_view_t, typename x2_view_t>
+  void times_vector(raft::resources const& handle,
+                    x1_view_t x1,
+                    x2_view_t x2,
+                    raft::device_vector_view<const math_t, int> alpha,
+                    raft::device_vector_view<math_t, int> out,
+                    math_t* norm_x1,
+                    math_t* norm_x2,
+                    size_t max_tile_elements)
+  {
+    cudaStream_t stream = resource::get_cuda_stream(handle);
+    int n1              = get_n_rows(x1);
+    int n2              = get_n_rows(x2);
+    ASSERT(alpha.extent(0) == n2, "GramMatrix alpha must have as many elements as x2 rows");
+    ASSERT(out.extent(0) == n1, "GramMatrix out must have as many elements as x1 rows");
+    RAFT_CUDA_TRY(cudaMemsetAsync(out.data_handle(), 0, n1 * sizeof(math_t), stream));
+    if (n1 == 0 || n2 == 0) { return; }
+
+    // the norms of the whole vector sets, once for all the tiles
+    rmm::device_uvector<math_t> tmp_norm_x1(0, stream);
+    rmm::device_uvector<math_t> tmp_norm_x2(0, stream);
+    if (uses_row_norms() && norm_x1 == nullptr) {
+      tmp_norm_x1.resize(n1, stream);
+      norm_x1 = tmp_norm_x1.data();
+      row_norms_l2(handle, x1, norm_x1);
+    }
+    if (uses_row_norms() && norm_x2 == nullptr) {
+      tmp_norm_x2.resize(n2, stream);
+      norm_x2 = tmp_norm_x2.data();
+      row_norms_l2(handle, x2, norm_x2);
+    }
+
+    // the tiles have the layout of the (dense) inputs
+    bool is_row_major = get_is_row_major(x1) && get_is_row_major(x2);
+    size_t max_tile   = std::max<size_t>(max_tile_elements, 1);
+    int tile2         = int(std::min<size_t>(n2, max_tile));
+    int tile1         = int(std::min<size_t>(n1, std::max<size_t>(max_tile / tile2, 1)));
+    rmm::device_uvector<math_t> tile(size_t(tile1) * tile2, stream);
+    rmm::device_uvector<int> indptr1(0, stream);
+    rmm::device_uvector<int> indptr2(0, stream);
+
+    const math_t one = 1;
+    for (int r2 = 0; r2 < n2; r2 += tile2) {
+      int c2       = std::min(tile2, n2 - r2);
+      auto x2_tile = slice_rows(handle, x2, r2, c2, indptr2);
+      for (int r1 = 0; r1 < n1; r1 += tile1) {
+        int c1        = std::min(tile1, n1 - r1);
+        auto x1_tile  = slice_rows(handle, x1, r1, c1, indptr1);
+        auto out_tile = is_row_major
+                          ? raft::make_device_strided_matrix_view<math_t, int, layout_c_contiguous>(
+                              tile.data(), c1, c2, 0)
+                          : raft::make_device_strided_matrix_view<math_t, int, layout_f_contiguous>(
+                              tile.data(), c1, c2, 0);
+        evaluate(handle,
+                 x1_tile,
+                 x2_tile,
+                 out_tile,
+                 norm_x1 == nullptr ? nullptr : norm_x1 + r1,
+                 norm_x2 == nullptr ? nullptr : norm_x2 + r2);
+        // out[r1:] += tile * alpha[r2:]; a row-major tile is the column-major transposed one
+        RAFT_CUBLAS_TRY(raft::linalg::detail::cublasgemv(resource::get_cublas_handle(handle),
+                                                         is_row_major ? CUBLAS_OP_T : CUBLAS_OP_N,
+                                                         is_row_major ? c2 : c1,
+                                                         is_row_major ? c1 : c2,
+                                                         &one,
+                                                         tile.data(),
+                                                         is_row_major ? c2 : c1,
+                                                         alpha.data_handle() + r2,
+                                                         1,
+                                                         &one,
+                                                         out.data_handle() + r1,
+                                                         1,
+                                                         stream));
+      }
+    }
+  }
+
   bool get_is_row_major(dense_output_matrix_view_t<math_t> matrix)
   {
     return (matrix.stride(1) == 1);
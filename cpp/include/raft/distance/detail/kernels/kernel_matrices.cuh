@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -515,6 +515,9 @@ class RBFKernel : public GramMatrixBase<math_t> {
       inout, ld, n1, n2, norm_n1, norm_n2, gain);
   }
 
+ protected:
+  bool uses_row_norms() const override { return true; }
+
  public:
   /**
    * Constructs a RBF kernel object.
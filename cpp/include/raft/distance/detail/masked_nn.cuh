@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -24,6 +24,7 @@
 #include <raft/distance/detail/compress_to_bits.cuh>
 #include <raft/distance/detail/fused_l2_nn.cuh>
 #include <raft/distance/detail/masked_distance_base.cuh>
+#include <raft/distance/distance_types.hpp>
 #include <raft/linalg/contractions.cuh>
 #include <raft/util/cuda_utils.cuh>
 #include <rmm/device_uvector.hpp>
@@ -32,32 +33,78 @@ namespace raft {
 namespace distance {
 namespace detail {
 
+/**
+ * @defgroup masked_nn_epilogue The distances of the masked nearest neighbors
+ *
+ * The distances are computed in the epilogue from the inner product `ip` of the rows of `x` and
+ * `y` and from their norms `xn`, `yn` (`use_norms` tells whether the norms are needed). The
+ * distances are minimized, so that the similarities are negated or subtracted from one.
+ * @{
+ */
+
+/** The L2 distance; `xn`, `yn` are the squared L2 norms. */
+template <typename DataT>
+struct masked_l2_epilogue {
+  static constexpr bool use_norms = true;
+  /** Whether to compute the actual (i.e. sqrt) L2 distance */
+  bool sqrt;
+
+  DI auto operator()(DataT ip, DataT xn, DataT yn) const -> DataT
+  {
+    const DataT d = xn + yn - DataT(2) * ip;
+    return sqrt ? raft::sqrt(d) : d;
+  }
+};
+
+/** The negated inner product, so that the nearest neighbor has the largest inner product. */
+template <typename DataT>
+struct masked_inner_product_epilogue {
+  static constexpr bool use_norms = false;
+
+  DI auto operator()(DataT ip, DataT, DataT) const -> DataT { return -ip; }
+};
+
+/** The cosine distance `1 - cos(x, y)`; `xn`, `yn` are the L2 norms (zero rows are at 1). */
+template <typename DataT>
+struct masked_cosine_epilogue {
+  static constexpr bool use_norms = true;
+
+  DI auto operator()(DataT ip, DataT xn, DataT yn) const -> DataT
+  {
+    const DataT norms = xn * yn;
+    return norms > DataT(0) ? DataT(1) - ip / norms : DataT(1);
+  }
+};
+
+/** @} */
+
 template <typename DataT,
           typename OutT,
           typename IdxT,
           typename P,
           typename ReduceOpT,
           typename KVPReduceOpT,
+          typename EpilogueT,
           typename CoreLambda,
           typename FinalLambda>
-__launch_bounds__(P::Nthreads, 2) RAFT_KERNEL masked_l2_nn_kernel(OutT* min,
-                                                                  const DataT* x,
-                                                                  const DataT* y,
-                                                                  const DataT* xn,
-                                                                  const DataT* yn,
-                                                                  const uint64_t* adj,
-                                                                  const IdxT* group_idxs,
-                                                                  IdxT num_groups,
-                                                                  IdxT m,
-                                                                  IdxT n,
-                                                                  IdxT k,
-                                                                  bool sqrt,
-                                                                  DataT maxVal,
-                                                                  int* mutex,
-                                                                  ReduceOpT redOp,
-                                                                  KVPReduceOpT pairRedOp,
-                                                                  CoreLambda core_op,
-                                                                  FinalLambda fin_op)
+__launch_bounds__(P::Nthreads, 2) RAFT_KERNEL masked_nn_kernel(OutT* min,
+                                                               const DataT* x,
+                                                               const DataT* y,
+                                                               const DataT* xn,
+                                                               const DataT* yn,
+                                                               const uint64_t* adj,
+                                                               const IdxT* group_idxs,
+                                                               IdxT num_groups,
+                                                               IdxT m,
+                                                               IdxT n,
+                                                               IdxT k,
+                                                               EpilogueT epilogue,
+                                                               DataT maxVal,
+                                                               int* mutex,
+                                                               ReduceOpT redOp,
+                                                               KVPReduceOpT pairRedOp,
+                                                               CoreLambda core_op,
+                                                               FinalLambda fin_op)
 {
   extern __shared__ char smem[];
 
@@ -69,7 +116,7 @@ __launch_bounds__(P::Nthreads, 2) RAFT_KERNEL masked_l2_nn_kernel(OutT* min,
   }
 
   // epilogue operation lambda for final value calculation
-  auto epilog_lambda = [pairRedOp, &val, maxVal, sqrt] __device__(
+  auto epilog_lambda = [pairRedOp, &val, maxVal, epilogue] __device__(
                          DataT acc[P::AccRowsPerTh][P::AccColsPerTh],
                          int thread_adj,
                          DataT* regxn,
@@ -83,15 +130,10 @@ __launch_bounds__(P::Nthreads, 2) RAFT_KERNEL masked_l2_nn_kernel(OutT* min,
     for (int i = 0; i < P::AccRowsPerTh; ++i) {
 #pragma unroll
       for (int j = 0; j < P::AccColsPerTh; ++j) {
-        acc[i][j] = regxn[i] + regyn[j] - (DataT)2.0 * acc[i][j];
-      }
-    }
-    if (sqrt) {
-#pragma unroll
-      for (int i = 0; i < P::AccRowsPerTh; ++i) {
-#pragma unroll
-        for (int j = 0; j < P::AccColsPerTh; ++j) {
-          acc[i][j] = raft::sqrt(acc[i][j]);
+        if constexpr (EpilogueT::use_norms) {
+          acc[i][j] = epilogue(acc[i][j], regxn[i], regyn[j]);
+        } else {
+          acc[i][j] = epilogue(acc[i][j], DataT(0), DataT(0));
         }
       }
     }
@@ -151,7 +193,7 @@ __launch_bounds__(P::Nthreads, 2) RAFT_KERNEL masked_l2_nn_kernel(OutT* min,
     };
 
   IdxT lda = k, ldb = k, ldd = n;
-  MaskedDistances<true,
+  MaskedDistances<EpilogueT::use_norms,
                   DataT,
                   DataT,
                   IdxT,
@@ -183,15 +225,13 @@ __launch_bounds__(P::Nthreads, 2) RAFT_KERNEL masked_l2_nn_kernel(OutT* min,
 }
 
 /**
- * @brief Wrapper for masked_l2_nn_kernel
+ * @brief Wrapper for masked_nn_kernel
  *
  * Responsibilities:
- * - Allocate (and initialize) workspace memory for:
- *   - mutexes used in nearest neighbor update step
- *   - adjacency matrix bitfield
- * - Compress adjacency matrix to bitfield
+ * - Allocate (and initialize) workspace memory for the mutexes used in nearest neighbor update
+ *   step
  * - Initialize output buffer (conditional on `initOutBuffer`)
- * - Specify core and final operations for the L2 norm
+ * - Specify core and final operations for the inner product
  * - Determine optimal launch configuration for kernel.
  * - Launch kernel and check for errors.
  *
@@ -203,76 +243,64 @@ __launch_bounds__(P::Nthreads, 2) RAFT_KERNEL masked_l2_nn_kernel(OutT* min,
  *                       elements with the appropriate initial value needed for
  *                       reduction.
  * @tparam KVPReduceOpT  Type of Reduction operation on key value pairs.
+ * @tparam EpilogueT     The distance computed from the inner products (see masked_nn_epilogue).
  *
  * @param      handle            RAFT handle for managing expensive resources
  * @param[out] out               Will contain reduced output (nn key-value pairs)
  * @param[in]  x                 First matrix. Row major. Dim = `m x k`. (on device)
  * @param[in]  y                 Second matrix. Row major. Dim = `n x k`. (on device)
- * @param[in]  xn                L2 squared norm of `x`. Length = `m`.
- * @param[in]  yn                L2 squared norm of `y`. Length = `n`.
- * @param[in]  adj           A boolean adjacency matrix indicating for each
- *                           row of `x` and each group in `y` whether to compute the
- *                           distance. Dim = `m x num_groups`.
+ * @param[in]  xn                Norms of `x` as required by `EpilogueT`. Length = `m`.
+ * @param[in]  yn                Norms of `y` as required by `EpilogueT`. Length = `n`.
+ * @param[in]  adj64         The adjacency bitfield: bit `i % 64` of `adj64[i / 64, j]` indicates
+ *                           whether to compute the distances between row `i` of `x` and group
+ *                           `j` in `y`. Dim = `ceildiv(m, 64) x num_groups`.
  * @param[in]  group_idxs    An array containing the *end* indices of each group
- *                           in `y`. The value of group_idxs[j] indicates the
- *                           start of group j + 1, i.e., it is the inclusive
- *                           scan of the group lengths. The first group is
- *                           always assumed to start at index 0 and the last
- *                           group typically ends at index `n`. Length =
- *                           `num_groups`.
+ *                           in `y`. Length = `num_groups`.
  * @param[in]  num_groups    Length of `group_idxs`.
  * @param      m             Rows of `x`.
  * @param      n             Rows of `y`.
  * @param      k             Cols of `x` and `y`.
  * @param      redOp         Reduction operator in the epilogue
  * @param      pairRedOp     Reduction operation on key value pairs
- * @param      sqrt          Whether to compute the squared or actual (i.e. sqrt) L2 norm.
+ * @param      epilogue      The distance computed from the inner products.
  * @param      initOutBuffer Whether to initialize the output buffer
- *
- *
  */
-template <typename DataT, typename OutT, typename IdxT, typename ReduceOpT, typename KVPReduceOpT>
-void masked_l2_nn_impl(raft::resources const& handle,
-                       OutT* out,
-                       const DataT* x,
-                       const DataT* y,
-                       const DataT* xn,
-                       const DataT* yn,
-                       const bool* adj,
-                       const IdxT* group_idxs,
-                       IdxT num_groups,
-                       IdxT m,
-                       IdxT n,
-                       IdxT k,
-                       ReduceOpT redOp,
-                       KVPReduceOpT pairRedOp,
-                       bool sqrt,
-                       bool initOutBuffer)
+template <typename DataT,
+          typename OutT,
+          typename IdxT,
+          typename ReduceOpT,
+          typename KVPReduceOpT,
+          typename EpilogueT>
+void masked_nn_launch(raft::resources const& handle,
+                      OutT* out,
+                      const DataT* x,
+                      const DataT* y,
+                      const DataT* xn,
+                      const DataT* yn,
+                      const uint64_t* adj64,
+                      const IdxT* group_idxs,
+                      IdxT num_groups,
+                      IdxT m,
+                      IdxT n,
+                      IdxT k,
+                      ReduceOpT redOp,
+                      KVPReduceOpT pairRedOp,
+                      EpilogueT epilogue,
+                      bool initOutBuffer)
 {
   typedef typename linalg::Policy4x4<DataT, 1>::Policy P;
 
-  static_assert(P::Mblk == 64, "masked_l2_nn_impl only supports a policy with 64 rows per block.");
+  static_assert(P::Mblk == 64, "masked_nn_launch only supports a policy with 64 rows per block.");
 
   // Get stream and workspace memory resource
   rmm::mr::device_memory_resource* ws_mr =
     dynamic_cast<rmm::mr::device_memory_resource*>(resource::get_workspace_resource(handle));
   auto stream = resource::get_cuda_stream(handle);
 
-  // Acquire temporary buffers and initialize to zero:
-  // 1) Adjacency matrix bitfield
-  // 2) Workspace for fused nearest neighbor operation
-  size_t m_div_64 = raft::ceildiv(m, IdxT(64));
-  rmm::device_uvector<uint64_t> ws_adj64{m_div_64 * num_groups, stream, ws_mr};
+  // Acquire the workspace for fused nearest neighbor operation and initialize it to zero.
   rmm::device_uvector<int> ws_fused_nn{size_t(m), stream, ws_mr};
-  RAFT_CUDA_TRY(cudaMemsetAsync(ws_adj64.data(), 0, ws_adj64.size() * sizeof(uint64_t), stream));
   RAFT_CUDA_TRY(cudaMemsetAsync(ws_fused_nn.data(), 0, ws_fused_nn.size() * sizeof(int), stream));
 
-  // Compress boolean adjacency matrix to bitfield.
-  auto adj_view = raft::make_device_matrix_view<const bool, int>(adj, m, num_groups);
-  auto adj64_view =
-    raft::make_device_matrix_view<uint64_t, int>(ws_adj64.data(), m_div_64, num_groups);
-  compress_to_bits(handle, adj_view, adj64_view);
-
   // Initialize output buffer with keyvalue pairs as determined by the reduction
   // operator (it will be called with maxVal).
   constexpr auto maxVal = std::numeric_limits<DataT>::max();
@@ -288,14 +316,15 @@ void masked_l2_nn_impl(raft::resources const& handle,
   auto core_lambda = [] __device__(DataT & acc, DataT & x, DataT & y) { acc += x * y; };
   auto fin_op      = raft::identity_op{};
 
-  auto kernel               = masked_l2_nn_kernel<DataT,
-                                    OutT,
-                                    IdxT,
-                                    P,
-                                    ReduceOpT,
-                                    KVPReduceOpT,
-                                    decltype(core_lambda),
-                                    decltype(fin_op)>;
+  auto kernel               = masked_nn_kernel<DataT,
+                                 OutT,
+                                 IdxT,
+                                 P,
+                                 ReduceOpT,
+                                 KVPReduceOpT,
+                                 EpilogueT,
+                                 decltype(core_lambda),
+                                 decltype(fin_op)>;
   constexpr size_t smemSize = P::SmemSize + ((P::Mblk + P::Nblk) * sizeof(DataT));
   dim3 block(P::Nthreads);
   dim3 grid = launchConfigGenerator<P>(m, n, smemSize, kernel);
@@ -305,13 +334,13 @@ void masked_l2_nn_impl(raft::resources const& handle,
                                             y,
                                             xn,
                                             yn,
-                                            ws_adj64.data(),
+                                            adj64,
                                             group_idxs,
                                             num_groups,
                                             m,
                                             n,
                                             k,
-                                            sqrt,
+                                            epilogue,
                                             maxVal,
                                             ws_fused_nn.data(),
                                             redOp,
@@ -322,6 +351,133 @@ void masked_l2_nn_impl(raft::resources const& handle,
   RAFT_CUDA_TRY(cudaGetLastError());
 }
 
+/**
+ * @brief Masked nearest neighbors for a metric, with the adjacency bitfield as input.
+ *
+ * The metric is one of L2Expanded, L2SqrtExpanded (also selected by `sqrt`), InnerProduct (the
+ * distances are the negated inner products, `xn`, `yn` are not used) and CosineExpanded (`xn`, `yn`
+ * are the L2 norms). See masked_nn_launch for the other parameters.
+ */
+template <typename DataT, typename OutT, typename IdxT, typename ReduceOpT, typename KVPReduceOpT>
+void masked_nn_impl(raft::resources const& handle,
+                    OutT* out,
+                    const DataT* x,
+                    const DataT* y,
+                    const DataT* xn,
+                    const DataT* yn,
+                    const uint64_t* adj64,
+                    const IdxT* group_idxs,
+                    IdxT num_groups,
+                    IdxT m,
+                    IdxT n,
+                    IdxT k,
+                    ReduceOpT redOp,
+                    KVPReduceOpT pairRedOp,
+                    raft::distance::DistanceType metric,
+                    bool sqrt,
+                    bool initOutBuffer)
+{
+  auto launch = [&](auto epilogue) {
+    masked_nn_launch<DataT, OutT, IdxT>(handle,
+                                        out,
+                                        x,
+                                        y,
+                                        xn,
+                                        yn,
+                                        adj64,
+                                        group_idxs,
+                                        num_groups,
+                                        m,
+                                        n,
+                                        k,
+                                        redOp,
+                                        pairRedOp,
+                                        epilogue,
+                                        initOutBuffer);
+  };
+  switch (metric) {
+    case raft::distance::DistanceType::L2Expanded: launch(masked_l2_epilogue<DataT>{sqrt}); break;
+    case raft::distance::DistanceType::L2SqrtExpanded:
+      launch(masked_l2_epilogue<DataT>{true});
+      break;
+    case raft::distance::DistanceType::InnerProduct:
+      launch(masked_inner_product_epilogue<DataT>{});
+      break;
+    case raft::distance::DistanceType::CosineExpanded:
+      launch(masked_cosine_epilogue<DataT>{});
+      break;
+    default: RAFT_FAIL("masked_nn: unsupported metric %d", static_cast<int>(metric));
+  }
+}
+
+/**
+ * @brief Compress the boolean adjacency matrix [m, num_groups] to the bitfield
+ * [ceildiv(m, 64), num_groups] of masked_nn_impl (allocated from the workspace resource).
+ */
+template <typename IdxT>
+auto compress_adjacency(raft::resources const& handle, const bool* adj, IdxT m, IdxT num_groups)
+  -> rmm::device_uvector<uint64_t>
+{
+  rmm::mr::device_memory_resource* ws_mr =
+    dynamic_cast<rmm::mr::device_memory_resource*>(resource::get_workspace_resource(handle));
+  auto stream = resource::get_cuda_stream(handle);
+
+  size_t m_div_64 = raft::ceildiv(m, IdxT(64));
+  rmm::device_uvector<uint64_t> adj64{m_div_64 * num_groups, stream, ws_mr};
+  RAFT_CUDA_TRY(cudaMemsetAsync(adj64.data(), 0, adj64.size() * sizeof(uint64_t), stream));
+
+  auto adj_view = raft::make_device_matrix_view<const bool, int>(adj, m, num_groups);
+  auto adj64_view =
+    raft::make_device_matrix_view<uint64_t, int>(adj64.data(), m_div_64, num_groups);
+  compress_to_bits(handle, adj_view, adj64_view);
+  return adj64;
+}
+
+/**
+ * @brief Masked L2 nearest neighbors with a boolean adjacency matrix.
+ *
+ * The boolean adjacency matrix `adj` (Dim = `m x num_groups`) is compressed to a bitfield before
+ * running masked_nn_impl with the L2 metric (`sqrt` selects L2-sqrt). See masked_nn_launch for the
+ * other parameters.
+ */
+template <typename DataT, typename OutT, typename IdxT, typename ReduceOpT, typename KVPReduceOpT>
+void masked_l2_nn_impl(raft::resources const& handle,
+                       OutT* out,
+                       const DataT* x,
+                       const DataT* y,
+                       const DataT* xn,
+                       const DataT* yn,
+                       const bool* adj,
+                       const IdxT* group_idxs,
+                       IdxT num_groups,
+                       IdxT m,
+                       IdxT n,
+                       IdxT k,
+                       ReduceOpT redOp,
+                       KVPReduceOpT pairRedOp,
+                       bool sqrt,
+                       bool initOutBuffer)
+{
+  auto adj64 = compress_adjacency(handle, adj, m, num_groups);
+  masked_nn_impl<DataT, OutT, IdxT>(handle,
+                                    out,
+                                    x,
+                                    y,
+                                    xn,
+                                    yn,
+                                    adj64.data(),
+                                    group_idxs,
+                                    num_groups,
+                                    m,
+                                    n,
+                                    k,
+                                    redOp,
+                                    pairRedOp,
+                                    raft::distance::DistanceType::L2Expanded,
+                                    sqrt,
+                                    initOutBuffer);
+}
+
 }  // namespace detail
 }  // namespace distance
 }  // namespace raft
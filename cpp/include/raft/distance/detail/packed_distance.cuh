@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/detail/macros.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/detail/distance_ops/bitwise_hamming.cuh>
+#include <raft/distance/detail/distance_ops/bitwise_jaccard.cuh>
+#include <raft/distance/detail/distance_ops/int8_dp4a.cuh>
+#include <raft/distance/detail/pairwise_matrix/dispatch_sm60.cuh>
+#include <raft/distance/detail/pairwise_matrix/params.cuh>
+#include <raft/distance/distance_types.hpp>
+#include <raft/linalg/coalesced_reduction.cuh>
+#include <raft/util/arch.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cstdint>
+
+namespace raft::distance::detail {
+
+/** The number of set bits in a word. */
+struct popc_op {
+  template <typename... UnusedArgs>
+  RAFT_DEVICE_INLINE_FUNCTION auto operator()(uint32_t x, UnusedArgs...) const -> uint32_t
+  {
+    return __popc(x);
+  }
+};
+
+/** The squared L2 norm of a word of four packed int8 values. */
+struct int8x4_sq_norm_op {
+  template <typename... UnusedArgs>
+  RAFT_DEVICE_INLINE_FUNCTION auto operator()(int32_t x, UnusedArgs...) const -> int32_t
+  {
+    return ops::dot_int8x4(x, x, 0);
+  }
+};
+
+/**
+ * Run the pairwise matrix kernel over row-major packed inputs.
+ *
+ * The packed distance ops do not have CUTLASS counterparts, so this always goes through the
+ * SM60 kernel.
+ */
+template <typename OpT, typename DataT, typename OutT, typename FinOpT, typename IdxT>
+void packed_pairwise_matrix(OpT distance_op,
+                            IdxT m,
+                            IdxT n,
+                            IdxT k,
+                            const DataT* x,
+                            const DataT* y,
+                            const DataT* x_norm,
+                            const DataT* y_norm,
+                            OutT* out,
+                            FinOpT fin_op,
+                            cudaStream_t stream)
+{
+  pairwise_matrix_params<IdxT, DataT, OutT, FinOpT> params{
+    m, n, k, k, k, n, x, y, x_norm, y_norm, out, fin_op, true};
+  namespace arch = raft::util::arch;
+  auto any_range = arch::SM_range(arch::SM_min(), arch::SM_future());
+  pairwise_matrix_sm60_dispatch(distance_op, params, any_range, stream);
+}
+
+/**
+ * Pairwise distances between rows of bit-packed binary codes.
+ *
+ * @param[in] handle
+ * @param[in] x row-major codes [m, n_words]
+ * @param[in] y row-major codes [n, n_words]
+ * @param[out] dist row-major distances [m, n]
+ * @param m
+ * @param n
+ * @param n_words the number of 32-bit words per code
+ * @param metric HammingUnexpanded or JaccardExpanded
+ */
+template <typename IdxT>
+void bitwise_pairwise_distance(raft::resources const& handle,
+                               const uint32_t* x,
+                               const uint32_t* y,
+                               float* dist,
+                               IdxT m,
+                               IdxT n,
+                               IdxT n_words,
+                               DistanceType metric)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  switch (metric) {
+    case DistanceType::HammingUnexpanded: {
+      ops::bitwise_hamming_distance_op<uint32_t, float, IdxT> distance_op(n_words * 32);
+      packed_pairwise_matrix(
+        distance_op, m, n, n_words, x, y, nullptr, nullptr, dist, raft::identity_op{}, stream);
+    } break;
+    case DistanceType::JaccardExpanded: {
+      rmm::device_uvector<uint32_t> norms(m + n, stream);
+      raft::linalg::coalescedReduction(
+        norms.data(), x, n_words, m, uint32_t(0), stream, false, popc_op{});
+      raft::linalg::coalescedReduction(
+        norms.data() + m, y, n_words, n, uint32_t(0), stream, false, popc_op{});
+      ops::bitwise_jaccard_distance_op<uint32_t, float, IdxT> distance_op{};
+      packed_pairwise_matrix(distance_op,
+                             m,
+                             n,
+                             n_words,
+                             x,
+                             y,
+                             norms.data(),
+                             norms.data() + m,
+                             dist,
+                             raft::identity_op{},
+                             stream);
+    } break;
+    default: RAFT_FAIL("Bit-packed inputs support the Hamming and Jaccard distances only");
+  }
+}
+
+/**
+ * Pairwise distances between rows of int8 vectors, four values per 32-bit word.
+ *
+ * @param[in] handle
+ * @param[in] x row-major packed vectors [m, n_words]
+ * @param[in] y row-major packed vectors [n, n_words]
+ * @param[out] dist row-major distances [m, n]
+ * @param m
+ * @param n
+ * @param n_words the number of 32-bit words per vector (a quarter of the dimensionality)
+ * @param metric L2Expanded, L2SqrtExpanded or InnerProduct
+ */
+template <typename IdxT>
+void int8_pairwise_distance(raft::resources const& handle,
+                            const int32_t* x,
+                            const int32_t* y,
+                            float* dist,
+                            IdxT m,
+                            IdxT n,
+                            IdxT n_words,
+                            DistanceType metric)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  switch (metric) {
+    case DistanceType::L2Expanded:
+    case DistanceType::L2SqrtExpanded: {
+      rmm::device_uvector<int32_t> norms(m + n, stream);
+      raft::linalg::coalescedReduction(
+        norms.data(), x, n_words, m, int32_t(0), stream, false, int8x4_sq_norm_op{});
+      raft::linalg::coalescedReduction(
+        norms.data() + m, y, n_words, n, int32_t(0), stream, false, int8x4_sq_norm_op{});
+      ops::int8_l2_exp_distance_op<int32_t, int32_t, IdxT> distance_op{};
+      auto run = [&](auto fin_op) {
+        packed_pairwise_matrix(
+          distance_op, m, n, n_words, x, y, norms.data(), norms.data() + m, dist, fin_op, stream);
+      };
+      if (metric == DistanceType::L2SqrtExpanded) {
+        run(raft::compose_op(raft::sqrt_op{}, raft::cast_op<float>{}));
+      } else {
+        run(raft::cast_op<float>{});
+      }
+    } break;
+    case DistanceType::InnerProduct: {
+      ops::int8_inner_product_op<int32_t, int32_t, IdxT> distance_op{};
+      packed_pairwise_matrix(
+        distance_op, m, n, n_words, x, y, nullptr, nullptr, dist, raft::cast_op<float>{}, stream);
+    } break;
+    default: RAFT_FAIL("int8 inputs support the L2 expanded and inner product distances only");
+  }
+}
+
+}  // namespace raft::distance::detail
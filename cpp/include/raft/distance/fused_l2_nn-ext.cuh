@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,9 @@
 #include <raft/distance/fused_l2_nn_helpers.cuh>  // include initialize and reduce operations
 #include <raft/util/raft_explicit.hpp>            // RAFT_EXPLICIT
 
+#include <cuda_bf16.h>  // nv_bfloat16
+#include <cuda_fp16.h>  // half
+
 #ifdef RAFT_EXPLICIT_INSTANTIATE_ONLY
 
 namespace raft {
@@ -41,6 +44,48 @@ void fusedL2NNMinReduce(OutT* min,
                         bool initOutBuffer,
                         cudaStream_t stream) RAFT_EXPLICIT;
 
+template <typename OutT, typename IdxT>
+void fusedL2NNMinReduce(OutT* min,
+                        const half* x,
+                        const half* y,
+                        const float* xn,
+                        const float* yn,
+                        IdxT m,
+                        IdxT n,
+                        IdxT k,
+                        void* workspace,
+                        bool sqrt,
+                        bool initOutBuffer,
+                        cudaStream_t stream) RAFT_EXPLICIT;
+
+template <typename OutT, typename IdxT>
+void fusedL2NNMinReduce(OutT* min,
+                        const nv_bfloat16* x,
+                        const nv_bfloat16* y,
+                        const float* xn,
+                        const float* yn,
+                        IdxT m,
+                        IdxT n,
+                        IdxT k,
+                        void* workspace,
+                        bool sqrt,
+                        bool initOutBuffer,
+                        cudaStream_t stream) RAFT_EXPLICIT;
+
+template <typename DataT, typename IdxT>
+void fusedL2NNTopK(raft::KeyValuePair<IdxT, DataT>* out,
+                   const DataT* x,
+                   const DataT* y,
+                   const DataT* xn,
+                   const DataT* yn,
+                   IdxT m,
+                   IdxT n,
+                   IdxT k,
+                   int n_neighbors,
+                   void* workspace,
+                   bool sqrt,
+                   cudaStream_t stream) RAFT_EXPLICIT;
+
 }  // namespace distance
 }  // namespace raft
 
@@ -77,6 +122,59 @@ instantiate_raft_distance_fusedL2NNMinReduce(float,
                                              raft::KeyValuePair<int64_t COMMA float>,
                                              int64_t);
 
+#undef instantiate_raft_distance_fusedL2NNMinReduce
+
+#define instantiate_raft_distance_fusedL2NNMinReduce_widened(InT, OutT, IdxT)             \
+  extern template void raft::distance::fusedL2NNMinReduce<OutT, IdxT>(OutT * min,         \
+                                                                      const InT* x,       \
+                                                                      const InT* y,       \
+                                                                      const float* xn,    \
+                                                                      const float* yn,    \
+                                                                      IdxT m,             \
+                                                                      IdxT n,             \
+                                                                      IdxT k,             \
+                                                                      void* workspace,    \
+                                                                      bool sqrt,          \
+                                                                      bool initOutBuffer, \
+                                                                      cudaStream_t stream)
+
+instantiate_raft_distance_fusedL2NNMinReduce_widened(half, float, int);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(half, float, int64_t);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(half,
+                                                     raft::KeyValuePair<int COMMA float>,
+                                                     int);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(half,
+                                                     raft::KeyValuePair<int64_t COMMA float>,
+                                                     int64_t);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(nv_bfloat16, float, int);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(nv_bfloat16, float, int64_t);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(nv_bfloat16,
+                                                     raft::KeyValuePair<int COMMA float>,
+                                                     int);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(nv_bfloat16,
+                                                     raft::KeyValuePair<int64_t COMMA float>,
+                                                     int64_t);
+
 #undef COMMA
 
-#undef instantiate_raft_distance_fusedL2NNMinReduce
+#undef instantiate_raft_distance_fusedL2NNMinReduce_widened
+
+#define instantiate_raft_distance_fusedL2NNTopK(DataT, IdxT)       \
+  extern template void raft::distance::fusedL2NNTopK<DataT, IdxT>( \
+    raft::KeyValuePair<IdxT, DataT> * out,                         \
+    const DataT* x,                                                \
+    const DataT* y,                                                \
+    const DataT* xn,                                               \
+    const DataT* yn,                                               \
+    IdxT m,                                                        \
+    IdxT n,                                                        \
+    IdxT k,                                                        \
+    int n_neighbors,                                               \
+    void* workspace,                                               \
+    bool sqrt,                                                     \
+    cudaStream_t stream)
+
+instantiate_raft_distance_fusedL2NNTopK(float, int);
+instantiate_raft_distance_fusedL2NNTopK(float, int64_t);
+
+#undef instantiate_raft_distance_fusedL2NNTopK
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,14 +21,23 @@
 
 #include <cub/cub.cuh>
 #include <limits>
+#include <raft/core/error.hpp>
+#include <raft/core/kvp.hpp>
+#include <raft/core/operators.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/distance/detail/fused_l2_nn.cuh>
 #include <raft/distance/fused_l2_nn_helpers.cuh>
 #include <raft/linalg/contractions.cuh>
+#include <raft/linalg/unary_op.cuh>
 #include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <rmm/device_uvector.hpp>
 #include <stdint.h>
 #include <type_traits>
 
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
+
 namespace raft {
 namespace distance {
 
@@ -198,6 +207,194 @@ void fusedL2NNMinReduce(OutT* min,
     min, x, y, xn, yn, m, n, k, workspace, redOp, pairRedOp, sqrt, initOutBuffer, stream);
 }
 
+namespace detail {
+
+/** Widens the half or nv_bfloat16 inputs to fp32 and runs the fp32 fusedL2NNMinReduce. */
+template <typename InT, typename OutT, typename IdxT>
+void fusedL2NNMinReduceWidened(OutT* min,
+                               const InT* x,
+                               const InT* y,
+                               const float* xn,
+                               const float* yn,
+                               IdxT m,
+                               IdxT n,
+                               IdxT k,
+                               void* workspace,
+                               bool sqrt,
+                               bool initOutBuffer,
+                               cudaStream_t stream)
+{
+  rmm::device_uvector<float> x_float(size_t(m) * size_t(k), stream);
+  rmm::device_uvector<float> y_float(size_t(n) * size_t(k), stream);
+  raft::linalg::unaryOp(x_float.data(), x, x_float.size(), raft::cast_op<float>{}, stream);
+  raft::linalg::unaryOp(y_float.data(), y, y_float.size(), raft::cast_op<float>{}, stream);
+  raft::distance::fusedL2NNMinReduce<float, OutT, IdxT>(min,
+                                                        x_float.data(),
+                                                        y_float.data(),
+                                                        xn,
+                                                        yn,
+                                                        m,
+                                                        n,
+                                                        k,
+                                                        workspace,
+                                                        sqrt,
+                                                        initOutBuffer,
+                                                        stream);
+}
+
+}  // namespace detail
+
+/**
+ * @brief fusedL2NNMinReduce of the half-precision inputs with fp32 accumulation.
+ *
+ * The inputs are widened to fp32 (which takes `(m + n) * k` floats of temporary memory, but no
+ * distance matrix) and reduced by the fp32 fused kernel.
+ *
+ * @tparam OutT  output type: raft::KeyValuePair<IdxT, float> or float
+ * @tparam IdxT  indexing arithmetic type
+ *
+ * @param[out] min           will contain the reduced output (Length = `m`)
+ *                           (on device)
+ * @param[in]  x             first matrix. Row major. Dim = `m x k`.
+ *                           (on device).
+ * @param[in]  y             second matrix. Row major. Dim = `n x k`.
+ *                           (on device).
+ * @param[in]  xn            L2 squared norm of `x`. Length = `m`. (on device).
+ * @param[in]  yn            L2 squared norm of `y`. Length = `n`. (on device)
+ * @param[in]  m             gemm m
+ * @param[in]  n             gemm n
+ * @param[in]  k             gemm k
+ * @param[in]  workspace     temp workspace. Size = sizeof(int)*m. (on device)
+ * @param[in]  sqrt          Whether the output `minDist` should contain L2-sqrt
+ * @param[in]  initOutBuffer whether to initialize the output buffer before the
+ *                           main kernel launch
+ * @param[in]  stream        cuda stream
+ */
+template <typename OutT, typename IdxT>
+void fusedL2NNMinReduce(OutT* min,
+                        const half* x,
+                        const half* y,
+                        const float* xn,
+                        const float* yn,
+                        IdxT m,
+                        IdxT n,
+                        IdxT k,
+                        void* workspace,
+                        bool sqrt,
+                        bool initOutBuffer,
+                        cudaStream_t stream)
+{
+  detail::fusedL2NNMinReduceWidened<half, OutT, IdxT>(
+    min, x, y, xn, yn, m, n, k, workspace, sqrt, initOutBuffer, stream);
+}
+
+/**
+ * @brief fusedL2NNMinReduce of the bfloat16 inputs with fp32 accumulation.
+ *
+ * As the half overload, the inputs are widened to fp32 before the fp32 fused kernel.
+ *
+ * @tparam OutT  output type: raft::KeyValuePair<IdxT, float> or float
+ * @tparam IdxT  indexing arithmetic type
+ *
+ * @param[out] min           will contain the reduced output (Length = `m`)
+ *                           (on device)
+ * @param[in]  x             first matrix. Row major. Dim = `m x k`.
+ *                           (on device).
+ * @param[in]  y             second matrix. Row major. Dim = `n x k`.
+ *                           (on device).
+ * @param[in]  xn            L2 squared norm of `x`. Length = `m`. (on device).
+ * @param[in]  yn            L2 squared norm of `y`. Length = `n`. (on device)
+ * @param[in]  m             gemm m
+ * @param[in]  n             gemm n
+ * @param[in]  k             gemm k
+ * @param[in]  workspace     temp workspace. Size = sizeof(int)*m. (on device)
+ * @param[in]  sqrt          Whether the output `minDist` should contain L2-sqrt
+ * @param[in]  initOutBuffer whether to initialize the output buffer before the
+ *                           main kernel launch
+ * @param[in]  stream        cuda stream
+ */
+template <typename OutT, typename IdxT>
+void fusedL2NNMinReduce(OutT* min,
+                        const nv_bfloat16* x,
+                        const nv_bfloat16* y,
+                        const float* xn,
+                        const float* yn,
+                        IdxT m,
+                        IdxT n,
+                        IdxT k,
+                        void* workspace,
+                        bool sqrt,
+                        bool initOutBuffer,
+                        cudaStream_t stream)
+{
+  detail::fusedL2NNMinReduceWidened<nv_bfloat16, OutT, IdxT>(
+    min, x, y, xn, yn, m, n, k, workspace, sqrt, initOutBuffer, stream);
+}
+
+/**
+ * @brief Fused L2 distance and k-nearest-neighbors computation for a small number of neighbors,
+ * e.g. the two closest centers needed by the Hamerly bounds of k-means or a soft assignment.
+ *
+ * The neighbors are found one after another by `n_neighbors` runs of the fused kernel, every run
+ * skipping the neighbors already found for the row. Thus, no distance matrix is materialized, at
+ * the cost of `n_neighbors` passes over the inputs.
+ *
+ * @tparam DataT     data type
+ * @tparam IdxT      indexing arithmetic type
+ *
+ * @param[out] out           the nearest neighbors of every row of `x`, sorted by the distance.
+ *                           Row major. Dim = `m x n_neighbors`. (on device)
+ * @param[in]  x             first matrix. Row major. Dim = `m x k`.
+ *                           (on device).
+ * @param[in]  y             second matrix. Row major. Dim = `n x k`.
+ *                           (on device).
+ * @param[in]  xn            L2 squared norm of `x`. Length = `m`. (on device).
+ * @param[in]  yn            L2 squared norm of `y`. Length = `n`. (on device)
+ * @param[in]  m             gemm m
+ * @param[in]  n             gemm n
+ * @param[in]  k             gemm k
+ * @param[in]  n_neighbors   the number of neighbors per row (`1 <= n_neighbors <= n`)
+ * @param[in]  workspace     temp workspace. Size = sizeof(int)*m. (on device)
+ * @param[in]  sqrt          Whether the output distances should contain L2-sqrt
+ * @param[in]  stream        cuda stream
+ */
+template <typename DataT, typename IdxT>
+void fusedL2NNTopK(raft::KeyValuePair<IdxT, DataT>* out,
+                   const DataT* x,
+                   const DataT* y,
+                   const DataT* xn,
+                   const DataT* yn,
+                   IdxT m,
+                   IdxT n,
+                   IdxT k,
+                   int n_neighbors,
+                   void* workspace,
+                   bool sqrt,
+                   cudaStream_t stream)
+{
+  using KVP = raft::KeyValuePair<IdxT, DataT>;
+  RAFT_EXPECTS(n_neighbors > 0 && n_neighbors <= n, "n_neighbors must be in [1, n]");
+  if (n_neighbors == 1) {
+    return fusedL2NNMinReduce<DataT, KVP, IdxT>(
+      out, x, y, xn, yn, m, n, k, workspace, sqrt, true, stream);
+  }
+  rmm::device_uvector<KVP> nearest(m, stream);
+  for (int j = 0; j < n_neighbors; j++) {
+    detail::MinAndDistanceExcludeReduceOpImpl<IdxT, DataT> redOp(out, m, n_neighbors, j);
+    detail::KVPMinExcludeReduceImpl<IdxT, DataT> pairRedOp{redOp};
+    fusedL2NN<DataT, KVP, IdxT>(
+      nearest.data(), x, y, xn, yn, m, n, k, workspace, redOp, pairRedOp, sqrt, true, stream);
+    RAFT_CUDA_TRY(cudaMemcpy2DAsync(out + j,
+                                    sizeof(KVP) * n_neighbors,
+                                    nearest.data(),
+                                    sizeof(KVP),
+                                    sizeof(KVP),
+                                    m,
+                                    cudaMemcpyDeviceToDevice,
+                                    stream));
+  }
+}
+
 /** @} */
 
 }  // namespace distance
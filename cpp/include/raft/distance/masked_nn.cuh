@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,7 @@
 #include <limits>
 #include <raft/core/handle.hpp>
 #include <raft/distance/detail/masked_nn.cuh>
+#include <raft/distance/distance_types.hpp>
 #include <raft/distance/fused_l2_nn.cuh>
 #include <raft/util/cuda_utils.cuh>
 #include <stdint.h>
@@ -61,7 +62,8 @@ namespace distance {
  * value (distance) is selected.
  *
  * In addition, prescribes whether to compute the square root of the distance
- * (`sqrt`) and whether to initialize the output buffer (`initOutBuffer`).
+ * (`sqrt`), whether to initialize the output buffer (`initOutBuffer`) and the
+ * distance metric of `masked_nn` (`metric`).
  */
 template <typename ReduceOpT, typename KVPReduceOpT>
 struct masked_l2_nn_params {
@@ -73,6 +75,8 @@ struct masked_l2_nn_params {
   bool sqrt;
   /** Whether to initialize the output buffer before the main kernel launch */
   bool initOutBuffer;
+  /** The distance metric of `masked_nn` (`masked_l2_nn` always computes the L2 distance) */
+  raft::distance::DistanceType metric = raft::distance::DistanceType::L2Expanded;
 };
 
 /**
@@ -191,6 +195,139 @@ void masked_l2_nn(raft::resources const& handle,
                                                           params.initOutBuffer);
 }
 
+/**
+ * @brief Masked distance and 1-nearest-neighbor computation for a metric, with the adjacency
+ * given as a bitfield.
+ *
+ * This is `masked_l2_nn` for the metric `params.metric`:
+ *
+ * - L2Expanded, L2SqrtExpanded: the L2 (the L2-sqrt if `params.sqrt` or L2SqrtExpanded) distance;
+ *   `x_norm`, `y_norm` are the squared L2 norms.
+ * - InnerProduct: the negated inner product, so that the nearest neighbor is the one with the
+ *   largest inner product; `x_norm`, `y_norm` are not used (and may be empty).
+ * - CosineExpanded: the cosine distance `1 - <x, y> / (|x| |y|)`; `x_norm`, `y_norm` are the L2
+ *   norms (not squared).
+ *
+ * The adjacency is the bitfield produced by `compress_to_bits`
+ * (distance/detail/compress_to_bits.cuh): bit `i % 64` of `adj_bits[i / 64, j]` tells whether to
+ * compute the distances between row `i` of `x` and group `j` in `y`. A tile of 64 rows of `x`
+ * skips a group whose 64 bits are all zero without loading any of its data, so
+ * the mask can be kept compressed (and reused) across calls.
+ *
+ * @tparam DataT     data type
+ * @tparam OutT      output type to either store 1-NN indices and their minimum
+ *                   distances or store only the min distances. Accordingly, one
+ *                   has to pass an appropriate `ReduceOpT`
+ * @tparam IdxT      indexing arithmetic type
+ * @tparam ReduceOpT A struct to perform the final needed reduction operation
+ *                   and also to initialize the output array elements with the
+ *                   appropriate initial value needed for reduction.
+ *
+ * @param handle             RAFT handle for managing expensive resources
+ * @param params             Parameter struct specifying the reduction operations and the metric.
+ * @param[in]  x             First matrix. Row major. Dim = `m x k`.
+ *                           (on device).
+ * @param[in]  y             Second matrix. Row major. Dim = `n x k`.
+ *                           (on device).
+ * @param[in]  x_norm        Norms of `x` (see above). Length = `m`. (on device).
+ * @param[in]  y_norm        Norms of `y` (see above). Length = `n`. (on device)
+ * @param[in]  adj_bits      The adjacency bitfield. Dim = `ceildiv(m, 64) x num_groups`.
+ * @param[in]  group_idxs    An array containing the *end* indices of each group
+ *                           in `y` (see `masked_l2_nn`). Length = `num_groups`.
+ * @param[out] out           will contain the reduced output (Length = `m`)
+ *                           (on device)
+ */
+template <typename DataT, typename OutT, typename IdxT, typename ReduceOpT, typename KVPReduceOpT>
+void masked_nn(raft::resources const& handle,
+               raft::distance::masked_l2_nn_params<ReduceOpT, KVPReduceOpT> params,
+               raft::device_matrix_view<const DataT, IdxT, raft::layout_c_contiguous> x,
+               raft::device_matrix_view<const DataT, IdxT, raft::layout_c_contiguous> y,
+               raft::device_vector_view<const DataT, IdxT, raft::layout_c_contiguous> x_norm,
+               raft::device_vector_view<const DataT, IdxT, raft::layout_c_contiguous> y_norm,
+               raft::device_matrix_view<const uint64_t, IdxT, raft::layout_c_contiguous> adj_bits,
+               raft::device_vector_view<const IdxT, IdxT, raft::layout_c_contiguous> group_idxs,
+               raft::device_vector_view<OutT, IdxT, raft::layout_c_contiguous> out)
+{
+  IdxT m          = x.extent(0);
+  IdxT n          = y.extent(0);
+  IdxT k          = x.extent(1);
+  IdxT num_groups = group_idxs.extent(0);
+
+  const bool use_norms = params.metric != raft::distance::DistanceType::InnerProduct;
+  // Match k dimension of x, y
+  RAFT_EXPECTS(x.extent(1) == y.extent(1), "Dimension of vectors in x and y must be equal.");
+  // Match x, x_norm and y, y_norm
+  RAFT_EXPECTS(!use_norms || m == x_norm.extent(0), "Length of `x_norm` must match input `x`.");
+  RAFT_EXPECTS(!use_norms || n == y_norm.extent(0), "Length of `y_norm` must match input `y` ");
+  // Match adj_bits to x and group_idxs
+  RAFT_EXPECTS(raft::ceildiv(m, IdxT(64)) == adj_bits.extent(0),
+               "#rows in `adj_bits` must be ceildiv(#rows in `x`, 64).");
+  RAFT_EXPECTS(num_groups == adj_bits.extent(1),
+               "#cols in `adj_bits` must match length of `group_idxs`.");
+  RAFT_EXPECTS(out.extent(0) == m, "Length of `out` must match input `x`.");
+
+  // If there is no work to be done, return immediately.
+  if (m == 0 || n == 0 || k == 0 || num_groups == 0) { return; }
+
+  detail::masked_nn_impl<DataT, OutT, IdxT>(handle,
+                                            out.data_handle(),
+                                            x.data_handle(),
+                                            y.data_handle(),
+                                            use_norms ? x_norm.data_handle() : nullptr,
+                                            use_norms ? y_norm.data_handle() : nullptr,
+                                            adj_bits.data_handle(),
+                                            group_idxs.data_handle(),
+                                            num_groups,
+                                            m,
+                                            n,
+                                            k,
+                                            params.redOp,
+                                            params.pairRedOp,
+                                            params.metric,
+                                            params.sqrt,
+                                            params.initOutBuffer);
+}
+
+/**
+ * @brief Masked distance and 1-nearest-neighbor computation for a metric.
+ *
+ * This is `masked_nn` with the boolean adjacency matrix `adj` (Dim = `m x num_groups`) of
+ * `masked_l2_nn`, which is compressed to a bitfield in the workspace first. When the same mask is
+ * used for several calls, compress it once with `compress_to_bits` and use the bitfield overload.
+ */
+template <typename DataT, typename OutT, typename IdxT, typename ReduceOpT, typename KVPReduceOpT>
+void masked_nn(raft::resources const& handle,
+               raft::distance::masked_l2_nn_params<ReduceOpT, KVPReduceOpT> params,
+               raft::device_matrix_view<const DataT, IdxT, raft::layout_c_contiguous> x,
+               raft::device_matrix_view<const DataT, IdxT, raft::layout_c_contiguous> y,
+               raft::device_vector_view<const DataT, IdxT, raft::layout_c_contiguous> x_norm,
+               raft::device_vector_view<const DataT, IdxT, raft::layout_c_contiguous> y_norm,
+               raft::device_matrix_view<const bool, IdxT, raft::layout_c_contiguous> adj,
+               raft::device_vector_view<const IdxT, IdxT, raft::layout_c_contiguous> group_idxs,
+               raft::device_vector_view<OutT, IdxT, raft::layout_c_contiguous> out)
+{
+  IdxT m          = x.extent(0);
+  IdxT num_groups = group_idxs.extent(0);
+
+  // Match adj to x and group_idxs
+  RAFT_EXPECTS(m == adj.extent(0), "#rows in `adj` must match input `x`.");
+  RAFT_EXPECTS(num_groups == adj.extent(1), "#cols in `adj` must match length of `group_idxs`.");
+
+  if (m == 0 || num_groups == 0) { return; }
+
+  auto adj64 = detail::compress_adjacency(handle, adj.data_handle(), m, num_groups);
+  masked_nn<DataT, OutT, IdxT>(handle,
+                               params,
+                               x,
+                               y,
+                               x_norm,
+                               y_norm,
+                               raft::make_device_matrix_view<const uint64_t, IdxT>(
+                                 adj64.data(), raft::ceildiv(m, IdxT(64)), num_groups),
+                               group_idxs,
+                               out);
+}
+
 /** @} */
 
 }  // namespace distance
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/detail/packed_distance.cuh>
+#include <raft/distance/distance_types.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace raft::distance {
+
+/**
+ * @addtogroup distance_mdspan
+ * @{
+ */
+
+/**
+ * @brief Evaluate pairwise distances between bit-packed binary codes.
+ *
+ * Every element of the inputs packs `8 * sizeof(BitsT)` binary features, and the distances are
+ * computed with population counts over whole words, instead of expanding every feature to a
+ * float. The Hamming distance is the fraction of differing bits over the packed width
+ * `8 * sizeof(BitsT) * x.extent(1)` (the padding bits must be equal in all the codes); the Jaccard
+ * distance is `1 - |x & y| / |x | y|`.
+ *
+ * Usage example:
+ * @code{.cpp}
+ * #include <raft/distance/packed_distance.cuh>
+ *
+ * // 256-bit codes
+ * auto x    = raft::make_device_matrix<uint64_t>(handle, n_x, 4);
+ * auto y    = raft::make_device_matrix<uint64_t>(handle, n_y, 4);
+ * auto dist = raft::make_device_matrix<float>(handle, n_x, n_y);
+ * ...
+ * raft::distance::pairwise_distance(handle,
+ *                                   raft::make_const_mdspan(x.view()),
+ *                                   raft::make_const_mdspan(y.view()),
+ *                                   dist.view(),
+ *                                   raft::distance::DistanceType::HammingUnexpanded);
+ * @endcode
+ *
+ * @tparam BitsT the word type of the codes (uint32_t or uint64_t)
+ * @tparam IdxT index type
+ * @param handle raft handle for managing expensive resources
+ * @param x first set of codes (size m * n_words)
+ * @param y second set of codes (size n * n_words)
+ * @param dist output distance matrix (size m * n)
+ * @param metric HammingUnexpanded or JaccardExpanded
+ */
+template <typename BitsT,
+          typename IdxT,
+          typename = std::enable_if_t<std::is_same_v<BitsT, uint32_t> ||
+                                      std::is_same_v<BitsT, uint64_t>>>
+void pairwise_distance(raft::resources const& handle,
+                       device_matrix_view<const BitsT, IdxT, row_major> x,
+                       device_matrix_view<const BitsT, IdxT, row_major> y,
+                       device_matrix_view<float, IdxT, row_major> dist,
+                       raft::distance::DistanceType metric)
+{
+  RAFT_EXPECTS(x.extent(1) == y.extent(1), "Number of columns must be equal.");
+  RAFT_EXPECTS(dist.extent(0) == x.extent(0),
+               "Number of rows in output must be equal to number of rows in X");
+  RAFT_EXPECTS(dist.extent(1) == y.extent(0),
+               "Number of columns in output must be equal to number of rows in Y");
+
+  // A 64-bit word is just two 32-bit words for the population counts.
+  constexpr IdxT kWordsPerElem = sizeof(BitsT) / sizeof(uint32_t);
+  detail::bitwise_pairwise_distance<IdxT>(handle,
+                                          reinterpret_cast<const uint32_t*>(x.data_handle()),
+                                          reinterpret_cast<const uint32_t*>(y.data_handle()),
+                                          dist.data_handle(),
+                                          x.extent(0),
+                                          y.extent(0),
+                                          x.extent(1) * kWordsPerElem,
+                                          metric);
+}
+
+/**
+ * @brief Evaluate pairwise distances between int8 vectors.
+ *
+ * The products are accumulated four values at a time in int32 (`dp4a`), so the L2 and inner
+ * product distances are exact, while the inputs take a quarter of the memory of floats.
+ *
+ * The dimensionality must be a multiple of four, and the rows must be 4-byte aligned.
+ *
+ * @tparam IdxT index type
+ * @param handle raft handle for managing expensive resources
+ * @param x first set of points (size m * dim)
+ * @param y second set of points (size n * dim)
+ * @param dist output distance matrix (size m * n)
+ * @param metric L2Expanded, L2SqrtExpanded or InnerProduct
+ */
+template <typename IdxT>
+void pairwise_distance(raft::resources const& handle,
+                       device_matrix_view<const int8_t, IdxT, row_major> x,
+                       device_matrix_view<const int8_t, IdxT, row_major> y,
+                       device_matrix_view<float, IdxT, row_major> dist,
+                       raft::distance::DistanceType metric)
+{
+  RAFT_EXPECTS(x.extent(1) == y.extent(1), "Number of columns must be equal.");
+  RAFT_EXPECTS(dist.extent(0) == x.extent(0),
+               "Number of rows in output must be equal to number of rows in X");
+  RAFT_EXPECTS(dist.extent(1) == y.extent(0),
+               "Number of columns in output must be equal to number of rows in Y");
+  RAFT_EXPECTS(x.extent(1) % 4 == 0, "The dimensionality of int8 inputs must be a multiple of 4");
+  RAFT_EXPECTS(reinterpret_cast<uintptr_t>(x.data_handle()) % 4 == 0 &&
+                 reinterpret_cast<uintptr_t>(y.data_handle()) % 4 == 0,
+               "int8 inputs must be 4-byte aligned");
+
+  detail::int8_pairwise_distance<IdxT>(handle,
+                                       reinterpret_cast<const int32_t*>(x.data_handle()),
+                                       reinterpret_cast<const int32_t*>(y.data_handle()),
+                                       dist.data_handle(),
+                                       x.extent(0),
+                                       y.extent(0),
+                                       x.extent(1) / 4,
+                                       metric);
+}
+
+/** @} */  // end group distance_mdspan
+
+}  // namespace raft::distance
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2022, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,7 +18,9 @@
 
 #pragma once
 
+#include <raft/label/classlabels_types.hpp>
 #include <raft/label/detail/classlabels.cuh>
+#include <raft/label/detail/hash_labels.cuh>
 
 namespace raft {
 namespace label {
@@ -43,6 +45,31 @@ int getUniquelabels(rmm::device_uvector<value_t>& unique, value_t* y, size_t n,
   return detail::getUniquelabels<value_t>(unique, y, n, stream);
 }
 
+/**
+ * Get unique class labels with a GPU hash table instead of a sort of the whole array: O(n)
+ * expected work, and a workspace of 1.5 n indices (32-bit below 2^31 labels). Only the distinct
+ * labels are sorted.
+ *
+ * @tparam value_t arithmetic type of the arrays with class labels (all the NaNs are one label)
+ * @param [inout] unique output unique labels, in the given order
+ * @param [in] y device array of labels, size [n]
+ * @param [in] n number of labels
+ * @param [in] stream cuda stream
+ * @param [in] order whether the unique labels are sorted, or in the order of their first
+ *   occurrence in y
+ * @returns the number of unique labels
+ */
+template <typename value_t>
+int getUniquelabels(rmm::device_uvector<value_t>& unique,
+                    const value_t* y,
+                    size_t n,
+                    cudaStream_t stream,
+                    relabel_order order)
+{
+  return int(detail::hash_relabel<value_t>(
+    nullptr, y, n, stream, raft::const_op(false), order, false, unique));
+}
+
 /**
  * Assign one versus rest labels.
  *
@@ -115,6 +142,80 @@ void make_monotonic(Type* out, Type* in, size_t N, cudaStream_t stream, bool zer
 {
   detail::make_monotonic<Type>(out, in, N, stream, zero_based);
 }
+/**
+ * Maps an input array into monotonically increasing labels like make_monotonic, with a GPU hash
+ * table (O(N) expected work) instead of a sort of the whole input. The labels follow either the
+ * sorted order of the values (the result of make_monotonic) or the order of their first
+ * occurrence, and the distinct values come for free as the inverse mapping: label l (minus one
+ * unless zero_based) is the value unique[l].
+ *
+ * @code{.cpp}
+ *   // in = {8, 3, 8, 5}: SORTED gives {3, 1, 3, 2}, FIRST_OCCURRENCE gives {1, 2, 1, 3},
+ *   // and unique = {3, 5, 8} or {8, 3, 5}
+ *   rmm::device_uvector<int> unique(0, stream);
+ *   make_monotonic_hashed(out, in, n, stream, relabel_order::FIRST_OCCURRENCE, false, &unique);
+ * @endcode
+ *
+ * @tparam Type the arithmetic type of the input and output arrays
+ * @tparam Lambda the type of the filter function
+ * @param[out] out the output monotonic array
+ * @param[in] in input label array
+ * @param[in] N number of elements in the input array
+ * @param[in] stream cuda stream to use
+ * @param[in] filter_op the values for which it returns true are not relabeled (out keeps them);
+ *   as with make_monotonic, they still count among the distinct values
+ * @param[in] order the order of the labels
+ * @param[in] zero_based force monotonic set to start at 0?
+ * @param[out] unique optional, the distinct values in the order of their labels [n_unique]
+ * @returns the number of distinct values
+ */
+template <typename Type, typename Lambda>
+size_t make_monotonic_hashed(Type* out,
+                             const Type* in,
+                             size_t N,
+                             cudaStream_t stream,
+                             Lambda filter_op,
+                             relabel_order order,
+                             bool zero_based                   = false,
+                             rmm::device_uvector<Type>* unique = nullptr)
+{
+  rmm::device_uvector<Type> workspace(0, stream);
+  return detail::hash_relabel<Type, Lambda>(out,
+                                            in,
+                                            N,
+                                            stream,
+                                            filter_op,
+                                            order,
+                                            zero_based,
+                                            unique != nullptr ? *unique : workspace);
+}
+
+/**
+ * Maps an input array into monotonically increasing labels with a GPU hash table; see the
+ * overload with a filter.
+ *
+ * @tparam Type the arithmetic type of the input and output arrays
+ * @param[out] out output label array with labels assigned monotonically
+ * @param[in] in input label array
+ * @param[in] N number of elements in the input array
+ * @param[in] stream cuda stream to use
+ * @param[in] order the order of the labels
+ * @param[in] zero_based force monotonic label set to start at 0?
+ * @param[out] unique optional, the distinct values in the order of their labels [n_unique]
+ * @returns the number of distinct values
+ */
+template <typename Type>
+size_t make_monotonic_hashed(Type* out,
+                             const Type* in,
+                             size_t N,
+                             cudaStream_t stream,
+                             relabel_order order               = relabel_order::SORTED,
+                             bool zero_based                   = false,
+                             rmm::device_uvector<Type>* unique = nullptr)
+{
+  return make_monotonic_hashed<Type>(
+    out, in, N, stream, raft::const_op(false), order, zero_based, unique);
+}
 };  // namespace label
 };  // end namespace raft
 
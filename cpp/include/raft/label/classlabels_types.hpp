@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+namespace raft {
+namespace label {
+
+/** The order of the labels assigned by the hash-based relabeling. */
+enum class relabel_order {
+  /** the labels follow the sorted order of the values, as with sort + unique */
+  SORTED,
+  /** the labels follow the order of the first occurrence of the values in the input */
+  FIRST_OCCURRENCE
+};
+
+};  // namespace label
+};  // end namespace raft
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cub/cub.cuh>
+
+#include <raft/core/error.hpp>
+#include <raft/label/classlabels_types.hpp>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/warp_primitives.cuh>
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+#include <rmm/exec_policy.hpp>
+
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/transform.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace raft {
+namespace label {
+namespace detail {
+
+/*
+ * The hash-based relabeling: an open addressing table (linear probing, load factor of at most
+ * 2/3) whose slots hold the index of the first occurrence of a value in the input, so that any
+ * value type works without an empty-key sentinel. Once the distinct values are known and ordered,
+ * the slots are overwritten with the labels, and the lookups compare the values with the array of
+ * the distinct values (the inverse mapping) instead of the input.
+ */
+
+static constexpr int kHashLabelsTPB = 256;
+
+/** All the NaNs are one value, and so are 0 and -0. */
+template <typename Type>
+__device__ inline auto labels_equal(Type a, Type b) -> bool
+{
+  if constexpr (std::is_floating_point_v<Type>) {
+    return a == b || (a != a && b != b);
+  } else {
+    return a == b;
+  }
+}
+
+template <typename Type>
+__device__ inline auto label_hash(Type key) -> uint64_t
+{
+  if constexpr (std::is_floating_point_v<Type>) {
+    if (key != key) { key = std::numeric_limits<Type>::quiet_NaN(); }
+    if (key == Type(0)) { key = Type(0); }
+  }
+  uint64_t k = 0;
+  memcpy(&k, &key, sizeof(Type));
+  // the finalizer of MurmurHash3
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+/** Insert every value of the input, keeping the smallest index of the equal values. */
+template <typename Type, typename IdxT>
+RAFT_KERNEL hash_labels_insert_kernel(const Type* in, IdxT n, IdxT* slots, IdxT capacity)
+{
+  constexpr IdxT kEmpty = std::numeric_limits<IdxT>::max();
+  for (IdxT i = IdxT(blockIdx.x) * blockDim.x + threadIdx.x; i < n;
+       i += IdxT(blockDim.x) * gridDim.x) {
+    Type key = in[i];
+    IdxT s   = IdxT(label_hash(key) % capacity);
+    while (true) {
+      IdxT cur = slots[s];
+      if (cur == kEmpty) {
+        cur = atomicCAS(slots + s, kEmpty, i);
+        if (cur == kEmpty) { break; }
+      }
+      // a claimed slot only ever holds the indices of one value
+      if (labels_equal(in[cur], key)) {
+        if (i < cur) { atomicMin(slots + s, i); }
+        break;
+      }
+      s = s + 1 == capacity ? 0 : s + 1;
+    }
+  }
+}
+
+/**
+ * Count the occupied slots and, when `slot_ids` is given, write their positions (in no particular
+ * order), one atomic per warp.
+ */
+template <typename IdxT>
+RAFT_KERNEL hash_labels_compact_kernel(const IdxT* slots,
+                                       IdxT capacity,
+                                       IdxT* count,
+                                       IdxT* slot_ids)
+{
+  constexpr IdxT kEmpty = std::numeric_limits<IdxT>::max();
+  const int lane        = threadIdx.x % raft::WarpSize;
+  // the bound of the loop is uniform over the block, for the ballots
+  for (IdxT base = IdxT(blockIdx.x) * blockDim.x; base < capacity;
+       base += IdxT(blockDim.x) * gridDim.x) {
+    IdxT s        = base + threadIdx.x;
+    bool occupied = s < capacity && slots[s] != kEmpty;
+    uint32_t mask = __ballot_sync(0xffffffff, occupied);
+    if (mask == 0) { continue; }
+    IdxT pos = 0;
+    if (lane == 0) { pos = atomicAdd(count, IdxT(__popc(mask))); }
+    pos = raft::shfl(pos, 0);
+    if (occupied && slot_ids != nullptr) {
+      slot_ids[pos + __popc(mask & ((1u << lane) - 1))] = s;
+    }
+  }
+}
+
+/** The label of every value not filtered out, from the slots holding the labels. */
+template <typename Type, typename IdxT, typename Lambda>
+RAFT_KERNEL hash_labels_map_kernel(const Type* in,
+                                   IdxT n,
+                                   const IdxT* slots,
+                                   IdxT capacity,
+                                   const Type* unique,
+                                   Type* out,
+                                   Lambda filter_op,
+                                   bool zero_based)
+{
+  for (IdxT i = IdxT(blockIdx.x) * blockDim.x + threadIdx.x; i < n;
+       i += IdxT(blockDim.x) * gridDim.x) {
+    Type key = in[i];
+    if (filter_op(key)) { continue; }
+    IdxT s = IdxT(label_hash(key) % capacity);
+    while (!labels_equal(unique[slots[s]], key)) {
+      s = s + 1 == capacity ? 0 : s + 1;
+    }
+    out[i] = Type(slots[s] + !zero_based);
+  }
+}
+
+template <typename KeyT, typename IdxT>
+void hash_labels_sort_pairs(
+  KeyT* keys_in, KeyT* keys_out, IdxT* values_in, IdxT* values_out, int n, cudaStream_t stream)
+{
+  size_t bytes = 0;
+  RAFT_CUDA_TRY(cub::DeviceRadixSort::SortPairs(
+    nullptr, bytes, keys_in, keys_out, values_in, values_out, n, 0, sizeof(KeyT) * 8, stream));
+  rmm::device_uvector<char> cub_storage(bytes, stream);
+  RAFT_CUDA_TRY(cub::DeviceRadixSort::SortPairs(cub_storage.data(),
+                                                bytes,
+                                                keys_in,
+                                                keys_out,
+                                                values_in,
+                                                values_out,
+                                                n,
+                                                0,
+                                                sizeof(KeyT) * 8,
+                                                stream));
+}
+
+template <typename Type, typename IdxT, typename Lambda>
+size_t hash_relabel_impl(Type* out,
+                         const Type* in,
+                         size_t N,
+                         cudaStream_t stream,
+                         Lambda filter_op,
+                         relabel_order order,
+                         bool zero_based,
+                         rmm::device_uvector<Type>& unique)
+{
+  IdxT n        = IdxT(N);
+  IdxT capacity = n + n / 2 + 1;
+  auto blocks   = [](IdxT len) {
+    return int(std::min<IdxT>(raft::ceildiv<IdxT>(len, kHashLabelsTPB), IdxT(65536)));
+  };
+
+  rmm::device_uvector<IdxT> slots(capacity, stream);
+  RAFT_CUDA_TRY(cudaMemsetAsync(slots.data(), 0xff, capacity * sizeof(IdxT), stream));
+  hash_labels_insert_kernel<Type, IdxT>
+    <<<blocks(n), kHashLabelsTPB, 0, stream>>>(in, n, slots.data(), capacity);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+  rmm::device_scalar<IdxT> d_count(0, stream);
+  hash_labels_compact_kernel<IdxT><<<blocks(capacity), kHashLabelsTPB, 0, stream>>>(
+    slots.data(), capacity, d_count.data(), nullptr);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  IdxT n_unique = d_count.value(stream);
+  RAFT_EXPECTS(n_unique <= IdxT(INT_MAX), "Too many distinct labels for the sort");
+
+  rmm::device_uvector<IdxT> slot_ids(n_unique, stream);
+  rmm::device_uvector<IdxT> sorted_slots(n_unique, stream);
+  d_count.set_value_to_zero_async(stream);
+  hash_labels_compact_kernel<IdxT><<<blocks(capacity), kHashLabelsTPB, 0, stream>>>(
+    slots.data(), capacity, d_count.data(), slot_ids.data());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+  unique.resize(n_unique, stream);
+  auto policy     = rmm::exec_policy(stream);
+  IdxT* slots_ptr = slots.data();
+  if (order == relabel_order::SORTED) {
+    rmm::device_uvector<Type> keys(n_unique, stream);
+    thrust::transform(policy,
+                      slot_ids.begin(),
+                      slot_ids.end(),
+                      keys.begin(),
+                      [in, slots_ptr] __device__(IdxT s) { return in[slots_ptr[s]]; });
+    hash_labels_sort_pairs(
+      keys.data(), unique.data(), slot_ids.data(), sorted_slots.data(), int(n_unique), stream);
+  } else {
+    rmm::device_uvector<IdxT> first(n_unique, stream);
+    rmm::device_uvector<IdxT> sorted_first(n_unique, stream);
+    thrust::transform(policy,
+                      slot_ids.begin(),
+                      slot_ids.end(),
+                      first.begin(),
+                      [slots_ptr] __device__(IdxT s) { return slots_ptr[s]; });
+    hash_labels_sort_pairs(first.data(),
+                           sorted_first.data(),
+                           slot_ids.data(),
+                           sorted_slots.data(),
+                           int(n_unique),
+                           stream);
+    thrust::transform(policy,
+                      sorted_first.begin(),
+                      sorted_first.end(),
+                      unique.begin(),
+                      [in] __device__(IdxT i) { return in[i]; });
+  }
+
+  // the slots now hold the labels, and the values to compare with are in unique
+  IdxT* sorted_ptr = sorted_slots.data();
+  thrust::for_each_n(policy,
+                     thrust::make_counting_iterator<IdxT>(0),
+                     n_unique,
+                     [slots_ptr, sorted_ptr] __device__(IdxT r) { slots_ptr[sorted_ptr[r]] = r; });
+
+  if (out != nullptr) {
+    hash_labels_map_kernel<Type, IdxT, Lambda><<<blocks(n), kHashLabelsTPB, 0, stream>>>(
+      in, n, slots.data(), capacity, unique.data(), out, filter_op, zero_based);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+  return size_t(n_unique);
+}
+
+/**
+ * The distinct values of `in` into `unique` (in the given order) and, when `out` is given, the
+ * label of every value not filtered out, in O(N) expected work.
+ */
+template <typename Type, typename Lambda>
+size_t hash_relabel(Type* out,
+                    const Type* in,
+                    size_t N,
+                    cudaStream_t stream,
+                    Lambda filter_op,
+                    relabel_order order,
+                    bool zero_based,
+                    rmm::device_uvector<Type>& unique)
+{
+  static_assert(std::is_arithmetic_v<Type> && sizeof(Type) <= sizeof(uint64_t),
+                "The hash-based relabeling supports the arithmetic types");
+  if (N == 0) {
+    unique.resize(0, stream);
+    return 0;
+  }
+  // 32-bit slots as long as the capacity and the grid strides cannot overflow them
+  if (N < (size_t(1) << 31)) {
+    return hash_relabel_impl<Type, unsigned int>(
+      out, in, N, stream, filter_op, order, zero_based, unique);
+  }
+  return hash_relabel_impl<Type, unsigned long long>(
+    out, in, N, stream, filter_op, order, zero_based, unique);
+}
+
+};  // namespace detail
+};  // namespace label
+};  // end namespace raft
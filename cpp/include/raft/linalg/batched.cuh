@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/batched.cuh"
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resources.hpp>
+
+namespace raft::linalg {
+
+/**
+ * @defgroup batched_linalg Batches of small dense problems
+ *
+ * The functions below solve many independent problems of the same shape in a single call, as
+ * the strided-batched routines of cuBLAS. The inputs are 3-D row-major views
+ * [batch_size, n_rows, n_cols] (the matrices stored one after the other, each in row-major
+ * order). The problems of at most 64 rows and columns (which fit in the shared memory) are solved
+ * by a single kernel, one thread block per problem; the larger ones by cuBLAS / cuSOLVER.
+ * @{
+ */
+
+/** A batch of row-major matrices [batch_size, n_rows, n_cols]. */
+template <typename ElementType, typename IndexType>
+using batched_matrix_view =
+  raft::device_mdspan<ElementType, raft::extent_3d<IndexType>, raft::row_major>;
+
+/**
+ * @brief The batched matrix products C[b] = alpha * A[b] * B[b] + beta * C[b].
+ *
+ * @param[in] handle raft::resources
+ * @param[in] A the left operands [batch_size, m, k]
+ * @param[in] B the right operands [batch_size, k, n]
+ * @param[inout] C the results [batch_size, m, n] (only read when beta != 0)
+ * @param[in] alpha the scaling of the products
+ * @param[in] beta the scaling of the input values of C
+ */
+template <typename ElementType, typename IndexType>
+void batched_gemm(raft::resources const& handle,
+                  batched_matrix_view<const ElementType, IndexType> A,
+                  batched_matrix_view<const ElementType, IndexType> B,
+                  batched_matrix_view<ElementType, IndexType> C,
+                  ElementType alpha = ElementType(1),
+                  ElementType beta  = ElementType(0))
+{
+  RAFT_EXPECTS(A.extent(0) == B.extent(0) && A.extent(0) == C.extent(0),
+               "The batches should have the same size");
+  RAFT_EXPECTS(A.extent(2) == B.extent(1), "Inner dimensions of A and B should match");
+  RAFT_EXPECTS(A.extent(1) == C.extent(1) && B.extent(2) == C.extent(2),
+               "C should have the shape of the products");
+  detail::batched_gemm(handle,
+                       A.data_handle(),
+                       B.data_handle(),
+                       C.data_handle(),
+                       int(A.extent(0)),
+                       int(A.extent(1)),
+                       int(B.extent(2)),
+                       int(A.extent(2)),
+                       alpha,
+                       beta);
+}
+
+/**
+ * @brief The batched matrix-vector products y[b] = alpha * A[b] * x[b] + beta * y[b].
+ *
+ * @param[in] handle raft::resources
+ * @param[in] A the matrices [batch_size, m, n]
+ * @param[in] x the vectors [batch_size, n]
+ * @param[inout] y the results [batch_size, m] (only read when beta != 0)
+ * @param[in] alpha the scaling of the products
+ * @param[in] beta the scaling of the input values of y
+ */
+template <typename ElementType, typename IndexType>
+void batched_gemv(raft::resources const& handle,
+                  batched_matrix_view<const ElementType, IndexType> A,
+                  raft::device_matrix_view<const ElementType, IndexType, raft::row_major> x,
+                  raft::device_matrix_view<ElementType, IndexType, raft::row_major> y,
+                  ElementType alpha = ElementType(1),
+                  ElementType beta  = ElementType(0))
+{
+  RAFT_EXPECTS(A.extent(0) == x.extent(0) && A.extent(0) == y.extent(0),
+               "The batches should have the same size");
+  RAFT_EXPECTS(A.extent(2) == x.extent(1), "The vectors x should have one element per column");
+  RAFT_EXPECTS(A.extent(1) == y.extent(1), "The vectors y should have one element per row");
+  // x[b] and y[b] are the [n, 1] and [m, 1] matrices
+  detail::batched_gemm(handle,
+                       A.data_handle(),
+                       x.data_handle(),
+                       y.data_handle(),
+                       int(A.extent(0)),
+                       int(A.extent(1)),
+                       1,
+                       int(A.extent(2)),
+                       alpha,
+                       beta);
+}
+
+/**
+ * @brief The batched Cholesky factorizations A[b] = L[b] * L[b]^T of symmetric positive definite
+ * matrices, in place.
+ *
+ * Only the lower triangles are read, and they are overwritten by the lower triangular factors;
+ * the strictly upper triangles are left untouched. As cuSOLVER, `info[b]` is 0 when the
+ * factorization of A[b] succeeded, or the order i of its leading minor which is not positive
+ * definite (the factorization stopped there).
+ *
+ * @param[in] handle raft::resources
+ * @param[inout] A the matrices [batch_size, n, n], replaced by their factors
+ * @param[out] info the status of every factorization [batch_size]
+ */
+template <typename ElementType, typename IndexType>
+void batched_cholesky(raft::resources const& handle,
+                      batched_matrix_view<ElementType, IndexType> A,
+                      raft::device_vector_view<int, IndexType> info)
+{
+  RAFT_EXPECTS(A.extent(1) == A.extent(2), "The matrices should be square");
+  RAFT_EXPECTS(info.extent(0) == A.extent(0), "info should have one element per matrix");
+  detail::batched_cholesky(
+    handle, A.data_handle(), info.data_handle(), int(A.extent(0)), int(A.extent(1)));
+}
+
+/**
+ * @brief The batched thin QR decompositions A[b] = Q[b] * R[b], m >= n, of matrices of full
+ * column rank.
+ *
+ * @param[in] handle raft::resources
+ * @param[in] A the matrices [batch_size, m, n]
+ * @param[out] Q the factors with orthonormal columns [batch_size, m, n]
+ * @param[out] R the upper triangular factors [batch_size, n, n]
+ */
+template <typename ElementType, typename IndexType>
+void batched_qr(raft::resources const& handle,
+                batched_matrix_view<const ElementType, IndexType> A,
+                batched_matrix_view<ElementType, IndexType> Q,
+                batched_matrix_view<ElementType, IndexType> R)
+{
+  RAFT_EXPECTS(A.extent(1) >= A.extent(2), "QR decomposition expects n_rows >= n_cols.");
+  RAFT_EXPECTS(Q.extent(0) == A.extent(0) && Q.extent(1) == A.extent(1) &&
+                 Q.extent(2) == A.extent(2),
+               "Q should have the shape of A");
+  RAFT_EXPECTS(R.extent(0) == A.extent(0) && R.extent(1) == A.extent(2) &&
+                 R.extent(2) == A.extent(2),
+               "R should be [batch_size, n_cols, n_cols]");
+  detail::batched_qr(handle,
+                     A.data_handle(),
+                     Q.data_handle(),
+                     R.data_handle(),
+                     int(A.extent(0)),
+                     int(A.extent(1)),
+                     int(A.extent(2)));
+}
+
+/**
+ * @brief The batched linear least squares solutions w[b] = argmin ||A[b] * w - b[b]||_2, m >= n,
+ * of matrices of full column rank.
+ *
+ * The small problems are solved by the QR decomposition of the augmented matrices [A[b] b[b]],
+ * as `batched_qr`; the larger ones by cuBLAS `gelsBatched`.
+ *
+ * @param[in] handle raft::resources
+ * @param[in] A the matrices [batch_size, m, n]
+ * @param[in] b the targets [batch_size, m]
+ * @param[out] w the solutions [batch_size, n]
+ */
+template <typename ElementType, typename IndexType>
+void batched_lstsq(raft::resources const& handle,
+                   batched_matrix_view<const ElementType, IndexType> A,
+                   raft::device_matrix_view<const ElementType, IndexType, raft::row_major> b,
+                   raft::device_matrix_view<ElementType, IndexType, raft::row_major> w)
+{
+  RAFT_EXPECTS(A.extent(1) >= A.extent(2), "Least squares expects n_rows >= n_cols.");
+  RAFT_EXPECTS(b.extent(0) == A.extent(0) && b.extent(1) == A.extent(1),
+               "b should be [batch_size, n_rows]");
+  RAFT_EXPECTS(w.extent(0) == A.extent(0) && w.extent(1) == A.extent(2),
+               "w should be [batch_size, n_cols]");
+  detail::batched_lstsq(handle,
+                        A.data_handle(),
+                        b.data_handle(),
+                        w.data_handle(),
+                        int(A.extent(0)),
+                        int(A.extent(1)),
+                        int(A.extent(2)));
+}
+
+/**
+ * @brief The batched eigendecompositions A[b] = V[b] * diag(W[b]) * V[b]^T of symmetric
+ * matrices, by the Jacobi method.
+ *
+ * The eigenvalues W[b] are in ascending order and the eigenvectors are the columns of V[b]. The
+ * sweeps of rotations stop when the off-diagonal norm of the rotated matrix is at most tol times
+ * its norm, or after `sweeps` sweeps.
+ *
+ * @param[in] handle raft::resources
+ * @param[in] A the symmetric matrices [batch_size, n, n]
+ * @param[out] W the eigenvalues [batch_size, n]
+ * @param[out] V the eigenvectors [batch_size, n, n]
+ * @param[in] tol the relative tolerance of the off-diagonal norm
+ * @param[in] sweeps the largest number of sweeps
+ */
+template <typename ElementType, typename IndexType>
+void batched_eig_jacobi(raft::resources const& handle,
+                        batched_matrix_view<const ElementType, IndexType> A,
+                        raft::device_matrix_view<ElementType, IndexType, raft::row_major> W,
+                        batched_matrix_view<ElementType, IndexType> V,
+                        ElementType tol = 1.e-7,
+                        int sweeps      = 15)
+{
+  RAFT_EXPECTS(A.extent(1) == A.extent(2), "The matrices should be square");
+  RAFT_EXPECTS(W.extent(0) == A.extent(0) && W.extent(1) == A.extent(1),
+               "W should be [batch_size, n]");
+  RAFT_EXPECTS(V.extent(0) == A.extent(0) && V.extent(1) == A.extent(1) &&
+                 V.extent(2) == A.extent(2),
+               "V should have the shape of A");
+  detail::batched_eig_jacobi(handle,
+                             A.data_handle(),
+                             W.data_handle(),
+                             V.data_handle(),
+                             int(A.extent(0)),
+                             int(A.extent(1)),
+                             tol,
+                             sweeps);
+}
+
+/** @} */
+
+}  // namespace raft::linalg
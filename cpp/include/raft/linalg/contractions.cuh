@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,6 +20,8 @@
 
 #include "detail/contractions.cuh"
 
+#include <cstdint>
+
 namespace raft {
 namespace linalg {
 
@@ -164,6 +166,19 @@ struct Policy4x4<double, _veclen> {
   typedef KernelPolicy<double, _veclen, 16, 4, 4, 16, 16> Policy;
   typedef ColKernelPolicy<double, _veclen, 16, 4, 4, 16, 16> ColPolicy;
 };
+
+// 32-bit words of packed inputs (bit-packed binary codes or four int8 values)
+template <int _veclen>
+struct Policy4x4<uint32_t, _veclen> {
+  typedef KernelPolicy<uint32_t, _veclen, 32, 4, 4, 16, 16> Policy;
+  typedef ColKernelPolicy<uint32_t, _veclen, 32, 4, 4, 16, 16> ColPolicy;
+};
+
+template <int _veclen>
+struct Policy4x4<int32_t, _veclen> {
+  typedef KernelPolicy<int32_t, _veclen, 32, 4, 4, 16, 16> Policy;
+  typedef ColKernelPolicy<int32_t, _veclen, 32, 4, 4, 16, 16> ColPolicy;
+};
 /** @} */
 
 /**
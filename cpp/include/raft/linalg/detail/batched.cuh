@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cublas_wrappers.hpp"
+#include "cusolver_wrappers.hpp"
+#include "eig.cuh"
+#include "qr.cuh"
+#include "transpose.cuh"
+
+#include <raft/core/resource/cublas_handle.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cusolver_dn_handle.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/reduction.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace raft::linalg::detail {
+
+/*
+ * The batched problems below are stored one after the other, every matrix in row-major order.
+ * The small ones are solved by one thread block per problem, with the matrices in the shared
+ * memory and the accumulators in the registers; the others go to cuBLAS / cuSOLVER.
+ */
+
+/** The largest dimension of the problems solved by one thread block. */
+constexpr int kBatchedSmallDim = 64;
+/** The shared memory the small kernels may use (for the matrices of one problem). */
+constexpr size_t kBatchedSmallSmem = 48 * 1024;
+constexpr int kBatchedTpb          = 256;
+
+template <typename T>
+constexpr auto batched_small_fits(int max_dim, size_t n_elements) -> bool
+{
+  return max_dim <= kBatchedSmallDim && n_elements * sizeof(T) <= kBatchedSmallSmem;
+}
+
+/** C[b] = alpha * A[b] B[b] + beta * C[b], A[b]: [m, k], B[b]: [k, n]. */
+template <typename T>
+RAFT_KERNEL batched_gemm_small_kernel(
+  const T* A, const T* B, T* C, int m, int n, int k, T alpha, T beta)
+{
+  extern __shared__ char smem_buf[];
+  T* a     = reinterpret_cast<T*>(smem_buf);
+  T* b     = a + m * k;
+  size_t p = blockIdx.x;
+  A += p * m * k;
+  B += p * k * n;
+  C += p * m * n;
+  for (int e = threadIdx.x; e < m * k; e += blockDim.x) {
+    a[e] = A[e];
+  }
+  for (int e = threadIdx.x; e < k * n; e += blockDim.x) {
+    b[e] = B[e];
+  }
+  __syncthreads();
+  for (int e = threadIdx.x; e < m * n; e += blockDim.x) {
+    int i = e / n;
+    int j = e % n;
+    T acc = 0;
+    for (int l = 0; l < k; l++) {
+      acc += a[i * k + l] * b[l * n + j];
+    }
+    C[e] = beta == T(0) ? alpha * acc : alpha * acc + beta * C[e];
+  }
+}
+
+template <typename T>
+void batched_gemm(raft::resources const& handle,
+                  const T* A,
+                  const T* B,
+                  T* C,
+                  int batch_size,
+                  int m,
+                  int n,
+                  int k,
+                  T alpha,
+                  T beta)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  if (batch_size == 0 || m == 0 || n == 0) { return; }
+  if (batched_small_fits<T>(std::max({m, n, k}), size_t(m) * k + size_t(k) * n)) {
+    size_t smem = (size_t(m) * k + size_t(k) * n) * sizeof(T);
+    batched_gemm_small_kernel<<<batch_size, kBatchedTpb, smem, stream>>>(
+      A, B, C, m, n, k, alpha, beta);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    return;
+  }
+  // row-major C = A B is the column-major C^T = B^T A^T
+  RAFT_CUBLAS_TRY(cublasgemmStridedBatched(resource::get_cublas_handle(handle),
+                                           CUBLAS_OP_N,
+                                           CUBLAS_OP_N,
+                                           n,
+                                           m,
+                                           k,
+                                           &alpha,
+                                           B,
+                                           n,
+                                           int64_t(k) * n,
+                                           A,
+                                           k,
+                                           int64_t(m) * k,
+                                           &beta,
+                                           C,
+                                           n,
+                                           int64_t(m) * n,
+                                           batch_size,
+                                           stream));
+}
+
+/**
+ * The lower Cholesky factors L[b] L[b]^T = A[b] in place, A[b]: [n, n]. The strictly upper
+ * triangles are left untouched and, as cuSOLVER, info[b] > 0 is the order of the leading minor
+ * which is not positive definite (the factorization of the matrix stops there).
+ */
+template <typename T>
+RAFT_KERNEL batched_cholesky_small_kernel(T* A, int n, int* info)
+{
+  extern __shared__ char smem_buf[];
+  T* a     = reinterpret_cast<T*>(smem_buf);
+  size_t p = blockIdx.x;
+  A += p * n * n;
+  for (int e = threadIdx.x; e < n * n; e += blockDim.x) {
+    a[e] = A[e];
+  }
+  int status = 0;
+  for (int c = 0; c < n; c++) {
+    __syncthreads();
+    T d = a[c * n + c];
+    if (!(d > T(0))) {
+      status = c + 1;
+      break;
+    }
+    T l_cc = raft::sqrt(d);
+    __syncthreads();
+    for (int i = c + threadIdx.x; i < n; i += blockDim.x) {
+      a[i * n + c] = i == c ? l_cc : a[i * n + c] / l_cc;
+    }
+    __syncthreads();
+    // the trailing lower triangle
+    int rest = n - c - 1;
+    for (int e = threadIdx.x; e < rest * rest; e += blockDim.x) {
+      int i = c + 1 + e / rest;
+      int j = c + 1 + e % rest;
+      if (j <= i) { a[i * n + j] -= a[i * n + c] * a[j * n + c]; }
+    }
+  }
+  __syncthreads();
+  for (int e = threadIdx.x; e < n * n; e += blockDim.x) {
+    if (e % n <= e / n) { A[e] = a[e]; }
+  }
+  if (threadIdx.x == 0) { info[p] = status; }
+}
+
+template <typename T>
+void batched_cholesky(raft::resources const& handle, T* A, int* info, int batch_size, int n)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  if (batch_size == 0 || n == 0) { return; }
+  if (batched_small_fits<T>(n, size_t(n) * n)) {
+    batched_cholesky_small_kernel<<<batch_size, kBatchedTpb, size_t(n) * n * sizeof(T), stream>>>(
+      A, n, info);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    return;
+  }
+  std::vector<T*> h_ptrs(batch_size);
+  for (int p = 0; p < batch_size; p++) {
+    h_ptrs[p] = A + size_t(p) * n * n;
+  }
+  rmm::device_uvector<T*> ptrs(batch_size, stream);
+  raft::update_device(ptrs.data(), h_ptrs.data(), batch_size, stream);
+  // the row-major lower triangle is the column-major upper one: A = U^T U, U = L^T
+  RAFT_CUSOLVER_TRY(cusolverDnpotrfBatched(resource::get_cusolver_dn_handle(handle),
+                                           CUBLAS_FILL_MODE_UPPER,
+                                           n,
+                                           ptrs.data(),
+                                           n,
+                                           info,
+                                           batch_size,
+                                           stream));
+}
+
+/**
+ * The thin QR decomposition of the matrix q [m, n] in the shared memory, m >= n, by the modified
+ * Gram-Schmidt process with one step of re-orthogonalization (the columns of Q stay orthogonal to
+ * the working precision): q is replaced by Q and r [n, n] by R. One warp per column of the
+ * trailing matrix. It ends with a barrier.
+ */
+template <typename T>
+__device__ void block_mgs_qr(T* q, T* r, int m, int n)
+{
+  int warp_id  = threadIdx.x / WarpSize;
+  int lane_id  = threadIdx.x % WarpSize;
+  int n_warps  = blockDim.x / WarpSize;
+  auto project = [=](int j, int l) {
+    T dot = 0;
+    for (int i = lane_id; i < m; i += WarpSize) {
+      dot += q[i * n + j] * q[i * n + l];
+    }
+    dot = raft::warpReduce(dot);
+    for (int i = lane_id; i < m; i += WarpSize) {
+      q[i * n + l] -= dot * q[i * n + j];
+    }
+    __syncwarp();
+    return dot;
+  };
+  for (int e = threadIdx.x; e < n * n; e += blockDim.x) {
+    r[e] = 0;
+  }
+  __syncthreads();
+  for (int j = 0; j < n; j++) {
+    if (warp_id == 0) {
+      T sq = 0;
+      for (int i = lane_id; i < m; i += WarpSize) {
+        sq += q[i * n + j] * q[i * n + j];
+      }
+      sq = raft::warpReduce(sq);
+      if (lane_id == 0) { r[j * n + j] = raft::sqrt(sq); }
+    }
+    __syncthreads();
+    T r_jj = r[j * n + j];
+    for (int i = threadIdx.x; i < m; i += blockDim.x) {
+      q[i * n + j] /= r_jj;
+    }
+    __syncthreads();
+    for (int l = j + 1 + warp_id; l < n; l += n_warps) {
+      T r_jl = project(j, l);
+      r_jl += project(j, l);
+      if (lane_id == 0) { r[j * n + l] = r_jl; }
+    }
+    __syncthreads();
+  }
+}
+
+/** The thin QR decompositions A[b] = Q[b] R[b], A[b], Q[b]: [m, n], R[b]: [n, n], m >= n. */
+template <typename T>
+RAFT_KERNEL batched_qr_small_kernel(const T* A, T* Q, T* R, int m, int n)
+{
+  extern __shared__ char smem_buf[];
+  T* q     = reinterpret_cast<T*>(smem_buf);
+  T* r     = q + m * n;
+  size_t p = blockIdx.x;
+  A += p * m * n;
+  Q += p * m * n;
+  R += p * n * n;
+  for (int e = threadIdx.x; e < m * n; e += blockDim.x) {
+    q[e] = A[e];
+  }
+  __syncthreads();
+  block_mgs_qr(q, r, m, n);
+  for (int e = threadIdx.x; e < m * n; e += blockDim.x) {
+    Q[e] = q[e];
+  }
+  for (int e = threadIdx.x; e < n * n; e += blockDim.x) {
+    R[e] = r[e];
+  }
+}
+
+template <typename T>
+void batched_qr(
+  raft::resources const& handle, const T* A, T* Q, T* R, int batch_size, int m, int n)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  if (batch_size == 0 || n == 0) { return; }
+  size_t mn = size_t(m) * n;
+  size_t nn = size_t(n) * n;
+  if (batched_small_fits<T>(m, mn + nn)) {
+    batched_qr_small_kernel<<<batch_size, kBatchedTpb, (mn + nn) * sizeof(T), stream>>>(
+      A, Q, R, m, n);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    return;
+  }
+  // one (column-major) cuSOLVER QR per problem: their size makes them compute-bound
+  rmm::device_uvector<T> a_col(mn, stream);
+  rmm::device_uvector<T> q_col(mn, stream);
+  rmm::device_uvector<T> r_col(nn, stream);
+  for (int p = 0; p < batch_size; p++) {
+    transpose(handle, const_cast<T*>(A) + p * mn, a_col.data(), n, m, stream);
+    qrGetQR(handle, a_col.data(), q_col.data(), r_col.data(), m, n, stream);
+    transpose(handle, q_col.data(), Q + p * mn, m, n, stream);
+    transpose(handle, r_col.data(), R + p * nn, n, n, stream);
+  }
+}
+
+/**
+ * The least squares solutions W[b] = argmin_w ||A[b] w - B[b]||, A[b]: [m, n], B[b]: [m], m >= n.
+ *
+ * The QR decomposition of the augmented matrix [A[b] B[b]] gives R_A and Q^T B[b] in its R factor
+ * (the first n rows of its last column), and the triangular system R_A w = Q^T B[b] is solved by
+ * back substitution, one warp per problem.
+ */
+template <typename T>
+RAFT_KERNEL batched_lstsq_small_kernel(const T* A, const T* B, T* W, int m, int n)
+{
+  extern __shared__ char smem_buf[];
+  const int n1 = n + 1;
+  T* q         = reinterpret_cast<T*>(smem_buf);
+  T* r         = q + m * n1;
+  size_t p     = blockIdx.x;
+  A += p * m * n;
+  B += p * m;
+  W += p * n;
+  for (int e = threadIdx.x; e < m * n1; e += blockDim.x) {
+    int i = e / n1;
+    int j = e % n1;
+    q[e]  = j < n ? A[i * n + j] : B[i];
+  }
+  __syncthreads();
+  // the last column of Q is not used (and not defined when B[b] is in the range of A[b])
+  block_mgs_qr(q, r, m, n1);
+  if (threadIdx.x < WarpSize) {
+    int lane_id = threadIdx.x;
+    for (int i = n - 1; i >= 0; i--) {
+      T acc = 0;
+      for (int j = i + 1 + lane_id; j < n; j += WarpSize) {
+        acc += r[i * n1 + j] * r[j * n1 + n];
+      }
+      acc = raft::warpReduce(acc);
+      if (lane_id == 0) { r[i * n1 + n] = (r[i * n1 + n] - acc) / r[i * n1 + i]; }
+      __syncwarp();
+    }
+  }
+  __syncthreads();
+  for (int i = threadIdx.x; i < n; i += blockDim.x) {
+    W[i] = r[i * n1 + n];
+  }
+}
+
+template <typename T>
+void batched_lstsq(
+  raft::resources const& handle, const T* A, const T* B, T* W, int batch_size, int m, int n)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  if (batch_size == 0 || n == 0) { return; }
+  size_t mn1 = size_t(m) * (n + 1);
+  size_t nn1 = size_t(n + 1) * (n + 1);
+  if (batched_small_fits<T>(std::max(m, n + 1), mn1 + nn1)) {
+    batched_lstsq_small_kernel<<<batch_size, kBatchedTpb, (mn1 + nn1) * sizeof(T), stream>>>(
+      A, B, W, m, n);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    return;
+  }
+  // cuBLAS gelsBatched (Householder QR) on the column-major copies of the problems
+  const int64_t mn = int64_t(m) * n;
+  rmm::device_uvector<T> a_col(batch_size * mn, stream);
+  rmm::device_uvector<T> c(size_t(batch_size) * m, stream);
+  raft::linalg::map_offset(handle,
+                           raft::make_device_vector_view<T, int64_t>(a_col.data(), a_col.size()),
+                           [A, m, n, mn] __device__(int64_t e) {
+                             int64_t p = e / mn;
+                             int64_t i = e % m;
+                             int64_t j = (e % mn) / m;
+                             return A[p * mn + i * n + j];
+                           });
+  raft::copy(c.data(), B, c.size(), stream);
+  std::vector<T*> h_ptrs(2 * size_t(batch_size));
+  for (int p = 0; p < batch_size; p++) {
+    h_ptrs[p]              = a_col.data() + p * mn;
+    h_ptrs[batch_size + p] = c.data() + size_t(p) * m;
+  }
+  rmm::device_uvector<T*> ptrs(h_ptrs.size(), stream);
+  raft::update_device(ptrs.data(), h_ptrs.data(), h_ptrs.size(), stream);
+  int info = 0;
+  RAFT_CUBLAS_TRY(cublasgelsBatched(resource::get_cublas_handle(handle),
+                                    CUBLAS_OP_N,
+                                    m,
+                                    n,
+                                    1,
+                                    ptrs.data(),
+                                    m,
+                                    ptrs.data() + batch_size,
+                                    m,
+                                    &info,
+                                    nullptr,
+                                    batch_size,
+                                    stream));
+  RAFT_EXPECTS(info == 0, "batched_lstsq: invalid argument %d of gelsBatched", -info);
+  // the solutions are the first n elements of the overwritten right-hand sides
+  RAFT_CUDA_TRY(cudaMemcpy2DAsync(W,
+                                  sizeof(T) * n,
+                                  c.data(),
+                                  sizeof(T) * m,
+                                  sizeof(T) * n,
+                                  batch_size,
+                                  cudaMemcpyDeviceToDevice,
+                                  stream));
+}
+
+/**
+ * The eigendecompositions A[b] = V[b] diag(W[b]) V[b]^T of symmetric A[b]: [n, n] by the cyclic
+ * Jacobi method, the eigenvalues W[b] ascending and the eigenvectors the columns of V[b].
+ *
+ * The n (n + 1 if n is odd, with a dummy index) indices are paired by the round-robin ordering,
+ * so that the n / 2 rotations of a round are disjoint and applied at once: first to the rows of
+ * a (J^T a), then to its columns and to those of v (a J, v J). The sweeps stop when the
+ * off-diagonal norm of a is at most tol times its norm.
+ */
+template <typename T>
+RAFT_KERNEL batched_eig_jacobi_small_kernel(const T* A, T* W, T* V, int n, T tol, int sweeps)
+{
+  extern __shared__ char smem_buf[];
+  __shared__ char reduce_buf[sizeof(T) * (kBatchedTpb / WarpSize)];
+  __shared__ bool converged;
+  int m    = n + (n & 1);
+  T* a     = reinterpret_cast<T*>(smem_buf);
+  T* v     = a + n * n;
+  T* cs    = v + n * n;  // the cosine and the sine of the rotation of every pair of a round
+  size_t p = blockIdx.x;
+  A += p * n * n;
+  W += p * n;
+  V += p * n * n;
+  for (int e = threadIdx.x; e < n * n; e += blockDim.x) {
+    a[e] = A[e];
+    v[e] = e / n == e % n ? T(1) : T(0);
+  }
+  // the index at the position i of the round-robin table of the round r; the pair k of the round
+  // is made of the positions k and m - 1 - k
+  auto player = [m](int r, int i) { return i == 0 ? 0 : (i - 1 + r) % (m - 1) + 1; };
+  for (int sweep = 0; sweep < sweeps; sweep++) {
+    __syncthreads();
+    T off = 0, all = 0;
+    for (int e = threadIdx.x; e < n * n; e += blockDim.x) {
+      T sq = a[e] * a[e];
+      all += sq;
+      if (e / n != e % n) { off += sq; }
+    }
+    off = raft::blockReduce(off, reduce_buf);
+    __syncthreads();
+    all = raft::blockReduce(all, reduce_buf);
+    if (threadIdx.x == 0) { converged = off <= tol * tol * all; }
+    __syncthreads();
+    if (converged) { break; }
+    for (int r = 0; r < m - 1; r++) {
+      for (int k = threadIdx.x; k < m / 2; k += blockDim.x) {
+        int i = player(r, k);
+        int j = player(r, m - 1 - k);
+        T c   = 1, s = 0;
+        if (i < n && j < n && a[i * n + j] != T(0)) {
+          T tau = (a[j * n + j] - a[i * n + i]) / (T(2) * a[i * n + j]);
+          T t   = T(1) / (raft::abs(tau) + raft::sqrt(T(1) + tau * tau));
+          t     = tau < T(0) ? -t : t;
+          c     = T(1) / raft::sqrt(T(1) + t * t);
+          s     = t * c;
+        }
+        cs[2 * k]     = c;
+        cs[2 * k + 1] = s;
+      }
+      __syncthreads();
+      for (int e = threadIdx.x; e < (m / 2) * n; e += blockDim.x) {
+        int k = e / n;
+        int l = e % n;
+        int i = player(r, k);
+        int j = player(r, m - 1 - k);
+        if (i >= n || j >= n) { continue; }
+        T c          = cs[2 * k], s = cs[2 * k + 1];
+        T x          = a[i * n + l], y = a[j * n + l];
+        a[i * n + l] = c * x - s * y;
+        a[j * n + l] = s * x + c * y;
+      }
+      __syncthreads();
+      for (int e = threadIdx.x; e < (m / 2) * n; e += blockDim.x) {
+        int k = e / n;
+        int l = e % n;
+        int i = player(r, k);
+        int j = player(r, m - 1 - k);
+        if (i >= n || j >= n) { continue; }
+        T c          = cs[2 * k], s = cs[2 * k + 1];
+        T x          = a[l * n + i], y = a[l * n + j];
+        a[l * n + i] = c * x - s * y;
+        a[l * n + j] = s * x + c * y;
+        x            = v[l * n + i];
+        y            = v[l * n + j];
+        v[l * n + i] = c * x - s * y;
+        v[l * n + j] = s * x + c * y;
+      }
+      __syncthreads();
+    }
+  }
+  __syncthreads();
+  // the eigenpairs in the ascending order of the eigenvalues
+  for (int c = threadIdx.x; c < n; c += blockDim.x) {
+    T w      = a[c * n + c];
+    int rank = 0;
+    for (int l = 0; l < n; l++) {
+      T w_l = a[l * n + l];
+      rank += w_l < w || (w_l == w && l < c);
+    }
+    W[rank] = w;
+    for (int i = 0; i < n; i++) {
+      V[i * n + rank] = v[i * n + c];
+    }
+  }
+}
+
+template <typename T>
+void batched_eig_jacobi(
+  raft::resources const& handle, const T* A, T* W, T* V, int batch_size, int n, T tol, int sweeps)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  if (batch_size == 0 || n == 0) { return; }
+  size_t nn = size_t(n) * n;
+  if (batched_small_fits<T>(n, 2 * nn + n + 1)) {
+    batched_eig_jacobi_small_kernel<<<batch_size,
+                                      kBatchedTpb,
+                                      (2 * nn + n + 1) * sizeof(T),
+                                      stream>>>(A, W, V, n, tol, sweeps);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    return;
+  }
+  // one cuSOLVER syevj per problem; the symmetric A[b] reads the same in column-major order
+  rmm::device_uvector<T> v_col(nn, stream);
+  for (int p = 0; p < batch_size; p++) {
+    eigJacobi(handle, A + p * nn, n, n, v_col.data(), W + size_t(p) * n, stream, tol, sweeps);
+    transpose(handle, v_col.data(), V + p * nn, n, n, stream);
+  }
+}
+
+}  // namespace raft::linalg::detail
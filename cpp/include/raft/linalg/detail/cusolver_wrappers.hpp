@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -887,6 +887,49 @@ inline cusolverStatus_t cusolverDnpotrf(cusolverDnHandle_t handle,  // NOLINT
 }
 /** @} */
 
+/**
+ * @defgroup potrfBatched cusolver batched potrf operations
+ * @{
+ */
+template <typename T>
+inline cusolverStatus_t cusolverDnpotrfBatched(cusolverDnHandle_t handle,  // NOLINT
+                                               cublasFillMode_t uplo,
+                                               int n,
+                                               T* Aarray[],
+                                               int lda,
+                                               int* infoArray,
+                                               int batchSize,
+                                               cudaStream_t stream);
+
+template <>
+inline cusolverStatus_t cusolverDnpotrfBatched(cusolverDnHandle_t handle,  // NOLINT
+                                               cublasFillMode_t uplo,
+                                               int n,
+                                               float* Aarray[],
+                                               int lda,
+                                               int* infoArray,
+                                               int batchSize,
+                                               cudaStream_t stream)
+{
+  RAFT_CUSOLVER_TRY(cusolverDnSetStream(handle, stream));
+  return cusolverDnSpotrfBatched(handle, uplo, n, Aarray, lda, infoArray, batchSize);
+}
+
+template <>
+inline cusolverStatus_t cusolverDnpotrfBatched(cusolverDnHandle_t handle,  // NOLINT
+                                               cublasFillMode_t uplo,
+                                               int n,
+                                               double* Aarray[],
+                                               int lda,
+                                               int* infoArray,
+                                               int batchSize,
+                                               cudaStream_t stream)
+{
+  RAFT_CUSOLVER_TRY(cusolverDnSetStream(handle, stream));
+  return cusolverDnDpotrfBatched(handle, uplo, n, Aarray, lda, infoArray, batchSize);
+}
+/** @} */
+
 /**
  * @defgroup potrs cusolver potrs operations
  * @{
@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/detail/lazy.cuh>
+#include <raft/util/cuda_dev_essentials.cuh>
+#include <raft/util/cuda_rt_essentials.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace raft::linalg::detail {
+
+/**
+ * A trivially copyable list of values of heterogeneous types (`std::tuple` is not trivially
+ * copyable, which the warp shuffles and the shared memory of the reductions require).
+ */
+template <typename... Ts>
+struct fused_list {};
+
+template <typename T, typename... Ts>
+struct fused_list<T, Ts...> {
+  T head;
+  fused_list<Ts...> tail;
+};
+
+inline auto make_fused_list() -> fused_list<> { return {}; }
+
+template <typename T, typename... Ts>
+auto make_fused_list(T head, Ts... tail) -> fused_list<T, Ts...>
+{
+  return {head, make_fused_list(tail...)};
+}
+
+/** The accumulators of a list of reductions. */
+template <typename... ReductionTs>
+using fused_acc_t = fused_list<typename ReductionTs::acc_type...>;
+
+inline auto fused_init(const fused_list<>&) -> fused_list<> { return {}; }
+
+template <typename R, typename... Rs>
+auto fused_init(const fused_list<R, Rs...>& rs) -> fused_acc_t<R, Rs...>
+{
+  return {rs.head.init, fused_init(rs.tail)};
+}
+
+template <typename InT, typename IdxT>
+HDI auto fused_main(const fused_list<>&, const InT&, IdxT) -> fused_list<>
+{
+  return {};
+}
+
+template <typename R, typename... Rs, typename InT, typename IdxT>
+HDI auto fused_main(const fused_list<R, Rs...>& rs, const InT& x, IdxT k) -> fused_acc_t<R, Rs...>
+{
+  return {typename R::acc_type(rs.head.main_op(x, k)), fused_main(rs.tail, x, k)};
+}
+
+HDI auto fused_combine(const fused_list<>&, const fused_list<>&, const fused_list<>&)
+  -> fused_list<>
+{
+  return {};
+}
+
+template <typename R, typename... Rs>
+HDI auto fused_combine(const fused_list<R, Rs...>& rs,
+                       const fused_acc_t<R, Rs...>& a,
+                       const fused_acc_t<R, Rs...>& b) -> fused_acc_t<R, Rs...>
+{
+  return {rs.head.reduce_op(a.head, b.head), fused_combine(rs.tail, a.tail, b.tail)};
+}
+
+template <typename IdxT>
+HDI void fused_store(const fused_list<>&, const fused_list<>&, IdxT)
+{
+}
+
+template <typename R, typename... Rs, typename IdxT>
+HDI void fused_store(const fused_list<R, Rs...>& rs, const fused_acc_t<R, Rs...>& acc, IdxT k)
+{
+  rs.head.out(k) = rs.head.final_op(acc.head);
+  fused_store(rs.tail, acc.tail, k);
+}
+
+/** The binary operation reducing all the accumulators at once. */
+template <typename... ReductionTs>
+struct fused_reduce_op {
+  fused_list<ReductionTs...> rs;
+
+  HDI auto operator()(const fused_acc_t<ReductionTs...>& a,
+                      const fused_acc_t<ReductionTs...>& b) const -> fused_acc_t<ReductionTs...>
+  {
+    return fused_combine(rs, a, b);
+  }
+};
+
+/**
+ * The lazy expression of all the main operations over a row-major view: the index passed to the
+ * main operations is the one along the reduced dimension, the column index `j` for the reduction
+ * of the rows (`kCoalesced`) and the row index `i` otherwise.
+ */
+template <bool kCoalesced, typename ViewT, typename... ReductionTs>
+struct fused_main_expr {
+  using index_type = typename ViewT::index_type;
+  using value_type = fused_acc_t<ReductionTs...>;
+
+  ViewT view;
+  fused_list<ReductionTs...> rs;
+
+  HDI auto operator()(index_type i, index_type j) const -> value_type
+  {
+    return fused_main(rs, view(i, j), kCoalesced ? j : i);
+  }
+  [[nodiscard]] HDI auto n_rows() const -> index_type { return view.extent(0); }
+  [[nodiscard]] HDI auto n_cols() const -> index_type { return view.extent(1); }
+};
+
+template <typename AccT, typename IdxT, typename... ReductionTs>
+RAFT_KERNEL fused_store_kernel(const AccT* accs, IdxT n, fused_list<ReductionTs...> rs)
+{
+  for (IdxT k = IdxT(blockIdx.x) * blockDim.x + threadIdx.x; k < n;
+       k += IdxT(blockDim.x) * gridDim.x) {
+    fused_store(rs, accs[k], k);
+  }
+}
+
+/**
+ * All the reductions in a single read of `data`: `along_rows` gives one result per row. The
+ * accumulators go through a temporary buffer of one element per output, from which the final
+ * operations scatter the results.
+ */
+template <typename InT, typename IdxT, typename LayoutPolicy, typename... ReductionTs>
+void fused_reduce(raft::resources const& res,
+                  raft::device_matrix_view<const InT, IdxT, LayoutPolicy> data,
+                  bool along_rows,
+                  ReductionTs... reductions)
+{
+  using acc_t    = fused_acc_t<ReductionTs...>;
+  auto stream    = resource::get_cuda_stream(res);
+  auto rs        = make_fused_list(reductions...);
+  IdxT n_outputs = along_rows ? data.extent(0) : data.extent(1);
+  if (n_outputs == 0) { return; }
+  rmm::device_uvector<acc_t> accs(n_outputs, stream);
+
+  // A column-major matrix is reduced as its (row-major) transpose
+  constexpr bool kRowMajor = std::is_same_v<LayoutPolicy, raft::row_major>;
+  auto view                = raft::make_device_matrix_view<const InT, IdxT, raft::row_major>(
+    data.data_handle(),
+    kRowMajor ? data.extent(0) : data.extent(1),
+    kRowMajor ? data.extent(1) : data.extent(0));
+  using view_t = decltype(view);
+  if (along_rows == kRowMajor) {
+    raft::linalg::lazy::detail::coalesced_reduction(
+      res,
+      fused_main_expr<true, view_t, ReductionTs...>{view, rs},
+      accs.data(),
+      fused_init(rs),
+      fused_reduce_op<ReductionTs...>{rs},
+      raft::identity_op{});
+  } else {
+    raft::linalg::lazy::detail::strided_reduction(
+      res,
+      fused_main_expr<false, view_t, ReductionTs...>{view, rs},
+      accs.data(),
+      fused_init(rs),
+      fused_reduce_op<ReductionTs...>{rs},
+      raft::identity_op{});
+  }
+
+  constexpr int kTpb = 256;
+  auto n_blocks      = std::min<size_t>(raft::ceildiv<size_t>(n_outputs, kTpb), 65536);
+  fused_store_kernel<<<n_blocks, kTpb, 0, stream>>>(accs.data(), n_outputs, rs);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+}  // namespace raft::linalg::detail
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/linalg_types.hpp>
+#include <raft/util/cuda_dev_essentials.cuh>
+#include <raft/util/cuda_rt_essentials.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cub/cub.cuh>
+
+#include <algorithm>
+#include <type_traits>
+
+namespace raft::linalg::lazy::detail {
+
+/*
+ * An expression is a trivially copyable functor `value_type operator()(index_type i, index_type j)`
+ * evaluating the element (i, j) of an `n_rows() x n_cols()` matrix on the device. The expressions
+ * are passed by value to the kernels of the terminal operations, so that the whole chain is
+ * inlined into a single kernel.
+ */
+
+/** The leaf expression: the elements of a matrix view. */
+template <typename ViewT>
+struct matrix_expr {
+  using value_type = std::remove_cv_t<typename ViewT::element_type>;
+  using index_type = typename ViewT::index_type;
+
+  ViewT view;
+
+  HDI auto operator()(index_type i, index_type j) const -> value_type { return view(i, j); }
+  [[nodiscard]] HDI auto n_rows() const -> index_type { return view.extent(0); }
+  [[nodiscard]] HDI auto n_cols() const -> index_type { return view.extent(1); }
+};
+
+/** An elementwise operation over an expression. */
+template <typename OpT, typename ExprT>
+struct unary_expr {
+  using index_type = typename ExprT::index_type;
+  using value_type = std::remove_cv_t<
+    std::remove_reference_t<std::invoke_result_t<OpT, typename ExprT::value_type>>>;
+
+  OpT op;
+  ExprT expr;
+
+  HDI auto operator()(index_type i, index_type j) const -> value_type { return op(expr(i, j)); }
+  [[nodiscard]] HDI auto n_rows() const -> index_type { return expr.n_rows(); }
+  [[nodiscard]] HDI auto n_cols() const -> index_type { return expr.n_cols(); }
+};
+
+/** An elementwise operation over two expressions of the same shape. */
+template <typename OpT, typename Expr1T, typename Expr2T>
+struct binary_expr {
+  using index_type = typename Expr1T::index_type;
+  using value_type = std::remove_cv_t<std::remove_reference_t<
+    std::invoke_result_t<OpT, typename Expr1T::value_type, typename Expr2T::value_type>>>;
+
+  OpT op;
+  Expr1T expr1;
+  Expr2T expr2;
+
+  HDI auto operator()(index_type i, index_type j) const -> value_type
+  {
+    return op(expr1(i, j), expr2(i, j));
+  }
+  [[nodiscard]] HDI auto n_rows() const -> index_type { return expr1.n_rows(); }
+  [[nodiscard]] HDI auto n_cols() const -> index_type { return expr1.n_cols(); }
+};
+
+/**
+ * The broadcast of a vector over an expression: `op(expr(i, j), vec(j))` along the rows (the
+ * vector has one element per column), `op(expr(i, j), vec(i))` along the columns.
+ */
+template <typename OpT, typename ExprT, typename VecT>
+struct broadcast_expr {
+  using index_type = typename ExprT::index_type;
+  using value_type = std::remove_cv_t<std::remove_reference_t<
+    std::invoke_result_t<OpT, typename ExprT::value_type, typename VecT::element_type>>>;
+
+  OpT op;
+  ExprT expr;
+  VecT vec;
+  bool along_rows;
+
+  HDI auto operator()(index_type i, index_type j) const -> value_type
+  {
+    return op(expr(i, j), vec(along_rows ? j : i));
+  }
+  [[nodiscard]] HDI auto n_rows() const -> index_type { return expr.n_rows(); }
+  [[nodiscard]] HDI auto n_cols() const -> index_type { return expr.n_cols(); }
+};
+
+template <typename ExprT, typename OutT>
+RAFT_KERNEL evaluate_kernel(ExprT expr, OutT out)
+{
+  using index_type  = typename ExprT::index_type;
+  index_type n_cols = expr.n_cols();
+  size_t n          = size_t(expr.n_rows()) * n_cols;
+  for (size_t k = size_t(blockIdx.x) * blockDim.x + threadIdx.x; k < n;
+       k += size_t(blockDim.x) * gridDim.x) {
+    index_type i = k / n_cols;
+    index_type j = k % n_cols;
+    out(i, j)    = expr(i, j);
+  }
+}
+
+/** A few rows per block, one warp per row: the narrow matrices. */
+template <int TPB, typename ExprT, typename OutT, typename ReduceOp, typename FinalOp>
+RAFT_KERNEL coalesced_reduction_thin_kernel(
+  ExprT expr, OutT* out, OutT init, ReduceOp reduce_op, FinalOp final_op)
+{
+  using index_type            = typename ExprT::index_type;
+  using warp_reduce           = cub::WarpReduce<OutT>;
+  constexpr int kRowsPerBlock = TPB / WarpSize;
+  __shared__ typename warp_reduce::TempStorage temp[kRowsPerBlock];
+  int warp_id    = threadIdx.x / WarpSize;
+  int lane_id    = threadIdx.x % WarpSize;
+  index_type row = index_type(blockIdx.x) * kRowsPerBlock + warp_id;
+  if (row >= expr.n_rows()) { return; }
+  OutT acc = init;
+  for (index_type j = lane_id; j < expr.n_cols(); j += WarpSize) {
+    acc = reduce_op(acc, OutT(expr(row, j)));
+  }
+  acc = warp_reduce(temp[warp_id]).Reduce(acc, reduce_op);
+  if (lane_id == 0) { out[row] = final_op(acc); }
+}
+
+/** One block per row: the wide matrices. */
+template <int TPB, typename ExprT, typename OutT, typename ReduceOp, typename FinalOp>
+RAFT_KERNEL coalesced_reduction_thick_kernel(
+  ExprT expr, OutT* out, OutT init, ReduceOp reduce_op, FinalOp final_op)
+{
+  using index_type   = typename ExprT::index_type;
+  using block_reduce = cub::BlockReduce<OutT, TPB>;
+  __shared__ typename block_reduce::TempStorage temp;
+  index_type row = blockIdx.x;
+  OutT acc       = init;
+  for (index_type j = threadIdx.x; j < expr.n_cols(); j += TPB) {
+    acc = reduce_op(acc, OutT(expr(row, j)));
+  }
+  acc = block_reduce(temp).Reduce(acc, reduce_op);
+  if (threadIdx.x == 0) { out[row] = final_op(acc); }
+}
+
+/**
+ * A tile of columns per block: every warp reads consecutive columns of a row, and the partial
+ * results of the `TPB_Y` row slices are combined in the shared memory. With `gridDim.y > 1`, the
+ * rows are split among the blocks and `out` receives the partial results [gridDim.y, n_cols],
+ * reduced again by the caller.
+ */
+template <int TPB_X, int TPB_Y, typename ExprT, typename OutT, typename ReduceOp, typename FinalOp>
+RAFT_KERNEL strided_reduction_kernel(
+  ExprT expr, OutT* out, OutT init, ReduceOp reduce_op, FinalOp final_op)
+{
+  using index_type = typename ExprT::index_type;
+  __shared__ OutT partial[TPB_Y][TPB_X];
+  index_type col     = index_type(blockIdx.x) * TPB_X + threadIdx.x;
+  index_type n_rows  = expr.n_rows();
+  index_type n_cols  = expr.n_cols();
+  index_type chunk   = raft::ceildiv<index_type>(n_rows, gridDim.y);
+  index_type row_end = std::min<index_type>(n_rows, chunk * (blockIdx.y + 1));
+  OutT acc           = init;
+  if (col < n_cols) {
+    for (index_type i = chunk * blockIdx.y + threadIdx.y; i < row_end; i += TPB_Y) {
+      acc = reduce_op(acc, OutT(expr(i, col)));
+    }
+  }
+  partial[threadIdx.y][threadIdx.x] = acc;
+  __syncthreads();
+  if (threadIdx.y != 0 || col >= n_cols) { return; }
+  for (int y = 1; y < TPB_Y; y++) {
+    acc = reduce_op(acc, partial[y][threadIdx.x]);
+  }
+  out[size_t(blockIdx.y) * n_cols + col] = gridDim.y > 1 ? acc : final_op(acc);
+}
+
+template <typename ExprT, typename OutT>
+void evaluate(raft::resources const& res, const ExprT& expr, OutT out)
+{
+  auto stream        = resource::get_cuda_stream(res);
+  size_t n           = size_t(expr.n_rows()) * expr.n_cols();
+  constexpr int kTpb = 256;
+  if (n == 0) { return; }
+  auto n_blocks = std::min<size_t>(raft::ceildiv<size_t>(n, kTpb), 65536);
+  evaluate_kernel<<<n_blocks, kTpb, 0, stream>>>(expr, out);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+template <typename ExprT, typename OutT, typename ReduceOp, typename FinalOp>
+void coalesced_reduction(raft::resources const& res,
+                         const ExprT& expr,
+                         OutT* out,
+                         OutT init,
+                         ReduceOp reduce_op,
+                         FinalOp final_op)
+{
+  auto stream        = resource::get_cuda_stream(res);
+  constexpr int kTpb = 256;
+  if (expr.n_rows() == 0) { return; }
+  if (expr.n_cols() <= 512) {
+    auto n_blocks = raft::ceildiv<size_t>(expr.n_rows(), kTpb / WarpSize);
+    coalesced_reduction_thin_kernel<kTpb>
+      <<<n_blocks, kTpb, 0, stream>>>(expr, out, init, reduce_op, final_op);
+  } else {
+    coalesced_reduction_thick_kernel<kTpb>
+      <<<expr.n_rows(), kTpb, 0, stream>>>(expr, out, init, reduce_op, final_op);
+  }
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+template <typename ExprT, typename OutT, typename ReduceOp, typename FinalOp>
+void strided_reduction(raft::resources const& res,
+                       const ExprT& expr,
+                       OutT* out,
+                       OutT init,
+                       ReduceOp reduce_op,
+                       FinalOp final_op)
+{
+  using index_type       = typename ExprT::index_type;
+  auto stream            = resource::get_cuda_stream(res);
+  constexpr int kTpbX    = WarpSize;
+  constexpr int kTpbY    = 8;
+  constexpr int kMinRows = 256;  // per block, below which the rows are not split any further
+  index_type n_cols      = expr.n_cols();
+  if (n_cols == 0) { return; }
+  // enough blocks to fill the device, when there are few columns
+  size_t col_blocks = raft::ceildiv<size_t>(n_cols, kTpbX);
+  size_t row_blocks = std::clamp<size_t>(
+    raft::ceildiv<size_t>(1024, col_blocks), 1, raft::ceildiv<size_t>(expr.n_rows(), kMinRows));
+  dim3 block(kTpbX, kTpbY);
+  if (row_blocks == 1) {
+    strided_reduction_kernel<kTpbX, kTpbY>
+      <<<dim3(col_blocks, 1), block, 0, stream>>>(expr, out, init, reduce_op, final_op);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    return;
+  }
+  rmm::device_uvector<OutT> partial(row_blocks * n_cols, stream);
+  strided_reduction_kernel<kTpbX, kTpbY>
+    <<<dim3(col_blocks, row_blocks), block, 0, stream>>>(
+      expr, partial.data(), init, reduce_op, final_op);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  auto partial_view = raft::make_device_matrix_view<const OutT, index_type>(
+    partial.data(), index_type(row_blocks), n_cols);
+  strided_reduction_kernel<kTpbX, kTpbY><<<dim3(col_blocks, 1), block, 0, stream>>>(
+    matrix_expr<decltype(partial_view)>{partial_view}, out, init, reduce_op, final_op);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+}  // namespace raft::linalg::lazy::detail
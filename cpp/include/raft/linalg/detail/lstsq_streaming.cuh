@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cublas_wrappers.hpp"
+#include "cusolver_wrappers.hpp"
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cublas_handle.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cusolver_dn_handle.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/linalg_types.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace raft::linalg::detail {
+
+/*
+ * The least squares solution of `Aw = b` for a tall A streamed by blocks of rows. The state is
+ * a column-major [n + 1, n + 1] matrix S of the augmented matrix [A b]:
+ *
+ *   - TSQR: the R factor of [A b] = QR, S = [[R_A, Q^T b], [0, +-||Aw - b||]]; a block [A_b b_b]
+ *     is stacked under S and the R factor of the stack is the new state;
+ *   - NORMAL_EQUATIONS: the Gram matrix S = [A b]^T [A b] = sum_b [A_b b_b]^T [A_b b_b].
+ *
+ * Both states of disjoint sets of rows combine into the state of their union: the R factor of the
+ * stacked R factors, or the sum of the Gram matrices.
+ */
+
+/** Write the block [A_b b_b] [rows, n + 1] into the rows [row0, row0 + rows) of out (ld rows). */
+template <typename T>
+RAFT_KERNEL lstsq_pack_block_kernel(
+  const T* A, const T* b, int64_t rows, int n, bool row_major, T* out, int64_t ld, int64_t row0)
+{
+  const int64_t n_elems = rows * (n + 1);
+  for (int64_t e = threadIdx.x + int64_t(blockDim.x) * blockIdx.x; e < n_elems;
+       e += int64_t(blockDim.x) * gridDim.x) {
+    const int64_t i = e % rows;
+    const int64_t j = e / rows;
+    T x;
+    if (j == n) {
+      x = b[i];
+    } else {
+      x = row_major ? A[i * n + j] : A[j * rows + i];
+    }
+    out[j * ld + row0 + i] = x;
+  }
+}
+
+/**
+ * Replace the state by the R factor of the column-major stack [ld, n1] (overwritten), n1 = n + 1.
+ */
+template <typename T>
+void tsqr_reduce(raft::resources const& handle, T* stack, int64_t ld, int n1, T* state)
+{
+  auto stream   = resource::get_cuda_stream(handle);
+  auto solver_h = resource::get_cusolver_dn_handle(handle);
+  const auto m  = static_cast<int>(ld);
+  int lwork     = 0;
+  RAFT_CUSOLVER_TRY(cusolverDngeqrf_bufferSize(solver_h, m, n1, stack, m, &lwork));
+  rmm::device_uvector<T> tau(n1, stream);
+  rmm::device_uvector<T> work(lwork, stream);
+  // geqrf only reports the invalid arguments: the info is not read back, which would synchronize
+  // the stream at every block
+  rmm::device_scalar<int> d_info(stream);
+  RAFT_CUSOLVER_TRY(cusolverDngeqrf(
+    solver_h, m, n1, stack, m, tau.data(), work.data(), lwork, d_info.data(), stream));
+  // the upper triangle of the stack is R; the Householder vectors below it are dropped
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(state, int64_t(n1) * n1),
+    [stack, ld, n1] __device__(int64_t e) {
+      const int64_t i = e % n1;
+      const int64_t j = e / n1;
+      return i <= j ? stack[j * ld + i] : T(0);
+    });
+}
+
+/** The TSQR state of the n_states states [n1, n1] one after the other in `states`. */
+template <typename T>
+void tsqr_merge(raft::resources const& handle, const T* states, int n_states, int n1, T* state)
+{
+  auto stream      = resource::get_cuda_stream(handle);
+  const int64_t ld = int64_t(n_states) * n1;
+  rmm::device_uvector<T> stack(ld * n1, stream);
+  raft::linalg::map_offset(handle,
+                           raft::make_device_vector_view<T, int64_t>(stack.data(), ld * n1),
+                           [states, ld, n1] __device__(int64_t e) {
+                             const int64_t j = e / ld;
+                             const int64_t s = (e % ld) / n1;
+                             const int64_t i = e % n1;
+                             return states[(s * n1 + j) * n1 + i];
+                           });
+  tsqr_reduce(handle, stack.data(), ld, n1, state);
+}
+
+/**
+ * Add the block of rows [A_b b_b] to the state.
+ *
+ * @param A the device block [rows, n], in row-major order if `row_major`, column-major otherwise
+ * @param b the device targets [rows]
+ * @param workspace resized as needed
+ */
+template <typename T>
+void lstsq_update(raft::resources const& handle,
+                  lstsq_method method,
+                  int n,
+                  T* state,
+                  const T* A,
+                  const T* b,
+                  int64_t rows,
+                  bool row_major,
+                  rmm::device_uvector<T>& workspace)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "raft::linalg::lstsq_accumulator::update(%ld, %d)", rows, n);
+  if (rows == 0) { return; }
+  auto stream      = resource::get_cuda_stream(handle);
+  const int n1     = n + 1;
+  const bool tsqr  = method == lstsq_method::TSQR;
+  const int64_t r0 = tsqr ? n1 : 0;
+  const int64_t ld = r0 + rows;
+  RAFT_EXPECTS(ld <= std::numeric_limits<int>::max(),
+               "lstsq_accumulator: the block of rows is too large; split it");
+  workspace.resize(ld * n1, stream);
+
+  constexpr int kTpb = 256;
+  const auto n_blocks =
+    static_cast<int>(std::min<int64_t>(raft::ceildiv<int64_t>(rows * n1, kTpb), 65535));
+  lstsq_pack_block_kernel<<<n_blocks, kTpb, 0, stream>>>(
+    A, b, rows, n, row_major, workspace.data(), ld, r0);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+  if (tsqr) {
+    // the current R factor on top of the block
+    RAFT_CUDA_TRY(cudaMemcpy2DAsync(workspace.data(),
+                                    sizeof(T) * ld,
+                                    state,
+                                    sizeof(T) * n1,
+                                    sizeof(T) * n1,
+                                    n1,
+                                    cudaMemcpyDeviceToDevice,
+                                    stream));
+    tsqr_reduce(handle, workspace.data(), ld, n1, state);
+  } else {
+    // S += W^T W, W = [A_b b_b] column-major [rows, n1]
+    const T one = 1;
+    RAFT_CUBLAS_TRY(cublasgemm(resource::get_cublas_handle(handle),
+                               CUBLAS_OP_T,
+                               CUBLAS_OP_N,
+                               n1,
+                               n1,
+                               static_cast<int>(rows),
+                               &one,
+                               workspace.data(),
+                               static_cast<int>(rows),
+                               workspace.data(),
+                               static_cast<int>(rows),
+                               &one,
+                               state,
+                               n1,
+                               stream));
+  }
+}
+
+/** Combine the state of other rows into the state. */
+template <typename T>
+void lstsq_merge(
+  raft::resources const& handle, lstsq_method method, int n, T* state, const T* other)
+{
+  auto stream      = resource::get_cuda_stream(handle);
+  const int n1     = n + 1;
+  const int64_t nn = int64_t(n1) * n1;
+  if (method == lstsq_method::NORMAL_EQUATIONS) {
+    raft::linalg::map_offset(handle,
+                             raft::make_device_vector_view<T, int64_t>(state, nn),
+                             [state, other] __device__(int64_t e) { return state[e] + other[e]; });
+    return;
+  }
+  rmm::device_uvector<T> states(2 * nn, stream);
+  raft::copy(states.data(), state, nn, stream);
+  raft::copy(states.data() + nn, other, nn, stream);
+  tsqr_merge(handle, states.data(), 2, n1, state);
+}
+
+/** Combine the states of all the ranks: every rank gets the state of all the rows. */
+template <typename T>
+void lstsq_allreduce(raft::resources const& handle,
+                     lstsq_method method,
+                     int n,
+                     T* state,
+                     const raft::comms::comms_t& comms)
+{
+  auto stream      = resource::get_cuda_stream(handle);
+  const int n1     = n + 1;
+  const int64_t nn = int64_t(n1) * n1;
+  if (method == lstsq_method::NORMAL_EQUATIONS) {
+    comms.allreduce(state, state, nn, raft::comms::op_t::SUM, stream);
+    RAFT_EXPECTS(comms.sync_stream(stream) == raft::comms::status_t::SUCCESS,
+                 "lstsq_accumulator: the allreduce of the Gram matrices failed");
+    return;
+  }
+  // the R factors of all the ranks, stacked in the order of the ranks (the same on every rank)
+  const int n_ranks = comms.get_size();
+  rmm::device_uvector<T> states(n_ranks * nn, stream);
+  comms.allgather(state, states.data(), nn, stream);
+  RAFT_EXPECTS(comms.sync_stream(stream) == raft::comms::status_t::SUCCESS,
+               "lstsq_accumulator: the allgather of the R factors failed");
+  tsqr_merge(handle, states.data(), n_ranks, n1, state);
+}
+
+/** The solution w [n] of the least squares problem of the state. */
+template <typename T>
+void lstsq_solve(raft::resources const& handle, lstsq_method method, int n, const T* state, T* w)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "raft::linalg::lstsq_accumulator::solve(%d)", n);
+  auto stream  = resource::get_cuda_stream(handle);
+  const int n1 = n + 1;
+  // the right-hand side is the first n elements of the last column: Q^T b or A^T b
+  raft::copy(w, state + int64_t(n) * n1, n, stream);
+  if (method == lstsq_method::TSQR) {
+    // R w = Q^T b
+    const T one = 1;
+    RAFT_CUBLAS_TRY(cublastrsm(resource::get_cublas_handle(handle),
+                               CUBLAS_SIDE_LEFT,
+                               CUBLAS_FILL_MODE_UPPER,
+                               CUBLAS_OP_N,
+                               CUBLAS_DIAG_NON_UNIT,
+                               n,
+                               1,
+                               &one,
+                               state,
+                               n1,
+                               w,
+                               n,
+                               stream));
+    return;
+  }
+  // (A^T A) w = A^T b by the Cholesky factorization of a copy of the state
+  auto solver_h = resource::get_cusolver_dn_handle(handle);
+  rmm::device_uvector<T> gram(int64_t(n1) * n1, stream);
+  raft::copy(gram.data(), state, gram.size(), stream);
+  int lwork = 0;
+  int info  = 0;
+  RAFT_CUSOLVER_TRY(
+    cusolverDnpotrf_bufferSize(solver_h, CUBLAS_FILL_MODE_LOWER, n, gram.data(), n1, &lwork));
+  rmm::device_uvector<T> work(lwork, stream);
+  rmm::device_scalar<int> d_info(stream);
+  RAFT_CUSOLVER_TRY(cusolverDnpotrf(solver_h,
+                                    CUBLAS_FILL_MODE_LOWER,
+                                    n,
+                                    gram.data(),
+                                    n1,
+                                    work.data(),
+                                    lwork,
+                                    d_info.data(),
+                                    stream));
+  RAFT_CUDA_TRY(cudaMemcpyAsync(&info, d_info.data(), sizeof(int), cudaMemcpyDeviceToHost, stream));
+  resource::sync_stream(handle, stream);
+  RAFT_EXPECTS(info == 0,
+               "lstsq_accumulator: A^T A is not positive definite (leading minor %d); "
+               "A is rank-deficient or ill-conditioned, use lstsq_method::TSQR",
+               info);
+  RAFT_CUSOLVER_TRY(cusolverDnpotrs(solver_h,
+                                    CUBLAS_FILL_MODE_LOWER,
+                                    n,
+                                    1,
+                                    gram.data(),
+                                    n1,
+                                    w,
+                                    n,
+                                    d_info.data(),
+                                    stream));
+}
+
+}  // namespace raft::linalg::detail
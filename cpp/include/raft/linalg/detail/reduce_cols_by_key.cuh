@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,6 +19,7 @@
 #include <cub/cub.cuh>
 #include <limits>
 #include <raft/util/cuda_utils.cuh>
+#include <raft/util/warp_primitives.cuh>
 #include <stdlib.h>
 
 namespace raft {
@@ -26,21 +27,37 @@ namespace linalg {
 namespace detail {
 
 ///@todo: support col-major
-///@todo: specialize this to support shared-mem based atomics
 
-template <typename T, typename KeyIteratorT, typename IdxType>
+/**
+ * The consecutive lanes of a warp read consecutive columns of a row: the runs of equal keys are
+ * summed in the warp first, so that only one atomic per run goes to the global results (with
+ * sorted or clustered keys, most of them).
+ */
+template <int TPB, typename T, typename KeyIteratorT, typename IdxType>
 RAFT_KERNEL reduce_cols_by_key_direct_kernel(
   const T* data, const KeyIteratorT keys, T* out, IdxType nrows, IdxType ncols, IdxType nkeys)
 {
   typedef typename std::iterator_traits<KeyIteratorT>::value_type KeyType;
+  typedef cub::WarpReduce<T> WarpReduce;
+  __shared__ typename WarpReduce::TempStorage temp_storage[TPB / WarpSize];
 
-  IdxType idx = static_cast<IdxType>(blockIdx.x) * blockDim.x + threadIdx.x;
-  if (idx >= (nrows * ncols)) return;
-  ///@todo: yikes! use fast-int-div
-  IdxType colId = idx % ncols;
-  IdxType rowId = idx / ncols;
-  KeyType key   = keys[colId];
-  raft::myAtomicAdd(out + rowId * nkeys + key, data[idx]);
+  // All the lanes take part in the warp reduction; the ones past the end add nothing
+  IdxType idx  = static_cast<IdxType>(blockIdx.x) * blockDim.x + threadIdx.x;
+  bool valid   = idx < nrows * ncols;
+  T val        = T{0};
+  IdxType dest = nrows * nkeys;
+  if (valid) {
+    ///@todo: yikes! use fast-int-div
+    IdxType colId = idx % ncols;
+    IdxType rowId = idx / ncols;
+    KeyType key   = keys[colId];
+    val           = data[idx];
+    dest          = rowId * nkeys + key;
+  }
+  IdxType prev_dest = raft::shfl_up(dest, 1);
+  bool head         = raft::laneId() == 0 || prev_dest != dest;
+  T sum             = WarpReduce(temp_storage[threadIdx.x / WarpSize]).HeadSegmentedSum(val, head);
+  if (valid && head) { raft::myAtomicAdd(out + dest, sum); }
 }
 
 template <typename T, typename KeyIteratorT, typename IdxType>
@@ -131,7 +148,7 @@ void reduce_cols_by_key(const T* data,
   } else {
     constexpr int TPB = 256;
     int nblks         = raft::ceildiv<IdxType>(nrows * ncols, TPB);
-    reduce_cols_by_key_direct_kernel<<<nblks, TPB, 0, stream>>>(
+    reduce_cols_by_key_direct_kernel<TPB><<<nblks, TPB, 0, stream>>>(
       data, keys, out, nrows, ncols, nkeys);
   }
   RAFT_CUDA_TRY(cudaPeekAtLastError());
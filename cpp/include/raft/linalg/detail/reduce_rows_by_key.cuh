@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -264,6 +264,88 @@ void sum_rows_by_key_large_nkeys_colmajor(const DataIteratorT d_A,
     d_A, lda, d_keys, nrows, ncols, key_offset, nkeys, d_sums);
 }
 
+//
+// Reduce by keys - medium number of keys
+// The sums of all the keys fit into smem: every block accumulates its rows into a private copy,
+// which it then adds to the global sums
+//
+
+#define SUM_ROWS_BY_KEY_MEDIUM_K_MAX_CACHE 49152
+
+template <typename DataIteratorT,
+          typename KeysIteratorT,
+          typename WeightT,
+          typename SumsT,
+          typename IdxT>
+RAFT_KERNEL sum_rows_by_key_medium_nkeys_kernel_rowmajor(const DataIteratorT d_A,
+                                                         IdxT lda,
+                                                         const WeightT* d_weights,
+                                                         KeysIteratorT d_keys,
+                                                         IdxT nrows,
+                                                         IdxT ncols,
+                                                         IdxT nkeys,
+                                                         SumsT* d_sums)
+{
+  extern __shared__ char smem[];
+  SumsT* local_sums = reinterpret_cast<SumsT*>(smem);
+
+  for (IdxT idx = threadIdx.x; idx < nkeys * ncols; idx += blockDim.x) {
+    local_sums[idx] = SumsT{0};
+  }
+  __syncthreads();
+
+  for (IdxT idx = threadIdx.x + blockDim.x * static_cast<IdxT>(blockIdx.x); idx < nrows * ncols;
+       idx += blockDim.x * static_cast<IdxT>(gridDim.x)) {
+    IdxT j    = idx % ncols;
+    IdxT i    = idx / ncols;
+    IdxT l    = static_cast<IdxT>(d_keys[i]);
+    SumsT val = d_A[j + lda * i];
+    if (d_weights != nullptr) val *= d_weights[i];
+    raft::myAtomicAdd(&local_sums[j + ncols * l], val);
+  }
+
+  __syncthreads();
+  for (IdxT idx = threadIdx.x; idx < nkeys * ncols; idx += blockDim.x) {
+    SumsT local_sum = local_sums[idx];
+    if (local_sum != SumsT{0}) { raft::myAtomicAdd(&d_sums[idx], local_sum); }
+  }
+}
+
+template <typename DataIteratorT,
+          typename KeysIteratorT,
+          typename WeightT,
+          typename SumsT,
+          typename IdxT>
+void sum_rows_by_key_medium_nkeys_rowmajor(const DataIteratorT d_A,
+                                           IdxT lda,
+                                           const KeysIteratorT d_keys,
+                                           const WeightT* d_weights,
+                                           IdxT nrows,
+                                           IdxT ncols,
+                                           IdxT nkeys,
+                                           SumsT* d_sums,
+                                           cudaStream_t st)
+{
+  constexpr uint32_t block_dim = 256;
+  size_t cache_size            = static_cast<size_t>(nkeys) * ncols * sizeof(SumsT);
+  int target_grid_dim          = 4 * raft::getMultiProcessorCount();
+  auto max_grid_dim = static_cast<int>(std::min<IdxT>(ceildiv<IdxT>(nrows * ncols, block_dim),
+                                                      static_cast<IdxT>(MAX_BLOCKS)));
+  int grid_dim      = std::min(target_grid_dim, max_grid_dim);
+  sum_rows_by_key_medium_nkeys_kernel_rowmajor<<<grid_dim, block_dim, cache_size, st>>>(
+    d_A, lda, d_weights, d_keys, nrows, ncols, nkeys, d_sums);
+}
+
+//
+// Reduce by keys - very large number of keys
+// The sums do not fit into smem, but the contention on the global sums is low. Every thread
+// sums one column over a segment of consecutive rows, and flushes its partial sum to the global
+// sums whenever the key changes: with sorted or clustered keys (e.g. the records of the IVF
+// lists) most of the global atomics are saved, without sorting the keys.
+//
+
+#define SUM_ROWS_BY_KEY_LARGE_K_SEGMENT_ROWS 32
+
 template <typename DataIteratorT,
           typename KeysIteratorT,
           typename WeightT,
@@ -277,14 +359,26 @@ RAFT_KERNEL sum_rows_by_key_large_nkeys_kernel_rowmajor(const DataIteratorT d_A,
                                                         IdxT ncols,
                                                         SumsT* d_sums)
 {
-  IdxT gid = threadIdx.x + (blockDim.x * static_cast<IdxT>(blockIdx.x));
-  IdxT j   = gid % ncols;
-  IdxT i   = gid / ncols;
-  if (i >= nrows) return;
-  IdxT l    = static_cast<IdxT>(d_keys[i]);
-  SumsT val = d_A[j + lda * i];
-  if (d_weights != nullptr) val *= d_weights[i];
-  raft::myAtomicAdd(&d_sums[j + ncols * l], val);
+  IdxT gid       = threadIdx.x + (blockDim.x * static_cast<IdxT>(blockIdx.x));
+  IdxT j         = gid % ncols;
+  IdxT row_begin = (gid / ncols) * SUM_ROWS_BY_KEY_LARGE_K_SEGMENT_ROWS;
+  if (row_begin >= nrows) return;
+  IdxT row_end = std::min<IdxT>(row_begin + SUM_ROWS_BY_KEY_LARGE_K_SEGMENT_ROWS, nrows);
+
+  IdxT l    = static_cast<IdxT>(d_keys[row_begin]);
+  SumsT sum = 0;
+  for (IdxT i = row_begin; i < row_end; i++) {
+    IdxT row_key = static_cast<IdxT>(d_keys[i]);
+    if (row_key != l) {
+      raft::myAtomicAdd(&d_sums[j + ncols * l], sum);
+      l   = row_key;
+      sum = 0;
+    }
+    SumsT val = d_A[j + lda * i];
+    if (d_weights != nullptr) val *= d_weights[i];
+    sum += val;
+  }
+  raft::myAtomicAdd(&d_sums[j + ncols * l], sum);
 }
 
 template <typename DataIteratorT,
@@ -302,7 +396,8 @@ void sum_rows_by_key_large_nkeys_rowmajor(const DataIteratorT d_A,
                                           cudaStream_t st)
 {
   uint32_t block_dim = 128;
-  auto grid_dim      = static_cast<uint32_t>(ceildiv<IdxT>(nrows * ncols, (IdxT)block_dim));
+  IdxT n_segments    = ceildiv<IdxT>(nrows, SUM_ROWS_BY_KEY_LARGE_K_SEGMENT_ROWS);
+  auto grid_dim      = static_cast<uint32_t>(ceildiv<IdxT>(n_segments * ncols, (IdxT)block_dim));
   sum_rows_by_key_large_nkeys_kernel_rowmajor<<<grid_dim, block_dim, 0, st>>>(
     d_A, lda, d_weights, d_keys, nrows, ncols, d_sums);
 }
@@ -358,6 +453,13 @@ void reduce_rows_by_key(const DataIteratorT d_A,
     convert_array(d_keys_char, d_keys, nrows, stream);
     sum_rows_by_key_small_nkeys(
       d_A, lda, d_keys_char, d_weights, nrows, ncols, nkeys, d_sums, stream);
+  } else if (static_cast<size_t>(nkeys) * ncols * sizeof(SumsT) <=
+               SUM_ROWS_BY_KEY_MEDIUM_K_MAX_CACHE &&
+             nrows * ncols >= IdxT{8192}) {
+    // The smem-privatized sums pay off when there are enough rows per key (the atomics on the
+    // global sums would collide)
+    sum_rows_by_key_medium_nkeys_rowmajor(
+      d_A, lda, d_keys, d_weights, nrows, ncols, nkeys, d_sums, stream);
   } else {
     sum_rows_by_key_large_nkeys_rowmajor(d_A, lda, d_keys, d_weights, nrows, ncols, d_sums, stream);
   }
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cublas_wrappers.hpp"
+#include "qr.cuh"
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cublas_handle.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/eig.cuh>
+#include <raft/linalg/map.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+
+namespace raft::linalg::detail {
+
+/**
+ * The randomized SVD of a tall matrix which does not fit on the device, streamed by blocks of
+ * rows from the host. Only the (n_cols x l) and (l x l) sketches, l = k + p, live on the device:
+ *
+ *   1. Q = orth(Omega), Omega a random Gaussian [n_cols, l];
+ *   2. (n_iters + 1) times: Q = orth(A^T A Q), with A^T A Q = sum_b A_b^T (A_b Q);
+ *   3. G = (A Q)^T (A Q) = sum_b (A_b Q)^T (A_b Q) = W L W^T;
+ *   4. S = sqrt(top-k of L), V = Q W_k and, optionally, U = A V S^-1 (one more pass).
+ *
+ * With `comms`, every rank holds different rows of A: the sketches are summed over the ranks
+ * (the random matrix and the orthogonalizations are the same on every rank) and every rank gets
+ * the rows of U of its own rows of A.
+ *
+ * @param M_host the (local) rows of A, row-major [n_rows, n_cols], in host memory
+ * @param S the top-k singular values [k], in decreasing order
+ * @param V the right singular vectors, row-major [n_cols, k] (column-major [k, n_cols])
+ * @param U_host nullptr, or the left singular vectors, row-major [n_rows, k], in host memory
+ */
+template <typename T>
+void rsvd_streaming(raft::resources const& handle,
+                    const T* M_host,
+                    int64_t n_rows,
+                    int n_cols,
+                    int k,
+                    int p,
+                    int n_iters,
+                    int64_t batch_rows,
+                    uint64_t seed,
+                    T* S,
+                    T* V,
+                    T* U_host,
+                    const raft::comms::comms_t* comms)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "raft::linalg::rsvd_streaming(%ld, %d, %d)", n_rows, n_cols, k);
+  int l = k + p;
+  RAFT_EXPECTS(l <= n_cols, "k + p must be <= n_cols");
+  RAFT_EXPECTS(batch_rows > 0, "batch_rows must be positive");
+  auto stream   = resource::get_cuda_stream(handle);
+  auto cublas_h = resource::get_cublas_handle(handle);
+  batch_rows    = std::max<int64_t>(1, std::min(batch_rows, n_rows));
+  const T one   = 1;
+  const T zero  = 0;
+
+  rmm::device_uvector<T> block(batch_rows * n_cols, stream);
+  rmm::device_uvector<T> y(batch_rows * l, stream);
+  rmm::device_uvector<T> q(size_t(n_cols) * l, stream);  // column-major [n_cols, l]
+  rmm::device_uvector<T> z(size_t(n_cols) * l, stream);  // column-major [n_cols, l]
+
+  // A row-major block of rows is the column-major A_b^T [n_cols, rows]
+  auto for_each_block = [&](auto&& f) {
+    for (int64_t row0 = 0; row0 < n_rows; row0 += batch_rows) {
+      int rows = int(std::min(batch_rows, n_rows - row0));
+      raft::copy(block.data(), M_host + row0 * n_cols, size_t(rows) * n_cols, stream);
+      // Y_b = A_b Q, column-major [rows, l]
+      RAFT_CUBLAS_TRY(cublasgemm(cublas_h,
+                                 CUBLAS_OP_T,
+                                 CUBLAS_OP_N,
+                                 rows,
+                                 l,
+                                 n_cols,
+                                 &one,
+                                 block.data(),
+                                 n_cols,
+                                 q.data(),
+                                 n_cols,
+                                 &zero,
+                                 y.data(),
+                                 rows,
+                                 stream));
+      f(row0, rows);
+    }
+  };
+  auto allreduce = [&](T* buf, size_t n) {
+    if (comms == nullptr) { return; }
+    comms->allreduce(buf, buf, n, raft::comms::op_t::SUM, stream);
+    RAFT_EXPECTS(comms->sync_stream(stream) == raft::comms::status_t::SUCCESS,
+                 "rsvd_streaming: the allreduce of the sketch failed");
+  };
+
+  raft::random::RngState rng(seed);
+  raft::random::normal(handle, rng, z.data(), z.size(), T(0), T(1));
+  qrGetQ(handle, z.data(), q.data(), n_cols, l, stream);
+
+  // The range finder: power iterations on A^T A
+  for (int iter = 0; iter <= n_iters; iter++) {
+    RAFT_CUDA_TRY(cudaMemsetAsync(z.data(), 0, z.size() * sizeof(T), stream));
+    for_each_block([&](int64_t, int rows) {
+      // Z += A_b^T Y_b
+      RAFT_CUBLAS_TRY(cublasgemm(cublas_h,
+                                 CUBLAS_OP_N,
+                                 CUBLAS_OP_N,
+                                 n_cols,
+                                 l,
+                                 rows,
+                                 &one,
+                                 block.data(),
+                                 n_cols,
+                                 y.data(),
+                                 rows,
+                                 &one,
+                                 z.data(),
+                                 n_cols,
+                                 stream));
+    });
+    allreduce(z.data(), z.size());
+    qrGetQ(handle, z.data(), q.data(), n_cols, l, stream);
+  }
+
+  // The small Gram matrix of the projection, and its eigen decomposition
+  auto g     = raft::make_device_matrix<T, int, raft::col_major>(handle, l, l);
+  auto w     = raft::make_device_matrix<T, int, raft::col_major>(handle, l, l);
+  auto evals = raft::make_device_vector<T, int>(handle, l);
+  RAFT_CUDA_TRY(cudaMemsetAsync(g.data_handle(), 0, g.size() * sizeof(T), stream));
+  for_each_block([&](int64_t, int rows) {
+    // G += Y_b^T Y_b
+    RAFT_CUBLAS_TRY(cublasgemm(cublas_h,
+                               CUBLAS_OP_T,
+                               CUBLAS_OP_N,
+                               l,
+                               l,
+                               rows,
+                               &one,
+                               y.data(),
+                               rows,
+                               y.data(),
+                               rows,
+                               &one,
+                               g.data_handle(),
+                               l,
+                               stream));
+  });
+  allreduce(g.data_handle(), g.size());
+  raft::linalg::eig_dc(handle, raft::make_const_mdspan(g.view()), w.view(), evals.view());
+
+  // The eigen values are in increasing order: keep the last k, reversed
+  auto w_k = raft::make_device_matrix<T, int, raft::col_major>(handle, l, k);
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int>(w_k.data_handle(), l * k),
+    [w_ptr = w.data_handle(), l] __device__(int e) { return w_ptr[e % l + (l - 1 - e / l) * l]; });
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int>(S, k),
+    [evals_ptr = evals.data_handle(), l] __device__(int i) {
+      return raft::sqrt(raft::max<T>(evals_ptr[l - 1 - i], T(0)));
+    });
+  // V^T = W_k^T Q^T, column-major [k, n_cols]
+  RAFT_CUBLAS_TRY(cublasgemm(cublas_h,
+                             CUBLAS_OP_T,
+                             CUBLAS_OP_T,
+                             k,
+                             n_cols,
+                             l,
+                             &one,
+                             w_k.data_handle(),
+                             l,
+                             q.data(),
+                             n_cols,
+                             &zero,
+                             V,
+                             k,
+                             stream));
+
+  if (U_host == nullptr) { return; }
+  // U_b^T = V^T A_b^T S^-1, column-major [k, rows], i.e. the row-major rows of U
+  rmm::device_uvector<T> u(batch_rows * k, stream);
+  for (int64_t row0 = 0; row0 < n_rows; row0 += batch_rows) {
+    int rows = int(std::min(batch_rows, n_rows - row0));
+    raft::copy(block.data(), M_host + row0 * n_cols, size_t(rows) * n_cols, stream);
+    RAFT_CUBLAS_TRY(cublasgemm(cublas_h,
+                               CUBLAS_OP_N,
+                               CUBLAS_OP_N,
+                               k,
+                               rows,
+                               n_cols,
+                               &one,
+                               V,
+                               k,
+                               block.data(),
+                               n_cols,
+                               &zero,
+                               u.data(),
+                               k,
+                               stream));
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<T, int64_t>(u.data(), int64_t(rows) * k),
+      [u_ptr = u.data(), S, k] __device__(int64_t e) {
+        T s = S[e % k];
+        return s > T(0) ? u_ptr[e] / s : T(0);
+      });
+    raft::copy(U_host + row0 * k, u.data(), size_t(rows) * k, stream);
+  }
+  resource::sync_stream(handle, stream);
+}
+
+template <typename math_t, typename idx_t>
+void rsvd_streaming(raft::resources const& handle,
+                    raft::host_matrix_view<const math_t, idx_t, raft::row_major> in,
+                    raft::device_vector_view<math_t, idx_t> S,
+                    raft::device_matrix_view<math_t, idx_t, raft::col_major> V,
+                    std::optional<raft::host_matrix_view<math_t, idx_t, raft::row_major>> U,
+                    std::size_t p,
+                    std::size_t niters,
+                    std::size_t batch_rows,
+                    uint64_t seed,
+                    const raft::comms::comms_t* comms)
+{
+  auto k = S.extent(0);
+  RAFT_EXPECTS(k == V.extent(0) && in.extent(1) == V.extent(1),
+               "V should have dimensions k * n_cols");
+  if (U) {
+    RAFT_EXPECTS(in.extent(0) == U.value().extent(0) && k == U.value().extent(1),
+                 "U should have dimensions n_rows * k");
+  }
+  rsvd_streaming(handle,
+                 in.data_handle(),
+                 int64_t(in.extent(0)),
+                 int(in.extent(1)),
+                 int(k),
+                 int(p),
+                 int(niters),
+                 int64_t(batch_rows),
+                 seed,
+                 S.data_handle(),
+                 V.data_handle(),
+                 U ? U.value().data_handle() : nullptr,
+                 comms);
+}
+
+}  // namespace raft::linalg::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,9 +22,9 @@
 #include <raft/core/resource/cublas_handle.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
-#include <rmm/exec_policy.hpp>
-#include <thrust/for_each.h>
-#include <thrust/iterator/counting_iterator.h>
+#include <raft/util/cuda_dev_essentials.cuh>
+
+#include <algorithm>
 
 namespace raft {
 namespace linalg {
@@ -62,25 +62,165 @@ void transpose(raft::resources const& handle,
                              stream));
 }
 
+/*
+ * The kernels below move 32 x 32 tiles through the shared memory, loaded and stored along the
+ * rows of the input and of the output (both coalesced). The columns of a tile are swizzled by
+ * the row they belong to, `tile[y][x ^ y]`, so that reading a column of the tile hits all the
+ * banks once, without the padding of a 32 x 33 tile.
+ */
+constexpr int kTransposeTile      = 32;
+constexpr int kTransposeBlockRows = 8;
+/** The limit of gridDim.y and gridDim.z: the kernels stride over the rest. */
+constexpr unsigned kTransposeMaxGridYz = 65535;
+
+/** out[b] = in[b]^T, in[b]: row-major [n_rows, n_cols], out[b]: row-major [n_cols, n_rows]. */
+template <typename T, typename IdxT>
+RAFT_KERNEL transpose_tiled_kernel(const T* in, T* out, IdxT batch_size, IdxT n_rows, IdxT n_cols)
+{
+  __shared__ T tile[kTransposeTile][kTransposeTile];
+  IdxT row0    = IdxT(blockIdx.x) * kTransposeTile;
+  IdxT n_tiles = raft::ceildiv<IdxT>(n_cols, kTransposeTile);
+  for (IdxT b = blockIdx.z; b < batch_size; b += gridDim.z) {
+    const T* in_b = in + size_t(b) * n_rows * n_cols;
+    T* out_b      = out + size_t(b) * n_rows * n_cols;
+    for (IdxT t = blockIdx.y; t < n_tiles; t += gridDim.y) {
+      IdxT col0 = t * kTransposeTile;
+      for (int y = threadIdx.y; y < kTransposeTile; y += kTransposeBlockRows) {
+        IdxT i = row0 + y;
+        IdxT j = col0 + threadIdx.x;
+        if (i < n_rows && j < n_cols) { tile[y][threadIdx.x ^ y] = in_b[i * n_cols + j]; }
+      }
+      __syncthreads();
+      for (int y = threadIdx.y; y < kTransposeTile; y += kTransposeBlockRows) {
+        IdxT i = col0 + y;
+        IdxT j = row0 + threadIdx.x;
+        if (i < n_cols && j < n_rows) {
+          out_b[i * n_rows + j] = tile[threadIdx.x][y ^ threadIdx.x];
+        }
+      }
+      __syncthreads();
+    }
+  }
+}
+
+template <typename T, typename IdxT>
+void transpose_batched(
+  const T* in, T* out, IdxT batch_size, IdxT n_rows, IdxT n_cols, cudaStream_t stream)
+{
+  if (batch_size == 0 || n_rows == 0 || n_cols == 0) { return; }
+  dim3 block(kTransposeTile, kTransposeBlockRows);
+  dim3 grid(raft::ceildiv<IdxT>(n_rows, kTransposeTile),
+            std::min<IdxT>(raft::ceildiv<IdxT>(n_cols, kTransposeTile), kTransposeMaxGridYz),
+            std::min<IdxT>(batch_size, kTransposeMaxGridYz));
+  transpose_tiled_kernel<<<grid, block, 0, stream>>>(in, out, batch_size, n_rows, n_cols);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/**
+ * The in-place transposes of square matrices [n, n]. Every thread block swaps a pair of tiles
+ * (t_row, t_col), t_col <= t_row, and their transposes: both are loaded before any is written.
+ */
+template <typename T, typename IdxT>
+RAFT_KERNEL transpose_square_inplace_kernel(T* data, IdxT batch_size, IdxT n)
+{
+  __shared__ T tile_a[kTransposeTile][kTransposeTile];
+  __shared__ T tile_b[kTransposeTile][kTransposeTile];
+  IdxT t_col   = blockIdx.x;
+  IdxT n_tiles = raft::ceildiv<IdxT>(n, kTransposeTile);
+  for (IdxT b = blockIdx.z; b < batch_size; b += gridDim.z) {
+    T* data_b = data + size_t(b) * n * n;
+    for (IdxT t_row = blockIdx.y; t_row < n_tiles; t_row += gridDim.y) {
+      if (t_col > t_row) { continue; }
+      IdxT i0 = t_row * kTransposeTile;
+      IdxT j0 = t_col * kTransposeTile;
+      for (int y = threadIdx.y; y < kTransposeTile; y += kTransposeBlockRows) {
+        if (i0 + y < n && j0 + threadIdx.x < n) {
+          tile_a[y][threadIdx.x ^ y] = data_b[(i0 + y) * n + j0 + threadIdx.x];
+        }
+        if (j0 + y < n && i0 + threadIdx.x < n) {
+          tile_b[y][threadIdx.x ^ y] = data_b[(j0 + y) * n + i0 + threadIdx.x];
+        }
+      }
+      __syncthreads();
+      for (int y = threadIdx.y; y < kTransposeTile; y += kTransposeBlockRows) {
+        if (j0 + y < n && i0 + threadIdx.x < n) {
+          data_b[(j0 + y) * n + i0 + threadIdx.x] = tile_a[threadIdx.x][y ^ threadIdx.x];
+        }
+        if (t_col != t_row && i0 + y < n && j0 + threadIdx.x < n) {
+          data_b[(i0 + y) * n + j0 + threadIdx.x] = tile_b[threadIdx.x][y ^ threadIdx.x];
+        }
+      }
+      __syncthreads();
+    }
+  }
+}
+
+template <typename T, typename IdxT>
+void transpose_square_inplace(T* data, IdxT batch_size, IdxT n, cudaStream_t stream)
+{
+  if (batch_size == 0 || n == 0) { return; }
+  IdxT n_tiles = raft::ceildiv<IdxT>(n, kTransposeTile);
+  dim3 block(kTransposeTile, kTransposeBlockRows);
+  dim3 grid(n_tiles,
+            std::min<IdxT>(n_tiles, kTransposeMaxGridYz),
+            std::min<IdxT>(batch_size, kTransposeMaxGridYz));
+  transpose_square_inplace_kernel<<<grid, block, 0, stream>>>(data, batch_size, n);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/**
+ * The in-place transpose of a rectangular matrix by following the cycles of the permutation:
+ * the element k = i * n_cols + j of the row-major [n_rows, n_cols] input goes to
+ * next(k) = j * n_rows + i. Every thread checks whether its index is the smallest of its cycle
+ * (it walks the cycle until it comes back, or finds a smaller index) and, if so, moves the
+ * elements of the whole cycle. The walks only read the indices: no extra memory is needed, at
+ * the cost of random accesses to the global memory.
+ */
+template <typename T, typename IdxT>
+RAFT_KERNEL transpose_cycles_inplace_kernel(T* data, IdxT n_rows, IdxT n_cols)
+{
+  auto next = [=](IdxT k) { return (k % n_cols) * n_rows + k / n_cols; };
+  IdxT len  = n_rows * n_cols;
+  // the first and the last elements do not move
+  for (IdxT s = IdxT(blockIdx.x) * blockDim.x + threadIdx.x + 1; s + 1 < len;
+       s += IdxT(blockDim.x) * gridDim.x) {
+    IdxT k = next(s);
+    while (k > s) {
+      k = next(k);
+    }
+    if (k != s) { continue; }
+    T carry = data[s];
+    for (k = next(s); k != s; k = next(k)) {
+      T tmp   = data[k];
+      data[k] = carry;
+      carry   = tmp;
+    }
+    data[s] = carry;
+  }
+}
+
+/**
+ * The in-place transpose of a row-major matrix [n_rows, n_cols] into the row-major
+ * [n_cols, n_rows].
+ */
+template <typename T, typename IdxT>
+void transpose_inplace(T* data, IdxT n_rows, IdxT n_cols, cudaStream_t stream)
+{
+  if (n_rows == n_cols) {
+    transpose_square_inplace(data, IdxT(1), n_rows, stream);
+    return;
+  }
+  if (n_rows <= 1 || n_cols <= 1) { return; }
+  constexpr int kTpb = 256;
+  IdxT n_blocks      = std::min<IdxT>(raft::ceildiv<IdxT>(n_rows * n_cols, kTpb), 65536);
+  transpose_cycles_inplace_kernel<<<n_blocks, kTpb, 0, stream>>>(data, n_rows, n_cols);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
 template <typename math_t>
 void transpose(math_t* inout, int n, cudaStream_t stream)
 {
-  auto m        = n;
-  auto size     = n * n;
-  auto d_inout  = inout;
-  auto counting = thrust::make_counting_iterator<int>(0);
-
-  thrust::for_each(rmm::exec_policy(stream), counting, counting + size, [=] __device__(int idx) {
-    int s_row = idx % m;
-    int s_col = idx / m;
-    int d_row = s_col;
-    int d_col = s_row;
-    if (s_row < s_col) {
-      auto temp                  = d_inout[d_col * m + d_row];
-      d_inout[d_col * m + d_row] = d_inout[s_col * m + s_row];
-      d_inout[s_col * m + s_row] = temp;
-    }
-  });
+  transpose_square_inplace(inout, 1, n, stream);
 }
 
 template <typename T, typename IndexType, typename LayoutPolicy, typename AccessorPolicy>
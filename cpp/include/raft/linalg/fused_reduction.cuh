@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/fused_reduction.cuh"
+#include "linalg_types.hpp"
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/kvp.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resources.hpp>
+
+#include <type_traits>
+
+namespace raft {
+namespace linalg {
+
+/**
+ * @defgroup fused_reduction Several reductions in a single pass
+ *
+ * The variants of `reduce`, `coalesced_reduction` and `strided_reduction` below compute any
+ * number of reductions of the same matrix while reading it only once, e.g. the sums, the sums of
+ * squares, the minima, the maxima and the positions of the maxima of all the rows of a row-major
+ * matrix:
+ * @code{.cpp}
+ *   using raft::linalg::make_reduction_output;
+ *   raft::linalg::fused_coalesced_reduction(
+ *     res,
+ *     data,
+ *     make_reduction_output(sums, 0.0f),
+ *     make_reduction_output(sq_sums, 0.0f, raft::sq_op{}),
+ *     make_reduction_output(mins, max_value, raft::identity_op{}, raft::min_op{}),
+ *     make_reduction_output(maxs, lowest_value, raft::identity_op{}, raft::max_op{}),
+ *     make_reduction_output(argmax,
+ *                           raft::KeyValuePair<int, float>{-1, lowest_value},
+ *                           raft::linalg::key_value_op{},
+ *                           raft::argmax_op{},
+ *                           raft::key_op{}));
+ * @endcode
+ * @{
+ */
+
+/**
+ * @brief One of the reductions of a fused reduction, and its output.
+ *
+ * The element k of `out` receives `final_op(reduce_op(init, main_op(x, i), ...))` over the
+ * elements x of its row (or column), i being the index of x along the reduced dimension. The
+ * reduction is carried out in `AccType`, which may differ from the output type (e.g. a
+ * raft::KeyValuePair reduced with raft::argmax_op, of which raft::key_op keeps the index).
+ */
+template <typename OutElementType,
+          typename IndexType,
+          typename AccType,
+          typename MainLambda,
+          typename ReduceLambda,
+          typename FinalLambda>
+struct reduction_output {
+  using acc_type = AccType;
+
+  raft::device_vector_view<OutElementType, IndexType> out;
+  AccType init;
+  MainLambda main_op;
+  ReduceLambda reduce_op;
+  FinalLambda final_op;
+};
+
+/**
+ * @brief Describe one of the reductions of a fused reduction.
+ *
+ * @param[out] out the result of the reduction, one element per row (or column)
+ * @param[in] init initial value of the reduction, of the type of the accumulator
+ * @param[in] main_op elementwise operation `AccType(InType, IndexType)` applied before the
+ *   reduction
+ * @param[in] reduce_op binary reduction operation over the accumulators
+ * @param[in] final_op operation `OutElementType(AccType)` applied before storing the result
+ */
+template <typename OutElementType,
+          typename IndexType,
+          typename AccType,
+          typename MainLambda   = raft::identity_op,
+          typename ReduceLambda = raft::add_op,
+          typename FinalLambda  = raft::identity_op>
+auto make_reduction_output(raft::device_vector_view<OutElementType, IndexType> out,
+                           AccType init,
+                           MainLambda main_op     = raft::identity_op(),
+                           ReduceLambda reduce_op = raft::add_op(),
+                           FinalLambda final_op   = raft::identity_op())
+  -> reduction_output<OutElementType, IndexType, AccType, MainLambda, ReduceLambda, FinalLambda>
+{
+  return {out, init, main_op, reduce_op, final_op};
+}
+
+/**
+ * @brief The main operation of an arg-reduction: pairs an element with its index
+ * (`raft::KeyValuePair{i, x}`), to be reduced with raft::argmin_op or raft::argmax_op.
+ */
+struct key_value_op {
+  template <typename Type, typename IndexType>
+  constexpr RAFT_INLINE_FUNCTION auto operator()(const Type& x, IndexType i) const
+  {
+    return raft::KeyValuePair<IndexType, Type>{i, x};
+  }
+};
+
+/**
+ * @brief Compute several reductions of the input matrix along the requested dimension, with a
+ * single read of the matrix.
+ *
+ * @tparam InElementType the input data-type of underlying raft::matrix_view
+ * @tparam LayoutPolicy The layout of the input (row or col major)
+ * @tparam IndexType Integer type used to for addressing
+ * @tparam ReductionTs the raft::linalg::reduction_output of the reductions
+ * @param[in] handle raft::resources
+ * @param[in] data Input of type raft::device_matrix_view
+ * @param[in] apply Apply::ALONG_ROWS for one result per row, Apply::ALONG_COLUMNS for one result
+ *   per column
+ * @param[inout] reductions the reductions and their outputs (see make_reduction_output)
+ */
+template <typename InElementType,
+          typename LayoutPolicy,
+          typename IndexType,
+          typename... ReductionTs>
+void fused_reduce(raft::resources const& handle,
+                  raft::device_matrix_view<const InElementType, IndexType, LayoutPolicy> data,
+                  Apply apply,
+                  ReductionTs... reductions)
+{
+  static_assert(sizeof...(ReductionTs) > 0, "At least one reduction is required");
+  static_assert(std::is_same_v<LayoutPolicy, raft::row_major> ||
+                  std::is_same_v<LayoutPolicy, raft::col_major>,
+                "Input must be row or column major");
+  bool along_rows = apply == Apply::ALONG_ROWS;
+  auto n_outputs  = along_rows ? data.extent(0) : data.extent(1);
+  bool sizes_ok   = ((IndexType(reductions.out.extent(0)) == n_outputs) && ...);
+  RAFT_EXPECTS(sizes_ok, "Every output should have one element per reduced row (or column)");
+  detail::fused_reduce(handle, data, along_rows, reductions...);
+}
+
+/**
+ * @brief Compute several reductions of the input matrix along the leading dimension (the fused
+ * raft::linalg::coalesced_reduction: one result per row of a row-major matrix, per column of a
+ * column-major one), with a single read of the matrix.
+ *
+ * @param[in] handle raft::resources
+ * @param[in] data Input of type raft::device_matrix_view
+ * @param[inout] reductions the reductions and their outputs
+ */
+template <typename InElementType,
+          typename LayoutPolicy,
+          typename IndexType,
+          typename... ReductionTs>
+void fused_coalesced_reduction(
+  raft::resources const& handle,
+  raft::device_matrix_view<const InElementType, IndexType, LayoutPolicy> data,
+  ReductionTs... reductions)
+{
+  constexpr bool kRowMajor = std::is_same_v<LayoutPolicy, raft::row_major>;
+  fused_reduce(
+    handle, data, kRowMajor ? Apply::ALONG_ROWS : Apply::ALONG_COLUMNS, reductions...);
+}
+
+/**
+ * @brief Compute several reductions of the input matrix along the strided dimension (the fused
+ * raft::linalg::strided_reduction: one result per column of a row-major matrix, per row of a
+ * column-major one), with a single read of the matrix.
+ *
+ * @param[in] handle raft::resources
+ * @param[in] data Input of type raft::device_matrix_view
+ * @param[inout] reductions the reductions and their outputs
+ */
+template <typename InElementType,
+          typename LayoutPolicy,
+          typename IndexType,
+          typename... ReductionTs>
+void fused_strided_reduction(
+  raft::resources const& handle,
+  raft::device_matrix_view<const InElementType, IndexType, LayoutPolicy> data,
+  ReductionTs... reductions)
+{
+  constexpr bool kRowMajor = std::is_same_v<LayoutPolicy, raft::row_major>;
+  fused_reduce(
+    handle, data, kRowMajor ? Apply::ALONG_COLUMNS : Apply::ALONG_ROWS, reductions...);
+}
+
+/** @} */  // end of group fused_reduction
+
+}  // namespace linalg
+}  // namespace raft
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/lazy.cuh"
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/linalg_types.hpp>
+
+namespace raft::linalg::lazy {
+
+/**
+ * @defgroup lazy_linalg Lazy expressions over mdspans
+ *
+ * The elementwise operations (`map`), the broadcasts of vectors (`matrix_vector_op`) and the
+ * reductions of RAFT read and write the whole matrix once per call. The lazy variants below only
+ * build an expression (a small functor evaluating one element on the device); the chain runs in a
+ * single kernel when it reaches a terminal operation (`evaluate`, `coalesced_reduction`,
+ * `strided_reduction` or `reduce`), which reads the input matrices once and writes only the
+ * result.
+ *
+ * For example, the squared norms of the mean-centered rows of a matrix, given its column means:
+ * @code{.cpp}
+ *   namespace lazy = raft::linalg::lazy;
+ *   auto centered = lazy::matrix_vector_op(
+ *     lazy::matrix(data), means, raft::linalg::Apply::ALONG_ROWS, raft::sub_op{});
+ *   lazy::coalesced_reduction(res, lazy::map(centered, raft::sq_op{}), norms, 0.0f);
+ * @endcode
+ *
+ * The operations are either the RAFT operators (`raft::sq_op`, `raft::add_op`, ...) or
+ * `__host__ __device__` lambdas (the type of an expression is deduced from the result of its
+ * operation on the host). An expression holds views: the viewed memory must outlive it. The
+ * expressions evaluate single elements, so the leaves should be row-major (or the chain should
+ * be transposed) for the accesses of the kernels to be coalesced.
+ * @{
+ */
+
+/** @brief The leaf of an expression: the elements of a matrix view. */
+template <typename ElementType, typename IndexType, typename LayoutPolicy>
+auto matrix(raft::device_matrix_view<ElementType, IndexType, LayoutPolicy> view)
+{
+  return detail::matrix_expr<raft::device_matrix_view<const ElementType, IndexType, LayoutPolicy>>{
+    view};
+}
+
+/**
+ * @brief The elementwise operation `op(expr(i, j))` (the lazy `raft::linalg::map`).
+ *
+ * @param[in] expr the input expression
+ * @param[in] op the operation
+ */
+template <typename ExprT, typename OpT>
+auto map(ExprT expr, OpT op)
+{
+  return detail::unary_expr<OpT, ExprT>{op, expr};
+}
+
+/**
+ * @brief The elementwise operation `op(expr1(i, j), expr2(i, j))` of two expressions of the same
+ * shape (the lazy `raft::linalg::map` of two inputs).
+ *
+ * @param[in] expr1 the first input expression
+ * @param[in] expr2 the second input expression
+ * @param[in] op the operation
+ */
+template <typename Expr1T, typename Expr2T, typename OpT>
+auto map(Expr1T expr1, Expr2T expr2, OpT op)
+{
+  RAFT_EXPECTS(expr1.n_rows() == expr2.n_rows() && expr1.n_cols() == expr2.n_cols(),
+               "The expressions should have the same shape");
+  return detail::binary_expr<OpT, Expr1T, Expr2T>{op, expr1, expr2};
+}
+
+/**
+ * @brief The broadcast of a vector over an expression (the lazy `raft::linalg::matrix_vector_op`).
+ *
+ * @param[in] expr the input expression
+ * @param[in] vec the vector: one element per column if `apply` is `Apply::ALONG_ROWS`, one element
+ *   per row if `Apply::ALONG_COLUMNS`
+ * @param[in] apply the direction of the broadcast
+ * @param[in] op the operation `op(expr(i, j), vec(j))` (or `vec(i)`)
+ */
+template <typename ExprT, typename ElementType, typename IndexType, typename OpT>
+auto matrix_vector_op(ExprT expr,
+                      raft::device_vector_view<ElementType, IndexType> vec,
+                      Apply apply,
+                      OpT op)
+{
+  bool along_rows = apply == Apply::ALONG_ROWS;
+  RAFT_EXPECTS(vec.extent(0) == (along_rows ? expr.n_cols() : expr.n_rows()),
+               "The size of the vector should match the direction of the broadcast");
+  auto cvec = raft::make_device_vector_view<const ElementType, IndexType>(vec.data_handle(),
+                                                                          vec.extent(0));
+  return detail::broadcast_expr<OpT, ExprT, decltype(cvec)>{op, expr, cvec, along_rows};
+}
+
+/**
+ * @brief Evaluate an expression into a matrix: the whole chain runs in a single kernel.
+ *
+ * @param[in] res raft::resources
+ * @param[in] expr the expression
+ * @param[out] out the output matrix, of the shape of the expression
+ */
+template <typename ExprT, typename ElementType, typename IndexType, typename LayoutPolicy>
+void evaluate(raft::resources const& res,
+              const ExprT& expr,
+              raft::device_matrix_view<ElementType, IndexType, LayoutPolicy> out)
+{
+  RAFT_EXPECTS(out.extent(0) == expr.n_rows() && out.extent(1) == expr.n_cols(),
+               "The output should have the shape of the expression");
+  detail::evaluate(res, expr, out);
+}
+
+/**
+ * @brief Reduce every row of an expression (the lazy `raft::linalg::coalesced_reduction`).
+ *
+ * @param[in] res raft::resources
+ * @param[in] expr the expression
+ * @param[out] out one value per row
+ * @param[in] init the initial value of the reduction (the identity of `reduce_op`)
+ * @param[in] reduce_op the binary reduction
+ * @param[in] final_op the operation applied to the result of every row
+ */
+template <typename ExprT,
+          typename OutType,
+          typename IndexType,
+          typename ReduceOp = raft::add_op,
+          typename FinalOp  = raft::identity_op>
+void coalesced_reduction(raft::resources const& res,
+                         const ExprT& expr,
+                         raft::device_vector_view<OutType, IndexType> out,
+                         OutType init,
+                         ReduceOp reduce_op = raft::add_op(),
+                         FinalOp final_op   = raft::identity_op())
+{
+  RAFT_EXPECTS(out.extent(0) == expr.n_rows(), "The output should have one element per row");
+  detail::coalesced_reduction(res, expr, out.data_handle(), init, reduce_op, final_op);
+}
+
+/**
+ * @brief Reduce every column of an expression (the lazy `raft::linalg::strided_reduction`).
+ *
+ * @param[in] res raft::resources
+ * @param[in] expr the expression
+ * @param[out] out one value per column
+ * @param[in] init the initial value of the reduction (the identity of `reduce_op`)
+ * @param[in] reduce_op the binary reduction
+ * @param[in] final_op the operation applied to the result of every column
+ */
+template <typename ExprT,
+          typename OutType,
+          typename IndexType,
+          typename ReduceOp = raft::add_op,
+          typename FinalOp  = raft::identity_op>
+void strided_reduction(raft::resources const& res,
+                       const ExprT& expr,
+                       raft::device_vector_view<OutType, IndexType> out,
+                       OutType init,
+                       ReduceOp reduce_op = raft::add_op(),
+                       FinalOp final_op   = raft::identity_op())
+{
+  RAFT_EXPECTS(out.extent(0) == expr.n_cols(), "The output should have one element per column");
+  detail::strided_reduction(res, expr, out.data_handle(), init, reduce_op, final_op);
+}
+
+/**
+ * @brief Reduce an expression along its rows (one value per row) or its columns (one value per
+ * column), as `raft::linalg::reduce`.
+ *
+ * @param[in] res raft::resources
+ * @param[in] expr the expression
+ * @param[out] out the result of the reduction
+ * @param[in] init the initial value of the reduction (the identity of `reduce_op`)
+ * @param[in] apply whether to reduce along the rows or along the columns
+ * @param[in] reduce_op the binary reduction
+ * @param[in] final_op the operation applied to every result
+ */
+template <typename ExprT,
+          typename OutType,
+          typename IndexType,
+          typename ReduceOp = raft::add_op,
+          typename FinalOp  = raft::identity_op>
+void reduce(raft::resources const& res,
+            const ExprT& expr,
+            raft::device_vector_view<OutType, IndexType> out,
+            OutType init,
+            Apply apply,
+            ReduceOp reduce_op = raft::add_op(),
+            FinalOp final_op   = raft::identity_op())
+{
+  if (apply == Apply::ALONG_ROWS) {
+    coalesced_reduction(res, expr, out, init, reduce_op, final_op);
+  } else {
+    strided_reduction(res, expr, out, init, reduce_op, final_op);
+  }
+}
+
+/** @} */
+
+}  // namespace raft::linalg::lazy
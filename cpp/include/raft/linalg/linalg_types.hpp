@@ -39,4 +39,11 @@ enum class FillMode { UPPER, LOWER };
  */
 enum class Operation { NON_TRANSPOSE, TRANSPOSE };
 
+/**
+ * @brief Enum for the method of the streaming least squares (see `lstsq_accumulator`): the R factor
+ * of the tall-skinny QR decomposition, or the normal equations.
+ *
+ */
+enum class lstsq_method { TSQR, NORMAL_EQUATIONS };
+
 }  // end namespace raft::linalg
\ No newline at end of file
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,9 +18,21 @@
 
 #pragma once
 
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/resource/comms.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/linalg/detail/lstsq.cuh>
+#include <raft/linalg/detail/lstsq_streaming.cuh>
+#include <raft/linalg/linalg_types.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <cstdint>
+#include <type_traits>
 namespace raft {
 namespace linalg {
 
@@ -243,6 +255,206 @@ void lstsq_qr(raft::resources const& handle,
           resource::get_cuda_stream(handle));
 }
 
+/**
+ * @brief The least squares solution of `Aw = b` for a tall A streamed by blocks of rows.
+ *
+ * Only an (n_cols + 1) x (n_cols + 1) state lives on the device, whatever the number of rows:
+ *  - lstsq_method::TSQR (tall-skinny QR) keeps the R factor of the QR decomposition of [A b];
+ *    every block of rows is stacked under it and factorized again. The solution solves the
+ *    triangular system `Rw = Q^T b`, with the accuracy of `lstsq_qr`.
+ *  - lstsq_method::NORMAL_EQUATIONS sums the Gram matrices [A_b b_b]^T [A_b b_b] of the blocks (a
+ *    single gemm per block) and solves `A^T A w = A^T b` by the Cholesky factorization: it is
+ *    faster, but squares the condition number of A, as `lstsq_eig`.
+ * In both cases, A must have full column rank.
+ *
+ * The blocks come from the device or the host (and are copied to the device), in row- or
+ * column-major order. The accumulators of disjoint sets of rows are combined by `merge`, and those
+ * of the ranks of a communicator by `allreduce` (for instance, with every rank streaming its own
+ * part of the rows).
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   #include <raft/linalg/lstsq.cuh>
+ *
+ *   raft::linalg::lstsq_accumulator<float> acc(handle, n_cols);
+ *   for (int64_t row0 = 0; row0 < n_rows; row0 += batch_rows) {
+ *     int64_t rows = std::min(batch_rows, n_rows - row0);
+ *     auto A_b =
+ *       raft::make_host_matrix_view<const float, int64_t>(A + row0 * n_cols, rows, n_cols);
+ *     auto b_b = raft::make_host_vector_view<const float, int64_t>(b + row0, rows);
+ *     acc.update(handle, A_b, b_b);
+ *   }
+ *   acc.solve(handle, w.view());
+ * @endcode
+ *
+ * @tparam ValueType the data-type of input/output
+ */
+template <typename ValueType>
+class lstsq_accumulator {
+ public:
+  /**
+   * @brief An accumulator of no rows.
+   *
+   * @param[in] handle raft::resources
+   * @param[in] n_cols the number of columns of A
+   * @param[in] method how the rows are accumulated
+   */
+  lstsq_accumulator(raft::resources const& handle,
+                    int n_cols,
+                    lstsq_method method = lstsq_method::TSQR)
+    : method_(method),
+      n_cols_(n_cols),
+      state_(raft::make_device_matrix<ValueType, int, raft::col_major>(
+        handle, n_cols + 1, n_cols + 1)),
+      workspace_(0, resource::get_cuda_stream(handle)),
+      staging_(0, resource::get_cuda_stream(handle))
+  {
+    RAFT_EXPECTS(n_cols > 0, "lstsq_accumulator: n_cols must be positive");
+    reset(handle);
+  }
+
+  /** @brief Forget all the rows. */
+  void reset(raft::resources const& handle)
+  {
+    n_rows_ = 0;
+    RAFT_CUDA_TRY(cudaMemsetAsync(state_.data_handle(),
+                                  0,
+                                  state_.size() * sizeof(ValueType),
+                                  resource::get_cuda_stream(handle)));
+  }
+
+  /**
+   * @brief Add a block of rows of A and their targets in device memory.
+   *
+   * @param[in] handle raft::resources
+   * @param[in] A the rows raft::device_matrix_view [rows, n_cols], row- or column-major
+   * @param[in] b the targets raft::device_vector_view [rows]
+   */
+  template <typename IndexType, typename LayoutPolicy>
+  void update(raft::resources const& handle,
+              raft::device_matrix_view<const ValueType, IndexType, LayoutPolicy> A,
+              raft::device_vector_view<const ValueType, IndexType> b)
+  {
+    RAFT_EXPECTS(A.extent(1) == IndexType(n_cols_), "Size mismatch between A and the accumulator");
+    RAFT_EXPECTS(A.extent(0) == b.size(), "Size mismatch between A and b");
+    detail::lstsq_update(handle,
+                         method_,
+                         n_cols_,
+                         state_.data_handle(),
+                         A.data_handle(),
+                         b.data_handle(),
+                         int64_t(A.extent(0)),
+                         std::is_same_v<LayoutPolicy, raft::row_major>,
+                         workspace_);
+    n_rows_ += int64_t(A.extent(0));
+  }
+
+  /**
+   * @brief Add a block of rows of A and their targets in host memory.
+   *
+   * The block is copied to the device on the stream of the handle; the copies of pinned host
+   * memory overlap with the previous work.
+   *
+   * @param[in] handle raft::resources
+   * @param[in] A the rows raft::host_matrix_view [rows, n_cols], row- or column-major
+   * @param[in] b the targets raft::host_vector_view [rows]
+   */
+  template <typename IndexType, typename LayoutPolicy>
+  void update(raft::resources const& handle,
+              raft::host_matrix_view<const ValueType, IndexType, LayoutPolicy> A,
+              raft::host_vector_view<const ValueType, IndexType> b)
+  {
+    RAFT_EXPECTS(A.extent(1) == IndexType(n_cols_), "Size mismatch between A and the accumulator");
+    RAFT_EXPECTS(A.extent(0) == b.size(), "Size mismatch between A and b");
+    auto stream = resource::get_cuda_stream(handle);
+    auto rows   = int64_t(A.extent(0));
+    staging_.resize(rows * (n_cols_ + 1), stream);
+    raft::copy(staging_.data(), A.data_handle(), rows * n_cols_, stream);
+    raft::copy(staging_.data() + rows * n_cols_, b.data_handle(), rows, stream);
+    update(handle,
+           raft::make_device_matrix_view<const ValueType, int64_t, LayoutPolicy>(
+             staging_.data(), rows, n_cols_),
+           raft::make_device_vector_view<const ValueType, int64_t>(
+             staging_.data() + rows * n_cols_, rows));
+  }
+
+  /**
+   * @brief Add the rows of another accumulator (of the same shape and method).
+   *
+   * @param[in] handle raft::resources
+   * @param[in] other the accumulator of other rows
+   */
+  void merge(raft::resources const& handle, const lstsq_accumulator& other)
+  {
+    RAFT_EXPECTS(other.n_cols_ == n_cols_ && other.method_ == method_,
+                 "lstsq_accumulator: merging accumulators of different shapes or methods");
+    detail::lstsq_merge(
+      handle, method_, n_cols_, state_.data_handle(), other.state_.data_handle());
+    n_rows_ += other.n_rows_;
+  }
+
+  /**
+   * @brief Combine the accumulators of all the ranks of the communicator of the handle.
+   *
+   * This is a collective operation: after it, every rank holds the accumulator of the rows of all
+   * the ranks (the normal equations are summed by `comms_t::allreduce`; the R factors are gathered
+   * and factorized again, in the order of the ranks, so that every rank gets the same result).
+   *
+   * @param[in] handle raft::resources with an initialized communicator
+   */
+  void allreduce(raft::resources const& handle)
+  {
+    const auto& comms = resource::get_comms(handle);
+    auto stream       = resource::get_cuda_stream(handle);
+    detail::lstsq_allreduce(handle, method_, n_cols_, state_.data_handle(), comms);
+    rmm::device_scalar<int64_t> n_rows(n_rows_, stream);
+    comms.allreduce(n_rows.data(), n_rows.data(), 1, raft::comms::op_t::SUM, stream);
+    RAFT_EXPECTS(comms.sync_stream(stream) == raft::comms::status_t::SUCCESS,
+                 "lstsq_accumulator: the allreduce of the row counts failed");
+    n_rows_ = n_rows.value(stream);
+  }
+
+  /**
+   * @brief The least squares solution w of the rows accumulated so far.
+   *
+   * The accumulator is left unchanged: more rows may be added and the problem solved again.
+   *
+   * @param[in] handle raft::resources
+   * @param[out] w output coefficient raft::device_vector_view [n_cols]
+   */
+  template <typename IndexType>
+  void solve(raft::resources const& handle, raft::device_vector_view<ValueType, IndexType> w) const
+  {
+    RAFT_EXPECTS(w.size() == IndexType(n_cols_), "Size mismatch between w and the accumulator");
+    RAFT_EXPECTS(n_rows_ >= n_cols_, "lstsq_accumulator: fewer rows than columns");
+    detail::lstsq_solve(handle, method_, n_cols_, state_.data_handle(), w.data_handle());
+  }
+
+  /** The number of the rows accumulated. */
+  [[nodiscard]] auto n_rows() const noexcept -> int64_t { return n_rows_; }
+  /** The number of the columns of A. */
+  [[nodiscard]] auto n_cols() const noexcept -> int { return n_cols_; }
+  /** How the rows are accumulated. */
+  [[nodiscard]] auto method() const noexcept -> lstsq_method { return method_; }
+  /**
+   * The state [n_cols + 1, n_cols + 1] of the augmented matrix [A b]: its R factor (TSQR) or its
+   * Gram matrix (NORMAL_EQUATIONS).
+   */
+  [[nodiscard]] auto state() const noexcept
+    -> raft::device_matrix_view<const ValueType, int, raft::col_major>
+  {
+    return state_.view();
+  }
+
+ private:
+  lstsq_method method_;
+  int n_cols_;
+  int64_t n_rows_{0};
+  raft::device_matrix<ValueType, int, raft::col_major> state_;
+  rmm::device_uvector<ValueType> workspace_;
+  rmm::device_uvector<ValueType> staging_;
+};
+
 /** @} */  // end of lstsq
 
 };  // namespace linalg
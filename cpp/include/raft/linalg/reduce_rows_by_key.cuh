@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -133,6 +133,12 @@ void reduce_rows_by_key(const DataIteratorT d_A,
 /**
  * @brief Computes the weighted sum-reduction of matrix rows for each given key
  * TODO: Support generic reduction lambdas https://github.com/rapidsai/raft/issues/860
+ *
+ * The strategy depends on the number of keys: up to 4 keys (with `d_keys_char`), the
+ * columns are reduced in registers; when the sums of all the keys fit into shared memory, every
+ * block reduces into a private copy of them; otherwise (e.g. the centers of 100k IVF lists), each
+ * thread sums the consecutive rows of the same key before updating the global sums, which saves
+ * most of the atomics when the keys are sorted or clustered.
  * @tparam ElementType data-type of input and output
  * @tparam KeyType data-type of keys
  * @tparam WeightType data-type of weights
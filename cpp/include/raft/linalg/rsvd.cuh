@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,7 +19,10 @@
 #pragma once
 
 #include "detail/rsvd.cuh"
+#include "detail/rsvd_streaming.cuh"
 #include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/resource/comms.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 
 namespace raft {
@@ -874,6 +877,74 @@ void randomized_svd(const raft::resources& handle,
   randomized_svd(handle, in, S, opt_u, opt_v, p, niters);
 }
 
+/**
+ * @brief randomized singular value decomposition (RSVD) of a tall matrix in host memory, streamed
+ * to the device by blocks of rows (out-of-core).
+ *
+ * The range finder runs its power iterations on A^T A, accumulated over the blocks of rows, and the
+ * decomposition is obtained from the eigen decomposition of the (k + p) x (k + p) Gram matrix of
+ * the projection: only the sketches [n_cols, k + p] and one block of rows live on the device. The
+ * matrix is read (niters + 2) times, once more if U is requested. As with `use_bbt` in
+ * `rsvd_fixed_rank`, the Gram matrix squares the condition number: the smallest of the requested
+ * singular values lose accuracy in single precision.
+ *
+ * @tparam math_t the data type
+ * @tparam idx_t index type
+ * @param[in]  handle:     raft handle
+ * @param[in]  in:         input matrix, row-major in host memory [dim = n_rows * n_cols]
+ * @param[out] S:          singular values of the input matrix, in decreasing order [dim = k]
+ * @param[out] V:          right singular vectors of the input matrix [dim = k * n_cols]
+ * @param[out] U:          optional left singular vectors of the input matrix, row-major in host
+ * memory. Use std::nullopt to not generate it. [dim = n_rows * k]
+ * @param[in]  p:          Oversampling. (k + p) must be at most n_cols.
+ * @param[in]  niters:     Number of power iterations.
+ * @param[in]  batch_rows: Number of rows of the blocks copied to the device.
+ * @param[in]  seed:       Seed of the random range finder.
+ */
+template <typename math_t, typename idx_t, typename opt_u_mat_t>
+void randomized_svd_streaming(const raft::resources& handle,
+                              raft::host_matrix_view<const math_t, idx_t, raft::row_major> in,
+                              raft::device_vector_view<math_t, idx_t> S,
+                              raft::device_matrix_view<math_t, idx_t, raft::col_major> V,
+                              opt_u_mat_t&& U,
+                              std::size_t p,
+                              std::size_t niters,
+                              std::size_t batch_rows,
+                              uint64_t seed = 0)
+{
+  std::optional<raft::host_matrix_view<math_t, idx_t, raft::row_major>> opt_u =
+    std::forward<opt_u_mat_t>(U);
+  detail::rsvd_streaming(handle, in, S, V, opt_u, p, niters, batch_rows, seed, nullptr);
+}
+
+/**
+ * @brief The distributed `randomized_svd_streaming`: every rank of the communicator of the handle
+ * holds (in host memory) different rows of the input matrix.
+ *
+ * The small sketch matrices are summed over the ranks with `comms_t::allreduce`, and all the ranks
+ * get the same S and V; U contains the left singular vectors of the local rows. All the ranks must
+ * call the function with the same k, p, niters and seed.
+ *
+ * Please see above for documentation of `randomized_svd_streaming`.
+ */
+template <typename math_t, typename idx_t, typename opt_u_mat_t>
+void randomized_svd_streaming_distributed(
+  const raft::resources& handle,
+  raft::host_matrix_view<const math_t, idx_t, raft::row_major> in,
+  raft::device_vector_view<math_t, idx_t> S,
+  raft::device_matrix_view<math_t, idx_t, raft::col_major> V,
+  opt_u_mat_t&& U,
+  std::size_t p,
+  std::size_t niters,
+  std::size_t batch_rows,
+  uint64_t seed = 0)
+{
+  std::optional<raft::host_matrix_view<math_t, idx_t, raft::row_major>> opt_u =
+    std::forward<opt_u_mat_t>(U);
+  const auto& comms = resource::get_comms(handle);
+  detail::rsvd_streaming(handle, in, S, V, opt_u, p, niters, batch_rows, seed, &comms);
+}
+
 /** @} */  // end of group rsvd
 
 };  // end namespace linalg
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,6 +20,7 @@
 
 #include "detail/transpose.cuh"
 #include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
 
 namespace raft {
@@ -101,6 +102,86 @@ auto transpose(raft::resources const& handle,
   }
 }
 
+/**
+ * @brief Transpose a matrix in place. The result has the same layout policy as the input.
+ *
+ * Square matrices are transposed by swapping pairs of tiles through the shared memory;
+ * rectangular ones by following the cycles of the permutation, which needs no extra memory but
+ * is slower than the out-of-place transpose. As the storage of a row-major [n_rows, n_cols]
+ * matrix transposed in place is the column-major [n_rows, n_cols] view of the input, this is a
+ * way to change the layout of a matrix without a second copy of it.
+ *
+ * @code{.cpp}
+ *   auto m = raft::make_device_matrix<float, int64_t, raft::row_major>(handle, n_rows, n_cols);
+ *   ...
+ *   // [n_cols, n_rows], row-major
+ *   auto m_t = raft::linalg::transpose_inplace(handle, m.view());
+ *   // the same values as m, column-major
+ *   auto m_col = raft::make_device_matrix_view<float, int64_t, raft::col_major>(
+ *     m_t.data_handle(), n_rows, n_cols);
+ * @endcode
+ *
+ * @tparam T Data type of the matrix elements.
+ * @tparam IndexType Index type of the matrix extents.
+ * @tparam LayoutPolicy raft::row_major or raft::col_major.
+ *
+ * @param[in] handle raft handle for managing expensive cuda resources.
+ * @param[inout] inout The matrix [n_rows, n_cols], overwritten by its transpose.
+ *
+ * @return The view [n_cols, n_rows] of the transposed matrix.
+ */
+template <typename T, typename IndexType, typename LayoutPolicy>
+auto transpose_inplace(raft::resources const& handle,
+                       raft::device_matrix_view<T, IndexType, LayoutPolicy> inout)
+  -> raft::device_matrix_view<T, IndexType, LayoutPolicy>
+{
+  static_assert(std::is_same_v<LayoutPolicy, layout_c_contiguous> ||
+                  std::is_same_v<LayoutPolicy, layout_f_contiguous>,
+                "transpose_inplace expects a row-major or a column-major matrix.");
+  IndexType n_rows = inout.extent(0);
+  IndexType n_cols = inout.extent(1);
+  // the column-major [n_rows, n_cols] storage is the row-major [n_cols, n_rows] one
+  if constexpr (std::is_same_v<LayoutPolicy, layout_c_contiguous>) {
+    detail::transpose_inplace(
+      inout.data_handle(), n_rows, n_cols, resource::get_cuda_stream(handle));
+  } else {
+    detail::transpose_inplace(
+      inout.data_handle(), n_cols, n_rows, resource::get_cuda_stream(handle));
+  }
+  return raft::make_device_matrix_view<T, IndexType, LayoutPolicy>(
+    inout.data_handle(), n_cols, n_rows);
+}
+
+/**
+ * @brief Transpose a batch of row-major matrices: out[b] = in[b]^T.
+ *
+ * The matrices are moved by 32 x 32 tiles through the shared memory, with coalesced loads and
+ * stores, in a single kernel launch for the whole batch.
+ *
+ * @tparam T Data type of the matrix elements.
+ * @tparam IndexType Index type of the extents.
+ *
+ * @param[in] handle raft handle for managing expensive cuda resources.
+ * @param[in] in The matrices [batch_size, n_rows, n_cols].
+ * @param[out] out The transposed matrices [batch_size, n_cols, n_rows].
+ */
+template <typename T, typename IndexType>
+void batched_transpose(
+  raft::resources const& handle,
+  raft::device_mdspan<const T, raft::extent_3d<IndexType>, raft::row_major> in,
+  raft::device_mdspan<T, raft::extent_3d<IndexType>, raft::row_major> out)
+{
+  RAFT_EXPECTS(out.extent(0) == in.extent(0), "The batches should have the same size.");
+  RAFT_EXPECTS(out.extent(1) == in.extent(2), "Invalid shape for transpose.");
+  RAFT_EXPECTS(out.extent(2) == in.extent(1), "Invalid shape for transpose.");
+  detail::transpose_batched(in.data_handle(),
+                            out.data_handle(),
+                            in.extent(0),
+                            in.extent(1),
+                            in.extent(2),
+                            resource::get_cuda_stream(handle));
+}
+
 /** @} */  // end of group transpose
 
 };  // end namespace linalg
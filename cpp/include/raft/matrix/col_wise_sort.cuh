@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -132,6 +132,82 @@ void sort_cols_per_row(Args... args)
   sort_cols_per_row(std::forward<Args>(args)..., std::nullopt);
 }
 
+/**
+ * @brief Sort the columns within each row of a row-major matrix in place (keys only).
+ *
+ * The rows may be strided (e.g. a padded matrix, or a block of columns of a wider matrix), as long
+ * as every row is contiguous (`keys.stride(1) == 1`). The rows of up to 1024 columns are sorted in
+ * registers by one warp (or sub-warp, for the rows of up to 16 columns) each, without workspace;
+ * the longer rows by a CUB segmented sort.
+ *
+ * @code{.cpp}
+ * // sort the first k columns of every row of a padded kNN graph
+ * auto graph = raft::make_device_matrix<int64_t, int64_t>(handle, n_rows, graph_degree);
+ * auto first = raft::make_device_strided_matrix_view<int64_t, int64_t>(
+ *   graph.data_handle(), n_rows, k, graph_degree);
+ * raft::matrix::sort_cols_per_row_inplace(handle, first);
+ * @endcode
+ *
+ * @tparam KeyT element type of the matrix (any arithmetic type, including 64-bit integers)
+ * @tparam IdxT integer type for matrix indexing
+ * @tparam LayoutPolicy the layout of the matrix (row-major, strided or padded)
+ * @param[in] handle raft handle
+ * @param[inout] keys the matrix [n_rows, n_cols], sorted row by row
+ * @param[in] ascending the order of the sort
+ */
+template <typename KeyT, typename IdxT, typename LayoutPolicy>
+void sort_cols_per_row_inplace(raft::resources const& handle,
+                               raft::device_matrix_view<KeyT, IdxT, LayoutPolicy> keys,
+                               bool ascending = true)
+{
+  RAFT_EXPECTS(keys.extent(1) <= 1 || keys.stride(1) == 1,
+               "The rows of `keys` must be contiguous.");
+  detail::sort_rows_inplace<KeyT, KeyT, IdxT>(handle,
+                                              keys.data_handle(),
+                                              IdxT(keys.stride(0)),
+                                              nullptr,
+                                              IdxT(0),
+                                              keys.extent(0),
+                                              keys.extent(1),
+                                              ascending);
+}
+
+/**
+ * @brief Sort the columns within each row of a row-major matrix of keys in place, together with
+ *   the values of a matrix of the same shape (a stable key-value sort).
+ *
+ * Both matrices may be strided (their rows contiguous); see the keys-only overload.
+ *
+ * @tparam KeyT element type of the keys (any arithmetic type, including 64-bit integers)
+ * @tparam ValT element type of the values
+ * @tparam IdxT integer type for matrix indexing
+ * @tparam KeyLayout the layout of the keys (row-major, strided or padded)
+ * @tparam ValLayout the layout of the values (row-major, strided or padded)
+ * @param[in] handle raft handle
+ * @param[inout] keys the keys [n_rows, n_cols], sorted row by row
+ * @param[inout] values the values [n_rows, n_cols], permuted as their keys
+ * @param[in] ascending the order of the sort
+ */
+template <typename KeyT, typename ValT, typename IdxT, typename KeyLayout, typename ValLayout>
+void sort_cols_per_row_inplace(raft::resources const& handle,
+                               raft::device_matrix_view<KeyT, IdxT, KeyLayout> keys,
+                               raft::device_matrix_view<ValT, IdxT, ValLayout> values,
+                               bool ascending = true)
+{
+  RAFT_EXPECTS(keys.extent(0) == values.extent(0) && keys.extent(1) == values.extent(1),
+               "`keys` and `values` must have the same shape.");
+  RAFT_EXPECTS(keys.extent(1) <= 1 || (keys.stride(1) == 1 && values.stride(1) == 1),
+               "The rows of `keys` and `values` must be contiguous.");
+  detail::sort_rows_inplace<KeyT, ValT, IdxT>(handle,
+                                              keys.data_handle(),
+                                              IdxT(keys.stride(0)),
+                                              values.data_handle(),
+                                              IdxT(values.stride(0)),
+                                              keys.extent(0),
+                                              keys.extent(1),
+                                              ascending);
+}
+
 /** @} */  // end of group col_wise_sort
 
 };  // end namespace raft::matrix
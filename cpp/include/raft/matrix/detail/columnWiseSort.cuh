@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,11 +16,26 @@
 
 #pragma once
 
-#include <cstddef>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/bitonic_sort.cuh>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_buffer.hpp>
+#include <rmm/device_uvector.hpp>
+
 #include <cub/cub.cuh>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
+
+#include <algorithm>
+#include <cstddef>
 #include <limits>
 #include <map>
-#include <raft/util/cuda_utils.cuh>
+#include <type_traits>
 
 #define INST_BLOCK_SORT(keyIn, keyOut, valueInOut, rows, columns, blockSize, elemPT, stream)     \
   devKeyValSortColumnPerRow<InType, OutType, blockSize, elemPT><<<rows, blockSize, 0, stream>>>( \
@@ -36,7 +51,9 @@ struct TemplateChecker {
     IsValid = (std::is_same<InType, short>::value && BLOCK_SIZE <= 1024) ||
               (std::is_same<InType, int>::value && BLOCK_SIZE <= 1024) ||
               (std::is_same<InType, float>::value && BLOCK_SIZE <= 1024) ||
-              (std::is_same<InType, double>::value && BLOCK_SIZE <= 512)
+              (std::is_same<InType, double>::value && BLOCK_SIZE <= 512) ||
+              (std::is_same<InType, int64_t>::value && BLOCK_SIZE <= 512) ||
+              (std::is_same<InType, uint64_t>::value && BLOCK_SIZE <= 512)
   };
 };
 
@@ -156,6 +173,313 @@ cudaError_t layoutSortOffset(T* in, T value, int n_times, cudaStream_t stream)
   return cudaGetLastError();
 }
 
+/** The longest rows sorted by the (sub-)warp bitonic path. */
+constexpr int kSortRowsWarpMaxCols = 1024;
+constexpr int kSortRowsBlockSize   = 128;
+
+/**
+ * The key of the bitonic sort of the rows with values: ordered by the key in the requested
+ * direction, then by the column. This makes the sort stable, and places the padding of the rows
+ * (the dummy keys) after the real elements even when they compare equal to them.
+ */
+template <typename KeyT, bool Ascending>
+struct row_sort_key {
+  KeyT key;
+  int col;
+
+  friend _RAFT_DEVICE _RAFT_FORCEINLINE auto operator<(const row_sort_key& a, const row_sort_key& b)
+    -> bool
+  {
+    if (a.key == b.key) { return a.col < b.col; }
+    return Ascending ? a.key < b.key : a.key > b.key;
+  }
+  friend _RAFT_DEVICE _RAFT_FORCEINLINE auto operator>(const row_sort_key& a, const row_sort_key& b)
+    -> bool
+  {
+    return b < a;
+  }
+};
+
+/**
+ * Sort the rows of up to `Capacity` columns in registers: one warp per row, or, for the rows of up
+ * to 16 columns, one sub-warp of `Capacity` lanes per row.
+ *
+ * The output rows may alias the input rows (in place): all the reads of a row precede its writes
+ * within the (sub-)warp. Without `WithValues`, only the keys are sorted; otherwise the sort is
+ * stable, and the values are taken from `in_vals` if `InputValues`, or are the column indices.
+ */
+template <int Capacity,
+          bool Ascending,
+          bool WithValues,
+          bool InputValues,
+          typename KeyT,
+          typename ValT,
+          typename IdxT>
+RAFT_KERNEL __launch_bounds__(kSortRowsBlockSize) sort_rows_warp_kernel(const KeyT* in_keys,
+                                                                        IdxT in_keys_ld,
+                                                                        KeyT* out_keys,
+                                                                        IdxT out_keys_ld,
+                                                                        const ValT* in_vals,
+                                                                        IdxT in_vals_ld,
+                                                                        ValT* out_vals,
+                                                                        IdxT out_vals_ld,
+                                                                        IdxT n_rows,
+                                                                        int n_cols)
+{
+  constexpr int kWarpWidth   = Capacity < WarpSize ? Capacity : WarpSize;
+  constexpr int kSize        = Capacity / kWarpWidth;
+  constexpr int kRowsPerWarp = WarpSize / kWarpWidth;
+  const IdxT warp_row =
+    (IdxT(blockIdx.x) * (blockDim.x / WarpSize) + threadIdx.x / WarpSize) * kRowsPerWarp;
+  // the whole warp leaves together: the sort needs all its lanes
+  if (warp_row >= n_rows) { return; }
+  const int lane    = laneId();
+  const int sublane = lane % kWarpWidth;
+  const IdxT row    = warp_row + lane / kWarpWidth;
+  const bool valid  = row < n_rows;
+  const KeyT dummy  = Ascending ? raft::upper_bound<KeyT>() : raft::lower_bound<KeyT>();
+
+  if constexpr (!WithValues) {
+    KeyT keys[kSize];
+#pragma unroll
+    for (int i = 0; i < kSize; i++) {
+      const int col = i * kWarpWidth + sublane;
+      keys[i]       = valid && col < n_cols ? in_keys[row * in_keys_ld + col] : dummy;
+    }
+    util::bitonic<kSize>(Ascending, kWarpWidth).sort(keys);
+    if (!valid) { return; }
+#pragma unroll
+    for (int i = 0; i < kSize; i++) {
+      const int col = i * kWarpWidth + sublane;
+      if (col < n_cols) { out_keys[row * out_keys_ld + col] = keys[i]; }
+    }
+  } else {
+    row_sort_key<KeyT, Ascending> keys[kSize];
+    ValT vals[InputValues ? kSize : 1];
+#pragma unroll
+    for (int i = 0; i < kSize; i++) {
+      const int col = i * kWarpWidth + sublane;
+      const bool in = valid && col < n_cols;
+      keys[i].key   = in ? in_keys[row * in_keys_ld + col] : dummy;
+      keys[i].col   = col;
+      if constexpr (InputValues) { vals[i] = in ? in_vals[row * in_vals_ld + col] : ValT{}; }
+    }
+    // the direction is in the comparison of the keys
+    if constexpr (InputValues) {
+      util::bitonic<kSize>(true, kWarpWidth).sort(keys, vals);
+    } else {
+      util::bitonic<kSize>(true, kWarpWidth).sort(keys);
+    }
+    if (!valid) { return; }
+#pragma unroll
+    for (int i = 0; i < kSize; i++) {
+      const int col = i * kWarpWidth + sublane;
+      if (col >= n_cols) { continue; }
+      if (out_keys != nullptr) { out_keys[row * out_keys_ld + col] = keys[i].key; }
+      if constexpr (InputValues) {
+        out_vals[row * out_vals_ld + col] = vals[i];
+      } else {
+        out_vals[row * out_vals_ld + col] = static_cast<ValT>(keys[i].col);
+      }
+    }
+  }
+}
+
+/**
+ * Sort the rows of up to `kSortRowsWarpMaxCols` columns with `sort_rows_warp_kernel` of the
+ * smallest capacity fitting them (see the kernel for the arguments).
+ */
+template <bool Ascending,
+          bool WithValues,
+          bool InputValues,
+          typename KeyT,
+          typename ValT,
+          typename IdxT>
+void sort_rows_warp(const KeyT* in_keys,
+                    IdxT in_keys_ld,
+                    KeyT* out_keys,
+                    IdxT out_keys_ld,
+                    const ValT* in_vals,
+                    IdxT in_vals_ld,
+                    ValT* out_vals,
+                    IdxT out_vals_ld,
+                    IdxT n_rows,
+                    int n_cols,
+                    cudaStream_t stream)
+{
+  if (n_rows == 0 || n_cols == 0) { return; }
+  auto launch = [&](auto capacity) {
+    constexpr int kCapacity     = decltype(capacity)::value;
+    constexpr int kWarpWidth    = kCapacity < WarpSize ? kCapacity : WarpSize;
+    constexpr int kRowsPerBlock = (kSortRowsBlockSize / WarpSize) * (WarpSize / kWarpWidth);
+    auto n_blocks               = raft::ceildiv<IdxT>(n_rows, kRowsPerBlock);
+    sort_rows_warp_kernel<kCapacity, Ascending, WithValues, InputValues, KeyT, ValT, IdxT>
+      <<<n_blocks, kSortRowsBlockSize, 0, stream>>>(in_keys,
+                                                    in_keys_ld,
+                                                    out_keys,
+                                                    out_keys_ld,
+                                                    in_vals,
+                                                    in_vals_ld,
+                                                    out_vals,
+                                                    out_vals_ld,
+                                                    n_rows,
+                                                    n_cols);
+  };
+  if (n_cols <= 2) {
+    launch(std::integral_constant<int, 2>{});
+  } else if (n_cols <= 4) {
+    launch(std::integral_constant<int, 4>{});
+  } else if (n_cols <= 8) {
+    launch(std::integral_constant<int, 8>{});
+  } else if (n_cols <= 16) {
+    launch(std::integral_constant<int, 16>{});
+  } else if (n_cols <= 32) {
+    launch(std::integral_constant<int, 32>{});
+  } else if (n_cols <= 64) {
+    launch(std::integral_constant<int, 64>{});
+  } else if (n_cols <= 128) {
+    launch(std::integral_constant<int, 128>{});
+  } else if (n_cols <= 256) {
+    launch(std::integral_constant<int, 256>{});
+  } else if (n_cols <= 512) {
+    launch(std::integral_constant<int, 512>{});
+  } else {
+    RAFT_EXPECTS(n_cols <= kSortRowsWarpMaxCols, "sort_rows_warp: too many columns");
+    launch(std::integral_constant<int, 1024>{});
+  }
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/** The offset of a row in a contiguous batch of rows (the segments of the CUB sort). */
+template <typename IdxT>
+struct row_offset_op {
+  IdxT n_cols;
+  __host__ __device__ auto operator()(IdxT row) const -> IdxT { return row * n_cols; }
+};
+
+/**
+ * Sort the (strided) rows in place with the CUB (stable) segmented sort, by batches of rows
+ * staged in contiguous buffers. `vals` may be nullptr to sort the keys only.
+ */
+template <typename KeyT, typename ValT, typename IdxT>
+void sort_rows_segmented(raft::resources const& handle,
+                         KeyT* keys,
+                         IdxT keys_ld,
+                         ValT* vals,
+                         IdxT vals_ld,
+                         IdxT n_rows,
+                         IdxT n_cols,
+                         bool ascending)
+{
+  if (n_rows == 0 || n_cols == 0) { return; }
+  RAFT_EXPECTS(n_cols <= IdxT(std::numeric_limits<int>::max()),
+               "sort_cols_per_row_inplace: too many columns");
+  auto stream = resource::get_cuda_stream(handle);
+  auto mr     = resource::get_workspace_resource(handle);
+  // the CUB sort counts the items with int
+  IdxT batch_rows = std::max<IdxT>(
+    1, std::min<IdxT>(n_rows, IdxT(std::numeric_limits<int>::max()) / n_cols));
+  size_t batch_len = size_t(batch_rows) * n_cols;
+  rmm::device_uvector<KeyT> keys0(batch_len, stream, mr);
+  rmm::device_uvector<KeyT> keys1(batch_len, stream, mr);
+  rmm::device_uvector<ValT> vals0(vals != nullptr ? batch_len : 0, stream, mr);
+  rmm::device_uvector<ValT> vals1(vals != nullptr ? batch_len : 0, stream, mr);
+  auto offsets = thrust::make_transform_iterator(thrust::counting_iterator<int>(0),
+                                                 row_offset_op<int>{int(n_cols)});
+  rmm::device_buffer workspace(0, stream, mr);
+
+  for (IdxT row0 = 0; row0 < n_rows; row0 += batch_rows) {
+    int rows = std::min(batch_rows, n_rows - row0);
+    int len  = rows * int(n_cols);
+    RAFT_CUDA_TRY(cudaMemcpy2DAsync(keys0.data(),
+                                    n_cols * sizeof(KeyT),
+                                    keys + row0 * keys_ld,
+                                    keys_ld * sizeof(KeyT),
+                                    n_cols * sizeof(KeyT),
+                                    rows,
+                                    cudaMemcpyDefault,
+                                    stream));
+    if (vals != nullptr) {
+      RAFT_CUDA_TRY(cudaMemcpy2DAsync(vals0.data(),
+                                      n_cols * sizeof(ValT),
+                                      vals + row0 * vals_ld,
+                                      vals_ld * sizeof(ValT),
+                                      n_cols * sizeof(ValT),
+                                      rows,
+                                      cudaMemcpyDefault,
+                                      stream));
+    }
+    cub::DoubleBuffer<KeyT> d_keys(keys0.data(), keys1.data());
+    cub::DoubleBuffer<ValT> d_vals(vals0.data(), vals1.data());
+    auto sort = [&](void* ws, size_t& ws_size) {
+      using sort_t = cub::DeviceSegmentedSort;
+      if (vals == nullptr) {
+        return ascending ? sort_t::StableSortKeys(
+                             ws, ws_size, d_keys, len, rows, offsets, offsets + 1, stream)
+                         : sort_t::StableSortKeysDescending(
+                             ws, ws_size, d_keys, len, rows, offsets, offsets + 1, stream);
+      }
+      return ascending ? sort_t::StableSortPairs(
+                           ws, ws_size, d_keys, d_vals, len, rows, offsets, offsets + 1, stream)
+                       : sort_t::StableSortPairsDescending(
+                           ws, ws_size, d_keys, d_vals, len, rows, offsets, offsets + 1, stream);
+    };
+    size_t ws_size = 0;
+    RAFT_CUDA_TRY(sort(nullptr, ws_size));
+    if (ws_size > workspace.size()) { workspace.resize(ws_size, stream); }
+    RAFT_CUDA_TRY(sort(workspace.data(), ws_size));
+    RAFT_CUDA_TRY(cudaMemcpy2DAsync(keys + row0 * keys_ld,
+                                    keys_ld * sizeof(KeyT),
+                                    d_keys.Current(),
+                                    n_cols * sizeof(KeyT),
+                                    n_cols * sizeof(KeyT),
+                                    rows,
+                                    cudaMemcpyDefault,
+                                    stream));
+    if (vals != nullptr) {
+      RAFT_CUDA_TRY(cudaMemcpy2DAsync(vals + row0 * vals_ld,
+                                      vals_ld * sizeof(ValT),
+                                      d_vals.Current(),
+                                      n_cols * sizeof(ValT),
+                                      n_cols * sizeof(ValT),
+                                      rows,
+                                      cudaMemcpyDefault,
+                                      stream));
+    }
+  }
+}
+
+/**
+ * Sort the (strided) rows [n_rows, n_cols] of keys in place, and the values with them if `vals`
+ * is not nullptr: in registers for the rows of up to `kSortRowsWarpMaxCols` columns, by the CUB
+ * segmented sort otherwise. The sort of the values is stable.
+ */
+template <typename KeyT, typename ValT, typename IdxT>
+void sort_rows_inplace(raft::resources const& handle,
+                       KeyT* keys,
+                       IdxT keys_ld,
+                       ValT* vals,
+                       IdxT vals_ld,
+                       IdxT n_rows,
+                       IdxT n_cols,
+                       bool ascending)
+{
+  if (n_cols > kSortRowsWarpMaxCols) {
+    return sort_rows_segmented(handle, keys, keys_ld, vals, vals_ld, n_rows, n_cols, ascending);
+  }
+  auto stream = resource::get_cuda_stream(handle);
+  int cols    = n_cols;
+  if (vals == nullptr) {
+    auto f = ascending ? sort_rows_warp<true, false, false, KeyT, ValT, IdxT>
+                       : sort_rows_warp<false, false, false, KeyT, ValT, IdxT>;
+    f(keys, keys_ld, keys, keys_ld, nullptr, 0, nullptr, 0, n_rows, cols, stream);
+  } else {
+    auto f = ascending ? sort_rows_warp<true, true, true, KeyT, ValT, IdxT>
+                       : sort_rows_warp<false, true, true, KeyT, ValT, IdxT>;
+    f(keys, keys_ld, keys, keys_ld, vals, vals_ld, vals, vals_ld, n_rows, cols, stream);
+  }
+}
+
 /**
  * @brief sort columns within each row of row-major input matrix and return sorted indexes
  * modelled as key-value sort with key being input matrix and value being index of values
@@ -187,6 +511,23 @@ void sortColumnsPerRow(const InType* in,
   // per row
   //          i.e. another output format: sorted values only
 
+  if (n_columns <= kSortRowsWarpMaxCols) {
+    // the short rows are sorted in registers, without a workspace
+    bAllocWorkspace = false;
+    sort_rows_warp<true, true, false, InType, OutType, int>(in,
+                                                            n_columns,
+                                                            sortedKeys,
+                                                            n_columns,
+                                                            nullptr,
+                                                            0,
+                                                            out,
+                                                            n_columns,
+                                                            n_rows,
+                                                            n_columns,
+                                                            stream);
+    return;
+  }
+
   int totalElements          = n_rows * n_columns;
   size_t perElementSmemUsage = sizeof(InType) + sizeof(OutType);
   size_t memAlignWidth       = 256;
@@ -210,12 +551,8 @@ void sortColumnsPerRow(const InType* in,
     // more elements per thread --> more register pressure
     // 512(blockSize) * 8 elements per thread = 71 register / thread
 
-    // instantiate some kernel combinations
-    if (n_columns <= 512)
-      INST_BLOCK_SORT(in, sortedKeys, out, n_rows, n_columns, 128, 4, stream);
-    else if (n_columns > 512 && n_columns <= 1024)
-      INST_BLOCK_SORT(in, sortedKeys, out, n_rows, n_columns, 128, 8, stream);
-    else if (n_columns > 1024 && n_columns <= 3072)
+    // instantiate some kernel combinations (the rows of up to 1024 columns are sorted above)
+    if (n_columns <= 3072)
       INST_BLOCK_SORT(in, sortedKeys, out, n_rows, n_columns, 512, 6, stream);
     else if (n_columns > 3072 && n_columns <= 4096)
       INST_BLOCK_SORT(in, sortedKeys, out, n_rows, n_columns, 512, 8, stream);
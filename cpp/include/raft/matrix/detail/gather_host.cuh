@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/nvtx.hpp>
+#include <raft/core/pinned_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/detail/staging_event.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace raft::matrix::detail {
+
+/** The size of each of the two pinned staging buffers of the rows gathered on the host. */
+constexpr size_t kGatherHostStagingBytes = size_t(32) << 20;
+
+/**
+ * Copy the rows `transform_op(map[i])` of the row-major host matrix `in` [*, D] to the rows i of
+ * the row-major device matrix `out` [map_length, D]; the map is in the host memory.
+ *
+ * The rows are gathered by blocks of `batch_rows` (by default, as many as fill
+ * `kGatherHostStagingBytes`) into one of two pinned buffers by the OpenMP threads, while the
+ * previous block is uploaded from the other one. The input may be pageable or pinned memory.
+ * The function returns when the last block is on the device.
+ */
+template <typename T, typename MapT, typename IdxT, typename MapTransformOp>
+void gather_from_host(raft::resources const& res,
+                      const T* in,
+                      IdxT D,
+                      const MapT* map,
+                      IdxT map_length,
+                      T* out,
+                      MapTransformOp transform_op,
+                      IdxT batch_rows = 0)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "raft::matrix::gather_from_host(%ld, %ld)", int64_t(map_length), int64_t(D));
+  if (map_length == 0) { return; }
+  auto stream = resource::get_cuda_stream(res);
+  if (batch_rows <= 0) {
+    batch_rows = IdxT(kGatherHostStagingBytes / (sizeof(T) * std::max<IdxT>(D, 1)));
+  }
+  batch_rows   = std::max<IdxT>(1, std::min(batch_rows, map_length));
+  auto staging = raft::make_pinned_matrix<T, IdxT>(res, 2 * batch_rows, D);
+  std::array<raft::detail::staging_event, 2> copied;
+  int b = 0;
+  for (IdxT row0 = 0; row0 < map_length; row0 += batch_rows, b ^= 1) {
+    IdxT rows = std::min(batch_rows, map_length - row0);
+    T* buf    = staging.data_handle() + size_t(b) * batch_rows * D;
+    // this buffer was uploaded two blocks ago
+    if (row0 >= 2 * batch_rows) { copied[b].sync(); }
+#pragma omp parallel for
+    for (int64_t i = 0; i < int64_t(rows); i++) {
+      IdxT src = transform_op(map[row0 + i]);
+      std::memcpy(buf + size_t(i) * D, in + size_t(src) * D, sizeof(T) * D);
+    }
+    raft::copy(out + size_t(row0) * D, buf, size_t(rows) * D, stream);
+    copied[b].record(stream);
+  }
+  // the staging buffers go with the scope
+  resource::sync_stream(res, stream);
+}
+
+}  // namespace raft::matrix::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -489,6 +489,74 @@ RAFT_KERNEL __launch_bounds__(MaxOffset, 2) matrixLinewiseVecRowsTailKernel(Type
   }
 }
 
+/**
+ * The linewise operation on strided matrices: the lines are `ld` elements apart (ld >= rowLen)
+ * and the elements between the lines are neither read nor written.
+ *
+ * Every line is split into `rowLen / VecElems` chunks of `VecElems` elements, loaded and stored
+ * with vectorized instructions, and the remaining elements, processed one by one. The threads
+ * work on the (line, chunk) pairs, grid-striped. The lines of `in` and `out` are expected to be
+ * aligned to `VecBytes` (the host side checks the pointers and the strides).
+ *
+ * @param [out] out the output matrix
+ * @param [in] in the input matrix
+ * @param [in] outLd the distance between the lines of `out` (in elements)
+ * @param [in] inLd the distance between the lines of `in` (in elements)
+ * @param [in] rowLen number of elements in a line
+ * @param [in] nRows number of lines
+ * @param [in] op the function to apply
+ * @param [in] vecs pointers to the argument vectors
+ */
+template <typename Type,
+          typename IdxType,
+          std::size_t VecBytes,
+          int BlockSize,
+          bool AlongLines,
+          typename Lambda,
+          typename... Vecs>
+RAFT_KERNEL __launch_bounds__(BlockSize) matrixLinewiseVecStridedKernel(Type* out,
+                                                                        const Type* in,
+                                                                        const IdxType outLd,
+                                                                        const IdxType inLd,
+                                                                        const IdxType rowLen,
+                                                                        const IdxType nRows,
+                                                                        Lambda op,
+                                                                        const Vecs*... vecs)
+{
+  typedef Linewise<Type, IdxType, VecBytes, BlockSize> L;
+  const IdxType nVecs   = rowLen / L::VecElems;
+  const IdxType nChunks = nVecs + (rowLen - nVecs * L::VecElems);
+  const IdxType total   = nChunks * nRows;
+  const IdxType d       = IdxType(BlockSize) * gridDim.x;
+  for (IdxType t = threadIdx.x + IdxType(blockIdx.x) * BlockSize; t < total; t += d) {
+    const IdxType row  = t / nChunks;
+    const IdxType c    = t % nChunks;
+    const Type* in_row = in + row * inLd;
+    Type* out_row      = out + row * outLd;
+    if (c < nVecs) {
+      const IdxType i = c * L::VecElems;
+      typename L::Vec v;
+      *v.vectorized_data() = __ldcv(reinterpret_cast<const typename L::Vec::io_t*>(in_row + i));
+#pragma unroll L::VecElems
+      for (int k = 0; k < L::VecElems; k++) {
+        if constexpr (AlongLines) {
+          v.val.data[k] = op(v.val.data[k], vecs[i + k]...);
+        } else {
+          v.val.data[k] = op(v.val.data[k], vecs[row]...);
+        }
+      }
+      __stwt(reinterpret_cast<typename L::Vec::io_t*>(out_row + i), *v.vectorized_data());
+    } else {
+      const IdxType i = nVecs * L::VecElems + (c - nVecs);
+      if constexpr (AlongLines) {
+        out_row[i] = op(in_row[i], vecs[i]...);
+      } else {
+        out_row[i] = op(in_row[i], vecs[row]...);
+      }
+    }
+  }
+}
+
 /** Fully occupy GPU this many times for better work balancing. */
 static inline constexpr uint OptimalSmOccupancy = 16;
 
@@ -737,6 +805,47 @@ void matrixLinewiseVecRowsSpan(
   }
 }
 
+/**
+ *  input/output data are strided: `nRows` lines of `rowLen` elements, `inLd` / `outLd` apart;
+ *  the elements in between are left untouched.
+ */
+template <typename Type,
+          typename IdxType,
+          std::size_t VecBytes,
+          int BlockSize,
+          typename Lambda,
+          typename... Vecs>
+void matrixLinewiseVecStrided(Type* out,
+                              const Type* in,
+                              const IdxType outLd,
+                              const IdxType inLd,
+                              const IdxType rowLen,
+                              const IdxType nRows,
+                              const bool alongLines,
+                              Lambda op,
+                              cudaStream_t stream,
+                              const Vecs*... vecs)
+{
+  constexpr std::size_t VecElems = VecBytes / sizeof(Type);
+  const IdxType nVecs            = rowLen / IdxType(VecElems);
+  const IdxType total            = (nVecs + (rowLen - nVecs * IdxType(VecElems))) * nRows;
+  if (total == 0) { return; }
+  constexpr dim3 bs(BlockSize, 1, 1);
+  // Minimum size of the grid to make the device well occupied
+  const uint occupy = getOptimalGridSize<BlockSize>();
+  // does not make sense to have more blocks than this
+  const IdxType maxBlocks = raft::ceildiv<IdxType>(total, IdxType(BlockSize));
+  const dim3 gs(uint(std::min<IdxType>(maxBlocks, IdxType(occupy))), 1, 1);
+  if (alongLines) {
+    matrixLinewiseVecStridedKernel<Type, IdxType, VecBytes, BlockSize, true, Lambda, Vecs...>
+      <<<gs, bs, 0, stream>>>(out, in, outLd, inLd, rowLen, nRows, op, vecs...);
+  } else {
+    matrixLinewiseVecStridedKernel<Type, IdxType, VecBytes, BlockSize, false, Lambda, Vecs...>
+      <<<gs, bs, 0, stream>>>(out, in, outLd, inLd, rowLen, nRows, op, vecs...);
+  }
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
 /**
  * Select one of the implementations:
  *   a. vectors applied along/across lines
@@ -812,6 +921,35 @@ struct MatrixLinewiseOp {
                                        Lambda,
                                        Vecs...>(out, in, lineLen, nLines, op, stream, vecs...);
   }
+
+  /**
+   * Strided matrices: the lines of `in` and `out` are `inLd` and `outLd` elements apart. The
+   * vectorized loads and stores are used when the pointers and the strides are aligned to
+   * `VecBytes`; otherwise, smaller `VecBytes` are tried.
+   */
+  template <typename Type, typename IdxType, typename Lambda, typename... Vecs>
+  static void runStrided(Type* out,
+                         const Type* in,
+                         const IdxType outLd,
+                         const IdxType inLd,
+                         const IdxType lineLen,
+                         const IdxType nLines,
+                         const bool alongLines,
+                         Lambda op,
+                         cudaStream_t stream,
+                         const Vecs*... vecs)
+  {
+    if constexpr (VecBytes > sizeof(Type)) {
+      typedef raft::Pow2<VecBytes> AlignBytes;
+      if (!AlignBytes::isAligned(in) || !AlignBytes::isAligned(out) ||
+          !AlignBytes::isAligned(size_t(inLd) * sizeof(Type)) ||
+          !AlignBytes::isAligned(size_t(outLd) * sizeof(Type)))
+        return MatrixLinewiseOp<std::max((VecBytes >> 1), sizeof(Type)), BlockSize>::runStrided(
+          out, in, outLd, inLd, lineLen, nLines, alongLines, op, stream, vecs...);
+    }
+    return matrixLinewiseVecStrided<Type, IdxType, VecBytes, BlockSize, Lambda, Vecs...>(
+      out, in, outLd, inLd, lineLen, nLines, alongLines, op, stream, vecs...);
+  }
 };
 
 }  // end namespace detail
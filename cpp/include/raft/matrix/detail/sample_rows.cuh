@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/matrix/detail/gather.cuh>
+#include <raft/matrix/detail/gather_host.cuh>
+#include <raft/random/detail/sample_indices.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <vector>
+
+namespace raft::matrix::detail {
+
+/**
+ * Copy n_samples distinct rows of the row-major dataset [n_rows, n_cols], drawn uniformly at
+ * random, to the device buffer `out` [n_samples, n_cols], in increasing order of their indices.
+ * The dataset may be in the host or in the device memory; the host rows are gathered by blocks
+ * in pinned buffers (`gather_from_host`).
+ */
+template <typename T, typename IdxT>
+void sample_rows(raft::resources const& res,
+                 raft::random::RngState& rng,
+                 const T* dataset,
+                 IdxT n_rows,
+                 IdxT n_cols,
+                 T* out,
+                 IdxT n_samples)
+{
+  auto stream = resource::get_cuda_stream(res);
+  rmm::device_uvector<IdxT> indices(n_samples, stream);
+  raft::random::detail::sample_indices_without_replacement(
+    res, rng, indices.data(), n_samples, n_rows);
+
+  cudaPointerAttributes attr;
+  RAFT_CUDA_TRY(cudaPointerGetAttributes(&attr, dataset));
+  if (attr.devicePointer != nullptr) {
+    gather(reinterpret_cast<const T*>(attr.devicePointer),
+           n_cols,
+           n_rows,
+           indices.data(),
+           n_samples,
+           out,
+           stream);
+    return;
+  }
+
+  std::vector<IdxT> h_indices(n_samples);
+  raft::update_host(h_indices.data(), indices.data(), n_samples, stream);
+  resource::sync_stream(res, stream);
+  gather_from_host(res, dataset, n_cols, h_indices.data(), n_samples, out, raft::identity_op{});
+}
+
+}  // namespace raft::matrix::detail
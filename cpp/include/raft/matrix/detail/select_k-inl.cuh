@@ -23,7 +23,9 @@
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/nvtx.hpp>
+#include <raft/core/resource/metrics.hpp>
 #include <raft/matrix/init.cuh>
+#include <raft/matrix/select_k_tuning.hpp>
 #include <raft/matrix/select_k_types.hpp>
 
 #include <raft/core/resource/thrust_policy.hpp>
@@ -31,6 +33,8 @@
 #include <rmm/mr/device/device_memory_resource.hpp>
 #include <thrust/scan.h>
 
+#include <sstream>
+
 namespace raft::matrix::detail {
 
 /**
@@ -242,10 +246,21 @@ void select_k(raft::resources const& handle,
 {
   common::nvtx::range<common::nvtx::domain::raft> fun_scope(
     "matrix::select_k(batch_size = %zu, len = %zu, k = %d)", batch_size, len, k);
+  resource::scoped_call call(handle, "matrix::select_k");
+  call.set_batch_size(batch_size);
 
   if (mr == nullptr) { mr = rmm::mr::get_current_device_resource(); }
 
-  if (algo == SelectAlgo::kAuto) { algo = choose_select_k_algorithm(batch_size, len, k); }
+  if (algo == SelectAlgo::kAuto) {
+    // a table tuned for this device (see raft::matrix::load_select_k_tuning) takes precedence
+    algo = lookup_select_k_tuning(batch_size, len, k)
+             .value_or(choose_select_k_algorithm(batch_size, len, k));
+  }
+  if (call.enabled()) {
+    std::ostringstream algo_name;
+    algo_name << algo;
+    call.set_algo(algo_name.str().c_str());
+  }
 
   auto stream = raft::resource::get_cuda_stream(handle);
   switch (algo) {
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/unary_op.cuh>
+#include <raft/matrix/select_k.cuh>
+#include <raft/neighbors/detail/knn_merge_parts.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <optional>
+
+namespace raft::matrix::detail {
+
+template <typename T, typename IdxT>
+void select_k_distributed(
+  raft::resources const& handle,
+  raft::device_matrix_view<const T, int64_t, row_major> in_val,
+  std::optional<raft::device_matrix_view<const IdxT, int64_t, row_major>> in_idx,
+  IdxT idx_offset,
+  raft::device_matrix_view<T, int64_t, row_major> out_val,
+  raft::device_matrix_view<IdxT, int64_t, row_major> out_idx,
+  bool select_min)
+{
+  const auto& comms   = resource::get_comms(handle);
+  auto stream         = resource::get_cuda_stream(handle);
+  const int n_ranks   = comms.get_size();
+  const int64_t batch = in_val.extent(0);
+  const int k         = out_val.extent(1);
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "matrix::select_k_distributed(batch_size = %zu, k = %d, n_ranks = %d)",
+    static_cast<size_t>(batch),
+    k,
+    n_ranks);
+
+  // The local top-k of every rank, in the order expected by knn_merge_parts:
+  // [n_ranks, batch, k], the part of this rank at its rank position after the allgather.
+  const size_t part_size = static_cast<size_t>(batch) * k;
+  auto local_val         = raft::make_device_vector<T, int64_t>(handle, part_size);
+  auto local_idx         = raft::make_device_vector<IdxT, int64_t>(handle, part_size);
+  raft::matrix::select_k<T, IdxT>(
+    handle,
+    in_val,
+    in_idx,
+    raft::make_device_matrix_view<T, int64_t>(local_val.data_handle(), batch, k),
+    raft::make_device_matrix_view<IdxT, int64_t>(local_idx.data_handle(), batch, k),
+    select_min);
+
+  auto all_val      = raft::make_device_vector<T, int64_t>(handle, part_size * n_ranks);
+  auto all_idx      = raft::make_device_vector<IdxT, int64_t>(handle, part_size * n_ranks);
+  auto local_offset = raft::make_device_scalar<IdxT>(handle, idx_offset);
+  auto translations = raft::make_device_vector<IdxT, int64_t>(handle, n_ranks);
+  comms.allgather(local_val.data_handle(), all_val.data_handle(), part_size, stream);
+  comms.allgather(local_idx.data_handle(), all_idx.data_handle(), part_size, stream);
+  comms.allgather(local_offset.data_handle(), translations.data_handle(), 1, stream);
+
+  // knn_merge_parts keeps the smallest keys
+  if (!select_min) {
+    raft::linalg::unaryOp(all_val.data_handle(),
+                          all_val.data_handle(),
+                          all_val.size(),
+                          raft::mul_const_op<T>(-1),
+                          stream);
+  }
+  raft::neighbors::detail::knn_merge_parts(handle,
+                                           all_val.data_handle(),
+                                           all_idx.data_handle(),
+                                           out_val.data_handle(),
+                                           out_idx.data_handle(),
+                                           batch,
+                                           n_ranks,
+                                           k,
+                                           translations.data_handle());
+  if (!select_min) {
+    raft::linalg::unaryOp(out_val.data_handle(),
+                          out_val.data_handle(),
+                          part_size,
+                          raft::mul_const_op<T>(-1),
+                          stream);
+  }
+}
+
+}  // namespace raft::matrix::detail
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "select_radix.cuh"
+#include "select_warpsort.cuh"
+
+#include <raft/core/detail/macros.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/util/cuda_rt_essentials.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <rmm/cuda_stream_view.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace raft::matrix::detail::select::segmented {
+
+/**
+ * The segments of at most `kWarpsortLenFactor * kBlockSize` elements go through the block-wide
+ * warpsort queue, the longer ones through the one-block radix select.
+ */
+constexpr int kBlockSize   = 256;
+constexpr int kBitsPerPass = 11;
+constexpr int kWarpsortLenFactor =
+  warpsort::LaunchThreshold<warpsort::warp_sort_filtered>::len_factor_for_single_block;
+
+/** Sort the first `n` pairs of `out` / `out_idx` in place (n <= Capacity). */
+template <int Capacity, bool Ascending, typename T, typename IdxT>
+_RAFT_DEVICE void sort_in_place(T* out, IdxT* out_idx, IdxT n, uint8_t* smem_buf)
+{
+  using bq_t = warpsort::block_sort<warpsort::warp_sort_filtered, Capacity, Ascending, T, IdxT>;
+  uint8_t* warp_smem = bq_t::queue_t::mem_required(blockDim.x) > 0 ? smem_buf : nullptr;
+  bq_t queue(n, warp_smem);
+
+  const IdxT per_thread_lim = n + laneId();
+  for (IdxT i = threadIdx.x; i < per_thread_lim; i += blockDim.x) {
+    queue.add(i < n ? out[i] : bq_t::queue_t::kDummy, i < n ? out_idx[i] : i);
+  }
+  // NB: `done` syncs the block, so all the reads of `out` are complete before the store.
+  queue.done(smem_buf);
+  queue.store(out, out_idx);
+}
+
+/**
+ * The one-block radix select over a segment, without the intermediate candidate buffers: every
+ * pass filters the whole segment by the bits of the k-th value found so far.
+ */
+template <typename T, typename IdxT, bool Ascending>
+_RAFT_DEVICE void radix_select_segment(
+  const T* in, const IdxT* in_idx, IdxT len, IdxT k, T* out, IdxT* out_idx)
+{
+  constexpr int num_buckets = radix::impl::calc_num_buckets<kBitsPerPass>();
+  constexpr int num_passes  = radix::impl::calc_num_passes<T, kBitsPerPass>();
+  __shared__ radix::impl::Counter<T, IdxT> counter;
+  __shared__ IdxT histogram[num_buckets];
+
+  if (threadIdx.x == 0) {
+    counter.k              = k;
+    counter.len            = len;
+    counter.previous_len   = len;
+    counter.kth_value_bits = 0;
+    counter.out_cnt        = 0;
+    counter.out_back_cnt   = 0;
+  }
+  __syncthreads();
+
+  for (int pass = 0; pass < num_passes; ++pass) {
+    const IdxT current_len = counter.len;
+    const IdxT current_k   = counter.k;
+
+    radix::impl::filter_and_histogram_for_one_block<T, IdxT, kBitsPerPass>(in,
+                                                                           in_idx,
+                                                                           nullptr,
+                                                                           nullptr,
+                                                                           out,
+                                                                           out_idx,
+                                                                           len,
+                                                                           &counter,
+                                                                           histogram,
+                                                                           Ascending,
+                                                                           pass);
+    __syncthreads();
+
+    radix::impl::scan<IdxT, kBitsPerPass, kBlockSize>(histogram);
+    __syncthreads();
+
+    radix::impl::choose_bucket<T, IdxT, kBitsPerPass>(&counter, histogram, current_k, pass);
+    if (threadIdx.x == 0) { counter.previous_len = current_len; }
+    __syncthreads();
+
+    if (counter.len == counter.k || pass == num_passes - 1) {
+      radix::impl::last_filter<T, IdxT, kBitsPerPass>(
+        in, in_idx, out, out_idx, len, k, &counter, Ascending, pass);
+      break;
+    }
+  }
+}
+
+/**
+ * One thread block per segment: short segments go through the block-wide warpsort queue, long
+ * segments through the one-block radix select, and segments not longer than k are copied as is.
+ */
+template <int Capacity, bool Ascending, typename T, typename IdxT>
+__launch_bounds__(kBlockSize) RAFT_KERNEL select_k_segmented_kernel(const T* in,
+                                                                    const IdxT* in_idx,
+                                                                    const int64_t* offsets,
+                                                                    IdxT k,
+                                                                    IdxT max_warpsort_len,
+                                                                    bool sorted,
+                                                                    T* out,
+                                                                    IdxT* out_idx)
+{
+  extern __shared__ __align__(256) uint8_t smem_buf_bytes[];
+  using queue_t = warpsort::warp_sort_filtered<Capacity, Ascending, T, IdxT>;
+
+  const size_t segment_id = blockIdx.x;  // size_t to avoid multiplication overflow
+  const int64_t begin     = offsets[segment_id];
+  const IdxT len          = static_cast<IdxT>(offsets[segment_id + 1] - begin);
+  in += begin;
+  if (in_idx != nullptr) { in_idx += begin; }
+  out += segment_id * k;
+  out_idx += segment_id * k;
+
+  if (len <= k) {
+    for (IdxT i = threadIdx.x; i < k; i += blockDim.x) {
+      out[i]     = i < len ? in[i] : queue_t::kDummy;
+      out_idx[i] = i < len ? (in_idx != nullptr ? in_idx[i] : i) : static_cast<IdxT>(-1);
+    }
+    if (sorted && len > 1 && k <= Capacity) {
+      __syncthreads();
+      sort_in_place<Capacity, Ascending, T, IdxT>(out, out_idx, len, smem_buf_bytes);
+    }
+    return;
+  }
+
+  if (len <= max_warpsort_len) {
+    using bq_t = warpsort::block_sort<warpsort::warp_sort_filtered, Capacity, Ascending, T, IdxT>;
+    uint8_t* warp_smem = queue_t::mem_required(blockDim.x) > 0 ? smem_buf_bytes : nullptr;
+    bq_t queue(k, warp_smem);
+
+    const IdxT per_thread_lim = len + laneId();
+    for (IdxT i = threadIdx.x; i < per_thread_lim; i += blockDim.x) {
+      queue.add(i < len ? __ldcs(in + i) : queue_t::kDummy,
+                (i < len && in_idx != nullptr) ? __ldcs(in_idx + i) : i);
+    }
+    queue.done(smem_buf_bytes);
+    queue.store(out, out_idx);
+    return;
+  }
+
+  radix_select_segment<T, IdxT, Ascending>(in, in_idx, len, k, out, out_idx);
+  if (sorted && k <= Capacity) {
+    __syncthreads();
+    sort_in_place<Capacity, Ascending, T, IdxT>(out, out_idx, k, smem_buf_bytes);
+  }
+}
+
+template <typename T, typename IdxT, int Capacity = warpsort::kMaxCapacity>
+struct launch_setup {
+  static void kernel(const T* in,
+                     const IdxT* in_idx,
+                     const int64_t* offsets,
+                     size_t n_segments,
+                     int k,
+                     bool select_min,
+                     bool sorted,
+                     T* out,
+                     IdxT* out_idx,
+                     rmm::cuda_stream_view stream)
+  {
+    const int capacity = bound_by_power_of_two(k);
+    if constexpr (Capacity > 1) {
+      if (capacity < Capacity) {
+        return launch_setup<T, IdxT, Capacity / 2>::kernel(
+          in, in_idx, offsets, n_segments, k, select_min, sorted, out, out_idx, stream);
+      }
+    }
+    // k above the largest warpsort capacity: all the segments use the radix select
+    const bool use_warpsort     = k <= Capacity;
+    const IdxT max_warpsort_len = use_warpsort ? IdxT(kWarpsortLenFactor * kBlockSize) : IdxT(0);
+
+    const int num_of_warp = kBlockSize / std::min<int>(WarpSize, Capacity);
+    int smem_size =
+      warpsort::calc_smem_size_for_block_wide<T, IdxT>(num_of_warp, std::min(k, Capacity));
+    smem_size = std::max<int>(
+      smem_size, warpsort::warp_sort_filtered<1, true, T, IdxT>::mem_required(kBlockSize));
+
+    constexpr size_t kMaxGridDimX = std::numeric_limits<int32_t>::max();
+    for (size_t offset = 0; offset < n_segments; offset += kMaxGridDimX) {
+      const auto n_blocks = static_cast<unsigned>(std::min(kMaxGridDimX, n_segments - offset));
+      if (select_min) {
+        select_k_segmented_kernel<Capacity, true, T, IdxT>
+          <<<n_blocks, kBlockSize, smem_size, stream>>>(in,
+                                                        in_idx,
+                                                        offsets + offset,
+                                                        IdxT(k),
+                                                        max_warpsort_len,
+                                                        sorted,
+                                                        out + offset * k,
+                                                        out_idx + offset * k);
+      } else {
+        select_k_segmented_kernel<Capacity, false, T, IdxT>
+          <<<n_blocks, kBlockSize, smem_size, stream>>>(in,
+                                                        in_idx,
+                                                        offsets + offset,
+                                                        IdxT(k),
+                                                        max_warpsort_len,
+                                                        sorted,
+                                                        out + offset * k,
+                                                        out_idx + offset * k);
+      }
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    }
+  }
+};
+
+/**
+ * Select k smallest or largest key/values from each segment of the input data.
+ *
+ * The segment `i` spans the elements `[offsets[i], offsets[i + 1])` of `in` and `in_idx`, so the
+ * segments may have any length, including zero. Every segment is processed by one thread block
+ * in a single kernel launch; the segment length decides whether the block uses the warpsort queue
+ * or the radix select.
+ *
+ * The segments shorter than `k` are padded with the worst key (`upper_bound<T>()` when
+ * `select_min`, `lower_bound<T>()` otherwise) and the index `IdxT(-1)`.
+ *
+ * @param[in] in contiguous device array of the segmented inputs.
+ * @param[in] in_idx optional payload of the inputs (`nullptr` means the position in the segment).
+ * @param[in] offsets device array of the segment offsets [n_segments + 1].
+ * @param n_segments the number of segments.
+ * @param k the number of outputs to select in each segment.
+ * @param[out] out device array of the selected keys [n_segments, k].
+ * @param[out] out_idx device array of the selected payload [n_segments, k].
+ * @param select_min whether to select k smallest (true) or largest (false) keys.
+ * @param sorted whether to sort the k selected pairs of every segment.
+ * @param stream
+ */
+template <typename T, typename IdxT>
+void select_k(const T* in,
+              const IdxT* in_idx,
+              const int64_t* offsets,
+              size_t n_segments,
+              int k,
+              T* out,
+              IdxT* out_idx,
+              bool select_min,
+              bool sorted,
+              rmm::cuda_stream_view stream)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "matrix::select_k_segmented(n_segments = %zu, k = %d)", n_segments, k);
+  RAFT_EXPECTS(!sorted || k <= warpsort::kMaxCapacity,
+               "Sorted segmented selection supports k up to %d (requested %d)",
+               warpsort::kMaxCapacity,
+               k);
+  if (n_segments == 0 || k == 0) { return; }
+  launch_setup<T, IdxT>::kernel(
+    in, in_idx, offsets, n_segments, k, select_min, sorted, out, out_idx, stream);
+}
+
+}  // namespace raft::matrix::detail::select::segmented
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,12 +17,17 @@
 #pragma once
 
 #include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/matrix/detail/gather.cuh>
+#include <raft/matrix/detail/gather_host.cuh>
 #include <raft/matrix/detail/gather_inplace.cuh>
+#include <raft/util/cudart_utils.hpp>
 #include <raft/util/itertools.hpp>
 
+#include <vector>
+
 namespace raft::matrix {
 
 /**
@@ -234,6 +239,93 @@ void gather(const raft::resources& handle,
     resource::get_cuda_stream(handle));
 }
 
+/**
+ * @brief Copies rows from a source matrix in the host memory into a destination matrix in the
+ * device memory according to a transformed map.
+ *
+ * The rows are gathered by the CPU threads (OpenMP) into pinned staging buffers, by blocks, and
+ * every block is uploaded while the next one is gathered. The input may be in pageable or in
+ * pinned memory. The call returns when all the rows are on the device.
+ *
+ * @code{.cpp}
+ *   // copy a random subset of the rows of a host dataset to the device
+ *   auto trainset = raft::make_device_matrix<float, int64_t>(res, n_samples, dim);
+ *   raft::matrix::gather(res, dataset_host_view, indices_host_view, trainset.view());
+ * @endcode
+ *
+ * @tparam matrix_t    Matrix element type
+ * @tparam map_t       Integer type of map elements
+ * @tparam idx_t       Integer type used for indexing
+ * @tparam map_xform_t Unary lambda expression or operator type. MapTransformOp's result type must
+ *                     be convertible to idx_t.
+ * @param[in]  handle        raft handle for managing resources
+ * @param[in]  in            Input matrix in the host memory, dim = [N, D] (row-major)
+ * @param[in]  map           Map of row indices to gather in the host memory, dim = [map_length]
+ * @param[out] out           Output matrix, dim = [map_length, D] (row-major)
+ * @param[in]  transform_op  (optional) Transformation to apply to map values
+ */
+template <typename matrix_t,
+          typename map_t,
+          typename idx_t,
+          typename map_xform_t = raft::identity_op>
+void gather(const raft::resources& handle,
+            raft::host_matrix_view<const matrix_t, idx_t, row_major> in,
+            raft::host_vector_view<const map_t, idx_t> map,
+            raft::device_matrix_view<matrix_t, idx_t, row_major> out,
+            map_xform_t transform_op = raft::identity_op())
+{
+  RAFT_EXPECTS(out.extent(0) == map.extent(0),
+               "Number of rows in output matrix must equal the size of the map vector");
+  RAFT_EXPECTS(out.extent(1) == in.extent(1),
+               "Number of columns in input and output matrices must be equal.");
+
+  detail::gather_from_host(handle,
+                           in.data_handle(),
+                           in.extent(1),
+                           map.data_handle(),
+                           map.extent(0),
+                           out.data_handle(),
+                           transform_op);
+}
+
+/**
+ * @brief Copies rows from a source matrix in the host memory into a destination matrix in the
+ * device memory according to a transformed map in the device memory.
+ *
+ * Same as the overload with the map in the host memory; the map is copied to the host first.
+ *
+ * @tparam matrix_t    Matrix element type
+ * @tparam map_t       Integer type of map elements
+ * @tparam idx_t       Integer type used for indexing
+ * @tparam map_xform_t Unary lambda expression or operator type. MapTransformOp's result type must
+ *                     be convertible to idx_t.
+ * @param[in]  handle        raft handle for managing resources
+ * @param[in]  in            Input matrix in the host memory, dim = [N, D] (row-major)
+ * @param[in]  map           Map of row indices to gather, dim = [map_length]
+ * @param[out] out           Output matrix, dim = [map_length, D] (row-major)
+ * @param[in]  transform_op  (optional) Transformation to apply to map values
+ */
+template <typename matrix_t,
+          typename map_t,
+          typename idx_t,
+          typename map_xform_t = raft::identity_op>
+void gather(const raft::resources& handle,
+            raft::host_matrix_view<const matrix_t, idx_t, row_major> in,
+            raft::device_vector_view<const map_t, idx_t> map,
+            raft::device_matrix_view<matrix_t, idx_t, row_major> out,
+            map_xform_t transform_op = raft::identity_op())
+{
+  auto stream = resource::get_cuda_stream(handle);
+  std::vector<map_t> h_map(map.extent(0));
+  raft::update_host(h_map.data(), map.data_handle(), map.extent(0), stream);
+  resource::sync_stream(handle, stream);
+  gather(handle,
+         in,
+         raft::make_host_vector_view<const map_t, idx_t>(h_map.data(), map.extent(0)),
+         out,
+         transform_op);
+}
+
 /**
  * @brief Conditionally copies rows according to a transformed map.
  *
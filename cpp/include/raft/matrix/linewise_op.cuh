@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -127,6 +127,65 @@ void linewise_op(raft::resources const& handle,
                                                            vecs.data_handle()...);
 }
 
+/**
+ * Run a function over the lines of strided matrices (e.g. the padded views made by
+ * `make_device_strided_matrix_view`), without touching the elements between the lines.
+ *
+ * The lines are the rows when the elements of a row are contiguous (`stride(1) == 1`), or the
+ * columns when the elements of a column are (`stride(0) == 1`, and `stride(1) != 1`); `in` and
+ * `out` must agree. The loads and stores are vectorized when the pointers and the strides are
+ * aligned to 16 bytes (or to smaller powers of two).
+ *
+ * @tparam m_t matrix elements type
+ * @tparam idx_t integer type used for indexing
+ * @tparam Lambda type of lambda function used for the operation
+ * @tparam vec_t variadic types of device_vector_view vectors (size m if alongRows, size n
+ * otherwise)
+ * @param[in] handle raft handle for managing resources
+ * @param [out] out result of the operation; can be same as `in`.
+ * @param [in] in input matrix consisting of `nLines` lines, each `lineLen`-long.
+ * @param [in] alongLines whether vectors are indices along or across lines.
+ * @param [in] op the operation applied on each line (see the overloads above)
+ * @param [in] vecs zero or more vectors to be passed as arguments,
+ *    size of each vector is `alongLines ? lineLen : nLines`.
+ */
+template <typename m_t,
+          typename idx_t,
+          typename Lambda,
+          typename... vec_t,
+          typename = raft::enable_if_device_mdspan<vec_t...>>
+void linewise_op(raft::resources const& handle,
+                 raft::device_matrix_view<const m_t, idx_t, raft::layout_stride> in,
+                 raft::device_matrix_view<m_t, idx_t, raft::layout_stride> out,
+                 const bool alongLines,
+                 Lambda op,
+                 vec_t... vecs)
+{
+  RAFT_EXPECTS(out.extent(0) == in.extent(0) && out.extent(1) == in.extent(1),
+               "Input and output must have the same shape.");
+  const bool is_rowmajor = in.stride(1) == 1;
+  RAFT_EXPECTS(is_rowmajor || in.stride(0) == 1,
+               "The elements of either the rows or the columns must be contiguous.");
+  RAFT_EXPECTS(is_rowmajor ? out.stride(1) == 1 : out.stride(0) == 1,
+               "Input and output must have the same contiguous dimension.");
+
+  const idx_t nLines  = is_rowmajor ? in.extent(0) : in.extent(1);
+  const idx_t lineLen = is_rowmajor ? in.extent(1) : in.extent(0);
+  const idx_t inLd    = is_rowmajor ? in.stride(0) : in.stride(1);
+  const idx_t outLd   = is_rowmajor ? out.stride(0) : out.stride(1);
+
+  detail::MatrixLinewiseOp<16, 256>::runStrided<m_t, idx_t>(out.data_handle(),
+                                                            in.data_handle(),
+                                                            outLd,
+                                                            inLd,
+                                                            lineLen,
+                                                            nLines,
+                                                            alongLines,
+                                                            op,
+                                                            resource::get_cuda_stream(handle),
+                                                            vecs.data_handle()...);
+}
+
 /** @} */  // end of group linewise_op
 
 }  // namespace raft::matrix
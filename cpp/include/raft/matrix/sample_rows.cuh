@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/mdspan.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/matrix/detail/sample_rows.cuh>
+#include <raft/random/rng_state.hpp>
+
+namespace raft::matrix {
+
+/**
+ * @defgroup matrix_sample_rows Random subset of the rows of a matrix
+ * @{
+ */
+
+/**
+ * @brief Copy distinct rows of a matrix, drawn uniformly at random, to the device.
+ *
+ * The rows are drawn by `raft::random::sample_indices_without_replacement`, in O(k log k) for
+ * k rows, and copied in increasing order of their indices. The dataset may be in the host or in
+ * the device memory: this is the way to pick a training set out of a dataset larger than the
+ * device memory.
+ *
+ * @tparam T the data type
+ * @tparam IdxT the index type
+ * @tparam Accessor the accessor of the dataset (host or device)
+ *
+ * @param[in] res raft resources
+ * @param[inout] rng_state the state of the random number generator
+ * @param[in] dataset the matrix [n_rows, n_cols]
+ * @param[out] output the sampled rows [n_samples, n_cols], n_samples <= n_rows
+ */
+template <typename T, typename IdxT, typename Accessor>
+void sample_rows(
+  raft::resources const& res,
+  raft::random::RngState& rng_state,
+  raft::mdspan<const T, raft::matrix_extent<IdxT>, raft::row_major, Accessor> dataset,
+  raft::device_matrix_view<T, IdxT, raft::row_major> output)
+{
+  RAFT_EXPECTS(output.extent(1) == dataset.extent(1),
+               "The output must have the columns of the dataset");
+  RAFT_EXPECTS(output.extent(0) <= dataset.extent(0),
+               "The number of samples must not exceed the number of rows");
+  detail::sample_rows(res,
+                      rng_state,
+                      dataset.data_handle(),
+                      dataset.extent(0),
+                      dataset.extent(1),
+                      output.data_handle(),
+                      output.extent(0));
+}
+
+/** @} */  // end group matrix_sample_rows
+
+}  // namespace raft::matrix
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "detail/select_k.cuh"
+#include "detail/select_segmented.cuh"
 #include <raft/core/resource/cuda_stream.hpp>
 
 #include <raft/core/device_mdspan.hpp>
@@ -117,6 +118,90 @@ void select_k(raft::resources const& handle,
                                    algo);
 }
 
+/**
+ * Select k smallest or largest key/values from each segment of a ragged input.
+ *
+ * The input is a CSR-like set of rows of variable length: the segment `i` spans the elements
+ * `[offsets[i], offsets[i + 1])` of `in_val` (and `in_idx`). This avoids padding the rows to the
+ * longest one. All the segments are processed in a single kernel launch, one thread block per
+ * segment; the short segments use the warpsort queue and the long ones the radix select. A single
+ * segment is thus never spread over multiple thread blocks: the dense select_k is preferable for a
+ * few very long rows.
+ *
+ * The segments shorter than `k` are padded with the worst possible key
+ * (`raft::upper_bound<T>()` if `select_min`, `raft::lower_bound<T>()` otherwise) and the index
+ * `IdxT(-1)`.
+ *
+ * Example usage
+ * @code{.cpp}
+ *   using namespace raft;
+ *   // the candidates of all the queries, one segment per query
+ *   auto in_values = {... input device_vector_view<const float, int64_t> ...}
+ *   auto offsets   = {... input device_vector_view<const int64_t, int64_t> [n_queries + 1] ...}
+ *   auto out_values  = make_device_matrix<float, int64_t>(handle, n_queries, k);
+ *   auto out_indices = make_device_matrix<int64_t, int64_t>(handle, n_queries, k);
+ *   matrix::select_k_segmented<float, int64_t>(
+ *     handle, in_values, std::nullopt, offsets, out_values.view(), out_indices.view(), true);
+ * @endcode
+ *
+ * @tparam T
+ *   the type of the keys (what is being compared).
+ * @tparam IdxT
+ *   the index type (what is being selected together with the keys).
+ *
+ * @param[in] handle container of reusable resources
+ * @param[in] in_val
+ *   input values of all the segments [offsets[n_segments]];
+ * @param[in] in_idx
+ *   optional input payload [offsets[n_segments]];
+ *   If `in_idx` is `std::nullopt`, the position of the element within its segment is implied.
+ * @param[in] offsets
+ *   the segment offsets [n_segments + 1]; every segment length must fit the `IdxT` type.
+ * @param[out] out_val
+ *   output values [n_segments, k];
+ * @param[out] out_idx
+ *   output payload (e.g. indices) [n_segments, k];
+ * @param[in] select_min
+ *   whether to select k smallest (true) or largest (false) keys.
+ * @param[in] sorted
+ *   whether to make sure selected pairs are sorted by value (supported for k <= 256).
+ */
+template <typename T, typename IdxT>
+void select_k_segmented(raft::resources const& handle,
+                        raft::device_vector_view<const T, int64_t> in_val,
+                        std::optional<raft::device_vector_view<const IdxT, int64_t>> in_idx,
+                        raft::device_vector_view<const int64_t, int64_t> offsets,
+                        raft::device_matrix_view<T, int64_t, row_major> out_val,
+                        raft::device_matrix_view<IdxT, int64_t, row_major> out_idx,
+                        bool select_min,
+                        bool sorted = false)
+{
+  RAFT_EXPECTS(out_val.extent(1) <= int64_t(std::numeric_limits<int>::max()),
+               "output k must fit the int type.");
+  RAFT_EXPECTS(offsets.extent(0) >= 1, "offsets must contain at least one element");
+  auto n_segments = offsets.extent(0) - 1;
+  auto k          = int(out_val.extent(1));
+  RAFT_EXPECTS(n_segments == out_val.extent(0), "the number of segments must be equal");
+  RAFT_EXPECTS(n_segments == out_idx.extent(0), "the number of segments must be equal");
+  if (in_idx.has_value()) {
+    RAFT_EXPECTS(in_val.extent(0) == in_idx->extent(0),
+                 "value and index input lengths must be equal");
+  }
+  RAFT_EXPECTS(int64_t(k) == out_idx.extent(1), "value and index output lengths must be equal");
+
+  return detail::select::segmented::select_k<T, IdxT>(
+    in_val.data_handle(),
+    in_idx.has_value() ? in_idx->data_handle() : nullptr,
+    offsets.data_handle(),
+    n_segments,
+    k,
+    out_val.data_handle(),
+    out_idx.data_handle(),
+    select_min,
+    sorted,
+    resource::get_cuda_stream(handle));
+}
+
 /** @} */  // end of group select_k
 
 }  // namespace raft::matrix
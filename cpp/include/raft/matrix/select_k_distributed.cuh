@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/select_k_distributed.cuh"
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resources.hpp>
+
+#include <optional>
+
+namespace raft::matrix {
+
+/**
+ * @addtogroup select_k
+ * @{
+ */
+
+/**
+ * Select k smallest or largest key/values from each row of a matrix sharded by columns across
+ * the ranks of the communicator.
+ *
+ * Every rank holds a contiguous block of columns of the same `batch_size` rows. Each rank selects
+ * its local top-k, the candidates of all the ranks are gathered with `allgather`, and they are
+ * merged on device, so that every rank ends up with the global top-k of every row. Nothing goes
+ * through the host.
+ *
+ * Example usage
+ * @code{.cpp}
+ *   using namespace raft;
+ *   // the resources must carry the communicator, see raft::resource::set_comms
+ *   // the distances of the queries to the dataset shard of this rank
+ *   auto in_values = {... input device_matrix_view<const float, int64_t, row_major> ...}
+ *   auto out_values  = make_device_matrix<float, int64_t>(handle, n_queries, k);
+ *   auto out_indices = make_device_matrix<int64_t, int64_t>(handle, n_queries, k);
+ *   // the global id of the first column of this shard
+ *   int64_t shard_offset = ...;
+ *   matrix::select_k_distributed<float, int64_t>(handle,
+ *                                                in_values,
+ *                                                std::nullopt,
+ *                                                shard_offset,
+ *                                                out_values.view(),
+ *                                                out_indices.view(),
+ *                                                true);
+ * @endcode
+ *
+ * @tparam T
+ *   the type of the keys (what is being compared).
+ * @tparam IdxT
+ *   the index type (what is being selected together with the keys).
+ *
+ * @param[in] handle container of reusable resources, with the communicator set.
+ * @param[in] in_val
+ *   the local input values [batch_size, len]; `len >= k` on every rank.
+ * @param[in] in_idx
+ *   optional local input payload [batch_size, len];
+ *   If `in_idx` is `std::nullopt`, a contiguous array `0...len-1` is implied.
+ * @param[in] idx_offset
+ *   the value added to the local payload of this rank to make it global (e.g. the global index of
+ *   the first local column, or zero if `in_idx` is already global).
+ * @param[out] out_val
+ *   output values [batch_size, k], the same on all the ranks.
+ * @param[out] out_idx
+ *   output payload [batch_size, k], the same on all the ranks.
+ * @param[in] select_min
+ *   whether to select k smallest (true) or largest (false) keys.
+ */
+template <typename T, typename IdxT>
+void select_k_distributed(
+  raft::resources const& handle,
+  raft::device_matrix_view<const T, int64_t, row_major> in_val,
+  std::optional<raft::device_matrix_view<const IdxT, int64_t, row_major>> in_idx,
+  IdxT idx_offset,
+  raft::device_matrix_view<T, int64_t, row_major> out_val,
+  raft::device_matrix_view<IdxT, int64_t, row_major> out_idx,
+  bool select_min)
+{
+  RAFT_EXPECTS(resource::comms_initialized(handle), "select_k_distributed needs a communicator");
+  RAFT_EXPECTS(in_val.extent(1) >= out_val.extent(1),
+               "every rank must hold at least k columns (len = %zu, k = %zu)",
+               static_cast<size_t>(in_val.extent(1)),
+               static_cast<size_t>(out_val.extent(1)));
+  RAFT_EXPECTS(in_val.extent(0) == out_val.extent(0), "batch sizes must be equal");
+  RAFT_EXPECTS(in_val.extent(0) == out_idx.extent(0), "batch sizes must be equal");
+  RAFT_EXPECTS(out_val.extent(1) == out_idx.extent(1),
+               "value and index output lengths must be equal");
+
+  detail::select_k_distributed<T, IdxT>(
+    handle, in_val, in_idx, idx_offset, out_val, out_idx, select_min);
+}
+
+/** @} */  // end of group select_k
+
+}  // namespace raft::matrix
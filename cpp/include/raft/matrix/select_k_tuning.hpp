@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/error.hpp>
+#include <raft/matrix/select_k_types.hpp>
+#include <raft/util/cuda_rt_essentials.hpp>
+
+#include <cuda_runtime_api.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace raft::matrix {
+
+/**
+ * @addtogroup select_k
+ * @{
+ */
+
+/**
+ * @brief A select-k algorithm decision table measured on one device.
+ *
+ * The table covers a grid of (batch_size, len, k) points, each dimension being a range of powers
+ * of two. Every grid point holds the fastest algorithm measured there, or `SelectAlgo::kAuto` if
+ * the point was not measured (the built-in heuristic is used for it).
+ *
+ * A table is produced by the select_k benchmark (`MATRIX_BENCH --select_k_autotune=<file>`), and
+ * registered for the current device with `raft::matrix::load_select_k_tuning`; from then on,
+ * `SelectAlgo::kAuto` picks the algorithm from the table.
+ */
+struct select_k_tuning_table {
+  /** A dimension of the grid: the powers of two `2^(first + i * step)` for `i` in `[0, count)`. */
+  struct log2_range {
+    int first = 0;
+    int step  = 1;
+    int count = 0;
+
+    /** The nearest grid point of `log2(x)`; `round_up` picks the first point not below it. */
+    [[nodiscard]] auto index_of(double x, bool round_up) const -> std::optional<int>
+    {
+      const double pos = (std::log2(std::max(x, 1.0)) - first) / step;
+      const int i      = static_cast<int>(round_up ? std::ceil(pos - 1e-9) : std::lround(pos));
+      if (round_up && i >= count) { return std::nullopt; }
+      return std::clamp(i, 0, count - 1);
+    }
+    [[nodiscard]] auto value_at(int i) const -> size_t { return size_t{1} << (first + i * step); }
+  };
+
+  /** The properties of the device the table was measured on. */
+  std::string device_name;
+  int cc_major = 0;
+  int cc_minor = 0;
+  int sm_count = 0;
+
+  log2_range batch_size;
+  log2_range len;
+  log2_range k;
+  /** The fastest algorithm at every grid point [batch_size.count, len.count, k.count]. */
+  std::vector<SelectAlgo> algos;
+
+  /** Whether the table was measured on a device with the given properties. */
+  [[nodiscard]] auto matches(const cudaDeviceProp& prop) const -> bool
+  {
+    return device_name == prop.name && cc_major == prop.major && cc_minor == prop.minor &&
+           sm_count == prop.multiProcessorCount;
+  }
+
+  /** The tuned algorithm for the given input shape, if the table covers it. */
+  [[nodiscard]] auto lookup(size_t rows, size_t cols, int k_value) const
+    -> std::optional<SelectAlgo>
+  {
+    // k is rounded up, so that the algorithm was measured with at least the requested k
+    auto ik = k.index_of(k_value, true);
+    if (!ik.has_value()) { return std::nullopt; }
+    auto ib   = *batch_size.index_of(rows, false);
+    auto il   = *len.index_of(cols, false);
+    auto algo = algos[(size_t(ib) * len.count + il) * k.count + *ik];
+    if (algo == SelectAlgo::kAuto) { return std::nullopt; }
+    return algo;
+  }
+
+  /** Write the table in a compact text form. */
+  void save(std::ostream& os) const
+  {
+    os << "raft_select_k_tuning " << kSerializationVersion << "\n"
+       << cc_major << " " << cc_minor << " " << sm_count << " " << device_name << "\n";
+    for (auto* r : {&batch_size, &len, &k}) {
+      os << r->first << " " << r->step << " " << r->count << "\n";
+    }
+    for (size_t i = 0; i < algos.size(); i++) {
+      os << static_cast<int>(algos[i]) << ((i + 1) % k.count == 0 ? "\n" : " ");
+    }
+  }
+
+  /** Read a table written by `save`. */
+  static auto load(std::istream& is) -> select_k_tuning_table
+  {
+    std::string magic;
+    int version = 0;
+    is >> magic >> version;
+    RAFT_EXPECTS(is && magic == "raft_select_k_tuning", "Not a select_k tuning table");
+    RAFT_EXPECTS(version == kSerializationVersion,
+                 "Unsupported select_k tuning table version %d (expected %d)",
+                 version,
+                 kSerializationVersion);
+    select_k_tuning_table table;
+    is >> table.cc_major >> table.cc_minor >> table.sm_count >> std::ws;
+    std::getline(is, table.device_name);
+    for (auto* r : {&table.batch_size, &table.len, &table.k}) {
+      is >> r->first >> r->step >> r->count;
+      RAFT_EXPECTS(is && r->count > 0 && r->step > 0, "Invalid select_k tuning table grid");
+    }
+    table.algos.resize(size_t(table.batch_size.count) * table.len.count * table.k.count);
+    for (auto& algo : table.algos) {
+      int a = 0;
+      is >> a;
+      RAFT_EXPECTS(is && a >= 0 && a <= static_cast<int>(SelectAlgo::kWarpDistributedShm),
+                   "Invalid select_k tuning table entry");
+      algo = static_cast<SelectAlgo>(a);
+    }
+    return table;
+  }
+
+  static constexpr int kSerializationVersion = 1;
+};
+
+namespace detail {
+
+struct select_k_tuning_registry {
+  std::mutex mutex;
+  std::unordered_map<int, select_k_tuning_table> tables;  // by device id
+  std::atomic<bool> empty{true};
+};
+
+inline auto get_select_k_tuning_registry() -> select_k_tuning_registry&
+{
+  static select_k_tuning_registry registry;
+  return registry;
+}
+
+}  // namespace detail
+
+/**
+ * Use the given table for `SelectAlgo::kAuto` on the current device.
+ *
+ * @param[in] table a table measured on a device of the same kind as the current one.
+ */
+inline void set_select_k_tuning(const select_k_tuning_table& table)
+{
+  int dev;
+  cudaDeviceProp prop;
+  RAFT_CUDA_TRY(cudaGetDevice(&dev));
+  RAFT_CUDA_TRY(cudaGetDeviceProperties(&prop, dev));
+  RAFT_EXPECTS(table.matches(prop),
+               "The select_k tuning table was measured on '%s' (sm_%d%d, %d SMs), not on '%s'",
+               table.device_name.c_str(),
+               table.cc_major,
+               table.cc_minor,
+               table.sm_count,
+               prop.name);
+  auto& registry = detail::get_select_k_tuning_registry();
+  std::lock_guard<std::mutex> guard(registry.mutex);
+  registry.tables[dev] = table;
+  registry.empty       = false;
+}
+
+/** Go back to the built-in heuristic for `SelectAlgo::kAuto` on all the devices. */
+inline void reset_select_k_tuning()
+{
+  auto& registry = detail::get_select_k_tuning_registry();
+  std::lock_guard<std::mutex> guard(registry.mutex);
+  registry.tables.clear();
+  registry.empty = true;
+}
+
+/**
+ * Load the tables of a tuning file and register the one measured on a device like the current
+ * one.
+ *
+ * A tuning file holds any number of tables (e.g. one per GPU model of a cluster).
+ *
+ * @param[in] path the tuning file
+ * @return whether the file had a table for the current device.
+ */
+inline auto load_select_k_tuning(const std::string& path) -> bool
+{
+  std::ifstream is(path);
+  RAFT_EXPECTS(is, "Cannot open the select_k tuning file '%s'", path.c_str());
+  int dev;
+  cudaDeviceProp prop;
+  RAFT_CUDA_TRY(cudaGetDevice(&dev));
+  RAFT_CUDA_TRY(cudaGetDeviceProperties(&prop, dev));
+  while ((is >> std::ws).peek() != std::char_traits<char>::eof()) {
+    auto table = select_k_tuning_table::load(is);
+    if (table.matches(prop)) {
+      set_select_k_tuning(table);
+      return true;
+    }
+  }
+  return false;
+}
+
+/** The algorithm tuned for the current device and the given input shape, if any. */
+inline auto lookup_select_k_tuning(size_t rows, size_t cols, int k) -> std::optional<SelectAlgo>
+{
+  auto& registry = detail::get_select_k_tuning_registry();
+  if (registry.empty) { return std::nullopt; }
+  int dev;
+  RAFT_CUDA_TRY(cudaGetDevice(&dev));
+  std::lock_guard<std::mutex> guard(registry.mutex);
+  auto it = registry.tables.find(dev);
+  if (it == registry.tables.end()) { return std::nullopt; }
+  return it->second.lookup(rows, cols, k);
+}
+
+/** @} */  // end of group select_k
+
+}  // namespace raft::matrix
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,8 @@
 
 #include <raft/distance/distance_types.hpp>
 
+#include <cstddef>
+
 namespace raft::neighbors::ann {
 
 /**
@@ -47,6 +49,28 @@ struct index_params {
 
 struct search_params {};
 
+/**
+ * The memory used by a call of an ANN method, in bytes (see raft/neighbors/memory_estimate.cuh).
+ *
+ * These are estimates of the dominant allocations of the method for the given parameters and
+ * sizes, not strict bounds: the workspaces of the libraries it calls (cuBLAS, CUB, thrust), the
+ * allocator overheads and the buffers whose size does not scale with the inputs are not counted.
+ */
+struct memory_estimate {
+  /** The device memory kept after the call (the index built); zero for a search. */
+  size_t device_index = 0;
+  /** The peak of the temporary device allocations during the call (mostly the workspace). */
+  size_t device_workspace = 0;
+  /** The peak of the host memory (pinned or not) during the call, including a host index. */
+  size_t host = 0;
+
+  /** The peak of the device memory used during the call. */
+  [[nodiscard]] constexpr auto device_peak() const noexcept -> size_t
+  {
+    return device_index + device_workspace;
+  }
+};
+
 /** @} */  // end group ann_types
 
 };  // namespace raft::neighbors::ann
@@ -16,6 +16,7 @@
 #pragma once
 
 #include <cstdint>                              // uint32_t
+#include <raft/core/device_csr_matrix.hpp>      // raft::device_csr_matrix
 #include <raft/distance/distance_types.hpp>     // raft::distance::DistanceType
 #include <raft/neighbors/ball_cover_types.hpp>  // BallCoverIndex
 #include <raft/util/raft_explicit.hpp>          // RAFT_EXPLICIT
@@ -86,6 +87,14 @@ void eps_nn(raft::resources const& handle,
             std::optional<raft::host_scalar_view<int_t, matrix_idx_t>> max_k = std::nullopt)
   RAFT_EXPLICIT;
 
+template <typename idx_t, typename value_t, typename int_t, typename matrix_idx_t>
+void eps_nn(raft::resources const& handle,
+            const BallCoverIndex<idx_t, value_t, int_t, matrix_idx_t>& index,
+            raft::device_matrix_view<const value_t, matrix_idx_t, row_major> query,
+            value_t eps,
+            raft::device_csr_matrix<bool, idx_t, idx_t, idx_t>& adj,
+            std::size_t max_workspace_bytes = std::size_t{1} << 30) RAFT_EXPLICIT;
+
 }  // namespace raft::neighbors::ball_cover
 
 #endif  // RAFT_EXPLICIT_INSTANTIATE_ONLY
@@ -124,6 +133,14 @@ void eps_nn(raft::resources const& handle,
     value_t eps,                                                                                   \
     std::optional<raft::host_scalar_view<int_t, matrix_idx_t>> max_k);                             \
                                                                                                    \
+  extern template void raft::neighbors::ball_cover::eps_nn<idx_t, value_t, int_t, matrix_idx_t>(   \
+    raft::resources const& handle,                                                                 \
+    const raft::neighbors::ball_cover::BallCoverIndex<idx_t, value_t, int_t, matrix_idx_t>& index, \
+    raft::device_matrix_view<const value_t, matrix_idx_t, row_major> query,                        \
+    value_t eps,                                                                                   \
+    raft::device_csr_matrix<bool, idx_t, idx_t, idx_t>& adj,                                       \
+    std::size_t max_workspace_bytes);                                                              \
+                                                                                                   \
   extern template void                                                                             \
   raft::neighbors::ball_cover::all_knn_query<idx_t, value_t, int_t, matrix_idx_t>(                 \
     raft::resources const& handle,                                                                 \
@@ -20,6 +20,7 @@
 
 #include <cstdint>
 
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/neighbors/ball_cover_types.hpp>
 #include <raft/spatial/knn/detail/ball_cover.cuh>
@@ -52,6 +53,10 @@ namespace raft::neighbors::ball_cover {
  *  ball_cover::build_index(handle, index);
  * @endcode
  *
+ * The supported metrics are Haversine (2d points), L2SqrtExpanded / L2SqrtUnexpanded and
+ * CosineExpanded (any dimensionality). The inner product is not a metric (the triangle inequality
+ * the pruning relies on does not hold): normalize the vectors and use the cosine distance instead.
+ *
  * @tparam idx_t knn index type
  * @tparam value_t knn value type
  * @tparam int_t integral type for knn params
@@ -63,6 +68,8 @@ template <typename idx_t, typename value_t, typename int_t, typename matrix_idx_
 void build_index(raft::resources const& handle,
                  BallCoverIndex<idx_t, value_t, int_t, matrix_idx_t>& index)
 {
+  RAFT_EXPECTS(index.metric != raft::distance::DistanceType::Haversine || index.n == 2,
+               "Haversine distance requires 2d (latitude, longitude) points");
   if (index.metric == raft::distance::DistanceType::Haversine) {
     raft::spatial::knn::detail::rbc_build_index(
       handle, index, spatial::knn::detail::HaversineFunc<value_t, int_t>());
@@ -70,6 +77,9 @@ void build_index(raft::resources const& handle,
              index.metric == raft::distance::DistanceType::L2SqrtUnexpanded) {
     raft::spatial::knn::detail::rbc_build_index(
       handle, index, spatial::knn::detail::EuclideanFunc<value_t, int_t>());
+  } else if (index.metric == raft::distance::DistanceType::CosineExpanded) {
+    raft::spatial::knn::detail::rbc_build_index(
+      handle, index, spatial::knn::detail::CosineFunc<value_t, int_t>());
   } else {
     RAFT_FAIL("Metric not support");
   }
@@ -116,7 +126,8 @@ void all_knn_query(raft::resources const& handle,
                    bool perform_post_filtering = true,
                    float weight                = 1.0)
 {
-  ASSERT(index.n <= 3, "only 2d and 3d vectors are supported in current implementation");
+  RAFT_EXPECTS(index.metric != raft::distance::DistanceType::Haversine || index.n == 2,
+               "Haversine distance requires 2d (latitude, longitude) points");
   if (index.metric == raft::distance::DistanceType::Haversine) {
     raft::spatial::knn::detail::rbc_all_knn_query(
       handle,
@@ -138,6 +149,16 @@ void all_knn_query(raft::resources const& handle,
       spatial::knn::detail::EuclideanFunc<value_t, int_t>(),
       perform_post_filtering,
       weight);
+  } else if (index.metric == raft::distance::DistanceType::CosineExpanded) {
+    raft::spatial::knn::detail::rbc_all_knn_query(
+      handle,
+      index,
+      k,
+      inds,
+      dists,
+      spatial::knn::detail::CosineFunc<value_t, int_t>(),
+      perform_post_filtering,
+      weight);
   } else {
     RAFT_FAIL("Metric not supported");
   }
@@ -209,7 +230,6 @@ void all_knn_query(raft::resources const& handle,
                    bool perform_post_filtering = true,
                    float weight                = 1.0)
 {
-  RAFT_EXPECTS(index.n <= 3, "only 2d and 3d vectors are supported in current implementation");
   RAFT_EXPECTS(k <= index.m,
                "k must be less than or equal to the number of data points in the index");
   RAFT_EXPECTS(inds.extent(1) == dists.extent(1) && dists.extent(1) == static_cast<matrix_idx_t>(k),
@@ -265,7 +285,6 @@ void knn_query(raft::resources const& handle,
                bool perform_post_filtering = true,
                float weight                = 1.0)
 {
-  ASSERT(index.n <= 3, "only 2d and 3d vectors are supported in current implementation");
   if (index.metric == raft::distance::DistanceType::Haversine) {
     raft::spatial::knn::detail::rbc_knn_query(handle,
                                               index,
@@ -289,6 +308,17 @@ void knn_query(raft::resources const& handle,
                                               spatial::knn::detail::EuclideanFunc<value_t, int_t>(),
                                               perform_post_filtering,
                                               weight);
+  } else if (index.metric == raft::distance::DistanceType::CosineExpanded) {
+    raft::spatial::knn::detail::rbc_knn_query(handle,
+                                              index,
+                                              k,
+                                              query,
+                                              n_query_pts,
+                                              inds,
+                                              dists,
+                                              spatial::knn::detail::CosineFunc<value_t, int_t>(),
+                                              perform_post_filtering,
+                                              weight);
   } else {
     RAFT_FAIL("Metric not supported");
   }
@@ -394,6 +424,58 @@ void eps_nn(raft::resources const& handle,
     spatial::knn::detail::EuclideanFunc<value_t, int_t>());
 }
 
+/**
+ * @brief Computes epsilon neighborhood for the L2 distance metric using rbc into a CSR matrix
+ *
+ * Unlike the variants above, the queries are processed in batches sized to `max_workspace_bytes`
+ * with a count pass and a fill pass, and the adjacency is allocated only once the number of
+ * neighbors is known: neither the dense `m x n` adjacency nor a per-row cap (`max_k`) is needed.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *  auto adj = raft::make_device_csr_matrix<bool, int64_t, int64_t, int64_t>(
+ *    handle, n_query, index.m);
+ *  raft::neighbors::ball_cover::eps_nn(handle, index, query, eps, adj);
+ *  // adj.structure_view().get_indptr() / get_indices() hold the neighborhoods of the queries
+ * @endcode
+ *
+ * @tparam value_t   IO and math type
+ * @tparam idx_t    Index type
+ *
+ * @param[in] handle raft handle for resource management
+ * @param[in] index ball cover index which has been built
+ * @param[in]  query  first matrix [row-major] [on device] [dim = m x k]
+ * @param[in]  eps    defines epsilon neighborhood radius
+ * @param[out] adj    sparsity-owning adjacency matrix [dim = m x index.m]; its sparsity is
+ *                    initialized by this function and all its elements are set to `true`
+ * @param[in]  max_workspace_bytes the bound of the temporary memory of a batch of queries (the
+ *                    landmark distances); the CSR output and the `m + 1` row offsets come on top
+ */
+template <typename idx_t, typename value_t, typename int_t, typename matrix_idx_t = std::int64_t>
+void eps_nn(raft::resources const& handle,
+            const BallCoverIndex<idx_t, value_t, int_t, matrix_idx_t>& index,
+            raft::device_matrix_view<const value_t, matrix_idx_t, row_major> query,
+            value_t eps,
+            raft::device_csr_matrix<bool, idx_t, idx_t, idx_t>& adj,
+            std::size_t max_workspace_bytes = std::size_t{1} << 30)
+{
+  ASSERT(index.n == query.extent(1), "vector dimension needs to be the same for index and queries");
+  ASSERT(index.metric == raft::distance::DistanceType::L2SqrtExpanded ||
+           index.metric == raft::distance::DistanceType::L2SqrtUnexpanded,
+         "Metric not supported");
+  ASSERT(index.is_index_trained(), "index must be previously trained");
+
+  raft::spatial::knn::detail::rbc_eps_nn_query_batched(
+    handle,
+    index,
+    eps,
+    query.data_handle(),
+    static_cast<int_t>(query.extent(0)),
+    max_workspace_bytes,
+    adj,
+    spatial::knn::detail::EuclideanFunc<value_t, int_t>());
+}
+
 /**
  * @ingroup random_ball_cover
  * @{
@@ -18,6 +18,7 @@
 
 #include <optional>
 
+#include <raft/core/bitset.cuh>              // raft::core::bitset_view
 #include <raft/core/device_mdspan.hpp>       // raft::device_matrix_view
 #include <raft/core/operators.hpp>           // raft::identity_op
 #include <raft/core/resources.hpp>           // raft::resources
@@ -25,6 +26,8 @@
 #include <raft/neighbors/brute_force_types.hpp>
 #include <raft/util/raft_explicit.hpp>  // RAFT_EXPLICIT
 
+#include <cuda_fp16.h>  // half
+
 #ifdef RAFT_EXPLICIT_INSTANTIATE_ONLY
 
 namespace raft::neighbors::brute_force {
@@ -65,6 +68,39 @@ void search(raft::resources const& res,
             raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
             raft::device_matrix_view<T, int64_t, row_major> distances) RAFT_EXPLICIT;
 
+template <typename T, typename IdxT>
+void search_with_filtering(raft::resources const& res,
+                           const index<T>& idx,
+                           raft::device_matrix_view<const T, int64_t, row_major> queries,
+                           raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                           raft::device_matrix_view<T, int64_t, row_major> distances,
+                           raft::core::bitset_view<const uint32_t, int64_t> filter) RAFT_EXPLICIT;
+
+template <typename T, typename IdxT>
+void streaming_knn(raft::resources const& res,
+                   raft::host_matrix_view<const T, int64_t, row_major> dataset,
+                   raft::device_matrix_view<const T, int64_t, row_major> queries,
+                   raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                   raft::device_matrix_view<T, int64_t, row_major> distances,
+                   raft::distance::DistanceType metric = distance::DistanceType::L2Unexpanded,
+                   T metric_arg                        = 2.0,
+                   int64_t chunk_rows                  = 0) RAFT_EXPLICIT;
+
+template <typename IdxT>
+void search(raft::resources const& res,
+            const index<half>& idx,
+            raft::device_matrix_view<const half, int64_t, row_major> queries,
+            raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+            raft::device_matrix_view<float, int64_t, row_major> distances) RAFT_EXPLICIT;
+
+template <typename IdxT>
+void search(raft::resources const& res,
+            search_params const& params,
+            const index<half>& idx,
+            raft::device_matrix_view<const half, int64_t, row_major> queries,
+            raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+            raft::device_matrix_view<float, int64_t, row_major> distances) RAFT_EXPLICIT;
+
 template <typename idx_t,
           typename value_t,
           typename matrix_idx,
@@ -152,6 +188,22 @@ extern template void search<float, int64_t>(
   raft::device_matrix_view<int64_t, int64_t, row_major> neighbors,
   raft::device_matrix_view<float, int64_t, row_major> distances);
 
+extern template void search_with_filtering<float, int>(
+  raft::resources const& res,
+  const raft::neighbors::brute_force::index<float>& idx,
+  raft::device_matrix_view<const float, int64_t, row_major> queries,
+  raft::device_matrix_view<int, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances,
+  raft::core::bitset_view<const uint32_t, int64_t> filter);
+
+extern template void search_with_filtering<float, int64_t>(
+  raft::resources const& res,
+  const raft::neighbors::brute_force::index<float>& idx,
+  raft::device_matrix_view<const float, int64_t, row_major> queries,
+  raft::device_matrix_view<int64_t, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances,
+  raft::core::bitset_view<const uint32_t, int64_t> filter);
+
 extern template raft::neighbors::brute_force::index<float> build<float>(
   raft::resources const& res,
   raft::device_matrix_view<const float, int64_t, row_major> dataset,
@@ -173,6 +225,53 @@ extern template raft::neighbors::brute_force::index<float> build<float>(
   raft::resources const& res,
   index_params const& params,
   raft::host_matrix_view<const float, int64_t, row_major> dataset);
+
+extern template void streaming_knn<float, int64_t>(
+  raft::resources const& res,
+  raft::host_matrix_view<const float, int64_t, row_major> dataset,
+  raft::device_matrix_view<const float, int64_t, row_major> queries,
+  raft::device_matrix_view<int64_t, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances,
+  raft::distance::DistanceType metric,
+  float metric_arg,
+  int64_t chunk_rows);
+
+extern template void search<int64_t>(
+  raft::resources const& res,
+  const raft::neighbors::brute_force::index<half>& idx,
+  raft::device_matrix_view<const half, int64_t, row_major> queries,
+  raft::device_matrix_view<int64_t, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances);
+
+extern template void search<int64_t>(
+  raft::resources const& res,
+  search_params const& params,
+  const raft::neighbors::brute_force::index<half>& idx,
+  raft::device_matrix_view<const half, int64_t, row_major> queries,
+  raft::device_matrix_view<int64_t, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances);
+
+extern template raft::neighbors::brute_force::index<half> build<half>(
+  raft::resources const& res,
+  raft::device_matrix_view<const half, int64_t, row_major> dataset,
+  raft::distance::DistanceType metric,
+  half metric_arg);
+
+extern template raft::neighbors::brute_force::index<half> build<half>(
+  raft::resources const& res,
+  index_params const& params,
+  raft::device_matrix_view<const half, int64_t, row_major> dataset);
+
+extern template raft::neighbors::brute_force::index<half> build<half>(
+  raft::resources const& res,
+  raft::host_matrix_view<const half, int64_t, row_major> dataset,
+  raft::distance::DistanceType metric,
+  half metric_arg);
+
+extern template raft::neighbors::brute_force::index<half> build<half>(
+  raft::resources const& res,
+  index_params const& params,
+  raft::host_matrix_view<const half, int64_t, row_major> dataset);
 }  // namespace raft::neighbors::brute_force
 
 #define instantiate_raft_neighbors_brute_force_fused_l2_knn(            \
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,12 +16,14 @@
 
 #pragma once
 
+#include <raft/core/bitset.cuh>
 #include <raft/core/copy.cuh>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/neighbors/brute_force_types.hpp>
 #include <raft/neighbors/detail/knn_brute_force.cuh>
+#include <raft/neighbors/detail/knn_brute_force_streaming.cuh>
 #include <raft/spatial/knn/detail/fused_l2_knn.cuh>
 
 namespace raft::neighbors::brute_force {
@@ -54,6 +56,9 @@ namespace raft::neighbors::brute_force {
  * each partition to its global id so that the final merged knn
  * is based on the global ids.
  *
+ * Up to `k = 1024` and a few dozen partitions, every row is merged by a block select; with more
+ * partitions or a larger `k`, all the partitions are merged with a single `select_k`.
+ *
  * Usage example:
  * @code{.cpp}
  *  #include <raft/core/resources.hpp>
@@ -102,14 +107,14 @@ inline void knn_merge_parts(
   if (translations.has_value()) { translations_ptr = translations.value().data_handle(); }
 
   auto n_parts = in_keys.extent(0) / n_samples;
-  detail::knn_merge_parts(in_keys.data_handle(),
+  detail::knn_merge_parts(handle,
+                          in_keys.data_handle(),
                           in_values.data_handle(),
                           out_keys.data_handle(),
                           out_values.data_handle(),
                           n_samples,
                           n_parts,
                           in_keys.extent(1),
-                          resource::get_cuda_stream(handle),
                           translations_ptr);
 }
 
@@ -207,7 +212,66 @@ void knn(raft::resources const& handle,
 }
 
 /**
- * @brief Compute the k-nearest neighbors using L2 expanded/unexpanded distance.
+ * @brief Exact k-nearest neighbors over a dataset in host memory (possibly larger than the GPU
+ * memory).
+ *
+ * The dataset is streamed to the device in chunks of `chunk_rows` rows, through pinned staging
+ * buffers. The copy of the next chunk runs on a side stream while the current chunk is searched;
+ * the per-chunk results are merged into the running top-k with `knn_merge_parts`. The side stream
+ * is taken from the stream pool of the resources: without a stream pool, the copies and the
+ * searches are serialized on the main stream.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *  #include <raft/core/resources.hpp>
+ *  #include <raft/core/resource/cuda_stream_pool.hpp>
+ *  #include <raft/neighbors/brute_force.cuh>
+ *  using namespace raft::neighbors;
+ *
+ *  raft::resources res;
+ *  // a stream for the uploads
+ *  raft::resource::set_cuda_stream_pool(res, std::make_shared<rmm::cuda_stream_pool>(1));
+ *  // dataset: host_matrix_view [n_rows, dim]; queries: device_matrix_view [n_queries, dim]
+ *  brute_force::streaming_knn(res,
+ *                             dataset,
+ *                             queries,
+ *                             neighbors.view(),
+ *                             distances.view(),
+ *                             raft::distance::DistanceType::InnerProduct);
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res raft resources
+ * @param[in] dataset a host matrix view to a row-major matrix [n_rows, dim]
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, dim]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors [n_queries,
+ * k]
+ * @param[in] metric distance metric to use
+ * @param[in] metric_arg the value of `p` for Minkowski (l-p) distances
+ * @param[in] chunk_rows the number of dataset rows per chunk (at least k); 0 picks the size from the
+ *   free device memory
+ */
+template <typename T, typename IdxT>
+void streaming_knn(raft::resources const& res,
+                   raft::host_matrix_view<const T, int64_t, row_major> dataset,
+                   raft::device_matrix_view<const T, int64_t, row_major> queries,
+                   raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                   raft::device_matrix_view<T, int64_t, row_major> distances,
+                   raft::distance::DistanceType metric = distance::DistanceType::L2Unexpanded,
+                   T metric_arg                        = 2.0,
+                   int64_t chunk_rows                  = 0)
+{
+  raft::neighbors::detail::brute_force_search_streaming<T, IdxT>(
+    res, dataset, queries, neighbors, distances, metric, metric_arg, chunk_rows);
+}
+
+/**
+ * @brief Compute the k-nearest neighbors using L2 expanded/unexpanded, inner product, cosine,
+ * L1, Linf, Canberra, Hamming, Jensen-Shannon or Russell-Rao distance.
  *
  * This is a specialized function for fusing the k-selection with the distance
  * computation when k < 64. The value of k will be inferred from the number
@@ -235,7 +299,8 @@ void knn(raft::resources const& handle,
  * @param[in] query input query array on device (size n * d)
  * @param[out] out_inds output indices array on device (size n * k)
  * @param[out] out_dists output dists array on device (size n * k)
- * @param[in] metric type of distance computation to perform (must be a variant of L2)
+ * @param[in] metric type of distance computation to perform (a variant of L2, InnerProduct,
+ *   CosineExpanded, L1, Linf, Canberra, HammingUnexpanded, JensenShannon or RusselRaoExpanded)
  */
 template <typename value_t, typename idx_t, typename idx_layout, typename query_layout>
 void fused_l2_knn(raft::resources const& handle,
@@ -255,8 +320,16 @@ void fused_l2_knn(raft::resources const& handle,
   RAFT_EXPECTS(metric == distance::DistanceType::L2Expanded ||
                  metric == distance::DistanceType::L2Unexpanded ||
                  metric == distance::DistanceType::L2SqrtUnexpanded ||
-                 metric == distance::DistanceType::L2SqrtExpanded,
-               "Distance metric must be L2");
+                 metric == distance::DistanceType::L2SqrtExpanded ||
+                 metric == distance::DistanceType::InnerProduct ||
+                 metric == distance::DistanceType::CosineExpanded ||
+                 metric == distance::DistanceType::L1 ||
+                 metric == distance::DistanceType::Linf ||
+                 metric == distance::DistanceType::Canberra ||
+                 metric == distance::DistanceType::HammingUnexpanded ||
+                 metric == distance::DistanceType::JensenShannon ||
+                 metric == distance::DistanceType::RusselRaoExpanded,
+               "Distance metric is not supported by the fused k-nearest neighbors");
 
   size_t n_index_rows = index.extent(0);
   size_t n_query_rows = query.extent(0);
@@ -341,7 +414,7 @@ index<T> build(raft::resources const& res,
 {
   // certain distance metrics can benefit by pre-calculating the norms for the index dataset
   // which lets us avoid calculating these at query time
-  std::optional<device_vector<T, int64_t>> norms;
+  std::optional<device_vector<typename index<T>::norm_type, int64_t>> norms;
   // TODO(wphicks): Replace once mdbuffer is available
   auto dataset_storage = std::optional<device_matrix<T, int64_t>>{};
   auto dataset_view    = [&res, &dataset_storage, dataset]() {
@@ -357,9 +430,17 @@ index<T> build(raft::resources const& res,
   if (metric == raft::distance::DistanceType::L2Expanded ||
       metric == raft::distance::DistanceType::L2SqrtExpanded ||
       metric == raft::distance::DistanceType::CosineExpanded) {
-    norms = make_device_vector<T, int64_t>(res, dataset.extent(0));
+    norms = make_device_vector<typename index<T>::norm_type, int64_t>(res, dataset.extent(0));
     // cosine needs the l2norm, where as l2 distances needs the squared norm
-    if (metric == raft::distance::DistanceType::CosineExpanded) {
+    if constexpr (std::is_same_v<T, half>) {
+      raft::neighbors::detail::half_row_norms(
+        res,
+        dataset_view.data_handle(),
+        dataset_view.extent(0),
+        dataset_view.extent(1),
+        norms->data_handle(),
+        metric == raft::distance::DistanceType::CosineExpanded);
+    } else if (metric == raft::distance::DistanceType::CosineExpanded) {
       raft::linalg::norm(res,
                          dataset_view,
                          norms->view(),
@@ -449,5 +530,110 @@ void search(raft::resources const& res,
   raft::neighbors::detail::brute_force_search<T, IdxT>(res, idx, queries, neighbors, distances);
 }
 
+/**
+ * @brief Brute Force search over the rows of the index passing a bitset filter.
+ *
+ * The rows passing the filter are selected first (a rank/select over the bitset) and gathered, and
+ * the distances are computed for these rows only. This is meant for selective filters: the cost
+ * scales with the number of rows passing the filter, at the price of a copy of these rows.
+ *
+ * If less than `k` rows pass the filter, the remaining neighbors of every query are set to
+ * `std::numeric_limits<IdxT>::max()`, with the worst distance of the metric.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   auto index = brute_force::build(res, dataset, raft::distance::DistanceType::L2Expanded);
+ *   // the rows of a tenant
+ *   raft::core::bitset<uint32_t, int64_t> filter(res, tenant_rows.view(), index.size());
+ *   brute_force::search_with_filtering(res, index, queries, neighbors, distances, filter.view());
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res raft resources
+ * @param[in] idx brute force index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors [n_queries,
+ * k]
+ * @param[in] filter a bitset of `idx.size()` bits, set for the rows that may be returned
+ */
+template <typename T, typename IdxT>
+void search_with_filtering(raft::resources const& res,
+                           const index<T>& idx,
+                           raft::device_matrix_view<const T, int64_t, row_major> queries,
+                           raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                           raft::device_matrix_view<T, int64_t, row_major> distances,
+                           raft::core::bitset_view<const uint32_t, int64_t> filter)
+{
+  raft::neighbors::detail::brute_force_search_prefiltered<T, IdxT>(
+    res, idx, queries, neighbors, distances, filter);
+}
+
+/**
+ * @brief Brute Force search of a half-precision index.
+ *
+ * The distances are computed with fp16 inputs and fp32 accumulation (on the tensor cores) and
+ * returned in fp32. Only the L2Expanded, L2SqrtExpanded, InnerProduct and CosineExpanded metrics
+ * are supported. The norms of the dataset are precomputed in fp32 by `build`.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   // dataset: [n_rows, dim] half-precision matrix
+ *   auto index = brute_force::build(res, dataset, raft::distance::DistanceType::InnerProduct);
+ *   auto neighbors = raft::make_device_matrix<int64_t, int64_t>(res, n_queries, k);
+ *   auto distances = raft::make_device_matrix<float, int64_t>(res, n_queries, k);
+ *   brute_force::search(res, index, queries, neighbors.view(), distances.view());
+ * @endcode
+ *
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res raft resources
+ * @param[in] idx brute force index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors [n_queries,
+ * k]
+ */
+template <typename IdxT>
+void search(raft::resources const& res,
+            const index<half>& idx,
+            raft::device_matrix_view<const half, int64_t, row_major> queries,
+            raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+            raft::device_matrix_view<float, int64_t, row_major> distances)
+{
+  raft::neighbors::detail::brute_force_search_half<IdxT>(res, idx, queries, neighbors, distances);
+}
+
+/**
+ * @brief Brute Force search of a half-precision index.
+ *
+ * See the overload without search parameters for details.
+ *
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res raft resources
+ * @param[in] params configure the search
+ * @param[in] idx brute force index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors [n_queries,
+ * k]
+ */
+template <typename IdxT>
+void search(raft::resources const& res,
+            search_params const& params,
+            const index<half>& idx,
+            raft::device_matrix_view<const half, int64_t, row_major> queries,
+            raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+            raft::device_matrix_view<float, int64_t, row_major> distances)
+{
+  raft::neighbors::detail::brute_force_search_half<IdxT>(res, idx, queries, neighbors, distances);
+}
+
 /** @} */  // end group brute_force_knn
 }  // namespace raft::neighbors::brute_force
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -164,17 +164,13 @@ auto deserialize(raft::resources const& handle, std::istream& is)
     deserialize_mdspan(handle, is, dataset_storage.view());
   }
 
-  auto has_norms     = deserialize_scalar<bool>(handle, is);
-  auto norms_storage = has_norms ? std::optional{raft::make_host_vector<T, std::int64_t>(rows)}
-                                 : std::optional<raft::host_vector<T, std::int64_t>>{};
-  // TODO(wphicks): Use mdbuffer here when available
+  auto has_norms  = deserialize_scalar<bool>(handle, is);
+  using norm_type = typename index<T>::norm_type;
+  // the norms are streamed to the device through the chunked serializer
   auto norms_storage_dev =
-    has_norms ? std::optional{raft::make_device_vector<T, std::int64_t>(handle, rows)}
-              : std::optional<raft::device_vector<T, std::int64_t>>{};
-  if (has_norms) {
-    deserialize_mdspan(handle, is, norms_storage->view());
-    raft::copy(handle, norms_storage_dev->view(), norms_storage->view());
-  }
+    has_norms ? std::optional{raft::make_device_vector<norm_type, std::int64_t>(handle, rows)}
+              : std::optional<raft::device_vector<norm_type, std::int64_t>>{};
+  if (has_norms) { deserialize_mdspan(handle, is, norms_storage_dev->view()); }
 
   auto result = index(handle,
                       raft::make_const_mdspan(dataset_storage.view()),
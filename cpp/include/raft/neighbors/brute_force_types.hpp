@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -30,6 +30,10 @@
 
 #include <raft/core/logger.hpp>
 
+#include <cuda_fp16.h>
+
+#include <type_traits>
+
 namespace raft::neighbors::brute_force {
 /**
  * @addtogroup brute_force_knn
@@ -49,6 +53,9 @@ using ann::search_params;
 template <typename T>
 struct index : ann::index {
  public:
+  /** The type of the dataset norms: the norms of a half-precision dataset are kept in fp32. */
+  using norm_type = std::conditional_t<std::is_same_v<T, half>, float, T>;
+
   /** Distance metric used for retrieval */
   [[nodiscard]] constexpr inline raft::distance::DistanceType metric() const noexcept
   {
@@ -69,7 +76,8 @@ struct index : ann::index {
   }
 
   /** Dataset norms */
-  [[nodiscard]] inline auto norms() const -> device_vector_view<const T, int64_t, row_major>
+  [[nodiscard]] inline auto norms() const
+    -> device_vector_view<const norm_type, int64_t, row_major>
   {
     return norms_view_.value();
   }
@@ -98,7 +106,7 @@ struct index : ann::index {
   template <typename data_accessor>
   index(raft::resources const& res,
         mdspan<const T, matrix_extent<int64_t>, row_major, data_accessor> dataset,
-        std::optional<raft::device_vector<T, int64_t>>&& norms,
+        std::optional<raft::device_vector<norm_type, int64_t>>&& norms,
         raft::distance::DistanceType metric,
         T metric_arg = 0.0)
     : ann::index(),
@@ -119,7 +127,7 @@ struct index : ann::index {
    */
   index(raft::resources const& res,
         raft::device_matrix_view<const T, int64_t, row_major> dataset_view,
-        std::optional<raft::device_vector_view<const T, int64_t>> norms_view,
+        std::optional<raft::device_vector_view<const norm_type, int64_t>> norms_view,
         raft::distance::DistanceType metric,
         T metric_arg = 0.0)
     : ann::index(),
@@ -135,7 +143,7 @@ struct index : ann::index {
   index(raft::resources const& res,
         index_params const& params,
         mdspan<const T, matrix_extent<int64_t>, row_major, data_accessor> dataset,
-        std::optional<raft::device_vector<T, int64_t>>&& norms = std::nullopt)
+        std::optional<raft::device_vector<norm_type, int64_t>>&& norms = std::nullopt)
     : ann::index(),
       metric_(params.metric),
       dataset_(make_device_matrix<T, int64_t>(res, 0, 0)),
@@ -172,8 +180,8 @@ struct index : ann::index {
  private:
   raft::distance::DistanceType metric_;
   raft::device_matrix<T, int64_t, row_major> dataset_;
-  std::optional<raft::device_vector<T, int64_t>> norms_;
-  std::optional<raft::device_vector_view<const T, int64_t>> norms_view_;
+  std::optional<raft::device_vector<norm_type, int64_t>> norms_;
+  std::optional<raft::device_vector_view<const norm_type, int64_t>> norms_view_;
   raft::device_matrix_view<const T, int64_t, row_major> dataset_view_;
   T metric_arg_;
 };
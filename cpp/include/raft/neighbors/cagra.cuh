@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,10 +16,17 @@
 
 #pragma once
 
+#include "detail/cagra/add_nodes.cuh"
 #include "detail/cagra/cagra_build.cuh"
 #include "detail/cagra/cagra_search.cuh"
+#include "detail/cagra/entry_points.cuh"
+#include "detail/cagra/filtered_search.cuh"
 #include "detail/cagra/graph_core.cuh"
+#include "detail/cagra/hnswlib_import.cuh"
+#include "detail/cagra/range_search.cuh"
+#include "detail/cagra/remove_nodes.cuh"
 
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/host_device_accessor.hpp>
 #include <raft/core/mdspan.hpp>
@@ -27,6 +34,8 @@
 #include <raft/neighbors/cagra_types.hpp>
 #include <rmm/cuda_stream_view.hpp>
 
+#include <vector>
+
 namespace raft::neighbors::cagra {
 
 /**
@@ -44,8 +53,9 @@ namespace raft::neighbors::cagra {
  *
  * See [cagra::build](#cagra::build) for an alternative method.
  *
- * The following distance metrics are supported:
+ * The following distance metrics are supported (set in `build_params`):
  * - L2Expanded
+ * - InnerProduct
  *
  * Usage example:
  * @code{.cpp}
@@ -227,6 +237,76 @@ void optimize(raft::resources const& res,
   detail::optimize(res, knn_graph, new_graph);
 }
 
+/**
+ * @brief Prune a KNN graph, with control over the memory footprint.
+ *
+ * The nodes are pruned in batches of `params.prune_batch_size` and their reverse edges are
+ * collected in passes over ranges of `params.reverse_batch_size` nodes, hence the device memory
+ * used besides the input graph is bounded by the parameters rather than by the graph size. With
+ * `graph_placement::HOST` (chosen by `AUTO` when the graph does not fit into half of the free
+ * device memory), the input graph itself stays in the host memory and is read by the device over
+ * the interconnect.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   cagra::optimize_params params;
+ *   params.input_graph_placement = cagra::graph_placement::HOST;
+ *   auto optimized_graph = raft::make_host_matrix<IdxT, int64_t>(n_rows, 64);
+ *   cagra::optimize(res, knn_graph.view(), optimized_graph.view(), params);
+ * @endcode
+ *
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resources
+ * @param[in] knn_graph a host matrix view of the input knn graph [n_rows, knn_graph_degree]
+ * @param[out] new_graph a host matrix view of the optimized knn graph [n_rows, graph_degree]
+ * @param[in] params the memory parameters of the optimization
+ */
+template <typename IdxT = uint32_t>
+void optimize(raft::resources const& res,
+              raft::host_matrix_view<IdxT, int64_t, row_major> knn_graph,
+              raft::host_matrix_view<IdxT, int64_t, row_major> new_graph,
+              const optimize_params& params)
+{
+  detail::optimize(res, knn_graph, new_graph, params);
+}
+
+/**
+ * @brief Prune a KNN graph on several GPUs.
+ *
+ * The nodes are split into `devices.size()` contiguous ranges and every device prunes its range
+ * and collects the reverse edges of its range, concurrently, one host thread per device, using the
+ * resources provided by `raft::device_resources_manager` for that device. Every device reads the
+ * whole input graph: it is copied to every device if it fits (see `optimize_params`), otherwise
+ * it is page-locked once and shared by all of them. The final replacement of the edges by reverse
+ * edges runs on the host.
+ *
+ * The result is equivalent to that of the single-GPU `cagra::optimize`.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   auto optimized_graph = raft::make_host_matrix<IdxT, int64_t>(n_rows, 64);
+ *   cagra::optimize(cagra::optimize_params{}, knn_graph.view(), optimized_graph.view(), {0, 1});
+ * @endcode
+ *
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] params the memory parameters of the optimization, applied on every device
+ * @param[in] knn_graph a host matrix view of the input knn graph [n_rows, knn_graph_degree]
+ * @param[out] new_graph a host matrix view of the optimized knn graph [n_rows, graph_degree]
+ * @param[in] devices the CUDA devices to use
+ */
+template <typename IdxT = uint32_t>
+void optimize(const optimize_params& params,
+              raft::host_matrix_view<IdxT, int64_t, row_major> knn_graph,
+              raft::host_matrix_view<IdxT, int64_t, row_major> new_graph,
+              const std::vector<int>& devices)
+{
+  detail::optimize<IdxT>(params, knn_graph, new_graph, devices);
+}
+
 /**
  * @brief Build the index from the dataset for efficient search.
  *
@@ -234,14 +314,29 @@ void optimize(raft::resources const& res,
  * create the final graph. The index_params struct controls the node degree of these
  * graphs.
  *
- * It is required that dataset and the optimized graph fit the GPU memory.
+ * It is required that the optimized graph fits the GPU memory. By default the dataset is copied to
+ * the GPU as well; set `index_params::attach_dataset_on_build = false` to get an index that holds
+ * only the graph, and supply the vectors afterwards, e.g. in pinned host memory:
+ * @code{.cpp}
+ *   cagra::index_params index_params;
+ *   index_params.attach_dataset_on_build = false;
+ *   // host_dataset is a host_matrix_view to memory allocated with cudaMallocHost or registered
+ *   // with cudaHostRegister
+ *   auto index = cagra::build(res, index_params, host_dataset);
+ *   // the search kernels read the vectors directly from host memory
+ *   index.attach_host_dataset(res, host_dataset);
+ * @endcode
  *
  * To customize the parameters for knn-graph building and pruning, and to reuse the
  * intermediate results, you could build the index in two steps using
  * [cagra::build_knn_graph](#cagra::build_knn_graph) and [cagra::optimize](#cagra::optimize).
  *
  * The following distance metrics are supported:
- * - L2
+ * - L2Expanded
+ * - InnerProduct (with the IVF-PQ graph build only); the distances are the inner products, sorted
+ *   in descending order
+ * - CosineExpanded; the kNN graph is built from a normalized float copy of the dataset, in the
+ *   memory of the dataset, and the index keeps the norms of the dataset rows for the search
  *
  * Usage example:
  * @code{.cpp}
@@ -278,6 +373,205 @@ index<T, IdxT> build(raft::resources const& res,
   return detail::build<T, IdxT, Accessor>(res, params, dataset);
 }
 
+/**
+ * @brief Import an hnswlib index as a CAGRA index, without building the graph again.
+ *
+ * The vectors and the base layer of the hnswlib index (as saved by `HierarchicalNSW::saveIndex`)
+ * make the dataset and the graph of the CAGRA index; the upper layers are ignored. The neighbor
+ * lists are padded to a fixed degree with the neighbors of the neighbors and sorted by the L2
+ * distance (of the normalized vectors for CosineExpanded); then every node keeps its
+ * `params.graph_degree` first neighbors, or, with `params.optimize`, the lists are pruned by
+ * `cagra::optimize`. The elements marked as deleted in the hnswlib index are removed from the
+ * CAGRA index (see `cagra::remove`).
+ *
+ * The nodes of the CAGRA index are the elements in the order of the file; the search returns
+ * these positions, which `labels` maps to the labels (external ids) of hnswlib.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   cagra::hnswlib_import_params params;
+ *   params.graph_degree = 32;
+ *   params.optimize     = true;
+ *   raft::host_vector<uint64_t, int64_t> labels = raft::make_host_vector<uint64_t, int64_t>(0);
+ *   auto index = cagra::from_hnswlib<float, uint32_t>(res, "/path/to/hnswlib/index", params,
+ *                                                     &labels);
+ *   cagra::search(res, search_params, index, queries, neighbors, distances);
+ * @endcode
+ *
+ * @tparam T data element type of the hnswlib index
+ * @tparam IdxT type of the indices of the CAGRA graph
+ *
+ * @param[in] res raft resources
+ * @param[in] is the input stream of the hnswlib index
+ * @param[in] params the parameters of the import
+ * @param[out] labels if not null, set to the hnswlib labels of the nodes [n_rows]
+ *
+ * @return the CAGRA index
+ */
+template <typename T, typename IdxT = uint32_t>
+auto from_hnswlib(raft::resources const& res,
+                  std::istream& is,
+                  const hnswlib_import_params& params         = hnswlib_import_params{},
+                  raft::host_vector<uint64_t, int64_t>* labels = nullptr) -> index<T, IdxT>
+{
+  return detail::from_hnswlib<T, IdxT>(res, is, params, labels);
+}
+
+/**
+ * @brief Import an hnswlib index from a file as a CAGRA index; see the stream overload.
+ *
+ * @tparam T data element type of the hnswlib index
+ * @tparam IdxT type of the indices of the CAGRA graph
+ *
+ * @param[in] res raft resources
+ * @param[in] filename the file of the hnswlib index
+ * @param[in] params the parameters of the import
+ * @param[out] labels if not null, set to the hnswlib labels of the nodes [n_rows]
+ *
+ * @return the CAGRA index
+ */
+template <typename T, typename IdxT = uint32_t>
+auto from_hnswlib(raft::resources const& res,
+                  const std::string& filename,
+                  const hnswlib_import_params& params         = hnswlib_import_params{},
+                  raft::host_vector<uint64_t, int64_t>* labels = nullptr) -> index<T, IdxT>
+{
+  return detail::from_hnswlib<T, IdxT>(res, filename, params, labels);
+}
+
+/**
+ * @brief Add new vectors to a CAGRA index without rebuilding the graph.
+ *
+ * The neighbors of each new vector are found by searching the current index. The candidate
+ * list is pruned with the same rank-based (2-hop detour) criterion as `cagra::optimize`, and
+ * reverse edges are inserted into the adjacency lists of the closest existing nodes. Only the
+ * rows of the graph affected by the insertion are modified, so the cost scales with the number of
+ * added vectors rather than the size of the index.
+ *
+ * The extended index owns a device copy of the whole dataset and graph. The graph quality of
+ * repeatedly extended indices is lower than that of a freshly built index; rebuild the index once
+ * a large fraction of it was added with `extend`.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   auto index = cagra::build(res, cagra::index_params{}, dataset);
+ *   // add new vectors [n_new, dim] to the index
+ *   cagra::extend(res, cagra::extend_params{}, raft::make_const_mdspan(new_vectors.view()), index);
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ * @tparam Accessor host or device accessor type of the new vectors
+ *
+ * @param[in] res raft resources
+ * @param[in] params extension parameters
+ * @param[in] additional_dataset a matrix view (host or device) to a row-major matrix
+ * [n_new_rows, dim]
+ * @param[inout] idx the index to extend
+ */
+template <typename T,
+          typename IdxT,
+          typename Accessor =
+            host_device_accessor<std::experimental::default_accessor<T>, memory_type::device>>
+void extend(raft::resources const& res,
+            const extend_params& params,
+            mdspan<const T, matrix_extent<int64_t>, row_major, Accessor> additional_dataset,
+            index<T, IdxT>& idx)
+{
+  detail::extend<T, IdxT, Accessor>(res, params, additional_dataset, idx);
+}
+
+/**
+ * @brief Remove vectors from a CAGRA index.
+ *
+ * The nodes are only marked as removed in a bitset of the index (a tombstone), which costs
+ * O(ids.extent(0)). `cagra::search` and `cagra::search_with_filtering` still traverse the removed
+ * nodes to navigate the graph, but never return them. Call `cagra::compact` to drop them from the
+ * dataset and the graph and reclaim their memory.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   auto index = cagra::build(res, cagra::index_params{}, dataset);
+ *   cagra::remove(res, index, raft::make_const_mdspan(removed_ids.view()));
+ *   cagra::search(res, search_params, index, queries, neighbors, distances);
+ *   // rows of the compacted index -> ids before compaction
+ *   auto old_ids = cagra::compact(res, index);
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resources
+ * @param[inout] idx the index
+ * @param[in] ids a device vector view to the ids of the nodes to remove; ids removed before are
+ * ignored, all of them must be smaller than `idx.size()`
+ */
+template <typename T, typename IdxT>
+void remove(raft::resources const& res,
+            index<T, IdxT>& idx,
+            raft::device_vector_view<const IdxT, int64_t> ids)
+{
+  detail::remove<T, IdxT>(res, idx, ids);
+}
+
+/**
+ * @brief Drop the removed nodes from a CAGRA index.
+ *
+ * The remaining nodes are renumbered in order, `[0, idx.size() - idx.n_removed())`. In the
+ * neighbor list of every remaining node, the removed neighbors are replaced by their own
+ * remaining neighbors, so that the graph stays connected without a rebuild. The index then owns a
+ * device copy of the compacted dataset and graph. The entry points, if any, are selected again.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resources
+ * @param[inout] idx the index
+ *
+ * @return the id before compaction of every node of the compacted index
+ */
+template <typename T, typename IdxT>
+auto compact(raft::resources const& res, index<T, IdxT>& idx) -> raft::device_vector<IdxT, int64_t>
+{
+  return detail::compact<T, IdxT>(res, idx);
+}
+
+/**
+ * @brief Select the entry points of the search of a CAGRA index (see `index::entry_points`).
+ *
+ * This is done by `cagra::build` when `index_params::n_entry_points > 0`; call it to add entry
+ * points to an existing (e.g. deserialized or extended) index, or to change their number. The
+ * centroids of a balanced k-means clustering of a subsample of the dataset are snapped to their
+ * nearest dataset rows, which the search then evaluates before the random seeds.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   auto index = cagra::build(res, cagra::index_params{}, dataset);
+ *   cagra::build_entry_points(res, index, 64);
+ *   cagra::search(res, search_params, index, queries, neighbors, distances);
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resources
+ * @param[inout] idx the index, with its dataset attached
+ * @param[in] n_entry_points the number of entry points, at most `idx.size()`; 0 removes them
+ */
+template <typename T, typename IdxT>
+void build_entry_points(raft::resources const& res, index<T, IdxT>& idx, uint32_t n_entry_points)
+{
+  if (n_entry_points == 0) {
+    idx.update_entry_points(res, raft::make_device_vector<IdxT, int64_t>(res, 0));
+    return;
+  }
+  idx.update_entry_points(res, detail::make_entry_points<T, IdxT>(res, idx, n_entry_points));
+}
+
 /**
  * @brief Search ANN using the constructed index.
  *
@@ -322,6 +616,19 @@ void search(raft::resources const& res,
   auto distances_internal = raft::make_device_matrix_view<float, int64_t, row_major>(
     distances.data_handle(), distances.extent(0), distances.extent(1));
 
+  if (idx.n_removed() > 0) {
+    cagra::detail::search_main<T,
+                               internal_IdxT,
+                               raft::neighbors::filtering::removed_cagra_sample_filter,
+                               IdxT>(res,
+                                     params,
+                                     idx,
+                                     queries_internal,
+                                     neighbors_internal,
+                                     distances_internal,
+                                     idx.removed_filter());
+    return;
+  }
   cagra::detail::search_main<T,
                              internal_IdxT,
                              decltype(raft::neighbors::filtering::none_cagra_sample_filter()),
@@ -337,6 +644,12 @@ void search(raft::resources const& res,
 /**
  * @brief Search ANN using the constructed index with the given sample filter.
  *
+ * Nodes rejected by the filter are still visited to navigate the graph, but they are never
+ * returned. To keep enough valid candidates, the internal top-k buffer is enlarged according to
+ * `params.filtering_rate`, which is computed automatically for a `filtering::bitset_filter`. When
+ * a bitset filter passes less than `params.filter_brute_force_threshold` of the rows, the search
+ * falls back to an exact brute-force search over these rows.
+ *
  * Usage example:
  * @code{.cpp}
  *   using namespace raft::neighbors;
@@ -400,10 +713,244 @@ void search_with_filtering(raft::resources const& res,
   auto distances_internal = raft::make_device_matrix_view<float, int64_t, row_major>(
     distances.data_handle(), distances.extent(0), distances.extent(1));
 
-  cagra::detail::search_main<T, internal_IdxT, CagraSampleFilterT, IdxT>(
+  if (idx.n_removed() > 0) {
+    using removed_and_filter_t =
+      raft::neighbors::filtering::removed_and_cagra_sample_filter<CagraSampleFilterT>;
+    cagra::detail::search_filtered_main<T, internal_IdxT, removed_and_filter_t, IdxT>(
+      res,
+      params,
+      idx,
+      queries_internal,
+      neighbors_internal,
+      distances_internal,
+      removed_and_filter_t{idx.removed_filter(), sample_filter});
+    return;
+  }
+  cagra::detail::search_filtered_main<T, internal_IdxT, CagraSampleFilterT, IdxT>(
     res, params, idx, queries_internal, neighbors_internal, distances_internal, sample_filter);
 }
 
+/**
+ * @brief A search plan that can be reused by many searches.
+ *
+ * Every `cagra::search` call selects the search kernels and allocates their workspace (hashmaps,
+ * intermediate top-k buffers) for the given parameters. When the same parameters are used
+ * repeatedly, create a plan once and pass it to `cagra::search` to skip this setup. The plan
+ * handles any number of queries, processing them in batches of up to `params.max_queries`.
+ *
+ * A plan must be used with the index it was created for (or another index of the same dim and
+ * graph degree) and exactly `k` neighbors. Searches sharing a plan share its workspace, so they
+ * must be ordered on a single CUDA stream.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   cagra::search_params search_params;
+ *   search_params.max_queries = 1024;
+ *   cagra::search_plan<float, uint32_t> plan(res, search_params, index, k);
+ *   for (auto& batch : query_batches) {
+ *     cagra::search(res, plan, index, batch.queries, batch.neighbors, batch.distances);
+ *   }
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ * @tparam CagraSampleFilterT the sample filter type used with `search_with_filtering`
+ */
+template <typename T,
+          typename IdxT,
+          typename CagraSampleFilterT = raft::neighbors::filtering::none_cagra_sample_filter>
+class search_plan {
+  using internal_IdxT = typename std::make_unsigned<IdxT>::type;
+  using filter_type =
+    typename cagra::detail::CagraSampleFilterT_Selector<CagraSampleFilterT>::type;
+
+ public:
+  using impl_type = cagra::detail::search_plan_impl<T, internal_IdxT, float, filter_type>;
+
+  /**
+   * @brief Select the kernels and allocate the workspace of the search.
+   *
+   * @param[in] res raft resources
+   * @param[in] params configure the search; `params.max_queries` must be set to the batch size
+   * @param[in] idx cagra index
+   * @param[in] k number of neighbors searched for every query
+   */
+  search_plan(raft::resources const& res,
+              const search_params& params,
+              const index<T, IdxT>& idx,
+              uint32_t k)
+  {
+    RAFT_EXPECTS(params.max_queries > 0,
+                 "search_params::max_queries must be set when creating a search plan");
+    impl_ = cagra::detail::factory<T, internal_IdxT, float, filter_type>::create(
+      res, params, idx.dim(), idx.graph_degree(), k);
+    impl_->check(k);
+  }
+
+  /** Number of neighbors searched for every query. */
+  [[nodiscard]] auto k() const noexcept -> uint32_t { return impl_->topk; }
+  /** Maximum number of queries searched at the same time. */
+  [[nodiscard]] auto max_queries() const noexcept -> uint32_t { return impl_->max_queries; }
+  /** The underlying plan used by `cagra::search`. */
+  [[nodiscard]] auto impl() noexcept -> impl_type& { return *impl_; }
+
+ private:
+  std::unique_ptr<impl_type> impl_;
+};
+
+/**
+ * @brief Search ANN using the constructed index, a search plan and the given sample filter.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ * @tparam CagraSampleFilterT Device filter function, with the signature
+ *         `(uint32_t query ix, uint32_t sample_ix) -> bool`
+ *
+ * @param[in] res raft resources
+ * @param[in] plan a search plan created for `idx`
+ * @param[in] idx cagra index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors [n_queries,
+ * k]
+ * @param[in] sample_filter a device filter function that greenlights samples for a given query
+ */
+template <typename T, typename IdxT, typename CagraSampleFilterT>
+void search_with_filtering(raft::resources const& res,
+                           search_plan<T, IdxT, CagraSampleFilterT>& plan,
+                           const index<T, IdxT>& idx,
+                           raft::device_matrix_view<const T, int64_t, row_major> queries,
+                           raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                           raft::device_matrix_view<float, int64_t, row_major> distances,
+                           CagraSampleFilterT sample_filter = CagraSampleFilterT())
+{
+  RAFT_EXPECTS(
+    queries.extent(0) == neighbors.extent(0) && queries.extent(0) == distances.extent(0),
+    "Number of rows in output neighbors and distances matrices must equal the number of queries.");
+
+  RAFT_EXPECTS(neighbors.extent(1) == distances.extent(1),
+               "Number of columns in output neighbors and distances matrices must equal k");
+  RAFT_EXPECTS(queries.extent(1) == idx.dim(),
+               "Number of query dimensions should equal number of dimensions in the index.");
+
+  using internal_IdxT   = typename std::make_unsigned<IdxT>::type;
+  auto queries_internal = raft::make_device_matrix_view<const T, int64_t, row_major>(
+    queries.data_handle(), queries.extent(0), queries.extent(1));
+  auto neighbors_internal = raft::make_device_matrix_view<internal_IdxT, int64_t, row_major>(
+    reinterpret_cast<internal_IdxT*>(neighbors.data_handle()),
+    neighbors.extent(0),
+    neighbors.extent(1));
+  auto distances_internal = raft::make_device_matrix_view<float, int64_t, row_major>(
+    distances.data_handle(), distances.extent(0), distances.extent(1));
+
+  RAFT_EXPECTS(idx.n_removed() == 0,
+               "Search plans do not skip removed nodes; call cagra::compact first or search "
+               "without a plan");
+  RAFT_EXPECTS(
+    std::is_same_v<CagraSampleFilterT, raft::neighbors::filtering::none_cagra_sample_filter> ||
+      idx.source_indices().extent(0) == 0,
+    "Search plans do not filter the dataset rows of a reordered index; search without a plan");
+
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::search_with_plan(max_queries = %u, k = %u, dim = %zu)",
+    plan.max_queries(),
+    plan.k(),
+    idx.dim());
+  cagra::detail::search_with_plan<T, internal_IdxT, CagraSampleFilterT, IdxT>(res,
+                                                                              plan.impl(),
+                                                                              idx,
+                                                                              queries_internal,
+                                                                              neighbors_internal,
+                                                                              distances_internal,
+                                                                              sample_filter);
+}
+
+/**
+ * @brief Search ANN using the constructed index and a search plan.
+ *
+ * The results are the same as those of `cagra::search` with the parameters of the plan.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res raft resources
+ * @param[in] plan a search plan created for `idx`
+ * @param[in] idx cagra index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors [n_queries,
+ * k]
+ */
+template <typename T, typename IdxT>
+void search(raft::resources const& res,
+            search_plan<T, IdxT>& plan,
+            const index<T, IdxT>& idx,
+            raft::device_matrix_view<const T, int64_t, row_major> queries,
+            raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+            raft::device_matrix_view<float, int64_t, row_major> distances)
+{
+  search_with_filtering(res,
+                        plan,
+                        idx,
+                        queries,
+                        neighbors,
+                        distances,
+                        raft::neighbors::filtering::none_cagra_sample_filter());
+}
+
+/**
+ * @brief Search all the neighbors of the queries within a radius.
+ *
+ * The results are written into a sparsity-owning CSR matrix of the shape [n_queries, idx.size()]:
+ * the row offsets delimit the neighborhood of every query, the column indices are the neighbor ids
+ * and the elements are their distances, sorted by rank within every row.
+ *
+ * The search uses the kernels of `cagra::search`: the queries are searched for
+ * `params.initial_k` neighbors first, and the queries whose results are all within the radius are
+ * searched again for twice as many, until the worst result of every query leaves the radius or
+ * `params.max_k` is reached. Hence a neighborhood larger than `params.max_k` is truncated to its
+ * `max_k` nearest (approximate) neighbors. The neighborhoods are counted first, then the CSR matrix
+ * is allocated and filled in.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   auto index = cagra::build(res, cagra::index_params{}, dataset);
+ *   cagra::range_search_params params;
+ *   params.max_k = 256;
+ *   auto result = raft::make_device_csr_matrix<float, int64_t, uint32_t, int64_t>(
+ *     res, queries.extent(0), uint32_t(index.size()));
+ *   cagra::range_search(res, params, index, queries, radius, result);
+ *   // result.structure_view().get_indptr() / get_indices() and result.get_elements()
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res raft resources
+ * @param[in] params configure the search
+ * @param[in] idx cagra index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[in] radius the radius, in the units of the distances returned by `cagra::search` (squared
+ * for L2Expanded); for InnerProduct, the minimum similarity of the neighbors
+ * @param[out] result the neighborhoods [n_queries, idx.size()]; its sparsity is initialized by
+ * this function
+ */
+template <typename T, typename IdxT>
+void range_search(raft::resources const& res,
+                  const range_search_params& params,
+                  const index<T, IdxT>& idx,
+                  raft::device_matrix_view<const T, int64_t, row_major> queries,
+                  float radius,
+                  raft::device_csr_matrix<float, int64_t, IdxT, int64_t>& result)
+{
+  using internal_IdxT = typename std::make_unsigned<IdxT>::type;
+  cagra::detail::range_search<T, internal_IdxT, IdxT>(res, params, idx, queries, radius, result);
+}
+
 /** @} */  // end group cagra
 
 }  // namespace raft::neighbors::cagra
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/cagra/cagra_ipc.cuh"
+
+namespace raft::neighbors::cagra {
+
+/**
+ * \defgroup cagra_ipc CAGRA index sharing across processes
+ * @{
+ */
+
+/**
+ * Move the index into a device allocation that other processes of the node can map.
+ *
+ * The dataset, the graph and the small arrays of the index are copied into a single `cudaMalloc`
+ * allocation, the index is re-pointed to it (its own copies are released) and keeps the
+ * allocation alive. Send the returned handle to the other processes and map the index there with
+ * `import_ipc`; the exporting index must outlive all of them.
+ *
+ * Experimental, the handle layout is subject to change.
+ *
+ * @code{.cpp}
+ * #include <raft/neighbors/cagra_ipc.cuh>
+ *
+ * // in the process that built the index
+ * auto handle = raft::neighbors::cagra::export_ipc(res, index);
+ * write(fd, &handle, sizeof(handle));
+ *
+ * // in the other processes
+ * raft::neighbors::cagra::ipc_handle handle;
+ * read(fd, &handle, sizeof(handle));
+ * auto shared = raft::neighbors::cagra::import_ipc<float, uint32_t>(res, handle);
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res the raft resources
+ * @param[inout] idx a device-resident index with an uncompressed graph and no removed nodes
+ *
+ * @return the handle describing the shared allocation
+ */
+template <typename T, typename IdxT>
+auto export_ipc(raft::resources const& res, index<T, IdxT>& idx) -> ipc_handle
+{
+  return detail::export_ipc<T, IdxT>(res, idx);
+}
+
+/**
+ * Map an index exported by another process with `export_ipc`.
+ *
+ * The dataset and the graph are used in place, read-only: the returned index holds the mapping
+ * (see `index::external_storage`) and unmaps it when destroyed. The norms, entry points and source
+ * indices are copied.
+ *
+ * @tparam T data element type, as in the exporting process
+ * @tparam IdxT type of the indices, as in the exporting process
+ *
+ * @param[in] res the raft resources
+ * @param[in] handle the handle received from the exporting process
+ *
+ * @return the shared index
+ */
+template <typename T, typename IdxT>
+auto import_ipc(raft::resources const& res, const ipc_handle& handle) -> index<T, IdxT>
+{
+  return detail::import_ipc<T, IdxT>(res, handle);
+}
+
+/**@}*/
+
+}  // namespace raft::neighbors::cagra
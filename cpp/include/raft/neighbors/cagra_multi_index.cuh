@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/cagra/cagra_search.cuh"
+#include "detail/cagra/dataset_norms.cuh"
+#include "detail/cagra/factory.cuh"
+#include "detail/cagra/search_plan.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_properties.hpp>
+#include <raft/core/resource/metrics.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/sample_filter_types.hpp>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace raft::neighbors::cagra {
+
+/**
+ * @defgroup cagra_multi_index CAGRA batched search over many small indices
+ * @{
+ */
+
+/**
+ * @brief Many CAGRA indices packed into shared device arenas.
+ *
+ * Searching thousands of small indices (e.g. one per tenant) with a `cagra::search` call each is
+ * bound by the kernel launches and leaves the GPU mostly idle. A multi-index copies the datasets
+ * and graphs of the indices into one dataset arena and one graph arena, so that
+ * `cagra::search_multi_index` serves a batch of queries against any mix of the indices with a
+ * single launch of the single-CTA search kernel; every thread block looks up the rows of the
+ * index of its query.
+ *
+ * The packed indices must have the same dimensionality, graph degree and metric, and their graphs
+ * must not be compressed. The neighbor ids stay relative to the individual indices; the multi-index
+ * does not reference the source indices after the construction.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   std::vector<const cagra::index<float, uint32_t>*> tenants = ...;
+ *   cagra::multi_index<float, uint32_t> arena(res, tenants);
+ *   // index_ids[i] is the position in `tenants` of the index searched by the query i
+ *   cagra::search_multi_index(res, search_params, arena, queries, index_ids, neighbors, distances);
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source datasets
+ */
+template <typename T, typename IdxT>
+class multi_index {
+ public:
+  /**
+   * @brief Pack the datasets and graphs of the indices into the arenas.
+   *
+   * @param[in] res raft resources
+   * @param[in] indices the indices to pack; the index `i` is selected by the id `i` in the search
+   */
+  multi_index(raft::resources const& res, const std::vector<const index<T, IdxT>*>& indices)
+    : metric_(raft::distance::DistanceType::L2Expanded),
+      offsets_(raft::make_device_vector<int64_t, int64_t>(res, 0)),
+      dataset_(raft::make_device_matrix<T, int64_t>(res, 0, 0)),
+      graph_(raft::make_device_matrix<IdxT, int64_t>(res, 0, 0)),
+      dataset_norms_(raft::make_device_vector<float, int64_t>(res, 0))
+  {
+    common::nvtx::range<common::nvtx::domain::raft> fun_scope("cagra::multi_index(%zu indices)",
+                                                              indices.size());
+    RAFT_EXPECTS(!indices.empty(), "At least one index is required");
+    RAFT_EXPECTS(indices.size() <= std::numeric_limits<uint32_t>::max(), "Too many indices");
+    const auto& first = *indices.front();
+    dim_              = first.dim();
+    graph_degree_     = first.graph_degree();
+    metric_           = first.metric();
+
+    std::vector<int64_t> offsets(indices.size() + 1, 0);
+    for (size_t i = 0; i < indices.size(); i++) {
+      const auto& idx = *indices[i];
+      RAFT_EXPECTS(idx.dim() == dim_ && idx.graph_degree() == graph_degree_,
+                   "The index %zu has a different dim or graph degree than the first index",
+                   i);
+      RAFT_EXPECTS(idx.metric() == metric_, "The index %zu has a different metric", i);
+      RAFT_EXPECTS(idx.size() > 0, "The index %zu is empty", i);
+      RAFT_EXPECTS(idx.dataset().extent(0) == static_cast<int64_t>(idx.size()),
+                   "The dataset of the index %zu must be attached",
+                   i);
+      RAFT_EXPECTS(idx.graph_bits() == 0,
+                   "The graph of the index %zu is compressed; call decompress_graph first",
+                   i);
+      RAFT_EXPECTS(idx.n_removed() == 0,
+                   "The index %zu has removed nodes; call cagra::compact first",
+                   i);
+      offsets[i + 1] = offsets[i] + idx.size();
+    }
+    const int64_t n_rows = offsets.back();
+
+    auto stream = resource::get_cuda_stream(res);
+    offsets_    = raft::make_device_vector<int64_t, int64_t>(res, offsets.size());
+    raft::copy(offsets_.data_handle(), offsets.data(), offsets.size(), stream);
+
+    // The rows are padded to 16 bytes, as in the index (see detail::copy_with_padding).
+    const int64_t padded_dim = raft::round_up_safe<size_t>(dim_ * sizeof(T), 16) / sizeof(T);
+    dataset_ = raft::make_device_matrix<T, int64_t>(res, n_rows, padded_dim);
+    graph_   = raft::make_device_matrix<IdxT, int64_t>(res, n_rows, graph_degree_);
+    if (padded_dim != dim_) {
+      RAFT_CUDA_TRY(
+        cudaMemsetAsync(dataset_.data_handle(), 0, dataset_.size() * sizeof(T), stream));
+    }
+    for (size_t i = 0; i < indices.size(); i++) {
+      const auto& idx = *indices[i];
+      RAFT_CUDA_TRY(cudaMemcpy2DAsync(dataset_.data_handle() + offsets[i] * padded_dim,
+                                      sizeof(T) * padded_dim,
+                                      idx.dataset().data_handle(),
+                                      sizeof(T) * idx.dataset().stride(0),
+                                      sizeof(T) * dim_,
+                                      idx.size(),
+                                      cudaMemcpyDefault,
+                                      stream));
+      raft::copy(graph_.data_handle() + offsets[i] * graph_degree_,
+                 idx.graph().data_handle(),
+                 idx.graph().size(),
+                 stream);
+    }
+    if (metric_ == raft::distance::DistanceType::CosineExpanded) {
+      dataset_norms_ = raft::make_device_vector<float, int64_t>(res, n_rows);
+      detail::compute_row_norms(res, dataset(), dataset_norms_.view());
+    }
+  }
+
+  /** Number of the packed indices. */
+  [[nodiscard]] auto n_indices() const noexcept -> uint32_t { return offsets_.extent(0) - 1; }
+  /** Total number of the rows of all indices. */
+  [[nodiscard]] auto size() const noexcept -> int64_t { return graph_.extent(0); }
+  /** Dimensionality of the data. */
+  [[nodiscard]] auto dim() const noexcept -> uint32_t { return dim_; }
+  /** Graph degree of every index. */
+  [[nodiscard]] auto graph_degree() const noexcept -> uint32_t { return graph_degree_; }
+  /** Distance metric of every index. */
+  [[nodiscard]] auto metric() const noexcept -> raft::distance::DistanceType { return metric_; }
+
+  /** The first arena row of every index, and the total number of rows [n_indices + 1]. */
+  [[nodiscard]] auto offsets() const noexcept -> device_vector_view<const int64_t, int64_t>
+  {
+    return offsets_.view();
+  }
+  /** The dataset arena [size, dim]. */
+  [[nodiscard]] auto dataset() const noexcept
+    -> device_matrix_view<const T, int64_t, layout_stride>
+  {
+    return make_device_strided_matrix_view<const T, int64_t>(
+      dataset_.data_handle(), dataset_.extent(0), dim_, dataset_.extent(1));
+  }
+  /** The graph arena [size, graph_degree], with the neighbor ids relative to their index. */
+  [[nodiscard]] auto graph() const noexcept -> device_matrix_view<const IdxT, int64_t, row_major>
+  {
+    return make_const_mdspan(graph_.view());
+  }
+  /** The L2 norms of the dataset rows [size] (CosineExpanded only, empty otherwise). */
+  [[nodiscard]] auto dataset_norms() const noexcept -> device_vector_view<const float, int64_t>
+  {
+    return make_const_mdspan(dataset_norms_.view());
+  }
+
+ private:
+  uint32_t dim_          = 0;
+  uint32_t graph_degree_ = 0;
+  raft::distance::DistanceType metric_;
+  raft::device_vector<int64_t, int64_t> offsets_;
+  raft::device_matrix<T, int64_t, row_major> dataset_;
+  raft::device_matrix<IdxT, int64_t, row_major> graph_;
+  raft::device_vector<float, int64_t> dataset_norms_;
+};
+
+/**
+ * @brief Search a batch of queries, each against its own index of a multi-index.
+ *
+ * All queries of a batch of up to `params.max_queries` are served by one launch of the single-CTA
+ * search kernel. The neighbor ids are relative to the index searched by the query.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res raft resources
+ * @param[in] params search parameters; `params.algo` must be AUTO or SINGLE_CTA
+ * @param[in] idx the packed indices
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, dim]
+ * @param[in] index_ids a device vector view [n_queries] of the index searched by every query; every
+ * id must be smaller than `idx.n_indices()`
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the dataset of the
+ * searched index [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors
+ * [n_queries, k]
+ */
+template <typename T, typename IdxT>
+void search_multi_index(raft::resources const& res,
+                        const search_params& params,
+                        const multi_index<T, IdxT>& idx,
+                        raft::device_matrix_view<const T, int64_t, row_major> queries,
+                        raft::device_vector_view<const uint32_t, int64_t> index_ids,
+                        raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                        raft::device_matrix_view<float, int64_t, row_major> distances)
+{
+  using internal_IdxT = typename std::make_unsigned<IdxT>::type;
+  using filter_type   = raft::neighbors::filtering::none_cagra_sample_filter;
+
+  RAFT_EXPECTS(params.algo == search_algo::AUTO || params.algo == search_algo::SINGLE_CTA,
+               "The multi-index search only supports the single-CTA algorithm");
+  RAFT_EXPECTS(queries.extent(0) == index_ids.extent(0) &&
+                 queries.extent(0) == neighbors.extent(0) &&
+                 queries.extent(0) == distances.extent(0),
+               "Number of rows in index ids, neighbors and distances must equal the number of "
+               "queries.");
+  RAFT_EXPECTS(neighbors.extent(1) == distances.extent(1),
+               "Number of columns in output neighbors and distances matrices must equal k");
+  RAFT_EXPECTS(queries.extent(1) == idx.dim(), "Queries and index dim must match");
+  const uint32_t topk = neighbors.extent(1);
+  if (queries.extent(0) == 0) { return; }
+
+  search_params plan_params = params;
+  plan_params.algo          = search_algo::SINGLE_CTA;
+  if (plan_params.max_queries == 0) {
+    plan_params.max_queries = std::min<size_t>(
+      queries.extent(0), resource::get_device_properties(res).maxGridSize[1]);
+  }
+
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::search_multi_index(max_queries = %u, k = %u, n_indices = %u)",
+    plan_params.max_queries,
+    topk,
+    idx.n_indices());
+  resource::scoped_call call(res, "cagra::search_multi_index");
+  call.set_batch_size(queries.extent(0));
+  call.set_algo("SINGLE_CTA");
+
+  auto plan = detail::factory<T, internal_IdxT, float, filter_type>::create(
+    res, plan_params, idx.dim(), idx.graph_degree(), topk);
+  plan->check(topk);
+  plan->metric = detail::make_search_metric(idx.metric(), idx.dataset_norms().data_handle());
+  plan->arena.offsets = idx.offsets().data_handle();
+  call.note_workspace();
+
+  auto graph = raft::make_device_matrix_view<const internal_IdxT, int64_t, row_major>(
+    reinterpret_cast<const internal_IdxT*>(idx.graph().data_handle()),
+    idx.graph().extent(0),
+    idx.graph().extent(1));
+  const uint32_t max_queries = plan->max_queries;
+  for (int64_t qid = 0; qid < queries.extent(0); qid += max_queries) {
+    resource::check_cancellation(res);
+    const uint32_t n_queries = std::min<int64_t>(max_queries, queries.extent(0) - qid);
+    plan->arena.index_ids    = index_ids.data_handle() + qid;
+    (*plan)(res,
+            idx.dataset(),
+            graph,
+            0,
+            reinterpret_cast<internal_IdxT*>(neighbors.data_handle()) + topk * qid,
+            distances.data_handle() + topk * qid,
+            queries.data_handle() + queries.extent(1) * qid,
+            n_queries,
+            nullptr,
+            nullptr,
+            topk,
+            filter_type{});
+  }
+  detail::postprocess_search_distances(res, idx.metric(), queries, distances);
+}
+
+/** @} */  // end group cagra_multi_index
+
+}  // namespace raft::neighbors::cagra
@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/cagra/dataset_norms.cuh"
+#include "detail/cagra/factory.cuh"
+#include "detail/cagra/search_plan.cuh"
+
+#include <raft/core/error.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/pinned_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/sample_filter_types.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace raft::neighbors::cagra {
+
+/**
+ * @defgroup cagra_search_server CAGRA persistent search server
+ * @{
+ */
+
+struct search_server_params : search_params {
+  /**
+   * Maximum number of queries that can be in flight at the same time, i.e. submitted but not yet
+   * collected with `search_server::poll`.
+   */
+  uint32_t queue_size = 1024;
+  /**
+   * Number of resident thread blocks serving the queue; each block searches one query at a time.
+   * Auto select when 0 (one block per SM).
+   */
+  uint32_t num_workers = 0;
+};
+
+/**
+ * @brief Low-latency CAGRA search for a stream of single queries.
+ *
+ * A regular `cagra::search` call pays a kernel launch (and usually a search plan setup) per
+ * batch, which dominates the latency when queries arrive one at a time. The search server
+ * instead launches the single-CTA search kernel once with long-lived thread blocks. The host
+ * publishes queries through pinned memory mapped into the device address space, the thread
+ * blocks pick them up as soon as they appear, and write the results back to mapped memory.
+ *
+ * The server occupies `num_workers` thread blocks of the GPU until it is destroyed, and it keeps
+ * references to the dataset and graph of the index, which therefore must outlive the server.
+ * `submit` and `poll` may be called from multiple host threads.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   cagra::search_server_params params;
+ *   cagra::search_server<float, uint32_t> server(res, params, index, k);
+ *   auto ticket = server.submit(raft::make_host_vector_view<const float, uint32_t>(q, dim));
+ *   while (!server.poll(ticket, neighbors, distances)) {}
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ */
+template <typename T, typename IdxT>
+class search_server {
+  using internal_IdxT = typename std::make_unsigned<IdxT>::type;
+  using plan_type =
+    cagra::detail::search_plan_impl<T,
+                                    internal_IdxT,
+                                    float,
+                                    raft::neighbors::filtering::none_cagra_sample_filter>;
+
+ public:
+  /**
+   * @brief Start serving queries against the index.
+   *
+   * @param[in] res raft resources
+   * @param[in] params search parameters; `params.algo` must be AUTO or SINGLE_CTA
+   * @param[in] idx the index to search; must outlive the server
+   * @param[in] k number of neighbors returned per query
+   */
+  search_server(raft::resources const& res,
+                const search_server_params& params,
+                const index<T, IdxT>& idx,
+                uint32_t k)
+    : dim_(idx.dim()),
+      k_(k),
+      metric_(idx.metric()),
+      queue_size_(params.queue_size),
+      queries_(raft::make_pinned_matrix<T, uint32_t>(res, params.queue_size, idx.dim())),
+      indices_(raft::make_pinned_matrix<internal_IdxT, uint32_t>(res, params.queue_size, k)),
+      distances_(raft::make_pinned_matrix<float, uint32_t>(res, params.queue_size, k)),
+      submitted_(raft::make_pinned_vector<uint64_t, uint32_t>(res, params.queue_size)),
+      completed_(raft::make_pinned_vector<uint64_t, uint32_t>(res, params.queue_size)),
+      stop_flag_(raft::make_pinned_vector<uint32_t, uint32_t>(res, 1)),
+      next_ticket_(0, resource::get_cuda_stream(res)),
+      dataset_norms_(raft::make_device_vector<float, int64_t>(res, 0)),
+      in_flight_(params.queue_size, false)
+  {
+    RAFT_EXPECTS(params.queue_size > 0, "queue_size must be positive");
+    RAFT_EXPECTS(params.algo == search_algo::AUTO || params.algo == search_algo::SINGLE_CTA,
+                 "The search server only supports the single-CTA algorithm");
+    RAFT_EXPECTS(idx.size() > 0, "The index must not be empty");
+    RAFT_EXPECTS(idx.dataset().extent(0) == static_cast<int64_t>(idx.size()),
+                 "The index dataset must be attached to start a search server");
+    RAFT_EXPECTS(idx.n_removed() == 0,
+                 "The search server does not skip removed nodes; call cagra::compact first");
+
+    uint32_t num_workers = params.num_workers;
+    if (num_workers == 0) { num_workers = raft::getMultiProcessorCount(); }
+
+    search_params plan_params = params;
+    plan_params.algo          = search_algo::SINGLE_CTA;
+    plan_params.max_queries   = num_workers;
+    plan_ = cagra::detail::
+      factory<T, internal_IdxT, float, raft::neighbors::filtering::none_cagra_sample_filter>::
+        create(res, plan_params, idx.dim(), idx.graph_degree(), k);
+    plan_->check(k);
+    const float* dataset_norms = idx.dataset_norms().data_handle();
+    if (metric_ == distance::DistanceType::CosineExpanded &&
+        idx.dataset_norms().extent(0) != idx.dataset().extent(0)) {
+      dataset_norms_ = cagra::detail::make_dataset_norms(res, idx);
+      dataset_norms  = dataset_norms_.data_handle();
+    }
+    plan_->metric = cagra::detail::make_search_metric(metric_, dataset_norms);
+
+    std::fill(submitted_.data_handle(), submitted_.data_handle() + queue_size_, 0);
+    std::fill(completed_.data_handle(), completed_.data_handle() + queue_size_, 0);
+    stop_flag_(0) = 0;
+
+    detail::persistent_job_queue<T, internal_IdxT, float> queue;
+    queue.queries     = device_ptr(queries_.data_handle());
+    queue.indices     = device_ptr(indices_.data_handle());
+    queue.distances   = device_ptr(distances_.data_handle());
+    queue.submitted   = device_ptr(submitted_.data_handle());
+    queue.completed   = device_ptr(completed_.data_handle());
+    queue.stop        = device_ptr(stop_flag_.data_handle());
+    queue.next_ticket = next_ticket_.data();
+    queue.num_slots   = queue_size_;
+
+    auto dataset = make_device_strided_matrix_view<const T, int64_t, row_major>(
+      idx.dataset().data_handle(),
+      idx.dataset().extent(0),
+      idx.dataset().extent(1),
+      idx.dataset().stride(0));
+    auto graph = detail::kernel_graph_view<internal_IdxT>(idx);
+
+    // The kernel never returns on its own, so it gets a stream that nothing else waits on.
+    // Everything it reads must be ready before the launch.
+    resource::sync_stream(res);
+    RAFT_CUDA_TRY(cudaStreamCreateWithFlags(&stream_, cudaStreamNonBlocking));
+    try {
+      plan_->launch_persistent(
+        res, dataset, graph, idx.graph_bits(), queue, num_workers, k, stream_);
+    } catch (...) {
+      RAFT_CUDA_TRY_NO_THROW(cudaStreamDestroy(stream_));
+      throw;
+    }
+  }
+
+  search_server(const search_server&)                    = delete;
+  search_server(search_server&&)                         = delete;
+  auto operator=(const search_server&) -> search_server& = delete;
+  auto operator=(search_server&&) -> search_server&      = delete;
+
+  /** Stop the kernel; queries that are still in flight are completed first. */
+  ~search_server() noexcept
+  {
+    *static_cast<volatile uint32_t*>(stop_flag_.data_handle()) = 1;
+    RAFT_CUDA_TRY_NO_THROW(cudaStreamSynchronize(stream_));
+    RAFT_CUDA_TRY_NO_THROW(cudaStreamDestroy(stream_));
+  }
+
+  /**
+   * @brief Publish a query to the search kernel.
+   *
+   * The function copies the query and returns immediately.
+   *
+   * @param[in] query a host vector [dim]
+   * @return the ticket identifying the query in `poll`
+   */
+  auto submit(raft::host_vector_view<const T, uint32_t> query) -> uint64_t
+  {
+    RAFT_EXPECTS(query.extent(0) == dim_, "Query and index dim must match");
+    std::lock_guard<std::mutex> guard(lock_);
+    const uint64_t ticket = next_submit_;
+    const uint32_t slot   = ticket % queue_size_;
+    RAFT_EXPECTS(!in_flight_[slot],
+                 "The queue is full (%u queries in flight); poll the completed queries first",
+                 queue_size_);
+    std::copy(query.data_handle(), query.data_handle() + dim_, &queries_(slot, 0));
+    in_flight_[slot] = true;
+    next_submit_++;
+    // The query must be visible to the device before the ticket is.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    static_cast<volatile uint64_t*>(submitted_.data_handle())[slot] = ticket + 1;
+    return ticket;
+  }
+
+  /**
+   * @brief Collect the result of a submitted query, if it is ready.
+   *
+   * Once this returns true, the ticket is released and must not be polled again.
+   *
+   * @param[in] ticket the value returned by `submit`
+   * @param[out] neighbors a host vector [k] for the indices of the neighbors
+   * @param[out] distances a host vector [k] for the distances to the neighbors
+   * @return whether the query has completed and the outputs have been written
+   */
+  auto poll(uint64_t ticket,
+            raft::host_vector_view<IdxT, uint32_t> neighbors,
+            raft::host_vector_view<float, uint32_t> distances) -> bool
+  {
+    RAFT_EXPECTS(neighbors.extent(0) == k_, "Number of neighbor output columns must equal k");
+    RAFT_EXPECTS(distances.extent(0) == k_, "Number of distance output columns must equal k");
+    std::lock_guard<std::mutex> guard(lock_);
+    const uint32_t slot = ticket % queue_size_;
+    RAFT_EXPECTS(ticket < next_submit_ && ticket + queue_size_ >= next_submit_ && in_flight_[slot],
+                 "The ticket %lu is not in flight",
+                 static_cast<unsigned long>(ticket));
+    if (static_cast<volatile uint64_t*>(completed_.data_handle())[slot] != ticket + 1) {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Restore the original scale of the distances (see cagra::detail::search_with_plan).
+    constexpr float kScale = spatial::knn::detail::utils::config<T>::kDivisor /
+                             spatial::knn::detail::utils::config<float>::kDivisor;
+    float query_norm = 0;
+    if (metric_ == distance::DistanceType::CosineExpanded) {
+      // the query is kept in its slot until the ticket is released
+      query_norm = cagra::detail::row_norm_op<T>{&queries_(slot, 0), dim_, dim_}(0);
+    }
+    for (uint32_t i = 0; i < k_; i++) {
+      neighbors(i) = static_cast<IdxT>(indices_(slot, i));
+      switch (metric_) {
+        case distance::DistanceType::L2SqrtUnexpanded:
+        case distance::DistanceType::L2SqrtExpanded:
+          distances(i) = kScale * std::sqrt(distances_(slot, i));
+          break;
+        case distance::DistanceType::InnerProduct:
+          distances(i) = -kScale * kScale * distances_(slot, i);
+          break;
+        case distance::DistanceType::CosineExpanded:
+          distances(i) = query_norm > 0 ? 1.0f + distances_(slot, i) / query_norm : 1.0f;
+          break;
+        default: distances(i) = kScale * kScale * distances_(slot, i); break;
+      }
+    }
+    in_flight_[slot] = false;
+    return true;
+  }
+
+  /** Dimensionality of the queries. */
+  [[nodiscard]] auto dim() const noexcept -> uint32_t { return dim_; }
+  /** Number of neighbors returned per query. */
+  [[nodiscard]] auto k() const noexcept -> uint32_t { return k_; }
+
+ private:
+  uint32_t dim_;
+  uint32_t k_;
+  raft::distance::DistanceType metric_;
+  uint32_t queue_size_;
+
+  std::unique_ptr<plan_type> plan_;
+  raft::pinned_matrix<T, uint32_t> queries_;
+  raft::pinned_matrix<internal_IdxT, uint32_t> indices_;
+  raft::pinned_matrix<float, uint32_t> distances_;
+  raft::pinned_vector<uint64_t, uint32_t> submitted_;
+  raft::pinned_vector<uint64_t, uint32_t> completed_;
+  raft::pinned_vector<uint32_t, uint32_t> stop_flag_;
+  rmm::device_scalar<unsigned long long> next_ticket_;
+  raft::device_vector<float, int64_t> dataset_norms_;
+  cudaStream_t stream_ = nullptr;
+
+  std::mutex lock_;
+  uint64_t next_submit_ = 0;
+  std::vector<bool> in_flight_;
+
+  template <typename PtrT>
+  static auto device_ptr(PtrT* ptr) -> PtrT*
+  {
+    void* dev_ptr = nullptr;
+    RAFT_CUDA_TRY(cudaHostGetDevicePointer(&dev_ptr, const_cast<std::remove_cv_t<PtrT>*>(ptr), 0));
+    return static_cast<PtrT*>(dev_ptr);
+  }
+};
+
+/** @} */  // end group cagra_search_server
+
+}  // namespace raft::neighbors::cagra
@@ -49,15 +49,18 @@ namespace raft::neighbors::cagra {
  * @param[in] os output stream
  * @param[in] index CAGRA index
  * @param[in] include_dataset Whether or not to write out the dataset to the file.
+ * @param[in] compress Whether to compress the (unpacked) graph: the neighbor ids are bit-packed
+ *   at the width of their range, encoded and decoded on the GPU.
  *
  */
 template <typename T, typename IdxT>
 void serialize(raft::resources const& handle,
                std::ostream& os,
                const index<T, IdxT>& index,
-               bool include_dataset = true)
+               bool include_dataset = true,
+               bool compress        = false)
 {
-  detail::serialize(handle, os, index, include_dataset);
+  detail::serialize(handle, os, index, include_dataset, compress);
 }
 
 /**
@@ -84,19 +87,28 @@ void serialize(raft::resources const& handle,
  * @param[in] filename the file name for saving the index
  * @param[in] index CAGRA index
  * @param[in] include_dataset Whether or not to write out the dataset to the file.
+ * @param[in] compress Whether to compress the (unpacked) graph: the neighbor ids are bit-packed
+ *   at the width of their range, encoded and decoded on the GPU.
  *
  */
 template <typename T, typename IdxT>
 void serialize(raft::resources const& handle,
                const std::string& filename,
                const index<T, IdxT>& index,
-               bool include_dataset = true)
+               bool include_dataset = true,
+               bool compress        = false)
 {
-  detail::serialize(handle, filename, index, include_dataset);
+  detail::serialize(handle, filename, index, include_dataset, compress);
 }
 
 /**
- * Write the CAGRA built index as a base layer HNSW index to an output stream
+ * Write the CAGRA built index as an HNSW index to an output stream
+ *
+ * By default, the index is base-layer-only (the CAGRA graph). With
+ * `hierarchy = hnsw::HnswHierarchy::GPU`, the upper layers of a full hierarchical HNSW index are
+ * built on the GPU: the levels of the nodes are sampled like in hnswlib and the graphs of the
+ * upper layers are the exact kNN graphs of their nodes (brute-force search). The hnswlib search
+ * then descends through the layers to its entry point instead of starting from fixed seeds.
  *
  * Experimental, both the API and the serialization format are subject to change.
  *
@@ -118,18 +130,23 @@ void serialize(raft::resources const& handle,
  * @param[in] handle the raft handle
  * @param[in] os output stream
  * @param[in] index CAGRA index
+ * @param[in] hierarchy how the upper layers of the HNSW index are constructed
  *
  */
 template <typename T, typename IdxT>
-void serialize_to_hnswlib(raft::resources const& handle,
-                          std::ostream& os,
-                          const raft::neighbors::cagra::index<T, IdxT>& index)
+void serialize_to_hnswlib(
+  raft::resources const& handle,
+  std::ostream& os,
+  const raft::neighbors::cagra::index<T, IdxT>& index,
+  raft::neighbors::hnsw::HnswHierarchy hierarchy = raft::neighbors::hnsw::HnswHierarchy::NONE)
 {
-  detail::serialize_to_hnswlib<T, IdxT>(handle, os, index);
+  detail::serialize_to_hnswlib<T, IdxT>(handle, os, index, hierarchy);
 }
 
 /**
- * Save a CAGRA build index in hnswlib base-layer-only serialized format
+ * Save a CAGRA build index in hnswlib serialized format
+ *
+ * See `serialize_to_hnswlib` on an output stream for the construction of the upper layers.
  *
  * Experimental, both the API and the serialization format are subject to change.
  *
@@ -151,14 +168,17 @@ void serialize_to_hnswlib(raft::resources const& handle,
  * @param[in] handle the raft handle
  * @param[in] filename the file name for saving the index
  * @param[in] index CAGRA index
+ * @param[in] hierarchy how the upper layers of the HNSW index are constructed
  *
  */
 template <typename T, typename IdxT>
-void serialize_to_hnswlib(raft::resources const& handle,
-                          const std::string& filename,
-                          const raft::neighbors::cagra::index<T, IdxT>& index)
+void serialize_to_hnswlib(
+  raft::resources const& handle,
+  const std::string& filename,
+  const raft::neighbors::cagra::index<T, IdxT>& index,
+  raft::neighbors::hnsw::HnswHierarchy hierarchy = raft::neighbors::hnsw::HnswHierarchy::NONE)
 {
-  detail::serialize_to_hnswlib<T, IdxT>(handle, filename, index);
+  detail::serialize_to_hnswlib<T, IdxT>(handle, filename, index, hierarchy);
 }
 
 /**
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/device_resources_manager.hpp>
+#include <raft/core/device_setter.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/neighbors/cagra.cuh>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/detail/cagra/shard_utils.hpp>
+#include <raft/neighbors/detail/knn_merge_parts.cuh>
+#include <raft/util/cuda_dev_essentials.cuh>
+#include <raft/util/cuda_rt_essentials.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace raft::neighbors::cagra {
+
+/**
+ * @defgroup cagra_sharded CAGRA multi-GPU sharded index
+ * @{
+ */
+
+/**
+ * @brief A CAGRA index partitioned by rows across several GPUs.
+ *
+ * Each shard is a regular `cagra::index` that lives on its own device and holds a contiguous
+ * range of the dataset rows. Use `cagra::build_sharded` to construct it and
+ * `cagra::search_sharded` to query it.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ */
+template <typename T, typename IdxT>
+class sharded_index {
+ public:
+  /**
+   * Construct a sharded index from already built shards.
+   *
+   * @param devices the CUDA device of every shard
+   * @param offsets global index of the first row of every shard
+   * @param shards the sub-indices; each must have been allocated on its device
+   */
+  sharded_index(std::vector<int> devices,
+                std::vector<IdxT> offsets,
+                std::vector<std::unique_ptr<index<T, IdxT>>> shards)
+    : devices_(std::move(devices)), offsets_(std::move(offsets)), shards_(std::move(shards))
+  {
+    RAFT_EXPECTS(devices_.size() == shards_.size() && offsets_.size() == shards_.size(),
+                 "Number of devices, offsets and shards must match");
+  }
+
+  sharded_index(const sharded_index&)            = delete;
+  sharded_index& operator=(const sharded_index&) = delete;
+  sharded_index(sharded_index&&)                 = default;
+  sharded_index& operator=(sharded_index&&)      = delete;
+
+  ~sharded_index()
+  {
+    // Device memory of every shard must be released on the device it was allocated on.
+    for (size_t i = 0; i < shards_.size(); i++) {
+      if (!shards_[i]) { continue; }
+      device_setter dev(devices_[i]);
+      shards_[i].reset();
+    }
+  }
+
+  /** Number of shards. */
+  [[nodiscard]] auto n_shards() const noexcept -> uint32_t { return shards_.size(); }
+  /** Total number of vectors in all shards. */
+  [[nodiscard]] auto size() const noexcept -> IdxT
+  {
+    return shards_.empty() ? 0 : offsets_.back() + shards_.back()->size();
+  }
+  /** Dimensionality of the data. */
+  [[nodiscard]] auto dim() const noexcept -> uint32_t
+  {
+    return shards_.empty() ? 0 : shards_.front()->dim();
+  }
+  /** CUDA device holding the shard `i`. */
+  [[nodiscard]] auto device(uint32_t i) const -> int { return devices_.at(i); }
+  /** Global index of the first row of the shard `i`. */
+  [[nodiscard]] auto offset(uint32_t i) const -> IdxT { return offsets_.at(i); }
+  /** The sub-index of the shard `i`; it must only be used while its device is active. */
+  [[nodiscard]] auto shard(uint32_t i) const -> const index<T, IdxT>& { return *shards_.at(i); }
+
+ private:
+  std::vector<int> devices_;
+  std::vector<IdxT> offsets_;
+  std::vector<std::unique_ptr<index<T, IdxT>>> shards_;
+};
+
+/**
+ * @brief Build a CAGRA index sharded across several GPUs.
+ *
+ * The rows of the dataset are split into `devices.size()` contiguous ranges of (almost) equal size
+ * and one `cagra::index` is built for each range on the corresponding device. The shards are built
+ * concurrently, one host thread per shard, using the resources provided by
+ * `raft::device_resources_manager` for that device; configure the manager (streams, memory pools)
+ * before calling this function if needed. A device may appear in the list more than once.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   // dataset is a host_matrix_view holding all vectors
+ *   auto index = cagra::build_sharded<float, uint32_t>(index_params, dataset, {0, 1, 2, 3});
+ *   // use default search parameters
+ *   cagra::search_params search_params;
+ *   // queries, neighbors and distances are on the device of `res`
+ *   cagra::search_sharded(res, search_params, index, queries, neighbors, distances);
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] params parameters for building each shard
+ * @param[in] dataset a host matrix view to a row-major matrix [n_rows, dim]
+ * @param[in] devices the CUDA devices to place the shards on
+ *
+ * @return the sharded index
+ */
+template <typename T, typename IdxT = uint32_t>
+auto build_sharded(const index_params& params,
+                   raft::host_matrix_view<const T, int64_t, row_major> dataset,
+                   const std::vector<int>& devices) -> sharded_index<T, IdxT>
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::build_sharded(%zu shards)", devices.size());
+  RAFT_EXPECTS(!devices.empty(), "At least one device is required");
+  const int64_t n_rows   = dataset.extent(0);
+  const int64_t n_shards = devices.size();
+  RAFT_EXPECTS(n_rows >= n_shards, "Every shard must contain at least one vector");
+  RAFT_EXPECTS(n_rows <= int64_t(std::numeric_limits<IdxT>::max()),
+               "The dataset size does not fit into the index type");
+
+  detail::enable_peer_access(devices);
+
+  std::vector<IdxT> offsets(n_shards);
+  std::vector<std::unique_ptr<index<T, IdxT>>> shards(n_shards);
+  const int64_t rows_per_shard = raft::ceildiv<int64_t>(n_rows, n_shards);
+  detail::for_each_shard(n_shards, [&](uint32_t i) {
+    const int64_t begin = std::min<int64_t>(i * rows_per_shard, n_rows);
+    const int64_t end   = std::min<int64_t>(begin + rows_per_shard, n_rows);
+    RAFT_EXPECTS(end > begin, "Shard %u is empty", i);
+
+    device_setter scoped_device(devices[i]);
+    auto const& res = device_resources_manager::get_device_resources(devices[i]);
+    auto shard_view = raft::make_host_matrix_view<const T, int64_t>(
+      dataset.data_handle() + begin * dataset.extent(1), end - begin, dataset.extent(1));
+    offsets[i] = IdxT(begin);
+    shards[i]  = std::make_unique<index<T, IdxT>>(build<T, IdxT>(res, params, shard_view));
+    resource::sync_stream(res);
+  });
+  return sharded_index<T, IdxT>(devices, std::move(offsets), std::move(shards));
+}
+
+/**
+ * @brief Search a sharded CAGRA index.
+ *
+ * The query batch is copied to every shard device (directly over NVLink / P2P when available),
+ * all shards are searched concurrently, and the per-shard `[n_queries, k]` results are copied back
+ * and merged on the device of `res` with a k-way selection. Neighbor indices in the output refer
+ * to rows of the full dataset passed to `cagra::build_sharded`.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] res raft resources of the device holding the queries and outputs
+ * @param[in] params search parameters, applied to every shard
+ * @param[in] idx the sharded index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, dim]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors
+ * [n_queries, k]
+ */
+template <typename T, typename IdxT>
+void search_sharded(raft::resources const& res,
+                    const search_params& params,
+                    const sharded_index<T, IdxT>& idx,
+                    raft::device_matrix_view<const T, int64_t, row_major> queries,
+                    raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                    raft::device_matrix_view<float, int64_t, row_major> distances)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::search_sharded(%zu queries, %u shards)", size_t(queries.extent(0)), idx.n_shards());
+  RAFT_EXPECTS(idx.n_shards() > 0, "The sharded index is empty");
+  RAFT_EXPECTS(queries.extent(0) == neighbors.extent(0) && queries.extent(0) == distances.extent(0),
+               "Number of rows in output neighbors and distances matrices must equal the number of "
+               "queries.");
+  RAFT_EXPECTS(neighbors.extent(1) == distances.extent(1),
+               "Number of columns in output neighbors and distances matrices must equal k");
+  RAFT_EXPECTS(queries.extent(1) == idx.dim(),
+               "Number of query dimensions should equal number of dimensions in the index.");
+  RAFT_EXPECTS(neighbors.extent(1) <= 1024, "search_sharded: k must not exceed 1024");
+
+  const int64_t n_queries = queries.extent(0);
+  const int64_t k         = neighbors.extent(1);
+  const uint32_t n_shards = idx.n_shards();
+  if (n_queries == 0) { return; }
+
+  auto stream            = resource::get_cuda_stream(res);
+  const int root         = device_setter::get_current_device();
+  const size_t part_size = n_queries * k;
+
+  rmm::device_uvector<float> parts_distances(part_size * n_shards, stream);
+  rmm::device_uvector<IdxT> parts_neighbors(part_size * n_shards, stream);
+  rmm::device_uvector<IdxT> translations(n_shards, stream);
+  {
+    std::vector<IdxT> offsets(n_shards);
+    for (uint32_t i = 0; i < n_shards; i++) {
+      offsets[i] = idx.offset(i);
+    }
+    raft::copy(translations.data(), offsets.data(), n_shards, stream);
+    // The shard threads read the queries and write the part buffers on their own streams.
+    resource::sync_stream(res);
+  }
+
+  detail::for_each_shard(n_shards, [&](uint32_t i) {
+    const int dev = idx.device(i);
+    device_setter scoped_device(dev);
+    auto const& shard_res = device_resources_manager::get_device_resources(dev);
+    auto shard_stream     = resource::get_cuda_stream(shard_res);
+
+    rmm::device_uvector<T> shard_queries(n_queries * queries.extent(1), shard_stream);
+    rmm::device_uvector<IdxT> shard_neighbors(part_size, shard_stream);
+    rmm::device_uvector<float> shard_distances(part_size, shard_stream);
+
+    RAFT_CUDA_TRY(cudaMemcpyPeerAsync(shard_queries.data(),
+                                      dev,
+                                      queries.data_handle(),
+                                      root,
+                                      shard_queries.size() * sizeof(T),
+                                      shard_stream));
+    search<T, IdxT>(
+      shard_res,
+      params,
+      idx.shard(i),
+      raft::make_device_matrix_view<const T, int64_t>(
+        shard_queries.data(), n_queries, queries.extent(1)),
+      raft::make_device_matrix_view<IdxT, int64_t>(shard_neighbors.data(), n_queries, k),
+      raft::make_device_matrix_view<float, int64_t>(shard_distances.data(), n_queries, k));
+    RAFT_CUDA_TRY(cudaMemcpyPeerAsync(parts_neighbors.data() + i * part_size,
+                                      root,
+                                      shard_neighbors.data(),
+                                      dev,
+                                      part_size * sizeof(IdxT),
+                                      shard_stream));
+    RAFT_CUDA_TRY(cudaMemcpyPeerAsync(parts_distances.data() + i * part_size,
+                                      root,
+                                      shard_distances.data(),
+                                      dev,
+                                      part_size * sizeof(float),
+                                      shard_stream));
+    resource::sync_stream(shard_res);
+  });
+
+  raft::neighbors::detail::knn_merge_parts(parts_distances.data(),
+                                           parts_neighbors.data(),
+                                           distances.data_handle(),
+                                           neighbors.data_handle(),
+                                           n_queries,
+                                           int(n_shards),
+                                           int(k),
+                                           stream,
+                                           translations.data());
+}
+
+/** @} */  // end group cagra_sharded
+
+}  // namespace raft::neighbors::cagra
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -26,8 +26,11 @@
 #include <raft/core/resources.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/neighbors/detail/cagra/utils.hpp>
+#include <raft/neighbors/sample_filter_types.hpp>
 #include <raft/util/integer_utils.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -52,6 +55,18 @@ enum class graph_build_algo {
   NN_DESCENT
 };
 
+/** The order of the nodes of the index returned by `cagra::build`. */
+enum class graph_reordering {
+  /** The nodes are the dataset rows in their input order. */
+  NONE,
+  /**
+   * The nodes are renumbered in the breadth-first order of the graph (Cuthill-McKee order; all
+   * nodes have the same degree), so that the neighbors of a node are mostly stored next to it and
+   * the search reads rows of the dataset and the graph that are close in memory.
+   */
+  BFS
+};
+
 struct index_params : ann::index_params {
   /** Degree of input graph for pruning. */
   size_t intermediate_graph_degree = 128;
@@ -61,6 +76,94 @@ struct index_params : ann::index_params {
   graph_build_algo build_algo = graph_build_algo::IVF_PQ;
   /** Number of Iterations to run if building with NN_DESCENT */
   size_t nn_descent_niter = 20;
+  /**
+   * Number of clusters the dataset is partitioned into when building with NN_DESCENT.
+   *
+   * With the default value of 1, NN-descent runs on the whole dataset at once, which requires the
+   * dataset to fit in device memory. Larger values let a host-resident dataset be processed one
+   * cluster at a time: only about `nn_descent_cluster_overlap * n_rows / nn_descent_n_clusters`
+   * vectors are resident on device at any moment.
+   */
+  size_t nn_descent_n_clusters = 1;
+  /**
+   * Number of closest clusters each vector is assigned to when `nn_descent_n_clusters > 1`.
+   * Vectors shared by several clusters connect the per-cluster subgraphs.
+   */
+  size_t nn_descent_cluster_overlap = 2;
+  /**
+   * Whether to attach the dataset to the index returned by `cagra::build`.
+   *
+   * If false, the index only holds the graph and the dataset has to be supplied later with
+   * `index::update_dataset` or `index::attach_host_dataset`. This avoids allocating a device copy
+   * of the dataset when it is going to live in host memory.
+   */
+  bool attach_dataset_on_build = true;
+  /**
+   * Number of entry points selected by `cagra::build` (0 disables them).
+   *
+   * The entry points are dataset rows spread over the dataset by a balanced k-means clustering
+   * (see `index::entry_points`). The search evaluates them before the random seeds, hence it starts
+   * from nodes close to the query and needs fewer iterations for the same recall. A few dozen to a
+   * few hundred are typical. They are not selected if `attach_dataset_on_build` is false.
+   */
+  size_t n_entry_points = 0;
+  /**
+   * Renumbering of the nodes after the graph is built (see `graph_reordering`).
+   *
+   * The dataset rows and the graph are stored in the new order, and `index::source_indices` maps
+   * the nodes back to the dataset rows; the search returns the row ids of the input dataset as
+   * usual. A reordered index owns a device copy of its dataset, and cannot be extended or have
+   * nodes removed. It is not reordered if `attach_dataset_on_build` is false.
+   */
+  graph_reordering reordering = graph_reordering::NONE;
+};
+
+/** Where `cagra::optimize` keeps the input kNN graph while pruning it. */
+enum class graph_placement {
+  /** Copy the graph to the device memory. */
+  DEVICE,
+  /**
+   * Read the graph from the host memory over the interconnect; the host array is page-locked for
+   * the duration of the call.
+   */
+  HOST,
+  /** DEVICE if the graph takes at most half of the free device memory, HOST otherwise. */
+  AUTO
+};
+
+struct optimize_params {
+  /**
+   * Where the input graph is kept while pruning it. The pruning of every node reads the neighbor
+   * lists of all its neighbors, hence the whole input graph must be accessible from the device.
+   */
+  graph_placement input_graph_placement = graph_placement::AUTO;
+  /**
+   * Number of nodes pruned per kernel launch. The device and host buffers of the pruning take
+   * about `input_graph_degree` bytes per node of a batch.
+   */
+  size_t prune_batch_size = 256 * 1024;
+  /**
+   * Number of nodes whose reverse edges are collected per device pass (0: as many as fit into
+   * half of the free device memory). Every pass reads the whole pruned graph.
+   */
+  size_t reverse_batch_size = 0;
+};
+
+/** Parameters of the import of an hnswlib index (see `cagra::from_hnswlib`). */
+struct hnswlib_import_params {
+  /** Degree of the CAGRA graph; 0: the degree of the base layer of the hnswlib index (maxM0). */
+  size_t graph_degree = 0;
+  /**
+   * Whether to prune the neighbor lists with `cagra::optimize` rather than keep the nearest
+   * `graph_degree` neighbors of every node. The input of the pruning is the neighbor lists padded
+   * to `2 * graph_degree` (or maxM0 if greater).
+   */
+  bool optimize = false;
+  /**
+   * The metric of the index; hnswlib does not save it in the file. The `ip` space of hnswlib is
+   * InnerProduct, its `cosine` space (normalized vectors) is InnerProduct or CosineExpanded.
+   */
+  raft::distance::DistanceType metric = raft::distance::DistanceType::L2Expanded;
 };
 
 enum class search_algo {
@@ -116,16 +219,70 @@ struct search_params : ann::search_params {
   uint32_t num_random_samplings = 1;
   /** Bit mask used for initial random seed node selection. */
   uint64_t rand_xor_mask = 0x128394;
+
+  /**
+   * Fraction of the dataset rows rejected by the sample filter of `search_with_filtering`.
+   *
+   * The internal top-k buffer is enlarged to `itopk_size / (1 - filtering_rate)` so that enough
+   * candidates pass the filter. When negative, it is computed from the filter if it is a
+   * `filtering::bitset_filter`, and no adjustment is made for other filters.
+   */
+  float filtering_rate = -1.0;
+  /**
+   * When a `filtering::bitset_filter` passes less than this fraction of the dataset rows,
+   * `search_with_filtering` does an exact brute-force search over these rows instead of
+   * traversing the graph. 0 disables the fallback.
+   */
+  float filter_brute_force_threshold = 0.01;
+  /**
+   * Whether to sort the queries by their nearest entry point (see `index::entry_points`, or a
+   * sample of the dataset rows if the index has none) before the search; the results are returned
+   * in the input order.
+   *
+   * The queries searched at the same time then traverse the same regions of the graph and share
+   * the cached dataset rows and neighbor lists, which helps large batches of unrelated queries.
+   * Ignored by the search plans and with the sample filters that depend on the query.
+   */
+  bool reorder_queries = false;
+};
+
+struct range_search_params : search_params {
+  /** Number of neighbors searched per query in the first round of `cagra::range_search`. */
+  uint32_t initial_k = 64;
+  /**
+   * Upper limit of the neighborhood size of a query. The queries whose `k` search results are all
+   * within the radius are searched again for `2 * k` neighbors, up to this limit.
+   */
+  uint32_t max_k = 512;
+};
+
+struct extend_params {
+  /**
+   * Number of new vectors processed together in one step of `cagra::extend`.
+   *
+   * Vectors added in the same step are not linked to each other, only to the nodes of the index
+   * grown by the previous steps, so smaller chunks give a better connected graph at the cost of
+   * more search calls. Auto select when 0 (at most 1024, and at most the current index size).
+   */
+  uint32_t max_chunk_size = 0;
 };
 
 static_assert(std::is_aggregate_v<index_params>);
 static_assert(std::is_aggregate_v<search_params>);
+static_assert(std::is_aggregate_v<range_search_params>);
+static_assert(std::is_aggregate_v<extend_params>);
 
 /**
  * @brief CAGRA index.
  *
  * The index stores the dataset and a kNN graph in device memory.
  *
+ * Thread safety: `cagra::search` and `cagra::search_with_filtering` take the index by const
+ * reference and never modify it, so any number of host threads may search one index concurrently,
+ * each with its own `raft::resources` (the temporary buffers of a search come from the resources of
+ * the call). The index must not be modified (extended, compacted, or updated) while it is being
+ * searched.
+ *
  * @tparam T data element type
  * @tparam IdxT type of the vector indices (represent dataset.extent(0))
  *
@@ -145,7 +302,7 @@ struct index : ann::index {
   /** Total length of the index (number of vectors). */
   [[nodiscard]] constexpr inline auto size() const noexcept -> IdxT
   {
-    return dataset_view_.extent(0);
+    return graph_bits_ > 0 ? packed_rows_ : graph_view_.extent(0);
   }
 
   /** Dimensionality of the data. */
@@ -166,13 +323,116 @@ struct index : ann::index {
     return dataset_view_;
   }
 
-  /** neighborhood graph [size, graph-degree] */
+  /**
+   * neighborhood graph [size, graph-degree]
+   *
+   * The view is empty ([0, graph-degree]) while the graph is compressed (`graph_bits() > 0`); the
+   * neighbor lists are then in `packed_graph()`.
+   */
   [[nodiscard]] inline auto graph() const noexcept
     -> device_matrix_view<const IdxT, int64_t, row_major>
   {
     return graph_view_;
   }
 
+  /** Number of bits per neighbor id in the packed graph, or 0 if the graph is not compressed. */
+  [[nodiscard]] constexpr inline auto graph_bits() const noexcept -> uint32_t
+  {
+    return graph_bits_;
+  }
+
+  /**
+   * The L2 norms of the dataset rows [size], used by the search with the CosineExpanded metric.
+   *
+   * They are computed by `cagra::build` (and by `deserialize`) and released whenever the dataset is
+   * replaced; if they are missing, the search computes them for the duration of the call.
+   */
+  [[nodiscard]] inline auto dataset_norms() const noexcept
+    -> device_vector_view<const float, int64_t>
+  {
+    return dataset_norms_.view();
+  }
+
+  /**
+   * The nodes evaluated first by the search to select its starting points, before the random
+   * samples; empty unless built by `cagra::build` (`index_params::n_entry_points`) or
+   * `cagra::build_entry_points`.
+   */
+  [[nodiscard]] inline auto entry_points() const noexcept
+    -> device_vector_view<const IdxT, int64_t>
+  {
+    return entry_points_.view();
+  }
+
+  /**
+   * The dataset row of every node [size], if the index was reordered by `cagra::build`
+   * (`index_params::reordering`); empty if the nodes are the dataset rows.
+   *
+   * The graph, the entry points and the nodes passed to the kernels refer to the positions in the
+   * index, while `cagra::search` returns (and the sample filters receive) the dataset rows.
+   */
+  [[nodiscard]] inline auto source_indices() const noexcept
+    -> device_vector_view<const IdxT, int64_t>
+  {
+    return source_indices_.view();
+  }
+
+  /**
+   * Keep an externally managed allocation alive as long as the index.
+   *
+   * This is the ownership model of the indices whose dataset and graph are references to memory
+   * the index does not allocate, e.g. the device memory mapped from another process by
+   * `cagra::import_ipc`: the views of the index point into `storage`, which is released (by its
+   * deleter) with the last index holding it.
+   */
+  void attach_external_storage(std::shared_ptr<void> storage)
+  {
+    external_storage_ = std::move(storage);
+  }
+
+  /** The external allocation attached with `attach_external_storage`, if any. */
+  [[nodiscard]] inline auto external_storage() const noexcept -> const std::shared_ptr<void>&
+  {
+    return external_storage_;
+  }
+
+  /** Number of nodes marked by `cagra::remove` and not yet dropped by `cagra::compact`. */
+  [[nodiscard]] constexpr inline auto n_removed() const noexcept -> int64_t { return n_removed_; }
+
+  /**
+   * One bit per node, set for the nodes that have not been removed, in the layout of
+   * `raft::core::bitset<uint32_t>`. Empty if no node has ever been removed.
+   */
+  [[nodiscard]] inline auto alive_bits() const noexcept
+    -> device_vector_view<const uint32_t, int64_t>
+  {
+    return alive_bits_.view();
+  }
+
+  /** A sample filter that rejects the removed nodes (only valid while `n_removed() > 0`). */
+  [[nodiscard]] inline auto removed_filter() const noexcept
+    -> raft::neighbors::filtering::removed_cagra_sample_filter
+  {
+    return raft::neighbors::filtering::removed_cagra_sample_filter{alive_bits_.data_handle()};
+  }
+
+  /**
+   * Number of 32-bit words needed to store a bit-packed graph, including one padding word that lets
+   * the search kernels always read two consecutive words.
+   */
+  static constexpr inline auto packed_graph_words(int64_t n_rows, int64_t degree, uint32_t bits)
+    -> int64_t
+  {
+    return raft::div_rounding_up_safe<int64_t>(n_rows * degree * bits, 32) + 1;
+  }
+
+  /** Bit-packed neighbor lists (empty unless the graph is compressed). */
+  [[nodiscard]] inline auto packed_graph() const noexcept
+    -> device_vector_view<const uint32_t, int64_t>
+  {
+    return packed_graph_.view();
+  }
+
   // Don't allow copying the index for performance reasons (try avoiding copying data)
   index(const index&)                    = delete;
   index(index&&)                         = default;
@@ -186,7 +446,12 @@ struct index : ann::index {
     : ann::index(),
       metric_(metric),
       dataset_(make_device_matrix<T, int64_t>(res, 0, 0)),
-      graph_(make_device_matrix<IdxT, int64_t>(res, 0, 0))
+      graph_(make_device_matrix<IdxT, int64_t>(res, 0, 0)),
+      packed_graph_(make_device_vector<uint32_t, int64_t>(res, 0)),
+      alive_bits_(make_device_vector<uint32_t, int64_t>(res, 0)),
+      dataset_norms_(make_device_vector<float, int64_t>(res, 0)),
+      entry_points_(make_device_vector<IdxT, int64_t>(res, 0)),
+      source_indices_(make_device_vector<IdxT, int64_t>(res, 0))
   {
   }
 
@@ -252,7 +517,12 @@ struct index : ann::index {
     : ann::index(),
       metric_(metric),
       dataset_(make_device_matrix<T, int64_t>(res, 0, 0)),
-      graph_(make_device_matrix<IdxT, int64_t>(res, 0, 0))
+      graph_(make_device_matrix<IdxT, int64_t>(res, 0, 0)),
+      packed_graph_(make_device_vector<uint32_t, int64_t>(res, 0)),
+      alive_bits_(make_device_vector<uint32_t, int64_t>(res, 0)),
+      dataset_norms_(make_device_vector<float, int64_t>(res, 0)),
+      entry_points_(make_device_vector<IdxT, int64_t>(res, 0)),
+      source_indices_(make_device_vector<IdxT, int64_t>(res, 0))
   {
     RAFT_EXPECTS(dataset.extent(0) == knn_graph.extent(0),
                  "Dataset and knn_graph must have equal number of rows");
@@ -271,15 +541,33 @@ struct index : ann::index {
   void update_dataset(raft::resources const& res,
                       raft::device_matrix_view<const T, int64_t, row_major> dataset)
   {
+    reset_dataset_norms(res);
     if (dataset.extent(1) * sizeof(T) % 16 != 0) {
       RAFT_LOG_DEBUG("Creating a padded copy of CAGRA dataset in device memory");
       copy_padded(res, dataset);
     } else {
+      release_dataset(res, dataset.data_handle());
       dataset_view_ = make_device_strided_matrix_view<const T, int64_t>(
         dataset.data_handle(), dataset.extent(0), dataset.extent(1), dataset.extent(1));
     }
   }
 
+  /**
+   * Replace the dataset with a padded device dataset, of which only a reference is stored.
+   *
+   * The row stride must be a multiple of 16 bytes. It is the caller's responsibility to ensure
+   * that the dataset stays alive as long as the index (see `attach_external_storage`).
+   */
+  void update_dataset(raft::resources const& res,
+                      raft::device_matrix_view<const T, int64_t, layout_stride> dataset)
+  {
+    RAFT_EXPECTS(dataset.stride(1) == 1 && dataset.stride(0) * sizeof(T) % 16 == 0,
+                 "The rows of the padded dataset must be contiguous and 16 bytes aligned");
+    reset_dataset_norms(res);
+    release_dataset(res, dataset.data_handle());
+    dataset_view_ = dataset;
+  }
+
   /**
    * Replace the dataset with a new dataset.
    *
@@ -289,9 +577,105 @@ struct index : ann::index {
                       raft::host_matrix_view<const T, int64_t, row_major> dataset)
   {
     RAFT_LOG_DEBUG("Copying CAGRA dataset from host to device");
+    reset_dataset_norms(res);
     copy_padded(res, dataset);
   }
 
+  /**
+   * Replace the dataset with a host-resident dataset that is read directly by the search kernels.
+   *
+   * No device copy is made: only a reference is stored and it is the caller's responsibility to
+   * keep the dataset alive as long as the index. The memory must be accessible from the device,
+   * i.e. allocated as pinned memory (`raft::make_pinned_matrix`, `cudaMallocHost`), registered with
+   * `cudaHostRegister`, or managed memory. The rows must be 16 bytes aligned.
+   *
+   * This allows searching datasets that do not fit in device memory while keeping the graph on the
+   * device. Each visited node reads its vector over the host interconnect, hence the search
+   * throughput is bound by the link bandwidth rather than the device memory bandwidth.
+   */
+  template <typename data_accessor>
+  void attach_host_dataset(
+    raft::resources const& res,
+    mdspan<const T, matrix_extent<int64_t>, row_major, data_accessor> dataset)
+  {
+    static_assert(data_accessor::is_host_accessible, "The dataset must reside in host memory");
+    cudaPointerAttributes attr;
+    RAFT_CUDA_TRY(cudaPointerGetAttributes(&attr, dataset.data_handle()));
+    RAFT_EXPECTS(attr.devicePointer != nullptr,
+                 "The host dataset must be accessible from the device (pinned, registered or "
+                 "managed memory)");
+    RAFT_EXPECTS(dataset.extent(1) * sizeof(T) % 16 == 0 &&
+                   reinterpret_cast<uintptr_t>(attr.devicePointer) % 16 == 0,
+                 "The rows of a host-resident dataset must be 16 bytes aligned");
+    RAFT_LOG_DEBUG("Attaching host-resident CAGRA dataset (%zu x %zu)",
+                   static_cast<size_t>(dataset.extent(0)),
+                   static_cast<size_t>(dataset.extent(1)));
+    // release the device copy, if any
+    if (dataset_.size()) { dataset_ = make_device_matrix<T, int64_t>(res, 0, 0); }
+    reset_dataset_norms(res);
+    dataset_view_ = make_device_strided_matrix_view<const T, int64_t>(
+      reinterpret_cast<const T*>(attr.devicePointer),
+      dataset.extent(0),
+      dataset.extent(1),
+      dataset.extent(1));
+  }
+
+  /**
+   * Replace the dataset with a new dataset, transferring the ownership of the device array to the
+   * index.
+   *
+   * Only the first `dim` columns of each row are considered part of the dataset, the rest is
+   * padding. The row width of `dataset` must be a multiple of 16 bytes.
+   */
+  void update_dataset(raft::resources const& res,
+                      raft::device_matrix<T, int64_t, row_major>&& dataset,
+                      uint32_t dim)
+  {
+    RAFT_EXPECTS(dataset.extent(1) * sizeof(T) % 16 == 0,
+                 "The rows of the padded dataset must be 16 bytes aligned");
+    RAFT_EXPECTS(dim <= dataset.extent(1), "dim cannot be larger than the padded row width");
+    reset_dataset_norms(res);
+    dataset_      = std::move(dataset);
+    dataset_view_ = make_device_strided_matrix_view<const T, int64_t>(
+      dataset_.data_handle(), dataset_.extent(0), dim, dataset_.extent(1));
+  }
+
+  /**
+   * Set the norms of the dataset rows (see `dataset_norms()`), transferring the ownership of the
+   * device array to the index.
+   */
+  void update_dataset_norms(raft::resources const& res,
+                            raft::device_vector<float, int64_t>&& norms)
+  {
+    RAFT_EXPECTS(norms.extent(0) == dataset_view_.extent(0),
+                 "The dataset norms must have one element per dataset row");
+    dataset_norms_ = std::move(norms);
+  }
+
+  /**
+   * Set the entry points of the search (see `entry_points()`), transferring the ownership of the
+   * device array to the index. Pass an empty vector to disable them.
+   */
+  void update_entry_points(raft::resources const& res,
+                           raft::device_vector<IdxT, int64_t>&& entry_points)
+  {
+    RAFT_EXPECTS(entry_points.extent(0) <= int64_t(size()),
+                 "There cannot be more entry points than nodes");
+    entry_points_ = std::move(entry_points);
+  }
+
+  /**
+   * Set the dataset row of every node (see `source_indices()`), transferring the ownership of the
+   * device array to the index. Pass an empty vector if the nodes are the dataset rows.
+   */
+  void update_source_indices(raft::resources const& res,
+                             raft::device_vector<IdxT, int64_t>&& source_indices)
+  {
+    RAFT_EXPECTS(source_indices.extent(0) == 0 || source_indices.extent(0) == int64_t(size()),
+                 "The source indices must have one element per node");
+    source_indices_ = std::move(source_indices);
+  }
+
   /**
    * Replace the graph with a new graph.
    *
@@ -301,6 +685,12 @@ struct index : ann::index {
   void update_graph(raft::resources const& res,
                     raft::device_matrix_view<const IdxT, int64_t, row_major> knn_graph)
   {
+    reset_packed_graph(res);
+    // the device copy owned by the index, if any, is not referenced anymore
+    const IdxT* p = knn_graph.data_handle();
+    if (graph_.size() && (p < graph_.data_handle() || p >= graph_.data_handle() + graph_.size())) {
+      graph_ = make_device_matrix<IdxT, int64_t>(res, 0, 0);
+    }
     graph_view_ = knn_graph;
   }
 
@@ -313,6 +703,7 @@ struct index : ann::index {
                     raft::host_matrix_view<const IdxT, int64_t, row_major> knn_graph)
   {
     RAFT_LOG_DEBUG("Copying CAGRA knn graph from host to device");
+    reset_packed_graph(res);
     if ((graph_.extent(0) != knn_graph.extent(0)) || (graph_.extent(1) != knn_graph.extent(1))) {
       // clear existing memory before allocating to prevent OOM errors on large graphs
       if (graph_.size()) { graph_ = make_device_matrix<IdxT, int64_t>(res, 0, 0); }
@@ -325,7 +716,171 @@ struct index : ann::index {
     graph_view_ = graph_.view();
   }
 
+  /**
+   * Replace the graph with a new graph, transferring the ownership of the device array to the
+   * index.
+   */
+  void update_graph(raft::resources const& res,
+                    raft::device_matrix<IdxT, int64_t, row_major>&& knn_graph)
+  {
+    reset_packed_graph(res);
+    graph_      = std::move(knn_graph);
+    graph_view_ = graph_.view();
+  }
+
+  /**
+   * Mutable view of the alive-node bitset (see `alive_bits()`), allocated with all nodes alive on
+   * first use. Used by `cagra::remove`, which keeps `n_removed()` in sync with `update_n_removed`.
+   */
+  auto alive_bits(raft::resources const& res) -> device_vector_view<uint32_t, int64_t>
+  {
+    const int64_t n_words = raft::div_rounding_up_safe<int64_t>(size(), 32);
+    if (alive_bits_.extent(0) != n_words) {
+      alive_bits_ = make_device_vector<uint32_t, int64_t>(res, n_words);
+      RAFT_CUDA_TRY(cudaMemsetAsync(alive_bits_.data_handle(),
+                                    0xff,
+                                    n_words * sizeof(uint32_t),
+                                    resource::get_cuda_stream(res)));
+      n_removed_ = 0;
+    }
+    return alive_bits_.view();
+  }
+
+  /** Set the number of removed nodes, releasing the alive-node bitset when it drops to 0. */
+  void update_n_removed(raft::resources const& res, int64_t n_removed)
+  {
+    RAFT_EXPECTS(n_removed >= 0 && n_removed <= int64_t(size()),
+                 "Invalid number of removed nodes");
+    n_removed_ = n_removed;
+    if (n_removed_ == 0) { alive_bits_ = make_device_vector<uint32_t, int64_t>(res, 0); }
+  }
+
+  /**
+   * Store the neighbor lists in a fixed-width bit-packed layout.
+   *
+   * Every neighbor id is stored with `ceil(log2(size()))` bits instead of `sizeof(IdxT) * 8`, which
+   * shrinks the graph by 2-3x for typical index sizes while keeping constant-time access to any
+   * edge during the search. The dense graph is released after packing; use `decompress_graph` to
+   * restore it (e.g. before extending the index or exporting it to hnswlib).
+   *
+   * Usage example:
+   * @code{.cpp}
+   *   auto index = cagra::build(res, index_params, dataset);
+   *   index.compress_graph(res);
+   *   cagra::search(res, search_params, index, queries, neighbors, distances);
+   * @endcode
+   */
+  void compress_graph(raft::resources const& res)
+  {
+    if (graph_bits_ > 0) { return; }
+    const int64_t n_rows = graph_view_.extent(0);
+    const int64_t degree = graph_view_.extent(1);
+    RAFT_EXPECTS(n_rows > 0, "Cannot compress an empty graph");
+
+    uint32_t bits = 1;
+    while (bits < 32 && (uint64_t(1) << bits) < uint64_t(n_rows)) {
+      bits++;
+    }
+
+    auto stream     = resource::get_cuda_stream(res);
+    auto host_graph = make_host_matrix<IdxT, int64_t>(n_rows, degree);
+    raft::copy(host_graph.data_handle(), graph_view_.data_handle(), graph_view_.size(), stream);
+    resource::sync_stream(res);
+
+    const int64_t n_words = packed_graph_words(n_rows, degree, bits);
+    auto host_words        = make_host_vector<uint32_t, int64_t>(n_words);
+    std::fill(host_words.data_handle(), host_words.data_handle() + n_words, 0u);
+    for (int64_t pos = 0; pos < n_rows * degree; pos++) {
+      const uint64_t v = host_graph.data_handle()[pos];
+      RAFT_EXPECTS(v < uint64_t(n_rows),
+                   "Graph contains an invalid neighbor id %zu",
+                   static_cast<size_t>(v));
+      const uint64_t bit   = pos * bits;
+      const uint64_t word  = bit >> 5;
+      const uint32_t shift = bit & 31;
+      host_words(word) |= static_cast<uint32_t>(v << shift);
+      if (shift + bits > 32) { host_words(word + 1) |= static_cast<uint32_t>(v >> (32 - shift)); }
+    }
+    update_packed_graph(res, host_words.view(), n_rows, degree, bits);
+  }
+
+  /** Restore the dense [size, graph-degree] graph from the bit-packed layout. */
+  void decompress_graph(raft::resources const& res)
+  {
+    if (graph_bits_ == 0) { return; }
+    const int64_t n_rows = size();
+    const int64_t degree = graph_degree();
+    const uint32_t bits  = graph_bits_;
+
+    auto stream     = resource::get_cuda_stream(res);
+    auto host_words = make_host_vector<uint32_t, int64_t>(packed_graph_.size());
+    raft::copy(host_words.data_handle(), packed_graph_.data_handle(), packed_graph_.size(), stream);
+    resource::sync_stream(res);
+
+    auto host_graph     = make_host_matrix<IdxT, int64_t>(n_rows, degree);
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    for (int64_t pos = 0; pos < n_rows * degree; pos++) {
+      const uint64_t bit   = pos * bits;
+      const uint64_t word  = bit >> 5;
+      const uint32_t shift = bit & 31;
+      const uint64_t v     = (uint64_t(host_words(word + 1)) << 32) | host_words(word);
+      host_graph.data_handle()[pos] = static_cast<IdxT>((v >> shift) & mask);
+    }
+    update_graph(res, raft::make_const_mdspan(host_graph.view()));
+    resource::sync_stream(res);
+  }
+
+  /**
+   * Replace the graph with an already bit-packed graph (as produced by `compress_graph`).
+   *
+   * The words are copied to the device and the dense graph, if any, is released; `graph()` is
+   * empty until the graph is decompressed or replaced.
+   */
+  void update_packed_graph(raft::resources const& res,
+                           raft::host_vector_view<const uint32_t, int64_t> words,
+                           int64_t n_rows,
+                           int64_t degree,
+                           uint32_t bits)
+  {
+    RAFT_EXPECTS(bits > 0 && bits <= 32, "Invalid number of bits per neighbor id: %u", bits);
+    RAFT_EXPECTS(words.extent(0) >= packed_graph_words(n_rows, degree, bits),
+                 "The packed graph is too small for %ld rows of degree %ld",
+                 n_rows,
+                 degree);
+    graph_        = make_device_matrix<IdxT, int64_t>(res, 0, 0);
+    packed_graph_ = make_device_vector<uint32_t, int64_t>(res, words.extent(0));
+    raft::copy(packed_graph_.data_handle(),
+               words.data_handle(),
+               words.extent(0),
+               resource::get_cuda_stream(res));
+    graph_bits_  = bits;
+    packed_rows_ = n_rows;
+    graph_view_  = make_device_matrix_view<const IdxT, int64_t>(nullptr, 0, degree);
+  }
+
  private:
+  void reset_packed_graph(raft::resources const& res)
+  {
+    if (graph_bits_ == 0) { return; }
+    packed_graph_ = make_device_vector<uint32_t, int64_t>(res, 0);
+    graph_bits_   = 0;
+    packed_rows_  = 0;
+  }
+
+  /** Release the device copy of the dataset owned by the index, unless `p` points into it. */
+  void release_dataset(raft::resources const& res, const T* p)
+  {
+    if (dataset_.size() == 0) { return; }
+    if (p >= dataset_.data_handle() && p < dataset_.data_handle() + dataset_.size()) { return; }
+    dataset_ = make_device_matrix<T, int64_t>(res, 0, 0);
+  }
+
+  void reset_dataset_norms(raft::resources const& res)
+  {
+    if (dataset_norms_.size() == 0) { return; }
+    dataset_norms_ = make_device_vector<float, int64_t>(res, 0);
+  }
+
   /** Create a device copy of the dataset, and pad it if necessary. */
   template <typename data_accessor>
   void copy_padded(raft::resources const& res,
@@ -346,6 +901,15 @@ struct index : ann::index {
   raft::device_matrix<IdxT, int64_t, row_major> graph_;
   raft::device_matrix_view<const T, int64_t, layout_stride> dataset_view_;
   raft::device_matrix_view<const IdxT, int64_t, row_major> graph_view_;
+  raft::device_vector<uint32_t, int64_t> packed_graph_;
+  uint32_t graph_bits_ = 0;
+  int64_t packed_rows_ = 0;
+  raft::device_vector<uint32_t, int64_t> alive_bits_;
+  int64_t n_removed_ = 0;
+  raft::device_vector<float, int64_t> dataset_norms_;
+  raft::device_vector<IdxT, int64_t> entry_points_;
+  raft::device_vector<IdxT, int64_t> source_indices_;
+  std::shared_ptr<void> external_storage_;
 };
 
 /** @} */
@@ -355,6 +919,7 @@ struct index : ann::index {
 // TODO: Remove deprecated experimental namespace in 23.12 release
 namespace raft::neighbors::experimental::cagra {
 using raft::neighbors::cagra::graph_build_algo;
+using raft::neighbors::cagra::graph_reordering;
 using raft::neighbors::cagra::hash_mode;
 using raft::neighbors::cagra::index;
 using raft::neighbors::cagra::index_params;
@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "../../cagra_types.hpp"
+#include "cagra_search.cuh"
+#include "utils.hpp"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/neighbors/sample_filter_types.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+#include <raft/util/cuda_rt_essentials.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+namespace raft::neighbors::cagra::detail {
+
+/** Count the number of incoming edges of every node of the graph. */
+template <class IdxT>
+RAFT_KERNEL kern_count_incoming_edges(const IdxT* const graph,  // [graph_size, graph_degree]
+                                      const uint64_t graph_size,
+                                      const uint32_t graph_degree,
+                                      uint32_t* const in_degree)  // [graph_size]
+{
+  const uint64_t tid  = threadIdx.x + static_cast<uint64_t>(blockDim.x) * blockIdx.x;
+  const uint64_t tnum = static_cast<uint64_t>(blockDim.x) * gridDim.x;
+  for (uint64_t i = tid; i < graph_size * graph_degree; i += tnum) {
+    const IdxT dst = graph[i];
+    if (dst < graph_size) { atomicAdd(in_degree + dst, 1u); }
+  }
+}
+
+/**
+ * For every new node (one block per node) and every candidate neighbor B in its rank ordered
+ * candidate list, count the number of 2-hop detours A->D->B where D is a candidate with a smaller
+ * rank than B. This is the same criterion as the one used by `graph::optimize`.
+ */
+template <class IdxT>
+RAFT_KERNEL kern_count_detours(const IdxT* const graph,  // [graph_size, graph_degree]
+                               const uint64_t graph_size,
+                               const uint32_t graph_degree,
+                               const IdxT* const candidates,  // [batch_size, num_candidates]
+                               const uint32_t num_candidates,
+                               uint32_t* const detour_count)  // [batch_size, num_candidates]
+{
+  extern __shared__ uint32_t smem_detour_count[];  // [num_candidates]
+
+  const uint64_t row         = blockIdx.x;
+  const IdxT* const cand_row = candidates + row * num_candidates;
+  for (uint32_t i = threadIdx.x; i < num_candidates; i += blockDim.x) {
+    smem_detour_count[i] = 0;
+  }
+  __syncthreads();
+
+  for (uint32_t j = 0; j + 1 < num_candidates; j++) {
+    const IdxT d = cand_row[j];
+    if (d >= graph_size) { continue; }
+    for (uint32_t k = threadIdx.x; k < graph_degree; k += blockDim.x) {
+      const IdxT b = graph[k + static_cast<uint64_t>(graph_degree) * d];
+      for (uint32_t i = j + 1; i < num_candidates; i++) {
+        if (cand_row[i] == b) {
+          atomicAdd(smem_detour_count + i, 1u);
+          break;
+        }
+      }
+    }
+  }
+  __syncthreads();
+
+  for (uint32_t i = threadIdx.x; i < num_candidates; i += blockDim.x) {
+    detour_count[i + row * num_candidates] = smem_detour_count[i];
+  }
+}
+
+/** Copy the rows `row_ids` of `src` into the contiguous buffer `dst`. */
+template <class IdxT>
+RAFT_KERNEL kern_gather_rows(const IdxT* const src,  // [src_size, degree]
+                             const uint32_t degree,
+                             const IdxT* const row_ids,  // [num_rows]
+                             const uint32_t num_rows,
+                             IdxT* const dst)  // [num_rows, degree]
+{
+  const uint64_t tid = threadIdx.x + static_cast<uint64_t>(blockDim.x) * blockIdx.x;
+  if (tid >= static_cast<uint64_t>(num_rows) * degree) { return; }
+  const uint64_t i = tid / degree;
+  const uint64_t k = tid % degree;
+  dst[tid]         = src[k + static_cast<uint64_t>(degree) * row_ids[i]];
+}
+
+/** Copy the contiguous buffer `src` into the rows `row_ids` of `dst`. */
+template <class IdxT>
+RAFT_KERNEL kern_scatter_rows(const IdxT* const src,  // [num_rows, degree]
+                              const uint32_t degree,
+                              const IdxT* const row_ids,  // [num_rows]
+                              const uint32_t num_rows,
+                              IdxT* const dst)  // [dst_size, degree]
+{
+  const uint64_t tid = threadIdx.x + static_cast<uint64_t>(blockDim.x) * blockIdx.x;
+  if (tid >= static_cast<uint64_t>(num_rows) * degree) { return; }
+  const uint64_t i = tid / degree;
+  const uint64_t k = tid % degree;
+  dst[k + static_cast<uint64_t>(degree) * row_ids[i]] = src[tid];
+}
+
+/**
+ * Compute the adjacency lists of the new nodes and insert reverse edges into the existing graph.
+ *
+ * The new vectors are added in chunks. The neighbors of a new node are found by searching the
+ * graph grown by the previous chunks, ordered by the 2-hop detour count, and interleaved with the
+ * edges they displace from the reverse edge insertion. Hence, a new node can be linked to the new
+ * nodes of the previous chunks, but not to the ones of its own chunk. Only the rows affected by
+ * the insertion are transferred between the host and the device, so the cost of a step scales
+ * with the number of added vectors.
+ *
+ * @param[in] res
+ * @param[in] idx the index before extension (its metric and entry points are used by the search)
+ * @param[in] dataset the dataset of the extended index [idx.size() + num_add, dim], where the
+ *   last num_add rows are the new vectors
+ * @param[in] additional_dataset the new vectors [num_add, dim]
+ * @param[inout] graph the graph of the extended index [idx.size() + num_add, graph_degree], where
+ *   the first idx.size() rows are a copy of the graph of `idx`.
+ * @param[in] max_chunk_size the number of new vectors processed together
+ */
+template <typename T, typename IdxT, typename Accessor>
+void add_node_core(raft::resources const& res,
+                   const index<T, IdxT>& idx,
+                   raft::device_matrix_view<const T, int64_t, layout_stride> dataset,
+                   mdspan<const T, matrix_extent<int64_t>, row_major, Accessor> additional_dataset,
+                   raft::device_matrix_view<IdxT, int64_t, row_major> graph,
+                   uint32_t max_chunk_size)
+{
+  using internal_IdxT = typename std::make_unsigned<IdxT>::type;
+
+  auto* const graph_ptr     = reinterpret_cast<internal_IdxT*>(graph.data_handle());
+  auto stream               = resource::get_cuda_stream(res);
+  auto mr                   = resource::get_workspace_resource(res);
+  const uint64_t old_size   = idx.size();
+  const uint64_t num_add    = additional_dataset.extent(0);
+  const uint64_t new_size   = old_size + num_add;
+  const uint32_t degree     = idx.graph_degree();
+  const uint32_t dim        = idx.dim();
+  const uint32_t num_rev    = degree / 2;
+  const uint32_t base_range = degree / 2;
+  const uint32_t base_degree =
+    static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(degree) * 2, old_size));
+
+  // Number of incoming edges; used to choose which edge of a neighbor is replaced by a reverse
+  // edge pointing to the new node (the most redundant one).
+  auto in_degree   = raft::make_host_vector<uint32_t, int64_t>(new_size);
+  auto d_in_degree = raft::make_device_mdarray<uint32_t>(res, mr, make_extents<int64_t>(old_size));
+  RAFT_CUDA_TRY(
+    cudaMemsetAsync(d_in_degree.data_handle(), 0, sizeof(uint32_t) * old_size, stream));
+  kern_count_incoming_edges<internal_IdxT>
+    <<<1024, 256, 0, stream>>>(graph_ptr, old_size, degree, d_in_degree.data_handle());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  raft::copy(in_degree.data_handle(), d_in_degree.data_handle(), old_size, stream);
+  std::fill(in_degree.data_handle() + old_size, in_degree.data_handle() + new_size, 0u);
+
+  cagra::search_params params;
+  params.itopk_size = std::max<size_t>(base_degree * 2, 256);
+
+  // The norms of all the rows are computed once; every step searches a prefix of them.
+  const bool cosine = idx.metric() == raft::distance::DistanceType::CosineExpanded;
+  auto norms        = raft::make_device_vector<float, int64_t>(res, cosine ? new_size : 0);
+  if (cosine) { compute_row_norms(res, dataset, norms.view()); }
+
+  auto d_candidates = raft::make_device_mdarray<internal_IdxT>(
+    res, mr, make_extents<int64_t>(max_chunk_size, base_degree));
+  auto d_candidate_distances =
+    raft::make_device_mdarray<float>(res, mr, make_extents<int64_t>(max_chunk_size, base_degree));
+  auto d_detour_count = raft::make_device_mdarray<uint32_t>(
+    res, mr, make_extents<int64_t>(max_chunk_size, base_degree));
+  auto candidates   = raft::make_host_matrix<internal_IdxT, int64_t>(max_chunk_size, base_degree);
+  auto detour_count = raft::make_host_matrix<uint32_t, int64_t>(max_chunk_size, base_degree);
+  auto new_rows     = raft::make_host_matrix<internal_IdxT, int64_t>(max_chunk_size, degree);
+  auto d_new_ids    = raft::make_device_mdarray<internal_IdxT>(res, mr, make_extents<int64_t>(0));
+  auto d_rows       = raft::make_device_mdarray<internal_IdxT>(res, mr, make_extents<int64_t>(0));
+
+  raft::spatial::knn::detail::utils::batch_load_iterator<T> batches(
+    additional_dataset.data_handle(), num_add, dim, max_chunk_size, stream, mr);
+
+  for (const auto& batch : batches) {
+    const uint32_t batch_size = batch.size();
+    const uint64_t first_id   = old_size + batch.offset();
+
+    // Step 1: search the base_degree nearest neighbors of the new vectors in the graph of the
+    // first_id nodes added so far, whose edges all point to nodes below first_id.
+    index<T, IdxT> grown_idx(res, idx.metric());
+    grown_idx.update_dataset(res,
+                             raft::make_device_strided_matrix_view<const T, int64_t>(
+                               dataset.data_handle(), first_id, dim, dataset.stride(0)));
+    grown_idx.update_graph(res,
+                           raft::make_device_matrix_view<const IdxT, int64_t>(
+                             graph.data_handle(), first_id, degree));
+    if (cosine) {
+      auto grown_norms = raft::make_device_vector<float, int64_t>(res, first_id);
+      raft::copy(grown_norms.data_handle(), norms.data_handle(), first_id, stream);
+      grown_idx.update_dataset_norms(res, std::move(grown_norms));
+    }
+    if (idx.entry_points().extent(0) > 0) {
+      const int64_t n_entry_points = idx.entry_points().extent(0);
+      auto entry_points            = raft::make_device_vector<IdxT, int64_t>(res, n_entry_points);
+      raft::copy(
+        entry_points.data_handle(), idx.entry_points().data_handle(), n_entry_points, stream);
+      grown_idx.update_entry_points(res, std::move(entry_points));
+    }
+    auto queries_view =
+      raft::make_device_matrix_view<const T, int64_t>(batch.data(), batch_size, dim);
+    auto candidates_view = raft::make_device_matrix_view<internal_IdxT, int64_t>(
+      d_candidates.data_handle(), batch_size, base_degree);
+    auto distances_view = raft::make_device_matrix_view<float, int64_t>(
+      d_candidate_distances.data_handle(), batch_size, base_degree);
+    search_main<T, internal_IdxT, raft::neighbors::filtering::none_cagra_sample_filter, IdxT>(
+      res,
+      params,
+      grown_idx,
+      queries_view,
+      candidates_view,
+      distances_view,
+      raft::neighbors::filtering::none_cagra_sample_filter());
+
+    // Step 2: count the detourable edges of the candidates.
+    kern_count_detours<internal_IdxT><<<batch_size, 32, sizeof(uint32_t) * base_degree, stream>>>(
+      graph_ptr,
+      first_id,
+      degree,
+      d_candidates.data_handle(),
+      base_degree,
+      d_detour_count.data_handle());
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    raft::copy(candidates.data_handle(),
+               d_candidates.data_handle(),
+               static_cast<size_t>(batch_size) * base_degree,
+               stream);
+    raft::copy(detour_count.data_handle(),
+               d_detour_count.data_handle(),
+               static_cast<size_t>(batch_size) * base_degree,
+               stream);
+    resource::sync_stream(res);
+
+    // Rank-based ordering: fewer detours first, ties keep the distance order of the search.
+    bool all_found = true;
+#pragma omp parallel for reduction(&& : all_found)
+    for (int64_t i = 0; i < static_cast<int64_t>(batch_size); i++) {
+      std::vector<uint32_t> order(base_degree);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return detour_count(i, a) < detour_count(i, b);
+      });
+      uint32_t num_valid = 0;
+      for (uint32_t j = 0; j < base_degree && num_valid < degree; j++) {
+        const auto c = candidates(i, order[j]);
+        if (c >= first_id) { continue; }
+        new_rows(i, num_valid++) = static_cast<internal_IdxT>(c);
+      }
+      if (num_valid == 0) {
+        all_found = false;
+        continue;
+      }
+      // Not enough neighbors found (tiny index), repeat the valid ones.
+      for (uint32_t j = num_valid; j < degree; j++) {
+        new_rows(i, j) = new_rows(i, j % num_valid);
+      }
+    }
+    RAFT_EXPECTS(all_found, "Could not find any neighbor for some of the new vectors");
+
+    // Step 3: fetch the adjacency lists of the nodes that receive reverse edges.
+    std::unordered_map<internal_IdxT, uint32_t> target_pos;
+    std::vector<internal_IdxT> target_ids;
+    for (uint32_t i = 0; i < batch_size; i++) {
+      for (uint32_t j = 0; j < num_rev; j++) {
+        const internal_IdxT t = new_rows(i, j);
+        if (target_pos.emplace(t, target_ids.size()).second) { target_ids.push_back(t); }
+      }
+    }
+    const uint32_t num_targets = target_ids.size();
+    if (d_new_ids.extent(0) < num_targets) {
+      d_new_ids =
+        raft::make_device_mdarray<internal_IdxT>(res, mr, make_extents<int64_t>(num_targets));
+      d_rows = raft::make_device_mdarray<internal_IdxT>(
+        res, mr, make_extents<int64_t>(static_cast<int64_t>(num_targets) * degree));
+    }
+    auto target_rows          = raft::make_host_matrix<internal_IdxT, int64_t>(num_targets, degree);
+    const uint32_t block_size = 256;
+    const uint32_t grid_size =
+      raft::ceildiv<uint64_t>(static_cast<uint64_t>(num_targets) * degree, block_size);
+    if (num_targets > 0) {
+      raft::copy(d_new_ids.data_handle(), target_ids.data(), num_targets, stream);
+      kern_gather_rows<internal_IdxT><<<grid_size, block_size, 0, stream>>>(
+        graph_ptr, degree, d_new_ids.data_handle(), num_targets, d_rows.data_handle());
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+      raft::copy(target_rows.data_handle(),
+                 d_rows.data_handle(),
+                 static_cast<size_t>(num_targets) * degree,
+                 stream);
+      resource::sync_stream(res);
+    }
+
+    // Step 4: insert the reverse edges. For each of the first `num_rev` neighbors of a new node,
+    // replace the most redundant edge (highest in-degree) of the less important half of the
+    // neighbor's list by an edge to the new node. The replaced node becomes a neighbor of the new
+    // node, so that the 2-hop connectivity of the graph is preserved.
+    std::vector<internal_IdxT> rev_edges(num_rev);
+    std::vector<internal_IdxT> merged(degree);
+    for (uint32_t i = 0; i < batch_size; i++) {
+      const internal_IdxT new_id = first_id + i;
+      uint32_t num_rev_kept      = 0;
+      for (uint32_t j = 0; j < num_rev; j++) {
+        internal_IdxT* row =
+          target_rows.data_handle() + static_cast<uint64_t>(target_pos[new_rows(i, j)]) * degree;
+        int64_t replace_pos    = -1;
+        uint32_t replace_count = 0;
+        for (int64_t k = degree - 1; k >= static_cast<int64_t>(base_range); k--) {
+          const internal_IdxT n = row[k];
+          if (n >= new_size || n == new_id || in_degree(n) <= replace_count) { continue; }
+          if (std::find(rev_edges.begin(), rev_edges.begin() + num_rev_kept, n) !=
+              rev_edges.begin() + num_rev_kept) {
+            continue;
+          }
+          replace_pos   = k;
+          replace_count = in_degree(n);
+        }
+        if (replace_pos < 0) { continue; }
+        rev_edges[num_rev_kept++] = row[replace_pos];
+        in_degree(row[replace_pos])--;
+        in_degree(new_id)++;
+        row[replace_pos] = new_id;
+      }
+
+      // Interleave the rank-based list with the displaced nodes.
+      uint32_t num_merged           = 0;
+      uint32_t pos[2]               = {0, 0};
+      const uint32_t len[2]         = {degree, num_rev_kept};
+      const internal_IdxT* lists[2] = {new_rows.data_handle() + static_cast<uint64_t>(i) * degree,
+                                       rev_edges.data()};
+      for (uint32_t s = 0; num_merged < degree; s = 1 - s) {
+        if (pos[0] >= len[0] && pos[1] >= len[1]) { break; }
+        for (; pos[s] < len[s]; pos[s]++) {
+          const internal_IdxT c = lists[s][pos[s]];
+          if (std::find(merged.begin(), merged.begin() + num_merged, c) ==
+              merged.begin() + num_merged) {
+            merged[num_merged++] = c;
+            pos[s]++;
+            break;
+          }
+        }
+      }
+      for (uint32_t k = num_merged; k < degree; k++) {
+        merged[k] = merged[k % num_merged];
+      }
+      for (uint32_t k = 0; k < degree; k++) {
+        new_rows(i, k) = merged[k];
+        if (k < num_merged) { in_degree(merged[k])++; }
+      }
+    }
+
+    // Step 5: write back the modified rows and the rows of the new nodes.
+    if (num_targets > 0) {
+      raft::copy(d_rows.data_handle(),
+                 target_rows.data_handle(),
+                 static_cast<size_t>(num_targets) * degree,
+                 stream);
+      kern_scatter_rows<internal_IdxT><<<grid_size, block_size, 0, stream>>>(
+        d_rows.data_handle(), degree, d_new_ids.data_handle(), num_targets, graph_ptr);
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    }
+    raft::copy(graph_ptr + first_id * degree,
+               new_rows.data_handle(),
+               static_cast<size_t>(batch_size) * degree,
+               stream);
+    // The host buffers are reused in the next iteration
+    resource::sync_stream(res);
+  }
+}
+
+template <typename T, typename IdxT, typename Accessor>
+void extend(raft::resources const& res,
+            const extend_params& params,
+            mdspan<const T, matrix_extent<int64_t>, row_major, Accessor> additional_dataset,
+            index<T, IdxT>& idx)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::extend(%zu, %zu)",
+    static_cast<size_t>(idx.size()),
+    static_cast<size_t>(additional_dataset.extent(0)));
+
+  RAFT_EXPECTS(additional_dataset.extent(1) == idx.dim(),
+               "The dimensionality of the new vectors must match the index");
+  RAFT_EXPECTS(idx.size() >= idx.graph_degree(),
+               "The index must contain at least graph_degree vectors to be extended");
+
+  auto stream            = resource::get_cuda_stream(res);
+  const int64_t old_size = idx.size();
+  const int64_t num_add  = additional_dataset.extent(0);
+  const int64_t new_size = old_size + num_add;
+  if (num_add == 0) { return; }
+  RAFT_EXPECTS(idx.graph_bits() == 0,
+               "A compressed graph cannot be extended; call decompress_graph first");
+  RAFT_EXPECTS(idx.n_removed() == 0,
+               "An index with removed nodes cannot be extended; call cagra::compact first");
+  RAFT_EXPECTS(idx.source_indices().extent(0) == 0, "A reordered index cannot be extended");
+  RAFT_EXPECTS(static_cast<uint64_t>(new_size) <=
+                 static_cast<uint64_t>(std::numeric_limits<IdxT>::max()),
+               "The extended index size exceeds the range of IdxT");
+
+  // By default, a chunk is not larger than the index it is added to, so that a large extension
+  // links most of the new nodes to the new nodes of the previous chunks.
+  const uint32_t max_chunk_size = params.max_chunk_size > 0
+                                    ? params.max_chunk_size
+                                    : std::min<int64_t>({num_add, old_size, int64_t(1024)});
+
+  // Concatenate the datasets, keeping the padding of the current one.
+  const int64_t stride = idx.dataset().stride(0);
+  auto new_dataset     = raft::make_device_matrix<T, int64_t>(res, new_size, stride);
+  if (stride != static_cast<int64_t>(idx.dim())) {
+    RAFT_CUDA_TRY(
+      cudaMemsetAsync(new_dataset.data_handle(), 0, new_dataset.size() * sizeof(T), stream));
+  }
+  RAFT_CUDA_TRY(cudaMemcpy2DAsync(new_dataset.data_handle(),
+                                  sizeof(T) * stride,
+                                  idx.dataset().data_handle(),
+                                  sizeof(T) * stride,
+                                  sizeof(T) * idx.dim(),
+                                  old_size,
+                                  cudaMemcpyDefault,
+                                  stream));
+  RAFT_CUDA_TRY(cudaMemcpy2DAsync(new_dataset.data_handle() + old_size * stride,
+                                  sizeof(T) * stride,
+                                  additional_dataset.data_handle(),
+                                  sizeof(T) * additional_dataset.extent(1),
+                                  sizeof(T) * additional_dataset.extent(1),
+                                  num_add,
+                                  cudaMemcpyDefault,
+                                  stream));
+
+  // The first old_size rows of the new graph are the current graph; the rows of the current nodes
+  // are modified in place only when they receive a reverse edge.
+  auto new_graph = raft::make_device_matrix<IdxT, int64_t>(res, new_size, idx.graph_degree());
+  raft::copy(new_graph.data_handle(), idx.graph().data_handle(), idx.graph().size(), stream);
+
+  add_node_core(res,
+                idx,
+                raft::make_device_strided_matrix_view<const T, int64_t>(
+                  new_dataset.data_handle(), new_size, idx.dim(), stride),
+                additional_dataset,
+                new_graph.view(),
+                max_chunk_size);
+
+  idx.update_dataset(res, std::move(new_dataset), idx.dim());
+  if (idx.metric() == raft::distance::DistanceType::CosineExpanded) {
+    idx.update_dataset_norms(res, make_dataset_norms(res, idx));
+  }
+  idx.update_graph(res, std::move(new_graph));
+  resource::sync_stream(res);
+}
+
+}  // namespace raft::neighbors::cagra::detail
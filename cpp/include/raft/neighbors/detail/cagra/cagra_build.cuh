@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,10 +16,20 @@
 #pragma once
 
 #include "../../cagra_types.hpp"
+#include "dataset_norms.cuh"
+#include "entry_points.cuh"
 #include "graph_core.cuh"
+#include "reorder.cuh"
+#include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstdio>
+#include <limits>
+#include <optional>
+#include <raft/core/resource/cancellation_token.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
 #include <vector>
 
 #include <raft/core/device_mdarray.hpp>
@@ -28,9 +38,14 @@
 #include <raft/core/host_mdarray.hpp>
 #include <raft/core/host_mdspan.hpp>
 #include <raft/core/logger.hpp>
+#include <raft/core/pinned_mdarray.hpp>
 #include <raft/distance/distance_types.hpp>
+#include <raft/linalg/map.cuh>
 #include <raft/spatial/knn/detail/ann_utils.cuh>
 
+#include <raft/cluster/kmeans_balanced.cuh>
+#include <raft/neighbors/brute_force.cuh>
+#include <raft/neighbors/detail/knn_brute_force_streaming.cuh>
 #include <raft/neighbors/detail/refine.cuh>
 #include <raft/neighbors/ivf_pq.cuh>
 #include <raft/neighbors/ivf_pq_types.hpp>
@@ -39,16 +54,56 @@
 
 namespace raft::neighbors::cagra::detail {
 
+/** The parameters of the IVF-PQ index of the kNN graph build, unless given by the user. */
+inline auto default_knn_graph_build_params(int64_t n_rows,
+                                           int64_t dim,
+                                           distance::DistanceType metric) -> ivf_pq::index_params
+{
+  ivf_pq::index_params params;
+  params.n_lists                  = n_rows < 4 * 2500 ? 4 : (uint32_t)(n_rows / 2500);
+  params.pq_dim                   = raft::Pow2<8>::roundUp(dim / 2);
+  params.pq_bits                  = 8;
+  params.kmeans_trainset_fraction = n_rows < 10000 ? 1 : 10;
+  params.kmeans_n_iters           = 25;
+  params.add_data_on_build        = true;
+  params.metric                   = metric;
+  return params;
+}
+
+/** The parameters of the IVF-PQ search of the kNN graph build, unless given by the user. */
+inline auto default_knn_graph_search_params(int64_t dim, const ivf_pq::index_params& build_params)
+  -> ivf_pq::search_params
+{
+  ivf_pq::search_params params;
+  params.n_probes                = std::min<int64_t>(dim * 2, build_params.n_lists);
+  params.lut_dtype               = CUDA_R_8U;
+  params.internal_distance_dtype = CUDA_R_32F;
+  return params;
+}
+
+/** The number of candidates searched by IVF-PQ (and refined) per row of the kNN graph. */
+inline auto knn_graph_candidates(uint32_t node_degree,
+                                 std::optional<float> refine_rate,
+                                 int64_t n_rows) -> uint32_t
+{
+  const uint32_t top_k = node_degree + 1;
+  uint32_t gpu_top_k   = node_degree * refine_rate.value_or(2.0f);
+  return std::min<int64_t>(std::max(gpu_top_k, top_k), n_rows);
+}
+
 template <typename DataT, typename IdxT, typename accessor>
 void build_knn_graph(raft::resources const& res,
                      mdspan<const DataT, matrix_extent<int64_t>, row_major, accessor> dataset,
                      raft::host_matrix_view<IdxT, int64_t, row_major> knn_graph,
                      std::optional<float> refine_rate                   = std::nullopt,
                      std::optional<ivf_pq::index_params> build_params   = std::nullopt,
-                     std::optional<ivf_pq::search_params> search_params = std::nullopt)
+                     std::optional<ivf_pq::search_params> search_params = std::nullopt,
+                     distance::DistanceType metric = distance::DistanceType::L2Expanded)
 {
-  RAFT_EXPECTS(!build_params || build_params->metric == distance::DistanceType::L2Expanded,
-               "Currently only L2Expanded metric is supported");
+  if (build_params) { metric = build_params->metric; }
+  RAFT_EXPECTS(metric == distance::DistanceType::L2Expanded ||
+                 metric == distance::DistanceType::InnerProduct,
+               "The IVF-PQ graph build supports only the L2Expanded and InnerProduct metrics");
 
   uint32_t node_degree = knn_graph.extent(1);
   common::nvtx::range<common::nvtx::domain::raft> fun_scope("cagra::build_graph(%zu, %zu, %u)",
@@ -57,13 +112,7 @@ void build_knn_graph(raft::resources const& res,
                                                             node_degree);
 
   if (!build_params) {
-    build_params          = ivf_pq::index_params{};
-    build_params->n_lists = dataset.extent(0) < 4 * 2500 ? 4 : (uint32_t)(dataset.extent(0) / 2500);
-    build_params->pq_dim  = raft::Pow2<8>::roundUp(dataset.extent(1) / 2);
-    build_params->pq_bits = 8;
-    build_params->kmeans_trainset_fraction = dataset.extent(0) < 10000 ? 1 : 10;
-    build_params->kmeans_n_iters           = 25;
-    build_params->add_data_on_build        = true;
+    build_params = default_knn_graph_build_params(dataset.extent(0), dataset.extent(1), metric);
   }
 
   // Make model name
@@ -91,32 +140,61 @@ void build_knn_graph(raft::resources const& res,
   // search top (k + 1) neighbors
   //
   if (!search_params) {
-    search_params            = ivf_pq::search_params{};
-    search_params->n_probes  = std::min<IdxT>(dataset.extent(1) * 2, build_params->n_lists);
-    search_params->lut_dtype = CUDA_R_8U;
-    search_params->internal_distance_dtype = CUDA_R_32F;
+    search_params = default_knn_graph_search_params(dataset.extent(1), *build_params);
   }
-  const auto top_k          = node_degree + 1;
-  uint32_t gpu_top_k        = node_degree * refine_rate.value_or(2.0f);
-  gpu_top_k                 = std::min<IdxT>(std::max(gpu_top_k, top_k), dataset.extent(0));
-  const auto num_queries    = dataset.extent(0);
-  const auto max_batch_size = 1024;
+  const auto top_k   = node_degree + 1;
+  uint32_t gpu_top_k = knn_graph_candidates(node_degree, refine_rate, dataset.extent(0));
+  const int64_t n_rows         = dataset.extent(0);
+  const int64_t dim            = dataset.extent(1);
+  const auto num_queries       = n_rows;
+  const int64_t max_batch_size = std::min<int64_t>(n_rows, 4096);
+  auto stream                  = resource::get_cuda_stream(res);
+
+  // The candidates are refined on the device if the dataset is there or fits there. Otherwise, the
+  // host threads refine a batch while the device searches the next one.
+  std::optional<raft::device_matrix<DataT, int64_t>> dataset_copy;
+  const DataT* dataset_dev = nullptr;
+  if constexpr (is_host_mdspan_v<decltype(dataset)>) {
+    if (graph::fits_in_device_memory(dataset.size() * sizeof(DataT))) {
+      dataset_copy.emplace(raft::make_device_matrix<DataT, int64_t>(res, n_rows, dim));
+      raft::copy(dataset_copy->data_handle(), dataset.data_handle(), dataset.size(), stream);
+      dataset_dev = dataset_copy->data_handle();
+    }
+  } else {
+    dataset_dev = dataset.data_handle();
+  }
+  const bool refine_on_device = dataset_dev != nullptr;
   RAFT_LOG_DEBUG(
-    "IVF-PQ search node_degree: %d, top_k: %d,  gpu_top_k: %d,  max_batch_size:: %d, n_probes: %u",
+    "IVF-PQ search node_degree: %d, top_k: %d,  gpu_top_k: %d,  max_batch_size:: %d, n_probes: %u, "
+    "refine on %s",
     node_degree,
     top_k,
     gpu_top_k,
-    max_batch_size,
-    search_params->n_probes);
-
-  auto distances = raft::make_device_matrix<float, int64_t>(res, max_batch_size, gpu_top_k);
-  auto neighbors = raft::make_device_matrix<int64_t, int64_t>(res, max_batch_size, gpu_top_k);
-  auto refined_distances = raft::make_device_matrix<float, int64_t>(res, max_batch_size, top_k);
-  auto refined_neighbors = raft::make_device_matrix<int64_t, int64_t>(res, max_batch_size, top_k);
-  auto neighbors_host    = raft::make_host_matrix<int64_t, int64_t>(max_batch_size, gpu_top_k);
-  auto queries_host = raft::make_host_matrix<DataT, int64_t>(max_batch_size, dataset.extent(1));
-  auto refined_neighbors_host = raft::make_host_matrix<int64_t, int64_t>(max_batch_size, top_k);
-  auto refined_distances_host = raft::make_host_matrix<float, int64_t>(max_batch_size, top_k);
+    int(max_batch_size),
+    search_params->n_probes,
+    refine_on_device ? "device" : "host");
+
+  // The batches are pipelined: while the device searches (and refines) a batch, the results of
+  // the previous one are copied to the host in a side stream, and the host threads (refine and)
+  // write out the one before. Hence the results are double-buffered on both sides.
+  const int64_t result_width      = refine_on_device ? top_k : gpu_top_k;
+  const int64_t device_batch_size = refine_on_device ? max_batch_size : 0;
+  const int64_t host_batch_size   = refine_on_device ? 0 : max_batch_size;
+
+  auto distances  = raft::make_device_matrix<float, int64_t>(res, max_batch_size, gpu_top_k);
+  auto candidates = raft::make_device_matrix<int64_t, int64_t>(res, device_batch_size, gpu_top_k);
+  std::array<raft::device_matrix<int64_t, int64_t>, 2> results{
+    raft::make_device_matrix<int64_t, int64_t>(res, max_batch_size, result_width),
+    raft::make_device_matrix<int64_t, int64_t>(res, max_batch_size, result_width)};
+  auto refined_distances = raft::make_device_matrix<float, int64_t>(res, device_batch_size, top_k);
+  std::array<raft::pinned_matrix<int64_t, int64_t>, 2> results_host{
+    raft::make_pinned_matrix<int64_t, int64_t>(res, max_batch_size, result_width),
+    raft::make_pinned_matrix<int64_t, int64_t>(res, max_batch_size, result_width)};
+  auto refined_neighbors_host = raft::make_host_matrix<int64_t, int64_t>(host_batch_size, top_k);
+  auto refined_distances_host = raft::make_host_matrix<float, int64_t>(host_batch_size, top_k);
+  std::array<raft::neighbors::detail::streaming_event, 2> computed;
+  std::array<raft::neighbors::detail::streaming_event, 2> copied;
+  auto copy_stream = resource::get_next_usable_stream(res);
 
   // TODO(tfeher): batched search with multiple GPUs
   std::size_t num_self_included = 0;
@@ -125,84 +203,46 @@ void build_knn_graph(raft::resources const& res,
 
   rmm::mr::device_memory_resource* device_memory = raft::resource::get_workspace_resource(res);
 
+  // The queries are prefetched in a pool stream if they are not on the device.
+  auto prefetch_stream = resource::is_stream_pool_initialized(res)
+                           ? std::make_optional(resource::get_stream_from_stream_pool(res))
+                           : std::nullopt;
   raft::spatial::knn::detail::utils::batch_load_iterator<DataT> vec_batches(
-    dataset.data_handle(),
-    dataset.extent(0),
-    dataset.extent(1),
+    refine_on_device ? dataset_dev : dataset.data_handle(),
+    n_rows,
+    dim,
     max_batch_size,
-    resource::get_cuda_stream(res),
-    device_memory);
+    stream,
+    device_memory,
+    resource::get_pinned_memory_resource(res),
+    prefetch_stream);
 
   size_t next_report_offset = 0;
   size_t d_report_offset    = dataset.extent(0) / 100;  // Report progress in 1% steps.
 
-  for (const auto& batch : vec_batches) {
-    // Map int64_t to uint32_t because ivf_pq requires the latter.
-    // TODO(tfeher): remove this mapping once ivf_pq accepts mdspan with int64_t index type
-    auto queries_view = raft::make_device_matrix_view<const DataT, uint32_t>(
-      batch.data(), batch.size(), batch.row_width());
-    auto neighbors_view = make_device_matrix_view<int64_t, uint32_t>(
-      neighbors.data_handle(), batch.size(), neighbors.extent(1));
-    auto distances_view = make_device_matrix_view<float, uint32_t>(
-      distances.data_handle(), batch.size(), distances.extent(1));
-
-    ivf_pq::search(res, *search_params, index, queries_view, neighbors_view, distances_view);
+  // (Refine and) write out a batch of results on the host.
+  auto write_out = [&](int64_t offset, int64_t size, int slot) {
+    copied[slot].sync();
+    const int64_t* batch_neighbors = results_host[slot].data_handle();
     if constexpr (is_host_mdspan_v<decltype(dataset)>) {
-      raft::copy(neighbors_host.data_handle(),
-                 neighbors.data_handle(),
-                 neighbors_view.size(),
-                 resource::get_cuda_stream(res));
-      raft::copy(queries_host.data_handle(),
-                 batch.data(),
-                 queries_view.size(),
-                 resource::get_cuda_stream(res));
-      auto queries_host_view = make_host_matrix_view<const DataT, int64_t>(
-        queries_host.data_handle(), batch.size(), batch.row_width());
-      auto neighbors_host_view = make_host_matrix_view<const int64_t, int64_t>(
-        neighbors_host.data_handle(), batch.size(), neighbors.extent(1));
-      auto refined_neighbors_host_view = make_host_matrix_view<int64_t, int64_t>(
-        refined_neighbors_host.data_handle(), batch.size(), top_k);
-      auto refined_distances_host_view = make_host_matrix_view<float, int64_t>(
-        refined_distances_host.data_handle(), batch.size(), top_k);
-      resource::sync_stream(res);
-
-      raft::neighbors::detail::refine_host<int64_t, DataT, float, int64_t>(
-        dataset,
-        queries_host_view,
-        neighbors_host_view,
-        refined_neighbors_host_view,
-        refined_distances_host_view,
-        build_params->metric);
-    } else {
-      auto neighbor_candidates_view = make_device_matrix_view<const int64_t, uint64_t>(
-        neighbors.data_handle(), batch.size(), gpu_top_k);
-      auto refined_neighbors_view = make_device_matrix_view<int64_t, int64_t>(
-        refined_neighbors.data_handle(), batch.size(), top_k);
-      auto refined_distances_view = make_device_matrix_view<float, int64_t>(
-        refined_distances.data_handle(), batch.size(), top_k);
-
-      auto dataset_view = make_device_matrix_view<const DataT, int64_t>(
-        dataset.data_handle(), dataset.extent(0), dataset.extent(1));
-      raft::neighbors::detail::refine_device<int64_t, DataT, float, int64_t>(
-        res,
-        dataset_view,
-        queries_view,
-        neighbor_candidates_view,
-        refined_neighbors_view,
-        refined_distances_view,
-        build_params->metric);
-      raft::copy(refined_neighbors_host.data_handle(),
-                 refined_neighbors_view.data_handle(),
-                 refined_neighbors_view.size(),
-                 resource::get_cuda_stream(res));
-      resource::sync_stream(res);
+      if (!refine_on_device) {
+        raft::neighbors::detail::refine_host<int64_t, DataT, float, int64_t>(
+          dataset,
+          make_host_matrix_view<const DataT, int64_t>(
+            dataset.data_handle() + offset * dim, size, dim),
+          make_host_matrix_view<const int64_t, int64_t>(batch_neighbors, size, gpu_top_k),
+          make_host_matrix_view<int64_t, int64_t>(
+            refined_neighbors_host.data_handle(), size, top_k),
+          make_host_matrix_view<float, int64_t>(refined_distances_host.data_handle(), size, top_k),
+          build_params->metric);
+        batch_neighbors = refined_neighbors_host.data_handle();
+      }
     }
     // omit itself & write out
-    // TODO(tfeher): do this in parallel with GPU processing of next batch
-    for (std::size_t i = 0; i < batch.size(); i++) {
-      size_t vec_idx = i + batch.offset();
+    for (int64_t i = 0; i < size; i++) {
+      size_t vec_idx = i + offset;
       for (std::size_t j = 0, num_added = 0; j < top_k && num_added < node_degree; j++) {
-        const auto v = refined_neighbors_host(i, j);
+        const auto v = batch_neighbors[i * top_k + j];
         if (static_cast<size_t>(v) == vec_idx) {
           num_self_included++;
           continue;
@@ -212,9 +252,9 @@ void build_knn_graph(raft::resources const& res,
       }
     }
 
-    size_t num_queries_done = batch.offset() + batch.size();
+    size_t num_queries_done = offset + size;
     const auto end_clock    = std::chrono::system_clock::now();
-    if (batch.offset() > next_report_offset) {
+    if (static_cast<size_t>(offset) > next_report_offset) {
       next_report_offset += d_report_offset;
       const auto time =
         std::chrono::duration_cast<std::chrono::microseconds>(end_clock - start_clock).count() *
@@ -231,10 +271,63 @@ void build_knn_graph(raft::resources const& res,
         (num_queries - num_queries_done) / throughput / 60,
         static_cast<double>(num_self_included) / num_queries_done * 100.);
     }
+  };
+
+  int64_t prev_offset = 0;
+  int64_t prev_size   = 0;
+  int slot            = 0;
+  for (const auto& batch : vec_batches) {
+    resource::check_cancellation(res);
+    // The device buffer of the results may still be copied from, two batches back.
+    copied[slot].wait_by(stream);
+
+    // Map int64_t to uint32_t because ivf_pq requires the latter.
+    // TODO(tfeher): remove this mapping once ivf_pq accepts mdspan with int64_t index type
+    auto queries_view = raft::make_device_matrix_view<const DataT, uint32_t>(
+      batch.data(), batch.size(), batch.row_width());
+    auto neighbors_view = make_device_matrix_view<int64_t, uint32_t>(
+      refine_on_device ? candidates.data_handle() : results[slot].data_handle(),
+      batch.size(),
+      gpu_top_k);
+    auto distances_view = make_device_matrix_view<float, uint32_t>(
+      distances.data_handle(), batch.size(), distances.extent(1));
+
+    ivf_pq::search(res, *search_params, index, queries_view, neighbors_view, distances_view);
+    if (refine_on_device) {
+      auto neighbor_candidates_view = make_device_matrix_view<const int64_t, int64_t>(
+        candidates.data_handle(), batch.size(), gpu_top_k);
+      auto refined_neighbors_view = make_device_matrix_view<int64_t, int64_t>(
+        results[slot].data_handle(), batch.size(), top_k);
+      auto refined_distances_view = make_device_matrix_view<float, int64_t>(
+        refined_distances.data_handle(), batch.size(), top_k);
+      raft::neighbors::detail::refine_device<int64_t, DataT, float, int64_t>(
+        res,
+        make_device_matrix_view<const DataT, int64_t>(dataset_dev, n_rows, dim),
+        make_device_matrix_view<const DataT, int64_t>(batch.data(), batch.size(), dim),
+        neighbor_candidates_view,
+        refined_neighbors_view,
+        refined_distances_view,
+        build_params->metric);
+    }
+    computed[slot].record(stream);
+    computed[slot].wait_by(copy_stream);
+    raft::copy(results_host[slot].data_handle(),
+               results[slot].data_handle(),
+               batch.size() * result_width,
+               copy_stream);
+    copied[slot].record(copy_stream);
+
+    // The host writes out the previous batch while the device processes this one.
+    if (!first) { write_out(prev_offset, prev_size, slot ^ 1); }
+    prev_offset = batch.offset();
+    prev_size   = batch.size();
+    slot ^= 1;
     first = false;
   }
-
-  if (!first) RAFT_LOG_DEBUG("# Finished building kNN graph");
+  if (!first) {
+    write_out(prev_offset, prev_size, slot ^ 1);
+    RAFT_LOG_DEBUG("# Finished building kNN graph");
+  }
 }
 
 template <typename DataT, typename IdxT, typename accessor>
@@ -260,12 +353,234 @@ void build_knn_graph(raft::resources const& res,
   graph::sort_knn_graph(res, dataset, knn_graph_internal);
 }
 
+/**
+ * Build the all-neighbors knn graph with NN-descent without holding the whole dataset on device.
+ *
+ * The dataset is partitioned with balanced k-means into `n_clusters` clusters and every vector is
+ * assigned to its `overlap` closest clusters. NN-descent is run on one cluster at a time, the local
+ * neighbor lists are sorted by their exact distances and merged into the global graph. Vectors on
+ * the boundary of a cluster appear in several clusters, which connects the subgraphs.
+ * Only one cluster (about `overlap * n_rows / n_clusters` vectors) is resident on device at a time.
+ */
+template <typename DataT, typename IdxT, typename accessor>
+void build_knn_graph_partitioned(
+  raft::resources const& res,
+  mdspan<const DataT, matrix_extent<int64_t>, row_major, accessor> dataset,
+  raft::host_matrix_view<IdxT, int64_t, row_major> knn_graph,
+  experimental::nn_descent::index_params build_params,
+  size_t n_clusters,
+  size_t overlap)
+{
+  const int64_t n_rows = dataset.extent(0);
+  const int64_t dim    = dataset.extent(1);
+  const int64_t degree = knn_graph.extent(1);
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::build_graph_partitioned(%zu, %zu, %zu clusters)",
+    size_t(n_rows),
+    size_t(dim),
+    n_clusters);
+  static_assert(accessor::is_host_accessible,
+                "The partitioned NN-descent build expects a host-accessible dataset");
+  namespace utils = raft::spatial::knn::detail::utils;
+  RAFT_EXPECTS(overlap >= 1 && overlap <= n_clusters,
+               "The cluster overlap must be in the range [1, n_clusters]");
+  RAFT_EXPECTS(size_t(n_rows) >= n_clusters, "The dataset has fewer rows than clusters");
+  auto stream = resource::get_cuda_stream(res);
+
+  // Train balanced k-means on a strided subsample of the dataset.
+  auto centers = raft::make_device_matrix<float, int64_t>(res, n_clusters, dim);
+  {
+    // A few thousand points per cluster are enough for the balanced k-means to converge, and keep
+    // the trainset small compared to the device memory.
+    constexpr size_t kTrainRowsPerCluster = 10000;
+    auto trainset_ratio = std::max<size_t>(1, n_rows / (kTrainRowsPerCluster * n_clusters));
+    auto n_rows_train   = n_rows / trainset_ratio;
+    auto trainset       = raft::make_device_matrix<DataT, int64_t>(res, n_rows_train, dim);
+    RAFT_CUDA_TRY(cudaMemcpy2DAsync(trainset.data_handle(),
+                                    sizeof(DataT) * dim,
+                                    dataset.data_handle(),
+                                    sizeof(DataT) * dim * trainset_ratio,
+                                    sizeof(DataT) * dim,
+                                    n_rows_train,
+                                    cudaMemcpyDefault,
+                                    stream));
+    raft::cluster::kmeans_balanced_params kmeans_params;
+    kmeans_params.metric = raft::distance::DistanceType::L2Expanded;
+    raft::cluster::kmeans_balanced::fit(res,
+                                        kmeans_params,
+                                        raft::make_const_mdspan(trainset.view()),
+                                        centers.view(),
+                                        utils::mapping<float>{});
+  }
+
+  // Assign every vector to its `overlap` closest clusters.
+  auto labels = raft::make_host_matrix<int64_t, int64_t>(n_rows, overlap);
+  {
+    constexpr int64_t kMaxBatchSize = 65536;
+    utils::batch_load_iterator<DataT> vec_batches(
+      dataset.data_handle(), n_rows, dim, kMaxBatchSize, stream);
+    auto batch_float  = raft::make_device_matrix<float, int64_t>(res, kMaxBatchSize, dim);
+    auto batch_labels = raft::make_device_matrix<int64_t, int64_t>(res, kMaxBatchSize, overlap);
+    auto batch_dists  = raft::make_device_matrix<float, int64_t>(res, kMaxBatchSize, overlap);
+    for (const auto& batch : vec_batches) {
+      resource::check_cancellation(res);
+      auto batch_size = int64_t(batch.size());
+      auto in_view    = raft::make_device_matrix_view<const DataT, int64_t>(
+        batch.data(), batch_size, dim);
+      auto out_view =
+        raft::make_device_matrix_view<float, int64_t>(batch_float.data_handle(), batch_size, dim);
+      raft::linalg::map(res, out_view, utils::mapping<float>{}, in_view);
+      std::vector<raft::device_matrix_view<const float, int64_t, row_major>> centers_list{
+        raft::make_const_mdspan(centers.view())};
+      raft::neighbors::brute_force::knn<int64_t, float, int64_t>(
+        res,
+        centers_list,
+        raft::make_const_mdspan(out_view),
+        raft::make_device_matrix_view<int64_t, int64_t>(
+          batch_labels.data_handle(), batch_size, overlap),
+        raft::make_device_matrix_view<float, int64_t>(
+          batch_dists.data_handle(), batch_size, overlap),
+        raft::distance::DistanceType::L2Expanded);
+      raft::copy(labels.data_handle() + batch.offset() * overlap,
+                 batch_labels.data_handle(),
+                 batch_size * overlap,
+                 stream);
+    }
+    resource::sync_stream(res);
+  }
+
+  // Row ids of every cluster in CSR form.
+  std::vector<int64_t> cluster_offsets(n_clusters + 1, 0);
+  for (int64_t i = 0; i < n_rows * int64_t(overlap); i++) {
+    cluster_offsets[labels.data_handle()[i] + 1]++;
+  }
+  for (size_t c = 0; c < n_clusters; c++) {
+    cluster_offsets[c + 1] += cluster_offsets[c];
+  }
+  std::vector<IdxT> cluster_rows(cluster_offsets.back());
+  {
+    std::vector<int64_t> fill(cluster_offsets.begin(), cluster_offsets.end() - 1);
+    for (int64_t i = 0; i < n_rows; i++) {
+      for (size_t j = 0; j < overlap; j++) {
+        cluster_rows[fill[labels(i, j)]++] = IdxT(i);
+      }
+    }
+  }
+
+  // The neighbor lists of the global graph are kept sorted by distance while merging.
+  constexpr auto kInvalid = std::numeric_limits<IdxT>::max();
+  auto knn_dists          = raft::make_host_matrix<float, int64_t>(n_rows, degree);
+  std::fill(knn_graph.data_handle(), knn_graph.data_handle() + knn_graph.size(), kInvalid);
+  std::fill(knn_dists.data_handle(),
+            knn_dists.data_handle() + knn_dists.size(),
+            std::numeric_limits<float>::max());
+
+  build_params.graph_degree = degree;
+  for (size_t c = 0; c < n_clusters; c++) {
+    const int64_t cluster_size = cluster_offsets[c + 1] - cluster_offsets[c];
+    const IdxT* rows           = cluster_rows.data() + cluster_offsets[c];
+    RAFT_EXPECTS(cluster_size > degree,
+                 "Cluster %zu has only %ld vectors, fewer than the graph degree + 1; reduce the "
+                 "number of clusters.",
+                 c,
+                 long(cluster_size));
+    RAFT_LOG_DEBUG("# Building the kNN graph of cluster %zu / %zu (%ld vectors)",
+                   c + 1,
+                   n_clusters,
+                   long(cluster_size));
+
+    // Gather the vectors of the cluster.
+    auto cluster_data = raft::make_host_matrix<DataT, int64_t>(cluster_size, dim);
+#pragma omp parallel for
+    for (int64_t i = 0; i < cluster_size; i++) {
+      std::copy(dataset.data_handle() + int64_t(rows[i]) * dim,
+                dataset.data_handle() + (int64_t(rows[i]) + 1) * dim,
+                cluster_data.data_handle() + i * dim);
+    }
+
+    // Run NN-descent on the cluster.
+    auto local_graph_u32 = raft::make_host_matrix<uint32_t, int64_t>(cluster_size, degree);
+    {
+      auto nn_descent_idx = experimental::nn_descent::index<uint32_t>(res, local_graph_u32.view());
+      experimental::nn_descent::build<DataT, uint32_t>(
+        res, build_params, raft::make_const_mdspan(cluster_data.view()), nn_descent_idx);
+    }
+
+    // Sort the local neighbor lists by their exact distances.
+    auto local_graph = raft::make_host_matrix<int64_t, int64_t>(cluster_size, degree);
+    auto local_dists = raft::make_host_matrix<float, int64_t>(cluster_size, degree);
+    std::copy(local_graph_u32.data_handle(),
+              local_graph_u32.data_handle() + local_graph_u32.size(),
+              local_graph.data_handle());
+    {
+      auto d_data  = raft::make_device_matrix<DataT, int64_t>(res, cluster_size, dim);
+      auto d_cands = raft::make_device_matrix<int64_t, int64_t>(res, cluster_size, degree);
+      auto d_graph = raft::make_device_matrix<int64_t, int64_t>(res, cluster_size, degree);
+      auto d_dists = raft::make_device_matrix<float, int64_t>(res, cluster_size, degree);
+      raft::copy(d_data.data_handle(), cluster_data.data_handle(), cluster_data.size(), stream);
+      raft::copy(d_cands.data_handle(), local_graph.data_handle(), local_graph.size(), stream);
+      raft::neighbors::refine<int64_t, DataT, float, int64_t>(
+        res,
+        raft::make_const_mdspan(d_data.view()),
+        raft::make_const_mdspan(d_data.view()),
+        raft::make_const_mdspan(d_cands.view()),
+        d_graph.view(),
+        d_dists.view(),
+        raft::distance::DistanceType::L2Expanded);
+      raft::copy(local_graph.data_handle(), d_graph.data_handle(), d_graph.size(), stream);
+      raft::copy(local_dists.data_handle(), d_dists.data_handle(), d_dists.size(), stream);
+      resource::sync_stream(res);
+    }
+
+    // Merge the local lists into the global graph. Every row appears at most once per cluster,
+    // so the rows can be merged in parallel.
+#pragma omp parallel
+    {
+      std::vector<IdxT> merged_ids(degree);
+      std::vector<float> merged_dists(degree);
+#pragma omp for
+      for (int64_t i = 0; i < cluster_size; i++) {
+        IdxT* old_ids          = knn_graph.data_handle() + int64_t(rows[i]) * degree;
+        float* old_dists       = knn_dists.data_handle() + int64_t(rows[i]) * degree;
+        const int64_t* new_ids = local_graph.data_handle() + i * degree;
+        const float* new_dists = local_dists.data_handle() + i * degree;
+        int64_t old_count      = std::find(old_ids, old_ids + degree, kInvalid) - old_ids;
+        int64_t a              = 0;
+        int64_t b              = 0;
+        for (int64_t j = 0; j < degree; j++) {
+          // Skip the new candidates that are already in the list.
+          while (b < degree && std::find(old_ids, old_ids + old_count, rows[new_ids[b]]) !=
+                                 old_ids + old_count) {
+            b++;
+          }
+          bool take_old = a < old_count && (b >= degree || old_dists[a] <= new_dists[b]);
+          if (take_old) {
+            merged_ids[j]   = old_ids[a];
+            merged_dists[j] = old_dists[a];
+            a++;
+          } else if (b < degree) {
+            merged_ids[j]   = rows[new_ids[b]];
+            merged_dists[j] = new_dists[b];
+            b++;
+          } else {
+            merged_ids[j]   = kInvalid;
+            merged_dists[j] = std::numeric_limits<float>::max();
+          }
+        }
+        std::copy(merged_ids.begin(), merged_ids.end(), old_ids);
+        std::copy(merged_dists.begin(), merged_dists.end(), old_dists);
+      }
+    }
+  }
+}
+
 template <typename IdxT = uint32_t,
           typename g_accessor =
             host_device_accessor<std::experimental::default_accessor<IdxT>, memory_type::host>>
 void optimize(raft::resources const& res,
               mdspan<IdxT, matrix_extent<int64_t>, row_major, g_accessor> knn_graph,
-              raft::host_matrix_view<IdxT, int64_t, row_major> new_graph)
+              raft::host_matrix_view<IdxT, int64_t, row_major> new_graph,
+              const optimize_params& params = optimize_params{})
 {
   using internal_IdxT = typename std::make_unsigned<IdxT>::type;
 
@@ -282,7 +597,80 @@ void optimize(raft::resources const& res,
       knn_graph.extent(0),
       knn_graph.extent(1));
 
-  cagra::detail::graph::optimize(res, knn_graph_internal, new_graph_internal);
+  cagra::detail::graph::optimize(res, knn_graph_internal, new_graph_internal, params);
+}
+
+template <typename IdxT = uint32_t>
+void optimize(const optimize_params& params,
+              raft::host_matrix_view<IdxT, int64_t, row_major> knn_graph,
+              raft::host_matrix_view<IdxT, int64_t, row_major> new_graph,
+              const std::vector<int>& devices)
+{
+  using internal_IdxT = typename std::make_unsigned<IdxT>::type;
+
+  auto knn_graph_internal = raft::make_host_matrix_view<internal_IdxT, int64_t>(
+    reinterpret_cast<internal_IdxT*>(knn_graph.data_handle()),
+    knn_graph.extent(0),
+    knn_graph.extent(1));
+  auto new_graph_internal = raft::make_host_matrix_view<internal_IdxT, int64_t>(
+    reinterpret_cast<internal_IdxT*>(new_graph.data_handle()),
+    new_graph.extent(0),
+    new_graph.extent(1));
+
+  cagra::detail::graph::optimize(params, knn_graph_internal, new_graph_internal, devices);
+}
+
+/** Build the intermediate kNN graph of `dataset` with the graph build algorithm of `params`. */
+template <typename IdxT, typename T, typename Accessor>
+void build_intermediate_graph(
+  raft::resources const& res,
+  const index_params& params,
+  mdspan<const T, matrix_extent<int64_t>, row_major, Accessor> dataset,
+  raft::host_matrix_view<IdxT, int64_t, row_major> knn_graph,
+  distance::DistanceType metric,
+  size_t intermediate_degree,
+  std::optional<experimental::nn_descent::index_params> nn_descent_params,
+  std::optional<float> refine_rate,
+  std::optional<ivf_pq::index_params> pq_build_params,
+  std::optional<ivf_pq::search_params> search_params)
+{
+  if (params.build_algo == graph_build_algo::IVF_PQ) {
+    if (pq_build_params) { pq_build_params->metric = metric; }
+    build_knn_graph(res, dataset, knn_graph, refine_rate, pq_build_params, search_params, metric);
+
+  } else {
+    RAFT_EXPECTS(metric == distance::DistanceType::L2Expanded,
+                 "The NN-descent graph build supports only the L2Expanded and CosineExpanded "
+                 "metrics");
+    // Use nn-descent to build CAGRA knn graph
+    if (!nn_descent_params) {
+      nn_descent_params                            = experimental::nn_descent::index_params();
+      nn_descent_params->graph_degree              = intermediate_degree;
+      nn_descent_params->intermediate_graph_degree = 1.5 * intermediate_degree;
+      nn_descent_params->max_iterations            = params.nn_descent_niter;
+    }
+    bool partitioned = params.nn_descent_n_clusters > 1;
+    if constexpr (!Accessor::is_host_accessible) {
+      if (partitioned) {
+        RAFT_LOG_WARN(
+          "The dataset is in device memory, ignoring nn_descent_n_clusters and running NN-descent "
+          "on the whole dataset.");
+        partitioned = false;
+      }
+    }
+    if (partitioned) {
+      if constexpr (Accessor::is_host_accessible) {
+        build_knn_graph_partitioned<T, IdxT>(res,
+                                             dataset,
+                                             knn_graph,
+                                             *nn_descent_params,
+                                             params.nn_descent_n_clusters,
+                                             params.nn_descent_cluster_overlap);
+      }
+    } else {
+      build_knn_graph<T, IdxT>(res, dataset, knn_graph, *nn_descent_params);
+    }
+  }
 }
 
 template <typename T,
@@ -315,21 +703,37 @@ index<T, IdxT> build(
     graph_degree = intermediate_degree;
   }
 
+  RAFT_EXPECTS(params.metric == distance::DistanceType::L2Expanded ||
+                 params.metric == distance::DistanceType::InnerProduct ||
+                 params.metric == distance::DistanceType::CosineExpanded,
+               "CAGRA supports only the L2Expanded, InnerProduct and CosineExpanded metrics");
   std::optional<raft::host_matrix<IdxT, int64_t>> knn_graph(
     raft::make_host_matrix<IdxT, int64_t>(dataset.extent(0), intermediate_degree));
 
-  if (params.build_algo == graph_build_algo::IVF_PQ) {
-    build_knn_graph(res, dataset, knn_graph->view(), refine_rate, pq_build_params, search_params);
-
+  if (params.metric == distance::DistanceType::CosineExpanded) {
+    // The cosine kNN graph is the L2 kNN graph of the normalized rows.
+    auto normalized = make_normalized_dataset(res, dataset);
+    build_intermediate_graph<IdxT>(res,
+                                   params,
+                                   raft::make_const_mdspan(normalized.view()),
+                                   knn_graph->view(),
+                                   distance::DistanceType::L2Expanded,
+                                   intermediate_degree,
+                                   nn_descent_params,
+                                   refine_rate,
+                                   pq_build_params,
+                                   search_params);
   } else {
-    // Use nn-descent to build CAGRA knn graph
-    if (!nn_descent_params) {
-      nn_descent_params                            = experimental::nn_descent::index_params();
-      nn_descent_params->graph_degree              = intermediate_degree;
-      nn_descent_params->intermediate_graph_degree = 1.5 * intermediate_degree;
-      nn_descent_params->max_iterations            = params.nn_descent_niter;
-    }
-    build_knn_graph<T, IdxT>(res, dataset, knn_graph->view(), *nn_descent_params);
+    build_intermediate_graph<IdxT>(res,
+                                   params,
+                                   dataset,
+                                   knn_graph->view(),
+                                   params.metric,
+                                   intermediate_degree,
+                                   nn_descent_params,
+                                   refine_rate,
+                                   pq_build_params,
+                                   search_params);
   }
 
   auto cagra_graph = raft::make_host_matrix<IdxT, int64_t>(dataset.extent(0), graph_degree);
@@ -339,7 +743,35 @@ index<T, IdxT> build(
   // free intermediate graph before trying to create the index
   knn_graph.reset();
 
+  if (!params.attach_dataset_on_build) {
+    // The dataset is supplied later by the user, e.g. as a host-resident array.
+    index<T, IdxT> idx(res, params.metric);
+    idx.update_graph(res, raft::make_const_mdspan(cagra_graph.view()));
+    resource::sync_stream(res);
+    return idx;
+  }
+
+  std::optional<index<T, IdxT>> reordered_idx;
+  if (params.reordering == graph_reordering::BFS) {
+    common::nvtx::range<common::nvtx::domain::raft> reorder_scope("cagra::build::reorder");
+    const auto order = make_bfs_order<IdxT>(raft::make_const_mdspan(cagra_graph.view()));
+    reorder_graph<IdxT>(cagra_graph.view(), order);
+    reordered_idx.emplace(res, params.metric);
+    reordered_idx->update_graph(res, raft::make_const_mdspan(cagra_graph.view()));
+    attach_reordered_dataset<T, IdxT>(res, *reordered_idx, dataset, order);
+  }
+
   // Construct an index from dataset and optimized knn graph.
-  return index<T, IdxT>(res, params.metric, dataset, raft::make_const_mdspan(cagra_graph.view()));
+  index<T, IdxT> idx =
+    reordered_idx.has_value()
+      ? std::move(*reordered_idx)
+      : index<T, IdxT>(res, params.metric, dataset, raft::make_const_mdspan(cagra_graph.view()));
+  if (params.metric == distance::DistanceType::CosineExpanded) {
+    idx.update_dataset_norms(res, make_dataset_norms(res, idx));
+  }
+  if (params.n_entry_points > 0) {
+    idx.update_entry_points(res, make_entry_points(res, idx, params.n_entry_points));
+  }
+  return idx;
 }
 }  // namespace raft::neighbors::cagra::detail
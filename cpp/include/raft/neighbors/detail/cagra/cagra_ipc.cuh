@@ -0,0 +1,245 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <cuda_runtime_api.h>
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace raft::neighbors::cagra {
+
+/**
+ * @brief The description of a CAGRA index exported by `cagra::export_ipc`.
+ *
+ * A plain structure that can be sent as is (e.g. as bytes over a pipe or a socket) to the other
+ * processes of the same node, which map the index with `cagra::import_ipc`. All the arrays of the
+ * index are stored in one device allocation, at the given byte offsets.
+ */
+struct ipc_handle {
+  /** The CUDA IPC handle of the allocation. */
+  cudaIpcMemHandle_t memory;
+  /** The size of the allocation in bytes. */
+  uint64_t size;
+  /** `sizeof(T)` and `sizeof(IdxT)` of the index, checked by the import. */
+  uint32_t value_size;
+  uint32_t index_size;
+  raft::distance::DistanceType metric;
+  int64_t n_rows;
+  uint32_t dim;
+  uint32_t graph_degree;
+  /** The row stride of the dataset, in elements. */
+  int64_t dataset_stride;
+  uint64_t dataset_offset;
+  uint64_t graph_offset;
+  /** The dataset norms, if `norms_offset > 0`. */
+  uint64_t norms_offset;
+  int64_t n_entry_points;
+  uint64_t entry_points_offset;
+  int64_t n_source_indices;
+  uint64_t source_indices_offset;
+};
+
+static_assert(std::is_trivially_copyable_v<ipc_handle>);
+
+}  // namespace raft::neighbors::cagra
+
+namespace raft::neighbors::cagra::detail {
+
+/** The alignment of the arrays in the shared allocation. */
+constexpr uint64_t kIpcAlignment = 256;
+
+/** Reserve `bytes` in the shared allocation and return their offset. */
+inline auto ipc_reserve(uint64_t& size, uint64_t bytes) -> uint64_t
+{
+  const uint64_t offset = raft::round_up_safe<uint64_t>(size, kIpcAlignment);
+  size                  = offset + bytes;
+  return offset;
+}
+
+template <typename T, typename IdxT>
+auto export_ipc(raft::resources const& res, index<T, IdxT>& idx) -> ipc_handle
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::export_ipc(%zu, %u)", static_cast<size_t>(idx.size()), idx.dim());
+  RAFT_EXPECTS(idx.size() > 0 && idx.dataset().extent(0) == int64_t(idx.size()),
+               "The dataset must be attached to the index to export it");
+  RAFT_EXPECTS(idx.graph_bits() == 0,
+               "A compressed graph cannot be exported; call decompress_graph first");
+  RAFT_EXPECTS(idx.n_removed() == 0,
+               "An index with removed nodes cannot be exported; call cagra::compact first");
+  cudaPointerAttributes attr;
+  RAFT_CUDA_TRY(cudaPointerGetAttributes(&attr, idx.dataset().data_handle()));
+  RAFT_EXPECTS(attr.type == cudaMemoryTypeDevice,
+               "Only a device-resident dataset can be exported");
+
+  auto stream          = resource::get_cuda_stream(res);
+  const int64_t n_rows = idx.size();
+  const auto dataset   = idx.dataset();
+  const auto graph     = idx.graph();
+
+  ipc_handle handle{};
+  handle.value_size     = sizeof(T);
+  handle.index_size     = sizeof(IdxT);
+  handle.metric         = idx.metric();
+  handle.n_rows         = n_rows;
+  handle.dim            = idx.dim();
+  handle.graph_degree   = idx.graph_degree();
+  handle.dataset_stride = dataset.stride(0);
+  uint64_t size         = 0;
+  handle.dataset_offset = ipc_reserve(size, sizeof(T) * n_rows * dataset.stride(0));
+  handle.graph_offset   = ipc_reserve(size, sizeof(IdxT) * graph.size());
+  if (idx.dataset_norms().extent(0) == n_rows) {
+    handle.norms_offset = ipc_reserve(size, sizeof(float) * n_rows);
+  }
+  handle.n_entry_points = idx.entry_points().extent(0);
+  if (handle.n_entry_points > 0) {
+    handle.entry_points_offset = ipc_reserve(size, sizeof(IdxT) * handle.n_entry_points);
+  }
+  handle.n_source_indices = idx.source_indices().extent(0);
+  if (handle.n_source_indices > 0) {
+    handle.source_indices_offset = ipc_reserve(size, sizeof(IdxT) * handle.n_source_indices);
+  }
+  handle.size = size;
+
+  // Not from the memory resource: a pool suballocation could not be mapped by the other processes.
+  void* ptr = nullptr;
+  RAFT_CUDA_TRY(cudaMalloc(&ptr, size));
+  std::shared_ptr<void> storage(ptr, [](void* p) { RAFT_CUDA_TRY_NO_THROW(cudaFree(p)); });
+  auto* base = static_cast<uint8_t*>(ptr);
+
+  RAFT_CUDA_TRY(cudaMemcpyAsync(base + handle.dataset_offset,
+                                dataset.data_handle(),
+                                sizeof(T) * n_rows * dataset.stride(0),
+                                cudaMemcpyDefault,
+                                stream));
+  raft::copy(
+    reinterpret_cast<IdxT*>(base + handle.graph_offset), graph.data_handle(), graph.size(), stream);
+  if (handle.norms_offset > 0) {
+    raft::copy(reinterpret_cast<float*>(base + handle.norms_offset),
+               idx.dataset_norms().data_handle(),
+               n_rows,
+               stream);
+  }
+  if (handle.n_entry_points > 0) {
+    raft::copy(reinterpret_cast<IdxT*>(base + handle.entry_points_offset),
+               idx.entry_points().data_handle(),
+               handle.n_entry_points,
+               stream);
+  }
+  if (handle.n_source_indices > 0) {
+    raft::copy(reinterpret_cast<IdxT*>(base + handle.source_indices_offset),
+               idx.source_indices().data_handle(),
+               handle.n_source_indices,
+               stream);
+  }
+  RAFT_CUDA_TRY(cudaIpcGetMemHandle(&handle.memory, ptr));
+  resource::sync_stream(res);
+
+  // The index now reads the shared allocation, and its own copies are released.
+  auto norms = raft::make_device_vector<float, int64_t>(res, 0);
+  if (handle.norms_offset > 0) {
+    norms = raft::make_device_vector<float, int64_t>(res, n_rows);
+    raft::copy(norms.data_handle(), idx.dataset_norms().data_handle(), n_rows, stream);
+  }
+  idx.update_dataset(res,
+                     raft::make_device_strided_matrix_view<const T, int64_t>(
+                       reinterpret_cast<const T*>(base + handle.dataset_offset),
+                       n_rows,
+                       handle.dim,
+                       handle.dataset_stride));
+  idx.update_graph(res,
+                   raft::make_device_matrix_view<const IdxT, int64_t>(
+                     reinterpret_cast<const IdxT*>(base + handle.graph_offset),
+                     n_rows,
+                     handle.graph_degree));
+  if (handle.norms_offset > 0) { idx.update_dataset_norms(res, std::move(norms)); }
+  idx.attach_external_storage(std::move(storage));
+  resource::sync_stream(res);
+  RAFT_LOG_DEBUG("Exported a CAGRA index of %zu bytes", static_cast<size_t>(size));
+  return handle;
+}
+
+template <typename T, typename IdxT>
+auto import_ipc(raft::resources const& res, const ipc_handle& handle) -> index<T, IdxT>
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::import_ipc(%zu, %u)", static_cast<size_t>(handle.n_rows), handle.dim);
+  RAFT_EXPECTS(handle.value_size == sizeof(T) && handle.index_size == sizeof(IdxT),
+               "The exported index has different data or index types");
+  auto stream = resource::get_cuda_stream(res);
+
+  void* ptr = nullptr;
+  RAFT_CUDA_TRY(cudaIpcOpenMemHandle(&ptr, handle.memory, cudaIpcMemLazyEnablePeerAccess));
+  std::shared_ptr<void> storage(ptr,
+                                [](void* p) { RAFT_CUDA_TRY_NO_THROW(cudaIpcCloseMemHandle(p)); });
+  const auto* base = static_cast<const uint8_t*>(ptr);
+
+  index<T, IdxT> idx(res, handle.metric);
+  idx.update_graph(res,
+                   raft::make_device_matrix_view<const IdxT, int64_t>(
+                     reinterpret_cast<const IdxT*>(base + handle.graph_offset),
+                     handle.n_rows,
+                     handle.graph_degree));
+  idx.update_dataset(res,
+                     raft::make_device_strided_matrix_view<const T, int64_t>(
+                       reinterpret_cast<const T*>(base + handle.dataset_offset),
+                       handle.n_rows,
+                       handle.dim,
+                       handle.dataset_stride));
+  // The small arrays are copied, the index owns them.
+  if (handle.norms_offset > 0) {
+    auto norms = raft::make_device_vector<float, int64_t>(res, handle.n_rows);
+    raft::copy(norms.data_handle(),
+               reinterpret_cast<const float*>(base + handle.norms_offset),
+               handle.n_rows,
+               stream);
+    idx.update_dataset_norms(res, std::move(norms));
+  }
+  if (handle.n_entry_points > 0) {
+    auto entry_points = raft::make_device_vector<IdxT, int64_t>(res, handle.n_entry_points);
+    raft::copy(entry_points.data_handle(),
+               reinterpret_cast<const IdxT*>(base + handle.entry_points_offset),
+               handle.n_entry_points,
+               stream);
+    idx.update_entry_points(res, std::move(entry_points));
+  }
+  if (handle.n_source_indices > 0) {
+    auto source_indices = raft::make_device_vector<IdxT, int64_t>(res, handle.n_source_indices);
+    raft::copy(source_indices.data_handle(),
+               reinterpret_cast<const IdxT*>(base + handle.source_indices_offset),
+               handle.n_source_indices,
+               stream);
+    idx.update_source_indices(res, std::move(source_indices));
+  }
+  idx.attach_external_storage(std::move(storage));
+  resource::sync_stream(res);
+  return idx;
+}
+
+}  // namespace raft::neighbors::cagra::detail
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "../ivf_pq_memory.cuh"
+#include "../nn_descent_memory.cuh"
+#include "cagra_build.cuh"
+#include "search_plan.cuh"
+#include "topk_for_cagra/topk_core.cuh"
+#include "utils.hpp"
+
+#include <raft/core/memory_type.hpp>
+#include <raft/core/resource/device_properties.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/neighbors/ann_types.hpp>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace raft::neighbors::cagra::detail {
+
+/**
+ * The kNN graph build of `build`, with the default parameters of the graph build algorithm.
+ *
+ * The dataset is assumed to be copied to the device for the refinement of the IVF-PQ candidates
+ * (as done whenever it fits), and NN-descent to run on the whole dataset.
+ */
+template <typename T, typename IdxT>
+auto estimate_knn_graph_memory(raft::resources const& res,
+                               const index_params& params,
+                               int64_t n_rows,
+                               uint32_t dim,
+                               uint32_t intermediate_degree,
+                               memory_type dataset_memory) -> ann::memory_estimate
+{
+  const uint64_t n = n_rows;
+  ann::memory_estimate estimate;
+  if (params.build_algo == graph_build_algo::IVF_PQ) {
+    const auto metric = params.metric == distance::DistanceType::CosineExpanded
+                          ? distance::DistanceType::L2Expanded
+                          : params.metric;
+    const auto pq_params = default_knn_graph_build_params(n_rows, dim, metric);
+    const auto pq        = ivf_pq::detail::estimate_build_memory<T, int64_t>(
+      res, pq_params, n_rows, dim, dataset_memory);
+
+    const auto search_params = default_knn_graph_search_params(dim, pq_params);
+    const auto shape         = ivf_pq::detail::make_index_shape(pq_params, dim);
+    const uint64_t top_k     = intermediate_degree + 1;
+    const uint64_t gpu_top_k = knn_graph_candidates(intermediate_degree, std::nullopt, n_rows);
+    const uint64_t batch     = std::min<uint64_t>(n, 4096);
+    uint64_t search =
+      ivf_pq::detail::estimate_search_workspace(
+        res,
+        search_params,
+        shape,
+        ivf_pq::detail::estimate_max_samples(shape, n, search_params.n_probes),
+        batch,
+        gpu_top_k) +
+      batch * gpu_top_k * (sizeof(float) + sizeof(int64_t)) +
+      batch * top_k * (2 * sizeof(int64_t) + sizeof(float));
+    if (!is_device_accessible(dataset_memory)) { search += n * dim * sizeof(T); }
+
+    estimate.device_workspace = pq.device_index + std::max(pq.device_workspace, search);
+    estimate.host             = pq.host + 2 * batch * top_k * sizeof(int64_t);
+  } else {
+    experimental::nn_descent::index_params nn_params;
+    nn_params.graph_degree              = intermediate_degree;
+    nn_params.intermediate_graph_degree = 1.5 * intermediate_degree;
+    nn_params.max_iterations            = params.nn_descent_niter;
+    const auto nn = experimental::nn_descent::detail::estimate_build_memory<T, IdxT>(
+      nn_params, n_rows, dim, dataset_memory);
+    // The NN-descent index is a view of the intermediate graph; `sort_knn_graph` copies the
+    // dataset and the graph to the device.
+    estimate.device_workspace = std::max<uint64_t>(
+      nn.device_workspace, n * (intermediate_degree * sizeof(IdxT) + dim * sizeof(T)));
+    estimate.host = nn.host - n * intermediate_degree * sizeof(IdxT);
+  }
+  return estimate;
+}
+
+template <typename T, typename IdxT>
+auto estimate_build_memory(raft::resources const& res,
+                           const index_params& params,
+                           int64_t n_rows,
+                           uint32_t dim,
+                           memory_type dataset_memory) -> ann::memory_estimate
+{
+  // The degrees as adjusted by `build`
+  size_t intermediate_degree = params.intermediate_graph_degree;
+  size_t graph_degree        = params.graph_degree;
+  if (intermediate_degree >= static_cast<size_t>(n_rows)) {
+    intermediate_degree = std::max<int64_t>(n_rows - 1, 0);
+  }
+  graph_degree      = std::min(graph_degree, intermediate_degree);
+  const uint64_t n  = n_rows;
+  const bool cosine = params.metric == distance::DistanceType::CosineExpanded;
+
+  // The intermediate kNN graph; the cosine graph is built on a normalized device copy.
+  const uint64_t knn_graph = n * intermediate_degree * sizeof(IdxT);
+  auto knn = cosine ? estimate_knn_graph_memory<float, IdxT>(
+                        res, params, n_rows, dim, intermediate_degree, memory_type::device)
+                    : estimate_knn_graph_memory<T, IdxT>(
+                        res, params, n_rows, dim, intermediate_degree, dataset_memory);
+  if (cosine) { knn.device_workspace += n * (dim + 1) * sizeof(float); }
+
+  // `optimize`: the pruning of the kNN graph (kept on the device), then the reverse graph
+  const optimize_params opt_params{};
+  const uint64_t prune_batch = std::min<uint64_t>(n, opt_params.prune_batch_size);
+  const uint64_t reverse     = n * (graph_degree * sizeof(IdxT) + sizeof(uint32_t) + sizeof(IdxT));
+
+  const uint64_t optimize_device = std::max<uint64_t>(
+    knn_graph + prune_batch * (intermediate_degree * sizeof(uint8_t) + sizeof(uint32_t)), reverse);
+  // the pruned graph, the detour counts of a batch and the reverse graph
+  const uint64_t optimize_host =
+    n * graph_degree * sizeof(IdxT) + prune_batch * intermediate_degree * sizeof(uint8_t) + reverse;
+
+  ann::memory_estimate estimate;
+  estimate.device_index = n * graph_degree * sizeof(IdxT);
+  uint64_t final_device = 0;
+  uint64_t final_host   = n * graph_degree * sizeof(IdxT);
+  if (params.attach_dataset_on_build) {
+    estimate.device_index += n * raft::round_up_safe<uint64_t>(dim * sizeof(T), 16);
+    if (cosine) { estimate.device_index += n * sizeof(float); }
+    estimate.device_index += params.n_entry_points * sizeof(IdxT);
+    if (params.reordering == graph_reordering::BFS) {
+      // the source indices, the order and the reordered graph and dataset
+      estimate.device_index += n * sizeof(IdxT);
+      final_host += n * (graph_degree + 2) * sizeof(IdxT);
+      if (is_device_accessible(dataset_memory)) {
+        final_device += n * dim * sizeof(T);
+      } else {
+        final_host += n * dim * sizeof(T);
+      }
+    }
+  }
+
+  estimate.device_workspace = std::max({knn.device_workspace, optimize_device, final_device});
+  estimate.host             = knn_graph + std::max({knn.host, optimize_host, final_host});
+  return estimate;
+}
+
+template <typename T, typename IdxT>
+auto estimate_search_memory(raft::resources const& res,
+                            search_params params,
+                            const index<T, IdxT>& idx,
+                            uint32_t n_queries,
+                            uint32_t k) -> ann::memory_estimate
+{
+  using internal_IdxT     = typename std::make_unsigned<IdxT>::type;
+  const uint64_t idx_size = sizeof(internal_IdxT);
+  const uint64_t entry    = sizeof(internal_IdxT) + sizeof(float);
+  const uint32_t dim      = idx.dim();
+  const uint64_t n_rows   = idx.dataset().extent(0);
+
+  ann::memory_estimate estimate;
+  // The sorted queries and their results
+  if (params.reorder_queries && n_queries > 1 && idx.size() > 0) {
+    estimate.device_workspace += uint64_t(n_queries) * (dim * sizeof(T) + sizeof(uint32_t) * 2 +
+                                                        uint64_t(k) * entry);
+  }
+
+  // The plan as made by `search`
+  if (params.max_queries == 0) {
+    params.max_queries =
+      std::min<size_t>(n_queries, resource::get_device_properties(res).maxGridSize[1]);
+  }
+  search_plan_impl_base plan(params, dim, idx.graph_degree(), k);
+  plan.adjust_search_params();
+  plan.check_params(false);
+  plan.calc_hashmap_params(idx_size);
+  const uint64_t max_queries = plan.max_queries;
+
+  uint64_t plan_size = max_queries * (sizeof(uint32_t) + idx.entry_points().extent(0) * idx_size);
+  switch (plan.algo) {
+    case search_algo::SINGLE_CTA:
+      if (plan.small_hash_bitlen == 0) { plan_size += plan.hashmap_size * idx_size; }
+      break;
+    case search_algo::MULTI_CTA: {
+      const uint64_t num_cta_per_query = std::max<uint64_t>(
+        params.search_width, raft::div_rounding_up_safe<uint64_t>(params.itopk_size, 32));
+      const uint64_t n_results = num_cta_per_query * 32;
+      plan_size += n_results * max_queries * entry + plan.hashmap_size * idx_size;
+      plan_size += sizeof(uint32_t) * _cuann_find_topk_bufferSize(
+                                        k, max_queries, n_results, utils::get_cuda_data_type<T>());
+      break;
+    }
+    case search_algo::MULTI_KERNEL: {
+      const uint64_t result_buffer_size =
+        plan.itopk_size + plan.search_width * uint64_t(idx.graph_degree());
+      plan_size += (result_buffer_size + plan.itopk_size) * max_queries * entry;
+      plan_size += max_queries * (plan.search_width * idx_size + sizeof(uint32_t));
+      plan_size += sizeof(uint32_t) * _cuann_find_topk_bufferSize(plan.itopk_size,
+                                                                  max_queries,
+                                                                  result_buffer_size,
+                                                                  utils::get_cuda_data_type<T>());
+      plan_size += plan.hashmap_size * idx_size;
+      break;
+    }
+    default: break;
+  }
+  estimate.device_workspace += plan_size;
+
+  // The query norms and, if the index has none, the dataset norms of the cosine distances
+  if (idx.metric() == distance::DistanceType::CosineExpanded) {
+    estimate.device_workspace += sizeof(float) * max_queries;
+    if (idx.dataset_norms().extent(0) != int64_t(n_rows)) {
+      estimate.device_workspace += sizeof(float) * n_rows;
+    }
+  }
+  return estimate;
+}
+
+}  // namespace raft::neighbors::cagra::detail
@@ -16,7 +16,9 @@
 
 #pragma once
 
+#include <raft/core/resource/cancellation_token.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/metrics.hpp>
 #include <raft/neighbors/detail/ivf_pq_search.cuh>
 #include <raft/neighbors/sample_filter_types.hpp>
 #include <raft/spatial/knn/detail/ann_utils.cuh>
@@ -28,7 +30,11 @@
 #include <raft/neighbors/cagra_types.hpp>
 #include <rmm/cuda_stream_view.hpp>
 
+#include "dataset_norms.cuh"
+#include "entry_points.cuh"
 #include "factory.cuh"
+#include "query_reorder.cuh"
+#include "reorder.cuh"
 #include "search_plan.cuh"
 #include "search_single_cta.cuh"
 
@@ -58,6 +64,11 @@ template <>
 struct CagraSampleFilterT_Selector<raft::neighbors::filtering::none_cagra_sample_filter> {
   using type = raft::neighbors::filtering::none_cagra_sample_filter;
 };
+// The removed-nodes filter does not depend on the query, so it is passed to the kernels as is.
+template <>
+struct CagraSampleFilterT_Selector<raft::neighbors::filtering::removed_cagra_sample_filter> {
+  using type = raft::neighbors::filtering::removed_cagra_sample_filter;
+};
 
 // A helper function to set a query id offset
 template <class CagraSampleFilterT>
@@ -75,6 +86,170 @@ inline
 {
   return filter;
 }
+template <>
+inline typename CagraSampleFilterT_Selector<
+  raft::neighbors::filtering::removed_cagra_sample_filter>::type
+set_offset<raft::neighbors::filtering::removed_cagra_sample_filter>(
+  raft::neighbors::filtering::removed_cagra_sample_filter filter, const uint32_t)
+{
+  return filter;
+}
+
+/**
+ * Restore the distances of the index metric from the values returned by the search kernels.
+ *
+ * The queries are used only by the CosineExpanded metric, which divides by their norms.
+ */
+template <typename T, typename DistanceT>
+void postprocess_search_distances(raft::resources const& res,
+                                  distance::DistanceType metric,
+                                  raft::device_matrix_view<const T, int64_t, row_major> queries,
+                                  raft::device_matrix_view<DistanceT, int64_t, row_major> distances)
+{
+  auto stream          = resource::get_cuda_stream(res);
+  const uint32_t topk  = distances.extent(1);
+  const auto query_dim = queries.extent(1);
+
+  static_assert(std::is_same_v<DistanceT, float>,
+                "only float distances are supported at the moment");
+  float* dist_out          = distances.data_handle();
+  const DistanceT* dist_in = distances.data_handle();
+  if (metric == distance::DistanceType::CosineExpanded) {
+    // The kernels return -<q, x> / |x|; the scale of the elements cancels out in the cosine.
+    rmm::device_uvector<float> query_norms(
+      queries.extent(0), stream, resource::get_workspace_resource(res));
+    compute_row_norms(
+      res,
+      raft::make_device_strided_matrix_view<const T, int64_t>(
+        queries.data_handle(), queries.extent(0), query_dim, query_dim),
+      raft::make_device_vector_view<float, int64_t>(query_norms.data(), query_norms.size()));
+    raft::linalg::map_offset(
+      res,
+      raft::make_device_vector_view<float, int64_t>(dist_out, distances.size()),
+      cosine_distance_op{dist_in, query_norms.data(), topk});
+    return;
+  }
+  // We're converting the data from T to DistanceT during distance computation
+  // and divide the values by kDivisor. Here we restore the original scale.
+  constexpr float kScale = spatial::knn::detail::utils::config<T>::kDivisor /
+                           spatial::knn::detail::utils::config<DistanceT>::kDivisor;
+  ivf_pq::detail::postprocess_distances(
+    dist_out, dist_in, metric, distances.extent(0), distances.extent(1), kScale, stream);
+}
+
+/**
+ * @brief Search ANN using a search plan created beforehand.
+ *
+ * The plan must have been created for the dimensionality and graph degree of `index` and
+ * `neighbors.extent(1)` neighbors; its workspace is reused by every call.
+ */
+template <typename T,
+          typename internal_IdxT,
+          typename CagraSampleFilterT,
+          typename IdxT      = uint32_t,
+          typename DistanceT = float>
+void search_with_plan(
+  raft::resources const& res,
+  search_plan_impl<T,
+                   internal_IdxT,
+                   DistanceT,
+                   typename CagraSampleFilterT_Selector<CagraSampleFilterT>::type>& plan,
+  const index<T, IdxT>& index,
+  raft::device_matrix_view<const T, int64_t, row_major> queries,
+  raft::device_matrix_view<internal_IdxT, int64_t, row_major> neighbors,
+  raft::device_matrix_view<DistanceT, int64_t, row_major> distances,
+  CagraSampleFilterT sample_filter = CagraSampleFilterT())
+{
+  RAFT_EXPECTS(plan.dim == static_cast<int64_t>(index.dim()) &&
+                 plan.graph_degree == static_cast<int64_t>(index.graph_degree()),
+               "The search plan was created for an index of a different shape");
+  const uint32_t topk = neighbors.extent(1);
+  RAFT_EXPECTS(topk == plan.topk,
+               "The search plan was created for k = %u, but %u neighbors were requested",
+               plan.topk,
+               topk);
+
+  RAFT_LOG_DEBUG("Cagra search");
+  const uint32_t max_queries = plan.max_queries;
+  const uint32_t query_dim   = queries.extent(1);
+  auto stream                = resource::get_cuda_stream(res);
+
+  const bool cosine = index.metric() == distance::DistanceType::CosineExpanded;
+  // the norms of the dataset rows are normally computed by the build
+  rmm::device_uvector<float> dataset_norms(0, stream, resource::get_workspace_resource(res));
+  const float* dataset_norms_ptr = index.dataset_norms().data_handle();
+  if (cosine && index.dataset_norms().extent(0) != index.dataset().extent(0)) {
+    RAFT_LOG_DEBUG("Computing the dataset norms of a CosineExpanded CAGRA index");
+    dataset_norms.resize(index.dataset().extent(0), stream);
+    compute_row_norms(res,
+                      index.dataset(),
+                      raft::make_device_vector_view<float, int64_t>(dataset_norms.data(),
+                                                                    dataset_norms.size()));
+    dataset_norms_ptr = dataset_norms.data();
+  }
+  plan.metric = make_search_metric(index.metric(), dataset_norms_ptr);
+
+  // The entry points are the first seeds of every query of a batch.
+  const uint32_t n_entry_points = index.entry_points().extent(0);
+  plan.num_seeds                = n_entry_points;
+  if (n_entry_points > 0) {
+    plan.dev_seed.resize(size_t(max_queries) * n_entry_points, stream);
+    raft::linalg::map_offset(
+      res,
+      raft::make_device_vector_view<internal_IdxT, int64_t>(plan.dev_seed.data(),
+                                                            plan.dev_seed.size()),
+      broadcast_entry_points_op<internal_IdxT>{
+        reinterpret_cast<const internal_IdxT*>(index.entry_points().data_handle()),
+        n_entry_points});
+  }
+
+  for (unsigned qid = 0; qid < queries.extent(0); qid += max_queries) {
+    resource::check_cancellation(res);
+    const uint32_t n_queries = std::min<std::size_t>(max_queries, queries.extent(0) - qid);
+    internal_IdxT* _topk_indices_ptr =
+      reinterpret_cast<internal_IdxT*>(neighbors.data_handle()) + (topk * qid);
+    DistanceT* _topk_distances_ptr = distances.data_handle() + (topk * qid);
+    // todo(tfeher): one could keep distances optional and pass nullptr
+    const T* _query_ptr = queries.data_handle() + (query_dim * qid);
+    const internal_IdxT* _seed_ptr = plan.num_seeds > 0 ? plan.dev_seed.data() : nullptr;
+    uint32_t* _num_executed_iterations = nullptr;
+
+    auto dataset_internal =
+      make_device_strided_matrix_view<const T, int64_t, row_major>(index.dataset().data_handle(),
+                                                                   index.dataset().extent(0),
+                                                                   index.dataset().extent(1),
+                                                                   index.dataset().stride(0));
+    auto graph_internal = kernel_graph_view<internal_IdxT>(index);
+
+    plan(res,
+         dataset_internal,
+         graph_internal,
+         index.graph_bits(),
+         _topk_indices_ptr,
+         _topk_distances_ptr,
+         _query_ptr,
+         n_queries,
+         _seed_ptr,
+         _num_executed_iterations,
+         topk,
+         set_offset(sample_filter, qid));
+  }
+
+  postprocess_search_distances(res, index.metric(), queries, distances);
+
+  // The nodes of a reordered index are translated back to the dataset rows.
+  if (index.source_indices().extent(0) > 0) {
+    auto neighbors_flat = raft::make_device_vector_view<internal_IdxT, int64_t>(
+      neighbors.data_handle(), neighbors.size());
+    auto source_indices =
+      reinterpret_cast<const internal_IdxT*>(index.source_indices().data_handle());
+    raft::linalg::map(res,
+                      neighbors_flat,
+                      source_index_op<internal_IdxT>{source_indices,
+                                                     static_cast<internal_IdxT>(index.size())},
+                      raft::make_const_mdspan(neighbors_flat));
+  }
+}
 
 /**
  * @brief Search ANN using the constructed index.
@@ -118,6 +293,43 @@ void search_main(raft::resources const& res,
   RAFT_EXPECTS(queries.extent(1) == index.dim(), "Queries and index dim must match");
   const uint32_t topk = neighbors.extent(1);
 
+  if constexpr (is_query_independent_filter<CagraSampleFilterT>::value) {
+    if (params.reorder_queries && queries.extent(0) > 1 && index.size() > 0) {
+      // Search the queries sorted by their nearest center, then restore the input order.
+      const int64_t n_queries = queries.extent(0);
+      auto order              = sort_queries_by_center(res, index, queries);
+      auto sorted_queries =
+        raft::make_device_matrix<T, int64_t>(res, n_queries, queries.extent(1));
+      raft::matrix::gather(res,
+                           queries,
+                           raft::make_device_vector_view<const uint32_t, int64_t>(order.data(),
+                                                                                  n_queries),
+                           sorted_queries.view());
+      auto sorted_neighbors =
+        raft::make_device_matrix<internal_IdxT, int64_t>(res, n_queries, topk);
+      auto sorted_distances  = raft::make_device_matrix<DistanceT, int64_t>(res, n_queries, topk);
+      params.reorder_queries = false;
+      search_main<T, internal_IdxT, CagraSampleFilterT, IdxT, DistanceT>(
+        res,
+        params,
+        index,
+        raft::make_const_mdspan(sorted_queries.view()),
+        sorted_neighbors.view(),
+        sorted_distances.view(),
+        sample_filter);
+      thrust::for_each_n(resource::get_thrust_policy(res),
+                         thrust::make_counting_iterator<int64_t>(0),
+                         sorted_neighbors.size(),
+                         unsort_results_op<internal_IdxT, DistanceT>{order.data(),
+                                                                     sorted_neighbors.data_handle(),
+                                                                     sorted_distances.data_handle(),
+                                                                     topk,
+                                                                     neighbors.data_handle(),
+                                                                     distances.data_handle()});
+      return;
+    }
+  }
+
   cudaDeviceProp deviceProp = resource::get_device_properties(res);
   if (params.max_queries == 0) {
     params.max_queries = std::min<size_t>(queries.extent(0), deviceProp.maxGridSize[1]);
@@ -125,70 +337,26 @@ void search_main(raft::resources const& res,
 
   common::nvtx::range<common::nvtx::domain::raft> fun_scope(
     "cagra::search(max_queries = %u, k = %u, dim = %zu)", params.max_queries, topk, index.dim());
+  resource::scoped_call call(res, "cagra::search");
+  call.set_batch_size(queries.extent(0));
 
   using CagraSampleFilterT_s = typename CagraSampleFilterT_Selector<CagraSampleFilterT>::type;
   std::unique_ptr<search_plan_impl<T, internal_IdxT, DistanceT, CagraSampleFilterT_s>> plan =
     factory<T, internal_IdxT, DistanceT, CagraSampleFilterT_s>::create(
       res, params, index.dim(), index.graph_degree(), topk);
-
-  plan->check(neighbors.extent(1));
-
-  RAFT_LOG_DEBUG("Cagra search");
-  const uint32_t max_queries = plan->max_queries;
-  const uint32_t query_dim   = queries.extent(1);
-
-  for (unsigned qid = 0; qid < queries.extent(0); qid += max_queries) {
-    const uint32_t n_queries = std::min<std::size_t>(max_queries, queries.extent(0) - qid);
-    internal_IdxT* _topk_indices_ptr =
-      reinterpret_cast<internal_IdxT*>(neighbors.data_handle()) + (topk * qid);
-    DistanceT* _topk_distances_ptr = distances.data_handle() + (topk * qid);
-    // todo(tfeher): one could keep distances optional and pass nullptr
-    const T* _query_ptr = queries.data_handle() + (query_dim * qid);
-    const internal_IdxT* _seed_ptr =
-      plan->num_seeds > 0
-        ? reinterpret_cast<const internal_IdxT*>(plan->dev_seed.data()) + (plan->num_seeds * qid)
-        : nullptr;
-    uint32_t* _num_executed_iterations = nullptr;
-
-    auto dataset_internal =
-      make_device_strided_matrix_view<const T, int64_t, row_major>(index.dataset().data_handle(),
-                                                                   index.dataset().extent(0),
-                                                                   index.dataset().extent(1),
-                                                                   index.dataset().stride(0));
-    auto graph_internal = raft::make_device_matrix_view<const internal_IdxT, int64_t, row_major>(
-      reinterpret_cast<const internal_IdxT*>(index.graph().data_handle()),
-      index.graph().extent(0),
-      index.graph().extent(1));
-
-    (*plan)(res,
-            dataset_internal,
-            graph_internal,
-            _topk_indices_ptr,
-            _topk_distances_ptr,
-            _query_ptr,
-            n_queries,
-            _seed_ptr,
-            _num_executed_iterations,
-            topk,
-            set_offset(sample_filter, qid));
+  plan->check(topk);
+  switch (plan->algo) {
+    case search_algo::SINGLE_CTA: call.set_algo("SINGLE_CTA"); break;
+    case search_algo::MULTI_CTA: call.set_algo("MULTI_CTA"); break;
+    case search_algo::MULTI_KERNEL: call.set_algo("MULTI_KERNEL"); break;
+    default: break;
   }
+  call.note_workspace();
 
-  static_assert(std::is_same_v<DistanceT, float>,
-                "only float distances are supported at the moment");
-  float* dist_out          = distances.data_handle();
-  const DistanceT* dist_in = distances.data_handle();
-  // We're converting the data from T to DistanceT during distance computation
-  // and divide the values by kDivisor. Here we restore the original scale.
-  constexpr float kScale = spatial::knn::detail::utils::config<T>::kDivisor /
-                           spatial::knn::detail::utils::config<DistanceT>::kDivisor;
-  ivf_pq::detail::postprocess_distances(dist_out,
-                                        dist_in,
-                                        index.metric(),
-                                        distances.extent(0),
-                                        distances.extent(1),
-                                        kScale,
-                                        resource::get_cuda_stream(res));
+  search_with_plan<T, internal_IdxT, CagraSampleFilterT, IdxT, DistanceT>(
+    res, *plan, index, queries, neighbors, distances, sample_filter);
 }
+
 /** @} */  // end group cagra
 
 }  // namespace raft::neighbors::cagra::detail
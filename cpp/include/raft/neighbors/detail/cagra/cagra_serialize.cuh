@@ -24,14 +24,25 @@
 #include <raft/core/nvtx.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/serialize.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/neighbors/brute_force.cuh>
 #include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/detail/id_compression.cuh>
+#include <raft/neighbors/hnsw_types.hpp>
+#include <raft/util/cudart_utils.hpp>
 
+#include "dataset_norms.cuh"
+
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <random>
 #include <type_traits>
+#include <vector>
 
 namespace raft::neighbors::cagra::detail {
 
-constexpr int serialization_version = 3;
+constexpr int serialization_version = 8;
 
 /**
  * Save the index to file.
@@ -47,7 +58,8 @@ template <typename T, typename IdxT>
 void serialize(raft::resources const& res,
                std::ostream& os,
                const index<T, IdxT>& index_,
-               bool include_dataset)
+               bool include_dataset,
+               bool compress = false)
 {
   common::nvtx::range<common::nvtx::domain::raft> fun_scope("cagra::serialize");
 
@@ -63,23 +75,39 @@ void serialize(raft::resources const& res,
   serialize_scalar(res, os, index_.dim());
   serialize_scalar(res, os, index_.graph_degree());
   serialize_scalar(res, os, index_.metric());
-  serialize_mdspan(res, os, index_.graph());
+  serialize_scalar(res, os, index_.graph_bits());
+  if (index_.graph_bits() == 0) {
+    serialize_scalar(res, os, compress);
+    if (compress) {
+      auto graph = index_.graph();
+      neighbors::detail::serialize_ids_compressed(
+        res,
+        os,
+        raft::make_device_vector_view<const IdxT, int64_t>(graph.data_handle(), graph.size()),
+        false);
+    } else {
+      serialize_mdspan(res, os, index_.graph());
+    }
+  } else {
+    serialize_scalar(res, os, index_.packed_graph().extent(0));
+    serialize_mdspan(res, os, index_.packed_graph());
+  }
+  serialize_scalar(res, os, index_.n_removed());
+  if (index_.n_removed() > 0) {
+    serialize_scalar(res, os, index_.alive_bits().extent(0));
+    serialize_mdspan(res, os, index_.alive_bits());
+  }
+  serialize_scalar(res, os, index_.entry_points().extent(0));
+  if (index_.entry_points().extent(0) > 0) { serialize_mdspan(res, os, index_.entry_points()); }
+  serialize_scalar(res, os, index_.source_indices().extent(0));
+  if (index_.source_indices().extent(0) > 0) {
+    serialize_mdspan(res, os, index_.source_indices());
+  }
 
   serialize_scalar(res, os, include_dataset);
   if (include_dataset) {
-    auto dataset = index_.dataset();
-    // Remove padding before saving the dataset
-    auto host_dataset = make_host_matrix<T, int64_t>(dataset.extent(0), dataset.extent(1));
-    RAFT_CUDA_TRY(cudaMemcpy2DAsync(host_dataset.data_handle(),
-                                    sizeof(T) * host_dataset.extent(1),
-                                    dataset.data_handle(),
-                                    sizeof(T) * dataset.stride(0),
-                                    sizeof(T) * host_dataset.extent(1),
-                                    dataset.extent(0),
-                                    cudaMemcpyDefault,
-                                    resource::get_cuda_stream(res)));
-    resource::sync_stream(res);
-    serialize_mdspan(res, os, host_dataset.view());
+    // The padding of the rows is removed by the strided serializer, chunk by chunk
+    serialize_mdspan(res, os, index_.dataset());
   }
 }
 
@@ -87,28 +115,150 @@ template <typename T, typename IdxT>
 void serialize(raft::resources const& res,
                const std::string& filename,
                const index<T, IdxT>& index_,
-               bool include_dataset)
+               bool include_dataset,
+               bool compress = false)
 {
   std::ofstream of(filename, std::ios::out | std::ios::binary);
   if (!of) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
 
-  detail::serialize(res, of, index_, include_dataset);
+  detail::serialize(res, of, index_, include_dataset, compress);
 
   of.close();
   if (!of) { RAFT_FAIL("Error writing output %s", filename.c_str()); }
 }
 
+/** Gather the rows of a (padded) dataset, converted to float, for the brute-force kNN. */
+template <typename T, typename IdxT>
+struct gather_rows_op {
+  const T* data;
+  int64_t stride;
+  int64_t dim;
+  const IdxT* rows;
+
+  RAFT_DEVICE_INLINE_FUNCTION auto operator()(int64_t i) const -> float
+  {
+    return static_cast<float>(data[static_cast<int64_t>(rows[i / dim]) * stride + i % dim]);
+  }
+};
+
+/**
+ * The upper layers of an HNSW index: for every level l > 0, the (sorted) ids of the nodes whose
+ * level is at least l and their neighbors among these nodes.
+ */
+template <typename IdxT>
+struct hnsw_upper_layers {
+  int max_level = 0;
+  std::vector<int> levels;
+  /** nodes[l - 1]: the ids of the nodes of the layer l. */
+  std::vector<std::vector<IdxT>> nodes;
+  /** graphs[l - 1]: [nodes[l - 1].size(), M] the neighbors in the layer l. */
+  std::vector<raft::host_matrix<IdxT, int64_t>> graphs;
+  /** degrees[l - 1]: the number of valid neighbors per node in the layer l. */
+  std::vector<uint32_t> degrees;
+};
+
+/**
+ * Build the upper layers of an HNSW index on the GPU.
+ *
+ * The levels are drawn from the same distribution as in hnswlib (`floor(-ln(u) * mult)`, with
+ * `mult = 1 / ln(M)`) with a fixed seed. Every layer holds ~1/M of the nodes of the layer below,
+ * so its exact kNN graph is computed with the brute-force search over the gathered nodes.
+ */
+template <typename T, typename IdxT>
+auto build_hnsw_upper_layers(raft::resources const& res,
+                             const raft::neighbors::cagra::index<T, IdxT>& index_,
+                             std::size_t M,
+                             double mult) -> hnsw_upper_layers<IdxT>
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("cagra::build_hnsw_upper_layers");
+  auto stream = resource::get_cuda_stream(res);
+  auto n_rows = static_cast<std::size_t>(index_.size());
+
+  hnsw_upper_layers<IdxT> layers;
+  layers.levels.resize(n_rows);
+  std::default_random_engine level_generator(100);
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+  for (std::size_t i = 0; i < n_rows; i++) {
+    // 1 - u is in (0, 1], which keeps the logarithm finite
+    layers.levels[i] = static_cast<int>(-std::log(1.0 - distribution(level_generator)) * mult);
+    layers.max_level = std::max(layers.max_level, layers.levels[i]);
+  }
+  for (int level = 1; level <= layers.max_level; level++) {
+    std::vector<IdxT> nodes;
+    for (std::size_t i = 0; i < n_rows; i++) {
+      if (layers.levels[i] >= level) { nodes.push_back(static_cast<IdxT>(i)); }
+    }
+    layers.nodes.push_back(std::move(nodes));
+  }
+
+  auto dataset = index_.dataset();
+  int64_t dim  = dataset.extent(1);
+  for (int level = 1; level <= layers.max_level; level++) {
+    const auto& nodes = layers.nodes[level - 1];
+    auto n_nodes      = static_cast<int64_t>(nodes.size());
+    auto degree       = static_cast<int64_t>(std::min<std::size_t>(M, nodes.size() - 1));
+    auto graph        = raft::make_host_matrix<IdxT, int64_t>(n_nodes, M);
+    std::fill(graph.data_handle(), graph.data_handle() + graph.size(), IdxT{0});
+    if (degree > 0) {
+      auto nodes_d = raft::make_device_vector<IdxT, int64_t>(res, n_nodes);
+      raft::copy(nodes_d.data_handle(), nodes.data(), n_nodes, stream);
+      auto vectors   = raft::make_device_matrix<float, int64_t>(res, n_nodes, dim);
+      auto gather_op = gather_rows_op<T, IdxT>{
+        dataset.data_handle(), dataset.stride(0), dim, nodes_d.data_handle()};
+      raft::linalg::map_offset(res, vectors.view(), gather_op);
+
+      // the nodes are their own nearest neighbors: search for one more and skip the self-match
+      auto neighbors_d = raft::make_device_matrix<int64_t, int64_t>(res, n_nodes, degree + 1);
+      auto distances_d = raft::make_device_matrix<float, int64_t>(res, n_nodes, degree + 1);
+      auto vectors_v   = raft::make_const_mdspan(vectors.view());
+      std::vector<raft::device_matrix_view<const float, int64_t, row_major>> db{vectors_v};
+      raft::neighbors::brute_force::knn<int64_t, float, int64_t>(
+        res, db, vectors_v, neighbors_d.view(), distances_d.view(), index_.metric());
+      auto neighbors = raft::make_host_matrix<int64_t, int64_t>(n_nodes, degree + 1);
+      raft::copy(neighbors.data_handle(), neighbors_d.data_handle(), neighbors_d.size(), stream);
+      resource::sync_stream(res);
+
+      for (int64_t i = 0; i < n_nodes; i++) {
+        int64_t k = 0;
+        for (int64_t j = 0; j <= degree && k < degree; j++) {
+          auto neighbor = neighbors(i, j);
+          if (neighbor == i || neighbor < 0 || neighbor >= n_nodes) { continue; }
+          graph(i, k++) = nodes[neighbor];
+        }
+      }
+    }
+    layers.graphs.push_back(std::move(graph));
+    layers.degrees.push_back(static_cast<uint32_t>(degree));
+  }
+  return layers;
+}
+
 template <typename T, typename IdxT>
 void serialize_to_hnswlib(raft::resources const& res,
                           std::ostream& os,
-                          const raft::neighbors::cagra::index<T, IdxT>& index_)
+                          const raft::neighbors::cagra::index<T, IdxT>& index_,
+                          raft::neighbors::hnsw::HnswHierarchy hierarchy)
 {
   // static_assert(std::is_same_v<IdxT, int> or std::is_same_v<IdxT, uint32_t>,
   //               "An hnswlib index can only be trained with int32 or uint32 IdxT");
   common::nvtx::range<common::nvtx::domain::raft> fun_scope("cagra::serialize");
-  RAFT_LOG_DEBUG("Saving CAGRA index to hnswlib format, size %zu, dim %u",
+  RAFT_EXPECTS(index_.graph_bits() == 0,
+               "A compressed graph cannot be exported to hnswlib; call decompress_graph first");
+  RAFT_EXPECTS(index_.n_removed() == 0,
+               "An index with removed nodes cannot be exported to hnswlib; call compact first");
+  bool hierarchical = hierarchy == raft::neighbors::hnsw::HnswHierarchy::GPU;
+  RAFT_EXPECTS(!hierarchical || index_.graph_degree() >= 4,
+               "The hierarchical export requires a graph degree of at least 4");
+  RAFT_LOG_DEBUG("Saving CAGRA index to hnswlib format, size %zu, dim %u, hierarchical: %d",
                  static_cast<size_t>(index_.size()),
-                 index_.dim());
+                 index_.dim(),
+                 int(hierarchical));
+
+  // The upper layers have (at most) M = graph_degree / 2 neighbors per node, as in hnswlib
+  auto M    = static_cast<std::size_t>(index_.graph_degree() / 2);
+  auto mult = hierarchical ? 1.0 / std::log(static_cast<double>(M)) : 0.42424242;
+  hnsw_upper_layers<IdxT> layers;
+  if (hierarchical) { layers = build_hnsw_upper_layers(res, index_, M, mult); }
 
   // offset_level_0
   std::size_t offset_level_0 = 0;
@@ -131,23 +281,23 @@ void serialize_to_hnswlib(raft::resources const& res,
   // offset_data
   auto offset_data = static_cast<std::size_t>(index_.graph_degree() * sizeof(IdxT) + 4);
   os.write(reinterpret_cast<char*>(&offset_data), sizeof(std::size_t));
-  // max_level
-  int max_level = 1;
+  // max_level; a base-layer-only index is searched from the seeds (the entry point is unused)
+  int max_level = hierarchical ? layers.max_level : 1;
   os.write(reinterpret_cast<char*>(&max_level), sizeof(int));
-  // entrypoint_node
-  auto entrypoint_node = static_cast<int>(index_.size() / 2);
+  // entrypoint_node: any node of the top layer
+  auto entrypoint_node = hierarchical && layers.max_level > 0
+                           ? static_cast<int>(layers.nodes.back().front())
+                           : static_cast<int>(index_.size() / 2);
   os.write(reinterpret_cast<char*>(&entrypoint_node), sizeof(int));
   // max_M
-  auto max_M = static_cast<std::size_t>(index_.graph_degree() / 2);
+  auto max_M = M;
   os.write(reinterpret_cast<char*>(&max_M), sizeof(std::size_t));
   // max_M0
   std::size_t max_M0 = index_.graph_degree();
   os.write(reinterpret_cast<char*>(&max_M0), sizeof(std::size_t));
   // M
-  auto M = static_cast<std::size_t>(index_.graph_degree() / 2);
   os.write(reinterpret_cast<char*>(&M), sizeof(std::size_t));
-  // mult, can be anything
-  double mult = 0.42424242;
+  // mult: the level generation factor (only meaningful for a hierarchical index)
   os.write(reinterpret_cast<char*>(&mult), sizeof(double));
   // efConstruction, can be anything
   std::size_t efConstruction = 500;
@@ -201,22 +351,34 @@ void serialize_to_hnswlib(raft::resources const& res,
     os.write(reinterpret_cast<char*>(&i), sizeof(std::size_t));
   }
 
+  // The link lists of the upper layers: the size in bytes (zero for the nodes of the base layer
+  // only), followed by the (count, M neighbors) list of every level of the node
+  auto size_links_per_element = static_cast<uint32_t>(M * sizeof(IdxT) + 4);
+  std::vector<std::size_t> cursors(layers.nodes.size(), 0);
   for (std::size_t i = 0; i < index_.size(); i++) {
-    // zeroes
-    auto zero = 0;
-    os.write(reinterpret_cast<char*>(&zero), sizeof(int));
+    auto level      = hierarchical ? layers.levels[i] : 0;
+    auto links_size = static_cast<uint32_t>(level) * size_links_per_element;
+    os.write(reinterpret_cast<char*>(&links_size), sizeof(uint32_t));
+    for (int l = 1; l <= level; l++) {
+      // the nodes of a layer are sorted, so that the position of i in it is the running cursor
+      auto row    = static_cast<int64_t>(cursors[l - 1]++);
+      auto degree = layers.degrees[l - 1];
+      os.write(reinterpret_cast<char*>(&degree), sizeof(uint32_t));
+      os.write(reinterpret_cast<const char*>(&layers.graphs[l - 1](row, 0)), M * sizeof(IdxT));
+    }
   }
 }
 
 template <typename T, typename IdxT>
 void serialize_to_hnswlib(raft::resources const& res,
                           const std::string& filename,
-                          const raft::neighbors::cagra::index<T, IdxT>& index_)
+                          const raft::neighbors::cagra::index<T, IdxT>& index_,
+                          raft::neighbors::hnsw::HnswHierarchy hierarchy)
 {
   std::ofstream of(filename, std::ios::out | std::ios::binary);
   if (!of) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
 
-  detail::serialize_to_hnswlib<T, IdxT>(res, of, index_);
+  detail::serialize_to_hnswlib<T, IdxT>(res, of, index_, hierarchy);
 
   of.close();
   if (!of) { RAFT_FAIL("Error writing output %s", filename.c_str()); }
@@ -240,30 +402,83 @@ auto deserialize(raft::resources const& res, std::istream& is) -> index<T, IdxT>
   is.read(dtype_string, 4);
 
   auto ver = deserialize_scalar<int>(res, is);
-  if (ver != serialization_version) {
+  // Version 3 is the same format without the packed graph, version 4 without the removed nodes,
+  // version 5 without the compression of the graph, version 6 without the entry points, version 7
+  // without the source indices.
+  if (ver != serialization_version && ver != 3 && ver != 4 && ver != 5 && ver != 6 && ver != 7) {
     RAFT_FAIL("serialization version mismatch, expected %d, got %d ", serialization_version, ver);
   }
   auto n_rows       = deserialize_scalar<IdxT>(res, is);
   auto dim          = deserialize_scalar<std::uint32_t>(res, is);
   auto graph_degree = deserialize_scalar<std::uint32_t>(res, is);
   auto metric       = deserialize_scalar<raft::distance::DistanceType>(res, is);
-
-  auto graph = raft::make_host_matrix<IdxT, int64_t>(n_rows, graph_degree);
-  deserialize_mdspan(res, is, graph.view());
+  auto graph_bits   = ver >= 4 ? deserialize_scalar<std::uint32_t>(res, is) : 0u;
+
+  // create a new index with no dataset when it was not saved - the user must supply via
+  // update_dataset themselves later (this avoids allocating GPU memory in the meantime)
+  index<T, IdxT> idx(res, metric);
+  if (graph_bits == 0) {
+    bool compressed = ver >= 6 ? deserialize_scalar<bool>(res, is) : false;
+    if (compressed) {
+      // decoded on the device, straight into the graph of the index
+      auto graph = raft::make_device_matrix<IdxT, int64_t>(res, n_rows, graph_degree);
+      neighbors::detail::deserialize_ids_compressed(
+        res,
+        is,
+        raft::make_device_vector_view<IdxT, int64_t>(graph.data_handle(), graph.size()));
+      idx.update_graph(res, std::move(graph));
+    } else {
+      auto graph = raft::make_host_matrix<IdxT, int64_t>(n_rows, graph_degree);
+      deserialize_mdspan(res, is, graph.view());
+      idx.update_graph(res, raft::make_const_mdspan(graph.view()));
+    }
+    resource::sync_stream(res);
+  } else {
+    auto n_words = deserialize_scalar<int64_t>(res, is);
+    auto words   = raft::make_host_vector<std::uint32_t, int64_t>(n_words);
+    deserialize_mdspan(res, is, words.view());
+    idx.update_packed_graph(
+      res, raft::make_const_mdspan(words.view()), n_rows, graph_degree, graph_bits);
+    resource::sync_stream(res);
+  }
+  auto n_removed = ver >= 5 ? deserialize_scalar<int64_t>(res, is) : int64_t(0);
+  if (n_removed > 0) {
+    auto n_words = deserialize_scalar<int64_t>(res, is);
+    auto words   = raft::make_host_vector<std::uint32_t, int64_t>(n_words);
+    deserialize_mdspan(res, is, words.view());
+    auto alive_bits = idx.alive_bits(res);
+    RAFT_EXPECTS(alive_bits.extent(0) == n_words, "Corrupt removed-node bitset in the stream");
+    raft::copy(alive_bits.data_handle(),
+               words.data_handle(),
+               n_words,
+               resource::get_cuda_stream(res));
+    resource::sync_stream(res);
+    idx.update_n_removed(res, n_removed);
+  }
+  auto n_entry_points = ver >= 7 ? deserialize_scalar<int64_t>(res, is) : int64_t(0);
+  if (n_entry_points > 0) {
+    auto entry_points = raft::make_device_vector<IdxT, int64_t>(res, n_entry_points);
+    deserialize_mdspan(res, is, entry_points.view());
+    idx.update_entry_points(res, std::move(entry_points));
+  }
+  auto n_source_indices = ver >= 8 ? deserialize_scalar<int64_t>(res, is) : int64_t(0);
+  if (n_source_indices > 0) {
+    auto source_indices = raft::make_device_vector<IdxT, int64_t>(res, n_source_indices);
+    deserialize_mdspan(res, is, source_indices.view());
+    idx.update_source_indices(res, std::move(source_indices));
+  }
 
   bool has_dataset = deserialize_scalar<bool>(res, is);
   if (has_dataset) {
     auto dataset = raft::make_host_matrix<T, int64_t>(n_rows, dim);
     deserialize_mdspan(res, is, dataset.view());
-    return index<T, IdxT>(
-      res, metric, raft::make_const_mdspan(dataset.view()), raft::make_const_mdspan(graph.view()));
-  } else {
-    // create a new index with no dataset - the user must supply via update_dataset themselves
-    // later (this avoids allocating GPU memory in the meantime)
-    index<T, IdxT> idx(res, metric);
-    idx.update_graph(res, raft::make_const_mdspan(graph.view()));
-    return idx;
+    idx.update_dataset(res, raft::make_const_mdspan(dataset.view()));
+    if (metric == raft::distance::DistanceType::CosineExpanded) {
+      idx.update_dataset_norms(res, make_dataset_norms(res, idx));
+    }
+    resource::sync_stream(res);
   }
+  return idx;
 }
 
 template <typename T, typename IdxT>
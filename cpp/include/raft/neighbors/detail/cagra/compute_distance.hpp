@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -15,6 +15,8 @@
  */
 #pragma once
 
+#include <raft/core/error.hpp>
+#include <raft/distance/distance_types.hpp>
 #include <raft/spatial/knn/detail/ann_utils.cuh>
 
 #include "device_common.hpp"
@@ -23,6 +25,43 @@
 #include <type_traits>
 
 namespace raft::neighbors::cagra::detail {
+
+/**
+ * The metric of the distances computed by the search kernels, which look for the smallest ones:
+ * the squared L2 distance or the negated inner product. With the dataset norms, the inner product
+ * is divided by the norm of the dataset row (the cosine distance, up to the norm of the query,
+ * which is applied to the results of the search).
+ */
+struct search_metric {
+  bool inner_product         = false;
+  const float* dataset_norms = nullptr;  // [dataset_size]
+
+  template <class DISTANCE_T>
+  __device__ DISTANCE_T normalize(DISTANCE_T dist, std::size_t row, bool valid) const
+  {
+    if (valid && dataset_norms != nullptr) {
+      const float norm = dataset_norms[row];
+      if (norm > 0) { dist /= norm; }
+    }
+    return dist;
+  }
+};
+
+/** The metric of the search kernels for the metric of an index (the norms are used for cosine). */
+inline auto make_search_metric(raft::distance::DistanceType metric, const float* dataset_norms)
+  -> search_metric
+{
+  switch (metric) {
+    case raft::distance::DistanceType::L2Expanded:
+    case raft::distance::DistanceType::L2SqrtExpanded:
+    case raft::distance::DistanceType::L2Unexpanded:
+    case raft::distance::DistanceType::L2SqrtUnexpanded: return search_metric{};
+    case raft::distance::DistanceType::InnerProduct: return search_metric{true, nullptr};
+    case raft::distance::DistanceType::CosineExpanded: return search_metric{true, dataset_norms};
+    default: RAFT_FAIL("The CAGRA search does not support the metric %d", static_cast<int>(metric));
+  }
+}
+
 namespace device {
 
 // using LOAD_256BIT_T = ulonglong4;
@@ -57,12 +96,19 @@ template <class LOAD_T,
           std::uint32_t TEAM_SIZE>
 struct distance_op<LOAD_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, false> {
   const float* const query_buffer;
-  __device__ distance_op(const float* const query_buffer) : query_buffer(query_buffer) {}
+  const search_metric metric;
+  __device__ distance_op(const float* const query_buffer, const search_metric metric)
+    : query_buffer(query_buffer), metric(metric)
+  {
+  }
 
-  __device__ DISTANCE_T operator()(const DATA_T* const dataset_ptr,
+  __device__ DISTANCE_T operator()(const DATA_T* const dataset,
+                                   const std::size_t dataset_ld,
+                                   const std::size_t row,
                                    const std::uint32_t dataset_dim,
                                    const bool valid)
   {
+    const DATA_T* const dataset_ptr = dataset + dataset_ld * row;
     const unsigned lane_id  = threadIdx.x % TEAM_SIZE;
     constexpr unsigned vlen = get_vlen<LOAD_T, DATA_T>();
     constexpr unsigned reg_nelem =
@@ -86,9 +132,13 @@ struct distance_op<LOAD_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, fal
           for (uint32_t v = 0; v < vlen; v++) {
             const uint32_t kv = k + v;
             // if (kv >= dataset_dim) break;
-            DISTANCE_T diff = query_buffer[device::swizzling(kv)];
-            diff -= spatial::knn::detail::utils::mapping<float>{}(dl_buff[e].data[v]);
-            norm2 += diff * diff;
+            const DISTANCE_T q = query_buffer[device::swizzling(kv)];
+            const DISTANCE_T x = spatial::knn::detail::utils::mapping<float>{}(dl_buff[e].data[v]);
+            if (metric.inner_product) {
+              norm2 -= q * x;
+            } else {
+              norm2 += (q - x) * (q - x);
+            }
           }
         }
       }
@@ -96,7 +146,7 @@ struct distance_op<LOAD_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, fal
     for (uint32_t offset = TEAM_SIZE / 2; offset > 0; offset >>= 1) {
       norm2 += __shfl_xor_sync(0xffffffff, norm2, offset);
     }
-    return norm2;
+    return metric.normalize(norm2, row, valid);
   }
 };
 template <class LOAD_T,
@@ -107,8 +157,10 @@ template <class LOAD_T,
 struct distance_op<LOAD_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, true> {
   static constexpr unsigned N_FRAGS = (DATASET_BLOCK_DIM + TEAM_SIZE - 1) / TEAM_SIZE;
   float query_frags[N_FRAGS];
+  const search_metric metric;
 
-  __device__ distance_op(const float* const query_buffer)
+  __device__ distance_op(const float* const query_buffer, const search_metric metric)
+    : metric(metric)
   {
     constexpr unsigned vlen = get_vlen<LOAD_T, DATA_T>();
     constexpr unsigned reg_nelem =
@@ -128,11 +180,14 @@ struct distance_op<LOAD_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, tru
     }
   }
 
-  __device__ DISTANCE_T operator()(const DATA_T* const dataset_ptr,
+  __device__ DISTANCE_T operator()(const DATA_T* const dataset,
+                                   const std::size_t dataset_ld,
+                                   const std::size_t row,
                                    const std::uint32_t dataset_dim,
                                    const bool valid)
   {
-    const unsigned lane_id  = threadIdx.x % TEAM_SIZE;
+    const DATA_T* const dataset_ptr = dataset + dataset_ld * row;
+    const unsigned lane_id          = threadIdx.x % TEAM_SIZE;
     constexpr unsigned vlen = get_vlen<LOAD_T, DATA_T>();
     constexpr unsigned reg_nelem =
       (DATASET_BLOCK_DIM + (TEAM_SIZE * vlen) - 1) / (TEAM_SIZE * vlen);
@@ -152,20 +207,174 @@ struct distance_op<LOAD_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, tru
         if (k >= dataset_dim) break;
 #pragma unroll
         for (unsigned v = 0; v < vlen; v++) {
-          DISTANCE_T diff;
-          const unsigned ev = (vlen * e) + v;
-          diff              = query_frags[ev];
-          diff -= spatial::knn::detail::utils::mapping<float>{}(dl_buff[e].data[v]);
-          norm2 += diff * diff;
+          const unsigned ev  = (vlen * e) + v;
+          const DISTANCE_T q = query_frags[ev];
+          const DISTANCE_T x = spatial::knn::detail::utils::mapping<float>{}(dl_buff[e].data[v]);
+          if (metric.inner_product) {
+            norm2 -= q * x;
+          } else {
+            norm2 += (q - x) * (q - x);
+          }
+        }
+      }
+    }
+    for (uint32_t offset = TEAM_SIZE / 2; offset > 0; offset >>= 1) {
+      norm2 += __shfl_xor_sync(0xffffffff, norm2, offset);
+    }
+    return metric.normalize(norm2, row, valid);
+  }
+};
+
+/**
+ * Distance computation for 8-bit datasets with the query held in registers.
+ *
+ * The query and the dataset vectors are both kept packed four elements per 32-bit word. The
+ * squared L2 distance of four elements is then a byte-wise absolute difference followed by a
+ * single `__dp4a`, instead of four conversions to float and four FMAs. The integer accumulator is
+ * exact; it is scaled once at the end to match `utils::mapping<float>` of the generic path. The
+ * inner product is a `__dp4a` of the packed words themselves (signed for int8).
+ */
+template <class LOAD_T,
+          class DATA_T,
+          class DISTANCE_T,
+          std::uint32_t DATASET_BLOCK_DIM,
+          std::uint32_t TEAM_SIZE>
+struct distance_op_8bit {
+  static_assert(sizeof(DATA_T) == 1, "distance_op_8bit requires an 8-bit data type");
+  static constexpr unsigned kVlen     = sizeof(LOAD_T) / sizeof(DATA_T);
+  static constexpr unsigned kWords    = sizeof(LOAD_T) / sizeof(uint32_t);
+  static constexpr unsigned kRegNelem = (DATASET_BLOCK_DIM + (TEAM_SIZE * kVlen) - 1) /
+                                        (TEAM_SIZE * kVlen);
+  static constexpr float kDivisor = spatial::knn::detail::utils::config<DATA_T>::kDivisor;
+
+  std::uint32_t query_words[kRegNelem * kWords];
+  const search_metric metric;
+
+  __device__ distance_op_8bit(const float* const query_buffer, const search_metric metric)
+    : metric(metric)
+  {
+    const std::uint32_t lane_id = threadIdx.x % TEAM_SIZE;
+    // The query buffer holds the 8-bit values scaled by 1/kDivisor, so the conversion back is
+    // exact.
+#pragma unroll
+    for (unsigned e = 0; e < kRegNelem; e++) {
+      const unsigned k = (lane_id + (TEAM_SIZE * e)) * kVlen;
+#pragma unroll
+      for (unsigned w = 0; w < kWords; w++) {
+        std::uint32_t word = 0;
+#pragma unroll
+        for (unsigned b = 0; b < 4; b++) {
+          const int q = __float2int_rn(query_buffer[device::swizzling(k + w * 4 + b)] * kDivisor);
+          word |= (static_cast<std::uint32_t>(q) & 0xffu) << (8 * b);
         }
+        query_words[e * kWords + w] = word;
       }
     }
+  }
+
+  __device__ static std::uint32_t absdiff(std::uint32_t a, std::uint32_t b)
+  {
+    if constexpr (std::is_signed_v<DATA_T>) {
+      return __vabsdiffs4(a, b);
+    } else {
+      return __vabsdiffu4(a, b);
+    }
+  }
+
+  __device__ static std::uint32_t dot4(std::uint32_t a, std::uint32_t b, std::uint32_t c)
+  {
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 610)
+    return __dp4a(a, b, c);
+#else
+#pragma unroll
+    for (unsigned i = 0; i < 4; i++) {
+      c += ((a >> (8 * i)) & 0xffu) * ((b >> (8 * i)) & 0xffu);
+    }
+    return c;
+#endif
+  }
+
+  __device__ static std::int32_t dot4s(std::uint32_t a, std::uint32_t b, std::int32_t c)
+  {
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 610)
+    return __dp4a(static_cast<int>(a), static_cast<int>(b), c);
+#else
+#pragma unroll
+    for (unsigned i = 0; i < 4; i++) {
+      c += static_cast<std::int32_t>(static_cast<std::int8_t>(a >> (8 * i))) *
+           static_cast<std::int32_t>(static_cast<std::int8_t>(b >> (8 * i)));
+    }
+    return c;
+#endif
+  }
+
+  __device__ DISTANCE_T operator()(const DATA_T* const dataset,
+                                   const std::size_t dataset_ld,
+                                   const std::size_t row,
+                                   const std::uint32_t dataset_dim,
+                                   const bool valid)
+  {
+    const DATA_T* const dataset_ptr = dataset + dataset_ld * row;
+    const unsigned lane_id          = threadIdx.x % TEAM_SIZE;
+    data_load_t<LOAD_T, std::uint32_t, kWords> dl_buff[kRegNelem];
+
+    // the squared L2 distance or the (unsigned) inner product
+    std::uint32_t acc = 0;
+    // the signed inner product
+    [[maybe_unused]] std::int32_t sacc = 0;
+    if (valid) {
+#pragma unroll
+      for (unsigned e = 0; e < kRegNelem; e++) {
+        const unsigned k = (lane_id + (TEAM_SIZE * e)) * kVlen;
+        if (k >= dataset_dim) break;
+        dl_buff[e].load = *reinterpret_cast<const LOAD_T*>(dataset_ptr + k);
+      }
+#pragma unroll
+      for (unsigned e = 0; e < kRegNelem; e++) {
+        const unsigned k = (lane_id + (TEAM_SIZE * e)) * kVlen;
+        if (k >= dataset_dim) break;
+#pragma unroll
+        for (unsigned w = 0; w < kWords; w++) {
+          const std::uint32_t q = query_words[e * kWords + w];
+          const std::uint32_t x = dl_buff[e].data[w];
+          if (!metric.inner_product) {
+            const std::uint32_t d = absdiff(q, x);
+            acc                   = dot4(d, d, acc);
+          } else if constexpr (std::is_signed_v<DATA_T>) {
+            sacc = dot4s(q, x, sacc);
+          } else {
+            acc = dot4(q, x, acc);
+          }
+        }
+      }
+    }
+    DISTANCE_T norm2;
+    if (!metric.inner_product) {
+      norm2 = static_cast<DISTANCE_T>(acc);
+    } else if constexpr (std::is_signed_v<DATA_T>) {
+      norm2 = -static_cast<DISTANCE_T>(sacc);
+    } else {
+      norm2 = -static_cast<DISTANCE_T>(acc);
+    }
+    norm2 *= 1.0f / (kDivisor * kDivisor);
     for (uint32_t offset = TEAM_SIZE / 2; offset > 0; offset >>= 1) {
       norm2 += __shfl_xor_sync(0xffffffff, norm2, offset);
     }
-    return norm2;
+    return metric.normalize(norm2, row, valid);
   }
 };
+template <class LOAD_T, class DISTANCE_T, std::uint32_t DATASET_BLOCK_DIM, std::uint32_t TEAM_SIZE>
+struct distance_op<LOAD_T, int8_t, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, true>
+  : distance_op_8bit<LOAD_T, int8_t, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE> {
+  using distance_op_8bit<LOAD_T, int8_t, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE>::
+    distance_op_8bit;
+};
+template <class LOAD_T, class DISTANCE_T, std::uint32_t DATASET_BLOCK_DIM, std::uint32_t TEAM_SIZE>
+struct distance_op<LOAD_T, uint8_t, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, true>
+  : distance_op_8bit<LOAD_T, uint8_t, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE> {
+  using distance_op_8bit<LOAD_T, uint8_t, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE>::
+    distance_op_8bit;
+};
 
 template <unsigned TEAM_SIZE,
           unsigned DATASET_BLOCK_DIM,
@@ -188,6 +397,7 @@ _RAFT_DEVICE void compute_distance_to_random_nodes(
   const uint32_t num_seeds,
   INDEX_T* const visited_hash_ptr,
   const uint32_t hash_bitlen,
+  const search_metric metric,
   const uint32_t block_id   = 0,
   const uint32_t num_blocks = 1)
 {
@@ -195,7 +405,7 @@ _RAFT_DEVICE void compute_distance_to_random_nodes(
   if (max_i % (32 / TEAM_SIZE)) { max_i += (32 / TEAM_SIZE) - (max_i % (32 / TEAM_SIZE)); }
 
   distance_op<LOAD_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, false> dist_op(
-    query_buffer);
+    query_buffer, metric);
 
   for (uint32_t i = threadIdx.x / TEAM_SIZE; i < max_i; i += blockDim.x / TEAM_SIZE) {
     const bool valid_i = (i < num_pickup);
@@ -215,7 +425,7 @@ _RAFT_DEVICE void compute_distance_to_random_nodes(
         }
       }
 
-      const auto norm2 = dist_op(dataset_ptr + dataset_ld * seed_index, dataset_dim, valid_i);
+      const auto norm2 = dist_op(dataset_ptr, dataset_ld, seed_index, dataset_dim, valid_i);
 
       if (valid_i && (norm2 < best_norm2_team_local)) {
         best_norm2_team_local = norm2;
@@ -254,12 +464,14 @@ _RAFT_DEVICE void compute_distance_to_child_nodes(INDEX_T* const result_child_in
                                                   // [knn_k, dataset_size]
                                                   const INDEX_T* const knn_graph,
                                                   const std::uint32_t knn_k,
+                                                  const std::uint32_t graph_bits,
                                                   // hashmap
                                                   INDEX_T* const visited_hashmap_ptr,
                                                   const std::uint32_t hash_bitlen,
                                                   const INDEX_T* const parent_indices,
                                                   const INDEX_T* const internal_topk_list,
-                                                  const std::uint32_t search_width)
+                                                  const std::uint32_t search_width,
+                                                  const search_metric metric)
 {
   constexpr INDEX_T index_msb_1_mask = utils::gen_index_msb_1_mask<INDEX_T>::value;
   const INDEX_T invalid_index        = utils::get_max_value<INDEX_T>();
@@ -271,7 +483,7 @@ _RAFT_DEVICE void compute_distance_to_child_nodes(INDEX_T* const result_child_in
     INDEX_T child_id             = invalid_index;
     if (smem_parent_id != invalid_index) {
       const auto parent_id = internal_topk_list[smem_parent_id] & ~index_msb_1_mask;
-      child_id             = knn_graph[(i % knn_k) + (static_cast<int64_t>(knn_k) * parent_id)];
+      child_id = device::load_graph_edge(knn_graph, knn_k, graph_bits, parent_id, i % knn_k);
     }
     if (child_id != invalid_index) {
       if (hashmap::insert(visited_hashmap_ptr, hash_bitlen, child_id) == 0) {
@@ -289,7 +501,7 @@ _RAFT_DEVICE void compute_distance_to_child_nodes(INDEX_T* const result_child_in
   constexpr unsigned N_FRAGS  = (DATASET_BLOCK_DIM + TEAM_SIZE - 1) / TEAM_SIZE;
   constexpr bool use_fragment = N_FRAGS <= MAX_N_FRAGS;
   distance_op<LOAD_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, use_fragment> dist_op(
-    query_buffer);
+    query_buffer, metric);
   __syncthreads();
 
   // Compute the distance to child nodes
@@ -302,7 +514,7 @@ _RAFT_DEVICE void compute_distance_to_child_nodes(INDEX_T* const result_child_in
     if (valid_i) { child_id = result_child_indices_ptr[i]; }
 
     DISTANCE_T norm2 =
-      dist_op(dataset_ptr + child_id * dataset_ld, dataset_dim, child_id != invalid_index);
+      dist_op(dataset_ptr, dataset_ld, child_id, dataset_dim, child_id != invalid_index);
 
     // Store the distance
     const unsigned lane_id = threadIdx.x % TEAM_SIZE;
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/mdspan.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+
+#include <cmath>
+#include <cstdint>
+
+namespace raft::neighbors::cagra::detail {
+
+/** The L2 norm of a row in the scale of `utils::mapping<float>`, as seen by the search kernels. */
+template <typename T>
+struct row_norm_op {
+  const T* data;
+  int64_t ld;
+  uint32_t dim;
+
+  HDI auto operator()(int64_t row) const -> float
+  {
+    float sum = 0;
+    for (uint32_t j = 0; j < dim; j++) {
+      const float v = spatial::knn::detail::utils::mapping<float>{}(data[row * ld + j]);
+      sum += v * v;
+    }
+    return sqrtf(sum);
+  }
+};
+
+/** The rows of a row-major matrix scaled to the unit L2 norm (zero rows are kept as is). */
+template <typename T>
+struct normalize_op {
+  const T* data;
+  const float* norms;
+  uint32_t dim;
+
+  HDI auto operator()(int64_t i) const -> float
+  {
+    const float norm = norms[i / dim];
+    const float v    = spatial::knn::detail::utils::mapping<float>{}(data[i]);
+    return norm > 0 ? v / norm : v;
+  }
+};
+
+/** The cosine distances from the negated inner products divided by the dataset norms. */
+struct cosine_distance_op {
+  const float* dist;
+  const float* query_norms;
+  uint32_t k;
+
+  HDI auto operator()(int64_t i) const -> float
+  {
+    const float norm = query_norms[i / k];
+    return norm > 0 ? 1.0f + dist[i] / norm : 1.0f;
+  }
+};
+
+/** Compute the L2 norms of the rows of a (strided) device matrix. */
+template <typename T>
+void compute_row_norms(raft::resources const& res,
+                       raft::device_matrix_view<const T, int64_t, layout_stride> data,
+                       raft::device_vector_view<float, int64_t> norms)
+{
+  RAFT_EXPECTS(norms.extent(0) == data.extent(0), "Need one norm per row");
+  raft::linalg::map_offset(
+    res,
+    norms,
+    row_norm_op<T>{data.data_handle(), data.stride(0), static_cast<uint32_t>(data.extent(1))});
+}
+
+/** Compute the norms of the dataset rows of an index (see `index::dataset_norms`). */
+template <typename T, typename IdxT>
+auto make_dataset_norms(raft::resources const& res, const index<T, IdxT>& idx)
+  -> raft::device_vector<float, int64_t>
+{
+  auto norms = raft::make_device_vector<float, int64_t>(res, idx.dataset().extent(0));
+  compute_row_norms(res, idx.dataset(), norms.view());
+  return norms;
+}
+
+/**
+ * A float copy of the dataset with the rows scaled to the unit L2 norm, in the same memory (host
+ * or device) as the dataset.
+ *
+ * The ordering of the L2 distances between the normalized rows is the ordering of the cosine
+ * distances between the original ones, hence the kNN graph of a CosineExpanded index is built from
+ * this copy with the L2Expanded metric.
+ */
+template <typename T, typename accessor>
+auto make_normalized_dataset(raft::resources const& res,
+                             mdspan<const T, matrix_extent<int64_t>, row_major, accessor> dataset)
+{
+  const int64_t n_rows = dataset.extent(0);
+  const uint32_t dim   = dataset.extent(1);
+  if constexpr (accessor::is_device_accessible) {
+    auto norms = raft::make_device_vector<float, int64_t>(res, n_rows);
+    raft::linalg::map_offset(res, norms.view(), row_norm_op<T>{dataset.data_handle(), dim, dim});
+    auto normalized = raft::make_device_matrix<float, int64_t>(res, n_rows, dim);
+    raft::linalg::map_offset(
+      res,
+      raft::make_device_vector_view<float, int64_t>(normalized.data_handle(), normalized.size()),
+      normalize_op<T>{dataset.data_handle(), norms.data_handle(), dim});
+    return normalized;
+  } else {
+    auto normalized = raft::make_host_matrix<float, int64_t>(n_rows, dim);
+    const row_norm_op<T> norm_op{dataset.data_handle(), dim, dim};
+#pragma omp parallel for
+    for (int64_t i = 0; i < n_rows; i++) {
+      const float norm = norm_op(i);
+      for (uint32_t j = 0; j < dim; j++) {
+        const float v    = spatial::knn::detail::utils::mapping<float>{}(dataset(i, j));
+        normalized(i, j) = norm > 0 ? v / norm : v;
+      }
+    }
+    return normalized;
+  }
+}
+
+}  // namespace raft::neighbors::cagra::detail
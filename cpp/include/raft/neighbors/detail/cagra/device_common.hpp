@@ -48,5 +48,26 @@ _RAFT_DEVICE inline T swizzling(T x)
   return x ^ (x >> 5);  // "x" must be less than 1024
 }
 
+/** Load the k-th neighbor of `node` from a CAGRA graph.
+ *
+ * When `bits` is zero the graph is a dense row-major [n_rows, degree] array of INDEX_T. Otherwise
+ * it is the fixed-width bit-packed layout produced by `index::compress_graph`: edge `pos` occupies
+ * bits [pos * bits, (pos + 1) * bits) of a little-endian stream of 32-bit words, and the stream is
+ * padded with one extra word so that reading two consecutive words never goes out of bounds.
+ */
+template <class INDEX_T>
+_RAFT_DEVICE inline INDEX_T load_graph_edge(
+  const INDEX_T* graph, uint32_t degree, uint32_t bits, uint64_t node, uint32_t k)
+{
+  const uint64_t pos = k + node * degree;
+  if (bits == 0) { return graph[pos]; }
+  const auto* words    = reinterpret_cast<const uint32_t*>(graph);
+  const uint64_t bit   = pos * bits;
+  const uint64_t word  = bit >> 5;
+  const uint32_t shift = bit & 31;
+  const uint64_t v     = (static_cast<uint64_t>(words[word + 1]) << 32) | words[word];
+  return static_cast<INDEX_T>((v >> shift) & ((1ull << bits) - 1));
+}
+
 }  // namespace device
 }  // namespace raft::neighbors::cagra::detail
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "dataset_norms.cuh"
+
+#include <raft/cluster/kmeans_balanced.cuh>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace raft::neighbors::cagra::detail {
+
+/** The number of training rows sampled per entry point. */
+constexpr int64_t kEntryPointTrainsetRatio = 128;
+
+/** A float copy of every `step`-th dataset row, scaled to the unit norm if `norms` is set. */
+template <typename T>
+struct sample_rows_op {
+  const T* data;
+  int64_t ld;
+  uint32_t dim;
+  int64_t step;
+  const float* norms;
+
+  HDI auto operator()(int64_t i) const -> float
+  {
+    const int64_t row = (i / dim) * step;
+    const float v     = spatial::knn::detail::utils::mapping<float>{}(data[row * ld + i % dim]);
+    if (norms == nullptr) { return v; }
+    const float norm = norms[row];
+    return norm > 0 ? v / norm : v;
+  }
+};
+
+/** The dataset row of a sampled row. */
+template <typename IdxT>
+struct sampled_row_id_op {
+  const uint32_t* sample_ids;
+  int64_t step;
+
+  HDI auto operator()(int64_t i) const -> IdxT
+  {
+    return static_cast<IdxT>(int64_t(sample_ids[i]) * step);
+  }
+};
+
+/** The entry points of every query of a batch: [n_queries, n_entry_points]. */
+template <typename IdxT>
+struct broadcast_entry_points_op {
+  const IdxT* entry_points;
+  uint32_t n_entry_points;
+
+  HDI auto operator()(int64_t i) const -> IdxT { return entry_points[i % n_entry_points]; }
+};
+
+/**
+ * Select `n_entry_points` dataset rows spread over the dataset (see `index::entry_points`).
+ *
+ * The centroids of a balanced k-means clustering of a subsample of the dataset are snapped to
+ * their nearest sampled rows. The clustering uses the L2 distance, on the normalized rows for the
+ * CosineExpanded metric.
+ */
+template <typename T, typename IdxT>
+auto make_entry_points(raft::resources const& res,
+                       const index<T, IdxT>& idx,
+                       uint32_t n_entry_points) -> raft::device_vector<IdxT, int64_t>
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("cagra::make_entry_points(%u)",
+                                                            n_entry_points);
+  const int64_t n_rows = idx.dataset().extent(0);
+  const uint32_t dim   = idx.dim();
+  RAFT_EXPECTS(n_rows > 0 && n_rows == int64_t(idx.size()),
+               "The dataset must be attached to the index to build its entry points");
+  RAFT_EXPECTS(n_entry_points > 0 && n_entry_points <= n_rows,
+               "The number of entry points (%u) must be in [1, %zu]",
+               n_entry_points,
+               static_cast<size_t>(n_rows));
+
+  const float* norms = nullptr;
+  auto tmp_norms     = raft::make_device_vector<float, int64_t>(res, 0);
+  if (idx.metric() == distance::DistanceType::CosineExpanded) {
+    if (idx.dataset_norms().extent(0) == n_rows) {
+      norms = idx.dataset_norms().data_handle();
+    } else {
+      tmp_norms = make_dataset_norms(res, idx);
+      norms     = tmp_norms.data_handle();
+    }
+  }
+
+  const int64_t n_train =
+    std::min<int64_t>(n_rows, int64_t(n_entry_points) * kEntryPointTrainsetRatio);
+  const int64_t step = n_rows / n_train;
+  auto trainset      = raft::make_device_matrix<float, int64_t>(res, n_train, dim);
+  raft::linalg::map_offset(
+    res,
+    raft::make_device_vector_view<float, int64_t>(trainset.data_handle(), trainset.size()),
+    sample_rows_op<T>{idx.dataset().data_handle(), idx.dataset().stride(0), dim, step, norms});
+
+  raft::cluster::kmeans_balanced_params kmeans_params;
+  kmeans_params.metric = distance::DistanceType::L2Expanded;
+  auto centers         = raft::make_device_matrix<float, int64_t>(res, n_entry_points, dim);
+  raft::cluster::kmeans_balanced::fit(
+    res, kmeans_params, raft::make_const_mdspan(trainset.view()), centers.view());
+
+  // The roles are swapped: every center is assigned to its nearest sampled row.
+  auto sample_ids = raft::make_device_vector<uint32_t, int64_t>(res, n_entry_points);
+  raft::cluster::kmeans_balanced::predict(res,
+                                          kmeans_params,
+                                          raft::make_const_mdspan(centers.view()),
+                                          raft::make_const_mdspan(trainset.view()),
+                                          sample_ids.view());
+
+  auto entry_points = raft::make_device_vector<IdxT, int64_t>(res, n_entry_points);
+  raft::linalg::map_offset(
+    res, entry_points.view(), sampled_row_id_op<IdxT>{sample_ids.data_handle(), step});
+  RAFT_LOG_DEBUG("Selected %u CAGRA entry points from %zu sampled rows",
+                 n_entry_points,
+                 static_cast<size_t>(n_train));
+  return entry_points;
+}
+
+}  // namespace raft::neighbors::cagra::detail
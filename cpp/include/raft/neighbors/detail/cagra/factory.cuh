@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -48,18 +48,22 @@ class factory {
           default: THROW("Incorrect team size %lu", plan.team_size);
         }
         break;
+#if RAFT_CAGRA_MAX_DATASET_BLOCK_DIM >= 256
       case 256:
         switch (plan.team_size) {
           case 16: return dispatch_kernel<256, 16>(res, plan); break;
           default: THROW("Incorrect team size %lu", plan.team_size);
         }
         break;
+#endif
+#if RAFT_CAGRA_MAX_DATASET_BLOCK_DIM >= 512
       case 512:
         switch (plan.team_size) {
           case 32: return dispatch_kernel<512, 32>(res, plan); break;
           default: THROW("Incorrect team size %lu", plan.team_size);
         }
         break;
+#endif
       default: THROW("Incorrect dataset_block_dim (%lu)\n", plan.dataset_block_dim);
     }
     return std::unique_ptr<search_plan_impl<T, IdxT, DistanceT, CagraSampleFilterT>>();
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "cagra_search.cuh"
+
+#include <raft/core/bitset.cuh>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/neighbors/brute_force.cuh>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/detail/ivf_pq_search.cuh>
+#include <raft/neighbors/sample_filter.cuh>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+
+#include <thrust/copy.h>
+#include <thrust/count.h>
+#include <thrust/iterator/counting_iterator.h>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+namespace raft::neighbors::cagra::detail {
+
+template <class CagraSampleFilterT>
+struct is_bitset_filter : std::false_type {};
+template <class bitset_t, class index_t>
+struct is_bitset_filter<raft::neighbors::filtering::bitset_filter<bitset_t, index_t>>
+  : std::true_type {};
+
+template <class BitsetViewT>
+struct bitset_test_op {
+  BitsetViewT bitset;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> bool { return bitset.test(i); }
+};
+
+/** Gather the rows `ids` of a strided dataset, converting them to float as the kernels do. */
+template <class T, class IdxT>
+struct gather_rows_op {
+  const T* dataset;
+  int64_t ld;
+  int64_t dim;
+  const IdxT* ids;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> float
+  {
+    const int64_t row = i / dim;
+    const int64_t col = i - row * dim;
+    return spatial::knn::detail::utils::mapping<float>{}(
+      dataset[static_cast<int64_t>(ids[row]) * ld + col]);
+  }
+};
+
+/** Map the brute-force results over the subset back to the dataset ids, padding missing ones. */
+template <class IdxT>
+struct translate_neighbors_op {
+  const int64_t* subset_neighbors;
+  const IdxT* ids;
+  uint32_t subset_k;
+  uint32_t k;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> IdxT
+  {
+    const int64_t q = i / k;
+    const int64_t j = i - q * k;
+    if (j >= subset_k) { return std::numeric_limits<IdxT>::max(); }
+    return ids[subset_neighbors[q * subset_k + j]];
+  }
+};
+
+struct pad_distances_op {
+  const float* subset_distances;
+  uint32_t subset_k;
+  uint32_t k;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> float
+  {
+    const int64_t q = i / k;
+    const int64_t j = i - q * k;
+    if (j >= subset_k) { return std::numeric_limits<float>::max(); }
+    return subset_distances[q * subset_k + j];
+  }
+};
+
+/**
+ * Exact search over the rows that pass a bitset filter.
+ *
+ * The distances are computed on the same float mapping of the data as the graph search, and are
+ * rescaled the same way, so the results are interchangeable with those of `search_main`.
+ */
+template <typename T, typename internal_IdxT, typename BitsetViewT, typename IdxT>
+void search_brute_force_filtered(
+  raft::resources const& res,
+  const index<T, IdxT>& index,
+  raft::device_matrix_view<const T, int64_t, row_major> queries,
+  raft::device_matrix_view<internal_IdxT, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances,
+  BitsetViewT bitset,
+  int64_t n_pass)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::search_brute_force_filtered(n_pass = %zu)", static_cast<size_t>(n_pass));
+  auto stream           = resource::get_cuda_stream(res);
+  const int64_t n_rows  = index.size();
+  const int64_t n_query = queries.extent(0);
+  const int64_t dim     = index.dim();
+  const uint32_t k      = neighbors.extent(1);
+  const uint32_t sub_k  = std::min<int64_t>(k, n_pass);
+
+  auto ids = raft::make_device_vector<internal_IdxT, int64_t>(res, n_pass);
+  thrust::copy_if(resource::get_thrust_policy(res),
+                  thrust::make_counting_iterator<int64_t>(0),
+                  thrust::make_counting_iterator<int64_t>(n_rows),
+                  ids.data_handle(),
+                  bitset_test_op<BitsetViewT>{bitset});
+
+  auto subset_neighbors = raft::make_device_matrix<int64_t, int64_t>(res, n_query, sub_k);
+  auto subset_distances = raft::make_device_matrix<float, int64_t>(res, n_query, sub_k);
+  if (sub_k > 0) {
+    auto subset = raft::make_device_matrix<float, int64_t>(res, n_pass, dim);
+    raft::linalg::map_offset(
+      res,
+      subset.view(),
+      gather_rows_op<T, internal_IdxT>{
+        index.dataset().data_handle(), index.dataset().stride(0), dim, ids.data_handle()});
+    auto queries_float = raft::make_device_matrix<float, int64_t>(res, n_query, dim);
+    raft::linalg::map(
+      res, queries_float.view(), spatial::knn::detail::utils::mapping<float>{}, queries);
+
+    std::vector<raft::device_matrix_view<const float, int64_t, row_major>> subset_list{
+      raft::make_const_mdspan(subset.view())};
+    raft::neighbors::brute_force::knn<int64_t, float, int64_t>(
+      res,
+      subset_list,
+      raft::make_const_mdspan(queries_float.view()),
+      subset_neighbors.view(),
+      subset_distances.view(),
+      index.metric());
+  }
+
+  raft::linalg::map_offset(
+    res,
+    neighbors,
+    translate_neighbors_op<internal_IdxT>{
+      subset_neighbors.data_handle(), ids.data_handle(), sub_k, k});
+  raft::linalg::map_offset(
+    res, distances, pad_distances_op{subset_distances.data_handle(), sub_k, k});
+
+  // the cosine distance does not depend on the scale of the elements
+  if (index.metric() == distance::DistanceType::CosineExpanded) { return; }
+  constexpr float kScale = spatial::knn::detail::utils::config<T>::kDivisor /
+                           spatial::knn::detail::utils::config<float>::kDivisor;
+  // unlike the search kernels, the brute-force search returns the inner products themselves
+  const auto metric = index.metric() == distance::DistanceType::InnerProduct
+                        ? distance::DistanceType::L2Expanded
+                        : index.metric();
+  ivf_pq::detail::postprocess_distances(distances.data_handle(),
+                                        distances.data_handle(),
+                                        metric,
+                                        distances.extent(0),
+                                        distances.extent(1),
+                                        kScale,
+                                        stream);
+}
+
+/**
+ * Enlarge the internal top-k buffer so that about `itopk_size` of its entries pass the filter.
+ *
+ * Filtered nodes are still expanded during the traversal (they keep the graph connected), but
+ * they are dropped from the buffer once expanded and never returned, so at a high filtering rate
+ * the buffer must be larger for the search to collect enough valid candidates.
+ */
+inline void adjust_itopk_to_filtering_rate(search_params& params, float filtering_rate)
+{
+  constexpr float kMaxFilteringRate = 0.999;
+  filtering_rate                    = std::min(filtering_rate, kMaxFilteringRate);
+  if (filtering_rate <= 0) { return; }
+
+  // The single-CTA and multi-kernel implementations are limited to 512 and 1024 entries; the
+  // multi-CTA one scales with the number of CTAs per query, which we keep reasonable.
+  size_t max_itopk = 4096;
+  if (params.algo == search_algo::SINGLE_CTA) {
+    max_itopk = 512;
+  } else if (params.algo == search_algo::MULTI_KERNEL) {
+    max_itopk = 1024;
+  }
+  const auto adjusted_itopk = std::min<size_t>(
+    max_itopk, static_cast<size_t>(params.itopk_size / (1.0 - filtering_rate)));
+  if (adjusted_itopk > params.itopk_size) {
+    RAFT_LOG_DEBUG("Filtering rate %f: increasing itopk_size from %zu to %zu",
+                   filtering_rate,
+                   params.itopk_size,
+                   adjusted_itopk);
+    params.itopk_size = adjusted_itopk;
+  }
+}
+
+/**
+ * @brief Search with a sample filter, adapting the search to the filter selectivity.
+ *
+ * When the fraction of rows passed by a `bitset_filter` is below
+ * `params.filter_brute_force_threshold`, the search is done by brute force over these rows.
+ * Otherwise the graph search is used with an internal top-k buffer sized to the filtering rate.
+ * The filter of a reordered index (see `index::source_indices`) is applied to the dataset rows.
+ */
+template <typename T,
+          typename internal_IdxT,
+          typename CagraSampleFilterT,
+          typename IdxT      = uint32_t,
+          typename DistanceT = float>
+void search_filtered_main(raft::resources const& res,
+                          search_params params,
+                          const index<T, IdxT>& index,
+                          raft::device_matrix_view<const T, int64_t, row_major> queries,
+                          raft::device_matrix_view<internal_IdxT, int64_t, row_major> neighbors,
+                          raft::device_matrix_view<DistanceT, int64_t, row_major> distances,
+                          CagraSampleFilterT sample_filter = CagraSampleFilterT())
+{
+  float filtering_rate = params.filtering_rate;
+  if constexpr (is_bitset_filter<CagraSampleFilterT>::value &&
+                std::is_same_v<DistanceT, float>) {
+    const auto bitset    = sample_filter.bitset_view_;
+    const int64_t n_rows = index.size();
+    if (n_rows > 0 && static_cast<int64_t>(bitset.size()) >= n_rows) {
+      const int64_t n_pass =
+        thrust::count_if(resource::get_thrust_policy(res),
+                         thrust::make_counting_iterator<int64_t>(0),
+                         thrust::make_counting_iterator<int64_t>(n_rows),
+                         bitset_test_op<std::remove_const_t<decltype(bitset)>>{bitset});
+      if (filtering_rate < 0) { filtering_rate = 1.0 - double(n_pass) / double(n_rows); }
+      // The brute force search scans the nodes, hence it is not used with a reordered index.
+      if (index.source_indices().extent(0) == 0 &&
+          double(n_pass) < double(params.filter_brute_force_threshold) * double(n_rows)) {
+        RAFT_LOG_DEBUG("Only %zu of %zu rows pass the filter, switching to brute force search",
+                       static_cast<size_t>(n_pass),
+                       static_cast<size_t>(n_rows));
+        search_brute_force_filtered<T, internal_IdxT>(
+          res, index, queries, neighbors, distances, bitset, n_pass);
+        return;
+      }
+    }
+  }
+  adjust_itopk_to_filtering_rate(params, filtering_rate);
+  if (index.source_indices().extent(0) > 0) {
+    // The filter is given the dataset rows rather than the nodes of the index.
+    using source_filter_t = source_index_sample_filter<internal_IdxT, CagraSampleFilterT>;
+    source_filter_t source_filter{
+      reinterpret_cast<const internal_IdxT*>(index.source_indices().data_handle()), sample_filter};
+    search_main<T, internal_IdxT, source_filter_t, IdxT, DistanceT>(
+      res, params, index, queries, neighbors, distances, source_filter);
+    return;
+  }
+  search_main<T, internal_IdxT, CagraSampleFilterT, IdxT, DistanceT>(
+    res, params, index, queries, neighbors, distances, sample_filter);
+}
+
+}  // namespace raft::neighbors::cagra::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -15,6 +15,8 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <climits>
 #include <cuda_fp16.h>
@@ -22,18 +24,29 @@
 #include <iostream>
 #include <memory>
 #include <omp.h>
+#include <optional>
+#include <raft/core/device_mdarray.hpp>
 #include <raft/core/device_mdspan.hpp>
+#include <raft/core/device_resources_manager.hpp>
+#include <raft/core/device_setter.hpp>
 #include <raft/core/host_device_accessor.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/logger.hpp>
 #include <raft/core/mdspan.hpp>
+#include <raft/core/resource/cancellation_token.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
+#include <raft/neighbors/cagra_types.hpp>
 #include <raft/spatial/knn/detail/ann_utils.cuh>
 #include <random>
 #include <sys/time.h>
+#include <vector>
 
 #include <raft/util/bitonic_sort.cuh>
 #include <raft/util/cuda_rt_essentials.hpp>
+#include <raft/util/integer_utils.hpp>
 
+#include "shard_utils.hpp"
 #include "utils.hpp"
 
 namespace raft::neighbors::cagra::detail {
@@ -125,21 +138,20 @@ RAFT_KERNEL kern_sort(const DATA_T* const dataset,  // [dataset_chunk_size, data
 }
 
 template <int MAX_DEGREE, class IdxT>
-RAFT_KERNEL kern_prune(const IdxT* const knn_graph,  // [graph_chunk_size, graph_degree]
-                       const uint32_t graph_size,
+RAFT_KERNEL kern_prune(const IdxT* const knn_graph,  // [graph_size, graph_degree]
+                       const uint64_t graph_size,
                        const uint32_t graph_degree,
                        const uint32_t degree,
-                       const uint32_t batch_size,
-                       const uint32_t batch_id,
-                       uint8_t* const detour_count,          // [graph_chunk_size, graph_degree]
-                       uint32_t* const num_no_detour_edges,  // [graph_size]
+                       const uint64_t batch_begin,
+                       uint8_t* const detour_count,          // [batch_size, graph_degree]
+                       uint32_t* const num_no_detour_edges,  // [batch_size]
                        uint64_t* const stats)
 {
   __shared__ uint32_t smem_num_detour[MAX_DEGREE];
   uint64_t* const num_retain = stats;
   uint64_t* const num_full   = stats + 1;
 
-  const uint64_t nid = blockIdx.x + (batch_size * batch_id);
+  const uint64_t nid = blockIdx.x + batch_begin;
   if (nid >= graph_size) { return; }
   for (uint32_t k = threadIdx.x; k < graph_degree; k += blockDim.x) {
     smem_num_detour[k] = 0;
@@ -170,7 +182,7 @@ RAFT_KERNEL kern_prune(const IdxT* const knn_graph,  // [graph_chunk_size, graph
 
   uint32_t num_edges_no_detour = 0;
   for (uint32_t k = threadIdx.x; k < graph_degree; k += blockDim.x) {
-    detour_count[k + (graph_degree * iA)] = min(smem_num_detour[k], (uint32_t)255);
+    detour_count[k + (graph_degree * blockIdx.x)] = min(smem_num_detour[k], (uint32_t)255);
     if (smem_num_detour[k] == 0) { num_edges_no_detour++; }
   }
   num_edges_no_detour += __shfl_xor_sync(0xffffffff, num_edges_no_detour, 1);
@@ -181,7 +193,7 @@ RAFT_KERNEL kern_prune(const IdxT* const knn_graph,  // [graph_chunk_size, graph
   num_edges_no_detour = min(num_edges_no_detour, degree);
 
   if (threadIdx.x == 0) {
-    num_no_detour_edges[iA] = num_edges_no_detour;
+    num_no_detour_edges[blockIdx.x] = num_edges_no_detour;
     atomicAdd((unsigned long long int*)num_retain, (unsigned long long int)num_edges_no_detour);
     if (num_edges_no_detour >= degree) { atomicAdd((unsigned long long int*)num_full, 1); }
   }
@@ -189,20 +201,23 @@ RAFT_KERNEL kern_prune(const IdxT* const knn_graph,  // [graph_chunk_size, graph
 
 template <class IdxT>
 RAFT_KERNEL kern_make_rev_graph(const IdxT* const dest_nodes,     // [graph_size]
-                                IdxT* const rev_graph,            // [size, degree]
-                                uint32_t* const rev_graph_count,  // [graph_size]
-                                const uint32_t graph_size,
-                                const uint32_t degree)
+                                IdxT* const rev_graph,            // [dest_end - dest_begin, degree]
+                                uint32_t* const rev_graph_count,  // [dest_end - dest_begin]
+                                const uint64_t graph_size,
+                                const uint32_t degree,
+                                const uint64_t dest_begin,
+                                const uint64_t dest_end)
 {
-  const uint32_t tid  = threadIdx.x + (blockDim.x * blockIdx.x);
-  const uint32_t tnum = blockDim.x * gridDim.x;
+  const uint64_t tid  = threadIdx.x + (blockDim.x * blockIdx.x);
+  const uint64_t tnum = blockDim.x * gridDim.x;
 
-  for (uint32_t src_id = tid; src_id < graph_size; src_id += tnum) {
+  for (uint64_t src_id = tid; src_id < graph_size; src_id += tnum) {
     const IdxT dest_id = dest_nodes[src_id];
-    if (dest_id >= graph_size) continue;
+    if (dest_id < dest_begin || dest_id >= dest_end) continue;
 
-    const uint32_t pos = atomicAdd(rev_graph_count + dest_id, 1);
-    if (pos < degree) { rev_graph[pos + ((uint64_t)degree * dest_id)] = src_id; }
+    const uint64_t row = dest_id - dest_begin;
+    const uint32_t pos = atomicAdd(rev_graph_count + row, 1);
+    if (pos < degree) { rev_graph[pos + ((uint64_t)degree * row)] = src_id; }
   }
 }
 
@@ -314,121 +329,149 @@ void sort_knn_graph(raft::resources const& res,
   RAFT_LOG_DEBUG("# Sorting kNN graph time: %.1lf sec\n", time_sort_end - time_sort_start);
 }
 
-template <typename IdxT = uint32_t,
-          typename g_accessor =
-            host_device_accessor<std::experimental::default_accessor<IdxT>, memory_type::host>>
-void optimize(raft::resources const& res,
-              mdspan<IdxT, matrix_extent<int64_t>, row_major, g_accessor> knn_graph,
-              raft::host_matrix_view<IdxT, int64_t, row_major> new_graph)
+/** Whether `bytes` take at most half of the free memory of the current device. */
+inline auto fits_in_device_memory(size_t bytes) -> bool
 {
-  RAFT_LOG_DEBUG(
-    "# Pruning kNN graph (size=%lu, degree=%lu)\n", knn_graph.extent(0), knn_graph.extent(1));
+  size_t free_bytes  = 0;
+  size_t total_bytes = 0;
+  RAFT_CUDA_TRY(cudaMemGetInfo(&free_bytes, &total_bytes));
+  return bytes <= free_bytes / 2;
+}
 
-  RAFT_EXPECTS(knn_graph.extent(0) == new_graph.extent(0),
-               "Each input array is expected to have the same number of rows");
-  RAFT_EXPECTS(new_graph.extent(1) <= knn_graph.extent(1),
-               "output graph cannot have more columns than input graph");
-  const uint32_t input_graph_degree  = knn_graph.extent(1);
-  const uint32_t output_graph_degree = new_graph.extent(1);
-  auto input_graph_ptr               = knn_graph.data_handle();
-  auto output_graph_ptr              = new_graph.data_handle();
-  const IdxT graph_size              = new_graph.extent(0);
+/** The device-accessible address of a host array, or nullptr if it is pageable memory. */
+template <typename T>
+auto device_accessible_ptr(T* ptr) -> T*
+{
+  cudaPointerAttributes attr;
+  RAFT_CUDA_TRY(cudaPointerGetAttributes(&attr, ptr));
+  return reinterpret_cast<T*>(attr.devicePointer);
+}
 
+/** RAII: page-lock a host array and map it into the address space of all the devices. */
+class host_registration {
+ public:
+  host_registration(void* ptr, size_t bytes) : ptr_(ptr)
   {
-    //
-    // Prune kNN graph
-    //
-    auto d_detour_count =
-      raft::make_device_matrix<uint8_t, int64_t>(res, graph_size, input_graph_degree);
-
-    RAFT_CUDA_TRY(cudaMemsetAsync(d_detour_count.data_handle(),
-                                  0xff,
-                                  graph_size * input_graph_degree * sizeof(uint8_t),
-                                  resource::get_cuda_stream(res)));
-
-    auto d_num_no_detour_edges = raft::make_device_vector<uint32_t, int64_t>(res, graph_size);
-    RAFT_CUDA_TRY(cudaMemsetAsync(d_num_no_detour_edges.data_handle(),
-                                  0x00,
-                                  graph_size * sizeof(uint32_t),
-                                  resource::get_cuda_stream(res)));
+    RAFT_CUDA_TRY(cudaHostRegister(ptr, bytes, cudaHostRegisterMapped | cudaHostRegisterPortable));
+  }
+  ~host_registration() { RAFT_CUDA_TRY_NO_THROW(cudaHostUnregister(ptr_)); }
 
-    auto dev_stats  = raft::make_device_vector<uint64_t>(res, 2);
-    auto host_stats = raft::make_host_vector<uint64_t>(2);
+  host_registration(const host_registration&)                    = delete;
+  auto operator=(const host_registration&) -> host_registration& = delete;
 
-    //
-    // Prune unimportant edges.
-    //
-    // The edge to be retained is determined without explicitly considering
-    // distance or angle. Suppose the edge is the k-th edge of some node-A to
-    // node-B (A->B). Among the edges originating at node-A, there are k-1 edges
-    // shorter than the edge A->B. Each of these k-1 edges are connected to a
-    // different k-1 nodes. Among these k-1 nodes, count the number of nodes with
-    // edges to node-B, which is the number of 2-hop detours for the edge A->B.
-    // Once the number of 2-hop detours has been counted for all edges, the
-    // specified number of edges are picked up for each node, starting with the
-    // edge with the lowest number of 2-hop detours.
-    //
-    const double time_prune_start = cur_time();
-    RAFT_LOG_DEBUG("# Pruning kNN Graph on GPUs\r");
+ private:
+  void* ptr_;
+};
 
-    // Copy input_graph_ptr over to device if necessary
-    device_matrix_view_from_host d_input_graph(
-      res,
-      raft::make_host_matrix_view<IdxT, int64_t>(input_graph_ptr, graph_size, input_graph_degree));
-
-    constexpr int MAX_DEGREE = 1024;
-    if (input_graph_degree > MAX_DEGREE) {
-      RAFT_FAIL(
-        "The degree of input knn graph is too large (%u). "
-        "It must be equal to or smaller than %d.",
-        input_graph_degree,
-        1024);
-    }
-    const uint32_t batch_size =
-      std::min(static_cast<uint32_t>(graph_size), static_cast<uint32_t>(256 * 1024));
-    const uint32_t num_batch = (graph_size + batch_size - 1) / batch_size;
-    const dim3 threads_prune(32, 1, 1);
-    const dim3 blocks_prune(batch_size, 1, 1);
-
-    RAFT_CUDA_TRY(cudaMemsetAsync(
-      dev_stats.data_handle(), 0, sizeof(uint64_t) * 2, resource::get_cuda_stream(res)));
-
-    for (uint32_t i_batch = 0; i_batch < num_batch; i_batch++) {
-      kern_prune<MAX_DEGREE, IdxT>
-        <<<blocks_prune, threads_prune, 0, resource::get_cuda_stream(res)>>>(
-          d_input_graph.data_handle(),
-          graph_size,
-          input_graph_degree,
-          output_graph_degree,
-          batch_size,
-          i_batch,
-          d_detour_count.data_handle(),
-          d_num_no_detour_edges.data_handle(),
-          dev_stats.data_handle());
-      resource::sync_stream(res);
-      RAFT_LOG_DEBUG(
-        "# Pruning kNN Graph on GPUs (%.1lf %%)\r",
-        (double)std::min<IdxT>((i_batch + 1) * batch_size, graph_size) / graph_size * 100);
+/**
+ * The input graph of the pruning as seen by the current device: the array itself if it is
+ * accessible from the device, otherwise a device copy or the page-locked host array (see
+ * `graph_placement`).
+ */
+template <typename IdxT>
+class pruning_input {
+ public:
+  pruning_input(raft::resources const& res,
+                raft::host_matrix_view<IdxT, int64_t, row_major> graph,
+                graph_placement placement)
+  {
+    ptr_ = device_accessible_ptr(graph.data_handle());
+    if (ptr_ != nullptr) { return; }
+    const size_t bytes = graph.size() * sizeof(IdxT);
+    if (placement == graph_placement::DEVICE ||
+        (placement == graph_placement::AUTO && fits_in_device_memory(bytes))) {
+      copy_.emplace(raft::make_device_matrix<IdxT, int64_t>(res, graph.extent(0), graph.extent(1)));
+      raft::copy(
+        copy_->data_handle(), graph.data_handle(), graph.size(), resource::get_cuda_stream(res));
+      ptr_ = copy_->data_handle();
+    } else {
+      RAFT_LOG_DEBUG("# Reading the kNN graph from the host memory (%zu bytes)", bytes);
+      registration_.emplace(graph.data_handle(), bytes);
+      RAFT_CUDA_TRY(
+        cudaHostGetDevicePointer(reinterpret_cast<void**>(&ptr_), graph.data_handle(), 0));
     }
-    resource::sync_stream(res);
-    RAFT_LOG_DEBUG("\n");
+  }
+
+  [[nodiscard]] auto data_handle() const -> const IdxT* { return ptr_; }
 
-    host_matrix_view_from_device<uint8_t, int64_t> detour_count(res, d_detour_count.view());
+ private:
+  std::optional<raft::device_matrix<IdxT, int64_t>> copy_;
+  std::optional<host_registration> registration_;
+  IdxT* ptr_ = nullptr;
+};
 
-    raft::copy(
-      host_stats.data_handle(), dev_stats.data_handle(), 2, resource::get_cuda_stream(res));
-    const auto num_keep = host_stats.data_handle()[0];
-    const auto num_full = host_stats.data_handle()[1];
+/**
+ * Prune the edges of the nodes [begin, end) of the input graph into the output graph,
+ * `batch_size` nodes per kernel launch.
+ *
+ * The edge to be retained is determined without explicitly considering
+ * distance or angle. Suppose the edge is the k-th edge of some node-A to
+ * node-B (A->B). Among the edges originating at node-A, there are k-1 edges
+ * shorter than the edge A->B. Each of these k-1 edges are connected to a
+ * different k-1 nodes. Among these k-1 nodes, count the number of nodes with
+ * edges to node-B, which is the number of 2-hop detours for the edge A->B.
+ * Once the number of 2-hop detours has been counted for all edges, the
+ * specified number of edges are picked up for each node, starting with the
+ * edge with the lowest number of 2-hop detours.
+ *
+ * The counts of the retained no-detour edges and of the nodes that retain only such edges are
+ * added to `stats`.
+ */
+template <typename IdxT>
+void prune_rows(raft::resources const& res,
+                const IdxT* d_input_graph,     // [graph_size, input_graph_degree], device
+                const IdxT* input_graph_ptr,   // [graph_size, input_graph_degree], host
+                IdxT* output_graph_ptr,        // [graph_size, output_graph_degree], host
+                uint64_t graph_size,
+                uint32_t input_graph_degree,
+                uint32_t output_graph_degree,
+                uint64_t begin,
+                uint64_t end,
+                uint64_t batch_size,
+                uint64_t* stats)
+{
+  constexpr int MAX_DEGREE = 1024;
+  auto stream              = resource::get_cuda_stream(res);
+  batch_size               = std::max<uint64_t>(std::min(batch_size, end - begin), 1);
+
+  auto d_detour_count =
+    raft::make_device_matrix<uint8_t, int64_t>(res, batch_size, input_graph_degree);
+  auto detour_count = raft::make_host_matrix<uint8_t, int64_t>(batch_size, input_graph_degree);
+  auto d_num_no_detour_edges = raft::make_device_vector<uint32_t, int64_t>(res, batch_size);
+  auto dev_stats             = raft::make_device_vector<uint64_t>(res, 2);
+  auto host_stats            = raft::make_host_vector<uint64_t>(2);
+  RAFT_CUDA_TRY(cudaMemsetAsync(dev_stats.data_handle(), 0, sizeof(uint64_t) * 2, stream));
+
+  for (uint64_t batch_begin = begin; batch_begin < end; batch_begin += batch_size) {
+    resource::check_cancellation(res);
+    const uint64_t n_rows = std::min(batch_size, end - batch_begin);
+    RAFT_CUDA_TRY(cudaMemsetAsync(d_detour_count.data_handle(),
+                                  0xff,
+                                  n_rows * input_graph_degree * sizeof(uint8_t),
+                                  stream));
+    kern_prune<MAX_DEGREE, IdxT><<<n_rows, 32, 0, stream>>>(d_input_graph,
+                                                            graph_size,
+                                                            input_graph_degree,
+                                                            output_graph_degree,
+                                                            batch_begin,
+                                                            d_detour_count.data_handle(),
+                                                            d_num_no_detour_edges.data_handle(),
+                                                            dev_stats.data_handle());
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    raft::copy(detour_count.data_handle(),
+               d_detour_count.data_handle(),
+               n_rows * input_graph_degree,
+               stream);
+    resource::sync_stream(res);
 
     // Create pruned kNN graph
-    uint32_t max_detour = 0;
-#pragma omp parallel for reduction(max : max_detour)
-    for (uint64_t i = 0; i < graph_size; i++) {
-      uint64_t pk = 0;
+#pragma omp parallel for
+    for (uint64_t r = 0; r < n_rows; r++) {
+      const uint64_t i = batch_begin + r;
+      uint64_t pk      = 0;
       for (uint32_t num_detour = 0; num_detour < output_graph_degree; num_detour++) {
-        if (max_detour < num_detour) { max_detour = num_detour; /* stats */ }
         for (uint64_t k = 0; k < input_graph_degree; k++) {
-          if (detour_count.data_handle()[k + (input_graph_degree * i)] != num_detour) { continue; }
+          if (detour_count.data_handle()[k + (input_graph_degree * r)] != num_detour) { continue; }
           output_graph_ptr[pk + (output_graph_degree * i)] =
             input_graph_ptr[k + (input_graph_degree * i)];
           pk += 1;
@@ -438,7 +481,213 @@ void optimize(raft::resources const& res,
       }
       assert(pk == output_graph_degree);
     }
-    // RAFT_LOG_DEBUG("# max_detour: %u\n", max_detour);
+    RAFT_LOG_DEBUG("# Pruning kNN Graph on GPUs (%.1lf %%)\r",
+                   (double)(batch_begin + n_rows - begin) / (end - begin) * 100);
+  }
+  raft::copy(host_stats.data_handle(), dev_stats.data_handle(), 2, stream);
+  resource::sync_stream(res);
+  stats[0] += host_stats(0);
+  stats[1] += host_stats(1);
+}
+
+/**
+ * The number of nodes whose reverse edges are collected per device pass (see
+ * `optimize_params::reverse_batch_size`).
+ */
+template <typename IdxT>
+auto reverse_batch_size(const optimize_params& params,
+                        uint64_t graph_size,
+                        uint64_t n_dest,
+                        uint32_t degree) -> uint64_t
+{
+  if (params.reverse_batch_size > 0) {
+    return std::min<uint64_t>(params.reverse_batch_size, n_dest);
+  }
+  size_t free_bytes  = 0;
+  size_t total_bytes = 0;
+  RAFT_CUDA_TRY(cudaMemGetInfo(&free_bytes, &total_bytes));
+  // a column of the pruned graph, and the reverse edges and their count per node of the pass
+  const uint64_t column_bytes = graph_size * sizeof(IdxT);
+  const uint64_t avail        = free_bytes / 2 > column_bytes ? free_bytes / 2 - column_bytes : 0;
+  const uint64_t n_rows       = avail / (degree * sizeof(IdxT) + sizeof(uint32_t));
+  return std::clamp<uint64_t>(n_rows, std::min<uint64_t>(n_dest, 1024), n_dest);
+}
+
+/**
+ * Collect the reverse edges of the nodes [dest_begin, dest_end) of the pruned graph into the rows
+ * of `rev_graph_ptr`, in the order of the columns of the pruned graph.
+ */
+template <typename IdxT>
+void make_reverse_rows(raft::resources const& res,
+                       const IdxT* output_graph_ptr,  // [graph_size, degree], host
+                       uint64_t graph_size,
+                       uint32_t degree,
+                       uint64_t dest_begin,
+                       uint64_t dest_end,
+                       IdxT* rev_graph_ptr,           // [graph_size, degree], host
+                       uint32_t* rev_graph_count_ptr  // [graph_size], host
+)
+{
+  auto stream            = resource::get_cuda_stream(res);
+  const uint64_t n       = dest_end - dest_begin;
+  auto d_rev_graph       = raft::make_device_matrix<IdxT, int64_t>(res, n, degree);
+  auto d_rev_graph_count = raft::make_device_vector<uint32_t, int64_t>(res, n);
+  RAFT_CUDA_TRY(
+    cudaMemsetAsync(d_rev_graph.data_handle(), 0xff, n * degree * sizeof(IdxT), stream));
+  RAFT_CUDA_TRY(
+    cudaMemsetAsync(d_rev_graph_count.data_handle(), 0x00, n * sizeof(uint32_t), stream));
+
+  auto dest_nodes   = raft::make_host_vector<IdxT, int64_t>(graph_size);
+  auto d_dest_nodes = raft::make_device_vector<IdxT, int64_t>(res, graph_size);
+
+  for (uint64_t k = 0; k < degree; k++) {
+#pragma omp parallel for
+    for (uint64_t i = 0; i < graph_size; i++) {
+      dest_nodes.data_handle()[i] = output_graph_ptr[k + (degree * i)];
+    }
+    resource::sync_stream(res);
+    resource::check_cancellation(res);
+
+    raft::copy(d_dest_nodes.data_handle(), dest_nodes.data_handle(), graph_size, stream);
+
+    dim3 threads(256, 1, 1);
+    dim3 blocks(1024, 1, 1);
+    kern_make_rev_graph<<<blocks, threads, 0, stream>>>(d_dest_nodes.data_handle(),
+                                                        d_rev_graph.data_handle(),
+                                                        d_rev_graph_count.data_handle(),
+                                                        graph_size,
+                                                        degree,
+                                                        dest_begin,
+                                                        dest_end);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    RAFT_LOG_DEBUG("# Making reverse graph on GPUs: %lu / %u    \r", k, degree);
+  }
+
+  raft::copy(rev_graph_ptr + dest_begin * degree, d_rev_graph.data_handle(), n * degree, stream);
+  raft::copy(rev_graph_count_ptr + dest_begin, d_rev_graph_count.data_handle(), n, stream);
+  resource::sync_stream(res);
+}
+
+/** Replace some edges of the pruned graph with reverse edges. */
+template <typename IdxT>
+void replace_reverse_edges(IdxT* output_graph_ptr,  // [graph_size, output_graph_degree]
+                           uint64_t graph_size,
+                           uint64_t output_graph_degree,
+                           const IdxT* rev_graph_ptr,           // [graph_size, output_graph_degree]
+                           const uint32_t* rev_graph_count_ptr  // [graph_size]
+)
+{
+  const double time_replace_start = cur_time();
+
+  const uint64_t num_protected_edges = output_graph_degree / 2;
+  RAFT_LOG_DEBUG("# num_protected_edges: %lu", num_protected_edges);
+
+  constexpr int _omp_chunk = 1024;
+#pragma omp parallel for schedule(dynamic, _omp_chunk)
+  for (uint64_t j = 0; j < graph_size; j++) {
+    uint64_t k = std::min<uint64_t>(rev_graph_count_ptr[j], output_graph_degree);
+    while (k) {
+      k--;
+      uint64_t i = rev_graph_ptr[k + (output_graph_degree * j)];
+
+      uint64_t pos =
+        pos_in_array<IdxT>(i, output_graph_ptr + (output_graph_degree * j), output_graph_degree);
+      if (pos < num_protected_edges) { continue; }
+      uint64_t num_shift = pos - num_protected_edges;
+      if (pos == output_graph_degree) {
+        num_shift = output_graph_degree - num_protected_edges - 1;
+      }
+      shift_array<IdxT>(output_graph_ptr + num_protected_edges + (output_graph_degree * j),
+                        num_shift);
+      output_graph_ptr[num_protected_edges + (output_graph_degree * j)] = i;
+    }
+    if ((omp_get_thread_num() == 0) && ((j % _omp_chunk) == 0)) {
+      RAFT_LOG_DEBUG("# Replacing reverse edges: %lu / %lu    ", j, graph_size);
+    }
+  }
+  RAFT_LOG_DEBUG("\n");
+
+  const double time_replace_end = cur_time();
+  RAFT_LOG_DEBUG("# Replacing edges time: %.1lf sec", time_replace_end - time_replace_start);
+
+  /* stats */
+  uint64_t num_replaced_edges = 0;
+#pragma omp parallel for reduction(+ : num_replaced_edges)
+  for (uint64_t i = 0; i < graph_size; i++) {
+    for (uint64_t k = 0; k < output_graph_degree; k++) {
+      const uint64_t j = output_graph_ptr[k + (output_graph_degree * i)];
+      const uint64_t pos =
+        pos_in_array<IdxT>(j, output_graph_ptr + (output_graph_degree * i), output_graph_degree);
+      if (pos == output_graph_degree) { num_replaced_edges += 1; }
+    }
+  }
+  RAFT_LOG_DEBUG("# Average number of replaced edges per node: %.2f",
+                 (double)num_replaced_edges / graph_size);
+}
+
+/** Check the shapes of the graphs of `optimize`. */
+inline void check_optimize_shapes(int64_t input_rows,
+                                  int64_t input_degree,
+                                  int64_t output_rows,
+                                  int64_t output_degree)
+{
+  RAFT_EXPECTS(input_rows == output_rows,
+               "Each input array is expected to have the same number of rows");
+  RAFT_EXPECTS(output_degree <= input_degree,
+               "output graph cannot have more columns than input graph");
+  constexpr int MAX_DEGREE = 1024;
+  if (input_degree > MAX_DEGREE) {
+    RAFT_FAIL(
+      "The degree of input knn graph is too large (%u). "
+      "It must be equal to or smaller than %d.",
+      static_cast<uint32_t>(input_degree),
+      MAX_DEGREE);
+  }
+}
+
+template <typename IdxT = uint32_t,
+          typename g_accessor =
+            host_device_accessor<std::experimental::default_accessor<IdxT>, memory_type::host>>
+void optimize(raft::resources const& res,
+              mdspan<IdxT, matrix_extent<int64_t>, row_major, g_accessor> knn_graph,
+              raft::host_matrix_view<IdxT, int64_t, row_major> new_graph,
+              const optimize_params& params = optimize_params{})
+{
+  RAFT_LOG_DEBUG(
+    "# Pruning kNN graph (size=%lu, degree=%lu)\n", knn_graph.extent(0), knn_graph.extent(1));
+
+  check_optimize_shapes(
+    knn_graph.extent(0), knn_graph.extent(1), new_graph.extent(0), new_graph.extent(1));
+  const uint32_t input_graph_degree  = knn_graph.extent(1);
+  const uint32_t output_graph_degree = new_graph.extent(1);
+  auto input_graph_ptr               = knn_graph.data_handle();
+  auto output_graph_ptr              = new_graph.data_handle();
+  const uint64_t graph_size          = new_graph.extent(0);
+
+  {
+    //
+    // Prune unimportant edges (see `prune_rows`).
+    //
+    const double time_prune_start = cur_time();
+    RAFT_LOG_DEBUG("# Pruning kNN Graph on GPUs\r");
+
+    pruning_input<IdxT> d_input_graph(
+      res,
+      raft::make_host_matrix_view<IdxT, int64_t>(input_graph_ptr, graph_size, input_graph_degree),
+      params.input_graph_placement);
+    uint64_t stats[2] = {0, 0};
+    prune_rows(res,
+               d_input_graph.data_handle(),
+               input_graph_ptr,
+               output_graph_ptr,
+               graph_size,
+               input_graph_degree,
+               output_graph_degree,
+               0,
+               graph_size,
+               params.prune_batch_size,
+               stats);
+    RAFT_LOG_DEBUG("\n");
 
     const double time_prune_end = cur_time();
     RAFT_LOG_DEBUG(
@@ -446,9 +695,9 @@ void optimize(raft::resources const& res,
       "avg_no_detour_edges_per_node: %.2lf/%u, "
       "nodes_with_no_detour_at_all_edges: %.1lf%%\n",
       time_prune_end - time_prune_start,
-      (double)num_keep / graph_size,
+      (double)stats[0] / graph_size,
       output_graph_degree,
-      (double)num_full / graph_size * 100);
+      (double)stats[1] / graph_size * 100);
   }
 
   auto rev_graph       = raft::make_host_matrix<IdxT, int64_t>(graph_size, output_graph_degree);
@@ -456,118 +705,128 @@ void optimize(raft::resources const& res,
 
   {
     //
-    // Make reverse graph
+    // Make reverse graph, a range of destination nodes per device pass
     //
     const double time_make_start = cur_time();
 
-    device_matrix_view_from_host<IdxT, int64_t> d_rev_graph(res, rev_graph.view());
-    RAFT_CUDA_TRY(cudaMemsetAsync(d_rev_graph.data_handle(),
-                                  0xff,
-                                  graph_size * output_graph_degree * sizeof(IdxT),
-                                  resource::get_cuda_stream(res)));
-
-    auto d_rev_graph_count = raft::make_device_vector<uint32_t, int64_t>(res, graph_size);
-    RAFT_CUDA_TRY(cudaMemsetAsync(d_rev_graph_count.data_handle(),
-                                  0x00,
-                                  graph_size * sizeof(uint32_t),
-                                  resource::get_cuda_stream(res)));
-
-    auto dest_nodes   = raft::make_host_vector<IdxT, int64_t>(graph_size);
-    auto d_dest_nodes = raft::make_device_vector<IdxT, int64_t>(res, graph_size);
-
-    for (uint64_t k = 0; k < output_graph_degree; k++) {
-#pragma omp parallel for
-      for (uint64_t i = 0; i < graph_size; i++) {
-        dest_nodes.data_handle()[i] = output_graph_ptr[k + (output_graph_degree * i)];
-      }
-      resource::sync_stream(res);
-
-      raft::copy(d_dest_nodes.data_handle(),
-                 dest_nodes.data_handle(),
-                 graph_size,
-                 resource::get_cuda_stream(res));
-
-      dim3 threads(256, 1, 1);
-      dim3 blocks(1024, 1, 1);
-      kern_make_rev_graph<<<blocks, threads, 0, resource::get_cuda_stream(res)>>>(
-        d_dest_nodes.data_handle(),
-        d_rev_graph.data_handle(),
-        d_rev_graph_count.data_handle(),
-        graph_size,
-        output_graph_degree);
-      RAFT_LOG_DEBUG("# Making reverse graph on GPUs: %lu / %u    \r", k, output_graph_degree);
+    const uint64_t step =
+      reverse_batch_size<IdxT>(params, graph_size, graph_size, output_graph_degree);
+    for (uint64_t dest_begin = 0; dest_begin < graph_size; dest_begin += step) {
+      make_reverse_rows(res,
+                        output_graph_ptr,
+                        graph_size,
+                        output_graph_degree,
+                        dest_begin,
+                        std::min(dest_begin + step, graph_size),
+                        rev_graph.data_handle(),
+                        rev_graph_count.data_handle());
     }
-
-    resource::sync_stream(res);
     RAFT_LOG_DEBUG("\n");
 
-    if (d_rev_graph.allocated_memory()) {
-      raft::copy(rev_graph.data_handle(),
-                 d_rev_graph.data_handle(),
-                 graph_size * output_graph_degree,
-                 resource::get_cuda_stream(res));
-    }
-    raft::copy(rev_graph_count.data_handle(),
-               d_rev_graph_count.data_handle(),
-               graph_size,
-               resource::get_cuda_stream(res));
-
     const double time_make_end = cur_time();
     RAFT_LOG_DEBUG("# Making reverse graph time: %.1lf sec", time_make_end - time_make_start);
   }
 
-  {
-    //
-    // Replace some edges with reverse edges
-    //
-    const double time_replace_start = cur_time();
-
-    const uint64_t num_protected_edges = output_graph_degree / 2;
-    RAFT_LOG_DEBUG("# num_protected_edges: %lu", num_protected_edges);
+  replace_reverse_edges(output_graph_ptr,
+                        graph_size,
+                        output_graph_degree,
+                        rev_graph.data_handle(),
+                        rev_graph_count.data_handle());
+}
 
-    constexpr int _omp_chunk = 1024;
-#pragma omp parallel for schedule(dynamic, _omp_chunk)
-    for (uint64_t j = 0; j < graph_size; j++) {
-      uint64_t k = std::min(rev_graph_count.data_handle()[j], output_graph_degree);
-      while (k) {
-        k--;
-        uint64_t i = rev_graph.data_handle()[k + (output_graph_degree * j)];
-
-        uint64_t pos =
-          pos_in_array<IdxT>(i, output_graph_ptr + (output_graph_degree * j), output_graph_degree);
-        if (pos < num_protected_edges) { continue; }
-        uint64_t num_shift = pos - num_protected_edges;
-        if (pos == output_graph_degree) {
-          num_shift = output_graph_degree - num_protected_edges - 1;
-        }
-        shift_array<IdxT>(output_graph_ptr + num_protected_edges + (output_graph_degree * j),
-                          num_shift);
-        output_graph_ptr[num_protected_edges + (output_graph_degree * j)] = i;
-      }
-      if ((omp_get_thread_num() == 0) && ((j % _omp_chunk) == 0)) {
-        RAFT_LOG_DEBUG("# Replacing reverse edges: %lu / %lu    ", j, graph_size);
-      }
+/**
+ * Prune a host kNN graph on several devices: the pruning and the reverse edges of contiguous
+ * ranges of nodes are computed concurrently, one host thread per device.
+ */
+template <typename IdxT = uint32_t>
+void optimize(const optimize_params& params,
+              raft::host_matrix_view<IdxT, int64_t, row_major> knn_graph,
+              raft::host_matrix_view<IdxT, int64_t, row_major> new_graph,
+              const std::vector<int>& devices)
+{
+  RAFT_EXPECTS(!devices.empty(), "At least one device is required");
+  check_optimize_shapes(
+    knn_graph.extent(0), knn_graph.extent(1), new_graph.extent(0), new_graph.extent(1));
+  const uint32_t input_graph_degree  = knn_graph.extent(1);
+  const uint32_t output_graph_degree = new_graph.extent(1);
+  const uint64_t graph_size          = new_graph.extent(0);
+  const uint32_t n_devices           = devices.size();
+  const uint64_t rows_per_device     = raft::div_rounding_up_safe<uint64_t>(graph_size, n_devices);
+  RAFT_LOG_DEBUG("# Pruning kNN graph (size=%lu, degree=%u) on %u GPUs\n",
+                 graph_size,
+                 input_graph_degree,
+                 n_devices);
+
+  // The devices share the page-locked host graph unless every one of them holds a copy.
+  std::optional<host_registration> registration;
+  const size_t input_bytes = knn_graph.size() * sizeof(IdxT);
+  if (params.input_graph_placement != graph_placement::DEVICE &&
+      device_accessible_ptr(knn_graph.data_handle()) == nullptr) {
+    bool fits = params.input_graph_placement == graph_placement::AUTO;
+    for (int dev : devices) {
+      if (!fits) { break; }
+      device_setter scoped_device(dev);
+      fits = fits_in_device_memory(input_bytes);
     }
-    RAFT_LOG_DEBUG("\n");
+    if (!fits) { registration.emplace(knn_graph.data_handle(), input_bytes); }
+  }
 
-    const double time_replace_end = cur_time();
-    RAFT_LOG_DEBUG("# Replacing edges time: %.1lf sec", time_replace_end - time_replace_start);
+  std::vector<std::array<uint64_t, 2>> stats(n_devices);
+  for_each_shard(n_devices, [&](uint32_t i) {
+    const uint64_t begin = std::min<uint64_t>(i * rows_per_device, graph_size);
+    const uint64_t end   = std::min<uint64_t>(begin + rows_per_device, graph_size);
+    if (begin == end) { return; }
+    device_setter scoped_device(devices[i]);
+    auto const& res = device_resources_manager::get_device_resources(devices[i]);
+    pruning_input<IdxT> d_input_graph(res, knn_graph, graph_placement::DEVICE);
+    prune_rows(res,
+               d_input_graph.data_handle(),
+               knn_graph.data_handle(),
+               new_graph.data_handle(),
+               graph_size,
+               input_graph_degree,
+               output_graph_degree,
+               begin,
+               end,
+               params.prune_batch_size,
+               stats[i].data());
+  });
+  registration.reset();
+  uint64_t num_keep = 0;
+  for (auto& s : stats) {
+    num_keep += s[0];
+  }
+  RAFT_LOG_DEBUG("# avg_no_detour_edges_per_node: %.2lf/%u",
+                 (double)num_keep / graph_size,
+                 output_graph_degree);
 
-    /* stats */
-    uint64_t num_replaced_edges = 0;
-#pragma omp parallel for reduction(+ : num_replaced_edges)
-    for (uint64_t i = 0; i < graph_size; i++) {
-      for (uint64_t k = 0; k < output_graph_degree; k++) {
-        const uint64_t j = output_graph_ptr[k + (output_graph_degree * i)];
-        const uint64_t pos =
-          pos_in_array<IdxT>(j, output_graph_ptr + (output_graph_degree * i), output_graph_degree);
-        if (pos == output_graph_degree) { num_replaced_edges += 1; }
-      }
+  auto rev_graph       = raft::make_host_matrix<IdxT, int64_t>(graph_size, output_graph_degree);
+  auto rev_graph_count = raft::make_host_vector<uint32_t, int64_t>(graph_size);
+  for_each_shard(n_devices, [&](uint32_t i) {
+    const uint64_t begin = std::min<uint64_t>(i * rows_per_device, graph_size);
+    const uint64_t end   = std::min<uint64_t>(begin + rows_per_device, graph_size);
+    if (begin == end) { return; }
+    device_setter scoped_device(devices[i]);
+    auto const& res = device_resources_manager::get_device_resources(devices[i]);
+    const uint64_t step =
+      reverse_batch_size<IdxT>(params, graph_size, end - begin, output_graph_degree);
+    for (uint64_t dest_begin = begin; dest_begin < end; dest_begin += step) {
+      make_reverse_rows(res,
+                        new_graph.data_handle(),
+                        graph_size,
+                        output_graph_degree,
+                        dest_begin,
+                        std::min(dest_begin + step, end),
+                        rev_graph.data_handle(),
+                        rev_graph_count.data_handle());
     }
-    RAFT_LOG_DEBUG("# Average number of replaced edges per node: %.2f",
-                   (double)num_replaced_edges / graph_size);
-  }
-}
+  });
 
+  replace_reverse_edges(new_graph.data_handle(),
+                        graph_size,
+                        output_graph_degree,
+                        rev_graph.data_handle(),
+                        rev_graph_count.data_handle());
+}
 }  // namespace graph
 }  // namespace raft::neighbors::cagra::detail
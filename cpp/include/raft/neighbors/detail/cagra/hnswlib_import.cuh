@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "../../cagra_types.hpp"
+#include "cagra_build.cuh"
+#include "dataset_norms.cuh"
+#include "graph_core.cuh"
+#include "remove_nodes.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+#include <vector>
+
+/*
+ * The import of an hnswlib index (as saved by `HierarchicalNSW::saveIndex`).
+ *
+ * The file starts with the header written by `serialize_to_hnswlib`, followed by the elements of
+ * the base layer, `size_data_per_element` bytes each:
+ *
+ *   - the link list header (uint32): the number of neighbors in the lower 16 bits and the deleted
+ *     flag in bit 16;
+ *   - `maxM0` neighbor ids (uint32, the positions of the elements in the file);
+ *   - the vector (`dim` values of the data type);
+ *   - the label (size_t), the external id of the element.
+ *
+ * The link lists of the upper layers follow; they are not needed by CAGRA.
+ */
+namespace raft::neighbors::cagra::detail {
+
+template <typename T, typename IdxT>
+auto from_hnswlib(raft::resources const& res,
+                  std::istream& is,
+                  const hnswlib_import_params& params,
+                  raft::host_vector<uint64_t, int64_t>* labels) -> index<T, IdxT>
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("cagra::from_hnswlib");
+  RAFT_EXPECTS(params.metric == distance::DistanceType::L2Expanded ||
+                 params.metric == distance::DistanceType::InnerProduct ||
+                 params.metric == distance::DistanceType::CosineExpanded,
+               "CAGRA supports only the L2Expanded, InnerProduct and CosineExpanded metrics");
+
+  auto read_pod = [&is](auto& x) { is.read(reinterpret_cast<char*>(&x), sizeof(x)); };
+  std::size_t offset_level_0, max_element, n_rows, size_data_per_element, label_offset,
+    offset_data, max_M, max_M0, M, ef_construction;
+  int max_level, entrypoint_node;
+  double mult;
+  read_pod(offset_level_0);
+  read_pod(max_element);
+  read_pod(n_rows);
+  read_pod(size_data_per_element);
+  read_pod(label_offset);
+  read_pod(offset_data);
+  read_pod(max_level);
+  read_pod(entrypoint_node);
+  read_pod(max_M);
+  read_pod(max_M0);
+  read_pod(M);
+  read_pod(mult);
+  read_pod(ef_construction);
+  RAFT_EXPECTS(is.good(), "Failed to read the header of the hnswlib index");
+  RAFT_EXPECTS(offset_data == max_M0 * sizeof(uint32_t) + sizeof(uint32_t) &&
+                 label_offset > offset_data &&
+                 size_data_per_element == label_offset + sizeof(std::size_t),
+               "Invalid layout of the elements of the hnswlib index");
+  RAFT_EXPECTS((label_offset - offset_data) % sizeof(T) == 0,
+               "The size of the vectors of the hnswlib index does not match the data type");
+  const auto dim          = static_cast<int64_t>((label_offset - offset_data) / sizeof(T));
+  const auto graph_degree =
+    static_cast<int64_t>(params.graph_degree > 0 ? params.graph_degree : max_M0);
+  RAFT_EXPECTS(graph_degree > 0 && static_cast<int64_t>(n_rows) > graph_degree,
+               "The hnswlib index must have more elements than the graph degree");
+  // the padded neighbor lists: the input of the pruning, or the candidates of the truncation
+  const auto knn_degree = std::min<int64_t>(
+    std::max<int64_t>(params.optimize ? 2 * graph_degree : graph_degree, max_M0), n_rows - 1);
+  RAFT_LOG_DEBUG("Importing an hnswlib index, size %zu, dim %ld, maxM0 %zu -> graph degree %ld",
+                 n_rows,
+                 dim,
+                 max_M0,
+                 graph_degree);
+
+  auto dataset   = raft::make_host_matrix<T, int64_t>(n_rows, dim);
+  auto knn_graph = raft::make_host_matrix<IdxT, int64_t>(n_rows, knn_degree);
+  std::vector<uint32_t> degrees(n_rows);
+  std::vector<IdxT> deleted{};
+  if (labels != nullptr) { *labels = raft::make_host_vector<uint64_t, int64_t>(n_rows); }
+  std::vector<char> element(size_data_per_element);
+  for (std::size_t i = 0; i < n_rows; i++) {
+    is.read(element.data(), size_data_per_element);
+    RAFT_EXPECTS(is.good(), "Failed to read the element %zu of the hnswlib index", i);
+    uint32_t header;
+    std::memcpy(&header, element.data(), sizeof(uint32_t));
+    if ((header >> 16) & 1u) { deleted.push_back(static_cast<IdxT>(i)); }
+    const uint32_t count = std::min<uint32_t>(header & 0xffffu, max_M0);
+    const auto* links    = element.data() + sizeof(uint32_t);
+    uint32_t degree      = 0;
+    for (uint32_t j = 0; j < count && degree < knn_degree; j++) {
+      uint32_t neighbor;
+      std::memcpy(&neighbor, links + j * sizeof(uint32_t), sizeof(uint32_t));
+      if (neighbor >= n_rows || neighbor == i) { continue; }
+      knn_graph(i, degree++) = static_cast<IdxT>(neighbor);
+    }
+    degrees[i] = degree;
+    std::memcpy(&dataset(i, 0), element.data() + offset_data, dim * sizeof(T));
+    if (labels != nullptr) {
+      std::size_t label;
+      std::memcpy(&label, element.data() + label_offset, sizeof(std::size_t));
+      (*labels)(i) = label;
+    }
+  }
+
+  // Pad the short lists with the neighbors of the neighbors, then by repeating the list, so that
+  // the padding is close to the node and the search wastes at most a few slots on it.
+#pragma omp parallel for
+  for (int64_t i = 0; i < static_cast<int64_t>(n_rows); i++) {
+    IdxT* row          = &knn_graph(i, 0);
+    const auto n_own   = static_cast<int64_t>(degrees[i]);
+    int64_t n          = n_own;
+    const auto has_row = [&](IdxT v) {
+      return v == IdxT(i) || std::find(row, row + n, v) != row + n;
+    };
+    for (int64_t j = 0; j < n_own && n < knn_degree; j++) {
+      const auto neighbor = static_cast<int64_t>(row[j]);
+      for (uint32_t l = 0; l < degrees[neighbor] && n < knn_degree; l++) {
+        const IdxT v = knn_graph(neighbor, l);
+        if (!has_row(v)) { row[n++] = v; }
+      }
+    }
+    for (int64_t j = n; j < knn_degree; j++) {
+      // an isolated node gets the next nodes of the file
+      row[j] = n > 0 ? row[j % n] : static_cast<IdxT>((i + 1 + j) % n_rows);
+    }
+  }
+
+  // the nearest neighbors first, as expected by the pruning and the truncation
+  using internal_IdxT     = typename std::make_unsigned<IdxT>::type;
+  auto knn_graph_internal = raft::make_host_matrix_view<internal_IdxT, int64_t>(
+    reinterpret_cast<internal_IdxT*>(knn_graph.data_handle()), n_rows, knn_degree);
+  if (params.metric == distance::DistanceType::CosineExpanded) {
+    auto normalized = make_normalized_dataset(res, raft::make_const_mdspan(dataset.view()));
+    graph::sort_knn_graph(res, raft::make_const_mdspan(normalized.view()), knn_graph_internal);
+  } else {
+    graph::sort_knn_graph(res, raft::make_const_mdspan(dataset.view()), knn_graph_internal);
+  }
+
+  auto cagra_graph = raft::make_host_matrix<IdxT, int64_t>(n_rows, graph_degree);
+  if (params.optimize) {
+    optimize<IdxT>(res, knn_graph.view(), cagra_graph.view());
+  } else {
+#pragma omp parallel for
+    for (int64_t i = 0; i < static_cast<int64_t>(n_rows); i++) {
+      std::copy(&knn_graph(i, 0), &knn_graph(i, 0) + graph_degree, &cagra_graph(i, 0));
+    }
+  }
+
+  index<T, IdxT> idx(res,
+                     params.metric,
+                     raft::make_const_mdspan(dataset.view()),
+                     raft::make_const_mdspan(cagra_graph.view()));
+  if (params.metric == distance::DistanceType::CosineExpanded) {
+    idx.update_dataset_norms(res, make_dataset_norms(res, idx));
+  }
+  // the deleted elements keep their place in the graph, but are never returned
+  if (!deleted.empty()) {
+    auto deleted_d = raft::make_device_vector<IdxT, int64_t>(res, deleted.size());
+    raft::copy(
+      deleted_d.data_handle(), deleted.data(), deleted.size(), resource::get_cuda_stream(res));
+    remove<T, IdxT>(res, idx, raft::make_const_mdspan(deleted_d.view()));
+    resource::sync_stream(res);
+  }
+  return idx;
+}
+
+template <typename T, typename IdxT>
+auto from_hnswlib(raft::resources const& res,
+                  const std::string& filename,
+                  const hnswlib_import_params& params,
+                  raft::host_vector<uint64_t, int64_t>* labels) -> index<T, IdxT>
+{
+  std::ifstream is(filename, std::ios::in | std::ios::binary);
+  if (!is) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
+  return from_hnswlib<T, IdxT>(res, is, params, labels);
+}
+
+}  // namespace raft::neighbors::cagra::detail
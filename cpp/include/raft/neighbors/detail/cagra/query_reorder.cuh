@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/cluster/kmeans_balanced.cuh>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/matrix/gather.cuh>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/sample_filter_types.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace raft::neighbors::cagra::detail {
+
+/** The number of dataset rows sampled to sort the queries when the index has no entry points. */
+constexpr int64_t kQueryReorderCenters = 64;
+
+/** Whether the sample filter gives the same answer for all queries, i.e. they can be reordered. */
+template <class CagraSampleFilterT>
+struct is_query_independent_filter
+  : std::bool_constant<
+      std::is_same_v<CagraSampleFilterT, raft::neighbors::filtering::none_cagra_sample_filter> ||
+      std::is_same_v<CagraSampleFilterT, raft::neighbors::filtering::removed_cagra_sample_filter>> {
+};
+
+/**
+ * A float copy of the center rows of the dataset: the entry points if any, every `step`-th row
+ * otherwise.
+ */
+template <typename T, typename IdxT>
+struct center_rows_op {
+  const T* data;
+  int64_t ld;
+  uint32_t dim;
+  const IdxT* entry_points;
+  int64_t step;
+
+  HDI auto operator()(int64_t i) const -> float
+  {
+    const int64_t c   = i / dim;
+    const int64_t row = entry_points != nullptr ? int64_t(entry_points[c]) : c * step;
+    return spatial::knn::detail::utils::mapping<float>{}(data[row * ld + i % dim]);
+  }
+};
+
+/** Write the results of the sorted queries back to the rows of the input queries. */
+template <typename IdxT, typename DistanceT>
+struct unsort_results_op {
+  const uint32_t* order;
+  const IdxT* sorted_neighbors;
+  const DistanceT* sorted_distances;
+  uint32_t k;
+  IdxT* neighbors;
+  DistanceT* distances;
+
+  HDI void operator()(int64_t i) const
+  {
+    const int64_t out = int64_t(order[i / k]) * k + i % k;
+    neighbors[out]    = sorted_neighbors[i];
+    distances[out]    = sorted_distances[i];
+  }
+};
+
+/**
+ * The order of the queries sorted by their nearest center, `order[sorted_pos] = query`.
+ *
+ * The centers are the entry points of the index, or a sample of its rows if it has none. They are
+ * compared to the queries with the L2 distance whatever the metric of the index: the order is only
+ * meant to group the queries that traverse the same regions of the graph.
+ */
+template <typename T, typename IdxT>
+auto sort_queries_by_center(raft::resources const& res,
+                            const index<T, IdxT>& idx,
+                            raft::device_matrix_view<const T, int64_t, row_major> queries)
+  -> rmm::device_uvector<uint32_t>
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::sort_queries_by_center(%zu)", static_cast<size_t>(queries.extent(0)));
+  auto stream             = resource::get_cuda_stream(res);
+  auto policy             = resource::get_thrust_policy(res);
+  const int64_t n_queries = queries.extent(0);
+  const uint32_t dim      = idx.dim();
+  const int64_t n_rows    = idx.dataset().extent(0);
+
+  const IdxT* entry_points = idx.entry_points().data_handle();
+  int64_t n_centers        = idx.entry_points().extent(0);
+  if (n_centers == 0) {
+    entry_points = nullptr;
+    n_centers    = std::min<int64_t>(kQueryReorderCenters, n_rows);
+  }
+  auto centers = raft::make_device_matrix<float, int64_t>(res, n_centers, dim);
+  raft::linalg::map_offset(
+    res,
+    raft::make_device_vector_view<float, int64_t>(centers.data_handle(), centers.size()),
+    center_rows_op<T, IdxT>{idx.dataset().data_handle(),
+                            idx.dataset().stride(0),
+                            dim,
+                            entry_points,
+                            n_rows / n_centers});
+
+  rmm::device_uvector<uint32_t> labels(n_queries, stream, resource::get_workspace_resource(res));
+  raft::cluster::kmeans_balanced_params kmeans_params;
+  kmeans_params.metric = distance::DistanceType::L2Expanded;
+  raft::cluster::kmeans_balanced::predict(
+    res,
+    kmeans_params,
+    queries,
+    raft::make_const_mdspan(centers.view()),
+    raft::make_device_vector_view<uint32_t, int64_t>(labels.data(), n_queries),
+    spatial::knn::detail::utils::mapping<float>{});
+
+  rmm::device_uvector<uint32_t> order(n_queries, stream);
+  thrust::sequence(policy, order.data(), order.data() + n_queries);
+  thrust::stable_sort_by_key(policy, labels.data(), labels.data() + n_queries, order.data());
+  return order;
+}
+
+}  // namespace raft::neighbors::cagra::detail
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "cagra_search.cuh"
+
+#include "../range_search_common.cuh"
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/matrix/gather.cuh>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/sample_filter_types.hpp>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace raft::neighbors::cagra::detail {
+
+/**
+ * Search the neighbors of the queries within the radius into a CSR matrix.
+ *
+ * The search kernels are unchanged: the queries are searched for `k = params.initial_k` neighbors
+ * first, and the queries whose `k` results are all within the radius (i.e. the worst candidate of
+ * the search has not yet left the radius) are searched again for twice as many, up to
+ * `params.max_k`. The neighborhoods are counted first, scanned into the row offsets of the CSR
+ * matrix, and then filled in from the results of the rounds.
+ */
+template <typename T, typename internal_IdxT, typename IdxT>
+void range_search(raft::resources const& res,
+                  const range_search_params& params,
+                  const index<T, IdxT>& idx,
+                  raft::device_matrix_view<const T, int64_t, row_major> queries,
+                  float radius,
+                  raft::device_csr_matrix<float, int64_t, IdxT, int64_t>& result)
+{
+  const int64_t n_queries = queries.extent(0);
+  const int64_t dim       = queries.extent(1);
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::range_search(%zu queries, radius = %f)", static_cast<size_t>(n_queries), radius);
+  RAFT_EXPECTS(dim == idx.dim(),
+               "Number of query dimensions should equal number of dimensions in the index.");
+  RAFT_EXPECTS(params.initial_k > 0 && params.initial_k <= params.max_k,
+               "range_search_params: initial_k must be in [1, max_k]");
+  RAFT_EXPECTS(static_cast<uint64_t>(result.structure_view().get_n_cols()) == idx.size(),
+               "The range search result must be of the shape [n_queries, index size]");
+
+  const uint32_t max_k  = std::min<uint64_t>(params.max_k, idx.size());
+  const bool similarity = idx.metric() == distance::DistanceType::InnerProduct;
+
+  auto run_search = [&](const search_params& round_params,
+                        raft::device_matrix_view<const T, int64_t, row_major> round_queries,
+                        raft::device_matrix_view<internal_IdxT, int64_t, row_major> neighbors,
+                        raft::device_matrix_view<float, int64_t, row_major> distances) {
+    if (idx.n_removed() > 0) {
+      search_main<T, internal_IdxT, raft::neighbors::filtering::removed_cagra_sample_filter, IdxT>(
+        res, round_params, idx, round_queries, neighbors, distances, idx.removed_filter());
+    } else {
+      search_main<T, internal_IdxT, raft::neighbors::filtering::none_cagra_sample_filter, IdxT>(
+        res,
+        round_params,
+        idx,
+        round_queries,
+        neighbors,
+        distances,
+        raft::neighbors::filtering::none_cagra_sample_filter());
+    }
+  };
+
+  auto search_round = [&](const int64_t* ids,
+                          int64_t n_pending,
+                          uint32_t k,
+                          raft::device_matrix_view<internal_IdxT, int64_t, row_major> neighbors,
+                          raft::device_matrix_view<float, int64_t, row_major> distances) {
+    search_params round_params = params;
+    round_params.itopk_size    = std::max<size_t>(params.itopk_size, k);
+    if (ids == nullptr) {
+      run_search(round_params, queries, neighbors, distances);
+    } else {
+      auto round_queries = raft::make_device_matrix<T, int64_t>(res, n_pending, dim);
+      raft::matrix::gather(res,
+                           queries,
+                           raft::make_device_vector_view<const int64_t, int64_t>(ids, n_pending),
+                           round_queries.view());
+      run_search(round_params, raft::make_const_mdspan(round_queries.view()), neighbors, distances);
+    }
+  };
+
+  raft::neighbors::detail::range_search_rounds<internal_IdxT>(
+    res,
+    n_queries,
+    std::min(params.initial_k, max_k),
+    max_k,
+    radius,
+    similarity,
+    static_cast<internal_IdxT>(idx.size()),
+    search_round,
+    result);
+}
+
+}  // namespace raft::neighbors::cagra::detail
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "../../cagra_types.hpp"
+#include "dataset_norms.cuh"
+#include "entry_points.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/neighbors/sample_filter_types.hpp>
+#include <raft/util/cuda_rt_essentials.hpp>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <thrust/copy.h>
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/scan.h>
+#include <thrust/sequence.h>
+#include <thrust/transform_scan.h>
+
+#include <algorithm>
+
+namespace raft::neighbors::cagra::detail {
+
+/** Clear the alive bit of every removed node, counting the nodes that were still alive. */
+template <class IdxT>
+struct remove_node_op {
+  uint32_t* alive_bits;
+  uint64_t n_rows;
+  unsigned long long* counters;  // [newly removed, out of range]
+
+  _RAFT_DEVICE void operator()(IdxT id) const
+  {
+    const auto i = static_cast<uint64_t>(id);
+    if (i >= n_rows) {
+      atomicAdd(counters + 1, 1ull);
+      return;
+    }
+    const uint32_t mask = 1u << (i % 32);
+    const uint32_t old  = atomicAnd(alive_bits + i / 32, ~mask);
+    if (old & mask) { atomicAdd(counters, 1ull); }
+  }
+};
+
+struct alive_flag_op {
+  raft::neighbors::filtering::removed_cagra_sample_filter alive;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> int64_t { return alive(0, i) ? 1 : 0; }
+};
+
+struct alive_test_op {
+  raft::neighbors::filtering::removed_cagra_sample_filter alive;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> bool { return alive(0, i); }
+};
+
+/** Copy the full (padded) rows `ids` of a strided dataset. */
+template <class T, class IdxT>
+struct gather_padded_rows_op {
+  const T* src;
+  int64_t ld;
+  const IdxT* ids;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> T
+  {
+    const int64_t row = i / ld;
+    const int64_t col = i - row * ld;
+    return src[static_cast<int64_t>(ids[row]) * ld + col];
+  }
+};
+
+/**
+ * Build the neighbor list of every remaining node (one thread per node).
+ *
+ * The remaining neighbors keep their rank order. The slots of the removed neighbors are refilled
+ * with the neighbors of these removed nodes (2-hop edges through them), so that paths that went
+ * through a removed node stay available to the search.
+ */
+template <class IdxT>
+RAFT_KERNEL kern_repair_graph(const IdxT* const graph,  // [old_size, graph_degree]
+                              const uint32_t graph_degree,
+                              const raft::neighbors::filtering::removed_cagra_sample_filter alive,
+                              const IdxT* const new_ids,  // [old_size]
+                              const IdxT* const old_ids,  // [new_size]
+                              const uint64_t new_size,
+                              IdxT* const new_graph)  // [new_size, graph_degree]
+{
+  const uint64_t tid  = threadIdx.x + static_cast<uint64_t>(blockDim.x) * blockIdx.x;
+  const uint64_t tnum = static_cast<uint64_t>(blockDim.x) * gridDim.x;
+  for (uint64_t row = tid; row < new_size; row += tnum) {
+    const IdxT old_row   = old_ids[row];
+    const IdxT* const in = graph + static_cast<uint64_t>(old_row) * graph_degree;
+    IdxT* const out      = new_graph + row * graph_degree;
+
+    uint32_t n = 0;
+    for (uint32_t j = 0; j < graph_degree; j++) {
+      if (alive(0, in[j])) { out[n++] = new_ids[in[j]]; }
+    }
+    for (uint32_t j = 0; j < graph_degree && n < graph_degree; j++) {
+      if (alive(0, in[j])) { continue; }
+      const IdxT* const in2 = graph + static_cast<uint64_t>(in[j]) * graph_degree;
+      for (uint32_t l = 0; l < graph_degree && n < graph_degree; l++) {
+        const IdxT w = in2[l];
+        if (w == old_row || !alive(0, w)) { continue; }
+        const IdxT new_w = new_ids[w];
+        bool duplicate   = false;
+        for (uint32_t m = 0; m < n && !duplicate; m++) {
+          duplicate = out[m] == new_w;
+        }
+        if (!duplicate) { out[n++] = new_w; }
+      }
+    }
+    // Only when the whole 2-hop neighborhood is gone: repeat the neighbors that are left.
+    for (uint32_t j = n; j < graph_degree; j++) {
+      out[j] = n > 0 ? out[j % n] : static_cast<IdxT>(row);
+    }
+  }
+}
+
+template <typename T, typename IdxT>
+void remove(raft::resources const& res,
+            index<T, IdxT>& idx,
+            raft::device_vector_view<const IdxT, int64_t> ids)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::remove(%zu)", static_cast<size_t>(ids.extent(0)));
+  if (ids.extent(0) == 0) { return; }
+  RAFT_EXPECTS(idx.size() > 0, "Cannot remove nodes from an empty index");
+  RAFT_EXPECTS(idx.source_indices().extent(0) == 0, "Cannot remove nodes from a reordered index");
+
+  auto stream     = resource::get_cuda_stream(res);
+  auto alive_bits = idx.alive_bits(res);
+  auto counters   = raft::make_device_vector<unsigned long long, int64_t>(res, 2);
+  RAFT_CUDA_TRY(
+    cudaMemsetAsync(counters.data_handle(), 0, sizeof(unsigned long long) * 2, stream));
+  thrust::for_each(
+    resource::get_thrust_policy(res),
+    ids.data_handle(),
+    ids.data_handle() + ids.extent(0),
+    remove_node_op<IdxT>{alive_bits.data_handle(), uint64_t(idx.size()), counters.data_handle()});
+
+  unsigned long long host_counters[2];
+  raft::copy(host_counters, counters.data_handle(), 2, stream);
+  resource::sync_stream(res);
+  idx.update_n_removed(res, idx.n_removed() + static_cast<int64_t>(host_counters[0]));
+  RAFT_EXPECTS(host_counters[1] == 0,
+               "%llu of the ids to remove are not in the index",
+               host_counters[1]);
+}
+
+template <typename T, typename IdxT>
+auto compact(raft::resources const& res, index<T, IdxT>& idx) -> raft::device_vector<IdxT, int64_t>
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "cagra::compact(%zu removed)", static_cast<size_t>(idx.n_removed()));
+  auto stream          = resource::get_cuda_stream(res);
+  auto policy          = resource::get_thrust_policy(res);
+  const int64_t n_rows = idx.size();
+
+  if (idx.n_removed() == 0) {
+    auto old_ids = raft::make_device_vector<IdxT, int64_t>(res, n_rows);
+    thrust::sequence(policy, old_ids.data_handle(), old_ids.data_handle() + n_rows);
+    return old_ids;
+  }
+  RAFT_EXPECTS(idx.graph_bits() == 0,
+               "A compressed graph cannot be compacted; call decompress_graph first");
+  RAFT_EXPECTS(idx.dataset().extent(0) == n_rows,
+               "The dataset must be attached to the index to compact it");
+  const int64_t new_size = n_rows - idx.n_removed();
+  RAFT_EXPECTS(new_size > 0, "Cannot compact an index where all the nodes are removed");
+  const uint32_t degree = idx.graph_degree();
+  const auto alive      = idx.removed_filter();
+
+  // The new id of every remaining node is its rank among the remaining nodes.
+  auto new_ids = raft::make_device_vector<IdxT, int64_t>(res, n_rows);
+  thrust::transform_exclusive_scan(policy,
+                                   thrust::make_counting_iterator<int64_t>(0),
+                                   thrust::make_counting_iterator<int64_t>(n_rows),
+                                   new_ids.data_handle(),
+                                   alive_flag_op{alive},
+                                   IdxT(0),
+                                   thrust::plus<IdxT>());
+  auto old_ids = raft::make_device_vector<IdxT, int64_t>(res, new_size);
+  thrust::copy_if(policy,
+                  thrust::make_counting_iterator<int64_t>(0),
+                  thrust::make_counting_iterator<int64_t>(n_rows),
+                  old_ids.data_handle(),
+                  alive_test_op{alive});
+
+  auto new_graph = raft::make_device_matrix<IdxT, int64_t>(res, new_size, degree);
+  constexpr uint32_t kBlockSize = 256;
+  const uint32_t n_blocks =
+    std::min<int64_t>(raft::div_rounding_up_safe<int64_t>(new_size, kBlockSize), 65535);
+  kern_repair_graph<<<n_blocks, kBlockSize, 0, stream>>>(idx.graph().data_handle(),
+                                                         degree,
+                                                         alive,
+                                                         new_ids.data_handle(),
+                                                         old_ids.data_handle(),
+                                                         uint64_t(new_size),
+                                                         new_graph.data_handle());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+  const int64_t ld = idx.dataset().stride(0);
+  auto new_dataset = raft::make_device_matrix<T, int64_t>(res, new_size, ld);
+  raft::linalg::map_offset(
+    res,
+    new_dataset.view(),
+    gather_padded_rows_op<T, IdxT>{idx.dataset().data_handle(), ld, old_ids.data_handle()});
+
+  RAFT_LOG_DEBUG("Compacted CAGRA index from %zu to %zu nodes",
+                 static_cast<size_t>(n_rows),
+                 static_cast<size_t>(new_size));
+  // The alive bits are still read by the kernels above: release them once they are done.
+  resource::sync_stream(res);
+  idx.update_dataset(res, std::move(new_dataset), idx.dim());
+  if (idx.metric() == raft::distance::DistanceType::CosineExpanded) {
+    idx.update_dataset_norms(res, make_dataset_norms(res, idx));
+  }
+  idx.update_graph(res, std::move(new_graph));
+  idx.update_n_removed(res, 0);
+  // the entry points may have been removed, and the others are renumbered
+  if (idx.entry_points().extent(0) > 0) {
+    const uint32_t n_entry_points = std::min<int64_t>(idx.entry_points().extent(0), new_size);
+    idx.update_entry_points(res, make_entry_points(res, idx, n_entry_points));
+  }
+  return old_ids;
+}
+
+}  // namespace raft::neighbors::cagra::detail
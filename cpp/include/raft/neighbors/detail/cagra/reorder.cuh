@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_device_accessor.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/matrix/gather.cuh>
+#include <raft/neighbors/cagra_types.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace raft::neighbors::cagra::detail {
+
+/**
+ * The breadth-first order of the nodes of a graph: `order[new_id] = old_id`.
+ *
+ * The traversal starts at node 0 and visits the neighbors of every node in the order of its
+ * neighbor list (i.e. by rank, the closest first); the nodes unreachable from the visited ones
+ * start a new traversal in the input order. Since all nodes have the same degree, this is also the
+ * Cuthill-McKee order of the graph.
+ */
+template <typename IdxT>
+auto make_bfs_order(raft::host_matrix_view<const IdxT, int64_t, row_major> graph)
+  -> std::vector<IdxT>
+{
+  const int64_t n_rows = graph.extent(0);
+  const int64_t degree = graph.extent(1);
+  std::vector<IdxT> order;
+  order.reserve(n_rows);
+  std::vector<bool> visited(n_rows, false);
+  int64_t head = 0;
+  for (int64_t root = 0; root < n_rows; root++) {
+    if (visited[root]) { continue; }
+    visited[root] = true;
+    order.push_back(static_cast<IdxT>(root));
+    for (; head < static_cast<int64_t>(order.size()); head++) {
+      const IdxT* neighbors = graph.data_handle() + static_cast<int64_t>(order[head]) * degree;
+      for (int64_t j = 0; j < degree; j++) {
+        const auto v = static_cast<int64_t>(neighbors[j]);
+        if (v < 0 || v >= n_rows || visited[v]) { continue; }
+        visited[v] = true;
+        order.push_back(neighbors[j]);
+      }
+    }
+  }
+  return order;
+}
+
+/**
+ * Renumber the nodes of a graph in place: the node `order[i]` becomes the node `i`, both as a row
+ * and as a neighbor.
+ */
+template <typename IdxT>
+void reorder_graph(raft::host_matrix_view<IdxT, int64_t, row_major> graph,
+                   const std::vector<IdxT>& order)
+{
+  const int64_t n_rows = graph.extent(0);
+  const int64_t degree = graph.extent(1);
+  std::vector<IdxT> new_ids(n_rows);
+  for (int64_t i = 0; i < n_rows; i++) {
+    new_ids[order[i]] = static_cast<IdxT>(i);
+  }
+  auto reordered = raft::make_host_matrix<IdxT, int64_t>(n_rows, degree);
+#pragma omp parallel for
+  for (int64_t i = 0; i < n_rows; i++) {
+    const IdxT* src = graph.data_handle() + static_cast<int64_t>(order[i]) * degree;
+    IdxT* dst       = reordered.data_handle() + i * degree;
+    for (int64_t j = 0; j < degree; j++) {
+      const auto v = static_cast<int64_t>(src[j]);
+      dst[j]       = v >= 0 && v < n_rows ? new_ids[v] : src[j];
+    }
+  }
+  std::copy(
+    reordered.data_handle(), reordered.data_handle() + reordered.size(), graph.data_handle());
+}
+
+/**
+ * Attach the rows `order` of the dataset to the index, as a device copy owned by the index, and
+ * store `order` as its source indices.
+ */
+template <typename T, typename IdxT, typename Accessor>
+void attach_reordered_dataset(
+  raft::resources const& res,
+  index<T, IdxT>& idx,
+  mdspan<const T, matrix_extent<int64_t>, row_major, Accessor> dataset,
+  const std::vector<IdxT>& order)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope("cagra::reorder_dataset");
+  const int64_t n_rows = dataset.extent(0);
+  const int64_t dim    = dataset.extent(1);
+  auto stream          = resource::get_cuda_stream(res);
+
+  auto source_indices = raft::make_device_vector<IdxT, int64_t>(res, n_rows);
+  raft::copy(source_indices.data_handle(), order.data(), n_rows, stream);
+
+  if constexpr (Accessor::is_device_accessible) {
+    auto reordered = raft::make_device_matrix<T, int64_t>(res, n_rows, dim);
+    raft::matrix::gather(
+      res,
+      raft::make_device_matrix_view<const T, int64_t>(dataset.data_handle(), n_rows, dim),
+      raft::make_const_mdspan(source_indices.view()),
+      reordered.view());
+    if (dim * sizeof(T) % 16 == 0) {
+      idx.update_dataset(res, std::move(reordered), dim);
+    } else {
+      // a padded copy is made by the index
+      idx.update_dataset(res, raft::make_const_mdspan(reordered.view()));
+      resource::sync_stream(res);
+    }
+  } else {
+    auto reordered = raft::make_host_matrix<T, int64_t>(n_rows, dim);
+#pragma omp parallel for
+    for (int64_t i = 0; i < n_rows; i++) {
+      const T* src = dataset.data_handle() + static_cast<int64_t>(order[i]) * dim;
+      std::copy(src, src + dim, reordered.data_handle() + i * dim);
+    }
+    idx.update_dataset(res, raft::make_const_mdspan(reordered.view()));
+    resource::sync_stream(res);
+  }
+  idx.update_source_indices(res, std::move(source_indices));
+}
+
+/** The dataset row of a search result; the missing results (not smaller than `size`) are kept. */
+template <typename IdxT>
+struct source_index_op {
+  const IdxT* source_indices;
+  IdxT size;
+
+  HDI auto operator()(IdxT i) const -> IdxT { return i < size ? source_indices[i] : i; }
+};
+
+/** A sample filter of the dataset rows, applied to the nodes of a reordered index. */
+template <typename IdxT, typename CagraSampleFilterT>
+struct source_index_sample_filter {
+  const IdxT* source_indices;
+  CagraSampleFilterT filter;
+
+  inline _RAFT_HOST_DEVICE bool operator()(const uint32_t query_ix, const uint32_t sample_ix)
+  {
+    return filter(query_ix, static_cast<uint32_t>(source_indices[sample_ix]));
+  }
+};
+
+}  // namespace raft::neighbors::cagra::detail
@@ -24,7 +24,9 @@
 #include <numeric>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
 #include <raft/core/resource/device_properties.hpp>
+#include <raft/core/resource/phase_timer.hpp>
 #include <raft/core/resources.hpp>
 
 #include <vector>
@@ -84,6 +86,7 @@ struct search : public search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILT
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::num_executed_iterations;
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::dev_seed;
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::num_seeds;
+  using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::metric;
 
   uint32_t num_cta_per_query;
   rmm::device_uvector<INDEX_T> intermediate_indices;
@@ -98,9 +101,11 @@ struct search : public search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILT
          uint32_t topk)
     : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>(
         res, params, dim, graph_degree, topk),
-      intermediate_indices(0, resource::get_cuda_stream(res)),
-      intermediate_distances(0, resource::get_cuda_stream(res)),
-      topk_workspace(0, resource::get_cuda_stream(res))
+      intermediate_indices(
+        0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      intermediate_distances(
+        0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      topk_workspace(0, resource::get_cuda_stream(res), resource::get_workspace_resource(res))
 
   {
     set_params(res, params);
@@ -195,6 +200,7 @@ struct search : public search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILT
   void operator()(raft::resources const& res,
                   raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
                   raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+                  uint32_t graph_bits,
                   INDEX_T* const topk_indices_ptr,       // [num_queries, topk]
                   DISTANCE_T* const topk_distances_ptr,  // [num_queries, topk]
                   const DATA_T* const queries_ptr,       // [num_queries, dataset_dim]
@@ -206,34 +212,40 @@ struct search : public search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILT
   {
     cudaStream_t stream = resource::get_cuda_stream(res);
 
-    select_and_run<TEAM_SIZE, DATASET_BLOCK_DIM, DATA_T, INDEX_T, DISTANCE_T>(
-      dataset,
-      graph,
-      intermediate_indices.data(),
-      intermediate_distances.data(),
-      queries_ptr,
-      num_queries,
-      dev_seed_ptr,
-      num_executed_iterations,
-      topk,
-      thread_block_size,
-      result_buffer_size,
-      smem_size,
-      hash_bitlen,
-      hashmap.data(),
-      num_cta_per_query,
-      num_random_samplings,
-      rand_xor_mask,
-      num_seeds,
-      itopk_size,
-      search_width,
-      min_iterations,
-      max_iterations,
-      sample_filter,
-      stream);
-    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    {
+      resource::scoped_phase phase(res, "cagra::traversal");
+      select_and_run<TEAM_SIZE, DATASET_BLOCK_DIM, DATA_T, INDEX_T, DISTANCE_T>(
+        dataset,
+        graph,
+        graph_bits,
+        metric,
+        intermediate_indices.data(),
+        intermediate_distances.data(),
+        queries_ptr,
+        num_queries,
+        dev_seed_ptr,
+        num_executed_iterations,
+        topk,
+        thread_block_size,
+        result_buffer_size,
+        smem_size,
+        hash_bitlen,
+        hashmap.data(),
+        num_cta_per_query,
+        num_random_samplings,
+        rand_xor_mask,
+        num_seeds,
+        itopk_size,
+        search_width,
+        min_iterations,
+        max_iterations,
+        sample_filter,
+        stream);
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    }
 
     // Select the top-k results from the intermediate results
+    resource::scoped_phase phase(res, "cagra::topk");
     const uint32_t num_intermediate_results = num_cta_per_query * itopk_size;
     _cuann_find_topk(topk,
                      num_queries,
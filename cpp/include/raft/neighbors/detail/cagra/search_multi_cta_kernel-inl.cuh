@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -142,6 +142,8 @@ __launch_bounds__(1024, 1) RAFT_KERNEL search_kernel(
   const DATA_T* const queries_ptr,  // [num_queries, dataset_dim]
   const INDEX_T* const knn_graph,   // [dataset_size, graph_degree]
   const uint32_t graph_degree,
+  const uint32_t graph_bits,
+  const search_metric metric,
   const unsigned num_distilation,
   const uint64_t rand_xor_mask,
   const INDEX_T* seed_ptr,  // [num_queries, num_seeds]
@@ -240,6 +242,7 @@ __launch_bounds__(1024, 1) RAFT_KERNEL search_kernel(
     num_seeds,
     local_visited_hashmap_ptr,
     hash_bitlen,
+    metric,
     block_id,
     num_blocks);
   __syncthreads();
@@ -282,11 +285,13 @@ __launch_bounds__(1024, 1) RAFT_KERNEL search_kernel(
       dataset_ld,
       knn_graph,
       graph_degree,
+      graph_bits,
       local_visited_hashmap_ptr,
       hash_bitlen,
       parent_indices_buffer,
       result_indices_buffer,
-      search_width);
+      search_width,
+      metric);
     _CLK_REC(clk_compute_distance);
     __syncthreads();
 
@@ -461,6 +466,8 @@ template <unsigned TEAM_SIZE,
 void select_and_run(  // raft::resources const& res,
   raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
   raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+  uint32_t graph_bits,
+  search_metric metric,
   INDEX_T* const topk_indices_ptr,       // [num_queries, topk]
   DISTANCE_T* const topk_distances_ptr,  // [num_queries, topk]
   const DATA_T* const queries_ptr,       // [num_queries, dataset_dim]
@@ -493,8 +500,7 @@ void select_and_run(  // raft::resources const& res,
                          DISTANCE_T,
                          SAMPLE_FILTER_T>::choose_buffer_size(result_buffer_size, block_size);
 
-  RAFT_CUDA_TRY(
-    cudaFuncSetAttribute(kernel, cudaFuncAttributeMaxDynamicSharedMemorySize, smem_size));
+  RAFT_CUDA_TRY(raise_max_dynamic_smem(kernel, smem_size));
   // Initialize hash table
   const uint32_t hash_size = hashmap::get_size(hash_bitlen);
   set_value_batch(
@@ -516,6 +522,8 @@ void select_and_run(  // raft::resources const& res,
                                                        queries_ptr,
                                                        graph.data_handle(),
                                                        graph.extent(1),
+                                                       graph_bits,
+                                                       metric,
                                                        num_random_samplings,
                                                        rand_xor_mask,
                                                        dev_seed_ptr,
@@ -23,7 +23,10 @@
 #include <memory>
 #include <numeric>
 #include <raft/core/device_mdspan.hpp>
+#include <raft/core/resource/cuda_graph.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/phase_timer.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/neighbors/sample_filter_types.hpp>
 #include <rmm/device_scalar.hpp>
@@ -34,6 +37,7 @@
 #include "device_common.hpp"
 #include "hashmap.hpp"
 #include "search_plan.cuh"
+#include "topk_merge.cuh"
 #include "topk_for_cagra/topk_core.cuh"  //todo replace with raft kernel
 #include "utils.hpp"
 #include <raft/core/logger.hpp>
@@ -103,7 +107,8 @@ RAFT_KERNEL random_pickup_kernel(const DATA_T* const dataset_ptr,  // [dataset_s
                                  DISTANCE_T* const result_distances_ptr,  // [num_queries, ldr]
                                  const std::uint32_t ldr,                 // (*) ldr >= num_pickup
                                  INDEX_T* const visited_hashmap_ptr,  // [num_queries, 1 << bitlen]
-                                 const std::uint32_t hash_bitlen)
+                                 const std::uint32_t hash_bitlen,
+                                 const search_metric metric)
 {
   const auto ldb               = hashmap::get_size(hash_bitlen);
   const auto global_team_index = (blockIdx.x * blockDim.x + threadIdx.x) / TEAM_SIZE;
@@ -124,7 +129,7 @@ RAFT_KERNEL random_pickup_kernel(const DATA_T* const dataset_ptr,  // [dataset_s
   }
   __syncthreads();
   device::distance_op<DATA_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, false> dist_op(
-    query_buffer);
+    query_buffer, metric);
 
   INDEX_T best_index_team_local;
   DISTANCE_T best_norm2_team_local = utils::get_max_value<DISTANCE_T>();
@@ -137,7 +142,7 @@ RAFT_KERNEL random_pickup_kernel(const DATA_T* const dataset_ptr,  // [dataset_s
       seed_index = device::xorshift64((global_team_index ^ rand_xor_mask) * (i + 1)) % dataset_size;
     }
 
-    const auto norm2 = dist_op(dataset_ptr + (dataset_ld * seed_index), dataset_dim, true);
+    const auto norm2 = dist_op(dataset_ptr, dataset_ld, seed_index, dataset_dim, true);
 
     if (norm2 < best_norm2_team_local) {
       best_norm2_team_local = norm2;
@@ -180,6 +185,7 @@ void random_pickup(const DATA_T* const dataset_ptr,  // [dataset_size, dataset_d
                    const std::size_t ldr,                   // (*) ldr >= num_pickup
                    INDEX_T* const visited_hashmap_ptr,      // [num_queries, 1 << bitlen]
                    const std::uint32_t hash_bitlen,
+                   const search_metric metric,
                    cudaStream_t const cuda_stream = 0)
 {
   const auto block_size                = 256u;
@@ -206,7 +212,8 @@ void random_pickup(const DATA_T* const dataset_ptr,  // [dataset_size, dataset_d
                                                         result_distances_ptr,
                                                         ldr,
                                                         visited_hashmap_ptr,
-                                                        hash_bitlen);
+                                                        hash_bitlen,
+                                                        metric);
 }
 
 template <class INDEX_T>
@@ -327,6 +334,8 @@ RAFT_KERNEL compute_distance_to_child_nodes_kernel(
   const std::uint32_t dataset_ld,
   const INDEX_T* const neighbor_graph_ptr,  // [dataset_size, graph_degree]
   const std::uint32_t graph_degree,
+  const std::uint32_t graph_bits,
+  const search_metric metric,
   const DATA_T* query_ptr,             // [num_queries, data_dim]
   INDEX_T* const visited_hashmap_ptr,  // [num_queries, 1 << hash_bitlen]
   const std::uint32_t hash_bitlen,
@@ -356,7 +365,7 @@ RAFT_KERNEL compute_distance_to_child_nodes_kernel(
   if (global_team_id >= search_width * graph_degree) { return; }
 
   device::distance_op<DATA_T, DATA_T, DISTANCE_T, DATASET_BLOCK_DIM, TEAM_SIZE, false> dist_op(
-    query_buffer);
+    query_buffer, metric);
 
   const std::size_t parent_list_index =
     parent_node_list[global_team_id / graph_degree + (search_width * blockIdx.y)];
@@ -372,15 +381,14 @@ RAFT_KERNEL compute_distance_to_child_nodes_kernel(
   }
   const auto parent_index = raw_parent_index & ~index_msb_1_mask;
 
-  const auto neighbor_list_head_ptr = neighbor_graph_ptr + (graph_degree * parent_index);
-
-  const std::size_t child_id = neighbor_list_head_ptr[global_team_id % graph_degree];
+  const std::size_t child_id = device::load_graph_edge(
+    neighbor_graph_ptr, graph_degree, graph_bits, parent_index, global_team_id % graph_degree);
 
   const auto compute_distance_flag = hashmap::insert<TEAM_SIZE, INDEX_T>(
     visited_hashmap_ptr + (ldb * blockIdx.y), hash_bitlen, child_id);
 
   const auto norm2 =
-    dist_op(dataset_ptr + (dataset_ld * child_id), dataset_dim, compute_distance_flag);
+    dist_op(dataset_ptr, dataset_ld, child_id, dataset_dim, compute_distance_flag);
 
   if (compute_distance_flag) {
     if (threadIdx.x % TEAM_SIZE == 0) {
@@ -421,6 +429,8 @@ void compute_distance_to_child_nodes(
   const std::uint32_t dataset_ld,
   const INDEX_T* const neighbor_graph_ptr,  // [dataset_size, graph_degree]
   const std::uint32_t graph_degree,
+  const std::uint32_t graph_bits,
+  const search_metric metric,
   const DATA_T* query_ptr,  // [num_queries, data_dim]
   const std::uint32_t num_queries,
   INDEX_T* const visited_hashmap_ptr,  // [num_queries, 1 << hash_bitlen]
@@ -453,6 +463,8 @@ void compute_distance_to_child_nodes(
                                                         dataset_ld,
                                                         neighbor_graph_ptr,
                                                         graph_degree,
+                                                        graph_bits,
+                                                        metric,
                                                         query_ptr,
                                                         visited_hashmap_ptr,
                                                         hash_bitlen,
@@ -597,6 +609,89 @@ void set_value_batch(T* const dev_ptr,
     <<<grid_size, block_size, 0, cuda_stream>>>(dev_ptr, ld, val, count, batch_size);
 }
 
+// The largest shared memory of `merge_itopk_kernel` (the default limit of a kernel)
+constexpr std::size_t merge_itopk_max_smem_size = 48 * 1024;
+
+template <class INDEX_T, class DISTANCE_T>
+constexpr auto merge_itopk_smem_size(std::uint32_t itopk_size, std::uint32_t num_children)
+  -> std::size_t
+{
+  return num_children * (sizeof(INDEX_T) + sizeof(DISTANCE_T)) + itopk_size * sizeof(DISTANCE_T);
+}
+
+// Update the sorted internal topk of the previous iteration by the children: the children are
+// sorted in shared memory and merged with the internal topk into the output (one block per query).
+template <class INDEX_T, class DISTANCE_T>
+RAFT_KERNEL merge_itopk_kernel(const INDEX_T* const itopk_indices_ptr,       // [num_queries, ld]
+                               const DISTANCE_T* const itopk_distances_ptr,  // [num_queries, ld]
+                               const INDEX_T* const child_indices_ptr,       // [num_queries, ld]
+                               const DISTANCE_T* const child_distances_ptr,  // [num_queries, ld]
+                               INDEX_T* const out_indices_ptr,               // [num_queries, ld]
+                               DISTANCE_T* const out_distances_ptr,          // [num_queries, ld]
+                               const std::size_t ld,
+                               const std::uint32_t itopk_size,
+                               const std::uint32_t num_children)
+{
+  extern __shared__ __align__(8) std::uint8_t merge_itopk_smem[];
+  auto child_indices   = reinterpret_cast<INDEX_T*>(merge_itopk_smem);
+  auto child_distances = reinterpret_cast<DISTANCE_T*>(child_indices + num_children);
+  auto itopk_distances = child_distances + num_children;
+
+  const std::size_t offset = ld * blockIdx.x;
+  for (std::uint32_t i = threadIdx.x; i < num_children; i += blockDim.x) {
+    child_indices[i]   = child_indices_ptr[offset + i];
+    child_distances[i] = child_distances_ptr[offset + i];
+  }
+  for (std::uint32_t i = threadIdx.x; i < itopk_size; i += blockDim.x) {
+    itopk_distances[i] = itopk_distances_ptr[offset + i];
+  }
+  __syncthreads();
+  topk_merge::block_bitonic_sort(child_distances, child_indices, num_children);
+
+  topk_merge::merge(
+    itopk_distances,
+    itopk_size,
+    child_distances,
+    num_children,
+    itopk_size,
+    [&](std::uint32_t i, std::uint32_t r) {
+      out_indices_ptr[offset + r]   = itopk_indices_ptr[offset + i];
+      out_distances_ptr[offset + r] = itopk_distances[i];
+    },
+    [&](std::uint32_t j, std::uint32_t r) {
+      out_indices_ptr[offset + r]   = child_indices[j];
+      out_distances_ptr[offset + r] = child_distances[j];
+    });
+}
+
+template <class INDEX_T, class DISTANCE_T>
+void merge_itopk(const INDEX_T* const itopk_indices_ptr,       // [num_queries, ld]
+                 const DISTANCE_T* const itopk_distances_ptr,  // [num_queries, ld]
+                 const INDEX_T* const child_indices_ptr,       // [num_queries, ld]
+                 const DISTANCE_T* const child_distances_ptr,  // [num_queries, ld]
+                 INDEX_T* const out_indices_ptr,               // [num_queries, ld]
+                 DISTANCE_T* const out_distances_ptr,          // [num_queries, ld]
+                 const std::size_t ld,
+                 const std::uint32_t itopk_size,
+                 const std::uint32_t num_children,
+                 const std::uint32_t num_queries,
+                 cudaStream_t cuda_stream)
+{
+  constexpr std::uint32_t block_size = 256;
+  const auto smem_size = merge_itopk_smem_size<INDEX_T, DISTANCE_T>(itopk_size, num_children);
+  assert(smem_size <= merge_itopk_max_smem_size);
+  merge_itopk_kernel<INDEX_T, DISTANCE_T>
+    <<<num_queries, block_size, smem_size, cuda_stream>>>(itopk_indices_ptr,
+                                                          itopk_distances_ptr,
+                                                          child_indices_ptr,
+                                                          child_distances_ptr,
+                                                          out_indices_ptr,
+                                                          out_distances_ptr,
+                                                          ld,
+                                                          itopk_size,
+                                                          num_children);
+}
+
 // result_buffer (work buffer) for "multi-kernel"
 // +--------------------+------------------------------+-------------------+
 // | internal_top_k (A) | neighbors of internal_top_k  | internal_topk (B) |
@@ -644,6 +739,7 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::num_executed_iterations;
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::dev_seed;
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::num_seeds;
+  using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::metric;
 
   size_t result_buffer_allocation_size;
   rmm::device_uvector<INDEX_T> result_indices;  // results_indices_buffer
@@ -660,12 +756,12 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
          uint32_t topk)
     : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>(
         res, params, dim, graph_degree, topk),
-      result_indices(0, resource::get_cuda_stream(res)),
-      result_distances(0, resource::get_cuda_stream(res)),
-      parent_node_list(0, resource::get_cuda_stream(res)),
-      topk_hint(0, resource::get_cuda_stream(res)),
-      topk_workspace(0, resource::get_cuda_stream(res)),
-      terminate_flag(resource::get_cuda_stream(res))
+      result_indices(0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      result_distances(0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      parent_node_list(0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      topk_hint(0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      topk_workspace(0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      terminate_flag(resource::get_cuda_stream(res), resource::get_workspace_resource(res))
   {
     set_params(res);
   }
@@ -698,6 +794,7 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
   void operator()(raft::resources const& res,
                   raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
                   raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+                  uint32_t graph_bits,
                   INDEX_T* const topk_indices_ptr,       // [num_queries, topk]
                   DISTANCE_T* const topk_distances_ptr,  // [num_queries, topk]
                   const DATA_T* const queries_ptr,       // [num_queries, dataset_dim]
@@ -709,6 +806,7 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
   {
     // Init hashmap
     cudaStream_t stream      = resource::get_cuda_stream(res);
+    const bool capturing     = resource::is_stream_capturing(res);
     const uint32_t hash_size = hashmap::get_size(hash_bitlen);
     set_value_batch(
       hashmap.data(), hash_size, utils::get_max_value<INDEX_T>(), hash_size, num_queries, stream);
@@ -723,100 +821,131 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
       set_value(top_hint_ptr, 0xffffffffu, num_queries, stream);
     }
 
-    // Choose initial entry point candidates at random
-    random_pickup<TEAM_SIZE, DATASET_BLOCK_DIM, DATA_T, DISTANCE_T, INDEX_T>(
-      dataset.data_handle(),
-      dataset.extent(1),
-      dataset.extent(0),
-      dataset.stride(0),
-      queries_ptr,
-      num_queries,
-      result_buffer_size,
-      num_random_samplings,
-      rand_xor_mask,
-      dev_seed_ptr,
-      num_seeds,
-      result_indices.data(),
-      result_distances.data(),
-      result_buffer_allocation_size,
-      hashmap.data(),
-      hash_bitlen,
-      stream);
-
     unsigned iter = 0;
-    while (1) {
-      // Make an index list of internal top-k nodes
-      _cuann_find_topk(itopk_size,
-                       num_queries,
-                       result_buffer_size,
-                       result_distances.data() + (iter & 0x1) * itopk_size,
-                       result_buffer_allocation_size,
-                       result_indices.data() + (iter & 0x1) * itopk_size,
-                       result_buffer_allocation_size,
-                       result_distances.data() + (1 - (iter & 0x1)) * result_buffer_size,
-                       result_buffer_allocation_size,
-                       result_indices.data() + (1 - (iter & 0x1)) * result_buffer_size,
-                       result_buffer_allocation_size,
-                       topk_workspace.data(),
-                       true,
-                       top_hint_ptr,
-                       stream);
-
-      // termination (1)
-      if ((iter + 1 == max_iterations)) {
-        iter++;
-        break;
-      }
-
-      if (iter + 1 >= min_iterations) { set_value<uint32_t>(terminate_flag.data(), 1, stream); }
-
-      // pickup parent nodes
-      uint32_t _small_hash_bitlen = 0;
-      if ((iter + 1) % small_hash_reset_interval == 0) { _small_hash_bitlen = small_hash_bitlen; }
-      pickup_next_parents(result_indices.data() + (1 - (iter & 0x1)) * result_buffer_size,
-                          result_buffer_allocation_size,
-                          itopk_size,
-                          num_queries,
-                          hashmap.data(),
-                          hash_bitlen,
-                          _small_hash_bitlen,
-                          parent_node_list.data(),
-                          search_width,
-                          search_width,
-                          terminate_flag.data(),
-                          stream);
-
-      // termination (2)
-      if (iter + 1 >= min_iterations && terminate_flag.value(stream)) {
-        iter++;
-        break;
-      }
-
-      // Compute distance to child nodes that are adjacent to the parent node
-      compute_distance_to_child_nodes<TEAM_SIZE, DATASET_BLOCK_DIM>(
-        parent_node_list.data(),
-        result_indices.data() + (1 - (iter & 0x1)) * result_buffer_size,
-        result_distances.data() + (1 - (iter & 0x1)) * result_buffer_size,
-        result_buffer_allocation_size,
-        search_width,
+    {
+      // the internal top-k of the iterations is a part of the traversal
+      resource::scoped_phase phase(res, "cagra::traversal");
+      // Choose initial entry point candidates at random
+      random_pickup<TEAM_SIZE, DATASET_BLOCK_DIM, DATA_T, DISTANCE_T, INDEX_T>(
         dataset.data_handle(),
         dataset.extent(1),
         dataset.extent(0),
         dataset.stride(0),
-        graph.data_handle(),
-        graph.extent(1),
         queries_ptr,
         num_queries,
+        result_buffer_size,
+        num_random_samplings,
+        rand_xor_mask,
+        dev_seed_ptr,
+        num_seeds,
+        result_indices.data(),
+        result_distances.data(),
+        result_buffer_allocation_size,
         hashmap.data(),
         hash_bitlen,
-        result_indices.data() + itopk_size,
-        result_distances.data() + itopk_size,
-        result_buffer_allocation_size,
-        sample_filter,
+        metric,
         stream);
 
-      iter++;
-    }  // while ( 1 )
+      // After the first iteration, the internal top-k of the previous iteration is sorted and is
+      // merged with the sorted children, unless a filter may have removed some of its nodes.
+      const uint32_t num_children = search_width * graph_degree;
+      constexpr bool no_filter =
+        std::is_same<SAMPLE_FILTER_T, raft::neighbors::filtering::none_cagra_sample_filter>::value;
+      const bool use_merge = no_filter && merge_itopk_smem_size<INDEX_T, DISTANCE_T>(
+                                            itopk_size, num_children) <= merge_itopk_max_smem_size;
+
+      while (1) {
+        // Make an index list of internal top-k nodes
+        if (use_merge && iter > 0) {
+          merge_itopk(result_indices.data() + (iter & 0x1) * result_buffer_size,
+                      result_distances.data() + (iter & 0x1) * result_buffer_size,
+                      result_indices.data() + itopk_size,
+                      result_distances.data() + itopk_size,
+                      result_indices.data() + (1 - (iter & 0x1)) * result_buffer_size,
+                      result_distances.data() + (1 - (iter & 0x1)) * result_buffer_size,
+                      result_buffer_allocation_size,
+                      itopk_size,
+                      num_children,
+                      num_queries,
+                      stream);
+        } else {
+          _cuann_find_topk(itopk_size,
+                           num_queries,
+                           result_buffer_size,
+                           result_distances.data() + (iter & 0x1) * itopk_size,
+                           result_buffer_allocation_size,
+                           result_indices.data() + (iter & 0x1) * itopk_size,
+                           result_buffer_allocation_size,
+                           result_distances.data() + (1 - (iter & 0x1)) * result_buffer_size,
+                           result_buffer_allocation_size,
+                           result_indices.data() + (1 - (iter & 0x1)) * result_buffer_size,
+                           result_buffer_allocation_size,
+                           topk_workspace.data(),
+                           true,
+                           top_hint_ptr,
+                           stream);
+        }
+
+        // termination (1)
+        if ((iter + 1 == max_iterations)) {
+          iter++;
+          break;
+        }
+
+        if (iter + 1 >= min_iterations) { set_value<uint32_t>(terminate_flag.data(), 1, stream); }
+
+        // pickup parent nodes
+        uint32_t _small_hash_bitlen = 0;
+        if ((iter + 1) % small_hash_reset_interval == 0) { _small_hash_bitlen = small_hash_bitlen; }
+        pickup_next_parents(result_indices.data() + (1 - (iter & 0x1)) * result_buffer_size,
+                            result_buffer_allocation_size,
+                            itopk_size,
+                            num_queries,
+                            hashmap.data(),
+                            hash_bitlen,
+                            _small_hash_bitlen,
+                            parent_node_list.data(),
+                            search_width,
+                            search_width,
+                            terminate_flag.data(),
+                            stream);
+
+        // termination (2); the flag is not checked while the stream is captured into a CUDA graph
+        // (reading it needs a host sync): the search then runs to max_iterations.
+        if (iter + 1 >= min_iterations && !capturing && terminate_flag.value(stream)) {
+          iter++;
+          break;
+        }
+
+        // Compute distance to child nodes that are adjacent to the parent node
+        compute_distance_to_child_nodes<TEAM_SIZE, DATASET_BLOCK_DIM>(
+          parent_node_list.data(),
+          result_indices.data() + (1 - (iter & 0x1)) * result_buffer_size,
+          result_distances.data() + (1 - (iter & 0x1)) * result_buffer_size,
+          result_buffer_allocation_size,
+          search_width,
+          dataset.data_handle(),
+          dataset.extent(1),
+          dataset.extent(0),
+          dataset.stride(0),
+          graph.data_handle(),
+          graph.extent(1),
+          graph_bits,
+          metric,
+          queries_ptr,
+          num_queries,
+          hashmap.data(),
+          hash_bitlen,
+          result_indices.data() + itopk_size,
+          result_distances.data() + itopk_size,
+          result_buffer_allocation_size,
+          sample_filter,
+          stream);
+
+        iter++;
+      }  // while ( 1 )
+    }
+    resource::scoped_phase phase(res, "cagra::topk");
     auto result_indices_ptr   = result_indices.data() + (iter & 0x1) * result_buffer_size;
     auto result_distances_ptr = result_distances.data() + (iter & 0x1) * result_buffer_size;
 
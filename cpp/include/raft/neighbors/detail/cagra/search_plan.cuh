@@ -16,8 +16,10 @@
 
 #pragma once
 
+#include "compute_distance.hpp"
 #include "hashmap.hpp"
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
 // #include "search_single_cta.cuh"
 // #include "topk_for_cagra/topk_core.cuh"
 
@@ -26,13 +28,81 @@
 #include <raft/neighbors/cagra_types.hpp>
 #include <raft/util/pow2_utils.cuh>
 
+/**
+ * The largest dataset block dim of the CAGRA search kernels (128, 256 or 512). The distances are
+ * computed in blocks of that many dimensions, hence a smaller value limits the instantiated
+ * kernels (and the binary size) without limiting the dimension of the dataset. Set by the
+ * `RAFT_CAGRA_MAX_DATASET_BLOCK_DIM` CMake option.
+ */
+#ifndef RAFT_CAGRA_MAX_DATASET_BLOCK_DIM
+#define RAFT_CAGRA_MAX_DATASET_BLOCK_DIM 512
+#endif
+
 namespace raft::neighbors::cagra::detail {
 
+/**
+ * Queue shared between the host and the persistent search kernel.
+ *
+ * Jobs are identified by a monotonically increasing ticket; ticket `t` uses the slot
+ * `t % num_slots`. The host publishes a query by writing `t + 1` to `submitted[slot]` and the
+ * kernel reports the result by writing `t + 1` to `completed[slot]`. All pointers except
+ * `next_ticket` refer to host memory mapped into the device address space.
+ */
+template <class DATA_T, class INDEX_T, class DISTANCE_T>
+struct persistent_job_queue {
+  const DATA_T* queries;            // [num_slots, dim]
+  INDEX_T* indices;                 // [num_slots, topk]
+  DISTANCE_T* distances;            // [num_slots, topk]
+  volatile uint64_t* submitted;     // [num_slots]
+  volatile uint64_t* completed;     // [num_slots]
+  volatile uint32_t* stop;          // [1]
+  unsigned long long* next_ticket;  // [1], device memory
+  uint32_t num_slots;
+};
+
+/**
+ * Per-query selection of the index searched by the single-CTA kernel, for a batch of queries over
+ * many small indices packed into one arena.
+ *
+ * The rows (dataset, graph and dataset norms) of the index `i` are `[offsets[i], offsets[i + 1])`
+ * of the arena, and its graph holds the neighbor ids relative to `offsets[i]`. The query `q` of
+ * the batch searches the index `index_ids[q]`. With `offsets == nullptr` (the default), all
+ * queries search the whole dataset.
+ */
+struct multi_index_arena {
+  const int64_t* offsets    = nullptr;  // [n_indices + 1], device memory
+  const uint32_t* index_ids = nullptr;  // [num_queries], device memory
+};
+
+/**
+ * The graph of an index as passed to the search kernels, [size, graph-degree]: the dense graph, or
+ * the words of the bit-packed graph if `idx.graph_bits() > 0` (the kernels unpack the ids).
+ */
+template <typename internal_IdxT, typename T, typename IdxT>
+auto kernel_graph_view(const index<T, IdxT>& idx)
+  -> raft::device_matrix_view<const internal_IdxT, int64_t, row_major>
+{
+  const void* graph = idx.graph_bits() > 0
+                        ? static_cast<const void*>(idx.packed_graph().data_handle())
+                        : static_cast<const void*>(idx.graph().data_handle());
+  return raft::make_device_matrix_view<const internal_IdxT, int64_t, row_major>(
+    static_cast<const internal_IdxT*>(graph), idx.size(), idx.graph_degree());
+}
+
 struct search_plan_impl_base : public search_params {
   int64_t dataset_block_dim;
   int64_t dim;
   int64_t graph_degree;
   uint32_t topk;
+  int64_t hash_bitlen;
+
+  size_t small_hash_bitlen;
+  size_t small_hash_reset_interval;
+  size_t hashmap_size;
+  /** The metric of the distances computed by the kernels (set by the search from the index). */
+  search_metric metric;
+  /** The per-query index selection (set by the multi-index search; single-CTA only). */
+  multi_index_arena arena;
   search_plan_impl_base(search_params params, int64_t dim, int64_t graph_degree, uint32_t topk)
     : search_params(params), dim(dim), graph_degree(graph_degree), topk(topk)
   {
@@ -51,7 +121,10 @@ struct search_plan_impl_base : public search_params {
 
   void set_dataset_block_and_team_size(int64_t dim)
   {
-    constexpr int64_t max_dataset_block_dim = 512;
+    constexpr int64_t max_dataset_block_dim = RAFT_CAGRA_MAX_DATASET_BLOCK_DIM;
+    static_assert(max_dataset_block_dim == 128 || max_dataset_block_dim == 256 ||
+                    max_dataset_block_dim == 512,
+                  "RAFT_CAGRA_MAX_DATASET_BLOCK_DIM must be 128, 256 or 512");
     dataset_block_dim                       = 128;
     while (dataset_block_dim < dim && dataset_block_dim < max_dataset_block_dim) {
       dataset_block_dim *= 2;
@@ -64,58 +137,6 @@ struct search_plan_impl_base : public search_params {
       default: team_size = 32; break;
     }
   }
-};
-
-template <class DATA_T, class INDEX_T, class DISTANCE_T, class SAMPLE_FILTER_T>
-struct search_plan_impl : public search_plan_impl_base {
-  int64_t hash_bitlen;
-
-  size_t small_hash_bitlen;
-  size_t small_hash_reset_interval;
-  size_t hashmap_size;
-  uint32_t dataset_size;
-  uint32_t result_buffer_size;
-
-  uint32_t smem_size;
-  uint32_t topk;
-  uint32_t num_seeds;
-
-  rmm::device_uvector<INDEX_T> hashmap;
-  rmm::device_uvector<uint32_t> num_executed_iterations;  // device or managed?
-  rmm::device_uvector<INDEX_T> dev_seed;
-
-  search_plan_impl(raft::resources const& res,
-                   search_params params,
-                   int64_t dim,
-                   int64_t graph_degree,
-                   uint32_t topk)
-    : search_plan_impl_base(params, dim, graph_degree, topk),
-      hashmap(0, resource::get_cuda_stream(res)),
-      num_executed_iterations(0, resource::get_cuda_stream(res)),
-      dev_seed(0, resource::get_cuda_stream(res)),
-      num_seeds(0)
-  {
-    adjust_search_params();
-    check_params();
-    calc_hashmap_params(res);
-    set_dataset_block_and_team_size(dim);
-    num_executed_iterations.resize(max_queries, resource::get_cuda_stream(res));
-    RAFT_LOG_DEBUG("# algo = %d", static_cast<int>(algo));
-  }
-
-  virtual ~search_plan_impl() {}
-
-  virtual void operator()(raft::resources const& res,
-                          raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
-                          raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
-                          INDEX_T* const result_indices_ptr,       // [num_queries, topk]
-                          DISTANCE_T* const result_distances_ptr,  // [num_queries, topk]
-                          const DATA_T* const queries_ptr,         // [num_queries, dataset_dim]
-                          const std::uint32_t num_queries,
-                          const INDEX_T* dev_seed_ptr,                   // [num_queries, num_seeds]
-                          std::uint32_t* const num_executed_iterations,  // [num_queries]
-                          uint32_t topk,
-                          SAMPLE_FILTER_T sample_filter){};
 
   void adjust_search_params()
   {
@@ -145,7 +166,8 @@ struct search_plan_impl : public search_plan_impl_base {
   }
 
   // defines hash_bitlen, small_hash_bitlen, small_hash_reset interval, hash_size
-  inline void calc_hashmap_params(raft::resources const& res)
+  // (`index_size` is the size of the node ids stored in the hash table)
+  inline void calc_hashmap_params(size_t index_size)
   {
     // for multiple CTA search
     uint32_t mc_num_cta_per_query = 0;
@@ -241,7 +263,7 @@ struct search_plan_impl : public search_plan_impl_base {
     if (small_hash_bitlen > 0) {
       RAFT_LOG_DEBUG("# small_hash_reset_interval = %lu", small_hash_reset_interval);
     }
-    hashmap_size = sizeof(INDEX_T) * max_queries * hashmap::get_size(hash_bitlen);
+    hashmap_size = index_size * max_queries * hashmap::get_size(hash_bitlen);
     RAFT_LOG_DEBUG("# hashmap size: %lu", hashmap_size);
     if (hashmap_size >= 1024 * 1024 * 1024) {
       RAFT_LOG_DEBUG(" (%.2f GiB)", (double)hashmap_size / (1024 * 1024 * 1024));
@@ -252,13 +274,8 @@ struct search_plan_impl : public search_plan_impl_base {
     }
   }
 
-  virtual void check(const uint32_t topk)
-  {
-    // For single-CTA and multi kernel
-    RAFT_EXPECTS(topk <= itopk_size, "topk must be smaller than itopk_size = %lu", itopk_size);
-  }
-
-  inline void check_params()
+  // the searches with a sample filter (`filtered`) use the normal hash
+  inline void check_params(bool filtered)
   {
     std::string error_message = "";
 
@@ -291,8 +308,7 @@ struct search_plan_impl : public search_plan_impl_base {
         "`hashmap_max_fill_rate` must be equal to or greater than 0.1 and smaller than 0.9. " +
         std::to_string(hashmap_max_fill_rate) + " has been given.";
     }
-    if constexpr (!std::is_same<SAMPLE_FILTER_T,
-                                raft::neighbors::filtering::none_cagra_sample_filter>::value) {
+    if (filtered) {
       if (hashmap_mode == hash_mode::SMALL) {
         error_message += "`SMALL` hash is not available when filtering";
       } else {
@@ -311,6 +327,75 @@ struct search_plan_impl : public search_plan_impl_base {
   }
 };
 
+template <class DATA_T, class INDEX_T, class DISTANCE_T, class SAMPLE_FILTER_T>
+struct search_plan_impl : public search_plan_impl_base {
+  uint32_t dataset_size;
+  uint32_t result_buffer_size;
+
+  uint32_t smem_size;
+  uint32_t num_seeds;
+
+  rmm::device_uvector<INDEX_T> hashmap;
+  rmm::device_uvector<uint32_t> num_executed_iterations;  // device or managed?
+  rmm::device_uvector<INDEX_T> dev_seed;
+
+  search_plan_impl(raft::resources const& res,
+                   search_params params,
+                   int64_t dim,
+                   int64_t graph_degree,
+                   uint32_t topk)
+    : search_plan_impl_base(params, dim, graph_degree, topk),
+      hashmap(0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      num_executed_iterations(
+        0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      dev_seed(0, resource::get_cuda_stream(res), resource::get_workspace_resource(res)),
+      num_seeds(0)
+  {
+    adjust_search_params();
+    check_params(!std::is_same_v<SAMPLE_FILTER_T,
+                                 raft::neighbors::filtering::none_cagra_sample_filter>);
+    calc_hashmap_params(sizeof(INDEX_T));
+    set_dataset_block_and_team_size(dim);
+    num_executed_iterations.resize(max_queries, resource::get_cuda_stream(res));
+    RAFT_LOG_DEBUG("# algo = %d", static_cast<int>(algo));
+  }
+
+  virtual ~search_plan_impl() {}
+
+  virtual void operator()(raft::resources const& res,
+                          raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
+                          raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+                          uint32_t graph_bits,
+                          INDEX_T* const result_indices_ptr,       // [num_queries, topk]
+                          DISTANCE_T* const result_distances_ptr,  // [num_queries, topk]
+                          const DATA_T* const queries_ptr,         // [num_queries, dataset_dim]
+                          const std::uint32_t num_queries,
+                          const INDEX_T* dev_seed_ptr,                   // [num_queries, num_seeds]
+                          std::uint32_t* const num_executed_iterations,  // [num_queries]
+                          uint32_t topk,
+                          SAMPLE_FILTER_T sample_filter){};
+
+  /** Launch the persistent search kernel serving `queue` on `num_blocks` thread blocks. */
+  virtual void launch_persistent(
+    raft::resources const& res,
+    raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
+    raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+    uint32_t graph_bits,
+    persistent_job_queue<DATA_T, INDEX_T, DISTANCE_T> queue,
+    uint32_t num_blocks,
+    uint32_t topk,
+    cudaStream_t stream)
+  {
+    RAFT_FAIL("The persistent search kernel is only implemented for the single-CTA algorithm");
+  }
+
+  virtual void check(const uint32_t topk)
+  {
+    // For single-CTA and multi kernel
+    RAFT_EXPECTS(topk <= itopk_size, "topk must be smaller than itopk_size = %lu", itopk_size);
+  }
+};
+
 // template <class DATA_T, class DISTANCE_T, class INDEX_T>
 // struct search_plan {
 //   search_plan(raft::resources const& res,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -25,6 +25,7 @@
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/device_properties.hpp>
+#include <raft/core/resource/phase_timer.hpp>
 #include <raft/core/resources.hpp>
 #include <rmm/device_uvector.hpp>
 #include <vector>
@@ -84,6 +85,8 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::num_executed_iterations;
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::dev_seed;
   using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::num_seeds;
+  using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::metric;
+  using search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>::arena;
 
   uint32_t num_itopk_candidates;
 
@@ -206,6 +209,7 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
   void operator()(raft::resources const& res,
                   raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
                   raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+                  uint32_t graph_bits,
                   INDEX_T* const result_indices_ptr,       // [num_queries, topk]
                   DISTANCE_T* const result_distances_ptr,  // [num_queries, topk]
                   const DATA_T* const queries_ptr,         // [num_queries, dataset_dim]
@@ -216,9 +220,14 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
                   SAMPLE_FILTER_T sample_filter)
   {
     cudaStream_t stream = resource::get_cuda_stream(res);
+    // the top-k of the single-CTA search is selected in the traversal kernel
+    resource::scoped_phase phase(res, "cagra::traversal");
     select_and_run<TEAM_SIZE, DATASET_BLOCK_DIM, DATA_T, INDEX_T, DISTANCE_T>(
       dataset,
       graph,
+      graph_bits,
+      metric,
+      arena,
       result_indices_ptr,
       result_distances_ptr,
       queries_ptr,
@@ -243,6 +252,48 @@ struct search : search_plan_impl<DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T> {
       sample_filter,
       stream);
   }
+
+  void launch_persistent(raft::resources const& res,
+                         raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
+                         raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+                         uint32_t graph_bits,
+                         persistent_job_queue<DATA_T, INDEX_T, DISTANCE_T> queue,
+                         uint32_t num_blocks,
+                         uint32_t topk,
+                         cudaStream_t stream) override
+  {
+    if constexpr (std::is_same_v<SAMPLE_FILTER_T,
+                                 raft::neighbors::filtering::none_cagra_sample_filter>) {
+      RAFT_EXPECTS(num_blocks <= max_queries,
+                   "The plan has workspace for %lu thread blocks, but %u were requested",
+                   max_queries,
+                   num_blocks);
+      select_and_run_persistent<TEAM_SIZE, DATASET_BLOCK_DIM, DATA_T, INDEX_T, DISTANCE_T>(
+        dataset,
+        graph,
+        graph_bits,
+        metric,
+        queue,
+        num_blocks,
+        topk,
+        num_itopk_candidates,
+        static_cast<uint32_t>(thread_block_size),
+        smem_size,
+        hash_bitlen,
+        hashmap.data(),
+        small_hash_bitlen,
+        small_hash_reset_interval,
+        num_random_samplings,
+        rand_xor_mask,
+        itopk_size,
+        search_width,
+        min_iterations,
+        max_iterations,
+        stream);
+    } else {
+      RAFT_FAIL("The persistent search kernel does not support filtering");
+    }
+  }
 };
 
 }  // namespace single_cta_search
@@ -15,6 +15,8 @@
  */
 #pragma once
 
+#include "search_plan.cuh"  // persistent_job_queue, multi_index_arena
+
 #include <raft/neighbors/sample_filter_types.hpp>
 #include <raft/util/raft_explicit.hpp>  // RAFT_EXPLICIT
 
@@ -32,6 +34,9 @@ template <unsigned TEAM_SIZE,
 void select_and_run(  // raft::resources const& res,
   raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
   raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+  uint32_t graph_bits,
+  search_metric metric,
+  multi_index_arena arena,
   INDEX_T* const topk_indices_ptr,       // [num_queries, topk]
   DISTANCE_T* const topk_distances_ptr,  // [num_queries, topk]
   const DATA_T* const queries_ptr,       // [num_queries, dataset_dim]
@@ -56,6 +61,34 @@ void select_and_run(  // raft::resources const& res,
   SAMPLE_FILTER_T sample_filter,
   cudaStream_t stream) RAFT_EXPLICIT;
 
+template <unsigned TEAM_SIZE,
+          unsigned MAX_DATASET_DIM,
+          typename DATA_T,
+          typename INDEX_T,
+          typename DISTANCE_T>
+void select_and_run_persistent(
+  raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
+  raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+  uint32_t graph_bits,
+  search_metric metric,
+  persistent_job_queue<DATA_T, INDEX_T, DISTANCE_T> queue,
+  uint32_t num_blocks,
+  uint32_t topk,
+  uint32_t num_itopk_candidates,
+  uint32_t block_size,
+  uint32_t smem_size,
+  int64_t hash_bitlen,
+  INDEX_T* hashmap_ptr,
+  size_t small_hash_bitlen,
+  size_t small_hash_reset_interval,
+  uint32_t num_random_samplings,
+  uint64_t rand_xor_mask,
+  size_t itopk_size,
+  size_t search_width,
+  size_t min_iterations,
+  size_t max_iterations,
+  cudaStream_t stream) RAFT_EXPLICIT;
+
 #endif  // RAFT_EXPLICIT_INSTANTIATE_ONLY
 
 #define instantiate_single_cta_select_and_run(                                              \
@@ -64,6 +97,9 @@ void select_and_run(  // raft::resources const& res,
   select_and_run<TEAM_SIZE, MAX_DATASET_DIM, DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>( \
     raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,                 \
     raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,                      \
+    uint32_t graph_bits,                                                                    \
+    search_metric metric,                                                                   \
+    multi_index_arena arena,                                                                \
     INDEX_T* const topk_indices_ptr,                                                        \
     DISTANCE_T* const topk_distances_ptr,                                                   \
     const DATA_T* const queries_ptr,                                                        \
@@ -88,32 +124,82 @@ void select_and_run(  // raft::resources const& res,
     SAMPLE_FILTER_T sample_filter,                                                          \
     cudaStream_t stream);
 
-instantiate_single_cta_select_and_run(
-  32, 1024, float, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   8, 128, float, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_single_cta_select_and_run(
+  8, 128, float, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   16, 256, float, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_single_cta_select_and_run(
+  16, 256, float, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   32, 512, float, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
-  32, 1024, int8_t, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+  32, 512, float, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   8, 128, int8_t, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_single_cta_select_and_run(
+  8, 128, int8_t, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   16, 256, int8_t, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_single_cta_select_and_run(
+  16, 256, int8_t, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   32, 512, int8_t, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
-  32, 1024, uint8_t, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+  32, 512, int8_t, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   8, 128, uint8_t, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_single_cta_select_and_run(
+  8, 128, uint8_t, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   16, 256, uint8_t, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_single_cta_select_and_run(
+  16, 256, uint8_t, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 instantiate_single_cta_select_and_run(
   32, 512, uint8_t, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_single_cta_select_and_run(
+  32, 512, uint8_t, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 
 #undef instantiate_single_cta_select_and_run
 
+#define instantiate_single_cta_select_and_run_persistent(                             \
+  TEAM_SIZE, MAX_DATASET_DIM, DATA_T, INDEX_T, DISTANCE_T)                            \
+  extern template void                                                                \
+  select_and_run_persistent<TEAM_SIZE, MAX_DATASET_DIM, DATA_T, INDEX_T, DISTANCE_T>( \
+    raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,           \
+    raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,                \
+    uint32_t graph_bits,                                                              \
+    search_metric metric,                                                             \
+    persistent_job_queue<DATA_T, INDEX_T, DISTANCE_T> queue,                          \
+    uint32_t num_blocks,                                                              \
+    uint32_t topk,                                                                    \
+    uint32_t num_itopk_candidates,                                                    \
+    uint32_t block_size,                                                              \
+    uint32_t smem_size,                                                               \
+    int64_t hash_bitlen,                                                              \
+    INDEX_T* hashmap_ptr,                                                             \
+    size_t small_hash_bitlen,                                                         \
+    size_t small_hash_reset_interval,                                                 \
+    uint32_t num_random_samplings,                                                    \
+    uint64_t rand_xor_mask,                                                           \
+    size_t itopk_size,                                                                \
+    size_t search_width,                                                              \
+    size_t min_iterations,                                                            \
+    size_t max_iterations,                                                            \
+    cudaStream_t stream);
+
+instantiate_single_cta_select_and_run_persistent(8, 128, float, uint32_t, float);
+instantiate_single_cta_select_and_run_persistent(16, 256, float, uint32_t, float);
+instantiate_single_cta_select_and_run_persistent(32, 512, float, uint32_t, float);
+instantiate_single_cta_select_and_run_persistent(8, 128, int8_t, uint32_t, float);
+instantiate_single_cta_select_and_run_persistent(16, 256, int8_t, uint32_t, float);
+instantiate_single_cta_select_and_run_persistent(32, 512, int8_t, uint32_t, float);
+instantiate_single_cta_select_and_run_persistent(8, 128, uint8_t, uint32_t, float);
+instantiate_single_cta_select_and_run_persistent(16, 256, uint8_t, uint32_t, float);
+instantiate_single_cta_select_and_run_persistent(32, 512, uint8_t, uint32_t, float);
+
+#undef instantiate_single_cta_select_and_run_persistent
+
 }  // namespace single_cta_search
 }  // namespace raft::neighbors::cagra::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,6 +21,7 @@
 #include <iostream>
 #include <memory>
 #include <numeric>
+#include <type_traits>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/device_properties.hpp>
@@ -36,6 +37,7 @@
 #include "hashmap.hpp"
 #include "search_plan.cuh"
 #include "topk_by_radix.cuh"
+#include "topk_merge.cuh"
 #include "topk_for_cagra/topk_core.cuh"  // TODO replace with raft topk
 #include "utils.hpp"
 #include <raft/core/logger.hpp>
@@ -453,7 +455,34 @@ __device__ inline void set_value_device(T* const ptr, const T fill, const std::u
   }
 }
 
-// One query one thread block
+/**
+ * Load a value written by the host to mapped memory, with acquire semantics at the system scope:
+ * the loads that follow it in program order (and, after a barrier, those of the block) see the
+ * host writes that preceded the value.
+ */
+RAFT_DEVICE_INLINE_FUNCTION auto load_acquire_sys(const volatile std::uint64_t* ptr)
+  -> std::uint64_t
+{
+  std::uint64_t value;
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 700)
+  asm volatile("ld.acquire.sys.global.u64 %0, [%1];" : "=l"(value) : "l"(ptr) : "memory");
+#else
+  value = *ptr;
+  __threadfence_system();
+#endif
+  return value;
+}
+
+/**
+ * Search a single query with the whole thread block.
+ *
+ * `query_id` selects the query, the hashmap and the output rows relative to the given pointers and
+ * is passed to the sample filter. The caller is responsible for a barrier before the shared memory
+ * is reused for another query.
+ *
+ * With `mapped_query`, the query is in host memory that the host rewrites between searches, and is
+ * read through volatile loads so that no copy of a previous query cached in L1 is used.
+ */
 template <unsigned TEAM_SIZE,
           unsigned MAX_ITOPK,
           unsigned MAX_CANDIDATES,
@@ -463,34 +492,36 @@ template <unsigned TEAM_SIZE,
           class DISTANCE_T,
           class INDEX_T,
           class SAMPLE_FILTER_T>
-__launch_bounds__(1024, 1) RAFT_KERNEL
-  search_kernel(INDEX_T* const result_indices_ptr,       // [num_queries, top_k]
-                DISTANCE_T* const result_distances_ptr,  // [num_queries, top_k]
-                const std::uint32_t top_k,
-                const DATA_T* const dataset_ptr,  // [dataset_size, dataset_dim]
-                const std::size_t dataset_dim,
-                const std::size_t dataset_size,
-                const std::size_t dataset_ld,     // stride of dataset
-                const DATA_T* const queries_ptr,  // [num_queries, dataset_dim]
-                const INDEX_T* const knn_graph,   // [dataset_size, graph_degree]
-                const std::uint32_t graph_degree,
-                const unsigned num_distilation,
-                const uint64_t rand_xor_mask,
-                const INDEX_T* seed_ptr,  // [num_queries, num_seeds]
-                const uint32_t num_seeds,
-                INDEX_T* const visited_hashmap_ptr,  // [num_queries, 1 << hash_bitlen]
-                const std::uint32_t internal_topk,
-                const std::uint32_t search_width,
-                const std::uint32_t min_iteration,
-                const std::uint32_t max_iteration,
-                std::uint32_t* const num_executed_iterations,  // [num_queries]
-                const std::uint32_t hash_bitlen,
-                const std::uint32_t small_hash_bitlen,
-                const std::uint32_t small_hash_reset_interval,
-                SAMPLE_FILTER_T sample_filter)
+__device__ void search_core(INDEX_T* const result_indices_ptr,       // [num_queries, top_k]
+                            DISTANCE_T* const result_distances_ptr,  // [num_queries, top_k]
+                            const std::uint32_t top_k,
+                            const DATA_T* const dataset_ptr,  // [dataset_size, dataset_dim]
+                            const std::size_t dataset_dim,
+                            const std::size_t dataset_size,
+                            const std::size_t dataset_ld,     // stride of dataset
+                            const DATA_T* const queries_ptr,  // [num_queries, dataset_dim]
+                            const INDEX_T* const knn_graph,   // [dataset_size, graph_degree]
+                            const std::uint32_t graph_degree,
+                            const std::uint32_t graph_bits,
+                            const search_metric metric,
+                            const unsigned num_distilation,
+                            const uint64_t rand_xor_mask,
+                            const INDEX_T* seed_ptr,  // [num_queries, num_seeds]
+                            const uint32_t num_seeds,
+                            INDEX_T* const visited_hashmap_ptr,  // [num_queries, 1 << hash_bitlen]
+                            const std::uint32_t internal_topk,
+                            const std::uint32_t search_width,
+                            const std::uint32_t min_iteration,
+                            const std::uint32_t max_iteration,
+                            std::uint32_t* const num_executed_iterations,  // [num_queries]
+                            const std::uint32_t hash_bitlen,
+                            const std::uint32_t small_hash_bitlen,
+                            const std::uint32_t small_hash_reset_interval,
+                            SAMPLE_FILTER_T sample_filter,
+                            const std::uint32_t query_id,
+                            const bool mapped_query = false)
 {
-  using LOAD_T        = device::LOAD_128BIT_T;
-  const auto query_id = blockIdx.y;
+  using LOAD_T = device::LOAD_128BIT_T;
 
 #ifdef _CLK_BREAKDOWN
   std::uint64_t clk_init                 = 0;
@@ -542,7 +573,9 @@ __launch_bounds__(1024, 1) RAFT_KERNEL
   for (unsigned i = threadIdx.x; i < query_smem_buffer_length; i += blockDim.x) {
     unsigned j = device::swizzling(i);
     if (i < dataset_dim) {
-      query_buffer[j] = spatial::knn::detail::utils::mapping<float>{}(query_ptr[i]);
+      const DATA_T value = mapped_query ? static_cast<const volatile DATA_T*>(query_ptr)[i]
+                                        : query_ptr[i];
+      query_buffer[j]    = spatial::knn::detail::utils::mapping<float>{}(value);
     } else {
       query_buffer[j] = 0.0;
     }
@@ -580,7 +613,8 @@ __launch_bounds__(1024, 1) RAFT_KERNEL
     local_seed_ptr,
     num_seeds,
     local_visited_hashmap_ptr,
-    hash_bitlen);
+    hash_bitlen,
+    metric);
   __syncthreads();
   _CLK_REC(clk_compute_1st_distance);
 
@@ -653,19 +687,33 @@ __launch_bounds__(1024, 1) RAFT_KERNEL
       _CLK_REC(clk_topk);
     } else {
       _CLK_START();
-      // topk with radix block sort
-      topk_by_radix_sort<MAX_ITOPK, INDEX_T>{}(
-        internal_topk,
-        gridDim.x,
-        result_buffer_size,
-        reinterpret_cast<std::uint32_t*>(result_distances_buffer),
-        result_indices_buffer,
-        reinterpret_cast<std::uint32_t*>(result_distances_buffer),
-        result_indices_buffer,
-        nullptr,
-        topk_ws,
-        true,
-        reinterpret_cast<std::uint32_t*>(smem_working_ptr));
+      if (iter > 0 && (std::is_same<SAMPLE_FILTER_T,
+                                    raft::neighbors::filtering::none_cagra_sample_filter>::value ||
+                       *filter_flag == 0)) {
+        // the internal topk is sorted: merge the sorted children into it
+        static_assert(topk_merge::inplace_workspace_size<DISTANCE_T, INDEX_T>(MAX_ITOPK) <=
+                        topk_by_radix_sort<MAX_ITOPK, INDEX_T>::smem_size * sizeof(std::uint32_t),
+                      "The merge of the children must fit in the working memory of the topk.");
+        topk_merge::merge_inplace(result_distances_buffer,
+                                  result_indices_buffer,
+                                  internal_topk,
+                                  search_width * graph_degree,
+                                  smem_working_ptr);
+      } else {
+        // topk with radix block sort
+        topk_by_radix_sort<MAX_ITOPK, INDEX_T>{}(
+          internal_topk,
+          1,
+          result_buffer_size,
+          reinterpret_cast<std::uint32_t*>(result_distances_buffer),
+          result_indices_buffer,
+          reinterpret_cast<std::uint32_t*>(result_distances_buffer),
+          result_indices_buffer,
+          nullptr,
+          topk_ws,
+          true,
+          reinterpret_cast<std::uint32_t*>(smem_working_ptr));
+      }
       _CLK_REC(clk_topk);
 
       // reset small-hash table
@@ -715,11 +763,13 @@ __launch_bounds__(1024, 1) RAFT_KERNEL
       dataset_ld,
       knn_graph,
       graph_degree,
+      graph_bits,
       local_visited_hashmap_ptr,
       hash_bitlen,
       parent_list_buffer,
       result_indices_buffer,
-      search_width);
+      search_width,
+      metric);
     __syncthreads();
     _CLK_REC(clk_compute_distance);
 
@@ -812,24 +862,239 @@ __launch_bounds__(1024, 1) RAFT_KERNEL
 #endif
 }
 
+// One query one thread block
+template <unsigned TEAM_SIZE,
+          unsigned MAX_ITOPK,
+          unsigned MAX_CANDIDATES,
+          unsigned TOPK_BY_BITONIC_SORT,
+          unsigned DATASET_BLOCK_DIM,
+          class DATA_T,
+          class DISTANCE_T,
+          class INDEX_T,
+          class SAMPLE_FILTER_T>
+__launch_bounds__(1024, 1) RAFT_KERNEL
+  search_kernel(INDEX_T* const result_indices_ptr,       // [num_queries, top_k]
+                DISTANCE_T* const result_distances_ptr,  // [num_queries, top_k]
+                const std::uint32_t top_k,
+                const DATA_T* const dataset_ptr,  // [dataset_size, dataset_dim]
+                const std::size_t dataset_dim,
+                const std::size_t dataset_size,
+                const std::size_t dataset_ld,     // stride of dataset
+                const DATA_T* const queries_ptr,  // [num_queries, dataset_dim]
+                const INDEX_T* const knn_graph,   // [dataset_size, graph_degree]
+                const std::uint32_t graph_degree,
+                const std::uint32_t graph_bits,
+                const search_metric metric,
+                const multi_index_arena arena,
+                const unsigned num_distilation,
+                const uint64_t rand_xor_mask,
+                const INDEX_T* seed_ptr,  // [num_queries, num_seeds]
+                const uint32_t num_seeds,
+                INDEX_T* const visited_hashmap_ptr,  // [num_queries, 1 << hash_bitlen]
+                const std::uint32_t internal_topk,
+                const std::uint32_t search_width,
+                const std::uint32_t min_iteration,
+                const std::uint32_t max_iteration,
+                std::uint32_t* const num_executed_iterations,  // [num_queries]
+                const std::uint32_t hash_bitlen,
+                const std::uint32_t small_hash_bitlen,
+                const std::uint32_t small_hash_reset_interval,
+                SAMPLE_FILTER_T sample_filter)
+{
+  // Select the rows of the index searched by this query (the arena graph is not bit-packed).
+  const DATA_T* index_dataset_ptr = dataset_ptr;
+  std::size_t index_size          = dataset_size;
+  const INDEX_T* index_graph      = knn_graph;
+  search_metric index_metric      = metric;
+  if (arena.offsets != nullptr) {
+    const auto index_id = arena.index_ids[blockIdx.y];
+    const int64_t first = arena.offsets[index_id];
+    const int64_t last  = arena.offsets[index_id + 1];
+    index_dataset_ptr   = dataset_ptr + first * dataset_ld;
+    index_size          = last - first;
+    index_graph         = knn_graph + first * graph_degree;
+    if (index_metric.dataset_norms != nullptr) { index_metric.dataset_norms += first; }
+  }
+  search_core<TEAM_SIZE,
+              MAX_ITOPK,
+              MAX_CANDIDATES,
+              TOPK_BY_BITONIC_SORT,
+              DATASET_BLOCK_DIM,
+              DATA_T,
+              DISTANCE_T,
+              INDEX_T,
+              SAMPLE_FILTER_T>(result_indices_ptr,
+                               result_distances_ptr,
+                               top_k,
+                               index_dataset_ptr,
+                               dataset_dim,
+                               index_size,
+                               dataset_ld,
+                               queries_ptr,
+                               index_graph,
+                               graph_degree,
+                               graph_bits,
+                               index_metric,
+                               num_distilation,
+                               rand_xor_mask,
+                               seed_ptr,
+                               num_seeds,
+                               visited_hashmap_ptr,
+                               internal_topk,
+                               search_width,
+                               min_iteration,
+                               max_iteration,
+                               num_executed_iterations,
+                               hash_bitlen,
+                               small_hash_bitlen,
+                               small_hash_reset_interval,
+                               sample_filter,
+                               blockIdx.y);
+}
+
+/**
+ * Persistent variant of the single-CTA search kernel.
+ *
+ * Every thread block stays resident and repeatedly takes the next ticket from the queue, waits
+ * until the host has published a query for it, searches it and publishes the result. The kernel
+ * returns once the host raises the stop flag.
+ */
+template <unsigned TEAM_SIZE,
+          unsigned MAX_ITOPK,
+          unsigned MAX_CANDIDATES,
+          unsigned TOPK_BY_BITONIC_SORT,
+          unsigned DATASET_BLOCK_DIM,
+          class DATA_T,
+          class DISTANCE_T,
+          class INDEX_T,
+          class SAMPLE_FILTER_T>
+__launch_bounds__(1024, 1) RAFT_KERNEL
+  search_kernel_p(persistent_job_queue<DATA_T, INDEX_T, DISTANCE_T> queue,
+                  const std::uint32_t top_k,
+                  const DATA_T* const dataset_ptr,  // [dataset_size, dataset_dim]
+                  const std::size_t dataset_dim,
+                  const std::size_t dataset_size,
+                  const std::size_t dataset_ld,    // stride of dataset
+                  const INDEX_T* const knn_graph,  // [dataset_size, graph_degree]
+                  const std::uint32_t graph_degree,
+                  const std::uint32_t graph_bits,
+                  const search_metric metric,
+                  const unsigned num_distilation,
+                  const uint64_t rand_xor_mask,
+                  INDEX_T* const visited_hashmap_ptr,  // [gridDim.x, 1 << hash_bitlen]
+                  const std::uint32_t internal_topk,
+                  const std::uint32_t search_width,
+                  const std::uint32_t min_iteration,
+                  const std::uint32_t max_iteration,
+                  const std::uint32_t hash_bitlen,
+                  const std::uint32_t small_hash_bitlen,
+                  const std::uint32_t small_hash_reset_interval,
+                  SAMPLE_FILTER_T sample_filter)
+{
+  constexpr auto kNoTicket = ~static_cast<unsigned long long>(0);
+  __shared__ unsigned long long job_ticket;
+
+  // The global hashmap (if any) is shared by all the queries processed by this block.
+  INDEX_T* const local_visited_hashmap_ptr =
+    small_hash_bitlen ? nullptr
+                      : visited_hashmap_ptr + hashmap::get_size(hash_bitlen) * blockIdx.x;
+
+  while (true) {
+    if (threadIdx.x == 0) {
+      auto ticket     = atomicAdd(queue.next_ticket, 1ull);
+      const auto slot = ticket % queue.num_slots;
+      // The acquire orders the reads of the query after the ticket it was published with.
+      while (load_acquire_sys(queue.submitted + slot) != ticket + 1) {
+        if (*queue.stop) {
+          ticket = kNoTicket;
+          break;
+        }
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 700)
+        __nanosleep(100);
+#endif
+      }
+      // Make the query written by the host visible to all threads of the block: the fence is
+      // between the ticket and the query reads of this thread, the barrier extends it to the block.
+      __threadfence_system();
+      job_ticket = ticket;
+    }
+    __syncthreads();
+    const auto ticket = job_ticket;
+    if (ticket == kNoTicket) { return; }
+
+    const auto slot = ticket % queue.num_slots;
+    search_core<TEAM_SIZE,
+                MAX_ITOPK,
+                MAX_CANDIDATES,
+                TOPK_BY_BITONIC_SORT,
+                DATASET_BLOCK_DIM,
+                DATA_T,
+                DISTANCE_T,
+                INDEX_T,
+                SAMPLE_FILTER_T>(queue.indices + slot * top_k,
+                                 queue.distances + slot * top_k,
+                                 top_k,
+                                 dataset_ptr,
+                                 dataset_dim,
+                                 dataset_size,
+                                 dataset_ld,
+                                 queue.queries + slot * dataset_dim,
+                                 knn_graph,
+                                 graph_degree,
+                                 graph_bits,
+                                 metric,
+                                 num_distilation,
+                                 rand_xor_mask,
+                                 nullptr,
+                                 0,
+                                 local_visited_hashmap_ptr,
+                                 internal_topk,
+                                 search_width,
+                                 min_iteration,
+                                 max_iteration,
+                                 nullptr,
+                                 hash_bitlen,
+                                 small_hash_bitlen,
+                                 small_hash_reset_interval,
+                                 sample_filter,
+                                 0,
+                                 true);
+    // Results must reach the host before the completion flag does.
+    __threadfence_system();
+    __syncthreads();
+    if (threadIdx.x == 0) { queue.completed[slot] = ticket + 1; }
+  }
+}
+
 template <unsigned TEAM_SIZE,
           unsigned MX_DIM,
           typename T,
           typename IdxT,
           typename DistT,
-          typename SAMPLE_FILTER_T>
+          typename SAMPLE_FILTER_T,
+          bool PERSISTENT = false>
 struct search_kernel_config {
-  using kernel_t =
-    decltype(&search_kernel<TEAM_SIZE, 64, 64, 0, MX_DIM, T, DistT, IdxT, SAMPLE_FILTER_T>);
+  using kernel_t = std::conditional_t<
+    PERSISTENT,
+    decltype(&search_kernel_p<TEAM_SIZE, 64, 64, 0, MX_DIM, T, DistT, IdxT, SAMPLE_FILTER_T>),
+    decltype(&search_kernel<TEAM_SIZE, 64, 64, 0, MX_DIM, T, DistT, IdxT, SAMPLE_FILTER_T>)>;
 
-  template <unsigned MAX_CANDIDATES, unsigned USE_BITONIC_SORT>
-  static auto choose_search_kernel(unsigned itopk_size) -> kernel_t
+  template <unsigned MAX_ITOPK, unsigned MAX_CANDIDATES, unsigned USE_BITONIC_SORT>
+  static auto get_kernel() -> kernel_t
   {
-    if (itopk_size <= 64) {
-      return search_kernel<TEAM_SIZE, 64, MAX_CANDIDATES, USE_BITONIC_SORT, MX_DIM, T, DistT, IdxT>;
-    } else if (itopk_size <= 128) {
+    if constexpr (PERSISTENT) {
+      return search_kernel_p<TEAM_SIZE,
+                             MAX_ITOPK,
+                             MAX_CANDIDATES,
+                             USE_BITONIC_SORT,
+                             MX_DIM,
+                             T,
+                             DistT,
+                             IdxT,
+                             SAMPLE_FILTER_T>;
+    } else {
       return search_kernel<TEAM_SIZE,
-                           128,
+                           MAX_ITOPK,
                            MAX_CANDIDATES,
                            USE_BITONIC_SORT,
                            MX_DIM,
@@ -837,26 +1102,20 @@ struct search_kernel_config {
                            DistT,
                            IdxT,
                            SAMPLE_FILTER_T>;
+    }
+  }
+
+  template <unsigned MAX_CANDIDATES, unsigned USE_BITONIC_SORT>
+  static auto choose_search_kernel(unsigned itopk_size) -> kernel_t
+  {
+    if (itopk_size <= 64) {
+      return get_kernel<64, MAX_CANDIDATES, USE_BITONIC_SORT>();
+    } else if (itopk_size <= 128) {
+      return get_kernel<128, MAX_CANDIDATES, USE_BITONIC_SORT>();
     } else if (itopk_size <= 256) {
-      return search_kernel<TEAM_SIZE,
-                           256,
-                           MAX_CANDIDATES,
-                           USE_BITONIC_SORT,
-                           MX_DIM,
-                           T,
-                           DistT,
-                           IdxT,
-                           SAMPLE_FILTER_T>;
+      return get_kernel<256, MAX_CANDIDATES, USE_BITONIC_SORT>();
     } else if (itopk_size <= 512) {
-      return search_kernel<TEAM_SIZE,
-                           512,
-                           MAX_CANDIDATES,
-                           USE_BITONIC_SORT,
-                           MX_DIM,
-                           T,
-                           DistT,
-                           IdxT,
-                           SAMPLE_FILTER_T>;
+      return get_kernel<512, MAX_CANDIDATES, USE_BITONIC_SORT>();
     }
     THROW("No kernel for parametels itopk_size %u, max_candidates %u", itopk_size, MAX_CANDIDATES);
   }
@@ -876,9 +1135,9 @@ struct search_kernel_config {
       // Radix-based topk is used
       constexpr unsigned max_candidates = 32;  // to avoid build failure
       if (itopk_size <= 256) {
-        return search_kernel<TEAM_SIZE, 256, max_candidates, 0, MX_DIM, T, DistT, IdxT>;
+        return get_kernel<256, max_candidates, 0>();
       } else if (itopk_size <= 512) {
-        return search_kernel<TEAM_SIZE, 512, max_candidates, 0, MX_DIM, T, DistT, IdxT>;
+        return get_kernel<512, max_candidates, 0>();
       }
     }
     THROW("No kernel for parametels itopk_size %u, num_itopk_candidates %u",
@@ -896,6 +1155,9 @@ template <unsigned TEAM_SIZE,
 void select_and_run(  // raft::resources const& res,
   raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
   raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+  uint32_t graph_bits,
+  search_metric metric,
+  multi_index_arena arena,
   INDEX_T* const topk_indices_ptr,       // [num_queries, topk]
   DISTANCE_T* const topk_distances_ptr,  // [num_queries, topk]
   const DATA_T* const queries_ptr,       // [num_queries, dataset_dim]
@@ -929,8 +1191,7 @@ void select_and_run(  // raft::resources const& res,
                          SAMPLE_FILTER_T>::choose_itopk_and_mx_candidates(itopk_size,
                                                                           num_itopk_candidates,
                                                                           block_size);
-  RAFT_CUDA_TRY(
-    cudaFuncSetAttribute(kernel, cudaFuncAttributeMaxDynamicSharedMemorySize, smem_size));
+  RAFT_CUDA_TRY(raise_max_dynamic_smem(kernel, smem_size));
   dim3 thread_dims(block_size, 1, 1);
   dim3 block_dims(1, num_queries, 1);
   RAFT_LOG_DEBUG(
@@ -945,6 +1206,9 @@ void select_and_run(  // raft::resources const& res,
                                                          queries_ptr,
                                                          graph.data_handle(),
                                                          graph.extent(1),
+                                                         graph_bits,
+                                                         metric,
+                                                         arena,
                                                          num_random_samplings,
                                                          rand_xor_mask,
                                                          dev_seed_ptr,
@@ -961,5 +1225,93 @@ void select_and_run(  // raft::resources const& res,
                                                          sample_filter);
   RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
+
+/**
+ * Launch the persistent single-CTA search kernel on `num_blocks` thread blocks.
+ *
+ * The kernel does not return until `*queue.stop` is set, so `stream` must not be shared with other
+ * work. All thread blocks must be resident at the same time, which is checked against the
+ * occupancy of the selected kernel.
+ */
+template <unsigned TEAM_SIZE,
+          unsigned DATASET_BLOCK_DIM,
+          typename DATA_T,
+          typename INDEX_T,
+          typename DISTANCE_T>
+void select_and_run_persistent(
+  raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,
+  raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,
+  uint32_t graph_bits,
+  search_metric metric,
+  persistent_job_queue<DATA_T, INDEX_T, DISTANCE_T> queue,
+  uint32_t num_blocks,
+  uint32_t topk,
+  uint32_t num_itopk_candidates,
+  uint32_t block_size,
+  uint32_t smem_size,
+  int64_t hash_bitlen,
+  INDEX_T* hashmap_ptr,  // [num_blocks, 1 << hash_bitlen]
+  size_t small_hash_bitlen,
+  size_t small_hash_reset_interval,
+  uint32_t num_random_samplings,
+  uint64_t rand_xor_mask,
+  size_t itopk_size,
+  size_t search_width,
+  size_t min_iterations,
+  size_t max_iterations,
+  cudaStream_t stream)
+{
+  using sample_filter_t = raft::neighbors::filtering::none_cagra_sample_filter;
+  auto kernel =
+    search_kernel_config<TEAM_SIZE,
+                         DATASET_BLOCK_DIM,
+                         DATA_T,
+                         INDEX_T,
+                         DISTANCE_T,
+                         sample_filter_t,
+                         true>::choose_itopk_and_mx_candidates(itopk_size,
+                                                               num_itopk_candidates,
+                                                               block_size);
+  RAFT_CUDA_TRY(raise_max_dynamic_smem(kernel, smem_size));
+
+  int dev_id;
+  int num_sm;
+  int blocks_per_sm;
+  RAFT_CUDA_TRY(cudaGetDevice(&dev_id));
+  RAFT_CUDA_TRY(cudaDeviceGetAttribute(&num_sm, cudaDevAttrMultiProcessorCount, dev_id));
+  RAFT_CUDA_TRY(
+    cudaOccupancyMaxActiveBlocksPerMultiprocessor(&blocks_per_sm, kernel, block_size, smem_size));
+  RAFT_EXPECTS(num_blocks <= static_cast<uint32_t>(blocks_per_sm * num_sm),
+               "The persistent kernel needs %u resident thread blocks, but at most %d fit the GPU",
+               num_blocks,
+               blocks_per_sm * num_sm);
+
+  RAFT_LOG_DEBUG("Launching persistent kernel with %u threads, %u blocks %u smem",
+                 block_size,
+                 num_blocks,
+                 smem_size);
+  kernel<<<num_blocks, block_size, smem_size, stream>>>(queue,
+                                                        topk,
+                                                        dataset.data_handle(),
+                                                        dataset.extent(1),
+                                                        dataset.extent(0),
+                                                        dataset.stride(0),
+                                                        graph.data_handle(),
+                                                        graph.extent(1),
+                                                        graph_bits,
+                                                        metric,
+                                                        num_random_samplings,
+                                                        rand_xor_mask,
+                                                        hashmap_ptr,
+                                                        itopk_size,
+                                                        search_width,
+                                                        min_iterations,
+                                                        max_iterations,
+                                                        hash_bitlen,
+                                                        small_hash_bitlen,
+                                                        small_hash_reset_interval,
+                                                        sample_filter_t{});
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
 }  // namespace single_cta_search
 }  // namespace raft::neighbors::cagra::detail
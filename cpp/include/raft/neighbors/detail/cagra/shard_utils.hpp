@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/device_setter.hpp>
+#include <raft/util/cuda_rt_essentials.hpp>
+
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace raft::neighbors::cagra::detail {
+
+/** Enable direct (NVLink / PCIe P2P) access between every pair of the devices where possible. */
+inline void enable_peer_access(const std::vector<int>& devices)
+{
+  for (int dev : devices) {
+    device_setter scoped_device(dev);
+    for (int peer : devices) {
+      if (peer == dev) { continue; }
+      int can_access = 0;
+      RAFT_CUDA_TRY(cudaDeviceCanAccessPeer(&can_access, dev, peer));
+      if (!can_access) { continue; }
+      auto err = cudaDeviceEnablePeerAccess(peer, 0);
+      if (err == cudaErrorPeerAccessAlreadyEnabled) {
+        // Clear the sticky error state set by the call above.
+        (void)cudaGetLastError();
+      } else {
+        RAFT_CUDA_TRY(err);
+      }
+    }
+  }
+}
+
+/** Run `f(i)` for every shard `i` in its own host thread and rethrow the first exception. */
+template <typename F>
+void for_each_shard(uint32_t n_shards, F&& f)
+{
+  std::vector<std::exception_ptr> errors(n_shards);
+  std::vector<std::thread> workers;
+  workers.reserve(n_shards);
+  for (uint32_t i = 0; i < n_shards; i++) {
+    workers.emplace_back([&f, &errors, i]() {
+      try {
+        f(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  for (auto& e : errors) {
+    if (e) { std::rethrow_exception(e); }
+  }
+}
+
+}  // namespace raft::neighbors::cagra::detail
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "utils.hpp"
+
+#include <cstdint>
+
+// The incremental update of the internal top-k list of the search.
+//
+// After the first iteration the internal top-k list is sorted, and an iteration only adds the
+// small batch of the candidates (the children of the parents). Instead of selecting the top-k of
+// the whole buffer again, the candidates are sorted and merged into the list: the cost per
+// iteration is O(c log^2 c + (k + c) log(k + c)) / block_size for k itopk entries and c candidates,
+// rather than a few radix passes over the k + c entries.
+namespace raft::neighbors::cagra::detail {
+namespace topk_merge {
+
+/**
+ * Sort the keys [n] (and the values) ascending by a thread block, in shared memory.
+ *
+ * This is the bitonic network of the next power of two with only ascending comparators (the first
+ * step of a merge flips the second half), so the positions beyond `n` behave as +inf and are never
+ * accessed. It ends with a barrier.
+ */
+template <class K, class V>
+__device__ void block_bitonic_sort(K* keys, V* vals, uint32_t n)
+{
+  const uint32_t n_pow2 = n <= 1 ? 1 : 1u << (32 - __clz(n - 1));
+  for (uint32_t k = 2; k <= n_pow2; k <<= 1) {
+    for (uint32_t j = k >> 1; j > 0; j >>= 1) {
+      for (uint32_t p = threadIdx.x; p < n_pow2 / 2; p += blockDim.x) {
+        const uint32_t lo = ((p & ~(j - 1)) << 1) | (p & (j - 1));
+        const uint32_t hi = j == (k >> 1) ? lo ^ (k - 1) : lo + j;
+        if (hi < n && keys[hi] < keys[lo]) {
+          const K k_lo = keys[lo];
+          const V v_lo = vals[lo];
+          keys[lo]     = keys[hi];
+          vals[lo]     = vals[hi];
+          keys[hi]     = k_lo;
+          vals[hi]     = v_lo;
+        }
+      }
+      __syncthreads();
+    }
+  }
+}
+
+/** The number of the sorted keys [n] less than x (or not greater than x if `Inclusive`). */
+template <bool Inclusive, class K>
+__device__ inline auto count_below(const K* keys, uint32_t n, K x) -> uint32_t
+{
+  uint32_t lo = 0;
+  while (n > 0) {
+    const uint32_t half = n / 2;
+    const K v           = keys[lo + half];
+    if (Inclusive ? !(x < v) : v < x) {
+      lo += half + 1;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+  return lo;
+}
+
+/**
+ * Merge the sorted keys a [n_a] and b [n_b] by a thread block, keeping the first n_out: the
+ * rank r < n_out in the merged list of every kept element is passed to `write_a(i, r)` or
+ * `write_b(j, r)`. The ties are ordered a first. There is no barrier.
+ */
+template <class K, class WriteA, class WriteB>
+__device__ void merge(const K* a,
+                      uint32_t n_a,
+                      const K* b,
+                      uint32_t n_b,
+                      uint32_t n_out,
+                      WriteA write_a,
+                      WriteB write_b)
+{
+  // the elements past n_out in either list cannot be kept
+  n_a = min(n_a, n_out);
+  n_b = min(n_b, n_out);
+  for (uint32_t i = threadIdx.x; i < n_a; i += blockDim.x) {
+    const uint32_t r = i + count_below<false>(b, n_b, a[i]);
+    if (r < n_out) { write_a(i, r); }
+  }
+  for (uint32_t j = threadIdx.x; j < n_b; j += blockDim.x) {
+    const uint32_t r = j + count_below<true>(a, n_a, b[j]);
+    if (r < n_out) { write_b(j, r); }
+  }
+}
+
+/**
+ * The shared memory workspace of `merge_inplace` (bytes): the merged list and a counter, aligned
+ * for the indices.
+ */
+template <class DISTANCE_T, class INDEX_T>
+constexpr auto inplace_workspace_size(uint32_t itopk) -> uint32_t
+{
+  return itopk * (sizeof(DISTANCE_T) + sizeof(INDEX_T)) + sizeof(uint32_t) + alignof(INDEX_T);
+}
+
+/**
+ * Update the sorted internal top-k list [itopk] followed by the candidates [n_candidates] in
+ * shared memory (the result buffer of the single-CTA search) by a thread block.
+ *
+ * The candidates are sorted in place and merged into the list; those taken into the list are then
+ * invalidated in the candidates, so that no node appears twice in the buffer. It ends with a
+ * barrier.
+ */
+template <class DISTANCE_T, class INDEX_T>
+__device__ void merge_inplace(DISTANCE_T* distances,
+                              INDEX_T* indices,
+                              uint32_t itopk,
+                              uint32_t n_candidates,
+                              void* workspace)
+{
+  auto* cand_distances = distances + itopk;
+  auto* cand_indices   = indices + itopk;
+  block_bitonic_sort(cand_distances, cand_indices, n_candidates);
+
+  auto ws        = reinterpret_cast<uintptr_t>(workspace);
+  ws             = (ws + alignof(INDEX_T) - 1) / alignof(INDEX_T) * alignof(INDEX_T);
+  auto* out_idx  = reinterpret_cast<INDEX_T*>(ws);
+  auto* out_dist = reinterpret_cast<DISTANCE_T*>(out_idx + itopk);
+  auto* n_taken  = reinterpret_cast<uint32_t*>(out_dist + itopk);
+  if (threadIdx.x == 0) { *n_taken = 0; }
+  __syncthreads();
+  merge(
+    distances,
+    itopk,
+    cand_distances,
+    n_candidates,
+    itopk,
+    [&](uint32_t i, uint32_t r) {
+      out_dist[r] = distances[i];
+      out_idx[r]  = indices[i];
+    },
+    [&](uint32_t j, uint32_t r) {
+      out_dist[r] = cand_distances[j];
+      out_idx[r]  = cand_indices[j];
+      atomicAdd(n_taken, 1u);
+    });
+  __syncthreads();
+  // the candidates taken are the first ones of the sorted candidates
+  const uint32_t n_cand_taken = *n_taken;
+  for (uint32_t i = threadIdx.x; i < itopk; i += blockDim.x) {
+    distances[i] = out_dist[i];
+    indices[i]   = out_idx[i];
+  }
+  for (uint32_t j = threadIdx.x; j < n_cand_taken; j += blockDim.x) {
+    cand_distances[j] = utils::get_max_value<DISTANCE_T>();
+    cand_indices[j]   = utils::get_max_value<INDEX_T>();
+  }
+  __syncthreads();
+}
+
+}  // namespace topk_merge
+}  // namespace raft::neighbors::cagra::detail
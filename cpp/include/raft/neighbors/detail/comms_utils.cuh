@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/comms.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+/** The point-to-point exchanges of the indexes distributed across a comms clique. */
+namespace raft::neighbors::detail {
+
+/** Exchanges the number of elements every rank sends to every other rank (an all-to-all). */
+inline auto exchange_counts(const comms::comms_t& comms,
+                            const std::vector<size_t>& send_counts,
+                            cudaStream_t stream) -> std::vector<size_t>
+{
+  int size = comms.get_size();
+  int rank = comms.get_rank();
+  rmm::device_uvector<uint64_t> d_counts(size * size, stream);
+  raft::update_device(d_counts.data() + rank * size,
+                      reinterpret_cast<const uint64_t*>(send_counts.data()),
+                      size,
+                      stream);
+  comms.allgather(d_counts.data() + rank * size, d_counts.data(), size, stream);
+  std::vector<uint64_t> counts(size * size);
+  raft::update_host(counts.data(), d_counts.data(), size * size, stream);
+  comms.sync_stream(stream);
+  std::vector<size_t> recv_counts(size);
+  for (int s = 0; s < size; s++) {
+    recv_counts[s] = counts[s * size + rank];
+  }
+  return recv_counts;
+}
+
+/** Sends the consecutive blocks of `send` to the ranks and receives theirs into `recv`. */
+template <typename value_t>
+void all_to_all(const comms::comms_t& comms,
+                const value_t* send,
+                const std::vector<size_t>& send_counts,
+                value_t* recv,
+                const std::vector<size_t>& recv_counts,
+                size_t row_width,
+                cudaStream_t stream)
+{
+  int size = comms.get_size();
+  std::vector<size_t> send_sizes(size), send_offsets(size), recv_sizes(size), recv_offsets(size);
+  std::vector<int> ranks(size);
+  std::iota(ranks.begin(), ranks.end(), 0);
+  size_t send_offset = 0, recv_offset = 0;
+  for (int r = 0; r < size; r++) {
+    send_sizes[r]   = send_counts[r] * row_width;
+    recv_sizes[r]   = recv_counts[r] * row_width;
+    send_offsets[r] = send_offset;
+    recv_offsets[r] = recv_offset;
+    send_offset += send_sizes[r];
+    recv_offset += recv_sizes[r];
+  }
+  comms.device_multicast_sendrecv(
+    send, send_sizes, send_offsets, ranks, recv, recv_sizes, recv_offsets, ranks, stream);
+}
+
+}  // namespace raft::neighbors::detail
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/error.hpp>
+#include <raft/distance/distance_types.hpp>
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * The pieces of the FAISS binary index format (`faiss/impl/index_write.cpp`) shared by the IVF
+ * indices: the index and IVF headers, the flat coarse quantizer and the array inverted lists.
+ */
+namespace raft::neighbors::detail::faiss {
+
+/** `faiss::MetricType` */
+constexpr int32_t kMetricInnerProduct = 0;
+constexpr int32_t kMetricL2           = 1;
+
+/** The four characters tagging an object of the file, as `faiss::fourcc`. */
+constexpr auto fourcc(const char (&s)[5]) -> uint32_t
+{
+  return uint32_t(uint8_t(s[0])) | uint32_t(uint8_t(s[1])) << 8 | uint32_t(uint8_t(s[2])) << 16 |
+         uint32_t(uint8_t(s[3])) << 24;
+}
+
+inline auto fourcc_string(uint32_t h) -> std::string
+{
+  return std::string{char(h & 0xff), char((h >> 8) & 0xff), char((h >> 16) & 0xff), char(h >> 24)};
+}
+
+template <typename T>
+void write_scalar(std::ostream& os, const T& value)
+{
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+auto read_scalar(std::istream& is) -> T
+{
+  T value{};
+  is.read(reinterpret_cast<char*>(&value), sizeof(T));
+  RAFT_EXPECTS(is.good(), "Unexpected end of the FAISS index stream");
+  return value;
+}
+
+/** `WRITEVECTOR`: the number of elements (size_t), then the elements. */
+template <typename T>
+void write_vector(std::ostream& os, const T* data, size_t size)
+{
+  write_scalar<size_t>(os, size);
+  os.write(reinterpret_cast<const char*>(data), sizeof(T) * size);
+}
+
+template <typename T>
+auto read_vector(std::istream& is) -> std::vector<T>
+{
+  const auto size = read_scalar<size_t>(is);
+  std::vector<T> data(size);
+  is.read(reinterpret_cast<char*>(data.data()), sizeof(T) * size);
+  RAFT_EXPECTS(is.good(), "Unexpected end of the FAISS index stream");
+  return data;
+}
+
+inline void expect_fourcc(std::istream& is, uint32_t expected)
+{
+  const auto h = read_scalar<uint32_t>(is);
+  RAFT_EXPECTS(h == expected,
+               "Unsupported FAISS index: expected '%s', found '%s'",
+               fourcc_string(expected).c_str(),
+               fourcc_string(h).c_str());
+}
+
+/** The FAISS metric of the RAFT `metric`, which must have one. */
+inline auto to_faiss_metric(raft::distance::DistanceType metric) -> int32_t
+{
+  switch (metric) {
+    case raft::distance::DistanceType::L2Expanded:
+    case raft::distance::DistanceType::L2Unexpanded: return kMetricL2;
+    case raft::distance::DistanceType::InnerProduct: return kMetricInnerProduct;
+    default: RAFT_FAIL("The metric %d has no FAISS equivalent", int(metric));
+  }
+}
+
+inline auto from_faiss_metric(int32_t metric) -> raft::distance::DistanceType
+{
+  switch (metric) {
+    case kMetricL2: return raft::distance::DistanceType::L2Expanded;
+    case kMetricInnerProduct: return raft::distance::DistanceType::InnerProduct;
+    default: RAFT_FAIL("Unsupported FAISS metric type %d", metric);
+  }
+}
+
+/** The fields of `faiss::Index` stored in the files. */
+struct index_header {
+  int32_t d;
+  int64_t ntotal;
+  bool is_trained;
+  int32_t metric_type;
+};
+
+inline void write_index_header(std::ostream& os, const index_header& h)
+{
+  const int64_t dummy = 1 << 20;
+  write_scalar(os, h.d);
+  write_scalar(os, h.ntotal);
+  write_scalar(os, dummy);
+  write_scalar(os, dummy);
+  write_scalar(os, h.is_trained);
+  write_scalar(os, h.metric_type);
+}
+
+inline auto read_index_header(std::istream& is) -> index_header
+{
+  index_header h{};
+  h.d      = read_scalar<int32_t>(is);
+  h.ntotal = read_scalar<int64_t>(is);
+  read_scalar<int64_t>(is);
+  read_scalar<int64_t>(is);
+  h.is_trained  = read_scalar<bool>(is);
+  h.metric_type = read_scalar<int32_t>(is);
+  // `metric_arg` of the metrics other than L2 and inner product
+  if (h.metric_type > 1) { read_scalar<float>(is); }
+  return h;
+}
+
+/**
+ * The header of `faiss::IndexIVF` with an `IndexFlat` coarse quantizer holding the (row-major)
+ * `centers` [n_lists, dim], and no direct map.
+ */
+inline void write_ivf_header(std::ostream& os,
+                             const index_header& h,
+                             uint64_t n_lists,
+                             const std::vector<float>& centers)
+{
+  write_index_header(os, h);
+  write_scalar<size_t>(os, n_lists);
+  write_scalar<size_t>(os, 1);  // nprobe
+  // the quantizer
+  write_scalar(os, fourcc(h.metric_type == kMetricInnerProduct ? "IxFI" : "IxF2"));
+  write_index_header(os, index_header{h.d, int64_t(n_lists), true, h.metric_type});
+  write_vector(os, centers.data(), centers.size());
+  // the direct map: `NoMap` and an empty array
+  write_scalar<char>(os, 0);
+  write_scalar<size_t>(os, 0);
+}
+
+/** Read the header written by `write_ivf_header`, returning the centers of the quantizer. */
+inline auto read_ivf_header(std::istream& is, index_header& h, uint64_t& n_lists)
+  -> std::vector<float>
+{
+  h       = read_index_header(is);
+  n_lists = read_scalar<size_t>(is);
+  read_scalar<size_t>(is);  // nprobe
+  const auto q = read_scalar<uint32_t>(is);
+  RAFT_EXPECTS(q == fourcc("IxF2") || q == fourcc("IxFI") || q == fourcc("IxFl"),
+               "Unsupported FAISS coarse quantizer '%s'; only the flat quantizers are supported",
+               fourcc_string(q).c_str());
+  const auto qh = read_index_header(is);
+  RAFT_EXPECTS(qh.d == h.d && uint64_t(qh.ntotal) == n_lists,
+               "Inconsistent FAISS coarse quantizer");
+  auto centers = read_vector<float>(is);
+  RAFT_EXPECTS(centers.size() == n_lists * uint64_t(h.d), "Inconsistent FAISS coarse quantizer");
+  // the direct map is not used
+  const auto direct_map_type = read_scalar<char>(is);
+  read_vector<int64_t>(is);
+  if (direct_map_type == 2) { read_vector<std::pair<int64_t, int64_t>>(is); }
+  return centers;
+}
+
+/**
+ * `faiss::ArrayInvertedLists` of the lists laid out one after another: the list `l` holds the
+ * records `[offsets[l], offsets[l + 1])` of `codes` [offsets[n_lists], code_size] and `ids`.
+ */
+inline void write_inverted_lists(std::ostream& os,
+                                 uint64_t code_size,
+                                 const std::vector<int64_t>& offsets,
+                                 const uint8_t* codes,
+                                 const int64_t* ids)
+{
+  const uint64_t n_lists = offsets.size() - 1;
+  write_scalar(os, fourcc("ilar"));
+  write_scalar<size_t>(os, n_lists);
+  write_scalar<size_t>(os, code_size);
+  write_scalar(os, fourcc("full"));
+  std::vector<size_t> sizes(n_lists);
+  for (uint64_t l = 0; l < n_lists; l++) {
+    sizes[l] = offsets[l + 1] - offsets[l];
+  }
+  write_vector(os, sizes.data(), sizes.size());
+  for (uint64_t l = 0; l < n_lists; l++) {
+    if (sizes[l] == 0) { continue; }
+    os.write(reinterpret_cast<const char*>(codes + offsets[l] * code_size), sizes[l] * code_size);
+    os.write(reinterpret_cast<const char*>(ids + offsets[l]), sizes[l] * sizeof(int64_t));
+  }
+}
+
+/** Read the lists written by `write_inverted_lists` (or as sparse lists, "sprs"). */
+inline void read_inverted_lists(std::istream& is,
+                                uint64_t n_lists,
+                                uint64_t code_size,
+                                std::vector<int64_t>& offsets,
+                                std::vector<uint8_t>& codes,
+                                std::vector<int64_t>& ids)
+{
+  const auto h = read_scalar<uint32_t>(is);
+  RAFT_EXPECTS(h == fourcc("ilar"),
+               "Unsupported FAISS inverted lists '%s'; only the array inverted lists are supported",
+               fourcc_string(h).c_str());
+  RAFT_EXPECTS(read_scalar<size_t>(is) == n_lists, "Inconsistent FAISS inverted lists");
+  RAFT_EXPECTS(read_scalar<size_t>(is) == code_size, "Inconsistent FAISS inverted lists");
+  std::vector<size_t> sizes(n_lists, 0);
+  const auto list_type = read_scalar<uint32_t>(is);
+  if (list_type == fourcc("full")) {
+    sizes = read_vector<size_t>(is);
+    RAFT_EXPECTS(sizes.size() == n_lists, "Inconsistent FAISS inverted lists");
+  } else if (list_type == fourcc("sprs")) {
+    const auto pairs = read_vector<size_t>(is);
+    for (size_t i = 0; i + 1 < pairs.size(); i += 2) {
+      RAFT_EXPECTS(pairs[i] < n_lists, "Inconsistent FAISS inverted lists");
+      sizes[pairs[i]] = pairs[i + 1];
+    }
+  } else {
+    RAFT_FAIL("Unsupported FAISS inverted list type '%s'", fourcc_string(list_type).c_str());
+  }
+  offsets.resize(n_lists + 1);
+  offsets[0] = 0;
+  for (uint64_t l = 0; l < n_lists; l++) {
+    RAFT_EXPECTS(sizes[l] <= std::numeric_limits<uint32_t>::max(),
+                 "A FAISS inverted list is too large");
+    offsets[l + 1] = offsets[l] + sizes[l];
+  }
+  codes.resize(offsets[n_lists] * code_size);
+  ids.resize(offsets[n_lists]);
+  for (uint64_t l = 0; l < n_lists; l++) {
+    if (sizes[l] == 0) { continue; }
+    is.read(reinterpret_cast<char*>(codes.data() + offsets[l] * code_size), sizes[l] * code_size);
+    is.read(reinterpret_cast<char*>(ids.data() + offsets[l]), sizes[l] * sizeof(int64_t));
+  }
+  RAFT_EXPECTS(is.good(), "Unexpected end of the FAISS index stream");
+}
+
+}  // namespace raft::neighbors::detail::faiss
@@ -18,7 +18,11 @@
 
 #include "hnsw_types.hpp"
 
+#include <algorithm>
 #include <cstdint>
+#include <limits>
+#include <queue>
+#include <utility>
 #include <raft/core/host_mdspan.hpp>
 #include <raft/core/resources.hpp>
 
@@ -28,17 +32,89 @@
 
 namespace raft::neighbors::hnsw::detail {
 
+/**
+ * The `searchKnn` of the (patched) hnswlib index with the size of the candidate list passed by
+ * the caller. The `ef_` member of the index is read by all the concurrent searches, hence it is
+ * never modified.
+ */
+template <typename dist_t>
+auto search_knn(hnswlib::HierarchicalNSW<dist_t> const* idx,
+                const void* query,
+                size_t k,
+                size_t ef) -> std::priority_queue<std::pair<dist_t, hnswlib::labeltype>>
+{
+  std::priority_queue<std::pair<dist_t, hnswlib::labeltype>> result;
+  if (idx->cur_element_count == 0) { return result; }
+
+  auto dist = [idx, query](hnswlib::tableint id) {
+    return idx->fstdistfunc_(query, idx->getDataByInternalId(id), idx->dist_func_param_);
+  };
+  hnswlib::tableint curr_obj = idx->enterpoint_node_;
+  dist_t curr_dist           = dist(curr_obj);
+  if (idx->base_layer_only) {
+    // the seeds spread over the dataset
+    for (int i = 0; i < idx->num_seeds; i++) {
+      const hnswlib::tableint obj = i * (idx->max_elements_ / idx->num_seeds);
+      const dist_t d              = dist(obj);
+      if (d < curr_dist) {
+        curr_dist = d;
+        curr_obj  = obj;
+      }
+    }
+  } else {
+    // greedy descent of the upper layers
+    for (int level = idx->maxlevel_; level > 0; level--) {
+      bool changed = true;
+      while (changed) {
+        changed          = false;
+        auto* data       = idx->get_linklist(curr_obj, level);
+        const int size   = idx->getListCount(data);
+        const auto* cand = reinterpret_cast<const hnswlib::tableint*>(data + 1);
+        for (int i = 0; i < size; i++) {
+          const dist_t d = dist(cand[i]);
+          if (d < curr_dist) {
+            curr_dist = d;
+            curr_obj  = cand[i];
+            changed   = true;
+          }
+        }
+      }
+    }
+  }
+
+  auto top_candidates =
+    idx->num_deleted_
+      ? idx->template searchBaseLayerST<true, false>(curr_obj, query, std::max(ef, k))
+      : idx->template searchBaseLayerST<false, false>(curr_obj, query, std::max(ef, k));
+  while (top_candidates.size() > k) {
+    top_candidates.pop();
+  }
+  for (; !top_candidates.empty(); top_candidates.pop()) {
+    result.emplace(top_candidates.top().first,
+                   idx->getExternalLabel(top_candidates.top().second));
+  }
+  return result;
+}
+
+/**
+ * Search a single query and write the results directly into the output rows; if the index returns
+ * fewer than k results, the remaining slots are filled with the invalid index and the max distance.
+ */
 template <typename T>
 void get_search_knn_results(hnswlib::HierarchicalNSW<typename hnsw_dist_t<T>::type> const* idx,
                             const T* query,
                             int k,
+                            int ef,
                             uint64_t* indices,
                             float* distances)
 {
-  auto result = idx->searchKnn(query, k);
-  assert(result.size() >= static_cast<size_t>(k));
-
-  for (int i = k - 1; i >= 0; --i) {
+  auto result = search_knn(idx, query, k, ef);
+  for (auto i = static_cast<int>(result.size()); i < k; ++i) {
+    indices[i]   = std::numeric_limits<uint64_t>::max();
+    distances[i] = std::numeric_limits<float>::max();
+  }
+  // the results are popped from the farthest to the nearest
+  for (auto i = static_cast<int>(result.size()) - 1; i >= 0; --i) {
     indices[i]   = result.top().second;
     distances[i] = result.top().first;
     result.pop();
@@ -58,24 +134,18 @@ void search(raft::resources const& res,
       idx.get_index());
 
   // when num_threads == 0, automatically maximize parallelism
-  if (params.num_threads) {
-#pragma omp parallel for num_threads(params.num_threads)
-    for (int64_t i = 0; i < queries.extent(0); ++i) {
-      get_search_knn_results(hnswlib_index,
-                             queries.data_handle() + i * queries.extent(1),
-                             neighbors.extent(1),
-                             neighbors.data_handle() + i * neighbors.extent(1),
-                             distances.data_handle() + i * distances.extent(1));
-    }
-  } else {
-#pragma omp parallel for
-    for (int64_t i = 0; i < queries.extent(0); ++i) {
-      get_search_knn_results(hnswlib_index,
-                             queries.data_handle() + i * queries.extent(1),
-                             neighbors.extent(1),
-                             neighbors.data_handle() + i * neighbors.extent(1),
-                             distances.data_handle() + i * distances.extent(1));
-    }
+  int num_threads = params.num_threads > 0 ? params.num_threads : omp_get_max_threads();
+  auto n_queries  = queries.extent(0);
+  auto k          = static_cast<int>(neighbors.extent(1));
+  // the search time varies between the queries: balance the load dynamically
+#pragma omp parallel for num_threads(num_threads) schedule(dynamic, 8)
+  for (int64_t i = 0; i < n_queries; ++i) {
+    get_search_knn_results(hnswlib_index,
+                           queries.data_handle() + i * queries.extent(1),
+                           k,
+                           params.ef,
+                           neighbors.data_handle() + i * neighbors.extent(1),
+                           distances.data_handle() + i * distances.extent(1));
   }
 }
 
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include <hnswlib/hnswlib.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace raft::neighbors::hnsw::detail {
+
+/**
+ * @brief The squared L2 distance between two int8/uint8 vectors (the hnswlib distance function
+ * signature: the third argument points to the dimensionality as a `size_t`).
+ */
+template <typename T>
+int l2_sqr_int8_scalar(const void* a, const void* b, const void* dim_ptr)
+{
+  auto dim = *static_cast<const std::size_t*>(dim_ptr);
+  auto pa  = static_cast<const T*>(a);
+  auto pb  = static_cast<const T*>(b);
+  int res  = 0;
+  for (std::size_t i = 0; i < dim; i++) {
+    int t = static_cast<int>(pa[i]) - static_cast<int>(pb[i]);
+    res += t * t;
+  }
+  return res;
+}
+
+#if defined(__x86_64__)
+
+/** AVX2: the differences are widened to int16 and squared-accumulated with `madd`. */
+template <typename T>
+__attribute__((target("avx2"))) int l2_sqr_int8_avx2(const void* a,
+                                                     const void* b,
+                                                     const void* dim_ptr)
+{
+  auto dim      = *static_cast<const std::size_t*>(dim_ptr);
+  auto pa       = static_cast<const T*>(a);
+  auto pb       = static_cast<const T*>(b);
+  __m256i acc   = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 16 <= dim; i += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i));
+    __m256i d;
+    if constexpr (std::is_signed_v<T>) {
+      d = _mm256_sub_epi16(_mm256_cvtepi8_epi16(va), _mm256_cvtepi8_epi16(vb));
+    } else {
+      d = _mm256_sub_epi16(_mm256_cvtepu8_epi16(va), _mm256_cvtepu8_epi16(vb));
+    }
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+  }
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  sum         = _mm_hadd_epi32(sum, sum);
+  sum         = _mm_hadd_epi32(sum, sum);
+  int res     = _mm_cvtsi128_si32(sum);
+  for (; i < dim; i++) {
+    int t = static_cast<int>(pa[i]) - static_cast<int>(pb[i]);
+    res += t * t;
+  }
+  return res;
+}
+
+/** AVX-512 VNNI: the int16 differences are squared-accumulated with `vpdpwssd`. */
+template <typename T>
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) int l2_sqr_int8_avx512_vnni(
+  const void* a, const void* b, const void* dim_ptr)
+{
+  auto dim      = *static_cast<const std::size_t*>(dim_ptr);
+  auto pa       = static_cast<const T*>(a);
+  auto pb       = static_cast<const T*>(b);
+  __m512i acc   = _mm512_setzero_si512();
+  std::size_t i = 0;
+  for (; i + 32 <= dim; i += 32) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa + i));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb + i));
+    __m512i d;
+    if constexpr (std::is_signed_v<T>) {
+      d = _mm512_sub_epi16(_mm512_cvtepi8_epi16(va), _mm512_cvtepi8_epi16(vb));
+    } else {
+      d = _mm512_sub_epi16(_mm512_cvtepu8_epi16(va), _mm512_cvtepu8_epi16(vb));
+    }
+    acc = _mm512_dpwssd_epi32(acc, d, d);
+  }
+  // (a reduction via a store: `_mm512_reduce_add_epi32` trips -Wuninitialized in gcc 12 headers)
+  alignas(64) int lanes[16];
+  _mm512_store_si512(lanes, acc);
+  int res = 0;
+  for (int lane : lanes) {
+    res += lane;
+  }
+  for (; i < dim; i++) {
+    int t = static_cast<int>(pa[i]) - static_cast<int>(pb[i]);
+    res += t * t;
+  }
+  return res;
+}
+
+#endif
+
+/** The fastest int8/uint8 squared L2 distance function supported by the host CPU. */
+template <typename T>
+auto l2_sqr_int8_func() -> hnswlib::DISTFUNC<int>
+{
+#if defined(__x86_64__)
+  if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw")) {
+    return l2_sqr_int8_avx512_vnni<T>;
+  }
+  if (__builtin_cpu_supports("avx2")) { return l2_sqr_int8_avx2<T>; }
+#endif
+  return l2_sqr_int8_scalar<T>;
+}
+
+/**
+ * @brief The hnswlib L2 space of the int8/uint8 vectors, with the distance function dispatched to
+ * the widest SIMD extension of the host CPU (the hnswlib `L2SpaceI` only has scalar kernels).
+ */
+template <typename T>
+class l2_space_int8 : public hnswlib::SpaceInterface<int> {
+  static_assert(std::is_same_v<T, std::int8_t> || std::is_same_v<T, std::uint8_t>);
+
+ public:
+  explicit l2_space_int8(std::size_t dim) : dim_{dim}, dist_func_{l2_sqr_int8_func<T>()} {}
+
+  auto get_data_size() -> std::size_t override { return dim_ * sizeof(T); }
+  auto get_dist_func() -> hnswlib::DISTFUNC<int> override { return dist_func_; }
+  auto get_dist_func_param() -> void* override { return &dim_; }
+
+ private:
+  std::size_t dim_;
+  hnswlib::DISTFUNC<int> dist_func_;
+};
+
+}  // namespace raft::neighbors::hnsw::detail
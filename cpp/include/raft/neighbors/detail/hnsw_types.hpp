@@ -17,6 +17,8 @@
 #pragma once
 
 #include "../hnsw_types.hpp"
+#include "hnsw_distance.hpp"
+
 #include <memory>
 #include <raft/core/error.hpp>
 #include <raft/distance/distance_types.hpp>
@@ -57,7 +59,7 @@ template <typename T>
 struct index_impl : index<T> {
  public:
   /**
-   * @brief load a base-layer-only hnswlib index originally saved from a built CAGRA index
+   * @brief load an hnswlib index originally saved from a built CAGRA index
    *
    * @param[in] filepath path to the index
    * @param[in] dim dimensions of the training dataset
@@ -74,7 +76,7 @@ struct index_impl : index<T> {
       }
     } else if constexpr (std::is_same_v<T, std::int8_t> or std::is_same_v<T, std::uint8_t>) {
       if (metric == raft::distance::L2Expanded) {
-        space_ = std::make_unique<hnswlib::L2SpaceI<T>>(dim);
+        space_ = std::make_unique<l2_space_int8<T>>(dim);
       }
     }
 
@@ -83,7 +85,9 @@ struct index_impl : index<T> {
     appr_alg_ = std::make_unique<hnswlib::HierarchicalNSW<typename hnsw_dist_t<T>::type>>(
       space_.get(), filepath);
 
-    appr_alg_->base_layer_only = true;
+    // An index exported without the upper layers is searched from the seeds spread over the
+    // dataset; a hierarchical one from its entry point.
+    appr_alg_->base_layer_only = appr_alg_->element_levels_[appr_alg_->enterpoint_node_] == 0;
   }
 
   /**
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/math.hpp>
+#include <raft/core/mdspan.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/core/serialize.hpp>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <cub/cub.cuh>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+namespace raft::neighbors::detail {
+
+/*
+ * The compression of the id arrays of the indices (the neighbor ids of a graph, the source ids of
+ * an IVF list), on the GPU at both ends:
+ *
+ *   the ids are cut in blocks of kIdCodecBlock; every block stores a reference and the width in
+ *   bits of its largest residual, and the residuals are bit-packed at that width. The residuals
+ *   are either the ids minus the smallest id of the block (frame of reference, for ids of a small
+ *   range such as graph neighbors), or the zigzag-coded differences of consecutive ids (delta,
+ *   for the nearly sorted ids of the IVF lists).
+ *
+ * The stream holds the NumPy records [n: uint64][delta: bool] and, unless n == 0,
+ * [references: uint64, n_blocks][bit widths: uint8, n_blocks][payload: uint32 words]; the word
+ * offsets of the blocks follow from the widths.
+ */
+
+constexpr uint32_t kIdCodecBlock   = 1024;
+constexpr int kIdCodecThreads      = 256;
+constexpr uint32_t kIdCodecPerItem = kIdCodecBlock / kIdCodecThreads;
+
+template <typename T>
+__device__ inline auto id_codec_to_bits(T id) -> uint64_t
+{
+  return uint64_t(std::make_unsigned_t<T>(id));
+}
+
+__device__ inline auto id_codec_zigzag(uint64_t d) -> uint64_t
+{
+  return (d << 1) ^ uint64_t(int64_t(d) >> 63);
+}
+
+__device__ inline auto id_codec_unzigzag(uint64_t z) -> uint64_t
+{
+  return (z >> 1) ^ (~(z & 1) + 1);
+}
+
+/** The number of ids of the block of this CUDA block. */
+template <typename IdxT>
+__device__ inline auto id_codec_block_len(IdxT n) -> uint32_t
+{
+  return uint32_t(raft::min(IdxT(kIdCodecBlock), n - IdxT(blockIdx.x) * kIdCodecBlock));
+}
+
+/** The residual of the id `j` of a block starting at `block_ids`. */
+template <typename T>
+__device__ inline auto id_codec_residual(const T* block_ids, uint32_t j, bool delta, uint64_t ref)
+  -> uint64_t
+{
+  uint64_t u = id_codec_to_bits(block_ids[j]);
+  if (!delta) { return u - ref; }
+  return j == 0 ? 0 : id_codec_zigzag(u - id_codec_to_bits(block_ids[j - 1]));
+}
+
+/** The reference and the bit width of every block; one CUDA block per block of ids. */
+template <typename T, typename IdxT>
+RAFT_KERNEL id_codec_stats_kernel(const T* ids, IdxT n, bool delta, uint64_t* refs, uint8_t* bits)
+{
+  using reduce_t = cub::BlockReduce<uint64_t, kIdCodecThreads>;
+  __shared__ typename reduce_t::TempStorage temp;
+  __shared__ uint64_t s_ref;
+  const T* block_ids = ids + IdxT(blockIdx.x) * kIdCodecBlock;
+  uint32_t len       = id_codec_block_len(n);
+
+  if (delta) {
+    if (threadIdx.x == 0) { s_ref = id_codec_to_bits(block_ids[0]); }
+  } else {
+    uint64_t local_min = ~uint64_t(0);
+    for (uint32_t j = threadIdx.x; j < len; j += kIdCodecThreads) {
+      local_min = raft::min(local_min, id_codec_to_bits(block_ids[j]));
+    }
+    uint64_t block_min = reduce_t(temp).Reduce(local_min, cub::Min());
+    if (threadIdx.x == 0) { s_ref = block_min; }
+  }
+  __syncthreads();
+  uint64_t ref       = s_ref;
+  uint64_t local_max = 0;
+  for (uint32_t j = threadIdx.x; j < len; j += kIdCodecThreads) {
+    local_max = raft::max(local_max, id_codec_residual(block_ids, j, delta, ref));
+  }
+  uint64_t block_max = reduce_t(temp).Reduce(local_max, cub::Max());
+  if (threadIdx.x == 0) {
+    refs[blockIdx.x] = ref;
+    bits[blockIdx.x] = uint8_t(block_max == 0 ? 0 : 64 - __clzll(block_max));
+  }
+}
+
+/** Bit-pack the residuals of every block into its words (zeroed on entry). */
+template <typename T, typename IdxT>
+RAFT_KERNEL id_codec_pack_kernel(const T* ids,
+                                 IdxT n,
+                                 bool delta,
+                                 const uint64_t* refs,
+                                 const uint8_t* bits,
+                                 const uint64_t* offsets,
+                                 uint32_t* payload)
+{
+  const T* block_ids = ids + IdxT(blockIdx.x) * kIdCodecBlock;
+  uint32_t len       = id_codec_block_len(n);
+  uint32_t width     = bits[blockIdx.x];
+  if (width == 0) { return; }
+  uint32_t* words = payload + offsets[blockIdx.x];
+  for (uint32_t j = threadIdx.x; j < len; j += kIdCodecThreads) {
+    uint64_t r   = id_codec_residual(block_ids, j, delta, refs[blockIdx.x]);
+    uint64_t pos = uint64_t(j) * width;
+    // a residual spans up to three words, shared with its neighbors
+    for (uint32_t done = 0; done < width;) {
+      uint32_t shift = uint32_t((pos + done) % 32);
+      uint32_t take  = raft::min(32 - shift, width - done);
+      uint64_t part  = (r >> done) & ((uint64_t(1) << take) - 1);
+      atomicOr(words + (pos + done) / 32, uint32_t(part << shift));
+      done += take;
+    }
+  }
+}
+
+/**
+ * Unpack the ids of every block; the deltas are summed by a scan over the block, every thread
+ * holding kIdCodecPerItem consecutive ids.
+ */
+template <typename T, typename IdxT>
+RAFT_KERNEL id_codec_unpack_kernel(const uint32_t* payload,
+                                   IdxT n,
+                                   bool delta,
+                                   const uint64_t* refs,
+                                   const uint8_t* bits,
+                                   const uint64_t* offsets,
+                                   T* ids)
+{
+  using scan_t = cub::BlockScan<uint64_t, kIdCodecThreads>;
+  __shared__ typename scan_t::TempStorage temp;
+  T* block_ids       = ids + IdxT(blockIdx.x) * kIdCodecBlock;
+  uint32_t len       = id_codec_block_len(n);
+  uint32_t width     = bits[blockIdx.x];
+  uint64_t ref       = refs[blockIdx.x];
+  const uint32_t* wd = payload + offsets[blockIdx.x];
+
+  uint64_t values[kIdCodecPerItem];
+  uint64_t local_sum = 0;
+  for (uint32_t k = 0; k < kIdCodecPerItem; k++) {
+    uint32_t j = threadIdx.x * kIdCodecPerItem + k;
+    uint64_t r = 0;
+    if (j < len) {
+      uint64_t pos = uint64_t(j) * width;
+      for (uint32_t done = 0; done < width;) {
+        uint32_t shift = uint32_t((pos + done) % 32);
+        uint32_t take  = raft::min(32 - shift, width - done);
+        uint64_t part  = (uint64_t(wd[(pos + done) / 32]) >> shift) & ((uint64_t(1) << take) - 1);
+        r |= part << done;
+        done += take;
+      }
+    }
+    values[k] = delta ? id_codec_unzigzag(r) : r;
+    local_sum += values[k];
+  }
+  // the sums are modulo 2^64, as the differences they undo
+  uint64_t prefix = 0;
+  if (delta) { scan_t(temp).ExclusiveSum(local_sum, prefix); }
+  for (uint32_t k = 0; k < kIdCodecPerItem; k++) {
+    uint32_t j = threadIdx.x * kIdCodecPerItem + k;
+    if (delta) { prefix += values[k]; }
+    if (j < len) {
+      using bits_t = std::make_unsigned_t<T>;
+      block_ids[j] = T(bits_t(ref + (delta ? prefix : values[k])));
+    }
+  }
+}
+
+/** The word offsets of the blocks [n_blocks + 1], from their bit widths. */
+template <typename IdxT>
+auto id_codec_offsets(const uint8_t* h_bits, IdxT n, IdxT n_blocks)
+  -> raft::host_vector<uint64_t, IdxT>
+{
+  auto offsets = raft::make_host_vector<uint64_t, IdxT>(n_blocks + 1);
+  offsets(0)   = 0;
+  for (IdxT b = 0; b < n_blocks; b++) {
+    uint64_t len   = std::min<uint64_t>(kIdCodecBlock, uint64_t(n) - uint64_t(b) * kIdCodecBlock);
+    offsets(b + 1) = offsets(b) + raft::div_rounding_up_safe<uint64_t>(len * h_bits[b], 32);
+  }
+  return offsets;
+}
+
+/**
+ * Write an array of ids in the compressed form (see above).
+ *
+ * @param[in] res the raft handle
+ * @param[in] os the output stream
+ * @param[in] ids the device ids
+ * @param[in] delta whether to code the differences of consecutive ids (for nearly sorted ids)
+ *   instead of the offsets to the smallest id of every block
+ */
+template <typename T, typename IdxT>
+void serialize_ids_compressed(raft::resources const& res,
+                              std::ostream& os,
+                              raft::device_vector_view<const T, IdxT> ids,
+                              bool delta)
+{
+  static_assert(std::is_integral_v<T>, "Only the integer ids can be compressed");
+  auto stream = resource::get_cuda_stream(res);
+  IdxT n      = ids.extent(0);
+  serialize_scalar(res, os, uint64_t(n));
+  serialize_scalar(res, os, delta);
+  if (n == 0) { return; }
+
+  IdxT n_blocks = raft::div_rounding_up_safe<IdxT>(n, kIdCodecBlock);
+  auto refs     = raft::make_device_vector<uint64_t, IdxT>(res, n_blocks);
+  auto bits     = raft::make_device_vector<uint8_t, IdxT>(res, n_blocks);
+  dim3 grid(uint32_t(n_blocks));
+  id_codec_stats_kernel<T, IdxT><<<grid, kIdCodecThreads, 0, stream>>>(
+    ids.data_handle(), n, delta, refs.data_handle(), bits.data_handle());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  auto h_bits = raft::make_host_vector<uint8_t, IdxT>(n_blocks);
+  raft::copy(h_bits.data_handle(), bits.data_handle(), n_blocks, stream);
+  resource::sync_stream(res);
+
+  auto offsets   = id_codec_offsets(h_bits.data_handle(), n, n_blocks);
+  auto d_offsets = raft::make_device_vector<uint64_t, IdxT>(res, n_blocks + 1);
+  raft::copy(d_offsets.data_handle(), offsets.data_handle(), n_blocks + 1, stream);
+  auto payload = raft::make_device_vector<uint32_t, int64_t>(res, int64_t(offsets(n_blocks)));
+  RAFT_CUDA_TRY(
+    cudaMemsetAsync(payload.data_handle(), 0, payload.size() * sizeof(uint32_t), stream));
+  id_codec_pack_kernel<T, IdxT><<<grid, kIdCodecThreads, 0, stream>>>(ids.data_handle(),
+                                                                     n,
+                                                                     delta,
+                                                                     refs.data_handle(),
+                                                                     bits.data_handle(),
+                                                                     d_offsets.data_handle(),
+                                                                     payload.data_handle());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+  serialize_mdspan(res, os, raft::make_const_mdspan(refs.view()));
+  serialize_mdspan(res, os, raft::make_const_mdspan(h_bits.view()));
+  serialize_mdspan(res, os, raft::make_const_mdspan(payload.view()));
+}
+
+/**
+ * Read an array of ids written by serialize_ids_compressed, decoding it on the device.
+ *
+ * @param[in] res the raft handle
+ * @param[in] is the input stream
+ * @param[out] ids the device ids, of the serialized size
+ */
+template <typename T, typename IdxT>
+void deserialize_ids_compressed(raft::resources const& res,
+                                std::istream& is,
+                                raft::device_vector_view<T, IdxT> ids)
+{
+  static_assert(std::is_integral_v<T>, "Only the integer ids can be compressed");
+  auto stream = resource::get_cuda_stream(res);
+  auto n      = deserialize_scalar<uint64_t>(res, is);
+  auto delta  = deserialize_scalar<bool>(res, is);
+  RAFT_EXPECTS(n == uint64_t(ids.extent(0)),
+               "Expected %zu compressed ids but got %zu",
+               size_t(ids.extent(0)),
+               size_t(n));
+  if (n == 0) { return; }
+
+  IdxT n_blocks = raft::div_rounding_up_safe<IdxT>(IdxT(n), kIdCodecBlock);
+  auto refs     = raft::make_device_vector<uint64_t, IdxT>(res, n_blocks);
+  auto h_bits   = raft::make_host_vector<uint8_t, IdxT>(n_blocks);
+  deserialize_mdspan(res, is, refs.view());
+  deserialize_mdspan(res, is, h_bits.view());
+  auto offsets   = id_codec_offsets(h_bits.data_handle(), IdxT(n), n_blocks);
+  auto bits      = raft::make_device_vector<uint8_t, IdxT>(res, n_blocks);
+  auto d_offsets = raft::make_device_vector<uint64_t, IdxT>(res, n_blocks + 1);
+  raft::copy(bits.data_handle(), h_bits.data_handle(), n_blocks, stream);
+  raft::copy(d_offsets.data_handle(), offsets.data_handle(), n_blocks + 1, stream);
+  auto payload = raft::make_device_vector<uint32_t, int64_t>(res, int64_t(offsets(n_blocks)));
+  deserialize_mdspan(res, is, payload.view());
+
+  dim3 grid(uint32_t(n_blocks));
+  id_codec_unpack_kernel<T, IdxT><<<grid, kIdCodecThreads, 0, stream>>>(payload.data_handle(),
+                                                                       IdxT(n),
+                                                                       delta,
+                                                                       refs.data_handle(),
+                                                                       bits.data_handle(),
+                                                                       d_offsets.data_handle(),
+                                                                       ids.data_handle());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  // the host copies of the widths and offsets must outlive their transfers
+  resource::sync_stream(res);
+}
+
+/**
+ * Write an IVF list like ivf::serialize_list, with the first `n_ids` source ids compressed (by
+ * deltas); the rest of the indices, if any, is the padding filled with kInvalidRecord.
+ */
+template <typename ListT>
+void serialize_list_compressed(const raft::resources& handle,
+                               std::ostream& os,
+                               const std::shared_ptr<ListT>& ld,
+                               const typename ListT::spec_type& store_spec,
+                               typename ListT::size_type size,
+                               typename ListT::size_type n_ids)
+{
+  using size_type  = typename ListT::size_type;
+  using value_type = const typename ListT::value_type;
+  using index_type = const typename ListT::index_type;
+  if (!ld) { size = 0; }
+  serialize_scalar(handle, os, size);
+  if (size == 0) { return; }
+
+  auto data_extents = store_spec.make_list_extents(size);
+  auto data_view    = make_mdspan<value_type, size_type, row_major, false, true>(
+    ld->data.data_handle(), data_extents);
+  serialize_mdspan(handle, os, data_view);
+  serialize_scalar(handle, os, n_ids);
+  serialize_ids_compressed(
+    handle,
+    os,
+    raft::make_device_vector_view<index_type, size_type>(ld->indices.data_handle(), n_ids),
+    true);
+}
+
+/** Read an IVF list written by serialize_list_compressed. */
+template <typename ListT>
+void deserialize_list_compressed(const raft::resources& handle,
+                                 std::istream& is,
+                                 std::shared_ptr<ListT>& ld,
+                                 const typename ListT::spec_type& store_spec,
+                                 const typename ListT::spec_type& device_spec)
+{
+  using size_type  = typename ListT::size_type;
+  using value_type = typename ListT::value_type;
+  using index_type = typename ListT::index_type;
+  auto size        = deserialize_scalar<size_type>(handle, is);
+  if (size == 0) { return ld.reset(); }
+  std::make_shared<ListT>(handle, device_spec, size).swap(ld);
+  auto data_extents = store_spec.make_list_extents(size);
+  auto data_view    = make_mdspan<value_type, size_type, row_major, false, true>(
+    ld->data.data_handle(), data_extents);
+  deserialize_mdspan(handle, is, data_view);
+  // NB: the ids past the compressed ones keep their kInvalidRecord.
+  auto n_ids = deserialize_scalar<size_type>(handle, is);
+  RAFT_EXPECTS(n_ids <= size, "Corrupt compressed ids of an IVF list");
+  deserialize_ids_compressed(
+    handle,
+    is,
+    raft::make_device_vector_view<index_type, size_type>(ld->indices.data_handle(), n_ids));
+}
+
+}  // namespace raft::neighbors::detail
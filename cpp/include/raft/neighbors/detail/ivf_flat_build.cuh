@@ -21,11 +21,18 @@
 #include <raft/core/mdarray.hpp>
 #include <raft/core/nvtx.hpp>
 #include <raft/core/operators.hpp>
+#include <raft/core/resource/cancellation_token.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/linalg/add.cuh>
 #include <raft/linalg/map.cuh>
 #include <raft/linalg/norm.cuh>
+#include <raft/matrix/detail/sample_rows.cuh>
+#include <raft/neighbors/detail/ivf_flat_normalize.cuh>
+#include <raft/neighbors/detail/ivf_list_removal.cuh>
 #include <raft/neighbors/ivf_flat_codepacker.hpp>
 #include <raft/neighbors/ivf_flat_types.hpp>
 #include <raft/neighbors/ivf_list.hpp>
@@ -36,7 +43,13 @@
 
 #include <rmm/cuda_stream_view.hpp>
 
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/scan.h>
+
 #include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace raft::neighbors::ivf_flat::detail {
 
@@ -179,9 +192,16 @@ void extend(raft::resources const& handle,
   RAFT_EXPECTS(new_indices != nullptr || index->size() == 0,
                "You must pass data indices when the index is non-empty.");
 
+  // The vectors of a CosineExpanded index are stored normalized, and they are assigned to the
+  // (normalized) centers by the inner product.
+  const bool normalize = is_normalized_metric(index->metric());
+  if constexpr (!std::is_same_v<T, float> && !std::is_same_v<T, half>) {
+    RAFT_EXPECTS(!normalize, "The CosineExpanded metric requires the floating-point vectors");
+  }
+
   auto new_labels = raft::make_device_vector<LabelT, IdxT>(handle, n_rows);
   raft::cluster::kmeans_balanced_params kmeans_params;
-  kmeans_params.metric = index->metric();
+  kmeans_params.metric = normalize ? raft::distance::DistanceType::InnerProduct : index->metric();
   auto orig_centroids_view =
     raft::make_device_matrix_view<const float, IdxT>(index->centers().data_handle(), n_lists, dim);
   // Calculate the batch size for the input data if it's not accessible directly from the device
@@ -189,16 +209,37 @@ void extend(raft::resources const& handle,
   size_t max_batch_size                    = std::min<size_t>(n_rows, kReasonableMaxBatchSize);
 
   // Predict the cluster labels for the new data, in batches if necessary
+  // If the resources have a stream pool, the batches of the input data which is not accessible
+  // directly from the device are prefetched in one of its streams (double-buffered)
+  auto prefetch_stream = resource::is_stream_pool_initialized(handle)
+                           ? std::make_optional(resource::get_stream_from_stream_pool(handle))
+                           : std::nullopt;
   utils::batch_load_iterator<T> vec_batches(new_vectors,
                                             n_rows,
                                             index->dim(),
                                             max_batch_size,
                                             stream,
-                                            resource::get_workspace_resource(handle));
+                                            resource::get_workspace_resource(handle),
+                                            resource::get_pinned_memory_resource(handle),
+                                            prefetch_stream);
+  rmm::device_uvector<T> normalized_batch(normalize ? max_batch_size * index->dim() : 0,
+                                          stream,
+                                          resource::get_workspace_resource(handle));
+  auto batch_data = [&](const auto& batch) -> const T* {
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, half>) {
+      if (normalize) {
+        normalize_rows<T>(
+          handle, batch.data(), normalized_batch.data(), batch.size(), index->dim());
+        return normalized_batch.data();
+      }
+    }
+    return batch.data();
+  };
 
   for (const auto& batch : vec_batches) {
+    resource::check_cancellation(handle);
     auto batch_data_view =
-      raft::make_device_matrix_view<const T, IdxT>(batch.data(), batch.size(), index->dim());
+      raft::make_device_matrix_view<const T, IdxT>(batch_data(batch), batch.size(), index->dim());
     auto batch_labels_view = raft::make_device_vector_view<LabelT, IdxT>(
       new_labels.data_handle() + batch.offset(), batch.size());
     raft::cluster::kmeans_balanced::predict(handle,
@@ -221,8 +262,8 @@ void extend(raft::resources const& handle,
       raft::make_device_vector_view<std::remove_pointer_t<decltype(list_sizes_ptr)>, IdxT>(
         list_sizes_ptr, n_lists);
     for (const auto& batch : vec_batches) {
-      auto batch_data_view =
-        raft::make_device_matrix_view<const T, IdxT>(batch.data(), batch.size(), index->dim());
+      auto batch_data_view = raft::make_device_matrix_view<const T, IdxT>(
+        batch_data(batch), batch.size(), index->dim());
       auto batch_labels_view = raft::make_device_vector_view<const LabelT, IdxT>(
         new_labels.data_handle() + batch.offset(), batch.size());
       raft::cluster::kmeans_balanced::helpers::calc_centers_and_sizes(handle,
@@ -233,6 +274,10 @@ void extend(raft::resources const& handle,
                                                                       false,
                                                                       utils::mapping<float>{});
     }
+    if (normalize) {
+      normalize_rows<float>(
+        handle, index->centers().data_handle(), index->centers().data_handle(), n_lists, dim);
+    }
   } else {
     raft::stats::histogram<uint32_t, IdxT>(raft::stats::HistTypeAuto,
                                            reinterpret_cast<int32_t*>(list_sizes_ptr),
@@ -267,14 +312,21 @@ void extend(raft::resources const& handle,
   // we'll rebuild the `list_sizes_ptr` in the following kernel, using it as an atomic counter.
   raft::copy(list_sizes_ptr, old_list_sizes_dev.data_handle(), n_lists, stream);
 
-  utils::batch_load_iterator<IdxT> vec_indices(
-    new_indices, n_rows, 1, max_batch_size, stream, resource::get_workspace_resource(handle));
+  utils::batch_load_iterator<IdxT> vec_indices(new_indices,
+                                               n_rows,
+                                               1,
+                                               max_batch_size,
+                                               stream,
+                                               resource::get_workspace_resource(handle),
+                                               resource::get_pinned_memory_resource(handle),
+                                               prefetch_stream);
   utils::batch_load_iterator<IdxT> idx_batch = vec_indices.begin();
   size_t next_report_offset                  = 0;
   size_t d_report_offset                     = n_rows * 5 / 100;
   for (const auto& batch : vec_batches) {
+    resource::check_cancellation(handle);
     auto batch_data_view =
-      raft::make_device_matrix_view<const T, IdxT>(batch.data(), batch.size(), index->dim());
+      raft::make_device_matrix_view<const T, IdxT>(batch_data(batch), batch.size(), index->dim());
     // Kernel to insert the new vectors
     const dim3 block_dim(256);
     const dim3 grid_dim(raft::ceildiv<IdxT>(batch.size(), block_dim.x));
@@ -349,7 +401,8 @@ inline auto build(raft::resources const& handle,
   auto stream = resource::get_cuda_stream(handle);
   common::nvtx::range<common::nvtx::domain::raft> fun_scope(
     "ivf_flat::build(%zu, %u)", size_t(n_rows), dim);
-  static_assert(std::is_same_v<T, float> || std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>,
+  static_assert(std::is_same_v<T, float> || std::is_same_v<T, half> ||
+                  std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>,
                 "unsupported data type");
   RAFT_EXPECTS(n_rows > 0 && dim > 0, "empty dataset");
   RAFT_EXPECTS(n_rows >= params.n_lists, "number of rows can't be less than n_lists");
@@ -365,24 +418,40 @@ inline auto build(raft::resources const& handle,
       1, n_rows / std::max<size_t>(params.kmeans_trainset_fraction * n_rows, index.n_lists()));
     auto n_rows_train = n_rows / trainset_ratio;
     rmm::device_uvector<T> trainset(n_rows_train * index.dim(), stream);
-    // TODO: a proper sampling
-    RAFT_CUDA_TRY(cudaMemcpy2DAsync(trainset.data(),
-                                    sizeof(T) * index.dim(),
-                                    dataset,
-                                    sizeof(T) * index.dim() * trainset_ratio,
-                                    sizeof(T) * index.dim(),
-                                    n_rows_train,
-                                    cudaMemcpyDefault,
-                                    stream));
+    raft::random::RngState random_state{137};
+    raft::matrix::detail::sample_rows<T, IdxT>(handle,
+                                               random_state,
+                                               dataset,
+                                               n_rows,
+                                               IdxT(index.dim()),
+                                               trainset.data(),
+                                               IdxT(n_rows_train));
+    // The cosine clustering is the spherical k-means: L2 on the normalized trainset, with the
+    // centers normalized after training.
+    const bool normalize = is_normalized_metric(index.metric());
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, half>) {
+      if (normalize) {
+        normalize_rows<T>(handle, trainset.data(), trainset.data(), n_rows_train, index.dim());
+      }
+    } else {
+      RAFT_EXPECTS(!normalize, "The CosineExpanded metric requires the floating-point vectors");
+    }
     auto trainset_const_view =
       raft::make_device_matrix_view<const T, IdxT>(trainset.data(), n_rows_train, index.dim());
     auto centers_view = raft::make_device_matrix_view<float, IdxT>(
       index.centers().data_handle(), index.n_lists(), index.dim());
     raft::cluster::kmeans_balanced_params kmeans_params;
     kmeans_params.n_iters = params.kmeans_n_iters;
-    kmeans_params.metric  = index.metric();
+    kmeans_params.metric  = normalize ? raft::distance::DistanceType::L2Expanded : index.metric();
     raft::cluster::kmeans_balanced::fit(
       handle, kmeans_params, trainset_const_view, centers_view, utils::mapping<float>{});
+    if (normalize) {
+      normalize_rows<float>(handle,
+                            index.centers().data_handle(),
+                            index.centers().data_handle(),
+                            index.n_lists(),
+                            index.dim());
+    }
   }
 
   // add the data if necessary
@@ -408,6 +477,9 @@ inline auto build(raft::resources const& handle,
  *   not known to this function, but each candidate_idx has to be smaller than n_rows.
  * @param[in] candidate_idx device pointer to neighbor candidates, size [n_queries, n_candidates]
  * @param[in] n_candidates  of neighbor_candidates
+ * @param[in] dataset_is_gathered whether `dataset` already holds the candidate vectors in the order
+ *   of `candidate_idx`, size [n_queries * n_candidates, dim] (e.g. gathered from the host memory);
+ *   the candidate indices are still recorded in the index.
  */
 template <typename T, typename IdxT>
 inline void fill_refinement_index(raft::resources const& handle,
@@ -415,7 +487,8 @@ inline void fill_refinement_index(raft::resources const& handle,
                                   const T* dataset,
                                   const IdxT* candidate_idx,
                                   IdxT n_queries,
-                                  uint32_t n_candidates)
+                                  uint32_t n_candidates,
+                                  bool dataset_is_gathered = false)
 {
   using LabelT = uint32_t;
 
@@ -448,16 +521,18 @@ inline void fill_refinement_index(raft::resources const& handle,
 
   const dim3 block_dim(256);
   const dim3 grid_dim(raft::ceildiv<IdxT>(n_queries * n_candidates, block_dim.x));
-  build_index_kernel<T, IdxT, LabelT, true>
-    <<<grid_dim, block_dim, 0, stream>>>(new_labels.data(),
-                                         dataset,
-                                         candidate_idx,
-                                         refinement_index->data_ptrs().data_handle(),
-                                         refinement_index->inds_ptrs().data_handle(),
-                                         list_sizes_ptr,
-                                         n_queries * n_candidates,
-                                         refinement_index->dim(),
-                                         refinement_index->veclen());
+  auto kernel = dataset_is_gathered ? build_index_kernel<T, IdxT, LabelT, false>
+                                    : build_index_kernel<T, IdxT, LabelT, true>;
+  kernel<<<grid_dim, block_dim, 0, stream>>>(new_labels.data(),
+                                             dataset,
+                                             candidate_idx,
+                                             refinement_index->data_ptrs().data_handle(),
+                                             refinement_index->inds_ptrs().data_handle(),
+                                             list_sizes_ptr,
+                                             n_queries * n_candidates,
+                                             refinement_index->dim(),
+                                             refinement_index->veclen(),
+                                             IdxT{0});
   RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
 
@@ -532,4 +607,185 @@ void unpack_list_data(
   RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
 
+/**
+ * Copy the records of all lists from/to the flat `codes` [size, dim] and `indices` [size] laid out
+ * list by list, as given by `offsets` [n_lists + 1]: a thread per `veclen` chunk of a record.
+ */
+template <bool Pack, typename T, typename IdxT>
+RAFT_KERNEL convert_all_lists_kernel(T* const* data_ptrs,
+                                     IdxT* const* inds_ptrs,
+                                     const int64_t* offsets,
+                                     uint32_t n_lists,
+                                     uint32_t dim,
+                                     uint32_t veclen,
+                                     std::conditional_t<Pack, const T*, T*> codes,
+                                     std::conditional_t<Pack, const IdxT*, IdxT*> indices)
+{
+  using interleaved_group = neighbors::detail::div_utils<kIndexGroupSize>;
+  const uint32_t n_chunks = dim / veclen;
+  const int64_t tid       = int64_t(blockIdx.x) * int64_t(blockDim.x) + int64_t(threadIdx.x);
+  const int64_t row       = tid / n_chunks;
+  const uint32_t l        = (tid % n_chunks) * veclen;
+  if (row >= offsets[n_lists]) { return; }
+  const auto label  = ivf::find_list(offsets, n_lists, row);
+  const uint32_t ix = row - offsets[label];
+
+  auto* block = data_ptrs[label] + size_t(interleaved_group::roundDown(ix)) * dim +
+                l * kIndexGroupSize + interleaved_group::mod(ix) * veclen;
+  auto* flat = codes + row * dim + l;
+  for (uint32_t j = 0; j < veclen; j++) {
+    if constexpr (Pack) {
+      block[j] = flat[j];
+    } else {
+      flat[j] = block[j];
+    }
+  }
+  if (l == 0) {
+    if constexpr (Pack) {
+      inds_ptrs[label][ix] = indices[row];
+    } else {
+      indices[row] = inds_ptrs[label][ix];
+    }
+  }
+}
+
+template <bool Pack, typename T, typename IdxT>
+void convert_all_lists(raft::resources const& res,
+                       const index<T, IdxT>& index,
+                       std::conditional_t<Pack, const T*, T*> codes,
+                       std::conditional_t<Pack, const IdxT*, IdxT*> indices,
+                       const int64_t* list_offsets,
+                       int64_t n_rows)
+{
+  const uint32_t n_chunks = index.dim() / index.veclen();
+  const int64_t n_threads = n_rows * n_chunks;
+  if (n_threads == 0) { return; }
+  static constexpr uint32_t kBlockSize = 256;
+  dim3 blocks(div_rounding_up_safe<int64_t>(n_threads, kBlockSize), 1, 1);
+  dim3 threads(kBlockSize, 1, 1);
+  convert_all_lists_kernel<Pack, T, IdxT>
+    <<<blocks, threads, 0, resource::get_cuda_stream(res)>>>(index.data_ptrs().data_handle(),
+                                                              index.inds_ptrs().data_handle(),
+                                                              list_offsets,
+                                                              index.n_lists(),
+                                                              index.dim(),
+                                                              index.veclen(),
+                                                              codes,
+                                                              indices);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/** See the public interface `ivf_flat::helpers::unpack_all_lists`. */
+template <typename T, typename IdxT>
+void unpack_all_lists(raft::resources const& res,
+                      const index<T, IdxT>& index,
+                      device_matrix_view<T, int64_t, row_major> codes,
+                      device_vector_view<IdxT, int64_t> indices,
+                      device_vector_view<int64_t, int64_t> list_offsets)
+{
+  const int64_t n_rows = index.size();
+  RAFT_EXPECTS(list_offsets.extent(0) == int64_t(index.n_lists()) + 1,
+               "list_offsets must have n_lists + 1 elements");
+  RAFT_EXPECTS(codes.extent(0) == n_rows && codes.extent(1) == int64_t(index.dim()),
+               "codes must be a [index.size(), index.dim()] matrix");
+  RAFT_EXPECTS(indices.extent(0) == n_rows, "indices must have index.size() elements");
+  auto stream = resource::get_cuda_stream(res);
+  RAFT_CUDA_TRY(cudaMemsetAsync(list_offsets.data_handle(), 0, sizeof(int64_t), stream));
+  auto sizes = thrust::make_transform_iterator(index.list_sizes().data_handle(),
+                                               raft::cast_op<int64_t>{});
+  thrust::inclusive_scan(resource::get_thrust_policy(res),
+                         sizes,
+                         sizes + index.n_lists(),
+                         list_offsets.data_handle() + 1);
+  convert_all_lists<false>(
+    res, index, codes.data_handle(), indices.data_handle(), list_offsets.data_handle(), n_rows);
+}
+
+/** See the public interface `ivf_flat::helpers::pack_all_lists`. */
+template <typename T, typename IdxT>
+void pack_all_lists(raft::resources const& res,
+                    index<T, IdxT>* index,
+                    device_matrix_view<const T, int64_t, row_major> codes,
+                    device_vector_view<const IdxT, int64_t> indices,
+                    device_vector_view<const int64_t, int64_t> list_offsets)
+{
+  const uint32_t n_lists = index->n_lists();
+  RAFT_EXPECTS(list_offsets.extent(0) == int64_t(n_lists) + 1,
+               "list_offsets must have n_lists + 1 elements");
+  RAFT_EXPECTS(codes.extent(1) == int64_t(index->dim()), "codes must have index.dim() columns");
+  RAFT_EXPECTS(indices.extent(0) == codes.extent(0), "codes and indices must have the same size");
+  auto stream = resource::get_cuda_stream(res);
+  std::vector<int64_t> offsets(n_lists + 1);
+  copy(offsets.data(), list_offsets.data_handle(), n_lists + 1, stream);
+  resource::sync_stream(res);
+  RAFT_EXPECTS(offsets[0] == 0 && offsets[n_lists] == codes.extent(0),
+               "list_offsets must span all rows of codes");
+
+  // Allocate the lists to the exact sizes
+  std::vector<uint32_t> sizes(n_lists);
+  list_spec<uint32_t, T, IdxT> spec{index->dim(), index->conservative_memory_allocation()};
+  auto& lists = index->lists();
+  for (uint32_t label = 0; label < n_lists; label++) {
+    const auto size = offsets[label + 1] - offsets[label];
+    RAFT_EXPECTS(size >= 0 && size <= std::numeric_limits<uint32_t>::max(),
+                 "list_offsets must be non-decreasing, with lists of up to 2^32-1 records");
+    sizes[label] = size;
+    if (size == 0) {
+      lists[label].reset();
+    } else {
+      lists[label] = std::make_shared<list_data<T, IdxT>>(res, spec, sizes[label]);
+    }
+  }
+  copy(index->list_sizes().data_handle(), sizes.data(), n_lists, stream);
+  index->recompute_internal_state(res);
+
+  convert_all_lists<true>(res,
+                          *index,
+                          codes.data_handle(),
+                          indices.data_handle(),
+                          list_offsets.data_handle(),
+                          codes.extent(0));
+}
+
+/** See the public interface `ivf_flat::helpers::compact`. */
+template <typename T, typename IdxT>
+void compact(raft::resources const& res, index<T, IdxT>* index, double threshold)
+{
+  if (index->n_removed() == 0) { return; }
+  auto stream            = resource::get_cuda_stream(res);
+  const uint32_t n_lists = index->n_lists();
+  std::vector<uint32_t> sizes(n_lists);
+  copy(sizes.data(), index->list_sizes().data_handle(), n_lists, stream);
+  resource::sync_stream(res);
+  auto& lists = index->lists();
+  for (uint32_t label = 0; label < n_lists; label++) {
+    auto& list = lists[label];
+    if (!list || list->n_removed == 0 || list->n_removed < threshold * sizes[label]) { continue; }
+    sizes[label] =
+      ivf::detail::compact_list(res, *list, sizes[label], index->dim(), index->veclen());
+  }
+  copy(index->list_sizes().data_handle(), sizes.data(), n_lists, stream);
+  index->recompute_internal_state(res);
+}
+
+/** See the public interface `ivf_flat::helpers::remove`. */
+template <typename T, typename IdxT>
+auto remove(raft::resources const& res,
+            index<T, IdxT>* index,
+            device_vector_view<const IdxT, int64_t> ids,
+            double compaction_threshold) -> int64_t
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_flat::remove(%zu ids)", size_t(ids.extent(0)));
+  const int64_t n_removed = ivf::detail::mark_removed(res,
+                                                      index->lists(),
+                                                      index->inds_ptrs().data_handle(),
+                                                      index->list_sizes().data_handle(),
+                                                      ids);
+  // the lists which got their first removed records need their bitmasks in the index
+  index->recompute_internal_state(res);
+  compact(res, index, compaction_threshold);
+  return n_removed;
+}
+
 }  // namespace raft::neighbors::ivf_flat::detail
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/linalg/gemm.cuh>
+#include <raft/linalg/map.cuh>
+#include <raft/linalg/norm.cuh>
+#include <raft/matrix/detail/select_k.cuh>
+#include <raft/neighbors/ivf_flat_types.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/pow2_utils.cuh>
+
+#include <rmm/device_uvector.hpp>
+#include <rmm/mr/device/device_memory_resource.hpp>
+
+#include <thrust/binary_search.h>
+#include <thrust/fill.h>
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+
+#include <algorithm>
+#include <cuda_fp16.h>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace raft::neighbors::ivf_flat::detail {
+
+/**
+ * The list-major GEMM scan is used when, on average, at least this many (query, probe) pairs fall
+ * into every list: then the cost of de-interleaving a list is amortized over enough queries for the
+ * GEMM to outrun the warp-per-query interleaved scan.
+ */
+constexpr uint64_t kGemmScanMinQueriesPerList = 512;
+/** The size (in elements) of the distance matrix of one query block x list GEMM. */
+constexpr uint64_t kGemmScanMaxTileElems = 32 * 1024 * 1024;
+
+/** Whether the list-major GEMM scan (`gemm_scan`) can replace the interleaved scan. */
+template <typename T, typename IdxT, typename IvfSampleFilterT>
+auto use_gemm_scan(const index<T, IdxT>& index, uint32_t n_queries, uint32_t n_probes) -> bool
+{
+  // Integer data is served by the dp4a interleaved scan, which also keeps its unscaled distances.
+  if constexpr (!std::is_same_v<T, float> && !std::is_same_v<T, half>) { return false; }
+  if constexpr (!std::is_same_v<IvfSampleFilterT, filtering::none_ivf_sample_filter>) {
+    return false;
+  }
+  // The GEMM scan has no record filtering, so it cannot skip the removed records.
+  if (index.n_removed() > 0) { return false; }
+  // The query norms are only computed by the coarse search for the expanded L2 metrics.
+  switch (index.metric()) {
+    case raft::distance::DistanceType::L2Expanded:
+    case raft::distance::DistanceType::L2SqrtExpanded:
+    case raft::distance::DistanceType::InnerProduct: break;
+    default: return false;
+  }
+  return uint64_t(n_queries) * uint64_t(n_probes) >=
+         kGemmScanMinQueriesPerList * uint64_t(index.n_lists());
+}
+
+/** De-interleave the rows of one list into a row-major float matrix. */
+template <typename T>
+struct unpack_list_op {
+  const T* list_data;
+  uint32_t dim;
+  uint32_t veclen;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> float
+  {
+    using interleaved_group = Pow2<kIndexGroupSize>;
+    const auto row          = static_cast<uint32_t>(i / dim);
+    const auto col          = static_cast<uint32_t>(i % dim);
+    const auto l            = col - col % veclen;
+    return utils::mapping<float>{}(list_data[interleaved_group::roundDown(row) * dim +
+                                             l * kIndexGroupSize +
+                                             interleaved_group::mod(row) * veclen + col % veclen]);
+  }
+};
+
+/** Gather the queries of a block of (query, probe) pairs. */
+struct gather_queries_op {
+  const float* queries;
+  const uint32_t* pairs;
+  uint32_t dim;
+  uint32_t n_probes;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> float
+  {
+    const int64_t row = i / dim;
+    const int64_t col = i % dim;
+    return queries[int64_t(pairs[row] / n_probes) * dim + col];
+  }
+};
+
+/** Turn the `-2 <q, x>` products into (squared) L2 distances. */
+struct l2_from_products_op {
+  const float* products;
+  const float* query_norms;
+  const float* row_norms;
+  const uint32_t* pairs;
+  uint32_t n_rows;
+  uint32_t n_probes;
+  bool sqrt;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> float
+  {
+    const int64_t q = i / n_rows;
+    const int64_t j = i % n_rows;
+    const float d   = std::max(0.0f, products[i] + query_norms[pairs[q] / n_probes] + row_norms[j]);
+    return sqrt ? sqrtf(d) : d;
+  }
+};
+
+/** Write the top-k of a query block in a list into the per-(query, probe) output slots. */
+template <typename IdxT>
+struct scatter_list_topk_op {
+  const float* block_distances;
+  const uint32_t* block_positions;
+  const uint32_t* pairs;
+  const IdxT* list_indices;
+  uint32_t block_k;
+  uint32_t k;
+  float* distances;
+  IdxT* neighbors;
+
+  _RAFT_DEVICE void operator()(int64_t i) const
+  {
+    const int64_t row = i / block_k;
+    const int64_t col = i % block_k;
+    const int64_t out = int64_t(pairs[row]) * k + col;
+    distances[out]    = block_distances[i];
+    neighbors[out]    = list_indices[block_positions[i]];
+  }
+};
+
+/**
+ * @brief Scan the probed lists list-by-list with GEMMs instead of the interleaved scan.
+ *
+ * The (query, probe) pairs are grouped by the probed list. Every list is de-interleaved once, and
+ * the distances between the list and a block of its queries are computed with one GEMM, followed
+ * by a row-wise top-k. This favors large batches, where every list is probed by many queries.
+ *
+ * The output has the same layout as that of the interleaved scan with `grid_dim_x = n_probes`:
+ * `k` candidates per (query, probe) pair, padded with dummy values when a list has fewer than `k`
+ * rows or when a probe is skipped.
+ *
+ * @param[in] queries float queries [n_queries, dim]
+ * @param[in] query_norms squared L2 norms of the queries [n_queries] (only for the L2 metrics)
+ * @param[in] coarse_indices the probed lists [n_queries, n_probes]
+ * @param[out] neighbors [n_queries, n_probes, k]
+ * @param[out] distances [n_queries, n_probes, k]
+ */
+template <typename T, typename IdxT>
+void gemm_scan(raft::resources const& handle,
+               const index<T, IdxT>& index,
+               const float* queries,
+               const float* query_norms,
+               const uint32_t* coarse_indices,
+               uint32_t n_queries,
+               uint32_t n_probes,
+               uint32_t k,
+               bool select_min,
+               IdxT* neighbors,
+               float* distances,
+               rmm::mr::device_memory_resource* mr)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_flat::gemm_scan(n_queries = %u, n_probes = %u)", n_queries, n_probes);
+  auto stream            = resource::get_cuda_stream(handle);
+  auto policy            = resource::get_thrust_policy(handle);
+  const uint32_t dim     = index.dim();
+  const uint32_t n_lists = index.n_lists();
+  const uint64_t n_pairs = uint64_t(n_queries) * n_probes;
+  const bool is_l2       = index.metric() != raft::distance::DistanceType::InnerProduct;
+  const bool is_sqrt     = index.metric() == raft::distance::DistanceType::L2SqrtExpanded ||
+                       index.metric() == raft::distance::DistanceType::L2SqrtUnexpanded;
+
+  // Group the (query, probe) pairs by the probed list; the skipped probes are sorted to the end.
+  rmm::device_uvector<uint32_t> pair_lists(n_pairs, stream, mr);
+  rmm::device_uvector<uint32_t> pairs(n_pairs, stream, mr);
+  raft::copy(pair_lists.data(), coarse_indices, n_pairs, stream);
+  thrust::sequence(policy, pairs.begin(), pairs.end());
+  thrust::sort_by_key(policy, pair_lists.begin(), pair_lists.end(), pairs.begin());
+  rmm::device_uvector<uint32_t> list_offsets_dev(n_lists + 1, stream, mr);
+  thrust::lower_bound(policy,
+                      pair_lists.begin(),
+                      pair_lists.end(),
+                      thrust::make_counting_iterator<uint32_t>(0),
+                      thrust::make_counting_iterator<uint32_t>(n_lists + 1),
+                      list_offsets_dev.begin());
+  std::vector<uint32_t> list_offsets(n_lists + 1);
+  std::vector<uint32_t> list_sizes(n_lists);
+  raft::copy(list_offsets.data(), list_offsets_dev.data(), n_lists + 1, stream);
+  raft::copy(list_sizes.data(), index.list_sizes().data_handle(), n_lists, stream);
+
+  // The output slots not written below (short lists, skipped probes) keep the dummy values.
+  const float dummy_distance =
+    select_min ? std::numeric_limits<float>::max() : std::numeric_limits<float>::lowest();
+  thrust::fill_n(policy, distances, n_pairs * k, dummy_distance);
+  thrust::fill_n(policy, neighbors, n_pairs * k, std::numeric_limits<IdxT>::max());
+  resource::sync_stream(handle);
+
+  // Size the workspace for the largest list and query block.
+  auto block_size_of = [n_pairs](uint32_t list_size) -> uint32_t {
+    return std::max<uint64_t>(
+      1, std::min<uint64_t>(n_pairs, kGemmScanMaxTileElems / std::max<uint32_t>(1, list_size)));
+  };
+  uint32_t max_list_size  = 0;
+  uint32_t max_block_rows = 0;
+  uint64_t max_tile_size  = 0;
+  uint64_t max_topk_size  = 0;
+  for (uint32_t l = 0; l < n_lists; l++) {
+    const uint32_t n_list_queries = list_offsets[l + 1] - list_offsets[l];
+    if (n_list_queries == 0 || list_sizes[l] == 0) { continue; }
+    const uint32_t block_rows = std::min(n_list_queries, block_size_of(list_sizes[l]));
+    max_list_size             = std::max(max_list_size, list_sizes[l]);
+    max_block_rows            = std::max(max_block_rows, block_rows);
+    max_tile_size = std::max<uint64_t>(max_tile_size, uint64_t(block_rows) * list_sizes[l]);
+    max_topk_size =
+      std::max<uint64_t>(max_topk_size, uint64_t(block_rows) * std::min(k, list_sizes[l]));
+  }
+  if (max_list_size == 0) { return; }
+  rmm::device_uvector<float> list_rows(uint64_t(max_list_size) * dim, stream, mr);
+  rmm::device_uvector<float> row_norms(is_l2 ? max_list_size : 0, stream, mr);
+  rmm::device_uvector<float> block_queries(uint64_t(max_block_rows) * dim, stream, mr);
+  rmm::device_uvector<float> tile(max_tile_size, stream, mr);
+  rmm::device_uvector<float> block_distances(max_topk_size, stream, mr);
+  rmm::device_uvector<uint32_t> block_positions(max_topk_size, stream, mr);
+
+  const float alpha = is_l2 ? -2.0f : 1.0f;
+  const float beta  = 0.0f;
+  for (uint32_t l = 0; l < n_lists; l++) {
+    const uint32_t n_list_queries = list_offsets[l + 1] - list_offsets[l];
+    const uint32_t n_rows         = list_sizes[l];
+    if (n_list_queries == 0 || n_rows == 0) { continue; }
+    const auto& list = index.lists()[l];
+
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<float, int64_t>(list_rows.data(), int64_t(n_rows) * dim),
+      unpack_list_op<T>{list->data.data_handle(), dim, index.veclen()});
+    if (is_l2) {
+      raft::linalg::rowNorm(row_norms.data(),
+                            list_rows.data(),
+                            static_cast<IdxT>(dim),
+                            static_cast<IdxT>(n_rows),
+                            raft::linalg::L2Norm,
+                            true,
+                            stream);
+    }
+
+    const uint32_t block_k    = std::min(k, n_rows);
+    const uint32_t block_size = block_size_of(n_rows);
+    for (uint32_t offset = 0; offset < n_list_queries; offset += block_size) {
+      const uint32_t block_rows   = std::min(block_size, n_list_queries - offset);
+      const uint32_t* block_pairs = pairs.data() + list_offsets[l] + offset;
+      raft::linalg::map_offset(
+        handle,
+        raft::make_device_vector_view<float, int64_t>(block_queries.data(),
+                                                      int64_t(block_rows) * dim),
+        gather_queries_op{queries, block_pairs, dim, n_probes});
+      linalg::gemm(handle,
+                   true,
+                   false,
+                   n_rows,
+                   block_rows,
+                   dim,
+                   &alpha,
+                   list_rows.data(),
+                   dim,
+                   block_queries.data(),
+                   dim,
+                   &beta,
+                   tile.data(),
+                   n_rows,
+                   stream);
+      if (is_l2) {
+        raft::linalg::map_offset(
+          handle,
+          raft::make_device_vector_view<float, int64_t>(tile.data(), int64_t(block_rows) * n_rows),
+          l2_from_products_op{
+            tile.data(), query_norms, row_norms.data(), block_pairs, n_rows, n_probes, is_sqrt});
+      }
+      matrix::detail::select_k<float, uint32_t>(handle,
+                                                tile.data(),
+                                                nullptr,
+                                                block_rows,
+                                                n_rows,
+                                                block_k,
+                                                block_distances.data(),
+                                                block_positions.data(),
+                                                select_min,
+                                                mr);
+      thrust::for_each(policy,
+                       thrust::make_counting_iterator<int64_t>(0),
+                       thrust::make_counting_iterator<int64_t>(int64_t(block_rows) * block_k),
+                       scatter_list_topk_op<IdxT>{block_distances.data(),
+                                                  block_positions.data(),
+                                                  block_pairs,
+                                                  list->indices.data_handle(),
+                                                  block_k,
+                                                  k,
+                                                  distances,
+                                                  neighbors});
+    }
+  }
+}
+
+}  // namespace raft::neighbors::ivf_flat::detail
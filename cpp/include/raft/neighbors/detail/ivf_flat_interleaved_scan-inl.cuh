@@ -30,6 +30,8 @@
 #include <raft/util/vectorized.cuh>
 #include <rmm/cuda_stream_view.hpp>
 
+#include <cuda_fp16.h>
+
 namespace raft::neighbors::ivf_flat::detail {
 
 using namespace raft::spatial::knn::detail;  // NOLINT
@@ -181,6 +183,88 @@ struct loadAndComputeDist {
   }
 };
 
+/** Load `Veclen` consecutive fp16 values at once (the address must be aligned accordingly). */
+template <int Veclen>
+__device__ __forceinline__ void load_half_vec(half (&x)[Veclen], const half* addr)
+{
+  using vec_t                  = typename IOType<half, Veclen>::Type;
+  *reinterpret_cast<vec_t*>(x) = *reinterpret_cast<const vec_t*>(addr);
+}
+
+// This handles fp16 lists: the values are loaded in their packed form (halving the bandwidth of
+// the scan compared to fp32) and converted to float in registers, so that the distance is
+// accumulated in full precision.
+template <int kUnroll, typename Lambda, int Veclen>
+struct loadAndComputeDist<kUnroll, Lambda, Veclen, half, float> {
+  Lambda compute_dist;
+  float& dist;
+
+  __device__ __forceinline__ loadAndComputeDist(float& dist, Lambda op)
+    : dist(dist), compute_dist(op)
+  {
+  }
+
+  template <typename IdxT>
+  __device__ __forceinline__ void runLoadShmemCompute(const half* const& data,
+                                                      const half* query_shared,
+                                                      IdxT loadIndex,
+                                                      IdxT shmemIndex)
+  {
+#pragma unroll
+    for (int j = 0; j < kUnroll; ++j) {
+      half encV[Veclen];
+      load_half_vec(encV, data + (loadIndex + j * kIndexGroupSize) * Veclen);
+      half queryRegs[Veclen];
+      load_half_vec(queryRegs, &query_shared[shmemIndex + j * Veclen]);
+#pragma unroll
+      for (int k = 0; k < Veclen; ++k) {
+        compute_dist(dist, __half2float(queryRegs[k]), __half2float(encV[k]));
+      }
+    }
+  }
+
+  template <typename IdxT>
+  __device__ __forceinline__ void runLoadShflAndCompute(const half*& data,
+                                                        const half* query,
+                                                        IdxT baseLoadIndex,
+                                                        const int lane_id)
+  {
+    float queryReg           = __half2float(query[baseLoadIndex + lane_id]);
+    constexpr int stride     = kUnroll * Veclen;
+    constexpr int totalIter  = WarpSize / stride;
+    constexpr int gmemStride = stride * kIndexGroupSize;
+#pragma unroll
+    for (int i = 0; i < totalIter; ++i, data += gmemStride) {
+#pragma unroll
+      for (int j = 0; j < kUnroll; ++j) {
+        half encV[Veclen];
+        load_half_vec(encV, data + (lane_id + j * kIndexGroupSize) * Veclen);
+        const int d = (i * kUnroll + j) * Veclen;
+#pragma unroll
+        for (int k = 0; k < Veclen; ++k) {
+          compute_dist(dist, shfl(queryReg, d + k, WarpSize), __half2float(encV[k]));
+        }
+      }
+    }
+  }
+
+  __device__ __forceinline__ void runLoadShflAndComputeRemainder(
+    const half*& data, const half* query, const int lane_id, const int dim, const int dimBlocks)
+  {
+    const int loadDim     = dimBlocks + lane_id;
+    float queryReg        = loadDim < dim ? __half2float(query[loadDim]) : 0.0f;
+    const int loadDataIdx = lane_id * Veclen;
+    for (int d = 0; d < dim - dimBlocks; d += Veclen, data += kIndexGroupSize * Veclen) {
+      half enc[Veclen];
+      load_half_vec(enc, data + loadDataIdx);
+#pragma unroll
+      for (int k = 0; k < Veclen; k++) {
+        compute_dist(dist, shfl(queryReg, d + k, WarpSize), __half2float(enc[k]));
+      }
+    }
+  }
+};
+
 // This handles uint8_t 8, 16 Veclens
 template <int kUnroll, typename Lambda, int uint8_veclen>
 struct loadAndComputeDist<kUnroll, Lambda, uint8_veclen, uint8_t, uint32_t> {
@@ -717,6 +801,8 @@ RAFT_KERNEL __launch_bounds__(kThreadsPerBlock)
     // Every CUDA block scans one cluster at a time.
     for (int probe_id = blockIdx.x; probe_id < n_probes; probe_id += gridDim.x) {
       const uint32_t list_id = coarse_index[probe_id];  // The id of cluster(list)
+      // Skipped by the adaptive probing
+      if (list_id == ivf::kSkippedProbe) { continue; }
 
       // The number of vectors in each cluster(list); [nlist]
       const uint32_t list_length = list_sizes[list_id];
@@ -943,6 +1029,15 @@ struct inner_prod_dist {
   }
 };
 
+/** The cosine distance of two normalized vectors from their inner product. */
+struct cosine_from_inner_product_op {
+  template <typename AccT>
+  HDI auto operator()(AccT inner_product) const -> AccT
+  {
+    return AccT(1) - inner_product;
+  }
+};
+
 /** Select the distance computation function and forward the rest of the arguments. */
 template <int Capacity,
           int Veclen,
@@ -987,6 +1082,17 @@ void launch_with_fixed_consts(raft::distance::DistanceType metric, Args&&... arg
                            IvfSampleFilterT,
                            inner_prod_dist<Veclen, T, AccT>,
                            raft::identity_op>({}, {}, std::forward<Args>(args)...);
+    case raft::distance::DistanceType::CosineExpanded:
+      // NB: the vectors are normalized by the index and the search.
+      return launch_kernel<Capacity,
+                           Veclen,
+                           Ascending,
+                           T,
+                           AccT,
+                           IdxT,
+                           IvfSampleFilterT,
+                           inner_prod_dist<Veclen, T, AccT>,
+                           cosine_from_inner_product_op>({}, {}, std::forward<Args>(args)...);
     // NB: update the description of `knn::ivf_flat::build` when adding here a new metric.
     default: RAFT_FAIL("The chosen distance metric is not supported (%d)", int(metric));
   }
@@ -1098,12 +1204,18 @@ void ivfflat_interleaved_scan(const index<T, IdxT>& index,
                               rmm::cuda_stream_view stream)
 {
   const int capacity = bound_by_power_of_two(k);
+  // The cosine distance decreases with the inner product, which is what the kernel selects.
+  const bool select_min_score =
+    metric == raft::distance::DistanceType::CosineExpanded ? !select_min : select_min;
 
+  // the records removed from the index are rejected along with the filtered ones
   auto filter_adapter = raft::neighbors::filtering::ivf_to_sample_filter(
-    index.inds_ptrs().data_handle(), sample_filter);
+    index.inds_ptrs().data_handle(),
+    sample_filter,
+    index.n_removed() > 0 ? index.removed_ptrs().data_handle() : nullptr);
   select_interleaved_scan_kernel<T, AccT, IdxT, decltype(filter_adapter)>::run(capacity,
                                                                                index.veclen(),
-                                                                               select_min,
+                                                                               select_min_score,
                                                                                metric,
                                                                                index,
                                                                                queries,
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cstdint>
+#include <type_traits>
+
+namespace raft::neighbors::ivf_flat::detail {
+
+/**
+ * Whether the lists and the queries are scaled to the unit norm: the CosineExpanded index keeps the
+ * normalized vectors, so that the cosine distance is `1 - <q, x>`.
+ */
+inline constexpr auto is_normalized_metric(raft::distance::DistanceType metric) -> bool
+{
+  return metric == raft::distance::DistanceType::CosineExpanded;
+}
+
+/** The L2 norm of a row of a row-major matrix. */
+template <typename T>
+struct row_norm_op {
+  const T* data;
+  uint32_t dim;
+
+  HDI auto operator()(int64_t row) const -> float
+  {
+    float sum = 0;
+    for (uint32_t j = 0; j < dim; j++) {
+      const float v = spatial::knn::detail::utils::mapping<float>{}(data[row * dim + j]);
+      sum += v * v;
+    }
+    return sqrtf(sum);
+  }
+};
+
+/** The rows of a row-major matrix scaled to the unit L2 norm (zero rows are kept as is). */
+template <typename T>
+struct normalize_op {
+  const T* data;
+  const float* norms;
+  uint32_t dim;
+
+  HDI auto operator()(int64_t i) const -> T
+  {
+    const float norm = norms[i / dim];
+    const float v    = spatial::knn::detail::utils::mapping<float>{}(data[i]);
+    return spatial::knn::detail::utils::mapping<T>{}(norm > 0 ? v / norm : v);
+  }
+};
+
+/** Scale the rows of a row-major device matrix to the unit L2 norm (`in` may be `out`). */
+template <typename T>
+void normalize_rows(raft::resources const& res, const T* in, T* out, int64_t n_rows, uint32_t dim)
+{
+  static_assert(std::is_same_v<T, float> || std::is_same_v<T, half>,
+                "Only the floating-point vectors can be normalized");
+  rmm::device_uvector<float> norms(
+    n_rows, resource::get_cuda_stream(res), resource::get_workspace_resource(res));
+  raft::linalg::map_offset(res,
+                           raft::make_device_vector_view<float, int64_t>(norms.data(), n_rows),
+                           row_norm_op<T>{in, dim});
+  raft::linalg::map_offset(res,
+                           raft::make_device_vector_view<T, int64_t>(out, n_rows * dim),
+                           normalize_op<T>{in, norms.data(), dim});
+}
+
+}  // namespace raft::neighbors::ivf_flat::detail
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <cstdint>                                 // uintX_t
+#include <cuda_fp16.h>                             // half
 #include <raft/neighbors/ivf_flat_types.hpp>       // raft::neighbors::ivf_flat::index
 #include <raft/neighbors/sample_filter_types.hpp>  // none_ivf_sample_filter
 #include <raft/util/raft_explicit.hpp>             // RAFT_EXPLICIT
@@ -35,7 +36,9 @@ void search(raft::resources const& handle,
             IdxT* neighbors,
             float* distances,
             rmm::mr::device_memory_resource* mr = nullptr,
-            IvfSampleFilterT sample_filter      = IvfSampleFilterT()) RAFT_EXPLICIT;
+            IvfSampleFilterT sample_filter      = IvfSampleFilterT(),
+            const uint32_t* query_n_probes      = nullptr,
+            const uint32_t* query_k             = nullptr) RAFT_EXPLICIT;
 
 }  // namespace raft::neighbors::ivf_flat::detail
 
@@ -52,10 +55,14 @@ void search(raft::resources const& handle,
     IdxT* neighbors,                                                                 \
     float* distances,                                                                \
     rmm::mr::device_memory_resource* mr,                                             \
-    IvfSampleFilterT sample_filter)
+    IvfSampleFilterT sample_filter,                                                  \
+    const uint32_t* query_n_probes,                                                  \
+    const uint32_t* query_k)
 
 instantiate_raft_neighbors_ivf_flat_detail_search(
   float, int64_t, raft::neighbors::filtering::none_ivf_sample_filter);
+instantiate_raft_neighbors_ivf_flat_detail_search(
+  half, int64_t, raft::neighbors::filtering::none_ivf_sample_filter);
 instantiate_raft_neighbors_ivf_flat_detail_search(
   int8_t, int64_t, raft::neighbors::filtering::none_ivf_sample_filter);
 instantiate_raft_neighbors_ivf_flat_detail_search(
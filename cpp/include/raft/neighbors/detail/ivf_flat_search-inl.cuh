@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,19 +17,25 @@
 #pragma once
 
 #include <raft/core/logger.hpp>  // RAFT_LOG_TRACE
+#include <raft/core/resource/cancellation_token.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/metrics.hpp>
 #include <raft/core/resources.hpp>                              // raft::resources
 #include <raft/distance/distance_types.hpp>                     // is_min_close, DistanceType
 #include <raft/linalg/gemm.cuh>                                 // raft::linalg::gemm
 #include <raft/linalg/norm.cuh>                                 // raft::linalg::norm
 #include <raft/linalg/unary_op.cuh>                             // raft::linalg::unary_op
 #include <raft/matrix/detail/select_k.cuh>                      // matrix::detail::select_k
+#include <raft/neighbors/detail/ivf_flat_gemm_scan.cuh>         // gemm_scan
 #include <raft/neighbors/detail/ivf_flat_interleaved_scan.cuh>  // interleaved_scan
+#include <raft/neighbors/detail/ivf_flat_normalize.cuh>         // normalize_rows
 #include <raft/neighbors/ivf_flat_types.hpp>                    // raft::neighbors::ivf_flat::index
 #include <raft/neighbors/sample_filter_types.hpp>               // none_ivf_sample_filter
 #include <raft/spatial/knn/detail/ann_utils.cuh>                // utils::mapping
 #include <rmm/mr/device/per_device_resource.hpp>                // rmm::device_memory_resource
 
+#include <limits>  // std::numeric_limits
+
 namespace raft::neighbors::ivf_flat::detail {
 
 using namespace raft::spatial::knn::detail;  // NOLINT
@@ -42,11 +48,13 @@ void search_impl(raft::resources const& handle,
                  uint32_t queries_offset,
                  uint32_t k,
                  uint32_t n_probes,
+                 float probe_distance_ratio,
                  bool select_min,
                  IdxT* neighbors,
                  AccT* distances,
                  rmm::mr::device_memory_resource* search_mr,
-                 IvfSampleFilterT sample_filter)
+                 IvfSampleFilterT sample_filter,
+                 const uint32_t* query_n_probes = nullptr)
 {
   auto stream = resource::get_cuda_stream(handle);
   // The norm of query
@@ -62,8 +70,20 @@ void search_impl(raft::resources const& handle,
   // The topk index of candidate vectors from each cluster(list)
   rmm::device_uvector<IdxT> refined_indices_dev(n_queries * n_probes * k, stream, search_mr);
 
+  // The queries of a CosineExpanded index are normalized once, for both the coarse search and the
+  // scan of the (normalized) lists.
+  const bool normalize = is_normalized_metric(index.metric());
+  rmm::device_uvector<T> normalized_queries_dev(
+    normalize ? n_queries * index.dim() : 0, stream, search_mr);
+  if constexpr (std::is_same_v<T, float> || std::is_same_v<T, half>) {
+    if (normalize) {
+      normalize_rows<T>(handle, queries, normalized_queries_dev.data(), n_queries, index.dim());
+      queries = normalized_queries_dev.data();
+    }
+  }
+
   size_t float_query_size;
-  if constexpr (std::is_integral_v<T>) {
+  if constexpr (!std::is_same_v<T, float>) {
     float_query_size = n_queries * index.dim();
   } else {
     float_query_size = 0;
@@ -104,6 +124,12 @@ void search_impl(raft::resources const& handle,
       RAFT_LOG_TRACE_VEC(distance_buffer_dev.data(), std::min<uint32_t>(20, index.n_lists()));
       break;
     }
+    case raft::distance::DistanceType::CosineExpanded: {
+      // The negated cosine similarities to the normalized centers
+      alpha = -1.0f;
+      beta  = 0.0f;
+      break;
+    }
     default: {
       alpha = 1.0f;
       beta  = 0.0f;
@@ -140,6 +166,68 @@ void search_impl(raft::resources const& handle,
   RAFT_LOG_TRACE_VEC(coarse_indices_dev.data(), n_probes);
   RAFT_LOG_TRACE_VEC(coarse_distances_dev.data(), n_probes);
 
+  // Adaptive probing: skip the clusters much farther than the closest one (the coarse distances
+  // are the squared L2 distances here).
+  if (probe_distance_ratio > 0 && index.metric() != raft::distance::DistanceType::InnerProduct &&
+      !normalize) {
+    utils::mask_distant_probes(n_queries,
+                               n_probes,
+                               coarse_distances_dev.data(),
+                               nullptr,
+                               probe_distance_ratio,
+                               ivf::kSkippedProbe,
+                               coarse_indices_dev.data(),
+                               stream);
+  }
+
+  // The queries with fewer probes than the batch do not scan the rest of theirs.
+  if (query_n_probes != nullptr) {
+    utils::mask_probes_per_query(size_t{n_queries},
+                                 n_probes,
+                                 query_n_probes,
+                                 ivf::kSkippedProbe,
+                                 coarse_indices_dev.data(),
+                                 stream);
+  }
+
+  // The lists where no sample passes the filter (for the query) are not scanned at all.
+  if constexpr (raft::neighbors::filtering::skips_lists<IvfSampleFilterT>::value) {
+    utils::mask_skipped_probes(n_queries,
+                               n_probes,
+                               queries_offset,
+                               sample_filter,
+                               ivf::kSkippedProbe,
+                               coarse_indices_dev.data(),
+                               stream);
+  }
+
+  if (use_gemm_scan<T, IdxT, IvfSampleFilterT>(index, n_queries, n_probes)) {
+    // Large batches: group the queries by the probed lists and scan every list with GEMMs.
+    gemm_scan<T, IdxT>(handle,
+                       index,
+                       converted_queries_ptr,
+                       query_norm_dev.data(),
+                       coarse_indices_dev.data(),
+                       n_queries,
+                       n_probes,
+                       k,
+                       select_min,
+                       refined_indices_dev.data(),
+                       refined_distances_dev.data(),
+                       search_mr);
+    matrix::detail::select_k<AccT, IdxT>(handle,
+                                         refined_distances_dev.data(),
+                                         refined_indices_dev.data(),
+                                         n_queries,
+                                         k * n_probes,
+                                         k,
+                                         distances,
+                                         neighbors,
+                                         select_min,
+                                         search_mr);
+    return;
+  }
+
   auto distances_dev_ptr = refined_distances_dev.data();
   auto indices_dev_ptr   = refined_indices_dev.data();
 
@@ -204,7 +292,14 @@ void search_impl(raft::resources const& handle,
   }
 }
 
-/** See raft::neighbors::ivf_flat::search docs */
+/**
+ * See raft::neighbors::ivf_flat::search docs
+ *
+ * With `query_n_probes` [n_queries] (device), the query `i` probes its `query_n_probes[i]` closest
+ * lists (at most `params.n_probes`), the rest of its probes being masked with `ivf::kSkippedProbe`.
+ * With `query_k` [n_queries] (device), the results of the query `i` past its `query_k[i]` nearest
+ * neighbors (at most `k`) are padded with `ivf::kInvalidRecord`.
+ */
 template <typename T,
           typename IdxT,
           typename IvfSampleFilterT = raft::neighbors::filtering::none_ivf_sample_filter>
@@ -217,14 +312,20 @@ inline void search(raft::resources const& handle,
                    IdxT* neighbors,
                    float* distances,
                    rmm::mr::device_memory_resource* mr = nullptr,
-                   IvfSampleFilterT sample_filter      = IvfSampleFilterT())
+                   IvfSampleFilterT sample_filter      = IvfSampleFilterT(),
+                   const uint32_t* query_n_probes      = nullptr,
+                   const uint32_t* query_k             = nullptr)
 {
   common::nvtx::range<common::nvtx::domain::raft> fun_scope(
     "ivf_flat::search(k = %u, n_queries = %u, dim = %zu)", k, n_queries, index.dim());
+  resource::scoped_call call(handle, "ivf_flat::search");
+  call.set_batch_size(n_queries);
 
   if (mr == nullptr) { mr = rmm::mr::get_current_device_resource(); }
   RAFT_EXPECTS(params.n_probes > 0,
                "n_probes (number of clusters to probe in the search) must be positive.");
+  RAFT_EXPECTS(params.probe_distance_ratio == 0 || params.probe_distance_ratio >= 1,
+               "probe_distance_ratio must be either zero (disabled) or not smaller than one.");
   auto n_probes = std::min<uint32_t>(params.n_probes, index.n_lists());
 
   // a batch size heuristic: try to keep the workspace within the specified size
@@ -233,8 +334,14 @@ inline void search(raft::resources const& handle,
     std::min<uint32_t>(n_queries,
                        raft::div_rounding_up_safe<uint64_t>(
                          kExpectedWsSize, 16ull * uint64_t{n_probes} * k + 4ull * index.dim()));
+  if (call.enabled()) {
+    call.set_algo(use_gemm_scan<T, IdxT, IvfSampleFilterT>(index, max_queries, n_probes)
+                    ? "gemm_scan"
+                    : "interleaved_scan");
+  }
 
   for (uint32_t offset_q = 0; offset_q < n_queries; offset_q += max_queries) {
+    resource::check_cancellation(handle);
     uint32_t queries_batch = min(max_queries, n_queries - offset_q);
 
     search_impl<T, float, IdxT, IvfSampleFilterT>(handle,
@@ -244,11 +351,27 @@ inline void search(raft::resources const& handle,
                                                   offset_q,
                                                   k,
                                                   n_probes,
+                                                  params.probe_distance_ratio,
                                                   raft::distance::is_min_close(index.metric()),
                                                   neighbors + offset_q * k,
                                                   distances + offset_q * k,
                                                   mr,
-                                                  sample_filter);
+                                                  sample_filter,
+                                                  query_n_probes == nullptr
+                                                    ? nullptr
+                                                    : query_n_probes + offset_q);
+    if (query_k != nullptr) {
+      utils::pad_results_per_query(queries_batch,
+                                   k,
+                                   query_k + offset_q,
+                                   ivf::kInvalidRecord<IdxT>,
+                                   raft::distance::is_min_close(index.metric())
+                                     ? std::numeric_limits<float>::max()
+                                     : std::numeric_limits<float>::lowest(),
+                                   neighbors + offset_q * k,
+                                   distances + offset_q * k,
+                                   resource::get_cuda_stream(handle));
+    }
   }
 }
 
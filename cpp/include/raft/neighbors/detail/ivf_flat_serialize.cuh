@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,12 +20,20 @@
 #include <raft/core/mdarray.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/serialize.hpp>
+#include <raft/linalg/norm.cuh>
+#include <raft/neighbors/detail/faiss_io.hpp>
+#include <raft/neighbors/detail/id_compression.cuh>
+#include <raft/neighbors/detail/ivf_flat_build.cuh>
 #include <raft/neighbors/ivf_flat_types.hpp>
 #include <raft/neighbors/ivf_list.hpp>
 #include <raft/neighbors/ivf_list_types.hpp>
 #include <raft/util/pow2_utils.cuh>
 
+#include <cstdint>
 #include <fstream>
+#include <limits>
+#include <type_traits>
+#include <vector>
 
 namespace raft::neighbors::ivf_flat::detail {
 
@@ -34,7 +42,7 @@ namespace raft::neighbors::ivf_flat::detail {
 // backward compatibility.
 // TODO(hcho3) Implement next-gen serializer for IVF that allows for expansion in a backward
 //             compatible fashion.
-constexpr int serialization_version = 4;
+constexpr int serialization_version = 5;
 
 /**
  * Save the index to file.
@@ -44,11 +52,16 @@ constexpr int serialization_version = 4;
  * @param[in] handle the raft handle
  * @param[in] filename the file name for saving the index
  * @param[in] index_ IVF-Flat index
+ * @param[in] compress whether to compress the source ids of the lists
  *
  */
 template <typename T, typename IdxT>
-void serialize(raft::resources const& handle, std::ostream& os, const index<T, IdxT>& index_)
+void serialize(raft::resources const& handle,
+               std::ostream& os,
+               const index<T, IdxT>& index_,
+               bool compress = false)
 {
+  RAFT_EXPECTS(index_.n_removed() == 0, "Compact the index before serializing it");
   RAFT_LOG_DEBUG(
     "Saving IVF-Flat index, size %zu, dim %u", static_cast<size_t>(index_.size()), index_.dim());
 
@@ -57,6 +70,7 @@ void serialize(raft::resources const& handle, std::ostream& os, const index<T, I
   os << dtype_string;
 
   serialize_scalar(handle, os, serialization_version);
+  serialize_scalar(handle, os, compress);
   serialize_scalar(handle, os, index_.size());
   serialize_scalar(handle, os, index_.dim());
   serialize_scalar(handle, os, index_.n_lists());
@@ -82,11 +96,13 @@ void serialize(raft::resources const& handle, std::ostream& os, const index<T, I
 
   list_spec<uint32_t, T, IdxT> list_store_spec{index_.dim(), true};
   for (uint32_t label = 0; label < index_.n_lists(); label++) {
-    ivf::serialize_list(handle,
-                        os,
-                        index_.lists()[label],
-                        list_store_spec,
-                        Pow2<kIndexGroupSize>::roundUp(sizes_host(label)));
+    auto size = Pow2<kIndexGroupSize>::roundUp(sizes_host(label));
+    if (compress) {
+      neighbors::detail::serialize_list_compressed(
+        handle, os, index_.lists()[label], list_store_spec, size, sizes_host(label));
+    } else {
+      ivf::serialize_list(handle, os, index_.lists()[label], list_store_spec, size);
+    }
   }
   resource::sync_stream(handle);
 }
@@ -94,12 +110,13 @@ void serialize(raft::resources const& handle, std::ostream& os, const index<T, I
 template <typename T, typename IdxT>
 void serialize(raft::resources const& handle,
                const std::string& filename,
-               const index<T, IdxT>& index_)
+               const index<T, IdxT>& index_,
+               bool compress = false)
 {
   std::ofstream of(filename, std::ios::out | std::ios::binary);
   if (!of) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
 
-  detail::serialize(handle, of, index_);
+  detail::serialize(handle, of, index_, compress);
 
   of.close();
   if (!of) { RAFT_FAIL("Error writing output %s", filename.c_str()); }
@@ -121,9 +138,11 @@ auto deserialize(raft::resources const& handle, std::istream& is) -> index<T, Id
   is.read(dtype_string, 4);
 
   auto ver = deserialize_scalar<int>(handle, is);
-  if (ver != serialization_version) {
+  // Version 4 is the same format without the compression of the ids.
+  if (ver != serialization_version && ver != 4) {
     RAFT_FAIL("serialization version mismatch, expected %d, got %d ", serialization_version, ver);
   }
+  bool compressed = ver >= 5 ? deserialize_scalar<bool>(handle, is) : false;
   auto n_rows           = deserialize_scalar<IdxT>(handle, is);
   auto dim              = deserialize_scalar<std::uint32_t>(handle, is);
   auto n_lists          = deserialize_scalar<std::uint32_t>(handle, is);
@@ -149,7 +168,12 @@ auto deserialize(raft::resources const& handle, std::istream& is) -> index<T, Id
   list_spec<uint32_t, T, IdxT> list_device_spec{index_.dim(), cma};
   list_spec<uint32_t, T, IdxT> list_store_spec{index_.dim(), true};
   for (uint32_t label = 0; label < index_.n_lists(); label++) {
-    ivf::deserialize_list(handle, is, index_.lists()[label], list_store_spec, list_device_spec);
+    if (compressed) {
+      neighbors::detail::deserialize_list_compressed(
+        handle, is, index_.lists()[label], list_store_spec, list_device_spec);
+    } else {
+      ivf::deserialize_list(handle, is, index_.lists()[label], list_store_spec, list_device_spec);
+    }
   }
   resource::sync_stream(handle);
 
@@ -171,4 +195,129 @@ auto deserialize(raft::resources const& handle, const std::string& filename) ->
 
   return index;
 }
+
+/**
+ * Write the index as a `faiss::IndexIVFFlat` (the `faiss::write_index` format).
+ *
+ * The lists are converted to the flat FAISS layout on the device in one pass, then written
+ * through a host copy of the whole index.
+ */
+template <typename T, typename IdxT>
+void serialize_to_faiss(raft::resources const& handle,
+                        std::ostream& os,
+                        const index<T, IdxT>& index_)
+{
+  static_assert(std::is_same_v<T, float>, "faiss::IndexIVFFlat holds float vectors only");
+  RAFT_EXPECTS(index_.n_removed() == 0, "Compact the index before serializing it");
+  namespace faiss = raft::neighbors::detail::faiss;
+  auto stream            = resource::get_cuda_stream(handle);
+  const int64_t n_rows   = index_.size();
+  const uint32_t dim     = index_.dim();
+  const uint32_t n_lists = index_.n_lists();
+  const auto metric      = faiss::to_faiss_metric(index_.metric());
+
+  auto codes   = make_device_matrix<T, int64_t>(handle, n_rows, dim);
+  auto indices = make_device_vector<IdxT, int64_t>(handle, n_rows);
+  auto offsets = make_device_vector<int64_t, int64_t>(handle, n_lists + 1);
+  unpack_all_lists(handle, index_, codes.view(), indices.view(), offsets.view());
+
+  std::vector<float> centers_host(size_t(n_lists) * dim);
+  std::vector<T> codes_host(codes.size());
+  std::vector<IdxT> indices_host(n_rows);
+  std::vector<int64_t> offsets_host(n_lists + 1);
+  copy(centers_host.data(), index_.centers().data_handle(), centers_host.size(), stream);
+  copy(codes_host.data(), codes.data_handle(), codes.size(), stream);
+  copy(indices_host.data(), indices.data_handle(), n_rows, stream);
+  copy(offsets_host.data(), offsets.data_handle(), n_lists + 1, stream);
+  resource::sync_stream(handle);
+  const std::vector<int64_t> ids(indices_host.begin(), indices_host.end());
+
+  faiss::write_scalar(os, faiss::fourcc("IwFl"));
+  faiss::write_ivf_header(
+    os, faiss::index_header{int32_t(dim), n_rows, true, metric}, n_lists, centers_host);
+  faiss::write_inverted_lists(os,
+                              dim * sizeof(T),
+                              offsets_host,
+                              reinterpret_cast<const uint8_t*>(codes_host.data()),
+                              ids.data());
+}
+
+template <typename T, typename IdxT>
+void serialize_to_faiss(raft::resources const& handle,
+                        const std::string& filename,
+                        const index<T, IdxT>& index_)
+{
+  std::ofstream of(filename, std::ios::out | std::ios::binary);
+  if (!of) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
+
+  detail::serialize_to_faiss(handle, of, index_);
+
+  of.close();
+  if (!of) { RAFT_FAIL("Error writing output %s", filename.c_str()); }
+}
+
+/** Load a `faiss::IndexIVFFlat` with a flat coarse quantizer and array inverted lists. */
+template <typename T, typename IdxT>
+auto deserialize_from_faiss(raft::resources const& handle, std::istream& is) -> index<T, IdxT>
+{
+  static_assert(std::is_same_v<T, float>, "faiss::IndexIVFFlat holds float vectors only");
+  namespace faiss = raft::neighbors::detail::faiss;
+  auto stream = resource::get_cuda_stream(handle);
+  faiss::expect_fourcc(is, faiss::fourcc("IwFl"));
+  faiss::index_header header;
+  uint64_t n_lists;
+  auto centers_host = faiss::read_ivf_header(is, header, n_lists);
+  RAFT_EXPECTS(n_lists <= std::numeric_limits<uint32_t>::max(), "Too many lists");
+  const uint32_t dim = header.d;
+  std::vector<int64_t> offsets_host;
+  std::vector<uint8_t> codes_host;
+  std::vector<int64_t> ids;
+  faiss::read_inverted_lists(is, n_lists, dim * sizeof(T), offsets_host, codes_host, ids);
+  const int64_t n_rows = offsets_host.back();
+  RAFT_EXPECTS(n_rows == header.ntotal, "Inconsistent FAISS index size");
+
+  index<T, IdxT> index_(
+    handle, faiss::from_faiss_metric(header.metric_type), n_lists, false, false, dim);
+  copy(index_.centers().data_handle(), centers_host.data(), centers_host.size(), stream);
+  index_.allocate_center_norms(handle);
+  if (index_.center_norms().has_value()) {
+    raft::linalg::rowNorm(index_.center_norms()->data_handle(),
+                          index_.centers().data_handle(),
+                          dim,
+                          uint32_t(n_lists),
+                          raft::linalg::L2Norm,
+                          true,
+                          stream);
+  }
+
+  const std::vector<IdxT> indices_host(ids.begin(), ids.end());
+  auto codes   = make_device_matrix<T, int64_t>(handle, n_rows, dim);
+  auto indices = make_device_vector<IdxT, int64_t>(handle, n_rows);
+  auto offsets = make_device_vector<int64_t, int64_t>(handle, n_lists + 1);
+  copy(codes.data_handle(), reinterpret_cast<const T*>(codes_host.data()), codes.size(), stream);
+  copy(indices.data_handle(), indices_host.data(), n_rows, stream);
+  copy(offsets.data_handle(), offsets_host.data(), n_lists + 1, stream);
+  pack_all_lists(handle,
+                 &index_,
+                 make_const_mdspan(codes.view()),
+                 make_const_mdspan(indices.view()),
+                 make_const_mdspan(offsets.view()));
+  resource::sync_stream(handle);
+  return index_;
+}
+
+template <typename T, typename IdxT>
+auto deserialize_from_faiss(raft::resources const& handle, const std::string& filename)
+  -> index<T, IdxT>
+{
+  std::ifstream is(filename, std::ios::in | std::ios::binary);
+
+  if (!is) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
+
+  auto index = detail::deserialize_from_faiss<T, IdxT>(handle, is);
+
+  is.close();
+
+  return index;
+}
 }  // namespace raft::neighbors::ivf_flat::detail
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/detail/macros.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/neighbors/ivf_list.hpp>
+#include <raft/util/cuda_rt_essentials.hpp>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <thrust/copy.h>
+#include <thrust/fill.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/sort.h>
+#include <thrust/unique.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * The removal of the records of the IVF lists by their source indices.
+ *
+ * A removed record is only marked in the bitmask of its list (`list::removed_bits`), which the
+ * searches check along with the sample filter; once enough records of a list are removed, the
+ * list is compacted in place: the removed records among the first `size - n_removed` ones are
+ * replaced by the remaining records past them, so that no record moves onto a record still to be
+ * moved.
+ *
+ * The lists of IVF-Flat and IVF-PQ share the interleaved layout: the records are grouped by
+ * `kIndexGroupSize` (32), and within a group, a chunk of `chunk_len` consecutive elements of one
+ * record follows the same chunk of the previous record; a record has `row_len` elements.
+ */
+namespace raft::neighbors::ivf::detail {
+
+/** Set the bits of the records of the lists whose source index is among the `sorted_ids`. */
+template <typename IdxT>
+RAFT_KERNEL mark_removed_kernel(const IdxT* const* inds_ptrs,
+                                uint32_t* const* removed_ptrs,
+                                const uint32_t* list_sizes,
+                                uint32_t n_lists,
+                                const IdxT* sorted_ids,
+                                int64_t n_ids,
+                                uint32_t* n_newly_removed)  // [n_lists]
+{
+  for (uint32_t label = blockIdx.y; label < n_lists; label += gridDim.y) {
+    const uint32_t size = list_sizes[label];
+    const IdxT* inds    = inds_ptrs[label];
+    uint32_t* removed   = removed_ptrs[label];
+    for (uint32_t i = threadIdx.x + blockDim.x * blockIdx.x; i < size;
+         i += blockDim.x * gridDim.x) {
+      const IdxT id = inds[i];
+      int64_t lo    = 0;
+      int64_t n     = n_ids;
+      while (n > 0) {
+        const int64_t half = n / 2;
+        if (sorted_ids[lo + half] < id) {
+          lo += half + 1;
+          n -= half + 1;
+        } else {
+          n = half;
+        }
+      }
+      if (lo == n_ids || sorted_ids[lo] != id) { continue; }
+      const uint32_t mask = 1u << (i % 32);
+      const uint32_t old  = atomicOr(removed + i / 32, mask);
+      if (!(old & mask)) { atomicAdd(n_newly_removed + label, 1u); }
+    }
+  }
+}
+
+/** Move the records `src` of a list onto the records `dst` (which are not among the `src`). */
+template <typename T, typename IdxT>
+RAFT_KERNEL move_records_kernel(T* data,
+                                IdxT* indices,
+                                const uint32_t* dst,
+                                const uint32_t* src,
+                                uint32_t n_moves,
+                                uint32_t row_len,
+                                uint32_t chunk_len)
+{
+  constexpr uint32_t kGroupSize = 32;
+  const uint64_t n_elems        = uint64_t(n_moves) * row_len;
+  for (uint64_t i = threadIdx.x + uint64_t(blockDim.x) * blockIdx.x; i < n_elems;
+       i += uint64_t(blockDim.x) * gridDim.x) {
+    const auto m      = uint32_t(i / row_len);
+    const auto e      = uint32_t(i % row_len);
+    const auto offset = [=](uint64_t r) {
+      return (r / kGroupSize) * kGroupSize * row_len + (e / chunk_len) * kGroupSize * chunk_len +
+             (r % kGroupSize) * chunk_len + e % chunk_len;
+    };
+    data[offset(dst[m])] = data[offset(src[m])];
+    if (e == 0) { indices[dst[m]] = indices[src[m]]; }
+  }
+}
+
+/**
+ * Mark the records of the lists whose source indices are among the `ids` as removed.
+ *
+ * @return the number of the records newly marked as removed
+ */
+template <typename IdxT, typename ListT>
+auto mark_removed(raft::resources const& res,
+                  std::vector<std::shared_ptr<ListT>>& lists,
+                  const IdxT* const* inds_ptrs,  // [n_lists]
+                  const uint32_t* list_sizes,    // [n_lists]
+                  raft::device_vector_view<const IdxT, int64_t> ids) -> int64_t
+{
+  using size_type = typename ListT::size_type;
+  auto stream     = resource::get_cuda_stream(res);
+  auto policy     = resource::get_thrust_policy(res);
+  auto n_lists    = static_cast<uint32_t>(lists.size());
+  if (ids.extent(0) == 0 || n_lists == 0) { return 0; }
+
+  auto sorted_ids = raft::make_device_vector<IdxT, int64_t>(res, ids.extent(0));
+  raft::copy(sorted_ids.data_handle(), ids.data_handle(), ids.extent(0), stream);
+  thrust::sort(policy, sorted_ids.data_handle(), sorted_ids.data_handle() + ids.extent(0));
+  const int64_t n_ids =
+    thrust::unique(policy, sorted_ids.data_handle(), sorted_ids.data_handle() + ids.extent(0)) -
+    sorted_ids.data_handle();
+
+  // every list gets its bitmask on the first removal
+  std::vector<uint32_t*> removed_ptrs_host(n_lists, nullptr);
+  size_type max_capacity = 0;
+  for (uint32_t label = 0; label < n_lists; label++) {
+    auto& list = lists[label];
+    if (!list) { continue; }
+    const size_type capacity = list->indices.extent(0);
+    if (list->removed_bits.size() == 0) {
+      const size_type n_words = div_rounding_up_safe<size_type>(capacity, 32);
+      list->removed_bits      =
+        make_device_mdarray<uint32_t>(res, make_extents<size_type>(n_words));
+      RAFT_CUDA_TRY(cudaMemsetAsync(
+        list->removed_bits.data_handle(), 0, n_words * sizeof(uint32_t), stream));
+    }
+    removed_ptrs_host[label] = list->removed_bits.data_handle();
+    max_capacity             = std::max(max_capacity, capacity);
+  }
+  auto removed_ptrs    = raft::make_device_vector<uint32_t*, uint32_t>(res, n_lists);
+  auto n_newly_removed = raft::make_device_vector<uint32_t, uint32_t>(res, n_lists);
+  raft::copy(removed_ptrs.data_handle(), removed_ptrs_host.data(), n_lists, stream);
+  RAFT_CUDA_TRY(
+    cudaMemsetAsync(n_newly_removed.data_handle(), 0, n_lists * sizeof(uint32_t), stream));
+
+  constexpr uint32_t kBlockSize = 256;
+  const auto n_blocks_per_list  = static_cast<uint32_t>(
+    std::clamp<size_type>(div_rounding_up_safe<size_type>(max_capacity, kBlockSize), 1, 64));
+  const dim3 block_dim(kBlockSize);
+  const dim3 grid_dim(n_blocks_per_list, std::min<uint32_t>(n_lists, 65535));
+  mark_removed_kernel<<<grid_dim, block_dim, 0, stream>>>(inds_ptrs,
+                                                          removed_ptrs.data_handle(),
+                                                          list_sizes,
+                                                          n_lists,
+                                                          sorted_ids.data_handle(),
+                                                          n_ids,
+                                                          n_newly_removed.data_handle());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+  std::vector<uint32_t> n_newly_removed_host(n_lists);
+  raft::copy(n_newly_removed_host.data(), n_newly_removed.data_handle(), n_lists, stream);
+  resource::sync_stream(res);
+  int64_t n_removed = 0;
+  for (uint32_t label = 0; label < n_lists; label++) {
+    if (n_newly_removed_host[label] == 0) { continue; }
+    lists[label]->n_removed += n_newly_removed_host[label];
+    n_removed += n_newly_removed_host[label];
+  }
+  return n_removed;
+}
+
+/** Whether the record `i` of a list is (not) removed. */
+template <bool Removed>
+struct removed_test_op {
+  const uint32_t* removed_bits;
+
+  _RAFT_DEVICE auto operator()(uint32_t i) const -> bool
+  {
+    return ((removed_bits[i / 32] >> (i % 32)) & 1u) == uint32_t(Removed);
+  }
+};
+
+/**
+ * Drop the removed records of a list of `size` records in place.
+ *
+ * @return the new size of the list
+ */
+template <typename ListT>
+auto compact_list(raft::resources const& res,
+                  ListT& list,
+                  uint32_t size,
+                  uint32_t row_len,
+                  uint32_t chunk_len) -> uint32_t
+{
+  using size_type = typename ListT::size_type;
+  using index_t   = typename ListT::index_type;
+  if (list.n_removed == 0) { return size; }
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf::compact_list(%u, %u removed)", size, uint32_t(list.n_removed));
+  auto stream             = resource::get_cuda_stream(res);
+  auto policy             = resource::get_thrust_policy(res);
+  const uint32_t new_size = size - uint32_t(list.n_removed);
+  const auto* bits        = list.removed_bits.data_handle();
+
+  // The removed records before the new end are replaced by the remaining records after it; their
+  // numbers are the same.
+  const uint32_t n_moves = size - new_size;
+  auto moves             = raft::make_device_matrix<uint32_t, uint32_t>(res, 2, n_moves);
+  auto* dst              = moves.data_handle();
+  auto* src              = moves.data_handle() + n_moves;
+  const uint32_t n_holes = thrust::copy_if(policy,
+                                           thrust::make_counting_iterator<uint32_t>(0),
+                                           thrust::make_counting_iterator<uint32_t>(new_size),
+                                           dst,
+                                           removed_test_op<true>{bits}) -
+                           dst;
+  thrust::copy_if(policy,
+                  thrust::make_counting_iterator<uint32_t>(new_size),
+                  thrust::make_counting_iterator<uint32_t>(size),
+                  src,
+                  removed_test_op<false>{bits});
+  if (n_holes > 0) {
+    constexpr uint32_t kBlockSize = 256;
+    const auto n_blocks           = static_cast<uint32_t>(std::min<uint64_t>(
+      div_rounding_up_safe<uint64_t>(uint64_t(n_holes) * row_len, kBlockSize), 65535));
+    move_records_kernel<<<n_blocks, kBlockSize, 0, stream>>>(
+      list.data.data_handle(), list.indices.data_handle(), dst, src, n_holes, row_len, chunk_len);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+  // the records past the size are invalid (see `kInvalidRecord`)
+  thrust::fill(policy,
+               list.indices.data_handle() + new_size,
+               list.indices.data_handle() + size,
+               kInvalidRecord<index_t>);
+  // the moves are read by the kernel above: release them (and the bits) once it's done
+  resource::sync_stream(res);
+  list.removed_bits = make_device_mdarray<uint32_t>(res, make_extents<size_type>(0));
+  list.n_removed    = 0;
+  list.size         = new_size;
+  return new_size;
+}
+
+}  // namespace raft::neighbors::ivf::detail
@@ -16,9 +16,12 @@
 
 #pragma once
 
+#include <raft/core/resource/cancellation_token.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
 #include <raft/spatial/knn/detail/ann_utils.cuh>
 
+#include <raft/neighbors/detail/ivf_list_removal.cuh>
 #include <raft/neighbors/detail/ivf_pq_codepacking.cuh>
 #include <raft/neighbors/ivf_list.hpp>
 #include <raft/neighbors/ivf_pq_types.hpp>
@@ -35,8 +38,10 @@
 #include <raft/linalg/gemm.cuh>
 #include <raft/linalg/map.cuh>
 #include <raft/linalg/norm.cuh>
+#include <raft/linalg/svd.cuh>
 #include <raft/linalg/unary_op.cuh>
 #include <raft/matrix/gather.cuh>
+#include <raft/matrix/detail/sample_rows.cuh>
 #include <raft/matrix/linewise_op.cuh>
 #include <raft/random/rng.cuh>
 #include <raft/stats/histogram.cuh>
@@ -47,15 +52,32 @@
 #include <raft/util/vectorized.cuh>
 
 #include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
 #include <rmm/cuda_stream_view.hpp>
 #include <rmm/device_uvector.hpp>
 #include <rmm/mr/device/managed_memory_resource.hpp>
 
+#include <thrust/copy.h>
+#include <thrust/count.h>
 #include <thrust/extrema.h>
+#include <thrust/fill.h>
+#include <thrust/for_each.h>
+#include <thrust/gather.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
 #include <thrust/scan.h>
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
 
+#include <algorithm>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <type_traits>
 #include <variant>
+#include <vector>
 
 namespace raft::neighbors::ivf_pq::detail {
 
@@ -153,60 +175,6 @@ inline void make_rotation_matrix(raft::resources const& handle,
   }
 }
 
-/**
- * @brief Compute residual vectors from the source dataset given by selected indices.
- *
- * The residual has the form `rotation_matrix %* (dataset[row_ids, :] - center)`
- *
- */
-template <typename T, typename IdxT>
-void select_residuals(raft::resources const& handle,
-                      float* residuals,
-                      IdxT n_rows,
-                      uint32_t dim,
-                      uint32_t rot_dim,
-                      const float* rotation_matrix,  // [rot_dim, dim]
-                      const float* center,           // [dim]
-                      const T* dataset,              // [.., dim]
-                      const IdxT* row_ids,           // [n_rows]
-                      rmm::mr::device_memory_resource* device_memory
-
-)
-{
-  auto stream = resource::get_cuda_stream(handle);
-  rmm::device_uvector<float> tmp(size_t(n_rows) * size_t(dim), stream, device_memory);
-  // Note: the number of rows of the input dataset isn't actually n_rows, but matrix::gather doesn't
-  // need to know it, any strictly positive number would work.
-  cub::TransformInputIterator<float, utils::mapping<float>, const T*> mapping_itr(
-    dataset, utils::mapping<float>{});
-  raft::matrix::gather(mapping_itr, (IdxT)dim, n_rows, row_ids, n_rows, tmp.data(), stream);
-
-  raft::matrix::linewise_op(handle,
-                            make_device_matrix_view<const T, IdxT>(tmp.data(), n_rows, dim),
-                            make_device_matrix_view<T, IdxT>(tmp.data(), n_rows, dim),
-                            true,
-                            raft::sub_op{},
-                            make_device_vector_view<const T, IdxT>(center, dim));
-
-  float alpha = 1.0;
-  float beta  = 0.0;
-  linalg::gemm(handle,
-               true,
-               false,
-               rot_dim,
-               n_rows,
-               dim,
-               &alpha,
-               rotation_matrix,
-               dim,
-               tmp.data(),
-               dim,
-               &beta,
-               residuals,
-               rot_dim,
-               stream);
-}
-
 /**
  * @brief Compute residual vectors from the source dataset given by selected indices.
  *
@@ -465,6 +433,47 @@ void train_per_subset(raft::resources const& handle,
   transpose_pq_centers(handle, index, pq_centers_tmp.data());
 }
 
+/**
+ * The PQ training sets of all clusters in one place: the residuals of the cluster rows
+ * interpreted as `pq_len`-dimensional sub-vectors, of which the first `n_sub[l]` train the
+ * codebook of the cluster `l`.
+ */
+template <typename IdxT>
+struct per_cluster_trainset {
+  const float* residuals;  // [n_rows, rot_dim]
+  const uint32_t* labels;  // [n_rows]
+  const IdxT* indices;     // [n_rows], the rows sorted by cluster
+  const IdxT* offsets;     // [n_lists + 1]
+  const uint32_t* n_sub;   // [n_lists]
+  uint32_t pq_dim;
+  uint32_t pq_len;
+
+  /** The `i`-th training sub-vector of the cluster `l` (`i < n_sub[l]`). */
+  HDI auto sub_vector(uint32_t l, uint32_t i) const -> const float*
+  {
+    const IdxT row = indices[offsets[l] + i / pq_dim];
+    return residuals + (uint64_t(row) * pq_dim + i % pq_dim) * pq_len;
+  }
+
+  /** The cluster and the rank in its training set of the `g`-th sub-vector in the cluster order. */
+  HDI auto locate(uint64_t g, uint32_t* rank) const -> uint32_t
+  {
+    const IdxT p     = g / pq_dim;
+    const uint32_t l = labels[indices[p]];
+    *rank            = uint32_t((uint64_t(p - offsets[l])) * pq_dim + g % pq_dim);
+    return l;
+  }
+};
+
+/**
+ * @brief Train the per-cluster PQ codebooks (codebook_gen::PER_CLUSTER).
+ *
+ * The codebooks of all clusters are trained at once with a batched Lloyd's k-means, so that every
+ * iteration is a fixed sequence of kernels over the training sets of all clusters, regardless of
+ * the number of lists. The codebook of a cluster is initialized with the sub-vectors evenly spread
+ * over its training set, and its empty centers are re-seeded with pseudo-random sub-vectors of the
+ * cluster after every iteration.
+ */
 template <typename IdxT>
 void train_per_cluster(raft::resources const& handle,
                        index<IdxT>& index,
@@ -474,8 +483,13 @@ void train_per_cluster(raft::resources const& handle,
                        uint32_t kmeans_n_iters,
                        rmm::mr::device_memory_resource* managed_memory)
 {
-  auto stream        = resource::get_cuda_stream(handle);
-  auto device_memory = resource::get_workspace_resource(handle);
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_pq::build::train_per_cluster(n_lists = %u)", index.n_lists());
+  auto stream              = resource::get_cuda_stream(handle);
+  auto device_memory       = resource::get_workspace_resource(handle);
+  const uint32_t pq_dim    = index.pq_dim();
+  const uint32_t pq_len    = index.pq_len();
+  const uint32_t book_size = index.pq_book_size();
 
   rmm::device_uvector<float> pq_centers_tmp(index.pq_centers().size(), stream, device_memory);
   rmm::device_uvector<uint32_t> cluster_sizes(index.n_lists(), stream, managed_memory);
@@ -490,66 +504,297 @@ void train_per_cluster(raft::resources const& handle,
                                            1,
                                            stream);
 
-  auto cluster_offsets      = offsets_buf.data();
-  auto indices              = indices_buf.data();
-  uint32_t max_cluster_size = calculate_offsets_and_indices(
+  auto cluster_offsets = offsets_buf.data();
+  auto indices         = indices_buf.data();
+  calculate_offsets_and_indices(
     IdxT(n_rows), index.n_lists(), labels, cluster_sizes.data(), cluster_offsets, indices, stream);
 
-  rmm::device_uvector<uint32_t> pq_labels(
-    size_t(max_cluster_size) * size_t(index.pq_dim()), stream, device_memory);
-  rmm::device_uvector<uint32_t> pq_cluster_sizes(index.pq_book_size(), stream, device_memory);
-  rmm::device_uvector<float> rot_vectors(
-    size_t(max_cluster_size) * size_t(index.rot_dim()), stream, device_memory);
-
-  resource::sync_stream(handle);  // make sure cluster offsets are up-to-date
-  for (uint32_t l = 0; l < index.n_lists(); l++) {
-    auto cluster_size = cluster_sizes.data()[l];
-    if (cluster_size == 0) continue;
-    common::nvtx::range<common::nvtx::domain::raft> pq_per_cluster_scope(
-      "ivf_pq::build::per_cluster[%u](size = %u)", l, cluster_size);
-
-    select_residuals(handle,
-                     rot_vectors.data(),
-                     IdxT(cluster_size),
-                     index.dim(),
-                     index.rot_dim(),
-                     index.rotation_matrix().data_handle(),
-                     index.centers().data_handle() + size_t(l) * size_t(index.dim_ext()),
-                     trainset,
-                     indices + cluster_offsets[l],
-                     device_memory);
-
-    // limit the cluster size to bound the training time.
-    // [sic] we interpret the data as pq_len-dimensional
-    size_t big_enough     = 256ul * std::max<size_t>(index.pq_book_size(), index.pq_dim());
-    size_t available_rows = size_t(cluster_size) * size_t(index.pq_dim());
-    auto pq_n_rows        = uint32_t(std::min(big_enough, available_rows));
-    // train PQ codebook for this cluster
-    auto rot_vectors_view = raft::make_device_matrix_view<const float, IdxT>(
-      rot_vectors.data(), pq_n_rows, index.pq_len());
-    auto centers_tmp_view = raft::make_device_matrix_view<float, IdxT>(
-      pq_centers_tmp.data() + static_cast<size_t>(index.pq_book_size()) *
-                                static_cast<size_t>(index.pq_len()) * static_cast<size_t>(l),
-      index.pq_book_size(),
-      index.pq_len());
-    auto pq_labels_view =
-      raft::make_device_vector_view<uint32_t, IdxT>(pq_labels.data(), pq_n_rows);
-    auto pq_cluster_sizes_view =
-      raft::make_device_vector_view<uint32_t, IdxT>(pq_cluster_sizes.data(), index.pq_book_size());
-    raft::cluster::kmeans_balanced_params kmeans_params;
-    kmeans_params.n_iters = kmeans_n_iters;
-    kmeans_params.metric  = raft::distance::DistanceType::L2Expanded;
-    raft::cluster::kmeans_balanced::helpers::build_clusters(handle,
-                                                            kmeans_params,
-                                                            rot_vectors_view,
-                                                            centers_tmp_view,
-                                                            pq_labels_view,
-                                                            pq_cluster_sizes_view,
-                                                            utils::mapping<float>{});
+  // The residuals of all training rows in the rotated space.
+  rmm::device_uvector<float> residuals(n_rows * index.rot_dim(), stream, device_memory);
+  flat_compute_residuals<float, IdxT>(handle,
+                                      residuals.data(),
+                                      IdxT(n_rows),
+                                      raft::make_const_mdspan(index.rotation_matrix()),
+                                      raft::make_const_mdspan(index.centers()),
+                                      trainset,
+                                      labels,
+                                      device_memory);
+
+  // limit the cluster training sets to bound the training time.
+  // [sic] we interpret the data as pq_len-dimensional
+  const uint32_t big_enough = 256u * std::max<uint32_t>(book_size, pq_dim);
+  rmm::device_uvector<uint32_t> n_sub(index.n_lists(), stream, device_memory);
+  linalg::map(handle,
+              raft::make_device_vector_view<uint32_t, uint32_t>(n_sub.data(), index.n_lists()),
+              [big_enough, pq_dim] __device__(uint32_t size) {
+                return uint32_t(std::min<uint64_t>(big_enough, uint64_t(size) * pq_dim));
+              },
+              raft::make_device_vector_view<const uint32_t, uint32_t>(cluster_sizes.data(),
+                                                                      index.n_lists()));
+  per_cluster_trainset<IdxT> data{
+    residuals.data(), labels, indices, cluster_offsets, n_sub.data(), pq_dim, pq_len};
+
+  const size_t n_centers = size_t(index.n_lists()) * book_size;
+  const uint64_t n_vecs  = uint64_t(n_rows) * pq_dim;
+  rmm::device_uvector<float> sums(n_centers * pq_len, stream, device_memory);
+  rmm::device_uvector<uint32_t> counts(n_centers, stream, device_memory);
+  rmm::device_uvector<uint32_t> sub_labels(n_vecs, stream, device_memory);
+  auto* centers     = pq_centers_tmp.data();
+  auto* sums_ptr    = sums.data();
+  auto* counts_ptr  = counts.data();
+  auto* labels_ptr  = sub_labels.data();
+  auto centers_view = raft::make_device_vector_view<float, size_t>(centers, n_centers * pq_len);
+
+  // The initial centers are spread evenly over the training set of the cluster.
+  linalg::map_offset(handle, centers_view, [data, book_size, pq_len] __device__(size_t e) {
+    const auto c     = uint32_t((e / pq_len) % book_size);
+    const auto l     = uint32_t(e / (size_t(pq_len) * book_size));
+    const uint32_t n = data.n_sub[l];
+    if (n == 0) { return 0.0f; }
+    const uint32_t i = n >= book_size ? uint32_t(uint64_t(c) * n / book_size) : c % n;
+    return data.sub_vector(l, i)[e % pq_len];
+  });
+
+  for (uint32_t iter = 0; iter < kmeans_n_iters; iter++) {
+    // Assign every training sub-vector to the closest center of its cluster.
+    linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<uint32_t, uint64_t>(labels_ptr, n_vecs),
+      [data, centers, book_size, pq_len] __device__(uint64_t g) {
+        uint32_t rank;
+        const uint32_t l = data.locate(g, &rank);
+        if (rank >= data.n_sub[l]) { return book_size; }
+        const float* x  = data.sub_vector(l, rank);
+        const float* c  = centers + size_t(l) * book_size * pq_len;
+        uint32_t best   = 0;
+        float best_dist = std::numeric_limits<float>::max();
+        for (uint32_t k = 0; k < book_size; k++, c += pq_len) {
+          float d = 0;
+          for (uint32_t j = 0; j < pq_len; j++) {
+            const float diff = x[j] - c[j];
+            d += diff * diff;
+          }
+          if (d < best_dist) {
+            best_dist = d;
+            best      = k;
+          }
+        }
+        return best;
+      });
+
+    // Accumulate the new centers.
+    RAFT_CUDA_TRY(cudaMemsetAsync(sums_ptr, 0, sums.size() * sizeof(float), stream));
+    RAFT_CUDA_TRY(cudaMemsetAsync(counts_ptr, 0, counts.size() * sizeof(uint32_t), stream));
+    thrust::for_each_n(resource::get_thrust_policy(handle),
+                       thrust::make_counting_iterator<uint64_t>(0),
+                       n_vecs,
+                       [data, labels_ptr, sums_ptr, counts_ptr, book_size, pq_len] __device__(
+                         uint64_t g) {
+                         const uint32_t k = labels_ptr[g];
+                         if (k >= book_size) { return; }
+                         uint32_t rank;
+                         const uint32_t l    = data.locate(g, &rank);
+                         const float* x      = data.sub_vector(l, rank);
+                         const size_t center = size_t(l) * book_size + k;
+                         for (uint32_t j = 0; j < pq_len; j++) {
+                           atomicAdd(sums_ptr + center * pq_len + j, x[j]);
+                         }
+                         atomicAdd(counts_ptr + center, 1u);
+                       });
+
+    // Update the centers; re-seed the empty ones.
+    linalg::map_offset(
+      handle,
+      centers_view,
+      [data, sums_ptr, counts_ptr, book_size, pq_len, iter] __device__(size_t e) {
+        const size_t center  = e / pq_len;
+        const uint32_t count = counts_ptr[center];
+        if (count > 0) { return sums_ptr[e] / float(count); }
+        const auto l     = uint32_t(center / book_size);
+        const uint32_t n = data.n_sub[l];
+        if (n == 0) { return 0.0f; }
+        const uint32_t i = uint32_t((center * 2654435761ull + iter * 40503ull) % n);
+        return data.sub_vector(l, i)[e % pq_len];
+      });
   }
   transpose_pq_centers(handle, index, pq_centers_tmp.data());
 }
 
+/**
+ * @brief Learn the rotation matrix with the optimized product quantization (OPQ).
+ *
+ * Every iteration trains per-subspace codebooks on the rotated residuals of the training set, and
+ * then replaces the rotation with the solution of the orthogonal Procrustes problem between the
+ * residuals and their quantized values: `R = U V^T`, where `U S V^T = quantized^T residuals`.
+ * The index rotation matrix is used as the initial rotation and is updated in-place.
+ *
+ * @param handle
+ * @param index
+ * @param n_rows the number of rows in the training set
+ * @param[in] trainset device pointer to the training set [n_rows, dim]
+ * @param[in] cluster_centers device pointer to the (not rotated) cluster centers [n_lists, dim]
+ * @param[in] labels device pointer to the cluster labels of the training set [n_rows]
+ * @param kmeans_n_iters the number of k-means iterations to train the codebooks
+ * @param opq_n_iters the number of OPQ iterations
+ */
+template <typename IdxT>
+void train_opq_rotation(raft::resources const& handle,
+                        index<IdxT>& index,
+                        size_t n_rows,
+                        const float* trainset,
+                        const float* cluster_centers,
+                        const uint32_t* labels,
+                        uint32_t kmeans_n_iters,
+                        uint32_t opq_n_iters)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_pq::build::train_opq_rotation(%u)", opq_n_iters);
+  auto stream         = resource::get_cuda_stream(handle);
+  auto device_memory  = resource::get_workspace_resource(handle);
+  uint32_t dim        = index.dim();
+  uint32_t rot_dim    = index.rot_dim();
+  uint32_t pq_len     = index.pq_len();
+  uint32_t book_size  = index.pq_book_size();
+  float* rotation_mat = index.rotation_matrix().data_handle();
+
+  // The residuals in the original space don't depend on the rotation.
+  rmm::device_uvector<float> residuals(n_rows * dim, stream, device_memory);
+  auto residuals_view =
+    raft::make_device_vector_view<float, size_t>(residuals.data(), residuals.size());
+  linalg::map_offset(
+    handle, residuals_view, [trainset, cluster_centers, labels, dim] __device__(size_t i) {
+      auto row_ix = i / dim;
+      auto el_ix  = i % dim;
+      return trainset[i] - cluster_centers[size_t(labels[row_ix]) * dim + el_ix];
+    });
+
+  rmm::device_uvector<float> rot_residuals(n_rows * rot_dim, stream, device_memory);
+  rmm::device_uvector<float> quantized(n_rows * rot_dim, stream, device_memory);
+  rmm::device_uvector<float> sub_trainset(n_rows * pq_len, stream, device_memory);
+  rmm::device_uvector<float> sub_quantized(n_rows * pq_len, stream, device_memory);
+  rmm::device_uvector<float> sub_centers(size_t(book_size) * pq_len, stream, device_memory);
+  rmm::device_uvector<uint32_t> sub_labels(n_rows, stream, device_memory);
+  rmm::device_uvector<uint32_t> sub_cluster_sizes(book_size, stream, device_memory);
+  rmm::device_uvector<float> cross(size_t(rot_dim) * dim, stream, device_memory);
+  rmm::device_uvector<float> sing_vals(dim, stream, device_memory);
+  rmm::device_uvector<float> left_vecs(size_t(rot_dim) * dim, stream, device_memory);
+  rmm::device_uvector<float> right_vecs(size_t(dim) * dim, stream, device_memory);
+
+  raft::cluster::kmeans_balanced_params kmeans_params;
+  kmeans_params.n_iters = kmeans_n_iters;
+  kmeans_params.metric  = raft::distance::DistanceType::L2Expanded;
+
+  for (uint32_t iter = 0; iter < opq_n_iters; iter++) {
+    // rot_residuals = residuals %* rotation_matrix^T  [n_rows, rot_dim]
+    float alpha = 1.0;
+    float beta  = 0.0;
+    linalg::gemm(handle,
+                 true,
+                 false,
+                 rot_dim,
+                 n_rows,
+                 dim,
+                 &alpha,
+                 rotation_mat,
+                 dim,
+                 residuals.data(),
+                 dim,
+                 &beta,
+                 rot_residuals.data(),
+                 rot_dim,
+                 stream);
+
+    // Quantize the rotated residuals with freshly trained codebooks, one subspace at a time.
+    for (uint32_t j = 0; j < index.pq_dim(); j++) {
+      RAFT_CUDA_TRY(cudaMemcpy2DAsync(sub_trainset.data(),
+                                      sizeof(float) * pq_len,
+                                      rot_residuals.data() + pq_len * j,
+                                      sizeof(float) * rot_dim,
+                                      sizeof(float) * pq_len,
+                                      n_rows,
+                                      cudaMemcpyDefault,
+                                      stream));
+      auto sub_trainset_view =
+        raft::make_device_matrix_view<const float, IdxT>(sub_trainset.data(), n_rows, pq_len);
+      auto sub_centers_view =
+        raft::make_device_matrix_view<float, IdxT>(sub_centers.data(), book_size, pq_len);
+      auto sub_labels_view =
+        raft::make_device_vector_view<uint32_t, IdxT>(sub_labels.data(), n_rows);
+      auto sub_cluster_sizes_view =
+        raft::make_device_vector_view<uint32_t, IdxT>(sub_cluster_sizes.data(), book_size);
+      raft::cluster::kmeans_balanced::helpers::build_clusters(handle,
+                                                              kmeans_params,
+                                                              sub_trainset_view,
+                                                              sub_centers_view,
+                                                              sub_labels_view,
+                                                              sub_cluster_sizes_view,
+                                                              utils::mapping<float>{});
+      raft::matrix::gather(sub_centers.data(),
+                           size_t(pq_len),
+                           size_t(book_size),
+                           sub_labels.data(),
+                           n_rows,
+                           sub_quantized.data(),
+                           stream);
+      RAFT_CUDA_TRY(cudaMemcpy2DAsync(quantized.data() + pq_len * j,
+                                      sizeof(float) * rot_dim,
+                                      sub_quantized.data(),
+                                      sizeof(float) * pq_len,
+                                      sizeof(float) * pq_len,
+                                      n_rows,
+                                      cudaMemcpyDefault,
+                                      stream));
+    }
+
+    // cross = quantized^T %* residuals  [rot_dim, dim], column-major
+    linalg::gemm(handle,
+                 false,
+                 true,
+                 rot_dim,
+                 dim,
+                 n_rows,
+                 &alpha,
+                 quantized.data(),
+                 rot_dim,
+                 residuals.data(),
+                 dim,
+                 &beta,
+                 cross.data(),
+                 rot_dim,
+                 stream);
+
+    // cross = U S V^T (NB: rot_dim >= dim, as required by the QR-based SVD)
+    linalg::svdQR(handle,
+                  cross.data(),
+                  int(rot_dim),
+                  int(dim),
+                  sing_vals.data(),
+                  left_vecs.data(),
+                  right_vecs.data(),
+                  false,
+                  true,
+                  true,
+                  stream);
+
+    // The row-major rotation_matrix = U V^T is the column-major (V^T)^T U^T
+    linalg::gemm(handle,
+                 true,
+                 true,
+                 dim,
+                 rot_dim,
+                 dim,
+                 &alpha,
+                 right_vecs.data(),
+                 dim,
+                 left_vecs.data(),
+                 rot_dim,
+                 &beta,
+                 rotation_mat,
+                 dim,
+                 stream);
+  }
+}
+
 /**
  * A helper function: given the dataset in the rotated space
  *  [n_rows, rot_dim] = [n_rows, pq_dim * pq_len],
@@ -1361,6 +1606,136 @@ void process_and_fill_codes(raft::resources const& handle,
   RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
 
+template <uint32_t BlockSize, uint32_t PqBits, typename IdxT>
+__launch_bounds__(BlockSize) RAFT_KERNEL encode_flat_codes_kernel(
+  device_matrix_view<const float, IdxT, row_major> residuals,
+  const uint32_t* labels,
+  device_mdspan<const float, extent_3d<uint32_t>, row_major> pq_centers,
+  codebook_gen codebook_kind,
+  uint8_t* out_codes)
+{
+  constexpr uint32_t kSubWarpSize = std::min<uint32_t>(WarpSize, 1u << PqBits);
+  using subwarp_align             = Pow2<kSubWarpSize>;
+  const uint32_t lane_id          = subwarp_align::mod(threadIdx.x);
+  const IdxT row_ix = subwarp_align::div(IdxT{threadIdx.x} + IdxT{BlockSize} * IdxT{blockIdx.x});
+  if (row_ix >= residuals.extent(0)) { return; }
+
+  // write the codes (one record per subwarp) into the tightly packed row of the vector
+  const uint32_t pq_dim = residuals.extent(1) / pq_centers.extent(1);
+  const size_t row_size = raft::ceildiv<size_t>(pq_dim * PqBits, 8);
+  auto encode_action =
+    encode_vectors<kSubWarpSize, IdxT>{pq_centers, residuals, codebook_kind, labels[row_ix]};
+  auto write_action = unpack_contiguous<PqBits>(out_codes + row_size * row_ix, pq_dim);
+  for (uint32_t j = 0; j < pq_dim; j++) {
+    uint8_t code = encode_action(row_ix, j);
+    if (lane_id == 0) { write_action(code, 0, j); }
+  }
+}
+
+/**
+ * Encode the vectors by the index without adding them to the lists: the coarse (cluster) labels
+ * and the flat PQ codes [n_rows, ceildiv(pq_dim * pq_bits, 8)] of the vectors.
+ *
+ * The vectors not accessible from the device are copied by batches, prefetched in a stream of the
+ * pool of the resources if it has one, while the previous batch is labeled, rotated and encoded.
+ */
+template <typename T, typename IdxT>
+void transform(raft::resources const& handle,
+               const index<IdxT>& index,
+               const T* vectors,
+               IdxT n_rows,
+               uint32_t* out_labels,
+               uint8_t* out_codes)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_pq::transform(%zu, %u)", size_t(n_rows), index.dim());
+  static_assert(std::is_same_v<T, float> || std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>,
+                "Unsupported data type");
+  if (n_rows == 0) { return; }
+
+  auto stream           = resource::get_cuda_stream(handle);
+  auto* device_memory   = resource::get_workspace_resource(handle);
+  auto* pinned_memory   = resource::get_pinned_memory_resource(handle);
+  const auto n_clusters = index.n_lists();
+  auto prefetch_stream  = resource::is_stream_pool_initialized(handle)
+                            ? std::make_optional(resource::get_stream_from_stream_pool(handle))
+                            : std::nullopt;
+  constexpr size_t kReasonableMaxBatchSize = 65536;
+  utils::batch_load_iterator<T> vec_batches(vectors,
+                                            n_rows,
+                                            index.dim(),
+                                            std::min<size_t>(n_rows, kReasonableMaxBatchSize),
+                                            stream,
+                                            device_memory,
+                                            pinned_memory,
+                                            prefetch_stream);
+
+  // The cluster centers in the index are stored padded, which is not acceptable by
+  // the kmeans_balanced::predict. Thus, we need the restructuring copy.
+  rmm::device_uvector<float> cluster_centers(
+    size_t(n_clusters) * size_t(index.dim()), stream, device_memory);
+  RAFT_CUDA_TRY(cudaMemcpy2DAsync(cluster_centers.data(),
+                                  sizeof(float) * index.dim(),
+                                  index.centers().data_handle(),
+                                  sizeof(float) * index.dim_ext(),
+                                  sizeof(float) * index.dim(),
+                                  n_clusters,
+                                  cudaMemcpyDefault,
+                                  stream));
+  auto centers_view = raft::make_device_matrix_view<const float, IdxT>(
+    cluster_centers.data(), n_clusters, index.dim());
+  raft::cluster::kmeans_balanced_params kmeans_params;
+  kmeans_params.metric = index.metric();
+
+  constexpr uint32_t kBlockSize  = 256;
+  const uint32_t threads_per_vec = std::min<uint32_t>(WarpSize, index.pq_book_size());
+  const size_t row_size          = raft::ceildiv<size_t>(index.pq_dim() * index.pq_bits(), 8);
+
+  auto kernel = [](uint32_t pq_bits) {
+    switch (pq_bits) {
+      case 4: return encode_flat_codes_kernel<kBlockSize, 4, IdxT>;
+      case 5: return encode_flat_codes_kernel<kBlockSize, 5, IdxT>;
+      case 6: return encode_flat_codes_kernel<kBlockSize, 6, IdxT>;
+      case 7: return encode_flat_codes_kernel<kBlockSize, 7, IdxT>;
+      case 8: return encode_flat_codes_kernel<kBlockSize, 8, IdxT>;
+      default: RAFT_FAIL("Invalid pq_bits (%u), the value must be within [4, 8]", pq_bits);
+    }
+  }(index.pq_bits());
+
+  for (const auto& batch : vec_batches) {
+    resource::check_cancellation(handle);
+    auto batch_rows   = IdxT(batch.size());
+    auto batch_labels = out_labels + batch.offset();
+    raft::cluster::kmeans_balanced::predict(
+      handle,
+      kmeans_params,
+      raft::make_device_matrix_view<const T, IdxT>(batch.data(), batch_rows, index.dim()),
+      centers_view,
+      raft::make_device_vector_view<uint32_t, IdxT>(batch_labels, batch_rows),
+      utils::mapping<float>{});
+
+    auto residuals = make_device_mdarray<float>(
+      handle, device_memory, make_extents<IdxT>(batch_rows, index.rot_dim()));
+    flat_compute_residuals<T, IdxT>(handle,
+                                    residuals.data_handle(),
+                                    batch_rows,
+                                    index.rotation_matrix(),
+                                    index.centers(),
+                                    batch.data(),
+                                    static_cast<const uint32_t*>(batch_labels),
+                                    device_memory);
+
+    dim3 blocks(div_rounding_up_safe<IdxT>(batch_rows, kBlockSize / threads_per_vec), 1, 1);
+    dim3 threads(kBlockSize, 1, 1);
+    kernel<<<blocks, threads, 0, stream>>>(raft::make_const_mdspan(residuals.view()),
+                                           batch_labels,
+                                           index.pq_centers(),
+                                           index.codebook_kind(),
+                                           out_codes + row_size * batch.offset());
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+}
+
 /** Update the state of the dependent index members. */
 template <typename IdxT>
 void recompute_internal_state(const raft::resources& res, index<IdxT>& index)
@@ -1369,16 +1744,20 @@ void recompute_internal_state(const raft::resources& res, index<IdxT>& index)
   auto tmp_res = resource::get_workspace_resource(res);
   rmm::device_uvector<uint32_t> sorted_sizes(index.n_lists(), stream, tmp_res);
 
-  // Actualize the list pointers
-  auto data_ptrs = index.data_ptrs();
-  auto inds_ptrs = index.inds_ptrs();
+  // Actualize the list pointers (in one copy per array, which matters with many lists)
+  std::vector<uint8_t*> data_ptrs_host(index.n_lists());
+  std::vector<IdxT*> inds_ptrs_host(index.n_lists());
+  std::vector<uint32_t*> removed_ptrs_host(index.n_lists());
   for (uint32_t label = 0; label < index.n_lists(); label++) {
-    auto& list          = index.lists()[label];
-    const auto data_ptr = list ? list->data.data_handle() : nullptr;
-    const auto inds_ptr = list ? list->indices.data_handle() : nullptr;
-    copy(&data_ptrs(label), &data_ptr, 1, stream);
-    copy(&inds_ptrs(label), &inds_ptr, 1, stream);
+    auto& list               = index.lists()[label];
+    data_ptrs_host[label]    = list ? list->data.data_handle() : nullptr;
+    inds_ptrs_host[label]    = list ? list->indices.data_handle() : nullptr;
+    removed_ptrs_host[label] =
+      list && list->n_removed > 0 ? list->removed_bits.data_handle() : nullptr;
   }
+  copy(index.data_ptrs().data_handle(), data_ptrs_host.data(), index.n_lists(), stream);
+  copy(index.inds_ptrs().data_handle(), inds_ptrs_host.data(), index.n_lists(), stream);
+  copy(index.removed_ptrs().data_handle(), removed_ptrs_host.data(), index.n_lists(), stream);
 
   // Sort the cluster sizes in the descending order.
   int begin_bit             = 0;
@@ -1433,8 +1812,7 @@ auto extend_list_prepare(raft::resources const& res,
   resource::sync_stream(res);
   uint32_t new_size = offset + n_rows;
   copy(index->list_sizes().data_handle() + label, &new_size, 1, resource::get_cuda_stream(res));
-  auto spec = list_spec<uint32_t, IdxT>{
-    index->pq_bits(), index->pq_dim(), index->conservative_memory_allocation()};
+  auto spec = index->make_list_spec();
   auto& list = index->lists()[label];
   ivf::resize_list(res, list, spec, new_size, offset);
   copy(list->indices.data_handle() + offset,
@@ -1496,6 +1874,468 @@ void erase_list(raft::resources const& res, index<IdxT>* index, uint32_t label)
   recompute_internal_state(res, *index);
 }
 
+/**
+ * Drop the removed records of the lists with at least `threshold` of their records removed.
+ * See the public interface for the api and usage.
+ */
+template <typename IdxT>
+void compact(raft::resources const& res, index<IdxT>* index, double threshold)
+{
+  if (index->n_removed() == 0) { return; }
+  auto stream            = resource::get_cuda_stream(res);
+  const uint32_t n_lists = index->n_lists();
+  std::vector<uint32_t> sizes(n_lists);
+  copy(sizes.data(), index->list_sizes().data_handle(), n_lists, stream);
+  resource::sync_stream(res);
+  auto& lists = index->lists();
+  for (uint32_t label = 0; label < n_lists; label++) {
+    auto& list = lists[label];
+    if (!list || list->n_removed == 0 || list->n_removed < threshold * sizes[label]) { continue; }
+    // a record is a row of `pq_chunks` interleaved chunks of kIndexGroupVecLen bytes
+    const auto row_len = static_cast<uint32_t>(list->data.extent(1) * kIndexGroupVecLen);
+    sizes[label] = ivf::detail::compact_list(res, *list, sizes[label], row_len, kIndexGroupVecLen);
+  }
+  copy(index->list_sizes().data_handle(), sizes.data(), n_lists, stream);
+  recompute_internal_state(res, *index);
+}
+
+/**
+ * Mark the records with the given source indices as removed.
+ * See the public interface for the api and usage.
+ */
+template <typename IdxT>
+auto remove(raft::resources const& res,
+            index<IdxT>* index,
+            device_vector_view<const IdxT, int64_t> ids,
+            double compaction_threshold) -> int64_t
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_pq::remove(%zu ids)", size_t(ids.extent(0)));
+  const int64_t n_removed = ivf::detail::mark_removed(res,
+                                                      index->lists(),
+                                                      index->inds_ptrs().data_handle(),
+                                                      index->list_sizes().data_handle(),
+                                                      ids);
+  // the lists which got their first removed records need their bitmasks in the index
+  recompute_internal_state(res, *index);
+  compact(res, index, compaction_threshold);
+  return n_removed;
+}
+
+/**
+ * Copy the records of all lists from/to the flat compressed `codes`
+ * [size, ceildiv(pq_dim * pq_bits, 8)] and `indices` [size] laid out list by list, as given by
+ * `offsets` [n_lists + 1]: a thread per record.
+ */
+template <uint32_t BlockSize, uint32_t PqBits, bool Pack, typename IdxT>
+__launch_bounds__(BlockSize) RAFT_KERNEL
+  convert_all_lists_kernel(std::conditional_t<Pack, uint8_t, const uint8_t>* const* data_ptrs,
+                           std::conditional_t<Pack, IdxT, const IdxT>* const* inds_ptrs,
+                           const int64_t* offsets,
+                           uint32_t n_lists,
+                           uint32_t pq_dim,
+                           uint32_t n_chunks,
+                           std::conditional_t<Pack, const uint8_t*, uint8_t*> codes,
+                           std::conditional_t<Pack, const IdxT*, IdxT*> indices)
+{
+  const int64_t row = int64_t(blockIdx.x) * int64_t(BlockSize) + int64_t(threadIdx.x);
+  if (row >= offsets[n_lists]) { return; }
+  const auto label  = ivf::find_list(offsets, n_lists, row);
+  const uint32_t ix = row - offsets[label];
+  // Only the trailing extents matter for the indexing; the list holds at least `ix + 1` records.
+  const typename list_spec<uint32_t, uint32_t>::list_extents exts{
+    Pow2<kIndexGroupSize>::div(ix) + 1, n_chunks};
+  auto* row_codes = codes + row * raft::ceildiv<uint32_t>(pq_dim * PqBits, 8);
+  if constexpr (Pack) {
+    device_mdspan<uint8_t, list_spec<uint32_t, uint32_t>::list_extents, row_major> list{
+      data_ptrs[label], exts};
+    write_vector<PqBits, 1>(
+      list, ix, uint32_t(0), pq_dim, pack_contiguous<PqBits>(row_codes, pq_dim));
+    inds_ptrs[label][ix] = indices[row];
+  } else {
+    device_mdspan<const uint8_t, list_spec<uint32_t, uint32_t>::list_extents, row_major> list{
+      data_ptrs[label], exts};
+    run_on_vector<PqBits>(list, ix, 0, pq_dim, unpack_contiguous<PqBits>(row_codes, pq_dim));
+    indices[row] = inds_ptrs[label][ix];
+  }
+}
+
+template <bool Pack, typename IdxT, typename DataPtrT, typename IndsPtrT, typename CodeT>
+void convert_all_lists(raft::resources const& res,
+                       const index<IdxT>& index,
+                       DataPtrT data_ptrs,
+                       IndsPtrT inds_ptrs,
+                       CodeT codes,
+                       std::conditional_t<Pack, const IdxT*, IdxT*> indices,
+                       const int64_t* list_offsets,
+                       int64_t n_rows)
+{
+  if (n_rows == 0) { return; }
+  constexpr uint32_t kBlockSize = 256;
+  const uint32_t n_chunks = raft::div_rounding_up_safe<uint32_t>(
+    index.pq_dim(), (kIndexGroupVecLen * 8u) / index.pq_bits());
+  dim3 blocks(div_rounding_up_safe<int64_t>(n_rows, kBlockSize), 1, 1);
+  dim3 threads(kBlockSize, 1, 1);
+  auto kernel = [pq_bits = index.pq_bits()]() {
+    switch (pq_bits) {
+      case 4: return convert_all_lists_kernel<kBlockSize, 4, Pack, IdxT>;
+      case 5: return convert_all_lists_kernel<kBlockSize, 5, Pack, IdxT>;
+      case 6: return convert_all_lists_kernel<kBlockSize, 6, Pack, IdxT>;
+      case 7: return convert_all_lists_kernel<kBlockSize, 7, Pack, IdxT>;
+      case 8: return convert_all_lists_kernel<kBlockSize, 8, Pack, IdxT>;
+      default: RAFT_FAIL("Invalid pq_bits (%u), the value must be within [4, 8]", pq_bits);
+    }
+  }();
+  kernel<<<blocks, threads, 0, resource::get_cuda_stream(res)>>>(data_ptrs,
+                                                                 inds_ptrs,
+                                                                 list_offsets,
+                                                                 index.n_lists(),
+                                                                 index.pq_dim(),
+                                                                 n_chunks,
+                                                                 codes,
+                                                                 indices);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/**
+ * Unpack the codes of all lists in one pass.
+ * See the public interface for the api and usage.
+ */
+template <typename IdxT>
+void unpack_all_lists(raft::resources const& res,
+                      const index<IdxT>& index,
+                      device_matrix_view<uint8_t, int64_t, row_major> codes,
+                      device_vector_view<IdxT, int64_t> indices,
+                      device_vector_view<int64_t, int64_t> list_offsets)
+{
+  const int64_t n_rows = index.size();
+  RAFT_EXPECTS(list_offsets.extent(0) == int64_t(index.n_lists()) + 1,
+               "list_offsets must have n_lists + 1 elements");
+  RAFT_EXPECTS(codes.extent(0) == n_rows &&
+                 codes.extent(1) == raft::ceildiv<int64_t>(index.pq_dim() * index.pq_bits(), 8),
+               "codes must be a [index.size(), ceildiv(pq_dim * pq_bits, 8)] matrix");
+  RAFT_EXPECTS(indices.extent(0) == n_rows, "indices must have index.size() elements");
+  auto stream = resource::get_cuda_stream(res);
+  RAFT_CUDA_TRY(cudaMemsetAsync(list_offsets.data_handle(), 0, sizeof(int64_t), stream));
+  auto sizes = thrust::make_transform_iterator(index.list_sizes().data_handle(),
+                                               raft::cast_op<int64_t>{});
+  thrust::inclusive_scan(resource::get_thrust_policy(res),
+                         sizes,
+                         sizes + index.n_lists(),
+                         list_offsets.data_handle() + 1);
+  convert_all_lists<false>(res,
+                           index,
+                           index.data_ptrs().data_handle(),
+                           index.inds_ptrs().data_handle(),
+                           codes.data_handle(),
+                           indices.data_handle(),
+                           list_offsets.data_handle(),
+                           n_rows);
+}
+
+/**
+ * Replace the lists of the index by the given codes in one pass.
+ * See the public interface for the api and usage.
+ */
+template <typename IdxT>
+void pack_all_lists(raft::resources const& res,
+                    index<IdxT>* index,
+                    device_matrix_view<const uint8_t, int64_t, row_major> codes,
+                    device_vector_view<const IdxT, int64_t> indices,
+                    device_vector_view<const int64_t, int64_t> list_offsets)
+{
+  const uint32_t n_lists = index->n_lists();
+  RAFT_EXPECTS(list_offsets.extent(0) == int64_t(n_lists) + 1,
+               "list_offsets must have n_lists + 1 elements");
+  RAFT_EXPECTS(codes.extent(1) == raft::ceildiv<int64_t>(index->pq_dim() * index->pq_bits(), 8),
+               "codes must have ceildiv(pq_dim * pq_bits, 8) columns");
+  RAFT_EXPECTS(indices.extent(0) == codes.extent(0), "codes and indices must have the same size");
+  auto stream = resource::get_cuda_stream(res);
+  std::vector<int64_t> offsets(n_lists + 1);
+  copy(offsets.data(), list_offsets.data_handle(), n_lists + 1, stream);
+  resource::sync_stream(res);
+  RAFT_EXPECTS(offsets[0] == 0 && offsets[n_lists] == codes.extent(0),
+               "list_offsets must span all rows of codes");
+
+  // Allocate the lists to the exact sizes
+  std::vector<uint32_t> sizes(n_lists);
+  auto spec   = index->make_list_spec();
+  auto& lists = index->lists();
+  for (uint32_t label = 0; label < n_lists; label++) {
+    const auto size = offsets[label + 1] - offsets[label];
+    RAFT_EXPECTS(size >= 0 && size <= std::numeric_limits<uint32_t>::max(),
+                 "list_offsets must be non-decreasing, with lists of up to 2^32-1 records");
+    sizes[label] = size;
+    if (size == 0) {
+      lists[label].reset();
+    } else {
+      lists[label] = std::make_shared<list_data<IdxT>>(res, spec, sizes[label]);
+    }
+  }
+  copy(index->list_sizes().data_handle(), sizes.data(), n_lists, stream);
+  recompute_internal_state(res, *index);
+
+  convert_all_lists<true>(res,
+                          *index,
+                          index->data_ptrs().data_handle(),
+                          index->inds_ptrs().data_handle(),
+                          codes.data_handle(),
+                          indices.data_handle(),
+                          list_offsets.data_handle(),
+                          codes.extent(0));
+}
+
+/**
+ * Split the oversized lists in two, reusing the labels of the smallest lists, whose records are
+ * merged into the closest remaining lists.
+ * See the public interface for the api and usage.
+ */
+template <typename IdxT>
+auto rebalance(raft::resources const& res, index<IdxT>* index, const rebalance_params& params)
+  -> uint32_t
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_pq::rebalance(%zu, %u)", size_t(index->size()), index->n_lists());
+  RAFT_EXPECTS(params.max_list_size_ratio > 1.0, "max_list_size_ratio must be larger than one.");
+  // the moved records must not bring the removed ones back
+  compact(res, index, 0.0);
+  auto stream            = resource::get_cuda_stream(res);
+  auto policy            = resource::get_thrust_policy(res);
+  auto* device_memory    = resource::get_workspace_resource(res);
+  const uint32_t n_lists = index->n_lists();
+  const uint32_t dim     = index->dim();
+  if (index->size() == 0 || n_lists < 2) { return 0; }
+
+  std::vector<uint32_t> list_sizes(n_lists);
+  copy(list_sizes.data(), index->list_sizes().data_handle(), n_lists, stream);
+  resource::sync_stream(res);
+
+  // Pair the largest lists to split with the smallest lists to free their labels.
+  std::vector<uint32_t> order(n_lists);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&list_sizes](uint32_t a, uint32_t b) {
+    return list_sizes[a] > list_sizes[b];
+  });
+  const double max_list_size =
+    params.max_list_size_ratio * static_cast<double>(index->size()) / n_lists;
+  std::vector<uint32_t> split_labels;
+  std::vector<uint32_t> freed_labels;
+  for (uint32_t i = 0, j = n_lists; i + 1 < j && list_sizes[order[i]] > max_list_size; i++) {
+    split_labels.push_back(order[i]);
+    freed_labels.push_back(order[--j]);
+  }
+  const auto n_splits = static_cast<uint32_t>(split_labels.size());
+  if (n_splits == 0) { return 0; }
+  RAFT_LOG_DEBUG("ivf_pq::rebalance: splitting %u lists", n_splits);
+
+  // Decode all the records of the affected lists.
+  std::vector<uint32_t> affected_labels(split_labels);
+  affected_labels.insert(affected_labels.end(), freed_labels.begin(), freed_labels.end());
+  size_t n_rows  = 0;
+  size_t n_freed = 0;
+  for (auto label : affected_labels) {
+    n_rows += list_sizes[label];
+  }
+  for (auto label : freed_labels) {
+    n_freed += list_sizes[label];
+  }
+  const size_t n_split_rows = n_rows - n_freed;
+  auto vectors =
+    make_device_mdarray<float>(res, device_memory, make_extents<int64_t>(n_rows, dim));
+  rmm::device_uvector<IdxT> indices(n_rows, stream, device_memory);
+  rmm::device_uvector<uint32_t> labels(n_rows, stream, device_memory);
+  size_t offset = 0;
+  for (auto label : affected_labels) {
+    const uint32_t size = list_sizes[label];
+    if (size == 0) { continue; }
+    reconstruct_list_data<float, IdxT>(
+      res,
+      *index,
+      make_device_matrix_view<float, uint32_t>(vectors.data_handle() + offset * dim, size, dim),
+      label,
+      uint32_t(0));
+    copy(indices.data() + offset, index->lists()[label]->indices.data_handle(), size, stream);
+    thrust::fill_n(policy, labels.data() + offset, size, label);
+    offset += size;
+  }
+
+  // The records of the freed lists go to the closest of the other lists.
+  raft::cluster::kmeans_balanced_params kmeans_params;
+  kmeans_params.n_iters = params.kmeans_n_iters;
+  kmeans_params.metric  = index->metric();
+  auto centers =
+    make_device_mdarray<float>(res, device_memory, make_extents<int64_t>(n_lists, dim));
+  RAFT_CUDA_TRY(cudaMemcpy2DAsync(centers.data_handle(),
+                                  sizeof(float) * dim,
+                                  index->centers().data_handle(),
+                                  sizeof(float) * index->dim_ext(),
+                                  sizeof(float) * dim,
+                                  n_lists,
+                                  cudaMemcpyDefault,
+                                  stream));
+  if (n_freed > 0) {
+    std::vector<bool> is_freed(n_lists, false);
+    for (auto label : freed_labels) {
+      is_freed[label] = true;
+    }
+    std::vector<uint32_t> kept_labels;
+    for (uint32_t label = 0; label < n_lists; label++) {
+      if (!is_freed[label]) { kept_labels.push_back(label); }
+    }
+    const auto n_kept = static_cast<int64_t>(kept_labels.size());
+    rmm::device_uvector<uint32_t> kept_labels_dev(n_kept, stream, device_memory);
+    copy(kept_labels_dev.data(), kept_labels.data(), n_kept, stream);
+    auto kept_centers =
+      make_device_mdarray<float>(res, device_memory, make_extents<int64_t>(n_kept, dim));
+    raft::matrix::gather(centers.data_handle(),
+                         int64_t(dim),
+                         int64_t(n_lists),
+                         kept_labels_dev.data(),
+                         n_kept,
+                         kept_centers.data_handle(),
+                         stream);
+    uint32_t* freed_rows_labels = labels.data() + n_split_rows;
+    raft::cluster::kmeans_balanced::predict(
+      res,
+      kmeans_params,
+      make_device_matrix_view<const float, int64_t>(
+        vectors.data_handle() + n_split_rows * dim, n_freed, dim),
+      raft::make_const_mdspan(kept_centers.view()),
+      make_device_vector_view<uint32_t, int64_t>(freed_rows_labels, n_freed));
+    const uint32_t* kept_labels_ptr = kept_labels_dev.data();
+    thrust::transform(policy,
+                      freed_rows_labels,
+                      freed_rows_labels + n_freed,
+                      freed_rows_labels,
+                      [kept_labels_ptr] __device__(uint32_t i) { return kept_labels_ptr[i]; });
+    // The temporary buffers must outlive the kernels using them.
+    resource::sync_stream(res);
+  }
+
+  // Split every oversized list in two with the balanced k-means.
+  for (uint32_t i = 0; i < n_splits; i++) {
+    const uint32_t label     = split_labels[i];
+    const uint32_t new_label = freed_labels[i];
+    const int64_t n_sub      = thrust::count(policy, labels.data(), labels.data() + n_rows, label);
+    if (n_sub < 2) { continue; }
+    rmm::device_uvector<int64_t> row_ids(n_sub, stream, device_memory);
+    thrust::copy_if(policy,
+                    thrust::make_counting_iterator<int64_t>(0),
+                    thrust::make_counting_iterator<int64_t>(n_rows),
+                    labels.data(),
+                    row_ids.data(),
+                    [label] __device__(uint32_t l) { return l == label; });
+    auto sub_vectors =
+      make_device_mdarray<float>(res, device_memory, make_extents<int64_t>(n_sub, dim));
+    raft::matrix::gather(vectors.data_handle(),
+                         int64_t(dim),
+                         int64_t(n_rows),
+                         row_ids.data(),
+                         n_sub,
+                         sub_vectors.data_handle(),
+                         stream);
+    auto sub_centers =
+      make_device_mdarray<float>(res, device_memory, make_extents<int64_t>(2, dim));
+    rmm::device_uvector<uint32_t> sub_labels(n_sub, stream, device_memory);
+    raft::cluster::kmeans_balanced::fit_predict(
+      res,
+      kmeans_params,
+      raft::make_const_mdspan(sub_vectors.view()),
+      sub_centers.view(),
+      make_device_vector_view<uint32_t, int64_t>(sub_labels.data(), n_sub));
+    auto* sub_centers_ptr = sub_centers.data_handle();
+    copy(centers.data_handle() + size_t(label) * dim, sub_centers_ptr, dim, stream);
+    copy(centers.data_handle() + size_t(new_label) * dim, sub_centers_ptr + dim, dim, stream);
+    uint32_t* labels_ptr           = labels.data();
+    const int64_t* row_ids_ptr     = row_ids.data();
+    const uint32_t* sub_labels_ptr = sub_labels.data();
+    thrust::for_each_n(
+      policy,
+      thrust::make_counting_iterator<int64_t>(0),
+      n_sub,
+      [labels_ptr, row_ids_ptr, sub_labels_ptr, label, new_label] __device__(int64_t j) {
+        labels_ptr[row_ids_ptr[j]] = sub_labels_ptr[j] == 0 ? label : new_label;
+      });
+    if (index->codebook_kind() == codebook_gen::PER_CLUSTER) {
+      // The new list starts with the codebook of the list it was split from.
+      const size_t book_size = index->pq_centers().extent(1) * index->pq_centers().extent(2);
+      copy(index->pq_centers().data_handle() + book_size * new_label,
+           index->pq_centers().data_handle() + book_size * label,
+           book_size,
+           stream);
+    }
+    resource::sync_stream(res);
+  }
+  set_centers(res, index, centers.data_handle());
+
+  // Re-encode the records of the affected lists, grouped by their new labels.
+  rmm::device_uvector<int64_t> order_dev(n_rows, stream, device_memory);
+  thrust::sequence(policy, order_dev.data(), order_dev.data() + n_rows);
+  thrust::stable_sort_by_key(policy, labels.data(), labels.data() + n_rows, order_dev.data());
+  auto sorted_vectors =
+    make_device_mdarray<float>(res, device_memory, make_extents<int64_t>(n_rows, dim));
+  raft::matrix::gather(vectors.data_handle(),
+                       int64_t(dim),
+                       int64_t(n_rows),
+                       order_dev.data(),
+                       int64_t(n_rows),
+                       sorted_vectors.data_handle(),
+                       stream);
+  rmm::device_uvector<IdxT> sorted_indices(n_rows, stream, device_memory);
+  thrust::gather(
+    policy, order_dev.data(), order_dev.data() + n_rows, indices.data(), sorted_indices.data());
+  std::vector<uint32_t> sorted_labels(n_rows);
+  copy(sorted_labels.data(), labels.data(), n_rows, stream);
+  resource::sync_stream(res);
+
+  for (auto label : affected_labels) {
+    erase_list(res, index, label);
+  }
+  for (size_t begin = 0; begin < n_rows;) {
+    const uint32_t label = sorted_labels[begin];
+    size_t end           = begin;
+    while (end < n_rows && sorted_labels[end] == label) {
+      end++;
+    }
+    const auto size = static_cast<uint32_t>(end - begin);
+    extend_list<float, IdxT>(
+      res,
+      index,
+      make_device_matrix_view<const float, uint32_t>(
+        sorted_vectors.data_handle() + begin * dim, size, dim),
+      make_device_vector_view<const IdxT, uint32_t>(sorted_indices.data() + begin, size),
+      label);
+    begin = end;
+  }
+  return n_splits;
+}
+
+/**
+ * Move the data of all lists to the given memory type.
+ * See the public interface for the api and usage.
+ */
+template <typename IdxT>
+void set_list_memory(raft::resources const& res, index<IdxT>* index, list_memory_type memory_type)
+{
+  if (index->list_memory() == memory_type) { return; }
+  index->set_list_memory(memory_type);
+  auto stream = resource::get_cuda_stream(res);
+  auto spec   = index->make_list_spec();
+  for (auto& list : index->lists()) {
+    if (!list) { continue; }
+    // Replace the shared pointer rather than the data: the old list may be shared with a clone.
+    const uint32_t size = list->size.load();
+    auto new_list       = std::make_shared<list_data<IdxT>>(res, spec, size);
+    auto copied_view    = make_mdspan<uint8_t, uint32_t, row_major, false, true>(
+      new_list->data.data_handle(), spec.make_list_extents(size));
+    copy(copied_view.data_handle(), list->data.data_handle(), copied_view.size(), stream);
+    copy(new_list->indices.data_handle(), list->indices.data_handle(), size, stream);
+    ivf::copy_removed_bits(res, *list, *new_list, size);
+    list.swap(new_list);
+  }
+  recompute_internal_state(res, *index);
+}
+
 /** Copy the state of an index into a new index, but share the list data among the two. */
 template <typename IdxT>
 auto clone(const raft::resources& res, const index<IdxT>& source) -> index<IdxT>
@@ -1509,7 +2349,9 @@ auto clone(const raft::resources& res, const index<IdxT>& source) -> index<IdxT>
                      source.n_lists(),
                      source.dim(),
                      source.pq_bits(),
-                     source.pq_dim());
+                     source.pq_dim(),
+                     source.conservative_memory_allocation(),
+                     source.list_memory());
 
   // Copy the independent parts
   copy(target.list_sizes().data_handle(),
@@ -1568,8 +2410,7 @@ void extend(raft::resources const& handle,
   rmm::mr::device_memory_resource* device_memory = raft::resource::get_workspace_resource(handle);
 
   // The spec defines how the clusters look like
-  auto spec = list_spec<uint32_t, IdxT>{
-    index->pq_bits(), index->pq_dim(), index->conservative_memory_allocation()};
+  auto spec = index->make_list_spec();
   // Try to allocate an index with the same parameters and the projected new size
   // (which can be slightly larger than index->size() + n_rows, due to padding).
   // If this fails, the index would be too big to fit in the device anyway.
@@ -1587,6 +2428,13 @@ void extend(raft::resources const& handle,
   rmm::device_uvector<uint32_t> new_data_labels(n_rows, stream, device_memory);
   free_mem -= sizeof(uint32_t) * n_rows;
 
+  // If the resources have a stream pool, the batches of the input data which is not accessible
+  // directly from the device are prefetched in one of its streams (double-buffered)
+  auto prefetch_stream = resource::is_stream_pool_initialized(handle)
+                           ? std::make_optional(resource::get_stream_from_stream_pool(handle))
+                           : std::nullopt;
+  size_t n_input_buffers = prefetch_stream.has_value() ? 2 : 1;
+
   // Calculate the batch size for the input data if it's not accessible directly from the device
   constexpr size_t kReasonableMaxBatchSize = 65536;
   size_t max_batch_size                    = std::min<size_t>(n_rows, kReasonableMaxBatchSize);
@@ -1600,14 +2448,14 @@ void extend(raft::resources const& handle,
     switch (utils::check_pointer_residency(new_vectors)) {
       case utils::pointer_residency::device_only:
       case utils::pointer_residency::host_and_device: break;
-      default: size_factor += index->dim() * sizeof(T);
+      default: size_factor += n_input_buffers * index->dim() * sizeof(T);
     }
     // the same with indices
     if (new_indices != nullptr) {
       switch (utils::check_pointer_residency(new_indices)) {
         case utils::pointer_residency::device_only:
         case utils::pointer_residency::host_and_device: break;
-        default: size_factor += sizeof(IdxT);
+        default: size_factor += n_input_buffers * sizeof(IdxT);
       }
     }
     // make the batch size fit into the remaining memory
@@ -1619,8 +2467,15 @@ void extend(raft::resources const& handle,
   }
 
   // Predict the cluster labels for the new data, in batches if necessary
-  utils::batch_load_iterator<T> vec_batches(
-    new_vectors, n_rows, index->dim(), max_batch_size, stream, device_memory);
+  auto* pinned_memory = resource::get_pinned_memory_resource(handle);
+  utils::batch_load_iterator<T> vec_batches(new_vectors,
+                                            n_rows,
+                                            index->dim(),
+                                            max_batch_size,
+                                            stream,
+                                            device_memory,
+                                            pinned_memory,
+                                            prefetch_stream);
   // Release the placeholder memory, because we don't intend to allocate any more long-living
   // temporary buffers before we allocate the index data.
   // This memory could potentially speed up UVM accesses, if any.
@@ -1639,6 +2494,7 @@ void extend(raft::resources const& handle,
                                     cudaMemcpyDefault,
                                     stream));
     for (const auto& batch : vec_batches) {
+      resource::check_cancellation(handle);
       auto batch_data_view =
         raft::make_device_matrix_view<const T, IdxT>(batch.data(), batch.size(), index->dim());
       auto batch_labels_view = raft::make_device_vector_view<uint32_t, IdxT>(
@@ -1693,8 +2549,9 @@ void extend(raft::resources const& handle,
   // By this point, the index state is updated and valid except it doesn't contain the new data
   // Fill the extended index with the new data (possibly, in batches)
   utils::batch_load_iterator<IdxT> idx_batches(
-    new_indices, n_rows, 1, max_batch_size, stream, device_memory);
+    new_indices, n_rows, 1, max_batch_size, stream, device_memory, pinned_memory, prefetch_stream);
   for (const auto& vec_batch : vec_batches) {
+    resource::check_cancellation(handle);
     const auto& idx_batch = *idx_batches++;
     process_and_fill_codes(handle,
                            *index,
@@ -1761,54 +2618,32 @@ auto build(raft::resources const& handle,
     // Besides just sampling, we transform the input dataset into floats to make it easier
     // to use gemm operations from cublas.
     rmm::device_uvector<float> trainset(n_rows_train * index.dim(), stream, device_memory);
-    // TODO: a proper sampling
+    raft::random::RngState random_state{137};
     if constexpr (std::is_same_v<T, float>) {
-      RAFT_CUDA_TRY(cudaMemcpy2DAsync(trainset.data(),
-                                      sizeof(T) * index.dim(),
-                                      dataset,
-                                      sizeof(T) * index.dim() * trainset_ratio,
-                                      sizeof(T) * index.dim(),
-                                      n_rows_train,
-                                      cudaMemcpyDefault,
-                                      stream));
+      raft::matrix::detail::sample_rows<T, IdxT>(handle,
+                                                 random_state,
+                                                 dataset,
+                                                 n_rows,
+                                                 IdxT(index.dim()),
+                                                 trainset.data(),
+                                                 IdxT(n_rows_train));
     } else {
-      size_t dim = index.dim();
-      cudaPointerAttributes dataset_attr;
-      RAFT_CUDA_TRY(cudaPointerGetAttributes(&dataset_attr, dataset));
-      if (dataset_attr.devicePointer != nullptr) {
-        // data is available on device: just run the kernel to copy and map the data
-        auto p = reinterpret_cast<T*>(dataset_attr.devicePointer);
-        auto trainset_view =
-          raft::make_device_vector_view<float, IdxT>(trainset.data(), dim * n_rows_train);
-        linalg::map_offset(handle, trainset_view, [p, trainset_ratio, dim] __device__(size_t i) {
-          auto col = i % dim;
-          return utils::mapping<float>{}(p[(i - col) * size_t(trainset_ratio) + col]);
-        });
-      } else {
-        // data is not available: first copy, then map inplace
-        auto trainset_tmp = reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(trainset.data()) +
-                                                 (sizeof(float) - sizeof(T)) * index.dim());
-        // We copy the data in strides, one row at a time, and place the smaller rows of type T
-        // at the end of float rows.
-        RAFT_CUDA_TRY(cudaMemcpy2DAsync(trainset_tmp,
-                                        sizeof(float) * index.dim(),
-                                        dataset,
-                                        sizeof(T) * index.dim() * trainset_ratio,
-                                        sizeof(T) * index.dim(),
-                                        n_rows_train,
-                                        cudaMemcpyDefault,
-                                        stream));
-        // Transform the input `{T -> float}`, one row per warp.
-        // The threads in each warp copy the data synchronously; this and the layout of the data
-        // (content is aligned to the end of the rows) together allow doing the transform in-place.
-        copy_warped(trainset.data(),
-                    index.dim(),
-                    trainset_tmp,
-                    index.dim() * sizeof(float) / sizeof(T),
-                    index.dim(),
-                    n_rows_train,
-                    stream);
-      }
+      rmm::device_uvector<T> trainset_tmp(n_rows_train * index.dim(), stream, device_memory);
+      raft::matrix::detail::sample_rows<T, IdxT>(handle,
+                                                 random_state,
+                                                 dataset,
+                                                 n_rows,
+                                                 IdxT(index.dim()),
+                                                 trainset_tmp.data(),
+                                                 IdxT(n_rows_train));
+      // Transform the input `{T -> float}`, one row per warp.
+      copy_warped(trainset.data(),
+                  index.dim(),
+                  trainset_tmp.data(),
+                  index.dim(),
+                  index.dim(),
+                  n_rows_train,
+                  stream);
     }
 
     // NB: here cluster_centers is used as if it is [n_clusters, data_dim] not [n_clusters,
@@ -1846,6 +2681,16 @@ auto build(raft::resources const& handle,
                          index.rot_dim(),
                          index.dim(),
                          index.rotation_matrix().data_handle());
+    if (params.opq_n_iters > 0) {
+      train_opq_rotation(handle,
+                         index,
+                         n_rows_train,
+                         trainset.data(),
+                         cluster_centers,
+                         labels.data(),
+                         params.kmeans_n_iters,
+                         params.opq_n_iters);
+    }
 
     set_centers(handle, &index, cluster_centers);
 
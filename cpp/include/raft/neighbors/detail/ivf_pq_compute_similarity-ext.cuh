@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,8 +19,9 @@
 #include <cuda_fp16.h>                               // __half
 #include <raft/core/detail/macros.hpp>               // RAFT_WEAK_FUNCTION
 #include <raft/distance/distance_types.hpp>          // raft::distance::DistanceType
-#include <raft/neighbors/detail/ivf_pq_fp_8bit.cuh>  // raft::neighbors::ivf_pq::detail::fp_8bit
+#include <raft/neighbors/detail/ivf_pq_fp_8bit.cuh>  // fp_8bit, __nv_fp8_e4m3, __nv_fp8_e5m2
 #include <raft/neighbors/ivf_pq_types.hpp>           // raft::neighbors::ivf_pq::codebook_gen
+#include <raft/neighbors/sample_filter.cuh>          // bitset_filter
 #include <raft/neighbors/sample_filter_types.hpp>    // none_ivf_sample_filter
 #include <raft/util/raft_explicit.hpp>               // RAFT_EXPLICIT
 #include <rmm/cuda_stream_view.hpp>                  // rmm::cuda_stream_view
@@ -41,7 +42,8 @@ template <typename OutT,
           uint32_t PqBits,
           int Capacity,
           bool PrecompBaseDiff,
-          bool EnableSMemLut>
+          bool EnableSMemLut,
+          bool PairedLut>
 RAFT_KERNEL compute_similarity_kernel(uint32_t dim,
                                       uint32_t n_probes,
                                       uint32_t pq_dim,
@@ -67,7 +69,7 @@ RAFT_KERNEL compute_similarity_kernel(uint32_t dim,
 // The signature of the kernel defined by a minimal set of template parameters
 template <typename OutT, typename LutT, typename IvfSampleFilterT>
 using compute_similarity_kernel_t =
-  decltype(&compute_similarity_kernel<OutT, LutT, IvfSampleFilterT, 8, 0, true, true>);
+  decltype(&compute_similarity_kernel<OutT, LutT, IvfSampleFilterT, 8, 0, true, true, false>);
 
 template <typename OutT, typename LutT, typename IvfSampleFilterT>
 struct selected {
@@ -212,6 +214,139 @@ instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
   raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA true>,
   raft::neighbors::filtering::ivf_to_sample_filter<
     int64_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA false>,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA true>,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  half,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  half,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  float,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA false>,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA true>,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA false>,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA true>,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  half,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  half,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  float,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA false>,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA true>,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+
+#ifdef RAFT_IVF_PQ_NATIVE_FP8_LUT
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  __nv_fp8_e4m3,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  __nv_fp8_e5m2,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  __nv_fp8_e4m3,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  __nv_fp8_e5m2,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  __nv_fp8_e4m3,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  __nv_fp8_e5m2,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  __nv_fp8_e4m3,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  __nv_fp8_e5m2,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  __nv_fp8_e4m3,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  half,
+  __nv_fp8_e5m2,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  __nv_fp8_e4m3,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(
+  float,
+  __nv_fp8_e5m2,
+  raft::neighbors::filtering::ivf_to_sample_filter<
+    int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>);
+#endif
 
 #undef COMMA
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,11 +22,15 @@
 #include <raft/neighbors/ivf_pq_types.hpp>                    // codebook_gen
 #include <raft/neighbors/sample_filter_types.hpp>             // none_ivf_sample_filter
 #include <raft/util/cuda_rt_essentials.hpp>                   // RAFT_CUDA_TRY
+#include <raft/util/cudart_utils.hpp>                         // raft::raise_max_dynamic_smem
 #include <raft/util/device_atomics.cuh>                       // raft::atomicMin
 #include <raft/util/pow2_utils.cuh>                           // raft::Pow2
 #include <raft/util/vectorized.cuh>                           // raft::TxN_t
 #include <rmm/cuda_stream_view.hpp>                           // rmm::cuda_stream_view
 
+#include <tuple>   // std::tuple
+#include <vector>  // std::vector
+
 namespace raft::neighbors::ivf_pq::detail {
 
 /**
@@ -187,6 +191,58 @@ __device__ auto ivfpq_compute_score(uint32_t pq_dim,
   return score;
 }
 
+/*
+ * Score one VecT chunk of 4-bit codes with the paired lookup table: every byte holds the codes of
+ * two consecutive subspaces (the low nibble first) and indexes a table of 256 combined scores.
+ */
+template <typename OutT, typename LutT, typename VecT, bool CheckBounds>
+__device__ __forceinline__ void ivfpq_compute_chunk_paired(OutT& score /* NOLINT */,
+                                                           const VecT& pq_codes,
+                                                           const LutT*& lut_head,
+                                                           const LutT* lut_end)
+{
+  constexpr uint32_t kBytesPerOp = sizeof(typename VecT::math_t);
+#pragma unroll
+  for (uint32_t j = 0; j < VecT::Ratio; j++) {
+    auto pq_code = pq_codes.val.data[j];
+#pragma unroll
+    for (uint32_t b = 0; b < kBytesPerOp; b++) {
+      if constexpr (CheckBounds) {
+        if (lut_head >= lut_end) { return; }
+      }
+      score += OutT(lut_head[pq_code & 0xffu]);
+      pq_code >>= 8;
+      lut_head += 256;
+    }
+  }
+}
+
+/* Compute the similarity for one vector of 4-bit codes in the pq_dataset (paired lookup table) */
+template <typename OutT, typename LutT, typename VecT>
+__device__ auto ivfpq_compute_score_paired(uint32_t pq_dim,
+                                           const typename VecT::io_t* pq_head,
+                                           const LutT* lut_scores,
+                                           OutT early_stop_limit) -> OutT
+{
+  constexpr uint32_t kChunkSize = sizeof(VecT) * 2u;
+  auto lut_head                 = lut_scores;
+  auto lut_end                  = lut_scores + (pq_dim << 7);
+  VecT pq_codes;
+  OutT score{0};
+  for (; pq_dim >= kChunkSize; pq_dim -= kChunkSize) {
+    *pq_codes.vectorized_data() = *pq_head;
+    pq_head += kIndexGroupSize;
+    ivfpq_compute_chunk_paired<OutT, LutT, VecT, false>(score, pq_codes, lut_head, lut_end);
+    // Early stop when it makes sense (otherwise early_stop_limit is kDummy/infinity).
+    if (score >= early_stop_limit) { return score; }
+  }
+  if (pq_dim > 0) {
+    *pq_codes.vectorized_data() = *pq_head;
+    ivfpq_compute_chunk_paired<OutT, LutT, VecT, true>(score, pq_codes, lut_head, lut_end);
+  }
+  return score;
+}
+
 /**
  * The main kernel that computes similarity scores across multiple queries and probes.
  * When `Capacity > 0`, it also selects top K candidates for each query and probe
@@ -212,6 +268,11 @@ __device__ auto ivfpq_compute_score(uint32_t pq_dim,
  *   Defines whether to use the shared memory for the lookup table (`lut_scores`).
  *   Setting this to `false` allows to reduce the shared memory usage (and maximum data dim)
  *   at the cost of reducing global memory reading throughput.
+ * @tparam PairedLut
+ *   (only with `PqBits == 4` and `EnableSMemLut`) Store the lookup table for pairs of
+ *   consecutive subspaces, `pq_dim / 2` tables of 256 entries indexed by a whole byte of codes.
+ *   This halves the number of lookups when scanning the clusters, at the cost of an eight times
+ *   larger table.
  *
  * @param dim the dimensionality of the data (NB: after rotation transform, i.e. `index.rot_dim()`).
  * @param n_probes the number of clusters to search for each query
@@ -267,7 +328,8 @@ template <typename OutT,
           uint32_t PqBits,
           int Capacity,
           bool PrecompBaseDiff,
-          bool EnableSMemLut>
+          bool EnableSMemLut,
+          bool PairedLut>
 RAFT_KERNEL compute_similarity_kernel(uint32_t dim,
                                       uint32_t n_probes,
                                       uint32_t pq_dim,
@@ -293,20 +355,25 @@ RAFT_KERNEL compute_similarity_kernel(uint32_t dim,
   /* Shared memory:
 
     * lut_scores: lookup table (LUT) of size = `pq_dim << PqBits`  (when EnableSMemLut)
+                  or `(pq_dim / 2) << 8` (when PairedLut)
     * lut_end+:
        * base_diff: size = dim (which is equal to `pq_dim * pq_len`)  or dim*2
+       * subspace_lut: size = `pq_dim << PqBits` floats (when PairedLut)
        * topk::warp_sort::mem_required - local topk temporary buffer (if necessary)
     * topk::block_sort: some amount of shared memory, but overlaps with the rest:
         block_sort only needs shared memory for `.done()` operation, which can come very last.
   */
   extern __shared__ __align__(256) uint8_t smem_buf[];  // NOLINT
   constexpr bool kManageLocalTopK = Capacity > 0;
+  static_assert(!PairedLut || (PqBits == 4 && EnableSMemLut),
+                "The paired lookup table is only implemented for 4-bit codes in shared memory");
 
   constexpr uint32_t PqShift = 1u << PqBits;  // NOLINT
   constexpr uint32_t PqMask  = PqShift - 1u;  // NOLINT
 
-  const uint32_t pq_len   = dim / pq_dim;
-  const uint32_t lut_size = pq_dim * PqShift;
+  const uint32_t pq_len            = dim / pq_dim;
+  const uint32_t subspace_lut_size = pq_dim * PqShift;
+  const uint32_t lut_size          = PairedLut ? (pq_dim << 7) : subspace_lut_size;
 
   if constexpr (EnableSMemLut) {
     lut_scores = reinterpret_cast<LutT*>(smem_buf);
@@ -350,7 +417,23 @@ RAFT_KERNEL compute_similarity_kernel(uint32_t dim,
       // Store all calculated distances to out_scores
       out_scores = _out_scores + uint64_t(max_samples) * query_ix;
     }
-    uint32_t label              = cluster_labels[n_probes * query_ix + probe_ix];
+    uint32_t label = cluster_labels[n_probes * query_ix + probe_ix];
+    if (label == ivf::kSkippedProbe) {
+      // The probe is skipped by the adaptive probing: output the same as for an empty cluster,
+      // without building the LUT.
+      if constexpr (kManageLocalTopK) {
+        for (uint32_t i = threadIdx.x; i < topk; i += blockDim.x) {
+          out_scores[i]  = upper_bound<OutT>();
+          out_indices[i] = 0;
+        }
+      } else if (probe_ix + 1 == n_probes) {
+        for (uint32_t i = threadIdx.x + chunk_indices[probe_ix]; i < max_samples;
+             i += blockDim.x) {
+          out_scores[i] = upper_bound<OutT>();
+        }
+      }
+      continue;
+    }
     const float* cluster_center = cluster_centers + dim * label;
     const float* pq_center;
     if (codebook_kind == codebook_gen::PER_SUBSPACE) {
@@ -381,11 +464,21 @@ RAFT_KERNEL compute_similarity_kernel(uint32_t dim,
       __syncthreads();
     }
 
+    // With the paired LUT, the scores of the subspaces are kept in full precision until combined.
+    float* subspace_lut = nullptr;
+    if constexpr (PairedLut) {
+      uint32_t base_diff_size = 0;
+      if constexpr (PrecompBaseDiff) {
+        base_diff_size = metric == distance::DistanceType::InnerProduct ? dim * 2 : dim;
+      }
+      subspace_lut = reinterpret_cast<float*>(lut_end) + base_diff_size;
+    }
+
     {
       // Create a lookup table
       // For each subspace, the lookup table stores the distance between the actual query vector
       // (projected into the subspace) and all possible pq vectors in that subspace.
-      for (uint32_t i = threadIdx.x; i < lut_size; i += blockDim.x) {
+      for (uint32_t i = threadIdx.x; i < subspace_lut_size; i += blockDim.x) {
         const uint32_t i_pq  = i >> PqBits;
         uint32_t j           = i_pq * pq_len;
         const uint32_t j_end = pq_len + j;
@@ -423,7 +516,22 @@ RAFT_KERNEL compute_similarity_kernel(uint32_t dim,
             default: __builtin_unreachable();
           }
         } while (++j < j_end);
-        lut_scores[i] = LutT(score);
+        if constexpr (PairedLut) {
+          subspace_lut[i] = score;
+        } else {
+          lut_scores[i] = LutT(score);
+        }
+      }
+    }
+
+    if constexpr (PairedLut) {
+      // Combine the tables of every two consecutive subspaces into one indexed by a pair of codes.
+      __syncthreads();
+      for (uint32_t i = threadIdx.x; i < lut_size; i += blockDim.x) {
+        const float* pair_lut = subspace_lut + ((i >> 8) << 5);
+        const float lo_score  = pair_lut[i & PqMask];
+        const float hi_score  = pair_lut[PqShift + ((i >> 4) & PqMask)];
+        lut_scores[i]         = LutT(lo_score + hi_score);
       }
     }
 
@@ -479,11 +587,19 @@ RAFT_KERNEL compute_similarity_kernel(uint32_t dim,
       bool valid = i < n_samples;
       // Check bounds and that the sample is acceptable for the query
       if (valid && sample_filter(queries_offset + query_ix, label, i)) {
-        score = ivfpq_compute_score<OutT, LutT, vec_t, PqBits>(
-          pq_dim,
-          reinterpret_cast<const vec_t::io_t*>(pq_thread_data),
-          lut_scores,
-          early_stop_limit);
+        if constexpr (PairedLut) {
+          score = ivfpq_compute_score_paired<OutT, LutT, vec_t>(
+            pq_dim,
+            reinterpret_cast<const vec_t::io_t*>(pq_thread_data),
+            lut_scores,
+            early_stop_limit);
+        } else {
+          score = ivfpq_compute_score<OutT, LutT, vec_t, PqBits>(
+            pq_dim,
+            reinterpret_cast<const vec_t::io_t*>(pq_thread_data),
+            lut_scores,
+            early_stop_limit);
+        }
       }
       if constexpr (kManageLocalTopK) {
         block_topk.add(score, sample_offset + i);
@@ -514,13 +630,14 @@ template <typename OutT,
           typename LutT,
           typename IvfSampleFilterT = raft::neighbors::filtering::none_ivf_sample_filter>
 using compute_similarity_kernel_t =
-  decltype(&compute_similarity_kernel<OutT, LutT, IvfSampleFilterT, 8, 0, true, true>);
+  decltype(&compute_similarity_kernel<OutT, LutT, IvfSampleFilterT, 8, 0, true, true, false>);
 
 // The config struct lifts the runtime parameters to the template parameters
 template <typename OutT,
           typename LutT,
           bool PrecompBaseDiff,
           bool EnableSMemLut,
+          bool PairedLut,
           typename IvfSampleFilterT = raft::neighbors::filtering::none_ivf_sample_filter>
 struct compute_similarity_kernel_config {
  public:
@@ -560,7 +677,8 @@ struct compute_similarity_kernel_config {
                                      PqBits,
                                      Capacity,
                                      PrecompBaseDiff,
-                                     EnableSMemLut>;
+                                     EnableSMemLut,
+                                     PairedLut && PqBits == 4>;
   }
 };
 
@@ -571,6 +689,7 @@ template <typename OutT,
           typename LutT,
           bool PrecompBaseDiff,
           bool EnableSMemLut,
+          bool PairedLut,
           typename IvfSampleFilterT = raft::neighbors::filtering::none_ivf_sample_filter>
 auto get_compute_similarity_kernel(uint32_t pq_bits, uint32_t k_max)
   -> compute_similarity_kernel_t<OutT, LutT, IvfSampleFilterT>
@@ -579,6 +698,7 @@ auto get_compute_similarity_kernel(uint32_t pq_bits, uint32_t k_max)
                                           LutT,
                                           PrecompBaseDiff,
                                           EnableSMemLut,
+                                          PairedLut,
                                           IvfSampleFilterT>::get(pq_bits, k_max);
 }
 
@@ -695,6 +815,10 @@ auto compute_similarity_select(const cudaDeviceProp& dev_props,
 {
   // Shared memory for storing the lookup table
   size_t lut_mem = sizeof(LutT) * (pq_dim << pq_bits);
+  // ...or the paired lookup table for 4-bit codes, which is built from the full-precision
+  // per-subspace table stored temporarily after the pre-computed data.
+  size_t paired_lut_mem   = sizeof(LutT) * (pq_dim << 7);
+  size_t subspace_lut_mem = sizeof(float) * (pq_dim << pq_bits);
   // Shared memory for storing pre-computed pieces to speedup the lookup table construction
   // (e.g. the distance between a cluster center and the query for L2).
   size_t bdf_mem = sizeof(float) * precomp_data_count;
@@ -792,21 +916,36 @@ auto compute_similarity_select(const cudaDeviceProp& dev_props,
    We try the most demanding and the fastest kernel first, trying to maximize occupancy with
    the minimum number of blocks (just one, really). Then, we tweak the `n_threads` to further
    optimize occupancy and data locality for the L1 cache.
+   For 4-bit codes, the fastest kernel scans the clusters with the paired lookup table.
    */
-  auto conf_fast        = get_compute_similarity_kernel<OutT, LutT, true, true, IvfSampleFilterT>;
-  auto conf_no_basediff = get_compute_similarity_kernel<OutT, LutT, false, true, IvfSampleFilterT>;
-  auto conf_no_smem_lut = get_compute_similarity_kernel<OutT, LutT, true, false, IvfSampleFilterT>;
-  auto topk_or_zero     = manage_local_topk ? topk : 0u;
-  std::array candidates{
-    std::make_tuple(conf_fast(pq_bits, topk_or_zero),
-                    total_shared_mem_t{ltk_add_mem, ltk_reduce_mem, lut_mem, bdf_mem},
-                    true),
-    std::make_tuple(conf_no_basediff(pq_bits, topk_or_zero),
-                    total_shared_mem_t{ltk_add_mem, ltk_reduce_mem, lut_mem, 0},
-                    true),
-    std::make_tuple(conf_no_smem_lut(pq_bits, topk_or_zero),
-                    total_shared_mem_t{ltk_add_mem, ltk_reduce_mem, 0, bdf_mem},
-                    false)};
+  auto conf_paired =
+    get_compute_similarity_kernel<OutT, LutT, true, true, true, IvfSampleFilterT>;
+  auto conf_fast =
+    get_compute_similarity_kernel<OutT, LutT, true, true, false, IvfSampleFilterT>;
+  auto conf_no_basediff =
+    get_compute_similarity_kernel<OutT, LutT, false, true, false, IvfSampleFilterT>;
+  auto conf_no_smem_lut =
+    get_compute_similarity_kernel<OutT, LutT, true, false, false, IvfSampleFilterT>;
+  auto topk_or_zero = manage_local_topk ? topk : 0u;
+  std::vector<std::tuple<compute_similarity_kernel_t<OutT, LutT, IvfSampleFilterT>,
+                         total_shared_mem_t,
+                         bool>>
+    candidates;
+  if (pq_bits == 4) {
+    candidates.emplace_back(
+      conf_paired(pq_bits, topk_or_zero),
+      total_shared_mem_t{ltk_add_mem, ltk_reduce_mem, paired_lut_mem, bdf_mem + subspace_lut_mem},
+      true);
+  }
+  candidates.emplace_back(conf_fast(pq_bits, topk_or_zero),
+                          total_shared_mem_t{ltk_add_mem, ltk_reduce_mem, lut_mem, bdf_mem},
+                          true);
+  candidates.emplace_back(conf_no_basediff(pq_bits, topk_or_zero),
+                          total_shared_mem_t{ltk_add_mem, ltk_reduce_mem, lut_mem, 0},
+                          true);
+  candidates.emplace_back(conf_no_smem_lut(pq_bits, topk_or_zero),
+                          total_shared_mem_t{ltk_add_mem, ltk_reduce_mem, 0, bdf_mem},
+                          false);
 
   // we may allow slightly lower than 100% occupancy;
   constexpr double kTargetOccupancy = 0.75;
@@ -823,11 +962,11 @@ auto compute_similarity_select(const cudaDeviceProp& dev_props,
     // needed to run at least one block per SM. At the same time, if more blocks fit into one SM,
     // this carveout value will limit the calculated occupancy. When we're done selecting the best
     // launch configuration, we will tighten the carveout once more, based on the final memory
-    // usage and occupancy.
+    // usage and occupancy. The carveout is only set when it changes; it is shared with the
+    // concurrent searches, which is fine as it's just a hint.
     const int max_carveout =
       estimate_carveout(preferred_shmem_carveout, smem_size_f(WarpSize), dev_props);
-    RAFT_CUDA_TRY(
-      cudaFuncSetAttribute(kernel, cudaFuncAttributePreferredSharedMemoryCarveout, max_carveout));
+    set_preferred_smem_carveout(kernel, max_carveout);
 
     // Get the theoretical maximum possible number of threads per block
     cudaFuncAttributes kernel_attrs;
@@ -838,8 +977,7 @@ auto compute_similarity_select(const cudaDeviceProp& dev_props,
     size_t smem_size = smem_size_f(n_threads);
 
     // Make sure the kernel can get enough shmem.
-    cudaError_t cuda_status =
-      cudaFuncSetAttribute(kernel, cudaFuncAttributeMaxDynamicSharedMemorySize, smem_size);
+    cudaError_t cuda_status = raise_max_dynamic_smem(kernel, smem_size);
     if (cuda_status != cudaSuccess) {
       RAFT_EXPECTS(
         cuda_status == cudaGetLastError(),
@@ -921,8 +1059,7 @@ auto compute_similarity_select(const cudaDeviceProp& dev_props,
         // a rather conservative bar; most likely, the kernel gets more shared memory than this,
         // and the occupancy doesn't get hurt.
         auto carveout = std::min<int>(max_carveout, std::ceil(100.0 * cur.shmem_use));
-        RAFT_CUDA_TRY(
-          cudaFuncSetAttribute(kernel, cudaFuncAttributePreferredSharedMemoryCarveout, carveout));
+        set_preferred_smem_carveout(kernel, carveout);
         if (cur.occupancy >= kTargetOccupancy) { break; }
       } else if (selected_perf.occupancy > 0.0) {
         // If we found a reasonable candidate on a previous iteration, and this one is not better,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -44,6 +44,17 @@
 #include <cub/cub.cuh>
 
 #include <cuda_fp16.h>
+#include <cuda_runtime_api.h>
+
+#if CUDART_VERSION >= 11080
+#include <cuda_fp8.h>
+/**
+ * The CUDA toolkit provides the standard FP8 types (`__nv_fp8_e4m3`, `__nv_fp8_e5m2`), which can be
+ * used as the look up table types (`CUDA_R_8F_E4M3`, `CUDA_R_8F_E5M2`). Their conversions are
+ * native on sm_89 and newer GPUs and emulated on the older ones.
+ */
+#define RAFT_IVF_PQ_NATIVE_FP8_LUT
+#endif
 
 #include <optional>
 
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "ivf_pq_search.cuh"
+
+#include <raft/cluster/detail/kmeans_balanced.cuh>
+#include <raft/core/memory_type.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
+#include <raft/core/resource/device_properties.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/neighbors/ann_types.hpp>
+#include <raft/neighbors/ivf_list.hpp>
+#include <raft/neighbors/ivf_pq_types.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace raft::neighbors::ivf_pq::detail {
+
+/** The dimensions of an IVF-PQ index, as derived from its build parameters. */
+struct index_shape {
+  uint32_t n_lists;
+  uint32_t dim;
+  uint32_t dim_ext;
+  uint32_t pq_bits;
+  uint32_t pq_dim;
+  uint32_t pq_len;
+  uint32_t rot_dim;
+  uint32_t pq_book_size;
+  codebook_gen codebook_kind;
+};
+
+/** The dimensions of the index built with `params` on `dim`-dimensional vectors. */
+inline auto make_index_shape(const index_params& params, uint32_t dim) -> index_shape
+{
+  index_shape s{};
+  s.n_lists       = params.n_lists;
+  s.dim           = dim;
+  s.dim_ext       = raft::round_up_safe(dim + 1, 8u);
+  s.pq_bits       = params.pq_bits;
+  s.pq_dim        = params.pq_dim == 0 ? index<int64_t>::calculate_pq_dim(dim) : params.pq_dim;
+  s.pq_len        = raft::div_rounding_up_unsafe(dim, s.pq_dim);
+  s.rot_dim       = s.pq_len * s.pq_dim;
+  s.pq_book_size  = 1u << s.pq_bits;
+  s.codebook_kind = params.codebook_kind;
+  return s;
+}
+
+/** The device memory of `n_rows` records spread evenly over the lists of the index. */
+template <typename IdxT>
+auto estimate_lists_size(const index_shape& s, uint64_t n_rows, bool conservative_memory_allocation)
+  -> uint64_t
+{
+  const list_spec<uint32_t, IdxT> spec{s.pq_bits, s.pq_dim, conservative_memory_allocation};
+  const auto rows_per_list = static_cast<uint32_t>(
+    raft::div_rounding_up_safe<uint64_t>(n_rows, std::max<uint32_t>(s.n_lists, 1)));
+  if (rows_per_list == 0) { return 0; }
+  const uint32_t capacity = ivf::calc_list_capacity(spec, rows_per_list);
+  const auto codes        = spec.make_list_extents(capacity);
+  const uint64_t list_size =
+    uint64_t(codes.extent(0)) * codes.extent(1) * codes.extent(2) * codes.extent(3) +
+    uint64_t(capacity) * sizeof(IdxT);
+  return list_size * s.n_lists;
+}
+
+/** The device memory of the index, except for the lists. */
+template <typename IdxT>
+auto estimate_index_size(const index_shape& s) -> uint64_t
+{
+  const uint64_t n_codebooks =
+    s.codebook_kind == codebook_gen::PER_SUBSPACE ? s.pq_dim : uint64_t(s.n_lists);
+  uint64_t size = 0;
+  // pq_centers, rotation_matrix
+  size += sizeof(float) * (n_codebooks * s.pq_len * s.pq_book_size + uint64_t(s.rot_dim) * s.dim);
+  // centers, centers_rot
+  size += sizeof(float) * uint64_t(s.n_lists) * (s.dim_ext + s.rot_dim);
+  // list_sizes, data_ptrs, inds_ptrs
+  size += uint64_t(s.n_lists) * (sizeof(uint32_t) + sizeof(uint8_t*) + sizeof(IdxT*));
+  return size;
+}
+
+/**
+ * The workspace of `kmeans_balanced::fit` on `n_rows` float rows: the minibatch buffers of the
+ * E-step, the norms and the mesocluster labels of the rows, and the training set of the largest
+ * mesocluster (assuming the mesoclusters hold at most twice their even share of the rows).
+ */
+inline auto estimate_kmeans_workspace(uint64_t n_clusters,
+                                      uint64_t n_rows,
+                                      uint32_t dim,
+                                      raft::distance::DistanceType metric) -> uint64_t
+{
+  if (n_rows == 0) { return 0; }
+  const auto [minibatch_size, mem_per_row] = raft::cluster::detail::calc_minibatch_size<float>(
+    int64_t(n_clusters), int64_t(n_rows), int64_t(dim), metric, true);
+  const auto n_mesoclusters =
+    std::clamp<uint64_t>(static_cast<uint64_t>(std::sqrt(double(n_clusters)) + 0.5),
+                         1,
+                         std::max<uint64_t>(n_clusters, 1));
+  const uint64_t mc_rows =
+    std::min<uint64_t>(n_rows, 2 * raft::div_rounding_up_safe(n_rows, n_mesoclusters));
+  uint64_t size = uint64_t(minibatch_size) * mem_per_row;
+  size += sizeof(float) * n_rows * 2;  // norms, mesocluster labels
+  size += sizeof(float) * mc_rows * (dim + 2);
+  return size;
+}
+
+template <typename T, typename IdxT>
+auto estimate_build_memory(raft::resources const& res,
+                           const index_params& params,
+                           int64_t n_rows,
+                           uint32_t dim,
+                           memory_type dataset_memory) -> ann::memory_estimate
+{
+  const auto s = make_index_shape(params, dim);
+  ann::memory_estimate estimate;
+  estimate.device_index = estimate_index_size<IdxT>(s);
+  if (params.add_data_on_build) {
+    const auto lists = estimate_lists_size<IdxT>(s, n_rows, params.conservative_memory_allocation);
+    if (params.list_memory == list_memory_type::MANAGED) {
+      estimate.host += lists;
+    } else {
+      estimate.device_index += lists;
+    }
+  }
+
+  // The training set (as in `build`); it is kept, with the cluster centers, until the codebooks
+  // are trained.
+  const auto trainset_ratio = std::max<uint64_t>(
+    1, uint64_t(n_rows) / std::max<uint64_t>(params.kmeans_trainset_fraction * n_rows, s.n_lists));
+  const uint64_t n_train    = n_rows / trainset_ratio;
+  const uint64_t train_base = sizeof(float) * (n_train + s.n_lists) * dim;
+  uint64_t train_peak       = std::is_same_v<T, float> ? 0 : sizeof(T) * n_train * dim;
+  train_peak =
+    std::max(train_peak, estimate_kmeans_workspace(s.n_lists, n_train, dim, params.metric));
+  uint64_t codebooks = 0;
+  if (s.codebook_kind == codebook_gen::PER_SUBSPACE) {
+    codebooks = sizeof(float) * (uint64_t(s.pq_dim) * s.pq_len * s.pq_book_size +
+                                 n_train * (s.pq_len + 1)) +
+                estimate_kmeans_workspace(
+                  s.pq_book_size, n_train, s.pq_len, distance::DistanceType::L2Expanded);
+  } else {
+    const uint64_t cluster_rows = 2 * raft::div_rounding_up_safe<uint64_t>(n_train, s.n_lists);
+    codebooks =
+      sizeof(float) * (uint64_t(s.n_lists) * s.pq_len * s.pq_book_size + n_train * s.rot_dim) +
+      sizeof(IdxT) * n_train +
+      estimate_kmeans_workspace(
+        s.pq_book_size, cluster_rows * s.pq_dim, s.pq_len, distance::DistanceType::L2Expanded);
+  }
+  if (params.opq_n_iters > 0) {
+    const uint64_t opq =
+      sizeof(float) * (n_train * (dim + 2 * s.rot_dim + 2 * s.pq_len + 1) +
+                       uint64_t(s.rot_dim) * dim * 2 + uint64_t(dim) * dim);
+    codebooks = std::max(codebooks, opq);
+  }
+  train_peak = std::max(train_peak, sizeof(uint32_t) * n_train + codebooks);
+
+  estimate.device_workspace = train_base + train_peak;
+
+  // The labels of the new rows and the batches of `extend`.
+  if (params.add_data_on_build) {
+    const uint64_t batch_size      = std::min<uint64_t>(n_rows, 65536);
+    const uint64_t n_input_buffers = resource::is_stream_pool_initialized(res) ? 2 : 1;
+    uint64_t size_per_row          = sizeof(float) * (dim + s.rot_dim) + sizeof(IdxT);
+    if (!is_device_accessible(dataset_memory)) {
+      size_per_row += n_input_buffers * dim * sizeof(T);
+      estimate.host += n_input_buffers * batch_size * dim * sizeof(T);  // pinned staging
+    }
+    estimate.device_workspace = std::max<uint64_t>(
+      estimate.device_workspace, sizeof(uint32_t) * n_rows + batch_size * size_per_row);
+  }
+  return estimate;
+}
+
+/** The dimensions of a built index. */
+template <typename IdxT>
+auto make_index_shape(const index<IdxT>& index) -> index_shape
+{
+  index_shape s{};
+  s.n_lists       = index.n_lists();
+  s.dim           = index.dim();
+  s.dim_ext       = index.dim_ext();
+  s.pq_bits       = index.pq_bits();
+  s.pq_dim        = index.pq_dim();
+  s.pq_len        = index.pq_len();
+  s.rot_dim       = index.rot_dim();
+  s.pq_book_size  = index.pq_book_size();
+  s.codebook_kind = index.codebook_kind();
+  return s;
+}
+
+/**
+ * The `get_max_samples` of an index of `n_rows` records spread evenly over its lists (before it is
+ * built).
+ */
+inline auto estimate_max_samples(const index_shape& s, uint64_t n_rows, uint32_t n_probes)
+  -> uint32_t
+{
+  const uint64_t rows_per_list =
+    raft::div_rounding_up_safe<uint64_t>(n_rows, std::max<uint32_t>(s.n_lists, 1));
+  return Pow2<128>::roundUp(std::min<uint64_t>(n_probes, s.n_lists) * rows_per_list);
+}
+
+/**
+ * The device workspace of the search of `n_queries` queries in an index of the shape `s`, whose
+ * `n_probes` largest lists hold `max_samples` records.
+ */
+inline auto estimate_search_workspace(raft::resources const& res,
+                                      const search_params& params,
+                                      const index_shape& s,
+                                      uint32_t max_samples,
+                                      uint32_t n_queries,
+                                      uint32_t k) -> uint64_t
+{
+  const uint32_t n_probes    = std::min<uint32_t>(params.n_probes, s.n_lists);
+  const uint32_t n_streams   = get_search_stream_count(res, n_queries);
+  const uint32_t max_queries = get_max_queries_per_stream(n_queries, n_streams);
+  // `get_max_batch_size` may only reduce the batches below `max_queries`
+  const uint64_t batch_size = max_queries;
+
+  // The buffers of the queries and of the probed clusters of every stream
+  const uint64_t per_stream =
+    sizeof(float) * uint64_t(max_queries) * (s.dim_ext + s.rot_dim + n_probes);
+  // The coarse search first, then the scan of the lists
+  const uint64_t coarse = sizeof(float) * uint64_t(max_queries) * (s.n_lists + n_probes + 1);
+
+  uint64_t scan = search_worker_workspace_size(k, n_probes, max_queries, max_samples) +
+                  batch_size * k * (sizeof(float) + sizeof(uint32_t));
+  // The lookup tables are kept in the global memory if they don't fit into the shared memory.
+  const uint64_t lut_elem = params.lut_dtype == CUDA_R_32F   ? 4
+                            : params.lut_dtype == CUDA_R_16F ? 2
+                                                             : 1;
+  const uint64_t lut_size = (uint64_t(s.pq_dim) << s.pq_bits) * lut_elem;
+  const auto& props       = resource::get_device_properties(res);
+  if (lut_size > props.sharedMemPerBlockOptin) {
+    const uint64_t n_blocks =
+      std::min<uint64_t>(batch_size * n_probes,
+                         uint64_t(props.maxBlocksPerMultiProcessor) * props.multiProcessorCount);
+    scan += n_blocks * lut_size;
+  }
+  return n_streams * (per_stream + std::max(coarse, scan));
+}
+
+template <typename IdxT>
+auto estimate_search_memory(raft::resources const& res,
+                            const search_params& params,
+                            const index<IdxT>& index,
+                            uint32_t n_queries,
+                            uint32_t k) -> ann::memory_estimate
+{
+  const uint32_t n_probes = std::min<uint32_t>(params.n_probes, index.n_lists());
+  ann::memory_estimate estimate;
+  estimate.device_workspace = estimate_search_workspace(
+    res, params, make_index_shape(index), get_max_samples(index, n_probes), n_queries, k);
+  return estimate;
+}
+
+}  // namespace raft::neighbors::ivf_pq::detail
@@ -16,27 +16,37 @@
 
 #pragma once
 
+#include <raft/core/resource/cancellation_token.hpp>
+#include <raft/core/resource/cublas_handle.hpp>
+#include <raft/core/resource/cuda_graph.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
 #include <raft/core/resource/device_properties.hpp>
 #include <raft/spatial/knn/detail/ann_utils.cuh>
 
 #include <raft/neighbors/detail/ivf_pq_compute_similarity.cuh>
 #include <raft/neighbors/detail/ivf_pq_dummy_block_sort.cuh>
 #include <raft/neighbors/detail/ivf_pq_fp_8bit.cuh>
+#include <raft/neighbors/detail/range_search_common.cuh>
+#include <raft/neighbors/detail/refine_device.cuh>
 #include <raft/neighbors/ivf_pq_types.hpp>
 #include <raft/neighbors/sample_filter_types.hpp>
 
 #include <raft/core/cudart_utils.hpp>
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/logger.hpp>
 #include <raft/core/nvtx.hpp>
 #include <raft/core/operators.hpp>
 #include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/metrics.hpp>
+#include <raft/core/resource/phase_timer.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/linalg/gemm.cuh>
 #include <raft/linalg/map.cuh>
 #include <raft/linalg/unary_op.cuh>
+#include <raft/matrix/gather.cuh>
 #include <raft/matrix/detail/select_k.cuh>
 #include <raft/matrix/detail/select_warpsort.cuh>
 #include <raft/util/cuda_utils.cuh>
@@ -52,7 +62,13 @@
 
 #include <cuda_fp16.h>
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
 #include <optional>
+#include <type_traits>
+#include <vector>
 
 namespace raft::neighbors::ivf_pq::detail {
 
@@ -64,6 +80,9 @@ using namespace raft::spatial::knn::detail;  // NOLINT
  * Assuming the number of clusters is not that big (a few thousands), we do a plain GEMM
  * followed by select_k to select the clusters to probe. There's no need to return the similarity
  * scores here.
+ *
+ * When `probe_distance_ratio > 0` (L2 metrics only), the selected clusters that are too far from
+ * the query compared to the closest one are replaced with `ivf::kSkippedProbe`.
  */
 template <typename T>
 void select_clusters(raft::resources const& handle,
@@ -77,7 +96,8 @@ void select_clusters(raft::resources const& handle,
                      raft::distance::DistanceType metric,
                      const T* queries,              // [n_queries, dim]
                      const float* cluster_centers,  // [n_lists, dim_ext]
-                     rmm::mr::device_memory_resource* mr)
+                     rmm::mr::device_memory_resource* mr,
+                     float probe_distance_ratio = 0.0f)
 {
   auto stream = resource::get_cuda_stream(handle);
   /* NOTE[qc_distances]
@@ -162,6 +182,30 @@ void select_clusters(raft::resources const& handle,
                                             clusters_to_probe,
                                             true,
                                             mr);
+
+  if (probe_distance_ratio > 0 && metric != raft::distance::DistanceType::InnerProduct) {
+    // qc_distances are the squared L2 distances minus the squared norms of the queries.
+    rmm::device_uvector<float> query_norms(n_queries, stream, mr);
+    auto query_norms_view =
+      raft::make_device_vector_view<float, uint32_t>(query_norms.data(), n_queries);
+    linalg::map_offset(
+      handle, query_norms_view, [float_queries, dim, dim_ext] __device__(uint32_t i) {
+        float norm = 0.0f;
+        for (uint32_t j = 0; j < dim; j++) {
+          float x = float_queries[i * dim_ext + j];
+          norm += x * x;
+        }
+        return norm;
+      });
+    utils::mask_distant_probes(n_queries,
+                               n_probes,
+                               cluster_dists.data(),
+                               query_norms.data(),
+                               probe_distance_ratio,
+                               ivf::kSkippedProbe,
+                               clusters_to_probe,
+                               stream);
+  }
 }
 
 /**
@@ -189,8 +233,8 @@ __launch_bounds__(BlockDim) RAFT_KERNEL
   const uint32_t n_probes_aligned = Pow2<BlockDim>::roundUp(n_probes);
   uint32_t total                  = 0;
   for (uint32_t probe_ix = threadIdx.x; probe_ix < n_probes_aligned; probe_ix += BlockDim) {
-    auto label = probe_ix < n_probes ? clusters_to_probe[probe_ix] : 0u;
-    auto chunk = probe_ix < n_probes ? cluster_sizes[label] : 0u;
+    auto label = probe_ix < n_probes ? clusters_to_probe[probe_ix] : ivf::kSkippedProbe;
+    auto chunk = label != ivf::kSkippedProbe ? cluster_sizes[label] : 0u;
     if (threadIdx.x == 0) { chunk += total; }
     block_scan(shm).InclusiveSum(chunk, chunk, total);
     __syncthreads();
@@ -375,6 +419,28 @@ void postprocess_distances(float* out,        // [n_queries, topk]
   }
 }
 
+/**
+ * The inverse of `postprocess_distances`: the internal score of a distance returned by the search.
+ * For InnerProduct, a larger distance (similarity) maps to a smaller score.
+ */
+inline auto distance_to_score(float distance,
+                              distance::DistanceType metric,
+                              float scaling_factor) -> float
+{
+  switch (metric) {
+    case distance::DistanceType::L2Unexpanded:
+    case distance::DistanceType::L2Expanded: return distance / (scaling_factor * scaling_factor);
+    case distance::DistanceType::L2SqrtUnexpanded:
+    case distance::DistanceType::L2SqrtExpanded: {
+      const float d = std::max(distance, 0.0f) / scaling_factor;
+      return d * d;
+    }
+    case distance::DistanceType::InnerProduct:
+      return -distance / (scaling_factor * scaling_factor);
+    default: RAFT_FAIL("Unexpected metric.");
+  }
+}
+
 /**
  * An approximation to the number of times each cluster appears in a batched sample.
  *
@@ -430,6 +496,7 @@ void ivfpq_search_worker(raft::resources const& handle,
                          float* distances,                   // [n_queries, topK]
                          float scaling_factor,
                          double preferred_shmem_carveout,
+                         float score_bound,  // in the units of ScoreT (before postprocessing)
                          IvfSampleFilterT sample_filter)
 {
   auto stream = resource::get_cuda_stream(handle);
@@ -552,49 +619,59 @@ void ivfpq_search_worker(raft::resources const& handle,
   if (manage_local_topk) {
     query_kths_buf.emplace(
       make_device_mdarray<float>(handle, mr, make_extents<uint32_t>(n_queries)));
-    linalg::map(handle,
-                query_kths_buf->view(),
-                raft::const_op<float>{dummy_block_sort_t<ScoreT, IdxT>::queue_t::kDummy});
+    // The local top-k of a block keeps only the scores below this bound, which tightens to the
+    // k-th best score of the query as the probes are scanned (and stops the L2 scores early).
+    const float kth_init =
+      std::min<float>(score_bound, dummy_block_sort_t<ScoreT, IdxT>::queue_t::kDummy);
+    linalg::map(handle, query_kths_buf->view(), raft::const_op<float>{kth_init});
     query_kths = query_kths_buf->data_handle();
   }
-  compute_similarity_run(search_instance,
-                         stream,
-                         index.rot_dim(),
-                         n_probes,
-                         index.pq_dim(),
-                         n_queries,
-                         queries_offset,
-                         index.metric(),
-                         index.codebook_kind(),
-                         topK,
-                         max_samples,
-                         index.centers_rot().data_handle(),
-                         index.pq_centers().data_handle(),
-                         index.data_ptrs().data_handle(),
-                         clusters_to_probe,
-                         chunk_index.data(),
-                         query,
-                         index_list_sorted,
-                         query_kths,
-                         sample_filter,
-                         device_lut.data(),
-                         distances_buf.data(),
-                         neighbors_ptr);
+  {
+    // The LUT construction is fused with the scan of the lists in the same kernel
+    resource::scoped_phase phase(handle, "ivf_pq::scan");
+    compute_similarity_run(search_instance,
+                           stream,
+                           index.rot_dim(),
+                           n_probes,
+                           index.pq_dim(),
+                           n_queries,
+                           queries_offset,
+                           index.metric(),
+                           index.codebook_kind(),
+                           topK,
+                           max_samples,
+                           index.centers_rot().data_handle(),
+                           index.pq_centers().data_handle(),
+                           index.data_ptrs().data_handle(),
+                           clusters_to_probe,
+                           chunk_index.data(),
+                           query,
+                           index_list_sorted,
+                           query_kths,
+                           sample_filter,
+                           device_lut.data(),
+                           distances_buf.data(),
+                           neighbors_ptr);
+  }
 
   // Select topk vectors for each query
   rmm::device_uvector<ScoreT> topk_dists(n_queries * topK, stream, mr);
-  matrix::detail::select_k<ScoreT, uint32_t>(handle,
-                                             distances_buf.data(),
-                                             neighbors_ptr,
-                                             n_queries,
-                                             topk_len,
-                                             topK,
-                                             topk_dists.data(),
-                                             neighbors_uint32,
-                                             true,
-                                             mr);
+  {
+    resource::scoped_phase phase(handle, "ivf_pq::select_k");
+    matrix::detail::select_k<ScoreT, uint32_t>(handle,
+                                               distances_buf.data(),
+                                               neighbors_ptr,
+                                               n_queries,
+                                               topk_len,
+                                               topK,
+                                               topk_dists.data(),
+                                               neighbors_uint32,
+                                               true,
+                                               mr);
+  }
 
   // Postprocessing
+  resource::scoped_phase phase(handle, "ivf_pq::postprocess");
   postprocess_distances(
     distances, topk_dists.data(), index.metric(), n_queries, topK, scaling_factor, stream);
   postprocess_neighbors(neighbors,
@@ -644,7 +721,7 @@ struct ivfpq_search {
   template <typename ScoreT>
   static auto fun_try_lut_t(const search_params& params, distance::DistanceType metric) -> fun_t
   {
-    bool signed_metric = false;
+    [[maybe_unused]] bool signed_metric = false;
     switch (metric) {
       case raft::distance::DistanceType::InnerProduct: signed_metric = true; break;
       default: break;
@@ -652,7 +729,18 @@ struct ivfpq_search {
 
     switch (params.lut_dtype) {
       case CUDA_R_32F: return filter_reasonable_instances<ScoreT, float>(params);
+#ifdef RAFT_IVF_PQ_DISABLE_FP8_LUT
+      // The 8-bit LUT kernels are not built: the 16-bit LUT is the closest in the shared memory
+      // footprint and in the recall.
+      case CUDA_R_8U:
+      case CUDA_R_8I:
+#ifdef RAFT_IVF_PQ_NATIVE_FP8_LUT
+      case CUDA_R_8F_E4M3:
+      case CUDA_R_8F_E5M2:
+#endif
+#endif
       case CUDA_R_16F: return filter_reasonable_instances<ScoreT, half>(params);
+#ifndef RAFT_IVF_PQ_DISABLE_FP8_LUT
       case CUDA_R_8U:
       case CUDA_R_8I:
         if (signed_metric) {
@@ -660,6 +748,12 @@ struct ivfpq_search {
         } else {
           return filter_reasonable_instances<ScoreT, fp_8bit<5, false>>(params);
         }
+#ifdef RAFT_IVF_PQ_NATIVE_FP8_LUT
+      // The standard FP8 types are signed, hence the same table serves all metrics.
+      case CUDA_R_8F_E4M3: return filter_reasonable_instances<ScoreT, __nv_fp8_e4m3>(params);
+      case CUDA_R_8F_E5M2: return filter_reasonable_instances<ScoreT, __nv_fp8_e5m2>(params);
+#endif
+#endif
       default: RAFT_FAIL("Unexpected lut_dtype (%d)", int(params.lut_dtype));
     }
   }
@@ -675,6 +769,23 @@ struct ivfpq_search {
   }
 };
 
+/**
+ * The workspace of the scan of `n_queries` queries (the buffers of `ivfpq_search_worker`), as
+ * accounted for by `get_max_batch_size`.
+ */
+inline auto search_worker_workspace_size(uint32_t k,
+                                         uint32_t n_probes,
+                                         uint32_t n_queries,
+                                         uint32_t max_samples) -> uint64_t
+{
+  const uint64_t buffers_fused     = 12ull * k * n_probes;
+  const uint64_t buffers_non_fused = 4ull * max_samples;
+  const uint64_t other             = 32ull * n_probes;
+  return static_cast<uint64_t>(n_queries) *
+         (other + (is_local_topk_feasible(k, n_probes, n_queries) ? buffers_fused
+                                                                  : buffers_non_fused));
+}
+
 /**
  * A heuristic for bounding the number of queries per batch, to improve GPU utilization.
  * (based on the number of SMs and the work size).
@@ -685,6 +796,8 @@ struct ivfpq_search {
  * @param n_queries number of queries hoped to be processed at once.
  *                  (maximum value for the returned batch size)
  * @param max_samples maximum possible number of samples to be processed for the given `n_probes`
+ * @param n_concurrent the number of batches processed at the same time (on different streams),
+ *                     which share the workspace memory
  *
  * @return maximum recommended batch size.
  */
@@ -692,7 +805,8 @@ inline auto get_max_batch_size(raft::resources const& res,
                                uint32_t k,
                                uint32_t n_probes,
                                uint32_t n_queries,
-                               uint32_t max_samples) -> uint32_t
+                               uint32_t max_samples,
+                               uint32_t n_concurrent = 1) -> uint32_t
 {
   uint32_t max_batch_size         = n_queries;
   uint32_t n_ctas_total           = getMultiProcessorCount() * 2;
@@ -706,13 +820,9 @@ inline auto get_max_batch_size(raft::resources const& res,
   }
   // Check in the tmp distance buffer is not too big
   auto ws_size = [k, n_probes, max_samples](uint32_t bs) -> uint64_t {
-    const uint64_t buffers_fused     = 12ull * k * n_probes;
-    const uint64_t buffers_non_fused = 4ull * max_samples;
-    const uint64_t other             = 32ull * n_probes;
-    return static_cast<uint64_t>(bs) *
-           (other + (is_local_topk_feasible(k, n_probes, bs) ? buffers_fused : buffers_non_fused));
+    return search_worker_workspace_size(k, n_probes, bs, max_samples);
   };
-  auto max_ws_size = resource::get_workspace_free_bytes(res);
+  auto max_ws_size = resource::get_workspace_free_bytes(res) / n_concurrent;
   if (ws_size(max_batch_size) > max_ws_size) {
     uint32_t smaller_batch_size = bound_by_power_of_two(max_batch_size);
     // gradually reduce the batch size until we fit into the max size limit.
@@ -724,7 +834,62 @@ inline auto get_max_batch_size(raft::resources const& res,
   return max_batch_size;
 }
 
-/** See raft::spatial::knn::ivf_pq::search docs */
+/** The maximum number of samples scanned by a query probing `n_probes` lists (the largest ones). */
+template <typename IdxT>
+auto get_max_samples(const index<IdxT>& index, uint32_t n_probes) -> uint32_t
+{
+  IdxT ms = Pow2<128>::roundUp(index.accum_sorted_sizes()(n_probes));
+  RAFT_EXPECTS(ms <= IdxT(std::numeric_limits<uint32_t>::max()),
+               "The maximum sample size is too big.");
+  return ms;
+}
+
+/**
+ * The number of streams the search of `n_queries` queries is split across.
+ *
+ * With a stream pool, the queries are split across its streams, so that the kernels of the
+ * different sub-batches (coarse search, LUT build and fine scan) overlap. This helps when they
+ * are too short to saturate the GPU on their own (e.g. with a small `n_probes`). The pool is not
+ * used while the main stream is captured into a CUDA graph, because joining it needs a host sync.
+ */
+inline auto get_search_stream_count(raft::resources const& res, uint32_t n_queries) -> uint32_t
+{
+  constexpr uint32_t kMinQueriesPerStream = 64;
+  uint32_t n_streams                      = 1;
+  if (res.has_resource_factory(resource::resource_type::CUDA_STREAM_POOL) &&
+      !resource::is_stream_capturing(res)) {
+    n_streams = std::min<uint32_t>(resource::get_stream_pool_size(res),
+                                   div_rounding_up_safe(n_queries, kMinQueriesPerStream));
+    n_streams = std::max<uint32_t>(n_streams, 1);
+  }
+  return n_streams;
+}
+
+/** Maximum number of query vectors searched at the same time on one of the `n_streams` streams. */
+inline auto get_max_queries_per_stream(uint32_t n_queries, uint32_t n_streams) -> uint32_t
+{
+  return std::min<uint32_t>(std::max<uint32_t>(div_rounding_up_safe(n_queries, n_streams), 1),
+                            4096);
+}
+
+/**
+ * See raft::spatial::knn::ivf_pq::search docs
+ *
+ * With `refine_dataset`, the scan selects `k * params.refine_ratio` candidates per query into the
+ * workspace, and every batch of them is refined on the raw vectors (as `raft::neighbors::refine`)
+ * right away, into the final `k` neighbors.
+ *
+ * With `distance_bound` (in the units of the output distances; the minimum similarity for
+ * InnerProduct), the scan may drop the candidates farther than the bound, and the missing
+ * neighbors are marked with `kOutOfBoundsRecord`. `ivf_pq::range_search` bounds its scans by the
+ * radius this way; the bound is not compatible with the refinement of the candidates.
+ *
+ * With `query_n_probes` [n_queries] (device), the query `i` probes its `query_n_probes[i]` closest
+ * lists (at most `params.n_probes`): the rest of its probes are masked with `ivf::kSkippedProbe`,
+ * so they take no place in the chunked probe layout of `calc_chunk_indices`. With `query_k`
+ * [n_queries] (device), the results of the query `i` past its `query_k[i]` nearest neighbors (at
+ * most `k`) are padded with `kOutOfBoundsRecord`.
+ */
 template <typename T,
           typename IdxT,
           typename IvfSampleFilterT = raft::neighbors::filtering::none_ivf_sample_filter>
@@ -736,7 +901,12 @@ inline void search(raft::resources const& handle,
                    uint32_t k,
                    IdxT* neighbors,
                    float* distances,
-                   IvfSampleFilterT sample_filter = IvfSampleFilterT())
+                   IvfSampleFilterT sample_filter = IvfSampleFilterT(),
+                   std::optional<raft::device_matrix_view<const T, int64_t, row_major>>
+                     refine_dataset                    = std::nullopt,
+                   std::optional<float> distance_bound = std::nullopt,
+                   const uint32_t* query_n_probes      = nullptr,
+                   const uint32_t* query_k             = nullptr)
 {
   static_assert(std::is_same_v<T, float> || std::is_same_v<T, uint8_t> || std::is_same_v<T, int8_t>,
                 "Unsupported element type.");
@@ -746,13 +916,23 @@ inline void search(raft::resources const& handle,
     params.n_probes,
     k,
     index.dim());
+  resource::scoped_call call(handle, "ivf_pq::search");
+  call.set_batch_size(n_queries);
 
   RAFT_EXPECTS(
     params.internal_distance_dtype == CUDA_R_16F || params.internal_distance_dtype == CUDA_R_32F,
     "internal_distance_dtype must be either CUDA_R_16F or CUDA_R_32F");
+#ifdef RAFT_IVF_PQ_NATIVE_FP8_LUT
+  RAFT_EXPECTS(params.lut_dtype == CUDA_R_16F || params.lut_dtype == CUDA_R_32F ||
+                 params.lut_dtype == CUDA_R_8U || params.lut_dtype == CUDA_R_8F_E4M3 ||
+                 params.lut_dtype == CUDA_R_8F_E5M2,
+               "lut_dtype must be CUDA_R_16F, CUDA_R_32F, CUDA_R_8U, CUDA_R_8F_E4M3 or "
+               "CUDA_R_8F_E5M2");
+#else
   RAFT_EXPECTS(params.lut_dtype == CUDA_R_16F || params.lut_dtype == CUDA_R_32F ||
                  params.lut_dtype == CUDA_R_8U,
                "lut_dtype must be CUDA_R_16F, CUDA_R_32F or CUDA_R_8U");
+#endif
   RAFT_EXPECTS(k > 0, "parameter `k` in top-k must be positive.");
   RAFT_EXPECTS(
     k <= index.size(),
@@ -761,6 +941,8 @@ inline void search(raft::resources const& handle,
     static_cast<uint64_t>(index.size()));
   RAFT_EXPECTS(params.n_probes > 0,
                "n_probes (number of clusters to probe in the search) must be positive.");
+  RAFT_EXPECTS(params.probe_distance_ratio == 0 || params.probe_distance_ratio >= 1,
+               "probe_distance_ratio must be either zero (disabled) or not smaller than one.");
 
   switch (utils::check_pointer_residency(queries, neighbors, distances)) {
     case utils::pointer_residency::device_only:
@@ -768,68 +950,135 @@ inline void search(raft::resources const& handle,
     default: RAFT_FAIL("all pointers must be accessible from the device.");
   }
 
-  auto stream = resource::get_cuda_stream(handle);
-
   auto dim      = index.dim();
   auto dim_ext  = index.dim_ext();
   auto n_probes = std::min<uint32_t>(params.n_probes, index.n_lists());
 
-  uint32_t max_samples = 0;
-  {
-    IdxT ms = Pow2<128>::roundUp(index.accum_sorted_sizes()(n_probes));
-    RAFT_EXPECTS(ms <= IdxT(std::numeric_limits<uint32_t>::max()),
-                 "The maximum sample size is too big.");
-    max_samples = ms;
+  // The number of candidates selected by the scan (more than k if they are refined).
+  const bool refine = refine_dataset.has_value();
+  uint32_t k_scan   = k;
+  if (refine) {
+    RAFT_EXPECTS((std::is_same_v<IdxT, int64_t>),
+                 "The candidates can be refined only with the int64_t indices");
+    RAFT_EXPECTS(refine_dataset->extent(1) == int64_t(dim),
+                 "The refinement dataset must have the dimensionality of the index");
+    RAFT_EXPECTS(k <= raft::matrix::detail::select::warpsort::kMaxCapacity,
+                 "k must be less than topk::kMaxCapacity (%d) to refine the candidates.",
+                 raft::matrix::detail::select::warpsort::kMaxCapacity);
+    k_scan = static_cast<uint32_t>(std::min<double>(
+      std::max<double>(k, std::ceil(double(k) * params.refine_ratio)), index.size()));
   }
 
-  auto mr = resource::get_workspace_resource(handle);
+  RAFT_EXPECTS(!(refine && distance_bound.has_value()),
+               "The candidates bounded by distance cannot be refined");
+  const float scaling_factor = utils::config<T>::kDivisor / utils::config<float>::kDivisor;
+  const float score_bound =
+    distance_bound.has_value()
+      ? distance_to_score(*distance_bound, index.metric(), scaling_factor)
+      : std::numeric_limits<float>::infinity();
 
-  // Maximum number of query vectors to search at the same time.
-  const auto max_queries = std::min<uint32_t>(std::max<uint32_t>(n_queries, 1), 4096);
-  auto max_batch_size    = get_max_batch_size(handle, k, n_probes, max_queries, max_samples);
+  const uint32_t max_samples = get_max_samples(index, n_probes);
 
-  rmm::device_uvector<float> float_queries(max_queries * dim_ext, stream, mr);
-  rmm::device_uvector<float> rot_queries(max_queries * index.rot_dim(), stream, mr);
-  rmm::device_uvector<uint32_t> clusters_to_probe(max_queries * n_probes, stream, mr);
+  auto mr = resource::get_workspace_resource(handle);
 
+  const uint32_t n_streams   = get_search_stream_count(handle, n_queries);
+  const uint32_t max_queries = get_max_queries_per_stream(n_queries, n_streams);
+  auto max_batch_size =
+    get_max_batch_size(handle, k_scan, n_probes, max_queries, max_samples, n_streams);
+
+  // The resources and the buffers of every stream; the streams share the cublas handle of the
+  // main resources, which is created here not to create one per stream.
+  if (n_streams > 1) { resource::get_cublas_handle(handle); }
+  std::vector<std::unique_ptr<raft::resources>> stream_handles;
+  std::vector<rmm::device_uvector<float>> float_queries;
+  std::vector<rmm::device_uvector<float>> rot_queries;
+  std::vector<rmm::device_uvector<uint32_t>> clusters_to_probe;
+  std::vector<rmm::device_uvector<IdxT>> candidates;
+  std::vector<rmm::device_uvector<float>> candidate_distances;
+  for (uint32_t i = 0; i < n_streams; i++) {
+    stream_handles.push_back(std::make_unique<raft::resources>(handle));
+    if (n_streams > 1) {
+      resource::set_cuda_stream(*stream_handles.back(),
+                                resource::get_stream_from_stream_pool(handle, i));
+    }
+    auto s = resource::get_cuda_stream(*stream_handles.back());
+    float_queries.emplace_back(max_queries * dim_ext, s, mr);
+    rot_queries.emplace_back(max_queries * index.rot_dim(), s, mr);
+    clusters_to_probe.emplace_back(max_queries * n_probes, s, mr);
+    const size_t n_candidates = refine ? size_t(max_batch_size) * k_scan : 0;
+    candidates.emplace_back(n_candidates, s, mr);
+    candidate_distances.emplace_back(n_candidates, s, mr);
+  }
+  call.note_workspace();
+  // Make the streams of the pool wait for the inputs prepared on the main stream
+  if (n_streams > 1) { resource::wait_stream_pool_on_stream(handle); }
+
+  // the records removed from the index are rejected along with the filtered ones
   auto filter_adapter = raft::neighbors::filtering::ivf_to_sample_filter(
-    index.inds_ptrs().data_handle(), sample_filter);
+    index.inds_ptrs().data_handle(),
+    sample_filter,
+    index.n_removed() > 0 ? index.removed_ptrs().data_handle() : nullptr);
   auto search_instance = ivfpq_search<IdxT, decltype(filter_adapter)>::fun(params, index.metric());
 
-  for (uint32_t offset_q = 0; offset_q < n_queries; offset_q += max_queries) {
+  for (uint32_t offset_q = 0, stream_ix = 0; offset_q < n_queries;
+       offset_q += max_queries, stream_ix = (stream_ix + 1) % n_streams) {
+    resource::check_cancellation(handle);
     uint32_t queries_batch = min(max_queries, n_queries - offset_q);
+    const auto& res        = *stream_handles[stream_ix];
 
-    select_clusters(handle,
-                    clusters_to_probe.data(),
-                    float_queries.data(),
-                    queries_batch,
-                    n_probes,
-                    index.n_lists(),
-                    dim,
-                    dim_ext,
-                    index.metric(),
-                    queries + static_cast<size_t>(dim) * offset_q,
-                    index.centers().data_handle(),
-                    mr);
-
-    // Rotate queries
-    float alpha = 1.0;
-    float beta  = 0.0;
-    linalg::gemm(handle,
-                 true,
-                 false,
-                 index.rot_dim(),
-                 queries_batch,
-                 dim,
-                 &alpha,
-                 index.rotation_matrix().data_handle(),
-                 dim,
-                 float_queries.data(),
-                 dim_ext,
-                 &beta,
-                 rot_queries.data(),
-                 index.rot_dim(),
-                 stream);
+    {
+      resource::scoped_phase phase(res, "ivf_pq::coarse_search");
+      select_clusters(res,
+                      clusters_to_probe[stream_ix].data(),
+                      float_queries[stream_ix].data(),
+                      queries_batch,
+                      n_probes,
+                      index.n_lists(),
+                      dim,
+                      dim_ext,
+                      index.metric(),
+                      queries + static_cast<size_t>(dim) * offset_q,
+                      index.centers().data_handle(),
+                      mr,
+                      params.probe_distance_ratio);
+      if (query_n_probes != nullptr) {
+        utils::mask_probes_per_query(size_t{queries_batch},
+                                     n_probes,
+                                     query_n_probes + offset_q,
+                                     ivf::kSkippedProbe,
+                                     clusters_to_probe[stream_ix].data(),
+                                     resource::get_cuda_stream(res));
+      }
+      // The lists where no sample passes the filter (for the query) are not scanned at all.
+      if constexpr (raft::neighbors::filtering::skips_lists<IvfSampleFilterT>::value) {
+        utils::mask_skipped_probes(queries_batch,
+                                   n_probes,
+                                   offset_q,
+                                   sample_filter,
+                                   ivf::kSkippedProbe,
+                                   clusters_to_probe[stream_ix].data(),
+                                   resource::get_cuda_stream(res));
+      }
+
+      // Rotate queries
+      float alpha = 1.0;
+      float beta  = 0.0;
+      linalg::gemm(res,
+                   true,
+                   false,
+                   index.rot_dim(),
+                   queries_batch,
+                   dim,
+                   &alpha,
+                   index.rotation_matrix().data_handle(),
+                   dim,
+                   float_queries[stream_ix].data(),
+                   dim_ext,
+                   &beta,
+                   rot_queries[stream_ix].data(),
+                   index.rot_dim(),
+                   resource::get_cuda_stream(res));
+    }
 
     for (uint32_t offset_b = 0; offset_b < queries_batch; offset_b += max_batch_size) {
       uint32_t batch_size = min(max_batch_size, queries_batch - offset_b);
@@ -837,22 +1086,130 @@ inline void search(raft::resources const& handle,
          as long as `index.rotation_matrix()` is orthogonal, the distances and thus results are
          preserved.
        */
-      search_instance(handle,
+      auto* batch_neighbors = neighbors + uint64_t(k) * (offset_q + offset_b);
+      auto* batch_distances = distances + uint64_t(k) * (offset_q + offset_b);
+      search_instance(res,
                       index,
                       max_samples,
                       n_probes,
-                      k,
+                      k_scan,
                       batch_size,
                       offset_q + offset_b,
-                      clusters_to_probe.data() + uint64_t(n_probes) * offset_b,
-                      rot_queries.data() + uint64_t(index.rot_dim()) * offset_b,
-                      neighbors + uint64_t(k) * (offset_q + offset_b),
-                      distances + uint64_t(k) * (offset_q + offset_b),
-                      utils::config<T>::kDivisor / utils::config<float>::kDivisor,
+                      clusters_to_probe[stream_ix].data() + uint64_t(n_probes) * offset_b,
+                      rot_queries[stream_ix].data() + uint64_t(index.rot_dim()) * offset_b,
+                      refine ? candidates[stream_ix].data() : batch_neighbors,
+                      refine ? candidate_distances[stream_ix].data() : batch_distances,
+                      scaling_factor,
                       params.preferred_shmem_carveout,
+                      score_bound,
                       filter_adapter);
+      if (refine) {
+        // The refinement scan is compiled for the int64_t indices only.
+        if constexpr (std::is_same_v<IdxT, int64_t>) {
+          resource::scoped_phase phase(res, "ivf_pq::refine");
+          raft::neighbors::detail::refine_device_impl<IdxT, T, float, int64_t>(
+            res,
+            refine_dataset->data_handle(),
+            false,
+            raft::make_device_matrix_view<const T, int64_t>(
+              queries + uint64_t(dim) * (offset_q + offset_b), batch_size, dim),
+            raft::make_device_matrix_view<const IdxT, int64_t>(
+              candidates[stream_ix].data(), batch_size, k_scan),
+            raft::make_device_matrix_view<IdxT, int64_t>(batch_neighbors, batch_size, k),
+            raft::make_device_matrix_view<float, int64_t>(batch_distances, batch_size, k),
+            index.metric());
+        }
+      }
+      if (query_k != nullptr) {
+        utils::pad_results_per_query(
+          batch_size,
+          k,
+          query_k + offset_q + offset_b,
+          kOutOfBoundsRecord<IdxT>,
+          index.metric() == distance::DistanceType::InnerProduct
+            ? std::numeric_limits<float>::lowest()
+            : std::numeric_limits<float>::max(),
+          batch_neighbors,
+          batch_distances,
+          resource::get_cuda_stream(res));
+      }
     }
   }
+
+  if (n_streams > 1) {
+    std::vector<std::size_t> stream_indices(n_streams);
+    std::iota(stream_indices.begin(), stream_indices.end(), 0);
+    resource::sync_stream_pool(handle, stream_indices);
+  }
+}
+
+/**
+ * See raft::neighbors::ivf_pq::range_search docs
+ *
+ * Every round of the range search is a top-k search bounded by the radius, so the scan drops (and,
+ * for the L2 metrics, stops computing early) the codes out of the radius.
+ */
+template <typename T, typename IdxT>
+void range_search(raft::resources const& handle,
+                  const range_search_params& params,
+                  const index<IdxT>& index,
+                  raft::device_matrix_view<const T, uint32_t, row_major> queries,
+                  float radius,
+                  raft::device_csr_matrix<float, int64_t, IdxT, int64_t>& result)
+{
+  const int64_t n_queries = queries.extent(0);
+  const int64_t dim       = queries.extent(1);
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_pq::range_search(%zu queries, radius = %f)", static_cast<size_t>(n_queries), radius);
+  RAFT_EXPECTS(dim == int64_t(index.dim()),
+               "Number of query dimensions should equal number of dimensions in the index.");
+  RAFT_EXPECTS(params.initial_k > 0 && params.initial_k <= params.max_k,
+               "range_search_params: initial_k must be in [1, max_k]");
+  RAFT_EXPECTS(static_cast<uint64_t>(result.structure_view().get_n_cols()) ==
+                 static_cast<uint64_t>(index.size()),
+               "The range search result must be of the shape [n_queries, index size]");
+
+  const uint32_t max_k  = std::min<uint64_t>(params.max_k, index.size());
+  const bool similarity = index.metric() == distance::DistanceType::InnerProduct;
+
+  auto search_round = [&](const int64_t* ids,
+                          int64_t n_pending,
+                          uint32_t k,
+                          raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                          raft::device_matrix_view<float, int64_t, row_major> distances) {
+    const T* round_queries = queries.data_handle();
+    auto gathered          = raft::make_device_matrix<T, int64_t>(handle, 0, dim);
+    if (ids != nullptr) {
+      gathered = raft::make_device_matrix<T, int64_t>(handle, n_pending, dim);
+      raft::matrix::gather(
+        handle,
+        raft::make_device_matrix_view<const T, int64_t>(round_queries, n_queries, dim),
+        raft::make_device_vector_view<const int64_t, int64_t>(ids, n_pending),
+        gathered.view());
+      round_queries = gathered.data_handle();
+    }
+    search<T, IdxT>(handle,
+                    params,
+                    index,
+                    round_queries,
+                    static_cast<uint32_t>(n_pending),
+                    k,
+                    neighbors.data_handle(),
+                    distances.data_handle(),
+                    raft::neighbors::filtering::none_ivf_sample_filter{},
+                    std::nullopt,
+                    std::make_optional(radius));
+  };
+
+  raft::neighbors::detail::range_search_rounds<IdxT>(handle,
+                                                     n_queries,
+                                                     std::min(params.initial_k, max_k),
+                                                     max_k,
+                                                     radius,
+                                                     similarity,
+                                                     ivf_pq::kOutOfBoundsRecord<IdxT>,
+                                                     search_round,
+                                                     result);
 }
 
 }  // namespace raft::neighbors::ivf_pq::detail
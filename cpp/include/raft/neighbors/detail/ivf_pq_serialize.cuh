@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/neighbors/detail/faiss_io.hpp>
+#include <raft/neighbors/detail/id_compression.cuh>
 #include <raft/neighbors/detail/ivf_pq_build.cuh>
 #include <raft/neighbors/ivf_list.hpp>
 #include <raft/neighbors/ivf_pq_types.hpp>
@@ -26,8 +28,21 @@
 #include <raft/core/resources.hpp>
 #include <raft/core/serialize.hpp>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <streambuf>
+#include <vector>
 
 namespace raft::neighbors::ivf_pq::detail {
 
@@ -36,28 +51,15 @@ namespace raft::neighbors::ivf_pq::detail {
 // backward compatibility.
 // TODO(hcho3) Implement next-gen serializer for IVF that allows for expansion in a backward
 //             compatible fashion.
-constexpr int kSerializationVersion = 3;
+constexpr int kSerializationVersion = 4;
 
 /**
- * Write the index to an output stream
- *
- * Experimental, both the API and the serialization format are subject to change.
- *
- * @param[in] handle the raft handle
- * @param[in] os output stream
- * @param[in] index IVF-PQ index
- *
+ * Write the index parameters, the centers and the codebooks: everything but the lists.
  */
 template <typename IdxT>
-void serialize(raft::resources const& handle_, std::ostream& os, const index<IdxT>& index)
+void serialize_header(raft::resources const& handle_, std::ostream& os, const index<IdxT>& index)
 {
-  RAFT_LOG_DEBUG("Size %zu, dim %d, pq_dim %d, pq_bits %d",
-                 static_cast<size_t>(index.size()),
-                 static_cast<int>(index.dim()),
-                 static_cast<int>(index.pq_dim()),
-                 static_cast<int>(index.pq_bits()));
-
-  serialize_scalar(handle_, os, kSerializationVersion);
+  RAFT_EXPECTS(index.n_removed() == 0, "Compact the index before serializing it");
   serialize_scalar(handle_, os, index.size());
   serialize_scalar(handle_, os, index.dim());
   serialize_scalar(handle_, os, index.pq_bits());
@@ -72,17 +74,90 @@ void serialize(raft::resources const& handle_, std::ostream& os, const index<Idx
   serialize_mdspan(handle_, os, index.centers());
   serialize_mdspan(handle_, os, index.centers_rot());
   serialize_mdspan(handle_, os, index.rotation_matrix());
+}
+
+/** Read the part written by `serialize_header` into a new index with empty lists. */
+template <typename IdxT>
+auto deserialize_header(raft::resources const& handle_, std::istream& is) -> index<IdxT>
+{
+  auto n_rows  = deserialize_scalar<IdxT>(handle_, is);
+  auto dim     = deserialize_scalar<std::uint32_t>(handle_, is);
+  auto pq_bits = deserialize_scalar<std::uint32_t>(handle_, is);
+  auto pq_dim  = deserialize_scalar<std::uint32_t>(handle_, is);
+  auto cma     = deserialize_scalar<bool>(handle_, is);
+
+  auto metric        = deserialize_scalar<raft::distance::DistanceType>(handle_, is);
+  auto codebook_kind = deserialize_scalar<raft::neighbors::ivf_pq::codebook_gen>(handle_, is);
+  auto n_lists       = deserialize_scalar<std::uint32_t>(handle_, is);
+
+  RAFT_LOG_DEBUG("n_rows %zu, dim %d, pq_dim %d, pq_bits %d, n_lists %d",
+                 static_cast<std::size_t>(n_rows),
+                 static_cast<int>(dim),
+                 static_cast<int>(pq_dim),
+                 static_cast<int>(pq_bits),
+                 static_cast<int>(n_lists));
+
+  auto index = raft::neighbors::ivf_pq::index<IdxT>(
+    handle_, metric, codebook_kind, n_lists, dim, pq_bits, pq_dim, cma);
+
+  deserialize_mdspan(handle_, is, index.pq_centers());
+  deserialize_mdspan(handle_, is, index.centers());
+  deserialize_mdspan(handle_, is, index.centers_rot());
+  deserialize_mdspan(handle_, is, index.rotation_matrix());
+  return index;
+}
 
+/** Copy the list sizes of the index to the host. */
+template <typename IdxT>
+auto list_sizes_to_host(raft::resources const& handle_, const index<IdxT>& index)
+  -> host_vector<uint32_t, uint32_t, row_major>
+{
   auto sizes_host = make_host_mdarray<uint32_t, uint32_t, row_major>(index.list_sizes().extents());
   copy(sizes_host.data_handle(),
        index.list_sizes().data_handle(),
        sizes_host.size(),
        resource::get_cuda_stream(handle_));
   resource::sync_stream(handle_);
+  return sizes_host;
+}
+
+/**
+ * Write the index to an output stream
+ *
+ * Experimental, both the API and the serialization format are subject to change.
+ *
+ * @param[in] handle the raft handle
+ * @param[in] os output stream
+ * @param[in] index IVF-PQ index
+ * @param[in] compress whether to compress the source ids of the lists
+ *
+ */
+template <typename IdxT>
+void serialize(raft::resources const& handle_,
+               std::ostream& os,
+               const index<IdxT>& index,
+               bool compress = false)
+{
+  RAFT_LOG_DEBUG("Size %zu, dim %d, pq_dim %d, pq_bits %d",
+                 static_cast<size_t>(index.size()),
+                 static_cast<int>(index.dim()),
+                 static_cast<int>(index.pq_dim()),
+                 static_cast<int>(index.pq_bits()));
+
+  serialize_scalar(handle_, os, kSerializationVersion);
+  serialize_scalar(handle_, os, compress);
+  serialize_header(handle_, os, index);
+
+  auto sizes_host = list_sizes_to_host(handle_, index);
   serialize_mdspan(handle_, os, sizes_host.view());
   auto list_store_spec = list_spec<uint32_t, IdxT>{index.pq_bits(), index.pq_dim(), true};
   for (uint32_t label = 0; label < index.n_lists(); label++) {
-    ivf::serialize_list(handle_, os, index.lists()[label], list_store_spec, sizes_host(label));
+    if (compress) {
+      neighbors::detail::serialize_list_compressed(
+        handle_, os, index.lists()[label], list_store_spec, sizes_host(label), sizes_host(label));
+    } else {
+      ivf::serialize_list(handle_, os, index.lists()[label], list_store_spec, sizes_host(label));
+    }
   }
 }
 
@@ -99,12 +174,13 @@ void serialize(raft::resources const& handle_, std::ostream& os, const index<Idx
 template <typename IdxT>
 void serialize(raft::resources const& handle_,
                const std::string& filename,
-               const index<IdxT>& index)
+               const index<IdxT>& index,
+               bool compress = false)
 {
   std::ofstream of(filename, std::ios::out | std::ios::binary);
   if (!of) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
 
-  detail::serialize(handle_, of, index);
+  detail::serialize(handle_, of, index, compress);
 
   of.close();
   if (!of) { RAFT_FAIL("Error writing output %s", filename.c_str()); }
@@ -124,38 +200,24 @@ template <typename IdxT>
 auto deserialize(raft::resources const& handle_, std::istream& is) -> index<IdxT>
 {
   auto ver = deserialize_scalar<int>(handle_, is);
-  if (ver != kSerializationVersion) {
+  // Version 3 is the same format without the compression of the ids.
+  if (ver != kSerializationVersion && ver != 3) {
     RAFT_FAIL("serialization version mismatch %d vs. %d", ver, kSerializationVersion);
   }
-  auto n_rows  = deserialize_scalar<IdxT>(handle_, is);
-  auto dim     = deserialize_scalar<std::uint32_t>(handle_, is);
-  auto pq_bits = deserialize_scalar<std::uint32_t>(handle_, is);
-  auto pq_dim  = deserialize_scalar<std::uint32_t>(handle_, is);
-  auto cma     = deserialize_scalar<bool>(handle_, is);
-
-  auto metric        = deserialize_scalar<raft::distance::DistanceType>(handle_, is);
-  auto codebook_kind = deserialize_scalar<raft::neighbors::ivf_pq::codebook_gen>(handle_, is);
-  auto n_lists       = deserialize_scalar<std::uint32_t>(handle_, is);
+  bool compressed = ver >= 4 ? deserialize_scalar<bool>(handle_, is) : false;
+  auto index      = deserialize_header<IdxT>(handle_, is);
 
-  RAFT_LOG_DEBUG("n_rows %zu, dim %d, pq_dim %d, pq_bits %d, n_lists %d",
-                 static_cast<std::size_t>(n_rows),
-                 static_cast<int>(dim),
-                 static_cast<int>(pq_dim),
-                 static_cast<int>(pq_bits),
-                 static_cast<int>(n_lists));
-
-  auto index = raft::neighbors::ivf_pq::index<IdxT>(
-    handle_, metric, codebook_kind, n_lists, dim, pq_bits, pq_dim, cma);
-
-  deserialize_mdspan(handle_, is, index.pq_centers());
-  deserialize_mdspan(handle_, is, index.centers());
-  deserialize_mdspan(handle_, is, index.centers_rot());
-  deserialize_mdspan(handle_, is, index.rotation_matrix());
   deserialize_mdspan(handle_, is, index.list_sizes());
-  auto list_device_spec = list_spec<uint32_t, IdxT>{pq_bits, pq_dim, cma};
-  auto list_store_spec  = list_spec<uint32_t, IdxT>{pq_bits, pq_dim, true};
+  auto list_device_spec = list_spec<uint32_t, IdxT>{
+    index.pq_bits(), index.pq_dim(), index.conservative_memory_allocation()};
+  auto list_store_spec = list_spec<uint32_t, IdxT>{index.pq_bits(), index.pq_dim(), true};
   for (auto& list : index.lists()) {
-    ivf::deserialize_list(handle_, is, list, list_store_spec, list_device_spec);
+    if (compressed) {
+      neighbors::detail::deserialize_list_compressed(
+        handle_, is, list, list_store_spec, list_device_spec);
+    } else {
+      ivf::deserialize_list(handle_, is, list, list_store_spec, list_device_spec);
+    }
   }
 
   resource::sync_stream(handle_);
@@ -188,4 +250,386 @@ auto deserialize(raft::resources const& handle_, const std::string& filename) ->
   return index;
 }
 
+/*
+ * The mapped layout (`serialize_mapped`):
+ *
+ *   [kMappedSerializationVersion][header]
+ *   (page-aligned) [list 0: codes, indices] ... (page-aligned) [list n_lists - 1: codes, indices]
+ *   [n_lists][list sizes][list offsets][offset of n_lists: uint64_t]
+ *
+ * The codes keep the interleaved (conservative) device layout, so that every list can be copied to
+ * the device straight from the memory-mapped file.
+ */
+constexpr int kMappedSerializationVersion = 1001;
+constexpr uint64_t kMappedPageSize        = 4096;
+
+/** The size in bytes of the codes of a list in the stored layout. */
+template <typename IdxT>
+auto mapped_list_data_bytes(const list_spec<uint32_t, IdxT>& store_spec, uint32_t size) -> size_t
+{
+  auto extents = store_spec.make_list_extents(size);
+  return size_t(extents.extent(0)) * extents.extent(1) * extents.extent(2) * extents.extent(3);
+}
+
+/** Write the index to a file in the mapped layout (see `ivf_pq::serialize_mapped`). */
+template <typename IdxT>
+void serialize_mapped(raft::resources const& handle_,
+                      const std::string& filename,
+                      const index<IdxT>& index)
+{
+  std::ofstream os(filename, std::ios::out | std::ios::binary);
+  if (!os) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
+
+  serialize_scalar(handle_, os, kMappedSerializationVersion);
+  serialize_header(handle_, os, index);
+
+  auto stream          = resource::get_cuda_stream(handle_);
+  auto sizes_host      = list_sizes_to_host(handle_, index);
+  auto list_store_spec = list_spec<uint32_t, IdxT>{index.pq_bits(), index.pq_dim(), true};
+  auto offsets         = make_host_vector<uint64_t, uint32_t>(index.n_lists());
+  std::vector<char> buf;
+  const std::vector<char> padding(kMappedPageSize, 0);
+  for (uint32_t label = 0; label < index.n_lists(); label++) {
+    const uint32_t size = sizes_host(label);
+    const auto pos      = static_cast<uint64_t>(os.tellp());
+    offsets(label)      = raft::round_up_safe<uint64_t>(pos, kMappedPageSize);
+    os.write(padding.data(), offsets(label) - pos);
+    if (size == 0) { continue; }
+    const auto& list        = index.lists()[label];
+    const size_t data_bytes = mapped_list_data_bytes(list_store_spec, size);
+    buf.resize(data_bytes + size_t(size) * sizeof(IdxT));
+    copy(reinterpret_cast<uint8_t*>(buf.data()), list->data.data_handle(), data_bytes, stream);
+    copy(reinterpret_cast<IdxT*>(buf.data() + data_bytes),
+         list->indices.data_handle(),
+         size,
+         stream);
+    resource::sync_stream(handle_);
+    os.write(buf.data(), buf.size());
+  }
+  const auto trailer_offset = static_cast<uint64_t>(os.tellp());
+  serialize_scalar(handle_, os, index.n_lists());
+  serialize_mdspan(handle_, os, sizes_host.view());
+  serialize_mdspan(handle_, os, offsets.view());
+  os.write(reinterpret_cast<const char*>(&trailer_offset), sizeof(trailer_offset));
+
+  os.close();
+  if (!os) { RAFT_FAIL("Error writing output %s", filename.c_str()); }
+}
+
+/** A read-only stream buffer over a range of memory (to parse the mapped file in place). */
+struct memory_streambuf : std::streambuf {
+  memory_streambuf(const char* begin, size_t size)
+  {
+    auto* p = const_cast<char*>(begin);
+    setg(p, p, p + size);
+  }
+};
+
+/** See `ivf_pq::mapped_lists`. */
+template <typename IdxT>
+class mapped_lists {
+ public:
+  mapped_lists(raft::resources const& handle_, const std::string& filename)
+    : sizes_{make_host_vector<uint32_t, uint32_t>(0)},
+      offsets_{make_host_vector<uint64_t, uint32_t>(0)}
+  {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) { RAFT_FAIL("Cannot open file %s: %s", filename.c_str(), std::strerror(errno)); }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      RAFT_FAIL("Cannot stat file %s: %s", filename.c_str(), std::strerror(errno));
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    RAFT_EXPECTS(size_ > sizeof(uint64_t), "The file %s is too small", filename.c_str());
+    void* ptr = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the file descriptor is closed.
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+      RAFT_FAIL("Cannot map file %s: %s", filename.c_str(), std::strerror(errno));
+    }
+    const auto size = size_;
+    mapping_        = std::shared_ptr<void>(ptr, [size](void* p) { ::munmap(p, size); });
+    base_           = static_cast<const char*>(ptr);
+
+    memory_streambuf version_buf(base_, size_);
+    std::istream version_is(&version_buf);
+    auto ver = deserialize_scalar<int>(handle_, version_is);
+    if (ver != kMappedSerializationVersion) {
+      RAFT_FAIL("serialization version mismatch %d vs. %d", ver, kMappedSerializationVersion);
+    }
+    header_offset_ = static_cast<size_t>(version_is.tellg());
+
+    uint64_t trailer_offset;
+    std::memcpy(&trailer_offset, base_ + size_ - sizeof(uint64_t), sizeof(uint64_t));
+    RAFT_EXPECTS(trailer_offset < size_, "The file %s is corrupted", filename.c_str());
+    memory_streambuf trailer_buf(base_ + trailer_offset, size_ - trailer_offset);
+    std::istream trailer_is(&trailer_buf);
+    auto n_lists = deserialize_scalar<uint32_t>(handle_, trailer_is);
+    sizes_   = make_host_vector<uint32_t, uint32_t>(n_lists);
+    offsets_ = make_host_vector<uint64_t, uint32_t>(n_lists);
+    deserialize_mdspan(handle_, trailer_is, sizes_.view());
+    deserialize_mdspan(handle_, trailer_is, offsets_.view());
+  }
+
+  [[nodiscard]] auto n_lists() const noexcept -> uint32_t { return sizes_.extent(0); }
+  [[nodiscard]] auto list_size(uint32_t label) const -> uint32_t { return sizes_(label); }
+
+  auto make_index(raft::resources const& handle_) const -> index<IdxT>
+  {
+    memory_streambuf header_buf(base_ + header_offset_, size_ - header_offset_);
+    std::istream header_is(&header_buf);
+    auto index = deserialize_header<IdxT>(handle_, header_is);
+    RAFT_EXPECTS(index.n_lists() == n_lists(), "The file is corrupted (inconsistent n_lists)");
+    // No list is loaded yet.
+    utils::memzero(index.list_sizes().data_handle(),
+                   index.list_sizes().size(),
+                   resource::get_cuda_stream(handle_));
+    recompute_internal_state(handle_, index);
+    return index;
+  }
+
+  void load(raft::resources const& handle_,
+            index<IdxT>* index,
+            const std::vector<uint32_t>& labels) const
+  {
+    RAFT_EXPECTS(index->n_lists() == n_lists(), "The index doesn't match the mapped file");
+    auto stream          = resource::get_cuda_stream(handle_);
+    auto spec            = index->make_list_spec();
+    auto list_store_spec = list_spec<uint32_t, IdxT>{index->pq_bits(), index->pq_dim(), true};
+    for (auto label : labels) {
+      RAFT_EXPECTS(label < n_lists(), "The list label %u is out of range", label);
+      auto& list          = index->lists()[label];
+      const uint32_t size = sizes_(label);
+      if (list || size == 0) { continue; }
+      const size_t data_bytes = mapped_list_data_bytes(list_store_spec, size);
+      const auto* src         = base_ + offsets_(label);
+      auto new_list           = std::make_shared<list_data<IdxT>>(handle_, spec, size);
+      copy(new_list->data.data_handle(), reinterpret_cast<const uint8_t*>(src), data_bytes, stream);
+      copy(new_list->indices.data_handle(),
+           reinterpret_cast<const IdxT*>(src + data_bytes),
+           size,
+           stream);
+      copy(index->list_sizes().data_handle() + label, &sizes_(label), 1, stream);
+      list.swap(new_list);
+    }
+    recompute_internal_state(handle_, *index);
+    resource::sync_stream(handle_);
+  }
+
+ private:
+  std::shared_ptr<void> mapping_;
+  const char* base_     = nullptr;
+  size_t size_          = 0;
+  size_t header_offset_ = 0;
+  host_vector<uint32_t, uint32_t> sizes_;
+  host_vector<uint64_t, uint32_t> offsets_;
+};
+
+/** Load a whole index in the mapped layout (see `ivf_pq::deserialize_mapped`). */
+template <typename IdxT>
+auto deserialize_mapped(raft::resources const& handle_, const std::string& filename)
+  -> index<IdxT>
+{
+  mapped_lists<IdxT> file(handle_, filename);
+  auto index = file.make_index(handle_);
+  std::vector<uint32_t> labels(file.n_lists());
+  std::iota(labels.begin(), labels.end(), 0);
+  file.load(handle_, &index, labels);
+  return index;
+}
+
+
+/**
+ * Write the index as a `faiss::IndexIVFPQ` (the `faiss::write_index` format).
+ *
+ * FAISS encodes the residuals in the original space with one codebook per subspace, so only the
+ * PER_SUBSPACE indices without a rotation (`rot_dim == dim`, identity rotation matrix) have an
+ * equivalent. The codes are converted to the flat FAISS layout on the device in one pass; the
+ * contiguous RAFT code layout is that of the FAISS PQ encoder, so no re-encoding happens.
+ */
+template <typename IdxT>
+void serialize_to_faiss(raft::resources const& handle_,
+                        std::ostream& os,
+                        const index<IdxT>& index)
+{
+  RAFT_EXPECTS(index.n_removed() == 0, "Compact the index before serializing it");
+  namespace faiss = raft::neighbors::detail::faiss;
+  auto stream            = resource::get_cuda_stream(handle_);
+  const auto metric      = faiss::to_faiss_metric(index.metric());
+  const int64_t n_rows   = index.size();
+  const uint32_t dim     = index.dim();
+  const uint32_t n_lists = index.n_lists();
+  const uint32_t pq_dim  = index.pq_dim();
+  const uint32_t pq_len  = index.pq_len();
+  const uint32_t ksub    = index.pq_book_size();
+  RAFT_EXPECTS(index.codebook_kind() == codebook_gen::PER_SUBSPACE,
+               "Only the PER_SUBSPACE codebooks have a FAISS equivalent");
+  RAFT_EXPECTS(index.rot_dim() == dim,
+               "FAISS has no rotation of the dataset: pq_dim must divide the dim of the index");
+
+  std::vector<float> rotation(size_t(dim) * dim);
+  copy(rotation.data(), index.rotation_matrix().data_handle(), rotation.size(), stream);
+  resource::sync_stream(handle_);
+  for (uint32_t i = 0; i < dim; i++) {
+    for (uint32_t j = 0; j < dim; j++) {
+      RAFT_EXPECTS(rotation[size_t(i) * dim + j] == (i == j ? 1.0f : 0.0f),
+                   "FAISS has no rotation of the dataset: the index must be built with an "
+                   "identity rotation (force_random_rotation = false)");
+    }
+  }
+
+  std::vector<float> centers_ext(size_t(n_lists) * index.dim_ext());
+  std::vector<float> pq_centers(index.pq_centers().size());
+  copy(centers_ext.data(), index.centers().data_handle(), centers_ext.size(), stream);
+  copy(pq_centers.data(), index.pq_centers().data_handle(), pq_centers.size(), stream);
+
+  const uint32_t code_size = raft::ceildiv<uint32_t>(pq_dim * index.pq_bits(), 8);
+  auto codes   = make_device_matrix<uint8_t, int64_t>(handle_, n_rows, code_size);
+  auto indices = make_device_vector<IdxT, int64_t>(handle_, n_rows);
+  auto offsets = make_device_vector<int64_t, int64_t>(handle_, n_lists + 1);
+  unpack_all_lists(handle_, index, codes.view(), indices.view(), offsets.view());
+  std::vector<uint8_t> codes_host(codes.size());
+  std::vector<IdxT> indices_host(n_rows);
+  std::vector<int64_t> offsets_host(n_lists + 1);
+  copy(codes_host.data(), codes.data_handle(), codes.size(), stream);
+  copy(indices_host.data(), indices.data_handle(), n_rows, stream);
+  copy(offsets_host.data(), offsets.data_handle(), n_lists + 1, stream);
+  resource::sync_stream(handle_);
+
+  // The centers without their norms, and the codebooks as [pq_dim, ksub, pq_len]
+  std::vector<float> centers(size_t(n_lists) * dim);
+  for (size_t l = 0; l < n_lists; l++) {
+    std::copy_n(centers_ext.data() + l * index.dim_ext(), dim, centers.data() + l * dim);
+  }
+  std::vector<float> centroids(pq_centers.size());
+  for (size_t m = 0; m < pq_dim; m++) {
+    for (size_t i = 0; i < pq_len; i++) {
+      for (size_t k = 0; k < ksub; k++) {
+        centroids[(m * ksub + k) * pq_len + i] = pq_centers[(m * pq_len + i) * ksub + k];
+      }
+    }
+  }
+  const std::vector<int64_t> ids(indices_host.begin(), indices_host.end());
+
+  faiss::write_scalar(os, faiss::fourcc("IwPQ"));
+  faiss::write_ivf_header(
+    os, faiss::index_header{int32_t(dim), n_rows, true, metric}, n_lists, centers);
+  faiss::write_scalar(os, true);  // by_residual
+  faiss::write_scalar<size_t>(os, code_size);
+  // faiss::ProductQuantizer
+  faiss::write_scalar<size_t>(os, dim);
+  faiss::write_scalar<size_t>(os, pq_dim);
+  faiss::write_scalar<size_t>(os, index.pq_bits());
+  faiss::write_vector(os, centroids.data(), centroids.size());
+  faiss::write_inverted_lists(os, code_size, offsets_host, codes_host.data(), ids.data());
+}
+
+template <typename IdxT>
+void serialize_to_faiss(raft::resources const& handle_,
+                        const std::string& filename,
+                        const index<IdxT>& index)
+{
+  std::ofstream of(filename, std::ios::out | std::ios::binary);
+  if (!of) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
+
+  detail::serialize_to_faiss(handle_, of, index);
+
+  of.close();
+  if (!of) { RAFT_FAIL("Error writing output %s", filename.c_str()); }
+}
+
+/**
+ * Load a `faiss::IndexIVFPQ` with a flat coarse quantizer and array inverted lists, encoding the
+ * residuals with 4 to 8 bits per code.
+ */
+template <typename IdxT>
+auto deserialize_from_faiss(raft::resources const& handle_, std::istream& is) -> index<IdxT>
+{
+  namespace faiss = raft::neighbors::detail::faiss;
+  auto stream = resource::get_cuda_stream(handle_);
+  faiss::expect_fourcc(is, faiss::fourcc("IwPQ"));
+  faiss::index_header header;
+  uint64_t n_lists;
+  auto centers_host = faiss::read_ivf_header(is, header, n_lists);
+  RAFT_EXPECTS(n_lists <= std::numeric_limits<uint32_t>::max(), "Too many lists");
+  RAFT_EXPECTS(faiss::read_scalar<bool>(is),
+               "Only the FAISS indices encoding the residuals are supported");
+  const auto code_size = faiss::read_scalar<size_t>(is);
+  const auto pq_d      = faiss::read_scalar<size_t>(is);
+  const auto pq_dim    = faiss::read_scalar<size_t>(is);
+  const auto pq_bits   = faiss::read_scalar<size_t>(is);
+  const auto centroids = faiss::read_vector<float>(is);
+  const uint32_t dim   = header.d;
+  RAFT_EXPECTS(pq_bits >= 4 && pq_bits <= 8,
+               "Unsupported FAISS PQ nbits %zu, the value must be within [4, 8]",
+               pq_bits);
+  RAFT_EXPECTS(pq_d == dim && pq_dim > 0 && dim % pq_dim == 0 &&
+                 code_size == raft::ceildiv<size_t>(pq_dim * pq_bits, 8) &&
+                 centroids.size() == size_t(dim) << pq_bits,
+               "Inconsistent FAISS product quantizer");
+  std::vector<int64_t> offsets_host;
+  std::vector<uint8_t> codes_host;
+  std::vector<int64_t> ids;
+  faiss::read_inverted_lists(is, n_lists, code_size, offsets_host, codes_host, ids);
+  const int64_t n_rows = offsets_host.back();
+  RAFT_EXPECTS(n_rows == header.ntotal, "Inconsistent FAISS index size");
+
+  auto index = ivf_pq::index<IdxT>(handle_,
+                                   faiss::from_faiss_metric(header.metric_type),
+                                   codebook_gen::PER_SUBSPACE,
+                                   n_lists,
+                                   dim,
+                                   pq_bits,
+                                   pq_dim,
+                                   false);
+  make_rotation_matrix(
+    handle_, false, index.rot_dim(), index.dim(), index.rotation_matrix().data_handle());
+  auto centers = make_device_matrix<float, uint32_t>(handle_, n_lists, dim);
+  copy(centers.data_handle(), centers_host.data(), centers_host.size(), stream);
+  set_centers(handle_, &index, centers.data_handle());
+
+  // The codebooks from [pq_dim, ksub, pq_len] to [pq_dim, pq_len, ksub]
+  const size_t pq_len = index.pq_len();
+  const size_t ksub   = index.pq_book_size();
+  std::vector<float> pq_centers(centroids.size());
+  for (size_t m = 0; m < pq_dim; m++) {
+    for (size_t i = 0; i < pq_len; i++) {
+      for (size_t k = 0; k < ksub; k++) {
+        pq_centers[(m * pq_len + i) * ksub + k] = centroids[(m * ksub + k) * pq_len + i];
+      }
+    }
+  }
+  copy(index.pq_centers().data_handle(), pq_centers.data(), pq_centers.size(), stream);
+
+  const std::vector<IdxT> indices_host(ids.begin(), ids.end());
+  auto codes   = make_device_matrix<uint8_t, int64_t>(handle_, n_rows, code_size);
+  auto indices = make_device_vector<IdxT, int64_t>(handle_, n_rows);
+  auto offsets = make_device_vector<int64_t, int64_t>(handle_, n_lists + 1);
+  copy(codes.data_handle(), codes_host.data(), codes.size(), stream);
+  copy(indices.data_handle(), indices_host.data(), n_rows, stream);
+  copy(offsets.data_handle(), offsets_host.data(), n_lists + 1, stream);
+  pack_all_lists(handle_,
+                 &index,
+                 make_const_mdspan(codes.view()),
+                 make_const_mdspan(indices.view()),
+                 make_const_mdspan(offsets.view()));
+  resource::sync_stream(handle_);
+  return index;
+}
+
+template <typename IdxT>
+auto deserialize_from_faiss(raft::resources const& handle_, const std::string& filename)
+  -> index<IdxT>
+{
+  std::ifstream is(filename, std::ios::in | std::ios::binary);
+
+  if (!is) { RAFT_FAIL("Cannot open file %s", filename.c_str()); }
+
+  auto index = detail::deserialize_from_faiss<IdxT>(handle_, is);
+
+  is.close();
+
+  return index;
+}
 }  // namespace raft::neighbors::ivf_pq::detail
@@ -16,6 +16,10 @@
 
 #pragma once
 
+#include <raft/core/bitset.cuh>
+#include <raft/core/managed_container_policy.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_graph.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/cuda_stream_pool.hpp>
 #include <raft/core/resource/device_memory_resource.hpp>
@@ -24,8 +28,11 @@
 #include <raft/distance/detail/distance_ops/l2_exp.cuh>
 #include <raft/distance/distance.cuh>
 #include <raft/distance/distance_types.hpp>
+#include <raft/linalg/detail/cublaslt_wrappers.hpp>
 #include <raft/linalg/map.cuh>
+#include <raft/linalg/reduce.cuh>
 #include <raft/linalg/transpose.cuh>
+#include <raft/matrix/gather.cuh>
 #include <raft/matrix/init.cuh>
 #include <raft/matrix/select_k.cuh>
 #include <raft/neighbors/brute_force_types.hpp>
@@ -41,10 +48,14 @@
 #include <rmm/cuda_stream_pool.hpp>
 #include <rmm/device_uvector.hpp>
 
+#include <cuda_fp16.h>
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
 #include <thrust/iterator/transform_iterator.h>
 
 #include <cstdint>
 #include <iostream>
+#include <limits>
 #include <set>
 
 namespace raft::neighbors::detail {
@@ -92,13 +103,13 @@ void tiled_brute_force_knn(const raft::resources& handle,
   tile_cols = std::max(tile_cols, k);
 
   // stores pairwise distances for the current tile
-  rmm::device_uvector<ElementType> temp_distances(tile_rows * tile_cols, stream);
+  rmm::device_uvector<ElementType> temp_distances(tile_rows * tile_cols, stream, device_memory);
 
   // calculate norms for L2 expanded distances - this lets us avoid calculating
   // norms repeatedly per-tile, and just do once for the entire input
   auto pairwise_metric = metric;
-  rmm::device_uvector<ElementType> search_norms(0, stream);
-  rmm::device_uvector<ElementType> index_norms(0, stream);
+  rmm::device_uvector<ElementType> search_norms(0, stream, device_memory);
+  rmm::device_uvector<ElementType> index_norms(0, stream, device_memory);
   if (metric == raft::distance::DistanceType::L2Expanded ||
       metric == raft::distance::DistanceType::L2SqrtExpanded ||
       metric == raft::distance::DistanceType::CosineExpanded) {
@@ -162,17 +173,33 @@ void tiled_brute_force_knn(const raft::resources& handle,
     }
   }
 
-  rmm::device_uvector<ElementType> temp_out_distances(tile_rows * temp_out_cols, stream);
-  rmm::device_uvector<IndexType> temp_out_indices(tile_rows * temp_out_cols, stream);
+  rmm::device_uvector<ElementType> temp_out_distances(
+    tile_rows * temp_out_cols, stream, device_memory);
+  rmm::device_uvector<IndexType> temp_out_indices(tile_rows * temp_out_cols, stream, device_memory);
 
   bool select_min = raft::distance::is_min_close(metric);
 
+  // A managed index (e.g. larger than the device memory) is streamed through the device tile by
+  // tile: the next tile is prefetched (in a stream of the pool, if any) while this one is
+  // processed, rather than faulted in by the distance kernels.
+  bool prefetch_index =
+    !resource::is_stream_capturing(handle) && raft::is_prefetchable_managed_ptr(index);
+  auto prefetch_stream = resource::get_next_usable_stream(handle);
+  int device           = rmm::get_current_cuda_device().value();
+  auto prefetch_tile   = [&](size_t j, rmm::cuda_stream_view s) {
+    if (!prefetch_index || j >= n) { return; }
+    auto bytes = std::min(tile_cols, n - j) * d * sizeof(ElementType);
+    raft::managed_prefetch_async(index + j * d, bytes, device, s);
+  };
+
   for (size_t i = 0; i < m; i += tile_rows) {
     size_t current_query_size = std::min(tile_rows, m - i);
 
     for (size_t j = 0; j < n; j += tile_cols) {
       size_t current_centroid_size = std::min(tile_cols, n - j);
       size_t current_k             = std::min(current_centroid_size, k);
+      if (j == 0) { prefetch_tile(j, stream); }
+      prefetch_tile(j + tile_cols, prefetch_stream);
 
       // calculate the top-k elements for the current tile, by calculating the
       // full pairwise distance for the tile - and then selecting the top-k from that
@@ -344,9 +371,14 @@ void brute_force_knn_impl(
   const value_t* search_norms         = nullptr)
 {
   auto userStream = resource::get_cuda_stream(handle);
+  auto mr         = resource::get_workspace_resource(handle);
 
   ASSERT(input.size() == sizes.size(), "input and sizes vectors should be the same size");
 
+  // While the main stream is captured into a CUDA graph, the stream pool is not used (joining it
+  // needs a host sync), and nothing is copied from the host unless the results need translating.
+  const bool capturing = resource::is_stream_capturing(handle);
+
   std::vector<IdxType>* id_ranges;
   if (translations == nullptr) {
     // If we don't have explicit translations
@@ -366,11 +398,14 @@ void brute_force_knn_impl(
   int device;
   RAFT_CUDA_TRY(cudaGetDevice(&device));
 
-  rmm::device_uvector<IdxType> trans(id_ranges->size(), userStream);
-  raft::update_device(trans.data(), id_ranges->data(), id_ranges->size(), userStream);
+  rmm::device_uvector<IdxType> trans(0, userStream, mr);
+  if (input.size() > 1 || translations != nullptr) {
+    trans.resize(id_ranges->size(), userStream);
+    raft::update_device(trans.data(), id_ranges->data(), id_ranges->size(), userStream);
+  }
 
-  rmm::device_uvector<value_t> all_D(0, userStream);
-  rmm::device_uvector<IdxType> all_I(0, userStream);
+  rmm::device_uvector<value_t> all_D(0, userStream, mr);
+  rmm::device_uvector<IdxType> all_I(0, userStream, mr);
 
   value_t* out_D = res_D;
   IdxType* out_I = res_I;
@@ -391,7 +426,7 @@ void brute_force_knn_impl(
   // api, which isn't supported
   // Instead, transpose the input matrices if they are passed as col-major.
   auto search = search_items;
-  rmm::device_uvector<value_t> search_row_major(0, userStream);
+  rmm::device_uvector<value_t> search_row_major(0, userStream, mr);
   if (!rowMajorQuery) {
     search_row_major.resize(n * D, userStream);
     raft::linalg::transpose(handle, search, search_row_major.data(), n, D, userStream);
@@ -399,7 +434,7 @@ void brute_force_knn_impl(
   }
 
   // transpose into a temporary buffer if necessary
-  rmm::device_uvector<value_t> index_row_major(0, userStream);
+  rmm::device_uvector<value_t> index_row_major(0, userStream, mr);
   if (!rowMajorIndex) {
     size_t total_size = 0;
     for (auto size : sizes) {
@@ -409,21 +444,39 @@ void brute_force_knn_impl(
   }
 
   // Make other streams from pool wait on main stream
-  resource::wait_stream_pool_on_stream(handle);
+  if (!capturing) { resource::wait_stream_pool_on_stream(handle); }
 
   size_t total_rows_processed = 0;
   for (size_t i = 0; i < input.size(); i++) {
     value_t* out_d_ptr = out_D + (i * k * n);
     IdxType* out_i_ptr = out_I + (i * k * n);
 
-    auto stream = resource::get_next_usable_stream(handle, i);
+    auto stream = capturing ? userStream : resource::get_next_usable_stream(handle, i);
+
+    // migrate a managed partition to the device in its stream before it is searched (the tiled
+    // search further prefetches its tiles ahead)
+    if (!capturing) {
+      raft::managed_prefetch_async(input[i],
+                                   size_t(sizes[i]) * D * sizeof(value_t),
+                                   rmm::get_current_cuda_device().value(),
+                                   stream);
+    }
 
     if (k <= 64 && rowMajorQuery == rowMajorIndex && rowMajorQuery == true &&
         std::is_same_v<DistanceEpilogue, raft::identity_op> &&
         (metric == raft::distance::DistanceType::L2Unexpanded ||
          metric == raft::distance::DistanceType::L2SqrtUnexpanded ||
          metric == raft::distance::DistanceType::L2Expanded ||
-         metric == raft::distance::DistanceType::L2SqrtExpanded)) {
+         metric == raft::distance::DistanceType::L2SqrtExpanded ||
+         metric == raft::distance::DistanceType::InnerProduct ||
+         metric == raft::distance::DistanceType::CosineExpanded ||
+         metric == raft::distance::DistanceType::L1 ||
+         metric == raft::distance::DistanceType::Linf ||
+         metric == raft::distance::DistanceType::Canberra ||
+         metric == raft::distance::DistanceType::LpUnexpanded ||
+         metric == raft::distance::DistanceType::HammingUnexpanded ||
+         metric == raft::distance::DistanceType::JensenShannon ||
+         metric == raft::distance::DistanceType::RusselRaoExpanded)) {
       fusedL2Knn(D,
                  out_i_ptr,
                  out_d_ptr,
@@ -437,14 +490,14 @@ void brute_force_knn_impl(
                  stream,
                  metric,
                  input_norms ? (*input_norms)[i] : nullptr,
-                 search_norms);
+                 search_norms,
+                 metricArg,
+                 mr);
 
-      // Perform necessary post-processing
+      // Perform necessary post-processing (the fused Lp distance is already rooted)
       if (metric == raft::distance::DistanceType::L2SqrtExpanded ||
-          metric == raft::distance::DistanceType::L2SqrtUnexpanded ||
-          metric == raft::distance::DistanceType::LpUnexpanded) {
+          metric == raft::distance::DistanceType::L2SqrtUnexpanded) {
         value_t p = 0.5;  // standard l2
-        if (metric == raft::distance::DistanceType::LpUnexpanded) p = 1.0 / metricArg;
         raft::linalg::unaryOp<value_t>(
           res_D,
           res_D,
@@ -499,7 +552,7 @@ void brute_force_knn_impl(
   // Sync internal streams if used. We don't need to
   // sync the user stream because we'll already have
   // fully serial execution.
-  resource::sync_stream_pool(handle);
+  if (!capturing) { resource::sync_stream_pool(handle); }
 
   if (input.size() > 1 || translations != nullptr) {
     // This is necessary for proper index translations. If there are
@@ -549,4 +602,372 @@ void brute_force_search(
                                          norms.size() ? &norms : nullptr,
                                          query_norms ? query_norms->data_handle() : nullptr);
 }
+/** The norms of the rows `ids` of the dataset. */
+template <typename T>
+struct gather_norms_op {
+  const T* norms;
+  const int64_t* ids;
+
+  HDI auto operator()(int64_t i) const -> T { return norms[ids[i]]; }
+};
+
+/**
+ * Map the results of a search over a subset of the dataset back to the dataset rows, padding the
+ * rows of `k` with the missing results if the subset has less than `k` rows.
+ */
+template <typename T, typename IdxT>
+struct subset_results_op {
+  const int64_t* ids;
+  const int64_t* subset_neighbors;
+  const T* subset_distances;
+  int64_t subset_k;
+  int64_t k;
+  T pad_distance;
+  IdxT* neighbors;
+  T* distances;
+
+  HDI void operator()(int64_t i) const
+  {
+    const int64_t q = i / k;
+    const int64_t j = i % k;
+    if (j < subset_k) {
+      neighbors[i] = static_cast<IdxT>(ids[subset_neighbors[q * subset_k + j]]);
+      distances[i] = subset_distances[q * subset_k + j];
+    } else {
+      neighbors[i] = std::numeric_limits<IdxT>::max();
+      distances[i] = pad_distance;
+    }
+  }
+};
+
+/**
+ * Exact search over the rows of the index passing a bitset filter.
+ *
+ * The ids of the rows passing the filter are compacted with a rank/select over the bitset, and the
+ * rows and their norms are gathered, so that the distances are computed for these rows only: the
+ * cost scales with the number of rows passing the filter rather than with the size of the index.
+ */
+template <typename T, typename IdxT>
+void brute_force_search_prefiltered(
+  raft::resources const& res,
+  const raft::neighbors::brute_force::index<T>& idx,
+  raft::device_matrix_view<const T, int64_t, row_major> queries,
+  raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+  raft::device_matrix_view<T, int64_t, row_major> distances,
+  raft::core::bitset_view<const uint32_t, int64_t> filter)
+{
+  RAFT_EXPECTS(neighbors.extent(1) == distances.extent(1), "Value of k must match for outputs");
+  RAFT_EXPECTS(idx.dataset().extent(1) == queries.extent(1),
+               "Number of columns in queries must match brute force index");
+  RAFT_EXPECTS(filter.size() == idx.size(), "The filter must have one bit per row of the index");
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "brute_force::search_prefiltered(%zu queries)", static_cast<size_t>(queries.extent(0)));
+
+  auto stream             = resource::get_cuda_stream(res);
+  const int64_t n_rows    = idx.size();
+  const int64_t n_queries = queries.extent(0);
+  const int64_t dim       = idx.dim();
+  const int64_t k         = neighbors.extent(1);
+
+  // Select the rows passing the filter: count them first, then write their ids.
+  auto offsets =
+    raft::make_device_vector<int64_t, int64_t>(res, raft::ceildiv<int64_t>(n_rows, 32) + 1);
+  auto n_pass_dev = raft::make_device_scalar<int64_t>(res, 0);
+  raft::core::detail::bitset_select(res,
+                                    filter.data(),
+                                    n_rows,
+                                    offsets.data_handle(),
+                                    static_cast<int64_t*>(nullptr),
+                                    int64_t(0),
+                                    n_pass_dev.data_handle());
+  int64_t n_pass = 0;
+  raft::copy(&n_pass, n_pass_dev.data_handle(), 1, stream);
+  resource::sync_stream(res);
+  auto ids = raft::make_device_vector<int64_t, int64_t>(res, n_pass);
+  raft::core::detail::bitset_select(res,
+                                    filter.data(),
+                                    n_rows,
+                                    offsets.data_handle(),
+                                    ids.data_handle(),
+                                    n_pass,
+                                    n_pass_dev.data_handle());
+
+  const int64_t subset_k = std::min(k, n_pass);
+  auto subset_neighbors  = raft::make_device_matrix<int64_t, int64_t>(res, n_queries, subset_k);
+  auto subset_distances  = raft::make_device_matrix<T, int64_t>(res, n_queries, subset_k);
+  if (subset_k > 0) {
+    auto subset = raft::make_device_matrix<T, int64_t>(res, n_pass, dim);
+    raft::matrix::gather(res, idx.dataset(), raft::make_const_mdspan(ids.view()), subset.view());
+    auto subset_norms = raft::make_device_vector<T, int64_t>(res, idx.has_norms() ? n_pass : 0);
+    std::vector<T*> norms;
+    if (idx.has_norms()) {
+      raft::linalg::map_offset(res,
+                               subset_norms.view(),
+                               gather_norms_op<T>{idx.norms().data_handle(), ids.data_handle()});
+      norms.push_back(subset_norms.data_handle());
+    }
+    std::vector<T*> dataset    = {subset.data_handle()};
+    std::vector<int64_t> sizes = {n_pass};
+    brute_force_knn_impl<int64_t, int64_t, T>(res,
+                                              dataset,
+                                              sizes,
+                                              dim,
+                                              const_cast<T*>(queries.data_handle()),
+                                              n_queries,
+                                              subset_neighbors.data_handle(),
+                                              subset_distances.data_handle(),
+                                              subset_k,
+                                              true,
+                                              true,
+                                              nullptr,
+                                              idx.metric(),
+                                              idx.metric_arg(),
+                                              raft::identity_op(),
+                                              norms.size() ? &norms : nullptr);
+  }
+
+  const T pad_distance = raft::distance::is_min_close(idx.metric())
+                           ? std::numeric_limits<T>::max()
+                           : std::numeric_limits<T>::lowest();
+  thrust::for_each_n(resource::get_thrust_policy(res),
+                     thrust::make_counting_iterator<int64_t>(0),
+                     n_queries * k,
+                     subset_results_op<T, IdxT>{ids.data_handle(),
+                                                subset_neighbors.data_handle(),
+                                                subset_distances.data_handle(),
+                                                subset_k,
+                                                k,
+                                                pad_distance,
+                                                neighbors.data_handle(),
+                                                distances.data_handle()});
+}
+
+/** The squared value of a half-precision element, in fp32. */
+struct half_sq_op {
+  template <typename IdxT>
+  _RAFT_DEVICE auto operator()(half x, IdxT) const -> float
+  {
+    const float f = __half2float(x);
+    return f * f;
+  }
+};
+
+/** The fp32 squared L2 norms (or the L2 norms if `sqrt`) of the rows of a half-precision matrix. */
+inline void half_row_norms(raft::resources const& res,
+                           const half* data,
+                           int64_t n_rows,
+                           int64_t dim,
+                           float* norms,
+                           bool sqrt)
+{
+  auto stream = resource::get_cuda_stream(res);
+  if (sqrt) {
+    raft::linalg::reduce<half, float, int64_t>(norms,
+                                               data,
+                                               dim,
+                                               n_rows,
+                                               0.0f,
+                                               true,
+                                               true,
+                                               stream,
+                                               false,
+                                               half_sq_op{},
+                                               raft::add_op{},
+                                               raft::sqrt_op{});
+  } else {
+    raft::linalg::reduce<half, float, int64_t>(
+      norms, data, dim, n_rows, 0.0f, true, true, stream, false, half_sq_op{});
+  }
+}
+
+/** Turn the inner products of a tile into distances. */
+struct half_tile_distance_op {
+  const float* products;     // [n_tile_rows, n_tile_cols]
+  const float* query_norms;  // [n_tile_rows], or nullptr for the inner product
+  const float* index_norms;  // [n_tile_cols], or nullptr for the inner product
+  int64_t n_tile_cols;
+  raft::distance::DistanceType metric;
+
+  _RAFT_DEVICE auto operator()(int64_t i) const -> float
+  {
+    const float ip = products[i];
+    if (metric == raft::distance::DistanceType::InnerProduct) { return ip; }
+    const float qn = query_norms[i / n_tile_cols];
+    const float xn = index_norms[i % n_tile_cols];
+    if (metric == raft::distance::DistanceType::CosineExpanded) { return 1.0f - ip / (qn * xn); }
+    const float d = raft::max(qn + xn - 2.0f * ip, 0.0f);
+    return metric == raft::distance::DistanceType::L2SqrtExpanded ? raft::sqrt(d) : d;
+  }
+};
+
+/**
+ * Brute-force search of a half-precision index.
+ *
+ * The inner products are computed by cuBLASLt tiles with fp16 inputs and fp32 accumulation, which
+ * uses the tensor cores; the norms and distances are fp32.
+ */
+template <typename IdxT>
+void brute_force_search_half(
+  raft::resources const& res,
+  const raft::neighbors::brute_force::index<half>& idx,
+  raft::device_matrix_view<const half, int64_t, row_major> queries,
+  raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances,
+  std::optional<raft::device_vector_view<const float, int64_t>> query_norms = std::nullopt)
+{
+  RAFT_EXPECTS(neighbors.extent(1) == distances.extent(1), "Value of k must match for outputs");
+  RAFT_EXPECTS(idx.dataset().extent(1) == queries.extent(1),
+               "Number of columns in queries must match brute force index");
+  const auto metric = idx.metric();
+  RAFT_EXPECTS(metric == raft::distance::DistanceType::L2Expanded ||
+                 metric == raft::distance::DistanceType::L2SqrtExpanded ||
+                 metric == raft::distance::DistanceType::InnerProduct ||
+                 metric == raft::distance::DistanceType::CosineExpanded,
+               "A half-precision brute force index supports only the L2Expanded, L2SqrtExpanded, "
+               "InnerProduct and CosineExpanded metrics");
+
+  const int64_t n_queries = queries.extent(0);
+  const int64_t n_rows    = idx.size();
+  const int64_t dim       = idx.dim();
+  const int64_t k         = neighbors.extent(1);
+  RAFT_EXPECTS(
+    k <= n_rows, "k (%zu) must not exceed the index size (%zu)", size_t(k), size_t(n_rows));
+  auto stream = resource::get_cuda_stream(res);
+  auto mr     = resource::get_workspace_resource(res);
+
+  // The norms are fp32, computed once for the whole input.
+  const bool use_norms  = metric != raft::distance::DistanceType::InnerProduct;
+  const bool sqrt_norms = metric == raft::distance::DistanceType::CosineExpanded;
+  rmm::device_uvector<float> index_norms_buf(0, stream, mr);
+  rmm::device_uvector<float> query_norms_buf(0, stream, mr);
+  const float* index_norms = nullptr;
+  const float* q_norms     = nullptr;
+  if (use_norms) {
+    if (idx.has_norms()) {
+      index_norms = idx.norms().data_handle();
+    } else {
+      index_norms_buf.resize(n_rows, stream);
+      half_row_norms(
+        res, idx.dataset().data_handle(), n_rows, dim, index_norms_buf.data(), sqrt_norms);
+      index_norms = index_norms_buf.data();
+    }
+    if (query_norms) {
+      q_norms = query_norms->data_handle();
+    } else {
+      query_norms_buf.resize(n_queries, stream);
+      half_row_norms(
+        res, queries.data_handle(), n_queries, dim, query_norms_buf.data(), sqrt_norms);
+      q_norms = query_norms_buf.data();
+    }
+  }
+
+  size_t tile_rows = 0;
+  size_t tile_cols = 0;
+  faiss_select::chooseTileSize(n_queries,
+                               n_rows,
+                               dim,
+                               sizeof(float),
+                               rmm::available_device_memory().second,
+                               tile_rows,
+                               tile_cols);
+  tile_cols = std::min<size_t>(std::max<size_t>(tile_cols, k), n_rows);
+  const int64_t n_col_tiles   = raft::div_rounding_up_safe<int64_t>(n_rows, tile_cols);
+  const int64_t temp_out_cols = n_col_tiles * k;
+  const bool select_min       = raft::distance::is_min_close(metric);
+
+  rmm::device_uvector<float> products(tile_rows * tile_cols, stream, mr);
+  rmm::device_uvector<float> tile_distances(n_col_tiles > 1 ? tile_rows * k : 0, stream, mr);
+  rmm::device_uvector<IdxT> tile_indices(n_col_tiles > 1 ? tile_rows * k : 0, stream, mr);
+  rmm::device_uvector<float> temp_out_distances(
+    n_col_tiles > 1 ? tile_rows * temp_out_cols : 0, stream, mr);
+  rmm::device_uvector<IdxT> temp_out_indices(
+    n_col_tiles > 1 ? tile_rows * temp_out_cols : 0, stream, mr);
+  const float alpha = 1.0f;
+  const float beta  = 0.0f;
+
+  for (int64_t i = 0; i < n_queries; i += tile_rows) {
+    const int64_t n_tile_rows = std::min<int64_t>(tile_rows, n_queries - i);
+    if (n_col_tiles > 1) {
+      // The last column tile can have fewer than k candidates: pad with the worst distance.
+      raft::matrix::fill(
+        res,
+        raft::make_device_vector_view(temp_out_distances.data(), n_tile_rows * temp_out_cols),
+        select_min ? std::numeric_limits<float>::max() : std::numeric_limits<float>::lowest());
+    }
+    for (int64_t j = 0; j < n_rows; j += tile_cols) {
+      const int64_t n_tile_cols = std::min<int64_t>(tile_cols, n_rows - j);
+      const int64_t tile_k      = std::min<int64_t>(k, n_tile_cols);
+      // products[n_tile_rows, n_tile_cols] = queries[i:] * dataset[j:]^T (in cuBLAS column-major
+      // terms: [n_tile_cols, n_tile_rows] = dataset^T (op) * queries)
+      raft::linalg::detail::matmul<false, float, half, half, float>(
+        res,
+        true,
+        false,
+        n_tile_cols,
+        n_tile_rows,
+        dim,
+        &alpha,
+        idx.dataset().data_handle() + j * dim,
+        dim,
+        queries.data_handle() + i * dim,
+        dim,
+        &beta,
+        products.data(),
+        n_tile_cols);
+      raft::linalg::map_offset(
+        res,
+        raft::make_device_vector_view(products.data(), n_tile_rows * n_tile_cols),
+        half_tile_distance_op{products.data(),
+                              use_norms ? q_norms + i : nullptr,
+                              use_norms ? index_norms + j : nullptr,
+                              n_tile_cols,
+                              metric});
+
+      auto* out_dists = n_col_tiles > 1 ? tile_distances.data() : distances.data_handle() + i * k;
+      auto* out_inds  = n_col_tiles > 1 ? tile_indices.data() : neighbors.data_handle() + i * k;
+      matrix::select_k<float, IdxT>(
+        res,
+        raft::make_device_matrix_view<const float, int64_t, row_major>(
+          products.data(), n_tile_rows, n_tile_cols),
+        std::nullopt,
+        raft::make_device_matrix_view<float, int64_t, row_major>(out_dists, n_tile_rows, tile_k),
+        raft::make_device_matrix_view<IdxT, int64_t, row_major>(out_inds, n_tile_rows, tile_k),
+        select_min,
+        true);
+      if (n_col_tiles > 1) {
+        // Move the tile top-k to its slot of the row and make the indices global.
+        const int64_t slot    = (j / tile_cols) * k;
+        auto* temp_out_dists  = temp_out_distances.data();
+        auto* temp_out_inds   = temp_out_indices.data();
+        const auto* tile_dist = tile_distances.data();
+        const auto* tile_inds = tile_indices.data();
+        thrust::for_each(resource::get_thrust_policy(res),
+                         thrust::make_counting_iterator<int64_t>(0),
+                         thrust::make_counting_iterator<int64_t>(n_tile_rows * tile_k),
+                         [=] __device__(int64_t x) {
+                           const int64_t row  = x / tile_k;
+                           const int64_t col  = x % tile_k;
+                           const int64_t out  = row * temp_out_cols + slot + col;
+                           temp_out_dists[out] = tile_dist[x];
+                           temp_out_inds[out]  = tile_inds[x] + static_cast<IdxT>(j);
+                         });
+      }
+    }
+    if (n_col_tiles > 1) {
+      matrix::select_k<float, IdxT>(
+        res,
+        raft::make_device_matrix_view<const float, int64_t, row_major>(
+          temp_out_distances.data(), n_tile_rows, temp_out_cols),
+        raft::make_device_matrix_view<const IdxT, int64_t, row_major>(
+          temp_out_indices.data(), n_tile_rows, temp_out_cols),
+        raft::make_device_matrix_view<float, int64_t, row_major>(
+          distances.data_handle() + i * k, n_tile_rows, k),
+        raft::make_device_matrix_view<IdxT, int64_t, row_major>(
+          neighbors.data_handle() + i * k, n_tile_rows, k),
+        select_min,
+        true);
+    }
+  }
+}
+
 }  // namespace raft::neighbors::detail
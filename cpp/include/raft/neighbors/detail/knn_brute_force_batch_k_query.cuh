@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -15,12 +15,43 @@
  */
 #pragma once
 
+#include <raft/core/device_mdarray.hpp>
+#include <raft/distance/distance_types.hpp>
 #include <raft/linalg/norm.cuh>
+#include <raft/matrix/select_k.cuh>
 #include <raft/matrix/slice.cuh>
 #include <raft/neighbors/brute_force_types.hpp>
 #include <raft/neighbors/detail/knn_brute_force.cuh>
 
+#include <rmm/cuda_device.hpp>
+
+#include <optional>
+#include <vector>
+
 namespace raft::neighbors::brute_force::detail {
+
+/** A distance epilogue that stores every tile distance into a [n_queries, n_rows] cache. */
+template <typename T>
+struct cache_distances_op {
+  T* cache;
+  int64_t n_rows;
+
+  template <typename IdxT>
+  _RAFT_DEVICE auto operator()(T val, IdxT row, IdxT col) const -> T
+  {
+    cache[static_cast<int64_t>(row) * n_rows + static_cast<int64_t>(col)] = val;
+    return val;
+  }
+};
+
+/**
+ * The batched k-query over a brute force index.
+ *
+ * The first page of neighbors is searched directly. When the consumer asks for neighbors beyond
+ * the loaded pages, the re-query also keeps all the distances between the queries and the
+ * dataset (as long as they fit in a quarter of the free device memory), so that every later
+ * page is served by a selection over these cached distances instead of a new search.
+ */
 template <typename T, typename IdxT = int64_t>
 class gpu_batch_k_query : public batch_k_query<T, IdxT> {
  public:
@@ -34,6 +65,11 @@ class gpu_batch_k_query : public batch_k_query<T, IdxT> {
   {
     auto metric = index.metric();
 
+    // haversine doesn't go through the tiled distances, so it can't fill the cache
+    auto cache_bytes = static_cast<size_t>(index.size()) * query.extent(0) * sizeof(T);
+    use_cache        = cache_bytes <= rmm::available_device_memory().first / 4;
+    if (metric == raft::distance::DistanceType::Haversine) { use_cache = false; }
+
     // precompute query norms, and re-use across batches
     if (metric == raft::distance::DistanceType::L2Expanded ||
         metric == raft::distance::DistanceType::L2SqrtExpanded ||
@@ -67,11 +103,54 @@ class gpu_batch_k_query : public batch_k_query<T, IdxT> {
     int64_t batch_size = std::min(std::max(offset * 2, next_batch_size * 2), this->index_size);
     output->resize(this->res, this->query_size, batch_size);
 
-    std::optional<raft::device_vector_view<const float, int64_t>> query_norms_view;
-    if (query_norms) { query_norms_view = query_norms->view(); }
+    if (distance_cache) {
+      matrix::select_k<T, IdxT>(this->res,
+                                raft::make_const_mdspan(distance_cache->view()),
+                                std::nullopt,
+                                output->distances(),
+                                output->indices(),
+                                raft::distance::is_min_close(index.metric()),
+                                true);
+      return;
+    }
 
-    raft::neighbors::detail::brute_force_search<T, IdxT>(
-      this->res, index, query, output->indices(), output->distances(), query_norms_view);
+    if (offset == 0 || !use_cache) {
+      std::optional<raft::device_vector_view<const T, int64_t>> query_norms_view;
+      if (query_norms) { query_norms_view = query_norms->view(); }
+
+      raft::neighbors::detail::brute_force_search<T, IdxT>(
+        this->res, index, query, output->indices(), output->distances(), query_norms_view);
+      return;
+    }
+
+    // the consumer asked for more neighbors than the first page: search again, and keep the
+    // distances of the search so that the following pages don't need to recompute them
+    distance_cache.emplace(
+      raft::make_device_matrix<T, int64_t>(this->res, this->query_size, this->index_size));
+
+    std::vector<T*> dataset    = {const_cast<T*>(index.dataset().data_handle())};
+    std::vector<int64_t> sizes = {index.dataset().extent(0)};
+    std::vector<T*> norms;
+    if (index.has_norms()) { norms.push_back(const_cast<T*>(index.norms().data_handle())); }
+
+    raft::neighbors::detail::brute_force_knn_impl<int64_t, IdxT, T>(
+      this->res,
+      dataset,
+      sizes,
+      index.dataset().extent(1),
+      const_cast<T*>(query.data_handle()),
+      this->query_size,
+      output->indices().data_handle(),
+      output->distances().data_handle(),
+      batch_size,
+      true,
+      true,
+      nullptr,
+      index.metric(),
+      index.metric_arg(),
+      cache_distances_op<T>{distance_cache->data_handle(), this->index_size},
+      norms.size() ? &norms : nullptr,
+      query_norms ? query_norms->data_handle() : nullptr);
   };
 
   void slice_batch(const batch<T, IdxT>& input,
@@ -94,5 +173,9 @@ class gpu_batch_k_query : public batch_k_query<T, IdxT> {
   const raft::neighbors::brute_force::index<T>& index;
   raft::device_matrix_view<const T, int64_t, row_major> query;
   std::optional<device_vector<T, int64_t>> query_norms;
+
+  // whether the distances may be cached, and the cached distances [n_queries, index.size()]
+  bool use_cache;
+  mutable std::optional<device_matrix<T, int64_t>> distance_cache;
 };
 }  // namespace raft::neighbors::brute_force::detail
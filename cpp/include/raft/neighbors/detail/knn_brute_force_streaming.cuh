@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/pinned_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/linalg/norm.cuh>
+#include <raft/linalg/unary_op.cuh>
+#include <raft/neighbors/detail/knn_brute_force.cuh>
+#include <raft/neighbors/detail/knn_merge_parts.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace raft::neighbors::detail {
+
+/** A CUDA event without timing, destroyed with the scope. */
+class streaming_event {
+ public:
+  streaming_event() { RAFT_CUDA_TRY(cudaEventCreateWithFlags(&e_, cudaEventDisableTiming)); }
+  ~streaming_event() { RAFT_CUDA_TRY_NO_THROW(cudaEventDestroy(e_)); }
+  streaming_event(const streaming_event&)                    = delete;
+  auto operator=(const streaming_event&) -> streaming_event& = delete;
+
+  void record(cudaStream_t stream) { RAFT_CUDA_TRY(cudaEventRecord(e_, stream)); }
+  void wait_by(cudaStream_t stream) { RAFT_CUDA_TRY(cudaStreamWaitEvent(stream, e_, 0u)); }
+  void sync() { RAFT_CUDA_TRY(cudaEventSynchronize(e_)); }
+
+ private:
+  cudaEvent_t e_;
+};
+
+/**
+ * Exact kNN over a host-resident dataset, streamed to the device in chunks.
+ *
+ * Every chunk is copied from the (pageable) dataset to a pinned staging buffer, and from there to
+ * the device on a side stream, while the main stream searches the previous chunk (two staging and
+ * two device buffers). The top-k of every chunk is merged with the running top-k by
+ * `knn_merge_parts`.
+ */
+template <typename T, typename IdxT>
+void brute_force_search_streaming(raft::resources const& res,
+                                  raft::host_matrix_view<const T, int64_t, row_major> dataset,
+                                  raft::device_matrix_view<const T, int64_t, row_major> queries,
+                                  raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,
+                                  raft::device_matrix_view<T, int64_t, row_major> distances,
+                                  raft::distance::DistanceType metric,
+                                  T metric_arg,
+                                  int64_t chunk_rows)
+{
+  const int64_t n_rows    = dataset.extent(0);
+  const int64_t dim       = dataset.extent(1);
+  const int64_t n_queries = queries.extent(0);
+  const int64_t k         = neighbors.extent(1);
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "brute_force::search_streaming(%zu rows, %zu queries, k = %zu)",
+    size_t(n_rows),
+    size_t(n_queries),
+    size_t(k));
+  RAFT_EXPECTS(distances.extent(1) == k, "Value of k must match for outputs");
+  RAFT_EXPECTS(queries.extent(1) == dim, "Number of columns in queries must match the dataset");
+  RAFT_EXPECTS(k <= n_rows, "k must not exceed the number of rows of the dataset");
+
+  auto stream      = resource::get_cuda_stream(res);
+  auto copy_stream = resource::get_next_usable_stream(res);
+  if (chunk_rows <= 0) {
+    // Two device buffers take up to a quarter of the free memory, leaving the rest to the tiles.
+    const size_t free_mem = rmm::available_device_memory().first;
+    chunk_rows            = static_cast<int64_t>(free_mem / 8 / (dim * sizeof(T)));
+  }
+  chunk_rows = std::clamp<int64_t>(chunk_rows, k, n_rows);
+  // A tail shorter than k is appended to the previous chunk, so that every chunk has k results.
+  int64_t n_chunks = raft::div_rounding_up_safe<int64_t>(n_rows, chunk_rows);
+  if (n_chunks > 1 && n_rows - (n_chunks - 1) * chunk_rows < k) { n_chunks--; }
+  const int64_t last_chunk = n_rows - (n_chunks - 1) * chunk_rows;
+  const int64_t max_chunk  = std::max(chunk_rows, last_chunk);
+  auto chunk_begin         = [chunk_rows](int64_t c) { return c * chunk_rows; };
+  auto chunk_size          = [=](int64_t c) { return c + 1 < n_chunks ? chunk_rows : last_chunk; };
+
+  // The query norms are the same for all chunks.
+  rmm::device_uvector<T> query_norms(0, stream);
+  if (metric == raft::distance::DistanceType::L2Expanded ||
+      metric == raft::distance::DistanceType::L2SqrtExpanded ||
+      metric == raft::distance::DistanceType::CosineExpanded) {
+    query_norms.resize(n_queries, stream);
+    if (metric == raft::distance::DistanceType::CosineExpanded) {
+      raft::linalg::rowNorm(query_norms.data(),
+                            queries.data_handle(),
+                            dim,
+                            n_queries,
+                            raft::linalg::NormType::L2Norm,
+                            true,
+                            stream,
+                            raft::sqrt_op{});
+    } else {
+      raft::linalg::rowNorm(query_norms.data(),
+                            queries.data_handle(),
+                            dim,
+                            n_queries,
+                            raft::linalg::NormType::L2Norm,
+                            true,
+                            stream);
+    }
+  }
+
+  std::array<raft::pinned_matrix<T, int64_t>, 2> staging{
+    raft::make_pinned_matrix<T, int64_t>(res, max_chunk, dim),
+    raft::make_pinned_matrix<T, int64_t>(res, n_chunks > 1 ? max_chunk : 0, dim)};
+  std::array<raft::device_matrix<T, int64_t>, 2> chunks{
+    raft::make_device_matrix<T, int64_t>(res, max_chunk, dim),
+    raft::make_device_matrix<T, int64_t>(res, n_chunks > 1 ? max_chunk : 0, dim)};
+  std::array<streaming_event, 2> copied;
+  std::array<streaming_event, 2> searched;
+
+  // knn_merge_parts input: part 0 is the running top-k, part 1 the top-k of the current chunk.
+  const size_t part_size = n_queries * k;
+  rmm::device_uvector<T> merge_dists(n_chunks > 1 ? 2 * part_size : 0, stream);
+  rmm::device_uvector<IdxT> merge_inds(n_chunks > 1 ? 2 * part_size : 0, stream);
+  // The id offsets of the two parts of every merge: {0, first row of the chunk}.
+  std::vector<IdxT> offsets(2 * n_chunks, 0);
+  for (int64_t c = 0; c < n_chunks; c++) {
+    offsets[2 * c + 1] = static_cast<IdxT>(chunk_begin(c));
+  }
+  rmm::device_uvector<IdxT> translations(offsets.size(), stream);
+  raft::update_device(translations.data(), offsets.data(), offsets.size(), stream);
+  // knn_merge_parts selects the smallest values.
+  const bool negate = !raft::distance::is_min_close(metric);
+
+  auto upload = [&](int64_t c) {
+    const int b = c % 2;
+    // The copy of chunk c - 2 is done with the staging buffer; its search, with the device buffer.
+    copied[b].sync();
+    const size_t size = chunk_size(c) * dim;
+    std::memcpy(staging[b].data_handle(),
+                dataset.data_handle() + chunk_begin(c) * dim,
+                size * sizeof(T));
+    searched[b].wait_by(copy_stream);
+    raft::copy(chunks[b].data_handle(), staging[b].data_handle(), size, copy_stream);
+    copied[b].record(copy_stream);
+  };
+
+  upload(0);
+  for (int64_t c = 0; c < n_chunks; c++) {
+    const int b = c % 2;
+    copied[b].wait_by(stream);
+    auto* out_dists = c == 0 ? distances.data_handle() : merge_dists.data() + part_size;
+    auto* out_inds  = c == 0 ? neighbors.data_handle() : merge_inds.data() + part_size;
+    tiled_brute_force_knn<T, IdxT>(res,
+                                   queries.data_handle(),
+                                   chunks[b].data_handle(),
+                                   n_queries,
+                                   chunk_size(c),
+                                   dim,
+                                   k,
+                                   out_dists,
+                                   out_inds,
+                                   metric,
+                                   metric_arg,
+                                   0,
+                                   0,
+                                   raft::identity_op{},
+                                   nullptr,
+                                   query_norms.size() ? query_norms.data() : nullptr);
+    searched[b].record(stream);
+
+    if (c > 0) {
+      raft::copy(merge_dists.data(), distances.data_handle(), part_size, stream);
+      raft::copy(merge_inds.data(), neighbors.data_handle(), part_size, stream);
+      if (negate) {
+        raft::linalg::unaryOp(merge_dists.data(),
+                              merge_dists.data(),
+                              2 * part_size,
+                              raft::mul_const_op<T>(-1),
+                              stream);
+      }
+      knn_merge_parts(res,
+                      merge_dists.data(),
+                      merge_inds.data(),
+                      distances.data_handle(),
+                      neighbors.data_handle(),
+                      n_queries,
+                      2,
+                      k,
+                      translations.data() + 2 * c);
+      if (negate) {
+        raft::linalg::unaryOp(distances.data_handle(),
+                              distances.data_handle(),
+                              part_size,
+                              raft::mul_const_op<T>(-1),
+                              stream);
+      }
+    }
+    // Stage the next chunk while this one is searched.
+    if (c + 1 < n_chunks) { upload(c + 1); }
+  }
+  // The staging buffers are released with the scope: wait for the last copy.
+  copied[(n_chunks - 1) % 2].sync();
+}
+
+}  // namespace raft::neighbors::detail
@@ -16,8 +16,15 @@
 
 #pragma once
 
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/matrix/detail/select_k.cuh>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
 
 #include <cstdint>
 #include <raft/neighbors/detail/faiss_select/DistanceUtils.h>
@@ -72,7 +79,7 @@ RAFT_KERNEL knn_merge_parts_kernel(const value_t* inK,
   value_idx translation = 0;
 
   for (; i < limit; i += tpb) {
-    translation = translations[part];
+    translation = translations == nullptr ? 0 : translations[part];
     heap.add(*inKStart, (*inVStart) + translation);
 
     part    = (i + tpb) / k;
@@ -86,7 +93,7 @@ RAFT_KERNEL knn_merge_parts_kernel(const value_t* inK,
 
   // Handle last remainder fraction of a warp of elements
   if (i < total_k) {
-    translation = translations[part];
+    translation = translations == nullptr ? 0 : translations[part];
     heap.addThreadQ(*inKStart, (*inVStart) + translation);
   }
 
@@ -122,10 +129,85 @@ inline void knn_merge_parts_impl(const value_t* inK,
   RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
 
+/**
+ * Gather the parts [n_parts, n_samples, k] into the rows [n_samples, n_parts * k] of a single
+ * selection problem, translating the indices of every part.
+ */
+template <typename value_idx, typename value_t>
+RAFT_KERNEL knn_merge_parts_gather_kernel(const value_t* inK,
+                                          const value_idx* inV,
+                                          value_t* outK,
+                                          value_idx* outV,
+                                          size_t n_samples,
+                                          int n_parts,
+                                          int k,
+                                          const value_idx* translations)
+{
+  const size_t len = static_cast<size_t>(n_parts) * k;
+  const size_t i   = static_cast<size_t>(blockIdx.x) * blockDim.x + threadIdx.x;
+  if (i >= n_samples * len) { return; }
+  const size_t row  = i / len;
+  const size_t col  = i % len;
+  const size_t part = col / k;
+  const size_t src  = (part * n_samples + row) * k + col % k;
+  outK[i]           = inK[src];
+  outV[i]           = translations == nullptr ? inV[src] : inV[src] + translations[part];
+}
+
+/**
+ * Merge the parts as a single `select_k` over the rows [n_samples, n_parts * k], which picks the
+ * radix or warp-sort selection depending on the size of the problem (see `knn_merge_parts`).
+ */
+template <typename value_idx = std::int64_t, typename value_t = float>
+inline void knn_merge_parts_select_k(raft::resources const& res,
+                                     const value_t* inK,
+                                     const value_idx* inV,
+                                     value_t* outK,
+                                     value_idx* outV,
+                                     size_t n_samples,
+                                     int n_parts,
+                                     int k,
+                                     const value_idx* translations)
+{
+  auto stream      = resource::get_cuda_stream(res);
+  auto* mr         = resource::get_workspace_resource(res);
+  const size_t len = static_cast<size_t>(n_parts) * k;
+  rmm::device_uvector<value_t> keys(n_samples * len, stream, mr);
+  rmm::device_uvector<value_idx> values(n_samples * len, stream, mr);
+
+  constexpr int kBlockSize = 256;
+  const dim3 grid(raft::ceildiv<size_t>(n_samples * len, kBlockSize));
+  knn_merge_parts_gather_kernel<value_idx, value_t><<<grid, kBlockSize, 0, stream>>>(
+    inK, inV, keys.data(), values.data(), n_samples, n_parts, k, translations);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+  matrix::detail::select_k<value_t, value_idx>(res,
+                                               keys.data(),
+                                               values.data(),
+                                               n_samples,
+                                               len,
+                                               k,
+                                               outK,
+                                               outV,
+                                               true,  // select_min
+                                               mr,
+                                               true);  // sorted
+}
+
+/**
+ * The number of parts from which the merge runs as a single `select_k` rather than a block select
+ * per row: the block select scans all `n_parts * k` candidates of a row with a single CTA.
+ */
+constexpr int kKnnMergePartsSelectKMinParts = 64;
+
 /**
  * @brief Merge knn distances and index matrix, which have been partitioned
  * by row, into a single matrix with only the k-nearest neighbors.
  *
+ * Up to `k = 1024` and fewer than `kKnnMergePartsSelectKMinParts` parts, every row is merged by a
+ * block select; otherwise, the parts are gathered into a single `select_k` problem.
+ *
+ * @param res raft resources
  * @param inK partitioned knn distance matrix
  * @param inV partitioned knn index matrix
  * @param outK merged knn distance matrix
@@ -133,20 +215,24 @@ inline void knn_merge_parts_impl(const value_t* inK,
  * @param n_samples number of samples per partition
  * @param n_parts number of partitions
  * @param k number of neighbors per partition (also number of merged neighbors)
- * @param stream CUDA stream to use
- * @param translations mapping of index offsets for each partition
+ * @param translations (optional) mapping of index offsets for each partition
  */
 template <typename value_idx = std::int64_t, typename value_t = float>
-inline void knn_merge_parts(const value_t* inK,
+inline void knn_merge_parts(raft::resources const& res,
+                            const value_t* inK,
                             const value_idx* inV,
                             value_t* outK,
                             value_idx* outV,
                             size_t n_samples,
                             int n_parts,
                             int k,
-                            cudaStream_t stream,
                             value_idx* translations)
 {
+  if (k > 1024 || n_parts >= kKnnMergePartsSelectKMinParts) {
+    return knn_merge_parts_select_k<value_idx, value_t>(
+      res, inK, inV, outK, outV, n_samples, n_parts, k, translations);
+  }
+  auto stream = resource::get_cuda_stream(res);
   if (k == 1)
     knn_merge_parts_impl<value_idx, value_t, 1, 1>(
       inK, inV, outK, outV, n_samples, n_parts, k, stream, translations);
@@ -165,8 +251,39 @@ inline void knn_merge_parts(const value_t* inK,
   else if (k <= 512)
     knn_merge_parts_impl<value_idx, value_t, 512, 8>(
       inK, inV, outK, outV, n_samples, n_parts, k, stream, translations);
-  else if (k <= 1024)
+  else
     knn_merge_parts_impl<value_idx, value_t, 1024, 8>(
       inK, inV, outK, outV, n_samples, n_parts, k, stream, translations);
 }
+
+/**
+ * @brief Merge knn distances and index matrix, which have been partitioned
+ * by row, into a single matrix with only the k-nearest neighbors.
+ *
+ * @param inK partitioned knn distance matrix
+ * @param inV partitioned knn index matrix
+ * @param outK merged knn distance matrix
+ * @param outV merged knn index matrix
+ * @param n_samples number of samples per partition
+ * @param n_parts number of partitions
+ * @param k number of neighbors per partition (also number of merged neighbors)
+ * @param stream CUDA stream to use
+ * @param translations mapping of index offsets for each partition
+ */
+template <typename value_idx = std::int64_t, typename value_t = float>
+inline void knn_merge_parts(const value_t* inK,
+                            const value_idx* inV,
+                            value_t* outK,
+                            value_idx* outV,
+                            size_t n_samples,
+                            int n_parts,
+                            int k,
+                            cudaStream_t stream,
+                            value_idx* translations)
+{
+  raft::resources res;
+  resource::set_cuda_stream(res, stream);
+  knn_merge_parts<value_idx, value_t>(
+    res, inK, inV, outK, outV, n_samples, n_parts, k, translations);
+}
 }  // namespace raft::neighbors::detail
@@ -16,15 +16,19 @@
 
 #pragma once
 
+#include <cuda_fp16.h>
 #include <cuda_runtime.h>
 #include <mma.h>
 #include <omp.h>
 
 #include <cub/cub.cuh>
+#include <algorithm>
 #include <limits>
+#include <optional>
 #include <queue>
 
 #include <random>
+#include <type_traits>
 #include <rmm/device_uvector.hpp>
 
 #include <thrust/execution_policy.h>
@@ -38,8 +42,10 @@
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/error.hpp>
 #include <raft/core/host_mdarray.hpp>
+#include <raft/core/resource/cancellation_token.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
+#include <raft/matrix/select_k.cuh>
 #include <raft/neighbors/detail/cagra/device_common.hpp>
 #include <raft/spatial/knn/detail/ann_utils.cuh>
 #include <raft/util/arch.cuh>  // raft::util::arch::SM_*
@@ -217,6 +223,11 @@ struct BuildConfig {
   // If internal_node_degree == 0, the value of node_degree will be assigned to it
   size_t max_iterations{50};
   float termination_threshold{0.0001};
+  // The number of neighbors the recall is estimated on (if 0, node_degree)
+  size_t output_graph_degree{0};
+  // If positive, stop as soon as the recall estimated on recall_sample_size rows reaches it
+  float target_recall{0};
+  size_t recall_sample_size{1000};
 };
 
 template <typename Index_t>
@@ -338,6 +349,17 @@ struct GnndGraph {
   ~GnndGraph();
 };
 
+/**
+ * The type of the copy of the dataset used by the local join: the 8-bit integers are kept as they
+ * are (at half the footprint and load traffic of fp16; they are converted exactly to fp16 when
+ * staged in the shared memory), everything else is converted to fp16.
+ */
+template <typename Data_t>
+using device_data_t =
+  std::conditional_t<std::is_same_v<Data_t, int8_t> || std::is_same_v<Data_t, uint8_t>,
+                     Data_t,
+                     __half>;
+
 template <typename Data_t = float, typename Index_t = int>
 class GNND {
  public:
@@ -345,7 +367,10 @@ class GNND {
   GNND(const GNND&)            = delete;
   GNND& operator=(const GNND&) = delete;
 
-  void build(Data_t* data, const Index_t nrow, Index_t* output_graph);
+  void build(Data_t* data,
+             const Index_t nrow,
+             Index_t* output_graph,
+             DistData_t* output_distances = nullptr);
   ~GNND()    = default;
   using ID_t = InternalID_t<Index_t>;
 
@@ -356,6 +381,13 @@ class GNND {
                          int2* list_sizes,
                          cudaStream_t stream = 0);
   void local_join(cudaStream_t stream = 0);
+  void compute_recall_ground_truth();
+  auto estimate_recall() -> double;
+  auto recall_k() const -> size_t
+  {
+    return build_config_.output_graph_degree ? build_config_.output_graph_degree
+                                             : build_config_.node_degree;
+  }
 
   raft::resources const& res;
 
@@ -366,7 +398,7 @@ class GNND {
   size_t nrow_;
   size_t ndim_;
 
-  raft::device_matrix<__half, size_t, raft::row_major> d_data_;
+  raft::device_matrix<device_data_t<std::remove_const_t<Data_t>>, size_t, raft::row_major> d_data_;
   raft::device_vector<DistData_t, size_t> l2_norms_;
 
   raft::device_matrix<ID_t, size_t, raft::row_major> graph_buffer_;
@@ -385,6 +417,10 @@ class GNND {
 
   raft::device_vector<int2, size_t> d_list_sizes_new_;
   raft::device_vector<int2, size_t> d_list_sizes_old_;
+
+  // the rows the recall is estimated on and the distance to their k-th exact neighbor
+  std::vector<Index_t> recall_sample_rows_;
+  std::vector<DistData_t> recall_kth_dists_;
 };
 
 constexpr int TILE_ROW_WIDTH = 64;
@@ -400,20 +436,41 @@ constexpr int WMMA_M                    = 16;
 constexpr int WMMA_N                    = 16;
 constexpr int WMMA_K                    = 16;
 
-template <typename Data_t>
-__device__ __forceinline__ void load_vec(Data_t* vec_buffer,
+template <typename Output_t, typename Data_t>
+__device__ __forceinline__ void load_vec(Output_t* vec_buffer,
                                          const Data_t* d_vec,
                                          const int load_dims,
                                          const int padding_dims,
                                          const int lane_id)
 {
-  if constexpr (std::is_same_v<Data_t, float> or std::is_same_v<Data_t, uint8_t> or
-                std::is_same_v<Data_t, int8_t>) {
+  constexpr bool kIsByte = std::is_same_v<Data_t, uint8_t> or std::is_same_v<Data_t, int8_t>;
+  if constexpr (kIsByte && std::is_same_v<Output_t, __half>) {
+    // four 8-bit values per lane, widened to fp16 (exact for 8-bit integers)
+    if ((size_t)d_vec % sizeof(uint32_t) == 0 && (size_t)vec_buffer % sizeof(float2) == 0 &&
+        load_dims % 4 == 0 && padding_dims % 4 == 0) {
+      constexpr int num_load_elems_per_warp = raft::warp_size() * 4;
+      for (int step = 0; step < ceildiv(padding_dims, num_load_elems_per_warp); step++) {
+        int idx_in_vec = step * num_load_elems_per_warp + lane_id * 4;
+        if (idx_in_vec + 4 <= load_dims) {
+          uint32_t packed = *(const uint32_t*)(d_vec + idx_in_vec);
+          Data_t v[4];
+          memcpy(v, &packed, sizeof(packed));
+          __half2* out = (__half2*)(vec_buffer + idx_in_vec);
+          out[0]       = __floats2half2_rn(static_cast<float>(v[0]), static_cast<float>(v[1]));
+          out[1]       = __floats2half2_rn(static_cast<float>(v[2]), static_cast<float>(v[3]));
+        } else if (idx_in_vec + 4 <= padding_dims) {
+          *(float2*)(vec_buffer + idx_in_vec) = float2({0.0f, 0.0f});
+        }
+      }
+      return;
+    }
+  }
+  if constexpr (std::is_same_v<Data_t, float> or kIsByte) {
     constexpr int num_load_elems_per_warp = raft::warp_size();
     for (int step = 0; step < ceildiv(padding_dims, num_load_elems_per_warp); step++) {
       int idx = step * num_load_elems_per_warp + lane_id;
       if (idx < load_dims) {
-        vec_buffer[idx] = d_vec[idx];
+        vec_buffer[idx] = static_cast<float>(d_vec[idx]);
       } else if (idx < padding_dims) {
         vec_buffer[idx] = 0.0f;
       }
@@ -447,10 +504,10 @@ __device__ __forceinline__ void load_vec(Data_t* vec_buffer,
 }
 
 // TODO: Replace with RAFT utilities https://github.com/rapidsai/raft/issues/1827
-/** Calculate L2 norm, and cast data to __half */
-template <typename Data_t>
+/** Calculate L2 norm, and cast data to the type of the local join (device_data_t) */
+template <typename Data_t, typename Output_t>
 RAFT_KERNEL preprocess_data_kernel(const Data_t* input_data,
-                                   __half* output_data,
+                                   Output_t* output_data,
                                    int dim,
                                    DistData_t* l2_norms,
                                    size_t list_offset = 0)
@@ -484,7 +541,7 @@ RAFT_KERNEL preprocess_data_kernel(const Data_t* input_data,
     if (idx < dim) {
       if (l2_norms == nullptr) {
         output_data[list_id * dim + idx] =
-          (float)input_data[(size_t)blockIdx.x * dim + idx] / sqrt(l2_norm);
+          static_cast<Output_t>((float)input_data[(size_t)blockIdx.x * dim + idx] / sqrt(l2_norm));
       } else {
         output_data[list_id * dim + idx] = input_data[(size_t)blockIdx.x * dim + idx];
         if (idx == 0) { l2_norms[list_id] = l2_norm; }
@@ -688,7 +745,7 @@ __device__ __forceinline__ void remove_duplicates(
 // MAX_RESIDENT_THREAD_PER_SM = BLOCK_SIZE * BLOCKS_PER_SM = 2048
 // For architectures 750 and 860 (890), the values for MAX_RESIDENT_THREAD_PER_SM
 // is 1024 and 1536 respectively, which means the bounds don't work anymore
-template <typename Index_t, typename ID_t = InternalID_t<Index_t>>
+template <typename Index_t, typename Data_t, typename ID_t = InternalID_t<Index_t>>
 RAFT_KERNEL
 #ifdef __CUDA_ARCH__
 #if (__CUDA_ARCH__) == 750 || ((__CUDA_ARCH__) >= 860 && (__CUDA_ARCH__) <= 890)
@@ -704,7 +761,7 @@ __launch_bounds__(BLOCK_SIZE, 4)
                     const Index_t* rev_graph_old,
                     const int2* sizes_old,
                     const int width,
-                    const __half* data,
+                    const Data_t* data,
                     const int data_dim,
                     ID_t* graph,
                     DistData_t* dists,
@@ -938,6 +995,52 @@ __launch_bounds__(BLOCK_SIZE, 4)
 #endif
 }
 
+/**
+ * The squared L2 distances between the rows of a sample and a tile of the dataset, with the same
+ * expansion as the local join (one warp per distance); `dists` is [n_samples, dists_ld]. The
+ * distances of a sample row to itself and to the rows past the end of the dataset (in the last
+ * tile) are set to the max.
+ */
+template <typename Data_t, typename Index_t>
+RAFT_KERNEL sample_distances_kernel(const Data_t* data,
+                                    const DistData_t* l2_norms,
+                                    const size_t nrow,
+                                    const int dim,
+                                    const Index_t* sample_rows,
+                                    const size_t tile_offset,
+                                    const size_t tile_size,
+                                    DistData_t* dists,
+                                    const size_t dists_ld)
+{
+  constexpr int kWarpsPerBlock = 8;
+  size_t row_in_tile           = blockIdx.x * kWarpsPerBlock + threadIdx.x / raft::warp_size();
+  if (row_in_tile >= tile_size) { return; }
+  int lane_id       = threadIdx.x % raft::warp_size();
+  size_t sample_row = sample_rows[blockIdx.y];
+  size_t row        = tile_offset + row_in_tile;
+  if (row >= nrow) {
+    if (lane_id == 0) {
+      dists[blockIdx.y * dists_ld + row_in_tile] = std::numeric_limits<DistData_t>::max();
+    }
+    return;
+  }
+  const Data_t* a = data + sample_row * dim;
+  const Data_t* b   = data + row * dim;
+
+  float dot = 0;
+  for (int i = lane_id; i < dim; i += raft::warp_size()) {
+    dot += static_cast<float>(a[i]) * static_cast<float>(b[i]);
+  }
+  for (int offset = raft::warp_size() >> 1; offset >= 1; offset >>= 1) {
+    dot += __shfl_down_sync(raft::warp_full_mask(), dot, offset);
+  }
+  if (lane_id == 0) {
+    dists[blockIdx.y * dists_ld + row_in_tile] =
+      row == sample_row ? std::numeric_limits<DistData_t>::max()
+                        : l2_norms[sample_row] + l2_norms[row] - 2.0f * dot;
+  }
+}
+
 namespace {
 template <typename Index_t>
 int insert_to_ordered_list(InternalID_t<Index_t>* list,
@@ -1145,8 +1248,9 @@ GNND<Data_t, Index_t>::GNND(raft::resources const& res, const BuildConfig& build
            NUM_SAMPLES),
     nrow_(build_config.max_dataset_size),
     ndim_(build_config.dataset_dim),
-    d_data_{raft::make_device_matrix<__half, size_t, raft::row_major>(
-      res, nrow_, build_config.dataset_dim)},
+    d_data_{raft::make_device_matrix<device_data_t<std::remove_const_t<Data_t>>,
+                                     size_t,
+                                     raft::row_major>(res, nrow_, build_config.dataset_dim)},
     l2_norms_{raft::make_device_vector<DistData_t, size_t>(res, nrow_)},
     graph_buffer_{
       raft::make_device_matrix<ID_t, size_t, raft::row_major>(res, nrow_, DEGREE_ON_DEVICE)},
@@ -1212,7 +1316,103 @@ void GNND<Data_t, Index_t>::local_join(cudaStream_t stream)
 }
 
 template <typename Data_t, typename Index_t>
-void GNND<Data_t, Index_t>::build(Data_t* data, const Index_t nrow, Index_t* output_graph)
+void GNND<Data_t, Index_t>::compute_recall_ground_truth()
+{
+  cudaStream_t stream = raft::resource::get_cuda_stream(res);
+  size_t n_samples    = std::min(build_config_.recall_sample_size, nrow_);
+  size_t k            = std::min(recall_k(), nrow_ - 1);
+  RAFT_EXPECTS(n_samples > 0 && k > 0, "The recall estimate needs a non-empty sample");
+
+  // rows spread evenly over the dataset
+  recall_sample_rows_.resize(n_samples);
+  for (size_t i = 0; i < n_samples; i++) {
+    recall_sample_rows_[i] = static_cast<Index_t>(i * nrow_ / n_samples);
+  }
+  auto d_sample_rows = raft::make_device_vector<Index_t, int64_t>(res, n_samples);
+  raft::copy(d_sample_rows.data_handle(), recall_sample_rows_.data(), n_samples, stream);
+
+  // the best k distances so far in the first k columns, followed by the distances to a tile
+  size_t tile_size = std::min(nrow_, std::max<size_t>(1024, (size_t{1} << 24) / n_samples));
+  size_t ld        = k + tile_size;
+  auto dists       = raft::make_device_matrix<DistData_t, int64_t>(res, n_samples, ld);
+  auto best        = raft::make_device_matrix<DistData_t, int64_t>(res, n_samples, k);
+  auto best_ids    = raft::make_device_matrix<int64_t, int64_t>(res, n_samples, k);
+  thrust::fill(thrust::device.on(stream),
+               dists.data_handle(),
+               dists.data_handle() + dists.size(),
+               std::numeric_limits<DistData_t>::max());
+
+  constexpr int kWarpsPerBlock = 8;
+  dim3 grid(ceildiv(tile_size, static_cast<size_t>(kWarpsPerBlock)), n_samples);
+  for (size_t tile_offset = 0; tile_offset < nrow_; tile_offset += tile_size) {
+    sample_distances_kernel<<<grid, kWarpsPerBlock * raft::warp_size(), 0, stream>>>(
+      d_data_.data_handle(),
+      l2_norms_.data_handle(),
+      nrow_,
+      ndim_,
+      d_sample_rows.data_handle(),
+      tile_offset,
+      tile_size,
+      dists.data_handle() + k,
+      ld);
+    raft::matrix::select_k<DistData_t, int64_t>(
+      res,
+      raft::make_device_matrix_view<const DistData_t, int64_t>(dists.data_handle(), n_samples, ld),
+      std::nullopt,
+      best.view(),
+      best_ids.view(),
+      true);
+    RAFT_CUDA_TRY(cudaMemcpy2DAsync(dists.data_handle(),
+                                    ld * sizeof(DistData_t),
+                                    best.data_handle(),
+                                    k * sizeof(DistData_t),
+                                    k * sizeof(DistData_t),
+                                    n_samples,
+                                    cudaMemcpyDeviceToDevice,
+                                    stream));
+  }
+
+  // the k-th distance of every sample row
+  auto best_host = raft::make_host_matrix<DistData_t, int64_t>(n_samples, k);
+  raft::copy(best_host.data_handle(), best.data_handle(), best.size(), stream);
+  raft::resource::sync_stream(res);
+  recall_kth_dists_.resize(n_samples);
+  for (size_t i = 0; i < n_samples; i++) {
+    auto row             = best_host.data_handle() + i * k;
+    recall_kth_dists_[i] = *std::max_element(row, row + k);
+  }
+}
+
+/**
+ * The fraction of the k nearest neighbors of the sample rows found in the current graph: an edge
+ * counts if it is not farther than the k-th exact neighbor (which is robust to the ties).
+ */
+template <typename Data_t, typename Index_t>
+auto GNND<Data_t, Index_t>::estimate_recall() -> double
+{
+  size_t k       = std::min(recall_k(), nrow_ - 1);
+  size_t n_found = 0;
+#pragma omp parallel for reduction(+ : n_found)
+  for (size_t i = 0; i < recall_sample_rows_.size(); i++) {
+    size_t row     = recall_sample_rows_[i];
+    auto kth_dist  = recall_kth_dists_[i];
+    auto tolerance = 1e-5f * std::max(1.0f, std::abs(kth_dist));
+    size_t n_row   = 0;
+    for (size_t j = 0; j < graph_.node_degree; j++) {
+      size_t idx = row * graph_.node_degree + j;
+      if (static_cast<size_t>(graph_.h_graph[idx].id()) >= nrow_) { continue; }
+      if (graph_.h_dists.data_handle()[idx] <= kth_dist + tolerance) { n_row++; }
+    }
+    n_found += std::min(n_row, k);
+  }
+  return static_cast<double>(n_found) / static_cast<double>(recall_sample_rows_.size() * k);
+}
+
+template <typename Data_t, typename Index_t>
+void GNND<Data_t, Index_t>::build(Data_t* data,
+                                  const Index_t nrow,
+                                  Index_t* output_graph,
+                                  DistData_t* output_distances)
 {
   using input_t = typename std::remove_const<Data_t>::type;
 
@@ -1244,6 +1444,9 @@ void GNND<Data_t, Index_t>::build(Data_t* data, const Index_t nrow, Index_t* out
                (Index_t*)graph_buffer_.data_handle() + graph_buffer_.size(),
                std::numeric_limits<Index_t>::max());
 
+  bool recall_termination = build_config_.target_recall > 0;
+  if (recall_termination) { compute_recall_ground_truth(); }
+
   graph_.clear();
   graph_.init_random_graph();
   graph_.sample_graph(true);
@@ -1264,6 +1467,7 @@ void GNND<Data_t, Index_t>::build(Data_t* data, const Index_t nrow, Index_t* out
   };
 
   for (size_t it = 0; it < build_config_.max_iterations; it++) {
+    raft::resource::check_cancellation(res);
     raft::copy(d_list_sizes_new_.data_handle(),
                thrust::raw_pointer_cast(graph_.h_list_sizes_new.data()),
                nrow_,
@@ -1301,7 +1505,7 @@ void GNND<Data_t, Index_t>::build(Data_t* data, const Index_t nrow, Index_t* out
     // __CUDA_ARCH__ >= 700. Since RAFT supports compilation for ARCH 600,
     // we need to ensure that `local_join_kernel` (which uses tensor) operations
     // is not only not compiled, but also a runtime error is presented to the user
-    auto kernel       = preprocess_data_kernel<input_t>;
+    auto kernel       = preprocess_data_kernel<input_t, device_data_t<input_t>>;
     void* kernel_ptr  = reinterpret_cast<void*>(kernel);
     auto runtime_arch = raft::util::arch::kernel_virtual_arch(kernel_ptr);
     auto wmma_range =
@@ -1316,6 +1520,12 @@ void GNND<Data_t, Index_t>::build(Data_t* data, const Index_t nrow, Index_t* out
     update_and_sample_thread.join();
 
     if (update_counter_ == -1) { break; }
+    if (recall_termination) {
+      // the recall of the graph merged with the results of the previous iteration
+      double recall = this->estimate_recall();
+      RAFT_LOG_DEBUG("# GNND estimated recall: %f", recall);
+      if (recall >= build_config_.target_recall) { break; }
+    }
     raft::copy(thrust::raw_pointer_cast(graph_host_buffer_.data()),
                graph_buffer_.data_handle(),
                nrow_ * DEGREE_ON_DEVICE,
@@ -1336,6 +1546,16 @@ void GNND<Data_t, Index_t>::build(Data_t* data, const Index_t nrow, Index_t* out
   raft::resource::sync_stream(res);
   graph_.sort_lists();
 
+  if (output_distances != nullptr) {
+#pragma omp parallel for
+    for (size_t i = 0; i < (size_t)nrow_; i++) {
+      for (size_t j = 0; j < build_config_.node_degree; j++) {
+        size_t idx = i * graph_.node_degree + j;
+        output_distances[i * build_config_.node_degree + j] = graph_.h_dists.data_handle()[idx];
+      }
+    }
+  }
+
   // Reuse graph_.h_dists as the buffer for shrink the lists in graph
   static_assert(sizeof(decltype(*(graph_.h_dists.data_handle()))) >= sizeof(Index_t));
   Index_t* graph_shrink_buffer = (Index_t*)graph_.h_dists.data_handle();
@@ -1410,16 +1630,33 @@ void build(raft::resources const& res,
                            .node_degree           = extended_graph_degree,
                            .internal_node_degree  = extended_intermediate_degree,
                            .max_iterations        = params.max_iterations,
-                           .termination_threshold = params.termination_threshold};
+                           .termination_threshold = params.termination_threshold,
+                           .output_graph_degree   = graph_degree,
+                           .target_recall         = params.target_recall,
+                           .recall_sample_size    = params.recall_sample_size};
+
+  auto distances = idx.distances();
+  std::optional<raft::host_matrix<DistData_t, int64_t, row_major>> int_distances;
+  if (distances.has_value()) {
+    int_distances.emplace(raft::make_host_matrix<DistData_t, int64_t, row_major>(
+      dataset.extent(0), static_cast<int64_t>(extended_graph_degree)));
+  }
 
   GNND<const T, int> nnd(res, build_config);
-  nnd.build(dataset.data_handle(), dataset.extent(0), int_graph.data_handle());
+  nnd.build(dataset.data_handle(),
+            dataset.extent(0),
+            int_graph.data_handle(),
+            int_distances.has_value() ? int_distances->data_handle() : nullptr);
 
 #pragma omp parallel for
   for (size_t i = 0; i < static_cast<size_t>(dataset.extent(0)); i++) {
     for (size_t j = 0; j < graph_degree; j++) {
       auto graph                  = idx.graph().data_handle();
       graph[i * graph_degree + j] = int_graph.data_handle()[i * extended_graph_degree + j];
+      if (distances.has_value()) {
+        distances->data_handle()[i * graph_degree + j] =
+          int_distances->data_handle()[i * extended_graph_degree + j];
+      }
     }
   }
 }
@@ -1444,7 +1681,8 @@ index<IdxT> build(raft::resources const& res,
     graph_degree = intermediate_degree;
   }
 
-  index<IdxT> idx{res, dataset.extent(0), static_cast<int64_t>(graph_degree)};
+  index<IdxT> idx{
+    res, dataset.extent(0), static_cast<int64_t>(graph_degree), params.return_distances};
 
   build(res, params, dataset, idx);
 
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "nn_descent.cuh"
+
+#include <raft/core/memory_type.hpp>
+#include <raft/neighbors/ann_types.hpp>
+#include <raft/neighbors/nn_descent_types.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace raft::neighbors::experimental::nn_descent::detail {
+
+template <typename T, typename IdxT>
+auto estimate_build_memory(const index_params& params,
+                           int64_t n_rows,
+                           uint32_t dim,
+                           memory_type dataset_memory) -> ann::memory_estimate
+{
+  // The degrees as adjusted by `build`
+  size_t intermediate_degree = params.intermediate_graph_degree;
+  size_t graph_degree        = params.graph_degree;
+  if (intermediate_degree >= static_cast<size_t>(n_rows)) {
+    intermediate_degree = std::max<int64_t>(n_rows - 1, 0);
+  }
+  graph_degree = std::min(graph_degree, intermediate_degree);
+  const size_t extended_graph_degree =
+    align32::roundUp(static_cast<size_t>(graph_degree * (graph_degree <= 32 ? 1.0 : 1.3)));
+  const size_t extended_intermediate_degree = align32::roundUp(
+    static_cast<size_t>(intermediate_degree * (intermediate_degree <= 32 ? 1.0 : 1.3)));
+  const uint64_t n = n_rows;
+
+  ann::memory_estimate estimate;
+  // GNND: the device copy of the data and its norms, the device graph and the locks
+  estimate.device_workspace =
+    n * dim * sizeof(device_data_t<T>) +
+    n * (sizeof(DistData_t) + DEGREE_ON_DEVICE * (sizeof(int) + sizeof(DistData_t)) + sizeof(int) +
+         2 * sizeof(int2));
+  // The batches of the data copied to the device
+  if (!is_device_accessible(dataset_memory)) {
+    estimate.device_workspace += std::min<uint64_t>(n, 100000) * dim * sizeof(T);
+  }
+
+  // The output graph (and distances) of the index
+  estimate.host = n * graph_degree * sizeof(IdxT);
+  if (params.return_distances) { estimate.host += n * graph_degree * sizeof(DistData_t); }
+  // The internal graph (and distances), the host buffer of the distances of GnndGraph
+  estimate.host += n * extended_graph_degree * (sizeof(int) + sizeof(DistData_t));
+  if (params.return_distances) { estimate.host += n * extended_graph_degree * sizeof(DistData_t); }
+  // The sampled (reverse) neighbors and the list sizes of GnndGraph and GNND (pinned)
+  estimate.host += n * (5 * NUM_SAMPLES * sizeof(int) + 2 * sizeof(int2));
+  // The host copies of the device graph (pinned)
+  estimate.host += n * DEGREE_ON_DEVICE * (sizeof(int) + sizeof(DistData_t));
+  // The bloom filter: 3 hashes into one 512-bit set per 32 neighbors of a list
+  estimate.host += n * (extended_intermediate_degree / 32) * (512 / 8);
+  return estimate;
+}
+
+}  // namespace raft::neighbors::experimental::nn_descent::detail
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/mdspan.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/matrix/col_wise_sort.cuh>
+#include <raft/matrix/detail/sample_rows.cuh>
+#include <raft/neighbors/quantization_types.hpp>
+#include <raft/random/rng_state.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace raft::neighbors::quantization::detail {
+
+/** The number of rows of the batches of the inputs not accessible from the device. */
+constexpr size_t kEncodeBatchRows = 65536;
+
+/**
+ * Train the ranges of a scalar quantizer on (a sample of) the rows of the dataset: the values of
+ * every range are sorted, and the range is cut at the quantiles of the two tails.
+ */
+template <typename QuantT, typename T, typename IdxT, typename Accessor>
+auto train(raft::resources const& res,
+           const params& p,
+           raft::mdspan<const T, raft::matrix_extent<IdxT>, raft::row_major, Accessor> dataset)
+  -> scalar_quantizer<QuantT>
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "quantization::train(%zu, %u)", size_t(dataset.extent(0)), uint32_t(dataset.extent(1)));
+  RAFT_EXPECTS(p.quantile > 0 && p.quantile <= 1, "The quantile must be in (0, 1]");
+  RAFT_EXPECTS(dataset.extent(0) > 0 && dataset.extent(1) > 0, "The dataset must not be empty");
+  auto stream      = resource::get_cuda_stream(res);
+  int64_t n_rows   = dataset.extent(0);
+  uint32_t dim     = dataset.extent(1);
+  int64_t n_train  = std::min<int64_t>(n_rows, std::max<int64_t>(p.max_train_rows, 1));
+  auto quantizer   = scalar_quantizer<QuantT>(res, dim, p.per_dimension);
+  uint32_t n_range = quantizer.n_ranges();
+
+  auto sample = raft::make_device_matrix<T, int64_t>(res, n_train, dim);
+  if (n_train == n_rows) {
+    raft::copy(sample.data_handle(), dataset.data_handle(), n_train * dim, stream);
+  } else {
+    raft::random::RngState rng(p.seed);
+    raft::matrix::detail::sample_rows(
+      res, rng, dataset.data_handle(), n_rows, int64_t(dim), sample.data_handle(), n_train);
+  }
+
+  // the training values of every range in a row: the columns of the sample per dimension, or the
+  // whole sample otherwise
+  int64_t len = p.per_dimension ? n_train : n_train * dim;
+  auto values = raft::make_device_matrix<float, int64_t>(res, n_range, len);
+  raft::linalg::map_offset(
+    res,
+    raft::make_device_vector_view<float, int64_t>(values.data_handle(), values.size()),
+    [src = sample.data_handle(), per_dim = p.per_dimension, n_train, dim] __device__(int64_t i) {
+      return static_cast<float>(per_dim ? src[(i % n_train) * dim + i / n_train] : src[i]);
+    });
+  raft::matrix::sort_cols_per_row_inplace(res, values.view());
+
+  auto tail   = static_cast<int64_t>(std::floor(0.5 * (1.0 - p.quantile) * double(len - 1)));
+  int64_t lo  = tail;
+  int64_t hi  = len - 1 - tail;
+  auto coeffs = quantizer.coefficients();
+  raft::linalg::map_offset(
+    res,
+    raft::make_device_vector_view<float, uint32_t>(coeffs.data_handle(), coeffs.size()),
+    [sorted = values.data_handle(), len, lo, hi] __device__(uint32_t i) {
+      const float* row = sorted + (i / 2) * len;
+      float min_val    = row[lo];
+      float max_val    = row[hi];
+      if constexpr (scalar_quantizer_view<QuantT>::kIntegerCodes) {
+        constexpr float kSteps  = scalar_quantizer<QuantT>::kSteps;
+        constexpr float kLowest = std::numeric_limits<QuantT>::lowest();
+        // a constant dimension is encoded by the lowest code
+        float scale = max_val > min_val ? (max_val - min_val) / kSteps : 1.0f;
+        return i % 2 == 0 ? min_val - kLowest * scale : scale;
+      } else {
+        return i % 2 == 0 ? min_val : max_val;
+      }
+    });
+  return quantizer;
+}
+
+/**
+ * Encode the rows of the dataset (host or device) in one pass, the rows not accessible from the
+ * device being copied by batches (prefetched when the resources have a stream pool).
+ */
+template <typename QuantT, typename T, typename IdxT, typename Accessor>
+void transform(raft::resources const& res,
+               const scalar_quantizer<QuantT>& quantizer,
+               raft::mdspan<const T, raft::matrix_extent<IdxT>, raft::row_major, Accessor> dataset,
+               raft::device_matrix_view<QuantT, IdxT, raft::row_major> out)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "quantization::transform(%zu, %u)", size_t(dataset.extent(0)), uint32_t(dataset.extent(1)));
+  RAFT_EXPECTS(dataset.extent(1) == quantizer.dim(), "The dataset must have `dim()` columns");
+  RAFT_EXPECTS(out.extent(0) == dataset.extent(0) && out.extent(1) == dataset.extent(1),
+               "The output must have the shape of the dataset");
+  auto stream   = resource::get_cuda_stream(res);
+  size_t n_rows = dataset.extent(0);
+  uint32_t dim  = quantizer.dim();
+  if (n_rows == 0) { return; }
+  auto prefetch_stream = resource::is_stream_pool_initialized(res)
+                           ? std::make_optional(resource::get_stream_from_stream_pool(res))
+                           : std::nullopt;
+  spatial::knn::detail::utils::batch_load_iterator<T> batches(
+    dataset.data_handle(),
+    n_rows,
+    dim,
+    std::min(n_rows, kEncodeBatchRows),
+    stream,
+    resource::get_workspace_resource(res),
+    resource::get_pinned_memory_resource(res),
+    prefetch_stream);
+  auto view = quantizer.view();
+  for (const auto& batch : batches) {
+    raft::linalg::map_offset(
+      res,
+      raft::make_device_vector_view<QuantT, int64_t>(out.data_handle() + batch.offset() * dim,
+                                                     batch.size() * dim),
+      [view, src = batch.data(), dim] __device__(int64_t i) {
+        return view.encode(static_cast<float>(src[i]), uint32_t(i % dim));
+      });
+  }
+}
+
+/** Decode the codes of a scalar quantizer. */
+template <typename QuantT, typename T, typename IdxT>
+void inverse_transform(raft::resources const& res,
+                       const scalar_quantizer<QuantT>& quantizer,
+                       raft::device_matrix_view<const QuantT, IdxT, raft::row_major> codes,
+                       raft::device_matrix_view<T, IdxT, raft::row_major> out)
+{
+  RAFT_EXPECTS(codes.extent(1) == quantizer.dim(), "The codes must have `dim()` columns");
+  RAFT_EXPECTS(out.extent(0) == codes.extent(0) && out.extent(1) == codes.extent(1),
+               "The output must have the shape of the codes");
+  uint32_t dim = quantizer.dim();
+  raft::linalg::map_offset(
+    res,
+    raft::make_device_vector_view<T, int64_t>(out.data_handle(), out.size()),
+    [view = quantizer.view(), src = codes.data_handle(), dim] __device__(int64_t i) {
+      return static_cast<T>(view.decode(src[i], uint32_t(i % dim)));
+    });
+}
+
+}  // namespace raft::neighbors::quantization::detail
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/copy.h>
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/scan.h>
+#include <thrust/scatter.h>
+#include <thrust/transform.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace raft::neighbors::detail {
+
+/**
+ * The number of the leading search results of a row within the radius (the results are sorted,
+ * so the first one out of the radius ends the neighborhood). For the similarities, the radius is
+ * the minimum similarity. The neighbors not smaller than `invalid` are the missing results.
+ */
+template <typename IdxT>
+struct range_count_op {
+  const IdxT* neighbors;
+  const float* distances;
+  uint32_t k;
+  float radius;
+  bool similarity;
+  IdxT invalid;
+
+  HDI auto operator()(int64_t row) const -> int64_t
+  {
+    int64_t n = 0;
+    for (uint32_t j = 0; j < k; j++) {
+      const int64_t i = row * k + j;
+      const float d   = distances[i];
+      if (neighbors[i] >= invalid || (similarity ? d < radius : d > radius)) { break; }
+      n++;
+    }
+    return n;
+  }
+};
+
+/** Whether the neighborhood of a query may extend beyond its `k` search results. */
+struct range_saturated_op {
+  int64_t k;
+
+  HDI auto operator()(int64_t count) const -> bool { return count == k; }
+};
+
+/** The number of results taken from a search round: none for the queries searched again. */
+struct range_take_op {
+  int64_t k;
+  bool last_round;
+
+  HDI auto operator()(int64_t count) const -> int64_t
+  {
+    return count == k && !last_round ? 0 : count;
+  }
+};
+
+/** Write the results taken from a search round into the CSR output. */
+template <typename IdxT>
+struct range_fill_op {
+  const int64_t* query_ids;
+  const IdxT* neighbors;
+  const float* distances;
+  const int64_t* take;
+  const int64_t* indptr;
+  uint32_t k;
+  IdxT* out_indices;
+  float* out_distances;
+
+  HDI void operator()(int64_t i) const
+  {
+    const int64_t row = i / k;
+    const int64_t j   = i % k;
+    if (j >= take[row]) { return; }
+    const int64_t query = query_ids == nullptr ? row : query_ids[row];
+    const int64_t pos   = indptr[query] + j;
+    out_indices[pos]    = neighbors[i];
+    out_distances[pos]  = distances[i];
+  }
+};
+
+/** The results of a round of `range_search_rounds`, kept until the CSR output is allocated. */
+template <typename IdxT>
+struct range_search_round {
+  /** The queries searched in the round (empty: all of them). */
+  rmm::device_uvector<int64_t> query_ids;
+  raft::device_matrix<IdxT, int64_t> neighbors;
+  raft::device_matrix<float, int64_t> distances;
+  /** The number of results taken per query (the size of its neighborhood if final, or 0). */
+  rmm::device_uvector<int64_t> take;
+  uint32_t k;
+};
+
+/**
+ * Search the neighbors of the queries within the radius into a CSR matrix, using a top-k search.
+ *
+ * The queries are searched for `k = initial_k` neighbors first, and the queries whose `k` results
+ * are all within the radius (i.e. the worst result has not yet left the radius) are searched again
+ * for twice as many, up to `max_k`. The neighborhoods are counted first, scanned into the row
+ * offsets of the CSR matrix, and then filled in from the results of the rounds.
+ *
+ * @tparam IdxT the type of the neighbors returned by the search
+ * @tparam OutIdxT the type of the column indices of the CSR matrix (of the same size as IdxT)
+ * @tparam SearchFn
+ *   `void(const int64_t* query_ids, int64_t n_queries, uint32_t k, neighbors, distances)`:
+ *   search the given queries (all of them if `query_ids == nullptr`) for the `k` nearest neighbors
+ *   into the device matrix views [n_queries, k]
+ *
+ * @param[in] res raft resources
+ * @param[in] n_queries the number of queries
+ * @param[in] initial_k the number of neighbors searched in the first round
+ * @param[in] max_k the maximum size of a neighborhood (at most the size of the index)
+ * @param[in] radius the radius, or the minimum similarity if `similarity`
+ * @param[in] similarity whether the search distances are similarities (larger is closer)
+ * @param[in] invalid the neighbors not smaller than this value mark the missing results
+ * @param[in] search the top-k search
+ * @param[out] result the neighborhoods [n_queries, n_cols]; its sparsity is initialized here
+ */
+template <typename IdxT, typename OutIdxT, typename SearchFn>
+void range_search_rounds(raft::resources const& res,
+                         int64_t n_queries,
+                         uint32_t initial_k,
+                         uint32_t max_k,
+                         float radius,
+                         bool similarity,
+                         IdxT invalid,
+                         SearchFn&& search,
+                         raft::device_csr_matrix<float, int64_t, OutIdxT, int64_t>& result)
+{
+  static_assert(sizeof(IdxT) == sizeof(OutIdxT),
+                "The search results must be of the size of the CSR column indices");
+  RAFT_EXPECTS(initial_k > 0 && initial_k <= max_k,
+               "range search: initial_k must be in [1, max_k]");
+  RAFT_EXPECTS(result.structure_view().get_n_rows() == n_queries,
+               "The range search result must have a row per query");
+
+  auto stream = resource::get_cuda_stream(res);
+  auto policy = resource::get_thrust_policy(res);
+
+  // Phase 1: search until every neighborhood is complete, and count them.
+  rmm::device_uvector<int64_t> counts(n_queries, stream);
+  std::vector<range_search_round<IdxT>> rounds;
+  rmm::device_uvector<int64_t> pending(0, stream);
+  int64_t n_pending = n_queries;
+  uint32_t k        = initial_k;
+  while (n_pending > 0) {
+    const bool last_round = k >= max_k;
+    auto& round           = rounds.emplace_back(
+      range_search_round<IdxT>{std::move(pending),
+                               raft::make_device_matrix<IdxT, int64_t>(res, n_pending, k),
+                               raft::make_device_matrix<float, int64_t>(res, n_pending, k),
+                               rmm::device_uvector<int64_t>(n_pending, stream),
+                               k});
+    const int64_t* ids = rounds.size() == 1 ? nullptr : round.query_ids.data();
+    search(ids, n_pending, k, round.neighbors.view(), round.distances.view());
+
+    raft::linalg::map_offset(
+      res,
+      raft::make_device_vector_view<int64_t, int64_t>(round.take.data(), n_pending),
+      range_count_op<IdxT>{round.neighbors.data_handle(),
+                           round.distances.data_handle(),
+                           k,
+                           radius,
+                           similarity,
+                           invalid});
+
+    // The queries whose k results are all within the radius are searched again for more.
+    rmm::device_uvector<int64_t> saturated(last_round ? 0 : n_pending, stream);
+    if (!last_round) {
+      int64_t* end = nullptr;
+      if (ids == nullptr) {
+        auto first = thrust::make_counting_iterator<int64_t>(0);
+        end        = thrust::copy_if(policy,
+                              first,
+                              first + n_pending,
+                              round.take.data(),
+                              saturated.data(),
+                              range_saturated_op{k});
+      } else {
+        end = thrust::copy_if(
+          policy, ids, ids + n_pending, round.take.data(), saturated.data(), range_saturated_op{k});
+      }
+      saturated.resize(end - saturated.data(), stream);
+    }
+    thrust::transform(policy,
+                      round.take.data(),
+                      round.take.data() + n_pending,
+                      round.take.data(),
+                      range_take_op{k, last_round});
+    if (ids == nullptr) {
+      raft::copy(counts.data(), round.take.data(), n_pending, stream);
+    } else {
+      thrust::scatter(policy, round.take.data(), round.take.data() + n_pending, ids, counts.data());
+    }
+
+    RAFT_LOG_DEBUG("# range search: %zu of %zu queries searched again with k = %u",
+                   saturated.size(),
+                   static_cast<size_t>(n_pending),
+                   2 * k);
+    n_pending = saturated.size();
+    pending   = std::move(saturated);
+    k         = std::min<uint32_t>(2 * k, max_k);
+  }
+
+  // Phase 2: allocate the CSR output and fill it in.
+  rmm::device_uvector<int64_t> indptr(n_queries + 1, stream);
+  RAFT_CUDA_TRY(cudaMemsetAsync(indptr.data(), 0, sizeof(int64_t), stream));
+  thrust::inclusive_scan(policy, counts.data(), counts.data() + n_queries, indptr.data() + 1);
+  int64_t nnz = 0;
+  raft::copy(&nnz, indptr.data() + n_queries, 1, stream);
+  resource::sync_stream(res);
+
+  result.initialize_sparsity(nnz);
+  auto structure = result.structure_view();
+  raft::copy(structure.get_indptr().data(), indptr.data(), n_queries + 1, stream);
+  auto* out_indices   = reinterpret_cast<IdxT*>(structure.get_indices().data());
+  auto* out_distances = result.get_elements().data();
+  for (size_t r = 0; r < rounds.size(); r++) {
+    const auto& round  = rounds[r];
+    const int64_t* ids = r == 0 ? nullptr : round.query_ids.data();
+    thrust::for_each_n(policy,
+                       thrust::make_counting_iterator<int64_t>(0),
+                       round.neighbors.size(),
+                       range_fill_op<IdxT>{ids,
+                                           round.neighbors.data_handle(),
+                                           round.distances.data_handle(),
+                                           round.take.data(),
+                                           indptr.data(),
+                                           round.k,
+                                           out_indices,
+                                           out_distances});
+  }
+}
+
+}  // namespace raft::neighbors::detail
@@ -17,8 +17,10 @@
 #pragma once
 
 #include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
 #include <raft/core/host_mdspan.hpp>
 #include <raft/core/nvtx.hpp>
+#include <raft/core/pinned_mdarray.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
 #include <raft/core/resources.hpp>
@@ -31,38 +33,36 @@
 
 #include <thrust/sequence.h>
 
+#include <omp.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
 namespace raft::neighbors::detail {
 
 /**
- * See raft::neighbors::refine for docs.
+ * The device refinement of the candidates, the vectors of which are read from `dataset_ptr`:
+ * either the full dataset indexed by the candidate ids, or (`dataset_is_gathered`) the candidate
+ * vectors gathered in the order of `neighbor_candidates`, [n_queries * n_candidates, dim].
  */
 template <typename idx_t, typename data_t, typename distance_t, typename matrix_idx>
-void refine_device(raft::resources const& handle,
-                   raft::device_matrix_view<const data_t, matrix_idx, row_major> dataset,
-                   raft::device_matrix_view<const data_t, matrix_idx, row_major> queries,
-                   raft::device_matrix_view<const idx_t, matrix_idx, row_major> neighbor_candidates,
-                   raft::device_matrix_view<idx_t, matrix_idx, row_major> indices,
-                   raft::device_matrix_view<distance_t, matrix_idx, row_major> distances,
-                   distance::DistanceType metric = distance::DistanceType::L2Unexpanded)
+void refine_device_impl(
+  raft::resources const& handle,
+  const data_t* dataset_ptr,
+  bool dataset_is_gathered,
+  raft::device_matrix_view<const data_t, matrix_idx, row_major> queries,
+  raft::device_matrix_view<const idx_t, matrix_idx, row_major> neighbor_candidates,
+  raft::device_matrix_view<idx_t, matrix_idx, row_major> indices,
+  raft::device_matrix_view<distance_t, matrix_idx, row_major> distances,
+  distance::DistanceType metric)
 {
   matrix_idx n_candidates = neighbor_candidates.extent(1);
   matrix_idx n_queries    = queries.extent(0);
-  matrix_idx dim          = dataset.extent(1);
+  matrix_idx dim          = queries.extent(1);
   uint32_t k              = static_cast<uint32_t>(indices.extent(1));
-
-  RAFT_EXPECTS(k <= raft::matrix::detail::select::warpsort::kMaxCapacity,
-               "k must be less than topk::kMaxCapacity (%d).",
-               raft::matrix::detail::select::warpsort::kMaxCapacity);
-
-  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
-    "neighbors::refine(%zu, %u)", size_t(n_queries), uint32_t(n_candidates));
-
-  refine_check_input(dataset.extents(),
-                     queries.extents(),
-                     neighbor_candidates.extents(),
-                     indices.extents(),
-                     distances.extents(),
-                     metric);
+  RAFT_EXPECTS(metric != distance::DistanceType::CosineExpanded,
+               "The device refinement does not support the CosineExpanded metric");
 
   // The refinement search can be mapped to an IVF flat search:
   // - We consider that the candidate vectors form a cluster, separately for each query.
@@ -82,10 +82,11 @@ void refine_device(raft::resources const& handle,
 
   raft::neighbors::ivf_flat::detail::fill_refinement_index(handle,
                                                            &refinement_index,
-                                                           dataset.data_handle(),
+                                                           dataset_ptr,
                                                            neighbor_candidates.data_handle(),
                                                            n_queries,
-                                                           n_candidates);
+                                                           n_candidates,
+                                                           dataset_is_gathered);
   uint32_t grid_dim_x = 1;
   raft::neighbors::ivf_flat::detail::ivfflat_interleaved_scan<
     data_t,
@@ -106,4 +107,152 @@ void refine_device(raft::resources const& handle,
            resource::get_cuda_stream(handle));
 }
 
+/**
+ * See raft::neighbors::refine for docs.
+ */
+template <typename idx_t, typename data_t, typename distance_t, typename matrix_idx>
+void refine_device(raft::resources const& handle,
+                   raft::device_matrix_view<const data_t, matrix_idx, row_major> dataset,
+                   raft::device_matrix_view<const data_t, matrix_idx, row_major> queries,
+                   raft::device_matrix_view<const idx_t, matrix_idx, row_major> neighbor_candidates,
+                   raft::device_matrix_view<idx_t, matrix_idx, row_major> indices,
+                   raft::device_matrix_view<distance_t, matrix_idx, row_major> distances,
+                   distance::DistanceType metric = distance::DistanceType::L2Unexpanded)
+{
+  matrix_idx n_candidates = neighbor_candidates.extent(1);
+  matrix_idx n_queries    = queries.extent(0);
+  uint32_t k              = static_cast<uint32_t>(indices.extent(1));
+
+  RAFT_EXPECTS(k <= raft::matrix::detail::select::warpsort::kMaxCapacity,
+               "k must be less than topk::kMaxCapacity (%d).",
+               raft::matrix::detail::select::warpsort::kMaxCapacity);
+
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "neighbors::refine(%zu, %u)", size_t(n_queries), uint32_t(n_candidates));
+
+  refine_check_input(dataset.extents(),
+                     queries.extents(),
+                     neighbor_candidates.extents(),
+                     indices.extents(),
+                     distances.extents(),
+                     metric);
+
+  refine_device_impl(handle,
+                     dataset.data_handle(),
+                     false,
+                     queries,
+                     neighbor_candidates,
+                     indices,
+                     distances,
+                     metric);
+}
+
+/**
+ * See raft::neighbors::refine (host dataset, device queries) for docs.
+ *
+ * The queries are processed in batches; for every batch, the host threads gather the candidate
+ * rows of the (pinned, pageable or memory-mapped) host dataset into a pinned staging buffer, which
+ * is copied to the device and refined there. Two staging buffers are used in turns, so that the
+ * gathering of a batch overlaps the copy and the refinement of the previous one.
+ */
+template <typename idx_t, typename data_t, typename distance_t, typename matrix_idx>
+void refine_host_dataset(
+  raft::resources const& handle,
+  raft::host_matrix_view<const data_t, matrix_idx, row_major> dataset,
+  raft::device_matrix_view<const data_t, matrix_idx, row_major> queries,
+  raft::device_matrix_view<const idx_t, matrix_idx, row_major> neighbor_candidates,
+  raft::device_matrix_view<idx_t, matrix_idx, row_major> indices,
+  raft::device_matrix_view<distance_t, matrix_idx, row_major> distances,
+  distance::DistanceType metric = distance::DistanceType::L2Unexpanded)
+{
+  matrix_idx n_candidates = neighbor_candidates.extent(1);
+  matrix_idx n_queries    = queries.extent(0);
+  matrix_idx n_rows       = dataset.extent(0);
+  matrix_idx dim          = dataset.extent(1);
+  auto stream             = resource::get_cuda_stream(handle);
+
+  RAFT_EXPECTS(static_cast<uint32_t>(indices.extent(1)) <=
+                 raft::matrix::detail::select::warpsort::kMaxCapacity,
+               "k must be less than topk::kMaxCapacity (%d).",
+               raft::matrix::detail::select::warpsort::kMaxCapacity);
+
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "neighbors::refine_host_dataset(%zu, %u)", size_t(n_queries), uint32_t(n_candidates));
+
+  refine_check_input(dataset.extents(),
+                     queries.extents(),
+                     neighbor_candidates.extents(),
+                     indices.extents(),
+                     distances.extents(),
+                     metric);
+  if (n_queries == 0) { return; }
+
+  // The batch size bounds the staging buffers (two pinned and two device buffers)
+  constexpr size_t kMaxStagingBytes = size_t{256} << 20;
+  size_t row_bytes                  = size_t(n_candidates) * dim * sizeof(data_t);
+  auto batch_size                   = static_cast<matrix_idx>(
+    std::clamp<size_t>(kMaxStagingBytes / std::max<size_t>(row_bytes, 1), 1, n_queries));
+
+  auto candidates_host = raft::make_host_matrix<idx_t, matrix_idx>(n_queries, n_candidates);
+  raft::copy(candidates_host.data_handle(),
+             neighbor_candidates.data_handle(),
+             neighbor_candidates.size(),
+             stream);
+
+  std::array<raft::pinned_matrix<data_t, matrix_idx>, 2> staging_host{
+    raft::make_pinned_matrix<data_t, matrix_idx>(handle, batch_size * n_candidates, dim),
+    raft::make_pinned_matrix<data_t, matrix_idx>(handle, batch_size * n_candidates, dim)};
+  std::array<raft::device_matrix<data_t, matrix_idx>, 2> staging_dev{
+    raft::make_device_matrix<data_t, matrix_idx>(handle, batch_size * n_candidates, dim),
+    raft::make_device_matrix<data_t, matrix_idx>(handle, batch_size * n_candidates, dim)};
+  std::array<cudaEvent_t, 2> copied;
+  for (auto& event : copied) {
+    RAFT_CUDA_TRY(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+  }
+  resource::sync_stream(handle);
+
+  for (matrix_idx offset = 0, b = 0; offset < n_queries; offset += batch_size, b++) {
+    auto rows  = std::min<matrix_idx>(batch_size, n_queries - offset);
+    auto& host = staging_host[b % 2];
+    auto& dev  = staging_dev[b % 2];
+    // The staging buffer may still be read by the copy of the batch before the previous one
+    RAFT_CUDA_TRY(cudaEventSynchronize(copied[b % 2]));
+
+    const idx_t* batch_candidates = candidates_host.data_handle() + offset * n_candidates;
+    int64_t n_gather              = int64_t(rows) * n_candidates;
+#pragma omp parallel for
+    for (int64_t i = 0; i < n_gather; i++) {
+      auto id  = batch_candidates[i];
+      auto dst = host.data_handle() + i * dim;
+      // The invalid candidates (e.g. the padding of an upstream search) get zero vectors
+      if (static_cast<uint64_t>(id) < static_cast<uint64_t>(n_rows)) {
+        std::memcpy(dst, dataset.data_handle() + int64_t(id) * dim, sizeof(data_t) * dim);
+      } else {
+        std::memset(dst, 0, sizeof(data_t) * dim);
+      }
+    }
+    raft::copy(dev.data_handle(), host.data_handle(), n_gather * dim, stream);
+    RAFT_CUDA_TRY(cudaEventRecord(copied[b % 2], stream));
+
+    refine_device_impl(
+      handle,
+      dev.data_handle(),
+      true,
+      raft::make_device_matrix_view<const data_t, matrix_idx>(
+        queries.data_handle() + offset * dim, rows, dim),
+      raft::make_device_matrix_view<const idx_t, matrix_idx>(
+        neighbor_candidates.data_handle() + offset * n_candidates, rows, n_candidates),
+      raft::make_device_matrix_view<idx_t, matrix_idx>(
+        indices.data_handle() + offset * indices.extent(1), rows, indices.extent(1)),
+      raft::make_device_matrix_view<distance_t, matrix_idx>(
+        distances.data_handle() + offset * distances.extent(1), rows, distances.extent(1)),
+      metric);
+  }
+  // The staging buffers must outlive the work queued on the stream
+  resource::sync_stream(handle);
+  for (auto& event : copied) {
+    RAFT_CUDA_TRY_NO_THROW(cudaEventDestroy(event));
+  }
+}
+
 }  // namespace raft::neighbors::detail
@@ -19,6 +19,7 @@
 #include <raft/core/host_mdspan.hpp>
 #include <raft/core/nvtx.hpp>
 #include <raft/neighbors/detail/refine_common.hpp>
+#include <raft/neighbors/detail/refine_host_distance.hpp>
 #include <raft/util/integer_utils.hpp>
 
 #include <algorithm>
@@ -44,6 +45,7 @@ template <typename DC, typename IdxT, typename DataT, typename DistanceT, typena
     "neighbors::refine_host(%zu, %zu -> %zu)", n_queries, orig_k, refined_k);
 
   auto suggested_n_threads = std::max(1, std::min(omp_get_num_procs(), omp_get_max_threads()));
+  auto row_distance        = select_row_distance<DC, DataT, DistanceT>();
 
   // If the number of queries is small, separate the distance calculation and
   // the top-k calculation into separate loops, and apply finer-grained thread
@@ -72,10 +74,7 @@ template <typename DC, typename IdxT, typename DataT, typename DistanceT, typena
         if (static_cast<size_t>(id) >= n_rows) {
           distance = std::numeric_limits<DistanceT>::max();
         } else {
-          const DataT* row = dataset.data_handle() + dim * id;
-          for (size_t k = 0; k < dim; k++) {
-            distance += DC::template eval<DistanceT>(query[k], row[k]);
-          }
+          distance = row_distance(query, dataset.data_handle() + dim * id, dim);
         }
         refined_pairs[i][j] = std::make_tuple(distance, id);
       }
@@ -105,15 +104,17 @@ template <typename DC, typename IdxT, typename DataT, typename DistanceT, typena
       // Compute the refined distance using original dataset vectors
       const DataT* query = queries.data_handle() + dim * i;
       for (size_t j = 0; j < orig_k; j++) {
+        // the candidate rows are scattered over the dataset: fetch the next one ahead of time
+        if (j + 1 < orig_k) {
+          auto next_id = static_cast<size_t>(neighbor_candidates(i, j + 1));
+          if (next_id < n_rows) { prefetch_row(dataset.data_handle() + dim * next_id, dim); }
+        }
         IdxT id            = neighbor_candidates(i, j);
         DistanceT distance = 0.0;
         if (static_cast<size_t>(id) >= n_rows) {
           distance = std::numeric_limits<DistanceT>::max();
         } else {
-          const DataT* row = dataset.data_handle() + dim * id;
-          for (size_t k = 0; k < dim; k++) {
-            distance += DC::template eval<DistanceT>(query[k], row[k]);
-          }
+          distance = row_distance(query, dataset.data_handle() + dim * id, dim);
         }
         refined_pairs[j] = std::make_tuple(distance, id);
       }
@@ -130,33 +131,6 @@ template <typename DC, typename IdxT, typename DataT, typename DistanceT, typena
   }
 }
 
-struct distance_comp_l2 {
-  template <typename DistanceT>
-  static inline auto eval(const DistanceT& a, const DistanceT& b) -> DistanceT
-  {
-    auto d = a - b;
-    return d * d;
-  }
-  template <typename DistanceT>
-  static inline auto postprocess(const DistanceT& a) -> DistanceT
-  {
-    return a;
-  }
-};
-
-struct distance_comp_inner {
-  template <typename DistanceT>
-  static inline auto eval(const DistanceT& a, const DistanceT& b) -> DistanceT
-  {
-    return -a * b;
-  }
-  template <typename DistanceT>
-  static inline auto postprocess(const DistanceT& a) -> DistanceT
-  {
-    return -a;
-  }
-};
-
 /**
  * Naive CPU implementation of refine operation
  *
@@ -0,0 +1,370 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace raft::neighbors::detail {
+
+struct distance_comp_l2 {
+  template <typename DistanceT>
+  static inline auto eval(const DistanceT& a, const DistanceT& b) -> DistanceT
+  {
+    auto d = a - b;
+    return d * d;
+  }
+  template <typename DistanceT>
+  static inline auto postprocess(const DistanceT& a) -> DistanceT
+  {
+    return a;
+  }
+};
+
+struct distance_comp_inner {
+  template <typename DistanceT>
+  static inline auto eval(const DistanceT& a, const DistanceT& b) -> DistanceT
+  {
+    return -a * b;
+  }
+  template <typename DistanceT>
+  static inline auto postprocess(const DistanceT& a) -> DistanceT
+  {
+    return -a;
+  }
+};
+
+/**
+ * The distance between a query and a dataset row, before the `DC::postprocess` (i.e. the sum of
+ * `DC::eval` over the dimensions).
+ */
+template <typename DataT, typename DistanceT>
+using row_distance_func = DistanceT (*)(const DataT*, const DataT*, size_t);
+
+template <typename DC, typename DataT, typename DistanceT>
+[[gnu::optimize(3), gnu::optimize("tree-vectorize")]] auto row_distance_scalar(const DataT* a,
+                                                                               const DataT* b,
+                                                                               size_t dim)
+  -> DistanceT
+{
+  DistanceT distance = 0.0;
+  for (size_t k = 0; k < dim; k++) {
+    distance += DC::template eval<DistanceT>(a[k], b[k]);
+  }
+  return distance;
+}
+
+/**
+ * The 8-bit kernels accumulate in int32, which may overflow past ~33k dimensions of the squared
+ * differences: the rows are split into blocks that are summed up in float.
+ */
+template <typename DataT, row_distance_func<DataT, float> Kernel>
+auto row_distance_blocked(const DataT* a, const DataT* b, size_t dim) -> float
+{
+  constexpr size_t kBlock = 32768;
+  float distance          = 0;
+  for (size_t i = 0; i < dim; i += kBlock) {
+    distance += Kernel(a + i, b + i, std::min(kBlock, dim - i));
+  }
+  return distance;
+}
+
+#if defined(__x86_64__)
+
+// NB: the AVX-512 kernels reduce the accumulators through a store: `_mm512_reduce_add_*` trips
+// -Wuninitialized in the gcc 12 headers.
+
+template <bool L2>
+__attribute__((target("avx2,fma"))) auto row_distance_f32_avx2(const float* a,
+                                                               const float* b,
+                                                               size_t dim) -> float
+{
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  size_t i    = 0;
+  for (; i + 16 <= dim; i += 16) {
+    __m256 a0 = _mm256_loadu_ps(a + i);
+    __m256 b0 = _mm256_loadu_ps(b + i);
+    __m256 a1 = _mm256_loadu_ps(a + i + 8);
+    __m256 b1 = _mm256_loadu_ps(b + i + 8);
+    if constexpr (L2) {
+      __m256 d0 = _mm256_sub_ps(a0, b0);
+      __m256 d1 = _mm256_sub_ps(a1, b1);
+      acc0      = _mm256_fmadd_ps(d0, d0, acc0);
+      acc1      = _mm256_fmadd_ps(d1, d1, acc1);
+    } else {
+      acc0 = _mm256_fmadd_ps(a0, b0, acc0);
+      acc1 = _mm256_fmadd_ps(a1, b1, acc1);
+    }
+  }
+  acc0       = _mm256_add_ps(acc0, acc1);
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+  sum        = _mm_hadd_ps(sum, sum);
+  sum        = _mm_hadd_ps(sum, sum);
+  float res  = _mm_cvtss_f32(sum);
+  for (; i < dim; i++) {
+    if constexpr (L2) {
+      float d = a[i] - b[i];
+      res += d * d;
+    } else {
+      res += a[i] * b[i];
+    }
+  }
+  return L2 ? res : -res;
+}
+
+template <bool L2>
+__attribute__((target("avx512f"))) auto row_distance_f32_avx512(const float* a,
+                                                                const float* b,
+                                                                size_t dim) -> float
+{
+  __m512 acc = _mm512_setzero_ps();
+  for (size_t i = 0; i < dim; i += 16) {
+    // the tail is read with a masked load (the masked-out lanes are zero)
+    __mmask16 mask = dim - i >= 16 ? __mmask16(0xffff) : __mmask16((1u << (dim - i)) - 1);
+    __m512 va      = _mm512_maskz_loadu_ps(mask, a + i);
+    __m512 vb      = _mm512_maskz_loadu_ps(mask, b + i);
+    if constexpr (L2) {
+      __m512 d = _mm512_sub_ps(va, vb);
+      acc      = _mm512_fmadd_ps(d, d, acc);
+    } else {
+      acc = _mm512_fmadd_ps(va, vb, acc);
+    }
+  }
+  alignas(64) float lanes[16];
+  _mm512_store_ps(lanes, acc);
+  float res = 0;
+  for (float lane : lanes) {
+    res += lane;
+  }
+  return L2 ? res : -res;
+}
+
+/** AVX2: the 8-bit values are widened to int16 and multiply-accumulated with `madd`. */
+template <typename T, bool L2>
+__attribute__((target("avx2"))) auto row_distance_i8_avx2(const T* a, const T* b, size_t dim)
+  -> float
+{
+  __m256i acc = _mm256_setzero_si256();
+  size_t i    = 0;
+  for (; i + 16 <= dim; i += 16) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+    __m256i wa, wb;
+    if constexpr (std::is_signed_v<T>) {
+      wa = _mm256_cvtepi8_epi16(va);
+      wb = _mm256_cvtepi8_epi16(vb);
+    } else {
+      wa = _mm256_cvtepu8_epi16(va);
+      wb = _mm256_cvtepu8_epi16(vb);
+    }
+    if constexpr (L2) {
+      __m256i d = _mm256_sub_epi16(wa, wb);
+      acc       = _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+    } else {
+      acc = _mm256_add_epi32(acc, _mm256_madd_epi16(wa, wb));
+    }
+  }
+  __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+  sum         = _mm_hadd_epi32(sum, sum);
+  sum         = _mm_hadd_epi32(sum, sum);
+  int32_t res = _mm_cvtsi128_si32(sum);
+  for (; i < dim; i++) {
+    int32_t x = a[i];
+    int32_t y = b[i];
+    res += L2 ? (x - y) * (x - y) : x * y;
+  }
+  return L2 ? float(res) : -float(res);
+}
+
+/** AVX-512: as the AVX2 kernel, 32 values per iteration and a masked load of the tail. */
+template <typename T, bool L2>
+__attribute__((target("avx512f,avx512bw,avx512vl"))) auto row_distance_i8_avx512(const T* a,
+                                                                                 const T* b,
+                                                                                 size_t dim)
+  -> float
+{
+  __m512i acc = _mm512_setzero_si512();
+  for (size_t i = 0; i < dim; i += 32) {
+    __mmask32 mask = dim - i >= 32 ? __mmask32(0xffffffff) : __mmask32((1u << (dim - i)) - 1);
+    __m256i va     = _mm256_maskz_loadu_epi8(mask, a + i);
+    __m256i vb     = _mm256_maskz_loadu_epi8(mask, b + i);
+    __m512i wa, wb;
+    if constexpr (std::is_signed_v<T>) {
+      wa = _mm512_cvtepi8_epi16(va);
+      wb = _mm512_cvtepi8_epi16(vb);
+    } else {
+      wa = _mm512_cvtepu8_epi16(va);
+      wb = _mm512_cvtepu8_epi16(vb);
+    }
+    if constexpr (L2) {
+      __m512i d = _mm512_sub_epi16(wa, wb);
+      acc       = _mm512_add_epi32(acc, _mm512_madd_epi16(d, d));
+    } else {
+      acc = _mm512_add_epi32(acc, _mm512_madd_epi16(wa, wb));
+    }
+  }
+  alignas(64) int32_t lanes[16];
+  _mm512_store_si512(lanes, acc);
+  int32_t res = 0;
+  for (int32_t lane : lanes) {
+    res += lane;
+  }
+  return L2 ? float(res) : -float(res);
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+template <bool L2>
+auto row_distance_f32_neon(const float* a, const float* b, size_t dim) -> float
+{
+  float32x4_t acc0 = vdupq_n_f32(0);
+  float32x4_t acc1 = vdupq_n_f32(0);
+  size_t i         = 0;
+  for (; i + 8 <= dim; i += 8) {
+    float32x4_t a0 = vld1q_f32(a + i);
+    float32x4_t b0 = vld1q_f32(b + i);
+    float32x4_t a1 = vld1q_f32(a + i + 4);
+    float32x4_t b1 = vld1q_f32(b + i + 4);
+    if constexpr (L2) {
+      float32x4_t d0 = vsubq_f32(a0, b0);
+      float32x4_t d1 = vsubq_f32(a1, b1);
+      acc0           = vfmaq_f32(acc0, d0, d0);
+      acc1           = vfmaq_f32(acc1, d1, d1);
+    } else {
+      acc0 = vfmaq_f32(acc0, a0, b0);
+      acc1 = vfmaq_f32(acc1, a1, b1);
+    }
+  }
+  float res = vaddvq_f32(vaddq_f32(acc0, acc1));
+  for (; i < dim; i++) {
+    if constexpr (L2) {
+      float d = a[i] - b[i];
+      res += d * d;
+    } else {
+      res += a[i] * b[i];
+    }
+  }
+  return L2 ? res : -res;
+}
+
+/** NEON: the 8-bit products are widened to 16 bit (`vmull`) and pairwise-accumulated in 32 bit. */
+template <typename T, bool L2>
+auto row_distance_i8_neon(const T* a, const T* b, size_t dim) -> float
+{
+  int64_t res = 0;
+  size_t i    = 0;
+  if constexpr (std::is_signed_v<T>) {
+    int32x4_t acc = vdupq_n_s32(0);
+    for (; i + 16 <= dim; i += 16) {
+      int8x16_t va = vld1q_s8(a + i);
+      int8x16_t vb = vld1q_s8(b + i);
+      if constexpr (L2) {
+        int16x8_t d_lo = vsubl_s8(vget_low_s8(va), vget_low_s8(vb));
+        int16x8_t d_hi = vsubl_high_s8(va, vb);
+        acc            = vmlal_s16(acc, vget_low_s16(d_lo), vget_low_s16(d_lo));
+        acc            = vmlal_high_s16(acc, d_lo, d_lo);
+        acc            = vmlal_s16(acc, vget_low_s16(d_hi), vget_low_s16(d_hi));
+        acc            = vmlal_high_s16(acc, d_hi, d_hi);
+      } else {
+        acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc = vpadalq_s16(acc, vmull_high_s8(va, vb));
+      }
+    }
+    res = vaddvq_s32(acc);
+  } else {
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 16 <= dim; i += 16) {
+      uint8x16_t va = vld1q_u8(a + i);
+      uint8x16_t vb = vld1q_u8(b + i);
+      if constexpr (L2) {
+        uint8x16_t d = vabdq_u8(va, vb);
+        acc          = vpadalq_u16(acc, vmull_u8(vget_low_u8(d), vget_low_u8(d)));
+        acc          = vpadalq_u16(acc, vmull_high_u8(d, d));
+      } else {
+        acc = vpadalq_u16(acc, vmull_u8(vget_low_u8(va), vget_low_u8(vb)));
+        acc = vpadalq_u16(acc, vmull_high_u8(va, vb));
+      }
+    }
+    res = vaddvq_u32(acc);
+  }
+  for (; i < dim; i++) {
+    int32_t x = a[i];
+    int32_t y = b[i];
+    res += L2 ? (x - y) * (x - y) : x * y;
+  }
+  return L2 ? float(res) : -float(res);
+}
+
+#endif
+
+/**
+ * The fastest row distance function for the given metric and data type supported by the host CPU
+ * (selected once per call of the refinement). The SIMD kernels are only used with the float
+ * distances; the other cases fall back to the auto-vectorized scalar loop.
+ */
+template <typename DC, typename DataT, typename DistanceT>
+auto select_row_distance() -> row_distance_func<DataT, DistanceT>
+{
+  constexpr bool kL2 = std::is_same_v<DC, distance_comp_l2>;
+  [[maybe_unused]] constexpr bool kSimd =
+    std::is_same_v<DistanceT, float> &&
+    (std::is_same_v<DC, distance_comp_l2> || std::is_same_v<DC, distance_comp_inner>);
+#if defined(__x86_64__)
+  if constexpr (kSimd && std::is_same_v<DataT, float>) {
+    if (__builtin_cpu_supports("avx512f")) { return row_distance_f32_avx512<kL2>; }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+      return row_distance_f32_avx2<kL2>;
+    }
+  } else if constexpr (kSimd && (std::is_same_v<DataT, int8_t> || std::is_same_v<DataT, uint8_t>)) {
+    if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) {
+      return row_distance_blocked<DataT, row_distance_i8_avx512<DataT, kL2>>;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      return row_distance_blocked<DataT, row_distance_i8_avx2<DataT, kL2>>;
+    }
+  }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  if constexpr (kSimd && std::is_same_v<DataT, float>) {
+    return row_distance_f32_neon<kL2>;
+  } else if constexpr (kSimd && (std::is_same_v<DataT, int8_t> || std::is_same_v<DataT, uint8_t>)) {
+    return row_distance_blocked<DataT, row_distance_i8_neon<DataT, kL2>>;
+  }
+#endif
+  return row_distance_scalar<DC, DataT, DistanceT>;
+}
+
+/** Prefetch a dataset row (e.g. the next candidate) into the cache. */
+template <typename DataT>
+inline void prefetch_row(const DataT* row, size_t dim)
+{
+  constexpr size_t kCacheLine = 64;
+  auto bytes                  = reinterpret_cast<const char*>(row);
+  for (size_t offset = 0; offset < dim * sizeof(DataT); offset += kCacheLine) {
+    __builtin_prefetch(bytes + offset);
+  }
+}
+
+}  // namespace raft::neighbors::detail
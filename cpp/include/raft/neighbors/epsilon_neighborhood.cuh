@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,11 +19,15 @@
 
 #pragma once
 
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
 #include <raft/spatial/knn/detail/epsilon_neighborhood.cuh>
 
+#include <cstddef>
+
 namespace raft::neighbors::epsilon_neighborhood {
 
 /**
@@ -116,6 +120,64 @@ void eps_neighbors_l2sq(raft::resources const& handle,
                                            resource::get_cuda_stream(handle));
 }
 
+/**
+ * @brief Computes epsilon neighborhood for an expanded distance metric into a CSR matrix.
+ *
+ * Unlike `eps_neighbors_l2sq`, the dense `m x n` adjacency is never allocated: the rows of `x` are
+ * processed in batches whose distances to `y` fit `max_workspace_bytes`, and the neighbors of
+ * every batch are compacted into the column indices of the CSR matrix, so that the memory grows
+ * with the number of edges rather than with `m * n`.
+ *
+ * @code{.cpp}
+ *  #include <raft/neighbors/epsilon_neighborhood.cuh>
+ *  #include <raft/core/device_csr_matrix.hpp>
+ *  using namespace raft::neighbors;
+ *  raft::resources handle;
+ *  ...
+ *  auto adj = raft::make_device_csr_matrix<bool, int64_t, int64_t, int64_t>(handle, m, n);
+ *  epsilon_neighborhood::eps_neighbors(
+ *    handle, x, y, adj, eps, raft::distance::DistanceType::CosineExpanded);
+ *  // adj.structure_view().get_indptr() / get_indices() hold the neighborhoods of the rows of x
+ * @endcode
+ *
+ * @tparam value_t   IO and math type
+ * @tparam idx_t    Index type
+ * @tparam matrix_idx_t matrix indexing type
+ *
+ * @param[in]  handle raft handle to manage library resources
+ * @param[in]  x      first matrix [row-major] [on device] [dim = m x k]
+ * @param[in]  y      second matrix [row-major] [on device] [dim = n x k]
+ * @param[out] adj    sparsity-owning adjacency matrix [dim = m x n]; its sparsity is initialized
+ *                    by this function and all its elements are set to `true`
+ * @param[in]  eps    defines epsilon neighborhood radius, in the units of the metric (squared for
+ *                    L2Expanded); for InnerProduct, the minimum similarity of the neighbors
+ * @param[in]  metric one of L2Expanded, L2SqrtExpanded, CosineExpanded, CorrelationExpanded or
+ *                    InnerProduct
+ * @param[in]  max_workspace_bytes the bound of the temporary distances of a batch of rows of x;
+ *                    the CSR output and its row offsets come on top
+ */
+template <typename value_t, typename idx_t, typename matrix_idx_t>
+void eps_neighbors(raft::resources const& handle,
+                   raft::device_matrix_view<const value_t, matrix_idx_t, row_major> x,
+                   raft::device_matrix_view<const value_t, matrix_idx_t, row_major> y,
+                   raft::device_csr_matrix<bool, idx_t, idx_t, idx_t>& adj,
+                   value_t eps,
+                   raft::distance::DistanceType metric = raft::distance::DistanceType::L2Expanded,
+                   std::size_t max_workspace_bytes     = std::size_t{1} << 30)
+{
+  RAFT_EXPECTS(x.extent(1) == y.extent(1), "x and y must have the same number of columns");
+  spatial::knn::detail::epsNeighborhoodCsr<value_t, idx_t>(handle,
+                                                           x.data_handle(),
+                                                           y.data_handle(),
+                                                           x.extent(0),
+                                                           y.extent(0),
+                                                           x.extent(1),
+                                                           eps,
+                                                           metric,
+                                                           max_workspace_bytes,
+                                                           adj);
+}
+
 /** @} */  // end group epsilon_neighbors
 
 }  // namespace raft::neighbors::epsilon_neighborhood
@@ -34,16 +34,20 @@ namespace raft::neighbors::hnsw {
  */
 
 /**
- * @brief Construct an hnswlib base-layer-only index from a CAGRA index
+ * @brief Construct an hnswlib index from a CAGRA index
  * NOTE: 1. This method uses the filesystem to write the CAGRA index in `/tmp/cagra_index.bin`
  * before reading it as an hnswlib index, then deleting the temporary file.
  *       2. This function is only offered as a compiled symbol in `libraft.so`
  *
+ * By default, the index is base-layer-only; with `params.hierarchy = HnswHierarchy::GPU` the upper
+ * layers of a full hierarchical index are built on the GPU (see `cagra::serialize_to_hnswlib`).
+ *
  * @tparam T data element type
  * @tparam IdxT type of the indices
  *
  * @param[in] res raft resources
  * @param[in] cagra_index cagra index
+ * @param[in] params how the upper layers of the hnswlib index are constructed
  *
  * Usage example:
  * @code{.cpp}
@@ -54,28 +58,37 @@ namespace raft::neighbors::hnsw {
  *   // create and fill the index from a [N, D] dataset
  *   auto index = cagra::build(res, index_params, dataset);
  *
- *   // Load CAGRA index as base-layer-only hnswlib index
- *   auto hnsw_index = hnsw::from_cagra(res, index);
+ *   // Load CAGRA index as a hierarchical hnswlib index
+ *   hnsw::index_params hnsw_params;
+ *   hnsw_params.hierarchy = hnsw::HnswHierarchy::GPU;
+ *   auto hnsw_index = hnsw::from_cagra(res, index, hnsw_params);
  * @endcode
  */
 template <typename T, typename IdxT>
 std::unique_ptr<index<T>> from_cagra(raft::resources const& res,
-                                     raft::neighbors::cagra::index<T, IdxT> cagra_index);
+                                     raft::neighbors::cagra::index<T, IdxT> cagra_index,
+                                     const index_params& params = index_params{});
 
 template <>
 std::unique_ptr<index<float>> from_cagra(
-  raft::resources const& res, raft::neighbors::cagra::index<float, uint32_t> cagra_index);
+  raft::resources const& res,
+  raft::neighbors::cagra::index<float, uint32_t> cagra_index,
+  const index_params& params);
 
 template <>
 std::unique_ptr<index<int8_t>> from_cagra(
-  raft::resources const& res, raft::neighbors::cagra::index<int8_t, uint32_t> cagra_index);
+  raft::resources const& res,
+  raft::neighbors::cagra::index<int8_t, uint32_t> cagra_index,
+  const index_params& params);
 
 template <>
 std::unique_ptr<index<uint8_t>> from_cagra(
-  raft::resources const& res, raft::neighbors::cagra::index<uint8_t, uint32_t> cagra_index);
+  raft::resources const& res,
+  raft::neighbors::cagra::index<uint8_t, uint32_t> cagra_index,
+  const index_params& params);
 
 /**
- * @brief Search hnswlib base-layer-only index constructed from a CAGRA index
+ * @brief Search an hnswlib index constructed from a CAGRA index
  *
  * @tparam T data element type
  * @tparam IdxT type of the indices
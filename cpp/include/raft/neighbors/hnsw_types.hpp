@@ -31,10 +31,30 @@ namespace raft::neighbors::hnsw {
  * @{
  */
 
+/** How the upper (hierarchical) layers of an hnswlib index are built from a CAGRA index. */
+enum class HnswHierarchy {
+  /**
+   * A base-layer-only index: the CAGRA graph is the only layer, the search starts from a fixed set
+   * of seeds spread over the dataset.
+   */
+  NONE,
+  /**
+   * A full hierarchical index: the levels of the nodes are sampled like in hnswlib and the graphs
+   * of the upper layers are the exact kNN graphs of their nodes, computed on the GPU.
+   */
+  GPU
+};
+
+struct index_params {
+  /** How the upper layers of the index are constructed. */
+  HnswHierarchy hierarchy = HnswHierarchy::NONE;
+};
+
 struct search_params : ann::search_params {
-  int ef;               // size of the candidate list
-  int num_threads = 0;  // number of host threads to use for concurrent searches. Value of 0
-                        // automatically maximizes parallelism
+  int ef          = 200;  // size of the candidate list (k is used when ef < k). The default is
+                          // the one of the pylibraft SearchParams
+  int num_threads = 0;    // number of host threads to use for concurrent searches. Value of 0
+                          // automatically maximizes parallelism
 };
 
 template <typename T>
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,8 @@
 
 #include <cstdint>  // int64_t
 
+#include <cuda_fp16.h>  // half
+
 #include <raft/core/device_mdspan.hpp>  // raft::device_matrix_view
 #include <raft/core/resources.hpp>      // raft::resources
 #include <raft/neighbors/ivf_flat_serialize.cuh>
@@ -139,6 +141,17 @@ void search(raft::resources const& handle,
             raft::device_matrix_view<IdxT, IdxT, row_major> neighbors,
             raft::device_matrix_view<float, IdxT, row_major> distances) RAFT_EXPLICIT;
 
+template <typename T, typename IdxT>
+void search(raft::resources const& handle,
+            const search_params& params,
+            const index<T, IdxT>& index,
+            raft::device_matrix_view<const T, IdxT, row_major> queries,
+            raft::device_matrix_view<IdxT, IdxT, row_major> neighbors,
+            raft::device_matrix_view<float, IdxT, row_major> distances,
+            raft::device_vector_view<const uint32_t, IdxT> query_n_probes,
+            std::optional<raft::device_vector_view<const uint32_t, IdxT>> query_k =
+              std::nullopt) RAFT_EXPLICIT;
+
 }  // namespace raft::neighbors::ivf_flat
 
 #endif  // RAFT_EXPLICIT_INSTANTIATE_ONLY
@@ -177,6 +190,7 @@ void search(raft::resources const& handle,
     raft::neighbors::ivf_flat::index<T, IdxT>& idx);
 
 instantiate_raft_neighbors_ivf_flat_build(float, int64_t);
+instantiate_raft_neighbors_ivf_flat_build(half, int64_t);
 instantiate_raft_neighbors_ivf_flat_build(int8_t, int64_t);
 instantiate_raft_neighbors_ivf_flat_build(uint8_t, int64_t);
 #undef instantiate_raft_neighbors_ivf_flat_build
@@ -224,6 +238,7 @@ instantiate_raft_neighbors_ivf_flat_build(uint8_t, int64_t);
     ->raft::neighbors::ivf_flat::index<T, IdxT>;
 
 instantiate_raft_neighbors_ivf_flat_extend(float, int64_t);
+instantiate_raft_neighbors_ivf_flat_extend(half, int64_t);
 instantiate_raft_neighbors_ivf_flat_extend(int8_t, int64_t);
 instantiate_raft_neighbors_ivf_flat_extend(uint8_t, int64_t);
 
@@ -247,9 +262,20 @@ instantiate_raft_neighbors_ivf_flat_extend(uint8_t, int64_t);
     const raft::neighbors::ivf_flat::index<T, IdxT>& index,        \
     raft::device_matrix_view<const T, IdxT, row_major> queries,    \
     raft::device_matrix_view<IdxT, IdxT, row_major> neighbors,     \
-    raft::device_matrix_view<float, IdxT, row_major> distances);
+    raft::device_matrix_view<float, IdxT, row_major> distances);   \
+                                                                   \
+  extern template void raft::neighbors::ivf_flat::search<T, IdxT>( \
+    raft::resources const& handle,                                 \
+    const raft::neighbors::ivf_flat::search_params& params,        \
+    const raft::neighbors::ivf_flat::index<T, IdxT>& index,        \
+    raft::device_matrix_view<const T, IdxT, row_major> queries,    \
+    raft::device_matrix_view<IdxT, IdxT, row_major> neighbors,     \
+    raft::device_matrix_view<float, IdxT, row_major> distances,    \
+    raft::device_vector_view<const uint32_t, IdxT> query_n_probes, \
+    std::optional<raft::device_vector_view<const uint32_t, IdxT>> query_k)
 
 instantiate_raft_neighbors_ivf_flat_search(float, int64_t);
+instantiate_raft_neighbors_ivf_flat_search(half, int64_t);
 instantiate_raft_neighbors_ivf_flat_search(int8_t, int64_t);
 instantiate_raft_neighbors_ivf_flat_search(uint8_t, int64_t);
 
@@ -36,6 +36,7 @@ namespace raft::neighbors::ivf_flat {
  * - L2Expanded
  * - L2Unexpanded
  * - InnerProduct
+ * - CosineExpanded (floating-point data only: the lists hold the normalized vectors)
  *
  * Usage example:
  * @code{.cpp}
@@ -83,6 +84,7 @@ auto build(raft::resources const& handle,
  * - L2Expanded
  * - L2Unexpanded
  * - InnerProduct
+ * - CosineExpanded (floating-point data only: the lists hold the normalized vectors)
  *
  * Usage example:
  * @code{.cpp}
@@ -139,6 +141,7 @@ auto build(raft::resources const& handle,
  * - L2Expanded
  * - L2Unexpanded
  * - InnerProduct
+ * - CosineExpanded (floating-point data only: the lists hold the normalized vectors)
  *
  * Usage example:
  * @code{.cpp}
@@ -660,6 +663,85 @@ void search(raft::resources const& handle,
                         raft::neighbors::filtering::none_ivf_sample_filter());
 }
 
+/**
+ * @brief Search ANN using the constructed index, with a number of probes (and of neighbors) per
+ * query.
+ *
+ * This lets a batch of queries of mixed quality requirements share a single search: the query `i`
+ * probes its `query_n_probes[i]` closest lists only. `params.n_probes` is the largest number of
+ * probes per query; the larger values of `query_n_probes` are capped to it.
+ *
+ * With `query_k`, the query `i` keeps its `query_k[i]` nearest neighbors, and the rest of its row
+ * in `neighbors` and `distances` (of `k = neighbors.extent(1)` columns, the largest number of
+ * neighbors per query) is padded with `ivf::kInvalidRecord` and the worst distance of the metric
+ * (the largest float, or the lowest for the similarities).
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   ivf_flat::search_params search_params;
+ *   search_params.n_probes = 64;  // the largest number of probes per query
+ *   // query_n_probes[i] <= 64, query_k[i] <= neighbors.extent(1)
+ *   ivf_flat::search(handle, search_params, index, queries, neighbors, distances,
+ *                    raft::make_const_mdspan(query_n_probes.view()),
+ *                    std::make_optional(raft::make_const_mdspan(query_k.view())));
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] handle
+ * @param[in] params configure the search
+ * @param[in] index ivf-flat constructed index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors [n_queries,
+ * k]
+ * @param[in] query_n_probes a device vector view to the number of probes of every query
+ * [n_queries]
+ * @param[in] query_k an optional device vector view to the number of neighbors of every query
+ * [n_queries]
+ */
+template <typename T, typename IdxT>
+void search(raft::resources const& handle,
+            const search_params& params,
+            const index<T, IdxT>& index,
+            raft::device_matrix_view<const T, IdxT, row_major> queries,
+            raft::device_matrix_view<IdxT, IdxT, row_major> neighbors,
+            raft::device_matrix_view<float, IdxT, row_major> distances,
+            raft::device_vector_view<const uint32_t, IdxT> query_n_probes,
+            std::optional<raft::device_vector_view<const uint32_t, IdxT>> query_k = std::nullopt)
+{
+  RAFT_EXPECTS(
+    queries.extent(0) == neighbors.extent(0) && queries.extent(0) == distances.extent(0),
+    "Number of rows in output neighbors and distances matrices must equal the number of queries.");
+
+  RAFT_EXPECTS(neighbors.extent(1) == distances.extent(1),
+               "Number of columns in output neighbors and distances matrices must be equal");
+
+  RAFT_EXPECTS(queries.extent(1) == index.dim(),
+               "Number of query dimensions should equal number of dimensions in the index.");
+
+  RAFT_EXPECTS(query_n_probes.extent(0) == queries.extent(0),
+               "query_n_probes must have a value per query.");
+  RAFT_EXPECTS(!query_k.has_value() || query_k->extent(0) == queries.extent(0),
+               "query_k must have a value per query.");
+
+  raft::neighbors::ivf_flat::detail::search(handle,
+                                            params,
+                                            index,
+                                            queries.data_handle(),
+                                            static_cast<std::uint32_t>(queries.extent(0)),
+                                            static_cast<std::uint32_t>(neighbors.extent(1)),
+                                            neighbors.data_handle(),
+                                            distances.data_handle(),
+                                            resource::get_workspace_resource(handle),
+                                            raft::neighbors::filtering::none_ivf_sample_filter(),
+                                            query_n_probes.data_handle(),
+                                            query_k.has_value() ? query_k->data_handle() : nullptr);
+}
+
 /** @} */
 
 }  // namespace raft::neighbors::ivf_flat
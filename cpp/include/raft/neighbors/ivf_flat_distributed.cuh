@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/cluster/kmeans_balanced.cuh>
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/linalg/norm.cuh>
+#include <raft/matrix/detail/sample_rows.cuh>
+#include <raft/matrix/gather.cuh>
+#include <raft/matrix/init.cuh>
+#include <raft/matrix/select_k.cuh>
+#include <raft/neighbors/brute_force.cuh>
+#include <raft/neighbors/detail/comms_utils.cuh>
+#include <raft/neighbors/ivf_flat.cuh>
+#include <raft/neighbors/ivf_flat_types.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace raft::neighbors::ivf_flat {
+
+/**
+ * @defgroup ivf_flat_distributed IVF-Flat index distributed across a comms clique
+ * @{
+ */
+
+/**
+ * @brief An IVF-Flat index whose lists are partitioned across the ranks of a communicator.
+ *
+ * Every rank holds the same coarse quantizer (all the `n_lists` centers), but only the lists it
+ * owns contain data: the list `l` is owned by the rank `l % n_ranks`. The index of every rank is
+ * a regular `ivf_flat::index` (the lists it does not own are empty) storing the global ids of
+ * the dataset rows. Use `ivf_flat::build_distributed` to construct it and
+ * `ivf_flat::search_distributed` to query it; both are collective over the communicator of the
+ * resources.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ */
+template <typename T, typename IdxT>
+struct distributed_index {
+  /** The local part of the index: all the centers, and the lists owned by this rank. */
+  index<T, IdxT> local;
+  /** The total number of rows of the dataset over all the ranks. */
+  IdxT global_size;
+
+  /** The rank owning a list. */
+  [[nodiscard]] static auto owner(uint32_t list, int n_ranks) -> int { return list % n_ranks; }
+};
+
+namespace detail {
+using raft::neighbors::detail::all_to_all;
+using raft::neighbors::detail::exchange_counts;
+}  // namespace detail
+
+/**
+ * @brief Build an IVF-Flat index distributed across the ranks of the communicator of `handle`.
+ *
+ * Every rank passes its own shard of the dataset; the shards are numbered in the order of the
+ * ranks, so that the global id of a row is its position in the concatenation of the shards.
+ *
+ * 1. The coarse quantizer is trained once, with `kmeans_balanced`, on the union of subsamples
+ *    of all the shards (gathered to the rank 0), and broadcast to all the ranks.
+ * 2. Every rank assigns its rows to the lists and sends them (with their global ids) to the
+ *    ranks owning these lists, which add them to their local index.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] handle the raft resources, with an initialized communicator
+ * @param[in] params configure the index building (`adaptive_centers` is not supported and
+ *   `add_data_on_build` is ignored: the data is always added)
+ * @param[in] dataset the local shard of the dataset [n_local_rows, dim]
+ *
+ * @return the local part of the distributed index
+ */
+template <typename T, typename IdxT>
+auto build_distributed(raft::resources const& handle,
+                       const index_params& params,
+                       raft::device_matrix_view<const T, IdxT, row_major> dataset)
+  -> distributed_index<T, IdxT>
+{
+  const auto& comms = resource::get_comms(handle);
+  auto stream       = resource::get_cuda_stream(handle);
+  int rank          = comms.get_rank();
+  int size          = comms.get_size();
+  IdxT n_local      = dataset.extent(0);
+  uint32_t dim      = dataset.extent(1);
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_flat::build_distributed(%zu, %u)", size_t(n_local), dim);
+  RAFT_EXPECTS(!params.adaptive_centers,
+               "adaptive_centers is not supported by the distributed index");
+
+  // the global offsets of the shards
+  std::vector<size_t> shard_sizes = detail::exchange_counts(
+    comms, std::vector<size_t>(size, size_t(n_local)), stream);
+  size_t n_total    = std::accumulate(shard_sizes.begin(), shard_sizes.end(), size_t(0));
+  size_t row_offset = std::accumulate(shard_sizes.begin(), shard_sizes.begin() + rank, size_t(0));
+  RAFT_EXPECTS(n_total >= params.n_lists, "number of rows can't be less than n_lists");
+
+  distributed_index<T, IdxT> result{
+    index<T, IdxT>(
+      handle, params.metric, params.n_lists, false, params.conservative_memory_allocation, dim),
+    IdxT(n_total)};
+  auto& local = result.local;
+  spatial::knn::detail::utils::memzero(
+    local.list_sizes().data_handle(), local.list_sizes().size(), stream);
+  spatial::knn::detail::utils::memzero(
+    local.data_ptrs().data_handle(), local.data_ptrs().size(), stream);
+  spatial::knn::detail::utils::memzero(
+    local.inds_ptrs().data_handle(), local.inds_ptrs().size(), stream);
+
+  // 1. the coarse quantizer, trained on the union of the subsamples of the shards
+  {
+    auto trainset_ratio = std::max<size_t>(
+      1, n_total / std::max<size_t>(params.kmeans_trainset_fraction * n_total, params.n_lists));
+    size_t n_train = n_local / trainset_ratio;
+    rmm::device_uvector<T> trainset(n_train * dim, stream);
+    if (n_train > 0) {
+      // different rows on every rank
+      raft::random::RngState random_state{137 + uint64_t(rank)};
+      raft::matrix::detail::sample_rows<T, IdxT>(handle,
+                                                 random_state,
+                                                 dataset.data_handle(),
+                                                 IdxT(n_local),
+                                                 IdxT(dim),
+                                                 trainset.data(),
+                                                 IdxT(n_train));
+    }
+    auto train_sizes = detail::exchange_counts(comms, std::vector<size_t>(size, n_train), stream);
+    std::vector<size_t> recvcounts(size), displs(size);
+    size_t n_train_total = 0;
+    for (int r = 0; r < size; r++) {
+      recvcounts[r] = train_sizes[r] * dim;
+      displs[r]     = n_train_total * dim;
+      n_train_total += train_sizes[r];
+    }
+    RAFT_EXPECTS(n_train_total >= params.n_lists, "the trainset is smaller than n_lists");
+    rmm::device_uvector<T> full_trainset(rank == 0 ? n_train_total * dim : 0, stream);
+    comms.gatherv(trainset.data(),
+                  full_trainset.data(),
+                  n_train * dim,
+                  recvcounts.data(),
+                  displs.data(),
+                  0,
+                  stream);
+    if (rank == 0) {
+      raft::cluster::kmeans_balanced_params kmeans_params;
+      kmeans_params.n_iters = params.kmeans_n_iters;
+      kmeans_params.metric  = params.metric;
+      raft::cluster::kmeans_balanced::fit(
+        handle,
+        kmeans_params,
+        raft::make_device_matrix_view<const T, IdxT>(full_trainset.data(), n_train_total, dim),
+        raft::make_device_matrix_view<float, IdxT>(
+          local.centers().data_handle(), local.n_lists(), dim),
+        spatial::knn::detail::utils::mapping<float>{});
+    }
+    comms.bcast(local.centers().data_handle(), local.centers().size(), 0, stream);
+    comms.sync_stream(stream);
+  }
+  local.allocate_center_norms(handle);
+  if (local.center_norms().has_value()) {
+    raft::linalg::rowNorm(local.center_norms()->data_handle(),
+                          local.centers().data_handle(),
+                          dim,
+                          local.n_lists(),
+                          raft::linalg::L2Norm,
+                          true,
+                          stream);
+  }
+
+  // 2. the rows, sent to the owners of their lists
+  auto labels = raft::make_device_vector<uint32_t, IdxT>(handle, n_local);
+  if (n_local > 0) {
+    raft::cluster::kmeans_balanced_params kmeans_params;
+    kmeans_params.metric = params.metric;
+    raft::cluster::kmeans_balanced::predict(
+      handle,
+      kmeans_params,
+      dataset,
+      raft::make_device_matrix_view<const float, IdxT>(
+        local.centers().data_handle(), local.n_lists(), dim),
+      labels.view(),
+      spatial::knn::detail::utils::mapping<float>{});
+  }
+  std::vector<uint32_t> h_labels(n_local);
+  raft::update_host(h_labels.data(), labels.data_handle(), n_local, stream);
+  resource::sync_stream(handle);
+
+  std::vector<size_t> send_counts(size, 0);
+  for (auto l : h_labels) {
+    send_counts[distributed_index<T, IdxT>::owner(l, size)]++;
+  }
+  std::vector<IdxT> h_order(n_local), h_ids(n_local);
+  {
+    std::vector<size_t> pos(size, 0);
+    std::exclusive_scan(send_counts.begin(), send_counts.end(), pos.begin(), size_t(0));
+    for (IdxT i = 0; i < n_local; i++) {
+      auto p     = pos[distributed_index<T, IdxT>::owner(h_labels[i], size)]++;
+      h_order[p] = i;
+      h_ids[p]   = IdxT(row_offset) + i;
+    }
+  }
+  auto order     = raft::make_device_vector<IdxT, IdxT>(handle, n_local);
+  auto send_ids  = raft::make_device_vector<IdxT, IdxT>(handle, n_local);
+  auto send_rows = raft::make_device_matrix<T, IdxT>(handle, n_local, dim);
+  raft::update_device(order.data_handle(), h_order.data(), n_local, stream);
+  raft::update_device(send_ids.data_handle(), h_ids.data(), n_local, stream);
+  if (n_local > 0) {
+    raft::matrix::gather(handle, dataset, raft::make_const_mdspan(order.view()), send_rows.view());
+  }
+
+  auto recv_counts = detail::exchange_counts(comms, send_counts, stream);
+  IdxT n_recv      = std::accumulate(recv_counts.begin(), recv_counts.end(), size_t(0));
+  auto recv_rows   = raft::make_device_matrix<T, IdxT>(handle, n_recv, dim);
+  auto recv_ids    = raft::make_device_vector<IdxT, IdxT>(handle, n_recv);
+  detail::all_to_all(
+    comms, send_rows.data_handle(), send_counts, recv_rows.data_handle(), recv_counts, dim, stream);
+  detail::all_to_all(
+    comms, send_ids.data_handle(), send_counts, recv_ids.data_handle(), recv_counts, 1, stream);
+  comms.sync_stream(stream);
+
+  if (n_recv > 0) {
+    ivf_flat::extend(handle,
+                     raft::make_const_mdspan(recv_rows.view()),
+                     std::make_optional(raft::make_const_mdspan(recv_ids.view())),
+                     &local);
+  }
+  return result;
+}
+
+/**
+ * @brief Search a distributed IVF-Flat index.
+ *
+ * Every rank passes its own queries and receives their neighbors among the whole distributed
+ * dataset. The probed lists of every query are selected locally with the coarse quantizer, and
+ * the query is sent only to the ranks owning at least one of them (so the work of a query is not
+ * replicated across all the ranks). The ranks search the queries they receive in their local
+ * lists and return their top-k, which are merged by the rank the query comes from.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] handle the raft resources, with an initialized communicator
+ * @param[in] params configure the search
+ * @param[in] index the local part of the distributed index
+ * @param[in] queries the local queries [n_queries, dim]
+ * @param[out] neighbors the global ids of the neighbors [n_queries, k]
+ * @param[out] distances the distances to the neighbors [n_queries, k]
+ */
+template <typename T, typename IdxT>
+void search_distributed(raft::resources const& handle,
+                        const search_params& params,
+                        const distributed_index<T, IdxT>& index,
+                        raft::device_matrix_view<const T, IdxT, row_major> queries,
+                        raft::device_matrix_view<IdxT, IdxT, row_major> neighbors,
+                        raft::device_matrix_view<float, IdxT, row_major> distances)
+{
+  const auto& comms = resource::get_comms(handle);
+  auto stream       = resource::get_cuda_stream(handle);
+  int size          = comms.get_size();
+  const auto& local = index.local;
+  IdxT n_queries    = queries.extent(0);
+  uint32_t dim      = local.dim();
+  uint32_t k        = neighbors.extent(1);
+  uint32_t n_probes = std::min(params.n_probes, local.n_lists());
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "ivf_flat::search_distributed(%zu, %u)", size_t(n_queries), k);
+  RAFT_EXPECTS(queries.extent(1) == IdxT(dim), "Number of query dimensions should match index");
+  RAFT_EXPECTS(distances.extent(0) == n_queries && distances.extent(1) == IdxT(k) &&
+                 neighbors.extent(0) == n_queries,
+               "Output shapes must match the number of queries and k");
+
+  // 1. the probed lists of the local queries, and the ranks owning them
+  auto probes = raft::make_device_matrix<IdxT, IdxT>(handle, n_queries, n_probes);
+  if (n_queries > 0) {
+    auto queries_f = raft::make_device_matrix<float, IdxT>(handle, n_queries, dim);
+    raft::linalg::map(handle,
+                      queries_f.view(),
+                      spatial::knn::detail::utils::mapping<float>{},
+                      queries);
+    auto probe_dists = raft::make_device_matrix<float, IdxT>(handle, n_queries, n_probes);
+    std::vector<raft::device_matrix_view<const float, IdxT, row_major>> centers{
+      raft::make_device_matrix_view<const float, IdxT>(
+        local.centers().data_handle(), local.n_lists(), dim)};
+    raft::neighbors::brute_force::knn(handle,
+                                      centers,
+                                      raft::make_const_mdspan(queries_f.view()),
+                                      probes.view(),
+                                      probe_dists.view(),
+                                      local.metric());
+  }
+  std::vector<IdxT> h_probes(size_t(n_queries) * n_probes);
+  raft::update_host(h_probes.data(), probes.data_handle(), h_probes.size(), stream);
+  resource::sync_stream(handle);
+
+  // the queries sent to every rank, in the order of the ranks
+  std::vector<std::vector<IdxT>> routed(size);
+  std::vector<char> needed(size);
+  for (IdxT q = 0; q < n_queries; q++) {
+    std::fill(needed.begin(), needed.end(), 0);
+    for (uint32_t p = 0; p < n_probes; p++) {
+      needed[distributed_index<T, IdxT>::owner(h_probes[size_t(q) * n_probes + p], size)] = 1;
+    }
+    for (int r = 0; r < size; r++) {
+      if (needed[r]) { routed[r].push_back(q); }
+    }
+  }
+  std::vector<size_t> send_counts(size);
+  std::vector<IdxT> h_routed;
+  for (int r = 0; r < size; r++) {
+    send_counts[r] = routed[r].size();
+    h_routed.insert(h_routed.end(), routed[r].begin(), routed[r].end());
+  }
+  IdxT n_sent    = h_routed.size();
+  auto send_map  = raft::make_device_vector<IdxT, IdxT>(handle, n_sent);
+  auto send_rows = raft::make_device_matrix<T, IdxT>(handle, n_sent, dim);
+  raft::update_device(send_map.data_handle(), h_routed.data(), n_sent, stream);
+  if (n_sent > 0) {
+    raft::matrix::gather(
+      handle, queries, raft::make_const_mdspan(send_map.view()), send_rows.view());
+  }
+
+  // 2. the received queries, searched in the local lists
+  auto recv_counts = detail::exchange_counts(comms, send_counts, stream);
+  IdxT n_recv      = std::accumulate(recv_counts.begin(), recv_counts.end(), size_t(0));
+  auto recv_rows   = raft::make_device_matrix<T, IdxT>(handle, n_recv, dim);
+  detail::all_to_all(
+    comms, send_rows.data_handle(), send_counts, recv_rows.data_handle(), recv_counts, dim, stream);
+  comms.sync_stream(stream);
+
+  auto part_neighbors = raft::make_device_matrix<IdxT, IdxT>(handle, n_recv, k);
+  auto part_distances = raft::make_device_matrix<float, IdxT>(handle, n_recv, k);
+  if (n_recv > 0) {
+    ivf_flat::search(handle,
+                     params,
+                     local,
+                     raft::make_const_mdspan(recv_rows.view()),
+                     part_neighbors.view(),
+                     part_distances.view());
+  }
+
+  // 3. the partial results, returned to the ranks of the queries and merged
+  auto ret_neighbors = raft::make_device_matrix<IdxT, IdxT>(handle, n_sent, k);
+  auto ret_distances = raft::make_device_matrix<float, IdxT>(handle, n_sent, k);
+  detail::all_to_all(comms,
+                     part_neighbors.data_handle(),
+                     recv_counts,
+                     ret_neighbors.data_handle(),
+                     send_counts,
+                     k,
+                     stream);
+  detail::all_to_all(comms,
+                     part_distances.data_handle(),
+                     recv_counts,
+                     ret_distances.data_handle(),
+                     send_counts,
+                     k,
+                     stream);
+  comms.sync_stream(stream);
+  if (n_queries == 0) { return; }
+
+  // every query gets `size` slots of k candidates; the ranks it was not sent to keep the fill
+  bool select_min = local.metric() != raft::distance::DistanceType::InnerProduct;
+  auto fill_distance =
+    select_min ? std::numeric_limits<float>::max() : std::numeric_limits<float>::lowest();
+  auto cand_neighbors = raft::make_device_matrix<IdxT, int64_t>(handle, n_queries, size * k);
+  auto cand_distances = raft::make_device_matrix<float, int64_t>(handle, n_queries, size * k);
+  raft::matrix::fill(handle, cand_neighbors.view(), IdxT(-1));
+  raft::matrix::fill(handle, cand_distances.view(), fill_distance);
+  std::vector<IdxT> h_slots(n_sent);
+  for (int r = 0, i = 0; r < size; r++) {
+    for (auto q : routed[r]) {
+      h_slots[i++] = IdxT(q) * size + r;
+    }
+  }
+  auto slots = raft::make_device_vector<IdxT, IdxT>(handle, n_sent);
+  raft::update_device(slots.data_handle(), h_slots.data(), n_sent, stream);
+  if (n_sent > 0) {
+    auto slot_ptr      = slots.data_handle();
+    auto ret_nbr_ptr   = ret_neighbors.data_handle();
+    auto ret_dist_ptr  = ret_distances.data_handle();
+    auto cand_nbr_ptr  = cand_neighbors.data_handle();
+    auto cand_dist_ptr = cand_distances.data_handle();
+    thrust::for_each_n(resource::get_thrust_policy(handle),
+                       thrust::make_counting_iterator<size_t>(0),
+                       size_t(n_sent) * k,
+                       [=] __device__(size_t i) {
+                         size_t dst         = size_t(slot_ptr[i / k]) * k + i % k;
+                         cand_nbr_ptr[dst]  = ret_nbr_ptr[i];
+                         cand_dist_ptr[dst] = ret_dist_ptr[i];
+                       });
+  }
+  raft::matrix::select_k<float, IdxT>(
+    handle,
+    raft::make_const_mdspan(cand_distances.view()),
+    std::make_optional(raft::make_const_mdspan(cand_neighbors.view())),
+    raft::make_device_matrix_view<float, int64_t>(distances.data_handle(), n_queries, k),
+    raft::make_device_matrix_view<IdxT, int64_t>(neighbors.data_handle(), n_queries, k),
+    select_min,
+    true);
+}
+
+/** @} */
+
+}  // namespace raft::neighbors::ivf_flat
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -141,5 +141,142 @@ void reset_index(const raft::resources& res, index<T, IdxT>* index)
   utils::memzero(index->data_ptrs().data_handle(), index->data_ptrs().size(), stream);
   utils::memzero(index->inds_ptrs().data_handle(), index->inds_ptrs().size(), stream);
 }
+
+/**
+ * @brief Unpack the records of all lists into flat arrays laid out list by list, in one pass.
+ *
+ * The list `l` ends up in the rows `[list_offsets[l], list_offsets[l + 1])` of `codes` and
+ * `indices`; this is the layout of the `faiss::ArrayInvertedLists` of a `faiss::IndexIVFFlat`.
+ * Unlike a loop over the lists with `codepacker::unpack`, all lists are converted by a single
+ * kernel, which matters for the indices with very many lists.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   auto codes   = raft::make_device_matrix<float, int64_t>(res, index.size(), index.dim());
+ *   auto indices = raft::make_device_vector<int64_t, int64_t>(res, index.size());
+ *   auto offsets = raft::make_device_vector<int64_t, int64_t>(res, index.n_lists() + 1);
+ *   ivf_flat::helpers::unpack_all_lists(
+ *     res, index, codes.view(), indices.view(), offsets.view());
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resource
+ * @param[in] index the index to read
+ * @param[out] codes the records [index.size(), index.dim()]
+ * @param[out] indices the source indices of the records [index.size()]
+ * @param[out] list_offsets the offsets of the lists in `codes` and `indices` [index.n_lists() + 1]
+ */
+template <typename T, typename IdxT>
+void unpack_all_lists(raft::resources const& res,
+                      const index<T, IdxT>& index,
+                      device_matrix_view<T, int64_t, row_major> codes,
+                      device_vector_view<IdxT, int64_t> indices,
+                      device_vector_view<int64_t, int64_t> list_offsets)
+{
+  raft::neighbors::ivf_flat::detail::unpack_all_lists(res, index, codes, indices, list_offsets);
+}
+
+/**
+ * @brief Replace the lists of the index by the records laid out list by list, in one pass.
+ *
+ * The inverse of `unpack_all_lists`: the list `l` gets the rows
+ * `[list_offsets[l], list_offsets[l + 1])` of `codes` and `indices`. The lists are reallocated to
+ * fit the new records; the centers of the index are left intact, so the records should belong to
+ * the clusters of these centers (e.g. fill them with `ivf_flat::build` or copy them from the
+ * coarse quantizer of a `faiss::IndexIVFFlat`).
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   // an empty index with the centers of the FAISS quantizer
+ *   ivf_flat::index<float, int64_t> index(res, metric, n_lists, false, false, dim);
+ *   raft::copy(index.centers().data_handle(), centers, n_lists * dim, stream);
+ *   ivf_flat::helpers::pack_all_lists(res,
+ *                                     &index,
+ *                                     raft::make_const_mdspan(codes.view()),
+ *                                     raft::make_const_mdspan(indices.view()),
+ *                                     raft::make_const_mdspan(offsets.view()));
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resource
+ * @param[inout] index the index to fill
+ * @param[in] codes the records [n_rows, index.dim()]
+ * @param[in] indices the source indices of the records [n_rows]
+ * @param[in] list_offsets the offsets of the lists in `codes` and `indices` [index.n_lists() + 1]
+ */
+template <typename T, typename IdxT>
+void pack_all_lists(raft::resources const& res,
+                    index<T, IdxT>* index,
+                    device_matrix_view<const T, int64_t, row_major> codes,
+                    device_vector_view<const IdxT, int64_t> indices,
+                    device_vector_view<const int64_t, int64_t> list_offsets)
+{
+  raft::neighbors::ivf_flat::detail::pack_all_lists(res, index, codes, indices, list_offsets);
+}
+
+/**
+ * @brief Remove the records with the given source indices from the index in-place.
+ *
+ * The removed records are first only marked in a bitmask of their lists, which the searches check
+ * along with the sample filter; `index.size()` still counts them and `index.n_removed()` gives
+ * their number. The lists with at least `compaction_threshold` of their records removed are
+ * compacted right away: their removed records are overwritten by the last records of the lists
+ * (so the order of the records in a list changes). The other lists can be compacted later by
+ * `compact`. The indices not found in the index are ignored.
+ *
+ * The lists shared with a clone of the index are modified for both; only the index passed here
+ * updates its list sizes and pointers.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   // the source indices of the records to drop
+ *   auto ids = raft::make_device_vector<int64_t, int64_t>(res, n_ids);
+ *   ... fill the ids ...
+ *   // compact the lists once a quarter of their records is removed
+ *   auto n_removed = ivf_flat::helpers::remove(res, &index, raft::make_const_mdspan(ids.view()));
+ *   ...
+ *   // drop all removed records, e.g. before serializing the index
+ *   ivf_flat::helpers::compact(res, &index);
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resource
+ * @param[inout] index the index to modify
+ * @param[in] ids the source indices of the records to remove [n_ids] (device memory)
+ * @param[in] compaction_threshold the fraction of the removed records of a list above which the
+ *   list is compacted; zero compacts every list with removed records, above one none.
+ * @return the number of the records removed (not counting the ones removed before)
+ */
+template <typename T, typename IdxT>
+auto remove(raft::resources const& res,
+            index<T, IdxT>* index,
+            device_vector_view<const IdxT, int64_t> ids,
+            double compaction_threshold = 0.25) -> int64_t
+{
+  return raft::neighbors::ivf_flat::detail::remove(res, index, ids, compaction_threshold);
+}
+
+/**
+ * @brief Drop the records marked by `remove` from all lists of the index in-place.
+ *
+ * The serialization requires an index without the removed records.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resource
+ * @param[inout] index the index to compact
+ */
+template <typename T, typename IdxT>
+void compact(raft::resources const& res, index<T, IdxT>* index)
+{
+  raft::neighbors::ivf_flat::detail::compact(res, index, 0.0);
+}
 /** @} */
 }  // namespace raft::neighbors::ivf_flat::helpers
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -47,12 +47,17 @@ namespace raft::neighbors::ivf_flat {
  * @param[in] handle the raft handle
  * @param[in] os output stream
  * @param[in] index IVF-Flat index
+ * @param[in] compress whether to compress the source ids of the lists (bit-packed deltas, encoded
+ *   and decoded on the GPU)
  *
  */
 template <typename T, typename IdxT>
-void serialize(raft::resources const& handle, std::ostream& os, const index<T, IdxT>& index)
+void serialize(raft::resources const& handle,
+               std::ostream& os,
+               const index<T, IdxT>& index,
+               bool compress = false)
 {
-  detail::serialize(handle, os, index);
+  detail::serialize(handle, os, index, compress);
 }
 
 /**
@@ -77,14 +82,16 @@ void serialize(raft::resources const& handle, std::ostream& os, const index<T, I
  * @param[in] handle the raft handle
  * @param[in] filename the file name for saving the index
  * @param[in] index IVF-Flat index
+ * @param[in] compress whether to compress the source ids of the lists
  *
  */
 template <typename T, typename IdxT>
 void serialize(raft::resources const& handle,
                const std::string& filename,
-               const index<T, IdxT>& index)
+               const index<T, IdxT>& index,
+               bool compress = false)
 {
-  detail::serialize(handle, filename, index);
+  detail::serialize(handle, filename, index, compress);
 }
 
 /**
@@ -149,6 +156,125 @@ index<T, IdxT> deserialize(raft::resources const& handle, const std::string& fil
   return detail::deserialize<T, IdxT>(handle, filename);
 }
 
+/**
+ * Write the index to an output stream as a `faiss::IndexIVFFlat`.
+ *
+ * The stream can be read with `faiss::read_index` (e.g. via `faiss::VectorIOReader` or a
+ * `faiss::FileIOReader`): the index has an `IndexFlat` coarse quantizer holding the cluster
+ * centers and array inverted lists holding the records of the lists. The lists are converted to
+ * the flat FAISS layout on the device in one pass (see `helpers::unpack_all_lists`).
+ *
+ * Only the float indices with the L2 or inner product metrics can be written.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * // create an index with `auto index = ivf_flat::build(...);`
+ * std::ofstream of("/path/to/index.faiss", std::ios::out | std::ios::binary);
+ * ivf_flat::serialize_to_faiss(handle, of, index);
+ * @endcode
+ *
+ * @tparam T data element type (float)
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] handle the raft handle
+ * @param[in] os output stream
+ * @param[in] index IVF-Flat index
+ */
+template <typename T, typename IdxT>
+void serialize_to_faiss(raft::resources const& handle,
+                        std::ostream& os,
+                        const index<T, IdxT>& index)
+{
+  detail::serialize_to_faiss(handle, os, index);
+}
+
+/**
+ * Save the index to file as a `faiss::IndexIVFFlat`; see the stream overload.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * // create an index with `auto index = ivf_flat::build(...);`
+ * ivf_flat::serialize_to_faiss(handle, "/path/to/index.faiss", index);
+ * // in python: index = faiss.read_index("/path/to/index.faiss")
+ * @endcode
+ *
+ * @tparam T data element type (float)
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] handle the raft handle
+ * @param[in] filename the file name for saving the index
+ * @param[in] index IVF-Flat index
+ */
+template <typename T, typename IdxT>
+void serialize_to_faiss(raft::resources const& handle,
+                        const std::string& filename,
+                        const index<T, IdxT>& index)
+{
+  detail::serialize_to_faiss(handle, filename, index);
+}
+
+/**
+ * Load a `faiss::IndexIVFFlat` from an input stream.
+ *
+ * The stream must hold an index written by `faiss::write_index` (or `serialize_to_faiss`) with a
+ * flat coarse quantizer and array inverted lists, with the L2 or inner product metric. The
+ * records are copied to the device and packed into the lists in one pass (see
+ * `helpers::pack_all_lists`).
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * std::ifstream is("/path/to/index.faiss", std::ios::in | std::ios::binary);
+ * auto index = ivf_flat::deserialize_from_faiss<float, int64_t>(handle, is);
+ * @endcode
+ *
+ * @tparam T data element type (float)
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] handle the raft handle
+ * @param[in] is input stream
+ *
+ * @return raft::neighbors::ivf_flat::index<T, IdxT>
+ */
+template <typename T, typename IdxT>
+index<T, IdxT> deserialize_from_faiss(raft::resources const& handle, std::istream& is)
+{
+  return detail::deserialize_from_faiss<T, IdxT>(handle, is);
+}
+
+/**
+ * Load a `faiss::IndexIVFFlat` from file; see the stream overload.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * auto index = ivf_flat::deserialize_from_faiss<float, int64_t>(handle, "/path/to/index.faiss");
+ * @endcode
+ *
+ * @tparam T data element type (float)
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] handle the raft handle
+ * @param[in] filename the name of the file that stores the index
+ *
+ * @return raft::neighbors::ivf_flat::index<T, IdxT>
+ */
+template <typename T, typename IdxT>
+index<T, IdxT> deserialize_from_faiss(raft::resources const& handle, const std::string& filename)
+{
+  return detail::deserialize_from_faiss<T, IdxT>(handle, filename);
+}
+
 /**@}*/
 
 }  // namespace raft::neighbors::ivf_flat
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -30,12 +30,15 @@
 #include <raft/neighbors/ivf_list_types.hpp>
 #include <raft/util/integer_utils.hpp>
 
+#include <rmm/mr/device/device_memory_resource.hpp>
+
 #include <thrust/reduce.h>
 
 #include <algorithm>  // std::max
 #include <memory>
 #include <optional>
 #include <type_traits>
+#include <vector>
 
 namespace raft::neighbors::ivf_flat {
 /**
@@ -81,6 +84,17 @@ struct index_params : ann::index_params {
 struct search_params : ann::search_params {
   /** The number of clusters to search. */
   uint32_t n_probes = 20;
+  /**
+   * Enables the adaptive probing when positive: among the `n_probes` clusters closest to a query,
+   * the clusters whose center is more than `probe_distance_ratio` times farther from the query
+   * than the closest center (comparing the L2 distances) are skipped. This way, the queries that
+   * fall well within a cluster probe fewer lists, while `n_probes` remains the maximum number of
+   * probes for the others.
+   *
+   * Possible values: 0 (disabled) or >= 1. The smaller the value, the fewer lists are probed.
+   * Only applies to the L2 metrics and is ignored for the inner product and cosine.
+   */
+  float probe_distance_ratio = 0;
 };
 
 static_assert(std::is_aggregate_v<index_params>);
@@ -95,6 +109,10 @@ struct list_spec {
   SizeT align_max;
   SizeT align_min;
   uint32_t dim;
+  /** The memory resource to allocate the lists with (nullptr: the current device resource) */
+  rmm::mr::device_memory_resource* mr = nullptr;
+  /** Shares the ownership of `mr` with the lists, when it is specific to the index. */
+  std::shared_ptr<rmm::mr::device_memory_resource> mr_owner = nullptr;
 
   constexpr list_spec(uint32_t dim, bool conservative_memory_allocation)
     : dim(dim),
@@ -106,7 +124,11 @@ struct list_spec {
   // Allow casting between different size-types (for safer size and offset calculations)
   template <typename OtherSizeT>
   constexpr explicit list_spec(const list_spec<OtherSizeT, ValueT, IdxT>& other_spec)
-    : dim{other_spec.dim}, align_min{other_spec.align_min}, align_max{other_spec.align_max}
+    : dim{other_spec.dim},
+      align_min{other_spec.align_min},
+      align_max{other_spec.align_max},
+      mr{other_spec.mr},
+      mr_owner{other_spec.mr_owner}
   {
   }
 
@@ -123,7 +145,16 @@ using list_data = ivf::list<list_spec, SizeT, ValueT, IdxT>;
 /**
  * @brief IVF-flat index.
  *
- * @tparam T data element type
+ * The lists keep the vectors in their source type `T`. A float dataset converted to `half` before
+ * the build halves the memory footprint and the bandwidth of the search scan; the distances are
+ * still accumulated in fp32.
+ *
+ * Thread safety: `ivf_flat::search` and `ivf_flat::search_with_filtering` take the index by const
+ * reference and never modify it, so any number of host threads may search one index concurrently,
+ * each with its own `raft::resources` (the temporary buffers of a search come from the resources of
+ * the call). The index must not be modified (e.g. extended) while it is being searched.
+ *
+ * @tparam T data element type (float, half, int8_t or uint8_t)
  * @tparam IdxT type of the indices in the source dataset
  *
  */
@@ -222,7 +253,7 @@ struct index : ann::index {
     }
   }
 
-  /** Total length of the index. */
+  /** Total length of the index (including the removed records not compacted yet). */
   [[nodiscard]] constexpr inline auto size() const noexcept -> IdxT { return total_size_; }
   /** Dimensionality of the data. */
   [[nodiscard]] constexpr inline auto dim() const noexcept -> uint32_t
@@ -257,6 +288,7 @@ struct index : ann::index {
       list_sizes_{make_device_vector<uint32_t, uint32_t>(res, n_lists)},
       data_ptrs_{make_device_vector<T*, uint32_t>(res, n_lists)},
       inds_ptrs_{make_device_vector<IdxT*, uint32_t>(res, n_lists)},
+      removed_ptrs_{make_device_vector<uint32_t*, uint32_t>(res, n_lists)},
       total_size_{0}
   {
     check_consistency();
@@ -289,6 +321,33 @@ struct index : ann::index {
   {
     return inds_ptrs_.view();
   }
+
+  /**
+   * Pointers to the bitmasks of the records removed from the lists (`list_data::removed_bits`)
+   * [n_lists]; null for the lists without removed records.
+   */
+  inline auto removed_ptrs() noexcept -> device_vector_view<uint32_t*, uint32_t>
+  {
+    return removed_ptrs_.view();
+  }
+  [[nodiscard]] inline auto removed_ptrs() const noexcept
+    -> device_vector_view<uint32_t* const, uint32_t>
+  {
+    return removed_ptrs_.view();
+  }
+
+  /**
+   * The number of the records removed by `helpers::remove` but not compacted yet: they still
+   * count in `size()`, but the searches never return them.
+   */
+  [[nodiscard]] inline auto n_removed() const noexcept -> IdxT
+  {
+    IdxT n = 0;
+    for (const auto& list : lists_) {
+      if (list) { n += list->n_removed; }
+    }
+    return n;
+  }
   /**
    * Whether to use convervative memory allocation when extending the list (cluster) data
    * (see index_params.conservative_memory_allocation).
@@ -305,17 +364,21 @@ struct index : ann::index {
   {
     auto stream = resource::get_cuda_stream(res);
 
-    // Actualize the list pointers
-    auto this_lists     = lists();
-    auto this_data_ptrs = data_ptrs();
-    auto this_inds_ptrs = inds_ptrs();
+    // Actualize the list pointers (in one copy per array, which matters with many lists)
+    auto& this_lists = lists();
+    std::vector<T*> data_ptrs_host(this_lists.size());
+    std::vector<IdxT*> inds_ptrs_host(this_lists.size());
+    std::vector<uint32_t*> removed_ptrs_host(this_lists.size());
     for (uint32_t label = 0; label < this_lists.size(); label++) {
-      auto& list          = this_lists[label];
-      const auto data_ptr = list ? list->data.data_handle() : nullptr;
-      const auto inds_ptr = list ? list->indices.data_handle() : nullptr;
-      copy(&this_data_ptrs(label), &data_ptr, 1, stream);
-      copy(&this_inds_ptrs(label), &inds_ptr, 1, stream);
+      auto& list               = this_lists[label];
+      data_ptrs_host[label]    = list ? list->data.data_handle() : nullptr;
+      inds_ptrs_host[label]    = list ? list->indices.data_handle() : nullptr;
+      removed_ptrs_host[label] =
+        list && list->n_removed > 0 ? list->removed_bits.data_handle() : nullptr;
     }
+    copy(data_ptrs().data_handle(), data_ptrs_host.data(), this_lists.size(), stream);
+    copy(inds_ptrs().data_handle(), inds_ptrs_host.data(), this_lists.size(), stream);
+    copy(removed_ptrs().data_handle(), removed_ptrs_host.data(), this_lists.size(), stream);
     auto this_list_sizes = list_sizes().data_handle();
     total_size_          = thrust::reduce(resource::get_thrust_policy(res),
                                  this_list_sizes,
@@ -366,6 +429,7 @@ struct index : ann::index {
   // Computed members
   device_vector<T*, uint32_t> data_ptrs_;
   device_vector<IdxT*, uint32_t> inds_ptrs_;
+  device_vector<uint32_t*, uint32_t> removed_ptrs_;
   IdxT total_size_;
 
   /** Throw an error if the index content is inconsistent. */
@@ -376,6 +440,7 @@ struct index : ann::index {
     RAFT_EXPECTS(list_sizes_.extent(0) == n_lists, "inconsistent list size");
     RAFT_EXPECTS(data_ptrs_.extent(0) == n_lists, "inconsistent list size");
     RAFT_EXPECTS(inds_ptrs_.extent(0) == n_lists, "inconsistent list size");
+    RAFT_EXPECTS(removed_ptrs_.extent(0) == n_lists, "inconsistent list size");
     RAFT_EXPECTS(                                       //
       (centers_.extent(0) == list_sizes_.extent(0)) &&  //
         (!center_norms_.has_value() || centers_.extent(0) == center_norms_->extent(0)),
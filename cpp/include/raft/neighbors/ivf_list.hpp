@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,22 +20,64 @@
 #include <raft/core/resource/thrust_policy.hpp>
 #include <raft/neighbors/ivf_list_types.hpp>
 
+#include <raft/core/detail/macros.hpp>
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/error.hpp>
 #include <raft/core/host_mdarray.hpp>
 #include <raft/core/mdspan.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/core/serialize.hpp>
+#include <raft/util/cuda_rt_essentials.hpp>
 #include <raft/util/integer_utils.hpp>
 
 #include <thrust/fill.h>
 
+#include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <type_traits>
 
 namespace raft::neighbors::ivf {
 
+/**
+ * The number of records allocated for a list of `n_rows` records: a multiple of `spec.align_max`,
+ * or a power of two (not smaller than `spec.align_min`) for the short lists.
+ */
+template <typename SpecT, typename SizeT>
+constexpr auto calc_list_capacity(const SpecT& spec, SizeT n_rows) -> SizeT
+{
+  auto capacity = round_up_safe<SizeT>(n_rows, spec.align_max);
+  if (n_rows < spec.align_max) {
+    capacity = bound_by_power_of_two<SizeT>(std::max<SizeT>(n_rows, spec.align_min));
+    capacity = std::min<SizeT>(capacity, spec.align_max);
+  }
+  return capacity;
+}
+
+/**
+ * The list holding the record `i` of the lists laid out one after another, where the list `l`
+ * holds the records `[offsets[l], offsets[l + 1])`: a binary search over the (non-decreasing)
+ * `offsets` [n_lists + 1]. Empty lists are skipped.
+ */
+template <typename OffsetT>
+_RAFT_HOST_DEVICE inline auto find_list(const OffsetT* offsets, uint32_t n_lists, OffsetT i)
+  -> uint32_t
+{
+  // invariant: offsets[lo] <= i < offsets[hi]
+  uint32_t lo = 0;
+  uint32_t hi = n_lists;
+  while (hi - lo > 1) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    if (offsets[mid] <= i) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
 /** The data for a single IVF list. */
 template <template <typename, typename...> typename SpecT,
           typename SizeT,
@@ -43,16 +85,12 @@ template <template <typename, typename...> typename SpecT,
 list<SpecT, SizeT, SpecExtraArgs...>::list(raft::resources const& res,
                                            const spec_type& spec,
                                            size_type n_rows)
-  : size{n_rows}, data{res}, indices{res}
+  : memory_owner{spec.mr_owner}, size{n_rows}, data{res}, indices{res}, removed_bits{res}
 {
-  auto capacity = round_up_safe<SizeT>(n_rows, spec.align_max);
-  if (n_rows < spec.align_max) {
-    capacity = bound_by_power_of_two<SizeT>(std::max<SizeT>(n_rows, spec.align_min));
-    capacity = std::min<SizeT>(capacity, spec.align_max);
-  }
+  auto capacity = calc_list_capacity(spec, n_rows);
   try {
-    data    = make_device_mdarray<value_type>(res, spec.make_list_extents(capacity));
-    indices = make_device_vector<index_type, SizeT>(res, capacity);
+    data    = make_device_mdarray<value_type>(res, spec.mr, spec.make_list_extents(capacity));
+    indices = make_device_mdarray<index_type>(res, spec.mr, make_extents<SizeT>(capacity));
   } catch (std::bad_alloc& e) {
     RAFT_FAIL(
       "ivf::list: failed to allocate a big enough list to hold all data "
@@ -69,6 +107,29 @@ list<SpecT, SizeT, SpecExtraArgs...>::list(raft::resources const& res,
                  ivf::kInvalidRecord<index_type>);
 }
 
+/**
+ * Carry the removed records of the first `n_rows` records of a list over to its copy `dst` (of a
+ * capacity not smaller than `n_rows`), whose records are not removed yet.
+ */
+template <typename ListT>
+void copy_removed_bits(raft::resources const& res,
+                       const ListT& src,
+                       ListT& dst,
+                       typename ListT::size_type n_rows)
+{
+  using size_type = typename ListT::size_type;
+  if (src.n_removed == 0) { return; }
+  auto stream        = resource::get_cuda_stream(res);
+  size_type n_words  = div_rounding_up_safe<size_type>(dst.indices.extent(0), 32);
+  size_type n_copied = std::min<size_type>(div_rounding_up_safe<size_type>(n_rows, 32),
+                                           src.removed_bits.extent(0));
+  dst.removed_bits   = make_device_mdarray<uint32_t>(res, make_extents<size_type>(n_words));
+  RAFT_CUDA_TRY(
+    cudaMemsetAsync(dst.removed_bits.data_handle(), 0, n_words * sizeof(uint32_t), stream));
+  copy(dst.removed_bits.data_handle(), src.removed_bits.data_handle(), n_copied, stream);
+  dst.n_removed = src.n_removed;
+}
+
 /**
  * Resize a list by the given id, so that it can contain the given number of records;
  * copy the data if necessary.
@@ -97,7 +158,15 @@ void resize_list(raft::resources const& res,
     old_used_size = 0;
   }
   if (skip_resize) { return; }
-  auto new_list = std::make_shared<ListT>(res, spec, new_used_size);
+  // Grow the lists geometrically (unless the index keeps its memory footprint minimal), so that
+  // many small extends cost an amortized O(1) per record rather than a reallocation every time.
+  auto new_capacity = new_used_size;
+  if (orig_list && spec.align_max > spec.align_min) {
+    new_capacity =
+      std::max<typename ListT::size_type>(new_used_size, 2 * orig_list->indices.extent(0));
+  }
+  auto new_list  = std::make_shared<ListT>(res, spec, new_capacity);
+  new_list->size = new_used_size;
   if (old_used_size > 0) {
     auto copied_data_extents = spec.make_list_extents(old_used_size);
     auto copied_view =
@@ -111,6 +180,7 @@ void resize_list(raft::resources const& res,
          orig_list->indices.data_handle(),
          old_used_size,
          resource::get_cuda_stream(res));
+    copy_removed_bits(res, *orig_list, *new_list, old_used_size);
   }
   // swap the shared pointer content with the new list
   new_list.swap(orig_list);
@@ -129,22 +199,16 @@ auto serialize_list(const raft::resources& handle,
   serialize_scalar(handle, os, size);
   if (size == 0) { return; }
 
+  // the device data are streamed through the chunked serializer, without a host copy of the list
+  using value_type  = const typename ListT::value_type;
+  using index_type  = const typename ListT::index_type;
   auto data_extents = store_spec.make_list_extents(size);
-  auto data_array =
-    make_host_mdarray<typename ListT::value_type, size_type, row_major>(data_extents);
-  auto inds_array = make_host_mdarray<typename ListT::index_type, size_type, row_major>(
-    make_extents<size_type>(size));
-  copy(data_array.data_handle(),
-       ld.data.data_handle(),
-       data_array.size(),
-       resource::get_cuda_stream(handle));
-  copy(inds_array.data_handle(),
-       ld.indices.data_handle(),
-       inds_array.size(),
-       resource::get_cuda_stream(handle));
-  resource::sync_stream(handle);
-  serialize_mdspan(handle, os, data_array.view());
-  serialize_mdspan(handle, os, inds_array.view());
+  auto data_view    = make_mdspan<value_type, size_type, row_major, false, true>(
+    ld.data.data_handle(), data_extents);
+  auto inds_view = make_mdspan<index_type, size_type, row_major, false, true>(
+    ld.indices.data_handle(), make_extents<size_type>(size));
+  serialize_mdspan(handle, os, data_view);
+  serialize_mdspan(handle, os, inds_view);
 }
 
 template <typename ListT>
@@ -173,22 +237,16 @@ auto deserialize_list(const raft::resources& handle,
   auto size       = deserialize_scalar<size_type>(handle, is);
   if (size == 0) { return ld.reset(); }
   std::make_shared<ListT>(handle, device_spec, size).swap(ld);
+  using value_type  = typename ListT::value_type;
+  using index_type  = typename ListT::index_type;
   auto data_extents = store_spec.make_list_extents(size);
-  auto data_array =
-    make_host_mdarray<typename ListT::value_type, size_type, row_major>(data_extents);
-  auto inds_array = make_host_mdarray<typename ListT::index_type, size_type, row_major>(
-    make_extents<size_type>(size));
-  deserialize_mdspan(handle, is, data_array.view());
-  deserialize_mdspan(handle, is, inds_array.view());
-  copy(ld->data.data_handle(),
-       data_array.data_handle(),
-       data_array.size(),
-       resource::get_cuda_stream(handle));
-  // NB: copying exactly 'size' indices to leave the rest 'kInvalidRecord' intact.
-  copy(
-    ld->indices.data_handle(), inds_array.data_handle(), size, resource::get_cuda_stream(handle));
-  // Make sure the data is copied from host to device before the host arrays get out of the scope.
-  resource::sync_stream(handle);
+  auto data_view    = make_mdspan<value_type, size_type, row_major, false, true>(
+    ld->data.data_handle(), data_extents);
+  // NB: reading exactly 'size' indices to leave the rest 'kInvalidRecord' intact.
+  auto inds_view = make_mdspan<index_type, size_type, row_major, false, true>(
+    ld->indices.data_handle(), make_extents<size_type>(size));
+  deserialize_mdspan(handle, is, data_view);
+  deserialize_mdspan(handle, is, inds_view);
 }
 
 }  // namespace raft::neighbors::ivf
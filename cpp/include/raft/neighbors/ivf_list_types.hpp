@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,8 +19,11 @@
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/resources.hpp>
 
+#include <rmm/mr/device/device_memory_resource.hpp>
+
 #include <atomic>
 #include <limits>
+#include <memory>
 #include <type_traits>
 
 namespace raft::neighbors::ivf {
@@ -34,6 +37,12 @@ template <typename IdxT>
 constexpr static IdxT kInvalidRecord =
   (std::is_signed_v<IdxT> ? IdxT{0} : std::numeric_limits<IdxT>::max()) - 1;
 
+/**
+ * The cluster label written in place of the probes skipped by the adaptive probing
+ * (`search_params::probe_distance_ratio`); the search treats them as empty lists.
+ */
+constexpr static uint32_t kSkippedProbe = std::numeric_limits<uint32_t>::max();
+
 /** The data for a single IVF list. */
 template <template <typename, typename...> typename SpecT,
           typename SizeT,
@@ -45,12 +54,21 @@ struct list {
   using index_type   = typename spec_type::index_type;
   using list_extents = typename spec_type::list_extents;
 
+  /** Keeps the memory resource of the list alive, if the spec owns one (e.g. a memory pool). */
+  std::shared_ptr<rmm::mr::device_memory_resource> memory_owner;
   /** Possibly encoded data; it's layout is defined by `SpecT`. */
   device_mdarray<value_type, list_extents, row_major> data;
   /** Source indices. */
   device_mdarray<index_type, extent_1d<size_type>, row_major> indices;
   /** The actual size of the content. */
   std::atomic<size_type> size;
+  /**
+   * The records removed from the list but not compacted yet: a set bit per removed record
+   * [ceildiv(capacity, 32)]. It is empty while no record of the list is removed.
+   */
+  device_mdarray<uint32_t, extent_1d<size_type>, row_major> removed_bits;
+  /** The number of the removed records not compacted yet (the set bits of `removed_bits`). */
+  size_type n_removed = 0;
 
   /** Allocate a new list capable of holding at least `n_rows` data records and indices. */
   list(raft::resources const& res, const spec_type& spec, size_type n_rows);
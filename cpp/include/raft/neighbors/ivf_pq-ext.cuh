@@ -18,9 +18,12 @@
 
 #include <cstdint>  // int64_t
 
+#include <raft/core/device_csr_matrix.hpp>        // raft::device_csr_matrix
 #include <raft/core/device_mdspan.hpp>            // raft::device_matrix_view
+#include <raft/core/host_mdspan.hpp>              // raft::host_matrix_view
 #include <raft/core/resources.hpp>                // raft::resources
 #include <raft/neighbors/ivf_pq_types.hpp>        // raft::neighbors::ivf_pq::index
+#include <raft/neighbors/sample_filter.cuh>       // raft::neighbors::filtering::bitset_filter
 #include <raft/util/raft_explicit.hpp>            // RAFT_EXPLICIT
 #include <rmm/mr/device/per_device_resource.hpp>  // rmm::mr::device_memory_resource
 
@@ -45,6 +48,20 @@ void extend(raft::resources const& handle,
             std::optional<raft::device_vector_view<const IdxT, IdxT, row_major>> new_indices,
             index<IdxT>* idx) RAFT_EXPLICIT;
 
+template <typename T, typename IdxT>
+void transform(raft::resources const& handle,
+               const index<IdxT>& idx,
+               raft::device_matrix_view<const T, IdxT, row_major> vectors,
+               raft::device_vector_view<uint32_t, IdxT> output_labels,
+               raft::device_matrix_view<uint8_t, IdxT, row_major> output_codes) RAFT_EXPLICIT;
+
+template <typename T, typename IdxT>
+void transform(raft::resources const& handle,
+               const index<IdxT>& idx,
+               raft::host_matrix_view<const T, IdxT, row_major> vectors,
+               raft::device_vector_view<uint32_t, IdxT> output_labels,
+               raft::device_matrix_view<uint8_t, IdxT, row_major> output_codes) RAFT_EXPLICIT;
+
 template <typename T, typename IdxT, typename IvfSampleFilterT>
 void search_with_filtering(raft::resources const& handle,
                            const search_params& params,
@@ -62,6 +79,34 @@ void search(raft::resources const& handle,
             raft::device_matrix_view<IdxT, uint32_t, row_major> neighbors,
             raft::device_matrix_view<float, uint32_t, row_major> distances) RAFT_EXPLICIT;
 
+template <typename T, typename IdxT>
+void search(raft::resources const& handle,
+            const search_params& params,
+            const index<IdxT>& idx,
+            raft::device_matrix_view<const T, uint32_t, row_major> queries,
+            raft::device_matrix_view<IdxT, uint32_t, row_major> neighbors,
+            raft::device_matrix_view<float, uint32_t, row_major> distances,
+            raft::device_matrix_view<const T, int64_t, row_major> dataset) RAFT_EXPLICIT;
+
+template <typename T, typename IdxT>
+void search(raft::resources const& handle,
+            const search_params& params,
+            const index<IdxT>& idx,
+            raft::device_matrix_view<const T, uint32_t, row_major> queries,
+            raft::device_matrix_view<IdxT, uint32_t, row_major> neighbors,
+            raft::device_matrix_view<float, uint32_t, row_major> distances,
+            raft::device_vector_view<const uint32_t, uint32_t> query_n_probes,
+            std::optional<raft::device_vector_view<const uint32_t, uint32_t>> query_k =
+              std::nullopt) RAFT_EXPLICIT;
+
+template <typename T, typename IdxT>
+void range_search(raft::resources const& handle,
+                  const range_search_params& params,
+                  const index<IdxT>& idx,
+                  raft::device_matrix_view<const T, uint32_t, row_major> queries,
+                  float radius,
+                  raft::device_csr_matrix<float, int64_t, IdxT, int64_t>& result) RAFT_EXPLICIT;
+
 template <typename T, typename IdxT = uint32_t>
 auto build(raft::resources const& handle,
            const index_params& params,
@@ -83,6 +128,14 @@ void extend(raft::resources const& handle,
             const IdxT* new_indices,
             IdxT n_rows) RAFT_EXPLICIT;
 
+template <typename T, typename IdxT>
+void transform(raft::resources const& handle,
+               const index<IdxT>& idx,
+               const T* vectors,
+               IdxT n_rows,
+               uint32_t* output_labels,
+               uint8_t* output_codes) RAFT_EXPLICIT;
+
 template <typename T, typename IdxT, typename IvfSampleFilterT>
 void search_with_filtering(raft::resources const& handle,
                            const raft::neighbors::ivf_pq::search_params& params,
@@ -152,6 +205,7 @@ search(raft::resources const& handle,
 instantiate_raft_neighbors_ivf_pq_build(float, int64_t);
 instantiate_raft_neighbors_ivf_pq_build(int8_t, int64_t);
 instantiate_raft_neighbors_ivf_pq_build(uint8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_build(float, uint32_t);
 
 #undef instantiate_raft_neighbors_ivf_pq_build
 
@@ -186,9 +240,40 @@ instantiate_raft_neighbors_ivf_pq_build(uint8_t, int64_t);
 instantiate_raft_neighbors_ivf_pq_extend(float, int64_t);
 instantiate_raft_neighbors_ivf_pq_extend(int8_t, int64_t);
 instantiate_raft_neighbors_ivf_pq_extend(uint8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_extend(float, uint32_t);
 
 #undef instantiate_raft_neighbors_ivf_pq_extend
 
+#define instantiate_raft_neighbors_ivf_pq_transform(T, IdxT)          \
+  extern template void raft::neighbors::ivf_pq::transform<T, IdxT>(   \
+    raft::resources const& handle,                                    \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                  \
+    raft::device_matrix_view<const T, IdxT, row_major> vectors,       \
+    raft::device_vector_view<uint32_t, IdxT> output_labels,           \
+    raft::device_matrix_view<uint8_t, IdxT, row_major> output_codes); \
+                                                                      \
+  extern template void raft::neighbors::ivf_pq::transform<T, IdxT>(   \
+    raft::resources const& handle,                                    \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                  \
+    raft::host_matrix_view<const T, IdxT, row_major> vectors,         \
+    raft::device_vector_view<uint32_t, IdxT> output_labels,           \
+    raft::device_matrix_view<uint8_t, IdxT, row_major> output_codes); \
+                                                                      \
+  extern template void raft::neighbors::ivf_pq::transform<T, IdxT>(   \
+    raft::resources const& handle,                                    \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                  \
+    const T* vectors,                                                 \
+    IdxT n_rows,                                                      \
+    uint32_t* output_labels,                                          \
+    uint8_t* output_codes);
+
+instantiate_raft_neighbors_ivf_pq_transform(float, int64_t);
+instantiate_raft_neighbors_ivf_pq_transform(int8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_transform(uint8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_transform(float, uint32_t);
+
+#undef instantiate_raft_neighbors_ivf_pq_transform
+
 #define instantiate_raft_neighbors_ivf_pq_search(T, IdxT)            \
   extern template void raft::neighbors::ivf_pq::search<T, IdxT>(     \
     raft::resources const& handle,                                   \
@@ -222,5 +307,90 @@ instantiate_raft_neighbors_ivf_pq_extend(uint8_t, int64_t);
 instantiate_raft_neighbors_ivf_pq_search(float, int64_t);
 instantiate_raft_neighbors_ivf_pq_search(int8_t, int64_t);
 instantiate_raft_neighbors_ivf_pq_search(uint8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_search(float, uint32_t);
 
 #undef instantiate_raft_neighbors_ivf_pq_search
+
+#define instantiate_raft_neighbors_ivf_pq_search_refine(T)            \
+  extern template void raft::neighbors::ivf_pq::search<T, int64_t>(   \
+    raft::resources const& handle,                                    \
+    const raft::neighbors::ivf_pq::search_params& params,             \
+    const raft::neighbors::ivf_pq::index<int64_t>& idx,               \
+    raft::device_matrix_view<const T, uint32_t, row_major> queries,   \
+    raft::device_matrix_view<int64_t, uint32_t, row_major> neighbors, \
+    raft::device_matrix_view<float, uint32_t, row_major> distances,   \
+    raft::device_matrix_view<const T, int64_t, row_major> dataset)
+
+instantiate_raft_neighbors_ivf_pq_search_refine(float);
+instantiate_raft_neighbors_ivf_pq_search_refine(int8_t);
+instantiate_raft_neighbors_ivf_pq_search_refine(uint8_t);
+
+#undef instantiate_raft_neighbors_ivf_pq_search_refine
+
+#define instantiate_raft_neighbors_ivf_pq_search_per_query(T, IdxT)    \
+  extern template void raft::neighbors::ivf_pq::search<T, IdxT>(       \
+    raft::resources const& handle,                                     \
+    const raft::neighbors::ivf_pq::search_params& params,              \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                   \
+    raft::device_matrix_view<const T, uint32_t, row_major> queries,    \
+    raft::device_matrix_view<IdxT, uint32_t, row_major> neighbors,     \
+    raft::device_matrix_view<float, uint32_t, row_major> distances,    \
+    raft::device_vector_view<const uint32_t, uint32_t> query_n_probes, \
+    std::optional<raft::device_vector_view<const uint32_t, uint32_t>> query_k)
+
+instantiate_raft_neighbors_ivf_pq_search_per_query(float, int64_t);
+instantiate_raft_neighbors_ivf_pq_search_per_query(int8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_search_per_query(uint8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_search_per_query(float, uint32_t);
+
+#undef instantiate_raft_neighbors_ivf_pq_search_per_query
+
+#define instantiate_raft_neighbors_ivf_pq_range_search(T, IdxT)        \
+  extern template void raft::neighbors::ivf_pq::range_search<T, IdxT>( \
+    raft::resources const& handle,                                     \
+    const raft::neighbors::ivf_pq::range_search_params& params,        \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                   \
+    raft::device_matrix_view<const T, uint32_t, row_major> queries,    \
+    float radius,                                                      \
+    raft::device_csr_matrix<float, int64_t, IdxT, int64_t>& result)
+
+instantiate_raft_neighbors_ivf_pq_range_search(float, int64_t);
+instantiate_raft_neighbors_ivf_pq_range_search(int8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_range_search(uint8_t, int64_t);
+instantiate_raft_neighbors_ivf_pq_range_search(float, uint32_t);
+
+#undef instantiate_raft_neighbors_ivf_pq_range_search
+
+#define instantiate_raft_neighbors_ivf_pq_search_with_filtering(T, IdxT, IvfSampleFilterT) \
+  extern template void                                                                     \
+  raft::neighbors::ivf_pq::search_with_filtering<T, IdxT, IvfSampleFilterT>(               \
+    raft::resources const& handle,                                                         \
+    const raft::neighbors::ivf_pq::search_params& params,                                  \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                                       \
+    raft::device_matrix_view<const T, uint32_t, row_major> queries,                        \
+    raft::device_matrix_view<IdxT, uint32_t, row_major> neighbors,                         \
+    raft::device_matrix_view<float, uint32_t, row_major> distances,                        \
+    IvfSampleFilterT sample_filter);                                                       \
+                                                                                           \
+  extern template void                                                                     \
+  raft::neighbors::ivf_pq::search_with_filtering<T, IdxT, IvfSampleFilterT>(               \
+    raft::resources const& handle,                                                         \
+    const raft::neighbors::ivf_pq::search_params& params,                                  \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                                       \
+    const T* queries,                                                                      \
+    uint32_t n_queries,                                                                    \
+    uint32_t k,                                                                            \
+    IdxT* neighbors,                                                                       \
+    float* distances,                                                                      \
+    IvfSampleFilterT sample_filter)
+
+#define COMMA ,
+instantiate_raft_neighbors_ivf_pq_search_with_filtering(
+  float, int64_t, raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>);
+instantiate_raft_neighbors_ivf_pq_search_with_filtering(
+  int8_t, int64_t, raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>);
+instantiate_raft_neighbors_ivf_pq_search_with_filtering(
+  uint8_t, int64_t, raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>);
+#undef COMMA
+
+#undef instantiate_raft_neighbors_ivf_pq_search_with_filtering
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,13 +21,17 @@
 #include <raft/neighbors/ivf_pq_serialize.cuh>
 #include <raft/neighbors/ivf_pq_types.hpp>
 
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_mdspan.hpp>
 #include <raft/core/resource/device_memory_resource.hpp>
 #include <raft/core/resources.hpp>
 
 #include <rmm/mr/device/device_memory_resource.hpp>
 
 #include <memory>  // shared_ptr
+#include <optional>
+#include <type_traits>
 
 namespace raft::neighbors::ivf_pq {
 
@@ -133,6 +137,95 @@ void extend(raft::resources const& handle,
                         n_rows);
 }
 
+/**
+ * @brief Encode the vectors by the index without adding them to its lists.
+ *
+ * The vectors are labeled by the nearest cluster centers of the index, and their residuals are
+ * rotated and encoded by its PQ codebooks, as `extend` does, in one pass over the batches of the
+ * input. The codes are written tightly packed, as `helpers::pack_contiguous_list_data` reads them,
+ * which allows storing them outside of the index and scanning them later.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   // train the index without populating it
+ *   ivf_pq::index_params index_params;
+ *   index_params.add_data_on_build = false;
+ *   auto index = ivf_pq::build(handle, index_params, dataset);
+ *   // encode the dataset
+ *   auto labels = raft::make_device_vector<uint32_t, int64_t>(handle, n_rows);
+ *   uint32_t code_size = raft::ceildiv(index.pq_dim() * index.pq_bits(), 8u);
+ *   auto codes = raft::make_device_matrix<uint8_t, int64_t>(handle, n_rows, code_size);
+ *   ivf_pq::transform(handle, index, dataset, labels.view(), codes.view());
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] handle
+ * @param[in] idx a trained index
+ * @param[in] vectors a device matrix view to a row-major matrix [n_rows, idx.dim()]
+ * @param[out] output_labels the cluster labels of the vectors [n_rows]
+ * @param[out] output_codes the flat PQ codes of the vectors
+ *   [n_rows, ceildiv(idx.pq_dim() * idx.pq_bits(), 8)]
+ */
+template <typename T, typename IdxT>
+void transform(raft::resources const& handle,
+               const index<IdxT>& idx,
+               raft::device_matrix_view<const T, IdxT, row_major> vectors,
+               raft::device_vector_view<uint32_t, IdxT> output_labels,
+               raft::device_matrix_view<uint8_t, IdxT, row_major> output_codes)
+{
+  RAFT_EXPECTS(vectors.extent(1) == idx.dim(), "vectors should have the dimension of the index");
+  RAFT_EXPECTS(output_labels.extent(0) == vectors.extent(0) &&
+                 output_codes.extent(0) == vectors.extent(0),
+               "the outputs should have the number of rows of the vectors");
+  RAFT_EXPECTS(output_codes.extent(1) == raft::ceildiv(idx.pq_dim() * idx.pq_bits(), 8u),
+               "output_codes should have ceildiv(pq_dim * pq_bits, 8) columns");
+  detail::transform(handle,
+                    idx,
+                    vectors.data_handle(),
+                    vectors.extent(0),
+                    output_labels.data_handle(),
+                    output_codes.data_handle());
+}
+
+/**
+ * @brief Encode the vectors in host memory by the index without adding them to its lists.
+ *
+ * The batches of the vectors are copied to the device while the previous ones are encoded (if the
+ * resources have a stream pool); see the device overload for the details.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] handle
+ * @param[in] idx a trained index
+ * @param[in] vectors a host matrix view to a row-major matrix [n_rows, idx.dim()]
+ * @param[out] output_labels the cluster labels of the vectors [n_rows]
+ * @param[out] output_codes the flat PQ codes of the vectors
+ *   [n_rows, ceildiv(idx.pq_dim() * idx.pq_bits(), 8)]
+ */
+template <typename T, typename IdxT>
+void transform(raft::resources const& handle,
+               const index<IdxT>& idx,
+               raft::host_matrix_view<const T, IdxT, row_major> vectors,
+               raft::device_vector_view<uint32_t, IdxT> output_labels,
+               raft::device_matrix_view<uint8_t, IdxT, row_major> output_codes)
+{
+  RAFT_EXPECTS(vectors.extent(1) == idx.dim(), "vectors should have the dimension of the index");
+  RAFT_EXPECTS(output_labels.extent(0) == vectors.extent(0) &&
+                 output_codes.extent(0) == vectors.extent(0),
+               "the outputs should have the number of rows of the vectors");
+  RAFT_EXPECTS(output_codes.extent(1) == raft::ceildiv(idx.pq_dim() * idx.pq_bits(), 8u),
+               "output_codes should have ceildiv(pq_dim * pq_bits, 8) columns");
+  detail::transform(handle,
+                    idx,
+                    vectors.data_handle(),
+                    vectors.extent(0),
+                    output_labels.data_handle(),
+                    output_codes.data_handle());
+}
+
 /**
  * @brief Search ANN using the constructed index with the given filter.
  *
@@ -146,6 +239,10 @@ void extend(raft::resources const& handle,
  * detail. However, you can safely specify a small initial size for the memory pool, so that only a
  * few allocations happen to grow it during the first invocations of the `search`.
  *
+ * If `handle` has a stream pool (e.g. `raft::device_resources` constructed with one), large query
+ * batches are split across its streams, so that the kernels of the sub-batches overlap. The
+ * function returns after the streams of the pool have finished.
+ *
  * @tparam T data element type
  * @tparam IdxT type of the indices
  * @tparam IvfSampleFilterT Device filter function, with the signature
@@ -206,6 +303,10 @@ void search_with_filtering(raft::resources const& handle,
  * detail. However, you can safely specify a small initial size for the memory pool, so that only a
  * few allocations happen to grow it during the first invocations of the `search`.
  *
+ * If `handle` has a stream pool (e.g. `raft::device_resources` constructed with one), large query
+ * batches are split across its streams, so that the kernels of the sub-batches overlap. The
+ * function returns after the streams of the pool have finished.
+ *
  * @tparam T data element type
  * @tparam IdxT type of the indices
  *
@@ -235,6 +336,202 @@ void search(raft::resources const& handle,
                         raft::neighbors::filtering::none_ivf_sample_filter{});
 }
 
+/**
+ * @brief Search ANN using the constructed index, refining the candidates on the raw vectors.
+ *
+ * This is the fused equivalent of an `ivf_pq::search` for `k * params.refine_ratio` candidates
+ * followed by `raft::neighbors::refine` for `k` neighbors: the candidates of every batch of
+ * queries are kept in the workspace and refined right after the PQ scan, instead of being written
+ * to the output and read back by a separate call.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   auto index = ivf_pq::build(handle, index_params, dataset);
+ *   ivf_pq::search_params search_params;
+ *   search_params.refine_ratio = 4;
+ *   ivf_pq::search(handle, search_params, index, queries, neighbors, distances, dataset);
+ * @endcode
+ *
+ * As with `raft::neighbors::refine`, every candidate must be a valid row of the dataset, that is
+ * the probed lists must contain at least `k * refine_ratio` rows for every query.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices (only int64_t is supported)
+ *
+ * @param[in] handle
+ * @param[in] params configure the search
+ * @param[in] idx ivf-pq constructed index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the exact distances to the selected neighbors
+ * [n_queries, k]
+ * @param[in] dataset a device matrix view to the raw vectors [n_rows, index->dim()], indexed by
+ * the source indices of the index
+ */
+template <typename T, typename IdxT>
+void search(raft::resources const& handle,
+            const search_params& params,
+            const index<IdxT>& idx,
+            raft::device_matrix_view<const T, uint32_t, row_major> queries,
+            raft::device_matrix_view<IdxT, uint32_t, row_major> neighbors,
+            raft::device_matrix_view<float, uint32_t, row_major> distances,
+            raft::device_matrix_view<const T, int64_t, row_major> dataset)
+{
+  static_assert(std::is_same_v<IdxT, int64_t>,
+                "The fused refinement supports only the int64_t indices.");
+  RAFT_EXPECTS(
+    queries.extent(0) == neighbors.extent(0) && queries.extent(0) == distances.extent(0),
+    "Number of rows in output neighbors and distances matrices must equal the number of queries.");
+
+  RAFT_EXPECTS(neighbors.extent(1) == distances.extent(1),
+               "Number of columns in output neighbors and distances matrices must equal k");
+
+  RAFT_EXPECTS(queries.extent(1) == idx.dim(),
+               "Number of query dimensions should equal number of dimensions in the index.");
+
+  detail::search(handle,
+                 params,
+                 idx,
+                 queries.data_handle(),
+                 queries.extent(0),
+                 neighbors.extent(1),
+                 neighbors.data_handle(),
+                 distances.data_handle(),
+                 raft::neighbors::filtering::none_ivf_sample_filter{},
+                 std::make_optional(dataset));
+}
+
+/**
+ * @brief Search ANN using the constructed index, with a number of probes (and of neighbors) per
+ * query.
+ *
+ * This lets a batch of queries of mixed quality requirements share a single search: the query `i`
+ * probes its `query_n_probes[i]` closest lists, and the lists the other queries probe in addition
+ * take no place in its share of the scan. `params.n_probes` is the largest number of probes per
+ * query; the larger values of `query_n_probes` are capped to it.
+ *
+ * With `query_k`, the query `i` keeps its `query_k[i]` nearest neighbors, and the rest of its row
+ * in `neighbors` and `distances` (of `k = neighbors.extent(1)` columns, the largest number of
+ * neighbors per query) is padded with `kOutOfBoundsRecord` and the worst distance of the metric
+ * (the largest float, or the lowest for InnerProduct).
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   ivf_pq::search_params search_params;
+ *   search_params.n_probes = 64;  // the largest number of probes per query
+ *   // query_n_probes[i] <= 64, query_k[i] <= neighbors.extent(1)
+ *   ivf_pq::search(handle, search_params, index, queries, neighbors, distances,
+ *                  raft::make_const_mdspan(query_n_probes.view()),
+ *                  std::make_optional(raft::make_const_mdspan(query_k.view())));
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] handle
+ * @param[in] params configure the search
+ * @param[in] idx ivf-pq constructed index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[out] neighbors a device matrix view to the indices of the neighbors in the source dataset
+ * [n_queries, k]
+ * @param[out] distances a device matrix view to the distances to the selected neighbors [n_queries,
+ * k]
+ * @param[in] query_n_probes a device vector view to the number of probes of every query
+ * [n_queries]
+ * @param[in] query_k an optional device vector view to the number of neighbors of every query
+ * [n_queries]
+ */
+template <typename T, typename IdxT>
+void search(raft::resources const& handle,
+            const search_params& params,
+            const index<IdxT>& idx,
+            raft::device_matrix_view<const T, uint32_t, row_major> queries,
+            raft::device_matrix_view<IdxT, uint32_t, row_major> neighbors,
+            raft::device_matrix_view<float, uint32_t, row_major> distances,
+            raft::device_vector_view<const uint32_t, uint32_t> query_n_probes,
+            std::optional<raft::device_vector_view<const uint32_t, uint32_t>> query_k =
+              std::nullopt)
+{
+  RAFT_EXPECTS(
+    queries.extent(0) == neighbors.extent(0) && queries.extent(0) == distances.extent(0),
+    "Number of rows in output neighbors and distances matrices must equal the number of queries.");
+
+  RAFT_EXPECTS(neighbors.extent(1) == distances.extent(1),
+               "Number of columns in output neighbors and distances matrices must equal k");
+
+  RAFT_EXPECTS(queries.extent(1) == idx.dim(),
+               "Number of query dimensions should equal number of dimensions in the index.");
+
+  RAFT_EXPECTS(query_n_probes.extent(0) == queries.extent(0),
+               "query_n_probes must have a value per query.");
+  RAFT_EXPECTS(!query_k.has_value() || query_k->extent(0) == queries.extent(0),
+               "query_k must have a value per query.");
+
+  detail::search(handle,
+                 params,
+                 idx,
+                 queries.data_handle(),
+                 queries.extent(0),
+                 neighbors.extent(1),
+                 neighbors.data_handle(),
+                 distances.data_handle(),
+                 raft::neighbors::filtering::none_ivf_sample_filter{},
+                 std::nullopt,
+                 std::nullopt,
+                 query_n_probes.data_handle(),
+                 query_k.has_value() ? query_k->data_handle() : nullptr);
+}
+
+/**
+ * @brief Search the neighbors within the radius of the queries into a CSR matrix.
+ *
+ * The range search is a sequence of top-k searches bounded by the radius: the scan drops the codes
+ * out of the radius (for the L2 metrics, it stops the distance computation of a code as soon as
+ * its partial distance leaves the radius). The queries are searched for `params.initial_k`
+ * neighbors first, and the queries whose results are all within the radius are searched again for
+ * twice as many, until the worst result of every query leaves the radius or `params.max_k` is
+ * reached. Hence a neighborhood larger than `params.max_k` is truncated to its `max_k` nearest
+ * (approximate) neighbors. The neighborhoods are counted first, then the CSR matrix is allocated
+ * and filled in.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   auto index = ivf_pq::build(handle, index_params, dataset);
+ *   ivf_pq::range_search_params params;
+ *   params.max_k = 256;
+ *   auto result = raft::make_device_csr_matrix<float, int64_t, int64_t, int64_t>(
+ *     handle, queries.extent(0), index.size());
+ *   ivf_pq::range_search(handle, params, index, queries, radius, result);
+ *   // result.structure_view().get_indptr() / get_indices() and result.get_elements()
+ * @endcode
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] handle
+ * @param[in] params configure the search
+ * @param[in] idx ivf-pq constructed index
+ * @param[in] queries a device matrix view to a row-major matrix [n_queries, index->dim()]
+ * @param[in] radius the radius, in the units of the distances returned by `ivf_pq::search`
+ * (squared for L2Expanded); for InnerProduct, the minimum similarity of the neighbors
+ * @param[out] result the neighborhoods [n_queries, idx.size()]; its sparsity is initialized by
+ * this function
+ */
+template <typename T, typename IdxT>
+void range_search(raft::resources const& handle,
+                  const range_search_params& params,
+                  const index<IdxT>& idx,
+                  raft::device_matrix_view<const T, uint32_t, row_major> queries,
+                  float radius,
+                  raft::device_csr_matrix<float, int64_t, IdxT, int64_t>& result)
+{
+  detail::range_search(handle, params, idx, queries, radius, result);
+}
+
 /** @} */  // end group ivf_pq
 
 /**
@@ -345,6 +642,33 @@ void extend(raft::resources const& handle,
   detail::extend(handle, idx, new_vectors, new_indices, n_rows);
 }
 
+/**
+ * @brief Encode the vectors by the index without adding them to its lists.
+ *
+ * See the mdspan overloads for the details.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] handle
+ * @param[in] idx a trained index
+ * @param[in] vectors a device/host pointer to a row-major matrix [n_rows, idx.dim()]
+ * @param[in] n_rows the number of vectors
+ * @param[out] output_labels a device pointer to the cluster labels of the vectors [n_rows]
+ * @param[out] output_codes a device pointer to the flat PQ codes of the vectors
+ *   [n_rows, ceildiv(idx.pq_dim() * idx.pq_bits(), 8)]
+ */
+template <typename T, typename IdxT>
+void transform(raft::resources const& handle,
+               const index<IdxT>& idx,
+               const T* vectors,
+               IdxT n_rows,
+               uint32_t* output_labels,
+               uint8_t* output_codes)
+{
+  detail::transform(handle, idx, vectors, n_rows, output_labels, output_codes);
+}
+
 /**
  * @brief Search ANN using the constructed index with the given filter.
  *
@@ -373,6 +697,10 @@ void extend(raft::resources const& handle,
  * detail. However, you can safely specify a small initial size for the memory pool, so that only a
  * few allocations happen to grow it during the first invocations of the `search`.
  *
+ * If `handle` has a stream pool (e.g. `raft::device_resources` constructed with one), large query
+ * batches are split across its streams, so that the kernels of the sub-batches overlap. The
+ * function returns after the streams of the pool have finished.
+ *
  * @tparam T data element type
  * @tparam IdxT type of the indices
  * @tparam IvfSampleFilterT Device filter function, with the signature
@@ -463,6 +791,10 @@ search_with_filtering(raft::resources const& handle,
  * detail. However, you can safely specify a small initial size for the memory pool, so that only a
  * few allocations happen to grow it during the first invocations of the `search`.
  *
+ * If `handle` has a stream pool (e.g. `raft::device_resources` constructed with one), large query
+ * batches are split across its streams, so that the kernels of the sub-batches overlap. The
+ * function returns after the streams of the pool have finished.
+ *
  * @tparam T data element type
  * @tparam IdxT type of the indices
  *
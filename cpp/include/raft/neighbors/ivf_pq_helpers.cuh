@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -597,6 +597,127 @@ void erase_list(raft::resources const& res, index<IdxT>* index, uint32_t label)
   ivf_pq::detail::erase_list(res, index, label);
 }
 
+/**
+ * @brief Remove the records with the given source indices from the index in-place.
+ *
+ * The removed records are first only marked in a bitmask of their lists, which the searches check
+ * along with the sample filter; `index.size()` still counts them and `index.n_removed()` gives
+ * their number. The lists with at least `compaction_threshold` of their records removed are
+ * compacted right away: their removed records are overwritten by the last records of the lists
+ * (so the order of the records in a list changes). The other lists can be compacted later by
+ * `compact`. The indices not found in the index are ignored.
+ *
+ * The lists shared with a clone of the index are modified for both; only the index passed here
+ * updates its list sizes and pointers.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   // the source indices of the records to drop
+ *   auto ids = raft::make_device_vector<int64_t, int64_t>(res, n_ids);
+ *   ... fill the ids ...
+ *   // compact the lists once a quarter of their records is removed
+ *   auto n_removed = ivf_pq::helpers::remove(res, &index, raft::make_const_mdspan(ids.view()));
+ *   ...
+ *   // drop all removed records, e.g. before serializing the index
+ *   ivf_pq::helpers::compact(res, &index);
+ * @endcode
+ *
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resource
+ * @param[inout] index the index to modify
+ * @param[in] ids the source indices of the records to remove [n_ids] (device memory)
+ * @param[in] compaction_threshold the fraction of the removed records of a list above which the
+ *   list is compacted; zero compacts every list with removed records, above one none.
+ * @return the number of the records removed (not counting the ones removed before)
+ */
+template <typename IdxT>
+auto remove(raft::resources const& res,
+            index<IdxT>* index,
+            device_vector_view<const IdxT, int64_t> ids,
+            double compaction_threshold = 0.25) -> int64_t
+{
+  return ivf_pq::detail::remove(res, index, ids, compaction_threshold);
+}
+
+/**
+ * @brief Drop the records marked by `remove` from all lists of the index in-place.
+ *
+ * The serialization requires an index without the removed records.
+ *
+ * @tparam IdxT
+ *
+ * @param[in] res
+ * @param[inout] index
+ */
+template <typename IdxT>
+void compact(raft::resources const& res, index<IdxT>* index)
+{
+  ivf_pq::detail::compact(res, index, 0.0);
+}
+
+/**
+ * @brief Move the data of all lists (clusters) of the index to the given memory type.
+ *
+ * The lists the index allocates from now on (e.g. in `ivf_pq::extend`) are placed in the same
+ * memory. This is useful to search an index that doesn't fit in the device memory, e.g. after
+ * deserializing it, with the lists in managed memory (see ivf_pq::list_memory_type).
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   auto index = ivf_pq::deserialize<int64_t>(res, filename);
+ *   ivf_pq::helpers::set_list_memory(res, &index, ivf_pq::list_memory_type::MANAGED);
+ *   ivf_pq::search(res, search_params, index, queries, neighbors, distances);
+ * @endcode
+ *
+ * @tparam IdxT
+ *
+ * @param[in] res raft resource
+ * @param[inout] index pointer to IVF-PQ index
+ * @param[in] memory_type where to place the lists
+ */
+template <typename IdxT>
+void set_list_memory(raft::resources const& res, index<IdxT>* index, list_memory_type memory_type)
+{
+  ivf_pq::detail::set_list_memory(res, index, memory_type);
+}
+
+/**
+ * @brief Rebalance the lists (clusters) of the index in-place.
+ *
+ * After many calls to `ivf_pq::extend`, some lists may grow much larger than the others, which
+ * makes the search slower (its work is distributed per list). This function splits every list
+ * holding more than `params.max_list_size_ratio` times the mean number of records per list in
+ * two with the balanced k-means. The number of lists doesn't change: every split reuses the label
+ * of one of the smallest lists, whose records are merged into the closest remaining lists.
+ *
+ * Only the records of the affected lists are decoded and encoded again with the new centers;
+ * the other lists and the PQ codebooks are left unchanged (with `codebook_gen::PER_CLUSTER`, both
+ * halves of a split list use the codebook of the original list). Note, the records are encoded
+ * again from their PQ-decoded approximations, which slightly increases their quantization error.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   ivf_pq::extend(res, new_vectors, new_indices, &index);
+ *   ivf_pq::rebalance_params params;
+ *   ivf_pq::helpers::rebalance(res, &index, params);
+ * @endcode
+ *
+ * @tparam IdxT
+ *
+ * @param[in] res raft resource
+ * @param[inout] index pointer to IVF-PQ index
+ * @param[in] params the rebalancing parameters
+ *
+ * @return the number of lists split
+ */
+template <typename IdxT>
+auto rebalance(raft::resources const& res, index<IdxT>* index, const rebalance_params& params)
+  -> uint32_t
+{
+  return ivf_pq::detail::rebalance(res, index, params);
+}
+
 /**
  * @brief Public helper API to reset the data and indices ptrs, and the list sizes. Useful for
  * externally modifying the index without going through the build stage. The data and indices of the
@@ -727,8 +848,7 @@ void set_centers(raft::resources const& res,
  *   ivf_pq::index<int64_t> index(res, index_params, D);
  *   ivf_pq::helpers::reset_index(res, &index);
  *   // resize the first IVF list to hold 5 records
- *   auto spec = list_spec<uint32_t, int64_t>{
- *     index->pq_bits(), index->pq_dim(), index->conservative_memory_allocation()};
+ *   auto spec = index.make_list_spec();
  *   uint32_t new_size = 5;
  *   ivf::resize_list(res, list, spec, new_size, 0);
  *   raft::update_device(index.list_sizes(), &new_size, 1, stream);
@@ -789,5 +909,69 @@ void extract_centers(raft::resources const& res,
                                   cudaMemcpyDefault,
                                   stream));
 }
+
+/**
+ * @brief Unpack the codes of all lists into flat arrays laid out list by list, in one pass.
+ *
+ * The codes are not expanded to one code per byte: each record occupies
+ * ceildiv(index.pq_dim() * index.pq_bits(), 8) bytes, its codes packed from the lowest bits
+ * (as `unpack_contiguous_list_data` does). The list `l` ends up in the rows
+ * `[list_offsets[l], list_offsets[l + 1])` of `codes` and `indices`; this is the layout of the
+ * `faiss::ArrayInvertedLists` of a `faiss::IndexIVFPQ`. Unlike a loop over the lists, all lists
+ * are converted by a single kernel, which matters for the indices with very many lists.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   int64_t code_size = raft::ceildiv(index.pq_dim() * index.pq_bits(), 8u);
+ *   auto codes   = raft::make_device_matrix<uint8_t, int64_t>(res, index.size(), code_size);
+ *   auto indices = raft::make_device_vector<int64_t, int64_t>(res, index.size());
+ *   auto offsets = raft::make_device_vector<int64_t, int64_t>(res, index.n_lists() + 1);
+ *   ivf_pq::helpers::unpack_all_lists(res, index, codes.view(), indices.view(), offsets.view());
+ * @endcode
+ *
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resource
+ * @param[in] index IVF-PQ index (passed by reference)
+ * @param[out] codes the flat compressed codes [index.size(), ceildiv(pq_dim * pq_bits, 8)]
+ * @param[out] indices the source indices of the records [index.size()]
+ * @param[out] list_offsets the offsets of the lists in `codes` and `indices` [index.n_lists() + 1]
+ */
+template <typename IdxT>
+void unpack_all_lists(raft::resources const& res,
+                      const index<IdxT>& index,
+                      device_matrix_view<uint8_t, int64_t, row_major> codes,
+                      device_vector_view<IdxT, int64_t> indices,
+                      device_vector_view<int64_t, int64_t> list_offsets)
+{
+  ivf_pq::detail::unpack_all_lists(res, index, codes, indices, list_offsets);
+}
+
+/**
+ * @brief Replace the lists of the index by the flat codes laid out list by list, in one pass.
+ *
+ * The inverse of `unpack_all_lists`: the list `l` gets the rows
+ * `[list_offsets[l], list_offsets[l + 1])` of `codes` and `indices`. The lists are reallocated to
+ * fit the new records; the centers and the codebooks of the index are left intact, so the codes
+ * must have been encoded with them (e.g. set them with `set_centers` and `index.pq_centers()`
+ * when importing a `faiss::IndexIVFPQ`).
+ *
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resource
+ * @param[inout] index pointer to IVF-PQ index
+ * @param[in] codes the flat compressed codes [n_rows, ceildiv(pq_dim * pq_bits, 8)]
+ * @param[in] indices the source indices of the records [n_rows]
+ * @param[in] list_offsets the offsets of the lists in `codes` and `indices` [index.n_lists() + 1]
+ */
+template <typename IdxT>
+void pack_all_lists(raft::resources const& res,
+                    index<IdxT>* index,
+                    device_matrix_view<const uint8_t, int64_t, row_major> codes,
+                    device_vector_view<const IdxT, int64_t> indices,
+                    device_vector_view<const int64_t, int64_t> list_offsets)
+{
+  ivf_pq::detail::pack_all_lists(res, index, codes, indices, list_offsets);
+}
 /** @} */
 }  // namespace raft::neighbors::ivf_pq::helpers
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -46,12 +46,17 @@ namespace raft::neighbors::ivf_pq {
  * @param[in] handle the raft handle
  * @param[in] os output stream
  * @param[in] index IVF-PQ index
+ * @param[in] compress whether to compress the source ids of the lists (bit-packed deltas, encoded
+ *   and decoded on the GPU)
  *
  */
 template <typename IdxT>
-void serialize(raft::resources const& handle, std::ostream& os, const index<IdxT>& index)
+void serialize(raft::resources const& handle,
+               std::ostream& os,
+               const index<IdxT>& index,
+               bool compress = false)
 {
-  detail::serialize(handle, os, index);
+  detail::serialize(handle, os, index, compress);
 }
 
 /**
@@ -75,12 +80,16 @@ void serialize(raft::resources const& handle, std::ostream& os, const index<IdxT
  * @param[in] handle the raft handle
  * @param[in] filename the file name for saving the index
  * @param[in] index IVF-PQ index
+ * @param[in] compress whether to compress the source ids of the lists
  *
  */
 template <typename IdxT>
-void serialize(raft::resources const& handle, const std::string& filename, const index<IdxT>& index)
+void serialize(raft::resources const& handle,
+               const std::string& filename,
+               const index<IdxT>& index,
+               bool compress = false)
 {
-  detail::serialize(handle, filename, index);
+  detail::serialize(handle, filename, index, compress);
 }
 
 /**
@@ -141,6 +150,215 @@ index<IdxT> deserialize(raft::resources const& handle, const std::string& filena
   return detail::deserialize<IdxT>(handle, filename);
 }
 
+/**
+ * Save the index to file in a page-aligned layout that can be memory-mapped.
+ *
+ * Every list is stored in its device layout at a page-aligned offset, so that the lists can be
+ * copied to the device straight from the mapped file (see `mapped_lists` and
+ * `deserialize_mapped`). This format cannot be read by `deserialize` and vice versa.
+ *
+ * Experimental, both the API and the serialization format are subject to change.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * // create an index with `auto index = ivf_pq::build(...);`
+ * ivf_pq::serialize_mapped(handle, "/path/to/index", index);
+ * @endcode
+ *
+ * @tparam IdxT type of the index
+ *
+ * @param[in] handle the raft handle
+ * @param[in] filename the file name for saving the index
+ * @param[in] index IVF-PQ index
+ */
+template <typename IdxT>
+void serialize_mapped(raft::resources const& handle,
+                      const std::string& filename,
+                      const index<IdxT>& index)
+{
+  detail::serialize_mapped(handle, filename, index);
+}
+
+/**
+ * Load a whole index saved by `serialize_mapped`.
+ *
+ * The file is memory-mapped and the lists are copied to the device directly from the mapping,
+ * without intermediate host buffers.
+ *
+ * Experimental, both the API and the serialization format are subject to change.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * using IdxT = int64_t; // type of the index
+ * auto index = ivf_pq::deserialize_mapped<IdxT>(handle, "/path/to/index");
+ * @endcode
+ *
+ * @tparam IdxT type of the index
+ *
+ * @param[in] handle the raft handle
+ * @param[in] filename the name of the file that stores the index
+ *
+ * @return raft::neighbors::ivf_pq::index<IdxT>
+ */
+template <typename IdxT>
+index<IdxT> deserialize_mapped(raft::resources const& handle, const std::string& filename)
+{
+  return detail::deserialize_mapped<IdxT>(handle, filename);
+}
+
+/**
+ * A memory-mapped file saved by `serialize_mapped`, for loading the lists of an index lazily.
+ *
+ * `make_index` creates the index with the dense parameters (clusters, codebooks, rotation) only:
+ * all of its lists are empty. `load` then uploads the given lists from the mapping on demand, for
+ * example the lists a batch of queries is going to probe. Until a list is loaded it counts as
+ * empty, so a search skips its records. Loading modifies the index: it must not overlap a search
+ * on the same index.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * ivf_pq::mapped_lists<int64_t> file(handle, "/path/to/index");
+ * auto index = file.make_index(handle);
+ * // upload only the lists that will be probed
+ * std::vector<uint32_t> labels = ...;
+ * file.load(handle, &index, labels);
+ * ivf_pq::search(handle, search_params, index, queries, neighbors, distances);
+ * @endcode
+ *
+ * @tparam IdxT type of the index
+ */
+template <typename IdxT>
+using mapped_lists = detail::mapped_lists<IdxT>;
+
+/**
+ * Write the index to an output stream as a `faiss::IndexIVFPQ`.
+ *
+ * The stream can be read with `faiss::read_index`: the index has an `IndexFlat` coarse quantizer
+ * holding the cluster centers, the product quantizer codebooks and array inverted lists holding
+ * the codes. The codes are converted to the flat FAISS layout on the device in one pass (see
+ * `helpers::unpack_all_lists`) and are not re-encoded.
+ *
+ * FAISS encodes the residuals in the original space, with one codebook per subspace. Hence only
+ * the indices with the L2 or inner product metrics, `codebook_gen::PER_SUBSPACE` codebooks and no
+ * rotation can be written: build them with `force_random_rotation = false` and a `pq_dim`
+ * dividing the dim.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * ivf_pq::index_params params;
+ * params.codebook_kind         = ivf_pq::codebook_gen::PER_SUBSPACE;
+ * params.force_random_rotation = false;
+ * params.pq_dim                = dim / 2;
+ * auto index = ivf_pq::build(handle, params, dataset);
+ * std::ofstream of("/path/to/index.faiss", std::ios::out | std::ios::binary);
+ * ivf_pq::serialize_to_faiss(handle, of, index);
+ * @endcode
+ *
+ * @tparam IdxT type of the index
+ *
+ * @param[in] handle the raft handle
+ * @param[in] os output stream
+ * @param[in] index IVF-PQ index
+ */
+template <typename IdxT>
+void serialize_to_faiss(raft::resources const& handle, std::ostream& os, const index<IdxT>& index)
+{
+  detail::serialize_to_faiss(handle, os, index);
+}
+
+/**
+ * Save the index to file as a `faiss::IndexIVFPQ`; see the stream overload.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * ivf_pq::serialize_to_faiss(handle, "/path/to/index.faiss", index);
+ * // in python: index = faiss.read_index("/path/to/index.faiss")
+ * @endcode
+ *
+ * @tparam IdxT type of the index
+ *
+ * @param[in] handle the raft handle
+ * @param[in] filename the file name for saving the index
+ * @param[in] index IVF-PQ index
+ */
+template <typename IdxT>
+void serialize_to_faiss(raft::resources const& handle,
+                        const std::string& filename,
+                        const index<IdxT>& index)
+{
+  detail::serialize_to_faiss(handle, filename, index);
+}
+
+/**
+ * Load a `faiss::IndexIVFPQ` from an input stream.
+ *
+ * The stream must hold an index written by `faiss::write_index` (or `serialize_to_faiss`) with a
+ * flat coarse quantizer, array inverted lists, the L2 or inner product metric, residual encoding
+ * (`by_residual`) and 4 to 8 bits per code. The resulting index has `codebook_gen::PER_SUBSPACE`
+ * codebooks and an identity rotation; the codes are packed into the lists in one pass (see
+ * `helpers::pack_all_lists`), without re-encoding.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * std::ifstream is("/path/to/index.faiss", std::ios::in | std::ios::binary);
+ * auto index = ivf_pq::deserialize_from_faiss<int64_t>(handle, is);
+ * @endcode
+ *
+ * @tparam IdxT type of the index
+ *
+ * @param[in] handle the raft handle
+ * @param[in] is input stream
+ *
+ * @return raft::neighbors::ivf_pq::index<IdxT>
+ */
+template <typename IdxT>
+index<IdxT> deserialize_from_faiss(raft::resources const& handle, std::istream& is)
+{
+  return detail::deserialize_from_faiss<IdxT>(handle, is);
+}
+
+/**
+ * Load a `faiss::IndexIVFPQ` from file; see the stream overload.
+ *
+ * @code{.cpp}
+ * #include <raft/core/resources.hpp>
+ *
+ * raft::resources handle;
+ *
+ * auto index = ivf_pq::deserialize_from_faiss<int64_t>(handle, "/path/to/index.faiss");
+ * @endcode
+ *
+ * @tparam IdxT type of the index
+ *
+ * @param[in] handle the raft handle
+ * @param[in] filename the name of the file that stores the index
+ *
+ * @return raft::neighbors::ivf_pq::index<IdxT>
+ */
+template <typename IdxT>
+index<IdxT> deserialize_from_faiss(raft::resources const& handle, const std::string& filename)
+{
+  return detail::deserialize_from_faiss<IdxT>(handle, filename);
+}
+
 /**@}*/
 
 }  // namespace raft::neighbors::ivf_pq
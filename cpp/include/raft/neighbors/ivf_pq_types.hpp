@@ -27,6 +27,11 @@
 #include <raft/distance/distance_types.hpp>
 #include <raft/util/integer_utils.hpp>
 
+#include <rmm/mr/device/device_memory_resource.hpp>
+#include <rmm/mr/device/managed_memory_resource.hpp>
+#include <rmm/mr/device/per_device_resource.hpp>
+#include <rmm/mr/device/pool_memory_resource.hpp>
+
 #include <thrust/fill.h>
 
 #include <memory>
@@ -45,6 +50,43 @@ enum class codebook_gen {  // NOLINT
   PER_CLUSTER  = 1,        // NOLINT
 };
 
+/** A type for specifying where the inverted lists (clusters) data is allocated. */
+enum class list_memory_type {  // NOLINT
+  /** Device memory (the current device memory resource). */
+  DEVICE = 0,  // NOLINT
+  /**
+   * CUDA managed (unified) memory. The lists may then exceed the device memory: the pages of the
+   * lists probed by a search migrate to the device when they're accessed, the frequently probed
+   * lists stay cached in device memory, and the least recently used pages are evicted back to the
+   * host when the device memory is oversubscribed.
+   */
+  MANAGED = 1,  // NOLINT
+  /**
+   * Device memory carved out of slabs shared by all lists of the index (a memory pool over the
+   * current device memory resource, growing geometrically). This saves an allocation per list and
+   * the fragmentation caused by the list reallocations of many small `extend` calls. The slabs are
+   * released once the index and all the lists allocated in them are destroyed.
+   */
+  POOLED = 2,  // NOLINT
+};
+
+/**
+ * The memory resource to allocate the lists data with, or `nullptr` for the current device memory
+ * resource. The pooled memory is specific to an index (see `index::make_list_spec`).
+ */
+inline auto list_memory_resource(list_memory_type memory_type) -> rmm::mr::device_memory_resource*
+{
+  switch (memory_type) {
+    case list_memory_type::DEVICE: return nullptr;
+    case list_memory_type::MANAGED: {
+      static rmm::mr::managed_memory_resource managed_memory{};
+      return &managed_memory;
+    }
+    case list_memory_type::POOLED: RAFT_FAIL("The list memory pool is owned by the index");
+    default: RAFT_FAIL("Unreachable code");
+  }
+}
+
 struct index_params : ann::index_params {
   /**
    * The number of inverted lists (clusters)
@@ -95,6 +137,17 @@ struct index_params : ann::index_params {
    * regardless of the values of `dim` and `pq_dim`.
    */
   bool force_random_rotation = false;
+  /**
+   * The number of iterations of the optimized product quantization (OPQ) to learn the rotation
+   * matrix. When zero, the rotation is kept as described above.
+   *
+   * Otherwise, starting from that rotation, the algorithm alternates between training per-subspace
+   * PQ codebooks on the rotated cluster residuals of the training set and updating the rotation to
+   * the orthogonal transform that best maps the residuals onto their quantized values (orthogonal
+   * Procrustes, solved with an SVD). The learned rotation reduces the quantization error, which
+   * allows to reach the same recall with a smaller `pq_dim`, at the cost of a longer build time.
+   */
+  uint32_t opq_n_iters = 0;
   /**
    * By default, the algorithm allocates more space than necessary for individual clusters
    * (`list_data`). This allows to amortize the cost of memory allocation and reduce the number of
@@ -105,19 +158,58 @@ struct index_params : ann::index_params {
    * flag to `true` if you prefer to use as little GPU memory for the database as possible.
    */
   bool conservative_memory_allocation = false;
+  /**
+   * Where to allocate the inverted lists (clusters) data.
+   *
+   * The lists take most of the memory of the index, but a search only reads the `n_probes` lists
+   * closest to every query. Use `list_memory_type::MANAGED` for indexes that don't fit in the
+   * device memory: only the probed lists are then moved to the device, on demand.
+   */
+  list_memory_type list_memory = list_memory_type::DEVICE;
+};
+
+/** Parameters of `helpers::rebalance`. */
+struct rebalance_params {
+  /**
+   * The lists holding more than `max_list_size_ratio` times the mean number of records per list
+   * are split in two.
+   */
+  double max_list_size_ratio = 4.0;
+  /** The number of iterations of the k-means splitting an oversized list. */
+  uint32_t kmeans_n_iters = 20;
 };
 
 struct search_params : ann::search_params {
   /** The number of clusters to search. */
   uint32_t n_probes = 20;
+  /**
+   * Enables the adaptive probing when positive: among the `n_probes` clusters closest to a query,
+   * the clusters whose center is more than `probe_distance_ratio` times farther from the query
+   * than the closest center (comparing the L2 distances) are skipped. This way, the queries that
+   * fall well within a cluster probe fewer lists, while `n_probes` remains the maximum number of
+   * probes for the others.
+   *
+   * Possible values: 0 (disabled) or >= 1. The smaller the value, the fewer lists are probed.
+   * Only applies to the L2 metrics and is ignored for the inner product.
+   */
+  float probe_distance_ratio = 0;
   /**
    * Data type of look up table to be created dynamically at search time.
    *
-   * Possible values: [CUDA_R_32F, CUDA_R_16F, CUDA_R_8U]
+   * Possible values: [CUDA_R_32F, CUDA_R_16F, CUDA_R_8U, CUDA_R_8F_E4M3, CUDA_R_8F_E5M2]
    *
    * The use of low-precision types reduces the amount of shared memory required at search time, so
    * fast shared memory kernels can be used even for datasets with large dimansionality. Note that
    * the recall is slightly degraded when low-precision type is selected.
+   *
+   * CUDA_R_8U is a custom 8-bit floating-point format with five exponent bits. CUDA_R_8F_E4M3 and
+   * CUDA_R_8F_E5M2 are the standard FP8 formats (CUDA 11.8 or newer), converted natively by the
+   * sm_89 and newer GPUs: E4M3 is more precise, but saturates at +-448, so it suits the data of a
+   * small range of distances; E5M2 covers a range similar to that of CUDA_R_16F.
+   *
+   * When the library is built with `RAFT_IVF_PQ_FP8_LUT=OFF` (which defines
+   * `RAFT_IVF_PQ_DISABLE_FP8_LUT`), the 8-bit look up table kernels are not compiled and
+   * all 8-bit types fall back to CUDA_R_16F.
    */
   cudaDataType_t lut_dtype = CUDA_R_32F;
   /**
@@ -144,10 +236,28 @@ struct search_params : ann::search_params {
    * performance if tweaked incorrectly.
    */
   double preferred_shmem_carveout = 1.0;
+  /**
+   * The number of candidates per requested neighbor refined within `search`, when it is given
+   * the raw dataset: the PQ scan selects `k * refine_ratio` candidates per query (at least `k`),
+   * which are re-ranked by their exact distances to the query before the final top-`k` is
+   * returned. Ignored by the searches without the dataset.
+   */
+  float refine_ratio = 1;
+};
+
+struct range_search_params : search_params {
+  /** Number of neighbors searched per query in the first round of `ivf_pq::range_search`. */
+  uint32_t initial_k = 64;
+  /**
+   * Upper limit of the neighborhood size of a query. The queries whose `k` search results are all
+   * within the radius are searched again for `2 * k` neighbors, up to this limit.
+   */
+  uint32_t max_k = 512;
 };
 
 static_assert(std::is_aggregate_v<index_params>);
 static_assert(std::is_aggregate_v<search_params>);
+static_assert(std::is_aggregate_v<range_search_params>);
 
 /** Size of the interleaved group. */
 constexpr static uint32_t kIndexGroupSize = 32;
@@ -181,6 +291,10 @@ struct list_spec {
   SizeT align_min;
   uint32_t pq_bits;
   uint32_t pq_dim;
+  /** The memory resource to allocate the lists with (nullptr: the current device resource) */
+  rmm::mr::device_memory_resource* mr = nullptr;
+  /** Shares the ownership of `mr` with the lists, when it is specific to the index. */
+  std::shared_ptr<rmm::mr::device_memory_resource> mr_owner = nullptr;
 
   constexpr list_spec(uint32_t pq_bits, uint32_t pq_dim, bool conservative_memory_allocation)
     : pq_bits(pq_bits),
@@ -196,7 +310,9 @@ struct list_spec {
     : pq_bits{other_spec.pq_bits},
       pq_dim{other_spec.pq_dim},
       align_min{other_spec.align_min},
-      align_max{other_spec.align_max}
+      align_max{other_spec.align_max},
+      mr{other_spec.mr},
+      mr_owner{other_spec.mr_owner}
   {
   }
 
@@ -255,6 +371,12 @@ using list_data = ivf::list<list_spec, SizeT, IdxT>;
  * In either case, the centroids are again found using k-means clustering interpreting the data as
  * having pq_len dimensions.
  *
+ * Thread safety: `ivf_pq::search` and `ivf_pq::search_with_filtering` take the index by const
+ * reference and never modify it, so any number of host threads may search one index concurrently,
+ * each with its own `raft::resources` (the temporary buffers of a search come from the resources of
+ * the call). The index must not be modified (extended or moved to another list memory) while it is
+ * being searched.
+ *
  * [1] Product quantization for nearest neighbor search Herve Jegou, Matthijs Douze, Cordelia Schmid
  *
  * @tparam IdxT type of the indices in the source dataset
@@ -266,7 +388,7 @@ struct index : ann::index {
                 "IdxT must be able to represent all values of uint32_t");
 
  public:
-  /** Total length of the index. */
+  /** Total length of the index (including the removed records not compacted yet). */
   [[nodiscard]] constexpr inline auto size() const noexcept -> IdxT
   {
     return accum_sorted_sizes_(n_lists());
@@ -323,6 +445,39 @@ struct index : ann::index {
   {
     return conservative_memory_allocation_;
   }
+  /** Where the list data is allocated (see index_params.list_memory). */
+  [[nodiscard]] constexpr inline auto list_memory() const noexcept -> list_memory_type
+  {
+    return list_memory_;
+  }
+  /**
+   * Set where the lists allocated from now on are placed. This doesn't move the existing lists;
+   * use `ivf_pq::helpers::set_list_memory` for that.
+   */
+  void set_list_memory(list_memory_type memory_type)
+  {
+    list_memory_ = memory_type;
+    // The pool is created here rather than on the first list allocation, so that the const
+    // methods of the index never modify it.
+    if (list_memory_ == list_memory_type::POOLED && !list_pool_) {
+      list_pool_ = std::make_shared<rmm::mr::pool_memory_resource<rmm::mr::device_memory_resource>>(
+        rmm::mr::get_current_device_resource(), 0);
+    }
+  }
+  /** The spec to allocate the lists of this index with. */
+  template <typename SizeT = uint32_t>
+  [[nodiscard]] auto make_list_spec() const -> list_spec<SizeT, IdxT>
+  {
+    auto spec = list_spec<SizeT, IdxT>{pq_bits(), pq_dim(), conservative_memory_allocation()};
+    if (list_memory() == list_memory_type::POOLED) {
+      // The lists keep the pool alive: they may be shared with a clone of this index.
+      spec.mr_owner = list_pool_;
+      spec.mr       = list_pool_.get();
+    } else {
+      spec.mr = list_memory_resource(list_memory());
+    }
+    return spec;
+  }
 
   // Don't allow copying the index for performance reasons (try avoiding copying data)
   index(const index&)                    = delete;
@@ -339,7 +494,8 @@ struct index : ann::index {
         uint32_t dim,
         uint32_t pq_bits                    = 8,
         uint32_t pq_dim                     = 0,
-        bool conservative_memory_allocation = false)
+        bool conservative_memory_allocation = false,
+        list_memory_type list_memory        = list_memory_type::DEVICE)
     : ann::index(),
       metric_(metric),
       codebook_kind_(codebook_kind),
@@ -347,6 +503,7 @@ struct index : ann::index {
       pq_bits_(pq_bits),
       pq_dim_(pq_dim == 0 ? calculate_pq_dim(dim) : pq_dim),
       conservative_memory_allocation_(conservative_memory_allocation),
+      list_memory_(list_memory),
       pq_centers_{make_device_mdarray<float>(handle, make_pq_centers_extents())},
       lists_{n_lists},
       rotation_matrix_{make_device_matrix<float, uint32_t>(handle, this->rot_dim(), this->dim())},
@@ -355,10 +512,12 @@ struct index : ann::index {
       centers_rot_{make_device_matrix<float, uint32_t>(handle, n_lists, this->rot_dim())},
       data_ptrs_{make_device_vector<uint8_t*, uint32_t>(handle, n_lists)},
       inds_ptrs_{make_device_vector<IdxT*, uint32_t>(handle, n_lists)},
+      removed_ptrs_{make_device_vector<uint32_t*, uint32_t>(handle, n_lists)},
       accum_sorted_sizes_{make_host_vector<IdxT, uint32_t>(n_lists + 1)}
   {
     check_consistency();
     accum_sorted_sizes_(n_lists) = 0;
+    set_list_memory(list_memory);
   }
 
   /** Construct an empty index. It needs to be trained and then populated. */
@@ -370,7 +529,8 @@ struct index : ann::index {
             dim,
             params.pq_bits,
             params.pq_dim,
-            params.conservative_memory_allocation)
+            params.conservative_memory_allocation,
+            params.list_memory)
   {
   }
 
@@ -424,6 +584,34 @@ struct index : ann::index {
       inds_ptrs_.data_handle(), inds_ptrs_.extents());
   }
 
+  /**
+   * Pointers to the bitmasks of the records removed from the lists (`list_data::removed_bits`)
+   * [n_lists]; null for the lists without removed records.
+   */
+  inline auto removed_ptrs() noexcept -> device_vector_view<uint32_t*, uint32_t, row_major>
+  {
+    return removed_ptrs_.view();
+  }
+  [[nodiscard]] inline auto removed_ptrs() const noexcept
+    -> device_vector_view<const uint32_t* const, uint32_t, row_major>
+  {
+    return make_mdspan<const uint32_t* const, uint32_t, row_major, false, true>(
+      removed_ptrs_.data_handle(), removed_ptrs_.extents());
+  }
+
+  /**
+   * The number of the records removed by `helpers::remove` but not compacted yet: they still
+   * count in `size()`, but the searches never return them.
+   */
+  [[nodiscard]] inline auto n_removed() const noexcept -> IdxT
+  {
+    IdxT n = 0;
+    for (const auto& list : lists_) {
+      if (list) { n += list->n_removed; }
+    }
+    return n;
+  }
+
   /** The transform matrix (original space -> rotated padded space) [rot_dim, dim] */
   inline auto rotation_matrix() noexcept -> device_matrix_view<float, uint32_t, row_major>
   {
@@ -511,6 +699,22 @@ struct index : ann::index {
     return list_data.size();
   }
 
+  /** The `pq_dim` of an index of the dimensionality `dim` built with `index_params::pq_dim = 0`. */
+  static inline auto calculate_pq_dim(uint32_t dim) -> uint32_t
+  {
+    // If the dimensionality is large enough, we can reduce it to improve performance
+    if (dim >= 128) { dim /= 2; }
+    // Round it down to 32 to improve performance.
+    auto r = raft::round_down_safe<uint32_t>(dim, 32);
+    if (r > 0) return r;
+    // If the dimensionality is really low, round it to the closest power-of-two
+    r = 1;
+    while ((r << 1) <= dim) {
+      r = r << 1;
+    }
+    return r;
+  }
+
  private:
   raft::distance::DistanceType metric_;
   codebook_gen codebook_kind_;
@@ -518,6 +722,9 @@ struct index : ann::index {
   uint32_t pq_bits_;
   uint32_t pq_dim_;
   bool conservative_memory_allocation_;
+  list_memory_type list_memory_;
+  // Created by set_list_memory for list_memory_type::POOLED
+  std::shared_ptr<rmm::mr::device_memory_resource> list_pool_;
 
   // Primary data members
   std::vector<std::shared_ptr<list_data<IdxT>>> lists_;
@@ -530,6 +737,7 @@ struct index : ann::index {
   // Computed members for accelerating search.
   device_vector<uint8_t*, uint32_t, row_major> data_ptrs_;
   device_vector<IdxT*, uint32_t, row_major> inds_ptrs_;
+  device_vector<uint32_t*, uint32_t, row_major> removed_ptrs_;
   host_vector<IdxT, uint32_t, row_major> accum_sorted_sizes_;
 
   /** Throw an error if the index content is inconsistent. */
@@ -555,21 +763,6 @@ struct index : ann::index {
       default: RAFT_FAIL("Unreachable code");
     }
   }
-
-  static inline auto calculate_pq_dim(uint32_t dim) -> uint32_t
-  {
-    // If the dimensionality is large enough, we can reduce it to improve performance
-    if (dim >= 128) { dim /= 2; }
-    // Round it down to 32 to improve performance.
-    auto r = raft::round_down_safe<uint32_t>(dim, 32);
-    if (r > 0) return r;
-    // If the dimensionality is really low, round it to the closest power-of-two
-    r = 1;
-    while ((r << 1) <= dim) {
-      r = r << 1;
-    }
-    return r;
-  }
 };
 
 /** @} */
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/memory_type.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/neighbors/ann_types.hpp>
+#include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/detail/cagra/cagra_memory.cuh>
+#include <raft/neighbors/detail/ivf_pq_memory.cuh>
+#include <raft/neighbors/detail/nn_descent_memory.cuh>
+#include <raft/neighbors/ivf_pq_types.hpp>
+#include <raft/neighbors/nn_descent_types.hpp>
+
+#include <cstdint>
+
+/**
+ * @defgroup ann_memory_estimate Memory footprint estimates of the ANN builds and searches
+ *
+ * The `estimate_memory` functions compute, without allocating anything, the device and host
+ * memory taken by a build or a search with the given parameters, as an `ann::memory_estimate`.
+ * Use them to size the memory pools, to choose the build parameters or the number of dataset
+ * shards that fit into a device, or the batch size of the queries.
+ *
+ * The estimates follow the dominant allocations of the algorithms (assuming the records spread
+ * evenly over the IVF lists) and do not include the workspaces of the libraries (cuBLAS, CUB) nor
+ * the allocator overheads; leave some headroom when planning against them.
+ *
+ * @code{.cpp}
+ * #include <raft/neighbors/memory_estimate.cuh>
+ *
+ * cagra::index_params params;
+ * auto estimate = cagra::estimate_memory<float, uint32_t>(
+ *   res, params, n_rows, dim, raft::memory_type::host);
+ * size_t free_bytes, total_bytes;
+ * RAFT_CUDA_TRY(cudaMemGetInfo(&free_bytes, &total_bytes));
+ * if (estimate.device_peak() > free_bytes) {
+ *   // shard the dataset, or build with NN-descent, etc.
+ * }
+ * @endcode
+ * @{
+ */
+
+namespace raft::neighbors::ivf_pq {
+
+/**
+ * @brief Estimate the memory of `ivf_pq::build` on a dataset of the given size.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resources (the stream pool and the device properties are used)
+ * @param[in] params the build parameters
+ * @param[in] n_rows the number of rows of the dataset
+ * @param[in] dim the dimensionality of the dataset
+ * @param[in] dataset_memory where the dataset is
+ *
+ * @return the index (device or, with managed lists, host memory) and the build workspace
+ */
+template <typename T, typename IdxT = int64_t>
+auto estimate_memory(raft::resources const& res,
+                     const index_params& params,
+                     int64_t n_rows,
+                     uint32_t dim,
+                     memory_type dataset_memory = memory_type::device) -> ann::memory_estimate
+{
+  return detail::estimate_build_memory<T, IdxT>(res, params, n_rows, dim, dataset_memory);
+}
+
+/**
+ * @brief Estimate the workspace of `ivf_pq::search` of `n_queries` queries in the index.
+ *
+ * @tparam IdxT type of the indices in the source dataset
+ *
+ * @param[in] res raft resources (the stream pool and the device properties are used)
+ * @param[in] params the search parameters
+ * @param[in] index the index to search
+ * @param[in] n_queries the number of queries of a `search` call
+ * @param[in] k the number of neighbors
+ *
+ * @return the search workspace (`device_workspace`)
+ */
+template <typename IdxT>
+auto estimate_memory(raft::resources const& res,
+                     const search_params& params,
+                     const index<IdxT>& index,
+                     uint32_t n_queries,
+                     uint32_t k) -> ann::memory_estimate
+{
+  return detail::estimate_search_memory(res, params, index, n_queries, k);
+}
+
+}  // namespace raft::neighbors::ivf_pq
+
+namespace raft::neighbors::experimental::nn_descent {
+
+/**
+ * @brief Estimate the memory of `nn_descent::build` on a dataset of the given size.
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices of the graph
+ *
+ * @param[in] params the build parameters
+ * @param[in] n_rows the number of rows of the dataset
+ * @param[in] dim the dimensionality of the dataset
+ * @param[in] dataset_memory where the dataset is
+ *
+ * @return the build workspace and the host memory of the build and of the graph
+ */
+template <typename T, typename IdxT = uint32_t>
+auto estimate_memory(const index_params& params,
+                     int64_t n_rows,
+                     uint32_t dim,
+                     memory_type dataset_memory = memory_type::device) -> ann::memory_estimate
+{
+  return detail::estimate_build_memory<T, IdxT>(params, n_rows, dim, dataset_memory);
+}
+
+}  // namespace raft::neighbors::experimental::nn_descent
+
+namespace raft::neighbors::cagra {
+
+/**
+ * @brief Estimate the memory of `cagra::build` on a dataset of the given size.
+ *
+ * The kNN graph is assumed to be built with the default parameters of `params.build_algo`, and
+ * the dataset to be attached to the index as a device copy (if `params.attach_dataset_on_build`).
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices of the graph
+ *
+ * @param[in] res raft resources (the stream pool and the device properties are used)
+ * @param[in] params the build parameters
+ * @param[in] n_rows the number of rows of the dataset
+ * @param[in] dim the dimensionality of the dataset
+ * @param[in] dataset_memory where the dataset is
+ *
+ * @return the index, the build workspace and the host memory of the build
+ */
+template <typename T, typename IdxT = uint32_t>
+auto estimate_memory(raft::resources const& res,
+                     const index_params& params,
+                     int64_t n_rows,
+                     uint32_t dim,
+                     memory_type dataset_memory = memory_type::device) -> ann::memory_estimate
+{
+  return detail::estimate_build_memory<T, IdxT>(res, params, n_rows, dim, dataset_memory);
+}
+
+/**
+ * @brief Estimate the workspace of `cagra::search` of `n_queries` queries in the index.
+ *
+ * The estimate is that of the unfiltered search (a filtered search may use a larger hash table).
+ *
+ * @tparam T data element type
+ * @tparam IdxT type of the indices of the graph
+ *
+ * @param[in] res raft resources (the device properties are used)
+ * @param[in] params the search parameters
+ * @param[in] index the index to search
+ * @param[in] n_queries the number of queries of a `search` call
+ * @param[in] k the number of neighbors
+ *
+ * @return the search workspace (`device_workspace`)
+ */
+template <typename T, typename IdxT>
+auto estimate_memory(raft::resources const& res,
+                     const search_params& params,
+                     const index<T, IdxT>& index,
+                     uint32_t n_queries,
+                     uint32_t k) -> ann::memory_estimate
+{
+  return detail::estimate_search_memory(res, params, index, n_queries, k);
+}
+
+}  // namespace raft::neighbors::cagra
+
+/** @} */  // end group ann_memory_estimate
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -46,7 +46,8 @@ namespace raft::neighbors::experimental::nn_descent {
  *   // dataset
  * @endcode
  *
- * @tparam T data-type of the input dataset
+ * @tparam T data-type of the input dataset: float, half, int8_t or uint8_t (8-bit datasets are
+ *           kept in their type on the device, half the footprint of the fp16 copy of the others)
  * @tparam IdxT data-type for the output index
  * @param[in] res raft::resources is an object mangaging resources
  * @param[in] params an instance of nn_descent::index_params that are parameters
@@ -83,7 +84,8 @@ index<IdxT> build(raft::resources const& res,
  *   // dataset
  * @endcode
  *
- * @tparam T data-type of the input dataset
+ * @tparam T data-type of the input dataset: float, half, int8_t or uint8_t (8-bit datasets are
+ *           kept in their type on the device, half the footprint of the fp16 copy of the others)
  * @tparam IdxT data-type for the output index
  * @param res raft::resources is an object mangaging resources
  * @param[in] params an instance of nn_descent::index_params that are parameters
@@ -120,7 +122,8 @@ void build(raft::resources const& res,
  *   // dataset
  * @endcode
  *
- * @tparam T data-type of the input dataset
+ * @tparam T data-type of the input dataset: float, half, int8_t or uint8_t (8-bit datasets are
+ *           kept in their type on the device, half the footprint of the fp16 copy of the others)
  * @tparam IdxT data-type for the output index
  * @param res raft::resources is an object mangaging resources
  * @param[in] params an instance of nn_descent::index_params that are parameters
@@ -157,7 +160,8 @@ index<IdxT> build(raft::resources const& res,
  *   // dataset
  * @endcode
  *
- * @tparam T data-type of the input dataset
+ * @tparam T data-type of the input dataset: float, half, int8_t or uint8_t (8-bit datasets are
+ *           kept in their type on the device, half the footprint of the fp16 copy of the others)
  * @tparam IdxT data-type for the output index
  * @param[in] res raft::resources is an object mangaging resources
  * @param[in] params an instance of nn_descent::index_params that are parameters
@@ -0,0 +1,620 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cancellation_token.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/matrix/gather.cuh>
+#include <raft/neighbors/detail/comms_utils.cuh>
+#include <raft/neighbors/nn_descent.cuh>
+#include <raft/neighbors/nn_descent_types.hpp>
+#include <raft/util/cuda_dev_essentials.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace raft::neighbors::experimental::nn_descent {
+
+/**
+ * @defgroup nn_descent_distributed nn-descent across a comms clique
+ * @{
+ */
+
+namespace detail {
+
+/** The number of new (and old) neighbors of a row sampled for the join of an iteration. */
+constexpr size_t kDistributedSamples = 16;
+/** The number of candidate pairs evaluated between two exchanges of the join. */
+constexpr size_t kDistributedPairsPerBatch = size_t{1} << 22;
+
+/** The contiguous ranges of the global ids owned by the ranks (the rank order of the shards). */
+template <typename IdxT>
+struct shard_layout {
+  std::vector<size_t> offsets;  // [n_ranks + 1]
+  int rank;
+
+  [[nodiscard]] auto owner(IdxT id) const -> int
+  {
+    return std::upper_bound(offsets.begin(), offsets.end(), size_t(id)) - offsets.begin() - 1;
+  }
+  [[nodiscard]] auto begin() const -> size_t { return offsets[rank]; }
+  [[nodiscard]] auto n_local() const -> size_t { return offsets[rank + 1] - offsets[rank]; }
+  [[nodiscard]] auto n_total() const -> size_t { return offsets.back(); }
+};
+
+/** The knn lists of the local rows: global ids sorted by distance, with the NN-descent flags. */
+template <typename IdxT>
+struct knn_lists {
+  static constexpr IdxT kInvalid = std::numeric_limits<IdxT>::max();
+
+  size_t n_rows;
+  size_t degree;
+  std::vector<IdxT> ids;
+  std::vector<float> dists;
+  std::vector<uint8_t> is_new;
+
+  knn_lists(size_t n_rows, size_t degree)
+    : n_rows{n_rows},
+      degree{degree},
+      ids(n_rows * degree, kInvalid),
+      dists(n_rows * degree, std::numeric_limits<float>::max()),
+      is_new(n_rows * degree, 0)
+  {
+  }
+
+  /** Insert a candidate into the list of a row; returns whether the list changed. */
+  auto insert(size_t row, IdxT id, float dist, bool mark_new) -> bool
+  {
+    IdxT* list_ids    = ids.data() + row * degree;
+    float* list_dists = dists.data() + row * degree;
+    uint8_t* flags    = is_new.data() + row * degree;
+    if (dist >= list_dists[degree - 1]) { return false; }
+    size_t pos = degree;
+    for (size_t i = 0; i < degree; i++) {
+      if (list_ids[i] == id) { return false; }
+      if (pos == degree && list_dists[i] > dist) { pos = i; }
+    }
+    for (size_t i = degree - 1; i > pos; i--) {
+      list_ids[i]   = list_ids[i - 1];
+      list_dists[i] = list_dists[i - 1];
+      flags[i]      = flags[i - 1];
+    }
+    list_ids[pos]   = id;
+    list_dists[pos] = dist;
+    flags[pos]      = mark_new;
+    return true;
+  }
+
+  /** Drop all but the first `keep` neighbors of every row. */
+  void truncate(size_t keep)
+  {
+    for (size_t i = 0; i < n_rows; i++) {
+      for (size_t j = keep; j < degree; j++) {
+        ids[i * degree + j]    = kInvalid;
+        dists[i * degree + j]  = std::numeric_limits<float>::max();
+        is_new[i * degree + j] = 0;
+      }
+    }
+  }
+};
+
+/** The squared L2 distances of the pairs of rows of `rows`, one warp per pair. */
+template <typename T>
+RAFT_KERNEL pair_distances_kernel(
+  const T* rows, const size_t dim, const uint32_t* pairs, const size_t n_pairs, float* dists)
+{
+  size_t pair = (size_t(blockIdx.x) * blockDim.x + threadIdx.x) / raft::warp_size();
+  if (pair >= n_pairs) { return; }
+  int lane_id = threadIdx.x % raft::warp_size();
+  const T* a  = rows + size_t(pairs[2 * pair]) * dim;
+  const T* b  = rows + size_t(pairs[2 * pair + 1]) * dim;
+  float dist  = 0;
+  for (size_t i = lane_id; i < dim; i += raft::warp_size()) {
+    float d = static_cast<float>(a[i]) - static_cast<float>(b[i]);
+    dist += d * d;
+  }
+  for (int offset = raft::warp_size() >> 1; offset >= 1; offset >>= 1) {
+    dist += __shfl_down_sync(raft::warp_full_mask(), dist, offset);
+  }
+  if (lane_id == 0) { dists[pair] = dist; }
+}
+
+/** The maximum of a host value over all the ranks of the communicator. */
+inline auto allreduce_max(raft::resources const& res, uint64_t value) -> uint64_t
+{
+  const auto& comms = resource::get_comms(res);
+  auto stream       = resource::get_cuda_stream(res);
+  auto buf          = raft::make_device_scalar<uint64_t>(res, value);
+  comms.allreduce(buf.data_handle(), buf.data_handle(), 1, raft::comms::op_t::MAX, stream);
+  raft::copy(&value, buf.data_handle(), 1, stream);
+  resource::sync_stream(res);
+  return value;
+}
+
+/** The sum of a host value over all the ranks of the communicator. */
+inline auto allreduce_sum(raft::resources const& res, uint64_t value) -> uint64_t
+{
+  const auto& comms = resource::get_comms(res);
+  auto stream       = resource::get_cuda_stream(res);
+  auto buf          = raft::make_device_scalar<uint64_t>(res, value);
+  comms.allreduce(buf.data_handle(), buf.data_handle(), 1, raft::comms::op_t::SUM, stream);
+  raft::copy(&value, buf.data_handle(), 1, stream);
+  resource::sync_stream(res);
+  return value;
+}
+
+/**
+ * Fetch the rows of the (sorted, unique) global ids from the ranks owning them; collective.
+ * The rows are exchanged as bytes, which covers all the dataset types.
+ */
+template <typename T, typename IdxT>
+auto fetch_rows(raft::resources const& res,
+                raft::device_matrix_view<const T, int64_t, row_major> dataset,
+                const shard_layout<IdxT>& shards,
+                const std::vector<IdxT>& ids) -> raft::device_matrix<T, int64_t, row_major>
+{
+  const auto& comms = resource::get_comms(res);
+  auto stream       = resource::get_cuda_stream(res);
+  int size          = comms.get_size();
+  int64_t dim       = dataset.extent(1);
+
+  std::vector<size_t> send_counts(size);
+  for (int r = 0; r < size; r++) {
+    send_counts[r] = std::lower_bound(ids.begin(), ids.end(), shards.offsets[r + 1]) -
+                     std::lower_bound(ids.begin(), ids.end(), shards.offsets[r]);
+  }
+  auto requests = raft::make_device_vector<IdxT, int64_t>(res, ids.size());
+  raft::update_device(requests.data_handle(), ids.data(), ids.size(), stream);
+
+  auto recv_counts = raft::neighbors::detail::exchange_counts(comms, send_counts, stream);
+  int64_t n_recv   = std::accumulate(recv_counts.begin(), recv_counts.end(), size_t(0));
+  auto requested   = raft::make_device_vector<IdxT, int64_t>(res, n_recv);
+  raft::neighbors::detail::all_to_all(
+    comms, requests.data_handle(), send_counts, requested.data_handle(), recv_counts, 1, stream);
+  comms.sync_stream(stream);
+
+  auto replies = raft::make_device_matrix<T, int64_t>(res, n_recv, dim);
+  if (n_recv > 0) {
+    int64_t begin = shards.begin();
+    raft::matrix::gather(res,
+                         dataset,
+                         raft::make_const_mdspan(requested.view()),
+                         replies.view(),
+                         [begin] __device__(IdxT id) { return int64_t(id) - begin; });
+  }
+  auto rows      = raft::make_device_matrix<T, int64_t>(res, ids.size(), dim);
+  size_t row_len = dim * sizeof(T);
+  raft::neighbors::detail::all_to_all(comms,
+                                      reinterpret_cast<const uint8_t*>(replies.data_handle()),
+                                      recv_counts,
+                                      reinterpret_cast<uint8_t*>(rows.data_handle()),
+                                      send_counts,
+                                      row_len,
+                                      stream);
+  comms.sync_stream(stream);
+  return rows;
+}
+
+/**
+ * Evaluate the candidate pairs generated for the local rows, and insert every pair into the
+ * lists of both its ends (the updates are sent to the ranks owning them); collective.
+ *
+ * @param row_pairs appends the pairs (of global ids) generated for a local row to a vector;
+ *   at most `max_pairs_per_row`
+ * @return the number of the local lists updates
+ */
+template <typename T, typename IdxT, typename PairsFn>
+auto join(raft::resources const& res,
+          raft::device_matrix_view<const T, int64_t, row_major> dataset,
+          const shard_layout<IdxT>& shards,
+          knn_lists<IdxT>& lists,
+          size_t max_pairs_per_row,
+          bool mark_new,
+          PairsFn&& row_pairs) -> uint64_t
+{
+  const auto& comms = resource::get_comms(res);
+  auto stream       = resource::get_cuda_stream(res);
+  int size          = comms.get_size();
+  size_t n_local    = shards.n_local();
+  size_t batch_rows =
+    std::max<size_t>(1, kDistributedPairsPerBatch / std::max<size_t>(1, max_pairs_per_row));
+  // all the ranks take part in the same number of exchanges
+  uint64_t n_batches = allreduce_max(res, raft::ceildiv<size_t>(n_local, batch_rows));
+
+  uint64_t n_updates = 0;
+  std::vector<std::pair<IdxT, IdxT>> pairs;
+  std::vector<IdxT> ids;
+  for (uint64_t batch = 0; batch < n_batches; batch++) {
+    size_t row_begin = std::min(n_local, batch * batch_rows);
+    size_t row_end   = std::min(n_local, row_begin + batch_rows);
+    pairs.clear();
+    for (size_t row = row_begin; row < row_end; row++) {
+      row_pairs(row, pairs);
+    }
+
+    // the distances of the pairs, over the rows fetched from their owners
+    ids.clear();
+    for (auto [a, b] : pairs) {
+      ids.push_back(a);
+      ids.push_back(b);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    auto rows = fetch_rows(res, dataset, shards, ids);
+
+    std::vector<uint32_t> h_positions(2 * pairs.size());
+    for (size_t i = 0; i < pairs.size(); i++) {
+      h_positions[2 * i] = std::lower_bound(ids.begin(), ids.end(), pairs[i].first) - ids.begin();
+      h_positions[2 * i + 1] =
+        std::lower_bound(ids.begin(), ids.end(), pairs[i].second) - ids.begin();
+    }
+    auto positions = raft::make_device_vector<uint32_t, int64_t>(res, h_positions.size());
+    auto pair_dist = raft::make_device_vector<float, int64_t>(res, pairs.size());
+    raft::update_device(positions.data_handle(), h_positions.data(), h_positions.size(), stream);
+    if (!pairs.empty()) {
+      constexpr int kWarpsPerBlock = 8;
+      pair_distances_kernel<<<raft::ceildiv<size_t>(pairs.size(), kWarpsPerBlock),
+                              kWarpsPerBlock * raft::warp_size(),
+                              0,
+                              stream>>>(rows.data_handle(),
+                                        dataset.extent(1),
+                                        positions.data_handle(),
+                                        pairs.size(),
+                                        pair_dist.data_handle());
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    }
+    std::vector<float> h_dists(pairs.size());
+    raft::update_host(h_dists.data(), pair_dist.data_handle(), pairs.size(), stream);
+    resource::sync_stream(res);
+
+    // every pair updates the lists of both its ends, sent to their owners as (row, candidate)
+    std::vector<size_t> send_counts(size, 0);
+    for (auto [a, b] : pairs) {
+      send_counts[shards.owner(a)]++;
+      send_counts[shards.owner(b)]++;
+    }
+    std::vector<size_t> pos(size);
+    std::exclusive_scan(send_counts.begin(), send_counts.end(), pos.begin(), size_t(0));
+    std::vector<IdxT> h_send_ids(4 * pairs.size());
+    std::vector<float> h_send_dists(2 * pairs.size());
+    auto push = [&](IdxT row, IdxT candidate, float dist) {
+      auto p                = pos[shards.owner(row)]++;
+      h_send_ids[2 * p]     = row;
+      h_send_ids[2 * p + 1] = candidate;
+      h_send_dists[p]       = dist;
+    };
+    for (size_t i = 0; i < pairs.size(); i++) {
+      push(pairs[i].first, pairs[i].second, h_dists[i]);
+      push(pairs[i].second, pairs[i].first, h_dists[i]);
+    }
+    auto send_ids   = raft::make_device_vector<IdxT, int64_t>(res, h_send_ids.size());
+    auto send_dists = raft::make_device_vector<float, int64_t>(res, h_send_dists.size());
+    raft::update_device(send_ids.data_handle(), h_send_ids.data(), h_send_ids.size(), stream);
+    raft::update_device(
+      send_dists.data_handle(), h_send_dists.data(), h_send_dists.size(), stream);
+
+    auto recv_counts = raft::neighbors::detail::exchange_counts(comms, send_counts, stream);
+    size_t n_recv    = std::accumulate(recv_counts.begin(), recv_counts.end(), size_t(0));
+    auto recv_ids    = raft::make_device_vector<IdxT, int64_t>(res, 2 * n_recv);
+    auto recv_dists  = raft::make_device_vector<float, int64_t>(res, n_recv);
+    raft::neighbors::detail::all_to_all(
+      comms, send_ids.data_handle(), send_counts, recv_ids.data_handle(), recv_counts, 2, stream);
+    raft::neighbors::detail::all_to_all(comms,
+                                        send_dists.data_handle(),
+                                        send_counts,
+                                        recv_dists.data_handle(),
+                                        recv_counts,
+                                        1,
+                                        stream);
+    comms.sync_stream(stream);
+    std::vector<IdxT> h_recv_ids(2 * n_recv);
+    std::vector<float> h_recv_dists(n_recv);
+    raft::update_host(h_recv_ids.data(), recv_ids.data_handle(), 2 * n_recv, stream);
+    raft::update_host(h_recv_dists.data(), recv_dists.data_handle(), n_recv, stream);
+    resource::sync_stream(res);
+
+    for (size_t i = 0; i < n_recv; i++) {
+      size_t row = size_t(h_recv_ids[2 * i]) - shards.begin();
+      n_updates += lists.insert(row, h_recv_ids[2 * i + 1], h_recv_dists[i], mark_new);
+    }
+  }
+  return n_updates;
+}
+
+/**
+ * The join lists of an iteration: the sampled new and old neighbors of every local row, and
+ * the rows having it among their sampled neighbors (the reverse edges, received from the ranks
+ * owning these rows); collective. The sampled new neighbors are flagged old.
+ */
+template <typename IdxT>
+void sample_join_lists(raft::resources const& res,
+                       const shard_layout<IdxT>& shards,
+                       knn_lists<IdxT>& lists,
+                       std::mt19937_64& rng,
+                       std::vector<IdxT>& join_new,
+                       std::vector<IdxT>& join_old)
+{
+  const auto& comms   = resource::get_comms(res);
+  auto stream         = resource::get_cuda_stream(res);
+  int size            = comms.get_size();
+  size_t n_local      = shards.n_local();
+  constexpr auto S    = kDistributedSamples;
+  constexpr auto kInv = knn_lists<IdxT>::kInvalid;
+
+  // the forward samples
+  join_new.assign(n_local * 2 * S, kInv);
+  join_old.assign(n_local * 2 * S, kInv);
+  std::vector<size_t> n_new(n_local, 0), n_old(n_local, 0);
+  for (size_t row = 0; row < n_local; row++) {
+    for (size_t j = 0; j < lists.degree; j++) {
+      size_t e = row * lists.degree + j;
+      if (lists.ids[e] == kInv) { continue; }
+      if (lists.is_new[e] && n_new[row] < S) {
+        join_new[row * 2 * S + n_new[row]++] = lists.ids[e];
+        lists.is_new[e]                      = 0;
+      } else if (!lists.is_new[e] && n_old[row] < S) {
+        join_old[row * 2 * S + n_old[row]++] = lists.ids[e];
+      }
+    }
+  }
+
+  // the reverse edges (neighbor, row, is_new), sent to the owners of the neighbors
+  std::vector<size_t> send_counts(size, 0);
+  for (size_t row = 0; row < n_local; row++) {
+    for (size_t j = 0; j < n_new[row]; j++) {
+      send_counts[shards.owner(join_new[row * 2 * S + j])]++;
+    }
+    for (size_t j = 0; j < n_old[row]; j++) {
+      send_counts[shards.owner(join_old[row * 2 * S + j])]++;
+    }
+  }
+  std::vector<size_t> pos(size);
+  std::exclusive_scan(send_counts.begin(), send_counts.end(), pos.begin(), size_t(0));
+  size_t n_send = std::accumulate(send_counts.begin(), send_counts.end(), size_t(0));
+  std::vector<IdxT> h_send(3 * n_send);
+  for (size_t row = 0; row < n_local; row++) {
+    IdxT id = IdxT(shards.begin() + row);
+    for (int flag = 1; flag >= 0; flag--) {
+      const IdxT* sampled = (flag ? join_new.data() : join_old.data()) + row * 2 * S;
+      for (size_t j = 0; j < (flag ? n_new[row] : n_old[row]); j++) {
+        auto p        = 3 * pos[shards.owner(sampled[j])]++;
+        h_send[p]     = sampled[j];
+        h_send[p + 1] = id;
+        h_send[p + 2] = IdxT(flag);
+      }
+    }
+  }
+  auto send = raft::make_device_vector<IdxT, int64_t>(res, h_send.size());
+  raft::update_device(send.data_handle(), h_send.data(), h_send.size(), stream);
+  auto recv_counts = raft::neighbors::detail::exchange_counts(comms, send_counts, stream);
+  size_t n_recv    = std::accumulate(recv_counts.begin(), recv_counts.end(), size_t(0));
+  auto recv        = raft::make_device_vector<IdxT, int64_t>(res, 3 * n_recv);
+  raft::neighbors::detail::all_to_all(
+    comms, send.data_handle(), send_counts, recv.data_handle(), recv_counts, 3, stream);
+  comms.sync_stream(stream);
+  std::vector<IdxT> h_recv(3 * n_recv);
+  raft::update_host(h_recv.data(), recv.data_handle(), h_recv.size(), stream);
+  resource::sync_stream(res);
+
+  // up to S reverse edges of each kind per row (reservoir sampling), appended to the samples
+  std::vector<size_t> n_seen_new(n_local, 0), n_seen_old(n_local, 0);
+  std::vector<IdxT> rev_new(n_local * S, kInv), rev_old(n_local * S, kInv);
+  for (size_t i = 0; i < n_recv; i++) {
+    size_t row = size_t(h_recv[3 * i]) - shards.begin();
+    bool flag  = h_recv[3 * i + 2] != 0;
+    auto& seen = flag ? n_seen_new[row] : n_seen_old[row];
+    IdxT* rev  = (flag ? rev_new.data() : rev_old.data()) + row * S;
+    size_t j   = seen < S ? seen : std::uniform_int_distribution<size_t>(0, seen)(rng);
+    if (j < S) { rev[j] = h_recv[3 * i + 1]; }
+    seen++;
+  }
+  auto append = [](IdxT* list, size_t& n, IdxT id) {
+    if (id == kInv || std::find(list, list + n, id) != list + n) { return; }
+    list[n++] = id;
+  };
+  for (size_t row = 0; row < n_local; row++) {
+    for (size_t j = 0; j < S; j++) {
+      append(join_new.data() + row * 2 * S, n_new[row], rev_new[row * S + j]);
+    }
+    for (size_t j = 0; j < S; j++) {
+      IdxT id        = rev_old[row * S + j];
+      const IdxT* nw = join_new.data() + row * 2 * S;
+      if (std::find(nw, nw + n_new[row], id) != nw + n_new[row]) { continue; }
+      append(join_old.data() + row * 2 * S, n_old[row], id);
+    }
+  }
+}
+
+}  // namespace detail
+
+/**
+ * @brief Build an all-neighbors knn graph of a dataset distributed across the ranks of the
+ * communicator of `res`; collective.
+ *
+ * Every rank passes its own shard of the dataset; the shards are numbered in the order of the
+ * ranks, so that the global id of a row is its position in the concatenation of the shards.
+ *
+ * 1. Every rank builds the knn graph of its shard with the single-GPU `nn_descent::build`.
+ * 2. The lists of `intermediate_graph_degree` neighbors keep the closest half of these local
+ *    neighbors (flagged old, as they were already joined), and are completed with random rows of
+ *    the other shards (flagged new), so that the joins of the next step cross the partitions.
+ * 3. The NN-descent iterations then run on the distributed lists: every rank samples the new and
+ *    old neighbors of its rows, exchanges the reverse edges with the owning ranks, and evaluates
+ *    the pairs of its join lists on the rows fetched from their owners; the updates are sent to
+ *    the ranks owning the two ends of every pair. The iterations stop after `max_iterations`, or
+ *    when the number of updates over all the ranks falls below
+ *    `termination_threshold * n_rows * intermediate_graph_degree`.
+ *
+ * The distances are the exact squared L2 distances of the dataset type.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors::experimental;
+ *   // `res` has an initialized communicator, and every rank passes its [n_local, D] shard
+ *   nn_descent::index_params index_params;
+ *   auto index = nn_descent::build_distributed(res, index_params, shard);
+ *   // index.graph() is the [n_local, graph_degree] graph of the local rows, with global ids
+ * @endcode
+ *
+ * @tparam T data-type of the input dataset: float, half, int8_t or uint8_t
+ * @tparam IdxT data-type for the output index (holding the global ids of all the shards)
+ *
+ * @param[in] res the raft resources, with an initialized communicator
+ * @param[in] params an instance of nn_descent::index_params that are parameters to run the
+ *   nn-descent algorithm (`target_recall` only applies to the local builds)
+ * @param[in] dataset the local shard of the dataset [n_local_rows, dim] in device memory
+ *
+ * @return the index of the local rows, with the global ids of their neighbors
+ */
+template <typename T, typename IdxT = uint32_t>
+auto build_distributed(raft::resources const& res,
+                       index_params const& params,
+                       raft::device_matrix_view<const T, int64_t, row_major> dataset)
+  -> index<IdxT>
+{
+  const auto& comms = resource::get_comms(res);
+  auto stream       = resource::get_cuda_stream(res);
+  int rank          = comms.get_rank();
+  int size          = comms.get_size();
+  size_t n_local    = dataset.extent(0);
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "nn_descent::build_distributed(%zu, %u)", n_local, uint32_t(dataset.extent(1)));
+  if (size == 1) { return build<T, IdxT>(res, params, dataset); }
+
+  detail::shard_layout<IdxT> shards{std::vector<size_t>(size + 1, 0), rank};
+  auto shard_sizes = raft::neighbors::detail::exchange_counts(
+    comms, std::vector<size_t>(size, n_local), stream);
+  std::inclusive_scan(shard_sizes.begin(), shard_sizes.end(), shards.offsets.begin() + 1);
+  size_t n_total = shards.n_total();
+  RAFT_EXPECTS(n_total < size_t(std::numeric_limits<IdxT>::max()),
+               "The total dataset size should fit the index type");
+  RAFT_EXPECTS(n_local > 1, "Every rank needs at least two rows of the dataset");
+
+  size_t degree       = std::min<size_t>(params.intermediate_graph_degree, n_total - 1);
+  size_t graph_degree = std::min<size_t>(params.graph_degree, degree);
+  size_t n_remote     = degree / 2;
+
+  // 1. the local graphs (with the global ids of the rows)
+  detail::knn_lists<IdxT> lists(n_local, degree);
+  {
+    auto local_params             = params;
+    local_params.graph_degree     = degree - n_remote;
+    local_params.return_distances = false;
+    auto local                    = build<T, IdxT>(res, local_params, dataset);
+    auto graph                    = local.graph();
+    size_t local_degree           = graph.extent(1);
+
+    // the exact distances of the local edges (evaluated in both directions)
+    detail::join(res,
+                 dataset,
+                 shards,
+                 lists,
+                 local_degree,
+                 false,
+                 [&](size_t row, std::vector<std::pair<IdxT, IdxT>>& pairs) {
+                   IdxT id = IdxT(shards.begin() + row);
+                   for (size_t j = 0; j < local_degree; j++) {
+                     IdxT nbr = graph(row, j);
+                     if (size_t(nbr) < n_local) {
+                       pairs.emplace_back(id, IdxT(nbr + shards.begin()));
+                     }
+                   }
+                 });
+    lists.truncate(degree - n_remote);
+  }
+
+  // 2. the random neighbors of the other shards
+  std::mt19937_64 rng(rank);
+  size_t n_others = n_total - n_local;
+  detail::join(res,
+               dataset,
+               shards,
+               lists,
+               n_remote,
+               true,
+               [&](size_t row, std::vector<std::pair<IdxT, IdxT>>& pairs) {
+                 IdxT id = IdxT(shards.begin() + row);
+                 std::uniform_int_distribution<size_t> dist(0, n_others - 1);
+                 for (size_t j = 0; j < n_remote; j++) {
+                   size_t other = dist(rng);
+                   if (other >= shards.begin()) { other += n_local; }
+                   pairs.emplace_back(id, IdxT(other));
+                 }
+               });
+
+  // 3. the distributed NN-descent iterations
+  constexpr auto kWidth = 2 * detail::kDistributedSamples;  // of the join lists
+  constexpr auto kInv   = detail::knn_lists<IdxT>::kInvalid;
+  std::vector<IdxT> join_new, join_old;
+  for (size_t it = 0; it < params.max_iterations; it++) {
+    raft::resource::check_cancellation(res);
+    detail::sample_join_lists(res, shards, lists, rng, join_new, join_old);
+    auto n_updates = detail::join(
+      res,
+      dataset,
+      shards,
+      lists,
+      kWidth * (kWidth - 1) / 2 + kWidth * kWidth,
+      true,
+      [&](size_t row, std::vector<std::pair<IdxT, IdxT>>& pairs) {
+        const IdxT* nw = join_new.data() + row * kWidth;
+        const IdxT* od = join_old.data() + row * kWidth;
+        for (size_t i = 0; i < kWidth && nw[i] != kInv; i++) {
+          for (size_t j = i + 1; j < kWidth && nw[j] != kInv; j++) {
+            pairs.emplace_back(nw[i], nw[j]);
+          }
+          for (size_t j = 0; j < kWidth && od[j] != kInv; j++) {
+            if (od[j] != nw[i]) { pairs.emplace_back(nw[i], od[j]); }
+          }
+        }
+      });
+    n_updates = detail::allreduce_sum(res, n_updates);
+    RAFT_LOG_DEBUG("# distributed NN-descent iteration: %lu / %lu, updates: %lu",
+                   it + 1,
+                   params.max_iterations,
+                   n_updates);
+    if (n_updates < params.termination_threshold * n_total * degree) { break; }
+  }
+
+  index<IdxT> idx{res, int64_t(n_local), int64_t(graph_degree), params.return_distances};
+  auto distances = idx.distances();
+  for (size_t i = 0; i < n_local; i++) {
+    for (size_t j = 0; j < graph_degree; j++) {
+      idx.graph()(i, j) = lists.ids[i * degree + j];
+      if (distances.has_value()) { (*distances)(i, j) = lists.dists[i * degree + j]; }
+    }
+  }
+  return idx;
+}
+
+/** @} */
+
+}  // namespace raft::neighbors::experimental::nn_descent
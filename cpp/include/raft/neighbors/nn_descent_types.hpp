@@ -25,6 +25,8 @@
 #include <raft/core/resources.hpp>
 #include <raft/distance/distance_types.hpp>
 
+#include <optional>
+
 namespace raft::neighbors::experimental::nn_descent {
 /**
  * @ingroup nn-descent
@@ -44,6 +46,10 @@ namespace raft::neighbors::experimental::nn_descent {
  * `max_iterations`: The number of iterations that nn-descent will refine
  * the graph for. More iterations produce a better quality graph at cost of performance
  * `termination_threshold`: The delta at which nn-descent will terminate its iterations
+ * `target_recall`: If positive, nn-descent also terminates as soon as the recall of the graph,
+ * estimated against the exact neighbors of `recall_sample_size` rows of the dataset, reaches this
+ * value (the exact neighbors of the sample are computed once, before the iterations)
+ * `return_distances`: Whether the index keeps the (squared L2) distances of the graph edges
  *
  */
 struct index_params : ann::index_params {
@@ -51,6 +57,9 @@ struct index_params : ann::index_params {
   size_t intermediate_graph_degree = 128;     // Degree of input graph for pruning.
   size_t max_iterations            = 20;      // Number of nn-descent iterations.
   float termination_threshold      = 0.0001;  // Termination threshold of nn-descent.
+  float target_recall              = 0;       // Estimated recall to stop at (0: disabled).
+  size_t recall_sample_size        = 1000;    // Number of rows to estimate the recall on.
+  bool return_distances            = false;   // Keep the distances of the graph edges.
 };
 
 /**
@@ -79,14 +88,19 @@ struct index : ann::index {
    * @param res raft::resources is an object mangaging resources
    * @param n_rows number of rows in knn-graph
    * @param n_cols number of cols in knn-graph
+   * @param return_distances whether to allocate (and fill at build) the distances of the edges
    */
-  index(raft::resources const& res, int64_t n_rows, int64_t n_cols)
+  index(raft::resources const& res, int64_t n_rows, int64_t n_cols, bool return_distances = false)
     : ann::index(),
       res_{res},
       metric_{raft::distance::DistanceType::L2Expanded},
       graph_{raft::make_host_matrix<IdxT, int64_t, row_major>(n_rows, n_cols)},
       graph_view_{graph_.view()}
   {
+    if (return_distances) {
+      distances_      = raft::make_host_matrix<float, int64_t, row_major>(n_rows, n_cols);
+      distances_view_ = distances_->view();
+    }
   }
 
   /**
@@ -98,14 +112,19 @@ struct index : ann::index {
    *
    * @param res raft::resources is an object mangaging resources
    * @param graph_view raft::host_matrix_view<IdxT, int64_t, raft::row_major> for storing knn-graph
+   * @param distances_view optional raft::host_matrix_view<float, int64_t, raft::row_major> of the
+   *                       same shape for storing the distances of the edges
    */
   index(raft::resources const& res,
-        raft::host_matrix_view<IdxT, int64_t, raft::row_major> graph_view)
+        raft::host_matrix_view<IdxT, int64_t, raft::row_major> graph_view,
+        std::optional<raft::host_matrix_view<float, int64_t, row_major>> distances_view =
+          std::nullopt)
     : ann::index(),
       res_{res},
       metric_{raft::distance::DistanceType::L2Expanded},
       graph_{raft::make_host_matrix<IdxT, int64_t, row_major>(0, 0)},
-      graph_view_{graph_view}
+      graph_view_{graph_view},
+      distances_view_{distances_view}
   {
   }
 
@@ -133,6 +152,16 @@ struct index : ann::index {
     return graph_view_;
   }
 
+  /**
+   * The squared L2 distances of the edges of graph() [size, graph-degree], sorted by row; only
+   * available if the index was built with `return_distances`.
+   */
+  [[nodiscard]] inline auto distances() noexcept
+    -> std::optional<host_matrix_view<float, int64_t, row_major>>
+  {
+    return distances_view_;
+  }
+
   // Don't allow copying the index for performance reasons (try avoiding copying data)
   index(const index&)                    = delete;
   index(index&&)                         = default;
@@ -146,6 +175,8 @@ struct index : ann::index {
   raft::host_matrix<IdxT, int64_t, row_major> graph_;  // graph to return for non-int IdxT
   raft::host_matrix_view<IdxT, int64_t, row_major>
     graph_view_;  // view of graph for user provided matrix
+  std::optional<raft::host_matrix<float, int64_t, row_major>> distances_;
+  std::optional<raft::host_matrix_view<float, int64_t, row_major>> distances_view_;
 };
 
 /** @} */
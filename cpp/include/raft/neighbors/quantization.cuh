@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/mdspan.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/neighbors/detail/quantization.cuh>
+#include <raft/neighbors/quantization_types.hpp>
+
+namespace raft::neighbors::quantization {
+
+/**
+ * @addtogroup scalar_quantization
+ * @{
+ */
+
+/**
+ * @brief Train a scalar quantizer on (a sample of) the rows of a dataset.
+ *
+ * The ranges are the central quantiles of the values of every dimension (or of the whole dataset
+ * when `params::per_dimension` is false) among at most `params::max_train_rows` sampled rows.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   using namespace raft::neighbors;
+ *   quantization::params params;
+ *   params.per_dimension = false;
+ *   // the dataset may reside in host or device memory
+ *   auto quantizer = quantization::train<int8_t>(handle, params, dataset);
+ *   auto codes = raft::make_device_matrix<int8_t, int64_t>(handle, n_rows, dim);
+ *   quantization::transform(handle, quantizer, dataset, codes.view());
+ *   // a single range preserves the order of the L2 distances: the codes can be indexed as is
+ *   auto index =
+ *     cagra::build(handle, cagra::index_params{}, raft::make_const_mdspan(codes.view()));
+ * @endcode
+ *
+ * @tparam QuantT the type of the codes (int8_t, uint8_t or half)
+ * @tparam T the data type of the dataset
+ * @tparam IdxT the type of the row indices
+ * @tparam Accessor the accessor of the dataset (host or device)
+ *
+ * @param[in] res raft resources
+ * @param[in] train_params the parameters of the training
+ * @param[in] dataset the dataset [n_rows, dim] (host or device)
+ * @return the trained quantizer
+ */
+template <typename QuantT, typename T, typename IdxT, typename Accessor>
+auto train(raft::resources const& res,
+           const params& train_params,
+           raft::mdspan<const T, raft::matrix_extent<IdxT>, raft::row_major, Accessor> dataset)
+  -> scalar_quantizer<QuantT>
+{
+  return detail::train<QuantT>(res, train_params, dataset);
+}
+
+/**
+ * @brief Encode the rows of a dataset by a scalar quantizer.
+ *
+ * The values outside the ranges of the quantizer are clamped. The rows of a dataset not
+ * accessible from the device are copied by batches, which are prefetched in a stream of the pool
+ * of the resources if it has one.
+ *
+ * @tparam QuantT the type of the codes (int8_t, uint8_t or half)
+ * @tparam T the data type of the dataset
+ * @tparam IdxT the type of the row indices
+ * @tparam Accessor the accessor of the dataset (host or device)
+ *
+ * @param[in] res raft resources
+ * @param[in] quantizer a trained quantizer
+ * @param[in] dataset the rows to encode [n_rows, dim] (host or device)
+ * @param[out] out the codes of the rows [n_rows, dim]
+ */
+template <typename QuantT, typename T, typename IdxT, typename Accessor>
+void transform(raft::resources const& res,
+               const scalar_quantizer<QuantT>& quantizer,
+               raft::mdspan<const T, raft::matrix_extent<IdxT>, raft::row_major, Accessor> dataset,
+               raft::device_matrix_view<QuantT, IdxT, raft::row_major> out)
+{
+  detail::transform(res, quantizer, dataset, out);
+}
+
+/**
+ * @brief Decode the codes of a scalar quantizer.
+ *
+ * The kernels working on the codes directly decode them in registers by
+ * `scalar_quantizer::view()` instead.
+ *
+ * @tparam QuantT the type of the codes (int8_t, uint8_t or half)
+ * @tparam T the data type of the decoded rows
+ * @tparam IdxT the type of the row indices
+ *
+ * @param[in] res raft resources
+ * @param[in] quantizer the quantizer of the codes
+ * @param[in] codes the codes [n_rows, dim]
+ * @param[out] out the decoded rows [n_rows, dim]
+ */
+template <typename QuantT, typename T, typename IdxT>
+void inverse_transform(raft::resources const& res,
+                       const scalar_quantizer<QuantT>& quantizer,
+                       raft::device_matrix_view<const QuantT, IdxT, raft::row_major> codes,
+                       raft::device_matrix_view<T, IdxT, raft::row_major> out)
+{
+  detail::inverse_transform(res, quantizer, codes, out);
+}
+
+/** @} */  // end group scalar_quantization
+
+}  // namespace raft::neighbors::quantization
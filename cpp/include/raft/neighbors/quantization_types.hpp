@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/detail/macros.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resources.hpp>
+
+#include <cuda_fp16.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+namespace raft::neighbors::quantization {
+
+/**
+ * @defgroup scalar_quantization Scalar quantization of the datasets
+ * @{
+ */
+
+/** @brief The parameters of the training of a scalar quantizer. */
+struct params {
+  /**
+   * Whether every dimension has its own range of values; otherwise the whole dataset shares one
+   * range, which preserves the order of the L2 distances (up to the rounding of the codes).
+   */
+  bool per_dimension = true;
+  /**
+   * The fraction of the training values inside the range, the range cutting the two tails
+   * equally. The values outside the range are clamped by the encoding: 1 uses the minimum and
+   * the maximum; e.g. 0.99 ignores the outliers of the 0.5% tails.
+   */
+  double quantile = 0.99;
+  /** The maximum number of rows sampled to train the quantizer (all the rows of a smaller set). */
+  int64_t max_train_rows = 100000;
+  /** The seed of the sampling of the training rows. */
+  uint64_t seed = 0;
+};
+
+/**
+ * @brief The coefficients of a scalar quantizer, which device code can encode and decode with in
+ * registers.
+ *
+ * The coefficients of the range of dimension j are `coefficients[2 * r]` and
+ * `coefficients[2 * r + 1]`, where r = j with the per-dimension ranges and r = 0 otherwise:
+ *
+ *   - integer codes: the offset and the scale of the decoding, x ~ offset + scale * q;
+ *   - half codes: the minimum and the maximum of the range, the codes are the clamped values.
+ *
+ * @tparam QuantT the type of the codes (int8_t, uint8_t or half)
+ */
+template <typename QuantT>
+struct scalar_quantizer_view {
+  static_assert(std::is_same_v<QuantT, int8_t> || std::is_same_v<QuantT, uint8_t> ||
+                  std::is_same_v<QuantT, half>,
+                "The codes of a scalar quantizer are int8_t, uint8_t or half.");
+  static constexpr bool kIntegerCodes = !std::is_same_v<QuantT, half>;
+
+  /** The coefficients [n_ranges, 2] (device memory). */
+  const float* coefficients;
+  /** Whether every dimension has its own range. */
+  bool per_dimension;
+
+  /** The decoded value of the code q of dimension j. */
+  _RAFT_HOST_DEVICE _RAFT_FORCEINLINE auto decode(QuantT q, uint32_t j) const -> float
+  {
+    if constexpr (kIntegerCodes) {
+      const float* c = coefficients + (per_dimension ? 2 * j : 0);
+      return c[0] + c[1] * static_cast<float>(q);
+    } else {
+      return static_cast<float>(q);
+    }
+  }
+
+  /** The code of the value x of dimension j. */
+  _RAFT_HOST_DEVICE _RAFT_FORCEINLINE auto encode(float x, uint32_t j) const -> QuantT
+  {
+    const float* c = coefficients + (per_dimension ? 2 * j : 0);
+    if constexpr (kIntegerCodes) {
+      constexpr float kMin = static_cast<float>(std::numeric_limits<QuantT>::lowest());
+      constexpr float kMax = static_cast<float>(std::numeric_limits<QuantT>::max());
+      float q              = roundf((x - c[0]) / c[1]);
+      return static_cast<QuantT>(q < kMin ? kMin : (q > kMax ? kMax : q));
+    } else {
+      return QuantT(x < c[0] ? c[0] : (x > c[1] ? c[1] : x));
+    }
+  }
+};
+
+/**
+ * @brief A scalar quantizer: the encoding of every dimension of the vectors in a range of values
+ * to int8_t, uint8_t or half codes.
+ *
+ * A quantizer with a single (global) range maps all the vectors by the same affine map, so the
+ * codes can be indexed and searched (L2) directly by the int8_t/uint8_t instantiations of IVF-Flat
+ * and CAGRA, the distances being those of the vectors up to the scale. The half codes keep the
+ * values (clamped) and can be searched by the half brute force with any metric.
+ *
+ * @tparam QuantT the type of the codes (int8_t, uint8_t or half)
+ */
+template <typename QuantT>
+struct scalar_quantizer {
+  /** The number of steps between the lowest and the highest integer codes (zero for half). */
+  static constexpr uint32_t kSteps =
+    scalar_quantizer_view<QuantT>::kIntegerCodes
+      ? uint32_t(int32_t(std::numeric_limits<QuantT>::max()) -
+                 int32_t(std::numeric_limits<QuantT>::lowest()))
+      : 0;
+
+  /** An empty quantizer of the vectors of `dim` dimensions, filled by `train`. */
+  scalar_quantizer(raft::resources const& res, uint32_t dim, bool per_dimension)
+    : dim_(dim),
+      per_dimension_(per_dimension),
+      coefficients_(raft::make_device_matrix<float, uint32_t>(res, per_dimension ? dim : 1, 2))
+  {
+  }
+
+  /** The dimensionality of the vectors. */
+  [[nodiscard]] constexpr inline auto dim() const noexcept -> uint32_t { return dim_; }
+  /** Whether every dimension has its own range. */
+  [[nodiscard]] constexpr inline auto per_dimension() const noexcept -> bool
+  {
+    return per_dimension_;
+  }
+  /** The number of ranges: `dim()` per dimension, otherwise one. */
+  [[nodiscard]] inline auto n_ranges() const noexcept -> uint32_t
+  {
+    return coefficients_.extent(0);
+  }
+  /** The coefficients of the ranges [n_ranges, 2] (see `scalar_quantizer_view`). */
+  [[nodiscard]] inline auto coefficients() noexcept
+    -> raft::device_matrix_view<float, uint32_t, raft::row_major>
+  {
+    return coefficients_.view();
+  }
+  [[nodiscard]] inline auto coefficients() const noexcept
+    -> raft::device_matrix_view<const float, uint32_t, raft::row_major>
+  {
+    return coefficients_.view();
+  }
+  /** The view of the quantizer passed by value to the kernels. */
+  [[nodiscard]] inline auto view() const noexcept -> scalar_quantizer_view<QuantT>
+  {
+    return scalar_quantizer_view<QuantT>{coefficients_.data_handle(), per_dimension_};
+  }
+
+ private:
+  uint32_t dim_;
+  bool per_dimension_;
+  raft::device_matrix<float, uint32_t, raft::row_major> coefficients_;
+};
+
+/** @} */  // end group scalar_quantization
+
+}  // namespace raft::neighbors::quantization
@@ -48,6 +48,16 @@ void refine(raft::resources const& handle,
             raft::distance::DistanceType metric = distance::DistanceType::L2Unexpanded)
   RAFT_EXPLICIT;
 
+template <typename idx_t, typename data_t, typename distance_t, typename matrix_idx>
+void refine(raft::resources const& handle,
+            raft::host_matrix_view<const data_t, matrix_idx, row_major> dataset,
+            raft::device_matrix_view<const data_t, matrix_idx, row_major> queries,
+            raft::device_matrix_view<const idx_t, matrix_idx, row_major> neighbor_candidates,
+            raft::device_matrix_view<idx_t, matrix_idx, row_major> indices,
+            raft::device_matrix_view<distance_t, matrix_idx, row_major> distances,
+            raft::distance::DistanceType metric = distance::DistanceType::L2Unexpanded)
+  RAFT_EXPLICIT;
+
 }  // namespace raft::neighbors
 
 #endif  // RAFT_EXPLICIT_INSTANTIATE_ONLY
@@ -69,6 +79,15 @@ void refine(raft::resources const& handle,
     raft::host_matrix_view<const idx_t, matrix_idx, row_major> neighbor_candidates,    \
     raft::host_matrix_view<idx_t, matrix_idx, row_major> indices,                      \
     raft::host_matrix_view<distance_t, matrix_idx, row_major> distances,               \
+    raft::distance::DistanceType metric);                                              \
+                                                                                       \
+  extern template void raft::neighbors::refine<idx_t, data_t, distance_t, matrix_idx>( \
+    raft::resources const& handle,                                                     \
+    raft::host_matrix_view<const data_t, matrix_idx, row_major> dataset,               \
+    raft::device_matrix_view<const data_t, matrix_idx, row_major> queries,             \
+    raft::device_matrix_view<const idx_t, matrix_idx, row_major> neighbor_candidates,  \
+    raft::device_matrix_view<idx_t, matrix_idx, row_major> indices,                    \
+    raft::device_matrix_view<distance_t, matrix_idx, row_major> distances,             \
     raft::distance::DistanceType metric);
 
 instantiate_raft_neighbors_refine(int64_t, float, float, int64_t);
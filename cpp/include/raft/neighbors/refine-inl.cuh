@@ -100,5 +100,35 @@ void refine(raft::resources const& handle,
   detail::refine_host(dataset, queries, neighbor_candidates, indices, distances, metric);
 }
 
+/** Same as above, but the dataset resides in the host memory, while the queries, the candidates
+ * and the outputs reside in the device memory.
+ *
+ * Only the candidate rows (n_queries * n_candidates) are gathered from the host dataset (which can
+ * be pinned, pageable or memory-mapped) by the host threads into pinned staging buffers, copied to
+ * the device and refined there. The queries are processed in batches, so that the gathering of a
+ * batch overlaps the copy and the refinement of the previous one.
+ *
+ * @param[in] handle the raft handle
+ * @param[in] dataset host matrix that stores the dataset [n_rows, dims]
+ * @param[in] queries device matrix of the queries [n_queris, dims]
+ * @param[in] neighbor_candidates device matrix with indices of candidate vectors [n_queries,
+ *   n_candidates], where n_candidates >= k
+ * @param[out] indices device matrix that stores the refined indices [n_queries, k]
+ * @param[out] distances device matrix that stores the refined distances [n_queries, k]
+ * @param[in] metric distance metric to use. Euclidean (L2) is used by default
+ */
+template <typename idx_t, typename data_t, typename distance_t, typename matrix_idx>
+void refine(raft::resources const& handle,
+            raft::host_matrix_view<const data_t, matrix_idx, row_major> dataset,
+            raft::device_matrix_view<const data_t, matrix_idx, row_major> queries,
+            raft::device_matrix_view<const idx_t, matrix_idx, row_major> neighbor_candidates,
+            raft::device_matrix_view<idx_t, matrix_idx, row_major> indices,
+            raft::device_matrix_view<distance_t, matrix_idx, row_major> distances,
+            distance::DistanceType metric = distance::DistanceType::L2Unexpanded)
+{
+  detail::refine_host_dataset(
+    handle, dataset, queries, neighbor_candidates, indices, distances, metric);
+}
+
 /** @} */  // end group ann_refine
 }  // namespace raft::neighbors
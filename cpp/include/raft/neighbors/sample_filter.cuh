@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,8 +18,19 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <vector>
 
 #include <raft/core/bitset.cuh>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/neighbors/sample_filter_types.hpp>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/warp_primitives.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cub/block/block_reduce.cuh>
 
 namespace raft::neighbors::filtering {
 /**
@@ -46,4 +57,234 @@ struct bitset_filter {
   }
 };
 
+namespace detail {
+
+/** The bits of one list per block: bit `s` of the list is the filter bit of its sample `s`. */
+template <typename bitset_t, typename index_t, typename IdxT>
+RAFT_KERNEL build_ivf_list_bitset_kernel(raft::core::bitset_view<bitset_t, index_t> filter,
+                                         const IdxT* const* inds_ptrs,
+                                         const uint32_t* list_sizes,
+                                         const int64_t* list_offsets,
+                                         uint32_t* bits,
+                                         uint32_t* list_n_passing)
+{
+  const uint32_t list_ix = blockIdx.x;
+  const uint32_t size    = list_sizes[list_ix];
+  const IdxT* ids        = inds_ptrs[list_ix];
+  uint32_t* list_bits    = bits + list_offsets[list_ix];
+  const uint32_t lane    = threadIdx.x % raft::WarpSize;
+  uint32_t n_passing     = 0;
+  // the bound of the loop is uniform over the warp, for the ballots
+  for (uint32_t base = threadIdx.x - lane; base < size; base += blockDim.x) {
+    uint32_t s  = base + lane;
+    bool passes = s < size && filter.test(index_t(ids[s]));
+    uint32_t w  = __ballot_sync(0xffffffff, passes);
+    if (lane == 0) {
+      list_bits[base / raft::WarpSize] = w;
+      n_passing += __popc(w);
+    }
+  }
+  if (lane == 0 && n_passing > 0) { atomicAdd(list_n_passing + list_ix, n_passing); }
+}
+
+/** The attributes of one list per block, and their smallest and largest values. */
+template <int BlockSize, typename attr_t, typename IdxT>
+RAFT_KERNEL __launch_bounds__(BlockSize)
+  build_ivf_attribute_range_kernel(const attr_t* attributes,
+                                   const IdxT* const* inds_ptrs,
+                                   const uint32_t* list_sizes,
+                                   const int64_t* list_offsets,
+                                   attr_t* values,
+                                   attr_t* list_min,
+                                   attr_t* list_max)
+{
+  using block_reduce = cub::BlockReduce<attr_t, BlockSize>;
+  __shared__ typename block_reduce::TempStorage min_storage;
+  __shared__ typename block_reduce::TempStorage max_storage;
+  const uint32_t list_ix = blockIdx.x;
+  const uint32_t size    = list_sizes[list_ix];
+  const IdxT* ids        = inds_ptrs[list_ix];
+  attr_t* list_values    = values + list_offsets[list_ix];
+  // an empty list gets an empty range, which no query range meets
+  attr_t lo = std::numeric_limits<attr_t>::max();
+  attr_t hi = std::numeric_limits<attr_t>::lowest();
+  for (uint32_t s = threadIdx.x; s < size; s += BlockSize) {
+    const attr_t v = attributes[ids[s]];
+    list_values[s] = v;
+    lo             = v < lo ? v : lo;
+    hi             = hi < v ? v : hi;
+  }
+  lo = block_reduce(min_storage).Reduce(lo, cub::Min());
+  hi = block_reduce(max_storage).Reduce(hi, cub::Max());
+  if (threadIdx.x == 0) {
+    list_min[list_ix] = lo;
+    list_max[list_ix] = hi;
+  }
+}
+
+}  // namespace detail
+
+/**
+ * @brief A bitset filter reordered to the order of the samples in the lists of an IVF index.
+ *
+ * Built once per filter and index, it turns the random bitset lookup by source id done for every
+ * candidate of an IVF scan (`bitset_filter`) into a contiguous read of the bits of the list being
+ * scanned, and lets the search skip the lists where no sample passes the filter.
+ *
+ * The filter follows the lists at the time it is built: build it again after extending the index.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   raft::neighbors::filtering::ivf_list_bitset list_filter(res, index, removed_bitset.view());
+ *   ivf_flat::search_with_filtering(res, params, index, queries, neighbors, distances,
+ *                                   list_filter.filter());
+ * @endcode
+ */
+class ivf_list_bitset {
+ public:
+  /**
+   * @brief Reorder a bitset over the source ids of an IVF index (ivf_flat or ivf_pq).
+   *
+   * @param res RAFT resources
+   * @param index the IVF index
+   * @param filter the bitset, set for the source ids passing the filter
+   */
+  template <typename IvfIndexT, typename bitset_t, typename index_t>
+  ivf_list_bitset(const raft::resources& res,
+                  const IvfIndexT& index,
+                  raft::core::bitset_view<bitset_t, index_t> filter)
+    : list_offsets_(index.n_lists() + 1, resource::get_cuda_stream(res)),
+      list_n_passing_(index.n_lists(), resource::get_cuda_stream(res)),
+      bits_(0, resource::get_cuda_stream(res))
+  {
+    auto stream  = resource::get_cuda_stream(res);
+    auto n_lists = index.n_lists();
+    std::vector<uint32_t> sizes(n_lists);
+    std::vector<int64_t> offsets(n_lists + 1, 0);
+    raft::update_host(sizes.data(), index.list_sizes().data_handle(), n_lists, stream);
+    resource::sync_stream(res);
+    for (uint32_t l = 0; l < n_lists; l++) {
+      offsets[l + 1] = offsets[l] + raft::ceildiv<int64_t>(sizes[l], raft::WarpSize);
+    }
+    bits_.resize(offsets[n_lists], stream);
+    raft::update_device(list_offsets_.data(), offsets.data(), n_lists + 1, stream);
+    RAFT_CUDA_TRY(cudaMemsetAsync(list_n_passing_.data(), 0, n_lists * sizeof(uint32_t), stream));
+    if (n_lists > 0) {
+      dim3 grid(n_lists);
+      const auto* inds_ptrs  = index.inds_ptrs().data_handle();
+      const auto* list_sizes = index.list_sizes().data_handle();
+      detail::build_ivf_list_bitset_kernel<<<grid, 256, 0, stream>>>(filter,
+                                                                     inds_ptrs,
+                                                                     list_sizes,
+                                                                     list_offsets_.data(),
+                                                                     bits_.data(),
+                                                                     list_n_passing_.data());
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    }
+    // the host offsets must outlive their copy
+    resource::sync_stream(res);
+  }
+
+  /** @brief The sample filter to pass to the IVF search, valid while this object lives. */
+  [[nodiscard]] auto filter() const -> ivf_list_bitset_filter
+  {
+    return ivf_list_bitset_filter{bits_.data(), list_offsets_.data(), list_n_passing_.data()};
+  }
+
+ private:
+  rmm::device_uvector<int64_t> list_offsets_;
+  rmm::device_uvector<uint32_t> list_n_passing_;
+  rmm::device_uvector<uint32_t> bits_;
+};
+
+/**
+ * @brief An attribute of the samples reordered to the order of the samples in the lists of an IVF
+ * index, for the range predicates evaluated inside the IVF scans.
+ *
+ * Every sample has one attribute value (e.g. a category or a timestamp) and every query an
+ * inclusive range of values. Unlike a bitset materialized per predicate, the attributes are
+ * reordered once, and every search passes its own ranges: the scans read the attributes of the
+ * list being scanned contiguously, and a query does not probe the lists where the smallest and the
+ * largest attributes miss its range. The predicates on several attributes combine with
+ * `and_ivf_sample_filter`.
+ *
+ * The attributes follow the lists at the time they are reordered: reorder them again after
+ * extending the index.
+ *
+ * Usage example:
+ * @code{.cpp}
+ *   // the timestamps of the source vectors [n_rows]
+ *   raft::neighbors::filtering::ivf_attribute_range<float> times(res, index, timestamps);
+ *   // the ranges of the queries [n_queries]
+ *   auto filter = times.filter(from.data_handle(), to.data_handle());
+ *   ivf_pq::search_with_filtering(res, params, index, queries, neighbors, distances, filter);
+ * @endcode
+ *
+ * @tparam attr_t the type of the attribute (an arithmetic type)
+ */
+template <typename attr_t>
+class ivf_attribute_range {
+ public:
+  /**
+   * @brief Reorder the attributes of the source ids of an IVF index (ivf_flat or ivf_pq).
+   *
+   * @param res RAFT resources
+   * @param index the IVF index
+   * @param attributes the attributes indexed by the source ids (device memory)
+   */
+  template <typename IvfIndexT>
+  ivf_attribute_range(const raft::resources& res, const IvfIndexT& index, const attr_t* attributes)
+    : list_offsets_(index.n_lists() + 1, resource::get_cuda_stream(res)),
+      list_min_(index.n_lists(), resource::get_cuda_stream(res)),
+      list_max_(index.n_lists(), resource::get_cuda_stream(res)),
+      values_(0, resource::get_cuda_stream(res))
+  {
+    auto stream  = resource::get_cuda_stream(res);
+    auto n_lists = index.n_lists();
+    std::vector<uint32_t> sizes(n_lists);
+    std::vector<int64_t> offsets(n_lists + 1, 0);
+    raft::update_host(sizes.data(), index.list_sizes().data_handle(), n_lists, stream);
+    resource::sync_stream(res);
+    for (uint32_t l = 0; l < n_lists; l++) {
+      offsets[l + 1] = offsets[l] + sizes[l];
+    }
+    values_.resize(offsets[n_lists], stream);
+    raft::update_device(list_offsets_.data(), offsets.data(), n_lists + 1, stream);
+    if (n_lists > 0) {
+      constexpr int kBlockSize = 256;
+      detail::build_ivf_attribute_range_kernel<kBlockSize>
+        <<<n_lists, kBlockSize, 0, stream>>>(attributes,
+                                             index.inds_ptrs().data_handle(),
+                                             index.list_sizes().data_handle(),
+                                             list_offsets_.data(),
+                                             values_.data(),
+                                             list_min_.data(),
+                                             list_max_.data());
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    }
+    // the host offsets must outlive their copy
+    resource::sync_stream(res);
+  }
+
+  /**
+   * @brief The sample filter to pass to the IVF search, valid while this object and the ranges
+   * live.
+   *
+   * @param query_lo the smallest attribute kept for every query [n_queries] (device memory)
+   * @param query_hi the largest attribute kept for every query [n_queries] (device memory)
+   */
+  [[nodiscard]] auto filter(const attr_t* query_lo, const attr_t* query_hi) const
+    -> ivf_attribute_range_filter<attr_t>
+  {
+    return ivf_attribute_range_filter<attr_t>{
+      values_.data(), list_offsets_.data(), list_min_.data(), list_max_.data(), query_lo, query_hi};
+  }
+
+ private:
+  rmm::device_uvector<int64_t> list_offsets_;
+  rmm::device_uvector<attr_t> list_min_;
+  rmm::device_uvector<attr_t> list_max_;
+  rmm::device_uvector<attr_t> values_;
+};
+
 }  // namespace raft::neighbors::filtering
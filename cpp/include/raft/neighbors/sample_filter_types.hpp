@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
 
 #include <raft/core/detail/macros.hpp>
 
@@ -49,6 +51,205 @@ struct none_cagra_sample_filter {
   }
 };
 
+/**
+ * A filter that rejects the nodes removed from a CAGRA index with `cagra::remove`.
+ *
+ * `alive_bits` holds one bit per node in the layout of `raft::core::bitset<uint32_t>`; a set bit
+ * marks a node that has not been removed.
+ */
+struct removed_cagra_sample_filter {
+  const uint32_t* alive_bits;
+
+  inline _RAFT_HOST_DEVICE bool operator()(
+    // query index
+    const uint32_t query_ix,
+    // the index of the current sample
+    const uint32_t sample_ix) const
+  {
+    return (alive_bits[sample_ix / 32] >> (sample_ix % 32)) & 1u;
+  }
+};
+
+/**
+ * A CAGRA sample filter that also rejects the nodes removed from the index.
+ */
+template <typename filter_t>
+struct removed_and_cagra_sample_filter {
+  removed_cagra_sample_filter removed;
+  filter_t filter;
+
+  inline _RAFT_HOST_DEVICE bool operator()(
+    // query index
+    const uint32_t query_ix,
+    // the index of the current sample
+    const uint32_t sample_ix)
+  {
+    return removed(query_ix, sample_ix) && filter(query_ix, sample_ix);
+  }
+};
+
+/**
+ * An IVF sample filter reading a bitset reordered to the order of the samples in the lists (see
+ * `ivf_list_bitset` in sample_filter.cuh): the bits of a list are contiguous, so the threads
+ * scanning a list read them together with the list data instead of a random bit per sample, and
+ * the lists with no sample passing the filter are not probed at all.
+ */
+struct ivf_list_bitset_filter {
+  // the bits of every list, the list `l` starting at the word list_offsets[l]
+  const uint32_t* bits;
+  // [n_lists + 1]
+  const int64_t* list_offsets;
+  // the number of samples passing the filter in every list [n_lists]
+  const uint32_t* list_n_passing;
+
+  inline _RAFT_HOST_DEVICE bool operator()(
+    // query index
+    const uint32_t query_ix,
+    // the current inverted list index
+    const uint32_t cluster_ix,
+    // the index of the current sample inside the current inverted list
+    const uint32_t sample_ix) const
+  {
+    return (bits[list_offsets[cluster_ix] + sample_ix / 32] >> (sample_ix % 32)) & 1u;
+  }
+
+  /** Whether no sample of the list passes the filter, for any query. */
+  inline _RAFT_HOST_DEVICE bool skips_list(const uint32_t cluster_ix) const
+  {
+    return list_n_passing[cluster_ix] == 0;
+  }
+};
+
+/** Whether an IVF sample filter skips whole lists for all queries, by `skips_list(cluster_ix)`. */
+template <typename filter_t, typename = void>
+struct skips_lists_for_all_queries : std::false_type {};
+template <typename filter_t>
+struct skips_lists_for_all_queries<
+  filter_t,
+  std::void_t<decltype(std::declval<const filter_t&>().skips_list(uint32_t{}))>>
+  : std::true_type {};
+
+/** Whether an IVF sample filter skips lists per query, by `skips_list(query_ix, cluster_ix)`. */
+template <typename filter_t, typename = void>
+struct skips_lists_per_query : std::false_type {};
+template <typename filter_t>
+struct skips_lists_per_query<
+  filter_t,
+  std::void_t<decltype(std::declval<const filter_t&>().skips_list(uint32_t{}, uint32_t{}))>>
+  : std::true_type {};
+
+/** Whether an IVF sample filter can skip whole lists (see `skips_probe`). */
+template <typename filter_t>
+struct skips_lists
+  : std::bool_constant<skips_lists_for_all_queries<filter_t>::value ||
+                       skips_lists_per_query<filter_t>::value> {};
+
+/** Whether the IVF sample filter rejects every sample of the list for the query. */
+template <typename filter_t>
+inline _RAFT_HOST_DEVICE bool skips_probe(const filter_t& filter,
+                                          const uint32_t query_ix,
+                                          const uint32_t cluster_ix)
+{
+  if constexpr (skips_lists_per_query<filter_t>::value) {
+    return filter.skips_list(query_ix, cluster_ix);
+  } else if constexpr (skips_lists_for_all_queries<filter_t>::value) {
+    return filter.skips_list(cluster_ix);
+  } else {
+    return false;
+  }
+}
+
+/**
+ * A filter keeping the samples whose attribute is within the range of the query: one value per
+ * sample (e.g. a timestamp, or a category with `lo == hi`) and one inclusive range per query.
+ *
+ * It looks the attribute up by the index of the sample, which suits CAGRA and brute force; the
+ * IVF searches prefer `ivf_attribute_range_filter` (see `ivf_attribute_range` in
+ * sample_filter.cuh).
+ */
+template <typename attr_t>
+struct attribute_range_filter {
+  // the attributes of the samples [n_samples]
+  const attr_t* values;
+  // the inclusive ranges of the queries [n_queries]
+  const attr_t* query_lo;
+  const attr_t* query_hi;
+
+  inline _RAFT_HOST_DEVICE bool operator()(
+    // query index
+    const uint32_t query_ix,
+    // the index of the current sample
+    const uint32_t sample_ix) const
+  {
+    const attr_t v = values[sample_ix];
+    return query_lo[query_ix] <= v && v <= query_hi[query_ix];
+  }
+};
+
+/**
+ * An IVF sample filter keeping the samples whose attribute is within the range of the query, with
+ * the attributes reordered to the order of the samples in the lists: the threads scanning a list
+ * read them together with the list data, and the lists whose range of attributes misses the range
+ * of a query are not probed by that query.
+ */
+template <typename attr_t>
+struct ivf_attribute_range_filter {
+  // the attributes of every list, the list `l` starting at list_offsets[l]
+  const attr_t* values;
+  // [n_lists + 1]
+  const int64_t* list_offsets;
+  // the smallest and the largest attribute of every list [n_lists]
+  const attr_t* list_min;
+  const attr_t* list_max;
+  // the inclusive ranges of the queries [n_queries]
+  const attr_t* query_lo;
+  const attr_t* query_hi;
+
+  inline _RAFT_HOST_DEVICE bool operator()(
+    // query index
+    const uint32_t query_ix,
+    // the current inverted list index
+    const uint32_t cluster_ix,
+    // the index of the current sample inside the current inverted list
+    const uint32_t sample_ix) const
+  {
+    const attr_t v = values[list_offsets[cluster_ix] + sample_ix];
+    return query_lo[query_ix] <= v && v <= query_hi[query_ix];
+  }
+
+  /** Whether no sample of the list is within the range of the query. */
+  inline _RAFT_HOST_DEVICE bool skips_list(const uint32_t query_ix, const uint32_t cluster_ix) const
+  {
+    return list_max[cluster_ix] < query_lo[query_ix] || query_hi[query_ix] < list_min[cluster_ix];
+  }
+};
+
+/**
+ * An IVF sample filter keeping the samples kept by both filters (e.g. a category and a time
+ * range); a list is skipped when either filter skips it.
+ */
+template <typename first_t, typename second_t>
+struct and_ivf_sample_filter {
+  first_t first;
+  second_t second;
+
+  inline _RAFT_HOST_DEVICE bool operator()(
+    // query index
+    const uint32_t query_ix,
+    // the current inverted list index
+    const uint32_t cluster_ix,
+    // the index of the current sample inside the current inverted list
+    const uint32_t sample_ix) const
+  {
+    return first(query_ix, cluster_ix, sample_ix) && second(query_ix, cluster_ix, sample_ix);
+  }
+
+  inline _RAFT_HOST_DEVICE bool skips_list(const uint32_t query_ix, const uint32_t cluster_ix) const
+  {
+    return skips_probe(first, query_ix, cluster_ix) || skips_probe(second, query_ix, cluster_ix);
+  }
+};
+
 template <typename filter_t, typename = void>
 struct takes_three_args : std::false_type {};
 template <typename filter_t>
@@ -69,15 +270,19 @@ template <typename index_t, typename filter_t>
 struct ivf_to_sample_filter {
   const index_t* const* inds_ptrs_;
   const filter_t next_filter_;
+  /** The bitmasks of the removed samples of every list (null for none), or null for no removal. */
+  const uint32_t* const* removed_ptrs_;
 
-  ivf_to_sample_filter(const index_t* const* inds_ptrs, const filter_t next_filter)
-    : inds_ptrs_{inds_ptrs}, next_filter_{next_filter}
+  ivf_to_sample_filter(const index_t* const* inds_ptrs,
+                       const filter_t next_filter,
+                       const uint32_t* const* removed_ptrs = nullptr)
+    : inds_ptrs_{inds_ptrs}, next_filter_{next_filter}, removed_ptrs_{removed_ptrs}
   {
   }
 
   /** If the original filter takes three arguments, then don't modify the arguments.
    * If the original filter takes two arguments, then we are using `inds_ptr_` to obtain the sample
-   * index.
+   * index. The samples removed from the index are rejected first.
    */
   inline _RAFT_HOST_DEVICE bool operator()(
     // query index
@@ -87,6 +292,12 @@ struct ivf_to_sample_filter {
     // the index of the current sample inside the current inverted list
     const uint32_t sample_ix) const
   {
+    if (removed_ptrs_ != nullptr) {
+      const uint32_t* removed = removed_ptrs_[cluster_ix];
+      if (removed != nullptr && ((removed[sample_ix / 32] >> (sample_ix % 32)) & 1u)) {
+        return false;
+      }
+    }
     if constexpr (takes_three_args<filter_t>::value) {
       return next_filter_(query_ix, cluster_ix, sample_ix);
     } else {
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/blobs_generator.cuh"
+#include "detail/make_blobs.cuh"
+#include "rng.cuh"
+#include "rng_state.hpp"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace raft::random {
+
+/**
+ * @defgroup blobs_generator Seekable generator of isotropic Gaussian clusters
+ * @{
+ */
+
+/**
+ * @brief A generator of isotropic Gaussian clusters (as make_blobs) by blocks of rows, for the
+ * datasets larger than the device memory.
+ *
+ * Every row is derived from the seed and its index only (it is the subsequence of the
+ * counter-based generator of this index): a block of rows can be generated from any offset,
+ * in any order and on any device, always with the same values. The centers (drawn uniformly in
+ * the box [center_box_min, center_box_max]) are kept on the device; the label of every row is a
+ * fixed permutation of its index modulo n_clusters, as the shuffled labels of make_blobs.
+ *
+ * @code{.cpp}
+ *   raft::random::blobs_generator<float, int64_t> gen(handle, 96, 1000);
+ *   auto block = raft::make_device_matrix<float, int64_t>(handle, 1 << 20, 96);
+ *   // the rows [5 << 20, 6 << 20) of the dataset
+ *   gen.generate(handle, 5 << 20, block.view());
+ * @endcode
+ *
+ * @tparam DataT the data type (float or double)
+ * @tparam IdxT the type of the extents of the blocks and of the labels
+ */
+template <typename DataT, typename IdxT = int64_t>
+class blobs_generator {
+ public:
+  /**
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[in] n_cols the number of columns of the dataset
+   * @param[in] n_clusters the number of clusters
+   * @param[in] cluster_std the standard deviation of the clusters
+   * @param[in] center_box_min the lower bound of the box of the centers
+   * @param[in] center_box_max the upper bound of the box of the centers
+   * @param[in] seed the seed of the generator
+   * @param[in] type the type of the generator
+   */
+  blobs_generator(raft::resources const& handle,
+                  IdxT n_cols,
+                  IdxT n_clusters,
+                  DataT cluster_std    = DataT(1.0),
+                  DataT center_box_min = DataT(-10.0),
+                  DataT center_box_max = DataT(10.0),
+                  uint64_t seed        = 0ULL,
+                  GeneratorType type   = GenPC)
+    : centers_(raft::make_device_matrix<DataT, IdxT>(handle, n_clusters, n_cols)),
+      cluster_std_(cluster_std),
+      rng_(seed, type)
+  {
+    RAFT_EXPECTS(n_clusters > 0, "n_clusters must be positive");
+    // the rows use the subsequences following the ones of the centers
+    uniform(handle, rng_, centers_.data_handle(), centers_.size(), center_box_min, center_box_max);
+    detail::affine_transform_params(rng_, n_clusters, label_a_, label_b_);
+  }
+
+  /**
+   * @brief Generate the rows [row_offset, row_offset + out.extent(0)) of the dataset.
+   *
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[in] row_offset the index of the first row of the block
+   * @param[out] out the rows [n_rows, n_cols]
+   * @param[out] labels optional, the labels of the rows [n_rows]
+   */
+  void generate(raft::resources const& handle,
+                uint64_t row_offset,
+                raft::device_matrix_view<DataT, IdxT, raft::row_major> out,
+                std::optional<raft::device_vector_view<IdxT, IdxT>> labels = std::nullopt) const
+  {
+    RAFT_EXPECTS(out.extent(1) == n_cols(), "The block must have n_cols columns");
+    if (labels) {
+      RAFT_EXPECTS(labels->extent(0) == out.extent(0), "There must be one label per row");
+    }
+    detail::generate_blobs_rows(out.data_handle(),
+                                labels ? labels->data_handle() : nullptr,
+                                row_offset,
+                                out.extent(0),
+                                n_cols(),
+                                n_clusters(),
+                                label_a_,
+                                label_b_,
+                                centers_.data_handle(),
+                                cluster_std_,
+                                rng_,
+                                resource::get_cuda_stream(handle));
+  }
+
+  /** The centers of the clusters [n_clusters, n_cols]. */
+  [[nodiscard]] auto centers() const -> raft::device_matrix_view<const DataT, IdxT>
+  {
+    return centers_.view();
+  }
+  [[nodiscard]] auto n_cols() const -> IdxT { return centers_.extent(1); }
+  [[nodiscard]] auto n_clusters() const -> IdxT { return centers_.extent(0); }
+
+ private:
+  raft::device_matrix<DataT, IdxT> centers_;
+  DataT cluster_std_;
+  RngState rng_;
+  IdxT label_a_;
+  IdxT label_b_;
+};
+
+/**
+ * @brief Write n_rows rows of a blobs_generator to a binary file, in the format of the ANN
+ * benchmarks (`.fbin` for float): the number of rows and the number of columns as two uint32_t,
+ * then the row-major data.
+ *
+ * The rows are generated by blocks of `batch_rows` rows, copied to a pinned double buffer and
+ * written by the host while the device generates the next block: only one block lives in the
+ * device memory, and the result does not depend on `batch_rows`.
+ *
+ * @param[in] handle raft handle for managing expensive resources
+ * @param[in] gen the generator
+ * @param[in] path the file to (over)write
+ * @param[in] n_rows the number of rows, at most 2^32 - 1
+ * @param[in] batch_rows the number of rows of the blocks
+ */
+template <typename DataT, typename IdxT>
+void make_blobs_file(raft::resources const& handle,
+                     const blobs_generator<DataT, IdxT>& gen,
+                     const std::string& path,
+                     int64_t n_rows,
+                     int64_t batch_rows = int64_t(1) << 20)
+{
+  detail::write_rows_to_file<DataT>(handle, gen, path, n_rows, gen.n_cols(), batch_rows);
+}
+
+/** @} */  // end group blobs_generator
+
+}  // namespace raft::random
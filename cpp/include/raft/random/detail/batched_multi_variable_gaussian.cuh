@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/math.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/detail/batched.cuh>
+#include <raft/linalg/map.cuh>
+#include <raft/random/detail/rng_impl.cuh>
+#include <raft/random/random_types.hpp>
+#include <raft/random/rng_state.hpp>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <vector>
+
+namespace raft::random::detail {
+
+/** The standard normals generated at once by a block, for a tile of points of one problem. */
+constexpr int kMvgTileNormals   = 1024;
+constexpr int kMvgTilesPerBlock = 16;
+constexpr int kMvgTpb           = 256;
+
+/**
+ * X[b] [n_points, dim] = Z F[b]^T + mu[b] (row-major), Z standard normal and F[b] [dim, dim] the
+ * row-major factor of the covariance F[b] F[b]^T (lower triangular, the upper triangle ignored,
+ * for `lower`). Every block samples up to kMvgTilesPerBlock tiles of points of one problem: the
+ * normals of a tile are generated in the shared memory, next to the transposed factor (when it
+ * fits), and every thread computes outputs of consecutive coordinates, so that neither the
+ * normals nor the factor go through the global memory more than once.
+ */
+template <typename GenType, typename T>
+RAFT_KERNEL batched_mvg_kernel(DeviceState<GenType> rng_state,
+                               const T* F,
+                               const T* mu,
+                               T* X,
+                               int n_points,
+                               int dim,
+                               int tile_points,
+                               int n_chunks,
+                               bool lower,
+                               bool stage_factor)
+{
+  extern __shared__ char smem_buf[];
+  T* z     = reinterpret_cast<T*>(smem_buf);
+  T* f_t   = z + tile_points * dim;
+  size_t p = blockIdx.x / n_chunks;
+  F += p * dim * dim;
+  X += p * n_points * dim;
+  if (mu != nullptr) { mu += p * dim; }
+  if (stage_factor) {
+    for (int e = threadIdx.x; e < dim * dim; e += blockDim.x) {
+      int i            = e / dim;
+      int j            = e % dim;
+      f_t[j * dim + i] = lower && j > i ? T(0) : F[e];
+    }
+  }
+  GenType gen(rng_state, uint64_t(blockIdx.x) * blockDim.x + threadIdx.x);
+  int first = (blockIdx.x % n_chunks) * tile_points * kMvgTilesPerBlock;
+  int last  = raft::min(n_points, first + tile_points * kMvgTilesPerBlock);
+  for (int t0 = first; t0 < last; t0 += tile_points) {
+    int size = raft::min(tile_points, last - t0) * dim;
+    __syncthreads();
+    for (int e = 2 * threadIdx.x; e < size; e += 2 * blockDim.x) {
+      T u1, u2;
+      do {
+        gen.next(u1);
+      } while (u1 == T(0));
+      gen.next(u2);
+      box_muller_transform<T>(u1, u2, T(1), T(0));
+      z[e] = u1;
+      if (e + 1 < size) { z[e + 1] = u2; }
+    }
+    __syncthreads();
+    for (int e = threadIdx.x; e < size; e += blockDim.x) {
+      int i       = e % dim;
+      const T* zq = z + (e - i);
+      int j_end   = lower ? i + 1 : dim;
+      T acc       = mu != nullptr ? mu[i] : T(0);
+      if (stage_factor) {
+        for (int j = 0; j < j_end; j++) {
+          acc += f_t[j * dim + i] * zq[j];
+        }
+      } else {
+        for (int j = 0; j < j_end; j++) {
+          acc += F[size_t(i) * dim + j] * zq[j];
+        }
+      }
+      X[size_t(t0) * dim + e] = acc;
+    }
+  }
+}
+
+template <typename GenType, typename T>
+void call_batched_mvg_kernel(DeviceState<GenType> const& dev_state,
+                             RngState& rng_state,
+                             cudaStream_t stream,
+                             const T* F,
+                             const T* mu,
+                             T* X,
+                             int batch_size,
+                             int n_points,
+                             int dim,
+                             bool lower)
+{
+  int tile_points    = std::max(1, std::min(n_points, kMvgTileNormals / dim));
+  int n_chunks       = raft::ceildiv(n_points, tile_points * kMvgTilesPerBlock);
+  size_t tile_size   = size_t(tile_points) * dim;
+  size_t factor_size = size_t(dim) * dim;
+  RAFT_EXPECTS(tile_size * sizeof(T) <= raft::linalg::detail::kBatchedSmallSmem,
+               "batched_multi_variable_gaussian: dim = %d is too large for the batched sampling; "
+               "use multi_variable_gaussian",
+               dim);
+  bool stage_factor =
+    (tile_size + factor_size) * sizeof(T) <= raft::linalg::detail::kBatchedSmallSmem;
+
+  size_t smem   = (tile_size + (stage_factor ? factor_size : 0)) * sizeof(T);
+  auto n_blocks = uint64_t(batch_size) * n_chunks;
+  batched_mvg_kernel<<<n_blocks, kMvgTpb, smem, stream>>>(
+    dev_state, F, mu, X, n_points, dim, tile_points, n_chunks, lower, stage_factor);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  rng_state.advance(n_blocks * kMvgTpb);
+}
+
+/**
+ * X[b] [n_points, dim] ~ N(mu[b], P[b]) for the batch_size covariances P[b] [dim, dim] (all
+ * row-major), P[b] replaced by its factor: the lower Cholesky factor (CHOLESKY), or
+ * V diag(sqrt(max(w, 0))) from its eigendecomposition (JACOBI, QR), which allows singular
+ * covariances.
+ */
+template <typename T>
+void batched_multi_variable_gaussian(raft::resources const& handle,
+                                     RngState& rng,
+                                     const T* mu,
+                                     T* P,
+                                     T* X,
+                                     int batch_size,
+                                     int n_points,
+                                     int dim,
+                                     multi_variable_gaussian_decomposition_method method,
+                                     int* info)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  auto mr     = resource::get_workspace_resource(handle);
+  if (batch_size == 0 || dim == 0) { return; }
+  size_t nn  = size_t(dim) * dim;
+  bool lower = method == multi_variable_gaussian_decomposition_method::CHOLESKY;
+  if (lower) {
+    rmm::device_uvector<int> info_buf(info == nullptr ? batch_size : 0, stream, mr);
+    int* d_info = info != nullptr ? info : info_buf.data();
+    raft::linalg::detail::batched_cholesky(handle, P, d_info, batch_size, dim);
+    if (info == nullptr) {
+      std::vector<int> h_info(batch_size);
+      raft::update_host(h_info.data(), d_info, batch_size, stream);
+      resource::sync_stream(handle, stream);
+      RAFT_EXPECTS(std::all_of(h_info.begin(), h_info.end(), [](int s) { return s == 0; }),
+                   "batched_multi_variable_gaussian: a covariance matrix is not positive "
+                   "definite; use the JACOBI method for the singular ones");
+    }
+  } else {
+    rmm::device_uvector<T> w(size_t(batch_size) * dim, stream, mr);
+    rmm::device_uvector<T> v(size_t(batch_size) * nn, stream, mr);
+    raft::linalg::detail::batched_eig_jacobi(
+      handle, P, w.data(), v.data(), batch_size, dim, T(1.e-7), 15);
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<T, int64_t>(P, int64_t(batch_size) * nn),
+      [v = v.data(), w = w.data(), dim, nn] __device__(int64_t e) {
+        T w_c = w[(e / nn) * dim + e % dim];
+        return v[e] * (w_c > T(0) ? raft::sqrt(w_c) : T(0));
+      });
+    if (info != nullptr) {
+      RAFT_CUDA_TRY(cudaMemsetAsync(info, 0, sizeof(int) * batch_size, stream));
+    }
+  }
+  if (n_points == 0) { return; }
+  RAFT_CALL_RNG_FUNC(rng,
+                     call_batched_mvg_kernel,
+                     rng,
+                     stream,
+                     P,
+                     mu,
+                     X,
+                     batch_size,
+                     n_points,
+                     dim,
+                     lower);
+}
+
+}  // namespace raft::random::detail
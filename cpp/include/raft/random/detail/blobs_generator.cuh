@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/pinned_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cuda_dev_essentials.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/detail/staging_event.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <string>
+
+namespace raft::random::detail {
+
+/**
+ * Write the rows [0, n_rows) of a seekable generator to a binary file: the number of rows and
+ * the number of columns (two uint32_t), then the row-major data.
+ *
+ * The blocks of rows are generated on the device and copied to one of two pinned buffers, while
+ * the host writes the previous block from the other one.
+ */
+template <typename DataT, typename IdxT, typename GeneratorT>
+void write_rows_to_file(raft::resources const& handle,
+                        const GeneratorT& gen,
+                        const std::string& path,
+                        int64_t n_rows,
+                        IdxT n_cols,
+                        int64_t batch_rows)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "raft::random::write_rows_to_file(%ld, %ld)", n_rows, int64_t(n_cols));
+  RAFT_EXPECTS(batch_rows > 0, "batch_rows must be positive");
+  RAFT_EXPECTS(n_rows >= 0 && uint64_t(n_rows) <= std::numeric_limits<uint32_t>::max() &&
+                 uint64_t(n_cols) <= std::numeric_limits<uint32_t>::max(),
+               "The shape of the dataset must fit in the uint32_t header of the file");
+  auto stream = resource::get_cuda_stream(handle);
+  std::unique_ptr<std::FILE, int (*)(std::FILE*)> fp(std::fopen(path.c_str(), "wb"), &std::fclose);
+  RAFT_EXPECTS(fp != nullptr, "Could not open the file '%s'", path.c_str());
+  uint32_t header[2] = {uint32_t(n_rows), uint32_t(n_cols)};
+  RAFT_EXPECTS(std::fwrite(header, sizeof(uint32_t), 2, fp.get()) == 2,
+               "Could not write to the file '%s'",
+               path.c_str());
+
+  batch_rows = std::max<int64_t>(1, std::min(batch_rows, n_rows));
+  auto block = raft::make_device_matrix<DataT, IdxT>(handle, IdxT(batch_rows), n_cols);
+  std::array<decltype(raft::make_pinned_matrix<DataT, IdxT>(handle, 0, 0)), 2> staging{
+    raft::make_pinned_matrix<DataT, IdxT>(handle, IdxT(batch_rows), n_cols),
+    raft::make_pinned_matrix<DataT, IdxT>(handle, IdxT(batch_rows), n_cols)};
+  std::array<raft::detail::staging_event, 2> copied;
+
+  int64_t n_blocks = raft::ceildiv<int64_t>(n_rows, batch_rows);
+  auto write_block = [&](int64_t b) {
+    copied[b % 2].sync();
+    size_t len = size_t(std::min(batch_rows, n_rows - b * batch_rows)) * n_cols;
+    RAFT_EXPECTS(std::fwrite(staging[b % 2].data_handle(), sizeof(DataT), len, fp.get()) == len,
+                 "Could not write to the file '%s'",
+                 path.c_str());
+  };
+  for (int64_t b = 0; b < n_blocks; b++) {
+    int64_t row0 = b * batch_rows;
+    IdxT rows    = IdxT(std::min(batch_rows, n_rows - row0));
+    gen.generate(handle,
+                 uint64_t(row0),
+                 raft::make_device_matrix_view<DataT, IdxT>(block.data_handle(), rows, n_cols));
+    raft::copy(staging[b % 2].data_handle(), block.data_handle(), size_t(rows) * n_cols, stream);
+    copied[b % 2].record(stream);
+    // the host writes the previous block while the device generates this one
+    if (b > 0) { write_block(b - 1); }
+  }
+  if (n_blocks > 0) { write_block(n_blocks - 1); }
+  RAFT_EXPECTS(std::fclose(fp.release()) == 0, "Could not write to the file '%s'", path.c_str());
+}
+
+}  // namespace raft::random::detail
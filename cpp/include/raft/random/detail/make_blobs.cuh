@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -24,6 +24,8 @@
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
 #include <rmm/device_uvector.hpp>
+
+#include <algorithm>
 #include <vector>
 
 namespace raft {
@@ -253,6 +255,85 @@ void make_blobs_caller(DataT* out,
                 r);
 }
 
+/**
+ * Rows [row_offset, row_offset + n_rows) of a dataset of blobs. The columns (2p, 2p + 1) of the
+ * row r only depend on the seed, on r and on p (the subsequence r of the generator, from its
+ * value 2p), so that any block of rows can be generated independently of the others, always
+ * with the same values. The label of the row r is (a r + b) mod n_clusters, a coprime to
+ * n_clusters.
+ */
+template <typename DataT, typename IdxT, typename GenType>
+RAFT_KERNEL generate_blobs_rows_kernel(raft::random::DeviceState<GenType> rng_state,
+                                       DataT* out,
+                                       IdxT* labels,
+                                       uint64_t row_offset,
+                                       IdxT n_rows,
+                                       IdxT n_cols,
+                                       IdxT n_clusters,
+                                       IdxT label_a,
+                                       IdxT label_b,
+                                       const DataT* centers,
+                                       DataT cluster_std)
+{
+  // the number of 32-bit draws per value (the unit of the offsets of the generators)
+  constexpr uint64_t kDrawsPerValue = sizeof(DataT) > sizeof(uint32_t) ? 2 : 1;
+  IdxT n_pairs = ceildiv<IdxT>(n_cols, 2);
+  int64_t len  = int64_t(n_rows) * n_pairs;
+  for (int64_t e = int64_t(blockIdx.x) * blockDim.x + threadIdx.x; e < len;
+       e += int64_t(blockDim.x) * gridDim.x) {
+    IdxT i       = e / n_pairs;
+    IdxT j       = 2 * (e % n_pairs);
+    uint64_t row = row_offset + i;
+    IdxT label   = IdxT((uint64_t(label_a) * (row % n_clusters) + label_b) % n_clusters);
+    GenType gen(rng_state.seed, rng_state.base_subsequence + row, kDrawsPerValue * j);
+    DataT val1, val2;
+    gen.next(val1);
+    gen.next(val2);
+    // (0, 1] for the log of the Box-Muller transform
+    val1            = DataT(1) - val1;
+    const DataT* mu = centers + size_t(label) * n_cols;
+    box_muller_transform<DataT>(
+      val1, val2, cluster_std, mu[j], cluster_std, j + 1 < n_cols ? mu[j + 1] : DataT(0));
+    DataT* out_row = out + size_t(i) * n_cols;
+    out_row[j]     = val1;
+    if (j + 1 < n_cols) { out_row[j + 1] = val2; }
+    if (labels != nullptr && j == 0) { labels[i] = label; }
+  }
+}
+
+template <typename DataT, typename IdxT>
+void generate_blobs_rows(DataT* out,
+                         IdxT* labels,
+                         uint64_t row_offset,
+                         IdxT n_rows,
+                         IdxT n_cols,
+                         IdxT n_clusters,
+                         IdxT label_a,
+                         IdxT label_b,
+                         const DataT* centers,
+                         DataT cluster_std,
+                         const raft::random::RngState& rng_state,
+                         cudaStream_t stream)
+{
+  constexpr int block_size = 256;
+  int64_t items            = int64_t(n_rows) * ceildiv<IdxT>(n_cols, 2);
+  if (items == 0) { return; }
+  int64_t n_blocks = std::min<int64_t>(ceildiv<int64_t>(items, block_size), 65536);
+  RAFT_CALL_RNG_FUNC(rng_state,
+                     (generate_blobs_rows_kernel<<<n_blocks, block_size, 0, stream>>>),
+                     out,
+                     labels,
+                     row_offset,
+                     n_rows,
+                     n_cols,
+                     n_clusters,
+                     label_a,
+                     label_b,
+                     centers,
+                     cluster_std);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
 }  // end namespace detail
 }  // end namespace random
 }  // end namespace raft
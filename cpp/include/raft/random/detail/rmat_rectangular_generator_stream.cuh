@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "rmat_rectangular_generator.cuh"
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/random/random_types.hpp>
+#include <raft/random/rng_state.hpp>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/device_atomics.cuh>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/copy.h>
+#include <thrust/fill.h>
+#include <thrust/functional.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace raft::random::detail {
+
+/** The empty slot of the hash set of the edges (not a key: r_scale + c_scale < 64). */
+constexpr uint64_t kRmatEmptyKey = ~uint64_t(0);
+
+/** The finalizer of MurmurHash3: the keys of the edges of an R-MAT graph share many bits. */
+HDI auto rmat_hash(uint64_t k) -> uint64_t
+{
+  k ^= k >> 33;
+  k *= 0xff51afd7ed558ccdULL;
+  k ^= k >> 33;
+  k *= 0xc4ceb9fe1a85ec53ULL;
+  k ^= k >> 33;
+  return k;
+}
+
+/**
+ * keep[i] = whether the edge i of a chunk is kept: its source is in [row_begin, row_end) and,
+ * with a hash set (open addressing, linear probing, `mask + 1` slots), it was not in the set yet.
+ * A full set raises `overflow` (and drops the edge).
+ */
+template <typename IdxT>
+RAFT_KERNEL rmat_filter_kernel(const IdxT* src,
+                               const IdxT* dst,
+                               IdxT n_edges,
+                               IdxT row_begin,
+                               IdxT row_end,
+                               IdxT c_scale,
+                               uint64_t* set,
+                               uint64_t mask,
+                               uint8_t* keep,
+                               int* overflow)
+{
+  IdxT i = threadIdx.x + IdxT(blockIdx.x) * blockDim.x;
+  if (i >= n_edges) { return; }
+  IdxT s    = src[i];
+  bool kept = s >= row_begin && s < row_end;
+  if (kept && set != nullptr) {
+    uint64_t key  = (uint64_t(s) << c_scale) | uint64_t(dst[i]);
+    uint64_t slot = rmat_hash(key) & mask;
+    for (uint64_t probe = 0;; probe++) {
+      if (probe > mask) {
+        *overflow = 1;
+        kept      = false;
+        break;
+      }
+      auto prev = atomicCAS(reinterpret_cast<unsigned long long*>(set + slot),
+                            static_cast<unsigned long long>(kRmatEmptyKey),
+                            static_cast<unsigned long long>(key));
+      if (prev == kRmatEmptyKey) { break; }
+      if (prev == key) {
+        kept = false;
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+  }
+  keep[i] = kept;
+}
+
+/** counts[src[i] - row_begin] += 1 for the edges i of a chunk. */
+template <typename IdxT>
+RAFT_KERNEL rmat_count_rows_kernel(const IdxT* src, IdxT n_edges, IdxT row_begin, IdxT* counts)
+{
+  IdxT i = threadIdx.x + IdxT(blockIdx.x) * blockDim.x;
+  if (i < n_edges) { atomicAdd(counts + (src[i] - row_begin), IdxT(1)); }
+}
+
+/** The keys (row, column) of the edges of a chunk, appended to their rows. */
+template <typename IdxT>
+RAFT_KERNEL rmat_scatter_keys_kernel(const IdxT* src,
+                                     const IdxT* dst,
+                                     IdxT n_edges,
+                                     IdxT row_begin,
+                                     IdxT c_scale,
+                                     const IdxT* indptr,
+                                     IdxT* fill,
+                                     uint64_t* keys)
+{
+  IdxT i = threadIdx.x + IdxT(blockIdx.x) * blockDim.x;
+  if (i >= n_edges) { return; }
+  IdxT row  = src[i] - row_begin;
+  IdxT pos  = indptr[row] + atomicAdd(fill + row, IdxT(1));
+  keys[pos] = (uint64_t(row) << c_scale) | uint64_t(dst[i]);
+}
+
+/**
+ * Generate the edges [edge_begin, edge_end) of the R-MAT stream of `r` by chunks, and call
+ * `on_chunk(src, dst)` with the device views of the edges kept of every chunk (valid until it
+ * returns; the work on them must be ordered on the stream of the resources).
+ * `generate(src, dst, n, r_chunk)` generates the first n edges of the stream of r_chunk.
+ */
+template <typename IdxT, typename GenerateOp, typename ChunkOp>
+void rmat_rectangular_gen_stream_impl(raft::resources const& handle,
+                                      const raft::random::RngState& r,
+                                      GenerateOp generate,
+                                      IdxT r_scale,
+                                      IdxT c_scale,
+                                      const rmat_stream_params& params,
+                                      ChunkOp on_chunk)
+{
+  static_assert(std::is_integral_v<IdxT>,
+                "rmat_rectangular_gen_stream: "
+                "Template parameter IdxT must be an integral type");
+  RAFT_EXPECTS(r_scale + c_scale < 64,
+               "rmat_rectangular_gen_stream: r_scale + c_scale must be less than 64");
+  RAFT_EXPECTS(params.edge_begin <= params.edge_end,
+               "rmat_rectangular_gen_stream: edge_begin must not exceed edge_end");
+  RAFT_EXPECTS(params.chunk_size > 0, "rmat_rectangular_gen_stream: chunk_size must be positive");
+  auto stream      = resource::get_cuda_stream(handle);
+  auto policy      = resource::get_thrust_policy(handle);
+  uint64_t n_rows  = uint64_t(1) << r_scale;
+  uint64_t row_end = params.row_end > 0 ? std::min(params.row_end, n_rows) : n_rows;
+  RAFT_EXPECTS(params.row_begin <= row_end,
+               "rmat_rectangular_gen_stream: row_begin must not exceed row_end");
+  uint64_t n_edges = params.edge_end - params.edge_begin;
+  if (n_edges == 0) { return; }
+  bool filter = params.deduplicate || params.row_begin > 0 || row_end < n_rows;
+
+  size_t chunk = std::min(params.chunk_size, n_edges);
+  rmm::device_uvector<IdxT> src(chunk, stream);
+  rmm::device_uvector<IdxT> dst(chunk, stream);
+  rmm::device_uvector<IdxT> kept_src(filter ? chunk : 0, stream);
+  rmm::device_uvector<IdxT> kept_dst(filter ? chunk : 0, stream);
+  rmm::device_uvector<uint8_t> keep(filter ? chunk : 0, stream);
+  rmm::device_scalar<int> overflow(0, stream);
+  // the hash set: at least twice as many slots as distinct edges, a power of two
+  uint64_t n_slots = 0;
+  if (params.deduplicate) {
+    uint64_t n_unique = params.max_unique_edges > 0 ? params.max_unique_edges : n_edges;
+    for (n_slots = 1; n_slots < 2 * n_unique; n_slots *= 2) {}
+  }
+  rmm::device_uvector<uint64_t> set(n_slots, stream);
+  if (n_slots > 0) {
+    thrust::fill(policy, set.begin(), set.end(), kRmatEmptyKey);
+  }
+
+  for (uint64_t first = params.edge_begin; first < params.edge_end; first += chunk) {
+    IdxT n = IdxT(std::min<uint64_t>(chunk, params.edge_end - first));
+    // the edge i of the stream is drawn from the subsequence base_subsequence + i
+    raft::random::RngState r_chunk = r;
+    r_chunk.base_subsequence += first;
+    generate(src.data(), dst.data(), n, r_chunk);
+    if (!filter) {
+      on_chunk(raft::make_device_vector_view<const IdxT, IdxT>(src.data(), n),
+               raft::make_device_vector_view<const IdxT, IdxT>(dst.data(), n));
+      continue;
+    }
+    constexpr int kTpb = 256;
+    rmat_filter_kernel<<<raft::ceildiv<IdxT>(n, kTpb), kTpb, 0, stream>>>(
+      src.data(),
+      dst.data(),
+      n,
+      IdxT(params.row_begin),
+      IdxT(row_end),
+      c_scale,
+      n_slots > 0 ? set.data() : nullptr,
+      n_slots - 1,
+      keep.data(),
+      overflow.data());
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    auto in  = thrust::make_zip_iterator(thrust::make_tuple(src.begin(), dst.begin()));
+    auto out = thrust::make_zip_iterator(thrust::make_tuple(kept_src.begin(), kept_dst.begin()));
+
+    IdxT n_kept =
+      thrust::copy_if(policy, in, in + n, keep.begin(), out, thrust::identity<uint8_t>()) - out;
+    RAFT_EXPECTS(overflow.value(stream) == 0,
+                 "rmat_rectangular_gen_stream: more distinct edges than max_unique_edges");
+    on_chunk(raft::make_device_vector_view<const IdxT, IdxT>(kept_src.data(), n_kept),
+             raft::make_device_vector_view<const IdxT, IdxT>(kept_dst.data(), n_kept));
+  }
+}
+
+/**
+ * The CSR structure of the rows [row_begin, row_end) of the edges kept of the stream, with the
+ * sorted columns of every row, in two passes over the stream: the first counts the edges of the
+ * rows, the second writes them (as sorted 64-bit keys, row then column).
+ */
+template <typename IdxT, typename GenerateOp>
+auto rmat_rectangular_gen_csr_impl(raft::resources const& handle,
+                                   const raft::random::RngState& r,
+                                   GenerateOp generate,
+                                   IdxT r_scale,
+                                   IdxT c_scale,
+                                   const rmat_stream_params& params)
+  -> raft::device_compressed_structure<IdxT, IdxT, IdxT>
+{
+  auto stream      = resource::get_cuda_stream(handle);
+  auto policy      = resource::get_thrust_policy(handle);
+  uint64_t n_rows  = uint64_t(1) << r_scale;
+  uint64_t row_end = params.row_end > 0 ? std::min(params.row_end, n_rows) : n_rows;
+  RAFT_EXPECTS(params.row_begin <= row_end,
+               "rmat_rectangular_gen_csr: row_begin must not exceed row_end");
+  IdxT row_begin = IdxT(params.row_begin);
+  IdxT n_local   = IdxT(row_end - params.row_begin);
+
+  constexpr int kTpb = 256;
+  rmm::device_uvector<IdxT> indptr(n_local + 1, stream);
+  thrust::fill(policy, indptr.begin(), indptr.end(), IdxT(0));
+  rmat_rectangular_gen_stream_impl(
+    handle, r, generate, r_scale, c_scale, params, [&](auto src, auto dst) {
+      IdxT n = src.extent(0);
+      if (n == 0) { return; }
+      rmat_count_rows_kernel<<<raft::ceildiv<IdxT>(n, kTpb), kTpb, 0, stream>>>(
+        src.data_handle(), n, row_begin, indptr.data() + 1);
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    });
+  thrust::inclusive_scan(policy, indptr.begin(), indptr.end(), indptr.begin());
+  IdxT nnz = indptr.element(n_local, stream);
+
+  rmm::device_uvector<uint64_t> keys(nnz, stream);
+  rmm::device_uvector<IdxT> fill(n_local, stream);
+  thrust::fill(policy, fill.begin(), fill.end(), IdxT(0));
+  rmat_rectangular_gen_stream_impl(
+    handle, r, generate, r_scale, c_scale, params, [&](auto src, auto dst) {
+      IdxT n = src.extent(0);
+      if (n == 0) { return; }
+      rmat_scatter_keys_kernel<<<raft::ceildiv<IdxT>(n, kTpb), kTpb, 0, stream>>>(
+        src.data_handle(),
+        dst.data_handle(),
+        n,
+        row_begin,
+        c_scale,
+        indptr.data(),
+        fill.data(),
+        keys.data());
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    });
+  // the rows are already grouped: sorting the keys sorts the columns of every row
+  thrust::sort(policy, keys.begin(), keys.end());
+
+  auto csr = raft::make_device_compressed_structure<IdxT, IdxT, IdxT>(
+    handle, n_local, IdxT(1) << c_scale, nnz);
+  auto structure = csr.view();
+  raft::copy(structure.get_indptr().data(), indptr.data(), n_local + 1, stream);
+  uint64_t col_mask = (uint64_t(1) << c_scale) - 1;
+  thrust::transform(policy,
+                    keys.begin(),
+                    keys.end(),
+                    structure.get_indices().data(),
+                    [col_mask] __device__(uint64_t key) { return IdxT(key & col_mask); });
+  return csr;
+}
+
+}  // namespace raft::random::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,12 +19,14 @@
 #include <raft/random/rng_state.hpp>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/integer_utils.hpp>
+#include <raft/util/vectorized.cuh>
 
 #include <curand_kernel.h>
 
 #include <rmm/device_uvector.hpp>
 
 #include <random>
+#include <type_traits>
 
 namespace raft {
 namespace random {
@@ -682,6 +684,65 @@ RAFT_KERNEL rngKernel(DeviceState<GenType> rng_state, OutType* ptr, LenType len,
   return;
 }
 
+/**
+ * The number of outputs of type `OutType` which fill one 128-bit store, when they can be generated
+ * by whole calls of `custom_next` (ITEMS_PER_CALL outputs each); 0 when the type has no vectorized
+ * IO type.
+ */
+template <typename OutType, int ITEMS_PER_CALL, typename = void>
+struct rng_vec_len : std::integral_constant<int, 0> {};
+
+template <typename OutType, int ITEMS_PER_CALL>
+struct rng_vec_len<OutType,
+                   ITEMS_PER_CALL,
+                   std::void_t<typename IOType<OutType, 16 / sizeof(OutType)>::Type>>
+  : std::integral_constant<int,
+                           (16 / sizeof(OutType)) % ITEMS_PER_CALL == 0 ? 16 / sizeof(OutType)
+                                                                        : 0> {};
+
+/**
+ * Same as `rngKernel`, but every thread generates `VecLen` consecutive outputs (with as many
+ * calls of `custom_next`, whose outputs are one element apart) and writes them with a single
+ * 128-bit store. The `head` first elements, before the first 16-byte aligned address, and the
+ * elements after the last whole vector are generated one call per thread.
+ */
+template <int ITEMS_PER_CALL,
+          int VecLen,
+          typename OutType,
+          typename LenType,
+          typename GenType,
+          typename ParamType>
+RAFT_KERNEL rngKernelVec(
+  DeviceState<GenType> rng_state, OutType* ptr, LenType len, LenType head, ParamType params)
+{
+  LenType tid = threadIdx.x + static_cast<LenType>(blockIdx.x) * blockDim.x;
+  GenType gen(rng_state, (uint64_t)tid);
+  const LenType stride = gridDim.x * blockDim.x;
+  const LenType n_vecs = (len - head) / VecLen;
+  for (LenType v = tid; v < n_vecs; v += stride) {
+    LenType idx = head + v * VecLen;
+    TxN_t<OutType, VecLen> out;
+#pragma unroll
+    for (int k = 0; k < VecLen; k += ITEMS_PER_CALL) {
+      custom_next(gen, out.val.data + k, params, idx + k, LenType(1));
+    }
+    out.store(ptr, idx);
+  }
+  // The unaligned ends: fewer than VecLen elements each
+  auto scalar = [&](LenType begin, LenType end) {
+    LenType idx = begin + tid * ITEMS_PER_CALL;
+    if (idx >= end) { return; }
+    OutType val[ITEMS_PER_CALL];
+    custom_next(gen, val, params, idx, LenType(1));
+#pragma unroll
+    for (int i = 0; i < ITEMS_PER_CALL; i++) {
+      if (idx + i < end) ptr[idx + i] = val[i];
+    }
+  };
+  scalar(0, head);
+  scalar(head + n_vecs * VecLen, len);
+}
+
 template <typename GenType, typename OutType, typename WeightType, typename IdxType>
 RAFT_KERNEL sample_with_replacement_kernel(DeviceState<GenType> rng_state,
                                            OutType* out,
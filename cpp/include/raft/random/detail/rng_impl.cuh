@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -23,6 +23,9 @@
 #include <raft/util/detail/cub_wrappers.cuh>
 #include <raft/util/scatter.cuh>
 
+#include <algorithm>
+#include <cstdint>
+
 namespace raft {
 namespace random {
 namespace detail {
@@ -61,15 +64,38 @@ namespace detail {
     default: RAFT_FAIL("Unexpected generator type '%d'", int((rng_state).type));    \
   }
 
-template <int ITEMS_PER_CALL, typename GenType, typename... ArgsT>
+/**
+ * Launch the generation of `len` outputs of a distribution. When the output type allows it, every
+ * thread writes 16 bytes of consecutive outputs at once (`rngKernelVec`), otherwise one output per
+ * store, `stride` elements apart (`rngKernel`).
+ */
+template <int ITEMS_PER_CALL,
+          typename GenType,
+          typename OutType,
+          typename LenType,
+          typename ParamType>
 void call_rng_kernel(DeviceState<GenType> const& dev_state,
                      RngState& rng_state,
                      cudaStream_t stream,
-                     ArgsT... args)
+                     OutType* ptr,
+                     LenType len,
+                     ParamType params)
 {
-  auto n_threads = 256;
-  auto n_blocks  = 4 * getMultiProcessorCount();
-  rngKernel<ITEMS_PER_CALL><<<n_blocks, n_threads, 0, stream>>>(dev_state, args...);
+  auto n_threads        = 256;
+  auto n_blocks         = 4 * getMultiProcessorCount();
+  constexpr int kVecLen = rng_vec_len<OutType, ITEMS_PER_CALL>::value;
+  auto addr             = reinterpret_cast<uintptr_t>(ptr);
+  if constexpr (kVecLen > 1) {
+    if (addr % sizeof(OutType) == 0) {
+      constexpr uintptr_t kVecBytes = kVecLen * sizeof(OutType);
+      auto head = LenType(((kVecBytes - addr % kVecBytes) % kVecBytes) / sizeof(OutType));
+      rngKernelVec<ITEMS_PER_CALL, kVecLen><<<n_blocks, n_threads, 0, stream>>>(
+        dev_state, ptr, len, std::min(head, len), params);
+      rng_state.advance(uint64_t(n_blocks) * n_threads, 16);
+      return;
+    }
+  }
+  rngKernel<ITEMS_PER_CALL><<<n_blocks, n_threads, 0, stream>>>(dev_state, ptr, len, params);
   rng_state.advance(uint64_t(n_blocks) * n_threads, 16);
 }
 
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "rng_impl.cuh"
+
+#include <raft/core/error.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/random/rng_state.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/sequence.h>
+#include <thrust/sort.h>
+#include <thrust/unique.h>
+
+#include <cstdint>
+#include <limits>
+
+namespace raft::random::detail {
+
+/** Above this fraction of the population, shuffling the whole population is not wasteful. */
+constexpr double kDenseSamplingFraction = 0.25;
+
+/**
+ * Sort n_values of `values` in a uniformly random order, by sorting them by random keys.
+ */
+template <typename IdxT>
+void random_order(raft::resources const& res, RngState& rng, IdxT* values, IdxT n_values)
+{
+  auto stream = resource::get_cuda_stream(res);
+  rmm::device_uvector<uint64_t> keys(n_values, stream);
+  uniformInt<uint64_t, IdxT>(
+    rng, keys.data(), n_values, uint64_t(0), std::numeric_limits<uint64_t>::max(), stream);
+  thrust::sort_by_key(
+    resource::get_thrust_policy(res), keys.data(), keys.data() + n_values, values);
+}
+
+/**
+ * k distinct indices drawn uniformly from [0, n), in increasing order.
+ *
+ * When k is a small fraction of n, about 1.5 k indices are drawn with replacement, sorted and
+ * deduplicated (drawing more until at least k are left), and k of the distinct ones are kept at
+ * random: as the distinct indices are a symmetric function of the draws, the result is a uniform
+ * k-subset, in O(k log k) instead of the O(n log n) of shuffling the whole population.
+ */
+template <typename IdxT>
+void sample_indices_without_replacement(
+  raft::resources const& res, RngState& rng, IdxT* out, IdxT k, IdxT n)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "raft::random::sample_indices_without_replacement(%zu, %zu)", size_t(k), size_t(n));
+  RAFT_EXPECTS(k <= n, "The number of samples must not exceed the size of the population");
+  if (k == 0) { return; }
+  auto stream = resource::get_cuda_stream(res);
+  auto policy = resource::get_thrust_policy(res);
+
+  if (double(k) > kDenseSamplingFraction * double(n)) {
+    rmm::device_uvector<IdxT> population(n, stream);
+    thrust::sequence(policy, population.data(), population.data() + n);
+    random_order(res, rng, population.data(), n);
+    raft::copy(out, population.data(), k, stream);
+    thrust::sort(policy, out, out + k);
+    return;
+  }
+
+  IdxT n_draws = k + k / 2 + 32;
+  while (true) {
+    rmm::device_uvector<IdxT> draws(n_draws, stream);
+    uniformInt<IdxT, IdxT>(rng, draws.data(), n_draws, IdxT(0), n, stream);
+    thrust::sort(policy, draws.data(), draws.data() + n_draws);
+    IdxT n_unique = thrust::unique(policy, draws.data(), draws.data() + n_draws) - draws.data();
+    if (n_unique >= k) {
+      if (n_unique > k) { random_order(res, rng, draws.data(), n_unique); }
+      raft::copy(out, draws.data(), k, stream);
+      thrust::sort(policy, out, out + k);
+      return;
+    }
+    n_draws *= 2;
+  }
+}
+
+}  // namespace raft::random::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,9 +19,15 @@
 
 #pragma once
 
+#include "detail/batched_multi_variable_gaussian.cuh"
 #include "detail/multi_variable_gaussian.cuh"
+#include <raft/core/device_mdspan.hpp>
 #include <raft/core/resources.hpp>
+#include <raft/linalg/batched.cuh>
 #include <raft/random/random_types.hpp>
+#include <raft/random/rng_state.hpp>
+
+#include <optional>
 
 namespace raft::random {
 
@@ -56,6 +62,70 @@ void multi_variable_gaussian(raft::resources const& handle,
   detail::compute_multi_variable_gaussian_impl(handle, *mem_resource_ptr, x, P, X, method);
 }
 
+/**
+ * @brief Sample many multi-variable Gaussians with small covariance matrices at once.
+ *
+ * The rows X[b] are n_points samples of the normal distribution of mean x[b] and covariance
+ * P[b]. The covariances are decomposed by batched kernels (one thread block per matrix when it
+ * fits in the shared memory) and every factor is applied to the standard normals in the shared
+ * memory, as they are generated: the normals never go through the global memory. This is much
+ * faster than one `multi_variable_gaussian` call per distribution for dimensions up to a few
+ * tens.
+ *
+ * CHOLESKY factorizes P[b] = L L^T; JACOBI (and QR, which uses the same batched solver) the
+ * eigendecomposition P[b] = V diag(w) V^T, with the factor V diag(sqrt(max(w, 0))), which
+ * allows positive semi-definite covariances.
+ *
+ * @tparam ValueType the data type (float/double)
+ * @param[in] handle raft resources
+ * @param[inout] rng the random state, advanced past the numbers used
+ * @param[in] x optional means [batch_size, dim] (zero by default)
+ * @param[inout] P the covariances [batch_size, dim, dim], overwritten by their factors
+ * @param[out] X the samples [batch_size, n_points, dim]
+ * @param[in] method the decomposition of the covariances
+ * @param[out] info optional status of the factorizations [batch_size] (CHOLESKY: as
+ *   `raft::linalg::batched_cholesky`, the samples of a matrix which is not positive definite are
+ *   undefined; without it, such a matrix is an error)
+ */
+template <typename ValueType>
+void batched_multi_variable_gaussian(
+  raft::resources const& handle,
+  RngState& rng,
+  std::optional<raft::device_matrix_view<const ValueType, int, raft::row_major>> x,
+  raft::linalg::batched_matrix_view<ValueType, int> P,
+  raft::linalg::batched_matrix_view<ValueType, int> X,
+  const multi_variable_gaussian_decomposition_method method,
+  std::optional<raft::device_vector_view<int, int>> info = std::nullopt)
+{
+  int batch_size = P.extent(0);
+  int dim        = P.extent(1);
+  RAFT_EXPECTS(P.extent(2) == dim, "batched_multi_variable_gaussian: P must be square");
+  RAFT_EXPECTS(X.extent(0) == batch_size && X.extent(2) == dim,
+               "batched_multi_variable_gaussian: X must be [batch_size, n_points, dim]");
+  const ValueType* mean = nullptr;
+  if (x.has_value()) {
+    RAFT_EXPECTS(x->extent(0) == batch_size && x->extent(1) == dim,
+                 "batched_multi_variable_gaussian: x must be [batch_size, dim]");
+    mean = x->data_handle();
+  }
+  int* d_info = nullptr;
+  if (info.has_value()) {
+    RAFT_EXPECTS(info->extent(0) == batch_size,
+                 "batched_multi_variable_gaussian: info must have one element per matrix");
+    d_info = info->data_handle();
+  }
+  detail::batched_multi_variable_gaussian(handle,
+                                          rng,
+                                          mean,
+                                          P.data_handle(),
+                                          X.data_handle(),
+                                          batch_size,
+                                          int(X.extent(1)),
+                                          dim,
+                                          method,
+                                          d_info);
+}
+
 /** @} */
 
 };  // end of namespace raft::random
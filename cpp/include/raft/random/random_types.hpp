@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2022, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace raft::random {
 
 /**
@@ -43,4 +45,44 @@ enum class multi_variable_gaussian_decomposition_method { CHOLESKY, JACOBI, QR }
 
 /** @} */
 
+/**
+ * \ingroup rmat
+ * @{
+ */
+
+/**
+ * @brief The parameters of the streaming R-MAT generators `rmat_rectangular_gen_stream` and
+ * `rmat_rectangular_gen_csr`.
+ *
+ * The edge i of the R-MAT stream of a random state is the edge i of `rmat_rectangular_gen` with
+ * that state, whatever the chunks it is generated by, so that a graph larger than the device
+ * memory can be generated in pieces and split across ranks without any communication:
+ *
+ * - by edges: every rank generates its range [edge_begin, edge_end) of the stream, or
+ * - by rows: every rank generates the whole stream and keeps the edges of its block of source
+ *   rows [row_begin, row_end), which gives a row partition of the graph (as expected by the
+ *   distributed sparse products), deduplicated across the ranks when `deduplicate` is set.
+ */
+struct rmat_stream_params {
+  /** The first edge of the stream generated. */
+  uint64_t edge_begin = 0;
+  /** The end of the range of edges generated. */
+  uint64_t edge_end = 0;
+  /** The edges are generated by chunks of at most this many (the device memory is linear in it). */
+  uint64_t chunk_size = uint64_t(1) << 26;
+  /** The first source row kept. */
+  uint64_t row_begin = 0;
+  /** The end of the range of source rows kept; 0 keeps all the rows. */
+  uint64_t row_end = 0;
+  /** Whether to keep a single copy of every edge. */
+  bool deduplicate = false;
+  /**
+   * The largest number of distinct edges kept (deduplicate only), which sizes the hash set of the
+   * edges: 16 to 32 bytes per edge. 0 selects edge_end - edge_begin.
+   */
+  uint64_t max_unique_edges = 0;
+};
+
+/** @} */
+
 };  // end of namespace raft::random
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,7 +17,12 @@
 #pragma once
 
 #include "detail/rmat_rectangular_generator.cuh"
+#include "detail/rmat_rectangular_generator_stream.cuh"
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/core/resources.hpp>
+#include <raft/random/random_types.hpp>
+
+#include <algorithm>
 
 namespace raft::random {
 
@@ -288,6 +293,144 @@ void rmat_rectangular_gen(IdxT* out,
     out, out_src, out_dst, a, b, c, r_scale, c_scale, n_edges, stream, r);
 }
 
+/**
+ * @brief Generate a range of the edges of an RMAT graph by chunks, without materializing the
+ * whole edge list.
+ *
+ * The edges [params.edge_begin, params.edge_end) of the stream of `r` (the same edges as those
+ * of `rmat_rectangular_gen` with `r`, whatever the chunks) are generated by chunks of
+ * params.chunk_size, optionally restricted to the source rows [params.row_begin,
+ * params.row_end) and deduplicated with a hash set on the device (see `rmat_stream_params` for
+ * the ways of splitting a graph across ranks). The edges kept of every chunk are passed to
+ * `on_chunk(src, dst)`, e.g. to append them to a file or to a graph builder. The views are valid
+ * until `on_chunk` returns, and the work on them must be ordered on the stream of the handle.
+ *
+ * The random state is not advanced, so that all the ranks see the same stream: advance it past
+ * the stream (`r.advance(n_edges, max(r_scale, c_scale))`) before generating another graph.
+ *
+ * @tparam IdxT  Type of each node index
+ * @tparam ProbT Data type used for probability distributions (either fp32 or fp64)
+ * @tparam ChunkOp host callable taking the source and destination node ids of a chunk
+ *   (`raft::device_vector_view<const IdxT, IdxT>` each)
+ *
+ * @param[in] handle  RAFT handle, containing the CUDA stream on which to schedule work
+ * @param[in] r       underlying state of the random generator
+ * @param[in] theta   distribution of each quadrant at each level of resolution
+ *                    [dim = max(r_scale, c_scale) x 2 x 2] (as in `rmat_rectangular_gen`)
+ * @param[in] r_scale 2^r_scale represents the number of source nodes
+ * @param[in] c_scale 2^c_scale represents the number of destination nodes
+ * @param[in] params  the range of the stream, the chunks and the filtering of the edges
+ * @param[in] on_chunk called with the edges kept of every chunk
+ */
+template <typename IdxT, typename ProbT, typename ChunkOp>
+void rmat_rectangular_gen_stream(raft::resources const& handle,
+                                 const raft::random::RngState& r,
+                                 raft::device_vector_view<const ProbT, IdxT> theta,
+                                 IdxT r_scale,
+                                 IdxT c_scale,
+                                 const rmat_stream_params& params,
+                                 ChunkOp on_chunk)
+{
+  RAFT_EXPECTS(theta.extent(0) == IdxT(4) * std::max(r_scale, c_scale),
+               "rmat_rectangular_gen_stream: theta must be [max(r_scale, c_scale) x 2 x 2]");
+  auto stream   = resource::get_cuda_stream(handle);
+  auto generate = [&](IdxT* src, IdxT* dst, IdxT n, raft::random::RngState& r_chunk) {
+    detail::rmat_rectangular_gen_caller<IdxT, ProbT>(
+      nullptr, src, dst, theta.data_handle(), r_scale, c_scale, n, stream, r_chunk);
+  };
+  detail::rmat_rectangular_gen_stream_impl(
+    handle, r, generate, r_scale, c_scale, params, on_chunk);
+}
+
+/**
+ * @brief Overload of `rmat_rectangular_gen_stream` that assumes the same
+ *   a, b, c, d probability distributions across all the scales.
+ */
+template <typename IdxT, typename ProbT, typename ChunkOp>
+void rmat_rectangular_gen_stream(raft::resources const& handle,
+                                 const raft::random::RngState& r,
+                                 ProbT a,
+                                 ProbT b,
+                                 ProbT c,
+                                 IdxT r_scale,
+                                 IdxT c_scale,
+                                 const rmat_stream_params& params,
+                                 ChunkOp on_chunk)
+{
+  auto stream   = resource::get_cuda_stream(handle);
+  auto generate = [&](IdxT* src, IdxT* dst, IdxT n, raft::random::RngState& r_chunk) {
+    detail::rmat_rectangular_gen_caller<IdxT, ProbT>(
+      nullptr, src, dst, a, b, c, r_scale, c_scale, n, stream, r_chunk);
+  };
+  detail::rmat_rectangular_gen_stream_impl(
+    handle, r, generate, r_scale, c_scale, params, on_chunk);
+}
+
+/**
+ * @brief Generate the CSR structure of (the rows of) an RMAT graph from its edge stream.
+ *
+ * The structure of the source rows [params.row_begin, params.row_end) (all by default) of the
+ * edges kept of `rmat_rectangular_gen_stream`, with the columns of every row sorted; only the
+ * structure and 16 bytes per edge of temporaries are held on the device, never the edge list of
+ * the whole stream. The stream is generated twice (counting, then writing the edges).
+ *
+ * With the rows of every rank and `params.deduplicate`, the ranks build the row partition of a
+ * simple graph without any communication.
+ *
+ * @tparam IdxT  Type of each node index (and of the offsets of the rows)
+ * @tparam ProbT Data type used for probability distributions (either fp32 or fp64)
+ *
+ * @param[in] handle  RAFT handle, containing the CUDA stream on which to schedule work
+ * @param[in] r       underlying state of the random generator (not advanced)
+ * @param[in] theta   distribution of each quadrant at each level of resolution
+ *                    [dim = max(r_scale, c_scale) x 2 x 2]
+ * @param[in] r_scale 2^r_scale represents the number of source nodes
+ * @param[in] c_scale 2^c_scale represents the number of destination nodes
+ * @param[in] params  the range of the stream, the chunks and the filtering of the edges
+ * @return the structure [row_end - row_begin, 2^c_scale] (the row i is the source row_begin + i)
+ */
+template <typename IdxT, typename ProbT>
+auto rmat_rectangular_gen_csr(raft::resources const& handle,
+                              const raft::random::RngState& r,
+                              raft::device_vector_view<const ProbT, IdxT> theta,
+                              IdxT r_scale,
+                              IdxT c_scale,
+                              const rmat_stream_params& params)
+  -> raft::device_compressed_structure<IdxT, IdxT, IdxT>
+{
+  RAFT_EXPECTS(theta.extent(0) == IdxT(4) * std::max(r_scale, c_scale),
+               "rmat_rectangular_gen_csr: theta must be [max(r_scale, c_scale) x 2 x 2]");
+  auto stream   = resource::get_cuda_stream(handle);
+  auto generate = [&](IdxT* src, IdxT* dst, IdxT n, raft::random::RngState& r_chunk) {
+    detail::rmat_rectangular_gen_caller<IdxT, ProbT>(
+      nullptr, src, dst, theta.data_handle(), r_scale, c_scale, n, stream, r_chunk);
+  };
+  return detail::rmat_rectangular_gen_csr_impl(handle, r, generate, r_scale, c_scale, params);
+}
+
+/**
+ * @brief Overload of `rmat_rectangular_gen_csr` that assumes the same
+ *   a, b, c, d probability distributions across all the scales.
+ */
+template <typename IdxT, typename ProbT>
+auto rmat_rectangular_gen_csr(raft::resources const& handle,
+                              const raft::random::RngState& r,
+                              ProbT a,
+                              ProbT b,
+                              ProbT c,
+                              IdxT r_scale,
+                              IdxT c_scale,
+                              const rmat_stream_params& params)
+  -> raft::device_compressed_structure<IdxT, IdxT, IdxT>
+{
+  auto stream   = resource::get_cuda_stream(handle);
+  auto generate = [&](IdxT* src, IdxT* dst, IdxT n, raft::random::RngState& r_chunk) {
+    detail::rmat_rectangular_gen_caller<IdxT, ProbT>(
+      nullptr, src, dst, a, b, c, r_scale, c_scale, n, stream, r_chunk);
+  };
+  return detail::rmat_rectangular_gen_csr_impl(handle, r, generate, r_scale, c_scale, params);
+}
+
 /** @} */
 
 }  // end namespace raft::random
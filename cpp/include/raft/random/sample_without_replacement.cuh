@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "detail/rng_impl.cuh"
+#include "detail/sample_indices.cuh"
 #include "rng_state.hpp"
 #include <cassert>
 #include <optional>
@@ -162,6 +163,36 @@ void sample_without_replacement(Args... args)
   sample_without_replacement(std::forward<Args>(args)..., std::nullopt);
 }
 
+/**
+ * @brief Draw distinct indices uniformly at random from the population [0, n_population),
+ * in increasing order.
+ *
+ * Unlike `sample_without_replacement`, which sorts random keys over the whole population,
+ * this draws about 1.5x the number of samples with replacement and deduplicates them, in
+ * O(k log k) for k samples: sampling 1M rows out of 1B only sorts a few million indices. When the
+ * samples are more than a quarter of the population, the whole population is shuffled instead.
+ *
+ * @tparam IdxT type of the indices
+ *
+ * @param[in] handle RAFT handle containing (among other resources)
+ *   the CUDA stream on which to run.
+ * @param[inout] rng_state Pseudorandom number generator state.
+ * @param[out] out the sampled indices [k]
+ * @param[in] n_population the size of the population
+ *
+ * @pre k = `out.extent(0)` is less than or equal to `n_population`.
+ */
+template <typename IdxT>
+void sample_indices_without_replacement(raft::resources const& handle,
+                                        RngState& rng_state,
+                                        raft::device_vector_view<IdxT, IdxT> out,
+                                        IdxT n_population)
+{
+  static_assert(std::is_integral<IdxT>::value, "IdxT must be an integral type.");
+  detail::sample_indices_without_replacement(
+    handle, rng_state, out.data_handle(), out.extent(0), n_population);
+}
+
 /** @} */
 
 }  // end namespace raft::random
\ No newline at end of file
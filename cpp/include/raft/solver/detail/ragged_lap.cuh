@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cuda_dev_essentials.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/warp_primitives.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace raft::solver::detail {
+
+/** The largest problems solved by one warp; the larger ones go to the block Hungarian solver. */
+constexpr int kLapWarpMaxSize = 256;
+/** The warps of a block of the warp-per-problem kernel. */
+constexpr int kLapWarpsPerBlock = 4;
+
+/** The shared memory of a warp solving problems of at most `max_n` rows. */
+template <typename weight_t>
+constexpr auto lap_warp_smem_bytes(int max_n) -> size_t
+{
+  size_t len = size_t(max_n) + 1;
+  size_t w   = raft::alignTo(3 * len * sizeof(weight_t), sizeof(int));
+  return raft::alignTo(w + 2 * len * sizeof(int) + len, sizeof(double));
+}
+
+/**
+ * One square assignment problem per warp, by the shortest augmenting paths of Jonker and
+ * Volgenant (the O(n^3) Hungarian algorithm with the potentials u, v): every row is inserted by a
+ * Dijkstra search over the columns on the reduced costs, whose relaxation and minimum are split
+ * over the lanes. The state (potentials, matching, tree and slacks, 1-based with the column 0 as
+ * the root) lives in shared memory. The problems are taken in the given order (the largest
+ * first, for the balance of the warps).
+ */
+template <typename vertex_t, typename weight_t>
+RAFT_KERNEL lap_warp_kernel(const weight_t* __restrict__ costs,
+                            const int64_t* __restrict__ cost_offsets,
+                            const int64_t* __restrict__ row_offsets,
+                            const vertex_t* __restrict__ sizes,
+                            const int* __restrict__ order,
+                            int n_problems,
+                            int max_n,
+                            vertex_t* row_assignments,
+                            vertex_t* col_assignments)
+{
+  extern __shared__ char lap_smem[];
+  const int lane    = threadIdx.x % raft::WarpSize;
+  const int warp    = threadIdx.x / raft::WarpSize;
+  const int problem = blockIdx.x * (blockDim.x / raft::WarpSize) + warp;
+  if (problem >= n_problems) { return; }
+
+  const size_t len   = size_t(max_n) + 1;
+  const size_t w_off = raft::alignTo(3 * len * sizeof(weight_t), sizeof(int));
+  char* smem         = lap_smem + warp * lap_warp_smem_bytes<weight_t>(max_n);
+  auto* u            = reinterpret_cast<weight_t*>(smem);
+  auto* v            = u + len;
+  auto* minv         = v + len;
+  auto* p            = reinterpret_cast<int*>(smem + w_off);
+  auto* way          = p + len;
+  auto* used         = reinterpret_cast<char*>(way + len);
+
+  const int pid       = order[problem];
+  const int n         = sizes[pid];
+  const weight_t* a   = costs + cost_offsets[pid];
+  const weight_t kInf = upper_bound<weight_t>();
+
+  for (int j = lane; j <= n; j += raft::WarpSize) {
+    u[j] = 0;
+    v[j] = 0;
+    p[j] = 0;
+  }
+  __syncwarp();
+
+  for (int i = 1; i <= n; i++) {
+    for (int j = lane; j <= n; j += raft::WarpSize) {
+      minv[j] = kInf;
+      used[j] = 0;
+    }
+    if (lane == 0) { p[0] = i; }
+    __syncwarp();
+    int j0 = 0;
+    do {
+      if (lane == 0) { used[j0] = 1; }
+      __syncwarp();
+      const int i0        = p[j0];
+      const weight_t ui0  = u[i0];
+      const weight_t* row = a + size_t(i0 - 1) * n;
+      weight_t delta      = kInf;
+      int j1              = n + 1;
+      for (int j = 1 + lane; j <= n; j += raft::WarpSize) {
+        if (used[j]) { continue; }
+        weight_t cur = row[j - 1] - ui0 - v[j];
+        if (cur < minv[j]) {
+          minv[j] = cur;
+          way[j]  = j0;
+        }
+        if (j1 > n || minv[j] < delta) {
+          delta = minv[j];
+          j1    = j;
+        }
+      }
+      // the smallest slack over the warp (the first column on ties)
+      for (int offset = raft::WarpSize / 2; offset > 0; offset /= 2) {
+        weight_t other_delta = shfl_xor(delta, offset);
+        int other_j1         = shfl_xor(j1, offset);
+        if (other_j1 <= n && (j1 > n || other_delta < delta ||
+                              (other_delta == delta && other_j1 < j1))) {
+          delta = other_delta;
+          j1    = other_j1;
+        }
+      }
+      // the columns of the tree and their rows are distinct: no two lanes update the same u
+      for (int j = lane; j <= n; j += raft::WarpSize) {
+        if (used[j]) {
+          u[p[j]] += delta;
+          v[j] -= delta;
+        } else {
+          minv[j] -= delta;
+        }
+      }
+      __syncwarp();
+      j0 = j1;
+    } while (p[j0] != 0);
+    // augment along the tree
+    if (lane == 0) {
+      do {
+        int j1 = way[j0];
+        p[j0]  = p[j1];
+        j0     = j1;
+      } while (j0 != 0);
+    }
+    __syncwarp();
+  }
+
+  const int64_t row0 = row_offsets[pid];
+  for (int j = 1 + lane; j <= n; j += raft::WarpSize) {
+    row_assignments[row0 + p[j] - 1] = vertex_t(j - 1);
+    col_assignments[row0 + j - 1]    = vertex_t(p[j] - 1);
+  }
+}
+
+/** The cost of the assignment of every problem, one warp per problem. */
+template <typename vertex_t, typename weight_t>
+RAFT_KERNEL lap_objective_kernel(const weight_t* __restrict__ costs,
+                                 const int64_t* __restrict__ cost_offsets,
+                                 const int64_t* __restrict__ row_offsets,
+                                 const vertex_t* __restrict__ sizes,
+                                 const vertex_t* __restrict__ row_assignments,
+                                 int n_problems,
+                                 weight_t* objectives)
+{
+  const int lane    = threadIdx.x % raft::WarpSize;
+  const int problem = (blockIdx.x * blockDim.x + threadIdx.x) / raft::WarpSize;
+  if (problem >= n_problems) { return; }
+  const int n       = sizes[problem];
+  const weight_t* a = costs + cost_offsets[problem];
+  const vertex_t* r = row_assignments + row_offsets[problem];
+  weight_t sum      = 0;
+  for (int i = lane; i < n; i += raft::WarpSize) {
+    sum += a[size_t(i) * n + r[i]];
+  }
+  for (int offset = raft::WarpSize / 2; offset > 0; offset /= 2) {
+    sum += shfl_xor(sum, offset);
+  }
+  if (lane == 0) { objectives[problem] = sum; }
+}
+
+/**
+ * The ragged batch: the problems of at most kLapWarpMaxSize rows in one launch of the warp
+ * kernel (the largest first), and the larger ones with the block Hungarian solver of
+ * `BlockSolver`, one batch per distinct size.
+ */
+template <typename vertex_t, typename weight_t, typename BlockSolver>
+void solve_ragged_lap(raft::resources const& handle,
+                      const weight_t* costs,
+                      const vertex_t* h_sizes,
+                      int n_problems,
+                      vertex_t* row_assignments,
+                      vertex_t* col_assignments,
+                      weight_t* objectives,
+                      weight_t epsilon)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  if (n_problems == 0) { return; }
+
+  std::vector<int64_t> cost_offsets(n_problems + 1, 0);
+  std::vector<int64_t> row_offsets(n_problems + 1, 0);
+  for (int i = 0; i < n_problems; i++) {
+    RAFT_EXPECTS(h_sizes[i] >= 0, "The sizes of the problems must not be negative");
+    cost_offsets[i + 1] = cost_offsets[i] + int64_t(h_sizes[i]) * h_sizes[i];
+    row_offsets[i + 1]  = row_offsets[i] + h_sizes[i];
+  }
+  std::vector<int> small, large;
+  for (int i = 0; i < n_problems; i++) {
+    if (h_sizes[i] == 0) { continue; }
+    (h_sizes[i] <= kLapWarpMaxSize ? small : large).push_back(i);
+  }
+  std::stable_sort(
+    small.begin(), small.end(), [&](int x, int y) { return h_sizes[x] > h_sizes[y]; });
+
+  rmm::device_uvector<int64_t> d_cost_offsets(n_problems + 1, stream);
+  rmm::device_uvector<int64_t> d_row_offsets(n_problems + 1, stream);
+  rmm::device_uvector<vertex_t> d_sizes(n_problems, stream);
+  raft::update_device(d_cost_offsets.data(), cost_offsets.data(), n_problems + 1, stream);
+  raft::update_device(d_row_offsets.data(), row_offsets.data(), n_problems + 1, stream);
+  raft::update_device(d_sizes.data(), h_sizes, n_problems, stream);
+
+  if (!small.empty()) {
+    int max_n = h_sizes[small.front()];
+    rmm::device_uvector<int> d_order(small.size(), stream);
+    raft::update_device(d_order.data(), small.data(), small.size(), stream);
+    size_t smem  = kLapWarpsPerBlock * lap_warp_smem_bytes<weight_t>(max_n);
+    int n_blocks = raft::ceildiv<int>(int(small.size()), kLapWarpsPerBlock);
+    lap_warp_kernel<vertex_t, weight_t>
+      <<<n_blocks, kLapWarpsPerBlock * raft::WarpSize, smem, stream>>>(costs,
+                                                                        d_cost_offsets.data(),
+                                                                        d_row_offsets.data(),
+                                                                        d_sizes.data(),
+                                                                        d_order.data(),
+                                                                        int(small.size()),
+                                                                        max_n,
+                                                                        row_assignments,
+                                                                        col_assignments);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+
+  // the large problems, gathered by size into the batches of the block solver
+  std::stable_sort(
+    large.begin(), large.end(), [&](int x, int y) { return h_sizes[x] < h_sizes[y]; });
+  for (size_t first = 0; first < large.size();) {
+    size_t last = first;
+    while (last < large.size() && h_sizes[large[last]] == h_sizes[large[first]]) {
+      last++;
+    }
+    vertex_t n     = h_sizes[large[first]];
+    vertex_t batch = vertex_t(last - first);
+    size_t n2      = size_t(n) * n;
+    rmm::device_uvector<weight_t> batch_costs(n2 * batch, stream);
+    rmm::device_uvector<vertex_t> batch_rows(size_t(n) * batch, stream);
+    rmm::device_uvector<vertex_t> batch_cols(size_t(n) * batch, stream);
+    for (size_t b = first; b < last; b++) {
+      raft::copy(batch_costs.data() + (b - first) * n2, costs + cost_offsets[large[b]], n2, stream);
+    }
+    BlockSolver solver(handle, n, batch, epsilon);
+    solver.solve(batch_costs.data(), batch_rows.data(), batch_cols.data());
+    for (size_t b = first; b < last; b++) {
+      int64_t row0 = row_offsets[large[b]];
+      raft::copy(row_assignments + row0, batch_rows.data() + (b - first) * n, n, stream);
+      raft::copy(col_assignments + row0, batch_cols.data() + (b - first) * n, n, stream);
+    }
+    first = last;
+  }
+
+  if (objectives != nullptr) {
+    constexpr int kThreads = 256;
+    int n_blocks           = raft::ceildiv<int>(n_problems * raft::WarpSize, kThreads);
+    lap_objective_kernel<vertex_t, weight_t>
+      <<<n_blocks, kThreads, 0, stream>>>(costs,
+                                          d_cost_offsets.data(),
+                                          d_row_offsets.data(),
+                                          d_sizes.data(),
+                                          row_assignments,
+                                          n_problems,
+                                          objectives);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+  // the host buffers of the copies must outlive them
+  resource::sync_stream(handle, stream);
+}
+
+}  // namespace raft::solver::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  * Copyright 2020 KETAN DATE & RAKESH NAGI
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
@@ -28,6 +28,9 @@
 
 #pragma once
 
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/host_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
 #include <rmm/device_uvector.hpp>
@@ -35,7 +38,11 @@
 #include <thrust/execution_policy.h>
 #include <thrust/fill.h>
 
+#include <cstdint>
+#include <optional>
+
 #include <raft/solver/detail/lap_functions.cuh>
+#include <raft/solver/detail/ragged_lap.cuh>
 #include <raft/solver/linear_assignment_types.hpp>
 
 namespace raft::solver {
@@ -329,6 +336,68 @@ class LinearAssignmentProblem {
   }
 };
 
+/**
+ * @brief Solve a ragged batch of square assignment problems of different sizes, e.g. the many
+ * small matchings of the frames of a tracking pipeline.
+ *
+ * The cost matrices are packed one after the other (row-major, n_i x n_i each). The problems of
+ * up to 256 rows are solved in a single launch, one warp per problem, by the shortest augmenting
+ * paths of Jonker and Volgenant with the state in shared memory (the largest problems are
+ * scheduled first). The larger ones are gathered by size and solved by the block Hungarian
+ * algorithm of LinearAssignmentProblem.
+ *
+ * @code{.cpp}
+ *   // sizes = {3, 2, 40}: costs has 9 + 4 + 1600 values, the assignments 3 + 2 + 40
+ *   raft::solver::solve_ragged_lap(handle,
+ *                                  costs.view(),
+ *                                  sizes.view(),
+ *                                  row_assignments.view(),
+ *                                  col_assignments.view(),
+ *                                  std::make_optional(objectives.view()));
+ * @endcode
+ *
+ * @tparam vertex_t the type of the assignments
+ * @tparam weight_t the type of the costs
+ * @param[in] handle raft handle for managing resources
+ * @param[in] costs the packed cost matrices [sum n_i^2]
+ * @param[in] sizes the number of rows (and columns) of every problem [n_problems]
+ * @param[out] row_assignments the column of every row of every problem, packed [sum n_i]
+ * @param[out] col_assignments the row of every column of every problem, packed [sum n_i]
+ * @param[out] objectives the optimal cost of every problem [n_problems]
+ * @param[in] epsilon the tolerance on the reduced costs of the block solver
+ */
+template <typename vertex_t, typename weight_t>
+void solve_ragged_lap(
+  raft::resources const& handle,
+  raft::device_vector_view<const weight_t, int64_t> costs,
+  raft::host_vector_view<const vertex_t, int64_t> sizes,
+  raft::device_vector_view<vertex_t, int64_t> row_assignments,
+  raft::device_vector_view<vertex_t, int64_t> col_assignments,
+  std::optional<raft::device_vector_view<weight_t, int64_t>> objectives = std::nullopt,
+  weight_t epsilon                                                      = weight_t(1e-6))
+{
+  int64_t n_rows   = 0;
+  int64_t n_values = 0;
+  for (int64_t i = 0; i < sizes.extent(0); i++) {
+    n_rows += sizes(i);
+    n_values += int64_t(sizes(i)) * sizes(i);
+  }
+  RAFT_EXPECTS(costs.extent(0) == n_values, "costs must hold the n_i x n_i matrices");
+  RAFT_EXPECTS(row_assignments.extent(0) == n_rows && col_assignments.extent(0) == n_rows,
+               "The assignments must have sum n_i elements");
+  RAFT_EXPECTS(!objectives.has_value() || objectives->extent(0) == sizes.extent(0),
+               "objectives must have n_problems elements");
+  detail::solve_ragged_lap<vertex_t, weight_t, LinearAssignmentProblem<vertex_t, weight_t>>(
+    handle,
+    costs.data_handle(),
+    sizes.data_handle(),
+    int(sizes.extent(0)),
+    row_assignments.data_handle(),
+    col_assignments.data_handle(),
+    objectives.has_value() ? objectives->data_handle() : nullptr,
+    epsilon);
+}
+
 }  // namespace raft::solver
 
 #endif
\ No newline at end of file
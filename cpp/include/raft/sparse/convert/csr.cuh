@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <raft/core/device_coo_matrix.hpp>
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/sparse/convert/detail/adj_to_csr.cuh>
 #include <raft/sparse/convert/detail/csr.cuh>
 #include <raft/sparse/csr.hpp>
@@ -68,6 +70,43 @@ void sorted_coo_to_csr(COO<T>* coo, int* row_ind, cudaStream_t stream)
   detail::sorted_coo_to_csr(coo->rows(), coo->nnz, row_ind, coo->n_rows, stream);
 }
 
+/**
+ * @brief Converts an unsorted COO matrix with duplicates into a sorted CSR matrix in a single
+ * pipeline: the entries are sorted by (row, column), the duplicates are summed, the zeros
+ * (including the duplicates summing to zero) are dropped and the row offsets are built.
+ *
+ * The input matrix is consumed (its rows and values are overwritten). `out` must have the shape
+ * of `coo`; its sparsity is set to the number of remaining entries, so that its buffers are not
+ * reallocated when it was created (or previously initialized) with at least that many nonzeros.
+ *
+ * @code{.cpp}
+ * auto csr = raft::make_device_csr_matrix<float, int, int, int>(handle, n_rows, n_cols, nnz);
+ * raft::sparse::convert::coo_to_sorted_csr(handle, coo_view, csr);
+ * @endcode
+ *
+ * @tparam value_t type of the values
+ * @tparam value_idx type of the row and column indices
+ * @tparam nnz_t type of the number of nonzeros
+ * @param[in] handle raft handle
+ * @param[inout] coo input COO matrix (overwritten)
+ * @param[out] out output CSR matrix
+ */
+template <typename value_t, typename value_idx, typename nnz_t>
+void coo_to_sorted_csr(raft::resources const& handle,
+                       raft::device_coo_matrix_view<value_t, value_idx, value_idx, nnz_t> coo,
+                       raft::device_csr_matrix<value_t, value_idx, value_idx, nnz_t>& out)
+{
+  auto coo_structure = coo.structure_view();
+  detail::coo_to_sorted_csr(handle,
+                            coo_structure.get_rows().data(),
+                            coo_structure.get_cols().data(),
+                            coo.get_elements().data(),
+                            coo_structure.get_nnz(),
+                            coo_structure.get_n_rows(),
+                            coo_structure.get_n_cols(),
+                            out);
+}
+
 /**
  * @brief Converts a boolean adjacency matrix into unsorted CSR format.
  *
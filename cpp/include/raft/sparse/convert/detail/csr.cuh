@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -26,15 +26,27 @@
 #include <raft/util/cudart_utils.hpp>
 #include <rmm/device_uvector.hpp>
 
+#include <thrust/binary_search.h>
+#include <thrust/copy.h>
+#include <thrust/count.h>
 #include <thrust/device_ptr.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
 #include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
+#include <thrust/tuple.h>
 
 #include <cuda_runtime.h>
 #include <stdio.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <iostream>
 
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
 #include <raft/sparse/coo.hpp>
 #include <raft/sparse/detail/utils.h>
 #include <raft/sparse/linalg/degree.cuh>
@@ -100,6 +112,69 @@ void sorted_coo_to_csr(const T* rows, int nnz, T* row_ind, int m, cudaStream_t s
   exclusive_scan(rmm::exec_policy(stream), row_counts_d, row_counts_d + m, c_ind_d);
 }
 
+/**
+ * Sorts a COO matrix by (row, column), sums its duplicates, removes its zeros and writes the
+ * result into the CSR matrix `out`. The input arrays are consumed: the values are sorted and
+ * scanned in place and `rows` is reused to hold the rows of the compacted entries. The only
+ * scratch space is the array of the linearized (row, column) keys, which makes the whole
+ * conversion a single radix sort followed by a segmented scan, one compaction and one search.
+ */
+template <typename value_idx, typename value_t, typename nnz_t>
+void coo_to_sorted_csr(raft::resources const& handle,
+                       value_idx* rows,
+                       const value_idx* cols,
+                       value_t* vals,
+                       nnz_t nnz,
+                       value_idx n_rows,
+                       value_idx n_cols,
+                       raft::device_csr_matrix<value_t, value_idx, value_idx, nnz_t>& out)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  auto policy = resource::get_thrust_policy(handle);
+
+  // 1. sort by the linearized (row, column) keys
+  rmm::device_uvector<uint64_t> keys(nnz, stream);
+  thrust::transform(
+    policy, rows, rows + nnz, cols, keys.begin(), [n_cols] __device__(value_idx r, value_idx c) {
+      return static_cast<uint64_t>(r) * static_cast<uint64_t>(n_cols) + static_cast<uint64_t>(c);
+    });
+  thrust::sort_by_key(policy, keys.begin(), keys.end(), vals);
+
+  // 2. the sum of every run of duplicates, at its last entry
+  thrust::inclusive_scan_by_key(policy, keys.begin(), keys.end(), vals, vals);
+
+  // 3. compaction of the last entries of the runs with a nonzero sum
+  auto keys_ptr = keys.data();
+  auto keep     = [keys_ptr, vals, nnz] __device__(nnz_t i) {
+    return (i + 1 == nnz || keys_ptr[i + 1] != keys_ptr[i]) && vals[i] != value_t(0);
+  };
+  auto first   = thrust::make_counting_iterator<nnz_t>(0);
+  nnz_t n_kept = thrust::count_if(policy, first, first + nnz, keep);
+  out.initialize_sparsity(n_kept);
+
+  auto structure = out.structure_view();
+  RAFT_EXPECTS(structure.get_n_rows() == n_rows && structure.get_n_cols() == n_cols,
+               "The COO and CSR matrices must have the same shape");
+  auto indptr  = structure.get_indptr().data();
+  auto entries = thrust::make_zip_iterator(thrust::make_tuple(
+    thrust::make_transform_iterator(
+      keys.begin(), [n_cols] __device__(uint64_t k) { return value_idx(k / uint64_t(n_cols)); }),
+    thrust::make_transform_iterator(
+      keys.begin(), [n_cols] __device__(uint64_t k) { return value_idx(k % uint64_t(n_cols)); }),
+    vals));
+  thrust::copy_if(policy,
+                  entries,
+                  entries + nnz,
+                  first,
+                  thrust::make_zip_iterator(thrust::make_tuple(
+                    rows, structure.get_indices().data(), out.get_elements().data())),
+                  keep);
+
+  // 4. the row offsets
+  auto row_ids = thrust::make_counting_iterator<value_idx>(0);
+  thrust::lower_bound(policy, rows, rows + n_kept, row_ids, row_ids + n_rows + 1, indptr);
+}
+
 };  // end NAMESPACE detail
 };  // end NAMESPACE convert
 };  // end NAMESPACE sparse
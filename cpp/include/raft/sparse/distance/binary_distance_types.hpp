@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace raft::sparse::distance {
+
+/** How `binary_pairwise_distance` computes the intersections of the rows. */
+enum class binary_distance_algo {
+  /** BITSET when the rows are dense enough for the bitsets to beat the SpMV, otherwise SPMV. */
+  AUTO,
+  /** The general sparse (SpMV) distances of `pairwise_distance`. */
+  SPMV,
+  /**
+   * The rows are packed into bitsets, by blocks of columns, and the intersections are counted
+   * with popcounts of the ANDed words (exact).
+   */
+  BITSET,
+  /**
+   * The Jaccard similarity of two rows is estimated by the fraction of their equal MinHash
+   * signatures (approximate: the standard error is sqrt(J (1 - J) / n_hashes)).
+   */
+  MINHASH
+};
+
+/** @brief The parameters of `binary_pairwise_distance`. */
+struct binary_distance_params {
+  binary_distance_algo algo = binary_distance_algo::AUTO;
+  /** The number of hash functions of the MinHash signatures (MINHASH only). */
+  uint32_t n_hashes = 128;
+  /** The seed of the hash functions (MINHASH only). */
+  uint64_t seed = 0;
+};
+
+}  // namespace raft::sparse::distance
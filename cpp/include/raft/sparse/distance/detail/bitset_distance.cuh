@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "common.hpp"
+
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/sparse/distance/binary_distance_types.hpp>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/integer_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+/*
+ * The distances of binary sparse rows (the non-zero elements are the members of the sets) from
+ * the sizes of the rows and of their intersections:
+ *
+ *  - BITSET: the rows are packed into bitsets by blocks of columns, and the intersections of
+ *    all the pairs of rows are counted by a tiled kernel ANDing and popcounting the words
+ *    staged in the shared memory (a GEMM-like loop with popc(a & b) as the multiply-add).
+ *  - MINHASH: every row gets n_hashes MinHash signatures (the smallest hash of its columns for
+ *    every hash function), the same tiled kernel counts the equal signatures of all the pairs,
+ *    and the Jaccard similarity J estimated by their fraction gives the intersection
+ *    J (|a| + |b|) / (1 + J).
+ */
+namespace raft::sparse::distance::detail {
+
+/** The rows and the columns of a tile of the outputs of `count_matches_kernel`. */
+constexpr int kBinaryTile = 16;
+/** The words of the rows staged in the shared memory at once by `count_matches_kernel`. */
+constexpr int kBinaryTileWords = 32;
+/** The largest size of the bitsets of a block of columns. */
+constexpr size_t kBitsetWorkspaceBytes = size_t(256) << 20;
+/**
+ * The bitsets are used by AUTO when a row has at least one non-zero element in this many
+ * columns on average: the popcounts then process the pairs of rows faster than the SpMV.
+ */
+constexpr int64_t kBitsetMaxColumnsPerNonzero = 256;
+
+struct popc_and_op {
+  __device__ __forceinline__ auto operator()(uint32_t a, uint32_t b) const -> uint32_t
+  {
+    return __popc(a & b);
+  }
+};
+
+struct equal_words_op {
+  __device__ __forceinline__ auto operator()(uint32_t a, uint32_t b) const -> uint32_t
+  {
+    return a == b;
+  }
+};
+
+/** The bits of the columns [col0, col0 + 32 n_words) of the rows (a warp per row). */
+template <typename value_idx, typename value_t>
+RAFT_KERNEL pack_bitsets_kernel(const value_idx* __restrict__ indptr,
+                                const value_idx* __restrict__ indices,
+                                const value_t* __restrict__ data,
+                                value_idx n_rows,
+                                int64_t col0,
+                                uint32_t n_words,
+                                uint32_t* bits)
+{
+  const int64_t row = (int64_t(blockIdx.x) * blockDim.x + threadIdx.x) / WarpSize;
+  if (row >= n_rows) { return; }
+  const int64_t n_cols = int64_t(n_words) * 32;
+  for (int64_t k = indptr[row] + threadIdx.x % WarpSize; k < indptr[row + 1]; k += WarpSize) {
+    const int64_t c = int64_t(indices[k]) - col0;
+    if (c >= 0 && c < n_cols && data[k] != value_t(0)) {
+      atomicOr(bits + row * n_words + c / 32, 1u << (c % 32));
+    }
+  }
+}
+
+/** norms[row] += the number of bits of the row (a thread per row). */
+template <typename value_t>
+RAFT_KERNEL add_popcounts_kernel(const uint32_t* __restrict__ bits,
+                                 int64_t n_rows,
+                                 uint32_t n_words,
+                                 value_t* norms)
+{
+  const int64_t row = int64_t(blockIdx.x) * blockDim.x + threadIdx.x;
+  if (row >= n_rows) { return; }
+  uint32_t count = 0;
+  for (uint32_t w = 0; w < n_words; w++) {
+    count += __popc(bits[row * n_words + w]);
+  }
+  norms[row] += value_t(count);
+}
+
+/** The hash of a column by the hash function h (MurmurHash3 finalizer of the mixed inputs). */
+__device__ __forceinline__ auto minhash_column(uint32_t col, uint32_t h, uint64_t seed) -> uint32_t
+{
+  uint32_t x = col * 0x9e3779b1u ^ uint32_t(seed) ^ (h * 0x85ebca6bu + uint32_t(seed >> 32));
+  x ^= x >> 16;
+  x *= 0x85ebca6bu;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35u;
+  x ^= x >> 16;
+  // the largest value marks the empty rows
+  return min(x, std::numeric_limits<uint32_t>::max() - 1);
+}
+
+/**
+ * signatures [n_rows, n_hashes]: the smallest hash of the columns of every row by every hash
+ * function, and norms [n_rows] the numbers of non-zero elements of the rows (a warp per row).
+ */
+template <typename value_idx, typename value_t>
+RAFT_KERNEL minhash_signatures_kernel(const value_idx* __restrict__ indptr,
+                                      const value_idx* __restrict__ indices,
+                                      const value_t* __restrict__ data,
+                                      value_idx n_rows,
+                                      uint32_t n_hashes,
+                                      uint64_t seed,
+                                      uint32_t* signatures,
+                                      value_t* norms)
+{
+  const int64_t row = (int64_t(blockIdx.x) * blockDim.x + threadIdx.x) / WarpSize;
+  if (row >= n_rows) { return; }
+  const uint32_t lane = threadIdx.x % WarpSize;
+  const int64_t begin = indptr[row];
+  const int64_t end   = indptr[row + 1];
+  for (uint32_t h = lane; h < n_hashes; h += WarpSize) {
+    uint32_t sig = std::numeric_limits<uint32_t>::max();
+    for (int64_t k = begin; k < end; k++) {
+      if (data[k] != value_t(0)) { sig = min(sig, minhash_column(uint32_t(indices[k]), h, seed)); }
+    }
+    signatures[row * n_hashes + h] = sig;
+  }
+  uint32_t count = 0;
+  for (int64_t k = begin + lane; k < end; k += WarpSize) {
+    count += data[k] != value_t(0);
+  }
+  count = raft::warpReduce(count);
+  if (lane == 0) { norms[row] = value_t(count); }
+}
+
+/**
+ * out [m, n] += the sum over the words w of op(a[i, w], b[j, w]), with a [m, n_words] and
+ * b [n, n_words] row-major (a kBinaryTile x kBinaryTile block of threads per tile of outputs).
+ */
+template <typename value_t, typename match_op>
+RAFT_KERNEL count_matches_kernel(const uint32_t* __restrict__ a,
+                                 const uint32_t* __restrict__ b,
+                                 int64_t m,
+                                 int64_t n,
+                                 uint32_t n_words,
+                                 value_t* out,
+                                 match_op op)
+{
+  __shared__ uint32_t a_tile[kBinaryTile][kBinaryTileWords + 1];
+  __shared__ uint32_t b_tile[kBinaryTile][kBinaryTileWords + 1];
+  const int64_t i0 = int64_t(blockIdx.y) * kBinaryTile;
+  const int64_t j0 = int64_t(blockIdx.x) * kBinaryTile;
+  const int tx     = threadIdx.x;
+  const int ty     = threadIdx.y;
+  uint32_t count   = 0;
+  for (uint32_t w0 = 0; w0 < n_words; w0 += kBinaryTileWords) {
+    for (int t = ty * kBinaryTile + tx; t < kBinaryTile * kBinaryTileWords;
+         t += kBinaryTile * kBinaryTile) {
+      const int r      = t / kBinaryTileWords;
+      const int c      = t % kBinaryTileWords;
+      const uint32_t w = w0 + c;
+      a_tile[r][c]     = (i0 + r < m && w < n_words) ? a[(i0 + r) * n_words + w] : 0;
+      b_tile[r][c]     = (j0 + r < n && w < n_words) ? b[(j0 + r) * n_words + w] : 0;
+    }
+    __syncthreads();
+    const uint32_t w_end = min(uint32_t(kBinaryTileWords), n_words - w0);
+    for (uint32_t w = 0; w < w_end; w++) {
+      count += op(a_tile[ty][w], b_tile[tx][w]);
+    }
+    __syncthreads();
+  }
+  if (i0 + ty < m && j0 + tx < n) { out[(i0 + ty) * n + j0 + tx] += value_t(count); }
+}
+
+/**
+ * bits [n_rows, n_words] = the bitsets of the columns [col0, col0 + 32 n_words) of the rows, and
+ * norms [n_rows] += their numbers of bits.
+ */
+template <typename value_idx, typename value_t>
+void pack_bitsets(const value_idx* indptr,
+                  const value_idx* indices,
+                  const value_t* data,
+                  value_idx n_rows,
+                  int64_t col0,
+                  uint32_t n_words,
+                  uint32_t* bits,
+                  value_t* norms,
+                  cudaStream_t stream)
+{
+  constexpr int kThreads = 256;
+  if (n_rows == 0) { return; }
+  RAFT_CUDA_TRY(cudaMemsetAsync(bits, 0, sizeof(uint32_t) * n_rows * n_words, stream));
+  pack_bitsets_kernel<<<raft::ceildiv<int64_t>(int64_t(n_rows) * WarpSize, kThreads),
+                        kThreads,
+                        0,
+                        stream>>>(indptr, indices, data, n_rows, col0, n_words, bits);
+  add_popcounts_kernel<<<raft::ceildiv<int64_t>(n_rows, kThreads), kThreads, 0, stream>>>(
+    bits, n_rows, n_words, norms);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+template <typename value_t, typename match_op>
+void count_matches(const uint32_t* a,
+                   const uint32_t* b,
+                   int64_t m,
+                   int64_t n,
+                   uint32_t n_words,
+                   value_t* out,
+                   match_op op,
+                   cudaStream_t stream)
+{
+  // the rows of a are split into chunks within the limit of the grid y dimension
+  constexpr int64_t kChunkRows = int64_t(65535) * kBinaryTile;
+  dim3 threads(kBinaryTile, kBinaryTile);
+  for (int64_t i = 0; i < m; i += kChunkRows) {
+    const int64_t rows = std::min(kChunkRows, m - i);
+    dim3 blocks(raft::ceildiv<int64_t>(n, kBinaryTile), raft::ceildiv<int64_t>(rows, kBinaryTile));
+    count_matches_kernel<<<blocks, threads, 0, stream>>>(
+      a + i * n_words, b, rows, n, n_words, out + i * n, op);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+}
+
+/** The distance of two binary rows from their sizes and the size of their intersection. */
+template <typename value_t>
+struct binary_expansion_op {
+  raft::distance::DistanceType metric;
+  value_t inv_n_cols;
+
+  __device__ __forceinline__ auto operator()(value_t inter, value_t a_norm, value_t b_norm) const
+    -> value_t
+  {
+    const value_t sum = a_norm + b_norm;
+    switch (metric) {
+      case raft::distance::DistanceType::JaccardExpanded: {
+        // two empty rows are at the distance zero, as in `jaccard_expanded_distances_t`
+        const value_t denom = sum - inter;
+        return denom == 0 ? value_t(0) : 1 - inter / denom;
+      }
+      case raft::distance::DistanceType::DiceExpanded:
+        return sum == 0 ? value_t(0) : 1 - 2 * inter / sum;
+      default:  // HammingUnexpanded
+        return (sum - 2 * inter) * inv_n_cols;
+    }
+  }
+};
+
+/** out [m, n] = op(out, a_norms, b_norms) (in place), the intersections becoming distances. */
+template <typename value_t>
+void expand_binary_distances(raft::resources const& handle,
+                             value_t* out,
+                             const value_t* a_norms,
+                             const value_t* b_norms,
+                             int64_t m,
+                             int64_t n,
+                             raft::distance::DistanceType metric,
+                             int64_t n_cols)
+{
+  binary_expansion_op<value_t> op{metric, value_t(1) / value_t(n_cols)};
+  raft::linalg::map_offset(handle,
+                           raft::make_device_vector_view<value_t, int64_t>(out, m * n),
+                           [out, a_norms, b_norms, n, op] __device__(int64_t k) {
+                             return op(out[k], a_norms[k / n], b_norms[k % n]);
+                           });
+}
+
+/** Whether AUTO computes the distances of the rows with the bitsets. */
+template <typename value_idx, typename value_t>
+auto use_bitsets(const distances_config_t<value_idx, value_t>& config) -> bool
+{
+  const int64_t nnz  = int64_t(config.a_nnz) + int64_t(config.b_nnz);
+  const int64_t rows = int64_t(config.a_nrows) + int64_t(config.b_nrows);
+  return int64_t(config.a_ncols) * rows <= kBitsetMaxColumnsPerNonzero * nnz;
+}
+
+template <typename value_idx, typename value_t>
+void bitset_pairwise_distance(value_t* out,
+                              const distances_config_t<value_idx, value_t>& config,
+                              raft::distance::DistanceType metric)
+{
+  auto& handle      = config.handle;
+  auto stream       = resource::get_cuda_stream(handle);
+  auto mr           = resource::get_workspace_resource(handle);
+  const int64_t m   = config.a_nrows;
+  const int64_t n   = config.b_nrows;
+  const int64_t dim = config.a_ncols;
+
+  // the blocks of columns, as wide as the workspace allows
+  const uint64_t total_words = raft::div_rounding_up_safe<int64_t>(dim, 32);
+  const uint64_t fit_words =
+    kBitsetWorkspaceBytes / (sizeof(uint32_t) * std::max<int64_t>(m + n, 1));
+  const uint32_t block_words = std::min<uint64_t>(
+    total_words,
+    std::max<uint64_t>(kBinaryTileWords, fit_words / kBinaryTileWords * kBinaryTileWords));
+
+  rmm::device_uvector<uint32_t> a_bits(m * block_words, stream, mr);
+  rmm::device_uvector<uint32_t> b_bits(n * block_words, stream, mr);
+  rmm::device_uvector<value_t> a_norms(m, stream, mr);
+  rmm::device_uvector<value_t> b_norms(n, stream, mr);
+  RAFT_CUDA_TRY(cudaMemsetAsync(out, 0, sizeof(value_t) * m * n, stream));
+  RAFT_CUDA_TRY(cudaMemsetAsync(a_norms.data(), 0, sizeof(value_t) * m, stream));
+  RAFT_CUDA_TRY(cudaMemsetAsync(b_norms.data(), 0, sizeof(value_t) * n, stream));
+
+  for (uint64_t w0 = 0; w0 < total_words; w0 += block_words) {
+    const uint32_t words = std::min<uint64_t>(block_words, total_words - w0);
+    const int64_t col0   = int64_t(w0) * 32;
+    pack_bitsets(config.a_indptr,
+                 config.a_indices,
+                 config.a_data,
+                 config.a_nrows,
+                 col0,
+                 words,
+                 a_bits.data(),
+                 a_norms.data(),
+                 stream);
+    pack_bitsets(config.b_indptr,
+                 config.b_indices,
+                 config.b_data,
+                 config.b_nrows,
+                 col0,
+                 words,
+                 b_bits.data(),
+                 b_norms.data(),
+                 stream);
+    if (m > 0 && n > 0) {
+      count_matches(a_bits.data(), b_bits.data(), m, n, words, out, popc_and_op{}, stream);
+    }
+  }
+  expand_binary_distances(handle, out, a_norms.data(), b_norms.data(), m, n, metric, dim);
+}
+
+template <typename value_idx, typename value_t>
+void minhash_pairwise_distance(value_t* out,
+                               const distances_config_t<value_idx, value_t>& config,
+                               raft::distance::DistanceType metric,
+                               const binary_distance_params& params)
+{
+  RAFT_EXPECTS(params.n_hashes > 0, "binary_pairwise_distance: n_hashes must be positive");
+  auto& handle      = config.handle;
+  auto stream       = resource::get_cuda_stream(handle);
+  auto mr           = resource::get_workspace_resource(handle);
+  const int64_t m   = config.a_nrows;
+  const int64_t n   = config.b_nrows;
+  const uint32_t k  = params.n_hashes;
+  const uint64_t sd = params.seed;
+
+  rmm::device_uvector<uint32_t> a_sig(m * k, stream, mr);
+  rmm::device_uvector<uint32_t> b_sig(n * k, stream, mr);
+  rmm::device_uvector<value_t> a_norms(m, stream, mr);
+  rmm::device_uvector<value_t> b_norms(n, stream, mr);
+  RAFT_CUDA_TRY(cudaMemsetAsync(out, 0, sizeof(value_t) * m * n, stream));
+
+  constexpr int kThreads = 256;
+  if (m > 0) {
+    minhash_signatures_kernel<<<raft::ceildiv<int64_t>(m * WarpSize, kThreads),
+                                kThreads,
+                                0,
+                                stream>>>(config.a_indptr,
+                                          config.a_indices,
+                                          config.a_data,
+                                          config.a_nrows,
+                                          k,
+                                          sd,
+                                          a_sig.data(),
+                                          a_norms.data());
+  }
+  if (n > 0) {
+    minhash_signatures_kernel<<<raft::ceildiv<int64_t>(n * WarpSize, kThreads),
+                                kThreads,
+                                0,
+                                stream>>>(config.b_indptr,
+                                          config.b_indices,
+                                          config.b_data,
+                                          config.b_nrows,
+                                          k,
+                                          sd,
+                                          b_sig.data(),
+                                          b_norms.data());
+  }
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  if (m == 0 || n == 0) { return; }
+  count_matches(a_sig.data(), b_sig.data(), m, n, k, out, equal_words_op{}, stream);
+
+  // the estimated intersections: J (|a| + |b|) / (1 + J), with J the fraction of equal signatures
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<value_t, int64_t>(out, m * n),
+    [out, a_norms = a_norms.data(), b_norms = b_norms.data(), n, inv_k = value_t(1) / value_t(k)]
+    __device__(int64_t i) {
+      const value_t jacc = out[i] * inv_k;
+      return jacc * (a_norms[i / n] + b_norms[i % n]) / (1 + jacc);
+    });
+  expand_binary_distances(
+    handle, out, a_norms.data(), b_norms.data(), m, n, metric, int64_t(config.a_ncols));
+}
+
+}  // namespace raft::sparse::distance::detail
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "base_strategy.cuh"
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/sparse/convert/csr.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/copy.h>
+#include <thrust/functional.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
+#include <thrust/tuple.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace raft {
+namespace sparse {
+namespace distance {
+namespace detail {
+
+/** The index of the last element of the sorted array `arr` [size] which is <= `v`. */
+template <typename T, typename V>
+__device__ inline int64_t merge_path_search(const T* arr, int64_t size, V v)
+{
+  int64_t lo = 0, hi = size;
+  while (lo < hi) {
+    auto mid = (lo + hi) / 2;
+    if (static_cast<V>(arr[mid]) <= v) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo - 1;
+}
+
+/**
+ * Expands and accumulates the products A_ik * B_jk of the nonzeros of A and of the columns of B
+ * (in CSC layout). The products are numbered by the A nonzero they belong to
+ * (`work_offsets`), and every thread takes the same number of consecutive products, whatever
+ * the lengths of the rows involved: its first A nonzero and row are found by a binary search in
+ * `work_offsets` and `a_indptr` (the merge path), after which it walks both arrays. The partial
+ * dot products are accumulated into the output with the atomic `write_func`.
+ */
+template <typename value_idx, typename value_t, typename product_f, typename write_f>
+RAFT_KERNEL merge_path_spgemm_kernel(const value_idx* a_indptr,
+                                     const value_idx* a_indices,
+                                     const value_t* a_data,
+                                     value_idx a_nrows,
+                                     value_idx a_nnz,
+                                     const value_idx* csc_indptr,
+                                     const value_idx* csc_rows,
+                                     const value_t* csc_data,
+                                     const uint64_t* work_offsets,
+                                     uint64_t total_work,
+                                     value_idx n,
+                                     int items_per_thread,
+                                     value_t* out,
+                                     product_f product_func,
+                                     write_f write_func)
+{
+  uint64_t begin = (uint64_t(blockIdx.x) * blockDim.x + threadIdx.x) * items_per_thread;
+  if (begin >= total_work) return;
+  uint64_t end = min(begin + items_per_thread, total_work);
+
+  int64_t e   = merge_path_search(work_offsets, int64_t(a_nnz) + 1, begin);
+  int64_t row = merge_path_search(a_indptr, int64_t(a_nrows) + 1, e);
+
+  for (uint64_t p = begin; p < end;) {
+    // skip the nonzeros of A whose columns are empty in B, and the rows they complete
+    while (work_offsets[e + 1] <= p) {
+      e++;
+    }
+    while (a_indptr[row + 1] <= e) {
+      row++;
+    }
+
+    value_t a_val  = a_data[e];
+    uint64_t stop  = min(end, work_offsets[e + 1]);
+    value_idx k    = csc_indptr[a_indices[e]] + value_idx(p - work_offsets[e]);
+    value_t* out_a = out + size_t(row) * n;
+    for (; p < stop; p++, k++) {
+      write_func(out_a + csc_rows[k], product_func(a_val, csc_data[k]));
+    }
+  }
+}
+
+/**
+ * Load-balanced strategy which expands the products of the intersection of the rows of A and B
+ * (a Gustavson SpGEMM of A and the transpose of B) instead of loading every row of A into
+ * shared memory and streaming all of B through it. The products are partitioned evenly over
+ * the threads (merge path), so that the few very long rows of power-law data (e.g. TF-IDF)
+ * do not stall whole blocks, and the work is proportional to the number of nonzero products
+ * rather than to `a_nrows * b_nnz`.
+ *
+ * Only the products of the nonzeros present in both A and B are computed: this strategy
+ * requires an annihilating semiring (`product(x, 0) = product(0, x) = 0`), such as the inner
+ * product, and does not support `dispatch_rev`.
+ */
+template <typename value_idx, typename value_t, int tpb>
+class merge_path_strategy : public coo_spmv_strategy<value_idx, value_t, tpb> {
+ public:
+  merge_path_strategy(const distances_config_t<value_idx, value_t>& config_,
+                      int items_per_thread_ = 16)
+    : coo_spmv_strategy<value_idx, value_t, tpb>(config_), items_per_thread(items_per_thread_)
+  {
+  }
+
+  /**
+   * Whether the row lengths of A or B are skewed enough for the merge path strategy to pay off:
+   * the longest row is more than `skew_ratio` times longer than the average row.
+   */
+  static bool is_preferred(const distances_config_t<value_idx, value_t>& config,
+                           double skew_ratio = 32.0)
+  {
+    return row_lengths_skewed(config.handle, config.a_indptr, config.a_nrows, skew_ratio) ||
+           row_lengths_skewed(config.handle, config.b_indptr, config.b_nrows, skew_ratio);
+  }
+
+  template <typename product_f, typename accum_f, typename write_f>
+  void dispatch(value_t* out_dists,
+                value_idx* coo_rows_b,
+                product_f product_func,
+                accum_f accum_func,
+                write_f write_func,
+                int chunk_size)
+  {
+    auto stream = resource::get_cuda_stream(this->config.handle);
+    auto policy = resource::get_thrust_policy(this->config.handle);
+
+    auto a_nnz   = this->config.a_nnz;
+    auto b_nnz   = this->config.b_nnz;
+    auto b_ncols = this->config.b_ncols;
+    if (a_nnz == 0 || b_nnz == 0) { return; }
+
+    // 1. B in CSC layout
+    rmm::device_uvector<value_idx> csc_cols(b_nnz, stream);
+    rmm::device_uvector<value_idx> csc_rows(b_nnz, stream);
+    rmm::device_uvector<value_t> csc_data(b_nnz, stream);
+    rmm::device_uvector<value_idx> csc_indptr(b_ncols + 1, stream);
+    raft::copy(csc_cols.data(), this->config.b_indices, b_nnz, stream);
+    raft::copy(csc_rows.data(), coo_rows_b, b_nnz, stream);
+    raft::copy(csc_data.data(), this->config.b_data, b_nnz, stream);
+    thrust::stable_sort_by_key(
+      policy,
+      csc_cols.begin(),
+      csc_cols.end(),
+      thrust::make_zip_iterator(thrust::make_tuple(csc_rows.begin(), csc_data.begin())));
+    raft::sparse::convert::sorted_coo_to_csr(
+      csc_cols.data(), b_nnz, csc_indptr.data(), b_ncols + 1, stream);
+
+    // 2. the number of products of every nonzero of A, and their offsets
+    rmm::device_uvector<uint64_t> work_offsets(a_nnz + 1, stream);
+    work_offsets.set_element_to_zero_async(0, stream);
+    auto col_ptr = csc_indptr.data();
+    thrust::transform(policy,
+                      this->config.a_indices,
+                      this->config.a_indices + a_nnz,
+                      work_offsets.begin() + 1,
+                      [col_ptr] __device__(value_idx col) {
+                        return static_cast<uint64_t>(col_ptr[col + 1] - col_ptr[col]);
+                      });
+    thrust::inclusive_scan(
+      policy, work_offsets.begin() + 1, work_offsets.end(), work_offsets.begin() + 1);
+    uint64_t total_work = work_offsets.element(a_nnz, stream);
+    if (total_work == 0) { return; }
+
+    // 3. the products, evenly partitioned over the threads
+    uint64_t n_threads = raft::ceildiv<uint64_t>(total_work, items_per_thread);
+    uint64_t n_blocks  = raft::ceildiv<uint64_t>(n_threads, tpb);
+    merge_path_spgemm_kernel<<<n_blocks, tpb, 0, stream>>>(this->config.a_indptr,
+                                                          this->config.a_indices,
+                                                          this->config.a_data,
+                                                          this->config.a_nrows,
+                                                          a_nnz,
+                                                          csc_indptr.data(),
+                                                          csc_rows.data(),
+                                                          csc_data.data(),
+                                                          work_offsets.data(),
+                                                          total_work,
+                                                          this->config.b_nrows,
+                                                          items_per_thread,
+                                                          out_dists,
+                                                          product_func,
+                                                          write_func);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+
+  template <typename product_f, typename accum_f, typename write_f>
+  void dispatch_rev(value_t* out_dists,
+                    value_idx* coo_rows_a,
+                    product_f product_func,
+                    accum_f accum_func,
+                    write_f write_func,
+                    int chunk_size)
+  {
+    RAFT_FAIL("merge_path_strategy supports only annihilating semirings (no dispatch_rev)");
+  }
+
+  /** Whether the longest row is more than `skew_ratio` times longer than the average row. */
+  static bool row_lengths_skewed(raft::resources const& handle,
+                                 const value_idx* indptr,
+                                 value_idx n_rows,
+                                 double skew_ratio)
+  {
+    if (n_rows == 0) { return false; }
+    auto degrees = thrust::make_transform_iterator(
+      thrust::make_counting_iterator<value_idx>(0),
+      [indptr] __device__(value_idx i) { return indptr[i + 1] - indptr[i]; });
+    value_idx max_degree = thrust::reduce(resource::get_thrust_policy(handle),
+                                          degrees,
+                                          degrees + n_rows,
+                                          value_idx(0),
+                                          thrust::maximum<value_idx>());
+    value_idx nnz = 0;
+    raft::update_host(&nnz, indptr + n_rows, 1, resource::get_cuda_stream(handle));
+    resource::sync_stream(handle);
+    double mean_degree = std::max(double(nnz) / double(n_rows), 1.0);
+    return double(max_degree) > skew_ratio * mean_degree;
+  }
+
+ private:
+  int items_per_thread;
+};
+
+}  // namespace detail
+}  // namespace distance
+}  // namespace sparse
+}  // namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -63,14 +63,28 @@ class ip_distances_t : public distances_t<value_t> {
   void compute(value_t* out_distances)
   {
     /**
-     * Compute pairwise distances and return dense matrix in row-major format
+     * Compute pairwise distances and return dense matrix in row-major format. The inner product
+     * is an annihilating semiring, so the load-balanced merge path strategy can be used when
+     * the rows are skewed (e.g. power-law document lengths).
      */
-    balanced_coo_pairwise_generalized_spmv<value_idx, value_t>(out_distances,
-                                                               *config_,
-                                                               coo_rows_b.data(),
-                                                               raft::mul_op(),
-                                                               raft::add_op(),
-                                                               raft::atomic_add_op());
+    using merge_path_t = merge_path_strategy<value_idx, value_t, 1024>;
+    if (merge_path_t::is_preferred(*config_)) {
+      merge_path_t strategy(*config_);
+      balanced_coo_pairwise_generalized_spmv<value_idx, value_t>(out_distances,
+                                                                 *config_,
+                                                                 coo_rows_b.data(),
+                                                                 raft::mul_op(),
+                                                                 raft::add_op(),
+                                                                 raft::atomic_add_op(),
+                                                                 strategy);
+    } else {
+      balanced_coo_pairwise_generalized_spmv<value_idx, value_t>(out_distances,
+                                                                 *config_,
+                                                                 coo_rows_b.data(),
+                                                                 raft::mul_op(),
+                                                                 raft::add_op(),
+                                                                 raft::atomic_add_op());
+    }
   }
 
   value_idx* b_rows_coo() { return coo_rows_b.data(); }
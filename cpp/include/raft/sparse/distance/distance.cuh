@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -26,7 +26,9 @@
 
 #include <raft/distance/distance_types.hpp>
 
+#include <raft/sparse/distance/binary_distance_types.hpp>
 #include <raft/sparse/distance/detail/bin_distance.cuh>
+#include <raft/sparse/distance/detail/bitset_distance.cuh>
 #include <raft/sparse/distance/detail/ip_distance.cuh>
 #include <raft/sparse/distance/detail/l2_distance.cuh>
 #include <raft/sparse/distance/detail/lp_distance.cuh>
@@ -132,6 +134,48 @@ void pairwiseDistance(value_t* out,
   }
 }
 
+namespace detail {
+
+/** The configuration of the distances between the rows of x and y, into dist. */
+template <typename DeviceCSRMatrix, typename ElementType, typename IndexType>
+auto make_distances_config(raft::resources const& handle,
+                           DeviceCSRMatrix x,
+                           DeviceCSRMatrix y,
+                           raft::device_matrix_view<ElementType, IndexType, raft::row_major> dist)
+  -> distances_config_t<IndexType, ElementType>
+{
+  auto x_structure = x.structure_view();
+  auto y_structure = y.structure_view();
+
+  RAFT_EXPECTS(x_structure.get_n_cols() == y_structure.get_n_cols(),
+               "Number of columns must be equal");
+
+  RAFT_EXPECTS(dist.extent(0) == x_structure.get_n_rows(),
+               "Number of rows in output must be equal to "
+               "number of rows in X");
+  RAFT_EXPECTS(dist.extent(1) == y_structure.get_n_rows(),
+               "Number of columns in output must be equal to "
+               "number of rows in Y");
+
+  distances_config_t<IndexType, ElementType> input_config(handle);
+  input_config.a_nrows   = x_structure.get_n_rows();
+  input_config.a_ncols   = x_structure.get_n_cols();
+  input_config.a_nnz     = x_structure.get_nnz();
+  input_config.a_indptr  = const_cast<IndexType*>(x_structure.get_indptr().data());
+  input_config.a_indices = const_cast<IndexType*>(x_structure.get_indices().data());
+  input_config.a_data    = const_cast<ElementType*>(x.get_elements().data());
+
+  input_config.b_nrows   = y_structure.get_n_rows();
+  input_config.b_ncols   = y_structure.get_n_cols();
+  input_config.b_nnz     = y_structure.get_nnz();
+  input_config.b_indptr  = const_cast<IndexType*>(y_structure.get_indptr().data());
+  input_config.b_indices = const_cast<IndexType*>(y_structure.get_indices().data());
+  input_config.b_data    = const_cast<ElementType*>(y.get_elements().data());
+  return input_config;
+}
+
+}  // namespace detail
+
 /**
  * @defgroup sparse_distance Sparse Pairwise Distance
  * @{
@@ -185,35 +229,72 @@ void pairwise_distance(raft::resources const& handle,
                        raft::distance::DistanceType metric,
                        float metric_arg = 2.0f)
 {
-  auto x_structure = x.structure_view();
-  auto y_structure = y.structure_view();
-
-  RAFT_EXPECTS(x_structure.get_n_cols() == y_structure.get_n_cols(),
-               "Number of columns must be equal");
-
-  RAFT_EXPECTS(dist.extent(0) == x_structure.get_n_rows(),
-               "Number of rows in output must be equal to "
-               "number of rows in X");
-  RAFT_EXPECTS(dist.extent(1) == y_structure.get_n_rows(),
-               "Number of columns in output must be equal to "
-               "number of rows in Y");
-
-  detail::distances_config_t<IndexType, ElementType> input_config(handle);
-  input_config.a_nrows   = x_structure.get_n_rows();
-  input_config.a_ncols   = x_structure.get_n_cols();
-  input_config.a_nnz     = x_structure.get_nnz();
-  input_config.a_indptr  = const_cast<IndexType*>(x_structure.get_indptr().data());
-  input_config.a_indices = const_cast<IndexType*>(x_structure.get_indices().data());
-  input_config.a_data    = const_cast<ElementType*>(x.get_elements().data());
+  auto input_config = detail::make_distances_config(handle, x, y, dist);
+  pairwiseDistance(dist.data_handle(), input_config, metric, metric_arg);
+}
 
-  input_config.b_nrows   = y_structure.get_n_rows();
-  input_config.b_ncols   = y_structure.get_n_cols();
-  input_config.b_nnz     = y_structure.get_nnz();
-  input_config.b_indptr  = const_cast<IndexType*>(y_structure.get_indptr().data());
-  input_config.b_indices = const_cast<IndexType*>(y_structure.get_indices().data());
-  input_config.b_data    = const_cast<ElementType*>(y.get_elements().data());
+/**
+ * @brief Compute the pairwise Jaccard, Dice or Hamming distances between the binary rows of x
+ * and y, treating every non-zero element as a one.
+ *
+ * With `binary_distance_algo::BITSET` the rows are packed into bitsets by blocks of columns and
+ * the intersections are counted with popcounts, which is much faster than the general SpMV of
+ * `pairwise_distance` on the rows of a moderate sparsity (e.g. the user-item presence sets);
+ * AUTO picks it when the rows are dense enough. `binary_distance_algo::MINHASH` estimates the
+ * Jaccard similarities from `params.n_hashes` MinHash signatures of every row instead, at a cost
+ * independent of the number of columns.
+ *
+ * @code{.cpp}
+ * raft::sparse::distance::binary_distance_params params;
+ * params.algo     = raft::sparse::distance::binary_distance_algo::MINHASH;
+ * params.n_hashes = 256;
+ * raft::sparse::distance::binary_pairwise_distance(
+ *   handle, x.view(), y.view(), out, raft::distance::DistanceType::JaccardExpanded, params);
+ * @endcode
+ *
+ * @tparam DeviceCSRMatrix raft::device_csr_matrix or raft::device_csr_matrix_view
+ * @tparam ElementType data-type of inputs and output
+ * @tparam IndexType data-type for indexing
+ *
+ * @param[in] handle raft::resources
+ * @param[in] x raft::device_csr_matrix_view
+ * @param[in] y raft::device_csr_matrix_view
+ * @param[out] dist raft::device_matrix_view dense matrix
+ * @param[in] metric JaccardExpanded, DiceExpanded or HammingUnexpanded
+ * @param[in] params the algorithm computing the intersections of the rows
+ */
+template <typename DeviceCSRMatrix,
+          typename ElementType,
+          typename IndexType,
+          typename = std::enable_if_t<raft::is_device_csr_matrix_view_v<DeviceCSRMatrix>>>
+void binary_pairwise_distance(
+  raft::resources const& handle,
+  DeviceCSRMatrix x,
+  DeviceCSRMatrix y,
+  raft::device_matrix_view<ElementType, IndexType, raft::row_major> dist,
+  raft::distance::DistanceType metric,
+  const binary_distance_params& params = {})
+{
+  RAFT_EXPECTS(metric == raft::distance::DistanceType::JaccardExpanded ||
+                 metric == raft::distance::DistanceType::DiceExpanded ||
+                 metric == raft::distance::DistanceType::HammingUnexpanded,
+               "Only the Jaccard, Dice and Hamming distances have a binary implementation");
+  auto input_config = detail::make_distances_config(handle, x, y, dist);
 
-  pairwiseDistance(dist.data_handle(), input_config, metric, metric_arg);
+  auto algo = params.algo;
+  if (algo == binary_distance_algo::AUTO) {
+    algo = detail::use_bitsets(input_config) ? binary_distance_algo::BITSET
+                                             : binary_distance_algo::SPMV;
+  }
+  switch (algo) {
+    case binary_distance_algo::BITSET:
+      detail::bitset_pairwise_distance(dist.data_handle(), input_config, metric);
+      break;
+    case binary_distance_algo::MINHASH:
+      detail::minhash_pairwise_distance(dist.data_handle(), input_config, metric, params);
+      break;
+    default: pairwiseDistance(dist.data_handle(), input_config, metric, 2.0f);
+  }
 }
 
 /** @} */  // end of sparse_distance
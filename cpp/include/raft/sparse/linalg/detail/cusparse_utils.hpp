@@ -81,6 +81,18 @@ cusparseSpMatDescr_t create_descriptor(
   return descr;
 }
 
+/**
+ * @brief distance between consecutive matrices of a strided batch of dense matrices, i.e. the
+ * size of one (possibly padded) matrix of the batch
+ */
+template <typename ValueType, typename IndexType, typename LayoutPolicy>
+int64_t batch_stride(raft::device_matrix_view<ValueType, IndexType, LayoutPolicy> dense_view)
+{
+  return raft::is_row_major(dense_view)
+           ? static_cast<int64_t>(dense_view.extent(0)) * dense_view.stride(0)
+           : static_cast<int64_t>(dense_view.extent(1)) * dense_view.stride(1);
+}
+
 /**
  * @brief convert the operation to cusparseOperation_t type
  * @param param[in] op type of operation
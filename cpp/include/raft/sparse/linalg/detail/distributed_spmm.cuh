@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/neighbors/detail/comms_utils.cuh>
+#include <raft/sparse/linalg/distributed_csr_matrix.hpp>
+#include <raft/sparse/linalg/spmm.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/binary_search.h>
+#include <thrust/copy.h>
+#include <thrust/execution_policy.h>
+#include <thrust/sort.h>
+#include <thrust/unique.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace raft::sparse::linalg::detail {
+
+/**
+ * The plan of the halo exchange of the rows A [n_local, n] of this rank (with a communicator; all
+ * the ranks call it), or the whole square matrix A (without).
+ */
+template <typename T>
+auto make_distributed_csr_matrix(raft::resources const& handle,
+                                 const raft::comms::comms_t* comms,
+                                 raft::device_csr_matrix_view<const T, int, int, int> A)
+  -> distributed_csr_matrix<T>
+{
+  auto stream     = resource::get_cuda_stream(handle);
+  auto structure  = A.structure_view();
+  int n_local     = structure.get_n_rows();
+  int n           = structure.get_n_cols();
+  int nnz         = structure.get_nnz();
+  const int* ptr  = structure.get_indptr().data();
+  const int* cols = structure.get_indices().data();
+  const T* values = A.get_elements().data();
+  std::vector<size_t> counts(1, size_t(n_local));
+  std::vector<size_t> offsets(1, 0);
+  if (comms == nullptr) {
+    RAFT_EXPECTS(n_local == n, "distributed_csr_matrix: the matrix must be square");
+    return distributed_csr_matrix<T>(nullptr,
+                                     n,
+                                     0,
+                                     n_local,
+                                     0,
+                                     ptr,
+                                     values,
+                                     nnz,
+                                     cols,
+                                     rmm::device_uvector<int>(0, stream),
+                                     std::move(counts),
+                                     std::move(offsets),
+                                     rmm::device_uvector<int>(0, stream),
+                                     std::vector<size_t>(1, 0),
+                                     std::vector<size_t>(1, 0));
+  }
+
+  // the rows of every rank
+  int n_ranks = comms->get_size();
+  int rank    = comms->get_rank();
+  rmm::device_scalar<size_t> d_local(size_t(n_local), stream);
+  rmm::device_uvector<size_t> d_counts(n_ranks, stream);
+  comms->allgather(d_local.data(), d_counts.data(), 1, stream);
+  RAFT_EXPECTS(comms->sync_stream(stream) == raft::comms::status_t::SUCCESS,
+               "distributed_csr_matrix: the allgather of the row counts failed");
+  counts.resize(n_ranks);
+  offsets.resize(n_ranks);
+  raft::update_host(counts.data(), d_counts.data(), n_ranks, stream);
+  resource::sync_stream(handle, stream);
+  std::exclusive_scan(counts.begin(), counts.end(), offsets.begin(), size_t(0));
+  RAFT_EXPECTS(offsets.back() + counts.back() == size_t(n),
+               "distributed_csr_matrix: the row blocks of the ranks must cover the columns");
+  int lo = offsets[rank];
+  int hi = lo + n_local;
+
+  // the halo: the distinct columns of the local rows owned by the other ranks, sorted (and thus
+  // grouped by owner)
+  auto policy = resource::get_thrust_policy(handle);
+  rmm::device_uvector<int> halo(nnz, stream);
+  auto halo_end =
+    thrust::copy_if(policy, cols, cols + nnz, halo.begin(), [lo, hi] __device__(int c) {
+      return c < lo || c >= hi;
+    });
+  thrust::sort(policy, halo.begin(), halo_end);
+  halo_end   = thrust::unique(policy, halo.begin(), halo_end);
+  int n_halo = halo_end - halo.begin();
+  halo.resize(n_halo, stream);
+
+  std::vector<int> h_halo(n_halo);
+  raft::update_host(h_halo.data(), halo.data(), n_halo, stream);
+  resource::sync_stream(handle, stream);
+  std::vector<size_t> recv_counts(n_ranks);
+  for (int r = 0; r < n_ranks; r++) {
+    auto first     = std::lower_bound(h_halo.begin(), h_halo.end(), int(offsets[r]));
+    auto last      = std::lower_bound(first, h_halo.end(), int(offsets[r] + counts[r]));
+    recv_counts[r] = last - first;
+  }
+
+  // every rank asks the owners for its halo rows, and learns the rows it sends to the others
+  auto send_counts = raft::neighbors::detail::exchange_counts(*comms, recv_counts, stream);
+  size_t n_send    = std::accumulate(send_counts.begin(), send_counts.end(), size_t(0));
+  rmm::device_uvector<int> send_rows(n_send, stream);
+  raft::neighbors::detail::all_to_all(
+    *comms, halo.data(), recv_counts, send_rows.data(), send_counts, 1, stream);
+  RAFT_EXPECTS(comms->sync_stream(stream) == raft::comms::status_t::SUCCESS,
+               "distributed_csr_matrix: the exchange of the halo rows failed");
+  auto send_view = raft::make_device_vector_view<int, int64_t>(send_rows.data(), n_send);
+  raft::linalg::map(handle,
+                    raft::make_const_mdspan(send_view),
+                    send_view,
+                    [lo] __device__(int c) { return c - lo; });
+
+  // the columns of the extended operand: the local rows, then the halo rows
+  rmm::device_uvector<int> remapped(nnz, stream);
+  raft::linalg::map(
+    handle,
+    raft::make_device_vector_view<const int, int64_t>(cols, nnz),
+    raft::make_device_vector_view<int, int64_t>(remapped.data(), nnz),
+    [lo, hi, n_local, halo = halo.data(), n_halo] __device__(int c) {
+      if (c >= lo && c < hi) { return c - lo; }
+      return n_local + int(thrust::lower_bound(thrust::seq, halo, halo + n_halo, c) - halo);
+    });
+  // `halo` is released on the stream after the remapping
+  return distributed_csr_matrix<T>(comms,
+                                   n,
+                                   lo,
+                                   n_local,
+                                   n_halo,
+                                   ptr,
+                                   values,
+                                   nnz,
+                                   cols,
+                                   std::move(remapped),
+                                   std::move(counts),
+                                   std::move(offsets),
+                                   std::move(send_rows),
+                                   std::move(send_counts),
+                                   std::move(recv_counts));
+}
+
+/**
+ * x_ext [n_local + n_halo, b] = the rows x [n_local, b] of this rank followed by its halo rows
+ * received from the other ranks (all column-major; all the ranks call it).
+ */
+template <typename T>
+void halo_exchange(raft::resources const& handle,
+                   const distributed_csr_matrix<T>& A,
+                   const T* x,
+                   int b,
+                   T* x_ext)
+{
+  RAFT_EXPECTS(A.comms() != nullptr, "halo_exchange: the matrix has no communicator");
+  auto stream   = resource::get_cuda_stream(handle);
+  auto mr       = resource::get_workspace_resource(handle);
+  size_t n_loc  = A.n_local_rows();
+  size_t n_ext  = n_loc + A.n_halo_rows();
+  auto rows     = A.send_rows();
+  size_t n_send = rows.extent(0);
+
+  // the rows sent to the other ranks and the halo rows, row-major so that the segment of every
+  // rank is contiguous
+  rmm::device_uvector<T> send(n_send * b, stream, mr);
+  rmm::device_uvector<T> recv(size_t(A.n_halo_rows()) * b, stream, mr);
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(send.data(), send.size()),
+    [x, rows = rows.data_handle(), b, n_loc] __device__(int64_t i) {
+      return x[size_t(i % b) * n_loc + rows[i / b]];
+    });
+  raft::neighbors::detail::all_to_all(
+    *A.comms(), send.data(), A.send_counts(), recv.data(), A.recv_counts(), b, stream);
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(x_ext, n_ext * b),
+    [x, recv = recv.data(), b, n_loc, n_ext] __device__(int64_t i) {
+      size_t r = i % n_ext;
+      size_t c = i / n_ext;
+      return r < n_loc ? x[c * n_loc + r] : recv[(r - n_loc) * b + c];
+    });
+}
+
+/** y [n_local, b] = alpha A x + beta y, where x [n_local, b] are the rows of this rank. */
+template <typename T>
+void distributed_spmm(raft::resources const& handle,
+                      const distributed_csr_matrix<T>& A,
+                      const T* alpha,
+                      const T* x,
+                      int b,
+                      const T* beta,
+                      T* y)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  int n_local = A.n_local_rows();
+  int n_ext   = n_local + A.n_halo_rows();
+  rmm::device_uvector<T> x_ext(0, stream, resource::get_workspace_resource(handle));
+  if (A.comms() != nullptr) {
+    x_ext.resize(size_t(n_ext) * b, stream);
+    halo_exchange(handle, A, x, b, x_ext.data());
+    x = x_ext.data();
+  }
+  raft::sparse::linalg::spmm(
+    handle,
+    false,
+    false,
+    alpha,
+    A.local_matrix(),
+    raft::make_device_matrix_view<const T, int, raft::col_major>(x, n_ext, b),
+    beta,
+    raft::make_device_matrix_view<T, int, raft::col_major>(y, n_local, b));
+}
+
+}  // namespace raft::sparse::linalg::detail
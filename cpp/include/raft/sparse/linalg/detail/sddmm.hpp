@@ -23,6 +23,7 @@
 #include <raft/core/resources.hpp>
 #include <raft/linalg/linalg_types.hpp>
 #include <raft/sparse/detail/cusparse_wrappers.h>
+#include <raft/util/cuda_dev_essentials.cuh>
 
 namespace raft {
 namespace sparse {
@@ -35,7 +36,8 @@ namespace detail {
  * It computes the following equation: C = alpha · (op_a(A) * op_b(B) ∘ spy(C)) + beta · C
  * where A,B are device matrix views and C is a CSR device matrix view
  *
- * @tparam ValueType Data type of input/output matrices (float/double)
+ * @tparam ValueType Data type of the scalars and of the computation (float/double); the
+ *         matrices may be half/bf16 when it is float (set by their descriptors)
  * @tparam IndexType Type of C
  * @tparam LayoutPolicyA layout of A
  * @tparam LayoutPolicyB layout of B
@@ -76,9 +78,9 @@ void sddmm(raft::resources const& handle,
                                                    &bufferSize,
                                                    resource::get_cuda_stream(handle)));
 
-  resource::sync_stream(handle);
-
-  rmm::device_uvector<ValueType> tmp(bufferSize, resource::get_cuda_stream(handle));
+  // the buffer size is in bytes; no synchronization is needed before the stream-ordered allocation
+  rmm::device_uvector<ValueType> tmp(raft::ceildiv(bufferSize, sizeof(ValueType)),
+                                     resource::get_cuda_stream(handle));
 
   RAFT_CUSPARSE_TRY(raft::sparse::detail::cusparsesddmm(resource::get_cusparse_handle(handle),
                                                         op_a,
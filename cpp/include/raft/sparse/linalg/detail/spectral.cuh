@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -23,8 +23,16 @@
 #include <raft/util/cuda_utils.cuh>
 #include <rmm/device_uvector.hpp>
 
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/math.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/linalg/norm_types.hpp>
 #include <raft/sparse/convert/csr.cuh>
 #include <raft/sparse/coo.hpp>
+#include <raft/sparse/linalg/norm.cuh>
+#include <raft/sparse/linalg/spectral_types.hpp>
+#include <raft/sparse/solver/detail/block_lanczos.cuh>
+#include <raft/sparse/solver/lanczos_types.hpp>
 
 namespace raft {
 namespace sparse {
@@ -112,6 +120,83 @@ void fit_embedding(raft::resources const& handle,
   RAFT_CUDA_TRY(cudaGetLastError());
 }
 
+/**
+ * The embedding [n, n_components] = D^-1/2 U, U the eigenvectors of the largest eigenvalues of
+ * D^-1/2 A D^-1/2 (the smallest of the normalized Laplacian), optionally without the trivial one.
+ * The warm start [n, n_warm] is a previous embedding, mapped back to the eigenvectors by D^1/2.
+ */
+template <typename T>
+auto fit_embedding(raft::resources const& handle,
+                   embedding_config<T> const& config,
+                   raft::device_csr_matrix_view<const T, int, int, int> graph,
+                   T* embedding,
+                   const T* warm_start,
+                   int n_warm) -> raft::sparse::solver::block_lanczos_result
+{
+  auto stream    = resource::get_cuda_stream(handle);
+  auto structure = graph.structure_view();
+  int n          = structure.get_n_rows();
+  int drop       = config.drop_first ? 1 : 0;
+  int k          = config.n_components + drop;
+
+  // scale = D^-1/2, 0 for the isolated vertices (their embedding is 0)
+  rmm::device_uvector<T> scale(n, stream);
+  raft::sparse::linalg::rowNormCsr(handle,
+                                   structure.get_indptr().data(),
+                                   graph.get_elements().data(),
+                                   structure.get_nnz(),
+                                   n,
+                                   scale.data(),
+                                   raft::linalg::NormType::L1Norm);
+  auto scale_view = raft::make_device_vector_view<T, int>(scale.data(), n);
+  raft::linalg::map(handle, raft::make_const_mdspan(scale_view), scale_view, [] __device__(T d) {
+    return d > T(0) ? T(1) / raft::sqrt(d) : T(0);
+  });
+
+  // the warm start: the trivial eigenvector D^1/2 1 (dropped from the embedding), then D^1/2 times
+  // the columns of the previous embedding
+  int n_initial = warm_start != nullptr ? n_warm + drop : 0;
+  rmm::device_uvector<T> initial(size_t(n) * n_initial, stream);
+  if (n_initial > 0) {
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<T, int64_t>(initial.data(), initial.size()),
+      [warm_start, s = scale.data(), n, drop] __device__(int64_t i) {
+        int64_t r   = i % n;
+        int64_t c   = i / n;
+        T sqrt_d    = s[r] > T(0) ? T(1) / s[r] : T(0);
+        T component = c < drop ? T(1) : warm_start[(c - drop) * n + r];
+        return sqrt_d * component;
+      });
+  }
+
+  raft::sparse::solver::block_lanczos_config<T> cfg{k};
+  cfg.block_size   = config.block_size > 0 ? config.block_size : k;
+  cfg.max_restarts = config.max_restarts;
+  cfg.tolerance    = config.tolerance;
+  cfg.which        = raft::sparse::solver::lanczos_which::LARGEST;
+  cfg.seed         = config.seed;
+  rmm::device_uvector<T> eigenvalues(k, stream);
+  rmm::device_uvector<T> eigenvectors(size_t(n) * k, stream);
+  auto result = raft::sparse::solver::detail::block_lanczos(handle,
+                                                            nullptr,
+                                                            cfg,
+                                                            graph,
+                                                            eigenvalues.data(),
+                                                            eigenvectors.data(),
+                                                            scale.data(),
+                                                            initial.data(),
+                                                            n_initial);
+
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(embedding, int64_t(n) * config.n_components),
+    [u = eigenvectors.data(), s = scale.data(), n, drop] __device__(int64_t i) {
+      return s[i % n] * u[i + int64_t(drop) * n];
+    });
+  return result;
+}
+
 };  // namespace detail
 };  // namespace spectral
 };  // namespace sparse
@@ -22,6 +22,7 @@
 #include <raft/core/resource/cusparse_handle.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/sparse/detail/cusparse_wrappers.h>
+#include <raft/util/cuda_dev_essentials.cuh>
 
 namespace raft {
 namespace sparse {
@@ -53,11 +54,8 @@ bool is_row_major(raft::device_matrix_view<const ValueType, IndexType, LayoutPol
  * combinations of operand layouts for cuSparse.
  * It computes the following equation: Z = alpha . X * Y + beta . Z
  * where X is a CSR device matrix view and Y,Z are device matrix views
- * @tparam ValueType Data type of input/output matrices (float/double)
- * @tparam IndexType Type of Y and Z
- * @tparam NZType Type of X
- * @tparam LayoutPolicyY layout of Y
- * @tparam LayoutPolicyZ layout of Z
+ * @tparam ValueType Data type of the scalars and of the computation (float/double); the
+ *         matrices may be half/bf16 when it is float (set by their descriptors)
  * @param[in] handle raft handle
  * @param[in] trans_x transpose operation for X
  * @param[in] trans_y transpose operation for Y
@@ -96,9 +94,9 @@ void spmm(raft::resources const& handle,
                                                   &bufferSize,
                                                   resource::get_cuda_stream(handle)));
 
-  raft::interruptible::synchronize(resource::get_cuda_stream(handle));
-
-  rmm::device_uvector<ValueType> tmp(bufferSize, resource::get_cuda_stream(handle));
+  // the buffer size is in bytes; no synchronization is needed before the stream-ordered allocation
+  rmm::device_uvector<ValueType> tmp(raft::ceildiv(bufferSize, sizeof(ValueType)),
+                                     resource::get_cuda_stream(handle));
 
   RAFT_CUSPARSE_TRY(raft::sparse::detail::cusparsespmm(resource::get_cusparse_handle(handle),
                                                        opX,
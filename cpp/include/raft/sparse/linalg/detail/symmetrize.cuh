@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -27,8 +27,17 @@
 
 #include <raft/sparse/op/sort.cuh>
 #include <raft/util/device_atomics.cuh>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <thrust/binary_search.h>
+#include <thrust/copy.h>
+#include <thrust/count.h>
 #include <thrust/device_ptr.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
 #include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
 
 #include <cuda_runtime.h>
 #include <stdio.h>
@@ -363,6 +372,188 @@ void symmetrize(raft::resources const& handle,
     handle, out, symm_rows.data(), symm_cols.data(), symm_vals.data(), nnz * 2, m, n);
 }
 
+/**
+ * For each edge `(i, j = knn_indices[i, t])` of a kNN graph, the position of `i` in the neighbors
+ * of `j` (i.e. `knn_indices[j, rev_pos[i, t]] == i`), or -1 if the graph does not have the
+ * reverse edge.
+ */
+template <typename value_idx>
+RAFT_KERNEL knn_reverse_pos_kernel(const value_idx* __restrict__ knn_indices,
+                                   size_t n,
+                                   int k,
+                                   int* __restrict__ rev_pos)
+{
+  size_t tid = size_t(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (tid >= n * k) return;
+
+  const value_idx i = tid / k;
+  const value_idx j = knn_indices[tid];
+  int pos           = -1;
+  if (j >= 0 && size_t(j) < n) {
+    const value_idx* nbrs = knn_indices + size_t(j) * k;
+    for (int t = 0; t < k; t++) {
+      if (nbrs[t] == i) {
+        pos = t;
+        break;
+      }
+    }
+  }
+  rev_pos[tid] = pos;
+}
+
+/**
+ * Place the edges of the kNN graph at the beginning of their rows of the symmetric CSR matrix. The
+ * edges present in both directions get the largest of the two distances.
+ */
+template <typename value_idx, typename value_t>
+RAFT_KERNEL knn_place_edges_kernel(const value_idx* __restrict__ knn_indices,
+                                   const value_t* __restrict__ knn_dists,
+                                   const int* __restrict__ rev_pos,
+                                   const value_idx* __restrict__ indptr,
+                                   size_t n,
+                                   int k,
+                                   value_idx* __restrict__ indices,
+                                   value_t* __restrict__ data)
+{
+  size_t tid = size_t(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (tid >= n * k) return;
+
+  const size_t i    = tid / k;
+  const value_idx j = knn_indices[tid];
+  value_t d         = knn_dists[tid];
+  if (rev_pos[tid] >= 0) { d = raft::max(d, knn_dists[size_t(j) * k + rev_pos[tid]]); }
+
+  const size_t pos = size_t(indptr[i]) + tid % k;
+  indices[pos]     = j;
+  data[pos]        = d;
+}
+
+/**
+ * Place the reverse edges (sorted by row) after the kNN edges of their rows: as row `r` starts at
+ * `r * k + (the number of reverse edges of the rows before r)`, the reverse edge `q` goes to
+ * `(r + 1) * k + q`.
+ */
+template <typename value_idx, typename value_t>
+RAFT_KERNEL knn_place_reverse_edges_kernel(const value_idx* __restrict__ rev_rows,
+                                           const value_idx* __restrict__ rev_cols,
+                                           const value_t* __restrict__ rev_vals,
+                                           size_t n_rev,
+                                           int k,
+                                           value_idx* __restrict__ indices,
+                                           value_t* __restrict__ data)
+{
+  size_t q = size_t(blockDim.x) * blockIdx.x + threadIdx.x;
+  if (q >= n_rev) return;
+
+  const size_t pos = (size_t(rev_rows[q]) + 1) * k + q;
+  indices[pos]     = rev_cols[q];
+  data[pos]        = rev_vals[q];
+}
+
+/** Whether an edge of the kNN graph is missing its reverse. */
+struct knn_one_way_op {
+  HDI auto operator()(int rev_pos) const -> bool { return rev_pos < 0; }
+};
+
+/** The source (row) of an edge of the kNN graph. */
+template <typename value_idx>
+struct knn_edge_row_op {
+  int k;
+  HDI auto operator()(size_t edge) const -> value_idx { return edge / k; }
+};
+
+/** The start of a row of the symmetric CSR matrix. */
+template <typename value_idx>
+struct knn_row_start_op {
+  int k;
+  HDI auto operator()(value_idx row, value_idx n_rev_before) const -> value_idx
+  {
+    return row * k + n_rev_before;
+  }
+};
+
+/**
+ * Build the symmetric CSR matrix of a kNN graph directly from the neighbor matrix.
+ *
+ * Unlike `from_knn_symmetrize_matrix` and `symmetrize`, the edges are not doubled, sorted and
+ * reduced. Only the edges whose reverse is not in the kNN graph are copied out and sorted by
+ * their destination. The row offsets follow from a binary search of the sorted rows, and all the
+ * edges are then placed without atomics. Each row holds its kNN edges (in the neighbor order)
+ * followed by its reverse edges (by increasing column), so the output is deterministic.
+ *
+ * @param handle: raft resources
+ * @param knn_indices: Input knn indices (n, k)
+ * @param knn_dists: Input knn distances (n, k)
+ * @param n: Number of rows
+ * @param k: Number of n_neighbors
+ * @param indptr: Output row offsets (resized to n + 1)
+ * @param indices: Output column indices (resized to nnz)
+ * @param data: Output values (resized to nnz)
+ */
+template <typename value_idx, typename value_t>
+void symmetrize_knn_csr(raft::resources const& handle,
+                        const value_idx* knn_indices,
+                        const value_t* knn_dists,
+                        size_t n,
+                        int k,
+                        rmm::device_uvector<value_idx>& indptr,
+                        rmm::device_uvector<value_idx>& indices,
+                        rmm::device_uvector<value_t>& data)
+{
+  auto stream       = resource::get_cuda_stream(handle);
+  auto policy       = resource::get_thrust_policy(handle);
+  const size_t nnz  = n * k;
+  constexpr int tpb = 256;
+
+  // Find the edges without their reverse ...
+  rmm::device_uvector<int> rev_pos(nnz, stream);
+  knn_reverse_pos_kernel<<<raft::ceildiv(nnz, size_t(tpb)), tpb, 0, stream>>>(
+    knn_indices, n, k, rev_pos.data());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  const size_t n_rev =
+    thrust::count_if(policy, rev_pos.data(), rev_pos.data() + nnz, knn_one_way_op{});
+
+  // ... and copy their reverse out, sorted by row (by column within a row, as the copy is ordered
+  // by the source).
+  rmm::device_uvector<value_idx> rev_rows(n_rev, stream);
+  rmm::device_uvector<value_idx> rev_cols(n_rev, stream);
+  rmm::device_uvector<value_t> rev_vals(n_rev, stream);
+  auto edge_rows = thrust::make_transform_iterator(thrust::make_counting_iterator<size_t>(0),
+                                                   knn_edge_row_op<value_idx>{k});
+  auto edges = thrust::make_zip_iterator(thrust::make_tuple(knn_indices, edge_rows, knn_dists));
+  thrust::copy_if(policy,
+                  edges,
+                  edges + nnz,
+                  rev_pos.data(),
+                  thrust::make_zip_iterator(
+                    thrust::make_tuple(rev_rows.data(), rev_cols.data(), rev_vals.data())),
+                  knn_one_way_op{});
+  thrust::stable_sort_by_key(policy,
+                             rev_rows.data(),
+                             rev_rows.data() + n_rev,
+                             thrust::make_zip_iterator(
+                               thrust::make_tuple(rev_cols.data(), rev_vals.data())));
+
+  // Row r holds k kNN edges and the reverse edges in [lower_bound(r), lower_bound(r + 1)).
+  indptr.resize(n + 1, stream);
+  auto rows = thrust::make_counting_iterator<value_idx>(0);
+  thrust::lower_bound(
+    policy, rev_rows.data(), rev_rows.data() + n_rev, rows, rows + n + 1, indptr.data());
+  thrust::transform(
+    policy, rows, rows + n + 1, indptr.data(), indptr.data(), knn_row_start_op<value_idx>{k});
+
+  indices.resize(nnz + n_rev, stream);
+  data.resize(nnz + n_rev, stream);
+  knn_place_edges_kernel<<<raft::ceildiv(nnz, size_t(tpb)), tpb, 0, stream>>>(
+    knn_indices, knn_dists, rev_pos.data(), indptr.data(), n, k, indices.data(), data.data());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  if (n_rev > 0) {
+    knn_place_reverse_edges_kernel<<<raft::ceildiv(n_rev, size_t(tpb)), tpb, 0, stream>>>(
+      rev_rows.data(), rev_cols.data(), rev_vals.data(), n_rev, k, indices.data(), data.data());
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+}
+
 };  // end NAMESPACE detail
 };  // end NAMESPACE linalg
 };  // end NAMESPACE sparse
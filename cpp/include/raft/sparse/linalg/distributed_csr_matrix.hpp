@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdspan.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace raft::sparse::linalg {
+
+/**
+ * @brief A square sparse matrix [n_rows, n_rows] partitioned by rows over the ranks of a
+ * communicator, with the plan of the halo exchange of its distributed products.
+ *
+ * Every rank holds a block of consecutive rows of the matrix (the ranks in order), and the same
+ * rows of the dense vectors multiplied by it. The columns referenced by the local rows outside of
+ * the block of the rank are its halo: before a product, every rank receives the halo rows of the
+ * dense operand from their owners, so that the communication is proportional to the edge cut of
+ * the partition rather than to the size of the matrix.
+ *
+ * The local rows are kept with their column indices remapped to the extended operand
+ * [n_local_rows + n_halo_rows]: first the rows of the rank, then its halo rows in the order of
+ * their global indices. The element values and the row offsets are those of the source matrix,
+ * which must outlive this object.
+ *
+ * Use `raft::sparse::linalg::make_distributed_csr_matrix` to create one (a collective call).
+ *
+ * @tparam ValueType the data type of the matrix
+ */
+template <typename ValueType>
+class distributed_csr_matrix {
+ public:
+  using value_type = ValueType;
+
+  distributed_csr_matrix(const raft::comms::comms_t* comms,
+                         int n_rows,
+                         int row_offset,
+                         int n_local_rows,
+                         int n_halo_rows,
+                         const int* indptr,
+                         const ValueType* elements,
+                         int nnz,
+                         const int* indices,
+                         rmm::device_uvector<int>&& remapped_indices,
+                         std::vector<size_t>&& row_counts,
+                         std::vector<size_t>&& row_offsets,
+                         rmm::device_uvector<int>&& send_rows,
+                         std::vector<size_t>&& send_counts,
+                         std::vector<size_t>&& recv_counts)
+    : comms_{comms},
+      n_rows_{n_rows},
+      row_offset_{row_offset},
+      n_local_rows_{n_local_rows},
+      n_halo_rows_{n_halo_rows},
+      indptr_{indptr},
+      elements_{elements},
+      nnz_{nnz},
+      remapped_indices_{std::move(remapped_indices)},
+      row_counts_{std::move(row_counts)},
+      row_offsets_{std::move(row_offsets)},
+      send_rows_{std::move(send_rows)},
+      send_counts_{std::move(send_counts)},
+      recv_counts_{std::move(recv_counts)}
+  {
+    // without a communicator, the column indices need no remapping
+    local_indices_ = remapped_indices_.size() > 0 ? remapped_indices_.data() : indices;
+  }
+
+  /** The communicator of the ranks sharing the matrix (nullptr: the whole matrix is local). */
+  [[nodiscard]] auto comms() const noexcept -> const raft::comms::comms_t* { return comms_; }
+  /** The size of the (global) matrix. */
+  [[nodiscard]] auto n_rows() const noexcept -> int { return n_rows_; }
+  /** The global index of the first row of the rank. */
+  [[nodiscard]] auto row_offset() const noexcept -> int { return row_offset_; }
+  /** The number of rows of the rank. */
+  [[nodiscard]] auto n_local_rows() const noexcept -> int { return n_local_rows_; }
+  /** The number of rows of the other ranks referenced by the rows of the rank. */
+  [[nodiscard]] auto n_halo_rows() const noexcept -> int { return n_halo_rows_; }
+  /** The number of rows of every rank. */
+  [[nodiscard]] auto row_counts() const noexcept -> const std::vector<size_t>&
+  {
+    return row_counts_;
+  }
+  /** The global index of the first row of every rank. */
+  [[nodiscard]] auto row_offsets() const noexcept -> const std::vector<size_t>&
+  {
+    return row_offsets_;
+  }
+  /** The number of the rows of the rank sent to every rank by a halo exchange. */
+  [[nodiscard]] auto send_counts() const noexcept -> const std::vector<size_t>&
+  {
+    return send_counts_;
+  }
+  /** The number of the halo rows received from every rank by a halo exchange. */
+  [[nodiscard]] auto recv_counts() const noexcept -> const std::vector<size_t>&
+  {
+    return recv_counts_;
+  }
+  /** The (local) indices of the rows sent by a halo exchange, grouped by destination rank. */
+  [[nodiscard]] auto send_rows() const noexcept -> raft::device_vector_view<const int, int64_t>
+  {
+    return raft::make_device_vector_view<const int, int64_t>(send_rows_.data(), send_rows_.size());
+  }
+
+  /**
+   * The rows of the rank with the columns of the extended operand: a CSR matrix
+   * [n_local_rows, n_local_rows + n_halo_rows].
+   */
+  [[nodiscard]] auto local_matrix() const
+    -> raft::device_csr_matrix_view<const ValueType, int, int, int>
+  {
+    auto structure = raft::make_device_compressed_structure_view<int, int, int>(
+      const_cast<int*>(indptr_),
+      const_cast<int*>(local_indices_),
+      n_local_rows_,
+      n_local_rows_ + n_halo_rows_,
+      nnz_);
+    return raft::make_device_csr_matrix_view<const ValueType, int, int, int>(elements_, structure);
+  }
+
+ private:
+  const raft::comms::comms_t* comms_;
+  int n_rows_;
+  int row_offset_;
+  int n_local_rows_;
+  int n_halo_rows_;
+  const int* indptr_;
+  const ValueType* elements_;
+  int nnz_;
+  const int* local_indices_{nullptr};
+  rmm::device_uvector<int> remapped_indices_;
+  std::vector<size_t> row_counts_;
+  std::vector<size_t> row_offsets_;
+  rmm::device_uvector<int> send_rows_;
+  std::vector<size_t> send_counts_;
+  std::vector<size_t> recv_counts_;
+};
+
+}  // namespace raft::sparse::linalg
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/sparse/linalg/detail/distributed_spmm.cuh>
+#include <raft/sparse/linalg/distributed_csr_matrix.hpp>
+
+namespace raft::sparse::linalg {
+
+/**
+ * @defgroup distributed_spmm Row-partitioned multi-GPU sparse products
+ *
+ * A square sparse matrix too large for one device (e.g. the adjacency or the Laplacian of a
+ * graph) is partitioned by blocks of consecutive rows over the ranks of the communicator of the
+ * resources. Every rank holds its rows with the global column indices, and the same rows of the
+ * dense operands and results. The products exchange only the halo rows of the operands (the
+ * rows of the other ranks referenced by the local rows), as planned once by
+ * `make_distributed_csr_matrix`.
+ *
+ * @code{.cpp}
+ * #include <raft/sparse/linalg/distributed_spmm.cuh>
+ *
+ * // rows [row_offset, row_offset + n_local) of the graph, with the global column indices
+ * raft::device_csr_matrix_view<const float, int, int, int> local_rows = ...;
+ * auto graph = raft::sparse::linalg::make_distributed_csr_matrix(handle, local_rows);
+ * // x, y: [n_local, b] column-major
+ * float alpha = 1, beta = 0;
+ * raft::sparse::linalg::distributed_spmm(handle, graph, &alpha, x, &beta, y);
+ * @endcode
+ * @{
+ */
+
+/**
+ * @brief Plan the distributed products with the rows of a matrix held by this rank.
+ *
+ * This is a collective call: all the ranks of the communicator of the resources call it with
+ * their rows, the ranks in the order of the rows. Without a communicator, the matrix must be
+ * square and the products are local.
+ *
+ * @tparam ValueType the data type of the matrix
+ * @param[in] handle raft resources
+ * @param[in] local_rows the rows of this rank [n_local, n_rows] (with the global column
+ * indices); it must outlive the returned matrix
+ * @return the distributed matrix
+ */
+template <typename ValueType>
+auto make_distributed_csr_matrix(
+  raft::resources const& handle,
+  raft::device_csr_matrix_view<const ValueType, int, int, int> local_rows)
+  -> distributed_csr_matrix<ValueType>
+{
+  const raft::comms::comms_t* comms =
+    resource::comms_initialized(handle) ? &resource::get_comms(handle) : nullptr;
+  return detail::make_distributed_csr_matrix(handle, comms, local_rows);
+}
+
+/**
+ * @brief Gather the halo rows of a distributed dense matrix.
+ *
+ * x_ext receives the rows x of this rank followed by its halo rows in the order of their global
+ * indices, i.e. the operand of `A.local_matrix()`. This is a collective call.
+ *
+ * @tparam ValueType the data type of the matrices
+ * @param[in] handle raft resources
+ * @param[in] A the distributed matrix
+ * @param[in] x the rows of this rank [n_local_rows, b]
+ * @param[out] x_ext the extended rows [n_local_rows + n_halo_rows, b]
+ */
+template <typename ValueType>
+void halo_exchange(raft::resources const& handle,
+                   const distributed_csr_matrix<ValueType>& A,
+                   raft::device_matrix_view<const ValueType, int, raft::col_major> x,
+                   raft::device_matrix_view<ValueType, int, raft::col_major> x_ext)
+{
+  RAFT_EXPECTS(x.extent(0) == A.n_local_rows(), "x must have the rows of this rank");
+  RAFT_EXPECTS(x_ext.extent(0) == A.n_local_rows() + A.n_halo_rows() &&
+                 x_ext.extent(1) == x.extent(1),
+               "x_ext must be [n_local_rows + n_halo_rows, x.extent(1)]");
+  detail::halo_exchange(handle, A, x.data_handle(), x.extent(1), x_ext.data_handle());
+}
+
+/**
+ * @brief Distributed SpMM: y = alpha A x + beta y, with the rows of this rank of x and y.
+ *
+ * This is a collective call. The halo rows of x are exchanged point-to-point with the ranks
+ * sharing edges with this one, then the local rows of A are multiplied by cuSPARSE.
+ *
+ * @tparam ValueType the data type of the matrices (float/double)
+ * @param[in] handle raft resources
+ * @param[in] A the distributed matrix
+ * @param[in] alpha scalar (host)
+ * @param[in] x the rows of this rank of the operand [n_local_rows, b]
+ * @param[in] beta scalar (host)
+ * @param[inout] y the rows of this rank of the result [n_local_rows, b]
+ */
+template <typename ValueType>
+void distributed_spmm(raft::resources const& handle,
+                      const distributed_csr_matrix<ValueType>& A,
+                      const ValueType* alpha,
+                      raft::device_matrix_view<const ValueType, int, raft::col_major> x,
+                      const ValueType* beta,
+                      raft::device_matrix_view<ValueType, int, raft::col_major> y)
+{
+  RAFT_EXPECTS(x.extent(0) == A.n_local_rows() && y.extent(0) == A.n_local_rows(),
+               "x and y must have the rows of this rank");
+  RAFT_EXPECTS(x.extent(1) == y.extent(1), "x and y must have the same number of columns");
+  detail::distributed_spmm(handle, A, alpha, x.data_handle(), x.extent(1), beta, y.data_handle());
+}
+
+/**
+ * @brief Distributed SpMV: y = alpha A x + beta y, with the rows of this rank of x and y.
+ *
+ * This is a collective call; see `distributed_spmm`.
+ *
+ * @tparam ValueType the data type of the matrix and the vectors (float/double)
+ * @param[in] handle raft resources
+ * @param[in] A the distributed matrix
+ * @param[in] alpha scalar (host)
+ * @param[in] x the rows of this rank of the operand [n_local_rows]
+ * @param[in] beta scalar (host)
+ * @param[inout] y the rows of this rank of the result [n_local_rows]
+ */
+template <typename ValueType>
+void distributed_spmv(raft::resources const& handle,
+                      const distributed_csr_matrix<ValueType>& A,
+                      const ValueType* alpha,
+                      raft::device_vector_view<const ValueType, int> x,
+                      const ValueType* beta,
+                      raft::device_vector_view<ValueType, int> y)
+{
+  RAFT_EXPECTS(x.extent(0) == A.n_local_rows() && y.extent(0) == A.n_local_rows(),
+               "x and y must have the rows of this rank");
+  detail::distributed_spmm(handle, A, alpha, x.data_handle(), 1, beta, y.data_handle());
+}
+
+/** @} */  // end group distributed_spmm
+
+}  // namespace raft::sparse::linalg
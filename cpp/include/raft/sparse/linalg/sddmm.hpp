@@ -78,6 +78,56 @@ void sddmm(raft::resources const& handle,
   RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
 
+/**
+ * @brief Mixed precision SDDMM: C = alpha · (opA(A) * opB(B) ∘ spy(C)) + beta · C with half or
+ * nv_bfloat16 matrices, float scalars and float accumulation.
+ * @tparam ValueType Data type of input/output matrices (half/nv_bfloat16)
+ * @tparam IndexType Type of C
+ * @tparam NZType Type of C
+ * @tparam LayoutPolicyA layout of A
+ * @tparam LayoutPolicyB layout of B
+ * @param[in] handle raft handle
+ * @param[in] A input raft::device_matrix_view
+ * @param[in] B input raft::device_matrix_view
+ * @param[inout] C output raft::device_csr_matrix_view
+ * @param[in] opA input Operation op(A)
+ * @param[in] opB input Operation op(B)
+ * @param[in] alpha input raft::host_scalar_view
+ * @param[in] beta input raft::host_scalar_view
+ */
+template <typename ValueType,
+          typename IndexType,
+          typename NZType,
+          typename LayoutPolicyA,
+          typename LayoutPolicyB>
+std::enable_if_t<std::is_same_v<ValueType, half> || std::is_same_v<ValueType, nv_bfloat16>> sddmm(
+  raft::resources const& handle,
+  raft::device_matrix_view<const ValueType, IndexType, LayoutPolicyA> A,
+  raft::device_matrix_view<const ValueType, IndexType, LayoutPolicyB> B,
+  raft::device_csr_matrix_view<ValueType, IndexType, IndexType, NZType> C,
+  const raft::linalg::Operation opA,
+  const raft::linalg::Operation opB,
+  raft::host_scalar_view<float> alpha,
+  raft::host_scalar_view<float> beta)
+{
+  RAFT_EXPECTS(raft::is_row_or_column_major(A), "A is not contiguous");
+  RAFT_EXPECTS(raft::is_row_or_column_major(B), "B is not contiguous");
+
+  auto descrA = detail::create_descriptor(A);
+  auto descrB = detail::create_descriptor(B);
+  auto descrC = detail::create_descriptor(C);
+  auto op_A   = detail::convert_operation(opA);
+  auto op_B   = detail::convert_operation(opB);
+
+  detail::sddmm(
+    handle, descrA, descrB, descrC, op_A, op_B, alpha.data_handle(), beta.data_handle());
+
+  RAFT_CUSPARSE_TRY_NO_THROW(cusparseDestroyDnMat(descrA));
+  RAFT_CUSPARSE_TRY_NO_THROW(cusparseDestroyDnMat(descrB));
+  RAFT_CUSPARSE_TRY_NO_THROW(cusparseDestroySpMat(descrC));
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
 }  // end namespace linalg
 }  // end namespace sparse
 }  // end namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,8 +16,14 @@
 #ifndef __SPARSE_SPECTRAL_H
 #define __SPARSE_SPECTRAL_H
 
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdspan.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/sparse/linalg/detail/spectral.cuh>
+#include <raft/sparse/linalg/spectral_types.hpp>
+#include <raft/sparse/solver/lanczos_types.hpp>
+
+#include <optional>
 
 namespace raft {
 namespace sparse {
@@ -36,6 +42,51 @@ void fit_embedding(raft::resources const& handle,
 {
   detail::fit_embedding(handle, rows, cols, vals, nnz, n, n_components, out, seed);
 }
+
+/**
+ * @brief The spectral embedding of a graph by the eigenvectors of its normalized Laplacian.
+ *
+ * The embedding is D^-1/2 U, where U are the eigenvectors of the smallest eigenvalues of the
+ * normalized Laplacian I - D^-1/2 A D^-1/2 of the adjacency A with the degrees D (as the
+ * `norm_laplacian` embedding of scikit-learn). They are computed as the largest eigenpairs of
+ * D^-1/2 A D^-1/2 by the block Lanczos solver, which applies the scaling on the fly around the
+ * products by the CSR graph: neither the Laplacian nor a copy of the graph is formed.
+ *
+ * The embedding of a previous, similar graph (e.g. the previous fit of an incremental pipeline)
+ * may be given as a warm start: the solver then starts from its span, which usually takes far
+ * fewer products than a random start.
+ *
+ * @tparam T the data type of the graph (float/double)
+ * @param[in] handle raft resources
+ * @param[in] config the parameters of the embedding
+ * @param[in] graph the symmetric adjacency matrix of the graph [n, n], with non-negative weights
+ * @param[out] embedding the embedding [n, n_components] (column-major)
+ * @param[in] warm_start an optional previous embedding [n, n_components] (column-major)
+ * @return what the eigensolver did
+ */
+template <typename T>
+auto fit_embedding(
+  raft::resources const& handle,
+  embedding_config<T> const& config,
+  raft::device_csr_matrix_view<const T, int, int, int> graph,
+  raft::device_matrix_view<T, int, raft::col_major> embedding,
+  std::optional<raft::device_matrix_view<const T, int, raft::col_major>> warm_start = std::nullopt)
+  -> raft::sparse::solver::block_lanczos_result
+{
+  int n = graph.structure_view().get_n_rows();
+  RAFT_EXPECTS(graph.structure_view().get_n_cols() == n, "fit_embedding: the graph must be square");
+  RAFT_EXPECTS(config.n_components > 0, "fit_embedding: n_components must be positive");
+  RAFT_EXPECTS(embedding.extent(0) == n && embedding.extent(1) == config.n_components,
+               "fit_embedding: embedding must be [n, n_components]");
+  const T* initial = nullptr;
+  int n_initial    = 0;
+  if (warm_start.has_value()) {
+    RAFT_EXPECTS(warm_start->extent(0) == n, "fit_embedding: warm_start must have n rows");
+    initial   = warm_start->data_handle();
+    n_initial = warm_start->extent(1);
+  }
+  return detail::fit_embedding(handle, config, graph, embedding.data_handle(), initial, n_initial);
+}
 };  // namespace spectral
 };  // namespace sparse
 };  // namespace raft
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace raft::sparse::spectral {
+
+/**
+ * @brief The parameters of the spectral embedding of a graph by its normalized Laplacian.
+ *
+ * @tparam ValueTypeT the data type of the graph
+ */
+template <typename ValueTypeT>
+struct embedding_config {
+  /** The dimension of the embedding. */
+  int n_components;
+  /**
+   * Whether to drop the trivial eigenvector (constant over every connected component), as
+   * usual for an embedding of a connected graph.
+   */
+  bool drop_first = true;
+  /** The block size of the block Lanczos solver; 0 selects the number of wanted eigenpairs. */
+  int block_size = 0;
+  /** The largest number of restarts of the block Lanczos solver. */
+  int max_restarts = 100;
+  /** The relative tolerance of the residuals of the eigenpairs. */
+  ValueTypeT tolerance = 1e-5;
+  /** The seed of the random columns of the starting block. */
+  uint64_t seed = 1234567;
+};
+
+}  // namespace raft::sparse::spectral
@@ -21,6 +21,8 @@
 #include <raft/sparse/linalg/detail/cusparse_utils.hpp>
 #include <raft/sparse/linalg/detail/spmm.hpp>
 
+#include <type_traits>
+
 namespace raft {
 namespace sparse {
 namespace linalg {
@@ -78,6 +80,127 @@ void spmm(raft::resources const& handle,
   RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
 
+/**
+ * @brief Batched SPMM: computes Z_i = alpha . X_i * Y_i + beta . Z_i for i in [0, batch_count)
+ * in a single cuSparse call (strided batch).
+ *
+ * The batch of dense matrices is stored contiguously: `y` and `z` are views of the first matrix
+ * of their batch, and the following ones are found at offsets of `extent * leading dimension`
+ * elements. With `shared_x`, the same sparse matrix X multiplies every right-hand side (e.g. a
+ * graph applied to several feature matrices); otherwise `x` is the first of `batch_count` CSR
+ * matrices of identical shape and nnz, with their index pointers, indices and elements stored
+ * one after the other (the index pointers of each matrix start at zero).
+ *
+ * The values may be half or nv_bfloat16 with float scalars: the products are accumulated in
+ * float (CUDA_R_32F compute type).
+ *
+ * @tparam ValueType Data type of the input and output matrices (float/double/half/nv_bfloat16)
+ * @tparam ScalarType Data type of alpha and beta and of the accumulation (float/double)
+ * @tparam IndexType Type of Y and Z
+ * @tparam NZType Type of X
+ * @tparam LayoutPolicyY layout of Y
+ * @tparam LayoutPolicyZ layout of Z
+ * @param[in] handle raft handle
+ * @param[in] trans_x transpose operation for X
+ * @param[in] trans_y transpose operation for Y
+ * @param[in] alpha scalar
+ * @param[in] x input raft::device_csr_matrix_view (first matrix of the batch)
+ * @param[in] y input raft::device_matrix_view (first matrix of the batch)
+ * @param[in] beta scalar
+ * @param[inout] z input-output raft::device_matrix_view (first matrix of the batch)
+ * @param[in] batch_count number of products
+ * @param[in] shared_x whether all the products share the sparse matrix X
+ */
+template <typename ValueType,
+          typename ScalarType,
+          typename IndexType,
+          typename NZType,
+          typename LayoutPolicyY,
+          typename LayoutPolicyZ>
+void spmm_batched(raft::resources const& handle,
+                  const bool trans_x,
+                  const bool trans_y,
+                  const ScalarType* alpha,
+                  raft::device_csr_matrix_view<const ValueType, int, int, NZType> x,
+                  raft::device_matrix_view<const ValueType, IndexType, LayoutPolicyY> y,
+                  const ScalarType* beta,
+                  raft::device_matrix_view<ValueType, IndexType, LayoutPolicyZ> z,
+                  int batch_count,
+                  bool shared_x = true)
+{
+  static_assert(std::is_same_v<ValueType, ScalarType> ||
+                  (std::is_same_v<ScalarType, float> &&
+                   (std::is_same_v<ValueType, half> || std::is_same_v<ValueType, nv_bfloat16>)),
+                "The scalars must have the type of the values, or be float for half/bf16 values");
+  RAFT_EXPECTS(batch_count > 0, "batch_count must be positive");
+
+  bool is_row_major = detail::is_row_major(y, z);
+
+  auto z_tmp_view =
+    is_row_major ? raft::make_device_strided_matrix_view<ValueType, IndexType, layout_c_contiguous>(
+                     z.data_handle(), z.extent(0), z.extent(1), z.stride(0))
+                 : raft::make_device_strided_matrix_view<ValueType, IndexType, layout_f_contiguous>(
+                     z.data_handle(), z.extent(0), z.extent(1), z.stride(1));
+
+  auto descr_x = detail::create_descriptor(x);
+  auto descr_y = detail::create_descriptor(y);
+  auto descr_z = detail::create_descriptor(z_tmp_view);
+
+  if (batch_count > 1) {
+    auto csr_structure = x.structure_view();
+
+    int64_t indptr_stride = shared_x ? 0 : int64_t(csr_structure.get_n_rows()) + 1;
+    int64_t values_stride = shared_x ? 0 : int64_t(csr_structure.get_nnz());
+    RAFT_CUSPARSE_TRY(
+      cusparseCsrSetStridedBatch(descr_x, batch_count, indptr_stride, values_stride));
+    RAFT_CUSPARSE_TRY(cusparseDnMatSetStridedBatch(descr_y, batch_count, detail::batch_stride(y)));
+    RAFT_CUSPARSE_TRY(
+      cusparseDnMatSetStridedBatch(descr_z, batch_count, detail::batch_stride(z_tmp_view)));
+  }
+
+  detail::spmm(handle, trans_x, trans_y, is_row_major, alpha, descr_x, descr_y, beta, descr_z);
+
+  RAFT_CUSPARSE_TRY_NO_THROW(cusparseDestroySpMat(descr_x));
+  RAFT_CUSPARSE_TRY_NO_THROW(cusparseDestroyDnMat(descr_y));
+  RAFT_CUSPARSE_TRY_NO_THROW(cusparseDestroyDnMat(descr_z));
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/**
+ * @brief Mixed precision SPMM: Z = alpha . X * Y + beta . Z with half or nv_bfloat16 matrices,
+ * float scalars and float accumulation.
+ * @tparam ValueType Data type of input/output matrices (half/nv_bfloat16)
+ * @tparam IndexType Type of Y and Z
+ * @tparam NZType Type of X
+ * @tparam LayoutPolicyY layout of Y
+ * @tparam LayoutPolicyZ layout of Z
+ * @param[in] handle raft handle
+ * @param[in] trans_x transpose operation for X
+ * @param[in] trans_y transpose operation for Y
+ * @param[in] alpha scalar
+ * @param[in] x input raft::device_csr_matrix_view
+ * @param[in] y input raft::device_matrix_view
+ * @param[in] beta scalar
+ * @param[inout] z input-output raft::device_matrix_view
+ */
+template <typename ValueType,
+          typename IndexType,
+          typename NZType,
+          typename LayoutPolicyY,
+          typename LayoutPolicyZ>
+std::enable_if_t<std::is_same_v<ValueType, half> || std::is_same_v<ValueType, nv_bfloat16>> spmm(
+  raft::resources const& handle,
+  const bool trans_x,
+  const bool trans_y,
+  const float* alpha,
+  raft::device_csr_matrix_view<const ValueType, int, int, NZType> x,
+  raft::device_matrix_view<const ValueType, IndexType, LayoutPolicyY> y,
+  const float* beta,
+  raft::device_matrix_view<ValueType, IndexType, LayoutPolicyZ> z)
+{
+  spmm_batched(handle, trans_x, trans_y, alpha, x, y, beta, z, 1);
+}
+
 }  // end namespace linalg
 }  // end namespace sparse
 }  // end namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -161,6 +161,37 @@ void symmetrize(raft::resources const& handle,
   detail::symmetrize(handle, rows, cols, vals, m, n, nnz, out);
 }
 
+/**
+ * @brief Builds the symmetric CSR matrix of a kNN graph directly from the neighbor matrix.
+ *
+ * This avoids the cost of `from_knn_symmetrize_matrix` / `symmetrize`, which double the edges
+ * and then sort and reduce them. Only the edges whose reverse is not in the kNN graph are sorted
+ * here, and everything is placed without atomics. An edge present in both directions is kept
+ * once, with the larger of its two distances (as `symmetrize` does). Each row holds its kNN
+ * edges followed by its reverse edges, by increasing column.
+ *
+ * @param handle: raft resources
+ * @param knn_indices: Input knn indices (n, k)
+ * @param knn_dists: Input knn distances (n, k)
+ * @param n: Number of rows
+ * @param k: Number of n_neighbors
+ * @param indptr: Output row offsets (resized to n + 1)
+ * @param indices: Output column indices (resized to nnz)
+ * @param data: Output values (resized to nnz)
+ */
+template <typename value_idx, typename value_t>
+void symmetrize_knn_csr(raft::resources const& handle,
+                        const value_idx* knn_indices,
+                        const value_t* knn_dists,
+                        size_t n,
+                        int k,
+                        rmm::device_uvector<value_idx>& indptr,
+                        rmm::device_uvector<value_idx>& indices,
+                        rmm::device_uvector<value_t>& data)
+{
+  detail::symmetrize_knn_csr(handle, knn_indices, knn_dists, n, k, indptr, indices, data);
+}
+
 };  // end NAMESPACE linalg
 };  // end NAMESPACE sparse
 };  // end NAMESPACE raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -63,8 +63,9 @@ value_idx get_n_components(value_idx* colors, size_t n_rows, cudaStream_t stream
  * operation must have `gather` and `scatter` functions defined
  * @param[in] row_batch_size the batch size for computing nearest neighbors. This parameter controls
  * the number of samples for which the nearest neighbors are computed at once. Therefore, it affects
- * the memory consumption mainly by reducing the size of the adjacency matrix for masked nearest
- * neighbors computation
+ * the memory consumption mainly by reducing the size of the adjacency bitfield for masked nearest
+ * neighbors computation. default 0 indicates that the batch size is chosen to fit the free
+ * workspace memory
  * @param[in] col_batch_size the input data is sorted and 'unsorted' based on color. An additional
  * scratch space buffer of shape (n_rows, col_batch_size) is created for this. Usually, this
  * parameter affects the memory consumption more drastically than the row_batch_size with a marginal
@@ -93,7 +94,71 @@ void cross_component_nn(
                              reduction_op,
                              row_batch_size,
                              col_batch_size,
-                             metric);
+                             metric,
+                             nullptr);
+}
+
+/**
+ * The nearest neighbors out of their components kept by `cross_component_nn`
+ * between the rounds of connecting a graph.
+ */
+template <typename value_idx, typename value_t>
+using cross_component_nn_state = detail::cross_component_nn_state<value_idx, value_t>;
+
+/**
+ * Connects the components of an otherwise unconnected knn graph like
+ * `cross_component_nn` above, keeping the nearest neighbor of each point out
+ * of its component between the calls (rounds).
+ *
+ * As the components only grow by merging between the rounds, the nearest
+ * neighbor of a point out of its component stays valid unless it has been
+ * merged into the component of the point; only those points are searched
+ * again. The tiles of 64 points whose neighbors are all still valid are
+ * skipped without loading their data.
+ *
+ * @tparam value_idx
+ * @tparam value_t
+ * @param[in] handle raft handle
+ * @param[out] out output edge list containing nearest cross-component
+ *             edges.
+ * @param[in] X original (row-major) dense matrix for which knn graph should be constructed.
+ * @param[in] orig_colors array containing component number for each row of X
+ * @param[in] n_rows number of rows in X
+ * @param[in] n_cols number of cols in X
+ * @param[in] reduction_op reduction operation for computing nearest neighbors. The reduction
+ * operation must have `gather` and `scatter` functions defined
+ * @param[inout] state the state of the previous rounds, of size `n_rows` (the first round
+ * searches all the points). The reduction operation must be the same in all rounds.
+ * @param[in] row_batch_size the batch size for computing nearest neighbors (default 0: as many
+ * rows as fit the adjacency bitfield in the free workspace memory)
+ * @param[in] col_batch_size the column batch size for sorting and 'unsorting' the data by color
+ * @param[in] metric distance metric
+ */
+template <typename value_idx, typename value_t, typename red_op>
+void cross_component_nn(
+  raft::resources const& handle,
+  raft::sparse::COO<value_t, value_idx>& out,
+  const value_t* X,
+  const value_idx* orig_colors,
+  size_t n_rows,
+  size_t n_cols,
+  red_op reduction_op,
+  cross_component_nn_state<value_idx, value_t>& state,
+  size_t row_batch_size               = 0,
+  size_t col_batch_size               = 0,
+  raft::distance::DistanceType metric = raft::distance::DistanceType::L2SqrtExpanded)
+{
+  detail::cross_component_nn(handle,
+                             out,
+                             X,
+                             orig_colors,
+                             n_rows,
+                             n_cols,
+                             reduction_op,
+                             row_batch_size,
+                             col_batch_size,
+                             metric,
+                             &state);
 }
 
 };  // end namespace raft::sparse::neighbors
\ No newline at end of file
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,6 +21,7 @@
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/kvp.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/distance/masked_nn.cuh>
@@ -52,6 +53,7 @@
 
 #include <cub/cub.cuh>
 
+#include <algorithm>
 #include <limits>
 
 namespace raft::sparse::neighbors::detail {
@@ -189,6 +191,76 @@ struct LookupColorOp {
   }
 };
 
+/**
+ * The state kept by `cross_component_nn` between the rounds of connecting
+ * a graph: the nearest neighbor of each point out of its component found in
+ * the previous round.
+ *
+ * As the components only grow by merging, the nearest neighbor of a point
+ * out of its component is still the nearest one after a merge, unless the
+ * merge brought it into the component of the point. Only the points whose
+ * previous nearest neighbor is now in their own component are searched
+ * again.
+ *
+ * @tparam value_idx
+ * @tparam value_t
+ */
+template <typename value_idx, typename value_t>
+struct cross_component_nn_state {
+  /** The nearest neighbor (and its distance) of each point out of its component */
+  rmm::device_uvector<raft::KeyValuePair<value_idx, value_t>> nn;
+  /** Whether `nn` holds the results of a previous round */
+  bool valid = false;
+
+  cross_component_nn_state(size_t n_rows, rmm::cuda_stream_view stream) : nn(n_rows, stream) {}
+};
+
+/**
+ * Functor to compute the adjacency bitfield of a batch of rows (sorted by
+ * component) for the masked nearest neighbors: bit `i % 64` of word
+ * `[i / 64, j]` is set iff row `i` is not in component `j` and is active.
+ * @tparam value_idx
+ */
+template <typename value_idx>
+struct CrossComponentMaskOp {
+  const value_idx* colors;
+  const bool* active;
+  size_t batch_offset;
+  size_t rows_per_batch;
+  raft::util::FastIntDiv n_components;
+
+  DI uint64_t operator()(value_idx idx) const
+  {
+    const size_t word_row = idx / n_components;
+    const value_idx col   = idx % n_components;
+    uint64_t bits         = 0;
+    for (size_t i = 0; i < 64; i++) {
+      const size_t row = word_row * 64 + i;
+      if (row >= rows_per_batch) { break; }
+      const size_t sample = batch_offset + row;
+      if (colors[sample] != col && (active == nullptr || active[sample])) {
+        bits |= uint64_t(1) << i;
+      }
+    }
+    return bits;
+  }
+};
+
+/**
+ * The number of rows of a batch of the cross-component nearest neighbors
+ * within the workspace memory: the adjacency bitfield takes 8 bytes per
+ * component for 64 rows, and the masked nearest neighbors 4 bytes per row.
+ */
+inline size_t cross_component_nn_row_batch_size(raft::resources const& handle,
+                                                size_t n_rows,
+                                                size_t n_components)
+{
+  const size_t budget     = resource::get_workspace_free_bytes(handle) / 2;
+  const size_t tile_bytes = n_components * sizeof(uint64_t) + 64 * sizeof(int);
+  const size_t n_tiles    = std::max<size_t>(1, budget / tile_bytes);
+  return std::min(n_rows, n_tiles * 64);
+}
+
 /**
  * Compute the cross-component 1-nearest neighbors for each row in X using
  * the given array of components
@@ -202,9 +274,12 @@ struct LookupColorOp {
  * @param[in] X original dense data
  * @param[in] n_rows number of rows in original dense data
  * @param[in] n_cols number of columns in original dense data
- * @param[in] row_batch_size row batch size for computing nearest neighbors
+ * @param[in] row_batch_size row batch size for computing nearest neighbors (0: as many rows as
+ * fit in the workspace memory, see cross_component_nn_row_batch_size)
  * @param[in] col_batch_size column batch size for sorting and 'unsorting'
  * @param[in] reduction_op reduction operation for computing nearest neighbors
+ * @param[in] active the rows to compute the nearest neighbors of (nullptr: all of them). The other
+ * rows of `kvp` are kept as given on input.
  */
 template <typename value_idx, typename value_t, typename red_op>
 void perform_1nn(raft::resources const& handle,
@@ -216,16 +291,42 @@ void perform_1nn(raft::resources const& handle,
                  size_t n_cols,
                  size_t row_batch_size,
                  size_t col_batch_size,
-                 red_op reduction_op)
+                 red_op reduction_op,
+                 const bool* active = nullptr)
 {
+  using OutT = raft::KeyValuePair<value_idx, value_t>;
+
   auto stream      = resource::get_cuda_stream(handle);
   auto exec_policy = resource::get_thrust_policy(handle);
 
   auto sort_plan = raft::make_device_vector<value_idx>(handle, (value_idx)n_rows);
   raft::linalg::map_offset(handle, sort_plan.view(), [] __device__(value_idx idx) { return idx; });
 
-  thrust::sort_by_key(
-    resource::get_thrust_policy(handle), colors, colors + n_rows, sort_plan.data_handle());
+  // Keep the results of the inactive rows, and order the active rows first within each component,
+  // so that the tiles of inactive rows are skipped by the masked nearest neighbors.
+  rmm::device_uvector<OutT> prev_kvp(active == nullptr ? 0 : n_rows, stream);
+  rmm::device_uvector<bool> active_sorted(active == nullptr ? 0 : n_rows, stream);
+  if (active != nullptr) {
+    raft::copy_async(prev_kvp.data(), kvp, n_rows, stream);
+    rmm::device_uvector<value_idx> keys(n_rows, stream);
+    thrust::transform(exec_policy, active, active + n_rows, keys.data(), [] __device__(bool a) {
+      return value_idx(!a);
+    });
+    thrust::stable_sort_by_key(
+      exec_policy, keys.data(), keys.data() + n_rows, sort_plan.data_handle());
+    thrust::gather(
+      exec_policy, sort_plan.data_handle(), sort_plan.data_handle() + n_rows, colors, keys.data());
+    raft::copy_async(colors, keys.data(), n_rows, stream);
+  }
+
+  thrust::stable_sort_by_key(exec_policy, colors, colors + n_rows, sort_plan.data_handle());
+  if (active != nullptr) {
+    thrust::gather(exec_policy,
+                   sort_plan.data_handle(),
+                   sort_plan.data_handle() + n_rows,
+                   active,
+                   active_sorted.data());
+  }
 
   // Modify the reduction operation based on the sort plan.
   reduction_op.gather(handle, sort_plan.data_handle());
@@ -254,8 +355,13 @@ void perform_1nn(raft::resources const& handle,
   raft::linalg::rowNorm(
     x_norm.data_handle(), X, n_cols, n_rows, raft::linalg::L2Norm, true, stream);
 
-  auto adj     = raft::make_device_matrix<bool, value_idx>(handle, row_batch_size, n_components);
-  using OutT   = raft::KeyValuePair<value_idx, value_t>;
+  if (row_batch_size == 0) {
+    row_batch_size = cross_component_nn_row_batch_size(handle, n_rows, n_components);
+  }
+
+  // The adjacency bitfield of a batch (see CrossComponentMaskOp).
+  size_t n_words = raft::ceildiv(row_batch_size, size_t(64)) * n_components;
+  rmm::device_uvector<uint64_t> adj(n_words, stream, resource::get_workspace_resource(handle));
   using ParamT = raft::distance::masked_l2_nn_params<red_op, red_op>;
 
   bool apply_sqrt      = true;
@@ -276,35 +382,34 @@ void perform_1nn(raft::resources const& handle,
     auto x_norm_batch_view = raft::make_device_vector_view<const value_t, value_idx>(
       x_norm.data_handle() + batch_offset, rows_per_batch);
 
-    auto mask_op = [colors,
-                    n_components = raft::util::FastIntDiv(n_components),
-                    batch_offset] __device__(value_idx idx) {
-      value_idx row = idx / n_components;
-      value_idx col = idx % n_components;
-      return colors[batch_offset + row] != col;
-    };
+    CrossComponentMaskOp<value_idx> mask_op{colors,
+                                            active == nullptr ? nullptr : active_sorted.data(),
+                                            batch_offset,
+                                            rows_per_batch,
+                                            raft::util::FastIntDiv(n_components)};
 
-    auto adj_vector_view = raft::make_device_vector_view<bool, value_idx>(
-      adj.data_handle(), rows_per_batch * n_components);
+    value_idx batch_words = raft::ceildiv(rows_per_batch, size_t(64));
+    auto adj_vector_view =
+      raft::make_device_vector_view<uint64_t, value_idx>(adj.data(), batch_words * n_components);
 
     raft::linalg::map_offset(handle, adj_vector_view, mask_op);
 
-    auto adj_view = raft::make_device_matrix_view<const bool, value_idx>(
-      adj.data_handle(), rows_per_batch, n_components);
+    auto adj_view = raft::make_device_matrix_view<const uint64_t, value_idx>(
+      adj.data(), batch_words, n_components);
 
     auto kvp_view =
       raft::make_device_vector_view<raft::KeyValuePair<value_idx, value_t>, value_idx>(
         kvp + batch_offset, rows_per_batch);
 
-    raft::distance::masked_l2_nn<value_t, OutT, value_idx, red_op, red_op>(handle,
-                                                                           params,
-                                                                           X_batch_view,
-                                                                           X_full_view,
-                                                                           x_norm_batch_view,
-                                                                           x_norm.view(),
-                                                                           adj_view,
-                                                                           group_idxs_view,
-                                                                           kvp_view);
+    raft::distance::masked_nn<value_t, OutT, value_idx, red_op, red_op>(handle,
+                                                                        params,
+                                                                        X_batch_view,
+                                                                        X_full_view,
+                                                                        x_norm_batch_view,
+                                                                        x_norm.view(),
+                                                                        adj_view,
+                                                                        group_idxs_view,
+                                                                        kvp_view);
   }
 
   // Transform the keys so that they correctly point to the unpermuted indices.
@@ -315,7 +420,7 @@ void perform_1nn(raft::resources const& handle,
                     [sort_plan = sort_plan.data_handle()] __device__(OutT KVP) {
                       OutT res;
                       res.value = KVP.value;
-                      res.key   = sort_plan[KVP.key];
+                      res.key   = KVP.key < 0 ? KVP.key : sort_plan[KVP.key];
                       return res;
                     });
 
@@ -333,7 +438,19 @@ void perform_1nn(raft::resources const& handle,
   reduction_op.scatter(handle, sort_plan.data_handle());
 
   raft::copy_async(colors, tmp_colors.data_handle(), n_rows, stream);
-  raft::copy_async(kvp, tmp_kvp.data_handle(), n_rows, stream);
+  if (active == nullptr) {
+    raft::copy_async(kvp, tmp_kvp.data_handle(), n_rows, stream);
+  } else {
+    auto results = thrust::make_zip_iterator(
+      thrust::make_tuple(tmp_kvp.data_handle(), prev_kvp.data(), active));
+    thrust::transform(exec_policy,
+                      results,
+                      results + n_rows,
+                      kvp,
+                      [] __device__(const thrust::tuple<OutT, OutT, bool>& t) {
+                        return thrust::get<2>(t) ? thrust::get<0>(t) : thrust::get<1>(t);
+                      });
+  }
 
   LookupColorOp<value_idx, value_t> extract_colors_op(colors);
   thrust::transform(exec_policy, kvp, kvp + n_rows, nn_colors, extract_colors_op);
@@ -442,14 +559,18 @@ void min_components_by_color(raft::sparse::COO<value_t, value_idx>& coo,
  * operation must have `gather` and `scatter` functions defined
  * @param[in] row_batch_size the batch size for computing nearest neighbors. This parameter controls
  * the number of samples for which the nearest neighbors are computed at once. Therefore, it affects
- * the memory consumption mainly by reducing the size of the adjacency matrix for masked nearest
- * neighbors computation. default 0 indicates that no batching is done
+ * the memory consumption mainly by reducing the size of the adjacency bitfield for masked nearest
+ * neighbors computation. default 0 indicates that the batch size is chosen to fit the adjacency
+ * bitfield in the free workspace memory
  * @param[in] col_batch_size the input data is sorted and 'unsorted' based on color. An additional
  * scratch space buffer of shape (n_rows, col_batch_size) is created for this. Usually, this
  * parameter affects the memory consumption more drastically than the col_batch_size with a marginal
  * increase in compute time as the col_batch_size is reduced. default 0 indicates that no batching
  * is done
  * @param[in] metric distance metric
+ * @param[inout] state the nearest neighbors of the previous round (nullptr: none are kept). When
+ * given, only the points whose previous nearest neighbor is now in their own component are
+ * searched again, and the state is updated with the results of this round.
  */
 template <typename value_idx, typename value_t, typename red_op>
 void cross_component_nn(
@@ -462,7 +583,8 @@ void cross_component_nn(
   red_op reduction_op,
   size_t row_batch_size,
   size_t col_batch_size,
-  raft::distance::DistanceType metric = raft::distance::DistanceType::L2SqrtExpanded)
+  raft::distance::DistanceType metric,
+  cross_component_nn_state<value_idx, value_t>* state)
 {
   auto stream = resource::get_cuda_stream(handle);
 
@@ -470,7 +592,7 @@ void cross_component_nn(
                "Fixing connectivities for an unconnected k-NN graph only "
                "supports L2SqrtExpanded currently.");
 
-  if (row_batch_size == 0 || row_batch_size > n_rows) { row_batch_size = n_rows; }
+  if (row_batch_size > n_rows) { row_batch_size = n_rows; }
 
   if (col_batch_size == 0 || col_batch_size > n_cols) { col_batch_size = n_cols; }
 
@@ -489,6 +611,23 @@ void cross_component_nn(
   rmm::device_uvector<raft::KeyValuePair<value_idx, value_t>> temp_inds_dists(n_rows, stream);
   rmm::device_uvector<value_idx> src_indices(n_rows, stream);
 
+  /**
+   * Only search again the points whose previous nearest neighbor has been merged into their
+   * component.
+   */
+  rmm::device_uvector<bool> active(0, stream);
+  if (state != nullptr && state->valid) {
+    RAFT_EXPECTS(state->nn.size() == n_rows, "cross_component_nn: the state must have n_rows");
+    active.resize(n_rows, stream);
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<bool, size_t>(active.data(), n_rows),
+      [colors = colors.data(), nn = state->nn.data()] __device__(size_t i) {
+        return nn[i].key < 0 || colors[nn[i].key] == colors[i];
+      });
+    raft::copy_async(temp_inds_dists.data(), state->nn.data(), n_rows, stream);
+  }
+
   perform_1nn(handle,
               temp_inds_dists.data(),
               nn_colors.data(),
@@ -498,7 +637,14 @@ void cross_component_nn(
               n_cols,
               row_batch_size,
               col_batch_size,
-              reduction_op);
+              reduction_op,
+              active.size() == 0 ? nullptr : active.data());
+
+  if (state != nullptr) {
+    RAFT_EXPECTS(state->nn.size() == n_rows, "cross_component_nn: the state must have n_rows");
+    raft::copy_async(state->nn.data(), temp_inds_dists.data(), n_rows, stream);
+    state->valid = true;
+  }
 
   /**
    * Sort data points by color (neighbors are not sorted)
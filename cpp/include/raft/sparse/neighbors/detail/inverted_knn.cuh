@@ -0,0 +1,423 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/error.hpp>
+#include <raft/core/nvtx.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance_types.hpp>
+#include <raft/linalg/norm_types.hpp>
+#include <raft/matrix/detail/select_warpsort.cuh>
+#include <raft/sparse/convert/coo.cuh>
+#include <raft/sparse/convert/csr.cuh>
+#include <raft/sparse/distance/detail/coo_spmv_strategies/merge_path_strategy.cuh>
+#include <raft/sparse/linalg/norm.cuh>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <raft/util/pow2_utils.cuh>
+
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/binary_search.h>
+#include <thrust/gather.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/zip_iterator.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
+#include <thrust/tuple.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace raft::sparse::neighbors::detail {
+
+/** Whether the fused inverted-index search supports the metric and the number of neighbors. */
+inline bool inverted_knn_supported(raft::distance::DistanceType metric, int k)
+{
+  return (metric == raft::distance::DistanceType::InnerProduct ||
+          metric == raft::distance::DistanceType::CosineExpanded) &&
+         k <= raft::matrix::detail::select::warpsort::kMaxCapacity;
+}
+
+/**
+ * Expands the products q_c * d_c of the nonzeros of the queries [q0, q1) with the postings of
+ * their columns in the inverted index, keyed by `(q - q0) * n_docs + d`. The products are
+ * partitioned evenly over the threads, as in the merge path SpGEMM strategy.
+ */
+template <typename value_idx, typename value_t>
+RAFT_KERNEL expand_postings_kernel(const value_idx* query_indptr,
+                                   const value_idx* query_indices,
+                                   const value_t* query_data,
+                                   value_idx n_queries,
+                                   value_idx query_nnz,
+                                   const value_idx* post_indptr,
+                                   const value_idx* post_docs,
+                                   const value_t* post_data,
+                                   const uint64_t* work_offsets,
+                                   uint64_t work_begin,
+                                   uint64_t work_end,
+                                   value_idx q0,
+                                   value_idx n_docs,
+                                   int items_per_thread,
+                                   uint64_t* keys,
+                                   value_t* products)
+{
+  uint64_t begin =
+    work_begin + (uint64_t(blockIdx.x) * blockDim.x + threadIdx.x) * items_per_thread;
+  if (begin >= work_end) return;
+  uint64_t end = min(begin + items_per_thread, work_end);
+
+  using raft::sparse::distance::detail::merge_path_search;
+  int64_t e = merge_path_search(work_offsets, int64_t(query_nnz) + 1, begin);
+  int64_t q = merge_path_search(query_indptr, int64_t(n_queries) + 1, e);
+
+  for (uint64_t p = begin; p < end;) {
+    while (work_offsets[e + 1] <= p) {
+      e++;
+    }
+    while (query_indptr[q + 1] <= e) {
+      q++;
+    }
+
+    value_t q_val     = query_data[e];
+    uint64_t stop     = min(end, work_offsets[e + 1]);
+    value_idx j       = post_indptr[query_indices[e]] + value_idx(p - work_offsets[e]);
+    uint64_t key_base = uint64_t(q - q0) * n_docs;
+    for (; p < stop; p++, j++) {
+      keys[p - work_begin]     = key_base + post_docs[j];
+      products[p - work_begin] = q_val * post_data[j];
+    }
+  }
+}
+
+/**
+ * Selects the k best documents of every query among the scored candidates (the documents
+ * sharing at least one column with the query). When a query has less than k candidates, the
+ * remaining slots are filled with the documents of the smallest ids not among the candidates,
+ * all at the distance `fill_value` of a document with no overlap.
+ */
+template <int Capacity, bool Ascending, typename value_idx, typename value_t>
+__launch_bounds__(256) RAFT_KERNEL select_candidates_kernel(const uint64_t* keys,
+                                                            const value_t* dists,
+                                                            const uint64_t* segments,
+                                                            value_idx n_docs,
+                                                            int k,
+                                                            value_t fill_value,
+                                                            value_t* out_dists,
+                                                            value_idx* out_indices)
+{
+  extern __shared__ __align__(256) uint8_t smem_buf_bytes[];
+  using namespace raft::matrix::detail::select::warpsort;
+  using bq_t    = block_sort<warp_sort_filtered, Capacity, Ascending, value_t, value_idx>;
+  using queue_t = typename bq_t::queue_t;
+  bq_t queue(k);
+
+  const uint64_t start    = segments[blockIdx.x];
+  const uint64_t len      = segments[blockIdx.x + 1] - start;
+  const uint64_t key_base = uint64_t(blockIdx.x) * n_docs;
+  const uint64_t lim      = len + laneId();
+  for (uint64_t i = threadIdx.x; i < lim; i += blockDim.x) {
+    queue.add(i < len ? dists[start + i] : queue_t::kDummy,
+              i < len ? value_idx(keys[start + i] - key_base) : value_idx{});
+  }
+  queue.done(smem_buf_bytes);
+
+  out_dists += uint64_t(blockIdx.x) * k;
+  out_indices += uint64_t(blockIdx.x) * k;
+  queue.store(out_dists, out_indices);
+  __syncthreads();
+
+  if (len < uint64_t(k) && threadIdx.x == 0) {
+    value_idx doc = 0;
+    for (int j = len; j < k; j++, doc++) {
+      // the candidates are sorted by document: skip those already selected
+      while (true) {
+        uint64_t lo = 0, hi = len, key = key_base + doc;
+        while (lo < hi) {
+          auto mid = (lo + hi) / 2;
+          if (keys[start + mid] < key) {
+            lo = mid + 1;
+          } else {
+            hi = mid;
+          }
+        }
+        if (lo == len || keys[start + lo] != key) { break; }
+        doc++;
+      }
+      out_dists[j]   = fill_value;
+      out_indices[j] = doc;
+    }
+  }
+}
+
+template <int Capacity, bool Ascending, typename value_idx, typename value_t>
+void select_candidates(const uint64_t* keys,
+                       const value_t* dists,
+                       const uint64_t* segments,
+                       value_idx n_queries,
+                       value_idx n_docs,
+                       int k,
+                       value_t fill_value,
+                       value_t* out_dists,
+                       value_idx* out_indices,
+                       cudaStream_t stream)
+{
+  if constexpr (Capacity > raft::WarpSize) {
+    if (k <= Capacity / 2) {
+      return select_candidates<Capacity / 2, Ascending>(
+        keys, dists, segments, n_queries, n_docs, k, fill_value, out_dists, out_indices, stream);
+    }
+  }
+  constexpr int kBlockSize   = 256;
+  constexpr int kSubwarpSize = std::min<int>(Capacity, raft::WarpSize);
+  int smem_size =
+    raft::matrix::detail::select::warpsort::calc_smem_size_for_block_wide<value_t, value_idx>(
+      kBlockSize / kSubwarpSize, k);
+  select_candidates_kernel<Capacity, Ascending><<<n_queries, kBlockSize, smem_size, stream>>>(
+    keys, dists, segments, n_docs, k, fill_value, out_dists, out_indices);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/**
+ * Fused sparse inner product / cosine kNN over an inverted index of the index matrix.
+ *
+ * Instead of computing dense [query batch, index batch] distance tiles, the index is
+ * transposed into posting lists (the documents of every column), and the products of the
+ * nonzeros of the queries with their posting lists are accumulated into sparse per-query scores
+ * (sort and reduce by (query, document)). Only the documents sharing at least one column with a
+ * query are ever scored; a per-query block-wide priority queue then selects the k best of them.
+ * The queries are processed in chunks of at most `max_products` expanded products, which bounds
+ * the memory independently of the number of documents.
+ *
+ * @param[in] handle raft resources
+ * @param[in] idxIndptr csr indptr of the index matrix [n_idx_rows + 1]
+ * @param[in] idxIndices csr column indices of the index matrix [idxNNZ]
+ * @param[in] idxData csr data of the index matrix [idxNNZ]
+ * @param[in] idxNNZ number of nonzeros of the index matrix
+ * @param[in] n_idx_rows number of rows of the index matrix
+ * @param[in] n_idx_cols number of columns of the index matrix
+ * @param[in] queryIndptr csr indptr of the query matrix [n_query_rows + 1]
+ * @param[in] queryIndices csr column indices of the query matrix [queryNNZ]
+ * @param[in] queryData csr data of the query matrix [queryNNZ]
+ * @param[in] queryNNZ number of nonzeros of the query matrix
+ * @param[in] n_query_rows number of rows of the query matrix
+ * @param[out] output_indices neighbors of every query [n_query_rows * k]
+ * @param[out] output_dists distances of every query [n_query_rows * k]
+ * @param[in] k number of neighbors, at most `kMaxCapacity`
+ * @param[in] metric InnerProduct or CosineExpanded
+ * @param[in] max_products maximum number of expanded products per chunk of queries
+ */
+template <typename value_idx, typename value_t>
+void inverted_knn(raft::resources const& handle,
+                  const value_idx* idxIndptr,
+                  const value_idx* idxIndices,
+                  const value_t* idxData,
+                  size_t idxNNZ,
+                  value_idx n_idx_rows,
+                  value_idx n_idx_cols,
+                  const value_idx* queryIndptr,
+                  const value_idx* queryIndices,
+                  const value_t* queryData,
+                  size_t queryNNZ,
+                  value_idx n_query_rows,
+                  value_idx* output_indices,
+                  value_t* output_dists,
+                  int k,
+                  raft::distance::DistanceType metric,
+                  uint64_t max_products = uint64_t(1) << 26)
+{
+  common::nvtx::range<common::nvtx::domain::raft> fun_scope(
+    "sparse::inverted_knn(%d, %d, k = %d)", int(n_query_rows), int(n_idx_rows), k);
+  RAFT_EXPECTS(inverted_knn_supported(metric, k),
+               "The inverted index kNN supports InnerProduct and CosineExpanded with k <= %d",
+               raft::matrix::detail::select::warpsort::kMaxCapacity);
+  RAFT_EXPECTS(k <= n_idx_rows, "k must not exceed the number of index rows");
+  if (n_query_rows == 0) { return; }
+
+  auto stream = resource::get_cuda_stream(handle);
+  auto policy = resource::get_thrust_policy(handle);
+
+  const bool cosine = metric == raft::distance::DistanceType::CosineExpanded;
+
+  // 1. the posting lists: the index matrix in CSC layout
+  rmm::device_uvector<value_idx> post_cols(idxNNZ, stream);
+  rmm::device_uvector<value_idx> post_docs(idxNNZ, stream);
+  rmm::device_uvector<value_t> post_data(idxNNZ, stream);
+  rmm::device_uvector<value_idx> post_indptr(n_idx_cols + 1, stream);
+  raft::copy(post_cols.data(), idxIndices, idxNNZ, stream);
+  raft::copy(post_data.data(), idxData, idxNNZ, stream);
+  raft::sparse::convert::csr_to_coo(
+    idxIndptr, n_idx_rows, post_docs.data(), value_idx(idxNNZ), stream);
+  thrust::stable_sort_by_key(
+    policy,
+    post_cols.begin(),
+    post_cols.end(),
+    thrust::make_zip_iterator(thrust::make_tuple(post_docs.begin(), post_data.begin())));
+  raft::sparse::convert::sorted_coo_to_csr(
+    post_cols.data(), int(idxNNZ), post_indptr.data(), n_idx_cols + 1, stream);
+
+  rmm::device_uvector<value_t> idx_norms(cosine ? n_idx_rows : 0, stream);
+  rmm::device_uvector<value_t> query_norms(cosine ? n_query_rows : 0, stream);
+  if (cosine) {
+    raft::sparse::linalg::rowNormCsr(handle,
+                                     idxIndptr,
+                                     idxData,
+                                     value_idx(idxNNZ),
+                                     n_idx_rows,
+                                     idx_norms.data(),
+                                     raft::linalg::L2Norm,
+                                     raft::sqrt_op());
+    raft::sparse::linalg::rowNormCsr(handle,
+                                     queryIndptr,
+                                     queryData,
+                                     value_idx(queryNNZ),
+                                     n_query_rows,
+                                     query_norms.data(),
+                                     raft::linalg::L2Norm,
+                                     raft::sqrt_op());
+  }
+
+  // 2. the number of products of every query nonzero, and of every query
+  rmm::device_uvector<uint64_t> work_offsets(queryNNZ + 1, stream);
+  work_offsets.set_element_to_zero_async(0, stream);
+  auto post_ptr = post_indptr.data();
+  thrust::transform(policy,
+                    queryIndices,
+                    queryIndices + queryNNZ,
+                    work_offsets.begin() + 1,
+                    [post_ptr] __device__(value_idx col) {
+                      return static_cast<uint64_t>(post_ptr[col + 1] - post_ptr[col]);
+                    });
+  thrust::inclusive_scan(
+    policy, work_offsets.begin() + 1, work_offsets.end(), work_offsets.begin() + 1);
+  rmm::device_uvector<uint64_t> query_work(n_query_rows + 1, stream);
+  thrust::gather(
+    policy, queryIndptr, queryIndptr + n_query_rows + 1, work_offsets.begin(), query_work.begin());
+  std::vector<uint64_t> h_query_work(n_query_rows + 1);
+  raft::update_host(h_query_work.data(), query_work.data(), n_query_rows + 1, stream);
+  resource::sync_stream(handle, stream);
+
+  // 3. the queries, in chunks of bounded numbers of products
+  constexpr int kItemsPerThread = 16;
+  constexpr int kBlockSize      = 256;
+  const value_t fill_value      = cosine ? value_t(1) : value_t(0);
+  rmm::device_uvector<uint64_t> keys(0, stream);
+  rmm::device_uvector<value_t> products(0, stream);
+  rmm::device_uvector<uint64_t> segments(0, stream);
+  for (value_idx q0 = 0; q0 < n_query_rows;) {
+    value_idx q1 = q0 + 1;
+    while (q1 < n_query_rows && h_query_work[q1 + 1] - h_query_work[q0] <= max_products) {
+      q1++;
+    }
+    value_idx n_queries = q1 - q0;
+    uint64_t work_begin = h_query_work[q0];
+    uint64_t n_products = h_query_work[q1] - work_begin;
+
+    keys.resize(n_products, stream);
+    products.resize(n_products, stream);
+    uint64_t n_candidates = 0;
+    if (n_products > 0) {
+      uint64_t n_threads = raft::ceildiv<uint64_t>(n_products, kItemsPerThread);
+      uint64_t n_blocks  = raft::ceildiv<uint64_t>(n_threads, kBlockSize);
+      expand_postings_kernel<<<n_blocks, kBlockSize, 0, stream>>>(
+        queryIndptr,
+        queryIndices,
+        queryData,
+        n_query_rows,
+        value_idx(queryNNZ),
+        post_indptr.data(),
+        post_docs.data(),
+        post_data.data(),
+        work_offsets.data(),
+        work_begin,
+        work_begin + n_products,
+        q0,
+        n_idx_rows,
+        kItemsPerThread,
+        keys.data(),
+        products.data());
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+      // the score of every (query, candidate) pair
+      thrust::sort_by_key(policy, keys.begin(), keys.end(), products.begin());
+      auto reduced = thrust::reduce_by_key(
+        policy, keys.begin(), keys.end(), products.begin(), keys.begin(), products.begin());
+      n_candidates = reduced.first - keys.begin();
+
+      if (cosine) {
+        auto q_norms = query_norms.data() + q0;
+        auto d_norms = idx_norms.data();
+        thrust::transform(policy,
+                          keys.begin(),
+                          keys.begin() + n_candidates,
+                          products.begin(),
+                          products.begin(),
+                          [q_norms, d_norms, n_idx_rows] __device__(uint64_t key, value_t score) {
+                            value_t denom = q_norms[key / n_idx_rows] * d_norms[key % n_idx_rows];
+                            return denom > value_t(0) ? value_t(1) - score / denom : value_t(1);
+                          });
+      }
+    }
+
+    // the candidates of every query
+    segments.resize(n_queries + 1, stream);
+    auto segment_keys = thrust::make_transform_iterator(
+      thrust::make_counting_iterator<uint64_t>(0),
+      [n_idx_rows] __device__(uint64_t q) { return q * n_idx_rows; });
+    thrust::lower_bound(policy,
+                        keys.begin(),
+                        keys.begin() + n_candidates,
+                        segment_keys,
+                        segment_keys + n_queries + 1,
+                        segments.begin());
+
+    constexpr int kCapacity = raft::matrix::detail::select::warpsort::kMaxCapacity;
+    if (cosine) {
+      select_candidates<kCapacity, true>(keys.data(),
+                                         products.data(),
+                                         segments.data(),
+                                         n_queries,
+                                         n_idx_rows,
+                                         k,
+                                         fill_value,
+                                         output_dists + uint64_t(q0) * k,
+                                         output_indices + uint64_t(q0) * k,
+                                         stream);
+    } else {
+      select_candidates<kCapacity, false>(keys.data(),
+                                          products.data(),
+                                          segments.data(),
+                                          n_queries,
+                                          n_idx_rows,
+                                          k,
+                                          fill_value,
+                                          output_dists + uint64_t(q0) * k,
+                                          output_indices + uint64_t(q0) * k,
+                                          stream);
+    }
+    q0 = q1;
+  }
+}
+
+}  // namespace raft::sparse::neighbors::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -29,6 +29,7 @@
 #include <raft/sparse/csr.hpp>
 #include <raft/sparse/detail/utils.h>
 #include <raft/sparse/distance/distance.cuh>
+#include <raft/sparse/neighbors/detail/inverted_knn.cuh>
 #include <raft/sparse/op/slice.cuh>
 
 #include <algorithm>
@@ -161,6 +162,28 @@ class sparse_knn_t {
   {
     using namespace raft::sparse;
 
+    // Inner products only need the documents sharing columns with the queries: search an
+    // inverted index instead of computing dense distance tiles.
+    if (inverted_knn_supported(metric, k) && k <= n_idx_rows) {
+      inverted_knn<value_idx, value_t>(handle,
+                                       idxIndptr,
+                                       idxIndices,
+                                       idxData,
+                                       idxNNZ,
+                                       n_idx_rows,
+                                       n_idx_cols,
+                                       queryIndptr,
+                                       queryIndices,
+                                       queryData,
+                                       queryNNZ,
+                                       n_query_rows,
+                                       output_indices,
+                                       output_dists,
+                                       k,
+                                       metric);
+      return;
+    }
+
     int n_batches_query = raft::ceildiv((size_t)n_query_rows, batch_size_query);
     csr_batcher_t<value_idx, value_t> query_batcher(
       batch_size_query, n_query_rows, queryIndptr, queryIndices, queryData);
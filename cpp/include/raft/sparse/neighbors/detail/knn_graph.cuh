@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,6 +20,7 @@
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
 
+#include <raft/sparse/convert/coo.cuh>
 #include <raft/sparse/coo.hpp>
 #include <raft/sparse/linalg/symmetrize.cuh>
 
@@ -38,21 +39,6 @@
 
 namespace raft::sparse::neighbors::detail {
 
-/**
- * Fills indices array of pairwise distance array
- * @tparam value_idx
- * @param indices
- * @param m
- */
-template <typename value_idx>
-RAFT_KERNEL fill_indices(value_idx* indices, size_t m, size_t nnz)
-{
-  value_idx tid = (blockIdx.x * blockDim.x) + threadIdx.x;
-  if (tid >= nnz) return;
-  value_idx v  = tid / m;
-  indices[tid] = v;
-}
-
 template <typename value_idx>
 value_idx build_k(value_idx n_samples, int c)
 {
@@ -78,44 +64,31 @@ void conv_indices(in_t* inds, out_t* out, size_t size, cudaStream_t stream)
 }
 
 /**
- * Constructs a (symmetrized) knn graph edge list from
- * dense input vectors.
- *
- * Note: The resulting KNN graph is not guaranteed to be connected.
+ * Computes the k nearest neighbors of the rows of X (including themselves).
  *
- * @tparam value_idx
- * @tparam value_t
  * @param[in] handle raft handle
  * @param[in] X dense matrix of input data samples and observations
  * @param[in] m number of data samples (rows) in X
  * @param[in] n number of observations (columns) in X
  * @param[in] metric distance metric to use when constructing neighborhoods
- * @param[out] out output edge list
- * @param[out] out output edge list
- * @param c
+ * @param[in] k number of neighbors
+ * @param[out] indices the neighbors (m, k)
+ * @param[out] dists the distances to the neighbors (m, k)
  */
-template <typename value_idx = int, typename value_t = float>
-void knn_graph(raft::resources const& handle,
-               const value_t* X,
-               size_t m,
-               size_t n,
-               raft::distance::DistanceType metric,
-               raft::sparse::COO<value_t, value_idx>& out,
-               int c = 15)
+template <typename value_idx, typename value_t>
+void knn_graph_neighbors(raft::resources const& handle,
+                         const value_t* X,
+                         size_t m,
+                         size_t n,
+                         raft::distance::DistanceType metric,
+                         size_t k,
+                         value_idx* indices,
+                         value_t* dists)
 {
-  size_t k = build_k(m, c);
-
   auto stream = resource::get_cuda_stream(handle);
 
   size_t nnz = m * k;
 
-  rmm::device_uvector<value_idx> rows(nnz, stream);
-  rmm::device_uvector<value_idx> indices(nnz, stream);
-  rmm::device_uvector<value_t> data(nnz, stream);
-
-  size_t blocks = ceildiv(nnz, (size_t)256);
-  fill_indices<value_idx><<<blocks, 256, 0, stream>>>(rows.data(), k, nnz);
-
   std::vector<value_t*> inputs;
   inputs.push_back(const_cast<value_t*>(X));
 
@@ -133,7 +106,7 @@ void knn_graph(raft::resources const& handle,
                                                                 const_cast<value_t*>(X),
                                                                 m,
                                                                 int64_indices.data(),
-                                                                data.data(),
+                                                                dists,
                                                                 k,
                                                                 true,
                                                                 true,
@@ -141,10 +114,91 @@ void knn_graph(raft::resources const& handle,
                                                                 metric);
 
   // convert from current knn's 64-bit to 32-bit.
-  conv_indices(int64_indices.data(), indices.data(), nnz, stream);
+  conv_indices(int64_indices.data(), indices, nnz, stream);
+}
+
+/**
+ * Constructs a symmetrized knn graph in the CSR format from
+ * dense input vectors.
+ *
+ * The graph is built directly from the neighbor matrix by
+ * `raft::sparse::linalg::symmetrize_knn_csr`, without doubling
+ * and sorting the edges.
+ *
+ * Note: The resulting KNN graph is not guaranteed to be connected.
+ *
+ * @tparam value_idx
+ * @tparam value_t
+ * @param[in] handle raft handle
+ * @param[in] X dense matrix of input data samples and observations
+ * @param[in] m number of data samples (rows) in X
+ * @param[in] n number of observations (columns) in X
+ * @param[in] metric distance metric to use when constructing neighborhoods
+ * @param[out] indptr output row offsets (resized to m + 1)
+ * @param[out] indices output column indices (resized to nnz)
+ * @param[out] data output distances (resized to nnz)
+ * @param c
+ */
+template <typename value_idx = int, typename value_t = float>
+void knn_graph(raft::resources const& handle,
+               const value_t* X,
+               size_t m,
+               size_t n,
+               raft::distance::DistanceType metric,
+               rmm::device_uvector<value_idx>& indptr,
+               rmm::device_uvector<value_idx>& indices,
+               rmm::device_uvector<value_t>& data,
+               int c = 15)
+{
+  size_t k = build_k(m, c);
+
+  auto stream = resource::get_cuda_stream(handle);
+
+  rmm::device_uvector<value_idx> knn_indices(m * k, stream);
+  rmm::device_uvector<value_t> knn_dists(m * k, stream);
+  knn_graph_neighbors(handle, X, m, n, metric, k, knn_indices.data(), knn_dists.data());
+
+  raft::sparse::linalg::symmetrize_knn_csr(
+    handle, knn_indices.data(), knn_dists.data(), m, int(k), indptr, indices, data);
+}
+
+/**
+ * Constructs a (symmetrized) knn graph edge list from
+ * dense input vectors.
+ *
+ * Note: The resulting KNN graph is not guaranteed to be connected.
+ *
+ * @tparam value_idx
+ * @tparam value_t
+ * @param[in] handle raft handle
+ * @param[in] X dense matrix of input data samples and observations
+ * @param[in] m number of data samples (rows) in X
+ * @param[in] n number of observations (columns) in X
+ * @param[in] metric distance metric to use when constructing neighborhoods
+ * @param[out] out output edge list (sorted by row)
+ * @param c
+ */
+template <typename value_idx = int, typename value_t = float>
+void knn_graph(raft::resources const& handle,
+               const value_t* X,
+               size_t m,
+               size_t n,
+               raft::distance::DistanceType metric,
+               raft::sparse::COO<value_t, value_idx>& out,
+               int c = 15)
+{
+  auto stream = resource::get_cuda_stream(handle);
+
+  rmm::device_uvector<value_idx> indptr(0, stream);
+  rmm::device_uvector<value_idx> indices(0, stream);
+  rmm::device_uvector<value_t> data(0, stream);
+  knn_graph(handle, X, m, n, metric, indptr, indices, data, c);
 
-  raft::sparse::linalg::symmetrize(
-    handle, rows.data(), indices.data(), data.data(), m, k, nnz, out);
+  value_idx nnz = indices.size();
+  out.allocate(nnz, m, m, false, stream);
+  raft::sparse::convert::csr_to_coo(indptr.data(), value_idx(m), out.rows(), nnz, stream);
+  raft::copy_async(out.cols(), indices.data(), nnz, stream);
+  raft::copy_async(out.vals(), data.data(), nnz, stream);
 }
 
 };  // namespace raft::sparse::neighbors::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,6 +20,8 @@
 #include <raft/sparse/coo.hpp>
 #include <raft/sparse/neighbors/detail/knn_graph.cuh>
 
+#include <rmm/device_uvector.hpp>
+
 #include <cstdint>
 
 namespace raft::sparse::neighbors {
@@ -52,4 +54,41 @@ void knn_graph(raft::resources const& handle,
   detail::knn_graph(handle, X, m, n, metric, out, c);
 }
 
+/**
+ * Constructs a symmetrized knn graph in the CSR format from
+ * dense input vectors.
+ *
+ * The symmetric graph is built directly from the neighbor matrix
+ * (see `raft::sparse::linalg::symmetrize_knn_csr`), which avoids
+ * doubling and sorting the edges of the COO path. Each row holds
+ * its nearest neighbors followed by its reverse neighbors.
+ *
+ * Note: The resulting KNN graph is not guaranteed to be connected.
+ *
+ * @tparam value_idx
+ * @tparam value_t
+ * @param[in] handle raft handle
+ * @param[in] X dense matrix of input data samples and observations
+ * @param[in] m number of data samples (rows) in X
+ * @param[in] n number of observations (columns) in X
+ * @param[in] metric distance metric to use when constructing neighborhoods
+ * @param[out] indptr output row offsets (resized to m + 1)
+ * @param[out] indices output column indices (resized to nnz)
+ * @param[out] data output distances (resized to nnz)
+ * @param c
+ */
+template <typename value_idx = int, typename value_t = float>
+void knn_graph(raft::resources const& handle,
+               const value_t* X,
+               std::size_t m,
+               std::size_t n,
+               raft::distance::DistanceType metric,
+               rmm::device_uvector<value_idx>& indptr,
+               rmm::device_uvector<value_idx>& indices,
+               rmm::device_uvector<value_t>& data,
+               int c = 15)
+{
+  detail::knn_graph(handle, X, m, n, metric, indptr, indices, data, c);
+}
+
 };  // namespace raft::sparse::neighbors
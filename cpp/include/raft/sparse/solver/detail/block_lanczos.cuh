@@ -0,0 +1,468 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cublas_handle.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/detail/cublas_wrappers.hpp>
+#include <raft/linalg/eig.cuh>
+#include <raft/linalg/map.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/sparse/linalg/detail/distributed_spmm.cuh>
+#include <raft/sparse/linalg/distributed_csr_matrix.hpp>
+#include <raft/sparse/solver/lanczos_types.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace raft::sparse::solver::detail {
+
+/*
+ * Block Lanczos with thick restarts.
+ *
+ * The Krylov basis V [n, ncv + b] is built by blocks of b vectors: every step multiplies the
+ * last block by A in one SpMM, and the product is orthogonalized against the whole basis by
+ * two passes of block classical Gram-Schmidt (GEMMs), then column by column within the block.
+ * The coefficients give the columns of the projected matrix T = V^T A V, which is block
+ * tridiagonal after a cold start and an arrow matrix after a restart. When the basis is full,
+ * the Ritz pairs of T are computed; the ones wanted the most are kept as the start of the next
+ * basis (with the last block, orthogonal to all of them), so that no Krylov information on
+ * them is lost.
+ *
+ * With a communicator, every rank holds a block of rows of A (with the global column indices)
+ * and the same rows of the basis: the halo rows of the blocks multiplied by A are exchanged
+ * (see `raft::sparse::linalg::distributed_csr_matrix`), and the projections and the norms are
+ * summed over the ranks. The projected matrix is small and replicated.
+ */
+
+/** Sum a device buffer over the ranks (a no-op without a communicator). */
+template <typename T>
+void sum_over_ranks(const raft::comms::comms_t* comms, T* buf, size_t len, cudaStream_t stream)
+{
+  if (comms == nullptr) { return; }
+  comms->allreduce(buf, buf, len, raft::comms::op_t::SUM, stream);
+  RAFT_EXPECTS(comms->sync_stream(stream) == raft::comms::status_t::SUCCESS,
+               "block_lanczos: the allreduce failed");
+}
+
+/** C = alpha op(A) op(B) + beta C, all column-major. */
+template <typename T>
+void block_gemm(raft::resources const& handle,
+                bool trans_a,
+                int m,
+                int n,
+                int k,
+                T alpha,
+                const T* a,
+                int lda,
+                const T* b,
+                int ldb,
+                T beta,
+                T* c,
+                int ldc)
+{
+  RAFT_CUBLAS_TRY(raft::linalg::detail::cublasgemm(resource::get_cublas_handle(handle),
+                                                   trans_a ? CUBLAS_OP_T : CUBLAS_OP_N,
+                                                   CUBLAS_OP_N,
+                                                   m,
+                                                   n,
+                                                   k,
+                                                   &alpha,
+                                                   a,
+                                                   lda,
+                                                   b,
+                                                   ldb,
+                                                   &beta,
+                                                   c,
+                                                   ldc,
+                                                   resource::get_cuda_stream(handle)));
+}
+
+/** The 2-norm of the (distributed) vector x [len]. */
+template <typename T>
+auto global_norm(raft::resources const& handle,
+                 const raft::comms::comms_t* comms,
+                 const T* x,
+                 int len) -> T
+{
+  auto stream = resource::get_cuda_stream(handle);
+  rmm::device_scalar<T> sq(stream);
+  block_gemm<T>(handle, true, 1, 1, len, T(1), x, len, x, len, T(0), sq.data(), 1);
+  sum_over_ranks(comms, sq.data(), 1, stream);
+  return std::sqrt(sq.value(stream));
+}
+
+/**
+ * W -= V (V^T W), twice (classical Gram-Schmidt with reorthogonalization), for the orthonormal
+ * V [n_local, n_basis] and W [n_local, n_cols]; the sum of the two projections is returned in
+ * h [n_basis, n_cols] (host, column-major).
+ */
+template <typename T>
+void project_out(raft::resources const& handle,
+                 const raft::comms::comms_t* comms,
+                 const T* V,
+                 int n_local,
+                 int n_basis,
+                 T* W,
+                 int n_cols,
+                 std::vector<T>& h)
+{
+  h.assign(size_t(n_basis) * n_cols, T(0));
+  if (n_basis == 0) { return; }
+  auto stream = resource::get_cuda_stream(handle);
+  rmm::device_uvector<T> h_dev(h.size(), stream);
+  std::vector<T> h_pass(h.size());
+  for (int pass = 0; pass < 2; pass++) {
+    auto* h_ptr = h_dev.data();
+    block_gemm<T>(
+      handle, true, n_basis, n_cols, n_local, T(1), V, n_local, W, n_local, T(0), h_ptr, n_basis);
+    sum_over_ranks(comms, h_ptr, h.size(), stream);
+    block_gemm<T>(
+      handle, false, n_local, n_cols, n_basis, T(-1), V, n_local, h_ptr, n_basis, T(1), W, n_local);
+    raft::update_host(h_pass.data(), h_dev.data(), h_dev.size(), stream);
+    resource::sync_stream(handle, stream);
+    for (size_t i = 0; i < h.size(); i++) {
+      h[i] += h_pass[i];
+    }
+  }
+}
+
+/**
+ * Orthonormalize the block W = V[:, n_basis : n_basis + b] against the columns before it:
+ * W = V[:, :n_basis] h + Q r, with Q overwriting W and r [b, b] upper triangular (host,
+ * column-major). The directions of W below the rounding errors of `scale` (the norm of W before
+ * the projection) are replaced by random vectors orthogonal to the basis, with a zero diagonal
+ * in r, so that Q always extends the basis even when the Krylov space is invariant.
+ */
+template <typename T>
+void orthonormalize_block(raft::resources const& handle,
+                          const raft::comms::comms_t* comms,
+                          raft::random::RngState& rng,
+                          T* V,
+                          int n_local,
+                          int n_basis,
+                          int b,
+                          T scale,
+                          std::vector<T>& h,
+                          std::vector<T>& r)
+{
+  T* W = V + size_t(n_basis) * n_local;
+  project_out(handle, comms, V, n_local, n_basis, W, b, h);
+
+  const T tiny = T(100) * std::numeric_limits<T>::epsilon() * scale;
+  r.assign(size_t(b) * b, T(0));
+  std::vector<T> coef;
+  for (int c = 0; c < b; c++) {
+    T* w = W + size_t(c) * n_local;
+    project_out(handle, comms, W, n_local, c, w, 1, coef);
+    for (int i = 0; i < c; i++) {
+      r[size_t(c) * b + i] = coef[i];
+    }
+    T norm = global_norm(handle, comms, w, n_local);
+    if (norm > tiny) {
+      r[size_t(c) * b + c] = norm;
+    } else {
+      raft::random::normal(handle, rng, w, n_local, T(0), T(1));
+      project_out(handle, comms, V, n_local, n_basis + c, w, 1, coef);
+      norm = global_norm(handle, comms, w, n_local);
+    }
+    raft::linalg::map_offset(handle,
+                             raft::make_device_vector_view<T, int>(w, n_local),
+                             [w, inv = T(1) / norm] __device__(int i) { return w[i] * inv; });
+  }
+}
+
+/**
+ * Y [n_local, b] = S A S X, exchanging the halo rows of X [n_local, b] with the other ranks first,
+ * with S = diag(scale) (the identity without a scale; x_scaled [n_local, b] is the workspace of
+ * S X).
+ */
+template <typename T>
+void block_multiply(raft::resources const& handle,
+                    const raft::sparse::linalg::distributed_csr_matrix<T>& A,
+                    const T* scale,
+                    const T* X,
+                    T* x_scaled,
+                    int b,
+                    T* Y)
+{
+  const T alpha = 1;
+  const T beta  = 0;
+  int n_local   = A.n_local_rows();
+  if (scale != nullptr) {
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<T, int64_t>(x_scaled, int64_t(n_local) * b),
+      [X, scale, n_local] __device__(int64_t i) { return X[i] * scale[i % n_local]; });
+    X = x_scaled;
+  }
+  raft::sparse::linalg::detail::distributed_spmm(handle, A, &alpha, X, b, &beta, Y);
+  if (scale != nullptr) {
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<T, int64_t>(Y, int64_t(n_local) * b),
+      [Y, scale, n_local] __device__(int64_t i) { return Y[i] * scale[i % n_local]; });
+  }
+}
+
+/**
+ * The eigenpairs of the symmetric T [nb, nb] (host, leading dimension ld): theta ascending and
+ * the eigenvectors s [nb, nb] (host, column-major). The ones of the first rank are broadcast, so
+ * that all the ranks restart the same way.
+ */
+template <typename T>
+void ritz_pairs(raft::resources const& handle,
+                const raft::comms::comms_t* comms,
+                const std::vector<T>& t,
+                int ld,
+                int nb,
+                std::vector<T>& theta,
+                std::vector<T>& s)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  std::vector<T> packed(size_t(nb) * nb);
+  for (int j = 0; j < nb; j++) {
+    auto col = t.begin() + size_t(j) * ld;
+    std::copy(col, col + nb, packed.begin() + size_t(j) * nb);
+  }
+  rmm::device_uvector<T> t_dev(packed.size(), stream);
+  rmm::device_uvector<T> s_dev(packed.size(), stream);
+  rmm::device_uvector<T> theta_dev(nb, stream);
+  raft::update_device(t_dev.data(), packed.data(), packed.size(), stream);
+  raft::linalg::eigDC(handle, t_dev.data(), nb, nb, s_dev.data(), theta_dev.data(), stream);
+  if (comms != nullptr) {
+    comms->bcast(s_dev.data(), s_dev.size(), 0, stream);
+    comms->bcast(theta_dev.data(), nb, 0, stream);
+    RAFT_EXPECTS(comms->sync_stream(stream) == raft::comms::status_t::SUCCESS,
+                 "block_lanczos: the broadcast of the Ritz pairs failed");
+  }
+  theta.resize(nb);
+  s.resize(packed.size());
+  raft::update_host(theta.data(), theta_dev.data(), nb, stream);
+  raft::update_host(s.data(), s_dev.data(), s.size(), stream);
+  resource::sync_stream(handle, stream);
+}
+
+/**
+ * The eigenpairs of the symmetric A (or of the rows of A held by this rank, with a
+ * communicator): eigenvalues [n_components] in the order of `which` (the most wanted first) and
+ * eigenvectors [n_local, n_components] (column-major).
+ *
+ * With a scale [n_local], the eigenpairs are those of S A S, S = diag(scale), applied without
+ * forming the product (e.g. the normalized adjacency D^-1/2 A D^-1/2 of a graph).
+ *
+ * The starting block is random, or made of the n_initial columns of initial [n_local, n_initial]
+ * (e.g. the eigenvectors of a previous, similar problem): the column c of the block is the sum of
+ * the columns j of initial with j % block_size == c, and the columns beyond n_initial stay random.
+ */
+template <typename T>
+auto block_lanczos(raft::resources const& handle,
+                   const raft::comms::comms_t* comms,
+                   block_lanczos_config<T> const& config,
+                   raft::device_csr_matrix_view<const T, int, int, int> A,
+                   T* eigenvalues,
+                   T* eigenvectors,
+                   const T* scale   = nullptr,
+                   const T* initial = nullptr,
+                   int n_initial    = 0) -> block_lanczos_result
+{
+  auto stream = resource::get_cuda_stream(handle);
+  int n_local = A.structure_view().get_n_rows();
+  int n       = A.structure_view().get_n_cols();
+  int k       = config.n_components;
+  int b       = config.block_size;
+  int ncv     = config.ncv > 0 ? config.ncv : std::max(2 * k, k + 2 * b);
+  RAFT_EXPECTS(k > 0 && b > 0, "block_lanczos: n_components and block_size must be positive");
+  RAFT_EXPECTS(ncv >= k + b, "block_lanczos: ncv must be at least n_components + block_size");
+  RAFT_EXPECTS(ncv + b <= n,
+               "block_lanczos: ncv + block_size must not exceed the size of the matrix");
+
+  // the rows of every rank and the plan of the halo exchanges of the products
+  auto A_dist = raft::sparse::linalg::detail::make_distributed_csr_matrix(handle, comms, A);
+
+  int ld = ncv + b;
+  rmm::device_uvector<T> V(size_t(n_local) * ld, stream);
+  rmm::device_uvector<T> restart_buf(size_t(n_local) * ld, stream);
+
+  rmm::device_uvector<T> x_scaled(scale != nullptr ? size_t(n_local) * b : 0, stream);
+
+  raft::random::RngState rng(config.seed + uint64_t(comms != nullptr ? comms->get_rank() : 0));
+  raft::random::normal(handle, rng, V.data(), size_t(n_local) * b, T(0), T(1));
+  if (initial != nullptr && n_initial > 0) {
+    // the warm start: the initial vectors folded into the columns of the block
+    const int64_t n_folded = int64_t(n_local) * std::min(b, n_initial);
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<T, int64_t>(V.data(), n_folded),
+      [initial, n_initial, n_local, b] __device__(int64_t i) {
+        T sum = 0;
+        for (int64_t j = i / n_local; j < n_initial; j += b) {
+          sum += initial[j * n_local + i % n_local];
+        }
+        return sum;
+      });
+  }
+  std::vector<T> h, r, theta, s;
+  orthonormalize_block(handle, comms, rng, V.data(), n_local, 0, b, T(1), h, r);
+
+  // T = V^T A V (host, column-major, leading dimension ld) and the coupling r_last of the last
+  // block of the basis to the block after it
+  std::vector<T> t(size_t(ld) * ld, T(0));
+  std::vector<T> r_last(size_t(b) * b, T(0));
+  std::vector<int> order;
+  block_lanczos_result result;
+  int cols = b;  // the orthonormal columns of V; the last block is not multiplied by A yet
+  int nb   = 0;
+  for (;;) {
+    while (cols <= ncv) {
+      int a0 = cols - b;
+      T* W   = V.data() + size_t(cols) * n_local;
+      block_multiply(
+        handle, A_dist, scale, V.data() + size_t(a0) * n_local, x_scaled.data(), b, W);
+      result.n_products++;
+      T scale = global_norm(handle, comms, W, n_local * b);
+      orthonormalize_block(handle, comms, rng, V.data(), n_local, cols, b, scale, h, r);
+      for (int c = 0; c < b; c++) {
+        for (int i = 0; i < a0; i++) {
+          t[size_t(a0 + c) * ld + i] = h[size_t(c) * cols + i];
+          t[size_t(i) * ld + a0 + c] = h[size_t(c) * cols + i];
+        }
+        for (int i = 0; i < b; i++) {
+          t[size_t(a0 + c) * ld + a0 + i] =
+            (h[size_t(c) * cols + a0 + i] + h[size_t(i) * cols + a0 + c]) / T(2);
+          t[size_t(a0 + c) * ld + cols + i] = r[size_t(c) * b + i];
+          t[size_t(cols + i) * ld + a0 + c] = r[size_t(c) * b + i];
+        }
+      }
+      r_last = r;
+      cols += b;
+    }
+    nb = cols - b;
+
+    ritz_pairs(handle, comms, t, ld, nb, theta, s);
+    order.resize(nb);
+    std::iota(order.begin(), order.end(), 0);
+    if (config.which == lanczos_which::LARGEST) { std::reverse(order.begin(), order.end()); }
+    // with A V = V T + V_next r_last E^T, the residual of the Ritz pair (theta_j, V s_j) is
+    // V_next r_last s_j[nb - b : nb]
+    auto coupling = [&](int j, int i) {
+      T u = 0;
+      for (int c = 0; c < b; c++) {
+        u += r_last[size_t(c) * b + i] * s[size_t(j) * nb + nb - b + c];
+      }
+      return u;
+    };
+    T a_norm       = std::max(std::abs(theta.front()), std::abs(theta.back()));
+    bool converged = true;
+    for (int i = 0; i < k && converged; i++) {
+      T res = 0;
+      for (int rr = 0; rr < b; rr++) {
+        T u = coupling(order[i], rr);
+        res += u * u;
+      }
+      converged = std::sqrt(res) <= config.tolerance * a_norm;
+    }
+    if (converged || result.n_restarts >= config.max_restarts) {
+      result.converged = converged;
+      break;
+    }
+    result.n_restarts++;
+
+    // thick restart: the `keep` most wanted Ritz vectors, then the block after the basis
+    int keep = std::min(ncv - b, std::max(k, (k + nb) / 2));
+    std::vector<T> s_keep(size_t(nb) * keep);
+    for (int i = 0; i < keep; i++) {
+      std::copy(s.begin() + size_t(order[i]) * nb,
+                s.begin() + size_t(order[i] + 1) * nb,
+                s_keep.begin() + size_t(i) * nb);
+    }
+    rmm::device_uvector<T> s_dev(s_keep.size(), stream);
+    raft::update_device(s_dev.data(), s_keep.data(), s_keep.size(), stream);
+    block_gemm<T>(handle,
+                  false,
+                  n_local,
+                  keep,
+                  nb,
+                  T(1),
+                  V.data(),
+                  n_local,
+                  s_dev.data(),
+                  nb,
+                  T(0),
+                  restart_buf.data(),
+                  n_local);
+    raft::copy(restart_buf.data() + size_t(keep) * n_local,
+               V.data() + size_t(nb) * n_local,
+               size_t(b) * n_local,
+               stream);
+    raft::copy(V.data(), restart_buf.data(), size_t(keep + b) * n_local, stream);
+
+    std::vector<T> t_next(t.size(), T(0));
+    for (int i = 0; i < keep; i++) {
+      t_next[size_t(i) * ld + i] = theta[order[i]];
+      for (int rr = 0; rr < b; rr++) {
+        T u                                = coupling(order[i], rr);
+        t_next[size_t(i) * ld + keep + rr] = u;
+        t_next[size_t(keep + rr) * ld + i] = u;
+      }
+    }
+    t.swap(t_next);
+    cols = keep + b;
+  }
+
+  std::vector<T> vals(k);
+  std::vector<T> s_out(size_t(nb) * k);
+  for (int i = 0; i < k; i++) {
+    vals[i] = theta[order[i]];
+    std::copy(s.begin() + size_t(order[i]) * nb,
+              s.begin() + size_t(order[i] + 1) * nb,
+              s_out.begin() + size_t(i) * nb);
+  }
+  rmm::device_uvector<T> s_dev(s_out.size(), stream);
+  raft::update_device(s_dev.data(), s_out.data(), s_out.size(), stream);
+  raft::update_device(eigenvalues, vals.data(), k, stream);
+  block_gemm<T>(handle,
+                false,
+                n_local,
+                k,
+                nb,
+                T(1),
+                V.data(),
+                n_local,
+                s_dev.data(),
+                nb,
+                T(0),
+                eigenvectors,
+                n_local);
+  resource::sync_stream(handle, stream);
+  return result;
+}
+
+}  // namespace raft::sparse::solver::detail
@@ -1,6 +1,6 @@
 
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -34,12 +34,11 @@ RAFT_KERNEL kernel_min_edge_per_vertex(const edge_t* offsets,
                                        edge_t* new_mst_edge,
                                        const bool* mst_edge,
                                        alteration_t* min_edge_color,
-                                       const vertex_t v)
+                                       const vertex_t* frontier,
+                                       const vertex_t n_frontier)
 {
-  edge_t tid = threadIdx.x + blockIdx.x * blockDim.x;
-
-  unsigned warp_id = tid / 32;
-  unsigned lane_id = tid % 32;
+  // one warp (block) per vertex of the frontier
+  unsigned lane_id = threadIdx.x;
 
   __shared__ edge_t min_edge_index[32];
   __shared__ alteration_t min_edge_weight[32];
@@ -51,30 +50,30 @@ RAFT_KERNEL kernel_min_edge_per_vertex(const edge_t* offsets,
 
   __syncthreads();
 
-  vertex_t self_color_idx = color_index[warp_id];
+  if (blockIdx.x >= n_frontier) { return; }
+  vertex_t vertex         = frontier[blockIdx.x];
+  vertex_t self_color_idx = color_index[vertex];
   vertex_t self_color     = color[self_color_idx];
 
   // find the minimum edge associated per row
   // each thread in warp holds the minimum edge for
   // only the edges that thread scanned
-  if (warp_id < v) {
-    // one row is associated with one warp
-    edge_t row_start = offsets[warp_id];
-    edge_t row_end   = offsets[warp_id + 1];
-
-    // assuming one warp per row
-    // find min for each thread in warp
-    for (edge_t e = row_start + lane_id; e < row_end; e += 32) {
-      alteration_t curr_edge_weight = weights[e];
-      vertex_t successor_color_idx  = color_index[indices[e]];
-      vertex_t successor_color      = color[successor_color_idx];
-
-      if (!mst_edge[e] && self_color != successor_color) {
-        if (curr_edge_weight < min_edge_weight[lane_id]) {
-          min_color[lane_id]       = successor_color;
-          min_edge_weight[lane_id] = curr_edge_weight;
-          min_edge_index[lane_id]  = e;
-        }
+  // one row is associated with one warp
+  edge_t row_start = offsets[vertex];
+  edge_t row_end   = offsets[vertex + 1];
+
+  // assuming one warp per row
+  // find min for each thread in warp
+  for (edge_t e = row_start + lane_id; e < row_end; e += 32) {
+    alteration_t curr_edge_weight = weights[e];
+    vertex_t successor_color_idx  = color_index[indices[e]];
+    vertex_t successor_color      = color[successor_color_idx];
+
+    if (!mst_edge[e] && self_color != successor_color) {
+      if (curr_edge_weight < min_edge_weight[lane_id]) {
+        min_color[lane_id]       = successor_color;
+        min_edge_weight[lane_id] = curr_edge_weight;
+        min_edge_index[lane_id]  = e;
       }
     }
   }
@@ -95,13 +94,16 @@ RAFT_KERNEL kernel_min_edge_per_vertex(const edge_t* offsets,
   }
 
   // min edge may now be found in first thread
+  // (no edge means that the vertex leaves the frontier)
   if (lane_id == 0) {
     if (min_edge_weight[0] != std::numeric_limits<alteration_t>::max()) {
-      new_mst_edge[warp_id] = min_edge_index[0];
+      new_mst_edge[vertex] = min_edge_index[0];
 
       // atomically set min edge per color
       // takes care of super vertex case
       atomicMin(&min_edge_color[self_color], min_edge_weight[0]);
+    } else {
+      new_mst_edge[vertex] = std::numeric_limits<edge_t>::max();
     }
   }
 }
@@ -327,7 +329,9 @@ RAFT_KERNEL kernel_count_new_mst_edges(const vertex_t* mst_src,
   bool predicate       = tid < v && (mst_src[tid] != std::numeric_limits<vertex_t>::max());
   vertex_t block_count = __syncthreads_count(predicate);
 
-  if (threadIdx.x == 0 && block_count > 0) { atomicAdd(mst_edge_count, block_count); }
+  if (threadIdx.x == 0 && block_count > 0) {
+    atomicAdd(mst_edge_count, static_cast<edge_t>(block_count));
+  }
 }
 
 }  // namespace raft::sparse::solver::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <curand.h>
+#include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/device_properties.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
 
@@ -28,6 +29,7 @@
 #include <rmm/device_scalar.hpp>
 #include <rmm/device_uvector.hpp>
 
+#include <cub/cub.cuh>
 #include <thrust/copy.h>
 #include <thrust/device_ptr.h>
 #include <thrust/execution_policy.h>
@@ -44,6 +46,7 @@
 #include <thrust/unique.h>
 
 #include <iostream>
+#include <utility>
 
 namespace raft::sparse::solver {
 
@@ -90,7 +93,14 @@ MST_solver<vertex_t, edge_t, weight_t, alteration_t>::MST_solver(raft::resources
     temp_dst(2 * v_, stream_),
     temp_weights(2 * v_, stream_),
     mst_edge_count(1, stream_),
-    prev_mst_edge_count(1, stream_),
+    prev_mst_edge_count(0),
+    frontier(v_, stream_),
+    next_frontier(v_, stream_),
+    next_frontier_size(stream_),
+    frontier_workspace(0, stream_),
+    frontier_size(v_),
+    status(raft::make_pinned_vector<edge_t, uint32_t>(handle_, 2)),
+    label_prop_done(raft::make_pinned_vector<bool, uint32_t>(handle_, 1)),
     stream(stream_),
     symmetrize_output(symmetrize_output_),
     initialize_colors(initialize_colors_),
@@ -101,7 +111,6 @@ MST_solver<vertex_t, edge_t, weight_t, alteration_t>::MST_solver(raft::resources
   sm_count    = resource::get_device_properties(handle_).multiProcessorCount;
 
   mst_edge_count.set_value_to_zero_async(stream);
-  prev_mst_edge_count.set_value_to_zero_async(stream);
   RAFT_CUDA_TRY(cudaMemsetAsync(mst_edge.data(), 0, mst_edge.size() * sizeof(bool), stream));
 
   // Initially, color holds the vertex id as color
@@ -113,6 +122,7 @@ MST_solver<vertex_t, edge_t, weight_t, alteration_t>::MST_solver(raft::resources
     raft::copy(color.data(), color_index, v, stream);
   }
   thrust::sequence(policy, next_color.begin(), next_color.end(), 0);
+  thrust::sequence(policy, frontier.begin(), frontier.end(), 0);
 }
 
 template <typename vertex_t, typename edge_t, typename weight_t, typename alteration_t>
@@ -137,24 +147,34 @@ Graph_COO<vertex_t, edge_t, weight_t> MST_solver<vertex_t, edge_t, weight_t, alt
   // Boruvka original formulation says "while more than 1 supervertex remains"
   // Here we adjust it to support disconnected components (spanning forest)
   // track completion with mst_edge_found status and v as upper bound
-  auto mst_iterations = iterations > 0 ? iterations : v;
+  auto mst_iterations        = iterations > 0 ? iterations : v;
+  edge_t curr_mst_edge_count = 0;
   for (auto i = 0; i < mst_iterations; i++) {
     // Finds the minimum edge from each vertex to the lowest color
     // by working at each vertex of the supervertex
     min_edge_per_vertex();
 
+    // drops the vertices without an edge out of their supervertex
+    compact_frontier();
+
     // Finds the minimum edge from each supervertex to the lowest color
     min_edge_per_supervertex();
 
     // check if msf/mst done, count new edges added
     check_termination();
 
-    auto curr_mst_edge_count = mst_edge_count.value(stream);
+    // the only synchronization of the iteration outside of label_prop: the device counters are
+    // read together through the pinned status buffer
+    raft::copy(status.data_handle(), mst_edge_count.data(), 1, stream);
+    raft::copy(status.data_handle() + 1, next_frontier_size.data(), 1, stream);
+    resource::sync_stream(handle, stream);
+    curr_mst_edge_count = status(0);
+    frontier_size       = static_cast<vertex_t>(status(1));
     RAFT_EXPECTS(curr_mst_edge_count <= max_mst_edges,
                  "Number of edges found by MST is invalid. This may be due to "
                  "loss in precision. Try increasing precision of weights.");
 
-    if (curr_mst_edge_count == prev_mst_edge_count.value(stream)) {
+    if (curr_mst_edge_count == prev_mst_edge_count) {
       // exit here when reaching steady state
       break;
     }
@@ -166,11 +186,11 @@ Graph_COO<vertex_t, edge_t, weight_t> MST_solver<vertex_t, edge_t, weight_t, alt
     label_prop(mst_result.src.data(), mst_result.dst.data());
 
     // copy this iteration's results and store
-    prev_mst_edge_count.set_value_async(curr_mst_edge_count, stream);
+    prev_mst_edge_count = curr_mst_edge_count;
   }
 
   // result packaging
-  mst_result.n_edges = mst_edge_count.value(stream);
+  mst_result.n_edges = curr_mst_edge_count;
   mst_result.src.resize(mst_result.n_edges, stream);
   mst_result.dst.resize(mst_result.n_edges, stream);
   mst_result.weights.resize(mst_result.n_edges, stream);
@@ -250,8 +270,6 @@ void MST_solver<vertex_t, edge_t, weight_t, alteration_t>::label_prop(vertex_t*
                                                                       vertex_t* mst_dst)
 {
   // update the colors of both ends its until there is no change in colors
-  edge_t curr_mst_edge_count = mst_edge_count.value(stream);
-
   auto min_pair_nthreads = std::min(v, (vertex_t)max_threads);
   auto min_pair_nblocks =
     std::min((v + min_pair_nthreads - 1) / min_pair_nthreads, (vertex_t)max_blocks);
@@ -265,17 +283,22 @@ void MST_solver<vertex_t, edge_t, weight_t, alteration_t>::label_prop(vertex_t*
   bool* done_ptr      = done.data();
   const bool true_val = true;
 
-  auto i = 0;
-  while (!done.value(stream)) {
-    done.set_value_async(true_val, stream);
+  // The rounds are launched in batches between the checks of the flag of the last round: the
+  // rounds after the colors have converged leave them unchanged.
+  constexpr int kRoundsPerCheck = 4;
+  do {
+    for (int i = 0; i < kRoundsPerCheck; i++) {
+      done.set_value_async(true_val, stream);
 
-    detail::min_pair_colors<<<min_pair_nblocks, min_pair_nthreads, 0, stream>>>(
-      v, indices, new_mst_edge_ptr, color_ptr, color_index, next_color_ptr);
+      detail::min_pair_colors<<<min_pair_nblocks, min_pair_nthreads, 0, stream>>>(
+        v, indices, new_mst_edge_ptr, color_ptr, color_index, next_color_ptr);
 
-    detail::update_colors<<<min_pair_nblocks, min_pair_nthreads, 0, stream>>>(
-      v, color_ptr, color_index, next_color_ptr, done_ptr);
-    i++;
-  }
+      detail::update_colors<<<min_pair_nblocks, min_pair_nthreads, 0, stream>>>(
+        v, color_ptr, color_index, next_color_ptr, done_ptr);
+    }
+    raft::copy(label_prop_done.data_handle(), done_ptr, 1, stream);
+    resource::sync_stream(handle, stream);
+  } while (!label_prop_done(0));
 
   detail::final_color_indices<<<min_pair_nblocks, min_pair_nthreads, 0, stream>>>(
     v, color_ptr, color_index);
@@ -288,8 +311,8 @@ void MST_solver<vertex_t, edge_t, weight_t, alteration_t>::min_edge_per_vertex()
   auto policy = resource::get_thrust_policy(handle);
   thrust::fill(
     policy, min_edge_color.begin(), min_edge_color.end(), std::numeric_limits<alteration_t>::max());
-  thrust::fill(
-    policy, new_mst_edge.begin(), new_mst_edge.end(), std::numeric_limits<weight_t>::max());
+  // the kernel resets the new edges of the frontier, the others have been reset when they left it
+  if (frontier_size == 0) { return; }
 
   int n_threads = 32;
 
@@ -299,15 +322,53 @@ void MST_solver<vertex_t, edge_t, weight_t, alteration_t>::min_edge_per_vertex()
   alteration_t* min_edge_color_ptr  = min_edge_color.data();
   alteration_t* altered_weights_ptr = altered_weights.data();
 
-  detail::kernel_min_edge_per_vertex<<<v, n_threads, 0, stream>>>(offsets,
-                                                                  indices,
-                                                                  altered_weights_ptr,
-                                                                  color_ptr,
-                                                                  color_index,
-                                                                  new_mst_edge_ptr,
-                                                                  mst_edge_ptr,
-                                                                  min_edge_color_ptr,
-                                                                  v);
+  detail::kernel_min_edge_per_vertex<<<frontier_size, n_threads, 0, stream>>>(offsets,
+                                                                              indices,
+                                                                              altered_weights_ptr,
+                                                                              color_ptr,
+                                                                              color_index,
+                                                                              new_mst_edge_ptr,
+                                                                              mst_edge_ptr,
+                                                                              min_edge_color_ptr,
+                                                                              frontier.data(),
+                                                                              frontier_size);
+}
+
+// a vertex stays in the frontier while it has an edge out of its supervertex
+template <typename vertex_t, typename edge_t>
+struct frontier_functor {
+  const edge_t* new_mst_edge;
+
+  __host__ __device__ bool operator()(const vertex_t& vertex) const
+  {
+    return new_mst_edge[vertex] != std::numeric_limits<edge_t>::max();
+  }
+};
+
+// Drops the vertices which have found no edge out of their supervertex from the frontier
+template <typename vertex_t, typename edge_t, typename weight_t, typename alteration_t>
+void MST_solver<vertex_t, edge_t, weight_t, alteration_t>::compact_frontier()
+{
+  frontier_functor<vertex_t, edge_t> op{new_mst_edge.data()};
+  size_t workspace_bytes = 0;
+  RAFT_CUDA_TRY(cub::DeviceSelect::If(nullptr,
+                                      workspace_bytes,
+                                      frontier.data(),
+                                      next_frontier.data(),
+                                      next_frontier_size.data(),
+                                      frontier_size,
+                                      op,
+                                      stream));
+  frontier_workspace.resize(workspace_bytes, stream);
+  RAFT_CUDA_TRY(cub::DeviceSelect::If(frontier_workspace.data(),
+                                      workspace_bytes,
+                                      frontier.data(),
+                                      next_frontier.data(),
+                                      next_frontier_size.data(),
+                                      frontier_size,
+                                      op,
+                                      stream));
+  std::swap(frontier, next_frontier);
 }
 
 // Finds the minimum edge from each supervertex to the lowest color
@@ -388,7 +449,7 @@ void MST_solver<vertex_t, edge_t, weight_t, alteration_t>::append_src_dst_pair(
 {
   auto policy = resource::get_thrust_policy(handle);
 
-  edge_t curr_mst_edge_count = prev_mst_edge_count.value(stream);
+  edge_t curr_mst_edge_count = prev_mst_edge_count;
 
   // iterator to end of mst edges added to final output in previous iteration
   auto src_dst_zip_end =
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,9 +18,17 @@
 
 #pragma once
 
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/sparse/solver/detail/block_lanczos.cuh>
 #include <raft/sparse/solver/detail/lanczos.cuh>
+#include <raft/sparse/solver/lanczos_types.hpp>
 #include <raft/spectral/matrix_wrappers.hpp>
 
+#include <optional>
+
 namespace raft::sparse::solver {
 
 // =========================================================
@@ -155,6 +163,130 @@ int computeLargestEigenvectors(
                                             seed);
 }
 
+/**
+ *  @brief  Compute the smallest or largest eigenpairs of a symmetric
+ *    sparse matrix by block Lanczos with thick restarts.
+ *
+ *    Every step multiplies a block of `block_size` vectors by A in
+ *    one SpMM and orthogonalizes the product against the whole
+ *    Krylov basis with GEMMs (block classical Gram-Schmidt, twice).
+ *    When the basis reaches `ncv` vectors, the most wanted Ritz
+ *    vectors are kept and the iteration goes on from them (a thick
+ *    restart), so that the memory stays at (ncv + block_size)
+ *    vectors. Clustered or multiple eigenvalues converge together
+ *    when the block is at least as large as the cluster.
+ *
+ *  @code{.cpp}
+ *    raft::sparse::solver::block_lanczos_config<float> config{n_components};
+ *    config.which = raft::sparse::solver::lanczos_which::LARGEST;
+ *    auto result  = raft::sparse::solver::block_lanczos(
+ *      handle, config, A, eigenvalues.view(), eigenvectors.view());
+ *  @endcode
+ *
+ *  @tparam value_type_t the type of the values of the matrix.
+ *  @param handle the raft handle.
+ *  @param config the parameters of the solver.
+ *  @param A the symmetric matrix [n, n].
+ *  @param eigenvalues (Output) the eigenvalues [n_components], the
+ *    most wanted first (ascending for the smallest ones, descending
+ *    for the largest ones).
+ *  @param eigenvectors (Output) the eigenvectors [n, n_components].
+ *  @param initial_vectors (Optional) approximations of the wanted
+ *    eigenvectors [n, n_initial] (e.g. the eigenvectors of a
+ *    slightly different matrix) to start the iterations from: the
+ *    column j is added to the column j % block_size of the random
+ *    starting block. The warm start is the most effective with a
+ *    block_size of n_initial.
+ *  @return the number of restarts and of block products, and
+ *    whether the tolerance was met.
+ */
+template <typename value_type_t>
+auto block_lanczos(
+  raft::resources const& handle,
+  block_lanczos_config<value_type_t> const& config,
+  raft::device_csr_matrix_view<const value_type_t, int, int, int> A,
+  raft::device_vector_view<value_type_t, int> eigenvalues,
+  raft::device_matrix_view<value_type_t, int, raft::col_major> eigenvectors,
+  std::optional<raft::device_matrix_view<const value_type_t, int, raft::col_major>>
+    initial_vectors = std::nullopt) -> block_lanczos_result
+{
+  int n = A.structure_view().get_n_rows();
+  RAFT_EXPECTS(eigenvalues.extent(0) == config.n_components,
+               "eigenvalues must have n_components elements");
+  RAFT_EXPECTS(eigenvectors.extent(0) == n && eigenvectors.extent(1) == config.n_components,
+               "eigenvectors must be [n, n_components]");
+  RAFT_EXPECTS(!initial_vectors.has_value() || initial_vectors->extent(0) == n,
+               "initial_vectors must have n rows");
+  return detail::block_lanczos(
+    handle,
+    nullptr,
+    config,
+    A,
+    eigenvalues.data_handle(),
+    eigenvectors.data_handle(),
+    static_cast<const value_type_t*>(nullptr),
+    initial_vectors.has_value() ? initial_vectors->data_handle() : nullptr,
+    initial_vectors.has_value() ? initial_vectors->extent(1) : 0);
+}
+
+/**
+ *  @brief  Block Lanczos over the ranks of the communicator of the
+ *    handle, for matrices distributed by blocks of rows.
+ *
+ *    Every rank holds a block of consecutive rows of A (with the
+ *    global column indices), the blocks of the ranks in the order of
+ *    their ranks, and gets the same rows of the eigenvectors. Only
+ *    the halo rows of the blocks of vectors multiplied by A (the rows
+ *    of the other ranks referenced by the local rows of A) are
+ *    exchanged, and the projections are summed over the ranks; the
+ *    small projected problem is replicated. This is a collective
+ *    operation: all the ranks must call it with the same config.
+ *
+ *  @tparam value_type_t the type of the values of the matrix.
+ *  @param handle the raft handle, with a communicator.
+ *  @param config the parameters of the solver.
+ *  @param A the rows of the symmetric matrix held by this rank
+ *    [n_local, n].
+ *  @param eigenvalues (Output) the eigenvalues [n_components], the
+ *    same on all the ranks.
+ *  @param eigenvectors (Output) the rows of the eigenvectors held by
+ *    this rank [n_local, n_components].
+ *  @param initial_vectors (Optional) the rows held by this rank of
+ *    the approximate eigenvectors to start from [n_local, n_initial]
+ *    (see `block_lanczos`).
+ *  @return the number of restarts and of block products, and
+ *    whether the tolerance was met.
+ */
+template <typename value_type_t>
+auto block_lanczos_distributed(
+  raft::resources const& handle,
+  block_lanczos_config<value_type_t> const& config,
+  raft::device_csr_matrix_view<const value_type_t, int, int, int> A,
+  raft::device_vector_view<value_type_t, int> eigenvalues,
+  raft::device_matrix_view<value_type_t, int, raft::col_major> eigenvectors,
+  std::optional<raft::device_matrix_view<const value_type_t, int, raft::col_major>>
+    initial_vectors = std::nullopt) -> block_lanczos_result
+{
+  int n_local = A.structure_view().get_n_rows();
+  RAFT_EXPECTS(eigenvalues.extent(0) == config.n_components,
+               "eigenvalues must have n_components elements");
+  RAFT_EXPECTS(eigenvectors.extent(0) == n_local && eigenvectors.extent(1) == config.n_components,
+               "eigenvectors must be [n_local, n_components]");
+  RAFT_EXPECTS(!initial_vectors.has_value() || initial_vectors->extent(0) == n_local,
+               "initial_vectors must have n_local rows");
+  const auto& comms = resource::get_comms(handle);
+  return detail::block_lanczos(
+    handle,
+    &comms,
+    config,
+    A,
+    eigenvalues.data_handle(),
+    eigenvectors.data_handle(),
+    static_cast<const value_type_t*>(nullptr),
+    initial_vectors.has_value() ? initial_vectors->data_handle() : nullptr,
+    initial_vectors.has_value() ? initial_vectors->extent(1) : 0);
+}
+
 }  // namespace raft::sparse::solver
 
 #endif
\ No newline at end of file
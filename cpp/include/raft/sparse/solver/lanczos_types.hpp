@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace raft::sparse::solver {
+
+/** The end of the spectrum computed by the block Lanczos solver. */
+enum class lanczos_which {
+  /** the smallest (algebraic) eigenvalues */
+  SMALLEST,
+  /** the largest (algebraic) eigenvalues */
+  LARGEST
+};
+
+/**
+ * @brief The parameters of the block Lanczos solver.
+ *
+ * @tparam ValueTypeT the data type of the matrix
+ */
+template <typename ValueTypeT>
+struct block_lanczos_config {
+  /** The number of eigenpairs to compute. */
+  int n_components;
+  /** The number of vectors multiplied by the matrix at once (the width of the SpMM). */
+  int block_size = 4;
+  /**
+   * The largest size of the Krylov basis before a thick restart; at least
+   * n_components + block_size, and block_size less than the size of the matrix.
+   * 0 selects max(2 n_components, n_components + 2 block_size).
+   */
+  int ncv = 0;
+  /** The largest number of restarts. */
+  int max_restarts = 100;
+  /**
+   * The iterations stop when the residual norms ||A x - lambda x|| of all the wanted eigenpairs
+   * are below tolerance times the largest eigenvalue (in magnitude) of the projected matrix.
+   */
+  ValueTypeT tolerance = 1e-6;
+  /** The end of the spectrum to compute. */
+  lanczos_which which = lanczos_which::SMALLEST;
+  /** The seed of the random starting block. */
+  uint64_t seed = 1234567;
+};
+
+/** @brief What the block Lanczos solver did. */
+struct block_lanczos_result {
+  /** The number of thick restarts performed. */
+  int n_restarts = 0;
+  /** The number of block products by the matrix (SpMM). */
+  int n_products = 0;
+  /** Whether all the wanted eigenpairs met the tolerance. */
+  bool converged = false;
+};
+
+}  // namespace raft::sparse::solver
@@ -1,6 +1,6 @@
 
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <raft/core/pinned_mdarray.hpp>
 #include <raft/core/resources.hpp>
 #include <rmm/device_scalar.hpp>
 #include <rmm/device_uvector.hpp>
@@ -77,11 +78,22 @@ class MST_solver {
   rmm::device_uvector<edge_t> new_mst_edge;           // new minimum edge per vertex
   rmm::device_uvector<alteration_t> altered_weights;  // weights to be used for mst
   rmm::device_scalar<edge_t> mst_edge_count;  // total number of edges added after every iteration
-  rmm::device_scalar<edge_t>
-    prev_mst_edge_count;                     // total number of edges up to the previous iteration
-  rmm::device_uvector<bool> mst_edge;        // mst output -  true if the edge belongs in mst
-  rmm::device_uvector<vertex_t> next_color;  //  next iteration color
-  rmm::device_uvector<vertex_t> color;       // index of color that vertex points to
+  edge_t prev_mst_edge_count;                 // total number of edges up to the previous iteration
+  rmm::device_uvector<bool> mst_edge;         // mst output -  true if the edge belongs in mst
+  rmm::device_uvector<vertex_t> next_color;   //  next iteration color
+  rmm::device_uvector<vertex_t> color;        // index of color that vertex points to
+
+  // vertices that may still have an edge out of their supervertex; the others are dropped
+  // for good, since the supervertices only grow
+  rmm::device_uvector<vertex_t> frontier;
+  rmm::device_uvector<vertex_t> next_frontier;
+  rmm::device_scalar<edge_t> next_frontier_size;
+  rmm::device_uvector<char> frontier_workspace;
+  vertex_t frontier_size;
+
+  // the device counters [mst_edge_count, next_frontier_size], read once per iteration
+  raft::pinned_vector<edge_t, uint32_t> status;
+  raft::pinned_vector<bool, uint32_t> label_prop_done;
 
   // new src-dst pairs found per iteration
   rmm::device_uvector<vertex_t> temp_src;
@@ -90,6 +102,7 @@ class MST_solver {
 
   void label_prop(vertex_t* mst_src, vertex_t* mst_dst);
   void min_edge_per_vertex();
+  void compact_frontier();
   void min_edge_per_supervertex();
   void check_termination();
   void alteration();
@@ -17,17 +17,23 @@
 #pragma once
 
 #include <raft/core/logger.hpp>
+#include <raft/core/managed_container_policy.hpp>
 #include <raft/distance/distance_types.hpp>
+#include <raft/neighbors/sample_filter_types.hpp>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
 #include <raft/util/integer_utils.hpp>
 
+#include <rmm/cuda_device.hpp>
 #include <rmm/cuda_stream_view.hpp>
 #include <rmm/device_scalar.hpp>
 #include <rmm/device_uvector.hpp>
+#include <rmm/mr/host/host_memory_resource.hpp>
 
+#include <cstring>
 #include <memory>
 #include <optional>
+#include <vector>
 
 #include <cuda_fp16.hpp>
 
@@ -148,9 +154,10 @@ struct config<float> {
   using value_t                    = float;
   static constexpr double kDivisor = 1.0;
 };
+// The distances between fp16 vectors are accumulated in full precision.
 template <>
 struct config<half> {
-  using value_t                    = half;
+  using value_t                    = float;
   static constexpr double kDivisor = 1.0;
 };
 template <>
@@ -313,6 +320,215 @@ void outer_add(const T* a, IdxT len_a, const T* b, IdxT len_b, T* c, rmm::cuda_s
   outer_add_kernel<<<blocks, threads, 0, stream>>>(a, len_a, b, len_b, c);
 }
 
+template <typename IdxT>
+RAFT_KERNEL mask_distant_probes_kernel(IdxT n_queries,
+                                       uint32_t n_probes,
+                                       const float* distances,
+                                       const float* offsets,
+                                       float max_ratio_sq,
+                                       uint32_t mask_label,
+                                       uint32_t* probes)
+{
+  IdxT gid       = threadIdx.x + blockDim.x * static_cast<IdxT>(blockIdx.x);
+  IdxT query_ix  = gid / n_probes;
+  uint32_t probe = gid % n_probes;
+  if (query_ix >= n_queries || probe == 0) return;
+  float offset  = offsets == nullptr ? 0.0f : offsets[query_ix];
+  float closest = max(distances[query_ix * n_probes] + offset, 0.0f);
+  if (distances[gid] + offset > max_ratio_sq * closest) { probes[gid] = mask_label; }
+}
+
+/**
+ * @brief Mask the probes that are too far from their query compared to its closest probe.
+ *
+ * The probe `j` of a query is replaced with `mask_label` when its squared L2 distance is larger
+ * than `max_ratio^2` times the squared L2 distance of the closest probe; the closest probe is
+ * always kept.
+ *
+ * NB: device-only function
+ *
+ * @tparam IdxT index type
+ *
+ * @param n_queries number of queries
+ * @param n_probes number of probes per query
+ * @param[in] distances device pointer to the coarse distances [n_queries, n_probes], such that
+ *   the first distance of each row is the smallest one.
+ * @param[in] offsets optional device pointer to the values to add to the distances of every query
+ *   to get the squared L2 distances [n_queries] (e.g. the norms when the distances are computed
+ *   up to a constant).
+ * @param max_ratio the maximum ratio of the L2 distances of a probe and of the closest probe.
+ * @param mask_label the label to write in place of the masked probes
+ * @param[inout] probes device pointer to the probed labels [n_queries, n_probes]
+ * @param stream
+ */
+template <typename IdxT>
+void mask_distant_probes(IdxT n_queries,
+                         uint32_t n_probes,
+                         const float* distances,
+                         const float* offsets,
+                         float max_ratio,
+                         uint32_t mask_label,
+                         uint32_t* probes,
+                         rmm::cuda_stream_view stream)
+{
+  if (n_queries == 0 || n_probes <= 1) { return; }
+  dim3 threads(128, 1, 1);
+  dim3 blocks(ceildiv<IdxT>(n_queries * n_probes, threads.x), 1, 1);
+  mask_distant_probes_kernel<<<blocks, threads, 0, stream>>>(
+    n_queries, n_probes, distances, offsets, max_ratio * max_ratio, mask_label, probes);
+}
+
+template <typename FilterT>
+RAFT_KERNEL mask_skipped_probes_kernel(size_t n,
+                                       uint32_t n_probes,
+                                       uint32_t queries_offset,
+                                       FilterT filter,
+                                       uint32_t mask_label,
+                                       uint32_t* probes)
+{
+  size_t gid = threadIdx.x + blockDim.x * static_cast<size_t>(blockIdx.x);
+  if (gid >= n) return;
+  uint32_t label = probes[gid];
+  if (label == mask_label) return;
+  uint32_t query_ix = queries_offset + static_cast<uint32_t>(gid / n_probes);
+  if (raft::neighbors::filtering::skips_probe(filter, query_ix, label)) {
+    probes[gid] = mask_label;
+  }
+}
+
+/**
+ * @brief Mask the probes of the lists a sample filter skips entirely (see `skips_lists`).
+ *
+ * NB: device-only function
+ *
+ * @tparam FilterT an IVF sample filter with a `skips_list(label)` or
+ *   `skips_list(query_ix, label)` member
+ *
+ * @param n_queries number of queries
+ * @param n_probes number of probes per query
+ * @param queries_offset the index of the first query, as passed to the filter
+ * @param filter the sample filter
+ * @param mask_label the label to write in place of the masked probes
+ * @param[inout] probes device pointer to the probed labels [n_queries, n_probes]
+ * @param stream
+ */
+template <typename FilterT>
+void mask_skipped_probes(uint32_t n_queries,
+                         uint32_t n_probes,
+                         uint32_t queries_offset,
+                         FilterT filter,
+                         uint32_t mask_label,
+                         uint32_t* probes,
+                         rmm::cuda_stream_view stream)
+{
+  size_t n = size_t(n_queries) * n_probes;
+  if (n == 0) { return; }
+  dim3 threads(128, 1, 1);
+  dim3 blocks(ceildiv<size_t>(n, threads.x), 1, 1);
+  mask_skipped_probes_kernel<<<blocks, threads, 0, stream>>>(
+    n, n_probes, queries_offset, filter, mask_label, probes);
+}
+
+template <typename IdxT>
+RAFT_KERNEL mask_probes_per_query_kernel(IdxT n,
+                                         uint32_t n_probes,
+                                         const uint32_t* query_n_probes,
+                                         uint32_t mask_label,
+                                         uint32_t* probes)
+{
+  IdxT gid = threadIdx.x + blockDim.x * static_cast<IdxT>(blockIdx.x);
+  if (gid >= n) return;
+  if (gid % n_probes >= query_n_probes[gid / n_probes]) { probes[gid] = mask_label; }
+}
+
+/**
+ * @brief Mask the probes beyond the number of probes of every query.
+ *
+ * The probes are sorted by the distance to the query, so a query with `query_n_probes[i] = p`
+ * keeps its `p` closest probes (all of them if `p >= n_probes`).
+ *
+ * NB: device-only function
+ *
+ * @tparam IdxT index type
+ *
+ * @param n_queries number of queries
+ * @param n_probes number of probes per query (the maximum of `query_n_probes`)
+ * @param[in] query_n_probes device pointer to the number of probes of every query [n_queries]
+ * @param mask_label the label to write in place of the masked probes
+ * @param[inout] probes device pointer to the probed labels [n_queries, n_probes]
+ * @param stream
+ */
+template <typename IdxT>
+void mask_probes_per_query(IdxT n_queries,
+                           uint32_t n_probes,
+                           const uint32_t* query_n_probes,
+                           uint32_t mask_label,
+                           uint32_t* probes,
+                           rmm::cuda_stream_view stream)
+{
+  IdxT n = n_queries * n_probes;
+  if (n == 0) { return; }
+  dim3 threads(128, 1, 1);
+  dim3 blocks(ceildiv<IdxT>(n, threads.x), 1, 1);
+  mask_probes_per_query_kernel<<<blocks, threads, 0, stream>>>(
+    n, n_probes, query_n_probes, mask_label, probes);
+}
+
+template <typename IdxT, typename DistT>
+RAFT_KERNEL pad_results_per_query_kernel(size_t n,
+                                         uint32_t k,
+                                         const uint32_t* query_k,
+                                         IdxT pad_index,
+                                         DistT pad_distance,
+                                         IdxT* neighbors,
+                                         DistT* distances)
+{
+  size_t gid = threadIdx.x + blockDim.x * static_cast<size_t>(blockIdx.x);
+  if (gid >= n) return;
+  if (gid % k >= query_k[gid / k]) {
+    neighbors[gid] = pad_index;
+    distances[gid] = pad_distance;
+  }
+}
+
+/**
+ * @brief Pad the search results beyond the number of neighbors of every query.
+ *
+ * The results of a query are sorted, so its first `query_k[i]` results are its `query_k[i]`
+ * nearest neighbors, and the rest of the row is overwritten with the padding values.
+ *
+ * NB: device-only function
+ *
+ * @tparam IdxT type of the neighbor indices
+ * @tparam DistT type of the distances
+ *
+ * @param n_queries number of queries
+ * @param k number of results per query (the maximum of `query_k`)
+ * @param[in] query_k device pointer to the number of neighbors of every query [n_queries]
+ * @param pad_index the index written in place of the padded neighbors
+ * @param pad_distance the distance written in place of the padded neighbors
+ * @param[inout] neighbors device pointer to the neighbors [n_queries, k]
+ * @param[inout] distances device pointer to the distances [n_queries, k]
+ * @param stream
+ */
+template <typename IdxT, typename DistT>
+void pad_results_per_query(uint32_t n_queries,
+                           uint32_t k,
+                           const uint32_t* query_k,
+                           IdxT pad_index,
+                           DistT pad_distance,
+                           IdxT* neighbors,
+                           DistT* distances,
+                           rmm::cuda_stream_view stream)
+{
+  size_t n = size_t(n_queries) * k;
+  if (n == 0) { return; }
+  dim3 threads(128, 1, 1);
+  dim3 blocks(ceildiv<size_t>(n, threads.x), 1, 1);
+  pad_results_per_query_kernel<<<blocks, threads, 0, stream>>>(
+    n, k, query_k, pad_index, pad_distance, neighbors, distances);
+}
+
 template <typename T, typename S, typename IdxT, typename LabelT>
 RAFT_KERNEL copy_selected_kernel(
   IdxT n_rows, IdxT n_cols, const S* src, const LabelT* row_ids, IdxT ld_src, T* dst, IdxT ld_dst)
@@ -382,11 +598,16 @@ void copy_selected(IdxT n_rows,
  *
  *  1. if `source == nullptr`: then `batch.data() == nullptr`
  *  2. if `source` is accessible from the device, `batch.data()` points directly at the source at
- *     the proper offsets on each iteration.
+ *     the proper offsets on each iteration. If `source` is managed memory, the batch is migrated
+ *     to the device before it is processed, and the next one is prefetched in the prefetch stream
+ *     (if given), so that an oversubscribed managed dataset is streamed rather than faulted in.
  *  3. if `source` is not accessible from the device, `batch.data()` points to an intermediate
  *     buffer; the corresponding data is copied in the given `stream` on every iterator dereference
  *     (i.e. batches can be skipped). Dereferencing the same batch two times in a row does not force
- *     the copy.
+ *     the copy. If `source` is pageable host memory and a pinned memory resource is given, the
+ *     data goes through a pinned staging buffer, so that the host-to-device copy is asynchronous
+ *     and fast. If a prefetch stream is given, the copy of the next batch in that stream overlaps
+ *     with the processing of the current one.
  *
  * In all three scenarios, the number of iterations, batch offsets and sizes are the same.
  *
@@ -409,16 +630,33 @@ struct batch_load_iterator {
     [[nodiscard]] auto data() const -> const T* { return const_cast<const T*>(dev_ptr_); }
     /** Whether this batch copies the data (i.e. the source is inaccessible from the device). */
     [[nodiscard]] auto does_copy() const -> bool { return needs_copy_; }
+    /** Whether the copy of the next batch is prefetched while the current one is processed. */
+    [[nodiscard]] auto does_prefetch() const -> bool { return slots_.size() > 1; }
 
    private:
+    /** A device buffer the batches are copied to. */
+    struct slot {
+      rmm::device_uvector<T> buf;
+      // optional pinned staging buffer for the copies from pageable memory
+      T* staging{nullptr};
+      // the batch loaded (or being loaded) into this slot
+      std::optional<size_type> pos{std::nullopt};
+      // recorded in the copy stream after the copy into the slot
+      cudaEvent_t ready{nullptr};
+      // recorded in the main stream when it no longer uses the previous batch of the slot
+      cudaEvent_t released{nullptr};
+    };
+
     batch(const T* source,
           size_type n_rows,
           size_type row_width,
           size_type batch_size,
           rmm::cuda_stream_view stream,
-          rmm::mr::device_memory_resource* mr)
+          rmm::mr::device_memory_resource* mr,
+          rmm::mr::host_memory_resource* pinned_mr,
+          std::optional<rmm::cuda_stream_view> prefetch_stream)
       : stream_(stream),
-        buf_(0, stream, mr),
+        copy_stream_(prefetch_stream.value_or(stream)),
         source_(source),
         dev_ptr_(nullptr),
         n_rows_(n_rows),
@@ -432,14 +670,52 @@ struct batch_load_iterator {
       cudaPointerAttributes attr;
       RAFT_CUDA_TRY(cudaPointerGetAttributes(&attr, source_));
       dev_ptr_ = reinterpret_cast<T*>(attr.devicePointer);
-      if (dev_ptr_ == nullptr) {
-        buf_.resize(row_width_ * batch_size_, stream);
-        dev_ptr_    = buf_.data();
-        needs_copy_ = true;
+      if (dev_ptr_ != nullptr) {
+        if (attr.type == cudaMemoryTypeManaged && raft::is_prefetchable_managed_ptr(source_)) {
+          managed_device_ = rmm::get_current_cuda_device().value();
+        }
+        return;
+      }
+      needs_copy_ = true;
+      // Double-buffer the batches if there is a stream to prefetch them on
+      size_type n_slots = prefetch_stream.has_value() && n_iters_ > 1 ? 2 : 1;
+      if (n_slots == 1) { copy_stream_ = stream_; }
+      if (pinned_mr != nullptr && attr.type == cudaMemoryTypeUnregistered) {
+        pinned_mr_ = pinned_mr;
       }
+      slots_.reserve(n_slots);
+      for (size_type i = 0; i < n_slots; i++) {
+        auto& s =
+          slots_.emplace_back(slot{rmm::device_uvector<T>(row_width_ * batch_size_, stream, mr)});
+        RAFT_CUDA_TRY(cudaEventCreateWithFlags(&s.ready, cudaEventDisableTiming));
+        RAFT_CUDA_TRY(cudaEventCreateWithFlags(&s.released, cudaEventDisableTiming));
+        if (pinned_mr_ != nullptr) {
+          s.staging = static_cast<T*>(pinned_mr_->allocate(row_width_ * batch_size_ * sizeof(T)));
+        }
+      }
+      dev_ptr_ = slots_[0].buf.data();
     }
+
+   public:
+    ~batch() noexcept
+    {
+      for (auto& s : slots_) {
+        // A prefetch may still be writing into the buffer, which is released in the main stream
+        if (copy_stream_ != stream_) {
+          RAFT_CUDA_TRY_NO_THROW(cudaStreamWaitEvent(stream_, s.ready));
+        }
+        if (s.staging != nullptr) {
+          RAFT_CUDA_TRY_NO_THROW(cudaEventSynchronize(s.ready));
+          pinned_mr_->deallocate(s.staging, row_width_ * batch_size_ * sizeof(T));
+        }
+        RAFT_CUDA_TRY_NO_THROW(cudaEventDestroy(s.ready));
+        RAFT_CUDA_TRY_NO_THROW(cudaEventDestroy(s.released));
+      }
+    }
+
+   private:
     rmm::cuda_stream_view stream_;
-    rmm::device_uvector<T> buf_;
+    rmm::cuda_stream_view copy_stream_;
     const T* source_;
     size_type n_rows_;
     size_type row_width_;
@@ -450,12 +726,70 @@ struct batch_load_iterator {
     std::optional<size_type> pos_;
     size_type batch_len_;
     T* dev_ptr_;
+    rmm::mr::host_memory_resource* pinned_mr_{nullptr};
+    std::vector<slot> slots_{};
+    size_type cur_slot_{0};
+    // the device the managed source is prefetched to (if it is managed memory)
+    std::optional<int> managed_device_{std::nullopt};
+    // the last batch of the managed source prefetched
+    std::optional<size_type> managed_prefetched_{std::nullopt};
 
     friend class batch_load_iterator<T>;
 
+    /** Start copying the batch `pos` into the slot `s` in the copy stream. */
+    void issue_copy(slot& s, size_type pos)
+    {
+      s.pos       = pos;
+      auto offset = pos * batch_size_;
+      auto len    = std::min(batch_size_, n_rows_ - std::min(offset, n_rows_));
+      if (len == 0) { return; }
+      RAFT_LOG_TRACE("batch_load_iterator::copy(offset = %zu, size = %zu, row_width = %zu)",
+                     size_t(offset),
+                     size_t(len),
+                     size_t(row_width_));
+      if (copy_stream_ != stream_) {
+        // The main stream may still be processing the previous batch in this slot
+        RAFT_CUDA_TRY(cudaEventRecord(s.released, stream_));
+        RAFT_CUDA_TRY(cudaStreamWaitEvent(copy_stream_, s.released));
+      }
+      const T* src = source_ + offset * row_width_;
+      if (s.staging != nullptr) {
+        // The staging buffer may still be read by the previous copy from it
+        RAFT_CUDA_TRY(cudaEventSynchronize(s.ready));
+        std::memcpy(s.staging, src, len * row_width_ * sizeof(T));
+        src = s.staging;
+      }
+      copy(s.buf.data(), src, len * row_width_, copy_stream_);
+      RAFT_CUDA_TRY(cudaEventRecord(s.ready, copy_stream_));
+    }
+
+    /**
+     * Migrate the managed batch `pos` to the device in the main stream (unless it has been
+     * prefetched already), and start prefetching the next one in the copy stream.
+     */
+    void prefetch_managed(size_type pos)
+    {
+      auto bytes = [this](size_type p) {
+        auto offset = p * batch_size_;
+        return std::min(batch_size_, n_rows_ - std::min(offset, n_rows_)) * row_width_ * sizeof(T);
+      };
+      if (managed_prefetched_ != pos) {
+        raft::managed_prefetch_async(dev_ptr_, bytes(pos), *managed_device_, stream_);
+      }
+      managed_prefetched_.emplace(pos);
+      if (pos + 1 < n_iters_) {
+        raft::managed_prefetch_async(source_ + (pos + 1) * batch_size_ * row_width_,
+                                     bytes(pos + 1),
+                                     *managed_device_,
+                                     copy_stream_);
+        managed_prefetched_.emplace(pos + 1);
+      }
+    }
+
     /**
      * Changes the state of the batch to point at the `pos` index.
-     * If necessary, copies the data from the source in the registered stream.
+     * If necessary, copies the data from the source (or waits for its prefetch) in the registered
+     * stream, and starts prefetching the next batch.
      */
     void load(const size_type& pos)
     {
@@ -464,16 +798,26 @@ struct batch_load_iterator {
       pos_.emplace(pos);
       batch_len_ = std::min(batch_size_, n_rows_ - std::min(offset(), n_rows_));
       if (source_ == nullptr) { return; }
-      if (needs_copy_) {
-        if (size() > 0) {
-          RAFT_LOG_TRACE("batch_load_iterator::copy(offset = %zu, size = %zu, row_width = %zu)",
-                         size_t(offset()),
-                         size_t(size()),
-                         size_t(row_width()));
-          copy(dev_ptr_, source_ + offset() * row_width(), size() * row_width(), stream_);
-        }
-      } else {
+      if (!needs_copy_) {
         dev_ptr_ = const_cast<T*>(source_) + offset() * row_width();
+        if (managed_device_.has_value()) { prefetch_managed(pos); }
+        return;
+      }
+      if (size() == 0) { return; }
+      auto n_slots = slots_.size();
+      if (slots_[cur_slot_].pos != pos) {
+        auto next = (cur_slot_ + 1) % n_slots;
+        if (slots_[next].pos != pos) { issue_copy(slots_[next], pos); }
+        cur_slot_ = next;
+      }
+      dev_ptr_ = slots_[cur_slot_].buf.data();
+      if (copy_stream_ != stream_) {
+        RAFT_CUDA_TRY(cudaStreamWaitEvent(stream_, slots_[cur_slot_].ready));
+      }
+      // Prefetch the next batch while this one is processed
+      if (n_slots > 1 && pos + 1 < n_iters_) {
+        auto& next = slots_[(cur_slot_ + 1) % n_slots];
+        if (next.pos != pos + 1) { issue_copy(next, pos + 1); }
       }
     }
   };
@@ -496,14 +840,23 @@ struct batch_load_iterator {
    * @param batch_size the desired size of the batch.
    * @param stream the ordering for the host->device copies, if applicable.
    * @param mr a custom memory resource for the intermediate buffer, if applicable.
+   * @param pinned_mr a pinned host memory resource for staging the copies from pageable host
+   *   memory, if applicable (the data is copied directly if nullptr).
+   * @param prefetch_stream if set, the batches are double-buffered: the next batch is copied in
+   *   this stream while the current one is processed in `stream` (which waits for the copies
+   *   through events); this doubles the size of the intermediate buffer.
    */
   batch_load_iterator(const T* source,
                       size_type n_rows,
                       size_type row_width,
                       size_type batch_size,
                       rmm::cuda_stream_view stream,
-                      rmm::mr::device_memory_resource* mr = rmm::mr::get_current_device_resource())
-    : cur_batch_(new batch(source, n_rows, row_width, batch_size, stream, mr)), cur_pos_(0)
+                      rmm::mr::device_memory_resource* mr = rmm::mr::get_current_device_resource(),
+                      rmm::mr::host_memory_resource* pinned_mr             = nullptr,
+                      std::optional<rmm::cuda_stream_view> prefetch_stream = std::nullopt)
+    : cur_batch_(
+        new batch(source, n_rows, row_width, batch_size, stream, mr, pinned_mr, prefetch_stream)),
+      cur_pos_(0)
   {
   }
   /**
@@ -511,6 +864,8 @@ struct batch_load_iterator {
    * (i.e. the source is inaccessible from the device).
    */
   [[nodiscard]] auto does_copy() const -> bool { return cur_batch_->does_copy(); }
+  /** Whether this iterator prefetches the next batch while the current one is processed. */
+  [[nodiscard]] auto does_prefetch() const -> bool { return cur_batch_->does_prefetch(); }
   /** Reset the iterator position to `begin()` */
   void reset() { cur_pos_ = 0; }
   /** Reset the iterator position to `end()` */
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
 #include <raft/core/resources.hpp>
@@ -29,6 +30,7 @@
 #include <limits.h>
 
 #include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
 
 #include <raft/neighbors/detail/faiss_select/key_value_block_select.cuh>
 
@@ -47,6 +49,7 @@
 #include <thrust/iterator/counting_iterator.h>
 #include <thrust/iterator/zip_iterator.h>
 #include <thrust/reduce.h>
+#include <thrust/scan.h>
 #include <thrust/sequence.h>
 #include <thrust/sort.h>
 #include <thrust/tuple.h>
@@ -169,6 +172,37 @@ void construct_landmark_1nn(raft::resources const& handle,
                                            resource::get_cuda_stream(handle));
 }
 
+/**
+ * Map the cosine distances `d = 1 - cos` to the chord distances `sqrt(2 d)` (see `CosineFunc`).
+ * The unset distances (max value) are kept as they are.
+ */
+template <typename value_t, typename value_int>
+void cosine_to_chord_dists(raft::resources const& handle, value_t* dists, value_int n)
+{
+  thrust::transform(resource::get_thrust_policy(handle),
+                    dists,
+                    dists + n,
+                    dists,
+                    [] __device__(value_t d) -> value_t {
+                      if (d == std::numeric_limits<value_t>::max()) { return d; }
+                      return d > 0 ? raft::sqrt(2 * d) : value_t(0);
+                    });
+}
+
+/** Map the chord distances `c` back to the cosine distances `c^2 / 2` (see `CosineFunc`). */
+template <typename value_t, typename value_int>
+void chord_to_cosine_dists(raft::resources const& handle, value_t* dists, value_int n)
+{
+  thrust::transform(resource::get_thrust_policy(handle),
+                    dists,
+                    dists + n,
+                    dists,
+                    [] __device__(value_t c) -> value_t {
+                      if (c == std::numeric_limits<value_t>::max()) { return c; }
+                      return c * c / 2;
+                    });
+}
+
 /**
  * Computes the k closest landmarks to a set of query points.
  * @tparam value_idx
@@ -203,6 +237,11 @@ void k_closest_landmarks(raft::resources const& handle,
     make_device_matrix_view(R_knn_inds, n_query_pts, k),
     make_device_matrix_view(R_knn_dists, n_query_pts, k),
     index.get_metric());
+
+  // the ball cover works with the chord distances (a metric) in place of the cosine distances
+  if (index.get_metric() == raft::distance::DistanceType::CosineExpanded) {
+    cosine_to_chord_dists(handle, R_knn_dists, n_query_pts * k);
+  }
 }
 
 /**
@@ -333,6 +372,44 @@ void perform_rbc_query(raft::resources const& handle,
                                                                          weight,
                                                                          post_dists_counter);
     }
+  } else {
+    // any dimensionality: the query rows are kept in the shared memory
+    const size_t bitset_size = raft::ceildiv<size_t>(index.n_landmarks, 32) * sizeof(std::uint32_t);
+    RAFT_EXPECTS(index.n * sizeof(value_t) + (perform_post_filtering ? bitset_size : 0) <=
+                   size_t(48 * 1024),
+                 "The query row (and the landmark bitset) must fit in the shared memory");
+    // Compute nearest k for each neighborhood in each closest R
+    rbc_low_dim_pass_one<value_idx, value_t, value_int, matrix_idx, 0>(handle,
+                                                                       index,
+                                                                       query,
+                                                                       n_query_pts,
+                                                                       k,
+                                                                       R_knn_inds,
+                                                                       R_knn_dists,
+                                                                       dfunc,
+                                                                       inds,
+                                                                       dists,
+                                                                       weight,
+                                                                       dists_counter);
+
+    if (perform_post_filtering) {
+      rbc_low_dim_pass_two<value_idx, value_t, value_int, matrix_idx, 0>(handle,
+                                                                         index,
+                                                                         query,
+                                                                         n_query_pts,
+                                                                         k,
+                                                                         R_knn_inds,
+                                                                         R_knn_dists,
+                                                                         dfunc,
+                                                                         inds,
+                                                                         dists,
+                                                                         weight,
+                                                                         post_dists_counter);
+    }
+  }
+
+  if (index.get_metric() == raft::distance::DistanceType::CosineExpanded) {
+    chord_to_cosine_dists(handle, dists, k * n_query_pts);
   }
 }
 
@@ -483,7 +560,6 @@ void rbc_all_knn_query(raft::resources const& handle,
                        bool perform_post_filtering = true,
                        float weight                = 1.0)
 {
-  ASSERT(index.n <= 3, "only 2d and 3d vectors are supported in current implementation");
   ASSERT(index.n_landmarks >= k, "number of landmark samples must be >= k");
   ASSERT(!index.is_index_trained(), "index cannot be previously trained");
 
@@ -559,7 +635,6 @@ void rbc_knn_query(raft::resources const& handle,
                    bool perform_post_filtering = true,
                    float weight                = 1.0)
 {
-  ASSERT(index.n <= 3, "only 2d and 3d vectors are supported in current implementation");
   ASSERT(index.n_landmarks >= k, "number of landmark samples must be >= k");
   ASSERT(index.is_index_trained(), "index must be previously trained");
 
@@ -715,6 +790,99 @@ void rbc_eps_nn_query(raft::resources const& handle,
                            vd);
 }
 
+/**
+ * Computes the epsilon neighborhood into a CSR matrix with a count pass and a fill pass over
+ * batches of queries. The landmark distances of a batch (the only workspace scaling with the
+ * number of queries) are bounded by `max_workspace_bytes`, and no dense adjacency is allocated, so
+ * the memory grows with the number of neighbors found rather than with `n_query_pts * index.m`.
+ * The landmark distances are recomputed in the fill pass rather than kept for all the queries.
+ */
+template <typename value_idx = std::int64_t,
+          typename value_t,
+          typename value_int  = std::int64_t,
+          typename matrix_idx = std::int64_t,
+          typename distance_func>
+void rbc_eps_nn_query_batched(
+  raft::resources const& handle,
+  const BallCoverIndex<value_idx, value_t, value_int, matrix_idx>& index,
+  const value_t eps,
+  const value_t* query,
+  value_int n_query_pts,
+  std::size_t max_workspace_bytes,
+  raft::device_csr_matrix<bool, value_idx, value_idx, value_idx>& adj,
+  distance_func dfunc)
+{
+  ASSERT(index.is_index_trained(), "index must be previously trained");
+
+  auto stream = resource::get_cuda_stream(handle);
+  // the landmark distances and the row offsets of a batch
+  std::size_t bytes_per_query = index.n_landmarks * sizeof(value_t) + sizeof(value_idx);
+  value_int batch_size = std::max<value_int>(
+    1, std::min<value_int>(n_query_pts, max_workspace_bytes / bytes_per_query));
+
+  auto R_dists =
+    raft::make_device_matrix<value_t, matrix_idx>(handle, batch_size, index.n_landmarks);
+
+  auto batch_ia = raft::make_device_vector<value_idx, matrix_idx>(handle, batch_size + 1);
+  auto counts   = raft::make_device_vector<value_idx, matrix_idx>(handle, n_query_pts + 1);
+  auto row_ia   = rmm::device_uvector<value_idx>(n_query_pts + 1, stream);
+
+  // pass 1: the number of neighbors of every query
+  for (value_int offset = 0; offset < n_query_pts; offset += batch_size) {
+    value_int n_batch = std::min<value_int>(batch_size, n_query_pts - offset);
+    compute_landmark_dists(handle, index, query + offset * index.n, n_batch, R_dists.data_handle());
+    rbc_eps_pass<value_idx, value_t, value_int, matrix_idx>(handle,
+                                                            index,
+                                                            query + offset * index.n,
+                                                            n_batch,
+                                                            eps,
+                                                            nullptr,
+                                                            R_dists.data_handle(),
+                                                            dfunc,
+                                                            batch_ia.data_handle(),
+                                                            nullptr,
+                                                            counts.data_handle() + offset);
+  }
+  thrust::exclusive_scan(resource::get_thrust_policy(handle),
+                         counts.data_handle(),
+                         counts.data_handle() + n_query_pts + 1,
+                         row_ia.data(),
+                         value_idx{0});
+  value_idx nnz = 0;
+  raft::copy(&nnz, row_ia.data() + n_query_pts, 1, stream);
+  resource::sync_stream(handle);
+
+  adj.initialize_sparsity(nnz);
+  auto structure = adj.structure_view();
+  RAFT_EXPECTS(structure.get_n_rows() == n_query_pts && structure.get_n_cols() == index.m,
+               "The adjacency matrix must be of the shape [n_query_pts, index.m]");
+  value_idx* adj_ia = structure.get_indptr().data();
+  value_idx* adj_ja = structure.get_indices().data();
+  raft::copy(adj_ia, row_ia.data(), n_query_pts + 1, stream);
+  thrust::fill(resource::get_thrust_policy(handle),
+               adj.get_elements().data(),
+               adj.get_elements().data() + nnz,
+               true);
+  if (nnz == 0) { return; }
+
+  // pass 2: the column indices, at the offsets of pass 1
+  for (value_int offset = 0; offset < n_query_pts; offset += batch_size) {
+    value_int n_batch = std::min<value_int>(batch_size, n_query_pts - offset);
+    compute_landmark_dists(handle, index, query + offset * index.n, n_batch, R_dists.data_handle());
+    rbc_eps_pass<value_idx, value_t, value_int, matrix_idx>(handle,
+                                                            index,
+                                                            query + offset * index.n,
+                                                            n_batch,
+                                                            eps,
+                                                            nullptr,
+                                                            R_dists.data_handle(),
+                                                            dfunc,
+                                                            adj_ia + offset,
+                                                            adj_ja,
+                                                            nullptr);
+  }
+}
+
 };  // namespace detail
 };  // namespace knn
 };  // namespace spatial
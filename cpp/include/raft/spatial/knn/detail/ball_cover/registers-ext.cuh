@@ -173,6 +173,18 @@ instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_one(
   std::int64_t, float, std::int64_t, std::int64_t, 2, raft::spatial::knn::detail::DistFunc);
 instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_one(
   std::int64_t, float, std::int64_t, std::int64_t, 3, raft::spatial::knn::detail::DistFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_one(
+  std::int64_t, float, std::int64_t, std::int64_t, 0, raft::spatial::knn::detail::HaversineFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_one(
+  std::int64_t, float, std::int64_t, std::int64_t, 0, raft::spatial::knn::detail::EuclideanFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_one(
+  std::int64_t, float, std::int64_t, std::int64_t, 0, raft::spatial::knn::detail::DistFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_one(
+  std::int64_t, float, std::int64_t, std::int64_t, 2, raft::spatial::knn::detail::CosineFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_one(
+  std::int64_t, float, std::int64_t, std::int64_t, 3, raft::spatial::knn::detail::CosineFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_one(
+  std::int64_t, float, std::int64_t, std::int64_t, 0, raft::spatial::knn::detail::CosineFunc);
 
 instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
   std::int64_t, float, std::int64_t, std::int64_t, 2, raft::spatial::knn::detail::HaversineFunc);
@@ -186,6 +198,18 @@ instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
   std::int64_t, float, std::int64_t, std::int64_t, 2, raft::spatial::knn::detail::DistFunc);
 instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
   std::int64_t, float, std::int64_t, std::int64_t, 3, raft::spatial::knn::detail::DistFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
+  std::int64_t, float, std::int64_t, std::int64_t, 0, raft::spatial::knn::detail::HaversineFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
+  std::int64_t, float, std::int64_t, std::int64_t, 0, raft::spatial::knn::detail::EuclideanFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
+  std::int64_t, float, std::int64_t, std::int64_t, 0, raft::spatial::knn::detail::DistFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
+  std::int64_t, float, std::int64_t, std::int64_t, 2, raft::spatial::knn::detail::CosineFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
+  std::int64_t, float, std::int64_t, std::int64_t, 3, raft::spatial::knn::detail::CosineFunc);
+instantiate_raft_spatial_knn_detail_rbc_low_dim_pass_two(
+  std::int64_t, float, std::int64_t, std::int64_t, 0, raft::spatial::knn::detail::CosineFunc);
 
 instantiate_raft_spatial_knn_detail_rbc_eps_pass(
   std::int64_t, float, std::int64_t, std::int64_t, raft::spatial::knn::detail::EuclideanFunc);
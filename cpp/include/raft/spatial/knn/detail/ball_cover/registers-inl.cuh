@@ -39,6 +39,50 @@ namespace spatial {
 namespace knn {
 namespace detail {
 
+/**
+ * Load the query row of the block. The rows are kept in the registers (`local_row`) for the low
+ * dimensionalities (at most `col_q` columns); with `col_q == 0` (any number of columns), the query
+ * row is staged in the shared memory (`smem_row`) instead.
+ */
+template <int col_q, int tpb, typename value_t, typename value_int>
+__device__ __forceinline__ auto load_query_row(const value_t* row,
+                                               value_t* local_row,
+                                               value_t* smem_row,
+                                               value_int n_cols) -> const value_t*
+{
+  if constexpr (col_q == 0) {
+    for (value_int j = threadIdx.x; j < n_cols; j += tpb) {
+      smem_row[j] = row[j];
+    }
+    __syncthreads();
+    return smem_row;
+  } else {
+    for (value_int j = 0; j < n_cols; ++j) {
+      local_row[j] = row[j];
+    }
+    return local_row;
+  }
+}
+
+/**
+ * Load a candidate row into the registers (`col_q > 0`), or read it in place from the global
+ * memory for the arbitrary dimensionality (`col_q == 0`).
+ */
+template <int col_q, typename value_t, typename value_int>
+__device__ __forceinline__ auto load_candidate_row(const value_t* row,
+                                                   value_t* local_row,
+                                                   value_int n_cols) -> const value_t*
+{
+  if constexpr (col_q == 0) {
+    return row;
+  } else {
+    for (value_int j = 0; j < n_cols; ++j) {
+      local_row[j] = row[j];
+    }
+    return local_row;
+  }
+}
+
 /**
  * To find exact neighbors, we perform a post-processing stage
  * that filters out those points which might have neighbors outside
@@ -79,27 +123,28 @@ RAFT_KERNEL perform_post_filter_registers(const value_t* X,
                                           std::uint32_t* output,
                                           float weight = 1.0)
 {
-  // allocate array of size n_landmarks / 32 ints
+  // allocate array of size n_landmarks / 32 ints (preceded by the query row if col_q == 0)
   extern __shared__ std::uint32_t shared_mem[];
+  std::uint32_t* bitset =
+    col_q == 0 ? shared_mem + n_cols * sizeof(value_t) / sizeof(std::uint32_t) : shared_mem;
 
   // Start with all bits on
   for (value_int i = threadIdx.x; i < bitset_size; i += tpb) {
-    shared_mem[i] = 0xffffffff;
+    bitset[i] = 0xffffffff;
   }
 
-  __syncthreads();
-
   // TODO: Would it be faster to use L1 for this?
-  value_t local_x_ptr[col_q];
-  for (value_int j = 0; j < n_cols; ++j) {
-    local_x_ptr[j] = X[n_cols * blockIdx.x + j];
-  }
+  value_t local_x[col_q > 0 ? col_q : 1];
+  const value_t* local_x_ptr = load_query_row<col_q, tpb>(
+    X + n_cols * blockIdx.x, local_x, reinterpret_cast<value_t*>(shared_mem), n_cols);
+
+  __syncthreads();
 
   value_t closest_R_dist = R_knn_dists[blockIdx.x * k + (k - 1)];
 
   // zero out bits for closest k landmarks
   for (value_int j = threadIdx.x; j < k; j += tpb) {
-    _zero_bit(shared_mem, (std::uint32_t)R_knn_inds[blockIdx.x * k + j]);
+    _zero_bit(bitset, (std::uint32_t)R_knn_inds[blockIdx.x * k + j]);
   }
 
   __syncthreads();
@@ -112,7 +157,7 @@ RAFT_KERNEL perform_post_filter_registers(const value_t* X,
     // compute p(q, r)
     value_t dist = dfunc(local_x_ptr, landmarks + (n_cols * l), n_cols);
     if (dist > weight * (closest_R_dist + R_radius[l]) || dist > 3 * closest_R_dist) {
-      _zero_bit(shared_mem, l);
+      _zero_bit(bitset, l);
     }
   }
 
@@ -122,7 +167,7 @@ RAFT_KERNEL perform_post_filter_registers(const value_t* X,
    * Output bitset
    */
   for (value_int l = threadIdx.x; l < bitset_size; l += tpb) {
-    output[blockIdx.x * bitset_size + l] = shared_mem[l];
+    output[blockIdx.x * bitset_size + l] = bitset[l];
   }
 }
 
@@ -177,12 +222,13 @@ RAFT_KERNEL compute_final_dists_registers(const value_t* X_index,
 
   __shared__ value_t shared_memK[kNumWarps * warp_q];
   __shared__ KeyValuePair<value_t, value_idx> shared_memV[kNumWarps * warp_q];
+  // the query row if col_q == 0
+  extern __shared__ std::uint32_t shared_mem[];
 
   const value_t* x_ptr = X + (n_cols * blockIdx.x);
-  value_t local_x_ptr[col_q];
-  for (value_int j = 0; j < n_cols; ++j) {
-    local_x_ptr[j] = x_ptr[j];
-  }
+  value_t local_x[col_q > 0 ? col_q : 1];
+  const value_t* local_x_ptr =
+    load_query_row<col_q, tpb>(x_ptr, local_x, reinterpret_cast<value_t*>(shared_mem), n_cols);
 
   using namespace raft::neighbors::detail::faiss_select;
   KeyValueBlockSelect<value_t, value_idx, false, Comparator<value_t>, warp_q, thread_q, tpb> heap(
@@ -238,11 +284,9 @@ RAFT_KERNEL compute_final_dists_registers(const value_t* X_index,
         // the closest k neighbors, compute it and add to k-select
         value_t dist = std::numeric_limits<value_t>::max();
         if (z <= heap.warpKTop) {
-          const value_t* y_ptr = X_index + (n_cols * cur_candidate_ind);
-          value_t local_y_ptr[col_q];
-          for (value_int j = 0; j < n_cols; ++j) {
-            local_y_ptr[j] = y_ptr[j];
-          }
+          value_t local_y[col_q > 0 ? col_q : 1];
+          const value_t* local_y_ptr =
+            load_candidate_row<col_q>(X_index + (n_cols * cur_candidate_ind), local_y, n_cols);
 
           dist = dfunc(local_x_ptr, local_y_ptr, n_cols);
         }
@@ -267,11 +311,9 @@ RAFT_KERNEL compute_final_dists_registers(const value_t* X_index,
         // the closest k neighbors, compute it and add to k-select
         value_t dist = std::numeric_limits<value_t>::max();
         if (z <= heap.warpKTop) {
-          const value_t* y_ptr = X_index + (n_cols * cur_candidate_ind);
-          value_t local_y_ptr[col_q];
-          for (value_int j = 0; j < n_cols; ++j) {
-            local_y_ptr[j] = y_ptr[j];
-          }
+          value_t local_y[col_q > 0 ? col_q : 1];
+          const value_t* local_y_ptr =
+            load_candidate_row<col_q>(X_index + (n_cols * cur_candidate_ind), local_y, n_cols);
           dist = dfunc(local_x_ptr, local_y_ptr, n_cols);
         }
         heap.addThreadQ(dist, cur_candidate_dist, cur_candidate_ind);
@@ -315,7 +357,7 @@ template <typename value_idx = std::int64_t,
           typename distance_func>
 RAFT_KERNEL block_rbc_kernel_registers(const value_t* X_index,
                                        const value_t* X,
-                                       value_int n_cols,  // n_cols should be 2 or 3 dims
+                                       value_int n_cols,  // at most col_q, unless col_q == 0
                                        const value_idx* R_knn_inds,
                                        const value_t* R_knn_dists,
                                        value_int m,
@@ -335,17 +377,15 @@ RAFT_KERNEL block_rbc_kernel_registers(const value_t* X_index,
   __shared__ value_t shared_memK[kNumWarps * warp_q];
   __shared__ KeyValuePair<value_t, value_idx> shared_memV[kNumWarps * warp_q];
 
-  // TODO: Separate kernels for different widths:
-  // 1. Very small (between 3 and 32) just use registers for columns of "blockIdx.x"
-  // 2. Can fit comfortably in shared memory (32 to a few thousand?)
-  // 3. Load each time individually.
+  // the query row if col_q == 0
+  extern __shared__ std::uint32_t shared_mem[];
+
   const value_t* x_ptr = X + (n_cols * blockIdx.x);
 
-  // Use registers only for 2d or 3d
-  value_t local_x_ptr[col_q];
-  for (value_int i = 0; i < n_cols; ++i) {
-    local_x_ptr[i] = x_ptr[i];
-  }
+  // Use registers only for 2d or 3d, the shared memory otherwise
+  value_t local_x[col_q > 0 ? col_q : 1];
+  const value_t* local_x_ptr =
+    load_query_row<col_q, tpb>(x_ptr, local_x, reinterpret_cast<value_t*>(shared_mem), n_cols);
 
   // Each warp works on 1 R
   using namespace raft::neighbors::detail::faiss_select;
@@ -408,11 +448,9 @@ RAFT_KERNEL block_rbc_kernel_registers(const value_t* X_index,
       value_t dist = std::numeric_limits<value_t>::max();
 
       if (z <= heap.warpKTop) {
-        const value_t* y_ptr = X_index + (n_cols * cur_candidate_ind);
-        value_t local_y_ptr[col_q];
-        for (value_int j = 0; j < n_cols; ++j) {
-          local_y_ptr[j] = y_ptr[j];
-        }
+        value_t local_y[col_q > 0 ? col_q : 1];
+        const value_t* local_y_ptr =
+          load_candidate_row<col_q>(X_index + (n_cols * cur_candidate_ind), local_y, n_cols);
         dist = dfunc(local_x_ptr, local_y_ptr, n_cols);
         ++n_dists_computed;
       }
@@ -433,11 +471,9 @@ RAFT_KERNEL block_rbc_kernel_registers(const value_t* X_index,
       value_t dist = std::numeric_limits<value_t>::max();
 
       if (z <= heap.warpKTop) {
-        const value_t* y_ptr = X_index + (n_cols * cur_candidate_ind);
-        value_t local_y_ptr[col_q];
-        for (value_int j = 0; j < n_cols; ++j) {
-          local_y_ptr[j] = y_ptr[j];
-        }
+        value_t local_y[col_q > 0 ? col_q : 1];
+        const value_t* local_y_ptr =
+          load_candidate_row<col_q>(X_index + (n_cols * cur_candidate_ind), local_y, n_cols);
         dist = dfunc(local_x_ptr, local_y_ptr, n_cols);
         ++n_dists_computed;
       }
@@ -701,6 +737,12 @@ RAFT_KERNEL block_rbc_kernel_eps_max_k_copy(const value_int max_k,
   if (i < num_cols) { adj_ja[col_start_idx + i] = tmp[offset + i]; }
 }
 
+/**
+ * The k-select over the k closest landmarks of each query.
+ *
+ * @tparam dims the number of columns kept in the registers (2 or 3), or 0 for any number of
+ *   columns (the query rows are then kept in the shared memory).
+ */
 template <typename value_idx,
           typename value_t,
           typename value_int  = std::int64_t,
@@ -720,9 +762,11 @@ void rbc_low_dim_pass_one(raft::resources const& handle,
                           float weight,
                           value_int* dists_counter)
 {
+  // dims == 0: any dimensionality, the query rows are kept in the shared memory
+  const size_t smem_size = dims == 0 ? index.n * sizeof(value_t) : 0;
   if (k <= 32)
     block_rbc_kernel_registers<value_idx, value_t, 32, 2, 128, dims, value_int>
-      <<<n_query_rows, 128, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 128, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -741,8 +785,8 @@ void rbc_low_dim_pass_one(raft::resources const& handle,
         weight);
 
   else if (k <= 64)
-    block_rbc_kernel_registers<value_idx, value_t, 64, 3, 128, 2, value_int>
-      <<<n_query_rows, 128, 0, resource::get_cuda_stream(handle)>>>(
+    block_rbc_kernel_registers<value_idx, value_t, 64, 3, 128, dims, value_int>
+      <<<n_query_rows, 128, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -761,7 +805,7 @@ void rbc_low_dim_pass_one(raft::resources const& handle,
         weight);
   else if (k <= 128)
     block_rbc_kernel_registers<value_idx, value_t, 128, 3, 128, dims, value_int>
-      <<<n_query_rows, 128, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 128, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -781,7 +825,7 @@ void rbc_low_dim_pass_one(raft::resources const& handle,
 
   else if (k <= 256)
     block_rbc_kernel_registers<value_idx, value_t, 256, 4, 128, dims, value_int>
-      <<<n_query_rows, 128, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 128, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -801,7 +845,7 @@ void rbc_low_dim_pass_one(raft::resources const& handle,
 
   else if (k <= 512)
     block_rbc_kernel_registers<value_idx, value_t, 512, 8, 64, dims, value_int>
-      <<<n_query_rows, 64, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 64, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -821,7 +865,7 @@ void rbc_low_dim_pass_one(raft::resources const& handle,
 
   else if (k <= 1024)
     block_rbc_kernel_registers<value_idx, value_t, 1024, 8, 64, dims, value_int>
-      <<<n_query_rows, 64, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 64, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -840,6 +884,10 @@ void rbc_low_dim_pass_one(raft::resources const& handle,
         weight);
 }
 
+/**
+ * The post-filtering of the landmarks that may still hold closer neighbors than the ones found in
+ * the first pass, and the k-select over them (the same `dims` as in `rbc_low_dim_pass_one`).
+ */
 template <typename value_idx,
           typename value_t,
           typename value_int  = std::int64_t,
@@ -866,8 +914,14 @@ void rbc_low_dim_pass_two(raft::resources const& handle,
   thrust::fill(
     resource::get_thrust_policy(handle), bitset.data(), bitset.data() + bitset.size(), 0);
 
+  // dims == 0: any dimensionality, the query rows are kept in the shared memory
+  const size_t smem_size = dims == 0 ? index.n * sizeof(value_t) : 0;
+
   perform_post_filter_registers<value_idx, value_t, value_int, dims, 128>
-    <<<n_query_rows, 128, bitset_size * sizeof(std::uint32_t), resource::get_cuda_stream(handle)>>>(
+    <<<n_query_rows,
+       128,
+       smem_size + bitset_size * sizeof(std::uint32_t),
+       resource::get_cuda_stream(handle)>>>(
       query,
       index.n,
       R_knn_inds,
@@ -891,7 +945,7 @@ void rbc_low_dim_pass_two(raft::resources const& handle,
                                   2,
                                   128,
                                   dims>
-      <<<n_query_rows, 128, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 128, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -917,7 +971,7 @@ void rbc_low_dim_pass_two(raft::resources const& handle,
                                   3,
                                   128,
                                   dims>
-      <<<n_query_rows, 128, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 128, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -943,7 +997,7 @@ void rbc_low_dim_pass_two(raft::resources const& handle,
                                   3,
                                   128,
                                   dims>
-      <<<n_query_rows, 128, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 128, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -969,7 +1023,7 @@ void rbc_low_dim_pass_two(raft::resources const& handle,
                                   4,
                                   128,
                                   dims>
-      <<<n_query_rows, 128, 0, resource::get_cuda_stream(handle)>>>(
+      <<<n_query_rows, 128, smem_size, resource::get_cuda_stream(handle)>>>(
         index.get_X().data_handle(),
         query,
         index.n,
@@ -994,22 +1048,23 @@ void rbc_low_dim_pass_two(raft::resources const& handle,
                                   512,
                                   8,
                                   64,
-                                  dims><<<n_query_rows, 64, 0, resource::get_cuda_stream(handle)>>>(
-      index.get_X().data_handle(),
-      query,
-      index.n,
-      bitset.data(),
-      bitset_size,
-      index.get_R_closest_landmark_dists().data_handle(),
-      index.get_R_indptr().data_handle(),
-      index.get_R_1nn_cols().data_handle(),
-      index.get_R_1nn_dists().data_handle(),
-      inds,
-      dists,
-      index.n_landmarks,
-      k,
-      dfunc,
-      post_dists_counter);
+                                  dims>
+      <<<n_query_rows, 64, smem_size, resource::get_cuda_stream(handle)>>>(
+        index.get_X().data_handle(),
+        query,
+        index.n,
+        bitset.data(),
+        bitset_size,
+        index.get_R_closest_landmark_dists().data_handle(),
+        index.get_R_indptr().data_handle(),
+        index.get_R_1nn_cols().data_handle(),
+        index.get_R_1nn_dists().data_handle(),
+        inds,
+        dists,
+        index.n_landmarks,
+        k,
+        dfunc,
+        post_dists_counter);
   else if (k <= 1024)
     compute_final_dists_registers<value_idx,
                                   value_t,
@@ -1019,22 +1074,23 @@ void rbc_low_dim_pass_two(raft::resources const& handle,
                                   1024,
                                   8,
                                   64,
-                                  dims><<<n_query_rows, 64, 0, resource::get_cuda_stream(handle)>>>(
-      index.get_X().data_handle(),
-      query,
-      index.n,
-      bitset.data(),
-      bitset_size,
-      index.get_R_closest_landmark_dists().data_handle(),
-      index.get_R_indptr().data_handle(),
-      index.get_R_1nn_cols().data_handle(),
-      index.get_R_1nn_dists().data_handle(),
-      inds,
-      dists,
-      index.n_landmarks,
-      k,
-      dfunc,
-      post_dists_counter);
+                                  dims>
+      <<<n_query_rows, 64, smem_size, resource::get_cuda_stream(handle)>>>(
+        index.get_X().data_handle(),
+        query,
+        index.n,
+        bitset.data(),
+        bitset_size,
+        index.get_R_closest_landmark_dists().data_handle(),
+        index.get_R_indptr().data_handle(),
+        index.get_R_1nn_cols().data_handle(),
+        index.get_R_1nn_dists().data_handle(),
+        inds,
+        dists,
+        index.n_landmarks,
+        k,
+        dfunc,
+        post_dists_counter);
 }
 
 template <typename value_idx,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -60,6 +60,31 @@ struct EuclideanFunc : public DistFunc<value_t, value_int> {
   }
 };
 
+/**
+ * The chord distance between the directions of two vectors, `sqrt(2 - 2 cos(a, b))` (i.e. the
+ * Euclidean distance between the normalized vectors). Unlike the cosine distance `1 - cos(a, b)`,
+ * it is a metric, so the triangle inequality used by the pruning holds.
+ */
+template <typename value_t, typename value_int = std::uint32_t>
+struct CosineFunc : public DistFunc<value_t, value_int> {
+  __device__ __host__ __forceinline__ value_t operator()(const value_t* a,
+                                                         const value_t* b,
+                                                         const value_int n_dims) override
+  {
+    value_t dot    = 0;
+    value_t norm_a = 0;
+    value_t norm_b = 0;
+    for (value_int i = 0; i < n_dims; ++i) {
+      dot += a[i] * b[i];
+      norm_a += a[i] * a[i];
+      norm_b += b[i] * b[i];
+    }
+    value_t norms = raft::sqrt(norm_a * norm_b);
+    value_t sq    = norms > 0 ? 2 - 2 * (dot / norms) : value_t(2);
+    return sq > 0 ? raft::sqrt(sq) : value_t(0);
+  }
+};
+
 };  // namespace detail
 };  // namespace knn
 };  // namespace spatial
@@ -16,9 +16,31 @@
 
 #pragma once
 
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/distance.cuh>
+#include <raft/distance/distance_types.hpp>
+#include <raft/linalg/coalesced_reduction.cuh>
 #include <raft/linalg/contractions.cuh>
+#include <raft/util/cudart_utils.hpp>
 #include <raft/util/device_utils.cuh>
 
+#include <rmm/device_uvector.hpp>
+
+#include <thrust/copy.h>
+#include <thrust/fill.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/scan.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
 namespace raft {
 namespace spatial {
 namespace knn {
@@ -236,6 +258,129 @@ void epsUnexpL2SqNeighborhood(bool* adj,
     epsUnexpL2SqNeighImpl<DataT, IdxT, 1>(adj, vd, x, y, m, n, k, eps, stream);
   }
 }
+
+/** Whether a distance is within the epsilon radius (for a similarity: whether it is >= eps). */
+template <typename DataT>
+struct within_eps_op {
+  DataT eps;
+  bool similarity;
+
+  template <typename... UnusedArgs>
+  HDI auto operator()(DataT d, UnusedArgs...) const -> bool
+  {
+    return similarity ? d >= eps : d <= eps;
+  }
+};
+
+/**
+ * @brief Computes the epsilon neighborhood into a CSR matrix, for any of the expanded distances
+ *
+ * The rows of `x` are processed in batches: the distances of a batch to all the rows of `y` (the
+ * only workspace scaling with the batch size) are bounded by `max_workspace_bytes`. The degrees of
+ * the batch rows are reduced from the distances and scanned into the row offsets, and the column
+ * indices are compacted at these offsets, so that neither the dense adjacency nor a second pass
+ * is needed. The column indices are accumulated in a buffer growing geometrically, and copied into
+ * the sparsity of `adj` once the number of edges is known.
+ *
+ * @param[in]  handle raft handle to manage library resources
+ * @param[in]  x      first matrix [row-major] [on device] [dim = m x k]
+ * @param[in]  y      second matrix [row-major] [on device] [dim = n x k]
+ * @param[in]  m      number of rows in x
+ * @param[in]  n      number of rows in y
+ * @param[in]  k      number of columns in x and k
+ * @param[in]  eps    the epsilon radius, in the units of the distance (e.g. squared for
+ *                    L2Expanded); for InnerProduct, the minimum similarity of the neighbors
+ * @param[in]  metric one of L2Expanded, L2SqrtExpanded, CosineExpanded, CorrelationExpanded or
+ *                    InnerProduct
+ * @param[in]  max_workspace_bytes the bound of the distances of a batch of rows of x
+ * @param[out] adj    sparsity-owning adjacency matrix [dim = m x n]; its sparsity is initialized
+ *                    by this function and all its elements are set to `true`
+ */
+template <typename DataT, typename IdxT>
+void epsNeighborhoodCsr(raft::resources const& handle,
+                        const DataT* x,
+                        const DataT* y,
+                        IdxT m,
+                        IdxT n,
+                        IdxT k,
+                        DataT eps,
+                        raft::distance::DistanceType metric,
+                        std::size_t max_workspace_bytes,
+                        raft::device_csr_matrix<bool, IdxT, IdxT, IdxT>& adj)
+{
+  using raft::distance::DistanceType;
+  RAFT_EXPECTS(metric == DistanceType::L2Expanded || metric == DistanceType::L2SqrtExpanded ||
+                 metric == DistanceType::CosineExpanded ||
+                 metric == DistanceType::CorrelationExpanded ||
+                 metric == DistanceType::InnerProduct,
+               "Only the expanded distances are supported");
+  RAFT_EXPECTS(n < std::numeric_limits<int>::max() && k < std::numeric_limits<int>::max(),
+               "The number of rows and columns of y should fit an int");
+
+  auto stream = resource::get_cuda_stream(handle);
+  auto policy = resource::get_thrust_policy(handle);
+  within_eps_op<DataT> is_neighbor{eps, metric == DistanceType::InnerProduct};
+
+  // the distances of a batch, with a tile of less than 2^31 elements (the distance indexing)
+  std::size_t row_len    = std::max<std::size_t>(1, n);
+  std::size_t batch_rows = std::min<std::size_t>({std::size_t(m),
+                                                  max_workspace_bytes / (row_len * sizeof(DataT)),
+                                                  std::numeric_limits<int>::max() / row_len});
+  IdxT batch_size        = std::max<std::size_t>(1, batch_rows);
+  rmm::device_uvector<DataT> dists(std::size_t(batch_size) * n, stream);
+  rmm::device_uvector<char> workspace(0, stream);
+  rmm::device_uvector<IdxT> indptr(m + 1, stream);
+  rmm::device_uvector<IdxT> indices(0, stream);
+  RAFT_CUDA_TRY(cudaMemsetAsync(indptr.data(), 0, sizeof(IdxT), stream));
+
+  IdxT nnz  = 0;
+  auto cols = thrust::make_transform_iterator(
+    thrust::make_counting_iterator<int64_t>(0),
+    [n] __device__(int64_t i) -> IdxT { return IdxT(i % n); });
+  for (IdxT offset = 0; offset < m && n > 0; offset += batch_size) {
+    IdxT n_batch = std::min<IdxT>(batch_size, m - offset);
+    raft::distance::pairwise_distance<DataT, int>(handle,
+                                                  x + std::size_t(offset) * k,
+                                                  y,
+                                                  dists.data(),
+                                                  int(n_batch),
+                                                  int(n),
+                                                  int(k),
+                                                  workspace,
+                                                  metric,
+                                                  true);
+
+    // the degrees, scanned into the row offsets after the edges of the previous batches
+    IdxT* batch_indptr = indptr.data() + offset;
+    raft::linalg::coalescedReduction<DataT, IdxT, IdxT>(
+      batch_indptr + 1, dists.data(), n, n_batch, IdxT(0), stream, false, is_neighbor);
+    thrust::inclusive_scan(policy, batch_indptr, batch_indptr + n_batch + 1, batch_indptr);
+    IdxT batch_end = 0;
+    raft::copy(&batch_end, batch_indptr + n_batch, 1, stream);
+    resource::sync_stream(handle, stream);
+
+    if (std::size_t(batch_end) > indices.capacity()) {
+      indices.reserve(std::max<std::size_t>(batch_end, 2 * indices.capacity()), stream);
+    }
+    indices.resize(batch_end, stream);
+    thrust::copy_if(policy,
+                    cols,
+                    cols + std::size_t(n_batch) * n,
+                    dists.data(),
+                    indices.data() + nnz,
+                    is_neighbor);
+    nnz = batch_end;
+  }
+  if (n == 0) { RAFT_CUDA_TRY(cudaMemsetAsync(indptr.data(), 0, (m + 1) * sizeof(IdxT), stream)); }
+
+  adj.initialize_sparsity(nnz);
+  auto structure = adj.structure_view();
+  RAFT_EXPECTS(structure.get_n_rows() == m && structure.get_n_cols() == n,
+               "The adjacency matrix must be of the shape [m, n]");
+  raft::copy(structure.get_indptr().data(), indptr.data(), m + 1, stream);
+  raft::copy(structure.get_indices().data(), indices.data(), nnz, stream);
+  thrust::fill(policy, adj.get_elements().data(), adj.get_elements().data() + nnz, true);
+}
 }  // namespace detail
 }  // namespace knn
 }  // namespace spatial
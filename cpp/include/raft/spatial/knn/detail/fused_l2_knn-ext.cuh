@@ -20,6 +20,8 @@
 #include <raft/distance/distance_types.hpp>  // DistanceType
 #include <raft/util/raft_explicit.hpp>       // RAFT_EXPLICIT
 
+#include <rmm/mr/device/device_memory_resource.hpp>  // device_memory_resource
+
 #if defined(RAFT_EXPLICIT_INSTANTIATE_ONLY)
 
 namespace raft::spatial::knn::detail {
@@ -37,8 +39,10 @@ void fusedL2Knn(size_t D,
                 bool rowMajorQuery,
                 cudaStream_t stream,
                 raft::distance::DistanceType metric,
-                const value_t* index_norms = NULL,
-                const value_t* query_norms = NULL) RAFT_EXPLICIT;
+                const value_t* index_norms          = NULL,
+                const value_t* query_norms          = NULL,
+                value_t metric_arg                  = 2.0,
+                rmm::mr::device_memory_resource* mr = nullptr) RAFT_EXPLICIT;
 
 }  // namespace raft::spatial::knn::detail
 
@@ -60,7 +64,9 @@ void fusedL2Knn(size_t D,
     cudaStream_t stream,                                                                    \
     raft::distance::DistanceType metric,                                                    \
     const Mvalue_t* index_norms,                                                            \
-    const Mvalue_t* query_norms);
+    const Mvalue_t* query_norms,                                                            \
+    Mvalue_t metric_arg,                                                                    \
+    rmm::mr::device_memory_resource* mr);
 
 instantiate_raft_spatial_knn_detail_fusedL2Knn(int32_t, float, true);
 instantiate_raft_spatial_knn_detail_fusedL2Knn(int32_t, float, false);
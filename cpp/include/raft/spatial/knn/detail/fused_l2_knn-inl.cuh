@@ -17,16 +17,28 @@
 #include <cub/cub.cuh>
 #include <limits>
 #include <raft/linalg/norm.cuh>
+#include <raft/linalg/unary_op.cuh>
 #include <raft/neighbors/detail/faiss_select/Select.cuh>
 // TODO: Need to hide the PairwiseDistance class impl and expose to public API
 #include "processing.cuh"
 #include <raft/core/operators.hpp>
 #include <raft/distance/detail/distance.cuh>
+#include <raft/distance/detail/distance_ops/canberra.cuh>
+#include <raft/distance/detail/distance_ops/cosine.cuh>
+#include <raft/distance/detail/distance_ops/hamming.cuh>
+#include <raft/distance/detail/distance_ops/jensen_shannon.cuh>
+#include <raft/distance/detail/distance_ops/l1.cuh>
 #include <raft/distance/detail/distance_ops/l2_exp.cuh>
 #include <raft/distance/detail/distance_ops/l2_unexp.cuh>
+#include <raft/distance/detail/distance_ops/l_inf.cuh>
+#include <raft/distance/detail/distance_ops/lp_unexp.cuh>
+#include <raft/distance/detail/distance_ops/russel_rao.cuh>
 #include <raft/distance/detail/pairwise_distance_base.cuh>
 #include <raft/util/cuda_utils.cuh>
 
+#include <rmm/device_uvector.hpp>
+#include <rmm/mr/device/per_device_resource.hpp>
+
 namespace raft {
 namespace spatial {
 namespace knn {
@@ -916,7 +928,228 @@ void fusedL2ExpKnn(IdxT m,
 }
 
 /**
- * Compute the k-nearest neighbors using L2 expanded/unexpanded distance.
+ * The negated inner product <x, y>.
+ *
+ * The fused kernel always selects the smallest distances: negating the products lets it select the
+ * largest ones (the caller negates the results back).
+ */
+template <typename DataType, typename AccType, typename IdxType>
+struct neg_inner_product_distance_op {
+  using DataT = DataType;
+  using AccT  = AccType;
+  using IdxT  = IdxType;
+
+  static constexpr bool use_norms            = false;
+  static constexpr bool expensive_inner_loop = false;
+
+  template <typename Policy>
+  static constexpr size_t shared_mem_size()
+  {
+    return Policy::SmemSize;
+  }
+
+  DI void core(AccT& acc, DataT& x, DataT& y) const { acc += x * y; };
+
+  template <typename Policy>
+  DI void epilog(AccT acc[Policy::AccRowsPerTh][Policy::AccColsPerTh],
+                 DataT* regxn,
+                 DataT* regyn,
+                 IdxT gridStrideX,
+                 IdxT gridStrideY) const
+  {
+#pragma unroll
+    for (int i = 0; i < Policy::AccRowsPerTh; ++i) {
+#pragma unroll
+      for (int j = 0; j < Policy::AccColsPerTh; ++j) {
+        acc[i][j] = -acc[i][j];
+      }
+    }
+  }
+};
+
+/**
+ * The fused distance + k-selection for any distance op of `raft::distance::detail::ops` (the
+ * smallest distances are selected). The norms `xn`, `yn` are only read if `OpT::use_norms`.
+ */
+template <typename DataT,
+          typename OutT,
+          typename IdxT,
+          int VecLen,
+          bool usePrevTopKs,
+          bool isRowMajor,
+          typename OpT>
+void fusedDistanceKnnImpl(const DataT* x,
+                          const DataT* y,
+                          const DataT* xn,
+                          const DataT* yn,
+                          IdxT m,
+                          IdxT n,
+                          IdxT k,
+                          IdxT lda,
+                          IdxT ldb,
+                          IdxT ldd,
+                          OpT distance_op,
+                          OutT* out_dists,
+                          IdxT* out_inds,
+                          IdxT numOfNN,
+                          cudaStream_t stream,
+                          void* workspace,
+                          size_t& worksize)
+{
+  typedef typename raft::linalg::Policy2x8<DataT, 1>::Policy RowPolicy;
+  typedef typename raft::linalg::Policy4x4<DataT, VecLen>::ColPolicy ColPolicy;
+
+  typedef typename std::conditional<true, RowPolicy, ColPolicy>::type KPolicy;
+
+  ASSERT(isRowMajor, "Only Row major inputs are allowed");
+
+  dim3 blk(KPolicy::Nthreads);
+
+  typedef cub::KeyValuePair<uint32_t, typename OpT::AccT> Pair;
+
+  raft::identity_op fin_op{};
+
+  if constexpr (isRowMajor) {
+    constexpr auto fusedDistanceKnn32RowMajor = fusedL2kNN<DataT,
+                                                           OutT,
+                                                           IdxT,
+                                                           KPolicy,
+                                                           OpT,
+                                                           decltype(fin_op),
+                                                           32,
+                                                           2,
+                                                           usePrevTopKs,
+                                                           isRowMajor>;
+    constexpr auto fusedDistanceKnn64RowMajor = fusedL2kNN<DataT,
+                                                           OutT,
+                                                           IdxT,
+                                                           KPolicy,
+                                                           OpT,
+                                                           decltype(fin_op),
+                                                           64,
+                                                           3,
+                                                           usePrevTopKs,
+                                                           isRowMajor>;
+
+    auto fusedDistanceKnnRowMajor = fusedDistanceKnn32RowMajor;
+    if (numOfNN <= 32) {
+      fusedDistanceKnnRowMajor = fusedDistanceKnn32RowMajor;
+    } else if (numOfNN <= 64) {
+      fusedDistanceKnnRowMajor = fusedDistanceKnn64RowMajor;
+    } else {
+      ASSERT(numOfNN <= 64, "fusedL2kNN: num of nearest neighbors must be <= 64");
+    }
+
+    const auto sharedMemSize =
+      distance_op.template shared_mem_size<KPolicy>() + KPolicy::Mblk * numOfNN * sizeof(Pair);
+
+    dim3 grid = raft::distance::detail::launchConfigGenerator<KPolicy>(
+      m, n, sharedMemSize, fusedDistanceKnnRowMajor);
+
+    if (grid.x > 1) {
+      const auto numMutexes = raft::ceildiv<int>(m, KPolicy::Mblk);
+      if (workspace == nullptr || worksize < (sizeof(int32_t) * numMutexes)) {
+        worksize = sizeof(int32_t) * numMutexes;
+        return;
+      } else {
+        RAFT_CUDA_TRY(cudaMemsetAsync(workspace, 0, sizeof(int32_t) * numMutexes, stream));
+      }
+    }
+
+    fusedDistanceKnnRowMajor<<<grid, blk, sharedMemSize, stream>>>(x,
+                                                                   y,
+                                                                   xn,
+                                                                   yn,
+                                                                   m,
+                                                                   n,
+                                                                   k,
+                                                                   lda,
+                                                                   ldb,
+                                                                   ldd,
+                                                                   distance_op,
+                                                                   fin_op,
+                                                                   (uint32_t)numOfNN,
+                                                                   (int*)workspace,
+                                                                   out_dists,
+                                                                   out_inds);
+  } else {
+  }
+
+  RAFT_CUDA_TRY(cudaGetLastError());
+}
+
+/** Run `fusedDistanceKnnImpl` with the widest vectorized loads the input strides allow. */
+template <typename DataT, typename OutT, typename IdxT, bool usePrevTopKs, typename OpT>
+void fusedDistanceKnn(IdxT m,
+                      IdxT n,
+                      IdxT k,
+                      const DataT* x,
+                      const DataT* y,
+                      const DataT* xn,
+                      const DataT* yn,
+                      OpT distance_op,
+                      OutT* out_dists,
+                      IdxT* out_inds,
+                      IdxT numOfNN,
+                      cudaStream_t stream,
+                      rmm::mr::device_memory_resource* mr)
+{
+  const IdxT lda = k, ldb = k, ldd = n;
+  size_t bytesA  = sizeof(DataT) * lda;
+  size_t bytesB  = sizeof(DataT) * ldb;
+  auto impl      = fusedDistanceKnnImpl<DataT, OutT, IdxT, 1, usePrevTopKs, true, OpT>;
+  if (16 % sizeof(DataT) == 0 && bytesA % 16 == 0 && bytesB % 16 == 0) {
+    impl = fusedDistanceKnnImpl<DataT, OutT, IdxT, 16 / sizeof(DataT), usePrevTopKs, true, OpT>;
+  } else if (8 % sizeof(DataT) == 0 && bytesA % 8 == 0 && bytesB % 8 == 0) {
+    impl = fusedDistanceKnnImpl<DataT, OutT, IdxT, 8 / sizeof(DataT), usePrevTopKs, true, OpT>;
+  }
+  // The first call only reports the workspace size if the kernel needs one.
+  size_t worksize = 0;
+  rmm::device_uvector<char> workspace(0, stream, mr);
+  impl(x,
+       y,
+       xn,
+       yn,
+       m,
+       n,
+       k,
+       lda,
+       ldb,
+       ldd,
+       distance_op,
+       out_dists,
+       out_inds,
+       numOfNN,
+       stream,
+       nullptr,
+       worksize);
+  if (worksize) {
+    workspace.resize(worksize, stream);
+    impl(x,
+         y,
+         xn,
+         yn,
+         m,
+         n,
+         k,
+         lda,
+         ldb,
+         ldd,
+         distance_op,
+         out_dists,
+         out_inds,
+         numOfNN,
+         stream,
+         workspace.data(),
+         worksize);
+  }
+}
+
+/**
+ * Compute the k-nearest neighbors, fusing the k-selection with the distance computation.
+ *
+ * Supports the L2 (expanded/unexpanded), inner product, cosine, L1, Linf, Canberra, Lp,
+ * Hamming, Jensen-Shannon and Russell-Rao distances.
 
  * @tparam value_idx
  * @tparam value_t
@@ -930,6 +1163,11 @@ void fusedL2ExpKnn(IdxT m,
  * @param[in] rowMajorIndex are the index arrays in row-major layout?
  * @param[in] rowMajorQuery are the query array in row-major layout?
  * @param[in] stream stream to order kernel launch
+ * @param[in] metric the distance metric
+ * @param[in] index_norms optional precomputed norms of the index rows (L2 expanded and cosine)
+ * @param[in] query_norms optional precomputed norms of the query rows (L2 expanded and cosine)
+ * @param[in] metric_arg the `p` of the Lp distance
+ * @param[in] mr the resource of the temporary buffers (the current device resource if null)
  */
 template <typename value_idx, typename value_t, bool usePrevTopKs = false>
 void fusedL2Knn(size_t D,
@@ -945,8 +1183,11 @@ void fusedL2Knn(size_t D,
                 cudaStream_t stream,
                 raft::distance::DistanceType metric,
                 const value_t* index_norms = NULL,
-                const value_t* query_norms = NULL)
+                const value_t* query_norms          = NULL,
+                value_t metric_arg                  = 2.0,
+                rmm::mr::device_memory_resource* mr = nullptr)
 {
+  if (mr == nullptr) { mr = rmm::mr::get_current_device_resource(); }
   // Validate the input data
   ASSERT(k > 0, "l2Knn: k must be > 0");
   ASSERT(D > 0, "l2Knn: D must be > 0");
@@ -967,8 +1208,24 @@ void fusedL2Knn(size_t D,
   constexpr bool sqrt = false;
 
   size_t worksize = 0, tempWorksize = 0;
-  rmm::device_uvector<char> workspace(worksize, stream);
+  rmm::device_uvector<char> workspace(worksize, stream, mr);
   value_idx lda = D, ldb = D, ldd = n_index_rows;
+  // The metrics without norms go through the generic fused kernel.
+  auto run_distance_op = [&](auto distance_op) {
+    fusedDistanceKnn<value_t, value_t, value_idx, usePrevTopKs>(n_query_rows,
+                                                                n_index_rows,
+                                                                D,
+                                                                query,
+                                                                index,
+                                                                nullptr,
+                                                                nullptr,
+                                                                distance_op,
+                                                                out_dists,
+                                                                out_inds,
+                                                                k,
+                                                                stream,
+                                                                mr);
+  };
   // <raft::distance::DistanceType::L2Expanded, float, float, float, value_idx>
   switch (metric) {
     case raft::distance::DistanceType::L2SqrtExpanded:
@@ -1056,7 +1313,104 @@ void fusedL2Knn(size_t D,
                                                                                   worksize);
       }
       break;
-    default: printf("only L2 distance metric is supported\n"); break;
+    case raft::distance::DistanceType::InnerProduct: {
+      auto negate = [out_dists, n_query_rows, k, stream]() {
+        raft::linalg::unaryOp(
+          out_dists, out_dists, n_query_rows * k, raft::mul_const_op<value_t>(-1), stream);
+      };
+      // The kernel selects the smallest negated products.
+      if constexpr (usePrevTopKs) { negate(); }
+      fusedDistanceKnn<value_t, value_t, value_idx, usePrevTopKs>(
+        n_query_rows,
+        n_index_rows,
+        D,
+        query,
+        index,
+        nullptr,
+        nullptr,
+        neg_inner_product_distance_op<value_t, value_t, value_idx>{},
+        out_dists,
+        out_inds,
+        k,
+        stream,
+        mr);
+      negate();
+    } break;
+    case raft::distance::DistanceType::CosineExpanded: {
+      // The cosine distance needs the (non-squared) L2 norms.
+      rmm::device_uvector<value_t> norms_buf(0, stream, mr);
+      if (!query_norms || !index_norms) {
+        norms_buf.resize((query_norms ? 0 : n_query_rows) + (index_norms ? 0 : n_index_rows),
+                         stream);
+      }
+      auto* norms_ptr = norms_buf.data();
+      if (!query_norms) {
+        raft::linalg::rowNorm(norms_ptr,
+                              query,
+                              D,
+                              n_query_rows,
+                              raft::linalg::L2Norm,
+                              true,
+                              stream,
+                              raft::sqrt_op{});
+        query_norms = norms_ptr;
+        norms_ptr += n_query_rows;
+      }
+      if (!index_norms) {
+        raft::linalg::rowNorm(norms_ptr,
+                              index,
+                              D,
+                              n_index_rows,
+                              raft::linalg::L2Norm,
+                              true,
+                              stream,
+                              raft::sqrt_op{});
+        index_norms = norms_ptr;
+      }
+      fusedDistanceKnn<value_t, value_t, value_idx, usePrevTopKs>(
+        n_query_rows,
+        n_index_rows,
+        D,
+        query,
+        index,
+        query_norms,
+        index_norms,
+        raft::distance::detail::ops::cosine_distance_op<value_t, value_t, value_idx>{},
+        out_dists,
+        out_inds,
+        k,
+        stream,
+        mr);
+    } break;
+    case raft::distance::DistanceType::L1:
+      run_distance_op(raft::distance::detail::ops::l1_distance_op<value_t, value_t, value_idx>{});
+      break;
+    case raft::distance::DistanceType::Linf:
+      run_distance_op(
+        raft::distance::detail::ops::l_inf_distance_op<value_t, value_t, value_idx>{});
+      break;
+    case raft::distance::DistanceType::Canberra:
+      run_distance_op(
+        raft::distance::detail::ops::canberra_distance_op<value_t, value_t, value_idx>{});
+      break;
+    case raft::distance::DistanceType::LpUnexpanded:
+      run_distance_op(
+        raft::distance::detail::ops::lp_unexp_distance_op<value_t, value_t, value_idx>(metric_arg));
+      break;
+    case raft::distance::DistanceType::HammingUnexpanded:
+      run_distance_op(raft::distance::detail::ops::hamming_distance_op<value_t, value_t, value_idx>(
+        static_cast<value_idx>(D)));
+      break;
+    case raft::distance::DistanceType::JensenShannon:
+      run_distance_op(
+        raft::distance::detail::ops::jensen_shannon_distance_op<value_t, value_t, value_idx>{});
+      break;
+    case raft::distance::DistanceType::RusselRaoExpanded:
+      run_distance_op(
+        raft::distance::detail::ops::russel_rao_distance_op<value_t, value_t, value_idx>(
+          static_cast<value_idx>(D)));
+      break;
+    default: printf("the metric is not supported by the fused k-nearest neighbors\n"); break;
   };
 }
 
@@ -20,10 +20,17 @@
 #include <raft/util/cudart_utils.hpp>
 #include <raft/util/pow2_utils.cuh>
 
+#include <raft/core/error.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/neighbors/detail/faiss_select/Select.cuh>
 
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
 namespace raft {
 namespace spatial {
 namespace knn {
@@ -34,76 +41,191 @@ DI value_t compute_haversine(value_t x1, value_t y1, value_t x2, value_t y2)
 {
   value_t sin_0 = raft::sin(0.5 * (x1 - y1));
   value_t sin_1 = raft::sin(0.5 * (x2 - y2));
-  value_t rdist = sin_0 * sin_0 + raft::cos(x1) * raft::cos(y1) * sin_1 * sin_1;
+/**
+ * The Haversine distance with the cosines of the latitudes precomputed, so that a tile of the
+ * index shared by several queries computes them once. The arithmetic stays in `value_t`.
+ */
+template <typename value_t>
+DI value_t compute_haversine(
+  value_t x1, value_t y1, value_t x2, value_t y2, value_t cos_x1, value_t cos_y1)
+{
+  value_t sin_0 = raft::sin(value_t(0.5) * (x1 - y1));
+  value_t sin_1 = raft::sin(value_t(0.5) * (x2 - y2));
+  value_t rdist = sin_0 * sin_0 + cos_x1 * cos_y1 * sin_1 * sin_1;
 
-  return 2 * raft::asin(raft::sqrt(rdist));
+  return 2 * raft::asin(raft::sqrt(raft::min(rdist, value_t(1))));
 }
 
+/** The number of index rows kept in shared memory by haversine_knn_tiled_kernel. */
+constexpr int kHaversineTileRows = 256;
+
+/** The maximum number of neighbors of haversine_knn. */
+constexpr int kHaversineMaxK = 1024;
+
 /**
+ * Tiled Haversine brute-force kNN: each warp selects the neighbors of a query, and the warps of a
+ * block share the tiles of the index (with the cosines of their latitudes) in shared memory.
+ *
  * @tparam value_idx data type of indices
- * @tparam value_t data type of values and distances
- * @tparam warp_q
- * @tparam thread_q
- * @tparam tpb
- * @param[out] out_inds output indices
- * @param[out] out_dists output distances
- * @param[in] index index array
- * @param[in] query query array
+ * @tparam value_t data type of the inputs
+ * @tparam compute_t data type of the distances (the arithmetic type)
+ * @tparam warp_q the size of the warp queue (at least k)
+ * @tparam thread_q the size of the thread queues
+ * @tparam tpb threads per block (a query per warp)
+ * @param[out] out_inds output indices [n_query_rows, k]
+ * @param[out] out_dists output distances [n_query_rows, k]
+ * @param[in] index index array [n_index_rows, 2]
+ * @param[in] query query array [n_query_rows, 2]
  * @param[in] n_index_rows number of rows in index array
+ * @param[in] n_query_rows number of rows in query array
  * @param[in] k number of closest neighbors to return
  */
-template <typename value_idx, typename value_t, int warp_q = 1024, int thread_q = 8, int tpb = 128>
-RAFT_KERNEL haversine_knn_kernel(value_idx* out_inds,
-                                 value_t* out_dists,
-                                 const value_t* index,
-                                 const value_t* query,
-                                 size_t n_index_rows,
-                                 int k)
+template <typename value_idx,
+          typename value_t,
+          typename compute_t,
+          int warp_q,
+          int thread_q,
+          int tpb = 128>
+RAFT_KERNEL haversine_knn_tiled_kernel(value_idx* out_inds,
+                                       compute_t* out_dists,
+                                       const value_t* index,
+                                       const value_t* query,
+                                       size_t n_index_rows,
+                                       size_t n_query_rows,
+                                       int k)
 {
   constexpr int kNumWarps = tpb / WarpSize;
 
-  __shared__ value_t smemK[kNumWarps * warp_q];
-  __shared__ value_idx smemV[kNumWarps * warp_q];
+  __shared__ compute_t smem_lat[kHaversineTileRows];
+  __shared__ compute_t smem_lon[kHaversineTileRows];
+  __shared__ compute_t smem_cos_lat[kHaversineTileRows];
 
   using namespace raft::neighbors::detail::faiss_select;
-  BlockSelect<value_t, value_idx, false, Comparator<value_t>, warp_q, thread_q, tpb> heap(
-    std::numeric_limits<value_t>::max(), std::numeric_limits<value_idx>::max(), smemK, smemV, k);
+  WarpSelect<compute_t, value_idx, false, Comparator<compute_t>, warp_q, thread_q, tpb> heap(
+    std::numeric_limits<compute_t>::max(), std::numeric_limits<value_idx>::max(), k);
 
-  // Grid is exactly sized to rows available
-  int limit = Pow2<WarpSize>::roundDown(n_index_rows);
+  const size_t query_row = size_t(blockIdx.x) * kNumWarps + threadIdx.x / WarpSize;
+  const bool valid_query = query_row < n_query_rows;
+  compute_t x1           = 0;
+  compute_t x2           = 0;
+  if (valid_query) {
+    x1 = compute_t(query[query_row * 2]);
+    x2 = compute_t(query[query_row * 2 + 1]);
+  }
+  const compute_t cos_x1 = raft::cos(x1);
 
-  const value_t* query_ptr = query + (blockIdx.x * 2);
-  value_t x1               = query_ptr[0];
-  value_t x2               = query_ptr[1];
+  for (size_t tile = 0; tile < n_index_rows; tile += kHaversineTileRows) {
+    const int tile_len = raft::min<size_t>(kHaversineTileRows, n_index_rows - tile);
+    // Wait until the previous tile is consumed.
+    __syncthreads();
+    for (int i = threadIdx.x; i < tile_len; i += tpb) {
+      const compute_t lat = compute_t(index[(tile + i) * 2]);
+      smem_lat[i]         = lat;
+      smem_lon[i]         = compute_t(index[(tile + i) * 2 + 1]);
+      smem_cos_lat[i]     = raft::cos(lat);
+    }
+    __syncthreads();
+    if (!valid_query) { continue; }
 
-  int i = threadIdx.x;
+    // All lanes of the warp run the same number of iterations, as required by the warp queue.
+    const int limit = Pow2<WarpSize>::roundUp(tile_len);
+    for (int i = raft::laneId(); i < limit; i += WarpSize) {
+      compute_t dist = std::numeric_limits<compute_t>::max();
+      value_idx idx  = std::numeric_limits<value_idx>::max();
+      if (i < tile_len) {
+        dist = compute_haversine(x1, smem_lat[i], x2, smem_lon[i], cos_x1, smem_cos_lat[i]);
+        idx  = value_idx(tile + i);
+      }
+      heap.add(dist, idx);
+    }
+  }
 
-  for (; i < limit; i += tpb) {
-    const value_t* idx_ptr = index + (i * 2);
-    value_t y1             = idx_ptr[0];
-    value_t y2             = idx_ptr[1];
+  if (!valid_query) { return; }
+  heap.reduce();
+  heap.writeOut(out_dists + query_row * k, out_inds + query_row * k, k);
+}
 
-    value_t dist = compute_haversine(x1, y1, x2, y2);
+/**
+ * Refine the candidates of the fp32 Haversine kNN in fp64: each warp recomputes the distances of
+ * the candidates of a query in double precision and selects the `k` nearest of them.
+ *
+ * @param[out] out_inds output indices [n_query_rows, k]
+ * @param[out] out_dists output distances [n_query_rows, k]
+ * @param[in] cand_inds the candidates [n_query_rows, n_cand] (missing ones are the maximum index)
+ * @param[in] index index array [n_index_rows, 2]
+ * @param[in] query query array [n_query_rows, 2]
+ * @param[in] n_query_rows number of rows in query array
+ * @param[in] n_cand the number of candidates per query
+ * @param[in] k number of closest neighbors to return
+ */
+template <typename value_idx, typename value_t, int warp_q, int thread_q, int tpb = 128>
+RAFT_KERNEL haversine_knn_refine_kernel(value_idx* out_inds,
+                                        value_t* out_dists,
+                                        const value_idx* cand_inds,
+                                        const value_t* index,
+                                        const value_t* query,
+                                        size_t n_query_rows,
+                                        int n_cand,
+                                        int k)
+{
+  constexpr int kNumWarps = tpb / WarpSize;
+  constexpr auto kMaxIdx  = std::numeric_limits<value_idx>::max();
 
-    heap.add(dist, i);
-  }
+  const size_t query_row = size_t(blockIdx.x) * kNumWarps + threadIdx.x / WarpSize;
+  if (query_row >= n_query_rows) { return; }
 
-  // Handle last remainder fraction of a warp of elements
-  if (i < n_index_rows) {
-    const value_t* idx_ptr = index + (i * 2);
-    value_t y1             = idx_ptr[0];
-    value_t y2             = idx_ptr[1];
+  using namespace raft::neighbors::detail::faiss_select;
+  using heap_t = WarpSelect<double, value_idx, false, Comparator<double>, warp_q, thread_q, tpb>;
+  heap_t heap(std::numeric_limits<double>::max(), kMaxIdx, k);
 
-    value_t dist = compute_haversine(x1, y1, x2, y2);
+  const double x1     = double(query[query_row * 2]);
+  const double x2     = double(query[query_row * 2 + 1]);
+  const double cos_x1 = raft::cos(x1);
 
-    heap.addThreadQ(dist, i);
+  const value_idx* cands = cand_inds + query_row * n_cand;
+  const int limit        = Pow2<WarpSize>::roundUp(n_cand);
+  for (int i = raft::laneId(); i < limit; i += WarpSize) {
+    double dist   = std::numeric_limits<double>::max();
+    value_idx idx = i < n_cand ? cands[i] : kMaxIdx;
+    if (idx != kMaxIdx) {
+      const double y1 = double(index[size_t(idx) * 2]);
+      const double y2 = double(index[size_t(idx) * 2 + 1]);
+      dist            = compute_haversine(x1, y1, x2, y2, cos_x1, raft::cos(y1));
+    }
+    heap.add(dist, idx);
   }
-
   heap.reduce();
 
-  for (int i = threadIdx.x; i < k; i += tpb) {
-    out_dists[blockIdx.x * k + i] = smemK[i];
-    out_inds[blockIdx.x * k + i]  = smemV[i];
+  const int lane = raft::laneId();
+#pragma unroll
+  for (int i = 0; i < heap_t::kNumWarpQRegisters; ++i) {
+    const int j = i * WarpSize + lane;
+    if (j < k) {
+      out_dists[query_row * k + j] = value_t(heap.warpK[i]);
+      out_inds[query_row * k + j]  = heap.warpV[i];
+    }
+  }
+}
+
+/**
+ * Call `launch(warp_q, thread_q)` with the warp queue sizes (as integral constants) of the
+ * faiss warp select for `k` neighbors.
+ */
+template <typename Launch>
+void haversine_dispatch_k(int k, Launch launch)
+{
+  if (k <= 32) {
+    launch(std::integral_constant<int, 32>{}, std::integral_constant<int, 2>{});
+  } else if (k <= 64) {
+    launch(std::integral_constant<int, 64>{}, std::integral_constant<int, 3>{});
+  } else if (k <= 128) {
+    launch(std::integral_constant<int, 128>{}, std::integral_constant<int, 3>{});
+  } else if (k <= 256) {
+    launch(std::integral_constant<int, 256>{}, std::integral_constant<int, 4>{});
+  } else if (k <= 512) {
+    launch(std::integral_constant<int, 512>{}, std::integral_constant<int, 8>{});
+  } else {
+    launch(std::integral_constant<int, 1024>{}, std::integral_constant<int, 8>{});
   }
 }
 
@@ -111,7 +233,16 @@ RAFT_KERNEL haversine_knn_kernel(value_idx* out_inds,
  * Conmpute the k-nearest neighbors using the Haversine
  * (great circle arc) distance. Input is assumed to have
  * 2 dimensions (latitude, longitude) in radians.
-
+ *
+ * The queries are processed a warp per query, with a fused warp top-k; each block shares the tiles
+ * of the index in shared memory between its queries.
+ *
+ * With `mixed_precision`, the distances are computed in fp32 for the `min(max(2 k, k + 32), 1024)`
+ * candidates of each query first, and the candidates are refined in fp64: this gives the fp64
+ * distances (sub-meter at the Earth's scale for fp64 inputs) at close to the fp32 throughput. A
+ * true neighbor can only be missed if its fp32 distance is out of order by more than the
+ * candidate margin.
+ *
  * @tparam value_idx
  * @tparam value_t
  * @param[out] out_inds output indices array on device (size n_query_rows * k)
@@ -120,8 +251,9 @@ RAFT_KERNEL haversine_knn_kernel(value_idx* out_inds,
  * @param[in] query input query array on device (size n_query_rows * 2)
  * @param[in] n_index_rows number of rows in index array
  * @param[in] n_query_rows number of rows in query array
- * @param[in] k number of closest neighbors to return
+ * @param[in] k number of closest neighbors to return (at most 1024)
  * @param[in] stream stream to order kernel launch
+ * @param[in] mixed_precision whether to select the candidates in fp32 and refine them in fp64
  */
 template <typename value_idx, typename value_t>
 void haversine_knn(value_idx* out_inds,
@@ -131,11 +263,53 @@ void haversine_knn(value_idx* out_inds,
                    size_t n_index_rows,
                    size_t n_query_rows,
                    int k,
-                   cudaStream_t stream)
+                   cudaStream_t stream,
+                   bool mixed_precision = false)
 {
-  // ensure kernel does not breach shared memory limits
-  constexpr int kWarpQ = sizeof(value_t) > 4 ? 512 : 1024;
-  haversine_knn_kernel<value_idx, value_t, kWarpQ>
+  RAFT_EXPECTS(k > 0 && k <= kHaversineMaxK,
+               "haversine_knn: the number of neighbors must be in [1, 1024]");
+  if (n_query_rows == 0) { return; }
+
+  constexpr int kTpb = 128;
+  const dim3 grid(raft::ceildiv<size_t>(n_query_rows, kTpb / WarpSize));
+
+  if (!mixed_precision) {
+    haversine_dispatch_k(k, [&](auto warp_q, auto thread_q) {
+      constexpr int kWarpQ   = decltype(warp_q)::value;
+      constexpr int kThreadQ = decltype(thread_q)::value;
+      haversine_knn_tiled_kernel<value_idx, value_t, value_t, kWarpQ, kThreadQ, kTpb>
+        <<<grid, kTpb, 0, stream>>>(
+          out_inds, out_dists, index, query, n_index_rows, n_query_rows, k);
+    });
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+    return;
+  }
+
+  // Select the candidates in fp32 ...
+  const int n_cand = std::min(std::max(2 * k, k + 32), kHaversineMaxK);
+  rmm::device_uvector<value_idx> cand_inds(n_query_rows * n_cand, stream);
+  rmm::device_uvector<float> cand_dists(n_query_rows * n_cand, stream);
+  haversine_dispatch_k(n_cand, [&](auto warp_q, auto thread_q) {
+    constexpr int kWarpQ   = decltype(warp_q)::value;
+    constexpr int kThreadQ = decltype(thread_q)::value;
+    haversine_knn_tiled_kernel<value_idx, value_t, float, kWarpQ, kThreadQ, kTpb>
+      <<<grid, kTpb, 0, stream>>>(
+        cand_inds.data(), cand_dists.data(), index, query, n_index_rows, n_query_rows, n_cand);
+  });
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+
+  // ... and refine them in fp64.
+  haversine_dispatch_k(k, [&](auto warp_q, auto thread_q) {
+    constexpr int kWarpQ   = decltype(warp_q)::value;
+    constexpr int kThreadQ = decltype(thread_q)::value;
+    haversine_knn_refine_kernel<value_idx, value_t, kWarpQ, kThreadQ, kTpb>
+      <<<grid, kTpb, 0, stream>>>(
+        out_inds, out_dists, cand_inds.data(), index, query, n_query_rows, n_cand, k);
+  });
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+ernel<value_idx, value_t, kWarpQ>
     <<<n_query_rows, 128, 0, stream>>>(out_inds, out_dists, index, query, n_index_rows, k);
 }
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -29,6 +29,7 @@
 #include <thrust/fill.h>
 #include <thrust/reduce.h>
 #include <thrust/system/cuda/execution_policy.h>
+#include <thrust/transform.h>
 
 #include <cuda/functional>
 
@@ -428,35 +429,27 @@ struct modularity_matrix_t : laplacian_matrix_t<index_type, value_type> {
     // y = A*x
     //
     sparse_matrix_t<index_type, value_type>::mv(alpha, x, 0, y, alg, transpose, symmetric);
-    value_type dot_res;
 
-    // gamma = d'*x
+    // gamma = d'*x, on the device: the product is stream-ordered, without a synchronization
     //
-    // Cublas::dot(this->n, D.raw(), 1, x, 1, &dot_res);
-    // TODO: Call from public API when ready
-    RAFT_CUBLAS_TRY(
-      raft::linalg::detail::cublasdot(cublas_h,
-                                      n,
-                                      laplacian_matrix_t<index_type, value_type>::diagonal_.raw(),
-                                      1,
-                                      x,
-                                      1,
-                                      &dot_res,
-                                      stream));
+    auto const* d = laplacian_matrix_t<index_type, value_type>::diagonal_.raw();
+    rmm::device_uvector<value_type> dot_res(1, stream);
+    {
+      raft::linalg::detail::cublas_device_pointer_mode<true> pmode(cublas_h);
+      // TODO: Call from public API when ready
+      RAFT_CUBLAS_TRY(
+        raft::linalg::detail::cublasdot(cublas_h, n, d, 1, x, 1, dot_res.data(), stream));
+    }
 
     // y = y -(gamma/edge_sum)*d
     //
-    value_type gamma_ = -dot_res / edge_sum_;
-    // TODO: Call from public API when ready
-    RAFT_CUBLAS_TRY(
-      raft::linalg::detail::cublasaxpy(cublas_h,
-                                       n,
-                                       &gamma_,
-                                       laplacian_matrix_t<index_type, value_type>::diagonal_.raw(),
-                                       1,
-                                       y,
-                                       1,
-                                       stream));
+    thrust::transform(resource::get_thrust_policy(handle),
+                      y,
+                      y + n,
+                      d,
+                      y,
+                      [dot_ptr = dot_res.data(), edge_sum = edge_sum_] __device__(
+                        value_type yi, value_type di) { return yi - (*dot_ptr / edge_sum) * di; });
   }
 
   value_type edge_sum_;
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -27,6 +27,7 @@
 #include <thrust/transform.h>
 
 #include <tuple>
+#include <vector>
 
 #include <raft/linalg/detail/cublas_wrappers.hpp>
 #include <raft/spectral/cluster_solvers.cuh>
@@ -34,6 +35,9 @@
 #include <raft/spectral/eigen_solvers.cuh>
 #include <raft/spectral/matrix_wrappers.hpp>
 
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
 namespace raft {
 namespace spectral {
 namespace detail {
@@ -101,7 +105,7 @@ std::tuple<vertex_t, weight_t, vertex_t> modularity_maximization(
 
   // notice that at this point the matrix has already been transposed, so we are scaling
   // columns
-  scale_obs(nEigVecs, n, eigVecs);
+  scale_obs(nEigVecs, n, eigVecs, stream);
   RAFT_CHECK_CUDA(stream);
 
   // Find partition clustering
@@ -116,6 +120,48 @@ std::tuple<vertex_t, weight_t, vertex_t> modularity_maximization(
 // Analysis of graph partition
 // =========================================================
 
+template <typename vertex_t, typename weight_t>
+RAFT_KERNEL modularity_kernel(const weight_t* __restrict__ stats,
+                              vertex_t nClusters,
+                              weight_t* modularity)
+{
+  const weight_t* internal = stats + 2 * nClusters;
+  const weight_t* volume   = stats + 3 * nClusters;
+  weight_t edge_sum        = stats[4 * nClusters];
+  weight_t sum             = 0;
+  for (vertex_t i = 0; i < nClusters; ++i) {
+    sum += internal[i] - volume[i] * volume[i] / edge_sum;
+  }
+  *modularity = sum / edge_sum;
+}
+
+/// Compute modularity, on the device
+/** The internal weight and the volume of every cluster are
+ *  accumulated in one pass over the edges of the graph, and the
+ *  modularity is left on the device: the analysis is stream-ordered,
+ *  without any synchronization.
+ *  @param csr_m Weighted graph in CSR format
+ *  @param nClusters Number of clusters.
+ *  @param clusters (Input, device memory, n entries) Cluster assignments.
+ *  @param modularity (Output, device memory) modularity
+ *  @param stats workspace, resized to 4 nClusters + 1 values; the
+ *    sizes of the clusters come first.
+ */
+template <typename vertex_t, typename weight_t>
+void analyzeModularity(raft::resources const& handle,
+                       raft::spectral::matrix::sparse_matrix_t<vertex_t, weight_t> const& csr_m,
+                       vertex_t nClusters,
+                       vertex_t const* __restrict__ clusters,
+                       weight_t* modularity,
+                       rmm::device_uvector<weight_t>& stats)
+{
+  RAFT_EXPECTS(clusters != nullptr, "Null clusters buffer.");
+  auto stream = resource::get_cuda_stream(handle);
+  partition_stats(handle, csr_m, nClusters, clusters, stats);
+  modularity_kernel<<<1, 1, 0, stream>>>(stats.data(), nClusters, modularity);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
 /// Compute modularity
 /** This function determines the modularity based on a graph and cluster assignments
  *  @param G Weighted graph in CSR format
@@ -131,39 +177,19 @@ void analyzeModularity(raft::resources const& handle,
                        weight_t& modularity)
 {
   RAFT_EXPECTS(clusters != nullptr, "Null clusters buffer.");
-
-  vertex_t i;
-  vertex_t n = csr_m.nrows_;
-  weight_t partModularity, clustersize;
-
-  auto cublas_h = resource::get_cublas_handle(handle);
-  auto stream   = resource::get_cuda_stream(handle);
-
-  // Device memory
-  raft::spectral::matrix::vector_t<weight_t> part_i(handle, n);
-  raft::spectral::matrix::vector_t<weight_t> Bx(handle, n);
-
-  // Initialize cuBLAS
-  RAFT_CUBLAS_TRY(linalg::detail::cublassetpointermode(cublas_h, CUBLAS_POINTER_MODE_HOST, stream));
-
-  // Initialize Modularity
-  raft::spectral::matrix::modularity_matrix_t<vertex_t, weight_t> B{handle, csr_m};
-
-  // Initialize output
-  modularity = 0;
-
-  // Iterate through partitions
-  for (i = 0; i < nClusters; ++i) {
-    if (!construct_indicator(handle, i, n, clustersize, partModularity, clusters, part_i, Bx, B)) {
-      WARNING("empty partition");
-      continue;
-    }
-
-    // Record results
-    modularity += partModularity;
+  auto stream = resource::get_cuda_stream(handle);
+
+  rmm::device_uvector<weight_t> stats(0, stream);
+  rmm::device_scalar<weight_t> result(stream);
+  analyzeModularity(handle, csr_m, nClusters, clusters, result.data(), stats);
+
+  // a single synchronization for the result and the sizes of the clusters
+  std::vector<weight_t> sizes(nClusters);
+  raft::update_host(sizes.data(), stats.data(), nClusters, stream);
+  modularity = result.value(stream);
+  for (auto size : sizes) {
+    if (size < weight_t(0.5)) { WARNING("empty partition"); }
   }
-
-  modularity = modularity / B.diagonal_.nrm1();
 }
 
 }  // namespace detail
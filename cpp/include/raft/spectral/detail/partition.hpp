@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -26,6 +26,7 @@
 #include <thrust/transform.h>
 
 #include <tuple>
+#include <vector>
 
 #include <raft/linalg/detail/cublas_wrappers.hpp>
 #include <raft/spectral/cluster_solvers.cuh>
@@ -33,6 +34,8 @@
 #include <raft/spectral/eigen_solvers.cuh>
 #include <raft/spectral/matrix_wrappers.hpp>
 
+#include <rmm/device_uvector.hpp>
+
 namespace raft {
 namespace spectral {
 namespace detail {
@@ -118,6 +121,57 @@ std::tuple<vertex_t, weight_t, vertex_t> partition(
 // Analysis of graph partition
 // =========================================================
 
+template <typename vertex_t, typename weight_t>
+RAFT_KERNEL partition_cost_kernel(const weight_t* __restrict__ stats,
+                                  vertex_t nClusters,
+                                  weight_t* edgeCut,
+                                  weight_t* cost)
+{
+  weight_t cut_sum  = 0;
+  weight_t cost_sum = 0;
+  for (vertex_t i = 0; i < nClusters; ++i) {
+    weight_t size = stats[i];
+    weight_t cut  = stats[nClusters + i];
+    if (size < weight_t(0.5)) { continue; }
+    cost_sum += cut / size;
+    cut_sum += cut / 2;
+  }
+  *edgeCut = cut_sum;
+  *cost    = cost_sum;
+}
+
+/// Compute cost function for partition, on the device
+/** The edges cut by every partition and its size are accumulated in
+ *  one pass over the edges of the graph, and the results are left
+ *  on the device: the analysis is stream-ordered, without any
+ *  synchronization.
+ *
+ *  @param csr_m Weighted graph in CSR format
+ *  @param nClusters Number of partitions.
+ *  @param clusters (Input, device memory, n entries) Partition
+ *    assignments.
+ *  @param edgeCut (Output, device memory) weight of edges cut by
+ *    partition.
+ *  @param cost (Output, device memory) partition cost function.
+ *  @param stats workspace, resized to 4 nClusters + 1 values; the
+ *    sizes of the partitions come first.
+ */
+template <typename vertex_t, typename weight_t>
+void analyzePartition(raft::resources const& handle,
+                      spectral::matrix::sparse_matrix_t<vertex_t, weight_t> const& csr_m,
+                      vertex_t nClusters,
+                      const vertex_t* __restrict__ clusters,
+                      weight_t* edgeCut,
+                      weight_t* cost,
+                      rmm::device_uvector<weight_t>& stats)
+{
+  RAFT_EXPECTS(clusters != nullptr, "Null clusters buffer.");
+  auto stream = resource::get_cuda_stream(handle);
+  partition_stats(handle, csr_m, nClusters, clusters, stats);
+  partition_cost_kernel<<<1, 1, 0, stream>>>(stats.data(), nClusters, edgeCut, cost);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
 /// Compute cost function for partition
 /** This function determines the edges cut by a partition and a cost
  *  function:
@@ -141,43 +195,24 @@ void analyzePartition(raft::resources const& handle,
                       weight_t& cost)
 {
   RAFT_EXPECTS(clusters != nullptr, "Null clusters buffer.");
-
-  vertex_t i;
-  vertex_t n = csr_m.nrows_;
-
-  auto stream   = resource::get_cuda_stream(handle);
-  auto cublas_h = resource::get_cublas_handle(handle);
-
-  weight_t partEdgesCut, clustersize;
-
-  // Device memory
-  spectral::matrix::vector_t<weight_t> part_i(handle, n);
-  spectral::matrix::vector_t<weight_t> Lx(handle, n);
-
-  // Initialize cuBLAS
-  RAFT_CUBLAS_TRY(
-    raft::linalg::detail::cublassetpointermode(cublas_h, CUBLAS_POINTER_MODE_HOST, stream));
-
-  // Initialize Laplacian
-  /// sparse_matrix_t<vertex_t, weight_t> A{handle, graph};
-  spectral::matrix::laplacian_matrix_t<vertex_t, weight_t> L{handle, csr_m};
-
-  // Initialize output
-  cost    = 0;
-  edgeCut = 0;
-
-  // Iterate through partitions
-  for (i = 0; i < nClusters; ++i) {
-    // Construct indicator vector for ith partition
-    if (!construct_indicator(handle, i, n, clustersize, partEdgesCut, clusters, part_i, Lx, L)) {
-      WARNING("empty partition");
-      continue;
-    }
-
-    // Record results
-    cost += partEdgesCut / clustersize;
-    edgeCut += partEdgesCut / 2;
+  auto stream = resource::get_cuda_stream(handle);
+
+  rmm::device_uvector<weight_t> stats(0, stream);
+  rmm::device_uvector<weight_t> results(2, stream);
+  analyzePartition(
+    handle, csr_m, nClusters, clusters, results.data(), results.data() + 1, stats);
+
+  // a single synchronization for the results and the sizes of the partitions
+  std::vector<weight_t> h_results(2);
+  std::vector<weight_t> sizes(nClusters);
+  raft::update_host(h_results.data(), results.data(), 2, stream);
+  raft::update_host(sizes.data(), stats.data(), nClusters, stream);
+  resource::sync_stream(handle, stream);
+  for (auto size : sizes) {
+    if (size < weight_t(0.5)) { WARNING("empty partition"); }
   }
+  edgeCut = h_results[0];
+  cost    = h_results[1];
 }
 
 }  // namespace detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,8 +21,13 @@
 #include <raft/core/resource/thrust_policy.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/linalg/detail/cublas_wrappers.hpp>
+#include <raft/linalg/map.cuh>
 #include <raft/spectral/matrix_wrappers.hpp>
+#include <raft/stats/meanvar.cuh>
 #include <raft/util/cudart_utils.hpp>
+#include <raft/util/reduction.cuh>
+
+#include <rmm/device_uvector.hpp>
 
 #include <thrust/device_ptr.h>
 #include <thrust/fill.h>
@@ -100,7 +105,7 @@ index_type_t next_pow2(index_type_t n)
 }
 
 template <typename index_type_t, typename value_type_t>
-cudaError_t scale_obs(index_type_t m, index_type_t n, value_type_t* obs)
+cudaError_t scale_obs(index_type_t m, index_type_t n, value_type_t* obs, cudaStream_t stream = 0)
 {
   index_type_t p2m;
 
@@ -113,83 +118,121 @@ cudaError_t scale_obs(index_type_t m, index_type_t n, value_type_t* obs)
   dim3 nblocks{1, (n + nthreads.y - 1) / nthreads.y, 1};
 
   // launch scaling kernel (scale each column of obs by its norm)
-  scale_obs_kernel<index_type_t, value_type_t><<<nblocks, nthreads>>>(m, n, obs);
+  scale_obs_kernel<index_type_t, value_type_t><<<nblocks, nthreads, 0, stream>>>(m, n, obs);
 
   return cudaSuccess;
 }
 
+/**
+ * Whiten the columns of the eigenvector matrix [n, nEigVecs] (column-major) to zero means and
+ * unit standard deviations, and transpose it in place to [nEigVecs, n]. The means and the
+ * deviations stay on the device: the whole transformation is stream-ordered, without any
+ * synchronization.
+ */
 template <typename vertex_t, typename edge_t, typename weight_t>
 void transform_eigen_matrix(raft::resources const& handle,
                             edge_t n,
                             vertex_t nEigVecs,
                             weight_t* eigVecs)
 {
-  auto stream             = resource::get_cuda_stream(handle);
-  auto cublas_h           = resource::get_cublas_handle(handle);
-  auto thrust_exec_policy = resource::get_thrust_policy(handle);
+  auto stream = resource::get_cuda_stream(handle);
+
+  rmm::device_uvector<weight_t> mean(nEigVecs, stream);
+  rmm::device_uvector<weight_t> var(nEigVecs, stream);
+  raft::stats::meanvar(
+    mean.data(), var.data(), eigVecs, static_cast<edge_t>(nEigVecs), n, false, false, stream);
+
+  // the whitened entry (i, c) goes to the position (c, i) of the transposed matrix
+  rmm::device_uvector<weight_t> work(size_t(nEigVecs) * n, stream);
+  int64_t k = nEigVecs;
+  int64_t m = n;
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<weight_t, int64_t>(work.data(), k * m),
+    [eigVecs, mean_ptr = mean.data(), var_ptr = var.data(), k, m] __device__(int64_t e) {
+      int64_t i = e / k;
+      int64_t c = e % k;
+      return (eigVecs[i + c * m] - mean_ptr[c]) / raft::sqrt(var_ptr[c]);
+    });
+  raft::copy(eigVecs, work.data(), work.size(), stream);
+}
 
-  const weight_t zero{0.0};
-  const weight_t one{1.0};
-
-  // Whiten eigenvector matrix
-  for (auto i = 0; i < nEigVecs; ++i) {
-    weight_t mean, std;
-
-    mean = thrust::reduce(thrust_exec_policy,
-                          thrust::device_pointer_cast(eigVecs + IDX(0, i, n)),
-                          thrust::device_pointer_cast(eigVecs + IDX(0, i + 1, n)));
-    RAFT_CHECK_CUDA(stream);
-    mean /= n;
-    thrust::transform(thrust_exec_policy,
-                      thrust::device_pointer_cast(eigVecs + IDX(0, i, n)),
-                      thrust::device_pointer_cast(eigVecs + IDX(0, i + 1, n)),
-                      thrust::make_constant_iterator(mean),
-                      thrust::device_pointer_cast(eigVecs + IDX(0, i, n)),
-                      thrust::minus<weight_t>());
-    RAFT_CHECK_CUDA(stream);
-
-    // TODO: Call from public API when ready
-    RAFT_CUBLAS_TRY(
-      raft::linalg::detail::cublasnrm2(cublas_h, n, eigVecs + IDX(0, i, n), 1, &std, stream));
-
-    std /= std::sqrt(static_cast<weight_t>(n));
-
-    thrust::transform(thrust_exec_policy,
-                      thrust::device_pointer_cast(eigVecs + IDX(0, i, n)),
-                      thrust::device_pointer_cast(eigVecs + IDX(0, i + 1, n)),
-                      thrust::make_constant_iterator(std),
-                      thrust::device_pointer_cast(eigVecs + IDX(0, i, n)),
-                      thrust::divides<weight_t>());
-    RAFT_CHECK_CUDA(stream);
+/**
+ * The statistics of the clusters of a partition of a graph, in one pass over its edges: the
+ * number of vertices of every cluster, the weight of its edges to other clusters (cut), the
+ * weight of its edges inside (internal, both directions) and the sum of the degrees of its
+ * vertices (volume). `total` gets the sum of the absolute degrees of all the vertices. The
+ * vertices out of [0, nClusters) are not counted in any cluster.
+ */
+template <typename vertex_t, typename weight_t>
+RAFT_KERNEL partition_stats_kernel(const vertex_t* __restrict__ row_offsets,
+                                   const vertex_t* __restrict__ col_indices,
+                                   const weight_t* __restrict__ values,
+                                   vertex_t n,
+                                   vertex_t nClusters,
+                                   const vertex_t* __restrict__ clusters,
+                                   weight_t* sizes,
+                                   weight_t* cut,
+                                   weight_t* internal,
+                                   weight_t* volume,
+                                   weight_t* total)
+{
+  weight_t abs_degrees = 0;
+  for (vertex_t i = blockIdx.x * blockDim.x + threadIdx.x; i < n; i += blockDim.x * gridDim.x) {
+    vertex_t c       = clusters[i];
+    weight_t degree  = 0;
+    weight_t row_cut = 0;
+    weight_t row_int = 0;
+    for (vertex_t e = row_offsets[i]; e < row_offsets[i + 1]; e++) {
+      weight_t w = values[e];
+      degree += w;
+      if (clusters[col_indices[e]] == c) {
+        row_int += w;
+      } else {
+        row_cut += w;
+      }
+    }
+    abs_degrees += degree > 0 ? degree : -degree;
+    if (c < 0 || c >= nClusters) { continue; }
+    atomicAdd(sizes + c, weight_t(1));
+    atomicAdd(cut + c, row_cut);
+    atomicAdd(internal + c, row_int);
+    atomicAdd(volume + c, degree);
   }
+  abs_degrees = raft::warpReduce(abs_degrees);
+  if (threadIdx.x % raft::WarpSize == 0) { atomicAdd(total, abs_degrees); }
+}
 
-  // Transpose eigenvector matrix
-  //   TODO: in-place transpose
-  {
-    raft::spectral::matrix::vector_t<weight_t> work(handle, nEigVecs * n);
-    // TODO: Call from public API when ready
-    RAFT_CUBLAS_TRY(
-      raft::linalg::detail::cublassetpointermode(cublas_h, CUBLAS_POINTER_MODE_HOST, stream));
-
-    // TODO: Call from public API when ready
-    RAFT_CUBLAS_TRY(raft::linalg::detail::cublasgeam(cublas_h,
-                                                     CUBLAS_OP_T,
-                                                     CUBLAS_OP_N,
-                                                     nEigVecs,
-                                                     n,
-                                                     &one,
-                                                     eigVecs,
-                                                     n,
-                                                     &zero,
-                                                     (weight_t*)NULL,
-                                                     nEigVecs,
-                                                     work.raw(),
-                                                     nEigVecs,
-                                                     stream));
-
-    RAFT_CUDA_TRY(cudaMemcpyAsync(
-      eigVecs, work.raw(), nEigVecs * n * sizeof(weight_t), cudaMemcpyDeviceToDevice, stream));
-  }
+/**
+ * The per-cluster statistics of `partition_stats_kernel` in a workspace of 4 nClusters + 1
+ * values: sizes, cut, internal, volume (each [nClusters]) and the total degree. Stream-ordered.
+ */
+template <typename vertex_t, typename weight_t>
+void partition_stats(raft::resources const& handle,
+                     spectral::matrix::sparse_matrix_t<vertex_t, weight_t> const& csr_m,
+                     vertex_t nClusters,
+                     vertex_t const* __restrict__ clusters,
+                     rmm::device_uvector<weight_t>& stats)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  vertex_t n  = csr_m.nrows_;
+  stats.resize(4 * size_t(nClusters) + 1, stream);
+  RAFT_CUDA_TRY(cudaMemsetAsync(stats.data(), 0, stats.size() * sizeof(weight_t), stream));
+  constexpr int kThreads = 256;
+  int n_blocks           = std::max<int>(1, std::min<int>(raft::ceildiv<int>(n, kThreads), 4096));
+  weight_t* sizes        = stats.data();
+  partition_stats_kernel<<<n_blocks, kThreads, 0, stream>>>(csr_m.row_offsets_,
+                                                             csr_m.col_indices_,
+                                                             csr_m.values_,
+                                                             n,
+                                                             nClusters,
+                                                             clusters,
+                                                             sizes,
+                                                             sizes + nClusters,
+                                                             sizes + 2 * nClusters,
+                                                             sizes + 3 * nClusters,
+                                                             sizes + 4 * nClusters);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
 
 namespace {
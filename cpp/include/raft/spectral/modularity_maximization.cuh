@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,10 @@
 
 #pragma once
 
+#include <raft/core/device_mdspan.hpp>
+
+#include <rmm/device_uvector.hpp>
+
 #include <tuple>
 
 #include <raft/spectral/detail/modularity_maximization.hpp>
@@ -80,6 +84,33 @@ void analyzeModularity(raft::resources const& handle,
     handle, csr_m, nClusters, clusters, modularity);
 }
 
+/// Compute modularity, on the device
+/** The same analysis as above, stream-ordered and without any
+ *  synchronization: the result stays on the device, e.g. for the
+ *  repeated clustering of a hyperparameter search.
+ *
+ *  @param handle raft handle for managing expensive resources
+ *  @param csr_m Weighted graph in CSR format
+ *  @param nClusters Number of clusters.
+ *  @param clusters (Input, device memory, n entries) Cluster assignments.
+ *  @param modularity (Output) modularity
+ *  @param workspace temporary storage of 4 nClusters + 1 values,
+ *    resized as needed: it can be reused across calls with
+ *    different numbers of clusters. On exit, it starts with the
+ *    sizes of the clusters.
+ */
+template <typename vertex_t, typename weight_t>
+void analyzeModularity(raft::resources const& handle,
+                       matrix::sparse_matrix_t<vertex_t, weight_t> const& csr_m,
+                       vertex_t nClusters,
+                       vertex_t const* __restrict__ clusters,
+                       raft::device_scalar_view<weight_t> modularity,
+                       rmm::device_uvector<weight_t>& workspace)
+{
+  raft::spectral::detail::analyzeModularity<vertex_t, weight_t>(
+    handle, csr_m, nClusters, clusters, modularity.data_handle(), workspace);
+}
+
 }  // namespace spectral
 }  // namespace raft
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -19,6 +19,10 @@
 
 #pragma once
 
+#include <raft/core/device_mdspan.hpp>
+
+#include <rmm/device_uvector.hpp>
+
 #include <tuple>
 
 #include <raft/spectral/detail/partition.hpp>
@@ -89,6 +93,36 @@ void analyzePartition(raft::resources const& handle,
     handle, csr_m, nClusters, clusters, edgeCut, cost);
 }
 
+/// Compute cost function for partition, on the device
+/** The same analysis as above, stream-ordered and without any
+ *  synchronization: the results stay on the device, e.g. for the
+ *  repeated partitioning of a hyperparameter search.
+ *
+ *  @param handle raft handle for managing expensive resources
+ *  @param csr_m Weighted graph in CSR format
+ *  @param nClusters Number of partitions.
+ *  @param clusters (Input, device memory, n entries) Partition
+ *    assignments.
+ *  @param edgeCut (Output) weight of edges cut by partition.
+ *  @param cost (Output) partition cost function.
+ *  @param workspace temporary storage of 4 nClusters + 1 values,
+ *    resized as needed: it can be reused across calls with
+ *    different numbers of partitions. On exit, it starts with the
+ *    sizes of the partitions.
+ */
+template <typename vertex_t, typename weight_t>
+void analyzePartition(raft::resources const& handle,
+                      matrix::sparse_matrix_t<vertex_t, weight_t> const& csr_m,
+                      vertex_t nClusters,
+                      const vertex_t* __restrict__ clusters,
+                      raft::device_scalar_view<weight_t> edgeCut,
+                      raft::device_scalar_view<weight_t> cost,
+                      rmm::device_uvector<weight_t>& workspace)
+{
+  raft::spectral::detail::analyzePartition<vertex_t, weight_t>(
+    handle, csr_m, nClusters, clusters, edgeCut.data_handle(), cost.data_handle(), workspace);
+}
+
 }  // namespace spectral
 }  // namespace raft
 
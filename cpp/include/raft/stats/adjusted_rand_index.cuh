@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -58,6 +58,10 @@ double adjusted_rand_index(const T* firstClusterArray,
 /**
  * @brief Function to calculate Adjusted RandIndex
  * @see https://en.wikipedia.org/wiki/Rand_index
+ *
+ * When the label range is large enough for the dense contingency matrix to exceed the input,
+ * the metric is computed from the sparse contingency matrix (see `sparseContingencyMatrix`),
+ * in time and memory linear in the number of samples and classes.
  * @tparam value_t data-type for input label arrays
  * @tparam math_t integral data-type used for computing n-choose-r
  * @tparam idx_t Index type of matrix extent.
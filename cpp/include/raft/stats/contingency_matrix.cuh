@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -26,6 +26,8 @@
 #include <raft/core/resources.hpp>
 #include <raft/stats/detail/contingencyMatrix.cuh>
 
+#include <optional>
+
 namespace raft {
 namespace stats {
 
@@ -105,6 +107,47 @@ void contingencyMatrix(const T* groundTruth,
                                      maxLabel);
 }
 
+/**
+ * @brief construct the non-zero entries of the contingency matrix given input ground truth and
+ *        prediction labels, in the COO format sorted by (row, column). Unlike the dense
+ *        contingencyMatrix, the memory and time scale with the number of samples instead of the
+ *        number of classes squared, which makes it suitable for large label spaces (e.g.
+ *        clusterings with millions of clusters).
+ * @tparam T label type
+ * @tparam OutT output count type
+ * @param groundTruth: device 1-d array for ground truth (num of rows)
+ * @param predictedLabel: device 1-d array for prediction (num of columns)
+ * @param nSamples: number of elements in input array
+ * @param outRows: [out] the ground truth labels of the entries [len >= nSamples]
+ * @param outCols: [out] the predicted labels of the entries [len >= nSamples]
+ * @param outCounts: [out] the counts of the entries [len >= nSamples]
+ * @param stream: cuda stream for execution
+ * @param minLabel: Optional, min value in input ground truth array
+ * @param maxLabel: Optional, max value in input ground truth array
+ * @return the number of non-zero entries
+ */
+template <typename T, typename OutT = int>
+int sparseContingencyMatrix(const T* groundTruth,
+                            const T* predictedLabel,
+                            int nSamples,
+                            T* outRows,
+                            T* outCols,
+                            OutT* outCounts,
+                            cudaStream_t stream,
+                            T minLabel = std::numeric_limits<T>::max(),
+                            T maxLabel = std::numeric_limits<T>::max())
+{
+  return detail::sparseContingencyMatrix<T, OutT>(groundTruth,
+                                                  predictedLabel,
+                                                  nSamples,
+                                                  outRows,
+                                                  outCols,
+                                                  outCounts,
+                                                  stream,
+                                                  minLabel,
+                                                  maxLabel);
+}
+
 /**
  * @defgroup contingency_matrix Contingency Matrix
  * @{
@@ -197,6 +240,49 @@ void contingency_matrix(raft::resources const& handle,
                                             max_label_value);
 }
 
+/**
+ * @brief construct the non-zero entries of the contingency matrix given input ground truth and
+ *        prediction labels, in the COO format sorted by (row, column). The memory and time scale
+ *        with the number of samples instead of the number of classes squared.
+ * @tparam value_t label type
+ * @tparam out_t output count type
+ * @tparam idx_t Index type of matrix extent.
+ * @param[in]  handle: the raft handle.
+ * @param[in]  ground_truth: device 1-d array for ground truth (num of rows)
+ * @param[in]  predicted_label: device 1-d array for prediction (num of columns)
+ * @param[out] out_rows: the ground truth labels of the entries [len >= n_samples]
+ * @param[out] out_cols: the predicted labels of the entries [len >= n_samples]
+ * @param[out] out_counts: the counts of the entries [len >= n_samples]
+ * @param[in]  min_label: std::optional, min value in input ground truth array
+ * @param[in]  max_label: std::optional, max value in input ground truth array
+ * @return the number of non-zero entries, i.e. the valid prefix of the outputs
+ */
+template <typename value_t, typename out_t, typename idx_t>
+idx_t sparse_contingency_matrix(raft::resources const& handle,
+                                raft::device_vector_view<const value_t, idx_t> ground_truth,
+                                raft::device_vector_view<const value_t, idx_t> predicted_label,
+                                raft::device_vector_view<value_t, idx_t> out_rows,
+                                raft::device_vector_view<value_t, idx_t> out_cols,
+                                raft::device_vector_view<out_t, idx_t> out_counts,
+                                std::optional<value_t> min_label = std::nullopt,
+                                std::optional<value_t> max_label = std::nullopt)
+{
+  RAFT_EXPECTS(ground_truth.size() == predicted_label.size(), "Size mismatch");
+  RAFT_EXPECTS(out_rows.size() >= ground_truth.size() && out_cols.size() >= ground_truth.size() &&
+                 out_counts.size() >= ground_truth.size(),
+               "The outputs must have room for one entry per sample");
+  return detail::sparseContingencyMatrix<value_t, out_t>(
+    ground_truth.data_handle(),
+    predicted_label.data_handle(),
+    ground_truth.extent(0),
+    out_rows.data_handle(),
+    out_cols.data_handle(),
+    out_counts.data_handle(),
+    resource::get_cuda_stream(handle),
+    min_label.value_or(std::numeric_limits<value_t>::max()),
+    max_label.value_or(std::numeric_limits<value_t>::max()));
+}
+
 /** @} */  // end group contingency_matrix
 
 /**
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2022, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -36,6 +36,8 @@
 #include <thrust/device_ptr.h>
 #include <thrust/execution_policy.h>
 #include <thrust/extrema.h>
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
 
 namespace raft {
 namespace stats {
@@ -108,6 +110,99 @@ int countUnique(const T* arr, int size, T& minLabel, T& maxLabel, cudaStream_t s
   return numUniques;
 }
 
+/**
+ * @brief The adjusted Rand index from the sums of the numbers of unordered pairs of the entries
+ * (nChooseTwoSum), the row sums (aCTwoSum) and the column sums (bCTwoSum) of the contingency matrix
+ */
+template <typename MathT>
+double adjusted_rand_index_from_pair_sums(MathT nChooseTwoSum,
+                                          MathT aCTwoSum,
+                                          MathT bCTwoSum,
+                                          int size)
+{
+  auto nChooseTwo    = double(size) * double(size - 1) / 2.0;
+  auto expectedIndex = double(aCTwoSum) * double(bCTwoSum) / double(nChooseTwo);
+  auto maxIndex      = (double(bCTwoSum) + double(aCTwoSum)) / 2.0;
+  auto index         = double(nChooseTwoSum);
+  if (maxIndex - expectedIndex)
+    return (index - expectedIndex) / (maxIndex - expectedIndex);
+  else
+    return 0;
+}
+
+/**
+ * @brief Function to calculate Adjusted RandIndex from the sparse contingency matrix, in time and
+ *        memory linear in the number of samples and classes (instead of the classes squared)
+ * @tparam T data-type for input label arrays
+ * @tparam MathT integral data-type used for computing n-choose-r
+ * @param firstClusterArray: the array of classes
+ * @param secondClusterArray: the array of classes
+ * @param size: the size of the data points of type int
+ * @param lowerLabelRange: the lower bound of the range of labels
+ * @param upperLabelRange: the upper bound of the range of labels
+ * @param stream: the cudaStream object
+ */
+template <typename T, typename MathT = int>
+double compute_adjusted_rand_index_sparse(const T* firstClusterArray,
+                                          const T* secondClusterArray,
+                                          int size,
+                                          T lowerLabelRange,
+                                          T upperLabelRange,
+                                          cudaStream_t stream)
+{
+  auto nClasses = size_t(upperLabelRange - lowerLabelRange) + 1;
+  rmm::device_uvector<T> rows(size, stream);
+  rmm::device_uvector<T> cols(size, stream);
+  rmm::device_uvector<MathT> counts(size, stream);
+  auto nnz = sparseContingencyMatrix<T, MathT>(firstClusterArray,
+                                               secondClusterArray,
+                                               size,
+                                               rows.data(),
+                                               cols.data(),
+                                               counts.data(),
+                                               stream,
+                                               lowerLabelRange,
+                                               upperLabelRange);
+  rmm::device_uvector<MathT> a(nClasses, stream);
+  rmm::device_uvector<MathT> b(nClasses, stream);
+  rmm::device_scalar<MathT> d_aCTwoSum(stream);
+  rmm::device_scalar<MathT> d_bCTwoSum(stream);
+  rmm::device_scalar<MathT> d_nChooseTwoSum(stream);
+  MathT h_aCTwoSum, h_bCTwoSum, h_nChooseTwoSum;
+  RAFT_CUDA_TRY(cudaMemsetAsync(a.data(), 0, nClasses * sizeof(MathT), stream));
+  RAFT_CUDA_TRY(cudaMemsetAsync(b.data(), 0, nClasses * sizeof(MathT), stream));
+  RAFT_CUDA_TRY(cudaMemsetAsync(d_aCTwoSum.data(), 0, sizeof(MathT), stream));
+  RAFT_CUDA_TRY(cudaMemsetAsync(d_bCTwoSum.data(), 0, sizeof(MathT), stream));
+  RAFT_CUDA_TRY(cudaMemsetAsync(d_nChooseTwoSum.data(), 0, sizeof(MathT), stream));
+  // calculating the sum of NijC2 over the non-zero entries
+  raft::linalg::mapThenSumReduce<MathT, nCTwo<MathT>>(
+    d_nChooseTwoSum.data(), nnz, nCTwo<MathT>(), stream, counts.data(), counts.data());
+  // calculating the row-wise and column-wise sums
+  const T* pRows    = rows.data();
+  const T* pCols    = cols.data();
+  const MathT* pCnt = counts.data();
+  MathT* pA         = a.data();
+  MathT* pB         = b.data();
+  thrust::for_each_n(thrust::cuda::par.on(stream),
+                     thrust::make_counting_iterator(0),
+                     nnz,
+                     [=] __device__(int i) {
+                       raft::myAtomicAdd(pA + (pRows[i] - lowerLabelRange), pCnt[i]);
+                       raft::myAtomicAdd(pB + (pCols[i] - lowerLabelRange), pCnt[i]);
+                     });
+  // calculating the sums of number of unordered pairs for every element of a and b
+  raft::linalg::mapThenSumReduce<MathT, nCTwo<MathT>>(
+    d_aCTwoSum.data(), nClasses, nCTwo<MathT>(), stream, a.data(), a.data());
+  raft::linalg::mapThenSumReduce<MathT, nCTwo<MathT>>(
+    d_bCTwoSum.data(), nClasses, nCTwo<MathT>(), stream, b.data(), b.data());
+  // updating in the host memory
+  raft::update_host(&h_nChooseTwoSum, d_nChooseTwoSum.data(), 1, stream);
+  raft::update_host(&h_aCTwoSum, d_aCTwoSum.data(), 1, stream);
+  raft::update_host(&h_bCTwoSum, d_bCTwoSum.data(), 1, stream);
+  RAFT_CUDA_TRY(cudaStreamSynchronize(stream));
+  return adjusted_rand_index_from_pair_sums(h_nChooseTwoSum, h_aCTwoSum, h_bCTwoSum, size);
+}
+
 /**
  * @brief Function to calculate Adjusted RandIndex as described
  *        <a href="https://en.wikipedia.org/wiki/Rand_index">here</a>
@@ -135,6 +230,11 @@ double compute_adjusted_rand_index(const T* firstClusterArray,
   if (nUniqFirst == nUniqSecond) {
     if (nUniqFirst == 1 || nUniqFirst == size) return 1.0;
   }
+  // the dense contingency matrix would be larger than the input
+  if (useSparseContingencyMatrix(size_t(nClasses), size)) {
+    return compute_adjusted_rand_index_sparse<T, MathT>(
+      firstClusterArray, secondClusterArray, size, lowerLabelRange, upperLabelRange, stream);
+  }
   auto nUniqClasses = MathT(nClasses);
   rmm::device_uvector<MathT> dContingencyMatrix(nUniqClasses * nUniqClasses, stream);
   RAFT_CUDA_TRY(cudaMemsetAsync(
@@ -186,14 +286,7 @@ double compute_adjusted_rand_index(const T* firstClusterArray,
   raft::update_host(&h_aCTwoSum, d_aCTwoSum.data(), 1, stream);
   raft::update_host(&h_bCTwoSum, d_bCTwoSum.data(), 1, stream);
   // calculating the ARI
-  auto nChooseTwo    = double(size) * double(size - 1) / 2.0;
-  auto expectedIndex = double(h_aCTwoSum) * double(h_bCTwoSum) / double(nChooseTwo);
-  auto maxIndex      = (double(h_bCTwoSum) + double(h_aCTwoSum)) / 2.0;
-  auto index         = double(h_nChooseTwoSum);
-  if (maxIndex - expectedIndex)
-    return (index - expectedIndex) / (maxIndex - expectedIndex);
-  else
-    return 0;
+  return adjusted_rand_index_from_pair_sums(h_nChooseTwoSum, h_aCTwoSum, h_bCTwoSum, size);
 }
 
 };  // end namespace detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,10 +16,12 @@
 
 #pragma once
 
+#include "../sampled_score.cuh"
 #include "../silhouette_score.cuh"
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/cuda_stream_pool.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
+#include <raft/linalg/map.cuh>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/device_atomics.cuh>
 #include <rmm/device_uvector.hpp>
@@ -27,6 +29,7 @@
 #include <thrust/device_vector.h>
 #include <thrust/fill.h>
 #include <thrust/reduce.h>
+#include <thrust/sequence.h>
 
 namespace raft {
 namespace stats {
@@ -113,6 +116,47 @@ RAFT_KERNEL compute_chunked_a_b_kernel(value_t* a,
   }
 }
 
+/**
+ * The same sweep as `compute_chunked_a_b_kernel` for a tile of the distances between the rows
+ * `row_ids[0..dist_rows)` (gathered, not contiguous) and the contiguous rows
+ * `[col_offset, col_offset + dist_cols)`; a and b are local to the rows of the tile
+ * ([dist_rows] and [dist_rows, n_labels]).
+ */
+template <typename value_t, typename value_idx, typename label_idx>
+RAFT_KERNEL compute_tiled_a_b_kernel(value_t* a,
+                                     value_t* b,
+                                     const value_idx* row_ids,
+                                     value_idx col_offset,
+                                     const label_idx* y,
+                                     label_idx n_labels,
+                                     const value_idx* cluster_counts,
+                                     const value_t* distances,
+                                     value_idx dist_rows,
+                                     value_idx dist_cols)
+{
+  value_idx row_id = threadIdx.x + blockIdx.x * blockDim.x;
+  value_idx col_id = threadIdx.y + blockIdx.y * blockDim.y;
+
+  if (row_id >= dist_rows || col_id >= dist_cols) { return; }
+
+  value_idx pw_row_id = row_ids[row_id];
+  value_idx pw_col_id = col_id + col_offset;
+  if (pw_row_id == pw_col_id) { return; }
+
+  auto row_cluster = y[pw_row_id];
+  if (cluster_counts[row_cluster] == 1) { return; }
+
+  auto col_cluster        = y[pw_col_id];
+  auto col_cluster_counts = cluster_counts[col_cluster];
+  auto dist               = distances[size_t(row_id) * dist_cols + col_id];
+
+  if (col_cluster == row_cluster) {
+    atomicAdd(&a[row_id], dist / (col_cluster_counts - 1));
+  } else {
+    atomicAdd(&b[size_t(row_id) * n_labels + col_cluster], dist / col_cluster_counts);
+  }
+}
+
 template <typename value_idx, typename label_idx>
 rmm::device_uvector<value_idx> get_cluster_counts(raft::resources const& handle,
                                                   const label_idx* y,
@@ -272,6 +316,191 @@ value_t silhouette_score(
   return thrust::reduce(policy, a_ptr, a_ptr + n_rows, value_t(0)) / n_rows;
 }
 
+/**
+ * The silhouette scores of the rows `row_ids` [n_sel] of X, written to `scores` [n_sel], with a
+ * bounded temporary memory: the rows are processed in blocks, whose distances to all the rows of
+ * X are computed tile by tile and reduced right away to the per-cluster sums of a and b. The
+ * blocks and the tiles are sized so that the gathered rows, a, b and one tile of distances stay
+ * within `max_workspace_bytes` (a block has at least one row and a tile at least one column).
+ */
+template <typename value_t, typename value_idx, typename label_idx>
+void silhouette_scores_tiled(raft::resources const& handle,
+                             const value_t* X,
+                             value_idx n_rows,
+                             value_idx n_cols,
+                             const label_idx* y,
+                             label_idx n_labels,
+                             const value_idx* cluster_counts,
+                             const value_idx* row_ids,
+                             value_idx n_sel,
+                             value_t* scores,
+                             size_t max_workspace_bytes,
+                             raft::distance::DistanceType metric)
+{
+  auto stream = resource::get_cuda_stream(handle);
+
+  // a block of rc rows takes rc * row_bytes (the rows, a and b) and rc * cc distances: at most half
+  // of the budget for the former, and no more rows than columns in a tile when both fit
+  size_t row_bytes = sizeof(value_t) * (size_t(n_cols) + size_t(n_labels) + 2);
+  size_t half      = max_workspace_bytes / 2;
+  size_t max_rc    = std::min<size_t>(half / row_bytes, std::sqrt(double(half / sizeof(value_t))));
+  value_idx rc     = value_idx(std::max<size_t>(1, std::min<size_t>(n_sel, max_rc)));
+  size_t rest = max_workspace_bytes > rc * row_bytes ? max_workspace_bytes - rc * row_bytes : 0;
+  value_idx cc =
+    value_idx(std::max<size_t>(1, std::min<size_t>(n_rows, rest / (sizeof(value_t) * rc))));
+
+  rmm::device_uvector<value_t> rows(size_t(rc) * n_cols, stream);
+  rmm::device_uvector<value_t> a(rc, stream);
+  rmm::device_uvector<value_t> b(size_t(rc) * n_labels, stream);
+  rmm::device_uvector<value_t> distances(size_t(rc) * cc, stream);
+
+  for (value_idx i = 0; i < n_sel; i += rc) {
+    value_idx n_left = std::min(rc, n_sel - i);
+    const value_idx* ids = row_ids + i;
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<value_t, size_t>(rows.data(), size_t(n_left) * n_cols),
+      [X, ids, n_cols] __device__(size_t e) {
+        return X[size_t(ids[e / n_cols]) * n_cols + e % n_cols];
+      });
+    RAFT_CUDA_TRY(cudaMemsetAsync(a.data(), 0, n_left * sizeof(value_t), stream));
+    // the same initial values of b as `fill_b_kernel`
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<value_t, size_t>(b.data(), size_t(n_left) * n_labels),
+      [y, ids, n_labels, cluster_counts] __device__(size_t e) {
+        auto row_cluster = y[ids[e / n_labels]];
+        auto col_cluster = label_idx(e % n_labels);
+        if ((row_cluster == col_cluster || cluster_counts[col_cluster] == 0) &&
+            cluster_counts[row_cluster] != 1) {
+          return std::numeric_limits<value_t>::max();
+        }
+        return value_t(0);
+      });
+
+    for (value_idx j = 0; j < n_rows; j += cc) {
+      value_idx n_right = std::min(cc, n_rows - j);
+      raft::distance::pairwise_distance(handle,
+                                        rows.data(),
+                                        X + size_t(j) * n_cols,
+                                        distances.data(),
+                                        n_left,
+                                        n_right,
+                                        n_cols,
+                                        metric);
+      dim3 block_size(32, 32);
+      dim3 grid_size(raft::ceildiv(n_left, (value_idx)block_size.x),
+                     raft::ceildiv(n_right, (value_idx)block_size.y));
+      compute_tiled_a_b_kernel<<<grid_size, block_size, 0, stream>>>(a.data(),
+                                                                      b.data(),
+                                                                      ids,
+                                                                      j,
+                                                                      y,
+                                                                      n_labels,
+                                                                      cluster_counts,
+                                                                      distances.data(),
+                                                                      n_left,
+                                                                      n_right);
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    }
+
+    raft::linalg::reduce<value_t, value_t, value_idx, raft::identity_op, raft::min_op>(
+      b.data(),
+      b.data(),
+      n_labels,
+      n_left,
+      std::numeric_limits<value_t>::max(),
+      true,
+      true,
+      stream,
+      false,
+      raft::identity_op(),
+      raft::min_op());
+    raft::linalg::binaryOp<value_t, raft::stats::detail::SilOp<value_t>, value_t, value_idx>(
+      scores + i, a.data(), b.data(), n_left, raft::stats::detail::SilOp<value_t>(), stream);
+  }
+}
+
+/** The exact silhouette score of all the rows, with `silhouette_scores_tiled`. */
+template <typename value_t, typename value_idx, typename label_idx>
+value_t silhouette_score_tiled(raft::resources const& handle,
+                               const value_t* X,
+                               value_idx n_rows,
+                               value_idx n_cols,
+                               const label_idx* y,
+                               label_idx n_labels,
+                               value_t* scores,
+                               size_t max_workspace_bytes,
+                               raft::distance::DistanceType metric)
+{
+  ASSERT(n_labels >= 2 && n_labels <= (n_rows - 1),
+         "silhouette Score not defined for the given number of labels!");
+  auto stream = resource::get_cuda_stream(handle);
+  auto policy = resource::get_thrust_policy(handle);
+
+  rmm::device_uvector<value_idx> cluster_counts = get_cluster_counts(handle, y, n_rows, n_labels);
+  rmm::device_uvector<value_idx> row_ids(n_rows, stream);
+  thrust::sequence(policy, row_ids.begin(), row_ids.end());
+  rmm::device_uvector<value_t> own_scores(scores == nullptr ? n_rows : 0, stream);
+  if (scores == nullptr) { scores = own_scores.data(); }
+
+  silhouette_scores_tiled(handle,
+                          X,
+                          n_rows,
+                          n_cols,
+                          y,
+                          n_labels,
+                          cluster_counts.data(),
+                          row_ids.data(),
+                          n_rows,
+                          scores,
+                          max_workspace_bytes,
+                          metric);
+  return thrust::reduce(policy, scores, scores + n_rows, value_t(0)) / n_rows;
+}
+
+/**
+ * The silhouette score estimated from the scores of n_samples rows drawn uniformly without
+ * replacement (exact when n_samples >= n_rows); the distances are still to all the rows.
+ */
+template <typename value_t, typename value_idx, typename label_idx>
+score_estimate<value_t> silhouette_score_sampled(raft::resources const& handle,
+                                                 const value_t* X,
+                                                 value_idx n_rows,
+                                                 value_idx n_cols,
+                                                 const label_idx* y,
+                                                 label_idx n_labels,
+                                                 value_idx n_samples,
+                                                 uint64_t seed,
+                                                 double confidence,
+                                                 size_t max_workspace_bytes,
+                                                 raft::distance::DistanceType metric)
+{
+  ASSERT(n_labels >= 2 && n_labels <= (n_rows - 1),
+         "silhouette Score not defined for the given number of labels!");
+  auto stream = resource::get_cuda_stream(handle);
+
+  rmm::device_uvector<value_idx> cluster_counts = get_cluster_counts(handle, y, n_rows, n_labels);
+  auto row_ids = raft::stats::detail::sample_score_rows(handle, n_rows, n_samples, seed);
+  auto n_sel   = value_idx(row_ids.size());
+  rmm::device_uvector<value_t> scores(n_sel, stream);
+
+  silhouette_scores_tiled(handle,
+                          X,
+                          n_rows,
+                          n_cols,
+                          y,
+                          n_labels,
+                          cluster_counts.data(),
+                          row_ids.data(),
+                          n_sel,
+                          scores.data(),
+                          max_workspace_bytes,
+                          metric);
+  return raft::stats::detail::estimate_mean_score(
+    handle, scores.data(), int64_t(n_sel), int64_t(n_rows), confidence);
+}
+
 }  // namespace detail
 }  // namespace batched
 }  // namespace stats
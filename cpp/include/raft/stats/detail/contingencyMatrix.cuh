@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,13 +16,21 @@
 
 #pragma once
 
+#include <raft/core/error.hpp>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
 
+#include <rmm/device_uvector.hpp>
+
 #include <thrust/device_ptr.h>
 #include <thrust/execution_policy.h>
 #include <thrust/extrema.h>
+#include <thrust/for_each.h>
+#include <thrust/iterator/constant_iterator.h>
+#include <thrust/iterator/counting_iterator.h>
 #include <thrust/reduce.h>
+#include <thrust/sort.h>
+#include <thrust/transform.h>
 
 #include <cub/cub.cuh>
 
@@ -311,6 +319,91 @@ void contingencyMatrix(const T* groundTruth,
   }
 }
 
+/**
+ * @brief Whether the metrics built on the contingency matrix should use its sparse form: when the
+ * dense matrix of `nClasses x nClasses` entries would be larger than the input (and not tiny),
+ * e.g. when evaluating clusterings with millions of clusters.
+ * @param nClasses: number of classes (maxLabel - minLabel + 1)
+ * @param nSamples: number of elements in input array
+ */
+inline bool useSparseContingencyMatrix(size_t nClasses, int nSamples)
+{
+  constexpr size_t kMinSparseEntries = size_t{1} << 20;
+  if (nClasses >= (size_t{1} << 32)) { return true; }
+  auto nEntries = nClasses * nClasses;
+  return nEntries > static_cast<size_t>(nSamples) && nEntries > kMinSparseEntries;
+}
+
+/**
+ * @brief construct the non-zero entries of the contingency matrix given input ground truth and
+ *        prediction labels, in the COO format sorted by (row, column). The cost scales with the
+ *        number of samples instead of the number of classes squared.
+ * @tparam T label type
+ * @tparam OutT output count type
+ * @param groundTruth: device 1-d array for ground truth (num of rows)
+ * @param predictedLabel: device 1-d array for prediction (num of columns)
+ * @param nSamples: number of elements in input array
+ * @param outRows: [out] the ground truth labels of the entries [len >= nSamples]
+ * @param outCols: [out] the predicted labels of the entries [len >= nSamples]
+ * @param outCounts: [out] the counts of the entries [len >= nSamples]
+ * @param stream: cuda stream for execution
+ * @param minLabel: Optional, min value in input ground truth array
+ * @param maxLabel: Optional, max value in input ground truth array
+ * @return the number of non-zero entries
+ */
+template <typename T, typename OutT = int>
+int sparseContingencyMatrix(const T* groundTruth,
+                            const T* predictedLabel,
+                            int nSamples,
+                            T* outRows,
+                            T* outCols,
+                            OutT* outCounts,
+                            cudaStream_t stream,
+                            T minLabel = std::numeric_limits<T>::max(),
+                            T maxLabel = std::numeric_limits<T>::max())
+{
+  if (nSamples == 0) { return 0; }
+  if (minLabel == std::numeric_limits<T>::max() || maxLabel == std::numeric_limits<T>::max()) {
+    getInputClassCardinality<T>(groundTruth, nSamples, stream, minLabel, maxLabel);
+  }
+  auto nClasses = static_cast<uint64_t>(maxLabel - minLabel) + 1;
+  RAFT_EXPECTS(nClasses <= (uint64_t{1} << 32),
+               "Too many classes for the sparse contingency matrix");
+
+  // the (row, column) pairs as one key, sorted and then counted
+  auto policy = thrust::cuda::par.on(stream);
+  rmm::device_uvector<uint64_t> keys(nSamples, stream);
+  thrust::transform(policy,
+                    groundTruth,
+                    groundTruth + nSamples,
+                    predictedLabel,
+                    keys.begin(),
+                    [minLabel, nClasses] __device__(T gt, T pd) {
+                      return static_cast<uint64_t>(gt - minLabel) * nClasses +
+                             static_cast<uint64_t>(pd - minLabel);
+                    });
+  thrust::sort(policy, keys.begin(), keys.end());
+  rmm::device_uvector<uint64_t> uniqueKeys(nSamples, stream);
+  auto ends = thrust::reduce_by_key(policy,
+                                    keys.begin(),
+                                    keys.end(),
+                                    thrust::make_constant_iterator(OutT(1)),
+                                    uniqueKeys.begin(),
+                                    outCounts);
+  int nnz   = static_cast<int>(ends.first - uniqueKeys.begin());
+
+  const uint64_t* pUniqueKeys = uniqueKeys.data();
+  thrust::for_each_n(policy,
+                     thrust::make_counting_iterator(0),
+                     nnz,
+                     [pUniqueKeys, outRows, outCols, minLabel, nClasses] __device__(int i) {
+                       auto key   = pUniqueKeys[i];
+                       outRows[i] = static_cast<T>(key / nClasses) + minLabel;
+                       outCols[i] = static_cast<T>(key % nClasses) + minLabel;
+                     });
+  return nnz;
+}
+
 };  // namespace detail
 };  // namespace stats
 };  // namespace raft
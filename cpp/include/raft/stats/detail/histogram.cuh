@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -23,6 +23,8 @@
 #include <raft/util/vectorized.cuh>
 #include <stdint.h>
 
+#include <algorithm>
+
 // This file is a shameless amalgamation of independent works done by
 // Lars Nyland and Andy Adinets
 
@@ -39,18 +41,31 @@ struct IdentityBinner {
 };
 
 static const int ThreadsPerBlock = 256;
+/** The largest y-dimension of a grid; the blocks loop over the columns beyond it. */
+static const int MaxGridDimY = 65535;
+/**
+ * The fraction of the shared memory of a block which `HistTypeAuto` lets the warp-private
+ * sub-histograms use (beyond it, they cost too much occupancy).
+ */
+static const int WarpPrivateSmemFraction = 4;
 
+/**
+ * All the columns are processed by a single launch: the blocks resident on the device are shared
+ * by the columns (rather than every column getting as many blocks as the device holds), and
+ * every block walks over the columns `blockIdx.y + k * gridDim.y`.
+ */
 template <typename IdxT, int VecLen>
-dim3 computeGridDim(IdxT nrows, IdxT ncols, const void* kernel)
+dim3 computeGridDim(IdxT nrows, IdxT ncols, const void* kernel, size_t smemSize = 0)
 {
   int occupancy;
   RAFT_CUDA_TRY(
-    cudaOccupancyMaxActiveBlocksPerMultiprocessor(&occupancy, kernel, ThreadsPerBlock, 0));
-  const auto maxBlks = occupancy * raft::getMultiProcessorCount();
+    cudaOccupancyMaxActiveBlocksPerMultiprocessor(&occupancy, kernel, ThreadsPerBlock, smemSize));
+  const auto maxBlks = std::max(occupancy, 1) * raft::getMultiProcessorCount();
   int nblksx         = raft::ceildiv<int>(VecLen ? nrows / VecLen : nrows, ThreadsPerBlock);
   // for cases when there aren't a lot of blocks for computing one histogram
-  nblksx = std::min(nblksx, maxBlks);
-  return dim3(nblksx, ncols);
+  nblksx     = std::max(1, std::min(nblksx, raft::ceildiv<int>(maxBlks, ncols)));
+  int nblksy = std::min<IdxT>(ncols, MaxGridDimY);
+  return dim3(nblksx, nblksy);
 }
 
 template <typename DataT, typename BinnerOp, typename IdxT, int VecLen, typename CoreOp>
@@ -75,7 +90,8 @@ DI void histCoreOp(const DataT* data, IdxT nrows, IdxT nbins, BinnerOp binner, C
 }
 
 template <typename DataT, typename BinnerOp, typename IdxT, int VecLen>
-RAFT_KERNEL gmemHistKernel(int* bins, const DataT* data, IdxT nrows, IdxT nbins, BinnerOp binner)
+RAFT_KERNEL gmemHistKernel(
+  int* bins, const DataT* data, IdxT nrows, IdxT ncols, IdxT nbins, BinnerOp binner)
 {
   auto op = [=] __device__(int binId, IdxT row, IdxT col) {
     if (row >= nrows) return;
@@ -89,7 +105,9 @@ RAFT_KERNEL gmemHistKernel(int* bins, const DataT* data, IdxT nrows, IdxT nbins,
     if (raft::laneId() == leader) { raft::myAtomicAdd(bins + binOffset + binId, __popc(mask)); }
 #endif  // __CUDA_ARCH__
   };
-  histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, blockIdx.y);
+  for (IdxT col = blockIdx.y; col < ncols; col += gridDim.y) {
+    histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, col);
+  }
 }
 
 template <typename DataT, typename BinnerOp, typename IdxT, int VecLen>
@@ -104,17 +122,14 @@ void gmemHist(int* bins,
   auto blks = computeGridDim<IdxT, VecLen>(
     nrows, ncols, (const void*)gmemHistKernel<DataT, BinnerOp, IdxT, VecLen>);
   gmemHistKernel<DataT, BinnerOp, IdxT, VecLen>
-    <<<blks, ThreadsPerBlock, 0, stream>>>(bins, data, nrows, nbins, binner);
+    <<<blks, ThreadsPerBlock, 0, stream>>>(bins, data, nrows, ncols, nbins, binner);
 }
 
 template <typename DataT, typename BinnerOp, typename IdxT, int VecLen, bool UseMatchAny>
-RAFT_KERNEL smemHistKernel(int* bins, const DataT* data, IdxT nrows, IdxT nbins, BinnerOp binner)
+RAFT_KERNEL smemHistKernel(
+  int* bins, const DataT* data, IdxT nrows, IdxT ncols, IdxT nbins, BinnerOp binner)
 {
   extern __shared__ unsigned sbins[];
-  for (auto i = threadIdx.x; i < nbins; i += blockDim.x) {
-    sbins[i] = 0;
-  }
-  __syncthreads();
   auto op = [=] __device__(int binId, IdxT row, IdxT col) {
     if (row >= nrows) return;
 #if __CUDA_ARCH__ < 700
@@ -132,13 +147,19 @@ RAFT_KERNEL smemHistKernel(int* bins, const DataT* data, IdxT nrows, IdxT nbins,
     }
 #endif  // __CUDA_ARCH__
   };
-  IdxT col = blockIdx.y;
-  histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, col);
-  __syncthreads();
-  auto binOffset = col * nbins;
-  for (auto i = threadIdx.x; i < nbins; i += blockDim.x) {
-    auto val = sbins[i];
-    if (val > 0) { raft::myAtomicAdd<unsigned int>((unsigned int*)bins + binOffset + i, val); }
+  for (IdxT col = blockIdx.y; col < ncols; col += gridDim.y) {
+    // every thread zeroes the bins it flushes
+    for (auto i = threadIdx.x; i < nbins; i += blockDim.x) {
+      sbins[i] = 0;
+    }
+    __syncthreads();
+    histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, col);
+    __syncthreads();
+    auto binOffset = col * nbins;
+    for (auto i = threadIdx.x; i < nbins; i += blockDim.x) {
+      auto val = sbins[i];
+      if (val > 0) { raft::myAtomicAdd<unsigned int>((unsigned int*)bins + binOffset + i, val); }
+    }
   }
 }
 
@@ -151,11 +172,73 @@ void smemHist(int* bins,
               BinnerOp binner,
               cudaStream_t stream)
 {
-  auto blks = computeGridDim<IdxT, VecLen>(
-    nrows, ncols, (const void*)smemHistKernel<DataT, BinnerOp, IdxT, VecLen, UseMatchAny>);
   size_t smemSize = nbins * sizeof(unsigned);
+  auto blks       = computeGridDim<IdxT, VecLen>(
+    nrows,
+    ncols,
+    (const void*)smemHistKernel<DataT, BinnerOp, IdxT, VecLen, UseMatchAny>,
+    smemSize);
   smemHistKernel<DataT, BinnerOp, IdxT, VecLen, UseMatchAny>
-    <<<blks, ThreadsPerBlock, smemSize, stream>>>(bins, data, nrows, nbins, binner);
+    <<<blks, ThreadsPerBlock, smemSize, stream>>>(bins, data, nrows, ncols, nbins, binner);
+}
+
+/**
+ * Every warp of the block counts in its own copy of the bins (summed when the block flushes
+ * them): the warps never contend for the same counters, which is what makes the skewed inputs
+ * (most of the values in a few bins) slow with a single copy per block.
+ */
+template <typename DataT, typename BinnerOp, typename IdxT, int VecLen>
+RAFT_KERNEL smemWarpHistKernel(
+  int* bins, const DataT* data, IdxT nrows, IdxT ncols, IdxT nbins, BinnerOp binner)
+{
+  extern __shared__ unsigned sbins[];
+  const int nwarps = blockDim.x / raft::WarpSize;
+  unsigned* wbins  = sbins + (threadIdx.x / raft::WarpSize) * nbins;
+  auto op          = [=] __device__(int binId, IdxT row, IdxT col) {
+    if (row >= nrows) return;
+    raft::myAtomicAdd<unsigned int>(wbins + binId, 1);
+  };
+  for (IdxT col = blockIdx.y; col < ncols; col += gridDim.y) {
+    for (auto i = threadIdx.x; i < nwarps * nbins; i += blockDim.x) {
+      sbins[i] = 0;
+    }
+    __syncthreads();
+    histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, col);
+    __syncthreads();
+    auto binOffset = col * nbins;
+    for (auto i = threadIdx.x; i < nbins; i += blockDim.x) {
+      unsigned val = 0;
+      for (int w = 0; w < nwarps; ++w) {
+        val += sbins[w * nbins + i];
+      }
+      if (val > 0) { raft::myAtomicAdd<unsigned int>((unsigned int*)bins + binOffset + i, val); }
+    }
+    __syncthreads();
+  }
+}
+
+template <typename IdxT>
+size_t smemWarpHistSize(IdxT nbins)
+{
+  return size_t(ThreadsPerBlock / raft::WarpSize) * nbins * sizeof(unsigned);
+}
+
+template <typename DataT, typename BinnerOp, typename IdxT, int VecLen>
+void smemWarpHist(int* bins,
+                  IdxT nbins,
+                  const DataT* data,
+                  IdxT nrows,
+                  IdxT ncols,
+                  BinnerOp binner,
+                  cudaStream_t stream)
+{
+  size_t smemSize = smemWarpHistSize(nbins);
+  RAFT_EXPECTS(smemSize <= size_t(raft::getSharedMemPerBlock()),
+               "histogram: too many bins for the warp-private shared memory histograms");
+  auto blks = computeGridDim<IdxT, VecLen>(
+    nrows, ncols, (const void*)smemWarpHistKernel<DataT, BinnerOp, IdxT, VecLen>, smemSize);
+  smemWarpHistKernel<DataT, BinnerOp, IdxT, VecLen>
+    <<<blks, ThreadsPerBlock, smemSize, stream>>>(bins, data, nrows, ncols, nbins, binner);
 }
 
 template <unsigned _BIN_BITS>
@@ -203,27 +286,29 @@ DI void incrementBin<1>(unsigned* sbins, int* bins, int nbins, int binId)
 
 template <typename DataT, typename BinnerOp, typename IdxT, int BIN_BITS, int VecLen>
 RAFT_KERNEL smemBitsHistKernel(
-  int* bins, const DataT* data, IdxT nrows, IdxT nbins, BinnerOp binner)
+  int* bins, const DataT* data, IdxT nrows, IdxT ncols, IdxT nbins, BinnerOp binner)
 {
   extern __shared__ unsigned sbins[];
   typedef BitsInfo<BIN_BITS> Bits;
   auto nwords = raft::ceildiv<int>(nbins, Bits::WORD_BINS);
-  for (auto j = threadIdx.x; j < nwords; j += blockDim.x) {
-    sbins[j] = 0;
-  }
-  __syncthreads();
-  IdxT col       = blockIdx.y;
-  IdxT binOffset = col * nbins;
-  auto op        = [=] __device__(int binId, IdxT row, IdxT col) {
+  auto op     = [=] __device__(int binId, IdxT row, IdxT col) {
     if (row >= nrows) return;
-    incrementBin<Bits::BIN_BITS>(sbins, bins + binOffset, (int)nbins, binId);
+    incrementBin<Bits::BIN_BITS>(sbins, bins + col * nbins, (int)nbins, binId);
   };
-  histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, col);
-  __syncthreads();
-  for (auto j = threadIdx.x; j < (int)nbins; j += blockDim.x) {
-    auto shift = j % Bits::WORD_BINS * Bits::BIN_BITS;
-    int count  = sbins[j / Bits::WORD_BINS] >> shift & Bits::BIN_MASK;
-    if (count > 0) raft::myAtomicAdd(bins + binOffset + j, count);
+  for (IdxT col = blockIdx.y; col < ncols; col += gridDim.y) {
+    for (auto j = threadIdx.x; j < nwords; j += blockDim.x) {
+      sbins[j] = 0;
+    }
+    __syncthreads();
+    IdxT binOffset = col * nbins;
+    histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, col);
+    __syncthreads();
+    for (auto j = threadIdx.x; j < (int)nbins; j += blockDim.x) {
+      auto shift = j % Bits::WORD_BINS * Bits::BIN_BITS;
+      int count  = sbins[j / Bits::WORD_BINS] >> shift & Bits::BIN_MASK;
+      if (count > 0) raft::myAtomicAdd(bins + binOffset + j, count);
+    }
+    __syncthreads();
   }
 }
 
@@ -237,11 +322,14 @@ void smemBitsHist(int* bins,
                   cudaStream_t stream)
 {
   typedef BitsInfo<BIN_BITS> Bits;
-  auto blks = computeGridDim<IdxT, VecLen>(
-    nrows, ncols, (const void*)smemBitsHistKernel<DataT, BinnerOp, IdxT, Bits::BIN_BITS, VecLen>);
   size_t smemSize = raft::ceildiv<size_t>(nbins, Bits::WORD_BITS / Bits::BIN_BITS) * sizeof(int);
+  auto blks       = computeGridDim<IdxT, VecLen>(
+    nrows,
+    ncols,
+    (const void*)smemBitsHistKernel<DataT, BinnerOp, IdxT, Bits::BIN_BITS, VecLen>,
+    smemSize);
   smemBitsHistKernel<DataT, BinnerOp, IdxT, Bits::BIN_BITS, VecLen>
-    <<<blks, ThreadsPerBlock, smemSize, stream>>>(bins, data, nrows, nbins, binner);
+    <<<blks, ThreadsPerBlock, smemSize, stream>>>(bins, data, nrows, ncols, nbins, binner);
 }
 
 #define INVALID_KEY -1
@@ -288,6 +376,7 @@ template <typename DataT, typename BinnerOp, typename IdxT, int VecLen>
 RAFT_KERNEL smemHashHistKernel(int* bins,
                                const DataT* data,
                                IdxT nrows,
+                               IdxT ncols,
                                IdxT nbins,
                                BinnerOp binner,
                                int hashSize,
@@ -324,10 +413,13 @@ RAFT_KERNEL smemHashHistKernel(int* bins,
       raft::myAtomicAdd(&(ht[hidx].y), 1);
     }
   };
-  IdxT col = blockIdx.y;
-  histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, col);
-  __syncthreads();
-  flushHashTable(ht, hashSize, bins, nbins, col);
+  for (IdxT col = blockIdx.y; col < ncols; col += gridDim.y) {
+    histCoreOp<DataT, BinnerOp, IdxT, VecLen>(data, nrows, nbins, binner, op, col);
+    __syncthreads();
+    // also clears the table for the next column
+    flushHashTable(ht, hashSize, bins, nbins, col);
+    __syncthreads();
+  }
 }
 
 inline int computeHashTableSize()
@@ -354,12 +446,12 @@ void smemHashHist(int* bins,
                   cudaStream_t stream)
 {
   static const int flushThreshold = 10;
+  int hashSize                    = computeHashTableSize();
+  size_t smemSize                 = hashSize * sizeof(int2) + sizeof(int);
   auto blks                       = computeGridDim<IdxT, 1>(
-    nrows, ncols, (const void*)smemHashHistKernel<DataT, BinnerOp, IdxT, 1>);
-  int hashSize    = computeHashTableSize();
-  size_t smemSize = hashSize * sizeof(int2) + sizeof(int);
+    nrows, ncols, (const void*)smemHashHistKernel<DataT, BinnerOp, IdxT, 1>, smemSize);
   smemHashHistKernel<DataT, BinnerOp, IdxT, 1><<<blks, ThreadsPerBlock, smemSize, stream>>>(
-    bins, data, nrows, nbins, binner, hashSize, flushThreshold);
+    bins, data, nrows, ncols, nbins, binner, hashSize, flushThreshold);
 }
 
 template <typename DataT, typename BinnerOp, typename IdxT, int VecLen>
@@ -385,6 +477,9 @@ void histogramVecLen(HistType type,
       smemHist<DataT, BinnerOp, IdxT, VecLen, true>(
         bins, nbins, data, nrows, ncols, binner, stream);
       break;
+    case HistTypeSmemWarp:
+      smemWarpHist<DataT, BinnerOp, IdxT, VecLen>(bins, nbins, data, nrows, ncols, binner, stream);
+      break;
     case HistTypeSmemBits16:
       smemBitsHist<DataT, BinnerOp, IdxT, 16, VecLen>(
         bins, nbins, data, nrows, ncols, binner, stream);
@@ -443,10 +538,17 @@ void histogramImpl(HistType type,
   }
 }
 
+/**
+ * The privatization level from the number of bins: a copy of the bins per warp when they are few
+ * (the inputs falling into few bins are the ones for which the contention is the highest), a
+ * copy per block when it fits the shared memory, possibly with narrower counters, and the global
+ * atomics otherwise.
+ */
 template <typename IdxT>
 HistType selectBestHistAlgo(IdxT nbins)
 {
-  size_t smem         = raft::getSharedMemPerBlock();
+  size_t smem = raft::getSharedMemPerBlock();
+  if (smemWarpHistSize(nbins) <= smem / WarpPrivateSmemFraction) { return HistTypeSmemWarp; }
   size_t requiredSize = nbins * sizeof(unsigned);
   if (requiredSize <= smem) { return HistTypeSmem; }
   for (int bits = 16; bits >= 1; bits >>= 1) {
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "meanvar.cuh"
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cublas_handle.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/detail/cublas_wrappers.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <cstdint>
+#include <limits>
+
+namespace raft::stats::detail {
+
+/*
+ * The state of the moments of n rows of D columns: the means, the sums of the squared deviations
+ * from the means M2 and, optionally, the co-moments C = sum (x - mean)(x - mean)^T [D, D]. Two
+ * states are merged by the pairwise update of Chan et al.: with delta = mean_b - mean_a,
+ *
+ *   mean = mean_a + delta n_b / n,
+ *   M2   = M2_a + M2_b + delta^2 n_a n_b / n,
+ *   C    = C_a + C_b + delta delta^T n_a n_b / n,
+ *
+ * which never subtracts two large sums (the variances are not computed as E[x^2] - E[x]^2).
+ */
+
+/** Merge the state b into the state a (in place); `c_a` or `c_b` may be nullptr. */
+template <typename T>
+void moments_merge(raft::resources const& handle,
+                   int64_t n_a,
+                   T* mean_a,
+                   T* m2_a,
+                   T* c_a,
+                   int64_t n_b,
+                   const T* mean_b,
+                   const T* m2_b,
+                   const T* c_b,
+                   int64_t D)
+{
+  if (n_b == 0) { return; }
+  double n = double(n_a) + double(n_b);
+  T w_b    = T(double(n_b) / n);
+  T w      = T(double(n_a) * double(n_b) / n);
+  // the co-moments; before the means are moved
+  if (c_a != nullptr) {
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<T, int64_t>(c_a, D * D),
+      [c_a, c_b, mean_a, mean_b, w, D] __device__(int64_t e) {
+        int64_t i = e / D;
+        int64_t j = e % D;
+        T c       = c_a[e] + w * (mean_b[i] - mean_a[i]) * (mean_b[j] - mean_a[j]);
+        return c_b != nullptr ? c + c_b[e] : c;
+      });
+  }
+  raft::linalg::map_offset(handle,
+                           raft::make_device_vector_view<T, int64_t>(m2_a, D),
+                           [m2_a, m2_b, mean_a, mean_b, w] __device__(int64_t i) {
+                             T delta = mean_b[i] - mean_a[i];
+                             return m2_a[i] + m2_b[i] + w * delta * delta;
+                           });
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(mean_a, D),
+    [mean_a, mean_b, w_b] __device__(int64_t i) {
+      return mean_a[i] + w_b * (mean_b[i] - mean_a[i]);
+    });
+}
+
+/**
+ * Add the rows of a row-major batch X [n_b, D] to the state (n, mean, m2, c). The moments of the
+ * batch are computed in a single sweep (by `meanvar`); with the co-moments, the batch is read once
+ * more, centered on its own means, for C_b = X_c^T X_c.
+ */
+template <typename T, typename IdxT>
+void moments_update(raft::resources const& handle,
+                    int64_t n,
+                    T* mean,
+                    T* m2,
+                    T* c,
+                    const T* X,
+                    IdxT n_b,
+                    IdxT D)
+{
+  if (n_b == 0) { return; }
+  auto stream = resource::get_cuda_stream(handle);
+  rmm::device_uvector<T> mean_b(D, stream);
+  rmm::device_uvector<T> m2_b(D, stream);
+  meanvar(mean_b.data(), m2_b.data(), X, D, n_b, false, true, stream);
+  // the population variances times n_b are the sums of the squared deviations
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(m2_b.data(), D),
+    [m2_b_ptr = m2_b.data(), n_b] __device__(int64_t i) { return m2_b_ptr[i] * T(n_b); });
+  moments_merge<T>(handle, n, mean, m2, c, n_b, mean_b.data(), m2_b.data(), nullptr, D);
+  if (c == nullptr) { return; }
+
+  RAFT_EXPECTS(n_b <= std::numeric_limits<int>::max() && D <= std::numeric_limits<int>::max(),
+               "The batches of the co-moments must have less than 2^31 rows");
+  rmm::device_uvector<T> centered(size_t(n_b) * D, stream);
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(centered.data(), int64_t(n_b) * D),
+    [X, mean_b_ptr = mean_b.data(), D] __device__(int64_t e) { return X[e] - mean_b_ptr[e % D]; });
+  // the row-major X_c [n_b, D] is the column-major X_c^T [D, n_b]: C += X_c^T (X_c^T)^T
+  const T one = 1;
+  RAFT_CUBLAS_TRY(raft::linalg::detail::cublasgemm(resource::get_cublas_handle(handle),
+                                                   CUBLAS_OP_N,
+                                                   CUBLAS_OP_T,
+                                                   int(D),
+                                                   int(D),
+                                                   int(n_b),
+                                                   &one,
+                                                   centered.data(),
+                                                   int(D),
+                                                   centered.data(),
+                                                   int(D),
+                                                   &one,
+                                                   c,
+                                                   int(D),
+                                                   stream));
+}
+
+/**
+ * Merge the states of all the ranks of `comms`, in place (every rank gets the global state). The
+ * counts and the weighted means are summed first; every rank then moves its M2 and C to the
+ * global means (M2 + n (mean - mu)^2, C + n (mean - mu)(mean - mu)^T) before they are summed.
+ */
+template <typename T>
+void moments_allreduce(raft::resources const& handle,
+                       const raft::comms::comms_t& comms,
+                       int64_t& n,
+                       T* mean,
+                       T* m2,
+                       T* c,
+                       int64_t D)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  auto sum    = [&](auto* buf, size_t len) {
+    comms.allreduce(buf, buf, len, raft::comms::op_t::SUM, stream);
+    RAFT_EXPECTS(comms.sync_stream(stream) == raft::comms::status_t::SUCCESS,
+                 "moments_accumulator: the allreduce of the moments failed");
+  };
+  int64_t n_local = n;
+  rmm::device_scalar<int64_t> d_n(n_local, stream);
+  sum(d_n.data(), 1);
+  n = d_n.value(stream);
+  if (n == 0) { return; }
+
+  // the global means mu = sum n_r mean_r / n
+  rmm::device_uvector<T> mu(D, stream);
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(mu.data(), D),
+    [mean, n_local] __device__(int64_t i) { return mean[i] * T(n_local); });
+  sum(mu.data(), D);
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(mu.data(), D),
+    [mu_ptr = mu.data(), n] __device__(int64_t i) { return mu_ptr[i] / T(n); });
+
+  T w = T(n_local);
+  if (c != nullptr) {
+    raft::linalg::map_offset(handle,
+                             raft::make_device_vector_view<T, int64_t>(c, D * D),
+                             [c, mean, mu_ptr = mu.data(), w, D] __device__(int64_t e) {
+                               int64_t i = e / D;
+                               int64_t j = e % D;
+                               return c[e] + w * (mean[i] - mu_ptr[i]) * (mean[j] - mu_ptr[j]);
+                             });
+    sum(c, D * D);
+  }
+  raft::linalg::map_offset(handle,
+                           raft::make_device_vector_view<T, int64_t>(m2, D),
+                           [m2, mean, mu_ptr = mu.data(), w] __device__(int64_t i) {
+                             T delta = mean[i] - mu_ptr[i];
+                             return m2[i] + w * delta * delta;
+                           });
+  sum(m2, D);
+  raft::copy(mean, mu.data(), D, stream);
+  resource::sync_stream(handle, stream);
+}
+
+}  // namespace raft::stats::detail
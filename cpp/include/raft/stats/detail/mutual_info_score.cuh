@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -35,6 +35,11 @@
 #include <rmm/device_scalar.hpp>
 #include <rmm/device_uvector.hpp>
 
+#include <thrust/execution_policy.h>
+#include <thrust/for_each.h>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/transform_reduce.h>
+
 namespace raft {
 namespace stats {
 namespace detail {
@@ -87,6 +92,74 @@ RAFT_KERNEL mutual_info_kernel(const int* dContingencyMatrix,
   if (threadIdx.x == 0 && threadIdx.y == 0) { raft::myAtomicAdd(d_MI, localMI); }
 }
 
+/**
+ * @brief Function to calculate the mutual information between two clusters from the sparse
+ * contingency matrix, in time and memory linear in the number of samples and classes (instead of
+ * the classes squared)
+ * @param firstClusterArray: the array of classes of type T
+ * @param secondClusterArray: the array of classes of type T
+ * @param size: the size of the data points of type int
+ * @param lowerLabelRange: the lower bound of the range of labels
+ * @param upperLabelRange: the upper bound of the range of labels
+ * @param stream: the cudaStream object
+ */
+template <typename T>
+double mutual_info_score_sparse(const T* firstClusterArray,
+                                const T* secondClusterArray,
+                                int size,
+                                T lowerLabelRange,
+                                T upperLabelRange,
+                                cudaStream_t stream)
+{
+  auto numUniqueClasses = size_t(upperLabelRange - lowerLabelRange) + 1;
+
+  // the non-zero entries of the contingency matrix
+  rmm::device_uvector<T> rows(size, stream);
+  rmm::device_uvector<T> cols(size, stream);
+  rmm::device_uvector<int> counts(size, stream);
+  auto nnz = raft::stats::detail::sparseContingencyMatrix<T, int>(firstClusterArray,
+                                                                  secondClusterArray,
+                                                                  size,
+                                                                  rows.data(),
+                                                                  cols.data(),
+                                                                  counts.data(),
+                                                                  stream,
+                                                                  lowerLabelRange,
+                                                                  upperLabelRange);
+
+  // the row-wise and column-wise sums
+  rmm::device_uvector<int> a(numUniqueClasses, stream);
+  rmm::device_uvector<int> b(numUniqueClasses, stream);
+  RAFT_CUDA_TRY(cudaMemsetAsync(a.data(), 0, numUniqueClasses * sizeof(int), stream));
+  RAFT_CUDA_TRY(cudaMemsetAsync(b.data(), 0, numUniqueClasses * sizeof(int), stream));
+  const T* pRows    = rows.data();
+  const T* pCols    = cols.data();
+  const int* pCount = counts.data();
+  int* pA           = a.data();
+  int* pB           = b.data();
+  auto policy       = thrust::cuda::par.on(stream);
+  thrust::for_each_n(policy, thrust::make_counting_iterator(0), nnz, [=] __device__(int i) {
+    raft::myAtomicAdd(pA + (pRows[i] - lowerLabelRange), pCount[i]);
+    raft::myAtomicAdd(pB + (pCols[i] - lowerLabelRange), pCount[i]);
+  });
+
+  // the aggregate mutual information over the non-zero entries
+  double h_MI = thrust::transform_reduce(
+    policy,
+    thrust::make_counting_iterator(0),
+    thrust::make_counting_iterator(nnz),
+    [=] __device__(int i) {
+      double n_ij = pCount[i];
+      double a_i  = pA[pRows[i] - lowerLabelRange];
+      double b_j  = pB[pCols[i] - lowerLabelRange];
+      return n_ij * (log(double(size) * n_ij) - log(a_i * b_j));
+    },
+    0.0,
+    thrust::plus<double>());
+
+  return h_MI / size;
+}
+
 /**
  * @brief Function to calculate the mutual information between two clusters
  * <a href="https://en.wikipedia.org/wiki/Mutual_information">more info on mutual information</a>
@@ -107,6 +180,13 @@ double mutual_info_score(const T* firstClusterArray,
 {
   int numUniqueClasses = upperLabelRange - lowerLabelRange + 1;
 
+  // the dense contingency matrix would be larger than the input
+  if (raft::stats::detail::useSparseContingencyMatrix(
+        size_t(upperLabelRange - lowerLabelRange) + 1, size)) {
+    return mutual_info_score_sparse(
+      firstClusterArray, secondClusterArray, size, lowerLabelRange, upperLabelRange, stream);
+  }
+
   // declaring, allocating and initializing memory for the contingency marix
   rmm::device_uvector<int> dContingencyMatrix(numUniqueClasses * numUniqueClasses, stream);
   RAFT_CUDA_TRY(cudaMemsetAsync(
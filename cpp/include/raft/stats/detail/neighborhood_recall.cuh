@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -23,7 +23,10 @@
 #include <raft/core/math.hpp>
 #include <raft/core/mdspan_types.hpp>
 #include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
+#include <raft/util/bitonic_sort.cuh>
+#include <raft/util/cudart_utils.hpp>
 
 #include <cub/cub.cuh>
 
@@ -33,6 +36,35 @@
 
 namespace raft::stats::detail {
 
+/** Whether two distances are equal within the relative tolerance eps (absolute near zero). */
+template <typename DistanceValueType>
+_RAFT_DEVICE _RAFT_FORCEINLINE bool distances_match(DistanceValueType dist,
+                                                    DistanceValueType ref_dist,
+                                                    DistanceValueType eps)
+{
+  DistanceValueType diff  = raft::abs(dist - ref_dist);
+  DistanceValueType m     = std::max(raft::abs(dist), raft::abs(ref_dist));
+  DistanceValueType ratio = diff > eps ? diff / m : diff;
+  return ratio <= eps;
+}
+
+/** The position of the first of the n sorted values not less than x. */
+template <typename T, typename IndexType>
+_RAFT_DEVICE _RAFT_FORCEINLINE IndexType sorted_lower_bound(const T* values, IndexType n, T x)
+{
+  IndexType lo = 0;
+  while (n > 0) {
+    IndexType half = n / 2;
+    if (values[lo + half] < x) {
+      lo += half + 1;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+  return lo;
+}
+
 template <typename IndicesValueType,
           typename DistanceValueType,
           typename IndexType,
@@ -45,6 +77,7 @@ RAFT_KERNEL neighborhood_recall(
   std::optional<raft::device_matrix_view<const DistanceValueType, IndexType, raft::row_major>>
     ref_distances,
   raft::device_scalar_view<ScalarType> recall_score,
+  ScalarType* per_query_recall,
   DistanceValueType const eps)
 {
   auto constexpr kThreadsPerBlock = 32;
@@ -58,17 +91,12 @@ RAFT_KERNEL neighborhood_recall(
       if (indices(row_idx, col_idx) == ref_indices(row_idx, ref_col_idx)) {
         thread_recall_score += 1;
         break;
-      } else if (distances.has_value()) {
-        auto dist               = distances.value()(row_idx, col_idx);
-        auto ref_dist           = ref_distances.value()(row_idx, ref_col_idx);
-        DistanceValueType diff  = raft::abs(dist - ref_dist);
-        DistanceValueType m     = std::max(raft::abs(dist), raft::abs(ref_dist));
-        DistanceValueType ratio = diff > eps ? diff / m : diff;
-
-        if (ratio <= eps) {
-          thread_recall_score += 1;
-          break;
-        }
+      } else if (distances.has_value() &&
+                 distances_match(distances.value()(row_idx, col_idx),
+                                 ref_distances.value()(row_idx, ref_col_idx),
+                                 eps)) {
+        thread_recall_score += 1;
+        break;
       }
     }
   }
@@ -86,9 +114,142 @@ RAFT_KERNEL neighborhood_recall(
       *recall_score.data_handle()};
     std::size_t const total_count = indices.extent(0) * indices.extent(1);
     device_recall_score.fetch_add(row_recall_score / total_count);
+    if (per_query_recall != nullptr) {
+      per_query_recall[row_idx] = row_recall_score / ScalarType(indices.extent(1));
+    }
   }
 }
 
+/**
+ * The same score in O(k log k) per row: the warp sorts the reference indices (and distances) of
+ * its row in registers (a bitonic sort of Capacity elements, Capacity / 32 per lane), stores them
+ * in shared memory, and every candidate is then looked up by a binary search. A candidate
+ * distance is only compared to the nearest reference distances below and above it, which are
+ * the closest in the relative sense as well (the distances of opposite signs never match within
+ * eps < 1, unless they are within eps of each other).
+ */
+template <int Capacity,
+          typename IndicesValueType,
+          typename DistanceValueType,
+          typename IndexType,
+          typename ScalarType>
+RAFT_KERNEL neighborhood_recall_sorted(
+  raft::device_matrix_view<const IndicesValueType, IndexType, raft::row_major> indices,
+  raft::device_matrix_view<const IndicesValueType, IndexType, raft::row_major> ref_indices,
+  std::optional<raft::device_matrix_view<const DistanceValueType, IndexType, raft::row_major>>
+    distances,
+  std::optional<raft::device_matrix_view<const DistanceValueType, IndexType, raft::row_major>>
+    ref_distances,
+  raft::device_scalar_view<ScalarType> recall_score,
+  ScalarType* per_query_recall,
+  DistanceValueType const eps)
+{
+  auto constexpr kThreadsPerBlock = 32;
+  auto constexpr kPerLane         = Capacity / kThreadsPerBlock;
+  __shared__ IndicesValueType sorted_indices[Capacity];
+  __shared__ DistanceValueType sorted_distances[Capacity];
+
+  IndexType const row_idx = blockIdx.x;
+  auto const lane_idx     = threadIdx.x % kThreadsPerBlock;
+  IndexType const k_ref   = ref_indices.extent(1);
+
+  IndicesValueType ind[kPerLane];
+#pragma unroll
+  for (int i = 0; i < kPerLane; i++) {
+    IndexType col = i * kThreadsPerBlock + lane_idx;
+    ind[i] = col < k_ref ? ref_indices(row_idx, col) : raft::upper_bound<IndicesValueType>();
+  }
+  raft::util::bitonic<kPerLane>(true).sort(ind);
+#pragma unroll
+  for (int i = 0; i < kPerLane; i++) {
+    sorted_indices[i * kThreadsPerBlock + lane_idx] = ind[i];
+  }
+  if (distances.has_value()) {
+    DistanceValueType dist[kPerLane];
+#pragma unroll
+    for (int i = 0; i < kPerLane; i++) {
+      IndexType col = i * kThreadsPerBlock + lane_idx;
+      dist[i] =
+        col < k_ref ? ref_distances.value()(row_idx, col) : raft::upper_bound<DistanceValueType>();
+    }
+    raft::util::bitonic<kPerLane>(true).sort(dist);
+#pragma unroll
+    for (int i = 0; i < kPerLane; i++) {
+      sorted_distances[i * kThreadsPerBlock + lane_idx] = dist[i];
+    }
+  }
+  __syncwarp();
+
+  IndexType thread_recall_score = 0;
+  for (IndexType col_idx = lane_idx; col_idx < indices.extent(1); col_idx += kThreadsPerBlock) {
+    auto id  = indices(row_idx, col_idx);
+    auto pos = sorted_lower_bound(sorted_indices, k_ref, id);
+    if (pos < k_ref && sorted_indices[pos] == id) {
+      thread_recall_score += 1;
+    } else if (distances.has_value()) {
+      auto dist = distances.value()(row_idx, col_idx);
+      pos       = sorted_lower_bound(sorted_distances, k_ref, dist);
+      if ((pos < k_ref && distances_match(dist, sorted_distances[pos], eps)) ||
+          (pos > 0 && distances_match(dist, sorted_distances[pos - 1], eps))) {
+        thread_recall_score += 1;
+      }
+    }
+  }
+
+  typedef cub::BlockReduce<IndexType, kThreadsPerBlock> BlockReduce;
+
+  __shared__ typename BlockReduce::TempStorage temp_storage;
+
+  ScalarType row_recall_score = BlockReduce(temp_storage).Sum(thread_recall_score);
+
+  if (lane_idx == 0) {
+    cuda::atomic_ref<ScalarType, cuda::thread_scope_device> device_recall_score{
+      *recall_score.data_handle()};
+    std::size_t const total_count = indices.extent(0) * indices.extent(1);
+    device_recall_score.fetch_add(row_recall_score / total_count);
+    if (per_query_recall != nullptr) {
+      per_query_recall[row_idx] = row_recall_score / ScalarType(indices.extent(1));
+    }
+  }
+}
+
+/** The largest number of reference neighbors per row sorted by `neighborhood_recall_sorted`. */
+constexpr int kRecallMaxSortedCapacity = 2048;
+
+/** Launch `neighborhood_recall_sorted` with the smallest capacity of the reference neighbors. */
+template <int Capacity,
+          typename IndicesValueType,
+          typename DistanceValueType,
+          typename IndexType,
+          typename ScalarType>
+void launch_recall_sorted(
+  cudaStream_t stream,
+  raft::device_matrix_view<const IndicesValueType, IndexType, raft::row_major> indices,
+  raft::device_matrix_view<const IndicesValueType, IndexType, raft::row_major> ref_indices,
+  std::optional<raft::device_matrix_view<const DistanceValueType, IndexType, raft::row_major>>
+    distances,
+  std::optional<raft::device_matrix_view<const DistanceValueType, IndexType, raft::row_major>>
+    ref_distances,
+  raft::device_scalar_view<ScalarType> recall_score,
+  ScalarType* per_query_recall,
+  DistanceValueType const eps)
+{
+  if constexpr (Capacity < kRecallMaxSortedCapacity) {
+    if (ref_indices.extent(1) > Capacity) {
+      return launch_recall_sorted<Capacity * 2>(stream,
+                                                indices,
+                                                ref_indices,
+                                                distances,
+                                                ref_distances,
+                                                recall_score,
+                                                per_query_recall,
+                                                eps);
+    }
+  }
+  neighborhood_recall_sorted<Capacity><<<indices.extent(0), 32, 0, stream>>>(
+    indices, ref_indices, distances, ref_distances, recall_score, per_query_recall, eps);
+}
+
 template <typename IndicesValueType,
           typename DistanceValueType,
           typename IndexType,
@@ -102,14 +263,24 @@ void neighborhood_recall(
   std::optional<raft::device_matrix_view<const DistanceValueType, IndexType, raft::row_major>>
     ref_distances,
   raft::device_scalar_view<ScalarType> recall_score,
+  ScalarType* per_query_recall,
   DistanceValueType const eps)
 {
   // One warp per row, launch a warp-width block per-row kernel
   auto constexpr kThreadsPerBlock = 32;
   auto const num_blocks           = indices.extent(0);
+  auto stream                     = resource::get_cuda_stream(res);
+  if (num_blocks == 0) { return; }
 
-  neighborhood_recall<<<num_blocks, kThreadsPerBlock>>>(
-    indices, ref_indices, distances, ref_distances, recall_score, eps);
+  if (ref_indices.extent(1) <= kRecallMaxSortedCapacity) {
+    launch_recall_sorted<32>(
+      stream, indices, ref_indices, distances, ref_distances, recall_score, per_query_recall, eps);
+  } else {
+    // too many reference neighbors to sort within a warp: compare all the pairs
+    neighborhood_recall<<<num_blocks, kThreadsPerBlock, 0, stream>>>(
+      indices, ref_indices, distances, ref_distances, recall_score, per_query_recall, eps);
+  }
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
 }
 
 }  // end namespace raft::stats::detail
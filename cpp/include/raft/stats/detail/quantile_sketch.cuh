@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/comms.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/util/cuda_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <cub/cub.cuh>
+
+#include <cstdint>
+#include <limits>
+
+namespace raft::stats::detail {
+
+/*
+ * A merging t-digest per column: at most `capacity` centroids (a mean and a weight), in the
+ * order of their means. The column and its new values (or the centroids of other digests) are
+ * sorted together, and the items are grouped by the slot
+ *
+ *   floor(capacity * (asin(2 q - 1) / pi + 1 / 2)),
+ *
+ * q the fraction of the weight before the middle of the item: the `k1` scale of t-digest makes
+ * the slots small at the tails (the first one holds a fraction (pi / (2 capacity))^2 of the
+ * weight) and large in the middle, so the error on the extreme percentiles stays small.
+ * The weights are kept in double precision: they are counts, up to billions of values.
+ */
+
+constexpr int kSketchTpb = 256;
+/** The shared memory of the slots (a weight and a weighted sum per slot) bounds the capacity. */
+constexpr int kSketchMaxCapacity = 2048;
+
+/** The slot of an item of the t-digest, from the fraction q of the weight before it. */
+DI int sketch_slot(double q, int capacity)
+{
+  constexpr double kPi = 3.14159265358979323846;
+  q                    = raft::min(raft::max(q, 0.0), 1.0);
+  double k             = asin(2.0 * q - 1.0) / kPi + 0.5;
+  return raft::min(int(k * capacity), capacity - 1);
+}
+
+/**
+ * Compress the sorted segments (one block per column) of `seg_len` items into `capacity`
+ * centroids; the items of zero weight are ignored. The extrema of the columns are updated.
+ */
+template <typename T, int BlockSize>
+RAFT_KERNEL sketch_compress_kernel(const T* keys,
+                                   const double* weights,
+                                   int seg_len,
+                                   int capacity,
+                                   double total,
+                                   T* means,
+                                   double* out_weights,
+                                   T* col_min,
+                                   T* col_max)
+{
+  using BlockScan   = cub::BlockScan<double, BlockSize>;
+  using BlockReduce = cub::BlockReduce<T, BlockSize>;
+  __shared__ typename BlockScan::TempStorage scan_tmp;
+  __shared__ typename BlockReduce::TempStorage reduce_tmp;
+  extern __shared__ double sketch_slots[];
+  double* sum_w  = sketch_slots;
+  double* sum_wx = sketch_slots + capacity;
+  for (int i = threadIdx.x; i < capacity; i += BlockSize) {
+    sum_w[i]  = 0;
+    sum_wx[i] = 0;
+  }
+  __syncthreads();
+  keys += size_t(blockIdx.x) * seg_len;
+  weights += size_t(blockIdx.x) * seg_len;
+  double offset = 0;
+  T lo          = raft::upper_bound<T>();
+  T hi          = raft::lower_bound<T>();
+  for (int i0 = 0; i0 < seg_len; i0 += BlockSize) {
+    int i    = i0 + threadIdx.x;
+    double w = i < seg_len ? weights[i] : 0.0;
+    double before, tile_total;
+    BlockScan(scan_tmp).ExclusiveSum(w, before, tile_total);
+    __syncthreads();
+    if (w > 0) {
+      T x     = keys[i];
+      int pos = sketch_slot((offset + before + 0.5 * w) / total, capacity);
+      raft::myAtomicAdd(sum_w + pos, w);
+      raft::myAtomicAdd(sum_wx + pos, w * double(x));
+      lo = raft::min(lo, x);
+      hi = raft::max(hi, x);
+    }
+    offset += tile_total;
+  }
+  lo = BlockReduce(reduce_tmp).Reduce(lo, raft::min_op{});
+  __syncthreads();
+  hi = BlockReduce(reduce_tmp).Reduce(hi, raft::max_op{});
+  __syncthreads();
+  if (threadIdx.x == 0) {
+    col_min[blockIdx.x] = raft::min(col_min[blockIdx.x], lo);
+    col_max[blockIdx.x] = raft::max(col_max[blockIdx.x], hi);
+  }
+  means += size_t(blockIdx.x) * capacity;
+  out_weights += size_t(blockIdx.x) * capacity;
+  for (int i = threadIdx.x; i < capacity; i += BlockSize) {
+    double w       = sum_w[i];
+    means[i]       = w > 0 ? T(sum_wx[i] / w) : raft::upper_bound<T>();
+    out_weights[i] = w;
+  }
+}
+
+/**
+ * Sort every segment of the items [n_cols, seg_len] (the centroids of the column and the items
+ * to add to it, in any order) by their keys, and replace the centroids of the columns by their
+ * compression. `total` is the weight of a column after the update.
+ */
+template <typename T>
+void sketch_compress(raft::resources const& handle,
+                     rmm::device_uvector<T>& keys,
+                     rmm::device_uvector<double>& weights,
+                     int64_t n_cols,
+                     int64_t seg_len,
+                     int capacity,
+                     double total,
+                     T* means,
+                     double* out_weights,
+                     T* col_min,
+                     T* col_max)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  RAFT_EXPECTS(n_cols * seg_len <= std::numeric_limits<int>::max(),
+               "quantile_sketch: too many values in a single update, use smaller batches");
+  int n_items = int(n_cols * seg_len);
+  rmm::device_uvector<int> offsets(n_cols + 1, stream);
+  raft::linalg::map_offset(handle,
+                           raft::make_device_vector_view<int, int64_t>(offsets.data(), n_cols + 1),
+                           [seg_len] __device__(int64_t c) { return int(c * seg_len); });
+  rmm::device_uvector<T> sorted_keys(n_items, stream);
+  rmm::device_uvector<double> sorted_weights(n_items, stream);
+  size_t ws_size = 0;
+  RAFT_CUDA_TRY(cub::DeviceSegmentedRadixSort::SortPairs(nullptr,
+                                                         ws_size,
+                                                         keys.data(),
+                                                         sorted_keys.data(),
+                                                         weights.data(),
+                                                         sorted_weights.data(),
+                                                         n_items,
+                                                         int(n_cols),
+                                                         offsets.data(),
+                                                         offsets.data() + 1,
+                                                         0,
+                                                         sizeof(T) * 8,
+                                                         stream));
+  rmm::device_uvector<char> ws(ws_size, stream);
+  RAFT_CUDA_TRY(cub::DeviceSegmentedRadixSort::SortPairs(ws.data(),
+                                                         ws_size,
+                                                         keys.data(),
+                                                         sorted_keys.data(),
+                                                         weights.data(),
+                                                         sorted_weights.data(),
+                                                         n_items,
+                                                         int(n_cols),
+                                                         offsets.data(),
+                                                         offsets.data() + 1,
+                                                         0,
+                                                         sizeof(T) * 8,
+                                                         stream));
+  size_t smem = 2 * size_t(capacity) * sizeof(double);
+  sketch_compress_kernel<T, kSketchTpb><<<n_cols, kSketchTpb, smem, stream>>>(sorted_keys.data(),
+                                                                             sorted_weights.data(),
+                                                                             int(seg_len),
+                                                                             capacity,
+                                                                             total,
+                                                                             means,
+                                                                             out_weights,
+                                                                             col_min,
+                                                                             col_max);
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+}
+
+/** Add the rows of a row-major batch X [n_rows, n_cols], of weight 1 each, to the digests. */
+template <typename T>
+void sketch_update(raft::resources const& handle,
+                   const T* X,
+                   int64_t n_rows,
+                   int64_t n_cols,
+                   int capacity,
+                   double total,
+                   T* means,
+                   double* weights,
+                   T* col_min,
+                   T* col_max)
+{
+  if (n_rows == 0) { return; }
+  auto stream     = resource::get_cuda_stream(handle);
+  int64_t seg_len = capacity + n_rows;
+  rmm::device_uvector<T> keys(n_cols * seg_len, stream);
+  rmm::device_uvector<double> item_weights(n_cols * seg_len, stream);
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(keys.data(), n_cols * seg_len),
+    [X, means, n_cols, seg_len, capacity] __device__(int64_t e) {
+      int64_t c = e / seg_len;
+      int64_t i = e % seg_len;
+      return i < capacity ? means[c * capacity + i] : X[(i - capacity) * n_cols + c];
+    });
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<double, int64_t>(item_weights.data(), n_cols * seg_len),
+    [weights, seg_len, capacity] __device__(int64_t e) {
+      int64_t c = e / seg_len;
+      int64_t i = e % seg_len;
+      return i < capacity ? weights[c * capacity + i] : 1.0;
+    });
+  sketch_compress(
+    handle, keys, item_weights, n_cols, seg_len, capacity, total, means, weights, col_min, col_max);
+}
+
+/** The segment of a column is made of its centroids in every sketch. */
+DI int64_t sketch_merge_source(int64_t e, int64_t n_cols, int64_t seg_len, int capacity)
+{
+  int64_t c = e / seg_len;
+  int64_t s = (e % seg_len) / capacity;
+  return (s * n_cols + c) * capacity + e % capacity;
+}
+
+/**
+ * Merge `n_sketches` sets of digests, stored one after the other ([n_sketches, n_cols,
+ * capacity]), into the digests (means, weights).
+ */
+template <typename T>
+void sketch_merge(raft::resources const& handle,
+                  const T* other_means,
+                  const double* other_weights,
+                  int64_t n_sketches,
+                  int64_t n_cols,
+                  int capacity,
+                  double total,
+                  T* means,
+                  double* weights,
+                  T* col_min,
+                  T* col_max)
+{
+  auto stream     = resource::get_cuda_stream(handle);
+  int64_t seg_len = n_sketches * capacity;
+  rmm::device_uvector<T> keys(n_cols * seg_len, stream);
+  rmm::device_uvector<double> item_weights(n_cols * seg_len, stream);
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(keys.data(), n_cols * seg_len),
+    [other_means, n_cols, seg_len, capacity] __device__(int64_t e) {
+      return other_means[sketch_merge_source(e, n_cols, seg_len, capacity)];
+    });
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<double, int64_t>(item_weights.data(), n_cols * seg_len),
+    [other_weights, n_cols, seg_len, capacity] __device__(int64_t e) {
+      return other_weights[sketch_merge_source(e, n_cols, seg_len, capacity)];
+    });
+  sketch_compress(
+    handle, keys, item_weights, n_cols, seg_len, capacity, total, means, weights, col_min, col_max);
+}
+
+/**
+ * Gather the digests of all the ranks of `comms`, and replace the local ones by their merge:
+ * every rank gets the same digests. `count` is replaced by the sum of the counts of the ranks.
+ */
+template <typename T>
+void sketch_allreduce(raft::resources const& handle,
+                      const raft::comms::comms_t& comms,
+                      int64_t& count,
+                      int64_t n_cols,
+                      int capacity,
+                      T* means,
+                      double* weights,
+                      T* col_min,
+                      T* col_max)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  auto check  = [&]() {
+    RAFT_EXPECTS(comms.sync_stream(stream) == raft::comms::status_t::SUCCESS,
+                 "quantile_sketch: the collective operation failed");
+  };
+  int64_t n_ranks = comms.get_size();
+  size_t len      = n_cols * capacity;
+  rmm::device_uvector<T> all_means(n_ranks * len, stream);
+  rmm::device_uvector<double> all_weights(n_ranks * len, stream);
+  rmm::device_scalar<int64_t> d_count(count, stream);
+  comms.allgather(means, all_means.data(), len, stream);
+  comms.allgather(weights, all_weights.data(), len, stream);
+  comms.allreduce(d_count.data(), d_count.data(), 1, raft::comms::op_t::SUM, stream);
+  comms.allreduce(col_min, col_min, n_cols, raft::comms::op_t::MIN, stream);
+  comms.allreduce(col_max, col_max, n_cols, raft::comms::op_t::MAX, stream);
+  check();
+  count = d_count.value(stream);
+  if (count == 0) { return; }
+  sketch_merge(handle,
+               all_means.data(),
+               all_weights.data(),
+               n_ranks,
+               n_cols,
+               capacity,
+               double(count),
+               means,
+               weights,
+               col_min,
+               col_max);
+  resource::sync_stream(handle, stream);
+}
+
+/**
+ * The quantile q of a digest: the means of the centroids sit at the middle of their weight, the
+ * extrema at the ends, and the quantile function is linear between them.
+ */
+template <typename T>
+DI T sketch_quantile(
+  const T* means, const double* weights, int capacity, double total, T lo, T hi, double q)
+{
+  if (q <= 0) { return lo; }
+  if (q >= 1) { return hi; }
+  double target   = q * total;
+  double cum      = 0;
+  double prev_pos = 0;
+  double prev_val = lo;
+  auto interp     = [&](double pos, double val) {
+    return pos > prev_pos ? prev_val + (target - prev_pos) / (pos - prev_pos) * (val - prev_val)
+                              : val;
+  };
+  for (int i = 0; i < capacity; i++) {
+    double w = weights[i];
+    if (w <= 0) { continue; }
+    double pos = cum + 0.5 * w;
+    if (target < pos) { return T(interp(pos, means[i])); }
+    prev_pos = pos;
+    prev_val = means[i];
+    cum += w;
+  }
+  return T(interp(total, hi));
+}
+
+/** The quantiles probs [n_probs] of every column, out: row-major [n_probs, n_cols]. */
+template <typename T, typename IdxT>
+void sketch_quantiles(raft::resources const& handle,
+                      const T* means,
+                      const double* weights,
+                      const T* col_min,
+                      const T* col_max,
+                      int64_t n_cols,
+                      int capacity,
+                      double total,
+                      const T* probs,
+                      IdxT n_probs,
+                      T* out)
+{
+  raft::linalg::map_offset(
+    handle,
+    raft::make_device_vector_view<T, int64_t>(out, int64_t(n_probs) * n_cols),
+    [=] __device__(int64_t e) {
+      int64_t p = e / n_cols;
+      int64_t c = e % n_cols;
+      return sketch_quantile(means + c * capacity,
+                             weights + c * capacity,
+                             capacity,
+                             total,
+                             col_min[c],
+                             col_max[c],
+                             double(probs[p]));
+    });
+}
+
+}  // namespace raft::stats::detail
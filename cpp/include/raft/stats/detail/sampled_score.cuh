@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "meanvar.cuh"
+
+#include <raft/core/error.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/random/rng_state.hpp>
+#include <raft/random/sample_without_replacement.cuh>
+#include <raft/stats/stats_types.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+namespace raft::stats::detail {
+
+/** The default bound of the temporary memory of the tiled scores. */
+constexpr size_t kScoreWorkspaceBytes = size_t(256) << 20;
+
+/** The z such that P(|N(0, 1)| <= z) = confidence, by bisection. */
+inline double normal_two_sided_quantile(double confidence)
+{
+  RAFT_EXPECTS(confidence > 0 && confidence < 1, "confidence must be in (0, 1)");
+  double lo = 0;
+  double hi = 40;
+  for (int i = 0; i < 100; i++) {
+    double mid = 0.5 * (lo + hi);
+    (std::erf(mid / std::sqrt(2.0)) < confidence ? lo : hi) = mid;
+  }
+  return 0.5 * (lo + hi);
+}
+
+/**
+ * The indices of the points a score is evaluated on: n_samples of them drawn uniformly without
+ * replacement (in increasing order) or, when n_samples >= n, all the points.
+ */
+template <typename IdxT>
+auto sample_score_rows(raft::resources const& handle, IdxT n, IdxT n_samples, uint64_t seed)
+  -> rmm::device_uvector<IdxT>
+{
+  auto stream = resource::get_cuda_stream(handle);
+  RAFT_EXPECTS(n_samples > 0, "n_samples must be positive");
+  if (n_samples >= n) {
+    std::vector<IdxT> h_rows(n);
+    std::iota(h_rows.begin(), h_rows.end(), IdxT(0));
+    rmm::device_uvector<IdxT> rows(n, stream);
+    raft::update_device(rows.data(), h_rows.data(), n, stream);
+    resource::sync_stream(handle, stream);
+    return rows;
+  }
+  rmm::device_uvector<IdxT> rows(n_samples, stream);
+  raft::random::RngState rng(seed);
+  raft::random::sample_indices_without_replacement(
+    handle, rng, raft::make_device_vector_view<IdxT, IdxT>(rows.data(), n_samples), n);
+  return rows;
+}
+
+/**
+ * The mean of the per-point scores of a uniform sample of n_samples out of n points, and its
+ * confidence interval.
+ */
+template <typename T>
+auto estimate_mean_score(raft::resources const& handle,
+                         const T* scores,
+                         int64_t n_samples,
+                         int64_t n,
+                         double confidence) -> score_estimate<T>
+{
+  auto stream = resource::get_cuda_stream(handle);
+  rmm::device_uvector<T> d_stats(2, stream);
+  meanvar(d_stats.data(), d_stats.data() + 1, scores, int64_t(1), n_samples, true, true, stream);
+  T h_stats[2];
+  raft::update_host(h_stats, d_stats.data(), 2, stream);
+  resource::sync_stream(handle, stream);
+  double mean = h_stats[0];
+  double se   = 0;
+  if (n_samples < n && n_samples > 1) {
+    double fpc = 1.0 - double(n_samples) / double(n);
+    se         = std::sqrt(double(h_stats[1]) / double(n_samples) * fpc);
+  }
+  double half = se > 0 ? normal_two_sided_quantile(confidence) * se : 0.0;
+  return score_estimate<T>{T(mean), T(se), T(mean - half), T(mean + half)};
+}
+
+}  // namespace raft::stats::detail
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -14,12 +14,19 @@
  * limitations under the License.
  */
 
+#include "sampled_score.cuh"
+
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
 #include <raft/distance/distance.cuh>
-#include <raft/matrix/col_wise_sort.cuh>
+#include <raft/linalg/map.cuh>
 #include <raft/spatial/knn/knn.cuh>
-#include <rmm/device_scalar.hpp>
+#include <raft/util/device_atomics.cuh>
 #include <rmm/device_uvector.hpp>
+#include <thrust/reduce.h>
+
+#include <algorithm>
+#include <cstdint>
 
 #define N_THREADS 512
 
@@ -28,61 +35,51 @@ namespace stats {
 namespace detail {
 
 /**
- * @brief Build the lookup table
- * @param[out] lookup_table: Lookup table giving nearest neighbor order
- *                of pairwise distance calculations given sample index
- * @param[in] X_ind: Sorted indexes of pairwise distance calculations of X
- * @param n: Number of samples
- * @param work: Number of elements to consider
- */
-RAFT_KERNEL build_lookup_table(int* lookup_table, const int* X_ind, int n, int work)
-{
-  int i = blockIdx.x * blockDim.x + threadIdx.x;
-  if (i >= work) return;
-
-  int sample_idx = i / n;
-  int nn_idx     = i % n;
-
-  int idx                              = X_ind[i];
-  lookup_table[(sample_idx * n) + idx] = nn_idx;
-}
-
-/**
- * @brief Compute a the rank of trustworthiness score
- * @param[out] rank: Resulting rank
- * @param[out] lookup_table: Lookup table giving nearest neighbor order
- *                of pairwise distance calculations given sample index
- * @param[in] emb_ind: Indexes of KNN on embeddings
- * @param n: Number of samples
- * @param n_neighbors: Number of neighbors considered by trustworthiness score
- * @param work: Batch to consider (to do it at once use n * n_neighbors)
+ * @brief Count, for every pair (sample i, embedded neighbor t) of a batch, the samples of a tile
+ * of X which are closer to i in the original space than the t-th neighbor: the rank of that
+ * neighbor among the neighbors of i in the original space
+ * @param[inout] counts: The ranks [batch_rows, n_targets], accumulated over the tiles
+ * @param[in] distances: The distances of the samples of the batch to the tile [batch_rows, cols]
+ * @param[in] targets: The distances of the samples of the batch to their embedded neighbors
+ *                     [batch_rows, n_targets]
+ * @param[in] target_ind: The indexes of the embedded neighbors [batch_rows, n_targets]
+ * @param col_offset: The index of the first sample of the tile
+ * @param batch_rows: Number of samples of the batch
+ * @param cols: Number of samples of the tile
+ * @param n_targets: Number of embedded neighbors per sample
  */
-template <typename knn_index_t>
-RAFT_KERNEL compute_rank(double* rank,
-                         const int* lookup_table,
-                         const knn_index_t* emb_ind,
-                         int n,
-                         int n_neighbors,
-                         int work)
+template <typename math_t, typename knn_index_t>
+RAFT_KERNEL count_closer_kernel(int* counts,
+                                const math_t* distances,
+                                const math_t* targets,
+                                const knn_index_t* target_ind,
+                                int col_offset,
+                                int batch_rows,
+                                int cols,
+                                int n_targets)
 {
-  int i = blockIdx.x * blockDim.x + threadIdx.x;
-  if (i >= work) return;
+  int64_t i = blockIdx.x * int64_t(blockDim.x) + threadIdx.x;
+  if (i >= int64_t(batch_rows) * cols) return;
 
-  int sample_idx = i / n_neighbors;
-
-  knn_index_t emb_nn_ind = emb_ind[i];
-
-  int r   = lookup_table[(sample_idx * n) + emb_nn_ind];
-  int tmp = r - n_neighbors + 1;
-  if (tmp > 0) raft::myAtomicAdd<double>(rank, tmp);
+  int row  = i / cols;
+  int col  = i % cols;
+  auto dij = distances[i];
+  for (int t = 0; t < n_targets; t++) {
+    int64_t target = int64_t(row) * n_targets + t;
+    if (dij < targets[target] && target_ind[target] != knn_index_t(col_offset + col)) {
+      atomicAdd(&counts[target], 1);
+    }
+  }
 }
 
 /**
- * @brief Compute a kNN and returns the indices of the nearest neighbors
+ * @brief Compute a kNN of queries and returns the indices of the nearest neighbors
  * @param h Raft handle
  * @param[in] input Input matrix containing the dataset
  * @param n Number of samples
  * @param d Number of features
+ * @param[in] queries Input matrix containing the queries
+ * @param n_queries Number of queries
  * @param n_neighbors number of neighbors
  * @param[out] indices KNN indexes
  * @param[out] distances KNN distances
@@ -92,6 +89,8 @@ void run_knn(const raft::resources& h,
              math_t* input,
              int n,
              int d,
+             math_t* queries,
+             int n_queries,
              int n_neighbors,
              int64_t* indices,
              math_t* distances)
@@ -105,8 +104,8 @@ void run_knn(const raft::resources& h,
                                                            ptrs,
                                                            sizes,
                                                            d,
-                                                           input,
-                                                           n,
+                                                           queries,
+                                                           n_queries,
                                                            indices,
                                                            distances,
                                                            n_neighbors,
@@ -116,6 +115,168 @@ void run_knn(const raft::resources& h,
                                                            distance_type);
 }
 
+/**
+ * @brief Compute a kNN and returns the indices of the nearest neighbors
+ * @param h Raft handle
+ * @param[in] input Input matrix containing the dataset
+ * @param n Number of samples
+ * @param d Number of features
+ * @param n_neighbors number of neighbors
+ * @param[out] indices KNN indexes
+ * @param[out] distances KNN distances
+ */
+template <raft::distance::DistanceType distance_type, typename math_t>
+void run_knn(const raft::resources& h,
+             math_t* input,
+             int n,
+             int d,
+             int n_neighbors,
+             int64_t* indices,
+             math_t* distances)
+{
+  run_knn<distance_type>(h, input, n, d, input, n, n_neighbors, indices, distances);
+}
+
+/**
+ * @brief Compute the trustworthiness penalties of the samples `row_ids`: for every sample, the sum
+ * over its n_neighbors nearest neighbors in the embedding (and itself) of the excess of their rank
+ * among the neighbors in the original space over n_neighbors.
+ *
+ * The ranks are counted, not sorted: the distances of a batch of samples to all the samples are
+ * computed tile by tile, and every tile only adds the number of its samples closer than each of
+ * the embedded neighbors. The temporary memory (beyond the n_sel * (n_neighbors + 1) embedded
+ * neighbors) is bounded by `max_workspace_bytes`, the batches being shrunk when needed.
+ *
+ * @param h Raft handle
+ * @param X[in]: Data in original dimension
+ * @param X_embedded[in]: Data in target dimension (embedding)
+ * @param n: Number of samples
+ * @param m: Number of features in high/original dimension
+ * @param d: Number of features in low/embedded dimension
+ * @param n_neighbors Number of neighbors considered by trustworthiness score
+ * @param[in] row_ids: The samples of which to compute the penalties [n_sel]
+ * @param n_sel: Number of such samples
+ * @param[out] penalties: The penalties [n_sel]
+ * @param batchSize Largest number of samples per batch
+ * @param max_workspace_bytes The bound of the temporary memory
+ */
+template <typename math_t, raft::distance::DistanceType distance_type>
+void trustworthiness_penalties(const raft::resources& h,
+                               const math_t* X,
+                               math_t* X_embedded,
+                               int n,
+                               int m,
+                               int d,
+                               int n_neighbors,
+                               const int* row_ids,
+                               int n_sel,
+                               double* penalties,
+                               int batchSize,
+                               size_t max_workspace_bytes)
+{
+  cudaStream_t stream = resource::get_cuda_stream(h);
+  const int n_targets = n_neighbors + 1;
+
+  // the embedded neighbors of the samples (the samples themselves included)
+  rmm::device_uvector<math_t> queries(int64_t(n_sel) * d, stream);
+  raft::linalg::map_offset(
+    h,
+    raft::make_device_vector_view<math_t, int64_t>(queries.data(), int64_t(n_sel) * d),
+    [X_embedded, row_ids, d] __device__(int64_t e) {
+      return X_embedded[int64_t(row_ids[e / d]) * d + e % d];
+    });
+  rmm::device_uvector<int64_t> emb_ind(int64_t(n_sel) * n_targets, stream);
+  rmm::device_uvector<math_t> emb_dist(int64_t(n_sel) * n_targets, stream);
+  run_knn<distance_type>(
+    h, X_embedded, n, d, queries.data(), n_sel, n_targets, emb_ind.data(), emb_dist.data());
+  queries.resize(0, stream);
+  queries.shrink_to_fit(stream);
+  emb_dist.resize(0, stream);
+  emb_dist.shrink_to_fit(stream);
+
+  // a batch of b samples: the samples, their neighbors, the distances between the two, and the
+  // ranks; at most half of the budget, the rest for the tiles of distances [b, cc]
+  auto fixed_bytes = [&](int64_t b) {
+    return size_t(b) * (sizeof(math_t) * (m + int64_t(n_targets) * (m + b + 1)) +
+                        sizeof(int) * n_targets);
+  };
+  int64_t b = std::max(1, std::min(batchSize, n_sel));
+  while (b > 1 && fixed_bytes(b) > max_workspace_bytes / 2) {
+    b = (b + 1) / 2;
+  }
+  size_t rest = max_workspace_bytes > fixed_bytes(b) ? max_workspace_bytes - fixed_bytes(b) : 0;
+  int cc      = int(std::max<int64_t>(1, std::min<int64_t>(n, rest / (sizeof(math_t) * b))));
+
+  rmm::device_uvector<math_t> X_batch(b * m, stream);
+  rmm::device_uvector<math_t> X_targets(b * n_targets * m, stream);
+  rmm::device_uvector<math_t> target_dist(b * b * n_targets, stream);
+  rmm::device_uvector<math_t> targets(b * n_targets, stream);
+  rmm::device_uvector<int> counts(b * n_targets, stream);
+  rmm::device_uvector<math_t> X_dist(b * cc, stream);
+
+  for (int start = 0; start < n_sel; start += b) {
+    int cur              = int(std::min<int64_t>(b, n_sel - start));
+    const int* ids       = row_ids + start;
+    const int64_t* t_ind = emb_ind.data() + int64_t(start) * n_targets;
+
+    raft::linalg::map_offset(
+      h,
+      raft::make_device_vector_view<math_t, int64_t>(X_batch.data(), int64_t(cur) * m),
+      [X, ids, m] __device__(int64_t e) { return X[int64_t(ids[e / m]) * m + e % m]; });
+    raft::linalg::map_offset(
+      h,
+      raft::make_device_vector_view<math_t, int64_t>(X_targets.data(),
+                                                     int64_t(cur) * n_targets * m),
+      [X, t_ind, m] __device__(int64_t e) { return X[t_ind[e / m] * m + e % m]; });
+
+    // the distances in the original space of every sample to its own embedded neighbors
+    raft::distance::pairwise_distance(h,
+                                      X_batch.data(),
+                                      X_targets.data(),
+                                      target_dist.data(),
+                                      cur,
+                                      cur * n_targets,
+                                      m,
+                                      distance_type);
+    raft::linalg::map_offset(
+      h,
+      raft::make_device_vector_view<math_t, int64_t>(targets.data(), int64_t(cur) * n_targets),
+      [target_dist_ptr = target_dist.data(), cur, n_targets] __device__(int64_t e) {
+        int64_t i = e / n_targets;
+        return target_dist_ptr[i * cur * n_targets + e];
+      });
+
+    RAFT_CUDA_TRY(cudaMemsetAsync(counts.data(), 0, sizeof(int) * cur * n_targets, stream));
+    for (int col = 0; col < n; col += cc) {
+      int cols = std::min(cc, n - col);
+      raft::distance::pairwise_distance(
+        h, X_batch.data(), X + int64_t(col) * m, X_dist.data(), cur, cols, m, distance_type);
+      int64_t work  = int64_t(cur) * cols;
+      auto n_blocks = raft::ceildiv<int64_t>(work, N_THREADS);
+      count_closer_kernel<<<n_blocks, N_THREADS, 0, stream>>>(counts.data(),
+                                                              X_dist.data(),
+                                                              targets.data(),
+                                                              t_ind,
+                                                              col,
+                                                              cur,
+                                                              cols,
+                                                              n_targets);
+      RAFT_CUDA_TRY(cudaPeekAtLastError());
+    }
+
+    raft::linalg::map_offset(
+      h,
+      raft::make_device_vector_view<double, int>(penalties + start, cur),
+      [counts_ptr = counts.data(), n_targets, n_neighbors] __device__(int i) {
+        double penalty = 0;
+        for (int t = 0; t < n_targets; t++) {
+          penalty += max(0, counts_ptr[i * n_targets + t] - n_neighbors);
+        }
+        return penalty;
+      });
+  }
+}
+
 /**
  * @brief Compute the trustworthiness score
  * @param h Raft handle
@@ -126,6 +287,7 @@ void run_knn(const raft::resources& h,
  * @param d: Number of features in low/embedded dimension
  * @param n_neighbors Number of neighbors considered by trustworthiness score
  * @param batchSize Batch size
+ * @param max_workspace_bytes The bound of the temporary memory
  * @return Trustworthiness score
  */
 template <typename math_t, raft::distance::DistanceType distance_type>
@@ -136,85 +298,90 @@ double trustworthiness_score(const raft::resources& h,
                              int m,
                              int d,
                              int n_neighbors,
-                             int batchSize = 512)
+                             int batchSize              = 512,
+                             size_t max_workspace_bytes = kScoreWorkspaceBytes)
 {
   cudaStream_t stream = resource::get_cuda_stream(h);
 
-  const int KNN_ALLOC = n * (n_neighbors + 1);
-  rmm::device_uvector<int64_t> emb_ind(KNN_ALLOC, stream);
-  rmm::device_uvector<math_t> emb_dist(KNN_ALLOC, stream);
-
-  run_knn<distance_type>(h, X_embedded, n, d, n_neighbors + 1, emb_ind.data(), emb_dist.data());
-
-  const int PAIRWISE_ALLOC = batchSize * n;
-  rmm::device_uvector<int> X_ind(PAIRWISE_ALLOC, stream);
-  rmm::device_uvector<math_t> X_dist(PAIRWISE_ALLOC, stream);
-  rmm::device_uvector<int> lookup_table(PAIRWISE_ALLOC, stream);
-
-  double t = 0.0;
-  rmm::device_scalar<double> t_dbuf(stream);
-
-  int toDo = n;
-  while (toDo > 0) {
-    int curBatchSize = min(toDo, batchSize);
-
-    // Takes at most batchSize vectors at a time
-    raft::distance::pairwise_distance(
-      h, &X[(n - toDo) * m], X, X_dist.data(), curBatchSize, n, m, distance_type);
-
-    size_t colSortWorkspaceSize = 0;
-    bool bAllocWorkspace        = false;
-
-    raft::matrix::sort_cols_per_row(X_dist.data(),
-                                    X_ind.data(),
-                                    curBatchSize,
-                                    n,
-                                    bAllocWorkspace,
-                                    nullptr,
-                                    colSortWorkspaceSize,
-                                    stream);
-
-    if (bAllocWorkspace) {
-      rmm::device_uvector<char> sortColsWorkspace(colSortWorkspaceSize, stream);
-
-      raft::matrix::sort_cols_per_row(X_dist.data(),
-                                      X_ind.data(),
-                                      curBatchSize,
-                                      n,
-                                      bAllocWorkspace,
-                                      sortColsWorkspace.data(),
-                                      colSortWorkspaceSize,
-                                      stream);
-    }
-
-    int work     = curBatchSize * n;
-    int n_blocks = raft::ceildiv(work, N_THREADS);
-    build_lookup_table<<<n_blocks, N_THREADS, 0, stream>>>(
-      lookup_table.data(), X_ind.data(), n, work);
-
-    RAFT_CUDA_TRY(cudaMemsetAsync(t_dbuf.data(), 0, sizeof(double), stream));
-
-    work     = curBatchSize * (n_neighbors + 1);
-    n_blocks = raft::ceildiv(work, N_THREADS);
-    compute_rank<<<n_blocks, N_THREADS, 0, stream>>>(
-      t_dbuf.data(),
-      lookup_table.data(),
-      &emb_ind.data()[(n - toDo) * (n_neighbors + 1)],
-      n,
-      n_neighbors + 1,
-      work);
-    RAFT_CUDA_TRY(cudaPeekAtLastError());
-
-    t += t_dbuf.value(stream);
-
-    toDo -= curBatchSize;
-  }
+  auto row_ids = sample_score_rows(h, n, n, 0);
+  rmm::device_uvector<double> penalties(n, stream);
+  trustworthiness_penalties<math_t, distance_type>(h,
+                                                   X,
+                                                   X_embedded,
+                                                   n,
+                                                   m,
+                                                   d,
+                                                   n_neighbors,
+                                                   row_ids.data(),
+                                                   n,
+                                                   penalties.data(),
+                                                   batchSize,
+                                                   max_workspace_bytes);
+  double t = thrust::reduce(
+    resource::get_thrust_policy(h), penalties.begin(), penalties.end(), double(0));
 
   t = 1.0 - ((2.0 / ((n * n_neighbors) * ((2.0 * n) - (3.0 * n_neighbors) - 1.0))) * t);
 
   return t;
 }
 
+/**
+ * @brief Estimate the trustworthiness score from the penalties of n_samples samples drawn
+ * uniformly without replacement: the score is the mean over the samples of
+ * 1 - 2 penalty / (n_neighbors (2 n - 3 n_neighbors - 1))
+ * @param h Raft handle
+ * @param X[in]: Data in original dimension
+ * @param X_embedded[in]: Data in target dimension (embedding)
+ * @param n: Number of samples
+ * @param m: Number of features in high/original dimension
+ * @param d: Number of features in low/embedded dimension
+ * @param n_neighbors Number of neighbors considered by trustworthiness score
+ * @param n_samples Number of sampled samples (the score is exact when it is at least n)
+ * @param seed The seed of the sample
+ * @param confidence The probability covered by the confidence interval
+ * @param batchSize Batch size
+ * @param max_workspace_bytes The bound of the temporary memory
+ * @return The estimated trustworthiness score and its confidence interval
+ */
+template <typename math_t, raft::distance::DistanceType distance_type>
+score_estimate<double> trustworthiness_score_sampled(const raft::resources& h,
+                                                     const math_t* X,
+                                                     math_t* X_embedded,
+                                                     int n,
+                                                     int m,
+                                                     int d,
+                                                     int n_neighbors,
+                                                     int n_samples,
+                                                     uint64_t seed,
+                                                     double confidence,
+                                                     int batchSize,
+                                                     size_t max_workspace_bytes)
+{
+  cudaStream_t stream = resource::get_cuda_stream(h);
+
+  auto row_ids = sample_score_rows(h, n, n_samples, seed);
+  int n_sel    = int(row_ids.size());
+  rmm::device_uvector<double> scores(n_sel, stream);
+  trustworthiness_penalties<math_t, distance_type>(h,
+                                                   X,
+                                                   X_embedded,
+                                                   n,
+                                                   m,
+                                                   d,
+                                                   n_neighbors,
+                                                   row_ids.data(),
+                                                   n_sel,
+                                                   scores.data(),
+                                                   batchSize,
+                                                   max_workspace_bytes);
+  double scale = 2.0 / (n_neighbors * ((2.0 * n) - (3.0 * n_neighbors) - 1.0));
+  raft::linalg::map_offset(
+    h,
+    raft::make_device_vector_view<double, int>(scores.data(), n_sel),
+    [scores_ptr = scores.data(), scale] __device__(int i) { return 1.0 - scale * scores_ptr[i]; });
+  return estimate_mean_score(h, scores.data(), int64_t(n_sel), int64_t(n), confidence);
+}
+
 }  // namespace detail
 }  // namespace stats
 }  // namespace raft
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/moments_accumulator.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <cstdint>
+#include <optional>
+
+namespace raft::stats {
+
+/**
+ * @defgroup stats_moments_accumulator Streaming mean, variance and covariance
+ * @{
+ */
+
+/**
+ * @brief The mean, variance and (optionally) covariance of the columns of a dataset given by
+ * batches of rows, for the datasets which are never on the device at once.
+ *
+ * The accumulator keeps the count, the means and the sums of the squared deviations M2 (and the
+ * co-moment matrix) on the device; every batch is reduced to its own moments in a single sweep,
+ * and merged by the pairwise update of Chan et al. The states of several accumulators (other
+ * streams, or the ranks of a communicator) merge the same way, in any order.
+ *
+ * @code{.cpp}
+ *   raft::stats::moments_accumulator<float> acc(handle, n_cols, true);
+ *   for (auto& batch : batches) {
+ *     acc.update(handle, batch);  // device_matrix_view<const float, int64_t> [n_rows, n_cols]
+ *   }
+ *   acc.allreduce(handle);  // with the comms of the handle, the moments of all the ranks
+ *   acc.mean(handle, mean.view());
+ *   acc.cov(handle, cov.view(), true);
+ * @endcode
+ *
+ * @tparam T the data type (float or double)
+ * @tparam IdxT the type of the extents of the batches
+ */
+template <typename T, typename IdxT = int64_t>
+class moments_accumulator {
+ public:
+  /**
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[in] n_cols the number of columns of the dataset
+   * @param[in] with_cov whether to keep the co-moments (n_cols x n_cols) for the covariance
+   */
+  moments_accumulator(raft::resources const& handle, IdxT n_cols, bool with_cov = false)
+    : mean_(raft::make_device_vector<T, IdxT>(handle, n_cols)),
+      m2_(raft::make_device_vector<T, IdxT>(handle, n_cols))
+  {
+    if (with_cov) { comoments_.emplace(raft::make_device_matrix<T, IdxT>(handle, n_cols, n_cols)); }
+    reset(handle);
+  }
+
+  /** @brief Forget all the rows seen so far. */
+  void reset(raft::resources const& handle)
+  {
+    auto stream = resource::get_cuda_stream(handle);
+    count_      = 0;
+    RAFT_CUDA_TRY(cudaMemsetAsync(mean_.data_handle(), 0, mean_.size() * sizeof(T), stream));
+    RAFT_CUDA_TRY(cudaMemsetAsync(m2_.data_handle(), 0, m2_.size() * sizeof(T), stream));
+    if (comoments_) {
+      RAFT_CUDA_TRY(
+        cudaMemsetAsync(comoments_->data_handle(), 0, comoments_->size() * sizeof(T), stream));
+    }
+  }
+
+  /**
+   * @brief Add a batch of rows.
+   *
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[in] batch the rows [n_rows, n_cols]; it may be overwritten as soon as the stream of
+   *   the handle is past this call
+   */
+  void update(raft::resources const& handle,
+              raft::device_matrix_view<const T, IdxT, raft::row_major> batch)
+  {
+    RAFT_EXPECTS(batch.extent(1) == n_cols(), "The batch must have n_cols columns");
+    detail::moments_update(handle,
+                           count_,
+                           mean_.data_handle(),
+                           m2_.data_handle(),
+                           comoments_ ? comoments_->data_handle() : nullptr,
+                           batch.data_handle(),
+                           batch.extent(0),
+                           n_cols());
+    count_ += int64_t(batch.extent(0));
+  }
+
+  /**
+   * @brief Add the rows seen by another accumulator (of the same number of columns), e.g. one
+   * fed on another stream; the two streams must be synchronized first.
+   *
+   * When this accumulator keeps the co-moments, the other one must keep them too.
+   */
+  void merge(raft::resources const& handle, const moments_accumulator& other)
+  {
+    RAFT_EXPECTS(other.n_cols() == n_cols(), "The accumulators must have the same columns");
+    RAFT_EXPECTS(!comoments_ || other.comoments_,
+                 "The other accumulator must keep the co-moments too");
+    detail::moments_merge<T>(handle,
+                             count_,
+                             mean_.data_handle(),
+                             m2_.data_handle(),
+                             comoments_ ? comoments_->data_handle() : nullptr,
+                             other.count_,
+                             other.mean_.data_handle(),
+                             other.m2_.data_handle(),
+                             other.comoments_ ? other.comoments_->data_handle() : nullptr,
+                             n_cols());
+    count_ += other.count_;
+  }
+
+  /**
+   * @brief Merge the accumulators of all the ranks of the communicator of the handle, in place:
+   * every rank ends up with the moments of all the rows. This is a collective operation (all the
+   * ranks must call it, with the same with_cov), which synchronizes the stream of the handle.
+   */
+  void allreduce(raft::resources const& handle)
+  {
+    detail::moments_allreduce<T>(handle,
+                                 resource::get_comms(handle),
+                                 count_,
+                                 mean_.data_handle(),
+                                 m2_.data_handle(),
+                                 comoments_ ? comoments_->data_handle() : nullptr,
+                                 n_cols());
+  }
+
+  /**
+   * @brief The means of the columns.
+   *
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[out] out the means [n_cols]
+   */
+  void mean(raft::resources const& handle, raft::device_vector_view<T, IdxT> out) const
+  {
+    RAFT_EXPECTS(out.extent(0) == n_cols(), "out must have n_cols elements");
+    raft::copy(out.data_handle(), mean_.data_handle(), n_cols(), resource::get_cuda_stream(handle));
+  }
+
+  /**
+   * @brief The variances of the columns.
+   *
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[out] out the variances [n_cols]
+   * @param[in] sample whether to normalize by count - 1 (the sample variance) or by count
+   */
+  void var(raft::resources const& handle, raft::device_vector_view<T, IdxT> out, bool sample) const
+  {
+    RAFT_EXPECTS(out.extent(0) == n_cols(), "out must have n_cols elements");
+    raft::linalg::map_offset(
+      handle, out, [m2 = m2_.data_handle(), d = denominator(sample)] __device__(IdxT i) {
+        return m2[i] / d;
+      });
+  }
+
+  /**
+   * @brief The covariance matrix of the columns; the accumulator must keep the co-moments.
+   *
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[out] out the covariance matrix [n_cols, n_cols]
+   * @param[in] sample whether to normalize by count - 1 (the sample covariance) or by count
+   */
+  void cov(raft::resources const& handle,
+           raft::device_matrix_view<T, IdxT, raft::row_major> out,
+           bool sample) const
+  {
+    RAFT_EXPECTS(comoments_.has_value(), "The accumulator does not keep the co-moments");
+    RAFT_EXPECTS(out.extent(0) == n_cols() && out.extent(1) == n_cols(),
+                 "out must be [n_cols, n_cols]");
+    raft::linalg::map_offset(
+      handle,
+      raft::make_device_vector_view<T, int64_t>(out.data_handle(), int64_t(out.size())),
+      [c = comoments_->data_handle(), d = denominator(sample)] __device__(int64_t e) {
+        return c[e] / d;
+      });
+  }
+
+  /** The number of rows seen so far. */
+  [[nodiscard]] auto count() const -> int64_t { return count_; }
+  [[nodiscard]] auto n_cols() const -> IdxT { return mean_.extent(0); }
+  [[nodiscard]] auto with_cov() const -> bool { return comoments_.has_value(); }
+
+ private:
+  [[nodiscard]] auto denominator(bool sample) const -> T
+  {
+    RAFT_EXPECTS(count_ > int64_t(sample), "Not enough rows for the moments");
+    return T(count_ - int64_t(sample));
+  }
+
+  int64_t count_ = 0;
+  raft::device_vector<T, IdxT> mean_;
+  raft::device_vector<T, IdxT> m2_;
+  std::optional<raft::device_matrix<T, IdxT>> comoments_;
+};
+
+/** @} */
+
+}  // namespace raft::stats
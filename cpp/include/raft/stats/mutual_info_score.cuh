@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -56,6 +56,10 @@ double mutual_info_score(const T* firstClusterArray,
 /**
  * @brief Function to calculate the mutual information between two clusters
  * <a href="https://en.wikipedia.org/wiki/Mutual_information">more info on mutual information</a>
+ *
+ * When the label range is large enough for the dense contingency matrix to exceed the input,
+ * the metric is computed from the sparse contingency matrix (see `sparseContingencyMatrix`),
+ * in time and memory linear in the number of samples and classes.
  * @tparam value_t the data type
  * @tparam idx_t index type
  * @param[in] handle the raft handle
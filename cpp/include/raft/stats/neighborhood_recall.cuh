@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -43,6 +43,10 @@ namespace raft::stats {
  * indices matrix of dimensions (D, k). If distance matrices are provided, then non-matching indices
  * could be considered a match if abs(dist, ref_dist) < eps.
  *
+ * Every row is scored by a single warp in O(k log k): the reference neighbors are sorted with a
+ * warp-wide bitonic sort and every neighbor is looked up by a binary search (rows of more than
+ * 2048 neighbors fall back to comparing all the pairs).
+ *
  * Usage example:
  * @code{.cpp}
  * raft::device_resources res;
@@ -78,6 +82,8 @@ namespace raft::stats {
  * @param[in] distances (optional) raft::device_matrix_view distances of neighbors
  * @param[in] ref_distances (optional) raft::device_matrix_view reference distances of neighbors
  * @param[in] eps (optional, default = 0.001) value within which distances are considered matching
+ * @param[out] per_query_recall (optional) raft::device_vector_view the recall of every row
+ * (length: D), e.g. to monitor the drift of the recall of the queries
  */
 template <typename IndicesValueType,
           typename IndexType,
@@ -92,7 +98,8 @@ void neighborhood_recall(
     distances = std::nullopt,
   std::optional<raft::device_matrix_view<const DistanceValueType, IndexType, raft::row_major>>
     ref_distances                                                    = std::nullopt,
-  std::optional<raft::host_scalar_view<const DistanceValueType>> eps = std::nullopt)
+  std::optional<raft::host_scalar_view<const DistanceValueType>> eps = std::nullopt,
+  std::optional<raft::device_vector_view<ScalarType, IndexType>> per_query_recall = std::nullopt)
 {
   RAFT_EXPECTS(indices.extent(0) == ref_indices.extent(0),
                "The number of rows in indices and reference indices should be equal");
@@ -114,11 +121,18 @@ void neighborhood_recall(
                  "The number of columns in indices and distances should be equal");
   }
 
+  ScalarType* per_query_ptr = nullptr;
+  if (per_query_recall.has_value()) {
+    RAFT_EXPECTS(per_query_recall.value().extent(0) == indices.extent(0),
+                 "The length of per_query_recall and the rows in indices should be equal");
+    per_query_ptr = per_query_recall.value().data_handle();
+  }
+
   DistanceValueType eps_val = 0.001;
   if (eps.has_value()) { eps_val = *eps.value().data_handle(); }
 
   detail::neighborhood_recall(
-    res, indices, ref_indices, distances, ref_distances, recall_score, eps_val);
+    res, indices, ref_indices, distances, ref_distances, recall_score, per_query_ptr, eps_val);
 }
 
 /**
@@ -128,6 +142,10 @@ void neighborhood_recall(
  * indices matrix of dimensions (D, k). If distance matrices are provided, then non-matching indices
  * could be considered a match if abs(dist, ref_dist) < eps.
  *
+ * Every row is scored by a single warp in O(k log k): the reference neighbors are sorted with a
+ * warp-wide bitonic sort and every neighbor is looked up by a binary search (rows of more than
+ * 2048 neighbors fall back to comparing all the pairs).
+ *
  * Usage example:
  * @code{.cpp}
  * raft::device_resources res;
@@ -163,6 +181,8 @@ void neighborhood_recall(
  * @param[in] distances (optional) raft::device_matrix_view distances of neighbors
  * @param[in] ref_distances (optional) raft::device_matrix_view reference distances of neighbors
  * @param[in] eps (optional, default = 0.001) value within which distances are considered matching
+ * @param[out] per_query_recall (optional) raft::device_vector_view the recall of every row
+ * (length: D), e.g. to monitor the drift of the recall of the queries
  */
 template <typename IndicesValueType,
           typename IndexType,
@@ -177,11 +197,18 @@ void neighborhood_recall(
     distances = std::nullopt,
   std::optional<raft::device_matrix_view<const DistanceValueType, IndexType, raft::row_major>>
     ref_distances                                                    = std::nullopt,
-  std::optional<raft::host_scalar_view<const DistanceValueType>> eps = std::nullopt)
+  std::optional<raft::host_scalar_view<const DistanceValueType>> eps = std::nullopt,
+  std::optional<raft::device_vector_view<ScalarType, IndexType>> per_query_recall = std::nullopt)
 {
   auto recall_score_d = raft::make_device_scalar(res, *recall_score.data_handle());
-  neighborhood_recall(
-    res, indices, ref_indices, recall_score_d.view(), distances, ref_distances, eps);
+  neighborhood_recall(res,
+                      indices,
+                      ref_indices,
+                      recall_score_d.view(),
+                      distances,
+                      ref_distances,
+                      eps,
+                      per_query_recall);
   raft::update_host(recall_score.data_handle(),
                     recall_score_d.data_handle(),
                     1,
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "detail/quantile_sketch.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/error.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/comms.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cstdint>
+
+namespace raft::stats {
+
+/**
+ * @defgroup stats_quantile_sketch Approximate quantiles
+ * @{
+ */
+
+/**
+ * @brief Approximate quantiles of the columns of a dataset given by batches of rows: a merging
+ * t-digest per column, on the device.
+ *
+ * Every column is summarized by at most `compression` centroids (a mean and a count), smaller
+ * at the tails than in the middle of the distribution, so the extreme percentiles are the most
+ * accurate ones; the minimum and the maximum of the columns are exact. Every batch is read once,
+ * sorted with the centroids by column, and compressed again. The sketches of other streams or
+ * ranks merge the same way.
+ *
+ * The temporary memory of an update is about 24 bytes per value of the batch (for float), which
+ * bounds the size of the batches.
+ *
+ * @code{.cpp}
+ *   raft::stats::quantile_sketch<float> sketch(handle, n_cols);
+ *   for (auto& batch : batches) {
+ *     sketch.update(handle, batch);  // device_matrix_view<const float, int64_t> [n_rows, n_cols]
+ *   }
+ *   sketch.allreduce(handle);  // with the comms of the handle, the sketch of all the ranks
+ *   // probs = {0.5, 0.9, 0.99}: out [3, n_cols]
+ *   sketch.quantiles(handle, probs.view(), out.view());
+ * @endcode
+ *
+ * @tparam T the data type (float or double)
+ * @tparam IdxT the type of the extents of the batches
+ */
+template <typename T, typename IdxT = int64_t>
+class quantile_sketch {
+ public:
+  /**
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[in] n_cols the number of columns of the dataset
+   * @param[in] compression the largest number of centroids per column; the errors on the ranks
+   *   of the quantiles decrease as 1 / compression in the middle, faster at the tails
+   */
+  quantile_sketch(raft::resources const& handle, IdxT n_cols, int compression = 200)
+    : means_(raft::make_device_matrix<T, IdxT>(handle, n_cols, compression)),
+      weights_(raft::make_device_matrix<double, IdxT>(handle, n_cols, compression)),
+      min_(raft::make_device_vector<T, IdxT>(handle, n_cols)),
+      max_(raft::make_device_vector<T, IdxT>(handle, n_cols))
+  {
+    RAFT_EXPECTS(compression >= 2 && compression <= detail::kSketchMaxCapacity,
+                 "compression must be in [2, %d]",
+                 detail::kSketchMaxCapacity);
+    reset(handle);
+  }
+
+  /** @brief Forget all the values seen so far. */
+  void reset(raft::resources const& handle)
+  {
+    auto stream = resource::get_cuda_stream(handle);
+    count_      = 0;
+    raft::linalg::map_offset(handle, means_.view(), [] __device__(IdxT) {
+      return raft::upper_bound<T>();
+    });
+    RAFT_CUDA_TRY(
+      cudaMemsetAsync(weights_.data_handle(), 0, weights_.size() * sizeof(double), stream));
+    raft::linalg::map_offset(handle, min_.view(), [] __device__(IdxT) {
+      return raft::upper_bound<T>();
+    });
+    raft::linalg::map_offset(handle, max_.view(), [] __device__(IdxT) {
+      return raft::lower_bound<T>();
+    });
+  }
+
+  /**
+   * @brief Add a batch of rows.
+   *
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[in] batch the rows [n_rows, n_cols]
+   */
+  void update(raft::resources const& handle,
+              raft::device_matrix_view<const T, IdxT, raft::row_major> batch)
+  {
+    RAFT_EXPECTS(batch.extent(1) == n_cols(), "The batch must have n_cols columns");
+    if (batch.extent(0) == 0) { return; }
+    count_ += int64_t(batch.extent(0));
+    detail::sketch_update(handle,
+                          batch.data_handle(),
+                          int64_t(batch.extent(0)),
+                          int64_t(n_cols()),
+                          compression(),
+                          double(count_),
+                          means_.data_handle(),
+                          weights_.data_handle(),
+                          min_.data_handle(),
+                          max_.data_handle());
+  }
+
+  /**
+   * @brief Add the values seen by another sketch (of the same columns and compression), e.g. one
+   * fed on another stream; the two streams must be synchronized first.
+   */
+  void merge(raft::resources const& handle, const quantile_sketch& other)
+  {
+    RAFT_EXPECTS(other.n_cols() == n_cols() && other.compression() == compression(),
+                 "The sketches must have the same columns and compression");
+    if (other.count_ == 0) { return; }
+    auto stream = resource::get_cuda_stream(handle);
+    size_t len  = means_.size();
+    rmm::device_uvector<T> both_means(2 * len, stream);
+    rmm::device_uvector<double> both_weights(2 * len, stream);
+    raft::copy(both_means.data(), means_.data_handle(), len, stream);
+    raft::copy(both_means.data() + len, other.means_.data_handle(), len, stream);
+    raft::copy(both_weights.data(), weights_.data_handle(), len, stream);
+    raft::copy(both_weights.data() + len, other.weights_.data_handle(), len, stream);
+    raft::linalg::map(handle,
+                      min_.view(),
+                      raft::min_op{},
+                      raft::make_const_mdspan(min_.view()),
+                      raft::make_const_mdspan(other.min_.view()));
+    raft::linalg::map(handle,
+                      max_.view(),
+                      raft::max_op{},
+                      raft::make_const_mdspan(max_.view()),
+                      raft::make_const_mdspan(other.max_.view()));
+    count_ += other.count_;
+    detail::sketch_merge(handle,
+                         both_means.data(),
+                         both_weights.data(),
+                         2,
+                         int64_t(n_cols()),
+                         compression(),
+                         double(count_),
+                         means_.data_handle(),
+                         weights_.data_handle(),
+                         min_.data_handle(),
+                         max_.data_handle());
+  }
+
+  /**
+   * @brief Merge the sketches of all the ranks of the communicator of the handle, in place:
+   * every rank ends up with the sketch of all the values. This is a collective operation (all the
+   * ranks must call it, with the same columns and compression), which synchronizes the stream of
+   * the handle.
+   */
+  void allreduce(raft::resources const& handle)
+  {
+    detail::sketch_allreduce(handle,
+                             resource::get_comms(handle),
+                             count_,
+                             int64_t(n_cols()),
+                             compression(),
+                             means_.data_handle(),
+                             weights_.data_handle(),
+                             min_.data_handle(),
+                             max_.data_handle());
+  }
+
+  /**
+   * @brief The approximate quantiles of every column.
+   *
+   * @param[in] handle raft handle for managing expensive resources
+   * @param[in] probs the probabilities of the quantiles, in [0, 1] [n_probs]
+   * @param[out] out the quantiles [n_probs, n_cols]
+   */
+  void quantiles(raft::resources const& handle,
+                 raft::device_vector_view<const T, IdxT> probs,
+                 raft::device_matrix_view<T, IdxT, raft::row_major> out) const
+  {
+    RAFT_EXPECTS(count_ > 0, "The sketch is empty");
+    RAFT_EXPECTS(out.extent(0) == probs.extent(0) && out.extent(1) == n_cols(),
+                 "out must be [n_probs, n_cols]");
+    detail::sketch_quantiles(handle,
+                             means_.data_handle(),
+                             weights_.data_handle(),
+                             min_.data_handle(),
+                             max_.data_handle(),
+                             int64_t(n_cols()),
+                             compression(),
+                             double(count_),
+                             probs.data_handle(),
+                             probs.extent(0),
+                             out.data_handle());
+  }
+
+  /** The number of values seen so far in every column. */
+  [[nodiscard]] auto count() const -> int64_t { return count_; }
+  [[nodiscard]] auto n_cols() const -> IdxT { return means_.extent(0); }
+  [[nodiscard]] auto compression() const -> int { return int(means_.extent(1)); }
+
+ private:
+  int64_t count_ = 0;
+  raft::device_matrix<T, IdxT> means_;
+  raft::device_matrix<double, IdxT> weights_;
+  raft::device_vector<T, IdxT> min_;
+  raft::device_vector<T, IdxT> max_;
+};
+
+/** @} */
+
+}  // namespace raft::stats
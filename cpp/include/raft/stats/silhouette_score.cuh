@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,9 @@
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/stats/detail/batched/silhouette_score.cuh>
 #include <raft/stats/detail/silhouette_score.cuh>
+#include <raft/stats/stats_types.hpp>
+
+#include <optional>
 
 namespace raft {
 namespace stats {
@@ -177,6 +180,111 @@ value_t silhouette_score_batched(
                                            metric);
 }
 
+/**
+ * @brief the average silhouette score, with a bounded temporary memory: the distances of blocks
+ * of samples to all the samples are computed tile by tile and reduced right away to the sums of
+ * the distances per cluster, so that no buffer grows with the square of the number of samples
+ * @tparam value_t: type of the data samples
+ * @tparam label_t: type of the labels
+ * @tparam idx_t index type
+ * @param[in]  handle: raft handle for managing expensive resources
+ * @param[in]  X: input matrix Data in row-major format (nRows x nCols)
+ * @param[in]  labels: the array containing labels for every data sample (length: nRows)
+ * @param[out] silhouette_score_per_sample: optional array populated with the silhouette score
+ * for every sample (length: nRows)
+ * @param[in]  n_unique_labels: number of unique labels in the labels array
+ * @param[in]  max_workspace_bytes: the bound of the temporary memory (the blocks have at least
+ * one sample and the tiles at least one column, beyond which the bound is exceeded)
+ * @param[in]  metric: the numerical value that maps to the type of distance metric to be used in
+ * the calculations
+ * @return: The silhouette score.
+ */
+template <typename value_t, typename label_t, typename idx_t>
+value_t silhouette_score_tiled(
+  raft::resources const& handle,
+  raft::device_matrix_view<const value_t, idx_t, raft::row_major> X,
+  raft::device_vector_view<const label_t, idx_t> labels,
+  std::optional<raft::device_vector_view<value_t, idx_t>> silhouette_score_per_sample,
+  idx_t n_unique_labels,
+  size_t max_workspace_bytes          = raft::stats::detail::kScoreWorkspaceBytes,
+  raft::distance::DistanceType metric = raft::distance::DistanceType::L2Unexpanded)
+{
+  static_assert(std::is_integral_v<idx_t>,
+                "silhouette_score_tiled: The index type "
+                "of each mdspan argument must be an integral type.");
+  static_assert(std::is_integral_v<label_t>,
+                "silhouette_score_tiled: The label type must be an integral type.");
+  RAFT_EXPECTS(labels.extent(0) == X.extent(0), "Size mismatch between labels and data");
+
+  value_t* scores_ptr = nullptr;
+  if (silhouette_score_per_sample.has_value()) {
+    scores_ptr = silhouette_score_per_sample.value().data_handle();
+    RAFT_EXPECTS(silhouette_score_per_sample.value().extent(0) == X.extent(0),
+                 "Size mismatch between silhouette_score_per_sample and data");
+  }
+  return batched::detail::silhouette_score_tiled(handle,
+                                                 X.data_handle(),
+                                                 X.extent(0),
+                                                 X.extent(1),
+                                                 labels.data_handle(),
+                                                 label_t(n_unique_labels),
+                                                 scores_ptr,
+                                                 max_workspace_bytes,
+                                                 metric);
+}
+
+/**
+ * @brief the average silhouette score estimated from the scores of a uniform random sample of
+ * the samples (drawn without replacement), with its confidence interval; every sampled score is
+ * exact (its distances are to all the samples, tile by tile as in `silhouette_score_tiled`), so
+ * the cost is n_samples / nRows of the exact score
+ * @tparam value_t: type of the data samples
+ * @tparam label_t: type of the labels
+ * @tparam idx_t index type
+ * @param[in]  handle: raft handle for managing expensive resources
+ * @param[in]  X: input matrix Data in row-major format (nRows x nCols)
+ * @param[in]  labels: the array containing labels for every data sample (length: nRows)
+ * @param[in]  n_unique_labels: number of unique labels in the labels array
+ * @param[in]  n_samples: the number of sampled samples; the score is exact when it is at least
+ * nRows
+ * @param[in]  seed: the seed of the sample
+ * @param[in]  confidence: the probability covered by the confidence interval, in (0, 1)
+ * @param[in]  max_workspace_bytes: the bound of the temporary memory
+ * @param[in]  metric: the numerical value that maps to the type of distance metric to be used in
+ * the calculations
+ * @return: The estimated silhouette score and its confidence interval.
+ */
+template <typename value_t, typename label_t, typename idx_t>
+score_estimate<value_t> silhouette_score_sampled(
+  raft::resources const& handle,
+  raft::device_matrix_view<const value_t, idx_t, raft::row_major> X,
+  raft::device_vector_view<const label_t, idx_t> labels,
+  idx_t n_unique_labels,
+  idx_t n_samples,
+  uint64_t seed                       = 0,
+  double confidence                   = 0.95,
+  size_t max_workspace_bytes          = raft::stats::detail::kScoreWorkspaceBytes,
+  raft::distance::DistanceType metric = raft::distance::DistanceType::L2Unexpanded)
+{
+  static_assert(std::is_integral_v<idx_t>,
+                "silhouette_score_sampled: The index type "
+                "of each mdspan argument must be an integral type.");
+  static_assert(std::is_integral_v<label_t>,
+                "silhouette_score_sampled: The label type must be an integral type.");
+  RAFT_EXPECTS(labels.extent(0) == X.extent(0), "Size mismatch between labels and data");
+  return batched::detail::silhouette_score_sampled(handle,
+                                                   X.data_handle(),
+                                                   X.extent(0),
+                                                   X.extent(1),
+                                                   labels.data_handle(),
+                                                   label_t(n_unique_labels),
+                                                   n_samples,
+                                                   seed,
+                                                   confidence,
+                                                   max_workspace_bytes,
+                                                   metric);
+}
+
 /** @} */  // end group stats_silhouette_score
 
 /**
@@ -220,6 +328,28 @@ value_t silhouette_score_batched(
   return silhouette_score_batched(
     handle, X, labels, opt_scores, n_unique_labels, batch_size, metric);
 }
+
+/**
+ * @brief Overload of `silhouette_score_tiled` to help the
+ *   compiler find the above overload, in case users pass in
+ *   `std::nullopt` for the optional arguments.
+ *
+ * Please see above for documentation of `silhouette_score_tiled`.
+ */
+template <typename value_t, typename label_t, typename idx_t>
+value_t silhouette_score_tiled(
+  raft::resources const& handle,
+  raft::device_matrix_view<const value_t, idx_t, raft::row_major> X,
+  raft::device_vector_view<const label_t, idx_t> labels,
+  std::nullopt_t silhouette_score_per_sample,
+  idx_t n_unique_labels,
+  size_t max_workspace_bytes          = raft::stats::detail::kScoreWorkspaceBytes,
+  raft::distance::DistanceType metric = raft::distance::DistanceType::L2Unexpanded)
+{
+  std::optional<raft::device_vector_view<value_t, idx_t>> opt_scores = silhouette_score_per_sample;
+  return silhouette_score_tiled(
+    handle, X, labels, opt_scores, n_unique_labels, max_workspace_bytes, metric);
+}
 };  // namespace stats
 };  // namespace raft
 
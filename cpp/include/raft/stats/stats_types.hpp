@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2022, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -56,11 +56,34 @@ enum HistType {
   /** builds a hashmap of active bins in shared mem */
   HistTypeSmemHash,
   /** decide at runtime the best algo for the given inputs */
-  HistTypeAuto
+  HistTypeAuto,
+  /**
+   * shared mem atomics into a private copy of the bins per warp, which removes the contention
+   * between the warps on the skewed inputs; this needs (ThreadsPerBlock / WarpSize) times the
+   * shared memory of `HistTypeSmem`. `HistTypeAuto` selects it for the small numbers of bins.
+   */
+  HistTypeSmemWarp
 };
 
 /** @} */
 
+/**
+ * @brief A score estimated from a uniform random sample of the points, and the bounds of its
+ * confidence interval (from the normal approximation of the mean of the per-point scores).
+ * When all the points are sampled, the score is exact and the interval is empty.
+ */
+template <typename T>
+struct score_estimate {
+  /** the mean of the scores of the sampled points */
+  T score;
+  /** the standard error of the mean, with the finite population correction */
+  T std_error;
+  /** the lower bound of the confidence interval */
+  T lower;
+  /** the upper bound of the confidence interval */
+  T upper;
+};
+
 /**
  * @ingroup stats_information_criterion
  * @{
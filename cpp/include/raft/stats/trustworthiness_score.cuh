@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,6 +21,7 @@
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/stats/detail/trustworthiness_score.cuh>
+#include <raft/stats/stats_types.hpp>
 
 namespace raft {
 namespace stats {
@@ -35,6 +36,8 @@ namespace stats {
  * @param[in] d: Number of features in low/embedded dimension
  * @param[in] n_neighbors Number of neighbors considered by trustworthiness score
  * @param[in] batchSize Batch size
+ * @param[in] max_workspace_bytes Bound of the temporary memory (beyond the n * (n_neighbors + 1)
+ * nearest neighbors in the embedding), shrinking the batches and the tiles of distances if needed
  * @return[out] Trustworthiness score
  */
 template <typename math_t, raft::distance::DistanceType distance_type>
@@ -45,10 +48,11 @@ double trustworthiness_score(const raft::resources& h,
                              int m,
                              int d,
                              int n_neighbors,
-                             int batchSize = 512)
+                             int batchSize              = 512,
+                             size_t max_workspace_bytes = detail::kScoreWorkspaceBytes)
 {
   return detail::trustworthiness_score<math_t, distance_type>(
-    h, X, X_embedded, n, m, d, n_neighbors, batchSize);
+    h, X, X_embedded, n, m, d, n_neighbors, batchSize, max_workspace_bytes);
 }
 
 /**
@@ -65,6 +69,9 @@ double trustworthiness_score(const raft::resources& h,
  * @param[in] X_embedded: Data in target dimension (embedding)
  * @param[in] n_neighbors Number of neighbors considered by trustworthiness score
  * @param[in] batch_size Batch size
+ * @param[in] max_workspace_bytes Bound of the temporary memory (beyond the n * (n_neighbors + 1)
+ * nearest neighbors in the embedding): the ranks of the neighbors are counted over tiles of the
+ * distances of a batch to all the samples, never sorted
  * @return Trustworthiness score
  * @note The constness of the data in X_embedded is currently casted away and the data is slightly
  * modified.
@@ -75,7 +82,8 @@ double trustworthiness_score(
   raft::device_matrix_view<const value_t, idx_t, raft::row_major> X,
   raft::device_matrix_view<const value_t, idx_t, raft::row_major> X_embedded,
   int n_neighbors,
-  int batch_size = 512)
+  int batch_size             = 512,
+  size_t max_workspace_bytes = detail::kScoreWorkspaceBytes)
 {
   RAFT_EXPECTS(X.extent(0) == X_embedded.extent(0), "Size mismatch between X and X_embedded");
   RAFT_EXPECTS(std::is_integral_v<idx_t> && X.extent(0) <= std::numeric_limits<int>::max(),
@@ -90,7 +98,59 @@ double trustworthiness_score(
     X.extent(1),
     X_embedded.extent(1),
     n_neighbors,
-    batch_size);
+    batch_size,
+    max_workspace_bytes);
+}
+
+/**
+ * @brief Estimate the trustworthiness score from a uniform random sample of the samples (drawn
+ * without replacement), with its confidence interval: the score is the mean of the contributions
+ * of the samples, and every contribution is computed exactly, at n_samples / n of the cost of the
+ * exact score
+ * @tparam value_t the data type
+ * @tparam idx_t Integer type used to for addressing
+ * @param[in] handle the raft handle
+ * @param[in] X: Data in original dimension
+ * @param[in] X_embedded: Data in target dimension (embedding)
+ * @param[in] n_neighbors Number of neighbors considered by trustworthiness score
+ * @param[in] n_samples Number of sampled samples; the score is exact when it is at least n
+ * @param[in] seed The seed of the sample
+ * @param[in] confidence The probability covered by the confidence interval, in (0, 1)
+ * @param[in] batch_size Batch size
+ * @param[in] max_workspace_bytes Bound of the temporary memory
+ * @return The estimated trustworthiness score and its confidence interval
+ * @note The constness of the data in X_embedded is currently casted away and the data is slightly
+ * modified.
+ */
+template <raft::distance::DistanceType distance_type, typename value_t, typename idx_t>
+score_estimate<double> trustworthiness_score_sampled(
+  raft::resources const& handle,
+  raft::device_matrix_view<const value_t, idx_t, raft::row_major> X,
+  raft::device_matrix_view<const value_t, idx_t, raft::row_major> X_embedded,
+  int n_neighbors,
+  int n_samples,
+  uint64_t seed              = 0,
+  double confidence          = 0.95,
+  int batch_size             = 512,
+  size_t max_workspace_bytes = detail::kScoreWorkspaceBytes)
+{
+  RAFT_EXPECTS(X.extent(0) == X_embedded.extent(0), "Size mismatch between X and X_embedded");
+  RAFT_EXPECTS(std::is_integral_v<idx_t> && X.extent(0) <= std::numeric_limits<int>::max(),
+               "Index type not supported");
+
+  return detail::trustworthiness_score_sampled<value_t, distance_type>(
+    handle,
+    X.data_handle(),
+    const_cast<value_t*>(X_embedded.data_handle()),
+    X.extent(0),
+    X.extent(1),
+    X_embedded.extent(1),
+    n_neighbors,
+    n_samples,
+    seed,
+    confidence,
+    batch_size,
+    max_workspace_bytes);
 }
 
 /** @} */  // end group stats_trustworthiness
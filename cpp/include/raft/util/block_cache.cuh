@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/core/error.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/logger.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+#include <rmm/mr/device/device_memory_resource.hpp>
+#include <rmm/mr/device/per_device_resource.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace raft::cache {
+
+/** The choice of the block evicted when the cache is full. */
+enum class eviction_policy {
+  /** the least recently used block */
+  LRU,
+  /**
+   * the second-chance (clock) approximation of LRU: a use only sets the reference bit of a block,
+   * which is cheaper on the hits than the reordering of LRU
+   */
+  CLOCK
+};
+
+/**
+ * @brief A device cache of variable-size blocks of T, keyed by KeyT.
+ *
+ * A generalization of `Cache` (the set-associative cache of fixed-size vectors of the SVM kernel
+ * rows) for the data that lives outside the device and is used by blocks of different sizes, such
+ * as the lists of an IVF index or the rows of a dataset kept in host memory: the blocks are
+ * filled asynchronously from host (preferably pinned) or device memory on a miss, and the cache
+ * evicts blocks, by LRU or clock, to stay within its capacity in bytes.
+ *
+ * The bookkeeping is on the host and the blocks are stream-ordered allocations of the device
+ * memory resource, hence the cache is meant to be used on one stream: the eviction of a block
+ * is ordered after the kernels that read it before on that stream.
+ *
+ * The blocks fetched by one call of fetch_batch are never evicted by that call, so that all the
+ * pointers it returns are valid together (until the next fetch).
+ *
+ * Example usage:
+ * @code{.cpp}
+ *   raft::cache::block_cache<float> cache(res, size_t(4) << 30);
+ *   // the lists probed by a batch of queries, kept in pinned host memory
+ *   cache.fetch_batch(res, probed_lists, [&](int64_t l) {
+ *     return std::make_pair(host_lists[l].data(), host_lists[l].size());
+ *   }, list_ptrs);
+ *   // list_ptrs[i] is the device copy of the list probed_lists[i]
+ * @endcode
+ *
+ * @tparam T the type of the elements of the blocks
+ * @tparam KeyT the key of a block
+ */
+template <typename T, typename KeyT = int64_t>
+class block_cache {
+ public:
+  /**
+   * @brief Construct an empty cache.
+   *
+   * @param res RAFT resources
+   * @param capacity_bytes the largest total size of the cached blocks
+   * @param policy the eviction policy
+   * @param mr the memory resource of the blocks (the current device resource by default)
+   */
+  block_cache([[maybe_unused]] const raft::resources& res,
+              std::size_t capacity_bytes,
+              eviction_policy policy              = eviction_policy::CLOCK,
+              rmm::mr::device_memory_resource* mr = nullptr)
+    : capacity_bytes_(capacity_bytes),
+      policy_(policy),
+      mr_(mr != nullptr ? mr : rmm::mr::get_current_device_resource()),
+      hand_(order_.end())
+  {
+  }
+  block_cache(const block_cache&)                    = delete;
+  auto operator=(const block_cache&) -> block_cache& = delete;
+
+  /** @brief Whether a block is in the cache (not counted as a use). */
+  [[nodiscard]] auto contains(KeyT key) const -> bool { return entries_.count(key) > 0; }
+
+  /**
+   * @brief The device pointer and the size of a cached block (counted as a use), if cached.
+   */
+  auto find(KeyT key) -> std::optional<std::pair<T*, std::size_t>>
+  {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) { return std::nullopt; }
+    touch(it->second);
+    return std::make_pair(it->second.data.data(), it->second.data.size());
+  }
+
+  /**
+   * @brief The device copy of a block, copied from `source` on a miss.
+   *
+   * The copy is asynchronous on the stream of `res` (truly so when `source` is pinned or device
+   * memory); `source` must stay valid until it is done.
+   *
+   * @param res RAFT resources
+   * @param key the key of the block
+   * @param source the data of the block, in host or device memory
+   * @param size the number of elements of the block
+   * @return the device pointer of the block
+   */
+  auto fetch(const raft::resources& res, KeyT key, const T* source, std::size_t size) -> T*
+  {
+    epoch_++;
+    return fetch_one(res, key, source, size);
+  }
+
+  /**
+   * @brief The device copies of a batch of blocks, none of which is evicted by the others.
+   *
+   * @param res RAFT resources
+   * @param keys the keys of the blocks
+   * @param source_of the data of a block missing from the cache: a callable taking a key and
+   *   returning the pair (pointer to the host or device data, number of elements)
+   * @param[out] ptrs the device pointers of the blocks
+   * @return the number of the blocks that were in the cache
+   */
+  template <typename SourceF, typename IdxT>
+  auto fetch_batch(const raft::resources& res,
+                   raft::host_vector_view<const KeyT, IdxT> keys,
+                   SourceF&& source_of,
+                   raft::host_vector_view<T*, IdxT> ptrs) -> IdxT
+  {
+    RAFT_EXPECTS(keys.extent(0) == ptrs.extent(0), "Expected one pointer per key");
+    epoch_++;
+    IdxT n_hits = 0;
+    for (IdxT i = 0; i < keys.extent(0); i++) {
+      auto it = entries_.find(keys(i));
+      if (it != entries_.end()) {
+        touch(it->second);
+        ptrs(i) = it->second.data.data();
+        n_hits++;
+      } else {
+        auto [source, size] = source_of(keys(i));
+        ptrs(i)             = fetch_one(res, keys(i), source, size);
+      }
+    }
+    return n_hits;
+  }
+
+  /** @brief Remove a block from the cache, if cached. */
+  void erase(KeyT key)
+  {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) { remove(it); }
+  }
+
+  /** @brief Remove all the blocks. */
+  void clear()
+  {
+    entries_.clear();
+    order_.clear();
+    hand_       = order_.end();
+    used_bytes_ = 0;
+  }
+
+  /** @brief The number of cached blocks. */
+  [[nodiscard]] auto size() const -> std::size_t { return entries_.size(); }
+  /** @brief The total size of the cached blocks. */
+  [[nodiscard]] auto used_bytes() const -> std::size_t { return used_bytes_; }
+  [[nodiscard]] auto capacity_bytes() const -> std::size_t { return capacity_bytes_; }
+  /** @brief The number of the fetches of cached blocks. */
+  [[nodiscard]] auto hits() const -> std::size_t { return hits_; }
+  /** @brief The number of the fetches of missing blocks. */
+  [[nodiscard]] auto misses() const -> std::size_t { return misses_; }
+
+ private:
+  using order_t = std::list<KeyT>;
+
+  struct entry {
+    rmm::device_uvector<T> data;
+    typename order_t::iterator pos;
+    bool referenced;
+    uint64_t epoch;
+  };
+
+  std::size_t capacity_bytes_;
+  eviction_policy policy_;
+  rmm::mr::device_memory_resource* mr_;
+  std::unordered_map<KeyT, entry> entries_;
+  // LRU: the most recently used first; clock: the ring of the blocks in their order of insertion
+  order_t order_;
+  typename order_t::iterator hand_;
+  std::size_t used_bytes_ = 0;
+  uint64_t epoch_         = 0;
+  std::size_t hits_       = 0;
+  std::size_t misses_     = 0;
+
+  void touch(entry& e)
+  {
+    hits_++;
+    e.epoch = epoch_;
+    if (policy_ == eviction_policy::LRU) {
+      order_.splice(order_.begin(), order_, e.pos);
+    } else {
+      e.referenced = true;
+    }
+  }
+
+  auto fetch_one(const raft::resources& res, KeyT key, const T* source, std::size_t size) -> T*
+  {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      touch(it->second);
+      return it->second.data.data();
+    }
+    misses_++;
+    auto stream = resource::get_cuda_stream(res);
+    auto bytes  = size * sizeof(T);
+    RAFT_EXPECTS(bytes <= capacity_bytes_,
+                 "A block of %zu bytes does not fit in a cache of %zu bytes",
+                 bytes,
+                 capacity_bytes_);
+    while (used_bytes_ + bytes > capacity_bytes_) {
+      RAFT_EXPECTS(evict_one(), "The blocks of one batch do not fit together in the cache");
+    }
+    // a new block goes before the hand of the clock (i.e. it is the last to be visited)
+    auto pos = policy_ == eviction_policy::LRU ? order_.insert(order_.begin(), key)
+                                               : order_.insert(hand_, key);
+    auto& e  = entries_
+                .emplace(key, entry{rmm::device_uvector<T>(size, stream, mr_), pos, false, epoch_})
+                .first->second;
+    used_bytes_ += bytes;
+    if (size > 0) { raft::copy(e.data.data(), source, size, stream); }
+    return e.data.data();
+  }
+
+  /** Evict one block not used by the current fetch; false if there is none. */
+  auto evict_one() -> bool
+  {
+    if (order_.empty()) { return false; }
+    if (policy_ == eviction_policy::LRU) {
+      for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+        auto e = entries_.find(*it);
+        if (e->second.epoch != epoch_) {
+          remove(e);
+          return true;
+        }
+      }
+      return false;
+    }
+    // clock: the blocks with the reference bit get a second chance; two turns at most
+    for (std::size_t step = 0; step < 2 * order_.size(); step++) {
+      if (hand_ == order_.end()) { hand_ = order_.begin(); }
+      auto e = entries_.find(*hand_);
+      if (e->second.epoch != epoch_ && !e->second.referenced) {
+        remove(e);
+        return true;
+      }
+      e->second.referenced = false;
+      ++hand_;
+    }
+    return false;
+  }
+
+  void remove(typename std::unordered_map<KeyT, entry>::iterator it)
+  {
+    if (hand_ == it->second.pos) { ++hand_; }
+    used_bytes_ -= it->second.data.size() * sizeof(T);
+    order_.erase(it->second.pos);
+    entries_.erase(it);
+  }
+};
+
+}  // namespace raft::cache
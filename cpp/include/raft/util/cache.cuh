@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -52,6 +52,9 @@ namespace raft::cache {
  * Note: we should have a look if the index management could be simplified using
  * concurrent_unordered_map.cuh from cudf. See Issue #914.
  *
+ * For blocks of different sizes, filled from host memory, see `block_cache` in
+ * raft/util/block_cache.cuh.
+ *
  * Example usage:
  * @code{.cpp}
  *
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -287,6 +287,60 @@ inline std::pair<int, int> getComputeCapability()
   return std::make_pair(majorVer, minorVer);
 }
 
+namespace detail {
+/** The lock of the kernel attributes set by the helpers below, in this binary. */
+inline auto kernel_attributes_mutex() -> std::mutex&
+{
+  static std::mutex mutex;
+  return mutex;
+}
+}  // namespace detail
+
+/**
+ * @brief Allow a kernel to use at least `smem_size` bytes of dynamic shared memory.
+ *
+ * `cudaFuncAttributeMaxDynamicSharedMemorySize` is a per-device property of the kernel shared by
+ * all host threads: setting it to the size of each launch races with the launches of the other
+ * threads, which fail when the limit is lowered in between. This helper reads the current limit
+ * with `cudaFuncGetAttributes` and only ever raises it, so that the kernels can be launched
+ * concurrently with different shared memory sizes. The read and the write are under one lock per
+ * binary; a library setting the attribute of the same kernel on its own is not covered.
+ *
+ * @return the error of `cudaFuncSetAttribute`, if the limit had to be raised and could not be.
+ */
+template <typename KernelT>
+inline auto raise_max_dynamic_smem(KernelT kernel, size_t smem_size) -> cudaError_t
+{
+  const auto* func = reinterpret_cast<const void*>(kernel);
+  std::lock_guard<std::mutex> guard(detail::kernel_attributes_mutex());
+  cudaFuncAttributes attrs;
+  RAFT_CUDA_TRY(cudaFuncGetAttributes(&attrs, func));
+  if (smem_size <= size_t(attrs.maxDynamicSharedSizeBytes)) { return cudaSuccess; }
+  return cudaFuncSetAttribute(func, cudaFuncAttributeMaxDynamicSharedMemorySize, int(smem_size));
+}
+
+/**
+ * @brief Set the preferred shared memory carveout of a kernel, unless it is set already.
+ *
+ * Unlike the shared memory limit, the carveout is only a hint and cannot make a launch fail, but
+ * it is still one per-device property of the kernel shared by all host threads: the last one to
+ * set it wins, for the launches of the other threads too.
+ *
+ * @param kernel the kernel.
+ * @param carveout the shared memory carveout, in percents [0, 100].
+ */
+template <typename KernelT>
+inline void set_preferred_smem_carveout(KernelT kernel, int carveout)
+{
+  const auto* func = reinterpret_cast<const void*>(kernel);
+  std::lock_guard<std::mutex> guard(detail::kernel_attributes_mutex());
+  cudaFuncAttributes attrs;
+  RAFT_CUDA_TRY(cudaFuncGetAttributes(&attrs, func));
+  if (attrs.preferredShmemCarveout == carveout) { return; }
+  RAFT_CUDA_TRY(
+    cudaFuncSetAttribute(func, cudaFuncAttributePreferredSharedMemoryCarveout, carveout));
+}
+
 /** helper method to convert an array on device to a string on host */
 template <typename T>
 std::string arr2Str(const T* arr, int size, std::string name, cudaStream_t stream, int width = 4)
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/util/cudart_utils.hpp>
+
+#include <cuda_runtime.h>
+
+namespace raft::detail {
+
+/**
+ * A CUDA event without timing, destroyed with the scope: it tells when the asynchronous copy of a
+ * host staging buffer is over, and the buffer can be filled again.
+ */
+class staging_event {
+ public:
+  staging_event() { RAFT_CUDA_TRY(cudaEventCreateWithFlags(&e_, cudaEventDisableTiming)); }
+  ~staging_event() { RAFT_CUDA_TRY_NO_THROW(cudaEventDestroy(e_)); }
+  staging_event(const staging_event&)                    = delete;
+  auto operator=(const staging_event&) -> staging_event& = delete;
+
+  void record(cudaStream_t stream) { RAFT_CUDA_TRY(cudaEventRecord(e_, stream)); }
+  void sync() { RAFT_CUDA_TRY(cudaEventSynchronize(e_)); }
+
+ private:
+  cudaEvent_t e_;
+};
+
+}  // namespace raft::detail
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <raft/neighbors/cagra_types.hpp>
+#include <raft/neighbors/hnsw_types.hpp>
 #include <raft/neighbors/ivf_pq_types.hpp>
 #include <string>
 
@@ -27,53 +28,57 @@
 namespace raft::runtime::neighbors::cagra {
 
 // Using device and host_matrix_view avoids needing to typedef mutltiple mdspans based on accessors
-#define RAFT_INST_CAGRA_FUNCS(T, IdxT)                                                 \
-  auto build(raft::resources const& handle,                                            \
-             const raft::neighbors::cagra::index_params& params,                       \
-             raft::device_matrix_view<const T, int64_t, row_major> dataset)            \
-    ->raft::neighbors::cagra::index<T, IdxT>;                                          \
-                                                                                       \
-  auto build(raft::resources const& handle,                                            \
-             const raft::neighbors::cagra::index_params& params,                       \
-             raft::host_matrix_view<const T, int64_t, row_major> dataset)              \
-    ->raft::neighbors::cagra::index<T, IdxT>;                                          \
-                                                                                       \
-  void build_device(raft::resources const& handle,                                     \
-                    const raft::neighbors::cagra::index_params& params,                \
-                    raft::device_matrix_view<const T, int64_t, row_major> dataset,     \
-                    raft::neighbors::cagra::index<T, IdxT>& idx);                      \
-                                                                                       \
-  void build_host(raft::resources const& handle,                                       \
-                  const raft::neighbors::cagra::index_params& params,                  \
-                  raft::host_matrix_view<const T, int64_t, row_major> dataset,         \
-                  raft::neighbors::cagra::index<T, IdxT>& idx);                        \
-                                                                                       \
-  void search(raft::resources const& handle,                                           \
-              raft::neighbors::cagra::search_params const& params,                     \
-              const raft::neighbors::cagra::index<T, IdxT>& index,                     \
-              raft::device_matrix_view<const T, int64_t, row_major> queries,           \
-              raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,            \
-              raft::device_matrix_view<float, int64_t, row_major> distances);          \
-  void serialize_file(raft::resources const& handle,                                   \
-                      const std::string& filename,                                     \
-                      const raft::neighbors::cagra::index<T, IdxT>& index,             \
-                      bool include_dataset = true);                                    \
-                                                                                       \
-  void deserialize_file(raft::resources const& handle,                                 \
-                        const std::string& filename,                                   \
-                        raft::neighbors::cagra::index<T, IdxT>* index);                \
-  void serialize(raft::resources const& handle,                                        \
-                 std::string& str,                                                     \
-                 const raft::neighbors::cagra::index<T, IdxT>& index,                  \
-                 bool include_dataset = true);                                         \
-  void serialize_to_hnswlib(raft::resources const& handle,                             \
-                            std::string& str,                                          \
-                            const raft::neighbors::cagra::index<T, IdxT>& index);      \
-  void serialize_to_hnswlib_file(raft::resources const& handle,                        \
-                                 const std::string& filename,                          \
-                                 const raft::neighbors::cagra::index<T, IdxT>& index); \
-  void deserialize(raft::resources const& handle,                                      \
-                   const std::string& str,                                             \
+#define RAFT_INST_CAGRA_FUNCS(T, IdxT)                                                \
+  auto build(raft::resources const& handle,                                           \
+             const raft::neighbors::cagra::index_params& params,                      \
+             raft::device_matrix_view<const T, int64_t, row_major> dataset)           \
+    ->raft::neighbors::cagra::index<T, IdxT>;                                         \
+                                                                                      \
+  auto build(raft::resources const& handle,                                           \
+             const raft::neighbors::cagra::index_params& params,                      \
+             raft::host_matrix_view<const T, int64_t, row_major> dataset)             \
+    ->raft::neighbors::cagra::index<T, IdxT>;                                         \
+                                                                                      \
+  void build_device(raft::resources const& handle,                                    \
+                    const raft::neighbors::cagra::index_params& params,               \
+                    raft::device_matrix_view<const T, int64_t, row_major> dataset,    \
+                    raft::neighbors::cagra::index<T, IdxT>& idx);                     \
+                                                                                      \
+  void build_host(raft::resources const& handle,                                      \
+                  const raft::neighbors::cagra::index_params& params,                 \
+                  raft::host_matrix_view<const T, int64_t, row_major> dataset,        \
+                  raft::neighbors::cagra::index<T, IdxT>& idx);                       \
+                                                                                      \
+  void search(raft::resources const& handle,                                          \
+              raft::neighbors::cagra::search_params const& params,                    \
+              const raft::neighbors::cagra::index<T, IdxT>& index,                    \
+              raft::device_matrix_view<const T, int64_t, row_major> queries,          \
+              raft::device_matrix_view<IdxT, int64_t, row_major> neighbors,           \
+              raft::device_matrix_view<float, int64_t, row_major> distances);         \
+  void serialize_file(raft::resources const& handle,                                  \
+                      const std::string& filename,                                    \
+                      const raft::neighbors::cagra::index<T, IdxT>& index,            \
+                      bool include_dataset = true);                                   \
+                                                                                      \
+  void deserialize_file(raft::resources const& handle,                                \
+                        const std::string& filename,                                  \
+                        raft::neighbors::cagra::index<T, IdxT>* index);               \
+  void serialize(raft::resources const& handle,                                       \
+                 std::string& str,                                                    \
+                 const raft::neighbors::cagra::index<T, IdxT>& index,                 \
+                 bool include_dataset = true);                                        \
+  void serialize_to_hnswlib(raft::resources const& handle,                            \
+                            std::string& str,                                         \
+                            const raft::neighbors::cagra::index<T, IdxT>& index,      \
+                            raft::neighbors::hnsw::HnswHierarchy hierarchy =          \
+                              raft::neighbors::hnsw::HnswHierarchy::NONE);            \
+  void serialize_to_hnswlib_file(raft::resources const& handle,                       \
+                                 const std::string& filename,                         \
+                                 const raft::neighbors::cagra::index<T, IdxT>& index, \
+                                 raft::neighbors::hnsw::HnswHierarchy hierarchy =     \
+                                   raft::neighbors::hnsw::HnswHierarchy::NONE);       \
+  void deserialize(raft::resources const& handle,                                     \
+                   const std::string& str,                                            \
                    raft::neighbors::cagra::index<T, IdxT>* index);
 
 RAFT_INST_CAGRA_FUNCS(float, uint32_t);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -48,6 +48,7 @@ namespace raft::runtime::neighbors::ivf_pq {
 RAFT_DECL_BUILD_EXTEND(float, int64_t);
 RAFT_DECL_BUILD_EXTEND(int8_t, int64_t);
 RAFT_DECL_BUILD_EXTEND(uint8_t, int64_t);
+RAFT_DECL_BUILD_EXTEND(float, uint32_t);
 
 #undef RAFT_DECL_BUILD_EXTEND
 
@@ -62,9 +63,29 @@ RAFT_DECL_BUILD_EXTEND(uint8_t, int64_t);
 RAFT_DECL_SEARCH(float, int64_t);
 RAFT_DECL_SEARCH(int8_t, int64_t);
 RAFT_DECL_SEARCH(uint8_t, int64_t);
+RAFT_DECL_SEARCH(float, uint32_t);
 
 #undef RAFT_DECL_SEARCH
 
+/**
+ * Search with a filter over the ids of the index: the id `i` can be in the results only if the bit
+ * `i` of `filter_bitset` is set (a raft::core::bitset of the ids, see `filtering::bitset_filter`).
+ */
+#define RAFT_DECL_SEARCH_WITH_FILTERING(T, IdxT)                                         \
+  void search_with_filtering(raft::resources const& handle,                              \
+                             const raft::neighbors::ivf_pq::search_params& params,       \
+                             const raft::neighbors::ivf_pq::index<IdxT>& idx,            \
+                             raft::device_matrix_view<const T, IdxT, row_major> queries, \
+                             raft::device_matrix_view<IdxT, IdxT, row_major> neighbors,  \
+                             raft::device_matrix_view<float, IdxT, row_major> distances, \
+                             raft::device_vector_view<const uint32_t, IdxT> filter_bitset);
+
+RAFT_DECL_SEARCH_WITH_FILTERING(float, int64_t);
+RAFT_DECL_SEARCH_WITH_FILTERING(int8_t, int64_t);
+RAFT_DECL_SEARCH_WITH_FILTERING(uint8_t, int64_t);
+
+#undef RAFT_DECL_SEARCH_WITH_FILTERING
+
 /**
  * Save the index to file.
  *
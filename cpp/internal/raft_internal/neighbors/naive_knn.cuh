@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -42,6 +42,8 @@ RAFT_KERNEL naive_distance_kernel(EvalT* dist,
   IdxT grid_size = IdxT(blockDim.y) * IdxT(gridDim.y);
   for (IdxT nidx = threadIdx.y + blockIdx.y * blockDim.y; nidx < n; nidx += grid_size) {
     EvalT acc = EvalT(0);
+    EvalT xx  = EvalT(0);
+    EvalT yy  = EvalT(0);
     for (IdxT i = 0; i < k; ++i) {
       IdxT xidx = i + midx * k;
       IdxT yidx = i + nidx * k;
@@ -51,6 +53,11 @@ RAFT_KERNEL naive_distance_kernel(EvalT* dist,
         case raft::distance::DistanceType::InnerProduct: {
           acc += xv * yv;
         } break;
+        case raft::distance::DistanceType::CosineExpanded: {
+          acc += xv * yv;
+          xx += xv * xv;
+          yy += yv * yv;
+        } break;
         case raft::distance::DistanceType::L2SqrtExpanded:
         case raft::distance::DistanceType::L2SqrtUnexpanded:
         case raft::distance::DistanceType::L2Expanded:
@@ -66,6 +73,10 @@ RAFT_KERNEL naive_distance_kernel(EvalT* dist,
       case raft::distance::DistanceType::L2SqrtUnexpanded: {
         acc = raft::sqrt(acc);
       } break;
+      case raft::distance::DistanceType::CosineExpanded: {
+        const auto norms = raft::sqrt(xx * yy);
+        acc              = norms > EvalT(0) ? EvalT(1) - acc / norms : EvalT(1);
+      } break;
       default: break;
     }
     dist[midx * n + nidx] = acc;
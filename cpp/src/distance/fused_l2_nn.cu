@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -52,3 +52,59 @@ instantiate_raft_distance_fusedL2NNMinReduce(float,
 #undef COMMA
 
 #undef instantiate_raft_distance_fusedL2NNMinReduce
+
+#define COMMA ,
+
+#define instantiate_raft_distance_fusedL2NNMinReduce_widened(InT, OutT, IdxT)      \
+  template void raft::distance::fusedL2NNMinReduce<OutT, IdxT>(OutT * min,         \
+                                                               const InT* x,       \
+                                                               const InT* y,       \
+                                                               const float* xn,    \
+                                                               const float* yn,    \
+                                                               IdxT m,             \
+                                                               IdxT n,             \
+                                                               IdxT k,             \
+                                                               void* workspace,    \
+                                                               bool sqrt,          \
+                                                               bool initOutBuffer, \
+                                                               cudaStream_t stream)
+
+instantiate_raft_distance_fusedL2NNMinReduce_widened(half, float, int);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(half, float, int64_t);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(half,
+                                                     raft::KeyValuePair<int COMMA float>,
+                                                     int);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(half,
+                                                     raft::KeyValuePair<int64_t COMMA float>,
+                                                     int64_t);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(nv_bfloat16, float, int);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(nv_bfloat16, float, int64_t);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(nv_bfloat16,
+                                                     raft::KeyValuePair<int COMMA float>,
+                                                     int);
+instantiate_raft_distance_fusedL2NNMinReduce_widened(nv_bfloat16,
+                                                     raft::KeyValuePair<int64_t COMMA float>,
+                                                     int64_t);
+
+#undef COMMA
+
+#undef instantiate_raft_distance_fusedL2NNMinReduce_widened
+
+#define instantiate_raft_distance_fusedL2NNTopK(DataT, IdxT)                                      \
+  template void raft::distance::fusedL2NNTopK<DataT, IdxT>(raft::KeyValuePair<IdxT, DataT> * out, \
+                                                           const DataT* x,                        \
+                                                           const DataT* y,                        \
+                                                           const DataT* xn,                       \
+                                                           const DataT* yn,                       \
+                                                           IdxT m,                                \
+                                                           IdxT n,                                \
+                                                           IdxT k,                                \
+                                                           int n_neighbors,                       \
+                                                           void* workspace,                       \
+                                                           bool sqrt,                             \
+                                                           cudaStream_t stream)
+
+instantiate_raft_distance_fusedL2NNTopK(float, int);
+instantiate_raft_distance_fusedL2NNTopK(float, int64_t);
+
+#undef instantiate_raft_distance_fusedL2NNTopK
@@ -40,6 +40,14 @@
     value_t eps,                                                                                   \
     std::optional<raft::host_scalar_view<int_t, matrix_idx_t>> max_k);                             \
                                                                                                    \
+  template void raft::neighbors::ball_cover::eps_nn<idx_t, value_t, int_t, matrix_idx_t>(          \
+    raft::resources const& handle,                                                                 \
+    const raft::neighbors::ball_cover::BallCoverIndex<idx_t, value_t, int_t, matrix_idx_t>& index, \
+    raft::device_matrix_view<const value_t, matrix_idx_t, row_major> query,                        \
+    value_t eps,                                                                                   \
+    raft::device_csr_matrix<bool, idx_t, idx_t, idx_t>& adj,                                       \
+    std::size_t max_workspace_bytes);                                                              \
+                                                                                                   \
   template void raft::neighbors::ball_cover::all_knn_query<idx_t, value_t, int_t, matrix_idx_t>(   \
     raft::resources const& handle,                                                                 \
     raft::neighbors::ball_cover::BallCoverIndex<idx_t, value_t, int_t, matrix_idx_t>& index,       \
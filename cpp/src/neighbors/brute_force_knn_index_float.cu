@@ -1,6 +1,6 @@
 
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -51,6 +51,22 @@ template void raft::neighbors::brute_force::search<float, int64_t>(
   raft::device_matrix_view<int64_t, int64_t, row_major> neighbors,
   raft::device_matrix_view<float, int64_t, row_major> distances);
 
+template void raft::neighbors::brute_force::search_with_filtering<float, int>(
+  raft::resources const& res,
+  const raft::neighbors::brute_force::index<float>& idx,
+  raft::device_matrix_view<const float, int64_t, row_major> queries,
+  raft::device_matrix_view<int, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances,
+  raft::core::bitset_view<const uint32_t, int64_t> filter);
+
+template void raft::neighbors::brute_force::search_with_filtering<float, int64_t>(
+  raft::resources const& res,
+  const raft::neighbors::brute_force::index<float>& idx,
+  raft::device_matrix_view<const float, int64_t, row_major> queries,
+  raft::device_matrix_view<int64_t, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances,
+  raft::core::bitset_view<const uint32_t, int64_t> filter);
+
 template raft::neighbors::brute_force::index<float> raft::neighbors::brute_force::
   build<float, raft::host_matrix_view<const float, int64_t, raft::row_major>::accessor_type>(
     raft::resources const& res,
@@ -76,3 +92,13 @@ template raft::neighbors::brute_force::index<float> raft::neighbors::brute_force
     raft::resources const& res,
     raft::neighbors::brute_force::index_params const& params,
     raft::device_matrix_view<const float, int64_t, raft::row_major> dataset);
+
+template void raft::neighbors::brute_force::streaming_knn<float, int64_t>(
+  raft::resources const& res,
+  raft::host_matrix_view<const float, int64_t, row_major> dataset,
+  raft::device_matrix_view<const float, int64_t, row_major> queries,
+  raft::device_matrix_view<int64_t, int64_t, row_major> neighbors,
+  raft::device_matrix_view<float, int64_t, row_major> distances,
+  raft::distance::DistanceType metric,
+  float metric_arg,
+  int64_t chunk_rows);
@@ -49,6 +49,8 @@ namespace raft::neighbors::cagra::detail::multi_cta_search {
   select_and_run<TEAM_SIZE, MAX_DATASET_DIM, DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>( \\
     raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,                 \\
     raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,                      \\
+    uint32_t graph_bits,                                                                    \\
+    search_metric metric,                                                                   \\
     INDEX_T* const topk_indices_ptr,                                                        \\
     DISTANCE_T* const topk_distances_ptr,                                                   \\
     const DATA_T* const queries_ptr,                                                        \\
@@ -80,7 +82,7 @@ trailer = """
 }  // namespace raft::neighbors::cagra::detail::multi_cta_search
 """
 
-mxdim_team = [(128, 8), (256, 16), (512, 32), (1024, 32)]
+mxdim_team = [(128, 8), (256, 16), (512, 32)]
 # block = [(64, 16), (128, 8), (256, 4), (512, 2), (1024, 1)]
 # mxelem = [64, 128, 256]
 load_types = ["uint4"]
@@ -103,6 +105,9 @@ for type_path, (data_t, idx_t, distance_t) in search_types.items():
             f.write(
                 f"instantiate_kernel_selection(\n  {team}, {mxdim}, {data_t}, {idx_t}, {distance_t}, raft::neighbors::filtering::none_cagra_sample_filter);\n"
             )
+            f.write(
+                f"instantiate_kernel_selection(\n  {team}, {mxdim}, {data_t}, {idx_t}, {distance_t}, raft::neighbors::filtering::removed_cagra_sample_filter);\n"
+            )
             f.write(trailer)
             # For pasting into CMakeLists.txt
         print(f"src/neighbors/detail/cagra/{path}")
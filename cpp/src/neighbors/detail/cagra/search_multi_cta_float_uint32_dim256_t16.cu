@@ -1,6 +1,6 @@
 
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -35,6 +35,8 @@ namespace raft::neighbors::cagra::detail::multi_cta_search {
   select_and_run<TEAM_SIZE, MAX_DATASET_DIM, DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>( \
     raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,                 \
     raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,                      \
+    uint32_t graph_bits,                                                                    \
+    search_metric metric,                                                                   \
     INDEX_T* const topk_indices_ptr,                                                        \
     DISTANCE_T* const topk_distances_ptr,                                                   \
     const DATA_T* const queries_ptr,                                                        \
@@ -60,6 +62,8 @@ namespace raft::neighbors::cagra::detail::multi_cta_search {
 
 instantiate_kernel_selection(
   16, 256, float, uint32_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_kernel_selection(
+  16, 256, float, uint32_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
 
 #undef instantiate_kernel_selection
 
@@ -1,6 +1,6 @@
 
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -35,6 +35,9 @@ namespace raft::neighbors::cagra::detail::single_cta_search {
   select_and_run<TEAM_SIZE, MAX_DATASET_DIM, DATA_T, INDEX_T, DISTANCE_T, SAMPLE_FILTER_T>( \
     raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,                 \
     raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,                      \
+    uint32_t graph_bits,                                                                    \
+    search_metric metric,                                                                   \
+    multi_index_arena arena,                                                                \
     INDEX_T* const topk_indices_ptr,                                                        \
     DISTANCE_T* const topk_distances_ptr,                                                   \
     const DATA_T* const queries_ptr,                                                        \
@@ -59,9 +62,39 @@ namespace raft::neighbors::cagra::detail::single_cta_search {
     SAMPLE_FILTER_T sample_filter,                                                          \
     cudaStream_t stream);
 
+#define instantiate_single_cta_select_and_run_persistent(                             \
+  TEAM_SIZE, MAX_DATASET_DIM, DATA_T, INDEX_T, DISTANCE_T)                            \
+  template void                                                                       \
+  select_and_run_persistent<TEAM_SIZE, MAX_DATASET_DIM, DATA_T, INDEX_T, DISTANCE_T>( \
+    raft::device_matrix_view<const DATA_T, int64_t, layout_stride> dataset,           \
+    raft::device_matrix_view<const INDEX_T, int64_t, row_major> graph,                \
+    uint32_t graph_bits,                                                              \
+    search_metric metric,                                                             \
+    persistent_job_queue<DATA_T, INDEX_T, DISTANCE_T> queue,                          \
+    uint32_t num_blocks,                                                              \
+    uint32_t topk,                                                                    \
+    uint32_t num_itopk_candidates,                                                    \
+    uint32_t block_size,                                                              \
+    uint32_t smem_size,                                                               \
+    int64_t hash_bitlen,                                                              \
+    INDEX_T* hashmap_ptr,                                                             \
+    size_t small_hash_bitlen,                                                         \
+    size_t small_hash_reset_interval,                                                 \
+    uint32_t num_random_samplings,                                                    \
+    uint64_t rand_xor_mask,                                                           \
+    size_t itopk_size,                                                                \
+    size_t search_width,                                                              \
+    size_t min_iterations,                                                            \
+    size_t max_iterations,                                                            \
+    cudaStream_t stream);
+
 instantiate_single_cta_select_and_run(
   8, 128, float, uint64_t, float, raft::neighbors::filtering::none_cagra_sample_filter);
+instantiate_single_cta_select_and_run(
+  8, 128, float, uint64_t, float, raft::neighbors::filtering::removed_cagra_sample_filter);
+instantiate_single_cta_select_and_run_persistent(8, 128, float, uint64_t, float);
 
 #undef instantiate_single_cta_search_kernel
+#undef instantiate_single_cta_select_and_run_persistent
 
 }  // namespace raft::neighbors::cagra::detail::single_cta_search
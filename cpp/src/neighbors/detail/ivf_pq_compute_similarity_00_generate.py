@@ -1,4 +1,4 @@
-# Copyright (c) 2023, NVIDIA CORPORATION.
+# Copyright (c) 2023-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -14,7 +14,7 @@
 
 header = """
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -40,6 +40,7 @@ header = """
 
 #include <raft/neighbors/detail/ivf_pq_compute_similarity-inl.cuh>
 #include <raft/neighbors/detail/ivf_pq_fp_8bit.cuh>
+#include <raft/neighbors/sample_filter.cuh>
 
 #define instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select(OutT, LutT, IvfSampleFilterT) \\
     template auto raft::neighbors::ivf_pq::detail::compute_similarity_select<OutT, LutT, IvfSampleFilterT>( \\
@@ -97,12 +98,33 @@ types = dict(
     float_float= ("float", "float"),
     float_fp8_false=("float", "raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA false>"),
     float_fp8_true=("float", "raft::neighbors::ivf_pq::detail::fp_8bit<5u COMMA true>"),
+    half_fp8_e4m3=("half", "__nv_fp8_e4m3"),
+    half_fp8_e5m2=("half", "__nv_fp8_e5m2"),
+    float_fp8_e4m3=("float", "__nv_fp8_e4m3"),
+    float_fp8_e5m2=("float", "__nv_fp8_e5m2"),
+)
+
+# The standard FP8 types require CUDA 11.8 or newer.
+native_fp8 = {"__nv_fp8_e4m3", "__nv_fp8_e5m2"}
+
+# The sample filters of the search of the index types compiled in libraft: the unfiltered search of
+# the int64_t and uint32_t indices, and the search of the int64_t indices filtered by a bitset.
+filters = dict(
+    int64_t="raft::neighbors::filtering::ivf_to_sample_filter<int64_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>",
+    uint32_t="raft::neighbors::filtering::ivf_to_sample_filter<uint32_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>",
+    bitset="raft::neighbors::filtering::ivf_to_sample_filter<int64_t COMMA raft::neighbors::filtering::bitset_filter<uint32_t COMMA int64_t>>",
 )
 
 for path_key, (OutT, LutT) in types.items():
-    path = f"ivf_pq_compute_similarity_{path_key}.cu"
-    with open(path, "w") as f:
-        f.write(header)
-        f.write(f"instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select({OutT}, {LutT}, raft::neighbors::filtering::ivf_to_sample_filter<int64_t COMMA raft::neighbors::filtering::none_ivf_sample_filter>);\n")
-        f.write(trailer)
-    print(f"src/neighbors/detail/{path}")
+    for filter_key, FilterT in filters.items():
+        suffix = "" if filter_key == "int64_t" else f"_{filter_key}"
+        path = f"ivf_pq_compute_similarity_{path_key}{suffix}.cu"
+        with open(path, "w") as f:
+            f.write(header)
+            if LutT in native_fp8:
+                f.write("#ifdef RAFT_IVF_PQ_NATIVE_FP8_LUT\n")
+            f.write(f"instantiate_raft_neighbors_ivf_pq_detail_compute_similarity_select({OutT}, {LutT}, {FilterT});\n")
+            if LutT in native_fp8:
+                f.write("#endif\n")
+            f.write(trailer)
+        print(f"src/neighbors/detail/{path}")
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -48,3 +48,30 @@
 instantiate_raft_neighbors_ivf_pq_extend(int8_t, int64_t);
 
 #undef instantiate_raft_neighbors_ivf_pq_extend
+
+#define instantiate_raft_neighbors_ivf_pq_transform(T, IdxT)          \
+  template void raft::neighbors::ivf_pq::transform<T, IdxT>(          \
+    raft::resources const& handle,                                    \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                  \
+    raft::device_matrix_view<const T, IdxT, row_major> vectors,       \
+    raft::device_vector_view<uint32_t, IdxT> output_labels,           \
+    raft::device_matrix_view<uint8_t, IdxT, row_major> output_codes); \
+                                                                      \
+  template void raft::neighbors::ivf_pq::transform<T, IdxT>(          \
+    raft::resources const& handle,                                    \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                  \
+    raft::host_matrix_view<const T, IdxT, row_major> vectors,         \
+    raft::device_vector_view<uint32_t, IdxT> output_labels,           \
+    raft::device_matrix_view<uint8_t, IdxT, row_major> output_codes); \
+                                                                      \
+  template void raft::neighbors::ivf_pq::transform<T, IdxT>(          \
+    raft::resources const& handle,                                    \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                  \
+    const T* vectors,                                                 \
+    IdxT n_rows,                                                      \
+    uint32_t* output_labels,                                          \
+    uint8_t* output_codes);
+
+instantiate_raft_neighbors_ivf_pq_transform(int8_t, int64_t);
+
+#undef instantiate_raft_neighbors_ivf_pq_transform
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -40,3 +40,45 @@
 instantiate_raft_neighbors_ivf_pq_search(uint8_t, int64_t);
 
 #undef instantiate_raft_neighbors_ivf_pq_search
+
+#define instantiate_raft_neighbors_ivf_pq_search_per_query(T, IdxT)    \
+  template void raft::neighbors::ivf_pq::search<T, IdxT>(              \
+    raft::resources const& handle,                                     \
+    const raft::neighbors::ivf_pq::search_params& params,              \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                   \
+    raft::device_matrix_view<const T, uint32_t, row_major> queries,    \
+    raft::device_matrix_view<IdxT, uint32_t, row_major> neighbors,     \
+    raft::device_matrix_view<float, uint32_t, row_major> distances,    \
+    raft::device_vector_view<const uint32_t, uint32_t> query_n_probes, \
+    std::optional<raft::device_vector_view<const uint32_t, uint32_t>> query_k)
+
+instantiate_raft_neighbors_ivf_pq_search_per_query(uint8_t, int64_t);
+
+#undef instantiate_raft_neighbors_ivf_pq_search_per_query
+
+#define instantiate_raft_neighbors_ivf_pq_range_search(T, IdxT)     \
+  template void raft::neighbors::ivf_pq::range_search<T, IdxT>(     \
+    raft::resources const& handle,                                  \
+    const raft::neighbors::ivf_pq::range_search_params& params,     \
+    const raft::neighbors::ivf_pq::index<IdxT>& idx,                \
+    raft::device_matrix_view<const T, uint32_t, row_major> queries, \
+    float radius,                                                   \
+    raft::device_csr_matrix<float, int64_t, IdxT, int64_t>& result)
+
+instantiate_raft_neighbors_ivf_pq_range_search(uint8_t, int64_t);
+
+#undef instantiate_raft_neighbors_ivf_pq_range_search
+
+#define instantiate_raft_neighbors_ivf_pq_search_refine(T)            \
+  template void raft::neighbors::ivf_pq::search<T, int64_t>(          \
+    raft::resources const& handle,                                    \
+    const raft::neighbors::ivf_pq::search_params& params,             \
+    const raft::neighbors::ivf_pq::index<int64_t>& idx,               \
+    raft::device_matrix_view<const T, uint32_t, row_major> queries,   \
+    raft::device_matrix_view<int64_t, uint32_t, row_major> neighbors, \
+    raft::device_matrix_view<float, uint32_t, row_major> distances,   \
+    raft::device_matrix_view<const T, int64_t, row_major> dataset)
+
+instantiate_raft_neighbors_ivf_pq_search_refine(uint8_t);
+
+#undef instantiate_raft_neighbors_ivf_pq_search_refine
@@ -52,16 +52,18 @@ namespace raft::runtime::neighbors::cagra {
                                                                                               \
   void serialize_to_hnswlib_file(raft::resources const& handle,                               \
                                  const std::string& filename,                                 \
-                                 const raft::neighbors::cagra::index<DTYPE, uint32_t>& index) \
+                                 const raft::neighbors::cagra::index<DTYPE, uint32_t>& index, \
+                                 raft::neighbors::hnsw::HnswHierarchy hierarchy)              \
   {                                                                                           \
-    raft::neighbors::cagra::serialize_to_hnswlib(handle, filename, index);                    \
+    raft::neighbors::cagra::serialize_to_hnswlib(handle, filename, index, hierarchy);         \
   };                                                                                          \
   void serialize_to_hnswlib(raft::resources const& handle,                                    \
                             std::string& str,                                                 \
-                            const raft::neighbors::cagra::index<DTYPE, uint32_t>& index)      \
+                            const raft::neighbors::cagra::index<DTYPE, uint32_t>& index,      \
+                            raft::neighbors::hnsw::HnswHierarchy hierarchy)                   \
   {                                                                                           \
     std::stringstream os;                                                                     \
-    raft::neighbors::cagra::serialize_to_hnswlib(handle, os, index);                          \
+    raft::neighbors::cagra::serialize_to_hnswlib(handle, os, index, hierarchy);               \
     str = os.str();                                                                           \
   }                                                                                           \
                                                                                               \
@@ -25,10 +25,13 @@ namespace raft::neighbors::hnsw {
 #define RAFT_INST_HNSW(T)                                                               \
   template <>                                                                           \
   std::unique_ptr<raft::neighbors::hnsw::index<T>> from_cagra(                          \
-    raft::resources const& res, raft::neighbors::cagra::index<T, uint32_t> cagra_index) \
+    raft::resources const& res,                                                         \
+    raft::neighbors::cagra::index<T, uint32_t> cagra_index,                             \
+    const raft::neighbors::hnsw::index_params& params)                                  \
   {                                                                                     \
     std::string filepath = "/tmp/cagra_index.bin";                                      \
-    raft::runtime::neighbors::cagra::serialize_to_hnswlib(res, filepath, cagra_index);  \
+    raft::runtime::neighbors::cagra::serialize_to_hnswlib_file(                         \
+      res, filepath, cagra_index, params.hierarchy);                                    \
     auto hnsw_index = raft::runtime::neighbors::hnsw::deserialize_file<T>(              \
       res, filepath, cagra_index.dim(), cagra_index.metric());                          \
     std::filesystem::remove(filepath);                                                  \
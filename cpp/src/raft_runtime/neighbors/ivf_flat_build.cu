@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -56,6 +56,7 @@ namespace raft::runtime::neighbors::ivf_flat {
 RAFT_INST_BUILD_EXTEND(float, int64_t);
 RAFT_INST_BUILD_EXTEND(int8_t, int64_t);
 RAFT_INST_BUILD_EXTEND(uint8_t, int64_t);
+RAFT_INST_BUILD_EXTEND(half, int64_t);
 
 #undef RAFT_INST_BUILD_EXTEND
 
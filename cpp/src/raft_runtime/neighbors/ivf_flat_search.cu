@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -34,6 +34,7 @@ namespace raft::runtime::neighbors::ivf_flat {
 RAFT_INST_SEARCH(float, int64_t);
 RAFT_INST_SEARCH(int8_t, int64_t);
 RAFT_INST_SEARCH(uint8_t, int64_t);
+RAFT_INST_SEARCH(half, int64_t);
 
 #undef RAFT_INST_SEARCH
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -60,6 +60,7 @@ namespace raft::runtime::neighbors::ivf_flat {
 RAFT_IVF_FLAT_SERIALIZE_INST(float);
 RAFT_IVF_FLAT_SERIALIZE_INST(int8_t);
 RAFT_IVF_FLAT_SERIALIZE_INST(uint8_t);
+RAFT_IVF_FLAT_SERIALIZE_INST(half);
 
 #undef RAFT_IVF_FLAT_SERIALIZE_INST
 }  // namespace raft::runtime::neighbors::ivf_flat
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -53,6 +53,7 @@ namespace raft::runtime::neighbors::ivf_pq {
 RAFT_INST_BUILD_EXTEND(float, int64_t);
 RAFT_INST_BUILD_EXTEND(int8_t, int64_t);
 RAFT_INST_BUILD_EXTEND(uint8_t, int64_t);
+RAFT_INST_BUILD_EXTEND(float, uint32_t);
 
 #undef RAFT_INST_BUILD_EXTEND
 
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/bitset.cuh>
+#include <raft/neighbors/ivf_pq.cuh>
+#include <raft/neighbors/sample_filter.cuh>
+
+#include <raft_runtime/neighbors/ivf_pq.hpp>
+
+namespace raft::runtime::neighbors::ivf_pq {
+
+#define RAFT_SEARCH_WITH_FILTERING_INST(T, IdxT)                                           \
+  void search_with_filtering(raft::resources const& handle,                                \
+                             const raft::neighbors::ivf_pq::search_params& params,         \
+                             const raft::neighbors::ivf_pq::index<IdxT>& idx,              \
+                             raft::device_matrix_view<const T, IdxT, row_major> queries,   \
+                             raft::device_matrix_view<IdxT, IdxT, row_major> neighbors,    \
+                             raft::device_matrix_view<float, IdxT, row_major> distances,   \
+                             raft::device_vector_view<const uint32_t, IdxT> filter_bitset) \
+  {                                                                                        \
+    auto bitset = raft::core::bitset_view<uint32_t, IdxT>(                                 \
+      const_cast<uint32_t*>(filter_bitset.data_handle()), filter_bitset.extent(0) * 32);   \
+    raft::neighbors::ivf_pq::search_with_filtering<T, IdxT>(                               \
+      handle,                                                                              \
+      params,                                                                              \
+      idx,                                                                                 \
+      queries,                                                                             \
+      neighbors,                                                                           \
+      distances,                                                                           \
+      raft::neighbors::filtering::bitset_filter<uint32_t, IdxT>(bitset));                  \
+  }
+
+RAFT_SEARCH_WITH_FILTERING_INST(uint8_t, int64_t);
+
+#undef RAFT_SEARCH_WITH_FILTERING_INST
+
+}  // namespace raft::runtime::neighbors::ivf_pq
@@ -119,16 +119,20 @@ distances = dict(
     haversine="raft::spatial::knn::detail::HaversineFunc",
     euclidean="raft::spatial::knn::detail::EuclideanFunc",
     dist="raft::spatial::knn::detail::DistFunc",
+    cosine="raft::spatial::knn::detail::CosineFunc",
 )
 
+# 0: any dimensionality (the query rows are kept in the shared memory)
+dims = [2, 3, 0]
+
 types = dict(
     int64_float=("std::int64_t", "float"),
     #int64_double=("std::int64_t", "double"),
 )
 
 for k, v in distances.items():
-    for dim in [2, 3]:
-        path = f"registers_pass_one_{dim}d_{k}.cu"
+    for dim in dims:
+        path = f"registers_pass_one_{dim}d_{k}.cu" if dim else f"registers_pass_one_nd_{k}.cu"
         with open(path, "w") as f:
             f.write(header)
             f.write(macro_pass_one)
@@ -139,8 +143,8 @@ for k, v in distances.items():
         print(f"src/spatial/knn/detail/ball_cover/{path}")
 
 for k, v in distances.items():
-    for dim in [2, 3]:
-        path = f"registers_pass_two_{dim}d_{k}.cu"
+    for dim in dims:
+        path = f"registers_pass_two_{dim}d_{k}.cu" if dim else f"registers_pass_two_nd_{k}.cu"
         with open(path, "w") as f:
             f.write(header)
             f.write(macro_pass_two)
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -34,7 +34,9 @@
     cudaStream_t stream,                                                                     \
     raft::distance::DistanceType metric,                                                     \
     const Mvalue_t* index_norms,                                                             \
-    const Mvalue_t* query_norms)
+    const Mvalue_t* query_norms,                                                             \
+    Mvalue_t metric_arg,                                                                     \
+    rmm::mr::device_memory_resource* mr)
 
 instantiate_raft_spatial_knn_detail_fusedL2Knn(int32_t, float, true);
 instantiate_raft_spatial_knn_detail_fusedL2Knn(int32_t, float, false);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,18 +18,22 @@
 #include <gtest/gtest.h>
 #include <optional>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
 #include <vector>
 
 #include <raft/cluster/kmeans.cuh>
 #include <raft/core/cudart_utils.hpp>
 #include <raft/core/operators.hpp>
 #include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
 #include <raft/random/make_blobs.cuh>
 #include <raft/stats/adjusted_rand_index.cuh>
 #include <raft/util/cuda_utils.cuh>
 #include <rmm/device_uvector.hpp>
 #include <thrust/fill.h>
 
+#include <cuda_fp16.h>
+
 namespace raft {
 
 template <typename T>
@@ -356,4 +360,311 @@ INSTANTIATE_TEST_CASE_P(KmeansTests, KmeansTestF, ::testing::ValuesIn(inputsf2))
 
 INSTANTIATE_TEST_CASE_P(KmeansTests, KmeansTestD, ::testing::ValuesIn(inputsd2));
 
+struct KmeansMiniBatchInputs {
+  int n_row;
+  int n_col;
+  int n_clusters;
+  int mini_batch_size;
+};
+
+template <typename T>
+class KmeansMiniBatchTest : public ::testing::TestWithParam<KmeansMiniBatchInputs> {
+ protected:
+  KmeansMiniBatchTest()
+    : testparams(::testing::TestWithParam<KmeansMiniBatchInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle)),
+      X(raft::make_device_matrix<T, int>(handle, testparams.n_row, testparams.n_col)),
+      labels_ref(raft::make_device_vector<int, int>(handle, testparams.n_row)),
+      labels(raft::make_device_vector<int, int>(handle, testparams.n_row)),
+      centroids(
+        raft::make_device_matrix<T, int>(handle, testparams.n_clusters, testparams.n_col))
+  {
+    params.n_clusters      = testparams.n_clusters;
+    params.mini_batch_size = testparams.mini_batch_size;
+    params.max_iter        = 500;
+    params.rng_state.seed  = 1;
+    raft::random::make_blobs<T, int>(X.data_handle(),
+                                     labels_ref.data_handle(),
+                                     testparams.n_row,
+                                     testparams.n_col,
+                                     params.n_clusters,
+                                     stream,
+                                     true,
+                                     nullptr,
+                                     nullptr,
+                                     T(1.0),
+                                     true,
+                                     (T)-10.0f,
+                                     (T)10.0f,
+                                     (uint64_t)1234);
+  }
+
+  auto score() -> double
+  {
+    T inertia = 0;
+    raft::cluster::kmeans::predict<T, int>(handle,
+                                           params,
+                                           raft::make_const_mdspan(X.view()),
+                                           std::nullopt,
+                                           raft::make_const_mdspan(centroids.view()),
+                                           labels.view(),
+                                           false,
+                                           raft::make_host_scalar_view(&inertia));
+    return raft::stats::adjusted_rand_index(
+      labels_ref.data_handle(), labels.data_handle(), testparams.n_row, stream);
+  }
+
+  void fitDevice()
+  {
+    T inertia  = 0;
+    int n_iter = 0;
+    raft::cluster::kmeans::fit<T, int>(handle,
+                                       params,
+                                       raft::make_const_mdspan(X.view()),
+                                       std::nullopt,
+                                       centroids.view(),
+                                       raft::make_host_scalar_view(&inertia),
+                                       raft::make_host_scalar_view(&n_iter));
+    ASSERT_LE(n_iter, params.max_iter);
+    ASSERT_GT(inertia, T(0));
+    ASSERT_GE(score(), 0.99);
+  }
+
+  void fitHost()
+  {
+    std::vector<T> X_host(X.size());
+    raft::update_host(X_host.data(), X.data_handle(), X.size(), stream);
+    resource::sync_stream(handle, stream);
+
+    T inertia  = 0;
+    int n_iter = 0;
+    raft::cluster::kmeans::fit<T, int>(
+      handle,
+      params,
+      raft::make_host_matrix_view<const T, int>(X_host.data(), testparams.n_row, testparams.n_col),
+      std::nullopt,
+      centroids.view(),
+      raft::make_host_scalar_view(&inertia),
+      raft::make_host_scalar_view(&n_iter));
+    ASSERT_GE(score(), 0.99);
+  }
+
+  void partialFit()
+  {
+    auto cluster_weights = raft::make_device_vector<T, int>(handle, params.n_clusters);
+    thrust::fill(resource::get_thrust_policy(handle),
+                 cluster_weights.data_handle(),
+                 cluster_weights.data_handle() + params.n_clusters,
+                 T(0));
+    // make_blobs shuffles the samples, so contiguous slices are random batches
+    const int batch = testparams.mini_batch_size;
+    for (int epoch = 0; epoch < 3; epoch++) {
+      for (int offset = 0; offset + batch <= testparams.n_row; offset += batch) {
+        T batch_inertia = 0;
+        raft::cluster::kmeans::partial_fit<T, int>(
+          handle,
+          params,
+          raft::make_device_matrix_view<const T, int>(
+            X.data_handle() + size_t(offset) * testparams.n_col, batch, testparams.n_col),
+          std::nullopt,
+          centroids.view(),
+          cluster_weights.view(),
+          raft::make_host_scalar_view(&batch_inertia));
+      }
+    }
+    ASSERT_GE(score(), 0.99);
+  }
+
+  raft::resources handle;
+  KmeansMiniBatchInputs testparams;
+  rmm::cuda_stream_view stream;
+  raft::device_matrix<T, int> X;
+  raft::device_vector<int, int> labels_ref;
+  raft::device_vector<int, int> labels;
+  raft::device_matrix<T, int> centroids;
+  raft::cluster::KMeansParams params;
+};
+
+const std::vector<KmeansMiniBatchInputs> inputs_minibatch = {
+  {10000, 32, 5, 1024}, {10000, 32, 10, 2048}, {20000, 100, 20, 4096}};
+
+typedef KmeansMiniBatchTest<float> KmeansMiniBatchTestF;
+TEST_P(KmeansMiniBatchTestF, FitDevice) { fitDevice(); }
+TEST_P(KmeansMiniBatchTestF, FitHost) { fitHost(); }
+TEST_P(KmeansMiniBatchTestF, PartialFit) { partialFit(); }
+
+INSTANTIATE_TEST_CASE_P(KmeansTests, KmeansMiniBatchTestF, ::testing::ValuesIn(inputs_minibatch));
+
+// The bounded iterations must follow the same trajectory as the plain Lloyd iterations
+template <typename T>
+void run_hamerly_bounds_test(int n_samples, int n_features, int n_clusters)
+{
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+  auto X      = raft::make_device_matrix<T, int>(handle, n_samples, n_features);
+  auto labels = raft::make_device_vector<int, int>(handle, n_samples);
+  raft::random::make_blobs<T, int>(X.data_handle(),
+                                   labels.data_handle(),
+                                   n_samples,
+                                   n_features,
+                                   n_clusters,
+                                   stream,
+                                   true,
+                                   nullptr,
+                                   nullptr,
+                                   T(2.0),
+                                   true,
+                                   (T)-10.0f,
+                                   (T)10.0f,
+                                   (uint64_t)1234);
+
+  raft::cluster::KMeansParams params;
+  params.n_clusters     = n_clusters;
+  params.rng_state.seed = 1;
+  params.max_iter       = 50;
+  auto init = raft::make_device_matrix<T, int>(handle, n_clusters, n_features);
+  rmm::device_uvector<char> workspace(0, stream);
+  raft::cluster::kmeans::init_plus_plus<T, int>(
+    handle, params, raft::make_const_mdspan(X.view()), init.view(), workspace);
+  params.init = raft::cluster::KMeansParams::InitMethod::Array;
+
+  auto run = [&](bool bounded, raft::device_matrix<T, int>& centroids) {
+    params.hamerly_bounds = bounded;
+    raft::copy(centroids.data_handle(), init.data_handle(), init.size(), stream);
+    T inertia  = 0;
+    int n_iter = 0;
+    raft::cluster::kmeans::fit<T, int>(handle,
+                                       params,
+                                       raft::make_const_mdspan(X.view()),
+                                       std::nullopt,
+                                       centroids.view(),
+                                       raft::make_host_scalar_view(&inertia),
+                                       raft::make_host_scalar_view(&n_iter));
+    return std::make_pair(inertia, n_iter);
+  };
+  auto lloyd_centroids   = raft::make_device_matrix<T, int>(handle, n_clusters, n_features);
+  auto bounded_centroids = raft::make_device_matrix<T, int>(handle, n_clusters, n_features);
+  auto lloyd             = run(false, lloyd_centroids);
+  auto bounded           = run(true, bounded_centroids);
+
+  ASSERT_EQ(lloyd.second, bounded.second);
+  ASSERT_NEAR(lloyd.first, bounded.first, 1e-3 * lloyd.first);
+  ASSERT_TRUE(devArrMatch(lloyd_centroids.data_handle(),
+                          bounded_centroids.data_handle(),
+                          lloyd_centroids.size(),
+                          CompareApprox<T>(1e-3),
+                          stream));
+}
+
+TEST(KmeansHamerlyBounds, MatchesLloydF)
+{
+  run_hamerly_bounds_test<float>(10000, 16, 10);
+  run_hamerly_bounds_test<float>(20000, 32, 200);
+}
+
+TEST(KmeansHamerlyBounds, MatchesLloydD) { run_hamerly_bounds_test<double>(10000, 32, 100); }
+
+/**
+ * k-means on half / int8 data must match the float k-means of the same (dequantized) data, from
+ * the same initial centroids; the small batch_samples splits the data into several chunks.
+ */
+template <typename DataT>
+void run_mapped_input_test(int n_samples, int n_features, int n_clusters, float scale)
+{
+  using to_data_t = raft::compose_op<raft::cast_op<DataT>, raft::mul_const_op<float>>;
+  using to_math_t = raft::compose_op<raft::div_const_op<float>, raft::cast_op<float>>;
+  const to_data_t to_data{raft::cast_op<DataT>{}, raft::mul_const_op<float>{scale}};
+  const to_math_t to_math{raft::div_const_op<float>{scale}, raft::cast_op<float>{}};
+
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+  auto blobs  = raft::make_device_matrix<float, int>(handle, n_samples, n_features);
+  auto labels = raft::make_device_vector<int, int>(handle, n_samples);
+  raft::random::make_blobs<float, int>(blobs.data_handle(),
+                                       labels.data_handle(),
+                                       n_samples,
+                                       n_features,
+                                       n_clusters,
+                                       stream,
+                                       true,
+                                       nullptr,
+                                       nullptr,
+                                       1.0f,
+                                       true,
+                                       -10.0f,
+                                       10.0f,
+                                       (uint64_t)1234);
+  auto X     = raft::make_device_matrix<DataT, int>(handle, n_samples, n_features);
+  auto X_ref = raft::make_device_matrix<float, int>(handle, n_samples, n_features);
+  raft::linalg::map(handle, X.view(), to_data, raft::make_const_mdspan(blobs.view()));
+  raft::linalg::map(handle, X_ref.view(), to_math, raft::make_const_mdspan(X.view()));
+
+  raft::cluster::KMeansParams params;
+  params.n_clusters     = n_clusters;
+  params.rng_state.seed = 1;
+  params.max_iter       = 30;
+  params.batch_samples  = 1000;
+  auto init = raft::make_device_matrix<float, int>(handle, n_clusters, n_features);
+  rmm::device_uvector<char> workspace(0, stream);
+  raft::cluster::kmeans::init_plus_plus<float, int>(
+    handle, params, raft::make_const_mdspan(X_ref.view()), init.view(), workspace);
+  params.init = raft::cluster::KMeansParams::InitMethod::Array;
+
+  auto ref_centroids = raft::make_device_matrix<float, int>(handle, n_clusters, n_features);
+  auto centroids     = raft::make_device_matrix<float, int>(handle, n_clusters, n_features);
+  raft::copy(ref_centroids.data_handle(), init.data_handle(), init.size(), stream);
+  raft::copy(centroids.data_handle(), init.data_handle(), init.size(), stream);
+  float ref_inertia = 0, inertia = 0;
+  int ref_n_iter = 0, n_iter = 0;
+  raft::cluster::kmeans::fit<float, int>(handle,
+                                         params,
+                                         raft::make_const_mdspan(X_ref.view()),
+                                         std::nullopt,
+                                         ref_centroids.view(),
+                                         raft::make_host_scalar_view(&ref_inertia),
+                                         raft::make_host_scalar_view(&ref_n_iter));
+  raft::cluster::kmeans::fit<DataT, float, int>(handle,
+                                                params,
+                                                raft::make_const_mdspan(X.view()),
+                                                std::nullopt,
+                                                centroids.view(),
+                                                raft::make_host_scalar_view(&inertia),
+                                                raft::make_host_scalar_view(&n_iter),
+                                                to_math);
+  ASSERT_EQ(ref_n_iter, n_iter);
+  ASSERT_NEAR(ref_inertia, inertia, 1e-3 * ref_inertia);
+  ASSERT_TRUE(devArrMatch(ref_centroids.data_handle(),
+                          centroids.data_handle(),
+                          centroids.size(),
+                          CompareApprox<float>(1e-3),
+                          stream));
+
+  auto ref_pred = raft::make_device_vector<int, int>(handle, n_samples);
+  auto pred     = raft::make_device_vector<int, int>(handle, n_samples);
+  raft::cluster::kmeans::predict<float, int>(handle,
+                                             params,
+                                             raft::make_const_mdspan(X_ref.view()),
+                                             std::nullopt,
+                                             raft::make_const_mdspan(ref_centroids.view()),
+                                             ref_pred.view(),
+                                             false,
+                                             raft::make_host_scalar_view(&ref_inertia));
+  raft::cluster::kmeans::predict<DataT, float, int>(handle,
+                                                    params,
+                                                    raft::make_const_mdspan(X.view()),
+                                                    std::nullopt,
+                                                    raft::make_const_mdspan(ref_centroids.view()),
+                                                    pred.view(),
+                                                    false,
+                                                    raft::make_host_scalar_view(&inertia),
+                                                    to_math);
+  ASSERT_NEAR(ref_inertia, inertia, 1e-3 * ref_inertia);
+  ASSERT_TRUE(devArrMatch(
+    ref_pred.data_handle(), pred.data_handle(), n_samples, Compare<int>(), stream));
+}
+
+TEST(KmeansMappedInput, MatchesFloatH) { run_mapped_input_test<half>(10000, 32, 20, 1.0f); }
+
+TEST(KmeansMappedInput, MatchesFloatI8) { run_mapped_input_test<int8_t>(10000, 32, 20, 4.0f); }
+
 }  // namespace raft
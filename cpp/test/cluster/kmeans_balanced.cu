@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -14,20 +14,23 @@
  * limitations under the License.
  */
 
-#include "../test_utils.h"
+#include "../test_utils.cuh"
 #include <gtest/gtest.h>
 #include <optional>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
 #include <vector>
 
 #include <raft/cluster/kmeans_balanced.cuh>
 #include <raft/core/cudart_utils.hpp>
 #include <raft/core/handle.hpp>
 #include <raft/core/operators.hpp>
+#include <raft/linalg/map.cuh>
 #include <raft/linalg/unary_op.cuh>
 #include <raft/random/make_blobs.cuh>
 #include <raft/stats/adjusted_rand_index.cuh>
 #include <raft/util/cuda_utils.cuh>
+#include <rmm/cuda_stream_pool.hpp>
 #include <rmm/device_uvector.hpp>
 #include <thrust/fill.h>
 
@@ -45,21 +48,45 @@ struct KmeansBalancedInputs {
   IdxT n_clusters;
   raft::cluster::kmeans_balanced_params kb_params;
   MathT tol;
+  size_t n_streams = 0;
 };
 
 template <typename MathT, typename IdxT>
 ::std::ostream& operator<<(::std::ostream& os, const KmeansBalancedInputs<MathT, IdxT>& p)
 {
   os << "{ " << p.n_rows << ", " << p.n_cols << ", " << p.n_clusters << ", " << p.kb_params.n_iters
-     << static_cast<int>(p.kb_params.metric) << '}' << std::endl;
+     << static_cast<int>(p.kb_params.metric) << ", " << p.kb_params.hierarchy_levels << ", "
+     << p.kb_params.max_train_points_per_cluster << ", " << p.n_streams << '}' << std::endl;
   return os;
 }
 
+/** The squared L2 distance of a row of the dataset to the centroid of its label. */
+template <typename DataT, typename MathT, typename LabelT, typename IdxT, typename MappingOpT>
+struct centroid_distance_op {
+  const DataT* X;
+  const MathT* centroids;
+  const LabelT* labels;
+  IdxT n_cols;
+  MappingOpT op;
+
+  RAFT_INLINE_FUNCTION auto operator()(IdxT i) const -> MathT
+  {
+    const MathT* c = centroids + static_cast<IdxT>(labels[i]) * n_cols;
+    MathT d        = 0;
+    for (IdxT j = 0; j < n_cols; j++) {
+      MathT diff = op(X[i * n_cols + j]) - c[j];
+      d += diff * diff;
+    }
+    return d;
+  }
+};
+
 template <typename DataT, typename MathT, typename LabelT, typename IdxT, typename MappingOpT>
 class KmeansBalancedTest : public ::testing::TestWithParam<KmeansBalancedInputs<MathT, IdxT>> {
  protected:
   KmeansBalancedTest()
     : stream(resource::get_cuda_stream(handle)),
+      d_X(0, stream),
       d_labels(0, stream),
       d_labels_ref(0, stream),
       d_centroids(0, stream)
@@ -71,8 +98,11 @@ class KmeansBalancedTest : public ::testing::TestWithParam<KmeansBalancedInputs<
     MappingOpT op{};
 
     auto p = ::testing::TestWithParam<KmeansBalancedInputs<MathT, IdxT>>::GetParam();
+    if (p.n_streams > 0) {
+      resource::set_cuda_stream_pool(handle, std::make_shared<rmm::cuda_stream_pool>(p.n_streams));
+    }
 
-    auto X           = raft::make_device_matrix<DataT, IdxT>(handle, p.n_rows, p.n_cols);
+    d_X.resize(p.n_rows * p.n_cols, stream);
     auto blob_labels = raft::make_device_vector<IdxT, IdxT>(handle, p.n_rows);
 
     MathT* blobs_ptr;
@@ -81,7 +111,7 @@ class KmeansBalancedTest : public ::testing::TestWithParam<KmeansBalancedInputs<
       blobs.resize(p.n_rows * p.n_cols, stream);
       blobs_ptr = blobs.data();
     } else {
-      blobs_ptr = X.data_handle();
+      blobs_ptr = d_X.data();
     }
 
     raft::random::make_blobs<MathT, IdxT>(blobs_ptr,
@@ -102,7 +132,7 @@ class KmeansBalancedTest : public ::testing::TestWithParam<KmeansBalancedInputs<
     // Convert blobs dataset to DataT if necessary
     if constexpr (!std::is_same_v<DataT, MathT>) {
       raft::linalg::unaryOp(
-        X.data_handle(), blobs.data(), p.n_rows * p.n_cols, op.reverse_op, stream);
+        d_X.data(), blobs.data(), p.n_rows * p.n_cols, op.reverse_op, stream);
     }
 
     d_labels.resize(p.n_rows, stream);
@@ -113,7 +143,7 @@ class KmeansBalancedTest : public ::testing::TestWithParam<KmeansBalancedInputs<
       d_labels_ref.data(), blob_labels.data_handle(), p.n_rows, raft::cast_op<LabelT>(), stream);
 
     auto X_view =
-      raft::make_device_matrix_view<const DataT, IdxT>(X.data_handle(), X.extent(0), X.extent(1));
+      raft::make_device_matrix_view<const DataT, IdxT>(d_X.data(), p.n_rows, p.n_cols);
     auto d_centroids_view =
       raft::make_device_matrix_view<MathT, IdxT>(d_centroids.data(), p.n_clusters, p.n_cols);
     auto d_labels_view = raft::make_device_vector_view<LabelT, IdxT>(d_labels.data(), p.n_rows);
@@ -137,11 +167,55 @@ class KmeansBalancedTest : public ::testing::TestWithParam<KmeansBalancedInputs<
     }
   }
 
+  /**
+   * A prepared predictor assigns every row to a centroid as close as the one of its label, in its
+   * small-batch and large-batch paths (the labels themselves may differ on ties).
+   */
+  void predictorTest()
+  {
+    MappingOpT op{};
+
+    auto p = ::testing::TestWithParam<KmeansBalancedInputs<MathT, IdxT>>::GetParam();
+
+    auto predictor = raft::cluster::kmeans_balanced::make_predictor(
+      handle,
+      p.kb_params,
+      raft::make_device_matrix_view<const MathT, IdxT>(d_centroids.data(), p.n_clusters, p.n_cols));
+    auto d_labels_pred = raft::make_device_vector<LabelT, IdxT>(handle, p.n_rows);
+    auto d_dists_ref   = raft::make_device_vector<MathT, IdxT>(handle, p.n_rows);
+    auto d_dists_pred  = raft::make_device_vector<MathT, IdxT>(handle, p.n_rows);
+
+    using dist_op = centroid_distance_op<DataT, MathT, LabelT, IdxT, MappingOpT>;
+    raft::linalg::map_offset(
+      handle,
+      d_dists_ref.view(),
+      dist_op{d_X.data(), d_centroids.data(), d_labels.data(), p.n_cols, op});
+
+    for (IdxT n_rows : {IdxT{1}, std::min<IdxT>(37, p.n_rows), p.n_rows}) {
+      raft::cluster::kmeans_balanced::predict(
+        handle,
+        predictor,
+        raft::make_device_matrix_view<const DataT, IdxT>(d_X.data(), n_rows, p.n_cols),
+        raft::make_device_vector_view<LabelT, IdxT>(d_labels_pred.data_handle(), n_rows),
+        op);
+      raft::linalg::map_offset(
+        handle,
+        raft::make_device_vector_view<MathT, IdxT>(d_dists_pred.data_handle(), n_rows),
+        dist_op{d_X.data(), d_centroids.data(), d_labels_pred.data_handle(), p.n_cols, op});
+      ASSERT_TRUE(devArrMatch(d_dists_ref.data_handle(),
+                              d_dists_pred.data_handle(),
+                              n_rows,
+                              raft::CompareApprox<MathT>(p.tol),
+                              stream));
+    }
+  }
+
   void SetUp() override { basicTest(); }
 
  protected:
   raft::handle_t handle;
   cudaStream_t stream;
+  rmm::device_uvector<DataT> d_X;
   rmm::device_uvector<LabelT> d_labels;
   rmm::device_uvector<LabelT> d_labels_ref;
   rmm::device_uvector<MathT> d_centroids;
@@ -171,14 +245,45 @@ std::vector<KmeansBalancedInputs<MathT, IdxT>> get_kmeans_balanced_inputs()
   return out;
 }
 
+/** Multi-level hierarchies, subsampled training and a stream pool for the fine clusters. */
+template <typename MathT, typename IdxT>
+std::vector<KmeansBalancedInputs<MathT, IdxT>> get_kmeans_balanced_hierarchy_inputs()
+{
+  std::vector<KmeansBalancedInputs<MathT, IdxT>> out;
+  KmeansBalancedInputs<MathT, IdxT> p;
+  p.kb_params.n_iters = 20;
+  p.kb_params.metric  = raft::distance::DistanceType::L2Expanded;
+  p.tol               = MathT{0.0001};
+  // n_rows, n_cols, n_clusters, hierarchy_levels, max_train_points_per_cluster, n_streams
+  std::vector<std::tuple<size_t, size_t, size_t, uint32_t, uint32_t, size_t>> configs = {
+    {10000, 32, 10, 2, 0, 4},
+    {10000, 100, 50, 3, 0, 0},
+    {10000, 100, 50, 3, 0, 4},
+    {100000, 32, 100, 2, 256, 0},
+    {100000, 32, 100, 3, 256, 4}};
+  for (auto& c : configs) {
+    p.n_rows                                 = static_cast<IdxT>(std::get<0>(c));
+    p.n_cols                                 = static_cast<IdxT>(std::get<1>(c));
+    p.n_clusters                             = static_cast<IdxT>(std::get<2>(c));
+    p.kb_params.hierarchy_levels             = std::get<3>(c);
+    p.kb_params.max_train_points_per_cluster = std::get<4>(c);
+    p.n_streams                              = std::get<5>(c);
+    out.push_back(p);
+  }
+  return out;
+}
+
 const auto inputsf_i32 = get_kmeans_balanced_inputs<float, int>();
 const auto inputsd_i32 = get_kmeans_balanced_inputs<double, int>();
 const auto inputsf_i64 = get_kmeans_balanced_inputs<float, int64_t>();
 const auto inputsd_i64 = get_kmeans_balanced_inputs<double, int64_t>();
 
+const auto inputsf_i64_hierarchy = get_kmeans_balanced_hierarchy_inputs<float, int64_t>();
+
 #define KB_TEST(test_type, test_name, test_inputs)         \
   typedef RAFT_DEPAREN(test_type) test_name;               \
   TEST_P(test_name, Result) { ASSERT_TRUE(score == 1.0); } \
+  TEST_P(test_name, Predictor) { predictorTest(); }        \
   INSTANTIATE_TEST_CASE_P(KmeansBalancedTests, test_name, ::testing::ValuesIn(test_inputs))
 
 /*
@@ -210,6 +315,10 @@ KB_TEST((KmeansBalancedTest<float, float, int64_t, int64_t, raft::identity_op>),
         KmeansBalancedTestFFI64I64,
         inputsf_i64);
 
+KB_TEST((KmeansBalancedTest<float, float, uint32_t, int64_t, raft::identity_op>),
+        KmeansBalancedHierarchyTestFFU32I64,
+        inputsf_i64_hierarchy);
+
 /*
  * Second set of tests: integer dataset with conversion
  */
@@ -232,5 +341,8 @@ KB_TEST((KmeansBalancedTest<int8_t, float, uint32_t, int, i2f_scaler<int8_t, flo
 KB_TEST((KmeansBalancedTest<int8_t, double, uint32_t, int, i2f_scaler<int8_t, double>>),
         KmeansBalancedTestDI8U32I32,
         inputsd_i32);
+KB_TEST((KmeansBalancedTest<int8_t, float, uint32_t, int64_t, i2f_scaler<int8_t, float>>),
+        KmeansBalancedHierarchyTestFI8U32I64,
+        inputsf_i64_hierarchy);
 
 }  // namespace raft
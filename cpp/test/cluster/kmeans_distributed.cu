@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+
+#include <raft/cluster/kmeans.cuh>
+#include <raft/cluster/kmeans_distributed.cuh>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/random/make_blobs.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <optional>
+#include <vector>
+
+namespace raft::cluster::kmeans {
+
+struct KmeansDistributedInputs {
+  int n_ranks;
+  int n_row;
+  int n_col;
+  int n_clusters;
+  KMeansParams::InitMethod init;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const KmeansDistributedInputs& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", " << p.n_row << " x " << p.n_col << ", n_clusters "
+     << p.n_clusters << (p.init == KMeansParams::InitMethod::Array ? ", Array" : ", k-means||")
+     << "}";
+  return os;
+}
+
+/**
+ * The rows of a blobs dataset are split in contiguous blocks across the ranks of an in-process
+ * clique. With the same initial centroids (InitMethod::Array), the Lloyd iterations of
+ * fit_distributed should give the centroids and the inertia of kmeans::fit on the whole dataset;
+ * with k-means||, whose samples differ, both should reach the inertia of the blobs.
+ */
+class KmeansDistributedTest : public ::testing::TestWithParam<KmeansDistributedInputs> {
+ protected:
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<KmeansDistributedInputs>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    KMeansParams params;
+    params.n_clusters     = p.n_clusters;
+    params.init           = p.init;
+    params.n_init         = 1;
+    params.tol            = 1e-4;
+    params.rng_state.seed = 1;
+    if (p.init == KMeansParams::InitMethod::KMeansPlusPlus) { params.oversampling_factor = 2.0; }
+
+    // the dataset and the reference, on the first device
+    std::vector<float> X(size_t(p.n_row) * p.n_col);
+    std::vector<float> init_centroids(size_t(p.n_clusters) * p.n_col);
+    std::vector<float> expected(size_t(p.n_clusters) * p.n_col);
+    float expected_inertia = 0;
+    {
+      raft::resources handle;
+      auto stream    = resource::get_cuda_stream(handle);
+      auto d_X       = raft::make_device_matrix<float, int>(handle, p.n_row, p.n_col);
+      auto labels    = raft::make_device_vector<int, int>(handle, p.n_row);
+      auto centroids = raft::make_device_matrix<float, int>(handle, p.n_clusters, p.n_col);
+      raft::random::make_blobs<float, int>(d_X.data_handle(),
+                                           labels.data_handle(),
+                                           p.n_row,
+                                           p.n_col,
+                                           p.n_clusters,
+                                           stream,
+                                           true,
+                                           nullptr,
+                                           nullptr,
+                                           1.0f,
+                                           true,
+                                           -10.0f,
+                                           10.0f,
+                                           1234ULL);
+      raft::update_host(X.data(), d_X.data_handle(), X.size(), stream);
+      // the blobs are shuffled: the first rows are a random initialization
+      raft::copy(centroids.data_handle(), d_X.data_handle(), centroids.size(), stream);
+      raft::update_host(init_centroids.data(), d_X.data_handle(), init_centroids.size(), stream);
+      int n_iter = 0;
+      fit<float, int>(handle,
+                      params,
+                      raft::make_const_mdspan(d_X.view()),
+                      std::nullopt,
+                      centroids.view(),
+                      raft::make_host_scalar_view(&expected_inertia),
+                      raft::make_host_scalar_view(&n_iter));
+      raft::update_host(expected.data(), centroids.data_handle(), expected.size(), stream);
+      resource::sync_stream(handle);
+    }
+
+    nccl_clique clique(p.n_ranks);
+    std::vector<std::vector<float>> actual(p.n_ranks);
+    std::vector<float> actual_inertia(p.n_ranks);
+    clique.run([&](int rank, const raft::resources& handle) {
+      auto stream     = resource::get_cuda_stream(handle);
+      const int begin = int64_t(p.n_row) * rank / p.n_ranks;
+      const int rows  = int64_t(p.n_row) * (rank + 1) / p.n_ranks - begin;
+      auto d_X        = raft::make_device_matrix<float, int>(handle, rows, p.n_col);
+      auto centroids  = raft::make_device_matrix<float, int>(handle, p.n_clusters, p.n_col);
+      raft::update_device(
+        d_X.data_handle(), X.data() + size_t(begin) * p.n_col, d_X.size(), stream);
+      raft::update_device(
+        centroids.data_handle(), init_centroids.data(), init_centroids.size(), stream);
+      int n_iter = 0;
+      fit_distributed<float, int>(handle,
+                                  params,
+                                  raft::make_const_mdspan(d_X.view()),
+                                  std::nullopt,
+                                  centroids.view(),
+                                  raft::make_host_scalar_view(&actual_inertia[rank]),
+                                  raft::make_host_scalar_view(&n_iter));
+      actual[rank].resize(centroids.size());
+      raft::update_host(actual[rank].data(), centroids.data_handle(), centroids.size(), stream);
+      resource::sync_stream(handle);
+    });
+
+    for (int rank = 0; rank < p.n_ranks; rank++) {
+      // the ranks hold the same model
+      ASSERT_TRUE(hostVecMatch(actual[0], actual[rank], raft::Compare<float>())) << "rank " << rank;
+      ASSERT_EQ(actual_inertia[0], actual_inertia[rank]) << "rank " << rank;
+    }
+    ASSERT_NEAR(expected_inertia, actual_inertia[0], 1e-3 * expected_inertia);
+    if (p.init == KMeansParams::InitMethod::Array) {
+      ASSERT_TRUE(hostVecMatch(expected, actual[0], raft::CompareApprox<float>(1e-3)));
+    }
+  }
+};
+
+const std::vector<KmeansDistributedInputs> inputs = {
+  {1, 1000, 8, 5, KMeansParams::InitMethod::Array},
+  {1, 10000, 32, 20, KMeansParams::InitMethod::KMeansPlusPlus},
+  {2, 1000, 8, 5, KMeansParams::InitMethod::Array},
+  {2, 10001, 32, 20, KMeansParams::InitMethod::Array},
+  {2, 10000, 32, 20, KMeansParams::InitMethod::KMeansPlusPlus}};
+
+TEST_P(KmeansDistributedTest, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(KmeansDistributedTests, KmeansDistributedTest, ::testing::ValuesIn(inputs));
+
+}  // namespace raft::cluster::kmeans
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,7 @@
 #include <gtest/gtest.h>
 #include <optional>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
 #include <vector>
 
 #include <raft/cluster/kmeans.cuh>
@@ -41,7 +42,10 @@ template <typename T>
 class KmeansFindKTest : public ::testing::TestWithParam<KmeansFindKInputs<T>> {
  protected:
   KmeansFindKTest()
-    : stream(resource::get_cuda_stream(handle)), best_k(raft::make_host_scalar<int>(0))
+    : stream(resource::get_cuda_stream(handle)),
+      best_k(raft::make_host_scalar<int>(0)),
+      best_k_pool(raft::make_host_scalar<int>(0)),
+      best_k_warm(raft::make_host_scalar<int>(0))
   {
   }
 
@@ -80,6 +84,23 @@ class KmeansFindKTest : public ::testing::TestWithParam<KmeansFindKInputs<T>> {
     raft::cluster::kmeans::find_k<int, T>(
       handle, X_view, best_k.view(), inertia.view(), n_iter.view(), n_clusters);
 
+    // The candidates fitted concurrently on a stream pool give the same search
+    raft::resources pool_handle(handle);
+    resource::set_cuda_stream_pool(pool_handle, std::make_shared<rmm::cuda_stream_pool>(4));
+    raft::cluster::kmeans::find_k<int, T>(
+      pool_handle, X_view, best_k_pool.view(), inertia.view(), n_iter.view(), n_clusters);
+
+    raft::cluster::kmeans::find_k<int, T>(pool_handle,
+                                          X_view,
+                                          best_k_warm.view(),
+                                          inertia.view(),
+                                          n_iter.view(),
+                                          n_clusters,
+                                          1,
+                                          100,
+                                          T(1e-3),
+                                          true);
+
     resource::sync_stream(handle, stream);
   }
 
@@ -90,6 +111,8 @@ class KmeansFindKTest : public ::testing::TestWithParam<KmeansFindKInputs<T>> {
   cudaStream_t stream;
   KmeansFindKInputs<T> testparams;
   raft::host_scalar<int> best_k;
+  raft::host_scalar<int> best_k_pool;
+  raft::host_scalar<int> best_k_warm;
 };
 
 const std::vector<KmeansFindKInputs<float>> inputsf2 = {{1000, 32, 8, 0.001f, true},
@@ -121,6 +144,8 @@ TEST_P(KmeansFindKTestF, Result)
     std::cout << best_k.view()[0] << " " << testparams.n_clusters << std::endl;
   }
   ASSERT_TRUE(best_k.view()[0] == testparams.n_clusters);
+  ASSERT_EQ(best_k_pool.view()[0], best_k.view()[0]);
+  ASSERT_TRUE(best_k_warm.view()[0] >= 2 && best_k_warm.view()[0] <= testparams.n_clusters);
 }
 
 typedef KmeansFindKTest<double> KmeansFindKTestD;
@@ -131,6 +156,8 @@ TEST_P(KmeansFindKTestD, Result)
   }
 
   ASSERT_TRUE(best_k.view()[0] == testparams.n_clusters);
+  ASSERT_EQ(best_k_pool.view()[0], best_k.view()[0]);
+  ASSERT_TRUE(best_k_warm.view()[0] >= 2 && best_k_warm.view()[0] <= testparams.n_clusters);
 }
 
 INSTANTIATE_TEST_CASE_P(KmeansFindKTests, KmeansFindKTestF, ::testing::ValuesIn(inputsf2));
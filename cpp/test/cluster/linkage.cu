@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -30,6 +30,8 @@
 #include <raft/linalg/transpose.cuh>
 #include <raft/sparse/coo.hpp>
 
+#include <raft/cluster/detail/agglomerative.cuh>
+#include <raft/cluster/single_linkage.cuh>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/sparse/hierarchy/single_linkage.cuh>
 #include <raft/util/cudart_utils.hpp>
@@ -38,6 +40,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <tuple>
 #include <vector>
 
 namespace raft {
@@ -165,7 +173,7 @@ template <typename T, typename IdxT>
   return os;
 }
 
-template <typename T, typename IdxT>
+template <typename T, typename IdxT, bool use_boruvka = false>
 class LinkageTest : public ::testing::TestWithParam<LinkageInputs<T, IdxT>> {
  public:
   LinkageTest()
@@ -195,7 +203,16 @@ class LinkageTest : public ::testing::TestWithParam<LinkageInputs<T, IdxT>> {
       raft::make_device_matrix_view<IdxT, IdxT, row_major>(out_children.data(), params.n_row, 2);
     auto labels_view = raft::make_device_vector_view<IdxT, IdxT>(labels.data(), params.n_row);
 
-    if (params.use_knn) {
+    if (use_boruvka) {
+      raft::cluster::hierarchy::
+        single_linkage<T, IdxT, raft::cluster::hierarchy::LinkageDistance::BORUVKA>(
+          handle,
+          data_view,
+          dendrogram_view,
+          labels_view,
+          raft::distance::DistanceType::L2SqrtExpanded,
+          params.n_clusters);
+    } else if (params.use_knn) {
       raft::cluster::hierarchy::
         single_linkage<T, IdxT, raft::cluster::hierarchy::LinkageDistance::KNN_GRAPH>(
           handle,
@@ -672,4 +689,211 @@ typedef LinkageTest<float, int> LinkageTestF_Int;
 TEST_P(LinkageTestF_Int, Result) { EXPECT_TRUE(score == 1.0); }
 
 INSTANTIATE_TEST_CASE_P(LinkageTest, LinkageTestF_Int, ::testing::ValuesIn(linkage_inputsf2));
+
+// The exact Borůvka MST must give the same clusters as the pairwise and knn graph paths.
+typedef LinkageTest<float, int, true> LinkageTestF_Int_Boruvka;
+TEST_P(LinkageTestF_Int_Boruvka, Result) { EXPECT_TRUE(score == 1.0); }
+
+INSTANTIATE_TEST_CASE_P(LinkageTest,
+                        LinkageTestF_Int_Boruvka,
+                        ::testing::ValuesIn(linkage_inputsf2));
+
+/**
+ * Total weight of the MST of the complete graph (Prim's algorithm on the host), on the L2 or the
+ * mutual reachability distances.
+ */
+double prim_mst_weight(const std::vector<float>& X, int m, int d, int min_samples)
+{
+  std::vector<double> dist(size_t(m) * m);
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < m; j++) {
+      double acc = 0;
+      for (int k = 0; k < d; k++) {
+        double diff = X[i * d + k] - X[j * d + k];
+        acc += diff * diff;
+      }
+      dist[size_t(i) * m + j] = std::sqrt(acc);
+    }
+  }
+  if (min_samples > 0) {
+    std::vector<double> core(m);
+    for (int i = 0; i < m; i++) {
+      std::vector<double> row(dist.begin() + size_t(i) * m, dist.begin() + size_t(i + 1) * m);
+      std::nth_element(row.begin(), row.begin() + min_samples - 1, row.end());
+      core[i] = row[min_samples - 1];
+    }
+    for (int i = 0; i < m; i++) {
+      for (int j = 0; j < m; j++) {
+        auto& v = dist[size_t(i) * m + j];
+        v       = std::max(v, std::max(core[i], core[j]));
+      }
+    }
+  }
+  std::vector<double> best(m, std::numeric_limits<double>::max());
+  std::vector<bool> in_tree(m, false);
+  best[0]       = 0;
+  double weight = 0;
+  for (int it = 0; it < m; it++) {
+    int u = -1;
+    for (int i = 0; i < m; i++) {
+      if (!in_tree[i] && (u < 0 || best[i] < best[u])) { u = i; }
+    }
+    in_tree[u] = true;
+    weight += best[u];
+    for (int i = 0; i < m; i++) {
+      if (!in_tree[i]) { best[i] = std::min(best[i], dist[size_t(u) * m + i]); }
+    }
+  }
+  return weight;
+}
+
+class BoruvkaMstTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(BoruvkaMstTest, MatchesPrim)
+{
+  const int m = 500, d = 4, min_samples = GetParam();
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  std::vector<float> h_X(m * d);
+  for (auto& v : h_X) {
+    v = uniform(gen);
+  }
+  rmm::device_uvector<float> X(m * d, stream);
+  raft::update_device(X.data(), h_X.data(), h_X.size(), stream);
+
+  rmm::device_uvector<int> src(m - 1, stream);
+  rmm::device_uvector<int> dst(m - 1, stream);
+  rmm::device_uvector<float> weights(m - 1, stream);
+  raft::cluster::hierarchy::build_mst(
+    handle,
+    raft::make_device_matrix_view<const float, int, row_major>(X.data(), m, d),
+    raft::make_device_vector_view<int, int>(src.data(), m - 1),
+    raft::make_device_vector_view<int, int>(dst.data(), m - 1),
+    raft::make_device_vector_view<float, int>(weights.data(), m - 1),
+    raft::distance::DistanceType::L2SqrtExpanded,
+    min_samples);
+
+  std::vector<int> h_src(m - 1), h_dst(m - 1);
+  std::vector<float> h_weights(m - 1);
+  raft::update_host(h_src.data(), src.data(), m - 1, stream);
+  raft::update_host(h_dst.data(), dst.data(), m - 1, stream);
+  raft::update_host(h_weights.data(), weights.data(), m - 1, stream);
+  resource::sync_stream(handle, stream);
+
+  // A spanning tree: m - 1 edges joining distinct components, sorted by weight
+  std::vector<int> parent(m);
+  for (int i = 0; i < m; i++) {
+    parent[i] = i;
+  }
+  auto find = [&parent](int v) {
+    while (parent[v] != v) {
+      v = parent[v] = parent[parent[v]];
+    }
+    return v;
+  };
+  double weight = 0;
+  for (int e = 0; e < m - 1; e++) {
+    auto a = find(h_src[e]);
+    auto b = find(h_dst[e]);
+    ASSERT_NE(a, b) << "edge " << e << " closes a cycle";
+    parent[a] = b;
+    if (e > 0) { ASSERT_LE(h_weights[e - 1], h_weights[e]); }
+    weight += h_weights[e];
+  }
+  ASSERT_NEAR(weight, prim_mst_weight(h_X, m, d, min_samples), 1e-3 * weight);
+}
+
+INSTANTIATE_TEST_CASE_P(BoruvkaMstTest, BoruvkaMstTest, ::testing::Values(0, 1, 5));
+
+/** The device dendrogram of a random spanning tree (or a chain) matches the host union-find. */
+class DendrogramTest : public ::testing::TestWithParam<std::tuple<int, bool>> {};
+
+TEST_P(DendrogramTest, MatchesHost)
+{
+  auto [m, chain] = GetParam();
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+
+  // the tree edges in a random order (the order of the sorted MST edges)
+  std::mt19937 gen(7);
+  std::vector<int> order(m);
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), gen);
+  std::vector<int> h_src(m - 1), h_dst(m - 1);
+  for (int v = 1; v < m; v++) {
+    int parent   = chain ? v - 1 : std::uniform_int_distribution<int>(0, v - 1)(gen);
+    h_src[v - 1] = order[parent];
+    h_dst[v - 1] = order[v];
+  }
+  std::vector<int> edges(m - 1);
+  std::iota(edges.begin(), edges.end(), 0);
+  std::shuffle(edges.begin(), edges.end(), gen);
+  std::vector<int> h_rows(m - 1), h_cols(m - 1);
+  std::vector<float> h_weights(m - 1);
+  for (int e = 0; e < m - 1; e++) {
+    h_rows[e]    = h_src[edges[e]];
+    h_cols[e]    = h_dst[edges[e]];
+    h_weights[e] = e;
+  }
+
+  rmm::device_uvector<int> rows(m - 1, stream);
+  rmm::device_uvector<int> cols(m - 1, stream);
+  rmm::device_uvector<float> weights(m - 1, stream);
+  raft::update_device(rows.data(), h_rows.data(), m - 1, stream);
+  raft::update_device(cols.data(), h_cols.data(), m - 1, stream);
+  raft::update_device(weights.data(), h_weights.data(), m - 1, stream);
+
+  rmm::device_uvector<int> children_host(2 * (m - 1), stream);
+  rmm::device_uvector<int> children_device(2 * (m - 1), stream);
+  rmm::device_uvector<float> delta_host(m - 1, stream);
+  rmm::device_uvector<float> delta_device(m - 1, stream);
+  rmm::device_uvector<int> size_host(m - 1, stream);
+  rmm::device_uvector<int> size_device(m - 1, stream);
+  raft::cluster::detail::build_dendrogram_host<int, float>(handle,
+                                                           rows.data(),
+                                                           cols.data(),
+                                                           weights.data(),
+                                                           m - 1,
+                                                           children_host.data(),
+                                                           delta_host.data(),
+                                                           size_host.data());
+  raft::cluster::detail::build_dendrogram_device<int, float>(handle,
+                                                             rows.data(),
+                                                             cols.data(),
+                                                             weights.data(),
+                                                             m - 1,
+                                                             children_device.data(),
+                                                             delta_device.data(),
+                                                             size_device.data());
+
+  ASSERT_TRUE(devArrMatch(
+    children_host.data(), children_device.data(), 2 * (m - 1), Compare<int>(), stream));
+  ASSERT_TRUE(devArrMatch(size_host.data(), size_device.data(), m - 1, Compare<int>(), stream));
+  ASSERT_TRUE(devArrMatch(delta_host.data(), delta_device.data(), m - 1, Compare<float>(), stream));
+
+  // the flat clusters (of the chain, too) are found in log2(m) rounds
+  const int n_clusters = std::min(m, 5);
+  rmm::device_uvector<int> labels(m, stream);
+  raft::cluster::detail::extract_flattened_clusters(
+    handle, labels.data(), children_device.data(), n_clusters, m);
+  std::vector<int> h_labels(m);
+  raft::update_host(h_labels.data(), labels.data(), m, stream);
+  resource::sync_stream(handle, stream);
+  for (int v = 0; v < m; v++) {
+    ASSERT_GE(h_labels[v], 0);
+    ASSERT_LT(h_labels[v], n_clusters);
+  }
+  // the edges of the first m - n_clusters merges join points of the same cluster
+  for (int e = 0; e < m - n_clusters; e++) {
+    ASSERT_EQ(h_labels[h_rows[e]], h_labels[h_cols[e]]);
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(DendrogramTest,
+                        DendrogramTest,
+                        ::testing::Combine(::testing::Values(2, 3, 100, 1000, 4097),
+                                           ::testing::Bool()));
 }  // end namespace raft
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <raft/comms/detail/util.hpp>
+#include <raft/comms/std_comms.hpp>
+#include <raft/core/device_resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <nccl.h>
+
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+namespace raft {
+
+/**
+ * A clique of ranks within the test process, one per device, every one with its raft::resources
+ * holding a NCCL-only std_comms (collectives and device p2p). The ranks are driven by one thread
+ * each, as the processes of a distributed run would be, so a single-rank clique runs the
+ * distributed code paths on any machine with one device.
+ */
+class nccl_clique {
+ public:
+  explicit nccl_clique(int n_ranks) : n_ranks_(n_ranks), nccl_comms_(n_ranks)
+  {
+    std::vector<int> devices(n_ranks);
+    std::iota(devices.begin(), devices.end(), 0);
+    RAFT_NCCL_TRY(ncclCommInitAll(nccl_comms_.data(), n_ranks, devices.data()));
+    for (int r = 0; r < n_ranks; r++) {
+      RAFT_CUDA_TRY(cudaSetDevice(r));
+      handles_.emplace_back(std::make_unique<raft::device_resources>());
+      raft::comms::build_comms_nccl_only(handles_[r].get(), nccl_comms_[r], n_ranks, r);
+    }
+    RAFT_CUDA_TRY(cudaSetDevice(0));
+  }
+
+  ~nccl_clique()
+  {
+    for (int r = 0; r < n_ranks_; r++) {
+      RAFT_CUDA_TRY_NO_THROW(cudaSetDevice(r));
+      handles_[r].reset();
+      RAFT_NCCL_TRY_NO_THROW(ncclCommDestroy(nccl_comms_[r]));
+    }
+    RAFT_CUDA_TRY_NO_THROW(cudaSetDevice(0));
+  }
+
+  /** Whether the machine has a device for each of `n_ranks` ranks. */
+  static auto fits(int n_ranks) -> bool
+  {
+    int n_devices = 0;
+    RAFT_CUDA_TRY(cudaGetDeviceCount(&n_devices));
+    return n_ranks <= n_devices;
+  }
+
+  [[nodiscard]] auto size() const -> int { return n_ranks_; }
+
+  /** Run f(rank, resources of the rank) in one thread per rank, on the device of the rank. */
+  template <typename Func>
+  void run(Func f)
+  {
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(n_ranks_);
+    for (int r = 0; r < n_ranks_; r++) {
+      threads.emplace_back([this, &f, &errors, r]() {
+        try {
+          RAFT_CUDA_TRY(cudaSetDevice(r));
+          f(r, *handles_[r]);
+        } catch (...) {
+          errors[r] = std::current_exception();
+        }
+      });
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    for (auto& e : errors) {
+      if (e) { std::rethrow_exception(e); }
+    }
+  }
+
+ private:
+  int n_ranks_;
+  std::vector<ncclComm_t> nccl_comms_;
+  std::vector<std::unique_ptr<raft::device_resources>> handles_;
+};
+
+}  // namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -25,6 +25,7 @@
 
 #include <algorithm>
 #include <numeric>
+#include <vector>
 
 namespace raft::core {
 
@@ -199,4 +200,117 @@ using Uint64_64 = BitsetTest<uint64_t, uint64_t>;
 TEST_P(Uint64_64, Run) { run(); }
 INSTANTIATE_TEST_CASE_P(BitsetTest, Uint64_64, inputs_bitset);
 
+template <typename bitset_t, typename index_t>
+class BitsetOpsTest : public testing::TestWithParam<test_spec_bitset> {
+ protected:
+  index_t static constexpr const bitset_element_size = sizeof(bitset_t) * 8;
+  const test_spec_bitset spec;
+  raft::resources res;
+
+ public:
+  explicit BitsetOpsTest() : spec(testing::TestWithParam<test_spec_bitset>::GetParam()) {}
+
+  auto make_bitset(raft::random::RngState& rng, std::vector<bitset_t>& cpu)
+    -> raft::core::bitset<bitset_t, index_t>
+  {
+    auto stream      = resource::get_cuda_stream(res);
+    auto mask_device = raft::make_device_vector<index_t, index_t>(res, spec.mask_len);
+    std::vector<index_t> mask_cpu(spec.mask_len);
+    raft::random::uniformInt(res, rng, mask_device.view(), index_t(0), index_t(spec.bitset_len));
+    update_host(mask_cpu.data(), mask_device.data_handle(), mask_device.extent(0), stream);
+    resource::sync_stream(res, stream);
+    cpu.resize(raft::ceildiv(spec.bitset_len, uint64_t(bitset_element_size)));
+    create_cpu_bitset(cpu, mask_cpu);
+    return raft::core::bitset<bitset_t, index_t>(
+      res, raft::make_const_mdspan(mask_device.view()), index_t(spec.bitset_len));
+  }
+
+  void run()
+  {
+    auto stream = resource::get_cuda_stream(res);
+    raft::random::RngState rng(42);
+    std::vector<bitset_t> a_cpu, b_cpu, c_cpu;
+    auto a = make_bitset(rng, a_cpu);
+    auto b = make_bitset(rng, b_cpu);
+    auto c = make_bitset(rng, c_cpu);
+    c.flip(res);
+    flip_cpu_bitset(c_cpu);
+
+    // (a & b) & ~c, and its reference
+    auto combined = raft::core::bitset<bitset_t, index_t>(res, index_t(spec.bitset_len));
+    raft::core::bitset_combine<bitset_t, index_t>(res,
+                                                  {a.view(), b.view(), c.view()},
+                                                  {bitset_op::AND, bitset_op::AND_NOT},
+                                                  combined.view());
+    std::vector<index_t> indices_ref;
+    for (uint64_t i = 0; i < spec.bitset_len; i++) {
+      auto e   = i / bitset_element_size;
+      auto bit = bitset_t{1} << (i % bitset_element_size);
+      if ((a_cpu[e] & bit) && (b_cpu[e] & bit) && !(c_cpu[e] & bit)) {
+        indices_ref.push_back(index_t(i));
+      }
+    }
+    auto n_ref = index_t(indices_ref.size());
+    ASSERT_EQ(combined.count(res), n_ref);
+
+    // the fused count, and an estimate that samples every element
+    std::vector<bitset_view<const bitset_t, index_t>> inputs{a.view(), b.view(), c.view()};
+    std::vector<bitset_op> ops{bitset_op::AND, bitset_op::AND_NOT};
+    auto count_gpu = raft::make_device_scalar<index_t>(res, 0);
+    index_t count_cpu;
+    raft::core::bitset_count(res, inputs, ops, count_gpu.view());
+    update_host(&count_cpu, count_gpu.data_handle(), 1, stream);
+    resource::sync_stream(res, stream);
+    ASSERT_EQ(count_cpu, n_ref);
+    raft::core::bitset_estimate_count(res, inputs, ops, count_gpu.view(), combined.n_elements());
+    update_host(&count_cpu, count_gpu.data_handle(), 1, stream);
+    resource::sync_stream(res, stream);
+    ASSERT_EQ(count_cpu, n_ref);
+    // a sampled estimate stays within the possible range
+    raft::core::bitset_estimate_count(res, inputs, ops, count_gpu.view(), index_t(16));
+    update_host(&count_cpu, count_gpu.data_handle(), 1, stream);
+    resource::sync_stream(res, stream);
+    ASSERT_LE(count_cpu, index_t(spec.bitset_len));
+
+    // select: the compact list of the ids set
+    auto indices = combined.to_indices(res);
+    std::vector<index_t> indices_cpu(indices.size());
+    update_host(indices_cpu.data(), indices.data_handle(), indices.size(), stream);
+    resource::sync_stream(res, stream);
+    ASSERT_TRUE(hostVecMatch(indices_ref, indices_cpu, raft::Compare<index_t>()));
+
+    // rank: the position of every id set among the ids set
+    auto ranks = raft::make_device_vector<index_t, index_t>(res, indices.size());
+    combined.rank(res, raft::make_const_mdspan(indices.view()), ranks.view());
+    std::vector<index_t> ranks_cpu(indices.size());
+    std::vector<index_t> ranks_ref(indices.size());
+    std::iota(ranks_ref.begin(), ranks_ref.end(), index_t(0));
+    update_host(ranks_cpu.data(), ranks.data_handle(), ranks.size(), stream);
+    resource::sync_stream(res, stream);
+    ASSERT_TRUE(hostVecMatch(ranks_ref, ranks_cpu, raft::Compare<index_t>()));
+
+    // the combination in place, by one operand
+    raft::core::bitset_combine<bitset_t, index_t>(res, {a.view()}, {}, combined.view());
+    ASSERT_EQ(combined.count(res), a.count(res));
+  }
+};
+
+auto inputs_bitset_ops = ::testing::Values(test_spec_bitset{32, 5, 0},
+                                           test_spec_bitset{100, 30, 0},
+                                           test_spec_bitset{1024, 255, 0},
+                                           test_spec_bitset{10000, 700, 0},
+                                           test_spec_bitset{1 << 20, 1 << 19, 0});
+
+using OpsUint8_32 = BitsetOpsTest<uint8_t, uint32_t>;
+TEST_P(OpsUint8_32, Run) { run(); }
+INSTANTIATE_TEST_CASE_P(BitsetOpsTest, OpsUint8_32, inputs_bitset_ops);
+
+using OpsUint32_32 = BitsetOpsTest<uint32_t, uint32_t>;
+TEST_P(OpsUint32_32, Run) { run(); }
+INSTANTIATE_TEST_CASE_P(BitsetOpsTest, OpsUint32_32, inputs_bitset_ops);
+
+using OpsUint64_64 = BitsetOpsTest<uint64_t, uint64_t>;
+TEST_P(OpsUint64_64, Run) { run(); }
+INSTANTIATE_TEST_CASE_P(BitsetOpsTest, OpsUint64_64, inputs_bitset_ops);
+
 }  // namespace raft::core
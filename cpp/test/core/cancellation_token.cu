@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/cancellation_token.hpp>
+#include <raft/core/resource/cancellation_token.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_scalar.hpp>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+namespace raft {
+
+namespace {
+// Spin until the work is cancelled (or for a bounded number of rounds)
+__global__ void spin_kernel(const volatile int* flag, int* rounds)
+{
+  int i = 0;
+  while (!raft::is_cancelled(flag) && i < (1 << 30)) {
+    i++;
+  }
+  *rounds = i;
+}
+}  // namespace
+
+TEST(CancellationToken, CancelAndReset)
+{
+  raft::resources res;
+  // nothing is checked before the token is requested
+  EXPECT_NO_THROW(resource::check_cancellation(res));
+  EXPECT_EQ(nullptr, resource::get_cancellation_flag(res));
+
+  auto& token = resource::get_cancellation_token(res);
+  EXPECT_NO_THROW(resource::check_cancellation(res));
+  token.cancel();
+  EXPECT_THROW(resource::check_cancellation(res), raft::interrupted_exception);
+
+  // the copies of the resources share the token
+  raft::resources res_copy(res);
+  EXPECT_THROW(resource::check_cancellation(res_copy), raft::interrupted_exception);
+
+  token.reset();
+  EXPECT_NO_THROW(resource::check_cancellation(res_copy));
+}
+
+TEST(CancellationToken, Deadline)
+{
+  raft::resources res;
+  {
+    resource::scoped_deadline deadline(res, std::chrono::hours(1));
+    EXPECT_NO_THROW(resource::check_cancellation(res));
+  }
+  {
+    resource::scoped_deadline deadline(res, std::chrono::milliseconds(0));
+    EXPECT_THROW(resource::check_cancellation(res), raft::deadline_exceeded_exception);
+    // the flag is raised for the kernels as well
+    EXPECT_TRUE(resource::get_cancellation_token(res).is_cancelled());
+  }
+  EXPECT_NO_THROW(resource::check_cancellation(res));
+  EXPECT_FALSE(resource::get_cancellation_token(res).deadline().has_value());
+}
+
+TEST(CancellationToken, KernelPolling)
+{
+  raft::resources res;
+  auto stream = resource::get_cuda_stream(res);
+  auto& token = resource::get_cancellation_token(res);
+  rmm::device_scalar<int> rounds(stream);
+
+  spin_kernel<<<1, 1, 0, stream>>>(resource::get_cancellation_flag(res), rounds.data());
+  RAFT_CUDA_TRY(cudaPeekAtLastError());
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  token.cancel();
+  // the kernel sees the host-side cancellation and returns early
+  EXPECT_LT(rounds.value(stream), 1 << 30);
+  token.reset();
+}
+
+}  // namespace raft
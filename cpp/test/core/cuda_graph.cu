@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_graph.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/map.cuh>
+#include <raft/matrix/init.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/cuda_stream.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace raft {
+
+TEST(CudaGraph, CaptureAndReplay)
+{
+  raft::resources res;
+  rmm::cuda_stream stream{};
+  resource::set_cuda_stream(res, stream.view());
+  constexpr int n = 1000;
+  auto in         = raft::make_device_vector<float, int>(res, n);
+  auto out        = raft::make_device_vector<float, int>(res, n);
+
+  // a temporary buffer from the workspace between two kernels
+  auto calls = [&](raft::resources const& graph_res) {
+    rmm::device_uvector<float> tmp(
+      n, resource::get_cuda_stream(graph_res), resource::get_workspace_resource(graph_res));
+    auto tmp_view = raft::make_device_vector_view<float, int>(tmp.data(), n);
+    raft::linalg::map(
+      graph_res, tmp_view, raft::mul_const_op<float>(2.0f), raft::make_const_mdspan(in.view()));
+    raft::linalg::map(
+      graph_res, out.view(), raft::add_const_op<float>(1.0f), raft::make_const_mdspan(tmp_view));
+  };
+
+  auto check = [&](float value) {
+    std::vector<float> h(n);
+    raft::update_host(h.data(), out.data_handle(), n, stream.view());
+    resource::sync_stream(res);
+    for (auto v : h) {
+      ASSERT_EQ(2.0f * value + 1.0f, v);
+    }
+  };
+
+  // the first call runs eagerly and captures the graph
+  raft::matrix::fill(res, in.view(), 1.0f);
+  resource::run_as_cuda_graph(res, 42, calls);
+  check(1.0f);
+  EXPECT_EQ(1, resource::get_cuda_graph_cache(res).size());
+
+  // the next calls replay it on the new contents of the same input
+  for (float value : {3.0f, 5.0f}) {
+    raft::matrix::fill(res, in.view(), value);
+    raft::matrix::fill(res, out.view(), 0.0f);
+    resource::run_as_cuda_graph(res, 42, [](raft::resources const&) { FAIL(); });
+    check(value);
+  }
+  EXPECT_FALSE(resource::is_stream_capturing(res));
+
+  resource::clear_cuda_graphs(res);
+  EXPECT_EQ(0, resource::get_cuda_graph_cache(res).size());
+}
+
+}  // namespace raft
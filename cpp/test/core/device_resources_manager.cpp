@@ -16,6 +16,7 @@
 #include <raft/core/device_resources_manager.hpp>
 #include <raft/core/device_setter.hpp>
 #include <raft/core/logger.hpp>
+#include <raft/core/resource/stream_priority.hpp>
 
 #include <rmm/mr/device/cuda_memory_resource.hpp>
 #include <rmm/mr/device/limiting_resource_adaptor.hpp>
@@ -51,13 +52,17 @@ TEST(DeviceResourcesManager, ObeysSetters)
   auto streams_per_pool   = 7;
   auto workspace_limit    = 2048;
   auto workspace_init     = 1024;
+  auto priority_streams   = 2;
   device_resources_manager::set_streams_per_device(streams_per_device);
   device_resources_manager::set_stream_pools_per_device(pools_per_device, streams_per_pool);
   device_resources_manager::set_mem_pool();
   device_resources_manager::set_workspace_allocation_limit(workspace_limit);
+  device_resources_manager::set_priority_streams_per_device(priority_streams);
 
-  auto unique_streams = std::array<std::set<cudaStream_t>, 2>{};
-  auto unique_pools   = std::array<std::set<rmm::cuda_stream_pool const*>, 2>{};
+  auto unique_streams      = std::array<std::set<cudaStream_t>, 2>{};
+  auto unique_pools        = std::array<std::set<rmm::cuda_stream_pool const*>, 2>{};
+  auto unique_high_streams = std::array<std::set<cudaStream_t>, 2>{};
+  auto unique_low_streams  = std::array<std::set<cudaStream_t>, 2>{};
 
   // Provide lock for counting unique objects
   auto mtx = std::mutex{};
@@ -128,16 +133,47 @@ TEST(DeviceResourcesManager, ObeysSetters)
       EXPECT_NE(workspace_mr, nullptr);
     }
 
+    auto const& high_res =
+      device_resources_manager::get_device_resources(stream_priority::high, device);
+    auto const& low_res =
+      device_resources_manager::get_device_resources(stream_priority::low, device);
+    auto high_stream = high_res.get_stream().value();
+    auto low_stream  = low_res.get_stream().value();
+    // Expect the same lane resources every time for a given thread
+    EXPECT_EQ(
+      high_stream,
+      device_resources_manager::get_device_resources(stream_priority::high).get_stream().value());
+    EXPECT_NE(high_stream, primary_stream);
+    EXPECT_NE(low_stream, primary_stream);
+    // Expect the lanes to use the extreme priorities of the device
+    auto least_priority    = 0;
+    auto greatest_priority = 0;
+    RAFT_CUDA_TRY(cudaDeviceGetStreamPriorityRange(&least_priority, &greatest_priority));
+    auto high_priority = 0;
+    auto low_priority  = 0;
+    RAFT_CUDA_TRY(cudaStreamGetPriority(high_stream, &high_priority));
+    RAFT_CUDA_TRY(cudaStreamGetPriority(low_stream, &low_priority));
+    EXPECT_EQ(greatest_priority, high_priority);
+    EXPECT_EQ(least_priority, low_priority);
+    EXPECT_EQ(stream_priority::high, resource::get_stream_priority(high_res));
+    EXPECT_EQ(stream_priority::low, resource::get_stream_priority(low_res));
+    EXPECT_EQ(stream_priority::normal, resource::get_stream_priority(res));
+    // Expect the lanes to share the stream pools of the primary streams
+    EXPECT_EQ(&pool, &low_res.get_stream_pool());
+
     {
       auto lock = std::unique_lock{mtx};
       unique_streams[device].insert(primary_stream);
       unique_pools[device].insert(&pool);
+      unique_high_streams[device].insert(high_stream);
+      unique_low_streams[device].insert(low_stream);
     }
     // Ensure that setters have no effect after get_device_resources call
     device_resources_manager::set_streams_per_device(streams_per_device + 1);
     device_resources_manager::set_stream_pools_per_device(pools_per_device - 1);
     device_resources_manager::set_mem_pool();
     device_resources_manager::set_workspace_allocation_limit(1024);
+    device_resources_manager::set_priority_streams_per_device(priority_streams + 1);
     device_resources_manager::set_workspace_memory_resource(
       alternate_workspace_mrs[i % devices.size()], devices[i % devices.size()]);
   }
@@ -146,6 +182,10 @@ TEST(DeviceResourcesManager, ObeysSetters)
   EXPECT_EQ(streams_per_device, unique_streams[devices[1]].size());
   EXPECT_EQ(pools_per_device, unique_pools[devices[0]].size());
   EXPECT_EQ(pools_per_device, unique_pools[devices[1]].size());
+  EXPECT_EQ(priority_streams, unique_high_streams[devices[0]].size());
+  EXPECT_EQ(priority_streams, unique_high_streams[devices[1]].size());
+  EXPECT_EQ(priority_streams, unique_low_streams[devices[0]].size());
+  EXPECT_EQ(priority_streams, unique_low_streams[devices[1]].size());
 }
 
 }  // namespace raft
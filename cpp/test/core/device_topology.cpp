@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <raft/core/device_resources.hpp>
+#include <raft/core/device_topology.hpp>
+#include <raft/core/pinned_mdarray.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace raft {
+
+TEST(DeviceTopology, ParseCpuList)
+{
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 8, 10, 11}), detail::parse_cpu_list("0-3,8,10-11"));
+  EXPECT_EQ(std::vector<int>{}, detail::parse_cpu_list(""));
+  EXPECT_EQ(std::vector<int>{}, detail::parse_cpu_list("not a list"));
+}
+
+TEST(DeviceTopology, Device)
+{
+  auto topology = get_device_topology(0);
+  EXPECT_EQ(0, topology.device_id);
+  EXPECT_FALSE(topology.pci_bus_id.empty());
+  EXPECT_GE(topology.numa_node, -1);
+  // the second query is served from the cache
+  EXPECT_EQ(topology.cpus, get_device_topology(0).cpus);
+}
+
+TEST(DeviceTopology, AffinitySetterRestores)
+{
+#ifdef __linux__
+  cpu_set_t before, after;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(before), &before));
+  {
+    auto scoped_affinity = cpu_affinity_setter{std::vector<int>{sched_getcpu()}};
+    cpu_set_t inside;
+    ASSERT_EQ(0, sched_getaffinity(0, sizeof(inside), &inside));
+    EXPECT_EQ(1, CPU_COUNT(&inside));
+  }
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(after), &after));
+  EXPECT_TRUE(CPU_EQUAL(&before, &after));
+#endif
+  // pinned allocations go through the setter of the device of the resources
+  auto res = device_resources{};
+  auto buf = make_pinned_vector<float, int>(res, 1000);
+  EXPECT_EQ(1000, buf.extent(0));
+}
+
+}  // namespace raft
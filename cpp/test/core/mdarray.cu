@@ -22,6 +22,7 @@
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/host_container_policy.hpp>
 #include <raft/core/host_mdarray.hpp>
+#include <raft/core/managed_mdarray.hpp>
 #include <raft/core/managed_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
@@ -411,6 +412,54 @@ void test_factory_methods()
 
 TEST(MDArray, Factory) { test_factory_methods(); }
 
+TEST(MDArray, ManagedAdvice)
+{
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+
+  managed_memory_advice advice;
+  advice.read_mostly        = true;
+  advice.preferred_location = managed_memory_location::HOST;
+  advice.prefetch_on_create = true;
+  auto mda = make_managed_matrix<float, int>(handle, 32, 16, advice);
+  static_assert(decltype(mda)::accessor_type::is_managed_accessible, "Not managed mdarray");
+
+  // the hints are applied only where the device supports concurrent managed access
+  bool prefetchable = is_prefetchable_managed_ptr(mda.data_handle());
+  if (prefetchable) {
+    int read_mostly = 0;
+    RAFT_CUDA_TRY(cudaMemRangeGetAttribute(&read_mostly,
+                                           sizeof(read_mostly),
+                                           cudaMemRangeAttributeReadMostly,
+                                           mda.data_handle(),
+                                           mda.size() * sizeof(float)));
+    ASSERT_EQ(read_mostly, 1);
+    int location = 0;
+    RAFT_CUDA_TRY(cudaMemRangeGetAttribute(&location,
+                                           sizeof(location),
+                                           cudaMemRangeAttributePreferredLocation,
+                                           mda.data_handle(),
+                                           mda.size() * sizeof(float)));
+    ASSERT_EQ(location, cudaCpuDeviceId);
+  }
+
+  // the data stays usable from the device and the host
+  thrust::sequence(
+    resource::get_thrust_policy(handle), mda.data_handle(), mda.data_handle() + mda.size());
+  ASSERT_EQ(
+    managed_prefetch_async(mda.data_handle(), mda.size() * sizeof(float), cudaCpuDeviceId, stream),
+    prefetchable);
+  resource::sync_stream(handle, stream);
+  for (int i = 0; i < int(mda.size()); i++) {
+    ASSERT_EQ(mda.data_handle()[i], float(i));
+  }
+
+  // device memory is left alone
+  auto d = make_device_vector<float, int>(handle, 10);
+  ASSERT_FALSE(is_prefetchable_managed_ptr(d.data_handle()));
+  ASSERT_FALSE(managed_prefetch_async(handle, d.data_handle(), 10 * sizeof(float)));
+}
+
 namespace {
 template <typename T, typename Index, typename LayoutPolicy>
 void check_matrix_layout(device_matrix_view<T, Index, LayoutPolicy> in)
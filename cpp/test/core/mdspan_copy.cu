@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,9 @@
 #include <raft/core/device_resources.hpp>
 #include <raft/core/host_mdarray.hpp>
 
+#include <array>
+#include <vector>
+
 namespace raft {
 TEST(MDSpanCopy, Mdspan3DDeviceDeviceCuda)
 {
@@ -430,4 +433,92 @@ TEST(MDSpanCopy, Mdspan2DHostDeviceCuda)
   }
 }
 
+TEST(MDSpanCopy, Mdspan2DPitchedHostDeviceCuda)
+{
+  auto res             = device_resources{};
+  auto constexpr rows  = std::uint32_t{30};
+  auto constexpr cols  = std::uint32_t{20};
+  auto constexpr pitch = std::uint32_t{32};
+
+  auto gen_unique_entry = [](auto&& x, auto&& y) { return x * 7 + y * 11; };
+
+  // Rows padded to the pitch, as in a padded index dataset
+  auto in_buf = std::vector<int>(rows * pitch, -1);
+  auto in     = host_matrix_view<int, std::uint32_t, layout_stride>{
+    in_buf.data(),
+    make_strided_layout(matrix_extent<std::uint32_t>{rows, cols},
+                        std::array<std::uint32_t, 2>{pitch, 1})};
+  for (auto i = std::uint32_t{}; i < rows; ++i) {
+    for (auto j = std::uint32_t{}; j < cols; ++j) {
+      in(i, j) = gen_unique_entry(i, j);
+    }
+  }
+
+  auto out = make_device_matrix<int, std::uint32_t>(res, rows, cols);
+  copy(res, out.view(), in);
+  res.sync_stream();
+  for (auto i = std::uint32_t{}; i < rows; ++i) {
+    for (auto j = std::uint32_t{}; j < cols; ++j) {
+      ASSERT_EQ(int(out(i, j)), int(gen_unique_entry(i, j)));
+    }
+  }
+
+  // Back into rows padded to another pitch, leaving the padding as is
+  auto back_pitch = pitch + 8;
+  auto back_buf   = std::vector<int>(rows * back_pitch, -1);
+  auto back       = host_matrix_view<int, std::uint32_t, layout_stride>{
+    back_buf.data(),
+    make_strided_layout(matrix_extent<std::uint32_t>{rows, cols},
+                        std::array<std::uint32_t, 2>{back_pitch, 1})};
+  copy(res, back, make_const_mdspan(out.view()));
+  res.sync_stream();
+  for (auto i = std::uint32_t{}; i < rows; ++i) {
+    for (auto j = std::uint32_t{}; j < back_pitch; ++j) {
+      ASSERT_EQ(back_buf[i * back_pitch + j], j < cols ? int(gen_unique_entry(i, j)) : -1);
+    }
+  }
+}
+
+TEST(MDSpanCopy, Mdspan3DPitchedDeviceDeviceCuda)
+{
+  auto res              = device_resources{};
+  auto constexpr depth  = std::uint32_t{5};
+  auto constexpr rows   = std::uint32_t{6};
+  auto constexpr cols   = std::uint32_t{7};
+  auto constexpr pitch  = std::uint32_t{8};
+  auto constexpr height = std::uint32_t{7};
+  auto gen_unique_entry = [](auto&& x, auto&& y, auto&& z) { return x * 7 + y * 11 + z * 13; };
+
+  // Padded rows in slices padded to `height` rows
+  auto in_host = std::vector<int>(depth * height * pitch, -1);
+  for (auto i = std::uint32_t{}; i < depth; ++i) {
+    for (auto j = std::uint32_t{}; j < rows; ++j) {
+      for (auto k = std::uint32_t{}; k < cols; ++k) {
+        in_host[(i * height + j) * pitch + k] = gen_unique_entry(i, j, k);
+      }
+    }
+  }
+  auto in_buf = make_device_vector<int, std::uint32_t>(res, in_host.size());
+  raft::copy(in_buf.data_handle(), in_host.data(), in_host.size(), res.get_stream());
+  using extents_type = extents<std::uint32_t, dynamic_extent, dynamic_extent, dynamic_extent>;
+  auto in            = device_mdspan<const int, extents_type, layout_stride>{
+    in_buf.data_handle(),
+    make_strided_layout(make_extents<std::uint32_t>(depth, rows, cols),
+                        std::array<std::uint32_t, 3>{height * pitch, pitch, 1})};
+
+  auto out = make_device_mdarray<int, std::uint32_t, layout_c_contiguous>(
+    res, make_extents<std::uint32_t>(depth, rows, cols));
+  copy(res, out.view(), in);
+  auto out_host = std::vector<int>(out.size());
+  raft::copy(out_host.data(), out.data_handle(), out.size(), res.get_stream());
+  res.sync_stream();
+  for (auto i = std::uint32_t{}; i < depth; ++i) {
+    for (auto j = std::uint32_t{}; j < rows; ++j) {
+      for (auto k = std::uint32_t{}; k < cols; ++k) {
+        ASSERT_EQ(out_host[(i * rows + j) * cols + k], int(gen_unique_entry(i, j, k)));
+      }
+    }
+  }
+}
+
 }  // namespace raft
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <raft/core/metrics.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/resource/metrics.hpp>
+#include <raft/core/resource/resource_types.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/cuda_stream.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace raft {
+
+namespace {
+// Busy-wait on the device for roughly the given number of clock cycles
+__global__ void sleep_kernel(long long int cycles)
+{
+  auto start = clock64();
+  while (clock64() - start < cycles) {}
+}
+}  // namespace
+
+TEST(Metrics, DisabledByDefault)
+{
+  raft::resources res;
+  {
+    resource::scoped_call call(res, "noop");
+    EXPECT_FALSE(call.enabled());
+    call.set_batch_size(10);
+    call.set_algo("none");
+  }
+  // the instrumentation does not create the sink
+  EXPECT_FALSE(res.has_resource_factory(resource::resource_type::METRICS_SINK));
+}
+
+TEST(Metrics, Scrape)
+{
+  raft::resources res;
+  auto stream = resource::get_cuda_stream(res);
+  auto sink   = std::make_shared<metrics_sink>(16);
+  resource::set_metrics_sink(res, sink);
+  EXPECT_EQ(&resource::get_metrics_sink(res), sink.get());
+
+  // the copies of the resources share the sink
+  raft::resources res_copy(res);
+  for (int i = 0; i < 3; i++) {
+    resource::scoped_call call(i % 2 == 0 ? res : res_copy, "sleep");
+    ASSERT_TRUE(call.enabled());
+    call.set_batch_size(i);
+    call.set_algo("a_very_long_algorithm_name_that_does_not_fit");
+    sleep_kernel<<<1, 1, 0, stream>>>(1000000);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+  {
+    resource::scoped_call call(res, "empty");
+  }
+
+  std::vector<call_record> records;
+  ASSERT_EQ(sink->scrape(records, true), 4u);
+  ASSERT_EQ(records.size(), 4u);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(records[i].seq, uint64_t(i));
+    EXPECT_STREQ(records[i].api, "sleep");
+    EXPECT_EQ(records[i].batch_size, i);
+    EXPECT_EQ(std::strlen(records[i].algo), sizeof(records[i].algo) - 1);
+    EXPECT_GT(records[i].gpu_time_ms, 0.0f);
+  }
+  EXPECT_STREQ(records[3].api, "empty");
+  EXPECT_EQ(records[3].batch_size, -1);
+  EXPECT_STREQ(records[3].algo, "");
+  EXPECT_GE(records[3].gpu_time_ms, 0.0f);
+  EXPECT_LT(records[3].gpu_time_ms, records[0].gpu_time_ms);
+  EXPECT_EQ(sink->dropped(), 0u);
+
+  // the records are consumed by the scrape
+  records.clear();
+  EXPECT_EQ(sink->scrape(records), 0u);
+}
+
+TEST(Metrics, Workspace)
+{
+  raft::resources res;
+  auto stream = resource::get_cuda_stream(res);
+  auto& sink  = resource::get_metrics_sink(res);
+  rmm::device_uvector<char> before(1024, stream, resource::get_workspace_resource(res));
+  {
+    resource::scoped_call call(res, "alloc");
+    rmm::device_uvector<char> buf(1 << 20, stream, resource::get_workspace_resource(res));
+    call.note_workspace();
+  }
+  std::vector<call_record> records;
+  ASSERT_EQ(sink.scrape(records, true), 1u);
+  // counted above the usage at the start of the call
+  EXPECT_GE(records[0].workspace_bytes, std::size_t(1 << 20));
+  EXPECT_LT(records[0].workspace_bytes, std::size_t(1 << 20) + 1024);
+}
+
+TEST(Metrics, Overflow)
+{
+  raft::resources res;
+  auto sink = std::make_shared<metrics_sink>(4);
+  resource::set_metrics_sink(res, sink);
+  for (int i = 0; i < 10; i++) {
+    resource::scoped_call call(res, "call");
+    call.set_batch_size(i);
+  }
+  // the oldest records are overwritten
+  std::vector<call_record> records;
+  ASSERT_EQ(sink->scrape(records, true), 4u);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(records[i].batch_size, 6 + i);
+  }
+  EXPECT_EQ(sink->dropped(), 6u);
+
+  // a call is not recorded while its slot is taken by a call in progress
+  {
+    resource::scoped_call outer(res, "outer");
+    for (int i = 0; i < 4; i++) {
+      resource::scoped_call call(res, "inner");
+    }
+    EXPECT_TRUE(outer.enabled());
+  }
+  records.clear();
+  ASSERT_EQ(sink->scrape(records, true), 4u);
+  EXPECT_STREQ(records[0].api, "outer");
+  EXPECT_EQ(sink->dropped(), 7u);
+}
+
+TEST(Metrics, ConcurrentCalls)
+{
+  constexpr int kThreads = 4;
+  constexpr int kCalls   = 100;
+  auto sink              = std::make_shared<metrics_sink>(kThreads * kCalls);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&sink, t]() {
+      raft::resources res;
+      resource::set_metrics_sink(res, sink);
+      for (int i = 0; i < kCalls; i++) {
+        resource::scoped_call call(res, "call");
+        call.set_batch_size(t);
+      }
+    });
+  }
+  // scrape concurrently with the recording
+  std::vector<call_record> records;
+  while (records.size() < kThreads * kCalls) {
+    sink->scrape(records, true);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  std::vector<int> per_thread(kThreads, 0);
+  for (std::size_t i = 0; i < records.size(); i++) {
+    EXPECT_EQ(records[i].seq, i);
+    per_thread[records[i].batch_size]++;
+  }
+  for (int t = 0; t < kThreads; t++) {
+    EXPECT_EQ(per_thread[t], kCalls);
+  }
+  EXPECT_EQ(sink->dropped(), 0u);
+}
+
+TEST(Metrics, GraphCapture)
+{
+  raft::resources res;
+  // the legacy default stream cannot be captured
+  rmm::cuda_stream capture_stream{};
+  resource::set_cuda_stream(res, capture_stream.view());
+  auto stream = resource::get_cuda_stream(res);
+  auto& sink  = resource::get_metrics_sink(res);
+
+  cudaGraph_t graph;
+  RAFT_CUDA_TRY(cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal));
+  {
+    resource::scoped_call call(res, "captured");
+    sleep_kernel<<<1, 1, 0, stream>>>(1000);
+  }
+  RAFT_CUDA_TRY(cudaStreamEndCapture(stream, &graph));
+  RAFT_CUDA_TRY(cudaGraphDestroy(graph));
+
+  // recorded without the GPU time
+  std::vector<call_record> records;
+  ASSERT_EQ(sink.scrape(records), 1u);
+  EXPECT_STREQ(records[0].api, "captured");
+  EXPECT_LT(records[0].gpu_time_ms, 0.0f);
+}
+
+}  // namespace raft
@@ -118,6 +118,45 @@ TEST(NumPySerializerMDSpan, ManagedMDSpan)
   test_mdspan_roundtrip<managed_mdspan_matrix2d_c_layout>(handle, vec, 2, 2, 2);
 }
 
+TEST(NumPySerializerMDSpan, ChunkedDeviceRoundTrip)
+{
+  raft::resources handle{};
+  using device_matrix_c_layout =
+    raft::device_mdspan<float, dextents<std::size_t, 2>, raft::layout_c_contiguous>;
+  using host_matrix_c_layout =
+    raft::host_mdspan<float, dextents<std::size_t, 2>, raft::layout_c_contiguous>;
+
+  std::vector<float> h_vec(1000 * 7);
+  for (std::size_t i = 0; i < h_vec.size(); i++) {
+    h_vec[i] = float(i) * 0.5f;
+  }
+  thrust::device_vector<float> d_vec(h_vec.begin(), h_vec.end());
+  thrust::device_vector<float> d_vec2(h_vec.size());
+  auto span  = device_matrix_c_layout(thrust::raw_pointer_cast(d_vec.data()), 1000, 7);
+  auto span2 = device_matrix_c_layout(thrust::raw_pointer_cast(d_vec2.data()), 1000, 7);
+
+  // the chunks (not a multiple of the element size) leave the format of the host serializer
+  std::size_t chunk_bytes = 1000;
+  std::vector<std::uint64_t> checksums;
+  std::ostringstream oss;
+  serialize_mdspan(handle, oss, span, checksums, chunk_bytes);
+  EXPECT_EQ(checksums.size(), (h_vec.size() * sizeof(float) + chunk_bytes - 1) / chunk_bytes);
+  std::ostringstream oss_host;
+  serialize_mdspan(handle, oss_host, host_matrix_c_layout(h_vec.data(), 1000, 7));
+  EXPECT_EQ(oss.str(), oss_host.str());
+
+  std::istringstream iss(oss.str());
+  deserialize_mdspan(handle, iss, span2, checksums, chunk_bytes);
+  EXPECT_EQ(d_vec, d_vec2);
+
+  // a corrupted byte fails the check of its chunk
+  std::string corrupted = oss.str();
+  corrupted[corrupted.size() - 10] ^= 0x1;
+  std::istringstream iss_corrupted(corrupted);
+  EXPECT_THROW(deserialize_mdspan(handle, iss_corrupted, span2, checksums, chunk_bytes),
+               raft::logic_error);
+}
+
 TEST(NumPySerializerMDSpan, Tuple2String)
 {
   {
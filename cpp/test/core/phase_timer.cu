@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/phase_timer.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/phase_timer.hpp>
+#include <raft/core/resource/resource_types.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/cuda_stream.hpp>
+
+#include <gtest/gtest.h>
+
+namespace raft {
+
+namespace {
+// Busy-wait on the device for roughly the given number of clock cycles
+__global__ void sleep_kernel(long long int cycles)
+{
+  auto start = clock64();
+  while (clock64() - start < cycles) {}
+}
+}  // namespace
+
+TEST(PhaseTimer, DisabledByDefault)
+{
+  raft::resources res;
+  {
+    resource::scoped_phase phase(res, "noop");
+  }
+  // the instrumentation does not create the timer
+  EXPECT_FALSE(res.has_resource_factory(resource::resource_type::PHASE_TIMER));
+}
+
+TEST(PhaseTimer, Collect)
+{
+  raft::resources res;
+  auto stream = resource::get_cuda_stream(res);
+  auto& timer = resource::get_phase_timer(res);
+
+  // the copies of the resources share the timer
+  raft::resources res_copy(res);
+  for (int i = 0; i < 3; i++) {
+    resource::scoped_phase phase(i % 2 == 0 ? res : res_copy, "sleep");
+    sleep_kernel<<<1, 1, 0, stream>>>(1000000);
+    RAFT_CUDA_TRY(cudaPeekAtLastError());
+  }
+  {
+    resource::scoped_phase phase(res, "empty");
+  }
+
+  auto times = timer.collect();
+  ASSERT_EQ(times.size(), 2u);
+  EXPECT_GT(times["sleep"], 0.0);
+  EXPECT_GE(times["empty"], 0.0);
+  EXPECT_LT(times["empty"], times["sleep"]);
+
+  // the times are reset by the collection
+  EXPECT_TRUE(timer.collect().empty());
+}
+
+TEST(PhaseTimer, IgnoresGraphCapture)
+{
+  raft::resources res;
+  // the legacy default stream cannot be captured
+  rmm::cuda_stream capture_stream{};
+  resource::set_cuda_stream(res, capture_stream.view());
+  auto stream = resource::get_cuda_stream(res);
+  auto& timer = resource::get_phase_timer(res);
+
+  cudaGraph_t graph;
+  RAFT_CUDA_TRY(cudaStreamBeginCapture(stream, cudaStreamCaptureModeThreadLocal));
+  {
+    resource::scoped_phase phase(res, "captured");
+    sleep_kernel<<<1, 1, 0, stream>>>(1000);
+  }
+  RAFT_CUDA_TRY(cudaStreamEndCapture(stream, &graph));
+  RAFT_CUDA_TRY(cudaGraphDestroy(graph));
+
+  EXPECT_TRUE(timer.collect().empty());
+}
+
+}  // namespace raft
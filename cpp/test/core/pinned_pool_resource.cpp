@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <raft/core/device_resources.hpp>
+#include <raft/core/memory_type.hpp>
+#include <raft/core/pinned_mdarray.hpp>
+#include <raft/core/pinned_pool_resource.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace raft {
+
+TEST(PinnedPoolResource, ReusesBlocks)
+{
+  auto pool = raft::mr::pinned_pool_resource{1 << 20};
+
+  auto* a = pool.allocate(1000);
+  pool.deallocate(a, 1000);
+  EXPECT_EQ(1024, pool.cached_bytes());
+
+  // a block is reused for the requests of up to twice smaller size
+  auto* b = pool.allocate(600);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(0, pool.cached_bytes());
+  auto* c = pool.allocate(1000);
+  EXPECT_NE(b, c);
+  EXPECT_EQ(2, pool.upstream_allocation_count());
+  pool.deallocate(b, 600);
+  pool.deallocate(c, 1000);
+
+  auto* d = pool.allocate(100);
+  EXPECT_EQ(3, pool.upstream_allocation_count());
+  pool.deallocate(d, 100);
+
+  pool.release();
+  EXPECT_EQ(0, pool.cached_bytes());
+}
+
+TEST(PinnedPoolResource, CacheLimit)
+{
+  auto pool = raft::mr::pinned_pool_resource{4096};
+  auto* a   = pool.allocate(4096);
+  auto* b   = pool.allocate(4096);
+  pool.deallocate(a, 4096);
+  // the cache is full: the second block goes back upstream
+  pool.deallocate(b, 4096);
+  EXPECT_EQ(4096, pool.cached_bytes());
+}
+
+TEST(PinnedPoolResource, PinnedMdarray)
+{
+  auto res = device_resources{};
+  resource::set_pinned_memory_pool(res, 1 << 20);
+  auto* pool =
+    dynamic_cast<raft::mr::pinned_pool_resource*>(resource::get_pinned_memory_resource(res));
+  ASSERT_NE(nullptr, pool);
+
+  float* first = nullptr;
+  for (int i = 0; i < 3; i++) {
+    auto buf = make_pinned_matrix<float, int>(res, 10, 10);
+    EXPECT_EQ(memory_type::pinned, memory_type_from_pointer(buf.data_handle()));
+    EXPECT_EQ(0.0f, buf(9, 9));
+    buf(9, 9) = 1.0f;
+    if (i == 0) { first = buf.data_handle(); }
+    EXPECT_EQ(first, buf.data_handle());
+  }
+  EXPECT_EQ(1, pool->upstream_allocation_count());
+}
+
+}  // namespace raft
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <raft/core/device_resources.hpp>
+#include <raft/core/resource/device_memory_resource.hpp>
+#include <raft/core/workspace_arena_resource.hpp>
+
+#include <rmm/cuda_stream.hpp>
+#include <rmm/device_uvector.hpp>
+#include <rmm/mr/device/cuda_memory_resource.hpp>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace raft {
+
+TEST(WorkspaceArenaResource, ReusesArena)
+{
+  auto upstream = std::make_shared<rmm::mr::cuda_memory_resource>();
+  auto arena    = raft::mr::workspace_arena_resource{upstream, 4096};
+  auto stream   = rmm::cuda_stream{};
+
+  void* first = nullptr;
+  {
+    auto* a = arena.allocate(1000, stream.view());
+    auto* b = arena.allocate(2000, stream.view());
+    first   = a;
+    EXPECT_EQ(4096, arena.capacity());
+    EXPECT_EQ(static_cast<char*>(a) + 1024, static_cast<char*>(b));
+    EXPECT_EQ(3072, arena.arena_used_bytes());
+    arena.deallocate(a, 1000, stream.view());
+    arena.deallocate(b, 2000, stream.view());
+  }
+  EXPECT_EQ(0, arena.arena_used_bytes());
+
+  // the same memory is handed out again once the arena is empty
+  auto* c = arena.allocate(10, stream.view());
+  EXPECT_EQ(first, c);
+  arena.deallocate(c, 10, stream.view());
+  EXPECT_EQ(0, arena.overflow_count());
+}
+
+TEST(WorkspaceArenaResource, GrowsAfterOverflow)
+{
+  auto upstream = std::make_shared<rmm::mr::cuda_memory_resource>();
+  auto arena    = raft::mr::workspace_arena_resource{upstream, 1024};
+  auto stream   = rmm::cuda_stream{};
+
+  auto* a = arena.allocate(1024, stream.view());
+  auto* b = arena.allocate(4096, stream.view());
+  EXPECT_EQ(1, arena.overflow_count());
+  arena.deallocate(b, 4096, stream.view());
+  arena.deallocate(a, 1024, stream.view());
+
+  // the next use of the empty arena regrows it to the peak demand
+  a = arena.allocate(1024, stream.view());
+  b = arena.allocate(4096, stream.view());
+  EXPECT_EQ(1, arena.overflow_count());
+  EXPECT_EQ(5120, arena.capacity());
+  arena.deallocate(b, 4096, stream.view());
+  arena.deallocate(a, 1024, stream.view());
+}
+
+TEST(WorkspaceArenaResource, OtherStreamWhileInUse)
+{
+  auto upstream = std::make_shared<rmm::mr::cuda_memory_resource>();
+  auto arena    = raft::mr::workspace_arena_resource{upstream, 4096};
+  auto stream1  = rmm::cuda_stream{};
+  auto stream2  = rmm::cuda_stream{};
+
+  auto* a = arena.allocate(256, stream1.view());
+  auto* b = arena.allocate(256, stream2.view());
+  EXPECT_EQ(1, arena.overflow_count());
+  arena.deallocate(b, 256, stream2.view());
+  arena.deallocate(a, 256, stream1.view());
+
+  // once empty, the arena is rebound to the new stream
+  b = arena.allocate(256, stream2.view());
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(1, arena.overflow_count());
+  arena.deallocate(b, 256, stream2.view());
+}
+
+TEST(WorkspaceArenaResource, AsWorkspaceResource)
+{
+  auto arena = std::make_shared<raft::mr::workspace_arena_resource>(
+    resource::workspace_resource_factory::default_plain_resource(), 1 << 20);
+  auto res = raft::device_resources{rmm::cuda_stream_per_thread, nullptr, arena};
+  auto* mr = resource::get_workspace_resource(res);
+  for (int i = 0; i < 3; i++) {
+    rmm::device_uvector<float> buf(1000, res.get_stream(), mr);
+    EXPECT_EQ(4096, arena->arena_used_bytes());
+  }
+  EXPECT_EQ(0, arena->arena_used_bytes());
+  EXPECT_EQ(0, arena->overflow_count());
+}
+
+}  // namespace raft
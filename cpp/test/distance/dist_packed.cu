@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/distance/packed_distance.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace raft::distance {
+
+struct PackedDistanceInputs {
+  int m;
+  int n;
+  int dim;  // words for the bit-packed inputs, int8 values otherwise
+  DistanceType metric;
+};
+
+inline auto operator<<(std::ostream& os, const PackedDistanceInputs& p) -> std::ostream&
+{
+  os << "{m: " << p.m << ", n: " << p.n << ", dim: " << p.dim
+     << ", metric: " << static_cast<int>(p.metric) << "}";
+  return os;
+}
+
+template <typename BitsT>
+auto ref_bitwise_distance(const BitsT* x, const BitsT* y, int n_words, DistanceType metric)
+  -> float
+{
+  constexpr int kBits = 8 * sizeof(BitsT);
+  int64_t n_xor = 0, n_and = 0, n_or = 0;
+  for (int i = 0; i < n_words; i++) {
+    n_xor += std::bitset<kBits>(x[i] ^ y[i]).count();
+    n_and += std::bitset<kBits>(x[i] & y[i]).count();
+    n_or += std::bitset<kBits>(x[i] | y[i]).count();
+  }
+  if (metric == DistanceType::HammingUnexpanded) { return float(n_xor) / (kBits * n_words); }
+  return n_or > 0 ? 1.0f - float(n_and) / float(n_or) : 0.0f;
+}
+
+inline auto ref_int8_distance(const int8_t* x, const int8_t* y, int dim, DistanceType metric)
+  -> float
+{
+  int64_t acc = 0;
+  for (int i = 0; i < dim; i++) {
+    acc += metric == DistanceType::InnerProduct ? int64_t(x[i]) * y[i]
+                                                : int64_t(x[i] - y[i]) * (x[i] - y[i]);
+  }
+  return metric == DistanceType::L2SqrtExpanded ? std::sqrt(float(acc)) : float(acc);
+}
+
+template <typename T>
+class PackedDistanceTest : public ::testing::TestWithParam<PackedDistanceInputs> {
+ public:
+  PackedDistanceTest()
+    : params_(::testing::TestWithParam<PackedDistanceInputs>::GetParam()),
+      stream_(resource::get_cuda_stream(handle_))
+  {
+  }
+
+  void run()
+  {
+    std::mt19937_64 gen(42);
+    const int m = params_.m, n = params_.n, dim = params_.dim;
+    std::vector<T> x(size_t(m) * dim), y(size_t(n) * dim);
+    for (auto* v : {&x, &y}) {
+      for (auto& e : *v) {
+        if constexpr (std::is_same_v<T, int8_t>) {
+          e = static_cast<int8_t>(int(gen() % 256) - 128);
+        } else {
+          // sparse-ish codes, so that the Jaccard distances are spread
+          e = static_cast<T>(gen() & gen());
+        }
+      }
+    }
+    // a duplicate row and an all-zero pair exercise the edge cases
+    std::copy(x.begin(), x.begin() + dim, y.begin());
+    std::fill(x.end() - dim, x.end(), T(0));
+    std::fill(y.end() - dim, y.end(), T(0));
+
+    auto d_x    = make_device_matrix<T, int>(handle_, m, dim);
+    auto d_y    = make_device_matrix<T, int>(handle_, n, dim);
+    auto d_dist = make_device_matrix<float, int>(handle_, m, n);
+    update_device(d_x.data_handle(), x.data(), x.size(), stream_);
+    update_device(d_y.data_handle(), y.data(), y.size(), stream_);
+
+    pairwise_distance(handle_,
+                      make_const_mdspan(d_x.view()),
+                      make_const_mdspan(d_y.view()),
+                      d_dist.view(),
+                      params_.metric);
+
+    std::vector<float> dist(size_t(m) * n);
+    update_host(dist.data(), d_dist.data_handle(), dist.size(), stream_);
+    resource::sync_stream(handle_);
+
+    for (int i = 0; i < m; i++) {
+      for (int j = 0; j < n; j++) {
+        const T* xi = x.data() + size_t(i) * dim;
+        const T* yj = y.data() + size_t(j) * dim;
+        float expected;
+        if constexpr (std::is_same_v<T, int8_t>) {
+          expected = ref_int8_distance(xi, yj, dim, params_.metric);
+        } else {
+          expected = ref_bitwise_distance(xi, yj, dim, params_.metric);
+        }
+        ASSERT_NEAR(expected, dist[size_t(i) * n + j], 1e-5 * std::max(1.0f, std::abs(expected)))
+          << "at (" << i << ", " << j << ")";
+      }
+    }
+  }
+
+ protected:
+  raft::resources handle_;
+  PackedDistanceInputs params_;
+  rmm::cuda_stream_view stream_;
+};
+
+const std::vector<PackedDistanceInputs> bitwise_inputs = {
+  {10, 20, 1, DistanceType::HammingUnexpanded},
+  {100, 300, 7, DistanceType::HammingUnexpanded},
+  {257, 129, 64, DistanceType::HammingUnexpanded},
+  {10, 20, 1, DistanceType::JaccardExpanded},
+  {100, 300, 7, DistanceType::JaccardExpanded},
+  {257, 129, 64, DistanceType::JaccardExpanded}};
+
+const std::vector<PackedDistanceInputs> int8_inputs = {
+  {10, 20, 4, DistanceType::L2Expanded},
+  {100, 300, 36, DistanceType::L2Expanded},
+  {257, 129, 512, DistanceType::L2SqrtExpanded},
+  {10, 20, 4, DistanceType::InnerProduct},
+  {257, 129, 512, DistanceType::InnerProduct}};
+
+using PackedDistanceTestU32 = PackedDistanceTest<uint32_t>;
+TEST_P(PackedDistanceTestU32, Result) { run(); }  // NOLINT
+INSTANTIATE_TEST_CASE_P(PackedDistanceTests,
+                        PackedDistanceTestU32,
+                        ::testing::ValuesIn(bitwise_inputs));  // NOLINT
+
+using PackedDistanceTestU64 = PackedDistanceTest<uint64_t>;
+TEST_P(PackedDistanceTestU64, Result) { run(); }  // NOLINT
+INSTANTIATE_TEST_CASE_P(PackedDistanceTests,
+                        PackedDistanceTestU64,
+                        ::testing::ValuesIn(bitwise_inputs));  // NOLINT
+
+using PackedDistanceTestI8 = PackedDistanceTest<int8_t>;
+TEST_P(PackedDistanceTestI8, Result) { run(); }  // NOLINT
+INSTANTIATE_TEST_CASE_P(PackedDistanceTests,
+                        PackedDistanceTestI8,
+                        ::testing::ValuesIn(int8_inputs));  // NOLINT
+
+}  // namespace raft::distance
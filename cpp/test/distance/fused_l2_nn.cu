@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,10 +21,18 @@
 #include <raft/distance/detail/fused_l2_nn.cuh>
 #include <raft/distance/fused_l2_nn.cuh>
 #include <raft/linalg/norm.cuh>
+#include <raft/linalg/unary_op.cuh>
 #include <raft/random/rng.cuh>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
 
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 namespace raft {
 namespace distance {
 
@@ -432,5 +440,180 @@ TEST_P(FusedL2NNDetTestD_Sqrt, Result)
 }
 INSTANTIATE_TEST_CASE_P(FusedL2NNDetTests, FusedL2NNDetTestD_Sqrt, ::testing::ValuesIn(inputsd));
 
+/// This is to test the top-k variant against the sorted distances
+template <bool Sqrt>
+class FusedL2NNTopKTest : public FusedL2NNTest<float, Sqrt> {
+ protected:
+  void generateGoldenResult() override {}
+
+  void runTopK(int n_neighbors)
+  {
+    int m = this->params.m;
+    int n = this->params.n;
+    int k = this->params.k;
+    rmm::device_uvector<raft::KeyValuePair<int, float>> out(m * n_neighbors, this->stream);
+    fusedL2NNTopK<float, int>(out.data(),
+                              this->x.data(),
+                              this->y.data(),
+                              this->xn.data(),
+                              this->yn.data(),
+                              m,
+                              n,
+                              k,
+                              n_neighbors,
+                              (void*)this->workspace.data(),
+                              Sqrt,
+                              this->stream);
+
+    std::vector<float> x_h(m * k);
+    std::vector<float> y_h(n * k);
+    std::vector<raft::KeyValuePair<int, float>> out_h(m * n_neighbors);
+    raft::update_host(x_h.data(), this->x.data(), m * k, this->stream);
+    raft::update_host(y_h.data(), this->y.data(), n * k, this->stream);
+    raft::update_host(out_h.data(), out.data(), m * n_neighbors, this->stream);
+    RAFT_CUDA_TRY(cudaStreamSynchronize(this->stream));
+
+    const float tol = this->params.tolerance;
+    std::vector<float> dists(n);
+    for (int i = 0; i < m; i++) {
+      for (int j = 0; j < n; j++) {
+        float d = 0;
+        for (int l = 0; l < k; l++) {
+          const float diff = x_h[i * k + l] - y_h[j * k + l];
+          d += diff * diff;
+        }
+        dists[j] = Sqrt ? std::sqrt(d) : d;
+      }
+      auto row = out_h.data() + i * n_neighbors;
+      // distinct neighbors, at the distances of the sorted distances
+      std::vector<float> sorted(dists);
+      std::partial_sort(sorted.begin(), sorted.begin() + n_neighbors, sorted.end());
+      for (int j = 0; j < n_neighbors; j++) {
+        ASSERT_TRUE(row[j].key >= 0 && row[j].key < n) << "row " << i << ", neighbor " << j;
+        for (int l = 0; l < j; l++) {
+          ASSERT_NE(row[j].key, row[l].key) << "row " << i << ", neighbor " << j;
+        }
+        ASSERT_NEAR(sorted[j], row[j].value, tol * std::max(1.0f, sorted[j]))
+          << "row " << i << ", neighbor " << j;
+        ASSERT_NEAR(dists[row[j].key], row[j].value, tol * std::max(1.0f, sorted[j]))
+          << "row " << i << ", neighbor " << j;
+      }
+    }
+  }
+};
+
+const std::vector<Inputs<float>> inputs_topk = {{0.001f, 32, 32, 32, 1234ULL},
+                                                {0.001f, 128, 64, 34, 1234ULL},
+                                                {0.001f, 64, 128, 7, 1234ULL},
+                                                {0.001f, 1805, 134, 2, 1234ULL},
+                                                {0.006f, 2048, 1024, 64, 1234ULL}};
+
+typedef FusedL2NNTopKTest<false> FusedL2NNTopKTestF_Sq;
+TEST_P(FusedL2NNTopKTestF_Sq, Result)
+{
+  runTopK(2);
+  runTopK(5);
+}
+INSTANTIATE_TEST_CASE_P(FusedL2NNTopKTests,
+                        FusedL2NNTopKTestF_Sq,
+                        ::testing::ValuesIn(inputs_topk));
+typedef FusedL2NNTopKTest<true> FusedL2NNTopKTestF_Sqrt;
+TEST_P(FusedL2NNTopKTestF_Sqrt, Result) { runTopK(2); }
+INSTANTIATE_TEST_CASE_P(FusedL2NNTopKTests,
+                        FusedL2NNTopKTestF_Sqrt,
+                        ::testing::ValuesIn(inputs_topk));
+
+/// This is to test the half and bfloat16 overloads against the fp32 kernel on the rounded inputs
+template <typename InT, bool Sqrt>
+class FusedL2NNLowPrecisionTest : public FusedL2NNTest<float, Sqrt> {
+ public:
+  FusedL2NNLowPrecisionTest()
+    : x_low(this->params.m * this->params.k, this->stream),
+      y_low(this->params.n * this->params.k, this->stream)
+  {
+  }
+
+ protected:
+  rmm::device_uvector<InT> x_low;
+  rmm::device_uvector<InT> y_low;
+
+  void generateGoldenResult() override
+  {
+    // round the inputs, so that the reference and the norms see the values of x_low and y_low
+    raft::linalg::unaryOp(
+      x_low.data(), this->x.data(), x_low.size(), raft::cast_op<InT>{}, this->stream);
+    raft::linalg::unaryOp(
+      y_low.data(), this->y.data(), y_low.size(), raft::cast_op<InT>{}, this->stream);
+    raft::linalg::unaryOp(
+      this->x.data(), x_low.data(), x_low.size(), raft::cast_op<float>{}, this->stream);
+    raft::linalg::unaryOp(
+      this->y.data(), y_low.data(), y_low.size(), raft::cast_op<float>{}, this->stream);
+    FusedL2NNTest<float, Sqrt>::generateGoldenResult();
+  }
+
+  void runLowPrecisionTest(raft::KeyValuePair<int, float>* out)
+  {
+    fusedL2NNMinReduce<raft::KeyValuePair<int, float>, int>(out,
+                                                            x_low.data(),
+                                                            y_low.data(),
+                                                            this->xn.data(),
+                                                            this->yn.data(),
+                                                            this->params.m,
+                                                            this->params.n,
+                                                            this->params.k,
+                                                            (void*)this->workspace.data(),
+                                                            Sqrt,
+                                                            true,
+                                                            this->stream);
+    RAFT_CUDA_TRY(cudaStreamSynchronize(this->stream));
+  }
+};
+
+const std::vector<Inputs<float>> inputs_low_precision = {{0.001f, 32, 32, 32, 1234ULL},
+                                                         {0.001f, 128, 64, 34, 1234ULL},
+                                                         {0.001f, 64, 128, 7, 1234ULL},
+                                                         {0.006f, 1805, 134, 2, 1234ULL},
+                                                         {0.006f, 8192, 1024, 64, 1234ULL}};
+
+typedef FusedL2NNLowPrecisionTest<half, false> FusedL2NNLowPrecisionTestH_Sq;
+TEST_P(FusedL2NNLowPrecisionTestH_Sq, Result)
+{
+  runLowPrecisionTest(this->min.data());
+  ASSERT_TRUE(devArrMatch(this->min_ref.data(),
+                          this->min.data(),
+                          this->params.m,
+                          CompareApproxAbsKVP<float>(this->params.tolerance),
+                          this->stream));
+}
+INSTANTIATE_TEST_CASE_P(FusedL2NNLowPrecisionTests,
+                        FusedL2NNLowPrecisionTestH_Sq,
+                        ::testing::ValuesIn(inputs_low_precision));
+typedef FusedL2NNLowPrecisionTest<nv_bfloat16, false> FusedL2NNLowPrecisionTestBF16_Sq;
+TEST_P(FusedL2NNLowPrecisionTestBF16_Sq, Result)
+{
+  runLowPrecisionTest(this->min.data());
+  ASSERT_TRUE(devArrMatch(this->min_ref.data(),
+                          this->min.data(),
+                          this->params.m,
+                          CompareApproxAbsKVP<float>(this->params.tolerance),
+                          this->stream));
+}
+INSTANTIATE_TEST_CASE_P(FusedL2NNLowPrecisionTests,
+                        FusedL2NNLowPrecisionTestBF16_Sq,
+                        ::testing::ValuesIn(inputs_low_precision));
+typedef FusedL2NNLowPrecisionTest<nv_bfloat16, true> FusedL2NNLowPrecisionTestBF16_Sqrt;
+TEST_P(FusedL2NNLowPrecisionTestBF16_Sqrt, Result)
+{
+  runLowPrecisionTest(this->min.data());
+  ASSERT_TRUE(devArrMatch(this->min_ref.data(),
+                          this->min.data(),
+                          this->params.m,
+                          CompareApproxAbsKVP<float>(this->params.tolerance),
+                          this->stream));
+}
+INSTANTIATE_TEST_CASE_P(FusedL2NNLowPrecisionTests,
+                        FusedL2NNLowPrecisionTestBF16_Sqrt,
+                        ::testing::ValuesIn(inputs_low_precision));
+
 }  // end namespace distance
 }  // end namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,6 +21,7 @@
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/kvp.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/distance/detail/compress_to_bits.cuh>
 #include <raft/distance/detail/masked_nn.cuh>
 #include <raft/distance/masked_nn.cuh>
 #include <raft/linalg/norm.cuh>
@@ -95,6 +96,7 @@ __launch_bounds__(32 * NWARPS, 2) RAFT_KERNEL referenceKernel(raft::KeyValuePair
                                                               int k,
                                                               int num_groups,
                                                               bool sqrt,
+                                                              DistanceType metric,
                                                               int* workspace,
                                                               DataT maxVal)
 {
@@ -115,15 +117,32 @@ __launch_bounds__(32 * NWARPS, 2) RAFT_KERNEL referenceKernel(raft::KeyValuePair
       }
       const bool include_dist = adj[midx * num_groups + group_idx] && midx < m && nidx < n;
 
-      // Compute L2 metric.
+      // Compute the metric.
       DataT acc = DataT(0);
-      for (int i = 0; i < k; ++i) {
-        int xidx  = i + midx * k;
-        int yidx  = i + nidx * k;
-        auto diff = x[xidx] - y[yidx];
-        acc += diff * diff;
+      if (metric == DistanceType::InnerProduct || metric == DistanceType::CosineExpanded) {
+        DataT xx = DataT(0);
+        DataT yy = DataT(0);
+        for (int i = 0; i < k; ++i) {
+          int xidx = i + midx * k;
+          int yidx = i + nidx * k;
+          acc += x[xidx] * y[yidx];
+          xx += x[xidx] * x[xidx];
+          yy += y[yidx] * y[yidx];
+        }
+        if (metric == DistanceType::InnerProduct) {
+          acc = -acc;
+        } else {
+          acc = xx * yy > DataT(0) ? DataT(1) - acc / raft::sqrt(xx * yy) : DataT(1);
+        }
+      } else {
+        for (int i = 0; i < k; ++i) {
+          int xidx  = i + midx * k;
+          int yidx  = i + nidx * k;
+          auto diff = x[xidx] - y[yidx];
+          acc += diff * diff;
+        }
+        if (sqrt) { acc = raft::sqrt(acc); }
       }
-      if (sqrt) { acc = raft::sqrt(acc); }
       ReduceOpT redOp;
       typedef cub::WarpReduce<raft::KeyValuePair<int, DataT>> WarpReduce;
       __shared__ typename WarpReduce::TempStorage temp[NWARPS];
@@ -155,12 +174,14 @@ struct Params {
   bool sqrt;
   unsigned long long int seed;
   AdjacencyPattern pattern;
+  DistanceType metric = DistanceType::L2Expanded;
 };
 
 inline auto operator<<(std::ostream& os, const Params& p) -> std::ostream&
 {
   os << "m: " << p.m << ", n: " << p.n << ", k: " << p.k << ", num_groups: " << p.num_groups
-     << ", sqrt: " << p.sqrt << ", seed: " << p.seed << ", tol: " << p.tolerance;
+     << ", sqrt: " << p.sqrt << ", seed: " << p.seed << ", tol: " << p.tolerance
+     << ", metric: " << static_cast<int>(p.metric);
   return os;
 }
 
@@ -233,6 +254,7 @@ auto reference(const raft::handle_t& handle, Inputs<DataT> inp, const Params& p)
                                 k,
                                 num_groups,
                                 p.sqrt,
+                                p.metric,
                                 (int*)workspace.data(),
                                 std::numeric_limits<DataT>::max());
   RAFT_CUDA_TRY(cudaGetLastError());
@@ -287,6 +309,79 @@ auto run_masked_nn(const raft::handle_t& handle, Inputs<DataT> inp, const Params
   return out;
 }
 
+// Runs masked_nn for `p.metric`, with the adjacency matrix compressed to a bitfield up front.
+template <typename DataT, typename OutT = raft::KeyValuePair<int, DataT>>
+auto run_masked_nn_bits(const raft::handle_t& handle, Inputs<DataT> inp, const Params& p)
+  -> raft::device_vector<OutT, int>
+{
+  using IdxT = int;
+
+  // Compute norms: squared L2 norms for L2, L2 norms for cosine and none for the inner product.
+  const bool use_norms = p.metric != DistanceType::InnerProduct;
+  auto x_norm          = raft::make_device_vector<DataT, IdxT>(handle, use_norms ? p.m : 0);
+  auto y_norm          = raft::make_device_vector<DataT, IdxT>(handle, use_norms ? p.n : 0);
+  if (p.metric == DistanceType::CosineExpanded) {
+    raft::linalg::norm(handle,
+                       std::as_const(inp.x).view(),
+                       x_norm.view(),
+                       raft::linalg::L2Norm,
+                       raft::linalg::Apply::ALONG_ROWS,
+                       raft::sqrt_op{});
+    raft::linalg::norm(handle,
+                       std::as_const(inp.y).view(),
+                       y_norm.view(),
+                       raft::linalg::L2Norm,
+                       raft::linalg::Apply::ALONG_ROWS,
+                       raft::sqrt_op{});
+  } else if (use_norms) {
+    raft::linalg::norm(handle,
+                       std::as_const(inp.x).view(),
+                       x_norm.view(),
+                       raft::linalg::L2Norm,
+                       raft::linalg::Apply::ALONG_ROWS);
+    raft::linalg::norm(handle,
+                       std::as_const(inp.y).view(),
+                       y_norm.view(),
+                       raft::linalg::L2Norm,
+                       raft::linalg::Apply::ALONG_ROWS);
+  }
+
+  // Compress the adjacency matrix.
+  auto adj_bits = raft::make_device_matrix<uint64_t, IdxT>(
+    handle, raft::ceildiv(p.m, IdxT(64)), p.num_groups);
+  RAFT_CUDA_TRY(cudaMemsetAsync(adj_bits.data_handle(),
+                                0,
+                                adj_bits.size() * sizeof(uint64_t),
+                                resource::get_cuda_stream(handle)));
+  raft::distance::detail::compress_to_bits(handle, std::as_const(inp.adj).view(), adj_bits.view());
+
+  // Create parameters for masked_nn
+  using RedOpT     = MinAndDistanceReduceOp<int, DataT>;
+  using PairRedOpT = raft::distance::KVPMinReduce<int, DataT>;
+  using ParamT     = raft::distance::masked_l2_nn_params<RedOpT, PairRedOpT>;
+
+  bool init_out = true;
+  ParamT masked_params{RedOpT{}, PairRedOpT{}, p.sqrt, init_out, p.metric};
+
+  // Create output
+  auto out = raft::make_device_vector<OutT, IdxT, raft::layout_c_contiguous>(handle, p.m);
+
+  // Launch kernel
+  raft::distance::masked_nn<DataT, OutT, IdxT>(handle,
+                                               masked_params,
+                                               inp.x.view(),
+                                               inp.y.view(),
+                                               x_norm.view(),
+                                               y_norm.view(),
+                                               std::as_const(adj_bits).view(),
+                                               inp.group_idxs.view(),
+                                               out.view());
+
+  resource::sync_stream(handle);
+
+  return out;
+}
+
 template <typename T>
 struct CompareApproxAbsKVP {
   typedef typename raft::KeyValuePair<int, T> KVP;
@@ -360,6 +455,24 @@ inline auto gen_params() -> std::vector<Params>
   return regular;
 }
 
+inline auto gen_metric_params() -> std::vector<Params>
+{
+  return raft::util::itertools::product<Params>({0.001f},         // tolerance
+                                                {64, 513},        // m
+                                                {128, 129},       // n
+                                                {8, 32},          // k
+                                                {3, 32},          // num_groups
+                                                {false},          // sqrt
+                                                {1234ULL},        // seed
+                                                {AdjacencyPattern::all_true,
+                                                 AdjacencyPattern::checkerboard,
+                                                 AdjacencyPattern::checkerboard_64,
+                                                 AdjacencyPattern::all_false},
+                                                {DistanceType::L2Expanded,
+                                                 DistanceType::InnerProduct,
+                                                 DistanceType::CosineExpanded});
+}
+
 class MaskedL2NNTest : public ::testing::TestWithParam<Params> {
   // Empty.
 };
@@ -432,4 +545,34 @@ TEST_P(MaskedL2NNTest, ReferenceCheckDouble)
 
 INSTANTIATE_TEST_CASE_P(MaskedL2NNTests, MaskedL2NNTest, ::testing::ValuesIn(gen_params()));
 
+// The other metrics, with the adjacency given as a bitfield.
+class MaskedNNMetricTest : public ::testing::TestWithParam<Params> {
+  // Empty.
+};
+
+TEST_P(MaskedNNMetricTest, ReferenceCheckFloat)
+{
+  using DataT = float;
+
+  // Get parameters; create handle and input data.
+  Params p = GetParam();
+  raft::handle_t handle{};
+  Inputs<DataT> inputs{handle, p};
+
+  // Calculate reference and test output
+  auto out_reference = reference(handle, inputs, p);
+  auto out_fast      = run_masked_nn_bits(handle, inputs, p);
+
+  // Check for differences.
+  ASSERT_TRUE(devArrMatch(out_reference.data_handle(),
+                          out_fast.data_handle(),
+                          p.m,
+                          CompareApproxAbsKVP<DataT>(p.tolerance),
+                          resource::get_cuda_stream(handle)));
+}
+
+INSTANTIATE_TEST_CASE_P(MaskedNNMetricTests,
+                        MaskedNNMetricTest,
+                        ::testing::ValuesIn(gen_metric_params()));
+
 }  // end namespace raft::distance::masked_nn
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2022, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,7 +22,9 @@
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
 
+#include <algorithm>
 #include <iostream>
+#include <random>
 #include <vector>
 
 namespace raft {
@@ -91,5 +93,68 @@ TEST(labelTest, Classlabels)
   EXPECT_TRUE(
     devArrMatchHost(y_relabeled_exp, y_relabeled_d.data(), n_rows, raft::Compare<float>(), stream));
 }
+TEST(labelTest, MakeMonotonicHashed)
+{
+  cudaStream_t stream;
+  RAFT_CUDA_TRY(cudaStreamCreate(&stream));
+
+  // the example of MakeMonotonicTest, matched by the sorted order
+  int m                  = 12;
+  float data_h[]         = {1.0, 2.0, 2.0, 2.0, 2.0, 3.0, 8.0, 7.0, 8.0, 8.0, 25.0, 80.0};
+  float sorted_h[]       = {1.0, 2.0, 2.0, 2.0, 2.0, 3.0, 5.0, 4.0, 5.0, 5.0, 6.0, 7.0};
+  float first_h[]        = {0.0, 1.0, 1.0, 1.0, 1.0, 2.0, 3.0, 4.0, 3.0, 3.0, 5.0, 6.0};
+  float unique_first_h[] = {1.0, 2.0, 3.0, 8.0, 7.0, 25.0, 80.0};
+
+  rmm::device_uvector<float> data(m, stream);
+  rmm::device_uvector<float> actual(m, stream);
+  rmm::device_uvector<float> unique(0, stream);
+  raft::update_device(data.data(), data_h, m, stream);
+
+  size_t n_unique = make_monotonic_hashed(actual.data(), data.data(), m, stream);
+  ASSERT_EQ(n_unique, size_t(7));
+  EXPECT_TRUE(devArrMatchHost(sorted_h, actual.data(), m, raft::Compare<float>(), stream));
+
+  n_unique = make_monotonic_hashed(
+    actual.data(), data.data(), m, stream, relabel_order::FIRST_OCCURRENCE, true, &unique);
+  ASSERT_EQ(n_unique, size_t(7));
+  EXPECT_TRUE(devArrMatchHost(first_h, actual.data(), m, raft::Compare<float>(), stream));
+  EXPECT_TRUE(
+    devArrMatchHost(unique_first_h, unique.data(), n_unique, raft::Compare<float>(), stream));
+
+  // many duplicated labels against sort + unique, with the inverse mapping
+  int n = 100000;
+  std::vector<int> big_h(n);
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> dist(-5000, 5000);
+  for (auto& v : big_h) {
+    v = dist(rng) * 7919;
+  }
+  rmm::device_uvector<int> big(n, stream);
+  rmm::device_uvector<int> big_out(n, stream);
+  rmm::device_uvector<int> big_unique(0, stream);
+  rmm::device_uvector<int> ref_unique(0, stream);
+  raft::update_device(big.data(), big_h.data(), n, stream);
+  int n_ref = getUniquelabels(ref_unique, big.data(), n, stream);
+  ASSERT_EQ(n_ref, getUniquelabels(big_unique, big.data(), n, stream, relabel_order::SORTED));
+  EXPECT_TRUE(
+    devArrMatch(ref_unique.data(), big_unique.data(), n_ref, raft::Compare<int>(), stream));
+
+  n_unique = make_monotonic_hashed(
+    big_out.data(), big.data(), n, stream, relabel_order::FIRST_OCCURRENCE, true, &big_unique);
+  ASSERT_EQ(n_unique, size_t(n_ref));
+  std::vector<int> out_h(n), unique_h(n_unique);
+  raft::update_host(out_h.data(), big_out.data(), n, stream);
+  raft::update_host(unique_h.data(), big_unique.data(), n_unique, stream);
+  RAFT_CUDA_TRY(cudaStreamSynchronize(stream));
+  int next = 0;
+  for (int i = 0; i < n; i++) {
+    ASSERT_EQ(unique_h[out_h[i]], big_h[i]) << i;
+    // the labels appear in increasing order
+    ASSERT_LE(out_h[i], next) << i;
+    if (out_h[i] == next) { next++; }
+  }
+  ASSERT_EQ(next, n_ref);
+  RAFT_CUDA_TRY(cudaStreamDestroy(stream));
+}
 };  // namespace label
 };  // namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  * Copyright 2020 KETAN DATE & RAKESH NAGI
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
@@ -23,14 +23,19 @@
  *
  */
 #include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 
 #include <rmm/device_uvector.hpp>
 
+#include <algorithm>
 #include <iostream>
+#include <numeric>
 #include <omp.h>
 #include <raft/solver/linear_assignment.cuh>
 #include <random>
+#include <vector>
 
 #define PROBLEMSIZE  1000  // Number of rows/columns
 #define BATCHSIZE    10    // Number of problems in the batch
@@ -148,4 +153,108 @@ TEST(Raft, HungarianLongLong)
   hungarian_test<long, long>(PROBLEMSIZE, COSTRANGE, PROBLEMCOUNT, REPETITIONS, BATCHSIZE, long{0});
 }
 
+// The optimal cost of a small problem, over all the permutations.
+template <typename weight_t>
+weight_t brute_force_objective(const weight_t* cost, int n)
+{
+  std::vector<int> perm(n);
+  std::iota(perm.begin(), perm.end(), 0);
+  weight_t best = 0;
+  bool first    = true;
+  do {
+    weight_t sum = 0;
+    for (int i = 0; i < n; i++) {
+      sum += cost[i * n + perm[i]];
+    }
+    if (first || sum < best) { best = sum; }
+    first = false;
+  } while (std::next_permutation(perm.begin(), perm.end()));
+  return best;
+}
+
+template <typename vertex_t, typename weight_t>
+void ragged_hungarian_test(weight_t epsilon)
+{
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+
+  // tiny problems (checked by brute force), medium ones for the warp solver and one of the block
+  // solver, in a mixed order; the empty problem is allowed
+  std::vector<vertex_t> sizes;
+  std::uniform_int_distribution<int> tiny(1, 8), medium(20, 60);
+  for (int i = 0; i < 40; i++) {
+    sizes.push_back(vertex_t(i % 4 == 0 ? medium(generator) : tiny(generator)));
+  }
+  sizes.push_back(0);
+  sizes.insert(sizes.begin() + 7, vertex_t(300));
+  int n_problems = int(sizes.size());
+
+  std::vector<int64_t> cost_offsets(n_problems + 1, 0), row_offsets(n_problems + 1, 0);
+  for (int i = 0; i < n_problems; i++) {
+    cost_offsets[i + 1] = cost_offsets[i] + int64_t(sizes[i]) * sizes[i];
+    row_offsets[i + 1]  = row_offsets[i] + sizes[i];
+  }
+  std::vector<weight_t> h_cost(cost_offsets.back());
+  std::uniform_int_distribution<int> distribution(0, COSTRANGE);
+  for (auto& c : h_cost) {
+    c = weight_t(distribution(generator));
+  }
+
+  auto costs      = raft::make_device_vector<weight_t, int64_t>(handle, h_cost.size());
+  auto rows       = raft::make_device_vector<vertex_t, int64_t>(handle, row_offsets.back());
+  auto cols       = raft::make_device_vector<vertex_t, int64_t>(handle, row_offsets.back());
+  auto objectives = raft::make_device_vector<weight_t, int64_t>(handle, n_problems);
+  raft::update_device(costs.data_handle(), h_cost.data(), h_cost.size(), stream);
+  raft::solver::solve_ragged_lap(
+    handle,
+    raft::make_const_mdspan(costs.view()),
+    raft::make_host_vector_view<const vertex_t, int64_t>(sizes.data(), n_problems),
+    rows.view(),
+    cols.view(),
+    std::make_optional(objectives.view()),
+    epsilon);
+
+  std::vector<vertex_t> h_rows(row_offsets.back()), h_cols(row_offsets.back());
+  std::vector<weight_t> h_objectives(n_problems);
+  raft::update_host(h_rows.data(), rows.data_handle(), h_rows.size(), stream);
+  raft::update_host(h_cols.data(), cols.data_handle(), h_cols.size(), stream);
+  raft::update_host(h_objectives.data(), objectives.data_handle(), n_problems, stream);
+  resource::sync_stream(handle, stream);
+
+  for (int k = 0; k < n_problems; k++) {
+    int n                 = sizes[k];
+    const weight_t* cost  = h_cost.data() + cost_offsets[k];
+    const vertex_t* r     = h_rows.data() + row_offsets[k];
+    const vertex_t* c     = h_cols.data() + row_offsets[k];
+    weight_t assigned_sum = 0;
+    for (int i = 0; i < n; i++) {
+      ASSERT_TRUE(r[i] >= 0 && r[i] < n) << "problem " << k;
+      ASSERT_EQ(c[r[i]], vertex_t(i)) << "problem " << k;
+      assigned_sum += cost[i * n + r[i]];
+    }
+    ASSERT_EQ(assigned_sum, h_objectives[k]) << "problem " << k;
+    if (n == 0) { continue; }
+
+    weight_t expected;
+    if (n <= 8) {
+      expected = brute_force_objective(cost, n);
+    } else {
+      rmm::device_uvector<weight_t> single_cost(size_t(n) * n, stream);
+      rmm::device_uvector<vertex_t> single_rows(n, stream);
+      rmm::device_uvector<vertex_t> single_cols(n, stream);
+      raft::update_device(single_cost.data(), cost, size_t(n) * n, stream);
+      raft::solver::LinearAssignmentProblem<vertex_t, weight_t> lpx(handle, n, 1, epsilon);
+      lpx.solve(single_cost.data(), single_rows.data(), single_cols.data());
+      expected = lpx.getPrimalObjectiveValue(0);
+    }
+    ASSERT_EQ(expected, h_objectives[k]) << "problem " << k << " of size " << n;
+  }
+}
+
+TEST(Raft, RaggedHungarianIntFloat) { ragged_hungarian_test<int, float>(float{1e-6}); }
+
+TEST(Raft, RaggedHungarianIntDouble) { ragged_hungarian_test<int, double>(double{1e-6}); }
+
+TEST(Raft, RaggedHungarianLongLong) { ragged_hungarian_test<long, long>(long{0}); }
+
 }  // namespace raft
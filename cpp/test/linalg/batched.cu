@@ -0,0 +1,344 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdspan.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/linalg/batched.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <vector>
+
+namespace raft {
+namespace linalg {
+
+struct BatchedInputs {
+  int batch_size, m, n, k;
+  unsigned long long int seed;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const BatchedInputs& p)
+{
+  os << "{" << p.batch_size << ", " << p.m << ", " << p.n << ", " << p.k << "}";
+  return os;
+}
+
+template <typename T>
+class BatchedTest : public ::testing::TestWithParam<BatchedInputs> {
+ public:
+  BatchedTest()
+    : params(::testing::TestWithParam<BatchedInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  auto random(size_t n, unsigned long long int seed) -> std::vector<T>
+  {
+    rmm::device_uvector<T> d(n, stream);
+    raft::random::RngState r(seed);
+    uniform(handle, r, d.data(), n, T(-1.0), T(1.0));
+    std::vector<T> h(n);
+    raft::update_host(h.data(), d.data(), n, stream);
+    resource::sync_stream(handle, stream);
+    return h;
+  }
+
+  template <typename IdxT = int, typename ElementType>
+  auto view(ElementType* ptr, IdxT rows, IdxT cols)
+  {
+    return raft::make_mdspan<ElementType, IdxT, raft::row_major, false, true>(
+      ptr, raft::make_extents<IdxT>(IdxT(params.batch_size), rows, cols));
+  }
+
+  /** C = 2 A B + 0.5 C, and y = A x for every problem. */
+  void testGemmGemv()
+  {
+    int b = params.batch_size, m = params.m, n = params.n, k = params.k;
+    auto h_a = random(size_t(b) * m * k, params.seed);
+    auto h_b = random(size_t(b) * k * n, params.seed + 1);
+    auto h_c = random(size_t(b) * m * n, params.seed + 2);
+    auto h_x = random(size_t(b) * k, params.seed + 3);
+    rmm::device_uvector<T> d_a(h_a.size(), stream), d_b(h_b.size(), stream),
+      d_c(h_c.size(), stream), d_x(h_x.size(), stream), d_y(size_t(b) * m, stream);
+    raft::update_device(d_a.data(), h_a.data(), h_a.size(), stream);
+    raft::update_device(d_b.data(), h_b.data(), h_b.size(), stream);
+    raft::update_device(d_c.data(), h_c.data(), h_c.size(), stream);
+    raft::update_device(d_x.data(), h_x.data(), h_x.size(), stream);
+
+    batched_gemm(handle,
+                 view<int, const T>(d_a.data(), m, k),
+                 view<int, const T>(d_b.data(), k, n),
+                 view<int, T>(d_c.data(), m, n),
+                 T(2),
+                 T(0.5));
+    batched_gemv(handle,
+                 view<int, const T>(d_a.data(), m, k),
+                 raft::make_device_matrix_view<const T, int>(d_x.data(), b, k),
+                 raft::make_device_matrix_view<T, int>(d_y.data(), b, m));
+
+    std::vector<T> exp_c(h_c.size()), exp_y(size_t(b) * m);
+    for (int p = 0; p < b; p++) {
+      for (int i = 0; i < m; i++) {
+        double y = 0;
+        for (int j = 0; j < n; j++) {
+          double acc = 0;
+          for (int l = 0; l < k; l++) {
+            acc += double(h_a[(size_t(p) * m + i) * k + l]) * h_b[(size_t(p) * k + l) * n + j];
+          }
+          size_t e = (size_t(p) * m + i) * n + j;
+          exp_c[e] = 2 * acc + 0.5 * h_c[e];
+        }
+        for (int l = 0; l < k; l++) {
+          y += double(h_a[(size_t(p) * m + i) * k + l]) * h_x[size_t(p) * k + l];
+        }
+        exp_y[size_t(p) * m + i] = y;
+      }
+    }
+    ASSERT_TRUE(raft::devArrMatchHost(
+      exp_c.data(), d_c.data(), exp_c.size(), raft::CompareApprox<T>(tolerance()), stream));
+    ASSERT_TRUE(raft::devArrMatchHost(
+      exp_y.data(), d_y.data(), exp_y.size(), raft::CompareApprox<T>(tolerance()), stream));
+  }
+
+  /** Factorize M M^T + m I, and check that L L^T gives it back. */
+  void testCholesky()
+  {
+    int b = params.batch_size, m = params.m;
+    auto h_m = random(size_t(b) * m * m, params.seed);
+    std::vector<T> h_a(h_m.size());
+    for (int p = 0; p < b; p++) {
+      const T* mp = h_m.data() + size_t(p) * m * m;
+      for (int i = 0; i < m; i++) {
+        for (int j = 0; j < m; j++) {
+          double acc = i == j ? m : 0;
+          for (int l = 0; l < m; l++) {
+            acc += double(mp[i * m + l]) * mp[j * m + l];
+          }
+          h_a[(size_t(p) * m + i) * m + j] = acc;
+        }
+      }
+    }
+    // the last matrix is not positive definite from its third leading minor
+    if (m >= 3) { h_a[(size_t(b - 1) * m + 2) * m + 2] = -1; }
+    rmm::device_uvector<T> d_a(h_a.size(), stream);
+    rmm::device_uvector<int> d_info(b, stream);
+    raft::update_device(d_a.data(), h_a.data(), h_a.size(), stream);
+
+    batched_cholesky(
+      handle, view<int, T>(d_a.data(), m, m), raft::make_device_vector_view(d_info.data(), b));
+
+    std::vector<T> h_l(h_a.size());
+    std::vector<int> h_info(b);
+    raft::update_host(h_l.data(), d_a.data(), h_l.size(), stream);
+    raft::update_host(h_info.data(), d_info.data(), b, stream);
+    resource::sync_stream(handle, stream);
+    for (int p = 0; p < b; p++) {
+      int exp_info = (m >= 3 && p == b - 1) ? 3 : 0;
+      ASSERT_EQ(h_info[p], exp_info) << "matrix " << p;
+      if (exp_info != 0) { continue; }
+      const T* lp = h_l.data() + size_t(p) * m * m;
+      const T* ap = h_a.data() + size_t(p) * m * m;
+      for (int i = 0; i < m; i++) {
+        for (int j = 0; j <= i; j++) {
+          double acc = 0;
+          for (int l = 0; l <= j; l++) {
+            acc += double(lp[i * m + l]) * lp[j * m + l];
+          }
+          ASSERT_TRUE(raft::match(ap[i * m + j], T(acc), raft::CompareApprox<T>(tolerance())))
+            << "matrix " << p << ", element (" << i << ", " << j << ")";
+        }
+        for (int j = i + 1; j < m; j++) {
+          ASSERT_EQ(lp[i * m + j], ap[i * m + j]) << "the upper triangle should be untouched";
+        }
+      }
+    }
+  }
+
+  /** Check that Q R gives A back, that Q^T Q = I and that R is upper triangular. */
+  void testQr()
+  {
+    int b = params.batch_size, m = params.m, n = params.n;
+    auto h_a = random(size_t(b) * m * n, params.seed);
+    rmm::device_uvector<T> d_a(h_a.size(), stream), d_q(h_a.size(), stream),
+      d_r(size_t(b) * n * n, stream);
+    raft::update_device(d_a.data(), h_a.data(), h_a.size(), stream);
+
+    batched_qr(handle,
+               view<int, const T>(d_a.data(), m, n),
+               view<int, T>(d_q.data(), m, n),
+               view<int, T>(d_r.data(), n, n));
+
+    std::vector<T> h_q(d_q.size()), h_r(d_r.size());
+    raft::update_host(h_q.data(), d_q.data(), h_q.size(), stream);
+    raft::update_host(h_r.data(), d_r.data(), h_r.size(), stream);
+    resource::sync_stream(handle, stream);
+    auto cmp = raft::CompareApprox<T>(tolerance());
+    for (int p = 0; p < b; p++) {
+      const T* ap = h_a.data() + size_t(p) * m * n;
+      const T* qp = h_q.data() + size_t(p) * m * n;
+      const T* rp = h_r.data() + size_t(p) * n * n;
+      for (int i = 0; i < m; i++) {
+        for (int j = 0; j < n; j++) {
+          double acc = 0;
+          for (int l = 0; l < n; l++) {
+            acc += double(qp[i * n + l]) * rp[l * n + j];
+          }
+          ASSERT_TRUE(raft::match(ap[i * n + j], T(acc), cmp))
+            << "QR, matrix " << p << ", element (" << i << ", " << j << ")";
+        }
+      }
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+          double acc = 0;
+          for (int l = 0; l < m; l++) {
+            acc += double(qp[l * n + i]) * qp[l * n + j];
+          }
+          ASSERT_TRUE(raft::match(T(i == j), T(acc), cmp))
+            << "Q^T Q, matrix " << p << ", element (" << i << ", " << j << ")";
+          if (j < i) { ASSERT_TRUE(raft::match(T(0), rp[i * n + j], cmp)); }
+        }
+      }
+    }
+  }
+
+  /** Solve the consistent systems A x0 = b, whose least squares solutions are x0. */
+  void testLstsq()
+  {
+    int b = params.batch_size, m = params.m, n = params.n;
+    auto h_a  = random(size_t(b) * m * n, params.seed);
+    auto h_x0 = random(size_t(b) * n, params.seed + 1);
+    std::vector<T> h_b(size_t(b) * m);
+    for (int p = 0; p < b; p++) {
+      for (int i = 0; i < m; i++) {
+        double acc = 0;
+        for (int j = 0; j < n; j++) {
+          acc += double(h_a[(size_t(p) * m + i) * n + j]) * h_x0[size_t(p) * n + j];
+        }
+        h_b[size_t(p) * m + i] = acc;
+      }
+    }
+    rmm::device_uvector<T> d_a(h_a.size(), stream), d_b(h_b.size(), stream),
+      d_w(h_x0.size(), stream);
+    raft::update_device(d_a.data(), h_a.data(), h_a.size(), stream);
+    raft::update_device(d_b.data(), h_b.data(), h_b.size(), stream);
+
+    batched_lstsq(handle,
+                  view<int, const T>(d_a.data(), m, n),
+                  raft::make_device_matrix_view<const T, int>(d_b.data(), b, m),
+                  raft::make_device_matrix_view<T, int>(d_w.data(), b, n));
+
+    // the square problems are less well conditioned
+    ASSERT_TRUE(raft::devArrMatchHost(h_x0.data(),
+                                      d_w.data(),
+                                      h_x0.size(),
+                                      raft::CompareApprox<T>(100 * tolerance()),
+                                      stream));
+  }
+
+  /** Check that A V = V diag(W), that V^T V = I and that W is ascending. */
+  void testEigJacobi()
+  {
+    int b = params.batch_size, n = params.m;
+    auto h_m = random(size_t(b) * n * n, params.seed);
+    std::vector<T> h_a(h_m.size());
+    for (int p = 0; p < b; p++) {
+      for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+          size_t base           = size_t(p) * n * n;
+          h_a[base + i * n + j] = (h_m[base + i * n + j] + h_m[base + j * n + i]) / 2;
+        }
+      }
+    }
+    rmm::device_uvector<T> d_a(h_a.size(), stream), d_v(h_a.size(), stream),
+      d_w(size_t(b) * n, stream);
+    raft::update_device(d_a.data(), h_a.data(), h_a.size(), stream);
+
+    batched_eig_jacobi(handle,
+                       view<int, const T>(d_a.data(), n, n),
+                       raft::make_device_matrix_view<T, int>(d_w.data(), b, n),
+                       view<int, T>(d_v.data(), n, n));
+
+    std::vector<T> h_v(d_v.size()), h_w(d_w.size());
+    raft::update_host(h_v.data(), d_v.data(), h_v.size(), stream);
+    raft::update_host(h_w.data(), d_w.data(), h_w.size(), stream);
+    resource::sync_stream(handle, stream);
+    for (int p = 0; p < b; p++) {
+      const T* ap   = h_a.data() + size_t(p) * n * n;
+      const T* vp   = h_v.data() + size_t(p) * n * n;
+      const T* wp   = h_w.data() + size_t(p) * n;
+      double a_norm = std::max(std::abs(double(wp[0])), std::abs(double(wp[n - 1])));
+      for (int c = 0; c < n; c++) {
+        if (c > 0) { ASSERT_LE(wp[c - 1], wp[c]) << "matrix " << p; }
+        for (int i = 0; i < n; i++) {
+          double av = 0;
+          for (int l = 0; l < n; l++) {
+            av += double(ap[i * n + l]) * vp[l * n + c];
+          }
+          ASSERT_NEAR(av, double(wp[c]) * vp[i * n + c], 10 * tolerance() * a_norm)
+            << "A V, matrix " << p << ", element (" << i << ", " << c << ")";
+        }
+        for (int d = 0; d < n; d++) {
+          double dot = 0;
+          for (int l = 0; l < n; l++) {
+            dot += double(vp[l * n + c]) * vp[l * n + d];
+          }
+          ASSERT_NEAR(double(c == d), dot, 10 * tolerance())
+            << "V^T V, matrix " << p << ", element (" << c << ", " << d << ")";
+        }
+      }
+    }
+  }
+
+  static constexpr auto tolerance() -> T { return std::is_same_v<T, float> ? T(1e-4) : T(1e-9); }
+
+  raft::resources handle;
+  BatchedInputs params;
+  cudaStream_t stream = 0;
+};
+
+// the shapes of the single-kernel problems, and larger ones which go to cuBLAS / cuSOLVER
+const std::vector<BatchedInputs> inputs = {{1000, 8, 8, 8, 1234ULL},
+                                           {300, 32, 16, 32, 1234ULL},
+                                           {100, 64, 64, 64, 1234ULL},
+                                           {57, 7, 3, 5, 1234ULL},
+                                           {5, 150, 100, 80, 1234ULL},
+                                           {3, 300, 257, 129, 1234ULL}};
+
+typedef BatchedTest<float> BatchedTestF;
+TEST_P(BatchedTestF, GemmGemv) { testGemmGemv(); }
+TEST_P(BatchedTestF, Cholesky) { testCholesky(); }
+TEST_P(BatchedTestF, Qr) { testQr(); }
+TEST_P(BatchedTestF, Lstsq) { testLstsq(); }
+TEST_P(BatchedTestF, EigJacobi) { testEigJacobi(); }
+INSTANTIATE_TEST_CASE_P(BatchedTests, BatchedTestF, ::testing::ValuesIn(inputs));
+
+typedef BatchedTest<double> BatchedTestD;
+TEST_P(BatchedTestD, GemmGemv) { testGemmGemv(); }
+TEST_P(BatchedTestD, Cholesky) { testCholesky(); }
+TEST_P(BatchedTestD, Qr) { testQr(); }
+TEST_P(BatchedTestD, Lstsq) { testLstsq(); }
+TEST_P(BatchedTestD, EigJacobi) { testEigJacobi(); }
+INSTANTIATE_TEST_CASE_P(BatchedTests, BatchedTestD, ::testing::ValuesIn(inputs));
+
+}  // end namespace linalg
+}  // end namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -15,10 +15,16 @@
  */
 
 #include <raft/core/nvtx.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/device_id.hpp>
+#include <raft/core/device_mdarray.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/spectral/eigen_solvers.cuh>
+#include <raft/spectral/modularity_maximization.cuh>
 #include <raft/spectral/partition.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
 
 #include <gtest/gtest.h>
 
@@ -26,6 +32,7 @@
 #include <iostream>
 #include <memory>
 #include <type_traits>
+#include <vector>
 
 namespace raft {
 namespace spectral {
@@ -115,5 +122,67 @@ TEST(Raft, SpectralSolvers)
   EXPECT_ANY_THROW(spectral::analyzePartition(h, sm, k, clusters, edgeCut, cost));
 }
 
+TEST(Raft, AnalyzePartition)
+{
+  using namespace matrix;
+  using index_type = int;
+  using value_type = double;
+
+  raft::resources h;
+  auto stream = resource::get_cuda_stream(h);
+
+  // the path 0 - 1 - 2 - 3 (unit weights) in the partitions {0, 1} and {2, 3}, and an empty one:
+  // the edge 1 - 2 is cut, cost = 1 / 2 + 1 / 2; with the degrees 1, 2, 2, 1, the modularity is
+  // 2 (2 - 3 * 3 / 6) / 6
+  std::vector<index_type> h_offsets{0, 1, 3, 5, 6};
+  std::vector<index_type> h_indices{1, 0, 2, 1, 3, 2};
+  std::vector<value_type> h_values(6, 1.0);
+  std::vector<index_type> h_clusters{0, 0, 1, 1};
+  rmm::device_uvector<index_type> offsets(5, stream);
+  rmm::device_uvector<index_type> indices(6, stream);
+  rmm::device_uvector<value_type> values(6, stream);
+  rmm::device_uvector<index_type> clusters(4, stream);
+  raft::update_device(offsets.data(), h_offsets.data(), 5, stream);
+  raft::update_device(indices.data(), h_indices.data(), 6, stream);
+  raft::update_device(values.data(), h_values.data(), 6, stream);
+  raft::update_device(clusters.data(), h_clusters.data(), 4, stream);
+  sparse_matrix_t<index_type, value_type> sm{
+    h, offsets.data(), indices.data(), values.data(), 4, 6};
+
+  value_type edgeCut{0};
+  value_type cost{0};
+  value_type modularity{0};
+  spectral::analyzePartition(h, sm, 3, clusters.data(), edgeCut, cost);
+  spectral::analyzeModularity(h, sm, 3, clusters.data(), modularity);
+  ASSERT_NEAR(1.0, edgeCut, 1e-12);
+  ASSERT_NEAR(1.0, cost, 1e-12);
+  ASSERT_NEAR(1.0 / 6, modularity, 1e-12);
+
+  // the same on the device, with a workspace reused across the numbers of partitions
+  rmm::device_uvector<value_type> workspace(0, stream);
+  auto d_results = raft::make_device_vector<value_type, int>(h, 3);
+  for (index_type n_clusters : {2, 3}) {
+    spectral::analyzePartition(h,
+                               sm,
+                               n_clusters,
+                               clusters.data(),
+                               raft::make_device_scalar_view(d_results.data_handle()),
+                               raft::make_device_scalar_view(d_results.data_handle() + 1),
+                               workspace);
+    spectral::analyzeModularity(h,
+                                sm,
+                                n_clusters,
+                                clusters.data(),
+                                raft::make_device_scalar_view(d_results.data_handle() + 2),
+                                workspace);
+    std::vector<value_type> results(3);
+    raft::update_host(results.data(), d_results.data_handle(), 3, stream);
+    resource::sync_stream(h, stream);
+    ASSERT_NEAR(edgeCut, results[0], 1e-12);
+    ASSERT_NEAR(cost, results[1], 1e-12);
+    ASSERT_NEAR(modularity, results[2], 1e-12);
+  }
+}
+
 }  // namespace spectral
 }  // namespace raft
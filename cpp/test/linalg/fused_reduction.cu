@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/kvp.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/linalg/fused_reduction.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+#include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace raft {
+namespace linalg {
+
+template <typename T>
+struct FusedReductionInputs {
+  T tolerance;
+  int rows, cols;
+  bool row_major;
+  bool along_rows;
+  unsigned long long int seed;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const FusedReductionInputs<T>& p)
+{
+  os << "{" << p.rows << ", " << p.cols << ", " << (p.row_major ? "row_major" : "col_major")
+     << ", " << (p.along_rows ? "along_rows" : "along_columns") << "}";
+  return os;
+}
+
+template <typename T, typename LayoutPolicy>
+void fusedReductionLaunch(const raft::resources& handle,
+                          raft::device_matrix_view<const T, int, LayoutPolicy> data,
+                          bool along_rows,
+                          T* sums,
+                          T* sq_sums,
+                          T* mins,
+                          T* maxs,
+                          int* argmax)
+{
+  int n         = along_rows ? data.extent(0) : data.extent(1);
+  auto lowest   = std::numeric_limits<T>::lowest();
+  auto greatest = std::numeric_limits<T>::max();
+  fused_reduce(
+    handle,
+    data,
+    along_rows ? Apply::ALONG_ROWS : Apply::ALONG_COLUMNS,
+    make_reduction_output(raft::make_device_vector_view(sums, n), T(0)),
+    make_reduction_output(raft::make_device_vector_view(sq_sums, n), T(0), raft::sq_op{}),
+    make_reduction_output(
+      raft::make_device_vector_view(mins, n), greatest, raft::identity_op{}, raft::min_op{}),
+    make_reduction_output(
+      raft::make_device_vector_view(maxs, n), lowest, raft::identity_op{}, raft::max_op{}),
+    make_reduction_output(raft::make_device_vector_view(argmax, n),
+                          raft::KeyValuePair<int, T>{-1, lowest},
+                          key_value_op{},
+                          raft::argmax_op{},
+                          raft::key_op{}));
+}
+
+template <typename T>
+class FusedReductionTest : public ::testing::TestWithParam<FusedReductionInputs<T>> {
+ public:
+  FusedReductionTest()
+    : params(::testing::TestWithParam<FusedReductionInputs<T>>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    int rows = params.rows, cols = params.cols;
+    int n    = params.along_rows ? rows : cols;
+    rmm::device_uvector<T> data(rows * cols, stream);
+    rmm::device_uvector<T> sums(n, stream), sq_sums(n, stream), mins(n, stream), maxs(n, stream);
+    rmm::device_uvector<int> argmax(n, stream);
+    raft::random::RngState r(params.seed);
+    uniform(handle, r, data.data(), rows * cols, T(-1.0), T(1.0));
+
+    if (params.row_major) {
+      fusedReductionLaunch(handle,
+                           raft::make_device_matrix_view<const T, int, raft::row_major>(
+                             data.data(), rows, cols),
+                           params.along_rows,
+                           sums.data(),
+                           sq_sums.data(),
+                           mins.data(),
+                           maxs.data(),
+                           argmax.data());
+    } else {
+      fusedReductionLaunch(handle,
+                           raft::make_device_matrix_view<const T, int, raft::col_major>(
+                             data.data(), rows, cols),
+                           params.along_rows,
+                           sums.data(),
+                           sq_sums.data(),
+                           mins.data(),
+                           maxs.data(),
+                           argmax.data());
+    }
+
+    std::vector<T> h_data(rows * cols);
+    raft::update_host(h_data.data(), data.data(), h_data.size(), stream);
+    resource::sync_stream(handle, stream);
+    std::vector<T> exp_sums(n), exp_sq_sums(n), exp_mins(n), exp_maxs(n);
+    std::vector<int> exp_argmax(n);
+    for (int k = 0; k < n; k++) {
+      double sum = 0, sq_sum = 0;
+      T min_v = std::numeric_limits<T>::max(), max_v = std::numeric_limits<T>::lowest();
+      int arg = -1;
+      for (int l = 0; l < (params.along_rows ? cols : rows); l++) {
+        int i = params.along_rows ? k : l;
+        int j = params.along_rows ? l : k;
+        T x   = h_data[params.row_major ? i * cols + j : j * rows + i];
+        sum += x;
+        sq_sum += double(x) * x;
+        min_v = std::min(min_v, x);
+        if (x > max_v) {
+          max_v = x;
+          arg   = l;
+        }
+      }
+      exp_sums[k]    = sum;
+      exp_sq_sums[k] = sq_sum;
+      exp_mins[k]    = min_v;
+      exp_maxs[k]    = max_v;
+      exp_argmax[k]  = arg;
+    }
+
+    ASSERT_TRUE(raft::devArrMatchHost(
+      exp_sums.data(), sums.data(), n, raft::CompareApprox<T>(params.tolerance), stream));
+    ASSERT_TRUE(raft::devArrMatchHost(
+      exp_sq_sums.data(), sq_sums.data(), n, raft::CompareApprox<T>(params.tolerance), stream));
+    ASSERT_TRUE(
+      raft::devArrMatchHost(exp_mins.data(), mins.data(), n, raft::Compare<T>(), stream));
+    ASSERT_TRUE(
+      raft::devArrMatchHost(exp_maxs.data(), maxs.data(), n, raft::Compare<T>(), stream));
+    ASSERT_TRUE(
+      raft::devArrMatchHost(exp_argmax.data(), argmax.data(), n, raft::Compare<int>(), stream));
+  }
+
+  raft::resources handle;
+  FusedReductionInputs<T> params;
+  cudaStream_t stream = 0;
+};
+
+// the shapes cover the thin and thick coalesced reductions, and the split rows of the strided ones
+const std::vector<FusedReductionInputs<float>> inputsf = {
+  {0.0001f, 1024, 32, true, true, 1234ULL},
+  {0.0001f, 1024, 32, true, false, 1234ULL},
+  {0.0001f, 1024, 32, false, true, 1234ULL},
+  {0.0001f, 1024, 32, false, false, 1234ULL},
+  {0.0001f, 7, 3000, true, true, 1234ULL},
+  {0.0001f, 7, 3000, false, false, 1234ULL},
+  {0.001f, 30000, 5, true, false, 1234ULL},
+  {0.001f, 30000, 5, false, true, 1234ULL}};
+const std::vector<FusedReductionInputs<double>> inputsd = {
+  {0.000001, 1024, 32, true, true, 1234ULL},
+  {0.000001, 1024, 32, false, false, 1234ULL},
+  {0.000001, 30000, 5, true, false, 1234ULL},
+  {0.000001, 30000, 5, false, true, 1234ULL}};
+
+typedef FusedReductionTest<float> FusedReductionTestF;
+TEST_P(FusedReductionTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(FusedReductionTests, FusedReductionTestF, ::testing::ValuesIn(inputsf));
+
+typedef FusedReductionTest<double> FusedReductionTestD;
+TEST_P(FusedReductionTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(FusedReductionTests, FusedReductionTestD, ::testing::ValuesIn(inputsd));
+
+}  // end namespace linalg
+}  // end namespace raft
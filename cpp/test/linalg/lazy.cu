@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/operators.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/linalg/lazy.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace raft {
+namespace linalg {
+
+template <typename T>
+struct LazyInputs {
+  T tolerance;
+  int rows, cols;
+  unsigned long long int seed;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const LazyInputs<T>& p)
+{
+  os << "{" << p.rows << ", " << p.cols << "}";
+  return os;
+}
+
+/**
+ * The chain map (x 2) -> mean-centering -> row L2 norms -> row normalization, in three kernels
+ * (the column means, the row norms and the normalized matrix) instead of one per primitive.
+ */
+template <typename T>
+class LazyTest : public ::testing::TestWithParam<LazyInputs<T>> {
+ public:
+  LazyTest()
+    : params(::testing::TestWithParam<LazyInputs<T>>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    int rows = params.rows, cols = params.cols;
+    auto data  = raft::make_device_matrix<T, int>(handle, rows, cols);
+    auto means = raft::make_device_vector<T, int>(handle, cols);
+    auto norms = raft::make_device_vector<T, int>(handle, rows);
+    auto maxs  = raft::make_device_vector<T, int>(handle, cols);
+    auto out   = raft::make_device_matrix<T, int>(handle, rows, cols);
+    raft::random::RngState r(params.seed);
+    uniform(handle, r, data.data_handle(), rows * cols, T(-1.0), T(1.0));
+
+    auto scaled = lazy::map(lazy::matrix(data.view()), raft::mul_const_op<T>(T(2)));
+    lazy::strided_reduction(
+      handle, scaled, means.view(), T(0), raft::add_op{}, raft::div_const_op<T>(T(rows)));
+    auto centered =
+      lazy::matrix_vector_op(scaled, means.view(), Apply::ALONG_ROWS, raft::sub_op{});
+    lazy::coalesced_reduction(handle,
+                              lazy::map(centered, raft::sq_op{}),
+                              norms.view(),
+                              T(0),
+                              raft::add_op{},
+                              raft::sqrt_op{});
+    lazy::evaluate(
+      handle,
+      lazy::matrix_vector_op(centered, norms.view(), Apply::ALONG_COLUMNS, raft::div_op{}),
+      out.view());
+    lazy::reduce(handle,
+                 lazy::map(lazy::matrix(data.view()), raft::abs_op{}),
+                 maxs.view(),
+                 T(0),
+                 Apply::ALONG_COLUMNS,
+                 raft::max_op{});
+
+    // the reference, on the host (accumulated in double)
+    std::vector<T> h_data(rows * cols);
+    raft::update_host(h_data.data(), data.data_handle(), h_data.size(), stream);
+    resource::sync_stream(handle, stream);
+    std::vector<double> sums(cols, 0);
+    std::vector<T> exp_means(cols), exp_norms(rows), exp_out(rows * cols), exp_maxs(cols, 0);
+    for (int i = 0; i < rows; i++) {
+      for (int j = 0; j < cols; j++) {
+        sums[j] += 2.0 * h_data[i * cols + j];
+        exp_maxs[j] = std::max<T>(exp_maxs[j], std::abs(h_data[i * cols + j]));
+      }
+    }
+    for (int j = 0; j < cols; j++) {
+      exp_means[j] = sums[j] / rows;
+    }
+    for (int i = 0; i < rows; i++) {
+      double norm = 0;
+      for (int j = 0; j < cols; j++) {
+        double c = 2.0 * h_data[i * cols + j] - sums[j] / rows;
+        norm += c * c;
+      }
+      exp_norms[i] = std::sqrt(norm);
+      for (int j = 0; j < cols; j++) {
+        exp_out[i * cols + j] = (2.0 * h_data[i * cols + j] - sums[j] / rows) / std::sqrt(norm);
+      }
+    }
+
+    ASSERT_TRUE(raft::devArrMatchHost(exp_means.data(),
+                                      means.data_handle(),
+                                      cols,
+                                      raft::CompareApprox<T>(params.tolerance),
+                                      stream));
+    ASSERT_TRUE(raft::devArrMatchHost(exp_norms.data(),
+                                      norms.data_handle(),
+                                      rows,
+                                      raft::CompareApprox<T>(params.tolerance),
+                                      stream));
+    ASSERT_TRUE(raft::devArrMatchHost(exp_out.data(),
+                                      out.data_handle(),
+                                      rows * cols,
+                                      raft::CompareApprox<T>(params.tolerance),
+                                      stream));
+    ASSERT_TRUE(raft::devArrMatchHost(
+      exp_maxs.data(), maxs.data_handle(), cols, raft::Compare<T>(), stream));
+  }
+
+  raft::resources handle;
+  LazyInputs<T> params;
+  cudaStream_t stream = 0;
+};
+
+// the shapes cover the thin and thick row reductions, and the split rows of the column ones
+const std::vector<LazyInputs<float>> inputsf = {{0.0001f, 2, 1, 1234ULL},
+                                                {0.0001f, 7, 3, 1234ULL},
+                                                {0.0001f, 1000, 16, 1234ULL},
+                                                {0.0001f, 100, 1000, 1234ULL},
+                                                {0.0001f, 3, 5000, 1234ULL},
+                                                {0.001f, 50000, 5, 1234ULL}};
+const std::vector<LazyInputs<double>> inputsd = {{0.000001, 7, 3, 1234ULL},
+                                                 {0.000001, 1000, 16, 1234ULL},
+                                                 {0.000001, 100, 1000, 1234ULL},
+                                                 {0.000001, 50000, 5, 1234ULL}};
+
+typedef LazyTest<float> LazyTestF;
+TEST_P(LazyTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(LazyTests, LazyTestF, ::testing::ValuesIn(inputsf));
+
+typedef LazyTest<double> LazyTestD;
+TEST_P(LazyTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(LazyTests, LazyTestD, ::testing::ValuesIn(inputsd));
+
+}  // end namespace linalg
+}  // end namespace raft
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/lstsq.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace raft {
+namespace linalg {
+
+template <typename T>
+struct LstsqStreamingInputs {
+  T tolerance;
+  int n_rows, n_cols, batch_rows;
+  lstsq_method method;
+  unsigned long long int seed;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const LstsqStreamingInputs<T>& p)
+{
+  os << "{" << p.n_rows << ", " << p.n_cols << ", batch_rows " << p.batch_rows << ", "
+     << (p.method == lstsq_method::TSQR ? "TSQR" : "NORMAL_EQUATIONS") << "}";
+  return os;
+}
+
+/**
+ * b = A x0 + noise: the streamed solutions (by host row-major blocks, by device column-major
+ * blocks, and merged from two accumulators of half the rows) should match lstsq_qr of the whole
+ * matrix.
+ */
+template <typename T>
+class LstsqStreamingTest : public ::testing::TestWithParam<LstsqStreamingInputs<T>> {
+ public:
+  LstsqStreamingTest()
+    : params(::testing::TestWithParam<LstsqStreamingInputs<T>>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    int n_rows = params.n_rows, n_cols = params.n_cols;
+    std::mt19937 gen(params.seed);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    auto a = raft::make_host_matrix<T, int, raft::row_major>(n_rows, n_cols);
+    auto b = raft::make_host_vector<T, int>(n_rows);
+    std::vector<double> x0(n_cols);
+    for (auto& x : x0) {
+      x = uniform(gen);
+    }
+    for (int i = 0; i < n_rows; i++) {
+      double acc = 0.1 * uniform(gen);
+      for (int j = 0; j < n_cols; j++) {
+        a(i, j) = uniform(gen);
+        acc += double(a(i, j)) * x0[j];
+      }
+      b(i) = acc;
+    }
+
+    // the reference: lstsq_qr of the whole column-major matrix
+    std::vector<T> a_col(size_t(n_rows) * n_cols);
+    for (int i = 0; i < n_rows; i++) {
+      for (int j = 0; j < n_cols; j++) {
+        a_col[size_t(j) * n_rows + i] = a(i, j);
+      }
+    }
+    auto d_a = raft::make_device_matrix<T, int, raft::col_major>(handle, n_rows, n_cols);
+    auto d_b = raft::make_device_vector<T, int>(handle, n_rows);
+    auto w   = raft::make_device_vector<T, int>(handle, n_cols);
+    raft::update_device(d_a.data_handle(), a_col.data(), a_col.size(), stream);
+    raft::update_device(d_b.data_handle(), b.data_handle(), n_rows, stream);
+    lstsq_qr(handle,
+             raft::make_const_mdspan(d_a.view()),
+             raft::make_const_mdspan(d_b.view()),
+             w.view());
+    std::vector<T> expected(n_cols);
+    raft::update_host(expected.data(), w.data_handle(), n_cols, stream);
+    resource::sync_stream(handle, stream);
+    // lstsq_qr overwrites its inputs
+    raft::update_device(d_a.data_handle(), a_col.data(), a_col.size(), stream);
+    raft::update_device(d_b.data_handle(), b.data_handle(), n_rows, stream);
+    auto cmp = raft::CompareApprox<T>(params.tolerance);
+
+    // the host row-major blocks
+    lstsq_accumulator<T> acc(handle, n_cols, params.method);
+    for (int row0 = 0; row0 < n_rows; row0 += params.batch_rows) {
+      int rows = std::min(params.batch_rows, n_rows - row0);
+      acc.update(handle,
+                 raft::make_host_matrix_view<const T, int, raft::row_major>(
+                   a.data_handle() + size_t(row0) * n_cols, rows, n_cols),
+                 raft::make_host_vector_view<const T, int>(b.data_handle() + row0, rows));
+    }
+    ASSERT_EQ(acc.n_rows(), int64_t(n_rows));
+    acc.solve(handle, w.view());
+    ASSERT_TRUE(raft::devArrMatchHost(expected.data(), w.data_handle(), n_cols, cmp, stream));
+
+    // the device column-major blocks, the first and the second half of the rows in two
+    // accumulators
+    lstsq_accumulator<T> first(handle, n_cols, params.method);
+    lstsq_accumulator<T> second(handle, n_cols, params.method);
+    std::vector<T> block;
+    auto d_block    = raft::make_device_vector<T, int>(handle, params.batch_rows * n_cols);
+    auto add_blocks = [&](lstsq_accumulator<T>& dst, int begin, int end) {
+      for (int row0 = begin; row0 < end; row0 += params.batch_rows) {
+        int rows = std::min(params.batch_rows, end - row0);
+        block.resize(size_t(rows) * n_cols);
+        for (int j = 0; j < n_cols; j++) {
+          std::copy(a_col.begin() + size_t(j) * n_rows + row0,
+                    a_col.begin() + size_t(j) * n_rows + row0 + rows,
+                    block.begin() + size_t(j) * rows);
+        }
+        raft::update_device(d_block.data_handle(), block.data(), block.size(), stream);
+        dst.update(handle,
+                   raft::make_device_matrix_view<const T, int, raft::col_major>(
+                     d_block.data_handle(), rows, n_cols),
+                   raft::make_device_vector_view<const T, int>(d_b.data_handle() + row0, rows));
+        // the host block is refilled by the next iteration
+        resource::sync_stream(handle, stream);
+      }
+    };
+    add_blocks(first, 0, n_rows / 2);
+    add_blocks(second, n_rows / 2, n_rows);
+    ASSERT_EQ(first.n_rows() + second.n_rows(), int64_t(n_rows));
+    first.merge(handle, second);
+    ASSERT_EQ(first.n_rows(), int64_t(n_rows));
+    first.solve(handle, w.view());
+    ASSERT_TRUE(raft::devArrMatchHost(expected.data(), w.data_handle(), n_cols, cmp, stream));
+  }
+
+  raft::resources handle;
+  LstsqStreamingInputs<T> params;
+  cudaStream_t stream = 0;
+};
+
+// blocks dividing the rows, not dividing them, and a single block
+const std::vector<LstsqStreamingInputs<float>> inputsf = {
+  {0.001f, 4000, 16, 1000, lstsq_method::TSQR, 1234ULL},
+  {0.001f, 4000, 16, 777, lstsq_method::TSQR, 1234ULL},
+  {0.001f, 3000, 100, 5000, lstsq_method::TSQR, 1234ULL},
+  {0.001f, 4000, 16, 777, lstsq_method::NORMAL_EQUATIONS, 1234ULL},
+  {0.001f, 3000, 100, 512, lstsq_method::NORMAL_EQUATIONS, 1234ULL}};
+const std::vector<LstsqStreamingInputs<double>> inputsd = {
+  {0.000001, 4000, 16, 777, lstsq_method::TSQR, 1234ULL},
+  {0.000001, 3000, 100, 512, lstsq_method::TSQR, 1234ULL},
+  {0.000001, 3000, 100, 512, lstsq_method::NORMAL_EQUATIONS, 1234ULL}};
+
+typedef LstsqStreamingTest<float> LstsqStreamingTestF;
+TEST_P(LstsqStreamingTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(LstsqStreamingTests, LstsqStreamingTestF, ::testing::ValuesIn(inputsf));
+
+typedef LstsqStreamingTest<double> LstsqStreamingTestD;
+TEST_P(LstsqStreamingTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(LstsqStreamingTests, LstsqStreamingTestD, ::testing::ValuesIn(inputsd));
+
+}  // end namespace linalg
+}  // end namespace raft
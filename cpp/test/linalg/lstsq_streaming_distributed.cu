@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/linalg/lstsq.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace raft::linalg {
+
+template <typename T>
+struct LstsqAllreduceInputs {
+  T tolerance;
+  int n_ranks;
+  int n_rows, n_cols;
+  lstsq_method method;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const LstsqAllreduceInputs<T>& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", " << p.n_rows << ", " << p.n_cols << ", "
+     << (p.method == lstsq_method::TSQR ? "TSQR" : "NORMAL_EQUATIONS") << "}";
+  return os;
+}
+
+/**
+ * The rows of b = A x0 + noise are split in contiguous blocks across the ranks of an in-process
+ * clique: after allreduce, every rank should hold the accumulator of all the rows, with the
+ * solution of the accumulators of the blocks merged (in the order of the ranks) on one device.
+ */
+template <typename T>
+class LstsqAllreduceTest : public ::testing::TestWithParam<LstsqAllreduceInputs<T>> {
+ protected:
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<LstsqAllreduceInputs<T>>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    int n_rows = p.n_rows, n_cols = p.n_cols;
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    auto a = raft::make_host_matrix<T, int, raft::row_major>(n_rows, n_cols);
+    auto b = raft::make_host_vector<T, int>(n_rows);
+    std::vector<double> x0(n_cols);
+    for (auto& x : x0) {
+      x = uniform(gen);
+    }
+    for (int i = 0; i < n_rows; i++) {
+      double acc = 0.1 * uniform(gen);
+      for (int j = 0; j < n_cols; j++) {
+        a(i, j) = uniform(gen);
+        acc += double(a(i, j)) * x0[j];
+      }
+      b(i) = acc;
+    }
+    auto shard_begin = [&](int rank) { return int(int64_t(n_rows) * rank / p.n_ranks); };
+    auto add_shard   = [&](const raft::resources& handle, lstsq_accumulator<T>& acc, int rank) {
+      int begin = shard_begin(rank);
+      int rows  = shard_begin(rank + 1) - begin;
+      acc.update(handle,
+                 raft::make_host_matrix_view<const T, int, raft::row_major>(
+                   a.data_handle() + size_t(begin) * n_cols, rows, n_cols),
+                 raft::make_host_vector_view<const T, int>(b.data_handle() + begin, rows));
+    };
+
+    // the reference: the accumulators of the shards merged on the first device
+    std::vector<T> expected(n_cols);
+    {
+      raft::resources handle;
+      auto stream = resource::get_cuda_stream(handle);
+      auto w      = raft::make_device_vector<T, int>(handle, n_cols);
+      lstsq_accumulator<T> merged(handle, n_cols, p.method);
+      add_shard(handle, merged, 0);
+      for (int rank = 1; rank < p.n_ranks; rank++) {
+        lstsq_accumulator<T> other(handle, n_cols, p.method);
+        add_shard(handle, other, rank);
+        merged.merge(handle, other);
+      }
+      ASSERT_EQ(merged.n_rows(), int64_t(n_rows));
+      merged.solve(handle, w.view());
+      raft::update_host(expected.data(), w.data_handle(), n_cols, stream);
+      resource::sync_stream(handle);
+    }
+
+    nccl_clique clique(p.n_ranks);
+    std::vector<std::vector<T>> actual(p.n_ranks);
+    std::vector<int64_t> actual_rows(p.n_ranks);
+    clique.run([&](int rank, const raft::resources& handle) {
+      auto stream = resource::get_cuda_stream(handle);
+      auto w      = raft::make_device_vector<T, int>(handle, n_cols);
+      lstsq_accumulator<T> acc(handle, n_cols, p.method);
+      add_shard(handle, acc, rank);
+      acc.allreduce(handle);
+      actual_rows[rank] = acc.n_rows();
+      acc.solve(handle, w.view());
+      actual[rank].resize(n_cols);
+      raft::update_host(actual[rank].data(), w.data_handle(), n_cols, stream);
+      resource::sync_stream(handle);
+    });
+
+    for (int rank = 0; rank < p.n_ranks; rank++) {
+      ASSERT_EQ(actual_rows[rank], int64_t(n_rows)) << "rank " << rank;
+      // the ranks hold the same accumulator
+      ASSERT_TRUE(hostVecMatch(actual[0], actual[rank], raft::Compare<T>())) << "rank " << rank;
+    }
+    ASSERT_TRUE(hostVecMatch(expected, actual[0], raft::CompareApprox<T>(p.tolerance)));
+  }
+};
+
+const std::vector<LstsqAllreduceInputs<float>> inputsf = {
+  {0.001f, 1, 4000, 16, lstsq_method::TSQR},
+  {0.001f, 2, 4000, 16, lstsq_method::TSQR},
+  {0.001f, 2, 3001, 100, lstsq_method::TSQR},
+  {0.001f, 1, 4000, 16, lstsq_method::NORMAL_EQUATIONS},
+  {0.001f, 2, 3001, 100, lstsq_method::NORMAL_EQUATIONS}};
+const std::vector<LstsqAllreduceInputs<double>> inputsd = {
+  {0.000001, 2, 4000, 16, lstsq_method::TSQR},
+  {0.000001, 2, 3001, 100, lstsq_method::NORMAL_EQUATIONS}};
+
+typedef LstsqAllreduceTest<float> LstsqAllreduceTestF;
+TEST_P(LstsqAllreduceTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(LstsqAllreduceTests, LstsqAllreduceTestF, ::testing::ValuesIn(inputsf));
+
+typedef LstsqAllreduceTest<double> LstsqAllreduceTestD;
+TEST_P(LstsqAllreduceTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(LstsqAllreduceTests, LstsqAllreduceTestD, ::testing::ValuesIn(inputsd));
+
+}  // namespace raft::linalg
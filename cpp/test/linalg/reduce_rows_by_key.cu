@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,9 @@
 #include <raft/random/rng.cuh>
 #include <raft/util/cudart_utils.hpp>
 
+#include <thrust/execution_policy.h>
+#include <thrust/sort.h>
+
 namespace raft {
 namespace linalg {
 
@@ -76,6 +79,7 @@ struct ReduceRowsInputs {
   unsigned long long int seed;
   bool weighted;
   T max_weight;
+  bool sorted_keys;
 };
 
 template <typename T>
@@ -109,6 +113,9 @@ class ReduceRowTest : public ::testing::TestWithParam<ReduceRowsInputs<T>> {
     uint32_t nkeys = params.nkeys;
     uniform(handle, r, in.data(), nobs * cols, T(0.0), T(2.0 / nobs));
     uniformInt(handle, r_int, keys.data(), nobs, (uint32_t)0, nkeys);
+    if (params.sorted_keys) {
+      thrust::sort(thrust::cuda::par.on(stream), keys.data(), keys.data() + nobs);
+    }
 
     rmm::device_uvector<T> weight(0, stream);
     if (params.weighted) {
@@ -258,5 +265,23 @@ INSTANTIATE_TEST_CASE_P(ReduceRowTests,
                         ReduceRowTestManyClusters,
                         ::testing::ValuesIn(inputsf_many_cluster));
 
+// ReduceRowTestManySortedClusters
+// 100000 Obs, 37 cols, 20000 clusters, with the rows in random order or sorted by cluster
+const std::vector<ReduceRowsInputs<float>> inputsf_many_sorted_cluster = {
+  {0.00001f, 100000, 37, 20000, 1234ULL, false, 1.0, false},
+  {0.00001f, 100000, 37, 20000, 1234ULL, false, 1.0, true},
+  {0.00001f, 100000, 37, 20000, 1234ULL, true, 16.0, true}};
+typedef ReduceRowTest<float> ReduceRowTestManySortedClusters;
+TEST_P(ReduceRowTestManySortedClusters, Result)
+{
+  ASSERT_TRUE(raft::devArrMatch(out_ref.data(),
+                                out.data(),
+                                params.cols * params.nkeys,
+                                raft::CompareApprox<float>(params.tolerance)));
+}
+INSTANTIATE_TEST_CASE_P(ReduceRowTests,
+                        ReduceRowTestManySortedClusters,
+                        ::testing::ValuesIn(inputsf_many_sorted_cluster));
+
 }  // end namespace linalg
 }  // end namespace raft
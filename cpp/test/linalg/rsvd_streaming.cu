@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/linalg/rsvd.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace raft {
+namespace linalg {
+
+template <typename T>
+struct RsvdStreamingInputs {
+  T tolerance;
+  int n_rows, n_cols, rank, k, p, n_iters, batch_rows;
+  unsigned long long int seed;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const RsvdStreamingInputs<T>& p)
+{
+  os << "{" << p.n_rows << ", " << p.n_cols << ", rank " << p.rank << ", k " << p.k
+     << ", batch_rows " << p.batch_rows << "}";
+  return os;
+}
+
+/** Random orthonormal columns [n_rows, n_cols], row-major, by Gram-Schmidt. */
+template <typename T>
+auto random_orthonormal(std::mt19937& gen, int n_rows, int n_cols) -> std::vector<double>
+{
+  std::normal_distribution<double> dist;
+  std::vector<double> q(size_t(n_rows) * n_cols);
+  for (auto& x : q) {
+    x = dist(gen);
+  }
+  for (int j = 0; j < n_cols; j++) {
+    for (int pass = 0; pass < 2; pass++) {
+      for (int l = 0; l < j; l++) {
+        double dot = 0;
+        for (int i = 0; i < n_rows; i++) {
+          dot += q[size_t(i) * n_cols + j] * q[size_t(i) * n_cols + l];
+        }
+        for (int i = 0; i < n_rows; i++) {
+          q[size_t(i) * n_cols + j] -= dot * q[size_t(i) * n_cols + l];
+        }
+      }
+    }
+    double norm = 0;
+    for (int i = 0; i < n_rows; i++) {
+      norm += q[size_t(i) * n_cols + j] * q[size_t(i) * n_cols + j];
+    }
+    for (int i = 0; i < n_rows; i++) {
+      q[size_t(i) * n_cols + j] /= std::sqrt(norm);
+    }
+  }
+  return q;
+}
+
+/**
+ * A = U0 diag(s) V0^T of the given rank, with the singular values s_i = rank - i: the top-k
+ * singular values have to be recovered, and U S V^T gives A back when k is the rank.
+ */
+template <typename T>
+class RsvdStreamingTest : public ::testing::TestWithParam<RsvdStreamingInputs<T>> {
+ public:
+  RsvdStreamingTest()
+    : params(::testing::TestWithParam<RsvdStreamingInputs<T>>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    int n_rows = params.n_rows, n_cols = params.n_cols, rank = params.rank, k = params.k;
+    std::mt19937 gen(params.seed);
+    auto u0 = random_orthonormal<T>(gen, n_rows, rank);
+    auto v0 = random_orthonormal<T>(gen, n_cols, rank);
+    auto a  = raft::make_host_matrix<T, int, raft::row_major>(n_rows, n_cols);
+    for (int i = 0; i < n_rows; i++) {
+      for (int j = 0; j < n_cols; j++) {
+        double acc = 0;
+        for (int c = 0; c < rank; c++) {
+          acc += u0[size_t(i) * rank + c] * (rank - c) * v0[size_t(j) * rank + c];
+        }
+        a(i, j) = acc;
+      }
+    }
+
+    auto s = raft::make_device_vector<T, int>(handle, k);
+    auto v = raft::make_device_matrix<T, int, raft::col_major>(handle, k, n_cols);
+    auto u = raft::make_host_matrix<T, int, raft::row_major>(n_rows, k);
+    randomized_svd_streaming(handle,
+                             raft::make_const_mdspan(a.view()),
+                             s.view(),
+                             v.view(),
+                             std::make_optional(u.view()),
+                             params.p,
+                             params.n_iters,
+                             params.batch_rows,
+                             params.seed);
+    std::vector<T> h_s(k), h_v(size_t(k) * n_cols);
+    raft::update_host(h_s.data(), s.data_handle(), k, stream);
+    raft::update_host(h_v.data(), v.data_handle(), h_v.size(), stream);
+    resource::sync_stream(handle, stream);
+
+    // the singular values
+    for (int c = 0; c < k; c++) {
+      ASSERT_TRUE(raft::match(T(rank - c), h_s[c], raft::CompareApprox<T>(params.tolerance)))
+        << "singular value " << c;
+    }
+    // the reconstruction, when the whole rank is requested
+    if (k == rank) {
+      double max_err = 0;
+      for (int i = 0; i < n_rows; i++) {
+        for (int j = 0; j < n_cols; j++) {
+          double acc = 0;
+          for (int c = 0; c < k; c++) {
+            acc += double(u(i, c)) * h_s[c] * h_v[c + size_t(j) * k];
+          }
+          max_err = std::max(max_err, std::abs(acc - a(i, j)));
+        }
+      }
+      ASSERT_LT(max_err, params.tolerance * rank);
+    }
+
+    // the singular values only: the same result without the pass computing U
+    auto s_only = raft::make_device_vector<T, int>(handle, k);
+    randomized_svd_streaming(handle,
+                             raft::make_const_mdspan(a.view()),
+                             s_only.view(),
+                             v.view(),
+                             std::nullopt,
+                             params.p,
+                             params.n_iters,
+                             params.batch_rows,
+                             params.seed);
+    ASSERT_TRUE(raft::devArrMatch(
+      s.data_handle(), s_only.data_handle(), k, raft::CompareApprox<T>(params.tolerance), stream));
+  }
+
+  raft::resources handle;
+  RsvdStreamingInputs<T> params;
+  cudaStream_t stream = 0;
+};
+
+// blocks dividing the rows, not dividing them, and a single block
+const std::vector<RsvdStreamingInputs<float>> inputsf = {
+  {0.001f, 4000, 64, 8, 8, 8, 2, 1000, 1234ULL},
+  {0.001f, 4000, 64, 8, 8, 8, 2, 777, 1234ULL},
+  {0.001f, 3000, 100, 20, 5, 10, 4, 5000, 1234ULL}};
+const std::vector<RsvdStreamingInputs<double>> inputsd = {
+  {0.000001, 4000, 64, 8, 8, 8, 2, 777, 1234ULL},
+  {0.000001, 3000, 100, 20, 5, 10, 8, 512, 1234ULL}};
+
+typedef RsvdStreamingTest<float> RsvdStreamingTestF;
+TEST_P(RsvdStreamingTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(RsvdStreamingTests, RsvdStreamingTestF, ::testing::ValuesIn(inputsf));
+
+typedef RsvdStreamingTest<double> RsvdStreamingTestD;
+TEST_P(RsvdStreamingTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(RsvdStreamingTests, RsvdStreamingTestD, ::testing::ValuesIn(inputsd));
+
+}  // end namespace linalg
+}  // end namespace raft
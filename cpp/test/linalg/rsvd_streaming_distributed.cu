@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/linalg/rsvd.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace raft::linalg {
+
+template <typename T>
+struct RsvdDistributedInputs {
+  T tolerance;
+  int n_ranks;
+  int n_rows, n_cols, rank, k, p, n_iters, batch_rows;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const RsvdDistributedInputs<T>& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", " << p.n_rows << ", " << p.n_cols << ", rank " << p.rank
+     << ", k " << p.k << ", batch_rows " << p.batch_rows << "}";
+  return os;
+}
+
+/**
+ * A = G diag(rank - i) H of the given rank, with gaussian G and H, and its rows split in
+ * contiguous blocks across the ranks of an in-process clique: every rank should get the singular
+ * values and the right singular vectors (up to their signs) of randomized_svd_streaming of the
+ * whole matrix with the same seed, and the rows of U of its block give A back when k is the rank.
+ */
+template <typename T>
+class RsvdDistributedTest : public ::testing::TestWithParam<RsvdDistributedInputs<T>> {
+ protected:
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<RsvdDistributedInputs<T>>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    int n_rows = p.n_rows, n_cols = p.n_cols, rank = p.rank, k = p.k;
+    const uint64_t seed = 1234ULL;
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> normal;
+    std::vector<double> g(size_t(n_rows) * rank), h(size_t(rank) * n_cols);
+    for (auto& x : g) {
+      x = normal(gen) / std::sqrt(double(n_rows));
+    }
+    for (auto& x : h) {
+      x = normal(gen) / std::sqrt(double(n_cols));
+    }
+    auto a = raft::make_host_matrix<T, int, raft::row_major>(n_rows, n_cols);
+    for (int i = 0; i < n_rows; i++) {
+      for (int j = 0; j < n_cols; j++) {
+        double acc = 0;
+        for (int c = 0; c < rank; c++) {
+          acc += g[size_t(i) * rank + c] * (rank - c) * h[size_t(c) * n_cols + j];
+        }
+        a(i, j) = acc;
+      }
+    }
+
+    // the reference: the whole matrix streamed to the first device
+    std::vector<T> expected_s(k), expected_v(size_t(k) * n_cols);
+    {
+      raft::resources handle;
+      auto stream = resource::get_cuda_stream(handle);
+      auto s      = raft::make_device_vector<T, int>(handle, k);
+      auto v      = raft::make_device_matrix<T, int, raft::col_major>(handle, k, n_cols);
+      randomized_svd_streaming(handle,
+                               raft::make_const_mdspan(a.view()),
+                               s.view(),
+                               v.view(),
+                               std::nullopt,
+                               p.p,
+                               p.n_iters,
+                               p.batch_rows,
+                               seed);
+      raft::update_host(expected_s.data(), s.data_handle(), k, stream);
+      raft::update_host(expected_v.data(), v.data_handle(), expected_v.size(), stream);
+      resource::sync_stream(handle);
+    }
+
+    nccl_clique clique(p.n_ranks);
+    std::vector<std::vector<T>> actual_s(p.n_ranks), actual_v(p.n_ranks);
+    auto u = raft::make_host_matrix<T, int, raft::row_major>(n_rows, k);
+    clique.run([&](int r, const raft::resources& handle) {
+      auto stream = resource::get_cuda_stream(handle);
+      int begin   = int64_t(n_rows) * r / p.n_ranks;
+      int rows    = int64_t(n_rows) * (r + 1) / p.n_ranks - begin;
+      auto s      = raft::make_device_vector<T, int>(handle, k);
+      auto v      = raft::make_device_matrix<T, int, raft::col_major>(handle, k, n_cols);
+      // the ranks write disjoint rows of U
+      randomized_svd_streaming_distributed(
+        handle,
+        raft::make_host_matrix_view<const T, int, raft::row_major>(
+          a.data_handle() + size_t(begin) * n_cols, rows, n_cols),
+        s.view(),
+        v.view(),
+        std::make_optional(raft::make_host_matrix_view<T, int, raft::row_major>(
+          u.data_handle() + size_t(begin) * k, rows, k)),
+        p.p,
+        p.n_iters,
+        p.batch_rows,
+        seed);
+      actual_s[r].resize(k);
+      actual_v[r].resize(v.size());
+      raft::update_host(actual_s[r].data(), s.data_handle(), k, stream);
+      raft::update_host(actual_v[r].data(), v.data_handle(), v.size(), stream);
+      resource::sync_stream(handle);
+    });
+
+    for (int r = 0; r < p.n_ranks; r++) {
+      // the ranks hold the same decomposition
+      ASSERT_TRUE(hostVecMatch(actual_s[0], actual_s[r], raft::Compare<T>())) << "rank " << r;
+      ASSERT_TRUE(hostVecMatch(actual_v[0], actual_v[r], raft::Compare<T>())) << "rank " << r;
+    }
+    const auto& s = actual_s[0];
+    const auto& v = actual_v[0];
+    ASSERT_TRUE(hostVecMatch(expected_s, s, raft::CompareApprox<T>(p.tolerance)));
+    // the right singular vectors are unit vectors, equal up to their signs
+    for (int c = 0; c < k; c++) {
+      double dot = 0;
+      for (int j = 0; j < n_cols; j++) {
+        dot += double(expected_v[c + size_t(j) * k]) * v[c + size_t(j) * k];
+      }
+      ASSERT_NEAR(std::abs(dot), 1.0, p.tolerance) << "singular vector " << c;
+    }
+    // the reconstruction, when the whole rank is requested
+    if (k == rank) {
+      double max_err = 0;
+      for (int i = 0; i < n_rows; i++) {
+        for (int j = 0; j < n_cols; j++) {
+          double acc = 0;
+          for (int c = 0; c < k; c++) {
+            acc += double(u(i, c)) * s[c] * v[c + size_t(j) * k];
+          }
+          max_err = std::max(max_err, std::abs(acc - a(i, j)));
+        }
+      }
+      ASSERT_LT(max_err, p.tolerance * rank);
+    }
+  }
+};
+
+// blocks dividing the local rows, not dividing them, and a single block per rank
+const std::vector<RsvdDistributedInputs<float>> inputsf = {
+  {0.001f, 1, 4000, 64, 8, 8, 8, 2, 1000},
+  {0.001f, 2, 4000, 64, 8, 8, 8, 2, 1000},
+  {0.001f, 2, 4001, 64, 8, 8, 8, 2, 777},
+  {0.001f, 2, 3000, 100, 20, 5, 10, 4, 5000}};
+const std::vector<RsvdDistributedInputs<double>> inputsd = {
+  {0.000001, 2, 4001, 64, 8, 8, 8, 2, 777}, {0.000001, 2, 3000, 100, 20, 5, 10, 8, 512}};
+
+typedef RsvdDistributedTest<float> RsvdDistributedTestF;
+TEST_P(RsvdDistributedTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(RsvdDistributedTests, RsvdDistributedTestF, ::testing::ValuesIn(inputsf));
+
+typedef RsvdDistributedTest<double> RsvdDistributedTestD;
+TEST_P(RsvdDistributedTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(RsvdDistributedTests, RsvdDistributedTestD, ::testing::ValuesIn(inputsd));
+
+}  // namespace raft::linalg
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -24,9 +24,13 @@
 
 #include <gtest/gtest.h>
 #include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_mdspan.hpp>
 
 #include <rmm/device_uvector.hpp>
 
+#include <utility>
+#include <vector>
+
 namespace raft {
 namespace linalg {
 
@@ -261,5 +265,91 @@ TEST(TransposeTest, SubMatrix)
   test_transpose_submatrix<float, layout_f_contiguous>();
   test_transpose_submatrix<double, layout_f_contiguous>();
 }
+
+namespace {
+template <typename T, typename LayoutPolicy>
+void test_transpose_inplace(size_t n_rows, size_t n_cols)
+{
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+  std::vector<T> h_in(n_rows * n_cols);
+  for (size_t e = 0; e < h_in.size(); e++) {
+    h_in[e] = T(e);
+  }
+  rmm::device_uvector<T> d(h_in.size(), stream);
+  raft::update_device(d.data(), h_in.data(), h_in.size(), stream);
+
+  auto out = transpose_inplace(
+    handle, raft::make_device_matrix_view<T, size_t, LayoutPolicy>(d.data(), n_rows, n_cols));
+  ASSERT_EQ(out.extent(0), n_cols);
+  ASSERT_EQ(out.extent(1), n_rows);
+
+  std::vector<T> h_out(h_in.size());
+  raft::update_host(h_out.data(), d.data(), h_out.size(), stream);
+  resource::sync_stream(handle, stream);
+  auto in_h  = raft::make_host_matrix_view<T, size_t, LayoutPolicy>(h_in.data(), n_rows, n_cols);
+  auto out_h = raft::make_host_matrix_view<T, size_t, LayoutPolicy>(h_out.data(), n_cols, n_rows);
+  for (size_t i = 0; i < n_rows; ++i) {
+    for (size_t j = 0; j < n_cols; ++j) {
+      ASSERT_EQ(out_h(j, i), in_h(i, j)) << n_rows << " x " << n_cols << ", (" << i << ", " << j
+                                         << ")";
+    }
+  }
+}
+
+template <typename T>
+void test_batched_transpose(int batch_size, int n_rows, int n_cols)
+{
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+  size_t len  = size_t(batch_size) * n_rows * n_cols;
+  std::vector<T> h_in(len);
+  for (size_t e = 0; e < len; e++) {
+    h_in[e] = T(e);
+  }
+  rmm::device_uvector<T> d_in(len, stream), d_out(len, stream);
+  raft::update_device(d_in.data(), h_in.data(), len, stream);
+
+  batched_transpose(handle,
+                    raft::make_mdspan<const T, int, raft::row_major, false, true>(
+                      d_in.data(), raft::make_extents<int>(batch_size, n_rows, n_cols)),
+                    raft::make_mdspan<T, int, raft::row_major, false, true>(
+                      d_out.data(), raft::make_extents<int>(batch_size, n_cols, n_rows)));
+
+  std::vector<T> h_out(len);
+  raft::update_host(h_out.data(), d_out.data(), len, stream);
+  resource::sync_stream(handle, stream);
+  for (int b = 0; b < batch_size; ++b) {
+    for (int i = 0; i < n_rows; ++i) {
+      for (int j = 0; j < n_cols; ++j) {
+        ASSERT_EQ(h_out[(size_t(b) * n_cols + j) * n_rows + i],
+                  h_in[(size_t(b) * n_rows + i) * n_cols + j])
+          << "matrix " << b << ", (" << i << ", " << j << ")";
+      }
+    }
+  }
+}
+}  // namespace
+
+TEST(TransposeTest, InPlace)
+{
+  // square with full and partial tiles, and rectangular
+  const std::vector<std::pair<size_t, size_t>> shapes = {
+    {1, 1}, {3, 3}, {64, 64}, {100, 100}, {1, 17}, {7, 13}, {1000, 3}, {257, 129}, {96, 1024}};
+  for (auto [n_rows, n_cols] : shapes) {
+    test_transpose_inplace<float, layout_c_contiguous>(n_rows, n_cols);
+    test_transpose_inplace<double, layout_c_contiguous>(n_rows, n_cols);
+    test_transpose_inplace<float, layout_f_contiguous>(n_rows, n_cols);
+    test_transpose_inplace<int, layout_f_contiguous>(n_rows, n_cols);
+  }
+}
+
+TEST(TransposeTest, Batched)
+{
+  test_batched_transpose<float>(1, 32, 32);
+  test_batched_transpose<float>(10, 7, 300);
+  test_batched_transpose<double>(100, 33, 65);
+  test_batched_transpose<int>(3, 1000, 1);
+}
 }  // end namespace linalg
 }  // end namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,7 @@
 #include <algorithm>
 #include <gtest/gtest.h>
 #include <numeric>
+#include <random>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
@@ -150,5 +151,131 @@ TEST_P(ColumnSortF, Result)
 
 INSTANTIATE_TEST_CASE_P(ColumnSortTests, ColumnSortF, ::testing::ValuesIn(inputsf1));
 
+struct sort_inplace_inputs {
+  int n_rows;
+  int n_cols;
+  int ld;  // the stride of the rows (>= n_cols)
+  bool ascending;
+  bool with_values;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const sort_inplace_inputs& p)
+{
+  return os << "{" << p.n_rows << ", " << p.n_cols << ", ld " << p.ld
+            << (p.ascending ? ", asc" : ", desc") << (p.with_values ? ", pairs}" : ", keys}");
+}
+
+template <typename KeyT>
+class SortInplaceTest : public ::testing::TestWithParam<sort_inplace_inputs> {
+ protected:
+  void run()
+  {
+    auto p      = ::testing::TestWithParam<sort_inplace_inputs>::GetParam();
+    auto stream = resource::get_cuda_stream(handle);
+    size_t len  = size_t(p.n_rows) * p.ld;
+
+    // few distinct keys, so that the stability of the sort of the values is checked
+    std::vector<KeyT> keys(len);
+    std::vector<int> vals(len);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, std::max(2, p.n_cols / 4));
+    for (size_t i = 0; i < len; i++) {
+      // 64-bit keys beyond the range of 32-bit integers
+      keys[i] = KeyT(dist(gen)) * KeyT(sizeof(KeyT) > 4 ? int64_t{1} << 40 : 256);
+      vals[i] = int(i);
+    }
+    std::vector<KeyT> expected_keys(keys);
+    std::vector<int> expected_vals(vals);
+    for (int r = 0; r < p.n_rows; r++) {
+      std::vector<int> perm(p.n_cols);
+      std::iota(perm.begin(), perm.end(), 0);
+      const KeyT* row = keys.data() + size_t(r) * p.ld;
+      std::stable_sort(perm.begin(), perm.end(), [&](int a, int b) {
+        return p.ascending ? row[a] < row[b] : row[a] > row[b];
+      });
+      for (int c = 0; c < p.n_cols; c++) {
+        expected_keys[size_t(r) * p.ld + c] = row[perm[c]];
+        expected_vals[size_t(r) * p.ld + c] = vals[size_t(r) * p.ld + perm[c]];
+      }
+    }
+
+    rmm::device_uvector<KeyT> d_keys(len, stream);
+    rmm::device_uvector<int> d_vals(len, stream);
+    raft::update_device(d_keys.data(), keys.data(), len, stream);
+    raft::update_device(d_vals.data(), vals.data(), len, stream);
+    auto keys_view =
+      raft::make_device_strided_matrix_view<KeyT, int>(d_keys.data(), p.n_rows, p.n_cols, p.ld);
+    auto vals_view =
+      raft::make_device_strided_matrix_view<int, int>(d_vals.data(), p.n_rows, p.n_cols, p.ld);
+    if (p.with_values) {
+      raft::matrix::sort_cols_per_row_inplace(handle, keys_view, vals_view, p.ascending);
+    } else {
+      raft::matrix::sort_cols_per_row_inplace(handle, keys_view, p.ascending);
+    }
+
+    // the padding of the rows is left untouched
+    ASSERT_TRUE(devArrMatchHost(
+      expected_keys.data(), d_keys.data(), len, raft::Compare<KeyT>(), stream));
+    if (p.with_values) {
+      ASSERT_TRUE(devArrMatchHost(
+        expected_vals.data(), d_vals.data(), len, raft::Compare<int>(), stream));
+    }
+  }
+
+  raft::resources handle;
+};
+
+const std::vector<sort_inplace_inputs> sort_inplace_inputs_vec = {{100, 1, 1, true, true},
+                                                                  {100, 3, 5, true, true},
+                                                                  {1000, 10, 10, false, true},
+                                                                  {333, 16, 20, true, false},
+                                                                  {200, 31, 31, true, true},
+                                                                  {200, 100, 128, false, true},
+                                                                  {50, 500, 512, true, false},
+                                                                  {50, 1024, 1030, true, true},
+                                                                  {10, 1025, 1025, false, true},
+                                                                  {7, 3000, 3100, true, true},
+                                                                  {7, 3000, 3000, false, false}};
+
+using SortInplaceTestF = SortInplaceTest<float>;
+TEST_P(SortInplaceTestF, Result) { run(); }
+INSTANTIATE_TEST_CASE_P(ColumnSortTests,
+                        SortInplaceTestF,
+                        ::testing::ValuesIn(sort_inplace_inputs_vec));
+
+using SortInplaceTestI64 = SortInplaceTest<int64_t>;
+TEST_P(SortInplaceTestI64, Result) { run(); }
+INSTANTIATE_TEST_CASE_P(ColumnSortTests,
+                        SortInplaceTestI64,
+                        ::testing::ValuesIn(sort_inplace_inputs_vec));
+
+// the key-index sort of 64-bit keys (the short rows by the warp sort, the others by CUB)
+TEST(ColumnSortTests, Int64KeysIndices)
+{
+  raft::resources handle;
+  auto stream = resource::get_cuda_stream(handle);
+  for (int n_col : {7, 1000, 5000}) {
+    int n_row = 11;
+    std::vector<int64_t> keys(n_row * n_col);
+    std::vector<int> expected(n_row * n_col);
+    for (int i = 0; i < n_row * n_col; i++) {
+      keys[i] = (int64_t(i * 7919 % n_col) << 33) - int64_t(1) * (i % 3);
+    }
+    for (int r = 0; r < n_row; r++) {
+      const int64_t* row = keys.data() + r * n_col;
+      auto first         = expected.begin() + r * n_col;
+      std::iota(first, first + n_col, 0);
+      std::stable_sort(first, first + n_col, [row](int a, int b) { return row[a] < row[b]; });
+    }
+    auto d_keys = raft::make_device_matrix<int64_t, int>(handle, n_row, n_col);
+    auto d_out  = raft::make_device_matrix<int, int>(handle, n_row, n_col);
+    raft::update_device(d_keys.data_handle(), keys.data(), keys.size(), stream);
+    raft::matrix::sort_cols_per_row(handle, raft::make_const_mdspan(d_keys.view()), d_out.view());
+    ASSERT_TRUE(devArrMatchHost(
+      expected.data(), d_out.data_handle(), expected.size(), raft::Compare<int>(), stream))
+      << "n_col = " << n_col;
+  }
+}
+
 }  // end namespace matrix
 }  // end namespace raft
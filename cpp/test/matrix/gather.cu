@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,8 +18,10 @@
 #include <gtest/gtest.h>
 #include <raft/core/cudart_utils.hpp>
 #include <raft/core/device_mdspan.hpp>
+#include <raft/core/host_mdspan.hpp>
 #include <raft/core/operators.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/matrix/detail/gather_host.cuh>
 #include <raft/matrix/gather.cuh>
 #include <raft/random/rng.cuh>
 #include <raft/util/cuda_utils.cuh>
@@ -243,4 +245,96 @@ GATHER_TEST((GatherTest<false, false, true, float, uint32_t, int64_t>),
 GATHER_TEST((GatherTest<false, false, true, float, int64_t, int64_t>),
             GatherInplaceTestFI64I64,
             inplace_inputs_i64);
-}  // end namespace raft
\ No newline at end of file
+
+/** The gather from the host, by blocks of col_batch_size rows through the staging buffers */
+template <typename MatrixT, typename MapT, typename IdxT>
+class GatherFromHostTest : public ::testing::TestWithParam<GatherInputs<IdxT>> {
+ protected:
+  void testGather()
+  {
+    auto params     = ::testing::TestWithParam<GatherInputs<IdxT>>::GetParam();
+    auto stream     = resource::get_cuda_stream(handle);
+    IdxT map_length = params.map_length;
+    IdxT D          = params.ncols;
+    std::vector<MatrixT> h_in(params.nrows * D);
+    for (size_t i = 0; i < h_in.size(); i++) {
+      h_in[i] = MatrixT(i);
+    }
+    rmm::device_uvector<MapT> d_map(map_length, stream);
+    raft::random::RngState r(params.seed);
+    raft::random::uniformInt(handle, r, d_map.data(), map_length, MapT(0), MapT(params.nrows));
+    std::vector<MapT> h_map(map_length);
+    raft::update_host(h_map.data(), d_map.data(), map_length, stream);
+    resource::sync_stream(handle, stream);
+    auto transform_op =
+      raft::compose_op(raft::mod_const_op<IdxT>(params.nrows), raft::add_const_op<IdxT>(10));
+
+    std::vector<MatrixT> h_exp(map_length * D), h_exp_transform(map_length * D);
+    naiveGather<false, false>(h_in.data(),
+                              D,
+                              params.nrows,
+                              h_map.data(),
+                              (MatrixT*)nullptr,
+                              map_length,
+                              h_exp.data(),
+                              raft::identity_op(),
+                              raft::identity_op());
+    naiveGather<false, true>(h_in.data(),
+                             D,
+                             params.nrows,
+                             h_map.data(),
+                             (MatrixT*)nullptr,
+                             map_length,
+                             h_exp_transform.data(),
+                             raft::identity_op(),
+                             transform_op);
+
+    rmm::device_uvector<MatrixT> d_out(map_length * D, stream);
+    auto in_view  = raft::make_host_matrix_view<const MatrixT, IdxT>(h_in.data(), params.nrows, D);
+    auto out_view = raft::make_device_matrix_view<MatrixT, IdxT>(d_out.data(), map_length, D);
+    // the map on the host, and on the device
+    raft::matrix::gather(handle,
+                         in_view,
+                         raft::make_host_vector_view<const MapT, IdxT>(h_map.data(), map_length),
+                         out_view);
+    ASSERT_TRUE(
+      devArrMatchHost(h_exp.data(), d_out.data(), h_exp.size(), raft::Compare<MatrixT>(), stream));
+    raft::matrix::gather(handle,
+                         in_view,
+                         raft::make_device_vector_view<const MapT, IdxT>(d_map.data(), map_length),
+                         out_view,
+                         transform_op);
+    ASSERT_TRUE(devArrMatchHost(
+      h_exp_transform.data(), d_out.data(), h_exp.size(), raft::Compare<MatrixT>(), stream));
+    // several blocks through the two staging buffers
+    raft::matrix::detail::gather_from_host(handle,
+                                           h_in.data(),
+                                           D,
+                                           h_map.data(),
+                                           map_length,
+                                           d_out.data(),
+                                           raft::identity_op(),
+                                           params.col_batch_size);
+    ASSERT_TRUE(
+      devArrMatchHost(h_exp.data(), d_out.data(), h_exp.size(), raft::Compare<MatrixT>(), stream));
+  }
+
+  raft::resources handle;
+};
+
+const std::vector<GatherInputs<int64_t>> from_host_inputs_i64 =
+  raft::util::itertools::product<GatherInputs<int64_t>>(
+    {25, 2000}, {6, 129}, {1, 11, 999}, {1, 7, 1000}, {1234ULL});
+
+typedef GatherFromHostTest<float, uint32_t, int64_t> GatherFromHostTestFU32I64;
+TEST_P(GatherFromHostTestFU32I64, Result) { testGather(); }
+INSTANTIATE_TEST_CASE_P(GatherTests,
+                        GatherFromHostTestFU32I64,
+                        ::testing::ValuesIn(from_host_inputs_i64));
+
+typedef GatherFromHostTest<double, int64_t, int64_t> GatherFromHostTestDI64I64;
+TEST_P(GatherFromHostTestDI64I64, Result) { testGather(); }
+INSTANTIATE_TEST_CASE_P(GatherTests,
+                        GatherFromHostTestDI64I64,
+                        ::testing::ValuesIn(from_host_inputs_i64));
+}  // end namespace raft
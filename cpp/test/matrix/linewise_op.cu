@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -342,6 +342,82 @@ struct LinewiseTest : public ::testing::TestWithParam<typename ParamsReader::Par
     return runWithPaddedSpan(suggestDimensions(2), genData(params.workSizeBytes));
   }
 
+  /**
+   * A strided view (the lines are `ld >= lineLen` elements apart): the results match the dense
+   * ones, and the elements between the lines stay untouched.
+   */
+  testing::AssertionResult runStrided(bool rowMajor, bool alongLines, I lineLen, I nLines, I ld)
+  {
+    const T sentinel = T(-1000);
+    std::vector<T> h_in(ld * nLines, sentinel), h_out(ld * nLines);
+    std::vector<T> h_vec(alongLines ? lineLen : nLines);
+    for (I j = 0; j < nLines; j++) {
+      for (I i = 0; i < lineLen; i++) {
+        h_in[j * ld + i] = T((j * lineLen + i) % 17);
+      }
+    }
+    for (std::size_t i = 0; i < h_vec.size(); i++) {
+      h_vec[i] = T(i % 5 + 1);
+    }
+    std::vector<T> h_sentinel(h_in.size(), sentinel);
+    rmm::device_uvector<T> d_in(h_in.size(), stream), d_out(h_in.size(), stream),
+      d_vec(h_vec.size(), stream);
+    update_device(d_in.data(), h_in.data(), h_in.size(), stream);
+    update_device(d_out.data(), h_sentinel.data(), h_in.size(), stream);
+    update_device(d_vec.data(), h_vec.data(), h_vec.size(), stream);
+    auto vec_view = raft::make_device_vector_view<const T, I>(d_vec.data(), h_vec.size());
+    if (rowMajor) {
+      auto in_view = raft::make_device_strided_matrix_view<const T, I, row_major>(
+        d_in.data(), nLines, lineLen, ld);
+      auto out_view =
+        raft::make_device_strided_matrix_view<T, I, row_major>(d_out.data(), nLines, lineLen, ld);
+      matrix::linewise_op(handle, in_view, out_view, alongLines, raft::add_op{}, vec_view);
+    } else {
+      auto in_view = raft::make_device_strided_matrix_view<const T, I, col_major>(
+        d_in.data(), lineLen, nLines, ld);
+      auto out_view =
+        raft::make_device_strided_matrix_view<T, I, col_major>(d_out.data(), lineLen, nLines, ld);
+      matrix::linewise_op(handle, in_view, out_view, alongLines, raft::add_op{}, vec_view);
+    }
+    update_host(h_out.data(), d_out.data(), h_out.size(), stream);
+    stream.synchronize();
+    for (I j = 0; j < nLines; j++) {
+      for (I i = 0; i < ld; i++) {
+        T expected = i < lineLen ? h_in[j * ld + i] + h_vec[alongLines ? i : j] : sentinel;
+        if (h_out[j * ld + i] != expected) {
+          return testing::AssertionFailure()
+                 << (rowMajor ? "row-major" : "col-major") << ", "
+                 << (alongLines ? "along" : "across") << " lines; lineLen " << lineLen
+                 << ", nLines " << nLines << ", ld " << ld << ": element " << i << " of line "
+                 << j << " is " << h_out[j * ld + i] << " instead of " << expected;
+        }
+      }
+    }
+    return testing::AssertionSuccess();
+  }
+
+  testing::AssertionResult runWithStridedView()
+  {
+    std::vector<I> sizes       = {1, 3, 16, 33, 257};
+    testing::AssertionResult r = testing::AssertionSuccess();
+    for (bool rowMajor : {true, false}) {
+      for (bool alongLines : {true, false}) {
+        for (I lineLen : sizes) {
+          for (I nLines : sizes) {
+            // unaligned strides, and strides aligned to the 16-byte vectors
+            for (I pad : {I(0), I(1), I(5), I(8 - lineLen % 8)}) {
+              // a col-major single row with ld = 1 is taken as a row-major one
+              if (!rowMajor && lineLen + pad == 1) { continue; }
+              r = runStrided(rowMajor, alongLines, lineLen, nLines, lineLen + pad);
+              if (!r) return r;
+            }
+          }
+        }
+      }
+    }
+    return r;
+  }
+
   testing::AssertionResult runEdgeCases()
   {
     std::vector<I> sizes = {1, 2, 3, 4, 7, 16};
@@ -442,5 +518,8 @@ TEST_IT_SPAN(runWithPaddedSpan, Megabyte, double, int);
 TEST_IT_SPAN(runWithPaddedSpan, Gigabyte, float, int);
 TEST_IT_SPAN(runWithPaddedSpan, Gigabyte, double, int);
 
+TEST_IT_SPAN(runWithStridedView, Tiny, float, int);
+TEST_IT_SPAN(runWithStridedView, Tiny, double, int);
+
 }  // namespace matrix
 }  // end namespace raft
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/host_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/matrix/sample_rows.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <vector>
+
+namespace raft {
+namespace matrix {
+
+struct SampleRowsInputs {
+  int64_t n_rows, n_cols, n_samples;
+  bool host_dataset;
+  unsigned long long int seed;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const SampleRowsInputs& p)
+{
+  os << "{" << p.n_rows << ", " << p.n_cols << ", " << p.n_samples << ", "
+     << (p.host_dataset ? "host" : "device") << "}";
+  return os;
+}
+
+/** The rows of the dataset hold their index: the samples are distinct rows, in order. */
+template <typename T>
+class SampleRowsTest : public ::testing::TestWithParam<SampleRowsInputs> {
+ public:
+  SampleRowsTest()
+    : params(::testing::TestWithParam<SampleRowsInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    auto h_data = raft::make_host_matrix<T, int64_t>(params.n_rows, params.n_cols);
+    for (int64_t i = 0; i < params.n_rows; i++) {
+      for (int64_t j = 0; j < params.n_cols; j++) {
+        h_data(i, j) = T(i * params.n_cols + j);
+      }
+    }
+    auto d_data = raft::make_device_matrix<T, int64_t>(handle, params.n_rows, params.n_cols);
+    raft::copy(d_data.data_handle(), h_data.data_handle(), h_data.size(), stream);
+    auto out = raft::make_device_matrix<T, int64_t>(handle, params.n_samples, params.n_cols);
+
+    raft::random::RngState rng(params.seed);
+    if (params.host_dataset) {
+      sample_rows(handle, rng, raft::make_const_mdspan(h_data.view()), out.view());
+    } else {
+      sample_rows(handle, rng, raft::make_const_mdspan(d_data.view()), out.view());
+    }
+
+    std::vector<T> h_out(out.size());
+    raft::update_host(h_out.data(), out.data_handle(), h_out.size(), stream);
+    resource::sync_stream(handle, stream);
+    int64_t prev = -1;
+    for (int64_t i = 0; i < params.n_samples; i++) {
+      auto row = int64_t(h_out[i * params.n_cols]) / params.n_cols;
+      ASSERT_TRUE(row > prev && row < params.n_rows) << "sample " << i;
+      for (int64_t j = 0; j < params.n_cols; j++) {
+        ASSERT_EQ(h_out[i * params.n_cols + j], h_data(row, j)) << "sample " << i;
+      }
+      prev = row;
+    }
+  }
+
+  raft::resources handle;
+  SampleRowsInputs params;
+  cudaStream_t stream = 0;
+};
+
+const std::vector<SampleRowsInputs> inputs = {{10000, 16, 100, false, 1234ULL},
+                                              {10000, 16, 100, true, 1234ULL},
+                                              {1000, 3, 900, false, 42ULL},
+                                              {1000, 3, 900, true, 42ULL},
+                                              {100000, 1, 1000, true, 1234ULL},
+                                              {777, 129, 777, true, 1234ULL}};
+
+typedef SampleRowsTest<float> SampleRowsTestF;
+TEST_P(SampleRowsTestF, Result) { Run(); }
+INSTANTIATE_TEST_SUITE_P(SampleRowsTests, SampleRowsTestF, ::testing::ValuesIn(inputs));
+
+typedef SampleRowsTest<double> SampleRowsTestD;
+TEST_P(SampleRowsTestD, Result) { Run(); }
+INSTANTIATE_TEST_SUITE_P(SampleRowsTests, SampleRowsTestD, ::testing::ValuesIn(inputs));
+
+}  // namespace matrix
+}  // namespace raft
@@ -15,6 +15,10 @@
  */
 #include "select_k.cuh"
 
+#include <raft/matrix/select_k_tuning.hpp>
+
+#include <sstream>
+
 namespace raft::matrix {
 
 auto inputs_random_longlist = testing::Values(select::params{1, 130, 15, false},
@@ -145,4 +149,42 @@ INSTANTIATE_TEST_CASE_P(                                       // NOLINT
                                    SelectAlgo::kRadix11bits,
                                    SelectAlgo::kRadix11bitsExtraPass)));
 
+TEST(SelectKTuning, TableLookupAndSerialization)  // NOLINT
+{
+  select_k_tuning_table table;
+  table.device_name = "test device";
+  table.cc_major    = 8;
+  table.cc_minor    = 0;
+  table.sm_count    = 108;
+  table.batch_size  = {0, 2, 2};  // 1, 4
+  table.len         = {10, 1, 2};  // 1024, 2048
+  table.k           = {0, 4, 2};   // 1, 16
+  table.algos       = {SelectAlgo::kWarpImmediate,
+                       SelectAlgo::kWarpFiltered,
+                       SelectAlgo::kRadix8bits,
+                       SelectAlgo::kAuto,
+                       SelectAlgo::kRadix11bits,
+                       SelectAlgo::kWarpDistributed,
+                       SelectAlgo::kWarpDistributedShm,
+                       SelectAlgo::kRadix11bitsExtraPass};
+
+  std::stringstream ss;
+  table.save(ss);
+  table.save(ss);
+  auto loaded = select_k_tuning_table::load(ss);
+  ASSERT_EQ(loaded.device_name, table.device_name);
+  ASSERT_EQ(loaded.sm_count, table.sm_count);
+  ASSERT_EQ(loaded.algos, table.algos);
+  // a file may hold several tables
+  ASSERT_EQ(select_k_tuning_table::load(ss).algos, table.algos);
+
+  // batch and len go to the nearest grid point, k to the first point not below it
+  ASSERT_EQ(loaded.lookup(1, 1024, 1), SelectAlgo::kWarpImmediate);
+  ASSERT_EQ(loaded.lookup(1, 1024, 2), SelectAlgo::kWarpFiltered);
+  ASSERT_EQ(loaded.lookup(1, 1500, 16), std::nullopt);  // not measured
+  ASSERT_EQ(loaded.lookup(3, 3000, 16), SelectAlgo::kRadix11bitsExtraPass);
+  ASSERT_EQ(loaded.lookup(100000, 10, 1), SelectAlgo::kRadix11bits);
+  ASSERT_EQ(loaded.lookup(1, 1024, 17), std::nullopt);  // beyond the largest k
+}
+
 }  // namespace raft::matrix
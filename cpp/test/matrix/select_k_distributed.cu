@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/matrix/select_k.cuh>
+#include <raft/matrix/select_k_distributed.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace raft::matrix {
+
+struct SelectKDistributedInputs {
+  int n_ranks;
+  int64_t batch_size;
+  int64_t len;
+  int k;
+  bool select_min;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const SelectKDistributedInputs& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", " << p.batch_size << " x " << p.len << ", k " << p.k
+     << (p.select_min ? ", min" : ", max") << "}";
+  return os;
+}
+
+/**
+ * The columns of a random matrix are split in contiguous blocks across the ranks of an in-process
+ * clique: every rank should get the result of matrix::select_k of the whole matrix.
+ */
+class SelectKDistributedTest : public ::testing::TestWithParam<SelectKDistributedInputs> {
+ protected:
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<SelectKDistributedInputs>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::vector<float> in(p.batch_size * p.len);
+    for (auto& v : in) {
+      v = uniform(gen);
+    }
+
+    // the reference, on the first device
+    std::vector<float> expected_val(p.batch_size * p.k);
+    std::vector<int64_t> expected_idx(p.batch_size * p.k);
+    {
+      raft::resources handle;
+      auto stream  = resource::get_cuda_stream(handle);
+      auto d_in    = raft::make_device_matrix<float, int64_t>(handle, p.batch_size, p.len);
+      auto out_val = raft::make_device_matrix<float, int64_t>(handle, p.batch_size, p.k);
+      auto out_idx = raft::make_device_matrix<int64_t, int64_t>(handle, p.batch_size, p.k);
+      raft::update_device(d_in.data_handle(), in.data(), in.size(), stream);
+      select_k<float, int64_t>(handle,
+                               raft::make_const_mdspan(d_in.view()),
+                               std::nullopt,
+                               out_val.view(),
+                               out_idx.view(),
+                               p.select_min,
+                               true);
+      raft::update_host(expected_val.data(), out_val.data_handle(), expected_val.size(), stream);
+      raft::update_host(expected_idx.data(), out_idx.data_handle(), expected_idx.size(), stream);
+      resource::sync_stream(handle);
+    }
+
+    nccl_clique clique(p.n_ranks);
+    std::vector<std::vector<float>> actual_val(p.n_ranks);
+    std::vector<std::vector<int64_t>> actual_idx(p.n_ranks);
+    clique.run([&](int rank, const raft::resources& handle) {
+      auto stream         = resource::get_cuda_stream(handle);
+      const int64_t begin = p.len * rank / p.n_ranks;
+      const int64_t len   = p.len * (rank + 1) / p.n_ranks - begin;
+      std::vector<float> shard(p.batch_size * len);
+      for (int64_t i = 0; i < p.batch_size; i++) {
+        std::copy(in.begin() + i * p.len + begin,
+                  in.begin() + i * p.len + begin + len,
+                  shard.begin() + i * len);
+      }
+      auto d_shard = raft::make_device_matrix<float, int64_t>(handle, p.batch_size, len);
+      auto out_val = raft::make_device_matrix<float, int64_t>(handle, p.batch_size, p.k);
+      auto out_idx = raft::make_device_matrix<int64_t, int64_t>(handle, p.batch_size, p.k);
+      raft::update_device(d_shard.data_handle(), shard.data(), shard.size(), stream);
+      select_k_distributed<float, int64_t>(handle,
+                                           raft::make_const_mdspan(d_shard.view()),
+                                           std::nullopt,
+                                           begin,
+                                           out_val.view(),
+                                           out_idx.view(),
+                                           p.select_min);
+      actual_val[rank].resize(out_val.size());
+      actual_idx[rank].resize(out_idx.size());
+      raft::update_host(actual_val[rank].data(), out_val.data_handle(), out_val.size(), stream);
+      raft::update_host(actual_idx[rank].data(), out_idx.data_handle(), out_idx.size(), stream);
+      resource::sync_stream(handle);
+    });
+
+    // the values are distinct, so are the selected indices
+    for (int rank = 0; rank < p.n_ranks; rank++) {
+      ASSERT_TRUE(hostVecMatch(expected_val, actual_val[rank], raft::Compare<float>()))
+        << "rank " << rank;
+      ASSERT_TRUE(hostVecMatch(expected_idx, actual_idx[rank], raft::Compare<int64_t>()))
+        << "rank " << rank;
+    }
+  }
+};
+
+const std::vector<SelectKDistributedInputs> inputs = {{1, 10, 1000, 16, true},
+                                                      {1, 100, 5000, 64, false},
+                                                      {2, 10, 1000, 16, true},
+                                                      {2, 100, 5001, 64, false},
+                                                      {2, 7, 300, 150, true}};
+
+TEST_P(SelectKDistributedTest, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(SelectKDistributedTests,
+                        SelectKDistributedTest,
+                        ::testing::ValuesIn(inputs));
+
+}  // namespace raft::matrix
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/matrix/select_k.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace raft::matrix {
+
+struct SegmentedSelectInputs {
+  int64_t n_segments;
+  int64_t max_len;  // segment lengths are drawn uniformly in [0, max_len]
+  int k;
+  bool select_min;
+  bool sorted;
+};
+
+inline auto operator<<(std::ostream& os, const SegmentedSelectInputs& p) -> std::ostream&
+{
+  os << "{n_segments: " << p.n_segments << ", max_len: " << p.max_len << ", k: " << p.k
+     << ", select_min: " << p.select_min << ", sorted: " << p.sorted << "}";
+  return os;
+}
+
+template <typename T, typename IdxT>
+class SegmentedSelectTest : public ::testing::TestWithParam<SegmentedSelectInputs> {
+ public:
+  SegmentedSelectTest()
+    : params_(::testing::TestWithParam<SegmentedSelectInputs>::GetParam()),
+      stream_(resource::get_cuda_stream(handle_))
+  {
+  }
+
+  void run()
+  {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int64_t> len_dist(0, params_.max_len);
+    std::uniform_real_distribution<float> val_dist(-100.0f, 100.0f);
+
+    std::vector<int64_t> offsets(params_.n_segments + 1, 0);
+    for (int64_t i = 0; i < params_.n_segments; i++) {
+      offsets[i + 1] = offsets[i] + len_dist(gen);
+    }
+    const int64_t n_elems = offsets.back();
+    std::vector<T> values(n_elems);
+    std::vector<IdxT> ids(n_elems);
+    for (int64_t i = 0; i < n_elems; i++) {
+      values[i] = T(val_dist(gen));
+      ids[i]    = IdxT(n_elems - i);
+    }
+
+    const int k   = params_.k;
+    auto d_vals   = make_device_vector<T, int64_t>(handle_, n_elems);
+    auto d_ids    = make_device_vector<IdxT, int64_t>(handle_, n_elems);
+    auto d_offs   = make_device_vector<int64_t, int64_t>(handle_, offsets.size());
+    auto out_vals = make_device_matrix<T, int64_t>(handle_, params_.n_segments, k);
+    auto out_ids  = make_device_matrix<IdxT, int64_t>(handle_, params_.n_segments, k);
+    update_device(d_vals.data_handle(), values.data(), n_elems, stream_);
+    update_device(d_ids.data_handle(), ids.data(), n_elems, stream_);
+    update_device(d_offs.data_handle(), offsets.data(), offsets.size(), stream_);
+
+    select_k_segmented<T, IdxT>(handle_,
+                                make_const_mdspan(d_vals.view()),
+                                std::make_optional(make_const_mdspan(d_ids.view())),
+                                make_const_mdspan(d_offs.view()),
+                                out_vals.view(),
+                                out_ids.view(),
+                                params_.select_min,
+                                params_.sorted);
+
+    std::vector<T> res_vals(params_.n_segments * k);
+    std::vector<IdxT> res_ids(params_.n_segments * k);
+    update_host(res_vals.data(), out_vals.data_handle(), res_vals.size(), stream_);
+    update_host(res_ids.data(), out_ids.data_handle(), res_ids.size(), stream_);
+    resource::sync_stream(handle_);
+
+    const T pad = params_.select_min ? upper_bound<T>() : lower_bound<T>();
+    auto better = [this](T a, T b) { return params_.select_min ? a < b : a > b; };
+    for (int64_t s = 0; s < params_.n_segments; s++) {
+      const int64_t begin = offsets[s];
+      const int64_t len   = offsets[s + 1] - begin;
+      std::vector<T> expected(values.begin() + begin, values.begin() + begin + len);
+      std::sort(expected.begin(), expected.end(), better);
+      expected.resize(k, pad);
+
+      std::vector<T> actual(res_vals.begin() + s * k, res_vals.begin() + (s + 1) * k);
+      if (params_.sorted) {
+        ASSERT_TRUE(std::is_sorted(actual.begin(), actual.end(), better)) << "segment " << s;
+      } else {
+        std::sort(actual.begin(), actual.end(), better);
+      }
+      for (int j = 0; j < k; j++) {
+        ASSERT_EQ(expected[j], actual[j]) << "segment " << s << ", rank " << j;
+      }
+      // the selected payload must point at the selected values
+      for (int j = 0; j < k; j++) {
+        const IdxT id = res_ids[s * k + j];
+        if (id == static_cast<IdxT>(-1)) {
+          ASSERT_GE(int64_t(j), len) << "segment " << s;
+          continue;
+        }
+        const int64_t pos = n_elems - int64_t(id);
+        ASSERT_TRUE(pos >= begin && pos < begin + len) << "segment " << s << ", rank " << j;
+        ASSERT_EQ(values[pos], res_vals[s * k + j]) << "segment " << s << ", rank " << j;
+      }
+    }
+  }
+
+ protected:
+  raft::resources handle_;
+  SegmentedSelectInputs params_;
+  rmm::cuda_stream_view stream_;
+};
+
+// segment lengths span the empty, shorter-than-k, warpsort (<= 8192) and radix ranges
+const std::vector<SegmentedSelectInputs> inputs = {{100, 50, 10, true, true},
+                                                   {100, 50, 10, false, false},
+                                                   {200, 3000, 32, true, false},
+                                                   {200, 3000, 64, false, true},
+                                                   {50, 30000, 1, true, true},
+                                                   {50, 30000, 100, true, true},
+                                                   {50, 30000, 256, false, true},
+                                                   {30, 30000, 1000, true, false},
+                                                   {20, 100000, 2048, false, false}};
+
+using SegmentedSelectFloatInt64 = SegmentedSelectTest<float, int64_t>;
+TEST_P(SegmentedSelectFloatInt64, Run) { run(); }  // NOLINT
+INSTANTIATE_TEST_CASE_P(SegmentedSelectTests,
+                        SegmentedSelectFloatInt64,
+                        ::testing::ValuesIn(inputs));  // NOLINT
+
+using SegmentedSelectFloatUint32 = SegmentedSelectTest<float, uint32_t>;
+TEST_P(SegmentedSelectFloatUint32, Run) { run(); }  // NOLINT
+INSTANTIATE_TEST_CASE_P(SegmentedSelectTests,
+                        SegmentedSelectFloatUint32,
+                        ::testing::ValuesIn(inputs));  // NOLINT
+
+}  // namespace raft::matrix
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,11 +18,13 @@
 #include "../test_utils.cuh"
 #include "ann_utils.cuh"
 #include "knn_utils.cuh"
+#include <raft/core/bitset.cuh>
 #include <raft/core/device_mdarray.hpp>
 #include <raft/core/host_mdarray.hpp>
 #include <raft/core/mdspan.hpp>
 #include <raft/core/mdspan_types.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
 #include <raft/linalg/map.cuh>
 #include <raft/neighbors/brute_force_types.hpp>
@@ -44,6 +46,7 @@
 #include <raft/random/rng.cuh>
 #include <raft/stats/mean.cuh>
 
+#include <rmm/cuda_stream_pool.hpp>
 #include <rmm/cuda_stream_view.hpp>
 #include <rmm/device_buffer.hpp>
 
@@ -52,8 +55,10 @@
 #include <rmm/device_uvector.hpp>
 #include <thrust/sequence.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
+#include <limits>
 #include <vector>
 
 namespace raft::neighbors::brute_force {
@@ -185,6 +190,136 @@ class AnnBruteForceTest : public ::testing::TestWithParam<AnnBruteForceInputs<Id
     }
   }
 
+  void testStreaming()
+  {
+    size_t queries_size = ps.num_queries * ps.k;
+
+    rmm::device_uvector<T> distances_naive_dev(queries_size, stream_);
+    rmm::device_uvector<IdxT> indices_naive_dev(queries_size, stream_);
+    naive_knn<T, DataT, IdxT>(handle_,
+                              distances_naive_dev.data(),
+                              indices_naive_dev.data(),
+                              search_queries.data(),
+                              database.data(),
+                              ps.num_queries,
+                              ps.num_db_vecs,
+                              ps.dim,
+                              ps.k,
+                              ps.metric);
+
+    auto host_database = raft::make_host_matrix<DataT, IdxT>(ps.num_db_vecs, ps.dim);
+    raft::copy(host_database.data_handle(), database.data(), ps.num_db_vecs * ps.dim, stream_);
+    resource::sync_stream(handle_);
+
+    // Overlap the uploads with the search and split the dataset into several uneven chunks.
+    raft::resources handle_pool(handle_);
+    resource::set_cuda_stream_pool(handle_pool, std::make_shared<rmm::cuda_stream_pool>(1));
+    rmm::device_uvector<T> distances_streaming_dev(queries_size, stream_);
+    rmm::device_uvector<IdxT> indices_streaming_dev(queries_size, stream_);
+    brute_force::streaming_knn<DataT, IdxT>(
+      handle_pool,
+      raft::make_const_mdspan(host_database.view()),
+      raft::make_device_matrix_view<const DataT, IdxT>(
+        search_queries.data(), ps.num_queries, ps.dim),
+      raft::make_device_matrix_view<IdxT, IdxT>(
+        indices_streaming_dev.data(), ps.num_queries, ps.k),
+      raft::make_device_matrix_view<T, IdxT>(distances_streaming_dev.data(), ps.num_queries, ps.k),
+      ps.metric,
+      DataT(0),
+      ps.num_db_vecs / 7 + ps.k);
+    resource::sync_stream(handle_);
+
+    ASSERT_TRUE(raft::spatial::knn::devArrMatchKnnPair(indices_naive_dev.data(),
+                                                       indices_streaming_dev.data(),
+                                                       distances_naive_dev.data(),
+                                                       distances_streaming_dev.data(),
+                                                       ps.num_queries,
+                                                       ps.k,
+                                                       0.001f,
+                                                       stream_,
+                                                       true));
+  }
+
+  void testPrefiltered(IdxT n_pass_target)
+  {
+    // The rows passing the filter: every `step`-th one.
+    const IdxT step   = raft::ceildiv<IdxT>(ps.num_db_vecs, n_pass_target);
+    const IdxT n_pass = raft::ceildiv<IdxT>(ps.num_db_vecs, step);
+    std::vector<IdxT> pass_ids(n_pass);
+    for (IdxT i = 0; i < n_pass; i++) {
+      pass_ids[i] = i * step;
+    }
+    auto pass_ids_dev = raft::make_device_vector<IdxT, IdxT>(handle_, n_pass);
+    raft::copy(pass_ids_dev.data_handle(), pass_ids.data(), n_pass, stream_);
+    raft::core::bitset<uint32_t, IdxT> filter(
+      handle_, raft::make_const_mdspan(pass_ids_dev.view()), ps.num_db_vecs, false);
+
+    auto database_view = raft::make_device_matrix_view<const DataT, IdxT>(
+      (const DataT*)database.data(), ps.num_db_vecs, ps.dim);
+    auto idx = brute_force::build(handle_, database_view, ps.metric);
+
+    size_t queries_size = ps.num_queries * ps.k;
+    rmm::device_uvector<T> distances_dev(queries_size, stream_);
+    rmm::device_uvector<IdxT> indices_dev(queries_size, stream_);
+    brute_force::search_with_filtering(
+      handle_,
+      idx,
+      raft::make_device_matrix_view<const DataT, int64_t>(
+        search_queries.data(), ps.num_queries, ps.dim),
+      raft::make_device_matrix_view<IdxT, int64_t>(indices_dev.data(), ps.num_queries, ps.k),
+      raft::make_device_matrix_view<T, int64_t>(distances_dev.data(), ps.num_queries, ps.k),
+      filter.view());
+
+    if (n_pass < ps.k) {
+      // All the rows passing the filter are returned, followed by the missing results.
+      std::vector<IdxT> indices(queries_size);
+      raft::update_host(indices.data(), indices_dev.data(), queries_size, stream_);
+      resource::sync_stream(handle_);
+      for (IdxT q = 0; q < ps.num_queries; q++) {
+        std::vector<IdxT> found(indices.begin() + q * ps.k, indices.begin() + q * ps.k + n_pass);
+        std::sort(found.begin(), found.end());
+        ASSERT_EQ(found, pass_ids);
+        for (IdxT j = n_pass; j < ps.k; j++) {
+          ASSERT_EQ(indices[q * ps.k + j], std::numeric_limits<IdxT>::max());
+        }
+      }
+      return;
+    }
+
+    // The exact search over the subset, mapped back to the dataset rows.
+    auto subset = raft::make_device_matrix<DataT, IdxT>(handle_, n_pass, ps.dim);
+    raft::matrix::gather(
+      handle_, database_view, raft::make_const_mdspan(pass_ids_dev.view()), subset.view());
+    rmm::device_uvector<T> distances_naive_dev(queries_size, stream_);
+    rmm::device_uvector<IdxT> indices_naive_dev(queries_size, stream_);
+    naive_knn<T, DataT, IdxT>(handle_,
+                              distances_naive_dev.data(),
+                              indices_naive_dev.data(),
+                              search_queries.data(),
+                              subset.data_handle(),
+                              ps.num_queries,
+                              n_pass,
+                              ps.dim,
+                              ps.k,
+                              ps.metric);
+    raft::linalg::map(
+      handle_,
+      raft::make_device_vector_view<IdxT, IdxT>(indices_naive_dev.data(), queries_size),
+      raft::mul_const_op<IdxT>(step),
+      raft::make_device_vector_view<const IdxT, IdxT>(indices_naive_dev.data(), queries_size));
+    resource::sync_stream(handle_);
+
+    ASSERT_TRUE(raft::spatial::knn::devArrMatchKnnPair(indices_naive_dev.data(),
+                                                       indices_dev.data(),
+                                                       distances_naive_dev.data(),
+                                                       distances_dev.data(),
+                                                       ps.num_queries,
+                                                       ps.k,
+                                                       0.001f,
+                                                       stream_,
+                                                       true));
+  }
+
   void SetUp() override
   {
     database.resize(ps.num_db_vecs * ps.dim, stream_);
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,13 @@ namespace raft::neighbors::brute_force {
 
 using AnnBruteForceTest_float = AnnBruteForceTest<float, float, std::int64_t>;
 TEST_P(AnnBruteForceTest_float, AnnBruteForce) { this->testBruteForce(); }
+TEST_P(AnnBruteForceTest_float, AnnBruteForceStreaming) { this->testStreaming(); }
+TEST_P(AnnBruteForceTest_float, AnnBruteForcePrefiltered)
+{
+  // A selective filter, and a filter passing less than k rows.
+  this->testPrefiltered(100);
+  this->testPrefiltered(4);
+}
 
 INSTANTIATE_TEST_CASE_P(AnnBruteForceTest, AnnBruteForceTest_float, ::testing::ValuesIn(inputs));
 
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "../ann_brute_force.cuh"
+
+#include <raft/linalg/unary_op.cuh>
+
+#include <cuda_fp16.h>
+
+namespace raft::neighbors::brute_force {
+
+struct float_to_half_op {
+  __device__ auto operator()(float x) const -> half { return __float2half(x); }
+};
+
+struct half_to_float_op {
+  __device__ auto operator()(half x) const -> float { return __half2float(x); }
+};
+
+/** Search a half-precision index and compare with the exact search over the same (rounded) data. */
+class AnnBruteForceTest_half : public ::testing::TestWithParam<AnnBruteForceInputs<int64_t>> {
+ public:
+  AnnBruteForceTest_half()
+    : stream_(resource::get_cuda_stream(handle_)),
+      ps(::testing::TestWithParam<AnnBruteForceInputs<int64_t>>::GetParam())
+  {
+  }
+
+  void testBruteForce()
+  {
+    const size_t n_data    = ps.num_db_vecs * ps.dim;
+    const size_t n_queries = ps.num_queries * ps.dim;
+    rmm::device_uvector<float> database(n_data, stream_);
+    rmm::device_uvector<float> queries(n_queries, stream_);
+    rmm::device_uvector<half> database_half(n_data, stream_);
+    rmm::device_uvector<half> queries_half(n_queries, stream_);
+    raft::random::RngState r(1234ULL);
+    raft::random::uniform(handle_, r, database.data(), n_data, -1.0f, 1.0f);
+    raft::random::uniform(handle_, r, queries.data(), n_queries, -1.0f, 1.0f);
+    // Round the reference data to fp16, so that both searches see the same values.
+    raft::linalg::unaryOp(
+      database_half.data(), database.data(), n_data, float_to_half_op{}, stream_);
+    raft::linalg::unaryOp(
+      queries_half.data(), queries.data(), n_queries, float_to_half_op{}, stream_);
+    raft::linalg::unaryOp(
+      database.data(), database_half.data(), n_data, half_to_float_op{}, stream_);
+    raft::linalg::unaryOp(
+      queries.data(), queries_half.data(), n_queries, half_to_float_op{}, stream_);
+
+    const size_t queries_size = ps.num_queries * ps.k;
+    rmm::device_uvector<float> distances_naive_dev(queries_size, stream_);
+    rmm::device_uvector<int64_t> indices_naive_dev(queries_size, stream_);
+    naive_knn<float, float, int64_t>(handle_,
+                                     distances_naive_dev.data(),
+                                     indices_naive_dev.data(),
+                                     queries.data(),
+                                     database.data(),
+                                     ps.num_queries,
+                                     ps.num_db_vecs,
+                                     ps.dim,
+                                     ps.k,
+                                     ps.metric);
+
+    brute_force::index_params index_params{};
+    index_params.metric = ps.metric;
+    auto idx            = brute_force::build(
+      handle_,
+      index_params,
+      raft::make_device_matrix_view<const half, int64_t>(
+        database_half.data(), ps.num_db_vecs, ps.dim));
+    auto neighbors = raft::make_device_matrix<int64_t, int64_t>(handle_, ps.num_queries, ps.k);
+    auto distances = raft::make_device_matrix<float, int64_t>(handle_, ps.num_queries, ps.k);
+    brute_force::search(handle_,
+                        idx,
+                        raft::make_device_matrix_view<const half, int64_t>(
+                          queries_half.data(), ps.num_queries, ps.dim),
+                        neighbors.view(),
+                        distances.view());
+
+    std::vector<int64_t> indices_naive(queries_size);
+    std::vector<int64_t> indices_half(queries_size);
+    std::vector<float> distances_naive(queries_size);
+    std::vector<float> distances_half(queries_size);
+    raft::update_host(indices_naive.data(), indices_naive_dev.data(), queries_size, stream_);
+    raft::update_host(indices_half.data(), neighbors.data_handle(), queries_size, stream_);
+    raft::update_host(distances_naive.data(), distances_naive_dev.data(), queries_size, stream_);
+    raft::update_host(distances_half.data(), distances.data_handle(), queries_size, stream_);
+    resource::sync_stream(handle_);
+    // The fp32 accumulation order differs from the reference: allow swapping the near ties.
+    ASSERT_TRUE(eval_neighbours(indices_naive,
+                                indices_half,
+                                distances_naive,
+                                distances_half,
+                                ps.num_queries,
+                                ps.k,
+                                0.001,
+                                0.99));
+  }
+
+ private:
+  raft::resources handle_;
+  rmm::cuda_stream_view stream_;
+  AnnBruteForceInputs<int64_t> ps;
+};
+
+const std::vector<AnnBruteForceInputs<int64_t>> inputs_half = {
+  {1000, 10000, 16, 16, raft::distance::DistanceType::L2Expanded, false},
+  {1000, 10000, 768, 16, raft::distance::DistanceType::L2Expanded, false},
+  {1000, 10000, 127, 10, raft::distance::DistanceType::L2SqrtExpanded, false},
+  {1000, 10000, 768, 10, raft::distance::DistanceType::InnerProduct, false},
+  {100, 100000, 64, 64, raft::distance::DistanceType::InnerProduct, false},
+  {1000, 10000, 768, 10, raft::distance::DistanceType::CosineExpanded, false}};
+
+TEST_P(AnnBruteForceTest_half, AnnBruteForce) { this->testBruteForce(); }
+
+INSTANTIATE_TEST_CASE_P(AnnBruteForceTest,
+                        AnnBruteForceTest_half,
+                        ::testing::ValuesIn(inputs_half));
+
+}  // namespace raft::neighbors::brute_force
@@ -23,13 +23,20 @@
 
 #include <raft_internal/neighbors/naive_knn.cuh>
 
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdarray.hpp>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/device_resources.hpp>
 #include <raft/core/logger.hpp>
+#include <raft/core/pinned_mdarray.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/linalg/add.cuh>
 #include <raft/neighbors/cagra.cuh>
+#include <raft/neighbors/cagra_ipc.cuh>
+#include <raft/neighbors/cagra_multi_index.cuh>
+#include <raft/neighbors/cagra_search_server.cuh>
 #include <raft/neighbors/cagra_serialize.cuh>
+#include <raft/neighbors/cagra_sharded.cuh>
 #include <raft/neighbors/sample_filter.cuh>
 #include <raft/random/rng.cuh>
 #include <raft/util/itertools.hpp>
@@ -40,9 +47,13 @@
 
 #include <thrust/sequence.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace raft::neighbors::cagra {
@@ -179,10 +190,23 @@ inline ::std::ostream& operator<<(::std::ostream& os, const AnnCagraInputs& p)
   return os;
 }
 
+/** Host copies of the neighbors of the queries, row-major [n_queries, k]. */
+template <typename DistanceT, typename IdxT>
+struct host_neighbors {
+  std::vector<IdxT> indices;
+  std::vector<DistanceT> distances;
+
+  explicit host_neighbors(size_t size) : indices(size), distances(size) {}
+};
+
+/**
+ * The dataset and the queries of the CAGRA tests, with their exact neighbors and the checks of the
+ * search results against them.
+ */
 template <typename DistanceT, typename DataT, typename IdxT>
-class AnnCagraTest : public ::testing::TestWithParam<AnnCagraInputs> {
+class AnnCagraFixture : public ::testing::TestWithParam<AnnCagraInputs> {
  public:
-  AnnCagraTest()
+  AnnCagraFixture()
     : stream_(resource::get_cuda_stream(handle_)),
       ps(::testing::TestWithParam<AnnCagraInputs>::GetParam()),
       database(0, stream_),
@@ -191,110 +215,6 @@ class AnnCagraTest : public ::testing::TestWithParam<AnnCagraInputs> {
   }
 
  protected:
-  void testCagra()
-  {
-    size_t queries_size = ps.n_queries * ps.k;
-    std::vector<IdxT> indices_Cagra(queries_size);
-    std::vector<IdxT> indices_naive(queries_size);
-    std::vector<DistanceT> distances_Cagra(queries_size);
-    std::vector<DistanceT> distances_naive(queries_size);
-
-    {
-      rmm::device_uvector<DistanceT> distances_naive_dev(queries_size, stream_);
-      rmm::device_uvector<IdxT> indices_naive_dev(queries_size, stream_);
-      naive_knn<DistanceT, DataT, IdxT>(handle_,
-                                        distances_naive_dev.data(),
-                                        indices_naive_dev.data(),
-                                        search_queries.data(),
-                                        database.data(),
-                                        ps.n_queries,
-                                        ps.n_rows,
-                                        ps.dim,
-                                        ps.k,
-                                        ps.metric);
-      update_host(distances_naive.data(), distances_naive_dev.data(), queries_size, stream_);
-      update_host(indices_naive.data(), indices_naive_dev.data(), queries_size, stream_);
-      resource::sync_stream(handle_);
-    }
-
-    {
-      rmm::device_uvector<DistanceT> distances_dev(queries_size, stream_);
-      rmm::device_uvector<IdxT> indices_dev(queries_size, stream_);
-
-      {
-        cagra::index_params index_params;
-        index_params.metric = ps.metric;  // Note: currently ony the cagra::index_params metric is
-                                          // not used for knn_graph building.
-        index_params.build_algo = ps.build_algo;
-        cagra::search_params search_params;
-        search_params.algo        = ps.algo;
-        search_params.max_queries = ps.max_queries;
-        search_params.team_size   = ps.team_size;
-
-        auto database_view = raft::make_device_matrix_view<const DataT, int64_t>(
-          (const DataT*)database.data(), ps.n_rows, ps.dim);
-
-        {
-          cagra::index<DataT, IdxT> index(handle_);
-          if (ps.host_dataset) {
-            auto database_host = raft::make_host_matrix<DataT, int64_t>(ps.n_rows, ps.dim);
-            raft::copy(database_host.data_handle(), database.data(), database.size(), stream_);
-            auto database_host_view = raft::make_host_matrix_view<const DataT, int64_t>(
-              (const DataT*)database_host.data_handle(), ps.n_rows, ps.dim);
-            index = cagra::build<DataT, IdxT>(handle_, index_params, database_host_view);
-          } else {
-            index = cagra::build<DataT, IdxT>(handle_, index_params, database_view);
-          };
-          cagra::serialize(handle_, "cagra_index", index, ps.include_serialized_dataset);
-        }
-
-        auto index = cagra::deserialize<DataT, IdxT>(handle_, "cagra_index");
-        if (!ps.include_serialized_dataset) { index.update_dataset(handle_, database_view); }
-
-        auto search_queries_view = raft::make_device_matrix_view<const DataT, int64_t>(
-          search_queries.data(), ps.n_queries, ps.dim);
-        auto indices_out_view =
-          raft::make_device_matrix_view<IdxT, int64_t>(indices_dev.data(), ps.n_queries, ps.k);
-        auto dists_out_view = raft::make_device_matrix_view<DistanceT, int64_t>(
-          distances_dev.data(), ps.n_queries, ps.k);
-
-        cagra::search(
-          handle_, search_params, index, search_queries_view, indices_out_view, dists_out_view);
-        update_host(distances_Cagra.data(), distances_dev.data(), queries_size, stream_);
-        update_host(indices_Cagra.data(), indices_dev.data(), queries_size, stream_);
-        resource::sync_stream(handle_);
-      }
-
-      // for (int i = 0; i < min(ps.n_queries, 10); i++) {
-      //   //  std::cout << "query " << i << std::end;
-      //   print_vector("T", indices_naive.data() + i * ps.k, ps.k, std::cout);
-      //   print_vector("C", indices_Cagra.data() + i * ps.k, ps.k, std::cout);
-      //   print_vector("T", distances_naive.data() + i * ps.k, ps.k, std::cout);
-      //   print_vector("C", distances_Cagra.data() + i * ps.k, ps.k, std::cout);
-      // }
-      double min_recall = ps.min_recall;
-      EXPECT_TRUE(eval_neighbours(indices_naive,
-                                  indices_Cagra,
-                                  distances_naive,
-                                  distances_Cagra,
-                                  ps.n_queries,
-                                  ps.k,
-                                  0.003,
-                                  min_recall));
-      EXPECT_TRUE(eval_distances(handle_,
-                                 database.data(),
-                                 search_queries.data(),
-                                 indices_dev.data(),
-                                 distances_dev.data(),
-                                 ps.n_rows,
-                                 ps.dim,
-                                 ps.n_queries,
-                                 ps.k,
-                                 ps.metric,
-                                 1.0e-4));
-    }
-  }
-
   void SetUp() override
   {
     database.resize(((size_t)ps.n_rows) * ps.dim, stream_);
@@ -320,7 +240,97 @@ class AnnCagraTest : public ::testing::TestWithParam<AnnCagraInputs> {
     search_queries.resize(0, stream_);
   }
 
- private:
+  auto database_view() const -> raft::device_matrix_view<const DataT, int64_t>
+  {
+    return raft::make_device_matrix_view<const DataT, int64_t>(database.data(), ps.n_rows, ps.dim);
+  }
+
+  auto queries_view() const -> raft::device_matrix_view<const DataT, int64_t>
+  {
+    return raft::make_device_matrix_view<const DataT, int64_t>(
+      search_queries.data(), ps.n_queries, ps.dim);
+  }
+
+  /**
+   * The exact neighbors of the queries among the `n_rows` rows of the database starting at
+   * `row_offset` (by default, all the rows), with their ids in the whole database.
+   */
+  auto naive_neighbors(int64_t row_offset = 0, int64_t n_rows = -1)
+    -> host_neighbors<DistanceT, IdxT>
+  {
+    if (n_rows < 0) { n_rows = ps.n_rows - row_offset; }
+    size_t queries_size = ps.n_queries * ps.k;
+    host_neighbors<DistanceT, IdxT> naive(queries_size);
+    rmm::device_uvector<DistanceT> distances_naive_dev(queries_size, stream_);
+    rmm::device_uvector<IdxT> indices_naive_dev(queries_size, stream_);
+    naive_knn<DistanceT, DataT, IdxT>(handle_,
+                                      distances_naive_dev.data(),
+                                      indices_naive_dev.data(),
+                                      search_queries.data(),
+                                      database.data() + row_offset * ps.dim,
+                                      ps.n_queries,
+                                      n_rows,
+                                      ps.dim,
+                                      ps.k,
+                                      ps.metric);
+    if (row_offset > 0) {
+      raft::linalg::addScalar(indices_naive_dev.data(),
+                              indices_naive_dev.data(),
+                              IdxT(row_offset),
+                              queries_size,
+                              stream_);
+    }
+    update_host(naive.distances.data(), distances_naive_dev.data(), queries_size, stream_);
+    update_host(naive.indices.data(), indices_naive_dev.data(), queries_size, stream_);
+    resource::sync_stream(handle_);
+    return naive;
+  }
+
+  auto check_recall(const host_neighbors<DistanceT, IdxT>& expected,
+                    const host_neighbors<DistanceT, IdxT>& actual) -> testing::AssertionResult
+  {
+    return eval_neighbours(expected.indices,
+                           actual.indices,
+                           expected.distances,
+                           actual.distances,
+                           ps.n_queries,
+                           ps.k,
+                           0.003,
+                           ps.min_recall);
+  }
+
+  /**
+   * Copy the neighbors found on the device to the host and check their recall against `expected`
+   * and, if `check_distances`, their distances to the queries in the database.
+   */
+  auto check_neighbors(const host_neighbors<DistanceT, IdxT>& expected,
+                       const IdxT* indices_dev,
+                       const DistanceT* distances_dev,
+                       bool check_distances = true) -> host_neighbors<DistanceT, IdxT>
+  {
+    size_t queries_size = ps.n_queries * ps.k;
+    host_neighbors<DistanceT, IdxT> actual(queries_size);
+    update_host(actual.distances.data(), distances_dev, queries_size, stream_);
+    update_host(actual.indices.data(), indices_dev, queries_size, stream_);
+    resource::sync_stream(handle_);
+
+    EXPECT_TRUE(check_recall(expected, actual));
+    if (check_distances) {
+      EXPECT_TRUE(eval_distances(handle_,
+                                 database.data(),
+                                 search_queries.data(),
+                                 indices_dev,
+                                 distances_dev,
+                                 ps.n_rows,
+                                 ps.dim,
+                                 ps.n_queries,
+                                 ps.k,
+                                 ps.metric,
+                                 1.0e-4));
+    }
+    return actual;
+  }
+
   raft::resources handle_;
   rmm::cuda_stream_view stream_;
   AnnCagraInputs ps;
@@ -328,6 +338,702 @@ class AnnCagraTest : public ::testing::TestWithParam<AnnCagraInputs> {
   rmm::device_uvector<DataT> search_queries;
 };
 
+template <typename DistanceT, typename DataT, typename IdxT>
+class AnnCagraTest : public AnnCagraFixture<DistanceT, DataT, IdxT> {
+  using base = AnnCagraFixture<DistanceT, DataT, IdxT>;
+  using base::check_neighbors;
+  using base::check_recall;
+  using base::database;
+  using base::database_view;
+  using base::handle_;
+  using base::naive_neighbors;
+  using base::ps;
+  using base::queries_view;
+  using base::search_queries;
+  using base::stream_;
+
+ protected:
+  void testCagra()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+
+    {
+      cagra::index<DataT, IdxT> index(handle_);
+      if (ps.host_dataset) {
+        auto database_host = raft::make_host_matrix<DataT, int64_t>(ps.n_rows, ps.dim);
+        raft::copy(database_host.data_handle(), database.data(), database.size(), stream_);
+        index = cagra::build<DataT, IdxT>(
+          handle_, index_params, raft::make_const_mdspan(database_host.view()));
+      } else {
+        index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+      }
+      cagra::serialize(handle_, "cagra_index", index, ps.include_serialized_dataset);
+    }
+
+    auto index = cagra::deserialize<DataT, IdxT>(handle_, "cagra_index");
+    if (!ps.include_serialized_dataset) { index.update_dataset(handle_, database_view()); }
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraHostResidentDataset()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric                  = ps.metric;
+    index_params.build_algo              = ps.build_algo;
+    index_params.attach_dataset_on_build = false;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+
+    // The vectors stay in pinned host memory, only the graph is copied to the device.
+    auto database_pinned = raft::make_pinned_matrix<DataT, int64_t>(handle_, ps.n_rows, ps.dim);
+    raft::copy(database_pinned.data_handle(), database.data(), database.size(), stream_);
+    resource::sync_stream(handle_);
+
+    auto database_host_view = raft::make_host_matrix_view<const DataT, int64_t>(
+      database_pinned.data_handle(), ps.n_rows, ps.dim);
+
+    auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_host_view);
+    ASSERT_EQ(index.size(), IdxT(ps.n_rows));
+    index.attach_host_dataset(handle_, database_host_view);
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraSearchPlan()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size   = ps.itopk_size;
+    search_params.search_width = ps.search_width;
+
+    auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+
+    cagra::search_plan<DataT, IdxT> plan(handle_, search_params, index, ps.k);
+
+    // Reuse the plan for batches of different sizes.
+    const int batches[] = {1, ps.n_queries / 2 - 1, ps.n_queries - ps.n_queries / 2};
+    int offset          = 0;
+    for (int batch : batches) {
+      auto batch_queries = raft::make_device_matrix_view<const DataT, int64_t>(
+        search_queries.data() + offset * ps.dim, batch, ps.dim);
+      auto indices_view = raft::make_device_matrix_view<IdxT, int64_t>(
+        indices_dev.data_handle() + offset * ps.k, batch, ps.k);
+      auto dists_view = raft::make_device_matrix_view<DistanceT, int64_t>(
+        distances_dev.data_handle() + offset * ps.k, batch, ps.k);
+      cagra::search(handle_, plan, index, batch_queries, indices_view, dists_view);
+      offset += batch;
+    }
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraSharded()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    auto database_host = raft::make_host_matrix<DataT, int64_t>(ps.n_rows, ps.dim);
+    raft::copy(database_host.data_handle(), database.data(), database.size(), stream_);
+    resource::sync_stream(handle_);
+
+    // The test machines have a single GPU: place all shards on the current device.
+    const int dev = device_setter::get_current_device();
+    std::vector<int> devices(3, dev);
+    auto index = cagra::build_sharded<DataT, IdxT>(
+      index_params, raft::make_const_mdspan(database_host.view()), devices);
+    ASSERT_EQ(index.n_shards(), devices.size());
+    ASSERT_EQ(index.size(), IdxT(ps.n_rows));
+
+    cagra::search_sharded(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraOptimizeOutOfCore()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric = ps.metric;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    auto knn_graph =
+      raft::make_host_matrix<IdxT, int64_t>(ps.n_rows, index_params.intermediate_graph_degree);
+    cagra::build_knn_graph<DataT, IdxT>(handle_, database_view(), knn_graph.view());
+
+    // Small batches, so that the pruning and the reverse graph take several passes.
+    cagra::optimize_params optimize_params;
+    optimize_params.input_graph_placement = cagra::graph_placement::HOST;
+    optimize_params.prune_batch_size      = 97;
+    optimize_params.reverse_batch_size    = 251;
+
+    for (bool multi_gpu : {false, true}) {
+      auto graph = raft::make_host_matrix<IdxT, int64_t>(ps.n_rows, index_params.graph_degree);
+      if (multi_gpu) {
+        // The test machines have a single GPU: split the nodes across the current device.
+        const int dev = device_setter::get_current_device();
+        cagra::optimize<IdxT>(
+          optimize_params, knn_graph.view(), graph.view(), std::vector<int>(2, dev));
+      } else {
+        cagra::optimize<IdxT>(handle_, knn_graph.view(), graph.view(), optimize_params);
+      }
+      for (int64_t i = 0; i < graph.size(); i++) {
+        ASSERT_LT(graph.data_handle()[i], IdxT(ps.n_rows));
+      }
+
+      cagra::index<DataT, IdxT> index(
+        handle_, ps.metric, database_view(), raft::make_const_mdspan(graph.view()));
+      cagra::search(
+        handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+      check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle(), false);
+    }
+  }
+
+  void testCagraPartitionedBuild()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    // Build the NN-descent graph one cluster at a time from a host-resident dataset.
+    index_params.nn_descent_n_clusters      = 4;
+    index_params.nn_descent_cluster_overlap = 2;
+
+    auto database_host = raft::make_host_matrix<DataT, int64_t>(ps.n_rows, ps.dim);
+    raft::copy(database_host.data_handle(), database.data(), database.size(), stream_);
+    resource::sync_stream(handle_);
+    auto index = cagra::build<DataT, IdxT>(
+      handle_, index_params, raft::make_const_mdspan(database_host.view()));
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraCompressedGraph()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+
+    {
+      auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+      std::vector<IdxT> dense_graph(index.graph().size());
+      update_host(dense_graph.data(), index.graph().data_handle(), index.graph().size(), stream_);
+      resource::sync_stream(handle_);
+
+      // Packing must be lossless.
+      index.compress_graph(handle_);
+      ASSERT_GT(index.graph_bits(), 0u);
+      ASSERT_LT(index.graph_bits(), sizeof(IdxT) * 8);
+      ASSERT_EQ(index.size(), IdxT(ps.n_rows));
+      // The dense view is empty while the graph is packed.
+      ASSERT_EQ(index.graph().extent(0), 0);
+      ASSERT_EQ(index.graph().extent(1), int64_t(index.graph_degree()));
+      ASSERT_EQ(index.packed_graph().extent(0),
+                cagra::index<DataT, IdxT>::packed_graph_words(
+                  ps.n_rows, index.graph_degree(), index.graph_bits()));
+      index.decompress_graph(handle_);
+      ASSERT_EQ(index.graph_bits(), 0u);
+      std::vector<IdxT> restored_graph(index.graph().size());
+      update_host(
+        restored_graph.data(), index.graph().data_handle(), index.graph().size(), stream_);
+      resource::sync_stream(handle_);
+      ASSERT_EQ(dense_graph, restored_graph);
+
+      index.compress_graph(handle_);
+      cagra::serialize(handle_, "cagra_index_compressed", index, false);
+    }
+
+    auto index = cagra::deserialize<DataT, IdxT>(handle_, "cagra_index_compressed");
+    ASSERT_GT(index.graph_bits(), 0u);
+    index.update_dataset(handle_, database_view());
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraEntryPoints()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    constexpr uint32_t kEntryPoints = 32;
+    cagra::index_params index_params;
+    index_params.metric         = ps.metric;
+    index_params.build_algo     = ps.build_algo;
+    index_params.n_entry_points = kEntryPoints;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    std::vector<IdxT> entry_points(kEntryPoints);
+    {
+      auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+      ASSERT_EQ(index.entry_points().extent(0), int64_t(kEntryPoints));
+      update_host(entry_points.data(), index.entry_points().data_handle(), kEntryPoints, stream_);
+      resource::sync_stream(handle_);
+      for (auto id : entry_points) {
+        ASSERT_LT(id, IdxT(ps.n_rows));
+      }
+      cagra::serialize(handle_, "cagra_index_entry_points", index, false);
+    }
+
+    // The entry points are saved with the index.
+    auto index = cagra::deserialize<DataT, IdxT>(handle_, "cagra_index_entry_points");
+    index.update_dataset(handle_, database_view());
+    ASSERT_EQ(index.entry_points().extent(0), int64_t(kEntryPoints));
+    std::vector<IdxT> loaded_entry_points(kEntryPoints);
+    update_host(
+      loaded_entry_points.data(), index.entry_points().data_handle(), kEntryPoints, stream_);
+    resource::sync_stream(handle_);
+    ASSERT_EQ(entry_points, loaded_entry_points);
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraHnswlibImport()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    std::stringstream hnswlib_stream;
+    {
+      auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+      cagra::serialize_to_hnswlib(handle_, hnswlib_stream, index);
+    }
+    const std::string hnswlib_index = hnswlib_stream.str();
+
+    // The exported graph as is, and pruned again to half its degree.
+    for (bool optimize : {false, true}) {
+      cagra::hnswlib_import_params import_params;
+      import_params.metric       = ps.metric;
+      import_params.optimize     = optimize;
+      import_params.graph_degree = optimize ? index_params.graph_degree / 2 : 0;
+      std::istringstream is(hnswlib_index);
+      auto labels = raft::make_host_vector<uint64_t, int64_t>(0);
+      auto index  = cagra::from_hnswlib<DataT, IdxT>(handle_, is, import_params, &labels);
+      ASSERT_EQ(index.size(), IdxT(ps.n_rows));
+      ASSERT_EQ(index.dim(), uint32_t(ps.dim));
+      ASSERT_EQ(index.graph_degree(),
+                optimize ? index_params.graph_degree / 2 : index_params.graph_degree);
+      ASSERT_EQ(labels.extent(0), int64_t(ps.n_rows));
+      for (int64_t i = 0; i < labels.extent(0); i++) {
+        ASSERT_EQ(labels(i), uint64_t(i));
+      }
+
+      cagra::search(
+        handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+      check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+    }
+  }
+
+  void testCagraReordered()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    index_params.reordering = graph_reordering::BFS;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    {
+      auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+      ASSERT_EQ(index.source_indices().extent(0), int64_t(ps.n_rows));
+      // The source indices are a permutation of the dataset rows.
+      std::vector<IdxT> source_indices(ps.n_rows);
+      update_host(
+        source_indices.data(), index.source_indices().data_handle(), ps.n_rows, stream_);
+      resource::sync_stream(handle_);
+      std::sort(source_indices.begin(), source_indices.end());
+      for (int i = 0; i < ps.n_rows; i++) {
+        ASSERT_EQ(source_indices[i], IdxT(i));
+      }
+      cagra::serialize(handle_, "cagra_index_reordered", index, true);
+    }
+
+    // The reordered dataset and the source indices are saved with the index.
+    auto index = cagra::deserialize<DataT, IdxT>(handle_, "cagra_index_reordered");
+    ASSERT_EQ(index.source_indices().extent(0), int64_t(ps.n_rows));
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    // The neighbors are the rows of the input dataset.
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraReorderQueries()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::search_params search_params;
+    search_params.algo            = ps.algo;
+    search_params.max_queries     = ps.max_queries;
+    search_params.team_size       = ps.team_size;
+    search_params.itopk_size      = ps.itopk_size;
+    search_params.reorder_queries = true;
+
+    auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+
+    // The queries are sorted by a sample of the dataset rows, then by the entry points.
+    for (uint32_t n_entry_points : {0u, 16u}) {
+      cagra::build_entry_points(handle_, index, n_entry_points);
+      cagra::search(
+        handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+      // The results are returned in the order of the input queries.
+      check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+    }
+  }
+
+  void testCagraConcurrentSearch()
+  {
+    auto naive = naive_neighbors();
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    const auto index        = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+    resource::sync_stream(handle_);
+
+    // The threads share the index, each with its own resources; the different itopk sizes make
+    // them launch the search kernels with different amounts of shared memory.
+    constexpr int kThreads = 4;
+    std::vector<host_neighbors<DistanceT, IdxT>> results(
+      kThreads, host_neighbors<DistanceT, IdxT>(ps.n_queries * ps.k));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+      threads.emplace_back([&, t]() {
+        raft::device_resources res;
+        auto stream = resource::get_cuda_stream(res);
+        cagra::search_params search_params;
+        search_params.algo        = ps.algo;
+        search_params.max_queries = ps.max_queries;
+        search_params.team_size   = ps.team_size;
+        search_params.itopk_size  = ps.itopk_size << (t % 3);
+
+        auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(res, ps.n_queries, ps.k);
+        auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(res, ps.n_queries, ps.k);
+        for (int rep = 0; rep < 4; rep++) {
+          cagra::search(
+            res, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+        }
+        update_host(results[t].distances.data(),
+                    distances_dev.data_handle(),
+                    distances_dev.size(),
+                    stream);
+        update_host(
+          results[t].indices.data(), indices_dev.data_handle(), indices_dev.size(), stream);
+        resource::sync_stream(res);
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    for (int t = 0; t < kThreads; t++) {
+      EXPECT_TRUE(check_recall(naive, results[t])) << "thread " << t;
+    }
+  }
+
+  void testCagraIpcExport()
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    index_params.reordering = cagra::graph_reordering::BFS;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+    cagra::build_entry_points(handle_, index, 16);
+
+    // The import maps the allocation of another process; here only the export is checked, i.e.
+    // that the index keeps working from the shared allocation.
+    auto ipc = cagra::export_ipc(handle_, index);
+    ASSERT_TRUE(index.external_storage());
+    EXPECT_EQ(ipc.n_rows, int64_t(ps.n_rows));
+    EXPECT_EQ(ipc.dim, uint32_t(ps.dim));
+    EXPECT_EQ(ipc.graph_degree, index.graph_degree());
+    EXPECT_EQ(ipc.n_entry_points, 16);
+    EXPECT_EQ(ipc.n_source_indices, int64_t(ps.n_rows));
+    const auto* base = static_cast<const uint8_t*>(index.external_storage().get());
+    EXPECT_EQ(reinterpret_cast<const uint8_t*>(index.dataset().data_handle()),
+              base + ipc.dataset_offset);
+    EXPECT_EQ(reinterpret_cast<const uint8_t*>(index.graph().data_handle()),
+              base + ipc.graph_offset);
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
+
+  void testCagraRangeSearch()
+  {
+    auto naive = naive_neighbors();
+
+    // Below the smallest k-th neighbor distance, every neighborhood is within the naive top-k.
+    DistanceT radius = std::numeric_limits<DistanceT>::max();
+    for (size_t i = 0; i < ps.n_queries; i++) {
+      radius = std::min(radius, naive.distances[i * ps.k + ps.k - 1]);
+    }
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::range_search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+    // Start below the neighborhood sizes, so that the saturated queries are searched again.
+    search_params.initial_k = 4;
+    search_params.max_k     = 64;
+
+    auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+
+    auto result = raft::make_device_csr_matrix<DistanceT, int64_t, IdxT, int64_t>(
+      handle_, int64_t(ps.n_queries), IdxT(ps.n_rows));
+    cagra::range_search(handle_, search_params, index, queries_view(), radius, result);
+
+    auto structure    = result.structure_view();
+    const int64_t nnz = structure.get_nnz();
+    std::vector<int64_t> indptr(ps.n_queries + 1);
+    std::vector<IdxT> indices(nnz);
+    std::vector<DistanceT> distances(nnz);
+    update_host(indptr.data(), structure.get_indptr().data(), ps.n_queries + 1, stream_);
+    update_host(indices.data(), structure.get_indices().data(), nnz, stream_);
+    update_host(distances.data(), result.get_elements().data(), nnz, stream_);
+    resource::sync_stream(handle_);
+
+    ASSERT_EQ(indptr[0], 0);
+    ASSERT_EQ(indptr[ps.n_queries], nnz);
+    size_t n_expected = 0;
+    size_t n_found    = 0;
+    for (size_t i = 0; i < ps.n_queries; i++) {
+      ASSERT_LE(indptr[i], indptr[i + 1]);
+      ASSERT_LE(indptr[i + 1] - indptr[i], int64_t(search_params.max_k));
+      std::vector<IdxT> found(indices.begin() + indptr[i], indices.begin() + indptr[i + 1]);
+      for (int64_t j = indptr[i]; j < indptr[i + 1]; j++) {
+        ASSERT_LT(indices[j], IdxT(ps.n_rows));
+        ASSERT_LE(distances[j], radius);
+      }
+      for (size_t j = 0; j < ps.k; j++) {
+        if (naive.distances[i * ps.k + j] > radius) { break; }
+        n_expected++;
+        auto id = naive.indices[i * ps.k + j];
+        if (std::find(found.begin(), found.end(), id) != found.end()) { n_found++; }
+      }
+    }
+    ASSERT_GT(n_expected, size_t(0));
+    double recall = static_cast<double>(n_found) / n_expected;
+    EXPECT_GE(recall, ps.min_recall) << "range search recall = " << recall;
+  }
+
+  void testCagraSearchServer()
+  {
+    auto naive = naive_neighbors();
+    host_neighbors<DistanceT, IdxT> result(ps.n_queries * ps.k);
+
+    std::vector<DataT> queries_host(ps.n_queries * ps.dim);
+    update_host(queries_host.data(), search_queries.data(), queries_host.size(), stream_);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    auto index              = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+    resource::sync_stream(handle_);
+
+    cagra::search_server_params server_params;
+    server_params.algo        = ps.algo;
+    server_params.team_size   = ps.team_size;
+    server_params.itopk_size  = ps.itopk_size;
+    server_params.queue_size  = 16;  // fewer slots than queries to exercise the slot reuse
+    server_params.num_workers = 4;
+
+    {
+      cagra::search_server<DataT, IdxT> server(handle_, server_params, index, ps.k);
+
+      // Keep the queue full: submit new queries whenever the oldest one has been collected.
+      std::vector<uint64_t> tickets;
+      int n_polled = 0;
+      while (n_polled < ps.n_queries) {
+        while (int(tickets.size()) < ps.n_queries &&
+               int(tickets.size()) - n_polled < int(server_params.queue_size)) {
+          tickets.push_back(server.submit(raft::make_host_vector_view<const DataT, uint32_t>(
+            queries_host.data() + tickets.size() * ps.dim, ps.dim)));
+        }
+        auto neighbors = raft::make_host_vector_view<IdxT, uint32_t>(
+          result.indices.data() + n_polled * ps.k, ps.k);
+        auto distances = raft::make_host_vector_view<DistanceT, uint32_t>(
+          result.distances.data() + n_polled * ps.k, ps.k);
+        if (server.poll(tickets[n_polled], neighbors, distances)) { n_polled++; }
+      }
+    }
+
+    EXPECT_TRUE(check_recall(naive, result));
+  }
+
+  void testCagraMultiIndex()
+  {
+    // Split the dataset into indices of different sizes; the query q searches the index q % 3.
+    const std::vector<int64_t> offsets = {0, ps.n_rows / 5, ps.n_rows / 2, ps.n_rows};
+    const uint32_t n_indices           = offsets.size() - 1;
+    std::vector<uint32_t> index_ids(ps.n_queries);
+    for (int q = 0; q < ps.n_queries; q++) {
+      index_ids[q] = q % n_indices;
+    }
+
+    // The neighbors are the rows of the index searched by the query.
+    host_neighbors<DistanceT, IdxT> naive(ps.n_queries * ps.k);
+    for (uint32_t i = 0; i < n_indices; i++) {
+      auto part = naive_neighbors(offsets[i], offsets[i + 1] - offsets[i]);
+      for (int q = 0; q < ps.n_queries; q++) {
+        if (index_ids[q] != i) { continue; }
+        for (int j = q * ps.k; j < (q + 1) * ps.k; j++) {
+          naive.indices[j]   = part.indices[j] - IdxT(offsets[i]);
+          naive.distances[j] = part.distances[j];
+        }
+      }
+    }
+
+    cagra::index_params index_params;
+    index_params.metric                    = ps.metric;
+    index_params.build_algo                = ps.build_algo;
+    index_params.intermediate_graph_degree = 64;
+    index_params.graph_degree              = 32;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    std::vector<cagra::index<DataT, IdxT>> indices;
+    for (uint32_t i = 0; i < n_indices; i++) {
+      auto part_view = raft::make_device_matrix_view<const DataT, int64_t>(
+        database.data() + offsets[i] * ps.dim, offsets[i + 1] - offsets[i], ps.dim);
+      indices.push_back(cagra::build<DataT, IdxT>(handle_, index_params, part_view));
+    }
+    std::vector<const cagra::index<DataT, IdxT>*> index_ptrs;
+    for (const auto& index : indices) {
+      index_ptrs.push_back(&index);
+    }
+    cagra::multi_index<DataT, IdxT> packed(handle_, index_ptrs);
+    ASSERT_EQ(packed.n_indices(), n_indices);
+    ASSERT_EQ(packed.size(), ps.n_rows);
+
+    rmm::device_uvector<uint32_t> index_ids_dev(ps.n_queries, stream_);
+    raft::copy(index_ids_dev.data(), index_ids.data(), ps.n_queries, stream_);
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+    cagra::search_multi_index(
+      handle_,
+      search_params,
+      packed,
+      queries_view(),
+      raft::make_device_vector_view<const uint32_t, int64_t>(index_ids_dev.data(), ps.n_queries),
+      indices_dev.view(),
+      distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle(), false);
+  }
+};
+
 template <typename DistanceT, typename DataT, typename IdxT>
 class AnnCagraSortTest : public ::testing::TestWithParam<AnnCagraInputs> {
  public:
@@ -411,277 +1117,296 @@ class AnnCagraSortTest : public ::testing::TestWithParam<AnnCagraInputs> {
 };
 
 template <typename DistanceT, typename DataT, typename IdxT>
-class AnnCagraFilterTest : public ::testing::TestWithParam<AnnCagraInputs> {
- public:
-  AnnCagraFilterTest()
-    : stream_(resource::get_cuda_stream(handle_)),
-      ps(::testing::TestWithParam<AnnCagraInputs>::GetParam()),
-      database(0, stream_),
-      search_queries(0, stream_)
-  {
-  }
+class AnnCagraFilterTest : public AnnCagraFixture<DistanceT, DataT, IdxT> {
+  using base = AnnCagraFixture<DistanceT, DataT, IdxT>;
+  using base::check_neighbors;
+  using base::check_recall;
+  using base::database;
+  using base::database_view;
+  using base::handle_;
+  using base::naive_neighbors;
+  using base::ps;
+  using base::queries_view;
+  using base::stream_;
 
  protected:
-  void testCagraFilter()
+  /** Build the index of the dataset for the filtered searches, from the host if `host_dataset`. */
+  auto build_filtered_index() -> cagra::index<DataT, IdxT>
   {
-    size_t queries_size = ps.n_queries * ps.k;
-    std::vector<IdxT> indices_Cagra(queries_size);
-    std::vector<IdxT> indices_naive(queries_size);
-    std::vector<DistanceT> distances_Cagra(queries_size);
-    std::vector<DistanceT> distances_naive(queries_size);
+    cagra::index_params index_params;
+    index_params.metric           = ps.metric;
+    index_params.nn_descent_niter = 50;
 
-    {
-      rmm::device_uvector<DistanceT> distances_naive_dev(queries_size, stream_);
-      rmm::device_uvector<IdxT> indices_naive_dev(queries_size, stream_);
-      auto* database_filtered_ptr = database.data() + test_cagra_sample_filter::offset * ps.dim;
-      naive_knn<DistanceT, DataT, IdxT>(handle_,
-                                        distances_naive_dev.data(),
-                                        indices_naive_dev.data(),
-                                        search_queries.data(),
-                                        database_filtered_ptr,
-                                        ps.n_queries,
-                                        ps.n_rows - test_cagra_sample_filter::offset,
-                                        ps.dim,
-                                        ps.k,
-                                        ps.metric);
-      raft::linalg::addScalar(indices_naive_dev.data(),
-                              indices_naive_dev.data(),
-                              IdxT(test_cagra_sample_filter::offset),
-                              queries_size,
-                              stream_);
-      update_host(distances_naive.data(), distances_naive_dev.data(), queries_size, stream_);
-      update_host(indices_naive.data(), indices_naive_dev.data(), queries_size, stream_);
-      resource::sync_stream(handle_);
+    cagra::index<DataT, IdxT> index(handle_);
+    if (ps.host_dataset) {
+      auto database_host = raft::make_host_matrix<DataT, int64_t>(ps.n_rows, ps.dim);
+      raft::copy(database_host.data_handle(), database.data(), database.size(), stream_);
+      index = cagra::build<DataT, IdxT>(
+        handle_, index_params, raft::make_const_mdspan(database_host.view()));
+    } else {
+      index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
     }
+    if (!ps.include_serialized_dataset) { index.update_dataset(handle_, database_view()); }
+    return index;
+  }
 
-    {
-      rmm::device_uvector<DistanceT> distances_dev(queries_size, stream_);
-      rmm::device_uvector<IdxT> indices_dev(queries_size, stream_);
-
-      {
-        cagra::index_params index_params;
-        index_params.metric = ps.metric;  // Note: currently ony the cagra::index_params metric is
-                                          // not used for knn_graph building.
-        index_params.nn_descent_niter = 50;
-        cagra::search_params search_params;
-        search_params.algo         = ps.algo;
-        search_params.max_queries  = ps.max_queries;
-        search_params.team_size    = ps.team_size;
-        search_params.hashmap_mode = cagra::hash_mode::HASH;
-
-        auto database_view = raft::make_device_matrix_view<const DataT, int64_t>(
-          (const DataT*)database.data(), ps.n_rows, ps.dim);
-
-        cagra::index<DataT, IdxT> index(handle_);
-        if (ps.host_dataset) {
-          auto database_host = raft::make_host_matrix<DataT, int64_t>(ps.n_rows, ps.dim);
-          raft::copy(database_host.data_handle(), database.data(), database.size(), stream_);
-          auto database_host_view = raft::make_host_matrix_view<const DataT, int64_t>(
-            (const DataT*)database_host.data_handle(), ps.n_rows, ps.dim);
-          index = cagra::build<DataT, IdxT>(handle_, index_params, database_host_view);
-        } else {
-          index = cagra::build<DataT, IdxT>(handle_, index_params, database_view);
-        }
-
-        if (!ps.include_serialized_dataset) { index.update_dataset(handle_, database_view); }
-
-        auto search_queries_view = raft::make_device_matrix_view<const DataT, int64_t>(
-          search_queries.data(), ps.n_queries, ps.dim);
-        auto indices_out_view =
-          raft::make_device_matrix_view<IdxT, int64_t>(indices_dev.data(), ps.n_queries, ps.k);
-        auto dists_out_view = raft::make_device_matrix_view<DistanceT, int64_t>(
-          distances_dev.data(), ps.n_queries, ps.k);
-
-        cagra::search_with_filtering(handle_,
-                                     search_params,
-                                     index,
-                                     search_queries_view,
-                                     indices_out_view,
-                                     dists_out_view,
-                                     test_cagra_sample_filter());
-        update_host(distances_Cagra.data(), distances_dev.data(), queries_size, stream_);
-        update_host(indices_Cagra.data(), indices_dev.data(), queries_size, stream_);
-        resource::sync_stream(handle_);
-      }
+  auto filtered_search_params() const -> cagra::search_params
+  {
+    cagra::search_params search_params;
+    search_params.algo         = ps.algo;
+    search_params.max_queries  = ps.max_queries;
+    search_params.team_size    = ps.team_size;
+    search_params.hashmap_mode = cagra::hash_mode::HASH;
+    return search_params;
+  }
 
-      // Test filter
-      bool unacceptable_node = false;
-      for (int q = 0; q < ps.n_queries; q++) {
-        for (int i = 0; i < ps.k; i++) {
-          const auto n      = indices_Cagra[q * ps.k + i];
-          unacceptable_node = unacceptable_node | !test_cagra_sample_filter()(q, n);
-        }
+  void testCagraFilter()
+  {
+    auto naive         = naive_neighbors(test_cagra_sample_filter::offset);
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    auto index = build_filtered_index();
+    cagra::search_with_filtering(handle_,
+                                 filtered_search_params(),
+                                 index,
+                                 queries_view(),
+                                 indices_dev.view(),
+                                 distances_dev.view(),
+                                 test_cagra_sample_filter());
+    auto result = check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+
+    // Test filter
+    bool unacceptable_node = false;
+    for (int q = 0; q < ps.n_queries; q++) {
+      for (int i = 0; i < ps.k; i++) {
+        const auto n      = result.indices[q * ps.k + i];
+        unacceptable_node = unacceptable_node | !test_cagra_sample_filter()(q, n);
       }
-      EXPECT_FALSE(unacceptable_node);
-
-      double min_recall = ps.min_recall;
-      EXPECT_TRUE(eval_neighbours(indices_naive,
-                                  indices_Cagra,
-                                  distances_naive,
-                                  distances_Cagra,
-                                  ps.n_queries,
-                                  ps.k,
-                                  0.003,
-                                  min_recall));
-      EXPECT_TRUE(eval_distances(handle_,
-                                 database.data(),
-                                 search_queries.data(),
-                                 indices_dev.data(),
-                                 distances_dev.data(),
-                                 ps.n_rows,
-                                 ps.dim,
-                                 ps.n_queries,
-                                 ps.k,
-                                 ps.metric,
-                                 1.0e-4));
     }
+    EXPECT_FALSE(unacceptable_node);
   }
 
   void testCagraRemoved()
   {
-    size_t queries_size = ps.n_queries * ps.k;
-    std::vector<IdxT> indices_Cagra(queries_size);
-    std::vector<IdxT> indices_naive(queries_size);
-    std::vector<DistanceT> distances_Cagra(queries_size);
-    std::vector<DistanceT> distances_naive(queries_size);
-
-    {
-      rmm::device_uvector<DistanceT> distances_naive_dev(queries_size, stream_);
-      rmm::device_uvector<IdxT> indices_naive_dev(queries_size, stream_);
-      auto* database_filtered_ptr = database.data() + test_cagra_sample_filter::offset * ps.dim;
-      naive_knn<DistanceT, DataT, IdxT>(handle_,
-                                        distances_naive_dev.data(),
-                                        indices_naive_dev.data(),
-                                        search_queries.data(),
-                                        database_filtered_ptr,
-                                        ps.n_queries,
-                                        ps.n_rows - test_cagra_sample_filter::offset,
-                                        ps.dim,
-                                        ps.k,
-                                        ps.metric);
-      raft::linalg::addScalar(indices_naive_dev.data(),
-                              indices_naive_dev.data(),
-                              IdxT(test_cagra_sample_filter::offset),
-                              queries_size,
-                              stream_);
-      update_host(distances_naive.data(), distances_naive_dev.data(), queries_size, stream_);
-      update_host(indices_naive.data(), indices_naive_dev.data(), queries_size, stream_);
-      resource::sync_stream(handle_);
-    }
-
-    {
-      rmm::device_uvector<DistanceT> distances_dev(queries_size, stream_);
-      rmm::device_uvector<IdxT> indices_dev(queries_size, stream_);
-
-      {
-        cagra::index_params index_params;
-        index_params.metric = ps.metric;  // Note: currently ony the cagra::index_params metric is
-                                          // not used for knn_graph building.
-        index_params.nn_descent_niter = 50;
-        cagra::search_params search_params;
-        search_params.algo         = ps.algo;
-        search_params.max_queries  = ps.max_queries;
-        search_params.team_size    = ps.team_size;
-        search_params.hashmap_mode = cagra::hash_mode::HASH;
-
-        auto database_view = raft::make_device_matrix_view<const DataT, int64_t>(
-          (const DataT*)database.data(), ps.n_rows, ps.dim);
-
-        cagra::index<DataT, IdxT> index(handle_);
-        if (ps.host_dataset) {
-          auto database_host = raft::make_host_matrix<DataT, int64_t>(ps.n_rows, ps.dim);
-          raft::copy(database_host.data_handle(), database.data(), database.size(), stream_);
-          auto database_host_view = raft::make_host_matrix_view<const DataT, int64_t>(
-            (const DataT*)database_host.data_handle(), ps.n_rows, ps.dim);
-          index = cagra::build<DataT, IdxT>(handle_, index_params, database_host_view);
-        } else {
-          index = cagra::build<DataT, IdxT>(handle_, index_params, database_view);
-        }
-
-        if (!ps.include_serialized_dataset) { index.update_dataset(handle_, database_view); }
-
-        auto search_queries_view = raft::make_device_matrix_view<const DataT, int64_t>(
-          search_queries.data(), ps.n_queries, ps.dim);
-        auto indices_out_view =
-          raft::make_device_matrix_view<IdxT, int64_t>(indices_dev.data(), ps.n_queries, ps.k);
-        auto dists_out_view = raft::make_device_matrix_view<DistanceT, int64_t>(
-          distances_dev.data(), ps.n_queries, ps.k);
-        auto removed_indices =
-          raft::make_device_vector<IdxT, int64_t>(handle_, test_cagra_sample_filter::offset);
-        thrust::sequence(
-          resource::get_thrust_policy(handle_),
-          thrust::device_pointer_cast(removed_indices.data_handle()),
-          thrust::device_pointer_cast(removed_indices.data_handle() + removed_indices.extent(0)));
-        resource::sync_stream(handle_);
-        raft::core::bitset<std::uint32_t, IdxT> removed_indices_bitset(
-          handle_, removed_indices.view(), ps.n_rows);
-        cagra::search_with_filtering(
-          handle_,
-          search_params,
-          index,
-          search_queries_view,
-          indices_out_view,
-          dists_out_view,
-          raft::neighbors::filtering::bitset_filter(removed_indices_bitset.view()));
-        update_host(distances_Cagra.data(), distances_dev.data(), queries_size, stream_);
-        update_host(indices_Cagra.data(), indices_dev.data(), queries_size, stream_);
-        resource::sync_stream(handle_);
-      }
-
-      double min_recall = ps.min_recall;
-      EXPECT_TRUE(eval_neighbours(indices_naive,
-                                  indices_Cagra,
-                                  distances_naive,
-                                  distances_Cagra,
-                                  ps.n_queries,
-                                  ps.k,
-                                  0.003,
-                                  min_recall));
-      EXPECT_TRUE(eval_distances(handle_,
-                                 database.data(),
-                                 search_queries.data(),
-                                 indices_dev.data(),
-                                 distances_dev.data(),
-                                 ps.n_rows,
-                                 ps.dim,
-                                 ps.n_queries,
-                                 ps.k,
-                                 ps.metric,
-                                 1.0e-4));
-    }
+    auto naive         = naive_neighbors(test_cagra_sample_filter::offset);
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    auto index = build_filtered_index();
+
+    auto removed_indices =
+      raft::make_device_vector<IdxT, int64_t>(handle_, test_cagra_sample_filter::offset);
+    thrust::sequence(
+      resource::get_thrust_policy(handle_),
+      thrust::device_pointer_cast(removed_indices.data_handle()),
+      thrust::device_pointer_cast(removed_indices.data_handle() + removed_indices.extent(0)));
+    resource::sync_stream(handle_);
+    raft::core::bitset<std::uint32_t, IdxT> removed_indices_bitset(
+      handle_, removed_indices.view(), ps.n_rows);
+    cagra::search_with_filtering(
+      handle_,
+      filtered_search_params(),
+      index,
+      queries_view(),
+      indices_dev.view(),
+      distances_dev.view(),
+      raft::neighbors::filtering::bitset_filter(removed_indices_bitset.view()));
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
   }
 
-  void SetUp() override
+  /**
+   * Remove the first rows of the index with cagra::remove (they must not be returned by
+   * cagra::search anymore), then compact the index and check the search again.
+   */
+  void testCagraRemoveCompact()
   {
-    database.resize(((size_t)ps.n_rows) * ps.dim, stream_);
-    search_queries.resize(ps.n_queries * ps.dim, stream_);
-    raft::random::RngState r(1234ULL);
-    if constexpr (std::is_same<DataT, float>{}) {
-      GenerateRoundingErrorFreeDataset(handle_, database.data(), ps.n_rows, ps.dim, r, true);
-      GenerateRoundingErrorFreeDataset(
-        handle_, search_queries.data(), ps.n_queries, ps.dim, r, true);
-    } else {
-      raft::random::uniformInt(
-        handle_, r, database.data(), ps.n_rows * ps.dim, DataT(1), DataT(20));
-      raft::random::uniformInt(
-        handle_, r, search_queries.data(), ps.n_queries * ps.dim, DataT(1), DataT(20));
+    const int64_t offset = test_cagra_sample_filter::offset;
+
+    auto naive         = naive_neighbors(offset);
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric           = ps.metric;
+    index_params.nn_descent_niter = 50;
+
+    auto index         = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+    auto search_params = filtered_search_params();
+
+    auto removed_indices = raft::make_device_vector<IdxT, int64_t>(handle_, offset);
+    thrust::sequence(
+      resource::get_thrust_policy(handle_),
+      thrust::device_pointer_cast(removed_indices.data_handle()),
+      thrust::device_pointer_cast(removed_indices.data_handle() + removed_indices.extent(0)));
+    cagra::remove(handle_, index, raft::make_const_mdspan(removed_indices.view()));
+    // Removing nodes twice is a no-op.
+    cagra::remove(handle_, index, raft::make_const_mdspan(removed_indices.view()));
+    ASSERT_EQ(index.n_removed(), offset);
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    auto result =
+      check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle(), false);
+    bool removed_node = false;
+    for (auto id : result.indices) {
+      removed_node = removed_node || static_cast<int64_t>(id) < offset;
     }
+    EXPECT_FALSE(removed_node);
+
+    auto old_ids = cagra::compact(handle_, index);
+    ASSERT_EQ(index.size(), static_cast<size_t>(ps.n_rows - offset));
+    ASSERT_EQ(index.n_removed(), 0);
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    std::vector<IdxT> old_ids_host(old_ids.extent(0));
+    host_neighbors<DistanceT, IdxT> compacted(indices_dev.size());
+    update_host(old_ids_host.data(), old_ids.data_handle(), old_ids.extent(0), stream_);
+    update_host(compacted.distances.data(),
+                distances_dev.data_handle(),
+                distances_dev.size(),
+                stream_);
+    update_host(compacted.indices.data(), indices_dev.data_handle(), indices_dev.size(), stream_);
     resource::sync_stream(handle_);
+    for (size_t i = 0; i < old_ids_host.size(); i++) {
+      ASSERT_EQ(static_cast<int64_t>(old_ids_host[i]), static_cast<int64_t>(i) + offset);
+    }
+    for (auto& id : compacted.indices) {
+      if (id < old_ids_host.size()) { id = old_ids_host[id]; }
+    }
+    EXPECT_TRUE(check_recall(naive, compacted));
   }
 
-  void TearDown() override
+  /**
+   * Keep only the first `n_keep` rows with a bitset filter. With a small enough `n_keep` the search
+   * falls back to brute force; otherwise it exercises the itopk adjustment to the filtering rate.
+   */
+  void testCagraSelectiveFilter(int64_t n_keep, float brute_force_threshold)
   {
+    auto naive         = naive_neighbors(0, n_keep);
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric           = ps.metric;
+    index_params.nn_descent_niter = 50;
+
+    auto index = cagra::build<DataT, IdxT>(handle_, index_params, database_view());
+
+    auto search_params                         = filtered_search_params();
+    search_params.itopk_size                   = ps.itopk_size;
+    search_params.search_width                 = ps.search_width;
+    search_params.filter_brute_force_threshold = brute_force_threshold;
+
+    auto removed_indices = raft::make_device_vector<IdxT, int64_t>(handle_, ps.n_rows - n_keep);
+    thrust::sequence(
+      resource::get_thrust_policy(handle_),
+      thrust::device_pointer_cast(removed_indices.data_handle()),
+      thrust::device_pointer_cast(removed_indices.data_handle() + removed_indices.extent(0)),
+      IdxT(n_keep));
     resource::sync_stream(handle_);
-    database.resize(0, stream_);
-    search_queries.resize(0, stream_);
+    raft::core::bitset<std::uint32_t, IdxT> removed_indices_bitset(
+      handle_, removed_indices.view(), ps.n_rows);
+    cagra::search_with_filtering(
+      handle_,
+      search_params,
+      index,
+      queries_view(),
+      indices_dev.view(),
+      distances_dev.view(),
+      raft::neighbors::filtering::bitset_filter(removed_indices_bitset.view()));
+    auto result = check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+
+    bool unacceptable_node = false;
+    for (auto id : result.indices) {
+      unacceptable_node = unacceptable_node || id >= IdxT(n_keep);
+    }
+    EXPECT_FALSE(unacceptable_node);
   }
+};
 
- private:
-  raft::resources handle_;
-  rmm::cuda_stream_view stream_;
-  AnnCagraInputs ps;
-  rmm::device_uvector<DataT> database;
-  rmm::device_uvector<DataT> search_queries;
+template <typename DistanceT, typename DataT, typename IdxT>
+class AnnCagraAddNodesTest : public AnnCagraFixture<DistanceT, DataT, IdxT> {
+  using base = AnnCagraFixture<DistanceT, DataT, IdxT>;
+  using base::check_neighbors;
+  using base::database;
+  using base::handle_;
+  using base::naive_neighbors;
+  using base::ps;
+  using base::queries_view;
+  using base::stream_;
+
+ protected:
+  /**
+   * Build the index on `initial_fraction` of the dataset and add the rest with extend, in chunks
+   * of `max_chunk_size` vectors (auto when 0).
+   */
+  void testCagraAddNodes(double initial_fraction = 0.75, uint32_t max_chunk_size = 64)
+  {
+    auto naive         = naive_neighbors();
+    auto indices_dev   = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.n_queries, ps.k);
+    auto distances_dev = raft::make_device_matrix<DistanceT, int64_t>(handle_, ps.n_queries, ps.k);
+
+    cagra::index_params index_params;
+    index_params.metric     = ps.metric;
+    index_params.build_algo = ps.build_algo;
+    cagra::search_params search_params;
+    search_params.algo        = ps.algo;
+    search_params.max_queries = ps.max_queries;
+    search_params.team_size   = ps.team_size;
+    search_params.itopk_size  = ps.itopk_size;
+
+    // Build the index on the first part of the dataset and add the rest with extend.
+    const int64_t initial_size = ps.n_rows * initial_fraction;
+    const int64_t num_add      = ps.n_rows - initial_size;
+
+    auto initial_database_view = raft::make_device_matrix_view<const DataT, int64_t>(
+      (const DataT*)database.data(), initial_size, ps.dim);
+    auto additional_database_view = raft::make_device_matrix_view<const DataT, int64_t>(
+      (const DataT*)database.data() + initial_size * ps.dim, num_add, ps.dim);
+
+    auto index = cagra::build<DataT, IdxT>(handle_, index_params, initial_database_view);
+
+    cagra::extend_params extend_params;
+    extend_params.max_chunk_size = max_chunk_size;
+    if (ps.host_dataset) {
+      auto additional_host = raft::make_host_matrix<DataT, int64_t>(num_add, ps.dim);
+      raft::copy(additional_host.data_handle(),
+                 additional_database_view.data_handle(),
+                 additional_host.size(),
+                 stream_);
+      resource::sync_stream(handle_);
+      cagra::extend(
+        handle_, extend_params, raft::make_const_mdspan(additional_host.view()), index);
+    } else {
+      cagra::extend(handle_, extend_params, additional_database_view, index);
+    }
+    ASSERT_EQ(index.size(), IdxT(ps.n_rows));
+
+    // The nodes added after the first chunk link to the new nodes of the previous chunks.
+    const int64_t chunk_size =
+      max_chunk_size > 0 ? max_chunk_size : std::min<int64_t>({num_add, initial_size, 1024});
+    if (num_add > chunk_size) {
+      const uint32_t degree = index.graph_degree();
+      std::vector<IdxT> graph_h(index.graph().size());
+      raft::copy(graph_h.data(), index.graph().data_handle(), graph_h.size(), stream_);
+      resource::sync_stream(handle_);
+      int64_t num_linked = 0;
+      for (int64_t i = initial_size + chunk_size; i < ps.n_rows; i++) {
+        const IdxT* row = graph_h.data() + i * degree;
+        num_linked += std::any_of(row, row + degree, [&](IdxT j) {
+          return int64_t(j) >= initial_size && j != IdxT(i);
+        });
+      }
+      EXPECT_GE(num_linked, (ps.n_rows - initial_size - chunk_size) / 2)
+        << "the new nodes are not linked to each other";
+    }
+
+    cagra::search(
+      handle_, search_params, index, queries_view(), indices_dev.view(), distances_dev.view());
+    check_neighbors(naive, indices_dev.data_handle(), distances_dev.data_handle());
+  }
 };
 
 inline std::vector<AnnCagraInputs> generate_inputs()
@@ -789,9 +1514,318 @@ inline std::vector<AnnCagraInputs> generate_inputs()
     {0.995});
   inputs.insert(inputs.end(), inputs2.begin(), inputs2.end());
 
+  // the inner product and cosine metrics (NN-descent builds the L2 knn graph only)
+  inputs2 = raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000},
+    {8, 64, 137},
+    {16},
+    {graph_build_algo::IVF_PQ},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA, search_algo::MULTI_KERNEL},
+    {10},
+    {0},  // team_size
+    {64},
+    {1},
+    {raft::distance::DistanceType::InnerProduct, raft::distance::DistanceType::CosineExpanded},
+    {false, true},
+    {true},
+    {0.95});
+  inputs.insert(inputs.end(), inputs2.begin(), inputs2.end());
+
   return inputs;
 }
 
 const std::vector<AnnCagraInputs> inputs = generate_inputs();
 
+inline std::vector<AnnCagraInputs> generate_addnode_inputs()
+{
+  return raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {2000, 10000},
+    {1, 8, 17, 128},
+    {16},  // k
+    {graph_build_algo::IVF_PQ, graph_build_algo::NN_DESCENT},
+    {search_algo::AUTO},
+    {10},
+    {0},
+    {256},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false, true},
+    {true},
+    {0.9});
+}
+
+const std::vector<AnnCagraInputs> inputs_addnode = generate_addnode_inputs();
+
+// The rows of a host-resident dataset must be 16 bytes aligned.
+const std::vector<AnnCagraInputs> inputs_host_resident =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {16, 64, 128},
+    {16},  // k
+    {graph_build_algo::IVF_PQ, graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA, search_algo::MULTI_KERNEL},
+    {10},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {true},
+    {false},
+    {0.995});
+
+inline std::vector<AnnCagraInputs> generate_search_plan_inputs()
+{
+  std::vector<AnnCagraInputs> inputs = raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA, search_algo::MULTI_KERNEL},
+    {10, 64},  // max_queries
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.995});
+
+  // the multi-kernel merge of the children into a large itopk, several parents per iteration
+  auto inputs2 = raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::MULTI_KERNEL},
+    {10, 64},  // max_queries
+    {0},
+    {320, 512},  // itopk_size
+    {2, 4},      // search_width
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.995});
+  inputs.insert(inputs.end(), inputs2.begin(), inputs2.end());
+
+  return inputs;
+}
+
+const std::vector<AnnCagraInputs> inputs_search_plan = generate_search_plan_inputs();
+
+const std::vector<AnnCagraInputs> inputs_sharded =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA},
+    {0},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.995});
+
+const std::vector<AnnCagraInputs> inputs_partitioned_build =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_KERNEL},
+    {0},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.99});
+
+const std::vector<AnnCagraInputs> inputs_optimize_out_of_core =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::IVF_PQ},
+    {search_algo::SINGLE_CTA},
+    {10},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.995});
+
+const std::vector<AnnCagraInputs> inputs_compressed_graph =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA, search_algo::MULTI_KERNEL},
+    {0},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.995});
+
+inline std::vector<AnnCagraInputs> generate_selective_filter_inputs()
+{
+  std::vector<AnnCagraInputs> inputs = raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA, search_algo::MULTI_KERNEL},
+    {0},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.99});
+
+  // the largest single-CTA itopk, whose radix path falls back from the merge under a filter
+  auto inputs2 = raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA},
+    {0},
+    {0},
+    {512},  // itopk_size
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.99});
+  inputs.insert(inputs.end(), inputs2.begin(), inputs2.end());
+
+  return inputs;
+}
+
+const std::vector<AnnCagraInputs> inputs_selective_filter = generate_selective_filter_inputs();
+
+const std::vector<AnnCagraInputs> inputs_search_server =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {1, 16, 128, 256},
+    {1, 16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::AUTO, search_algo::SINGLE_CTA},
+    {0},
+    {0},
+    {64, 256},
+    {1},
+    {raft::distance::DistanceType::L2Expanded},
+    {false},
+    {false},
+    {0.995});
+
+const std::vector<AnnCagraInputs> inputs_entry_points =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA, search_algo::MULTI_KERNEL},
+    {10},
+    {0},
+    {32, 64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded, raft::distance::DistanceType::CosineExpanded},
+    {false},
+    {false},
+    {0.99});
+
+const std::vector<AnnCagraInputs> inputs_hnswlib_import =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA},
+    {10},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded, raft::distance::DistanceType::CosineExpanded},
+    {false},
+    {false},
+    {0.99});
+
+const std::vector<AnnCagraInputs> inputs_reordering =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA, search_algo::MULTI_KERNEL},
+    {10},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded, raft::distance::DistanceType::InnerProduct},
+    {false},
+    {false},
+    {0.99});
+
+const std::vector<AnnCagraInputs> inputs_range_search =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::SINGLE_CTA, search_algo::MULTI_CTA, search_algo::MULTI_KERNEL},
+    {0},
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded, raft::distance::DistanceType::CosineExpanded},
+    {false},
+    {false},
+    {0.99});
+
+const std::vector<AnnCagraInputs> inputs_multi_index =
+  raft::util::itertools::product<AnnCagraInputs>(
+    {100},
+    {1000, 10000},
+    {8, 128},
+    {16},  // k
+    {graph_build_algo::NN_DESCENT},
+    {search_algo::AUTO, search_algo::SINGLE_CTA},
+    {0, 10},  // query size
+    {0},
+    {64},
+    {1},
+    {raft::distance::DistanceType::L2Expanded, raft::distance::DistanceType::CosineExpanded},
+    {false},
+    {false},
+    {0.99});
+
 }  // namespace raft::neighbors::cagra
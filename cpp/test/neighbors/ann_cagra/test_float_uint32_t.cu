@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -23,6 +23,69 @@ namespace raft::neighbors::cagra {
 typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraTestF_U32;
 TEST_P(AnnCagraTestF_U32, AnnCagra) { this->testCagra(); }
 
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraHostResidentTestF_U32;
+TEST_P(AnnCagraHostResidentTestF_U32, AnnCagraHostResident)
+{
+  this->testCagraHostResidentDataset();
+}
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraSearchPlanTestF_U32;
+TEST_P(AnnCagraSearchPlanTestF_U32, AnnCagraSearchPlan) { this->testCagraSearchPlan(); }
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraShardedTestF_U32;
+TEST_P(AnnCagraShardedTestF_U32, AnnCagraSharded) { this->testCagraSharded(); }
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraPartitionedBuildTestF_U32;
+TEST_P(AnnCagraPartitionedBuildTestF_U32, AnnCagraPartitionedBuild)
+{
+  this->testCagraPartitionedBuild();
+}
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraOptimizeOutOfCoreTestF_U32;
+TEST_P(AnnCagraOptimizeOutOfCoreTestF_U32, AnnCagraOptimizeOutOfCore)
+{
+  this->testCagraOptimizeOutOfCore();
+}
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraCompressedGraphTestF_U32;
+TEST_P(AnnCagraCompressedGraphTestF_U32, AnnCagraCompressedGraph)
+{
+  this->testCagraCompressedGraph();
+}
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraEntryPointsTestF_U32;
+TEST_P(AnnCagraEntryPointsTestF_U32, AnnCagraEntryPoints) { this->testCagraEntryPoints(); }
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraHnswlibImportTestF_U32;
+TEST_P(AnnCagraHnswlibImportTestF_U32, AnnCagraHnswlibImport) { this->testCagraHnswlibImport(); }
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraReorderedTestF_U32;
+TEST_P(AnnCagraReorderedTestF_U32, AnnCagraReordered) { this->testCagraReordered(); }
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraReorderQueriesTestF_U32;
+TEST_P(AnnCagraReorderQueriesTestF_U32, AnnCagraReorderQueries)
+{
+  this->testCagraReorderQueries();
+}
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraConcurrentSearchTestF_U32;
+TEST_P(AnnCagraConcurrentSearchTestF_U32, AnnCagraConcurrentSearch)
+{
+  this->testCagraConcurrentSearch();
+}
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraIpcExportTestF_U32;
+TEST_P(AnnCagraIpcExportTestF_U32, AnnCagraIpcExport) { this->testCagraIpcExport(); }
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraRangeSearchTestF_U32;
+TEST_P(AnnCagraRangeSearchTestF_U32, AnnCagraRangeSearch) { this->testCagraRangeSearch(); }
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraSearchServerTestF_U32;
+TEST_P(AnnCagraSearchServerTestF_U32, AnnCagraSearchServer) { this->testCagraSearchServer(); }
+
+typedef AnnCagraTest<float, float, std::uint32_t> AnnCagraMultiIndexTestF_U32;
+TEST_P(AnnCagraMultiIndexTestF_U32, AnnCagraMultiIndex) { this->testCagraMultiIndex(); }
+
 typedef AnnCagraSortTest<float, float, std::uint32_t> AnnCagraSortTestF_U32;
 TEST_P(AnnCagraSortTestF_U32, AnnCagraSort) { this->testCagraSort(); }
 
@@ -33,8 +96,75 @@ TEST_P(AnnCagraFilterTestF_U32, AnnCagraFilter)
   this->testCagraRemoved();
 }
 
+TEST_P(AnnCagraFilterTestF_U32, AnnCagraRemoveCompact) { this->testCagraRemoveCompact(); }
+
+typedef AnnCagraFilterTest<float, float, std::uint32_t> AnnCagraSelectiveFilterTestF_U32;
+TEST_P(AnnCagraSelectiveFilterTestF_U32, AnnCagraSelectiveFilter)
+{
+  // A few rows pass the filter: brute force fallback.
+  this->testCagraSelectiveFilter(std::max<int64_t>(2 * ps.k, ps.n_rows / 200), 0.05);
+  // A fifth of the rows pass the filter: graph search with an enlarged itopk buffer.
+  this->testCagraSelectiveFilter(ps.n_rows / 5, 0.0);
+}
+
+typedef AnnCagraAddNodesTest<float, float, std::uint32_t> AnnCagraAddNodesTestF_U32;
+TEST_P(AnnCagraAddNodesTestF_U32, AnnCagraAddNodes) { this->testCagraAddNodes(); }
+// build on a quarter of the dataset, so that most neighbors of the new nodes are new nodes
+TEST_P(AnnCagraAddNodesTestF_U32, AnnCagraExtendMany) { this->testCagraAddNodes(0.25, 0); }
+
 INSTANTIATE_TEST_CASE_P(AnnCagraTest, AnnCagraTestF_U32, ::testing::ValuesIn(inputs));
 INSTANTIATE_TEST_CASE_P(AnnCagraSortTest, AnnCagraSortTestF_U32, ::testing::ValuesIn(inputs));
 INSTANTIATE_TEST_CASE_P(AnnCagraFilterTest, AnnCagraFilterTestF_U32, ::testing::ValuesIn(inputs));
+INSTANTIATE_TEST_CASE_P(AnnCagraSelectiveFilterTest,
+                        AnnCagraSelectiveFilterTestF_U32,
+                        ::testing::ValuesIn(inputs_selective_filter));
+INSTANTIATE_TEST_CASE_P(AnnCagraHostResidentTest,
+                        AnnCagraHostResidentTestF_U32,
+                        ::testing::ValuesIn(inputs_host_resident));
+INSTANTIATE_TEST_CASE_P(AnnCagraSearchPlanTest,
+                        AnnCagraSearchPlanTestF_U32,
+                        ::testing::ValuesIn(inputs_search_plan));
+INSTANTIATE_TEST_CASE_P(AnnCagraShardedTest,
+                        AnnCagraShardedTestF_U32,
+                        ::testing::ValuesIn(inputs_sharded));
+INSTANTIATE_TEST_CASE_P(AnnCagraPartitionedBuildTest,
+                        AnnCagraPartitionedBuildTestF_U32,
+                        ::testing::ValuesIn(inputs_partitioned_build));
+INSTANTIATE_TEST_CASE_P(AnnCagraOptimizeOutOfCoreTest,
+                        AnnCagraOptimizeOutOfCoreTestF_U32,
+                        ::testing::ValuesIn(inputs_optimize_out_of_core));
+INSTANTIATE_TEST_CASE_P(AnnCagraCompressedGraphTest,
+                        AnnCagraCompressedGraphTestF_U32,
+                        ::testing::ValuesIn(inputs_compressed_graph));
+INSTANTIATE_TEST_CASE_P(AnnCagraEntryPointsTest,
+                        AnnCagraEntryPointsTestF_U32,
+                        ::testing::ValuesIn(inputs_entry_points));
+INSTANTIATE_TEST_CASE_P(AnnCagraHnswlibImportTest,
+                        AnnCagraHnswlibImportTestF_U32,
+                        ::testing::ValuesIn(inputs_hnswlib_import));
+INSTANTIATE_TEST_CASE_P(AnnCagraReorderedTest,
+                        AnnCagraReorderedTestF_U32,
+                        ::testing::ValuesIn(inputs_reordering));
+INSTANTIATE_TEST_CASE_P(AnnCagraReorderQueriesTest,
+                        AnnCagraReorderQueriesTestF_U32,
+                        ::testing::ValuesIn(inputs_reordering));
+INSTANTIATE_TEST_CASE_P(AnnCagraConcurrentSearchTest,
+                        AnnCagraConcurrentSearchTestF_U32,
+                        ::testing::ValuesIn(inputs_reordering));
+INSTANTIATE_TEST_CASE_P(AnnCagraIpcExportTest,
+                        AnnCagraIpcExportTestF_U32,
+                        ::testing::ValuesIn(inputs_reordering));
+INSTANTIATE_TEST_CASE_P(AnnCagraRangeSearchTest,
+                        AnnCagraRangeSearchTestF_U32,
+                        ::testing::ValuesIn(inputs_range_search));
+INSTANTIATE_TEST_CASE_P(AnnCagraSearchServerTest,
+                        AnnCagraSearchServerTestF_U32,
+                        ::testing::ValuesIn(inputs_search_server));
+INSTANTIATE_TEST_CASE_P(AnnCagraMultiIndexTest,
+                        AnnCagraMultiIndexTestF_U32,
+                        ::testing::ValuesIn(inputs_multi_index));
+INSTANTIATE_TEST_CASE_P(AnnCagraAddNodesTest,
+                        AnnCagraAddNodesTestF_U32,
+                        ::testing::ValuesIn(inputs_addnode));
 
 }  // namespace raft::neighbors::cagra
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,6 +21,7 @@
 #include <raft/core/host_mdarray.hpp>
 #include <raft/core/mdspan.hpp>
 #include <raft/core/mdspan_types.hpp>
+#include <raft/core/operators.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resource/thrust_policy.hpp>
 #include <raft/linalg/map.cuh>
@@ -39,6 +40,7 @@
 #include <raft/matrix/gather.cuh>
 #include <raft/neighbors/ivf_flat.cuh>
 #include <raft/neighbors/ivf_flat_helpers.cuh>
+#include <raft/neighbors/ivf_flat_serialize.cuh>
 #include <raft/random/rng.cuh>
 #include <raft/spatial/knn/ann.cuh>
 #include <raft/spatial/knn/knn.cuh>
@@ -50,10 +52,13 @@
 #include <gtest/gtest.h>
 
 #include <rmm/device_uvector.hpp>
+#include <thrust/fill.h>
 #include <thrust/sequence.h>
 
 #include <cstddef>
 #include <iostream>
+#include <sstream>
+#include <type_traits>
 #include <vector>
 
 namespace raft::neighbors::ivf_flat {
@@ -129,8 +134,8 @@ class AnnIVFFlatTest : public ::testing::TestWithParam<AnnIvfFlatInputs<IdxT>> {
       rmm::device_uvector<T> distances_ivfflat_dev(queries_size, stream_);
       rmm::device_uvector<IdxT> indices_ivfflat_dev(queries_size, stream_);
 
-      {
-        // legacy interface
+      // the legacy interface has no half index
+      if constexpr (!std::is_same_v<DataT, half>) {
         raft::spatial::knn::IVFFlatParam ivfParams;
         ivfParams.nprobe = ps.nprobe;
         ivfParams.nlist  = ps.nlist;
@@ -157,16 +162,16 @@ class AnnIVFFlatTest : public ::testing::TestWithParam<AnnIvfFlatInputs<IdxT>> {
         update_host(distances_ivfflat.data(), distances_ivfflat_dev.data(), queries_size, stream_);
         update_host(indices_ivfflat.data(), indices_ivfflat_dev.data(), queries_size, stream_);
         resource::sync_stream(handle_);
-      }
 
-      ASSERT_TRUE(eval_neighbours(indices_naive,
-                                  indices_ivfflat,
-                                  distances_naive,
-                                  distances_ivfflat,
-                                  ps.num_queries,
-                                  ps.k,
-                                  0.001,
-                                  min_recall));
+        ASSERT_TRUE(eval_neighbours(indices_naive,
+                                    indices_ivfflat,
+                                    distances_naive,
+                                    distances_ivfflat,
+                                    ps.num_queries,
+                                    ps.k,
+                                    0.001,
+                                    min_recall));
+      }
       {
         ivf_flat::index_params index_params;
         ivf_flat::search_params search_params;
@@ -303,6 +308,100 @@ class AnnIVFFlatTest : public ::testing::TestWithParam<AnnIvfFlatInputs<IdxT>> {
                                         raft::Compare<float>(),
                                         stream_));
         }
+
+        // With the ratio of one, the adaptive probing only probes the closest cluster
+        if (ps.metric != raft::distance::DistanceType::InnerProduct && ps.nprobe > 1) {
+          std::vector<IdxT> indices_single(queries_size);
+          std::vector<IdxT> indices_adaptive(queries_size);
+          std::vector<T> distances_single(queries_size);
+          std::vector<T> distances_adaptive(queries_size);
+          auto search_params_single     = search_params;
+          search_params_single.n_probes = 1;
+          ivf_flat::search(handle_,
+                           search_params_single,
+                           index_loaded,
+                           search_queries_view,
+                           indices_out_view,
+                           dists_out_view);
+          update_host(distances_single.data(), distances_ivfflat_dev.data(), queries_size, stream_);
+          update_host(indices_single.data(), indices_ivfflat_dev.data(), queries_size, stream_);
+          auto search_params_adaptive                 = search_params;
+          search_params_adaptive.probe_distance_ratio = 1.0f;
+          ivf_flat::search(handle_,
+                           search_params_adaptive,
+                           index_loaded,
+                           search_queries_view,
+                           indices_out_view,
+                           dists_out_view);
+          update_host(
+            distances_adaptive.data(), distances_ivfflat_dev.data(), queries_size, stream_);
+          update_host(indices_adaptive.data(), indices_ivfflat_dev.data(), queries_size, stream_);
+          resource::sync_stream(handle_);
+          ASSERT_TRUE(eval_neighbours(indices_single,
+                                      indices_adaptive,
+                                      distances_single,
+                                      distances_adaptive,
+                                      ps.num_queries,
+                                      ps.k,
+                                      0.001,
+                                      0.99));
+        }
+
+        // A single probe per query (out of n_probes) must find the same neighbors as a search
+        // with n_probes = 1, and the neighbors past the k of a query are padded.
+        if (ps.nprobe > 1) {
+          std::vector<IdxT> indices_single(queries_size);
+          std::vector<IdxT> indices_per_query(queries_size);
+          std::vector<T> distances_single(queries_size);
+          std::vector<T> distances_per_query(queries_size);
+          auto search_params_single     = search_params;
+          search_params_single.n_probes = 1;
+          ivf_flat::search(handle_,
+                           search_params_single,
+                           index_loaded,
+                           search_queries_view,
+                           indices_out_view,
+                           dists_out_view);
+          update_host(distances_single.data(), distances_ivfflat_dev.data(), queries_size, stream_);
+          update_host(indices_single.data(), indices_ivfflat_dev.data(), queries_size, stream_);
+
+          std::vector<uint32_t> query_k(ps.num_queries);
+          for (IdxT i = 0; i < ps.num_queries; i++) {
+            query_k[i] = i % 2 == 0 ? ps.k : std::max<uint32_t>(ps.k / 2, 1);
+          }
+          auto n_probes_dev = raft::make_device_vector<uint32_t, IdxT>(handle_, ps.num_queries);
+          auto k_dev        = raft::make_device_vector<uint32_t, IdxT>(handle_, ps.num_queries);
+          raft::linalg::map(handle_, n_probes_dev.view(), raft::const_op<uint32_t>{1});
+          update_device(k_dev.data_handle(), query_k.data(), ps.num_queries, stream_);
+          ivf_flat::search(handle_,
+                           search_params,
+                           index_loaded,
+                           search_queries_view,
+                           indices_out_view,
+                           dists_out_view,
+                           raft::make_const_mdspan(n_probes_dev.view()),
+                           std::make_optional(raft::make_const_mdspan(k_dev.view())));
+          update_host(
+            distances_per_query.data(), distances_ivfflat_dev.data(), queries_size, stream_);
+          update_host(indices_per_query.data(), indices_ivfflat_dev.data(), queries_size, stream_);
+          resource::sync_stream(handle_);
+          for (IdxT i = 0; i < ps.num_queries; i++) {
+            for (IdxT j = query_k[i]; j < ps.k; j++) {
+              ASSERT_EQ(indices_per_query[i * ps.k + j], ivf::kInvalidRecord<IdxT>);
+              // The padded neighbors are not compared below.
+              indices_per_query[i * ps.k + j]   = indices_single[i * ps.k + j];
+              distances_per_query[i * ps.k + j] = distances_single[i * ps.k + j];
+            }
+          }
+          ASSERT_TRUE(eval_neighbours(indices_single,
+                                      indices_per_query,
+                                      distances_single,
+                                      distances_per_query,
+                                      ps.num_queries,
+                                      ps.k,
+                                      0.001,
+                                      0.99));
+        }
       }
       ASSERT_TRUE(eval_neighbours(indices_naive,
                                   indices_ivfflat,
@@ -445,6 +544,132 @@ class AnnIVFFlatTest : public ::testing::TestWithParam<AnnIvfFlatInputs<IdxT>> {
     }
   }
 
+  void testRemove()
+  {
+    ivf_flat::index_params index_params;
+    ivf_flat::search_params search_params;
+    index_params.n_lists   = ps.nlist;
+    index_params.metric    = ps.metric;
+    search_params.n_probes = ps.nprobe;
+
+    auto database_view = raft::make_device_matrix_view<const DataT, IdxT>(
+      (const DataT*)database.data(), ps.num_db_vecs, ps.dim);
+    auto idx = ivf_flat::build(handle_, index_params, database_view);
+
+    // remove every third record
+    std::vector<IdxT> ids_host;
+    for (IdxT i = 0; i < ps.num_db_vecs; i += 3) {
+      ids_host.push_back(i);
+    }
+    auto n_ids = int64_t(ids_host.size());
+    auto ids   = raft::make_device_vector<IdxT, int64_t>(handle_, n_ids);
+    update_device(ids.data_handle(), ids_host.data(), n_ids, stream_);
+    auto ids_view = raft::make_const_mdspan(ids.view());
+
+    size_t queries_size      = ps.num_queries * ps.k;
+    auto search_queries_view = raft::make_device_matrix_view<const DataT, IdxT>(
+      search_queries.data(), ps.num_queries, ps.dim);
+    auto indices = raft::make_device_matrix<IdxT, IdxT>(handle_, ps.num_queries, ps.k);
+    auto dists   = raft::make_device_matrix<T, IdxT>(handle_, ps.num_queries, ps.k);
+
+    auto check_results = [&]() {
+      ivf_flat::search(
+        handle_, search_params, idx, search_queries_view, indices.view(), dists.view());
+      std::vector<IdxT> indices_host(queries_size);
+      update_host(indices_host.data(), indices.data_handle(), queries_size, stream_);
+      resource::sync_stream(handle_);
+      for (auto i : indices_host) {
+        if (i < ps.num_db_vecs) { ASSERT_NE(i % 3, 0) << "A removed record is found"; }
+      }
+    };
+
+    // no list is compacted: the records are only marked
+    ASSERT_EQ(ivf_flat::helpers::remove(handle_, &idx, ids_view, 2.0), n_ids);
+    ASSERT_EQ(idx.size(), ps.num_db_vecs);
+    ASSERT_EQ(idx.n_removed(), IdxT(n_ids));
+    check_results();
+    // the records removed already are not counted again
+    ASSERT_EQ(ivf_flat::helpers::remove(handle_, &idx, ids_view, 2.0), 0);
+
+    ivf_flat::helpers::compact(handle_, &idx);
+    ASSERT_EQ(idx.size(), ps.num_db_vecs - IdxT(n_ids));
+    ASSERT_EQ(idx.n_removed(), 0);
+    check_results();
+  }
+
+  void testFaiss()
+  {
+    if constexpr (std::is_same_v<DataT, float>) {
+      if (ps.metric != raft::distance::DistanceType::L2Expanded &&
+          ps.metric != raft::distance::DistanceType::InnerProduct) {
+        return;
+      }
+      ivf_flat::index_params index_params;
+      ivf_flat::search_params search_params;
+      index_params.n_lists   = ps.nlist;
+      index_params.metric    = ps.metric;
+      search_params.n_probes = ps.nprobe;
+
+      auto database_view = raft::make_device_matrix_view<const DataT, IdxT>(
+        (const DataT*)database.data(), ps.num_db_vecs, ps.dim);
+      auto idx = ivf_flat::build(handle_, index_params, database_view);
+
+      // The bulk conversion matches the conversion of the lists one by one
+      auto codes   = make_device_matrix<DataT, int64_t>(handle_, idx.size(), idx.dim());
+      auto indices = make_device_vector<IdxT, int64_t>(handle_, idx.size());
+      auto offsets = make_device_vector<int64_t, int64_t>(handle_, idx.n_lists() + 1);
+      helpers::unpack_all_lists(handle_, idx, codes.view(), indices.view(), offsets.view());
+      std::vector<int64_t> offsets_host(idx.n_lists() + 1);
+      update_host(offsets_host.data(), offsets.data_handle(), offsets_host.size(), stream_);
+      resource::sync_stream(handle_);
+      ASSERT_EQ(offsets_host.back(), int64_t(idx.size()));
+      for (uint32_t label = 0; label < idx.n_lists(); label++) {
+        uint32_t list_size = offsets_host[label + 1] - offsets_host[label];
+        if (list_size == 0) { continue; }
+        auto list_codes = make_device_matrix<DataT, uint32_t>(handle_, list_size, idx.dim());
+        helpers::codepacker::unpack<DataT, IdxT>(
+          handle_, idx.lists()[label]->data.view(), idx.veclen(), 0, list_codes.view());
+        ASSERT_TRUE(raft::devArrMatch(list_codes.data_handle(),
+                                      codes.data_handle() + offsets_host[label] * idx.dim(),
+                                      size_t(list_size) * idx.dim(),
+                                      raft::Compare<DataT>(),
+                                      stream_));
+        ASSERT_TRUE(raft::devArrMatch(idx.lists()[label]->indices.data_handle(),
+                                      indices.data_handle() + offsets_host[label],
+                                      list_size,
+                                      raft::Compare<IdxT>(),
+                                      stream_));
+      }
+
+      // The index searches the same after the round trip through the FAISS format
+      std::stringstream ss;
+      ivf_flat::serialize_to_faiss(handle_, ss, idx);
+      auto loaded = ivf_flat::deserialize_from_faiss<DataT, IdxT>(handle_, ss);
+      ASSERT_EQ(loaded.size(), idx.size());
+      ASSERT_EQ(loaded.metric(), idx.metric());
+
+      size_t queries_size = ps.num_queries * ps.k;
+      std::vector<IdxT> expected(queries_size);
+      std::vector<IdxT> actual(queries_size);
+      auto queries_view = raft::make_device_matrix_view<const DataT, IdxT>(
+        search_queries.data(), ps.num_queries, ps.dim);
+      auto neighbors = make_device_matrix<IdxT, IdxT>(handle_, ps.num_queries, ps.k);
+      auto distances = make_device_matrix<T, IdxT>(handle_, ps.num_queries, ps.k);
+      ivf_flat::search(
+        handle_, search_params, idx, queries_view, neighbors.view(), distances.view());
+      update_host(expected.data(), neighbors.data_handle(), queries_size, stream_);
+      ivf_flat::search(
+        handle_, search_params, loaded, queries_view, neighbors.view(), distances.view());
+      update_host(actual.data(), neighbors.data_handle(), queries_size, stream_);
+      resource::sync_stream(handle_);
+      size_t n_same = 0;
+      for (size_t i = 0; i < queries_size; i++) {
+        n_same += expected[i] == actual[i];
+      }
+      EXPECT_GE(double(n_same), 0.99 * double(queries_size)) << ps;
+    }
+  }
+
   void testFilter()
   {
     size_t queries_size = ps.num_queries * ps.k;
@@ -452,6 +677,10 @@ class AnnIVFFlatTest : public ::testing::TestWithParam<AnnIvfFlatInputs<IdxT>> {
     std::vector<IdxT> indices_naive(queries_size);
     std::vector<T> distances_ivfflat(queries_size);
     std::vector<T> distances_naive(queries_size);
+    std::vector<IdxT> indices_list_ivfflat(queries_size);
+    std::vector<T> distances_list_ivfflat(queries_size);
+    std::vector<IdxT> indices_attr_ivfflat(queries_size);
+    std::vector<T> distances_attr_ivfflat(queries_size);
 
     {
       rmm::device_uvector<T> distances_naive_dev(queries_size, stream_);
@@ -532,7 +761,161 @@ class AnnIVFFlatTest : public ::testing::TestWithParam<AnnIvfFlatInputs<IdxT>> {
         update_host(
           indices_ivfflat.data(), indices_ivfflat_dev.data_handle(), queries_size, stream_);
         resource::sync_stream(handle_);
+
+        // Search with the same filter reordered to the lists (and skipping the filtered lists)
+        raft::neighbors::filtering::ivf_list_bitset list_filter(
+          handle_, index, removed_indices_bitset.view());
+        ivf_flat::search_with_filtering(handle_,
+                                        search_params,
+                                        index,
+                                        search_queries_view,
+                                        indices_ivfflat_dev.view(),
+                                        distances_ivfflat_dev.view(),
+                                        list_filter.filter());
+
+        update_host(distances_list_ivfflat.data(),
+                    distances_ivfflat_dev.data_handle(),
+                    queries_size,
+                    stream_);
+        update_host(
+          indices_list_ivfflat.data(), indices_ivfflat_dev.data_handle(), queries_size, stream_);
+        resource::sync_stream(handle_);
+
+        // Search with the same filter as a range predicate on an attribute: the source id
+        auto attributes = raft::make_device_vector<float, IdxT>(handle_, ps.num_db_vecs);
+        auto query_lo   = raft::make_device_vector<float, uint32_t>(handle_, ps.num_queries);
+        auto query_hi   = raft::make_device_vector<float, uint32_t>(handle_, ps.num_queries);
+        thrust::sequence(resource::get_thrust_policy(handle_),
+                         attributes.data_handle(),
+                         attributes.data_handle() + ps.num_db_vecs);
+        thrust::fill(resource::get_thrust_policy(handle_),
+                     query_lo.data_handle(),
+                     query_lo.data_handle() + ps.num_queries,
+                     float(test_ivf_sample_filter::offset));
+        thrust::fill(resource::get_thrust_policy(handle_),
+                     query_hi.data_handle(),
+                     query_hi.data_handle() + ps.num_queries,
+                     float(ps.num_db_vecs));
+        raft::neighbors::filtering::ivf_attribute_range<float> attr_filter(
+          handle_, index, attributes.data_handle());
+        ivf_flat::search_with_filtering(
+          handle_,
+          search_params,
+          index,
+          search_queries_view,
+          indices_ivfflat_dev.view(),
+          distances_ivfflat_dev.view(),
+          attr_filter.filter(query_lo.data_handle(), query_hi.data_handle()));
+
+        update_host(distances_attr_ivfflat.data(),
+                    distances_ivfflat_dev.data_handle(),
+                    queries_size,
+                    stream_);
+        update_host(
+          indices_attr_ivfflat.data(), indices_ivfflat_dev.data_handle(), queries_size, stream_);
+        resource::sync_stream(handle_);
       }
+      ASSERT_TRUE(eval_neighbours(indices_naive,
+                                  indices_ivfflat,
+                                  distances_naive,
+                                  distances_ivfflat,
+                                  ps.num_queries,
+                                  ps.k,
+                                  0.001,
+                                  min_recall));
+      ASSERT_TRUE(eval_neighbours(indices_naive,
+                                  indices_list_ivfflat,
+                                  distances_naive,
+                                  distances_list_ivfflat,
+                                  ps.num_queries,
+                                  ps.k,
+                                  0.001,
+                                  min_recall));
+      ASSERT_TRUE(eval_neighbours(indices_naive,
+                                  indices_attr_ivfflat,
+                                  distances_naive,
+                                  distances_attr_ivfflat,
+                                  ps.num_queries,
+                                  ps.k,
+                                  0.001,
+                                  min_recall));
+    }
+  }
+
+  void testCosine()
+  {
+    size_t queries_size = ps.num_queries * ps.k;
+    std::vector<IdxT> indices_ivfflat(queries_size);
+    std::vector<IdxT> indices_naive(queries_size);
+    std::vector<T> distances_ivfflat(queries_size);
+    std::vector<T> distances_naive(queries_size);
+
+    {
+      rmm::device_uvector<T> distances_naive_dev(queries_size, stream_);
+      rmm::device_uvector<IdxT> indices_naive_dev(queries_size, stream_);
+      naive_knn<T, DataT, IdxT>(handle_,
+                                distances_naive_dev.data(),
+                                indices_naive_dev.data(),
+                                search_queries.data(),
+                                database.data(),
+                                ps.num_queries,
+                                ps.num_db_vecs,
+                                ps.dim,
+                                ps.k,
+                                ps.metric);
+      update_host(distances_naive.data(), distances_naive_dev.data(), queries_size, stream_);
+      update_host(indices_naive.data(), indices_naive_dev.data(), queries_size, stream_);
+      resource::sync_stream(handle_);
+    }
+
+    {
+      double min_recall = static_cast<double>(ps.nprobe) / static_cast<double>(ps.nlist);
+
+      auto distances_ivfflat_dev = raft::make_device_matrix<T, IdxT>(handle_, ps.num_queries, ps.k);
+      auto indices_ivfflat_dev =
+        raft::make_device_matrix<IdxT, IdxT>(handle_, ps.num_queries, ps.k);
+
+      ivf_flat::index_params index_params;
+      ivf_flat::search_params search_params;
+      index_params.n_lists                  = ps.nlist;
+      index_params.metric                   = ps.metric;
+      index_params.adaptive_centers         = ps.adaptive_centers;
+      index_params.kmeans_trainset_fraction = 0.5;
+      search_params.n_probes                = ps.nprobe;
+
+      // Build on a half of the data and extend with the rest (the lists are normalized by both)
+      IdxT half_of_data  = ps.num_db_vecs / 2;
+      auto database_view = raft::make_device_matrix_view<const DataT, IdxT>(
+        database.data(), half_of_data, ps.dim);
+      auto index = ivf_flat::build(handle_, index_params, database_view);
+
+      rmm::device_uvector<IdxT> vector_indices(ps.num_db_vecs - half_of_data, stream_);
+      thrust::sequence(resource::get_thrust_policy(handle_),
+                       thrust::device_pointer_cast(vector_indices.data()),
+                       thrust::device_pointer_cast(vector_indices.data() + vector_indices.size()),
+                       half_of_data);
+      auto new_data_view = raft::make_device_matrix_view<const DataT, IdxT>(
+        database.data() + half_of_data * ps.dim, IdxT(ps.num_db_vecs) - half_of_data, ps.dim);
+      ivf_flat::extend(handle_,
+                       new_data_view,
+                       std::make_optional(raft::make_device_vector_view<const IdxT, IdxT>(
+                         vector_indices.data(), vector_indices.size())),
+                       &index);
+
+      auto search_queries_view = raft::make_device_matrix_view<const DataT, IdxT>(
+        search_queries.data(), ps.num_queries, ps.dim);
+      ivf_flat::search(handle_,
+                       search_params,
+                       index,
+                       search_queries_view,
+                       indices_ivfflat_dev.view(),
+                       distances_ivfflat_dev.view());
+
+      update_host(
+        distances_ivfflat.data(), distances_ivfflat_dev.data_handle(), queries_size, stream_);
+      update_host(indices_ivfflat.data(), indices_ivfflat_dev.data_handle(), queries_size, stream_);
+      resource::sync_stream(handle_);
+
       ASSERT_TRUE(eval_neighbours(indices_naive,
                                   indices_ivfflat,
                                   distances_naive,
@@ -555,6 +938,17 @@ class AnnIVFFlatTest : public ::testing::TestWithParam<AnnIvfFlatInputs<IdxT>> {
         handle_, r, database.data(), ps.num_db_vecs * ps.dim, DataT(0.1), DataT(2.0));
       raft::random::uniform(
         handle_, r, search_queries.data(), ps.num_queries * ps.dim, DataT(0.1), DataT(2.0));
+    } else if constexpr (std::is_same<DataT, half>{}) {
+      for (auto* data : {&database, &search_queries}) {
+        rmm::device_uvector<float> data_float(data->size(), stream_);
+        raft::random::uniform(handle_, r, data_float.data(), data_float.size(), 0.1f, 2.0f);
+        raft::linalg::map(
+          handle_,
+          raft::make_device_vector_view<DataT, int64_t>(data->data(), data->size()),
+          raft::cast_op<DataT>{},
+          raft::make_device_vector_view<const float, int64_t>(data_float.data(),
+                                                              data_float.size()));
+      }
     } else {
       raft::random::uniformInt(
         handle_, r, database.data(), ps.num_db_vecs * ps.dim, DataT(1), DataT(20));
@@ -631,6 +1025,13 @@ const std::vector<AnnIvfFlatInputs<int64_t>> inputs = {
   {100000, 1024, 32, 10, 64, 64, raft::distance::DistanceType::InnerProduct, false},
   {1000000, 1024, 32, 10, 256, 256, raft::distance::DistanceType::InnerProduct, false},
   {98306, 1024, 32, 10, 64, 64, raft::distance::DistanceType::InnerProduct, true},
+  // (few queries per list: these stay on the interleaved scan)
+  {100000, 8192, 32, 10, 16, 4096, raft::distance::DistanceType::L2Expanded, false},
+
+  // test the list-major GEMM scan (many queries per probed list)
+  {20000, 10000, 16, 10, 20, 64, raft::distance::DistanceType::L2SqrtExpanded, false},
+  {20000, 10000, 17, 10, 20, 64, raft::distance::DistanceType::L2Expanded, true},
+  {20000, 10000, 64, 200, 20, 64, raft::distance::DistanceType::InnerProduct, false},
 
   // test radix_sort for getting the cluster selection
   {1000,
@@ -655,4 +1056,12 @@ const std::vector<AnnIvfFlatInputs<int64_t>> inputs = {
   {20000, 8712, 3, 10, 51, 66, raft::distance::DistanceType::L2Expanded, false},
   {100000, 8712, 3, 10, 51, 66, raft::distance::DistanceType::L2Expanded, false}};
 
+// The CosineExpanded metric is supported for the floating-point data only.
+const std::vector<AnnIvfFlatInputs<int64_t>> cosine_inputs = {
+  // num_queries, num_db_vecs, dim, k, nprobe, nlist, metric, adaptive_centers
+  {1000, 10000, 3, 16, 40, 1024, raft::distance::DistanceType::CosineExpanded, false},
+  {1000, 10000, 8, 16, 40, 1024, raft::distance::DistanceType::CosineExpanded, true},
+  {1000, 10000, 64, 16, 40, 1024, raft::distance::DistanceType::CosineExpanded, false},
+  {100, 10000, 16, 128, 20, 1024, raft::distance::DistanceType::CosineExpanded, false}};
+
 }  // namespace raft::neighbors::ivf_flat
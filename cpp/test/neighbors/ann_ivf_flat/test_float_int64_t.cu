@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -25,8 +25,15 @@ TEST_P(AnnIVFFlatTestF, AnnIVFFlat)
 {
   this->testIVFFlat();
   this->testPacker();
+  this->testFaiss();
+  this->testRemove();
 }
 
 INSTANTIATE_TEST_CASE_P(AnnIVFFlatTest, AnnIVFFlatTestF, ::testing::ValuesIn(inputs));
 
+typedef AnnIVFFlatTest<float, float, std::int64_t> AnnIVFFlatCosineTestF;
+TEST_P(AnnIVFFlatCosineTestF, AnnIVFFlatCosine) { this->testCosine(); }
+
+INSTANTIATE_TEST_CASE_P(AnnIVFFlatTest, AnnIVFFlatCosineTestF, ::testing::ValuesIn(cosine_inputs));
+
 }  // namespace raft::neighbors::ivf_flat
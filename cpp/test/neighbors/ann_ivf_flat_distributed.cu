@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+#include "ann_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/neighbors/ivf_flat.cuh>
+#include <raft/neighbors/ivf_flat_distributed.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <raft_internal/neighbors/naive_knn.cuh>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace raft::neighbors::ivf_flat {
+
+struct AnnIvfFlatDistributedInputs {
+  int n_ranks;
+  int64_t n_rows;
+  int64_t n_queries;
+  uint32_t dim;
+  uint32_t k;
+  uint32_t n_lists;
+  uint32_t n_probes;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const AnnIvfFlatDistributedInputs& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", " << p.n_rows << " x " << p.dim << ", n_queries "
+     << p.n_queries << ", k " << p.k << ", n_lists " << p.n_lists << ", n_probes " << p.n_probes
+     << "}";
+  return os;
+}
+
+/**
+ * The rows and the queries are split in contiguous blocks across the ranks of an in-process
+ * clique. Probing all the lists, the distributed index should find the exact neighbors in the
+ * concatenated shards; probing a part of them, its recall should be the one of a single-GPU
+ * ivf_flat index built on the concatenated shards (the coarse quantizers are trained on
+ * different subsamples).
+ */
+class AnnIvfFlatDistributedTest : public ::testing::TestWithParam<AnnIvfFlatDistributedInputs> {
+ protected:
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<AnnIvfFlatDistributedInputs>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    ivf_flat::index_params index_params;
+    ivf_flat::search_params search_params;
+    index_params.n_lists   = p.n_lists;
+    search_params.n_probes = p.n_probes;
+
+    // the dataset, the exact neighbors and the single-GPU index, on the first device
+    const size_t queries_size = p.n_queries * p.k;
+    std::vector<float> database(p.n_rows * p.dim);
+    std::vector<float> queries(p.n_queries * p.dim);
+    std::vector<int64_t> indices_naive(queries_size);
+    std::vector<float> distances_naive(queries_size);
+    std::vector<int64_t> indices_single(queries_size);
+    std::vector<float> distances_single(queries_size);
+    {
+      raft::resources handle;
+      auto stream     = resource::get_cuda_stream(handle);
+      auto d_database = raft::make_device_matrix<float, int64_t>(handle, p.n_rows, p.dim);
+      auto d_queries  = raft::make_device_matrix<float, int64_t>(handle, p.n_queries, p.dim);
+      auto d_indices  = raft::make_device_matrix<int64_t, int64_t>(handle, p.n_queries, p.k);
+      auto d_dists    = raft::make_device_matrix<float, int64_t>(handle, p.n_queries, p.k);
+      raft::random::RngState r(1234ULL);
+      raft::random::uniform(handle, r, d_database.data_handle(), d_database.size(), -1.0f, 1.0f);
+      raft::random::uniform(handle, r, d_queries.data_handle(), d_queries.size(), -1.0f, 1.0f);
+      raft::update_host(database.data(), d_database.data_handle(), database.size(), stream);
+      raft::update_host(queries.data(), d_queries.data_handle(), queries.size(), stream);
+
+      naive_knn<float, float, int64_t>(handle,
+                                       d_dists.data_handle(),
+                                       d_indices.data_handle(),
+                                       d_queries.data_handle(),
+                                       d_database.data_handle(),
+                                       p.n_queries,
+                                       p.n_rows,
+                                       p.dim,
+                                       p.k,
+                                       index_params.metric);
+      raft::update_host(distances_naive.data(), d_dists.data_handle(), queries_size, stream);
+      raft::update_host(indices_naive.data(), d_indices.data_handle(), queries_size, stream);
+
+      auto idx = build(handle, index_params, raft::make_const_mdspan(d_database.view()));
+      search(handle,
+             search_params,
+             idx,
+             raft::make_const_mdspan(d_queries.view()),
+             d_indices.view(),
+             d_dists.view());
+      raft::update_host(distances_single.data(), d_dists.data_handle(), queries_size, stream);
+      raft::update_host(indices_single.data(), d_indices.data_handle(), queries_size, stream);
+      resource::sync_stream(handle);
+    }
+
+    std::vector<int64_t> indices_distributed(queries_size);
+    std::vector<float> distances_distributed(queries_size);
+    nccl_clique clique(p.n_ranks);
+    clique.run([&](int rank, const raft::resources& handle) {
+      auto stream           = resource::get_cuda_stream(handle);
+      const int64_t begin   = p.n_rows * rank / p.n_ranks;
+      const int64_t rows    = p.n_rows * (rank + 1) / p.n_ranks - begin;
+      const int64_t q_begin = p.n_queries * rank / p.n_ranks;
+      const int64_t q_rows  = p.n_queries * (rank + 1) / p.n_ranks - q_begin;
+      auto d_shard          = raft::make_device_matrix<float, int64_t>(handle, rows, p.dim);
+      auto d_queries        = raft::make_device_matrix<float, int64_t>(handle, q_rows, p.dim);
+      auto d_indices        = raft::make_device_matrix<int64_t, int64_t>(handle, q_rows, p.k);
+      auto d_dists          = raft::make_device_matrix<float, int64_t>(handle, q_rows, p.k);
+      raft::update_device(
+        d_shard.data_handle(), database.data() + begin * p.dim, d_shard.size(), stream);
+      raft::update_device(
+        d_queries.data_handle(), queries.data() + q_begin * p.dim, d_queries.size(), stream);
+
+      auto idx = build_distributed<float, int64_t>(
+        handle, index_params, raft::make_const_mdspan(d_shard.view()));
+      ASSERT_EQ(idx.global_size, p.n_rows);
+      search_distributed<float, int64_t>(handle,
+                                         search_params,
+                                         idx,
+                                         raft::make_const_mdspan(d_queries.view()),
+                                         d_indices.view(),
+                                         d_dists.view());
+      // the ranks write disjoint rows
+      raft::update_host(indices_distributed.data() + q_begin * p.k,
+                        d_indices.data_handle(),
+                        d_indices.size(),
+                        stream);
+      raft::update_host(distances_distributed.data() + q_begin * p.k,
+                        d_dists.data_handle(),
+                        d_dists.size(),
+                        stream);
+      resource::sync_stream(handle);
+    });
+
+    if (p.n_probes >= p.n_lists) {
+      ASSERT_TRUE(eval_neighbours(indices_naive,
+                                  indices_distributed,
+                                  distances_naive,
+                                  distances_distributed,
+                                  p.n_queries,
+                                  p.k,
+                                  0.001,
+                                  0.999));
+    } else {
+      auto [recall_single, matches_single, total_single] = calc_recall(
+        indices_naive, indices_single, distances_naive, distances_single, p.n_queries, p.k, 0.001);
+      ASSERT_TRUE(eval_neighbours(indices_naive,
+                                  indices_distributed,
+                                  distances_naive,
+                                  distances_distributed,
+                                  p.n_queries,
+                                  p.k,
+                                  0.001,
+                                  recall_single - 0.05));
+    }
+  }
+};
+
+const std::vector<AnnIvfFlatDistributedInputs> inputs = {
+  // all the lists probed: the exact neighbors
+  {1, 5000, 100, 16, 10, 32, 32},
+  {2, 5000, 100, 16, 10, 32, 32},
+  {2, 10001, 99, 64, 32, 64, 64},
+  // a part of the lists probed: the recall of the single-GPU index
+  {1, 20000, 500, 32, 10, 128, 16},
+  {2, 20000, 500, 32, 10, 128, 16},
+  {2, 20001, 333, 64, 64, 100, 20}};
+
+TEST_P(AnnIvfFlatDistributedTest, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(AnnIvfFlatDistributedTests,
+                        AnnIvfFlatDistributedTest,
+                        ::testing::ValuesIn(inputs));
+
+}  // namespace raft::neighbors::ivf_flat
@@ -18,9 +18,11 @@
 #include "../test_utils.cuh"
 #include "ann_utils.cuh"
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
 
 #include <raft_internal/neighbors/naive_knn.cuh>
 
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/core/logger.hpp>
 #include <raft/distance/distance_types.hpp>
 #include <raft/linalg/map.cuh>
@@ -29,6 +31,8 @@
 #include <raft/neighbors/ivf_pq.cuh>
 #include <raft/neighbors/ivf_pq_helpers.cuh>
 #include <raft/neighbors/ivf_pq_serialize.cuh>
+#include <raft/neighbors/memory_estimate.cuh>
+#include <raft/neighbors/refine.cuh>
 #include <raft/neighbors/sample_filter.cuh>
 #include <raft/random/rng.cuh>
 
@@ -45,7 +49,11 @@
 #include <algorithm>
 #include <cstddef>
 #include <iostream>
+#include <limits>
+#include <numeric>
 #include <optional>
+#include <sstream>
+#include <type_traits>
 #include <vector>
 
 namespace raft::neighbors::ivf_pq {
@@ -82,6 +90,17 @@ inline auto operator<<(std::ostream& os, const ivf_pq::codebook_gen& p) -> std::
   return os;
 }
 
+inline auto operator<<(std::ostream& os, const ivf_pq::list_memory_type& p) -> std::ostream&
+{
+  switch (p) {
+    case ivf_pq::list_memory_type::DEVICE: os << "list_memory_type::DEVICE"; break;
+    case ivf_pq::list_memory_type::MANAGED: os << "list_memory_type::MANAGED"; break;
+    case ivf_pq::list_memory_type::POOLED: os << "list_memory_type::POOLED"; break;
+    default: RAFT_FAIL("unreachable code");
+  }
+  return os;
+}
+
 inline auto operator<<(std::ostream& os, const ivf_pq_inputs& p) -> std::ostream&
 {
   ivf_pq_inputs dflt;
@@ -112,6 +131,8 @@ inline auto operator<<(std::ostream& os, const ivf_pq_inputs& p) -> std::ostream
   PRINT_DIFF(.index_params.pq_dim);
   PRINT_DIFF(.index_params.codebook_kind);
   PRINT_DIFF(.index_params.force_random_rotation);
+  PRINT_DIFF(.index_params.opq_n_iters);
+  PRINT_DIFF(.index_params.list_memory);
   PRINT_DIFF(.search_params.n_probes);
   PRINT_DIFF_V(.search_params.lut_dtype, print_dtype{p.search_params.lut_dtype});
   PRINT_DIFF_V(.search_params.internal_distance_dtype,
@@ -256,7 +277,116 @@ class ivf_pq_test : public ::testing::TestWithParam<ivf_pq_inputs> {
   auto build_serialize()
   {
     ivf_pq::serialize<IdxT>(handle_, "ivf_pq_index", build_only());
-    return ivf_pq::deserialize<IdxT>(handle_, "ivf_pq_index");
+    auto index = ivf_pq::deserialize<IdxT>(handle_, "ivf_pq_index");
+    // The list memory type is not serialized
+    ivf_pq::helpers::set_list_memory(handle_, &index, ps.index_params.list_memory);
+    return index;
+  }
+
+  auto build_serialize_mapped()
+  {
+    ivf_pq::serialize_mapped<IdxT>(handle_, "ivf_pq_index_mapped", build_only());
+    ivf_pq::mapped_lists<IdxT> file(handle_, "ivf_pq_index_mapped");
+    auto index = file.make_index(handle_);
+    // Load the lists lazily in two rounds; the second round skips the already loaded lists.
+    std::vector<uint32_t> labels;
+    for (uint32_t label = 0; label < file.n_lists(); label += 2) {
+      labels.push_back(label);
+    }
+    file.load(handle_, &index, labels);
+    labels.resize(file.n_lists());
+    std::iota(labels.begin(), labels.end(), 0);
+    file.load(handle_, &index, labels);
+    ivf_pq::helpers::set_list_memory(handle_, &index, ps.index_params.list_memory);
+    return index;
+  }
+
+  auto search_indices(const index<IdxT>& index) -> std::vector<IdxT>
+  {
+    size_t queries_size = size_t{ps.num_queries} * size_t{ps.k};
+    auto query_view =
+      raft::make_device_matrix_view<DataT, uint32_t>(search_queries.data(), ps.num_queries, ps.dim);
+    auto inds  = raft::make_device_matrix<IdxT, uint32_t>(handle_, ps.num_queries, ps.k);
+    auto dists = raft::make_device_matrix<EvalT, uint32_t>(handle_, ps.num_queries, ps.k);
+    ivf_pq::search<DataT, IdxT>(
+      handle_, ps.search_params, index, query_view, inds.view(), dists.view());
+    std::vector<IdxT> indices(queries_size);
+    update_host(indices.data(), inds.data_handle(), queries_size, stream_);
+    resource::sync_stream(handle_);
+    return indices;
+  }
+
+  void check_rebalance()
+  {
+    auto index = build_only();
+    double recall_before =
+      std::get<0>(calc_recall(indices_ref, search_indices(index), ps.num_queries, ps.k));
+
+    ivf_pq::rebalance_params params;
+    params.max_list_size_ratio = 1.2;
+    auto n_split               = ivf_pq::helpers::rebalance(handle_, &index, params);
+    ASSERT_EQ(index.size(), ps.num_db_vecs);
+    if (n_split == 0) { return; }
+
+    // All the records must be kept, each in exactly one list
+    std::vector<uint32_t> list_sizes(index.n_lists());
+    update_host(list_sizes.data(), index.list_sizes().data_handle(), index.n_lists(), stream_);
+    resource::sync_stream(handle_);
+    std::vector<IdxT> all_indices;
+    for (uint32_t label = 0; label < index.n_lists(); label++) {
+      if (list_sizes[label] == 0) { continue; }
+      std::vector<IdxT> list_indices(list_sizes[label]);
+      update_host(list_indices.data(),
+                  index.lists()[label]->indices.data_handle(),
+                  list_sizes[label],
+                  stream_);
+      resource::sync_stream(handle_);
+      all_indices.insert(all_indices.end(), list_indices.begin(), list_indices.end());
+    }
+    ASSERT_EQ(all_indices.size(), size_t(ps.num_db_vecs));
+    std::sort(all_indices.begin(), all_indices.end());
+    for (size_t i = 0; i < all_indices.size(); i++) {
+      ASSERT_EQ(all_indices[i], IdxT(i));
+    }
+
+    // The records are encoded again from their approximations, which may cost a bit of recall
+    double recall_after =
+      std::get<0>(calc_recall(indices_ref, search_indices(index), ps.num_queries, ps.k));
+    ASSERT_GE(recall_after, recall_before - 0.05) << ps;
+  }
+
+  void check_remove()
+  {
+    auto index = build_only();
+    // remove every third record
+    std::vector<IdxT> ids_host;
+    for (IdxT i = 0; i < IdxT(ps.num_db_vecs); i += 3) {
+      ids_host.push_back(i);
+    }
+    auto n_ids = int64_t(ids_host.size());
+    auto ids   = make_device_vector<IdxT, int64_t>(handle_, n_ids);
+    update_device(ids.data_handle(), ids_host.data(), n_ids, stream_);
+    auto ids_view = make_const_mdspan(ids.view());
+
+    auto check_results = [this](const std::vector<IdxT>& indices) {
+      for (auto i : indices) {
+        if (i < IdxT(ps.num_db_vecs)) { ASSERT_NE(i % 3, 0) << "A removed record is found"; }
+      }
+    };
+
+    // no list is compacted: the records are only marked
+    ASSERT_EQ(ivf_pq::helpers::remove(handle_, &index, ids_view, 2.0), n_ids);
+    ASSERT_EQ(index.size(), IdxT(ps.num_db_vecs));
+    ASSERT_EQ(index.n_removed(), IdxT(n_ids));
+    check_results(search_indices(index));
+    // the records removed already are not counted again
+    ASSERT_EQ(ivf_pq::helpers::remove(handle_, &index, ids_view, 2.0), 0);
+    ASSERT_EQ(index.n_removed(), IdxT(n_ids));
+
+    ivf_pq::helpers::compact(handle_, &index);
+    ASSERT_EQ(index.size(), IdxT(ps.num_db_vecs - n_ids));
+    ASSERT_EQ(index.n_removed(), 0);
+    check_results(search_indices(index));
   }
 
   void check_reconstruction(const index<IdxT>& index,
@@ -458,6 +588,359 @@ class ivf_pq_test : public ::testing::TestWithParam<ivf_pq_inputs> {
                             Compare<uint8_t>{}));
   }
 
+  void check_fused_refine()
+  {
+    if constexpr (std::is_same_v<IdxT, int64_t>) {
+      constexpr uint32_t kRefineRatio = 2;
+      auto index                      = build_only();
+      const uint32_t n_candidates     = ps.k * kRefineRatio;
+      // Every candidate must be a valid row to be refined.
+      if (n_candidates > min_output_size(handle_, index, ps.search_params.n_probes)) { return; }
+
+      auto query_view   = raft::make_device_matrix_view<const DataT, uint32_t>(
+        search_queries.data(), ps.num_queries, ps.dim);
+      auto dataset_view = raft::make_device_matrix_view<const DataT, int64_t>(
+        database.data(), ps.num_db_vecs, ps.dim);
+
+      // The separate search for the candidates and refinement
+      auto candidates =
+        raft::make_device_matrix<IdxT, uint32_t>(handle_, ps.num_queries, n_candidates);
+      auto candidate_dists =
+        raft::make_device_matrix<EvalT, uint32_t>(handle_, ps.num_queries, n_candidates);
+      ivf_pq::search<DataT, IdxT>(
+        handle_, ps.search_params, index, query_view, candidates.view(), candidate_dists.view());
+      auto inds_ref  = raft::make_device_matrix<IdxT, int64_t>(handle_, ps.num_queries, ps.k);
+      auto dists_ref = raft::make_device_matrix<EvalT, int64_t>(handle_, ps.num_queries, ps.k);
+      raft::neighbors::refine<IdxT, DataT, EvalT, int64_t>(
+        handle_,
+        dataset_view,
+        raft::make_device_matrix_view<const DataT, int64_t>(
+          search_queries.data(), ps.num_queries, ps.dim),
+        raft::make_device_matrix_view<const IdxT, int64_t>(
+          candidates.data_handle(), ps.num_queries, n_candidates),
+        inds_ref.view(),
+        dists_ref.view(),
+        ps.index_params.metric);
+
+      // The fused search
+      auto search_params         = ps.search_params;
+      search_params.refine_ratio = kRefineRatio;
+      auto inds  = raft::make_device_matrix<IdxT, uint32_t>(handle_, ps.num_queries, ps.k);
+      auto dists = raft::make_device_matrix<EvalT, uint32_t>(handle_, ps.num_queries, ps.k);
+      ivf_pq::search<DataT, IdxT>(
+        handle_, search_params, index, query_view, inds.view(), dists.view(), dataset_view);
+
+      size_t queries_size = size_t{ps.num_queries} * size_t{ps.k};
+      std::vector<IdxT> indices_ref(queries_size);
+      std::vector<IdxT> indices_fused(queries_size);
+      std::vector<EvalT> distances_ref(queries_size);
+      std::vector<EvalT> distances_fused(queries_size);
+      update_host(indices_ref.data(), inds_ref.data_handle(), queries_size, stream_);
+      update_host(distances_ref.data(), dists_ref.data_handle(), queries_size, stream_);
+      update_host(indices_fused.data(), inds.data_handle(), queries_size, stream_);
+      update_host(distances_fused.data(), dists.data_handle(), queries_size, stream_);
+      resource::sync_stream(handle_);
+      ASSERT_TRUE(eval_neighbours(indices_ref,
+                                  indices_fused,
+                                  distances_ref,
+                                  distances_fused,
+                                  ps.num_queries,
+                                  ps.k,
+                                  0.0001,
+                                  0.99))
+        << ps;
+    }
+  }
+
+  void check_range_search()
+  {
+    // The radius is in the units of the L2 distances here.
+    if (ps.index_params.metric != distance::DistanceType::L2Expanded) { return; }
+    auto index = build_only();
+
+    size_t queries_size = size_t{ps.num_queries} * size_t{ps.k};
+    auto query_view     = raft::make_device_matrix_view<const DataT, uint32_t>(
+      search_queries.data(), ps.num_queries, ps.dim);
+    auto inds  = raft::make_device_matrix<IdxT, uint32_t>(handle_, ps.num_queries, ps.k);
+    auto dists = raft::make_device_matrix<float, uint32_t>(handle_, ps.num_queries, ps.k);
+    ivf_pq::search<DataT, IdxT>(
+      handle_, ps.search_params, index, query_view, inds.view(), dists.view());
+    std::vector<IdxT> indices_knn(queries_size);
+    std::vector<float> distances_knn(queries_size);
+    update_host(indices_knn.data(), inds.data_handle(), queries_size, stream_);
+    update_host(distances_knn.data(), dists.data_handle(), queries_size, stream_);
+    resource::sync_stream(handle_);
+
+    // The radius within which every query has at least its k-th neighbor
+    float radius = std::numeric_limits<float>::max();
+    for (uint32_t i = 0; i < ps.num_queries; i++) {
+      radius = std::min(radius, distances_knn[size_t{i} * ps.k + ps.k - 1]);
+    }
+
+    ivf_pq::range_search_params params;
+    static_cast<ivf_pq::search_params&>(params) = ps.search_params;
+    params.initial_k                            = std::min<uint32_t>(4, ps.k);
+    params.max_k                                = ps.k;
+    auto result = raft::make_device_csr_matrix<float, int64_t, IdxT, int64_t>(
+      handle_, ps.num_queries, IdxT(index.size()));
+    ivf_pq::range_search<DataT, IdxT>(handle_, params, index, query_view, radius, result);
+
+    auto structure = result.structure_view();
+    std::vector<int64_t> indptr(ps.num_queries + 1);
+    std::vector<IdxT> indices(structure.get_nnz());
+    std::vector<float> distances(structure.get_nnz());
+    update_host(indptr.data(), structure.get_indptr().data(), indptr.size(), stream_);
+    update_host(indices.data(), structure.get_indices().data(), indices.size(), stream_);
+    update_host(distances.data(), result.get_elements().data(), distances.size(), stream_);
+    resource::sync_stream(handle_);
+
+    // The neighborhoods must match the top-k results within the radius.
+    size_t n_expected = 0;
+    size_t n_found    = 0;
+    for (uint32_t i = 0; i < ps.num_queries; i++) {
+      std::vector<IdxT> row(indices.begin() + indptr[i], indices.begin() + indptr[i + 1]);
+      std::sort(row.begin(), row.end());
+      for (int64_t j = indptr[i]; j < indptr[i + 1]; j++) {
+        ASSERT_LE(distances[j], radius) << ps;
+      }
+      for (uint32_t j = 0; j < ps.k; j++) {
+        if (distances_knn[size_t{i} * ps.k + j] > radius) { break; }
+        n_expected++;
+        if (std::binary_search(row.begin(), row.end(), indices_knn[size_t{i} * ps.k + j])) {
+          n_found++;
+        }
+      }
+    }
+    double recall = static_cast<double>(n_found) / static_cast<double>(n_expected);
+    EXPECT_GE(recall, 0.95) << ps << "; range search recall = " << recall;
+  }
+
+  void check_per_query_search()
+  {
+    auto index = build_only();
+
+    // The even queries probe all `n_probes` lists and the odd ones a quarter of them; every third
+    // query asks for all `k` neighbors and the others for a half of them.
+    const uint32_t n_probes_hi = std::min<uint32_t>(ps.search_params.n_probes, index.n_lists());
+    const uint32_t n_probes_lo = std::max<uint32_t>(n_probes_hi / 4, 1);
+    const uint32_t k_lo        = std::max<uint32_t>(ps.k / 2, 1);
+    std::vector<uint32_t> query_n_probes(ps.num_queries);
+    std::vector<uint32_t> query_k(ps.num_queries);
+    for (uint32_t i = 0; i < ps.num_queries; i++) {
+      query_n_probes[i] = i % 2 == 0 ? n_probes_hi : n_probes_lo;
+      query_k[i]        = i % 3 == 0 ? ps.k : k_lo;
+    }
+    auto query_n_probes_dev = raft::make_device_vector<uint32_t, uint32_t>(handle_, ps.num_queries);
+    auto query_k_dev        = raft::make_device_vector<uint32_t, uint32_t>(handle_, ps.num_queries);
+    update_device(query_n_probes_dev.data_handle(), query_n_probes.data(), ps.num_queries, stream_);
+    update_device(query_k_dev.data_handle(), query_k.data(), ps.num_queries, stream_);
+
+    size_t queries_size = size_t{ps.num_queries} * size_t{ps.k};
+    auto query_view     = raft::make_device_matrix_view<const DataT, uint32_t>(
+      search_queries.data(), ps.num_queries, ps.dim);
+    auto inds  = raft::make_device_matrix<IdxT, uint32_t>(handle_, ps.num_queries, ps.k);
+    auto dists = raft::make_device_matrix<float, uint32_t>(handle_, ps.num_queries, ps.k);
+    auto search_uniform = [&](uint32_t n_probes) {
+      auto params     = ps.search_params;
+      params.n_probes = n_probes;
+      ivf_pq::search<DataT, IdxT>(handle_, params, index, query_view, inds.view(), dists.view());
+      std::vector<IdxT> indices(queries_size);
+      update_host(indices.data(), inds.data_handle(), queries_size, stream_);
+      resource::sync_stream(handle_);
+      return indices;
+    };
+    auto indices_hi = search_uniform(n_probes_hi);
+    auto indices_lo = search_uniform(n_probes_lo);
+
+    auto params     = ps.search_params;
+    params.n_probes = n_probes_hi;
+    ivf_pq::search<DataT, IdxT>(handle_,
+                                params,
+                                index,
+                                query_view,
+                                inds.view(),
+                                dists.view(),
+                                raft::make_const_mdspan(query_n_probes_dev.view()),
+                                std::make_optional(raft::make_const_mdspan(query_k_dev.view())));
+    std::vector<IdxT> indices(queries_size);
+    update_host(indices.data(), inds.data_handle(), queries_size, stream_);
+    resource::sync_stream(handle_);
+
+    // Every query must find the neighbors of a search with its own parameters (up to the ties of
+    // the low-precision scores).
+    size_t n_expected = 0;
+    size_t n_found    = 0;
+    for (uint32_t i = 0; i < ps.num_queries; i++) {
+      const auto& expected = i % 2 == 0 ? indices_hi : indices_lo;
+      const auto row       = indices.begin() + size_t{i} * ps.k;
+      for (uint32_t j = query_k[i]; j < ps.k; j++) {
+        ASSERT_EQ(row[j], kOutOfBoundsRecord<IdxT>) << ps;
+      }
+      for (uint32_t j = 0; j < query_k[i]; j++) {
+        n_expected++;
+        if (std::find(row, row + query_k[i], expected[size_t{i} * ps.k + j]) != row + query_k[i]) {
+          n_found++;
+        }
+      }
+    }
+    double match = static_cast<double>(n_found) / static_cast<double>(n_expected);
+    EXPECT_GE(match, 0.9) << ps << "; per-query search match = " << match;
+  }
+
+  void check_memory_estimate()
+  {
+    auto ipams              = ps.index_params;
+    ipams.add_data_on_build = true;
+    auto estimate = ivf_pq::estimate_memory<DataT, IdxT>(handle_, ipams, ps.num_db_vecs, ps.dim);
+    auto index    = build_only();
+
+    // The estimate assumes the records spread evenly over the lists.
+    size_t actual = sizeof(float) * (index.pq_centers().size() + index.rotation_matrix().size() +
+                                     index.centers().size() + index.centers_rot().size());
+    for (const auto& list : index.lists()) {
+      if (list) { actual += list->data.size() + list->indices.size() * sizeof(IdxT); }
+    }
+    const size_t estimated = estimate.device_index + estimate.host;
+    EXPECT_GE(estimated, actual / 2) << ps;
+    EXPECT_LE(estimated, actual * 2) << ps;
+    EXPECT_GT(estimate.device_workspace, 0) << ps;
+
+    auto search_estimate =
+      ivf_pq::estimate_memory(handle_, ps.search_params, index, ps.num_queries, ps.k);
+    EXPECT_GT(search_estimate.device_workspace, 0) << ps;
+    EXPECT_EQ(search_estimate.device_index, 0) << ps;
+  }
+
+  void check_transform()
+  {
+    auto index = build_only();
+
+    // The codes of the vectors are those written by `extend` into the lists
+    const uint32_t code_size = ceildiv<uint32_t>(index.pq_dim() * index.pq_bits(), 8);
+    auto list_codes   = make_device_matrix<uint8_t, int64_t>(handle_, index.size(), code_size);
+    auto list_indices = make_device_vector<IdxT, int64_t>(handle_, index.size());
+    auto list_offsets = make_device_vector<int64_t, int64_t>(handle_, index.n_lists() + 1);
+    ivf_pq::helpers::unpack_all_lists(
+      handle_, index, list_codes.view(), list_indices.view(), list_offsets.view());
+
+    // from device and from host memory
+    std::vector<DataT> database_host(database.size());
+    update_host(database_host.data(), database.data(), database.size(), stream_);
+    resource::sync_stream(handle_);
+    auto labels   = make_device_vector<uint32_t, IdxT>(handle_, ps.num_db_vecs);
+    auto codes    = make_device_matrix<uint8_t, IdxT>(handle_, ps.num_db_vecs, code_size);
+    auto labels_h = make_device_vector<uint32_t, IdxT>(handle_, ps.num_db_vecs);
+    auto codes_h  = make_device_matrix<uint8_t, IdxT>(handle_, ps.num_db_vecs, code_size);
+    ivf_pq::transform(
+      handle_,
+      index,
+      raft::make_device_matrix_view<const DataT, IdxT>(database.data(), ps.num_db_vecs, ps.dim),
+      labels.view(),
+      codes.view());
+    ivf_pq::transform(
+      handle_,
+      index,
+      raft::make_host_matrix_view<const DataT, IdxT>(database_host.data(), ps.num_db_vecs, ps.dim),
+      labels_h.view(),
+      codes_h.view());
+    ASSERT_TRUE(devArrMatch(
+      labels.data_handle(), labels_h.data_handle(), labels.size(), Compare<uint32_t>{}, stream_));
+    ASSERT_TRUE(devArrMatch(
+      codes.data_handle(), codes_h.data_handle(), codes.size(), Compare<uint8_t>{}, stream_));
+
+    auto to_host = [this](const auto& arr) {
+      std::vector<typename std::decay_t<decltype(arr)>::value_type> v(arr.size());
+      update_host(v.data(), arr.data_handle(), arr.size(), stream_);
+      return v;
+    };
+    auto codes_host        = to_host(codes);
+    auto labels_host       = to_host(labels);
+    auto list_codes_host   = to_host(list_codes);
+    auto list_indices_host = to_host(list_indices);
+    auto list_offsets_host = to_host(list_offsets);
+    resource::sync_stream(handle_);
+    size_t n_same = 0;
+    for (uint32_t label = 0; label < index.n_lists(); label++) {
+      for (auto i = list_offsets_host[label]; i < list_offsets_host[label + 1]; i++) {
+        auto row = list_indices_host[i];
+        n_same += labels_host[row] == label &&
+                  std::equal(list_codes_host.begin() + i * code_size,
+                             list_codes_host.begin() + (i + 1) * code_size,
+                             codes_host.begin() + size_t(row) * code_size);
+      }
+    }
+    // the assignment of the (rare) points equidistant to two centers may differ
+    EXPECT_GE(double(n_same), 0.99 * double(ps.num_db_vecs)) << ps;
+  }
+
+  void check_faiss_roundtrip()
+  {
+    if (ps.index_params.metric != distance::DistanceType::L2Expanded &&
+        ps.index_params.metric != distance::DistanceType::InnerProduct) {
+      return;
+    }
+    // FAISS has one codebook per subspace and no rotation
+    auto ipams                  = ps.index_params;
+    ipams.add_data_on_build     = true;
+    ipams.codebook_kind         = ivf_pq::codebook_gen::PER_SUBSPACE;
+    ipams.force_random_rotation = false;
+    if (ipams.pq_dim == 0) { ipams.pq_dim = index<IdxT>::calculate_pq_dim(ps.dim); }
+    while (ps.dim % ipams.pq_dim != 0) {
+      ipams.pq_dim--;
+    }
+    auto database_view =
+      raft::make_device_matrix_view<DataT, IdxT>(database.data(), ps.num_db_vecs, ps.dim);
+    auto index = ivf_pq::build<DataT, IdxT>(handle_, ipams, database_view);
+
+    // The bulk conversion matches the conversion of the lists one by one
+    const uint32_t code_size = ceildiv<uint32_t>(index.pq_dim() * index.pq_bits(), 8);
+    auto codes   = make_device_matrix<uint8_t, int64_t>(handle_, index.size(), code_size);
+    auto indices = make_device_vector<IdxT, int64_t>(handle_, index.size());
+    auto offsets = make_device_vector<int64_t, int64_t>(handle_, index.n_lists() + 1);
+    ivf_pq::helpers::unpack_all_lists(
+      handle_, index, codes.view(), indices.view(), offsets.view());
+    std::vector<int64_t> offsets_host(index.n_lists() + 1);
+    update_host(offsets_host.data(), offsets.data_handle(), offsets_host.size(), stream_);
+    resource::sync_stream(handle_);
+    for (uint32_t label = 0; label < index.n_lists(); label++) {
+      uint32_t n_rows = offsets_host[label + 1] - offsets_host[label];
+      if (n_rows == 0) { continue; }
+      auto list_codes = make_device_matrix<uint8_t>(handle_, n_rows, code_size);
+      ivf_pq::helpers::unpack_contiguous_list_data(
+        handle_, index, list_codes.data_handle(), n_rows, label, 0);
+      ASSERT_TRUE(devArrMatch(list_codes.data_handle(),
+                              codes.data_handle() + offsets_host[label] * code_size,
+                              size_t(n_rows) * code_size,
+                              Compare<uint8_t>{},
+                              stream_));
+      ASSERT_TRUE(devArrMatch(index.lists()[label]->indices.data_handle(),
+                              indices.data_handle() + offsets_host[label],
+                              n_rows,
+                              Compare<IdxT>{},
+                              stream_));
+    }
+
+    // The index searches the same after the round trip through the FAISS format
+    std::stringstream ss;
+    ivf_pq::serialize_to_faiss(handle_, ss, index);
+    auto loaded = ivf_pq::deserialize_from_faiss<IdxT>(handle_, ss);
+    ASSERT_EQ(loaded.size(), index.size());
+    ASSERT_EQ(loaded.pq_dim(), index.pq_dim());
+    ASSERT_EQ(loaded.pq_bits(), index.pq_bits());
+    ASSERT_TRUE(devArrMatch(index.pq_centers().data_handle(),
+                            loaded.pq_centers().data_handle(),
+                            index.pq_centers().size(),
+                            Compare<float>{},
+                            stream_));
+    auto expected = search_indices(index);
+    auto actual   = search_indices(loaded);
+    size_t n_same = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+      n_same += expected[i] == actual[i];
+    }
+    EXPECT_GE(double(n_same), 0.99 * double(expected.size())) << ps;
+  }
+
   template <typename BuildIndex>
   void run(BuildIndex build_index)
   {
@@ -557,6 +1040,59 @@ class ivf_pq_test : public ::testing::TestWithParam<ivf_pq_inputs> {
         size_t(ps.num_db_vecs),
         ps.index_params.n_lists);
     }
+
+    // The same search split across the streams of a stream pool must give the same results
+    if (ps.num_queries >= 128) {
+      raft::resources pool_handle(handle_);
+      resource::set_cuda_stream_pool(pool_handle, std::make_shared<rmm::cuda_stream_pool>(4));
+      std::vector<IdxT> indices_pool(queries_size);
+      std::vector<EvalT> distances_pool(queries_size);
+      ivf_pq::search<DataT, IdxT>(
+        pool_handle, ps.search_params, index, query_view, inds_view, dists_view);
+      update_host(distances_pool.data(), distances_ivf_pq_dev.data(), queries_size, stream_);
+      update_host(indices_pool.data(), indices_ivf_pq_dev.data(), queries_size, stream_);
+      resource::sync_stream(handle_);
+      ASSERT_TRUE(eval_neighbours(indices_ivf_pq,
+                                  indices_pool,
+                                  distances_ivf_pq,
+                                  distances_pool,
+                                  ps.num_queries,
+                                  ps.k,
+                                  0.0001 * compression_ratio,
+                                  0.99))
+        << ps;
+    }
+
+    // With the ratio of one, the adaptive probing only probes the closest cluster
+    if (ps.index_params.metric != distance::DistanceType::InnerProduct &&
+        ps.search_params.n_probes > 1) {
+      std::vector<IdxT> indices_single(queries_size);
+      std::vector<IdxT> indices_adaptive(queries_size);
+      std::vector<EvalT> distances_single(queries_size);
+      std::vector<EvalT> distances_adaptive(queries_size);
+      auto search_params_single     = ps.search_params;
+      search_params_single.n_probes = 1;
+      ivf_pq::search<DataT, IdxT>(
+        handle_, search_params_single, index, query_view, inds_view, dists_view);
+      update_host(distances_single.data(), distances_ivf_pq_dev.data(), queries_size, stream_);
+      update_host(indices_single.data(), indices_ivf_pq_dev.data(), queries_size, stream_);
+      auto search_params_adaptive                 = ps.search_params;
+      search_params_adaptive.probe_distance_ratio = 1.0f;
+      ivf_pq::search<DataT, IdxT>(
+        handle_, search_params_adaptive, index, query_view, inds_view, dists_view);
+      update_host(distances_adaptive.data(), distances_ivf_pq_dev.data(), queries_size, stream_);
+      update_host(indices_adaptive.data(), indices_ivf_pq_dev.data(), queries_size, stream_);
+      resource::sync_stream(handle_);
+      ASSERT_TRUE(eval_neighbours(indices_single,
+                                  indices_adaptive,
+                                  distances_single,
+                                  distances_adaptive,
+                                  ps.num_queries,
+                                  ps.k,
+                                  0.0001 * compression_ratio,
+                                  0.99))
+        << ps;
+    }
   }
 
   void SetUp() override  // NOLINT
@@ -850,6 +1386,11 @@ inline auto enum_variety() -> test_cases_t
     x.index_params.pq_bits       = 4;
     x.min_recall                 = 0.79;
   });
+  ADD_CASE({
+    x.index_params.pq_bits    = 4;
+    x.search_params.lut_dtype = CUDA_R_8U;
+    x.min_recall              = 0.75;
+  });
   ADD_CASE({
     x.index_params.codebook_kind = ivf_pq::codebook_gen::PER_CLUSTER;
     x.index_params.pq_bits       = 5;
@@ -877,6 +1418,29 @@ inline auto enum_variety() -> test_cases_t
     x.index_params.force_random_rotation = false;
     x.min_recall                         = 0.86;
   });
+  ADD_CASE({
+    x.index_params.opq_n_iters = 4;
+    x.min_recall               = 0.86;
+  });
+  ADD_CASE({
+    x.index_params.opq_n_iters           = 4;
+    x.index_params.force_random_rotation = true;
+    x.min_recall                         = 0.86;
+  });
+
+  ADD_CASE({
+    x.index_params.list_memory = ivf_pq::list_memory_type::MANAGED;
+    x.min_recall               = 0.86;
+  });
+  ADD_CASE({
+    x.index_params.list_memory = ivf_pq::list_memory_type::POOLED;
+    x.min_recall               = 0.86;
+  });
+  ADD_CASE({
+    x.index_params.list_memory                    = ivf_pq::list_memory_type::POOLED;
+    x.index_params.conservative_memory_allocation = true;
+    x.min_recall                                  = 0.86;
+  });
 
   ADD_CASE({
     x.search_params.lut_dtype = CUDA_R_32F;
@@ -890,6 +1454,16 @@ inline auto enum_variety() -> test_cases_t
     x.search_params.lut_dtype = CUDA_R_8U;
     x.min_recall              = 0.84;
   });
+#ifdef RAFT_IVF_PQ_NATIVE_FP8_LUT
+  ADD_CASE({
+    x.search_params.lut_dtype = CUDA_R_8F_E4M3;
+    x.min_recall              = 0.84;
+  });
+  ADD_CASE({
+    x.search_params.lut_dtype = CUDA_R_8F_E5M2;
+    x.min_recall              = 0.78;
+  });
+#endif
 
   ADD_CASE({
     x.search_params.internal_distance_dtype = CUDA_R_32F;
@@ -923,6 +1497,12 @@ inline auto enum_variety_ip() -> test_cases_t
         // thus we're forced to used signed 8-bit representation,
         // thus we have one bit less precision
         y.min_recall = y.min_recall.value() * 0.90;
+#ifdef RAFT_IVF_PQ_NATIVE_FP8_LUT
+      } else if (y.search_params.lut_dtype == CUDA_R_8F_E4M3 ||
+                 y.search_params.lut_dtype == CUDA_R_8F_E5M2) {
+        // The standard FP8 types are signed already, but still as coarse as the 8-bit LUT above
+        y.min_recall = y.min_recall.value() * 0.90;
+#endif
       } else {
         // In other cases it seems to perform a little bit better, still worse than L2
         y.min_recall = y.min_recall.value() * 0.94;
@@ -1089,6 +1669,60 @@ inline auto special_cases() -> test_cases_t
     this->run([this]() { return this->build_serialize(); }); \
   }
 
+#define TEST_BUILD_SERIALIZE_MAPPED_SEARCH(type)                    \
+  TEST_P(type, build_serialize_mapped_search) /* NOLINT */          \
+  {                                                                 \
+    this->run([this]() { return this->build_serialize_mapped(); }); \
+  }
+
+#define TEST_BUILD_REBALANCE_SEARCH(type)            \
+  TEST_P(type, build_rebalance_search) /* NOLINT */ \
+  {                                                 \
+    this->check_rebalance();                        \
+  }
+
+#define TEST_BUILD_REFINE_SEARCH(type)            \
+  TEST_P(type, build_refine_search) /* NOLINT */ \
+  {                                              \
+    this->check_fused_refine();                  \
+  }
+
+#define TEST_BUILD_RANGE_SEARCH(type)            \
+  TEST_P(type, build_range_search) /* NOLINT */ \
+  {                                             \
+    this->check_range_search();                 \
+  }
+
+#define TEST_BUILD_PER_QUERY_SEARCH(type)            \
+  TEST_P(type, build_per_query_search) /* NOLINT */ \
+  {                                                 \
+    this->check_per_query_search();                 \
+  }
+
+#define TEST_BUILD_MEMORY_ESTIMATE(type)            \
+  TEST_P(type, build_memory_estimate) /* NOLINT */ \
+  {                                                \
+    this->check_memory_estimate();                 \
+  }
+
+#define TEST_BUILD_FAISS_ROUNDTRIP(type)            \
+  TEST_P(type, build_faiss_roundtrip) /* NOLINT */ \
+  {                                                \
+    this->check_faiss_roundtrip();                 \
+  }
+
+#define TEST_BUILD_TRANSFORM(type)            \
+  TEST_P(type, build_transform) /* NOLINT */ \
+  {                                          \
+    this->check_transform();                 \
+  }
+
+#define TEST_BUILD_REMOVE_SEARCH(type)            \
+  TEST_P(type, build_remove_search) /* NOLINT */ \
+  {                                              \
+    this->check_remove();                        \
+  }
+
 #define INSTANTIATE(type, vals) \
   INSTANTIATE_TEST_SUITE_P(IvfPq, type, ::testing::ValuesIn(vals)); /* NOLINT */
 
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,15 @@ using f32_f32_i64 = ivf_pq_test<float, float, int64_t>;
 
 TEST_BUILD_EXTEND_SEARCH(f32_f32_i64)
 TEST_BUILD_SERIALIZE_SEARCH(f32_f32_i64)
+TEST_BUILD_SERIALIZE_MAPPED_SEARCH(f32_f32_i64)
+TEST_BUILD_REBALANCE_SEARCH(f32_f32_i64)
+TEST_BUILD_REMOVE_SEARCH(f32_f32_i64)
+TEST_BUILD_REFINE_SEARCH(f32_f32_i64)
+TEST_BUILD_RANGE_SEARCH(f32_f32_i64)
+TEST_BUILD_PER_QUERY_SEARCH(f32_f32_i64)
+TEST_BUILD_MEMORY_ESTIMATE(f32_f32_i64)
+TEST_BUILD_FAISS_ROUNDTRIP(f32_f32_i64)
+TEST_BUILD_TRANSFORM(f32_f32_i64)
 INSTANTIATE(f32_f32_i64, defaults() + small_dims() + big_dims_moderate_lut());
 
 }  // namespace raft::neighbors::ivf_pq
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,7 @@ using f32_u08_i64 = ivf_pq_test<float, uint8_t, int64_t>;
 
 TEST_BUILD_SEARCH(f32_u08_i64)
 TEST_BUILD_EXTEND_SEARCH(f32_u08_i64)
+TEST_BUILD_TRANSFORM(f32_u08_i64)
 INSTANTIATE(f32_u08_i64, small_dims_per_cluster() + enum_variety());
 
 }  // namespace raft::neighbors::ivf_pq
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -20,12 +20,15 @@
 
 #include <raft_internal/neighbors/naive_knn.cuh>
 
+#include <raft/core/operators.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/linalg/map.cuh>
 #include <raft/neighbors/nn_descent.cuh>
 #include <raft/util/itertools.hpp>
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
 #include <string>
@@ -61,11 +64,17 @@ class AnnNNDescentTest : public ::testing::TestWithParam<AnnNNDescentInputs> {
   }
 
  protected:
-  void testNNDescent()
+  /**
+   * @param return_distances also check the distances of the graph edges
+   * @param target_recall the recall-based termination criterion (0: disabled)
+   */
+  void testNNDescent(bool return_distances = false, float target_recall = 0)
   {
     size_t queries_size = ps.n_rows * ps.graph_degree;
     std::vector<IdxT> indices_NNDescent(queries_size);
     std::vector<IdxT> indices_naive(queries_size);
+    std::vector<DistanceT> distances_NNDescent(queries_size);
+    std::vector<DistanceT> distances_naive(queries_size);
 
     {
       rmm::device_uvector<DistanceT> distances_naive_dev(queries_size, stream_);
@@ -81,6 +90,7 @@ class AnnNNDescentTest : public ::testing::TestWithParam<AnnNNDescentInputs> {
                                         ps.graph_degree,
                                         ps.metric);
       update_host(indices_naive.data(), indices_naive_dev.data(), queries_size, stream_);
+      update_host(distances_naive.data(), distances_naive_dev.data(), queries_size, stream_);
       resource::sync_stream(handle_);
     }
 
@@ -91,6 +101,8 @@ class AnnNNDescentTest : public ::testing::TestWithParam<AnnNNDescentInputs> {
         index_params.graph_degree              = ps.graph_degree;
         index_params.intermediate_graph_degree = 2 * ps.graph_degree;
         index_params.max_iterations            = 100;
+        index_params.return_distances          = return_distances;
+        index_params.target_recall             = target_recall;
 
         auto database_view = raft::make_device_matrix_view<const DataT, int64_t>(
           (const DataT*)database.data(), ps.n_rows, ps.dim);
@@ -104,10 +116,24 @@ class AnnNNDescentTest : public ::testing::TestWithParam<AnnNNDescentInputs> {
             auto index = nn_descent::build<DataT, IdxT>(handle_, index_params, database_host_view);
             update_host(
               indices_NNDescent.data(), index.graph().data_handle(), queries_size, stream_);
+            if (return_distances) {
+              ASSERT_TRUE(index.distances().has_value());
+              update_host(distances_NNDescent.data(),
+                          index.distances()->data_handle(),
+                          queries_size,
+                          stream_);
+            }
           } else {
             auto index = nn_descent::build<DataT, IdxT>(handle_, index_params, database_view);
             update_host(
               indices_NNDescent.data(), index.graph().data_handle(), queries_size, stream_);
+            if (return_distances) {
+              ASSERT_TRUE(index.distances().has_value());
+              update_host(distances_NNDescent.data(),
+                          index.distances()->data_handle(),
+                          queries_size,
+                          stream_);
+            }
           };
         }
         resource::sync_stream(handle_);
@@ -116,6 +142,24 @@ class AnnNNDescentTest : public ::testing::TestWithParam<AnnNNDescentInputs> {
       double min_recall = ps.min_recall;
       EXPECT_TRUE(eval_recall(
         indices_naive, indices_NNDescent, ps.n_rows, ps.graph_degree, 0.001, min_recall));
+
+      if (return_distances) {
+        for (int i = 0; i < ps.n_rows; i++) {
+          auto row = distances_NNDescent.begin() + size_t(i) * ps.graph_degree;
+          ASSERT_TRUE(std::is_sorted(row, row + ps.graph_degree)) << "row " << i;
+        }
+        // the 8-bit datasets are kept exactly on the device, so are their distances
+        if constexpr (std::is_integral_v<DataT>) {
+          EXPECT_TRUE(eval_neighbours(indices_naive,
+                                      indices_NNDescent,
+                                      distances_naive,
+                                      distances_NNDescent,
+                                      ps.n_rows,
+                                      ps.graph_degree,
+                                      0.001,
+                                      min_recall));
+        }
+      }
     }
   }
 
@@ -125,6 +169,15 @@ class AnnNNDescentTest : public ::testing::TestWithParam<AnnNNDescentInputs> {
     raft::random::RngState r(1234ULL);
     if constexpr (std::is_same<DataT, float>{}) {
       raft::random::normal(handle_, r, database.data(), ps.n_rows * ps.dim, DataT(0.1), DataT(2.0));
+    } else if constexpr (std::is_same<DataT, half>{}) {
+      rmm::device_uvector<float> database_float(database.size(), stream_);
+      raft::random::normal(handle_, r, database_float.data(), ps.n_rows * ps.dim, 0.1f, 2.0f);
+      raft::linalg::map(
+        handle_,
+        raft::make_device_vector_view<DataT, int64_t>(database.data(), database.size()),
+        raft::cast_op<DataT>{},
+        raft::make_device_vector_view<const float, int64_t>(database_float.data(),
+                                                            database_float.size()));
     } else {
       raft::random::uniformInt(
         handle_, r, database.data(), ps.n_rows * ps.dim, DataT(1), DataT(20));
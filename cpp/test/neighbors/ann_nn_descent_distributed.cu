@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+#include "ann_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/neighbors/nn_descent_distributed.cuh>
+#include <raft/random/rng.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <raft_internal/neighbors/naive_knn.cuh>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace raft::neighbors::experimental::nn_descent {
+
+struct AnnNNDescentDistributedInputs {
+  int n_ranks;
+  int64_t n_rows;
+  int64_t dim;
+  int graph_degree;
+  double min_recall;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const AnnNNDescentDistributedInputs& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", " << p.n_rows << " x " << p.dim << ", graph_degree "
+     << p.graph_degree << "}";
+  return os;
+}
+
+/**
+ * The rows of a random dataset are split in contiguous blocks across the ranks of an in-process
+ * clique: the graph assembled from the local rows of every rank (with their global ids) should
+ * have the recall of the single-GPU nn_descent test against the brute-force knn graph of the
+ * whole dataset.
+ */
+class AnnNNDescentDistributedTest
+  : public ::testing::TestWithParam<AnnNNDescentDistributedInputs> {
+ protected:
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<AnnNNDescentDistributedInputs>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    nn_descent::index_params index_params;
+    index_params.metric                    = raft::distance::DistanceType::L2Expanded;
+    index_params.graph_degree              = p.graph_degree;
+    index_params.intermediate_graph_degree = 2 * p.graph_degree;
+    index_params.max_iterations            = 100;
+
+    // the dataset and the brute-force graph, on the first device
+    const size_t graph_size = p.n_rows * p.graph_degree;
+    std::vector<float> database(p.n_rows * p.dim);
+    std::vector<uint32_t> indices_naive(graph_size);
+    {
+      raft::resources handle;
+      auto stream     = resource::get_cuda_stream(handle);
+      auto d_database = raft::make_device_matrix<float, int64_t>(handle, p.n_rows, p.dim);
+      auto d_indices  = raft::make_device_vector<uint32_t, int64_t>(handle, graph_size);
+      auto d_dists    = raft::make_device_vector<float, int64_t>(handle, graph_size);
+      raft::random::RngState r(1234ULL);
+      raft::random::normal(handle, r, d_database.data_handle(), d_database.size(), 0.1f, 2.0f);
+      raft::update_host(database.data(), d_database.data_handle(), database.size(), stream);
+      naive_knn<float, float, uint32_t>(handle,
+                                        d_dists.data_handle(),
+                                        d_indices.data_handle(),
+                                        d_database.data_handle(),
+                                        d_database.data_handle(),
+                                        p.n_rows,
+                                        p.n_rows,
+                                        p.dim,
+                                        p.graph_degree,
+                                        index_params.metric);
+      raft::update_host(indices_naive.data(), d_indices.data_handle(), graph_size, stream);
+      resource::sync_stream(handle);
+    }
+
+    std::vector<uint32_t> indices_distributed(graph_size);
+    nccl_clique clique(p.n_ranks);
+    clique.run([&](int rank, const raft::resources& handle) {
+      auto stream         = resource::get_cuda_stream(handle);
+      const int64_t begin = p.n_rows * rank / p.n_ranks;
+      const int64_t rows  = p.n_rows * (rank + 1) / p.n_ranks - begin;
+      auto d_shard        = raft::make_device_matrix<float, int64_t>(handle, rows, p.dim);
+      raft::update_device(
+        d_shard.data_handle(), database.data() + begin * p.dim, d_shard.size(), stream);
+
+      auto index = build_distributed<float, uint32_t>(
+        handle, index_params, raft::make_const_mdspan(d_shard.view()));
+      ASSERT_EQ(index.graph().extent(0), rows);
+      ASSERT_EQ(index.graph().extent(1), p.graph_degree);
+      // the graph is on the host, and the ranks write disjoint rows
+      std::copy(index.graph().data_handle(),
+                index.graph().data_handle() + index.graph().size(),
+                indices_distributed.begin() + begin * p.graph_degree);
+    });
+
+    ASSERT_TRUE(eval_recall(
+      indices_naive, indices_distributed, p.n_rows, p.graph_degree, 0.001, p.min_recall));
+  }
+};
+
+// the recall of the single-GPU test; a single rank runs the single-GPU build
+const std::vector<AnnNNDescentDistributedInputs> inputs = {{1, 2000, 64, 32, 0.90},
+                                                           {2, 2000, 64, 32, 0.90},
+                                                           {2, 2001, 17, 64, 0.90},
+                                                           {2, 10000, 128, 32, 0.90}};
+
+TEST_P(AnnNNDescentDistributedTest, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(AnnNNDescentDistributedTests,
+                        AnnNNDescentDistributedTest,
+                        ::testing::ValuesIn(inputs));
+
+}  // namespace raft::neighbors::experimental::nn_descent
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -71,6 +71,10 @@ inline auto operator<<(std::ostream& os, const print_dtype& p) -> std::ostream&
     case CUDA_C_64I: os << "CUDA_C_64I"; break;
     case CUDA_R_64U: os << "CUDA_R_64U"; break;
     case CUDA_C_64U: os << "CUDA_C_64U"; break;
+#if CUDART_VERSION >= 11080
+    case CUDA_R_8F_E4M3: os << "CUDA_R_8F_E4M3"; break;
+    case CUDA_R_8F_E5M2: os << "CUDA_R_8F_E5M2"; break;
+#endif
     default: RAFT_FAIL("unreachable code");
   }
   return os;
@@ -359,7 +359,12 @@ const std::vector<BallCoverInputs<std::int64_t>> ballcover_inputs = {
   {25, 5000, 2, 1.0, 10000, raft::distance::DistanceType::L2SqrtUnexpanded},
   {5, 8000, 3, 1.0, 10000, raft::distance::DistanceType::L2SqrtUnexpanded},
   {11, 6000, 3, 1.0, 10000, raft::distance::DistanceType::L2SqrtUnexpanded},
-  {25, 10000, 3, 1.0, 5000, raft::distance::DistanceType::L2SqrtUnexpanded}};
+  {25, 10000, 3, 1.0, 5000, raft::distance::DistanceType::L2SqrtUnexpanded},
+  {5, 8000, 3, 1.0, 5000, raft::distance::DistanceType::CosineExpanded},
+  {10, 5000, 32, 1.0, 2000, raft::distance::DistanceType::L2SqrtUnexpanded},
+  {25, 5000, 128, 1.0, 2000, raft::distance::DistanceType::L2SqrtUnexpanded},
+  {10, 5000, 64, 1.0, 2000, raft::distance::DistanceType::CosineExpanded},
+  {64, 10000, 96, 1.0, 1000, raft::distance::DistanceType::CosineExpanded}};
 
 INSTANTIATE_TEST_CASE_P(BallCoverAllKNNTest,
                         BallCoverAllKNNTestF,
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/device_resources.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
+#include <raft/core/resource/pinned_memory_resource.hpp>
+#include <raft/spatial/knn/detail/ann_utils.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/cuda_stream_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <numeric>
+#include <vector>
+
+namespace raft::neighbors {
+
+namespace utils = raft::spatial::knn::detail::utils;
+
+struct BatchLoadInputs {
+  bool prefetch;
+  bool pinned;
+};
+
+class BatchLoadIteratorTest : public ::testing::TestWithParam<BatchLoadInputs> {
+ protected:
+  void run()
+  {
+    auto params = GetParam();
+    raft::device_resources res;
+    resource::set_cuda_stream_pool(res, std::make_shared<rmm::cuda_stream_pool>(1));
+    if (params.pinned) { resource::set_pinned_memory_pool(res, 1 << 20); }
+    auto stream = resource::get_cuda_stream(res);
+
+    constexpr size_t n_rows = 1000, row_width = 7, batch_size = 128;
+    std::vector<float> source(n_rows * row_width);
+    std::iota(source.begin(), source.end(), 0.0f);
+
+    auto prefetch_stream = params.prefetch
+                             ? std::make_optional(resource::get_stream_from_stream_pool(res))
+                             : std::nullopt;
+    utils::batch_load_iterator<float> batches(
+      source.data(),
+      n_rows,
+      row_width,
+      batch_size,
+      stream,
+      resource::get_workspace_resource(res),
+      params.pinned ? resource::get_pinned_memory_resource(res) : nullptr,
+      prefetch_stream);
+    ASSERT_TRUE(batches.does_copy());
+    ASSERT_EQ(params.prefetch, batches.does_prefetch());
+
+    // the iterator is reusable: go through the data twice
+    std::vector<float> loaded(batch_size * row_width);
+    for (int pass = 0; pass < 2; pass++) {
+      size_t n_loaded = 0;
+      for (const auto& batch : batches) {
+        ASSERT_EQ(n_loaded, batch.offset());
+        raft::update_host(loaded.data(), batch.data(), batch.size() * row_width, stream);
+        resource::sync_stream(res);
+        for (size_t i = 0; i < batch.size() * row_width; i++) {
+          ASSERT_EQ(source[n_loaded * row_width + i], loaded[i]);
+        }
+        n_loaded += batch.size();
+      }
+      ASSERT_EQ(n_rows, n_loaded);
+    }
+  }
+};
+
+TEST_P(BatchLoadIteratorTest, LoadsAllBatches) { run(); }
+
+INSTANTIATE_TEST_CASE_P(BatchLoadIteratorTests,
+                        BatchLoadIteratorTest,
+                        ::testing::Values(BatchLoadInputs{false, false},
+                                          BatchLoadInputs{false, true},
+                                          BatchLoadInputs{true, false},
+                                          BatchLoadInputs{true, true}));
+
+}  // namespace raft::neighbors
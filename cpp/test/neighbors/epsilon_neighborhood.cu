@@ -17,9 +17,11 @@
 #include "../test_utils.cuh"
 #include <gtest/gtest.h>
 #include <memory>
+#include <raft/core/device_csr_matrix.hpp>
 #include <raft/core/device_mdspan.hpp>
 #include <raft/core/host_mdspan.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/thrust_policy.hpp>
 #include <raft/neighbors/ball_cover.cuh>
 #include <raft/random/make_blobs.cuh>
 #include <raft/sparse/convert/csr.cuh>
@@ -27,6 +29,9 @@
 #include <raft/util/cudart_utils.hpp>
 #include <rmm/device_uvector.hpp>
 
+#include <thrust/functional.h>
+#include <thrust/transform.h>
+
 namespace raft {
 namespace spatial {
 namespace knn {
@@ -124,6 +129,40 @@ TEST_P(EpsNeighTestFI, ResultBruteForce)
   }
 }
 
+TEST_P(EpsNeighTestFI, SparseResultBruteForce)
+{
+  auto stream = resource::get_cuda_stream(handle);
+  // a workspace of a few rows, to run many batches
+  std::size_t workspace = 7 * param.n_row * sizeof(float);
+  for (auto metric : {raft::distance::DistanceType::L2Expanded,
+                      raft::distance::DistanceType::L2SqrtExpanded}) {
+    float eps = metric == raft::distance::DistanceType::L2Expanded ? param.eps * param.eps
+                                                                    : param.eps;
+    for (int i = 0; i < param.n_batches; ++i) {
+      auto x_view = make_device_matrix_view<const float, int64_t>(
+        data.data() + (i * batchSize * param.n_col), batchSize, param.n_col);
+      auto y_view =
+        make_device_matrix_view<const float, int64_t>(data.data(), param.n_row, param.n_col);
+      auto csr = raft::make_device_csr_matrix<bool, int64_t, int64_t, int64_t>(
+        handle, batchSize, param.n_row);
+
+      raft::neighbors::epsilon_neighborhood::eps_neighbors<float, int64_t, int64_t>(
+        handle, x_view, y_view, csr, eps, metric, workspace);
+
+      // the degrees of the rows
+      auto indptr = csr.structure_view().get_indptr().data();
+      thrust::transform(resource::get_thrust_policy(handle),
+                        indptr + 1,
+                        indptr + batchSize + 1,
+                        indptr,
+                        vd.data(),
+                        thrust::minus<int64_t>());
+      ASSERT_TRUE(raft::devArrMatch(
+        param.n_row / param.n_centers, vd.data(), batchSize, raft::Compare<int64_t>(), stream));
+    }
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(EpsNeighTests, EpsNeighTestFI, ::testing::ValuesIn(inputsfi));
 
 // rbc examples take fewer points as correctness checks are very costly
@@ -308,6 +347,70 @@ TEST_P(EpsNeighRbcTestFI, SparseRbc)
   }
 }
 
+TEST_P(EpsNeighRbcTestFI, SparseRbcBatched)
+{
+  auto vd_baseline     = raft::make_device_vector<int64_t>(handle, batchSize + 1);
+  auto adj_ia_baseline = raft::make_device_vector<int64_t>(handle, batchSize + 1);
+  auto adj_ja_baseline = raft::make_device_vector<int64_t>(handle, param.n_row * batchSize);
+
+  raft::neighbors::ball_cover::BallCoverIndex<int64_t, float, int64_t, int64_t> rbc_index(
+    handle, data.data(), param.n_row, param.n_col, raft::distance::DistanceType::L2SqrtUnexpanded);
+  raft::neighbors::ball_cover::build_index(handle, rbc_index);
+
+  // a workspace of a few queries, to exercise the batching
+  size_t max_workspace_bytes = 7 * rbc_index.n_landmarks * sizeof(float);
+
+  for (int i = 0; i < param.n_batches; ++i) {
+    float* query = data.data() + (i * batchSize * param.n_col);
+
+    // compute dense baseline and convert adj to csr
+    {
+      raft::neighbors::ball_cover::eps_nn<int64_t, float, int64_t, int64_t>(
+        handle,
+        rbc_index,
+        make_device_matrix_view<bool, int64_t>(adj.data(), batchSize, param.n_row),
+        make_device_vector_view<int64_t, int64_t>(vd_baseline.data_handle(), batchSize + 1),
+        make_device_matrix_view<float, int64_t>(query, batchSize, param.n_col),
+        param.eps * param.eps);
+      thrust::exclusive_scan(resource::get_thrust_policy(handle),
+                             vd_baseline.data_handle(),
+                             vd_baseline.data_handle() + batchSize + 1,
+                             adj_ia_baseline.data_handle());
+      raft::sparse::convert::adj_to_csr(handle,
+                                        adj.data(),
+                                        adj_ia_baseline.data_handle(),
+                                        batchSize,
+                                        param.n_row,
+                                        labels.data(),
+                                        adj_ja_baseline.data_handle());
+    }
+
+    auto adj_csr =
+      raft::make_device_csr_matrix<bool, int64_t, int64_t, int64_t>(handle, batchSize, param.n_row);
+    raft::neighbors::ball_cover::eps_nn<int64_t, float, int64_t, int64_t>(
+      handle,
+      rbc_index,
+      make_device_matrix_view<const float, int64_t>(query, batchSize, param.n_col),
+      param.eps * param.eps,
+      adj_csr,
+      max_workspace_bytes);
+
+    auto structure = adj_csr.structure_view();
+    ASSERT_TRUE(raft::devArrMatch(adj_ia_baseline.data_handle(),
+                                  structure.get_indptr().data(),
+                                  batchSize + 1,
+                                  raft::Compare<int64_t>(),
+                                  stream));
+    ASSERT_TRUE(assertCsrEqualUnordered(adj_ia_baseline.data_handle(),
+                                        adj_ja_baseline.data_handle(),
+                                        structure.get_indptr().data(),
+                                        structure.get_indices().data(),
+                                        batchSize,
+                                        param.n_row,
+                                        stream));
+  }
+}
+
 TEST_P(EpsNeighRbcTestFI, SparseRbcMaxK)
 {
   auto adj_ia          = raft::make_device_vector<int64_t>(handle, batchSize + 1);
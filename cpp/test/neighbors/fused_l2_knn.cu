@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -89,7 +89,7 @@ class FusedL2KNNTest : public ::testing::TestWithParam<FusedL2KNNInputs> {
       std::nullopt,
       make_device_matrix_view<T, int64_t>(ref_distances_.data(), num_queries, k_),
       make_device_matrix_view<int64_t, int64_t>(ref_indices_.data(), num_queries, k_),
-      true,
+      raft::distance::is_min_close(metric),
       true);
 
     auto index_view =
@@ -124,8 +124,10 @@ class FusedL2KNNTest : public ::testing::TestWithParam<FusedL2KNNInputs> {
 
     unsigned long long int seed = 1234ULL;
     raft::random::RngState r(seed);
-    uniform(handle_, r, database.data(), num_db_vecs * dim, T(-1.0), T(1.0));
-    uniform(handle_, r, search_queries.data(), num_queries * dim, T(-1.0), T(1.0));
+    // Jensen-Shannon is defined for non-negative inputs only
+    const T low = metric == raft::distance::DistanceType::JensenShannon ? T(0.0) : T(-1.0);
+    uniform(handle_, r, database.data(), num_db_vecs * dim, low, T(1.0));
+    uniform(handle_, r, search_queries.data(), num_queries * dim, low, T(1.0));
   }
 
  private:
@@ -162,6 +164,20 @@ const std::vector<FusedL2KNNInputs> inputs = {
   {1000, 10000, 16, 50, raft::distance::DistanceType::L2Unexpanded},
   {1000, 10000, 32, 50, raft::distance::DistanceType::L2Unexpanded},
   {10000, 40000, 32, 30, raft::distance::DistanceType::L2Unexpanded},
+  // inner product, cosine, L1
+  {100, 1000, 16, 10, raft::distance::DistanceType::InnerProduct},
+  {1000, 10000, 32, 50, raft::distance::DistanceType::InnerProduct},
+  {100, 1000, 16, 10, raft::distance::DistanceType::CosineExpanded},
+  {1000, 10000, 32, 50, raft::distance::DistanceType::CosineExpanded},
+  {100, 1000, 16, 10, raft::distance::DistanceType::L1},
+  {1000, 10000, 32, 50, raft::distance::DistanceType::L1},
+  // other distance ops
+  {100, 1000, 16, 10, raft::distance::DistanceType::Linf},
+  {1000, 10000, 32, 50, raft::distance::DistanceType::Linf},
+  {100, 1000, 16, 10, raft::distance::DistanceType::Canberra},
+  {1000, 10000, 32, 50, raft::distance::DistanceType::Canberra},
+  {100, 1000, 16, 10, raft::distance::DistanceType::JensenShannon},
+  {1000, 10000, 32, 50, raft::distance::DistanceType::JensenShannon},
 };
 
 typedef FusedL2KNNTest<float> FusedL2KNNTestF;
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -21,6 +21,12 @@
 #include <raft/distance/distance_types.hpp>
 #include <raft/spatial/knn/detail/haversine_distance.cuh>
 #include <rmm/device_uvector.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <type_traits>
 #include <vector>
 
 namespace raft {
@@ -128,6 +134,132 @@ TEST_F(HaversineKNNTestF, Fit)
     raft::devArrMatch(d_ref_I.data(), d_pred_I.data(), n * n, raft::Compare<int>(), stream));
 }
 
+struct HaversineRandomInputs {
+  int n_index;
+  int n_query;
+  int k;
+  bool mixed_precision;
+};
+
+inline auto host_haversine(double x1, double y1, double x2, double y2) -> double
+{
+  double sin_0 = std::sin(0.5 * (x1 - y1));
+  double sin_1 = std::sin(0.5 * (x2 - y2));
+  double rdist = sin_0 * sin_0 + std::cos(x1) * std::cos(y1) * sin_1 * sin_1;
+  return 2 * std::asin(std::sqrt(std::min(rdist, 1.0)));
+}
+
+// Checks the tiled (and the mixed-precision) kernels against an fp64 brute force on the host.
+template <typename value_t>
+class HaversineKNNRandomTest : public ::testing::TestWithParam<HaversineRandomInputs> {
+ public:
+  HaversineKNNRandomTest()
+    : params(::testing::TestWithParam<HaversineRandomInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void run()
+  {
+    const int n_index = params.n_index;
+    const int n_query = params.n_query;
+    const int k       = params.k;
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> lat(-M_PI / 2, M_PI / 2);
+    std::uniform_real_distribution<double> lon(-M_PI, M_PI);
+    std::vector<value_t> h_index(n_index * 2);
+    std::vector<value_t> h_query(n_query * 2);
+    for (int i = 0; i < n_index; i++) {
+      h_index[i * 2]     = lat(gen);
+      h_index[i * 2 + 1] = lon(gen);
+    }
+    for (int i = 0; i < n_query; i++) {
+      h_query[i * 2]     = lat(gen);
+      h_query[i * 2 + 1] = lon(gen);
+    }
+
+    // fp64 reference
+    std::vector<int64_t> ref_I(n_query * k);
+    std::vector<value_t> ref_D(n_query * k);
+    std::vector<double> dists(n_index);
+    std::vector<int64_t> order(n_index);
+    for (int q = 0; q < n_query; q++) {
+      for (int i = 0; i < n_index; i++) {
+        dists[i] = host_haversine(
+          h_query[q * 2], h_index[i * 2], h_query[q * 2 + 1], h_index[i * 2 + 1]);
+      }
+      std::iota(order.begin(), order.end(), 0);
+      std::partial_sort(order.begin(), order.begin() + k, order.end(), [&](auto a, auto b) {
+        return dists[a] < dists[b];
+      });
+      for (int j = 0; j < k; j++) {
+        ref_I[q * k + j] = order[j];
+        ref_D[q * k + j] = dists[order[j]];
+      }
+    }
+
+    rmm::device_uvector<value_t> d_index(n_index * 2, stream);
+    rmm::device_uvector<value_t> d_query(n_query * 2, stream);
+    rmm::device_uvector<int64_t> d_ref_I(n_query * k, stream);
+    rmm::device_uvector<value_t> d_ref_D(n_query * k, stream);
+    rmm::device_uvector<int64_t> d_pred_I(n_query * k, stream);
+    rmm::device_uvector<value_t> d_pred_D(n_query * k, stream);
+    raft::update_device(d_index.data(), h_index.data(), h_index.size(), stream);
+    raft::update_device(d_query.data(), h_query.data(), h_query.size(), stream);
+    raft::update_device(d_ref_I.data(), ref_I.data(), ref_I.size(), stream);
+    raft::update_device(d_ref_D.data(), ref_D.data(), ref_D.size(), stream);
+
+    raft::spatial::knn::detail::haversine_knn(d_pred_I.data(),
+                                              d_pred_D.data(),
+                                              d_index.data(),
+                                              d_query.data(),
+                                              n_index,
+                                              n_query,
+                                              k,
+                                              stream,
+                                              params.mixed_precision);
+    resource::sync_stream(handle, stream);
+
+    // fp32 distances may reorder the neighbors at the same distance within the precision.
+    const bool exact  = std::is_same_v<value_t, double> || params.mixed_precision;
+    const value_t tol = std::is_same_v<value_t, double> ? 1e-9 : 1e-4;
+    ASSERT_TRUE(raft::devArrMatch(
+      d_ref_D.data(), d_pred_D.data(), n_query * k, raft::CompareApprox<value_t>(tol), stream));
+    if (exact) {
+      ASSERT_TRUE(raft::devArrMatch(
+        d_ref_I.data(), d_pred_I.data(), n_query * k, raft::Compare<int64_t>(), stream));
+    }
+  }
+
+  raft::resources handle;
+  HaversineRandomInputs params;
+  cudaStream_t stream;
+};
+
+const std::vector<HaversineRandomInputs> random_inputs = {
+  {3000, 97, 1, false},
+  {3000, 97, 40, false},
+  {3000, 97, 40, true},
+  {1000, 300, 300, false},
+  {1000, 300, 300, true},
+  {2000, 10, 1024, false},
+  {2000, 10, 1024, true},
+};
+
+typedef HaversineKNNRandomTest<float> HaversineKNNRandomTestF;
+TEST_P(HaversineKNNRandomTestF, Result) { run(); }
+INSTANTIATE_TEST_CASE_P(HaversineKNNRandomTests,
+                        HaversineKNNRandomTestF,
+                        ::testing::ValuesIn(random_inputs));
+
+typedef HaversineKNNRandomTest<double> HaversineKNNRandomTestD;
+TEST_P(HaversineKNNRandomTestD, Result) { run(); }
+INSTANTIATE_TEST_CASE_P(HaversineKNNRandomTests,
+                        HaversineKNNRandomTestD,
+                        ::testing::ValuesIn(random_inputs));
+
 }  // namespace knn
 }  // namespace spatial
 }  // namespace raft
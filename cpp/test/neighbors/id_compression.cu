@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_resources.hpp>
+#include <raft/neighbors/detail/id_compression.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace raft::neighbors {
+
+struct IdCompressionInputs {
+  int64_t n;
+  bool delta;
+  bool sorted;
+};
+
+template <typename T>
+class IdCompressionTest : public ::testing::TestWithParam<IdCompressionInputs> {
+ protected:
+  void run()
+  {
+    auto params = GetParam();
+    raft::device_resources res;
+    auto stream = resource::get_cuda_stream(res);
+
+    // nearly sorted ids with a few outliers, or ids of a small range
+    std::mt19937 rng(42);
+    std::vector<T> ids(params.n);
+    for (int64_t i = 0; i < params.n; i++) {
+      ids[i] = params.sorted ? T(i * 3 + rng() % 5) : T(rng() % 100000);
+      if (params.sorted && rng() % 997 == 0) {
+        ids[i] = std::numeric_limits<T>::max() - T(rng() % 7);
+      }
+    }
+    auto d_ids = raft::make_device_vector<T, int64_t>(res, params.n);
+    raft::update_device(d_ids.data_handle(), ids.data(), params.n, stream);
+
+    std::stringstream ss;
+    detail::serialize_ids_compressed(res, ss, raft::make_const_mdspan(d_ids.view()), params.delta);
+    auto decoded = raft::make_device_vector<T, int64_t>(res, params.n);
+    detail::deserialize_ids_compressed(res, ss, decoded.view());
+
+    std::vector<T> result(params.n);
+    raft::update_host(result.data(), decoded.data_handle(), params.n, stream);
+    resource::sync_stream(res);
+    for (int64_t i = 0; i < params.n; i++) {
+      ASSERT_EQ(ids[i], result[i]) << "at " << i;
+    }
+    // the residuals of a small range take fewer bits than the ids themselves
+    if (params.n >= 4096 && !params.sorted) {
+      ASSERT_LT(ss.str().size(), params.n * sizeof(T));
+    }
+  }
+};
+
+const std::vector<IdCompressionInputs> inputs = {{0, false, false},
+                                                 {1, true, true},
+                                                 {1000, false, false},
+                                                 {1024, true, true},
+                                                 {5000, false, false},
+                                                 {5000, true, true},
+                                                 {100000, true, false},
+                                                 {100000, false, true}};
+
+using IdCompressionTestU32 = IdCompressionTest<uint32_t>;
+TEST_P(IdCompressionTestU32, RoundTrip) { run(); }
+INSTANTIATE_TEST_CASE_P(IdCompressionTests, IdCompressionTestU32, ::testing::ValuesIn(inputs));
+
+using IdCompressionTestI64 = IdCompressionTest<int64_t>;
+TEST_P(IdCompressionTestI64, RoundTrip) { run(); }
+INSTANTIATE_TEST_CASE_P(IdCompressionTests, IdCompressionTestI64, ::testing::ValuesIn(inputs));
+
+}  // namespace raft::neighbors
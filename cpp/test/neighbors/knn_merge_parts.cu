@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_resources.hpp>
+#include <raft/neighbors/detail/knn_merge_parts.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace raft::neighbors {
+
+struct KnnMergePartsInputs {
+  size_t n_samples;
+  int n_parts;
+  int k;
+  bool translate;
+};
+
+template <typename IdxT>
+class KnnMergePartsTest : public ::testing::TestWithParam<KnnMergePartsInputs> {
+ protected:
+  void run()
+  {
+    auto params = GetParam();
+    raft::device_resources res;
+    auto stream = resource::get_cuda_stream(res);
+
+    // distinct keys, so that the merged order is unique
+    const size_t len  = static_cast<size_t>(params.n_parts) * params.k;
+    const size_t size = params.n_samples * len;
+    std::vector<float> keys(size);
+    std::iota(keys.begin(), keys.end(), 0.0f);
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+    std::vector<IdxT> values(size);
+    for (size_t i = 0; i < size; i++) {
+      values[i] = IdxT(i % len);
+    }
+    std::vector<IdxT> translations(params.n_parts);
+    for (int p = 0; p < params.n_parts; p++) {
+      translations[p] = IdxT(p * 100000);
+    }
+
+    // the reference: a sort of all the candidates of a row
+    std::vector<float> expected_keys(params.n_samples * params.k);
+    std::vector<IdxT> expected_values(params.n_samples * params.k);
+    std::vector<std::pair<float, IdxT>> row(len);
+    for (size_t r = 0; r < params.n_samples; r++) {
+      for (int p = 0; p < params.n_parts; p++) {
+        for (int j = 0; j < params.k; j++) {
+          const size_t src      = (p * params.n_samples + r) * params.k + j;
+          row[p * params.k + j] = {keys[src],
+                                   values[src] + (params.translate ? translations[p] : IdxT(0))};
+        }
+      }
+      std::sort(row.begin(), row.end());
+      for (int j = 0; j < params.k; j++) {
+        expected_keys[r * params.k + j]   = row[j].first;
+        expected_values[r * params.k + j] = row[j].second;
+      }
+    }
+
+    const size_t out_size = params.n_samples * params.k;
+    auto d_keys           = raft::make_device_vector<float, int64_t>(res, size);
+    auto d_values         = raft::make_device_vector<IdxT, int64_t>(res, size);
+    auto d_translations   = raft::make_device_vector<IdxT, int64_t>(res, params.n_parts);
+    auto d_out_keys       = raft::make_device_vector<float, int64_t>(res, out_size);
+    auto d_out_values     = raft::make_device_vector<IdxT, int64_t>(res, out_size);
+    raft::update_device(d_keys.data_handle(), keys.data(), size, stream);
+    raft::update_device(d_values.data_handle(), values.data(), size, stream);
+    raft::update_device(d_translations.data_handle(), translations.data(), params.n_parts, stream);
+
+    neighbors::detail::knn_merge_parts<IdxT, float>(
+      res,
+      d_keys.data_handle(),
+      d_values.data_handle(),
+      d_out_keys.data_handle(),
+      d_out_values.data_handle(),
+      params.n_samples,
+      params.n_parts,
+      params.k,
+      params.translate ? d_translations.data_handle() : nullptr);
+
+    std::vector<float> out_keys(out_size);
+    std::vector<IdxT> out_values(out_size);
+    raft::update_host(out_keys.data(), d_out_keys.data_handle(), out_keys.size(), stream);
+    raft::update_host(out_values.data(), d_out_values.data_handle(), out_values.size(), stream);
+    resource::sync_stream(res);
+    for (size_t i = 0; i < out_keys.size(); i++) {
+      ASSERT_EQ(expected_keys[i], out_keys[i]) << "at " << i;
+      ASSERT_EQ(expected_values[i], out_values[i]) << "at " << i;
+    }
+  }
+};
+
+const std::vector<KnnMergePartsInputs> inputs = {
+  // n_samples, n_parts, k, translate
+  // the block select per row
+  {100, 2, 1, true},
+  {100, 4, 32, false},
+  {50, 8, 100, true},
+  {20, 16, 1024, true},
+  // a single select_k
+  {100, 64, 10, true},
+  {30, 256, 64, false},
+  {10, 4, 2048, true},
+  {5, 2, 4096, false}};
+
+using KnnMergePartsTestI64 = KnnMergePartsTest<int64_t>;
+TEST_P(KnnMergePartsTestI64, Merge) { run(); }
+INSTANTIATE_TEST_CASE_P(KnnMergePartsTests, KnnMergePartsTestI64, ::testing::ValuesIn(inputs));
+
+using KnnMergePartsTestU32 = KnnMergePartsTest<uint32_t>;
+TEST_P(KnnMergePartsTestU32, Merge) { run(); }
+INSTANTIATE_TEST_CASE_P(KnnMergePartsTests, KnnMergePartsTestU32, ::testing::ValuesIn(inputs));
+
+}  // namespace raft::neighbors
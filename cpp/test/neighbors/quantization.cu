@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/device_resources.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/core/resource/cuda_stream_pool.hpp>
+#include <raft/neighbors/quantization.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/cuda_stream_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace raft::neighbors::quantization {
+
+struct QuantizationInputs {
+  int64_t n_rows;
+  uint32_t dim;
+  bool per_dimension;
+  double quantile;
+  int64_t max_train_rows;
+};
+
+/** Every dimension j of the data is uniform in [-j - 1, 2 j + 1]. */
+inline auto make_data(int64_t n_rows, uint32_t dim) -> std::vector<float>
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  std::vector<float> data(n_rows * dim);
+  for (int64_t i = 0; i < n_rows; i++) {
+    for (uint32_t j = 0; j < dim; j++) {
+      data[i * dim + j] = -float(j + 1) + float(3 * j + 2) * uniform(gen);
+    }
+  }
+  return data;
+}
+
+template <typename QuantT>
+class QuantizationTest : public ::testing::TestWithParam<QuantizationInputs> {
+ public:
+  QuantizationTest() : ps(GetParam()), stream(resource::get_cuda_stream(res))
+  {
+    resource::set_cuda_stream_pool(res, std::make_shared<rmm::cuda_stream_pool>(1));
+  }
+
+ protected:
+  void run()
+  {
+    auto data   = make_data(ps.n_rows, ps.dim);
+    auto d_data = raft::make_device_matrix<float, int64_t>(res, ps.n_rows, ps.dim);
+    raft::update_device(d_data.data_handle(), data.data(), data.size(), stream);
+    auto h_view = raft::make_host_matrix_view<const float, int64_t>(data.data(), ps.n_rows, ps.dim);
+
+    params p;
+    p.per_dimension  = ps.per_dimension;
+    p.quantile       = ps.quantile;
+    p.max_train_rows = ps.max_train_rows;
+    auto quantizer   = train<QuantT>(res, p, h_view);
+    ASSERT_EQ(quantizer.n_ranges(), ps.per_dimension ? ps.dim : 1u);
+
+    // the codes of the host and the device inputs are the same
+    auto codes   = raft::make_device_matrix<QuantT, int64_t>(res, ps.n_rows, ps.dim);
+    auto d_codes = raft::make_device_matrix<QuantT, int64_t>(res, ps.n_rows, ps.dim);
+    transform(res, quantizer, h_view, codes.view());
+    transform(res, quantizer, raft::make_const_mdspan(d_data.view()), d_codes.view());
+    auto decoded = raft::make_device_matrix<float, int64_t>(res, ps.n_rows, ps.dim);
+    inverse_transform(res, quantizer, raft::make_const_mdspan(codes.view()), decoded.view());
+
+    std::vector<QuantT> h_codes(data.size());
+    std::vector<QuantT> h_d_codes(data.size());
+    std::vector<float> h_decoded(data.size());
+    std::vector<float> coeffs(quantizer.coefficients().size());
+    raft::update_host(h_codes.data(), codes.data_handle(), data.size(), stream);
+    raft::update_host(h_d_codes.data(), d_codes.data_handle(), data.size(), stream);
+    raft::update_host(h_decoded.data(), decoded.data_handle(), data.size(), stream);
+    raft::update_host(coeffs.data(), quantizer.coefficients().data_handle(), coeffs.size(), stream);
+    resource::sync_stream(res, stream);
+
+    // the values inside the ranges are restored up to the rounding, the others are clamped
+    auto view      = scalar_quantizer_view<QuantT>{coeffs.data(), ps.per_dimension};
+    int64_t n_clip = 0;
+    for (size_t i = 0; i < data.size(); i++) {
+      ASSERT_EQ(h_codes[i], h_d_codes[i]);
+      uint32_t j = i % ps.dim;
+      float lo   = view.decode(std::numeric_limits<QuantT>::lowest(), j);
+      float hi   = view.decode(std::numeric_limits<QuantT>::max(), j);
+      float x    = std::clamp(data[i], lo, hi);
+      n_clip += x != data[i];
+      float step = coeffs[(ps.per_dimension ? 2 * j : 0) + 1];
+      ASSERT_NEAR(x, h_decoded[i], 0.5f * step + 1e-5f * std::abs(x));
+      ASSERT_GE(h_decoded[i], lo - 1e-5f * std::abs(lo));
+      ASSERT_LE(h_decoded[i], hi + 1e-5f * std::abs(hi));
+    }
+    double clipped = double(n_clip) / double(data.size());
+    ASSERT_LE(clipped, 1.0 - ps.quantile + 0.02);
+    if (ps.quantile < 1 && ps.max_train_rows >= ps.n_rows) {
+      ASSERT_GE(clipped, 1.0 - ps.quantile - 0.02);
+    }
+  }
+
+  raft::device_resources res;
+  QuantizationInputs ps;
+  rmm::cuda_stream_view stream;
+};
+
+const std::vector<QuantizationInputs> inputs = {
+  {3000, 5, true, 1.0, 100000},
+  {3000, 5, false, 1.0, 100000},
+  {3000, 5, true, 0.9, 100000},
+  {3000, 5, false, 0.95, 100000},
+  {20000, 7, true, 1.0, 1000},
+  {20000, 7, true, 0.9, 2000},
+  {100, 1, true, 1.0, 100000},
+};
+
+using QuantizationTestInt8 = QuantizationTest<int8_t>;
+TEST_P(QuantizationTestInt8, Result) { run(); }
+INSTANTIATE_TEST_CASE_P(QuantizationTests, QuantizationTestInt8, ::testing::ValuesIn(inputs));
+
+using QuantizationTestUint8 = QuantizationTest<uint8_t>;
+TEST_P(QuantizationTestUint8, Result) { run(); }
+INSTANTIATE_TEST_CASE_P(QuantizationTests, QuantizationTestUint8, ::testing::ValuesIn(inputs));
+
+TEST(QuantizationTests, HalfClampsToRanges)
+{
+  raft::device_resources res;
+  auto stream    = resource::get_cuda_stream(res);
+  int64_t n_rows = 4000;
+  uint32_t dim   = 3;
+  auto data      = make_data(n_rows, dim);
+  auto h_view    = raft::make_host_matrix_view<const float, int64_t>(data.data(), n_rows, dim);
+  params p;
+  p.quantile     = 0.9;
+  auto quantizer = train<half>(res, p, h_view);
+  auto codes     = raft::make_device_matrix<half, int64_t>(res, n_rows, dim);
+  transform(res, quantizer, h_view, codes.view());
+  auto decoded = raft::make_device_matrix<float, int64_t>(res, n_rows, dim);
+  inverse_transform(res, quantizer, raft::make_const_mdspan(codes.view()), decoded.view());
+
+  std::vector<float> h_decoded(data.size());
+  std::vector<float> coeffs(2 * dim);
+  raft::update_host(h_decoded.data(), decoded.data_handle(), data.size(), stream);
+  raft::update_host(coeffs.data(), quantizer.coefficients().data_handle(), coeffs.size(), stream);
+  resource::sync_stream(res, stream);
+  for (uint32_t j = 0; j < dim; j++) {
+    // the central 90% of uniform [-j - 1, 2 j + 1]
+    float width = float(3 * j + 2);
+    ASSERT_NEAR(coeffs[2 * j], -float(j + 1) + 0.05f * width, 0.02f * width);
+    ASSERT_NEAR(coeffs[2 * j + 1], float(2 * j + 1) - 0.05f * width, 0.02f * width);
+  }
+  for (size_t i = 0; i < data.size(); i++) {
+    uint32_t j = i % dim;
+    float x    = std::clamp(data[i], coeffs[2 * j], coeffs[2 * j + 1]);
+    ASSERT_NEAR(x, h_decoded[i], 1e-3f * std::max(1.0f, std::abs(x)));
+  }
+}
+
+}  // namespace raft::neighbors::quantization
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -98,6 +98,40 @@ class RefineTest : public ::testing::TestWithParam<RefineInputs<IdxT>> {
                                                  min_recall));
   }
 
+  /** The device refinement of a host-resident dataset (device queries, candidates and outputs). */
+  void testRefineHostDataset()
+  {
+    if (!data.p.host_data) { GTEST_SKIP(); }
+    std::vector<IdxT> indices(data.p.n_queries * data.p.k);
+    std::vector<DistanceT> distances(data.p.n_queries * data.p.k);
+
+    raft::neighbors::refine<IdxT, DataT, DistanceT, IdxT>(handle_,
+                                                          data.dataset_host.view(),
+                                                          data.queries.view(),
+                                                          data.candidates.view(),
+                                                          data.refined_indices.view(),
+                                                          data.refined_distances.view(),
+                                                          data.p.metric);
+    update_host(distances.data(),
+                data.refined_distances.data_handle(),
+                data.refined_distances.size(),
+                stream_);
+    update_host(
+      indices.data(), data.refined_indices.data_handle(), data.refined_indices.size(), stream_);
+    resource::sync_stream(handle_);
+
+    double min_recall = 1;
+
+    ASSERT_TRUE(raft::neighbors::eval_neighbours(data.true_refined_indices_host,
+                                                 indices,
+                                                 data.true_refined_distances_host,
+                                                 distances,
+                                                 data.p.n_queries,
+                                                 data.p.k,
+                                                 0.001,
+                                                 min_recall));
+  }
+
  public:
   raft::resources handle_;
   rmm::cuda_stream_view stream_;
@@ -116,14 +150,17 @@ const std::vector<RefineInputs<int64_t>> inputs =
 
 typedef RefineTest<float, float, std::int64_t> RefineTestF;
 TEST_P(RefineTestF, AnnRefine) { this->testRefine(); }
+TEST_P(RefineTestF, AnnRefineHostDataset) { this->testRefineHostDataset(); }
 
 INSTANTIATE_TEST_CASE_P(RefineTest, RefineTestF, ::testing::ValuesIn(inputs));
 
 typedef RefineTest<uint8_t, float, std::int64_t> RefineTestF_uint8;
 TEST_P(RefineTestF_uint8, AnnRefine) { this->testRefine(); }
+TEST_P(RefineTestF_uint8, AnnRefineHostDataset) { this->testRefineHostDataset(); }
 INSTANTIATE_TEST_CASE_P(RefineTest, RefineTestF_uint8, ::testing::ValuesIn(inputs));
 
 typedef RefineTest<int8_t, float, std::int64_t> RefineTestF_int8;
 TEST_P(RefineTestF_int8, AnnRefine) { this->testRefine(); }
+TEST_P(RefineTestF_int8, AnnRefineHostDataset) { this->testRefineHostDataset(); }
 INSTANTIATE_TEST_CASE_P(RefineTest, RefineTestF_int8, ::testing::ValuesIn(inputs));
 }  // namespace raft::neighbors
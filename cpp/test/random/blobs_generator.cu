@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/random/blobs_generator.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace raft {
+namespace random {
+
+struct BlobsGeneratorInputs {
+  int64_t n_rows;
+  int64_t n_cols, n_clusters;
+  int64_t batch_rows;
+  GeneratorType gtype;
+  uint64_t seed;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const BlobsGeneratorInputs& p)
+{
+  os << "{" << p.n_rows << ", " << p.n_cols << ", " << p.n_clusters << ", " << p.batch_rows
+     << ", " << int(p.gtype) << "}";
+  return os;
+}
+
+template <typename T>
+class BlobsGeneratorTest : public ::testing::TestWithParam<BlobsGeneratorInputs> {
+ public:
+  BlobsGeneratorTest()
+    : params(::testing::TestWithParam<BlobsGeneratorInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle)),
+      gen(handle, params.n_cols, params.n_clusters, T(1), T(-10), T(10), params.seed, params.gtype)
+  {
+  }
+
+ protected:
+  /** The whole dataset in one block, on the host. */
+  void generate_all(std::vector<T>& data, std::vector<int64_t>& labels)
+  {
+    auto d_data   = raft::make_device_matrix<T, int64_t>(handle, params.n_rows, params.n_cols);
+    auto d_labels = raft::make_device_vector<int64_t, int64_t>(handle, params.n_rows);
+    gen.generate(handle, 0, d_data.view(), std::make_optional(d_labels.view()));
+    data.resize(d_data.size());
+    labels.resize(d_labels.size());
+    raft::update_host(data.data(), d_data.data_handle(), data.size(), stream);
+    raft::update_host(labels.data(), d_labels.data_handle(), labels.size(), stream);
+    resource::sync_stream(handle, stream);
+  }
+
+  /** The blocks of rows are the same as the rows of the whole dataset. */
+  void testBlocks()
+  {
+    std::vector<T> data;
+    std::vector<int64_t> labels;
+    generate_all(data, labels);
+    auto d_block  = raft::make_device_matrix<T, int64_t>(handle, params.batch_rows, params.n_cols);
+    auto d_labels = raft::make_device_vector<int64_t, int64_t>(handle, params.batch_rows);
+    // in the reverse order, to make sure that the blocks do not depend on each other
+    int64_t n_blocks = raft::ceildiv<int64_t>(params.n_rows, params.batch_rows);
+    for (int64_t b = n_blocks - 1; b >= 0; b--) {
+      int64_t row0 = b * params.batch_rows;
+      int64_t rows = std::min(params.batch_rows, params.n_rows - row0);
+      gen.generate(handle,
+                   row0,
+                   raft::make_device_matrix_view<T, int64_t>(
+                     d_block.data_handle(), rows, params.n_cols),
+                   std::make_optional(raft::make_device_vector_view<int64_t, int64_t>(
+                     d_labels.data_handle(), rows)));
+      ASSERT_TRUE(raft::devArrMatchHost(data.data() + row0 * params.n_cols,
+                                        d_block.data_handle(),
+                                        rows * params.n_cols,
+                                        raft::Compare<T>(),
+                                        stream));
+      ASSERT_TRUE(raft::devArrMatchHost(
+        labels.data() + row0, d_labels.data_handle(), rows, raft::Compare<int64_t>(), stream));
+    }
+  }
+
+  /** The rows are normally distributed around the centers of their clusters. */
+  void testDistribution()
+  {
+    std::vector<T> data;
+    std::vector<int64_t> labels;
+    generate_all(data, labels);
+    std::vector<T> centers(params.n_clusters * params.n_cols);
+    raft::update_host(centers.data(), gen.centers().data_handle(), centers.size(), stream);
+    resource::sync_stream(handle, stream);
+
+    std::vector<double> sum(centers.size(), 0), sq_sum(centers.size(), 0);
+    std::vector<int64_t> count(params.n_clusters, 0);
+    for (int64_t i = 0; i < params.n_rows; i++) {
+      ASSERT_TRUE(labels[i] >= 0 && labels[i] < params.n_clusters);
+      count[labels[i]]++;
+      for (int64_t j = 0; j < params.n_cols; j++) {
+        double x = data[i * params.n_cols + j] - centers[labels[i] * params.n_cols + j];
+        sum[labels[i] * params.n_cols + j] += x;
+        sq_sum[labels[i] * params.n_cols + j] += x * x;
+      }
+    }
+    for (int64_t c = 0; c < params.n_clusters; c++) {
+      // the labels are spread evenly
+      ASSERT_LE(std::abs(count[c] - params.n_rows / params.n_clusters), 1);
+      for (int64_t j = 0; j < params.n_cols; j++) {
+        double mean = sum[c * params.n_cols + j] / count[c];
+        double var  = sq_sum[c * params.n_cols + j] / count[c] - mean * mean;
+        // 5 standard deviations of the estimators
+        ASSERT_LT(std::abs(mean), 5.0 / std::sqrt(count[c])) << "cluster " << c << ", column " << j;
+        ASSERT_LT(std::abs(var - 1.0), 5.0 * std::sqrt(2.0 / count[c]))
+          << "cluster " << c << ", column " << j;
+      }
+    }
+  }
+
+  /** The file holds the same rows as the device generation. */
+  void testFile()
+  {
+    std::vector<T> data;
+    std::vector<int64_t> labels;
+    generate_all(data, labels);
+    std::string path = ::testing::TempDir() + "raft_blobs_generator_test.bin";
+    make_blobs_file(handle, gen, path, params.n_rows, params.batch_rows);
+
+    std::FILE* fp = std::fopen(path.c_str(), "rb");
+    ASSERT_NE(fp, nullptr);
+    uint32_t header[2];
+    std::vector<T> file_data(data.size());
+    ASSERT_EQ(std::fread(header, sizeof(uint32_t), 2, fp), 2u);
+    ASSERT_EQ(std::fread(file_data.data(), sizeof(T), file_data.size(), fp), file_data.size());
+    ASSERT_EQ(std::fgetc(fp), EOF);
+    std::fclose(fp);
+    std::remove(path.c_str());
+    ASSERT_EQ(header[0], uint32_t(params.n_rows));
+    ASSERT_EQ(header[1], uint32_t(params.n_cols));
+    for (size_t e = 0; e < data.size(); e++) {
+      ASSERT_EQ(file_data[e], data[e]) << "element " << e;
+    }
+  }
+
+  raft::resources handle;
+  BlobsGeneratorInputs params;
+  cudaStream_t stream = 0;
+  blobs_generator<T, int64_t> gen;
+};
+
+const std::vector<BlobsGeneratorInputs> inputs = {{20000, 10, 5, 1000, GenPC, 1234ULL},
+                                                  {20000, 7, 3, 777, GenPhilox, 1234ULL},
+                                                  {10001, 33, 10, 10001, GenPC, 42ULL},
+                                                  {5000, 1, 2, 37, GenPhilox, 42ULL}};
+
+typedef BlobsGeneratorTest<float> BlobsGeneratorTestF;
+TEST_P(BlobsGeneratorTestF, Blocks) { testBlocks(); }
+TEST_P(BlobsGeneratorTestF, Distribution) { testDistribution(); }
+TEST_P(BlobsGeneratorTestF, File) { testFile(); }
+INSTANTIATE_TEST_CASE_P(BlobsGeneratorTests, BlobsGeneratorTestF, ::testing::ValuesIn(inputs));
+
+typedef BlobsGeneratorTest<double> BlobsGeneratorTestD;
+TEST_P(BlobsGeneratorTestD, Blocks) { testBlocks(); }
+TEST_P(BlobsGeneratorTestD, Distribution) { testDistribution(); }
+TEST_P(BlobsGeneratorTestD, File) { testFile(); }
+INSTANTIATE_TEST_CASE_P(BlobsGeneratorTests, BlobsGeneratorTestD, ::testing::ValuesIn(inputs));
+
+}  // end namespace random
+}  // end namespace raft
@@ -15,6 +15,7 @@
  */
 
 #include "../test_utils.cuh"
+#include <algorithm>
 #include <cmath>
 #include <gtest/gtest.h>
 #include <iostream>
@@ -501,4 +502,133 @@ INSTANTIATE_TEST_CASE_P(MVGTests, MVGTestD, ::testing::ValuesIn(inputsd));
 INSTANTIATE_TEST_CASE_P(MVGMdspanTests, MVGMdspanTestF, ::testing::ValuesIn(inputsf));
 INSTANTIATE_TEST_CASE_P(MVGMdspanTests, MVGMdspanTestD, ::testing::ValuesIn(inputsd));
 
+struct BatchedMVGInputs {
+  multi_variable_gaussian_decomposition_method method;
+  int batch_size, dim, n_points;
+  // the covariances of rank dim / 2 (positive semi-definite)
+  bool singular;
+  unsigned long long int seed;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const BatchedMVGInputs& p)
+{
+  os << "{method " << int(p.method) << ", batch " << p.batch_size << ", dim " << p.dim
+     << ", singular " << p.singular << "}";
+  return os;
+}
+
+template <typename T>
+class BatchedMVGTest : public ::testing::TestWithParam<BatchedMVGInputs> {
+ public:
+  BatchedMVGTest()
+    : params(::testing::TestWithParam<BatchedMVGInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  /** The sample means and covariances match those of every distribution. */
+  void Run()
+  {
+    int b = params.batch_size, d = params.dim, n = params.n_points;
+    int rank = params.singular ? std::max(1, d / 2) : d;
+    std::mt19937 gen(params.seed);
+    std::uniform_real_distribution<double> unif(-1, 1);
+    // the covariances M M^T / rank (+ I), and the means
+    std::vector<double> cov(size_t(b) * d * d), mean(size_t(b) * d);
+    for (int p = 0; p < b; p++) {
+      std::vector<double> m(size_t(d) * rank);
+      for (auto& e : m) {
+        e = unif(gen);
+      }
+      for (int i = 0; i < d; i++) {
+        mean[size_t(p) * d + i] = 4 * unif(gen);
+        for (int j = 0; j < d; j++) {
+          double acc = params.singular || i != j ? 0 : 1;
+          for (int l = 0; l < rank; l++) {
+            acc += m[i * rank + l] * m[j * rank + l] / rank;
+          }
+          cov[(size_t(p) * d + i) * d + j] = acc;
+        }
+      }
+    }
+    std::vector<T> h_cov(cov.begin(), cov.end()), h_mean(mean.begin(), mean.end());
+    rmm::device_uvector<T> d_cov(h_cov.size(), stream), d_mean(h_mean.size(), stream),
+      d_x(size_t(b) * n * d, stream);
+    rmm::device_uvector<int> d_info(b, stream);
+    raft::update_device(d_cov.data(), h_cov.data(), h_cov.size(), stream);
+    raft::update_device(d_mean.data(), h_mean.data(), h_mean.size(), stream);
+
+    RngState rng(params.seed);
+    auto mean_view = raft::make_device_matrix_view<const T, int>(d_mean.data(), b, d);
+    auto cov_view  = raft::make_mdspan<T, int, raft::row_major, false, true>(
+      d_cov.data(), raft::make_extents<int>(b, d, d));
+    auto x_view    = raft::make_mdspan<T, int, raft::row_major, false, true>(
+      d_x.data(), raft::make_extents<int>(b, n, d));
+    auto info_view = raft::make_device_vector_view<int, int>(d_info.data(), b);
+    batched_multi_variable_gaussian(handle,
+                                    rng,
+                                    std::make_optional(mean_view),
+                                    cov_view,
+                                    x_view,
+                                    params.method,
+                                    std::make_optional(info_view));
+
+    std::vector<T> h_x(d_x.size());
+    std::vector<int> h_info(b);
+    raft::update_host(h_x.data(), d_x.data(), h_x.size(), stream);
+    raft::update_host(h_info.data(), d_info.data(), b, stream);
+    resource::sync_stream(handle, stream);
+    for (int p = 0; p < b; p++) {
+      ASSERT_EQ(h_info[p], 0) << "problem " << p;
+      const T* xp = h_x.data() + size_t(p) * n * d;
+      std::vector<double> mu(d, 0);
+      for (int q = 0; q < n; q++) {
+        for (int i = 0; i < d; i++) {
+          mu[i] += xp[size_t(q) * d + i] / n;
+        }
+      }
+      for (int i = 0; i < d; i++) {
+        double sd = std::sqrt(cov[(size_t(p) * d + i) * d + i]);
+        ASSERT_NEAR(mean[size_t(p) * d + i], mu[i], 5 * sd / std::sqrt(n) + 1e-4)
+          << "problem " << p << ", mean " << i;
+      }
+      for (int i = 0; i < d; i++) {
+        for (int j = 0; j <= i; j++) {
+          double acc = 0;
+          for (int q = 0; q < n; q++) {
+            acc += (xp[size_t(q) * d + i] - mu[i]) * (xp[size_t(q) * d + j] - mu[j]);
+          }
+          double expected = cov[(size_t(p) * d + i) * d + j];
+          double scale    = std::sqrt(cov[(size_t(p) * d + i) * d + i] *
+                                   cov[(size_t(p) * d + j) * d + j]);
+          ASSERT_NEAR(expected, acc / (n - 1), 6 * scale * std::sqrt(2.0 / n) + 1e-4)
+            << "problem " << p << ", covariance (" << i << ", " << j << ")";
+        }
+      }
+    }
+  }
+
+  raft::resources handle;
+  BatchedMVGInputs params;
+  cudaStream_t stream = 0;
+};
+
+// small dimensions (the factors staged in the shared memory, with one or many tiles of points
+// per block) and a few points of larger ones
+const std::vector<BatchedMVGInputs> batched_inputs = {
+  {multi_variable_gaussian_decomposition_method::CHOLESKY, 40, 8, 20000, false, 1234ULL},
+  {multi_variable_gaussian_decomposition_method::CHOLESKY, 4, 64, 20000, false, 1234ULL},
+  {multi_variable_gaussian_decomposition_method::JACOBI, 40, 7, 20000, false, 1234ULL},
+  {multi_variable_gaussian_decomposition_method::JACOBI, 12, 24, 20000, true, 1234ULL},
+  {multi_variable_gaussian_decomposition_method::QR, 3, 100, 5000, false, 1234ULL}};
+
+using BatchedMVGTestF = BatchedMVGTest<float>;
+TEST_P(BatchedMVGTestF, MeanAndCovAreCorrect) { Run(); }
+INSTANTIATE_TEST_CASE_P(BatchedMVGTests, BatchedMVGTestF, ::testing::ValuesIn(batched_inputs));
+
+using BatchedMVGTestD = BatchedMVGTest<double>;
+TEST_P(BatchedMVGTestD, MeanAndCovAreCorrect) { Run(); }
+INSTANTIATE_TEST_CASE_P(BatchedMVGTests, BatchedMVGTestD, ::testing::ValuesIn(batched_inputs));
+
 };  // end of namespace raft::random
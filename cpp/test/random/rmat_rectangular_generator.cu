@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2022-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2022-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -18,6 +18,10 @@
 #include <gtest/gtest.h>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <sys/timeb.h>
+
+#include <algorithm>
+#include <set>
+#include <utility>
 #include <vector>
 
 #include "../test_utils.cuh"
@@ -398,5 +402,119 @@ INSTANTIATE_TEST_SUITE_P(RmatGenTests, RmatGenTest, ::testing::ValuesIn(inputs))
 TEST_P(RmatGenMdspanTest, Result) { validate(); }
 INSTANTIATE_TEST_SUITE_P(RmatGenMdspanTests, RmatGenMdspanTest, ::testing::ValuesIn(inputs));
 
+struct RmatStreamInputs {
+  int r_scale, c_scale, n_edges, chunk_size, n_ranks;
+  uint64_t seed;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const RmatStreamInputs& p)
+{
+  os << "{" << p.r_scale << ", " << p.c_scale << ", " << p.n_edges << ", chunk " << p.chunk_size
+     << ", ranks " << p.n_ranks << "}";
+  return os;
+}
+
+/**
+ * The chunks of the stream give the edges of the one-shot generator, and the row blocks of the
+ * ranks, deduplicated, the CSR structure of the simple graph.
+ */
+class RmatStreamTest : public ::testing::TestWithParam<RmatStreamInputs> {
+ public:
+  RmatStreamTest()
+    : params(::testing::TestWithParam<RmatStreamInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    const float a = 0.57f, b = 0.19f, c = 0.19f;
+    int n         = params.n_edges;
+    RngState state(params.seed);
+    rmm::device_uvector<int> d_src(n, stream), d_dst(n, stream);
+    RngState one_shot = state;
+    rmat_rectangular_gen(handle,
+                         one_shot,
+                         raft::make_device_vector_view(d_src.data(), n),
+                         raft::make_device_vector_view(d_dst.data(), n),
+                         a,
+                         b,
+                         c,
+                         params.r_scale,
+                         params.c_scale);
+    std::vector<int> h_src(n), h_dst(n);
+    raft::update_host(h_src.data(), d_src.data(), n, stream);
+    raft::update_host(h_dst.data(), d_dst.data(), n, stream);
+    resource::sync_stream(handle, stream);
+
+    rmat_stream_params stream_params;
+    stream_params.edge_end   = n;
+    stream_params.chunk_size = params.chunk_size;
+    std::vector<int> s_src, s_dst;
+    auto collect = [&](auto src, auto dst) {
+      size_t offset = s_src.size();
+      s_src.resize(offset + src.extent(0));
+      s_dst.resize(offset + dst.extent(0));
+      raft::update_host(s_src.data() + offset, src.data_handle(), src.extent(0), stream);
+      raft::update_host(s_dst.data() + offset, dst.data_handle(), dst.extent(0), stream);
+      resource::sync_stream(handle, stream);
+    };
+    rmat_rectangular_gen_stream(
+      handle, state, a, b, c, params.r_scale, params.c_scale, stream_params, collect);
+    ASSERT_EQ(h_src, s_src);
+    ASSERT_EQ(h_dst, s_dst);
+
+    std::set<std::pair<int, int>> edges;
+    for (int i = 0; i < n; i++) {
+      edges.emplace(h_src[i], h_dst[i]);
+    }
+    int n_rows                = 1 << params.r_scale;
+    stream_params.deduplicate = true;
+    size_t n_unique           = 0;
+    for (int rank = 0; rank < params.n_ranks; rank++) {
+      stream_params.row_begin = uint64_t(n_rows) * rank / params.n_ranks;
+      stream_params.row_end   = uint64_t(n_rows) * (rank + 1) / params.n_ranks;
+
+      auto csr       = rmat_rectangular_gen_csr(
+        handle, state, a, b, c, params.r_scale, params.c_scale, stream_params);
+      auto structure = csr.view();
+      int n_local    = structure.get_n_rows();
+      int nnz        = structure.get_nnz();
+      std::vector<int> indptr(n_local + 1), indices(nnz);
+      raft::update_host(indptr.data(), structure.get_indptr().data(), n_local + 1, stream);
+      raft::update_host(indices.data(), structure.get_indices().data(), nnz, stream);
+      resource::sync_stream(handle, stream);
+      ASSERT_EQ(n_local, int(stream_params.row_end - stream_params.row_begin));
+      ASSERT_EQ(indptr[n_local], nnz);
+      std::vector<std::pair<int, int>> expected, actual;
+      for (auto [s, d] : edges) {
+        if (s >= int(stream_params.row_begin) && s < int(stream_params.row_end)) {
+          expected.emplace_back(s, d);
+        }
+      }
+      for (int i = 0; i < n_local; i++) {
+        for (int e = indptr[i]; e < indptr[i + 1]; e++) {
+          actual.emplace_back(int(stream_params.row_begin) + i, indices[e]);
+        }
+      }
+      ASSERT_EQ(expected, actual) << "rank " << rank;
+      n_unique += nnz;
+    }
+    ASSERT_EQ(edges.size(), n_unique);
+  }
+
+  raft::resources handle;
+  RmatStreamInputs params;
+  cudaStream_t stream = 0;
+};
+
+const std::vector<RmatStreamInputs> stream_inputs = {{10, 10, 100000, 7919, 1, 123456ULL},
+                                                     {12, 9, 100000, 1 << 14, 3, 123456ULL},
+                                                     {9, 12, 50000, 100000, 4, 456789ULL}};
+
+TEST_P(RmatStreamTest, Result) { Run(); }
+INSTANTIATE_TEST_SUITE_P(RmatStreamTests, RmatStreamTest, ::testing::ValuesIn(stream_inputs));
+
 }  // namespace random
 }  // namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -29,6 +29,10 @@
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
 
+#include <rmm/device_uvector.hpp>
+
+#include <vector>
+
 namespace raft {
 namespace random {
 
@@ -799,5 +803,70 @@ const std::vector<RngAffineInputs> inputs_affine = {
 TEST_P(RngAffineTest, Result) { check(); }
 INSTANTIATE_TEST_SUITE_P(RngAffineTests, RngAffineTest, ::testing::ValuesIn(inputs_affine));
 
+/** Rng tests of unaligned outputs and of lengths which are not multiples of the vector length */
+struct RngUnalignedInputs {
+  int offset, len;
+  GeneratorType gtype;
+  unsigned long long seed;
+};
+
+template <typename T>
+class RngUnalignedTest : public ::testing::TestWithParam<RngUnalignedInputs> {
+ protected:
+  void check()
+  {
+    auto params = ::testing::TestWithParam<RngUnalignedInputs>::GetParam();
+    auto stream = resource::get_cuda_stream(handle);
+    int n       = params.offset + params.len + 16;
+    rmm::device_uvector<T> data(n, stream);
+    RngState r(params.seed, params.gtype);
+    T sentinel = T(10);
+    for (int dist = 0; dist < 2; dist++) {
+      std::vector<T> h_data(n, sentinel);
+      update_device(data.data(), h_data.data(), n, stream);
+      // uniform: one output per call, normal: two
+      if (dist == 0) {
+        uniform(handle, r, data.data() + params.offset, params.len, T(-1), T(1));
+      } else {
+        normal(handle, r, data.data() + params.offset, params.len, T(0), T(0.1));
+      }
+      update_host(h_data.data(), data.data(), n, stream);
+      resource::sync_stream(handle, stream);
+      for (int i = 0; i < n; i++) {
+        bool inside = i >= params.offset && i < params.offset + params.len;
+        if (inside) {
+          ASSERT_TRUE(h_data[i] > T(-2) && h_data[i] < T(2)) << "dist " << dist << ", i " << i;
+        } else {
+          ASSERT_EQ(h_data[i], sentinel) << "dist " << dist << ", i " << i;
+        }
+      }
+    }
+  }
+
+  raft::resources handle;
+};
+
+const std::vector<RngUnalignedInputs> inputs_unaligned = {
+  {0, 1, GenPhilox, 1234ULL},
+  {1, 2, GenPhilox, 1234ULL},
+  {0, 4096, GenPhilox, 1234ULL},
+  {1, 4095, GenPhilox, 1234ULL},
+  {3, 100003, GenPhilox, 1234ULL},
+  {2, 333333, GenPC, 1234ULL},
+  {1, 7, GenPC, 1234ULL},
+};
+
+using RngUnalignedTestF = RngUnalignedTest<float>;
+TEST_P(RngUnalignedTestF, Result) { check(); }
+INSTANTIATE_TEST_SUITE_P(RngUnalignedTests,
+                         RngUnalignedTestF,
+                         ::testing::ValuesIn(inputs_unaligned));
+
+using RngUnalignedTestD = RngUnalignedTest<double>;
+TEST_P(RngUnalignedTestD, Result) { check(); }
+INSTANTIATE_TEST_SUITE_P(RngUnalignedTests,
+                         RngUnalignedTestD,
+                         ::testing::ValuesIn(inputs_unaligned));
+
 }  // namespace random
 }  // namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -16,12 +16,14 @@
 
 #include "../test_utils.cuh"
 #include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 #include <raft/core/resources.hpp>
 #include <raft/random/rng.cuh>
 #include <raft/random/sample_without_replacement.cuh>
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
+#include <cmath>
 #include <set>
 #include <vector>
 
@@ -279,5 +281,77 @@ using SWoRMdspanTestD = SWoRMdspanTest<double>;
 TEST_P(SWoRMdspanTestD, Result) { _RAFT_SWOR_TEST_CONTENTS(); }
 INSTANTIATE_TEST_SUITE_P(SWoRTests2, SWoRMdspanTestD, ::testing::ValuesIn(inputsd));
 
+struct SampleIndicesInputs {
+  int64_t n_population, n_samples;
+  int n_trials;
+  GeneratorType gtype;
+  unsigned long long int seed;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const SampleIndicesInputs& p)
+{
+  os << "{" << p.n_population << ", " << p.n_samples << ", " << p.n_trials << "}";
+  return os;
+}
+
+/**
+ * The samples are distinct, in increasing order and, over the trials, every index is drawn about
+ * n_trials * n_samples / n_population times.
+ */
+class SampleIndicesTest : public ::testing::TestWithParam<SampleIndicesInputs> {
+ public:
+  SampleIndicesTest()
+    : params(::testing::TestWithParam<SampleIndicesInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    RngState r(params.seed, params.gtype);
+    auto d_out = raft::make_device_vector<int64_t, int64_t>(handle, params.n_samples);
+    std::vector<int64_t> h_out(params.n_samples);
+    std::vector<int64_t> counts(params.n_population, 0);
+    for (int t = 0; t < params.n_trials; t++) {
+      sample_indices_without_replacement(handle, r, d_out.view(), params.n_population);
+      raft::update_host(h_out.data(), d_out.data_handle(), params.n_samples, stream);
+      resource::sync_stream(handle, stream);
+      for (int64_t i = 0; i < params.n_samples; i++) {
+        ASSERT_TRUE(h_out[i] >= 0 && h_out[i] < params.n_population) << "sample " << i;
+        if (i > 0) { ASSERT_LT(h_out[i - 1], h_out[i]) << "sample " << i; }
+        counts[h_out[i]]++;
+      }
+    }
+    if (params.n_trials == 1) { return; }
+    double p        = double(params.n_samples) / params.n_population;
+    double expected = params.n_trials * p;
+    double sd       = std::sqrt(params.n_trials * p * (1 - p));
+    for (int64_t j = 0; j < params.n_population; j++) {
+      ASSERT_LT(std::abs(counts[j] - expected), 5 * sd + 1) << "index " << j;
+    }
+  }
+
+  raft::resources handle;
+  SampleIndicesInputs params;
+  cudaStream_t stream = 0;
+};
+
+// the excess sampling (few samples), the shuffle of the population (many samples), and large
+// populations
+const std::vector<SampleIndicesInputs> sample_indices_inputs = {
+  {40, 5, 2000, GenPC, 1234ULL},
+  {40, 30, 2000, GenPhilox, 1234ULL},
+  {1000, 1000, 10, GenPC, 1234ULL},
+  {1000, 1, 2000, GenPC, 42ULL},
+  {1000000000, 1000000, 1, GenPC, 1234ULL},
+  {1000000000, 0, 1, GenPhilox, 1234ULL},
+  {3000000, 1500000, 1, GenPhilox, 42ULL}};
+
+TEST_P(SampleIndicesTest, Result) { Run(); }
+INSTANTIATE_TEST_SUITE_P(SampleIndicesTests,
+                         SampleIndicesTest,
+                         ::testing::ValuesIn(sample_indices_inputs));
+
 }  // namespace random
 }  // namespace raft
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/sparse/solver/lanczos.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace raft {
+namespace sparse {
+
+template <typename T>
+struct BlockLanczosInputs {
+  T tolerance;
+  // 0: the 1D Laplacian (simple eigenvalues), 1: a diagonal matrix with every eigenvalue twice
+  int kind;
+  int n, n_components, block_size, ncv;
+  raft::sparse::solver::lanczos_which which;
+  unsigned long long seed;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const BlockLanczosInputs<T>& p)
+{
+  os << "{kind " << p.kind << ", n " << p.n << ", k " << p.n_components << ", block "
+     << p.block_size << ", ncv " << p.ncv << ", largest "
+     << (p.which == raft::sparse::solver::lanczos_which::LARGEST) << "}";
+  return os;
+}
+
+template <typename T>
+class BlockLanczosTest : public ::testing::TestWithParam<BlockLanczosInputs<T>> {
+ public:
+  BlockLanczosTest()
+    : params(::testing::TestWithParam<BlockLanczosInputs<T>>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    int n = params.n, k = params.n_components;
+    // the matrix (host CSR) and its spectrum, ascending
+    std::vector<int> indptr(1, 0), indices;
+    std::vector<T> values;
+    std::vector<double> spectrum(n);
+    for (int i = 0; i < n; i++) {
+      if (params.kind == 0) {
+        for (int j = std::max(i - 1, 0); j <= std::min(i + 1, n - 1); j++) {
+          indices.push_back(j);
+          values.push_back(i == j ? T(2) : T(-1));
+        }
+        spectrum[i] = 2 - 2 * std::cos(M_PI * (i + 1) / (n + 1));
+      } else {
+        // the eigenvalues 1, 1, 2, 2, ... in a scrambled order
+        int j = int((size_t(i) * 7919) % n);
+        indices.push_back(i);
+        values.push_back(T(j / 2 + 1));
+        spectrum[i] = i / 2 + 1;
+      }
+      indptr.push_back(int(indices.size()));
+    }
+    int nnz = int(values.size());
+
+    rmm::device_uvector<int> d_indptr(n + 1, stream);
+    rmm::device_uvector<int> d_indices(nnz, stream);
+    rmm::device_uvector<T> d_values(nnz, stream);
+    raft::update_device(d_indptr.data(), indptr.data(), n + 1, stream);
+    raft::update_device(d_indices.data(), indices.data(), nnz, stream);
+    raft::update_device(d_values.data(), values.data(), nnz, stream);
+    auto structure = raft::make_device_compressed_structure_view<int, int, int>(
+      d_indptr.data(), d_indices.data(), n, n, nnz);
+    auto A = raft::make_device_csr_matrix_view<const T, int, int, int>(d_values.data(), structure);
+
+    raft::sparse::solver::block_lanczos_config<T> config{k};
+    config.block_size   = params.block_size;
+    config.ncv          = params.ncv;
+    config.max_restarts = 500;
+    config.tolerance    = params.tolerance;
+    config.which        = params.which;
+    config.seed         = params.seed;
+    auto eigenvalues    = raft::make_device_vector<T, int>(handle, k);
+    auto eigenvectors   = raft::make_device_matrix<T, int, raft::col_major>(handle, n, k);
+    auto result         = raft::sparse::solver::block_lanczos(
+      handle, config, A, eigenvalues.view(), eigenvectors.view());
+    ASSERT_TRUE(result.converged) << result.n_restarts << " restarts";
+
+    std::vector<T> h_vals(k), h_vecs(size_t(n) * k);
+    raft::update_host(h_vals.data(), eigenvalues.data_handle(), k, stream);
+    raft::update_host(h_vecs.data(), eigenvectors.data_handle(), h_vecs.size(), stream);
+    resource::sync_stream(handle, stream);
+
+    bool largest  = params.which == raft::sparse::solver::lanczos_which::LARGEST;
+    double a_norm = std::max(std::abs(spectrum.front()), std::abs(spectrum.back()));
+    for (int c = 0; c < k; c++) {
+      double expected = largest ? spectrum[n - 1 - c] : spectrum[c];
+      ASSERT_NEAR(expected, h_vals[c], 10 * params.tolerance * a_norm) << "eigenvalue " << c;
+      // the residual ||A x - lambda x|| of a unit x
+      double res = 0, norm = 0;
+      for (int i = 0; i < n; i++) {
+        double ax = 0;
+        for (int e = indptr[i]; e < indptr[i + 1]; e++) {
+          ax += double(values[e]) * h_vecs[size_t(c) * n + indices[e]];
+        }
+        double x = h_vecs[size_t(c) * n + i];
+        res += (ax - h_vals[c] * x) * (ax - h_vals[c] * x);
+        norm += x * x;
+      }
+      ASSERT_NEAR(1.0, norm, 10 * params.tolerance) << "eigenvector " << c;
+      ASSERT_LT(std::sqrt(res), 10 * params.tolerance * a_norm) << "eigenvector " << c;
+    }
+  }
+
+  raft::resources handle;
+  BlockLanczosInputs<T> params;
+  cudaStream_t stream = 0;
+};
+
+using raft::sparse::solver::lanczos_which;
+
+// simple and double eigenvalues, at both ends, with blocks of one vector and more, restarting or
+// not (ncv of the default)
+const std::vector<BlockLanczosInputs<float>> inputsf = {
+  {1e-4f, 0, 200, 4, 4, 32, lanczos_which::LARGEST, 1234ULL},
+  {1e-4f, 1, 300, 6, 2, 24, lanczos_which::SMALLEST, 1234ULL},
+  {1e-4f, 1, 300, 6, 3, 0, lanczos_which::LARGEST, 1234ULL}};
+const std::vector<BlockLanczosInputs<double>> inputsd = {
+  {1e-8, 0, 200, 4, 1, 24, lanczos_which::LARGEST, 1234ULL},
+  {1e-8, 0, 100, 3, 4, 40, lanczos_which::SMALLEST, 1234ULL},
+  {1e-8, 1, 300, 8, 4, 32, lanczos_which::SMALLEST, 1234ULL}};
+
+typedef BlockLanczosTest<float> BlockLanczosTestF;
+TEST_P(BlockLanczosTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(BlockLanczosTests, BlockLanczosTestF, ::testing::ValuesIn(inputsf));
+
+typedef BlockLanczosTest<double> BlockLanczosTestD;
+TEST_P(BlockLanczosTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(BlockLanczosTests, BlockLanczosTestD, ::testing::ValuesIn(inputsd));
+
+}  // end namespace sparse
+}  // end namespace raft
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/sparse/solver/lanczos.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace raft::sparse::solver {
+
+template <typename T>
+struct BlockLanczosDistributedInputs {
+  T tolerance;
+  int n_ranks;
+  int n, nnz_per_row, n_components, block_size, ncv;
+  lanczos_which which;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const BlockLanczosDistributedInputs<T>& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", n " << p.n << ", nnz_per_row " << p.nnz_per_row << ", k "
+     << p.n_components << ", block " << p.block_size << ", ncv " << p.ncv << ", largest "
+     << (p.which == lanczos_which::LARGEST) << "}";
+  return os;
+}
+
+/**
+ * A symmetric matrix with the distinct diagonal 1, ..., n (scrambled) and small random
+ * off-diagonal entries anywhere (so that every rank has a halo, and the eigenvalues stay apart)
+ * is split by contiguous blocks of rows across the ranks of an in-process clique. The ranks
+ * should get the same eigenvalues, and together the eigenpairs of single-GPU `block_lanczos` on
+ * the whole matrix (the eigenvectors up to their signs).
+ */
+template <typename T>
+class BlockLanczosDistributedTest
+  : public ::testing::TestWithParam<BlockLanczosDistributedInputs<T>> {
+ protected:
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<BlockLanczosDistributedInputs<T>>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    int n = p.n, k = p.n_components;
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<double> uniform(-0.05, 0.05);
+    std::uniform_int_distribution<int> column(0, n - 1);
+    std::vector<std::map<int, T>> rows(n);
+    for (int i = 0; i < n; i++) {
+      rows[i][i] = T((size_t(i) * 7919) % n + 1);
+    }
+    for (int i = 0; i < n; i++) {
+      for (int e = 0; e < p.nnz_per_row; e++) {
+        int j = column(gen);
+        if (j == i) { continue; }
+        T v        = uniform(gen);
+        rows[i][j] = v;
+        rows[j][i] = v;
+      }
+    }
+    std::vector<int> indptr(1, 0), indices;
+    std::vector<T> values;
+    for (int i = 0; i < n; i++) {
+      for (auto [j, v] : rows[i]) {
+        indices.push_back(j);
+        values.push_back(v);
+      }
+      indptr.push_back(int(indices.size()));
+    }
+
+    block_lanczos_config<T> config{k};
+    config.block_size   = p.block_size;
+    config.ncv          = p.ncv;
+    config.max_restarts = 500;
+    config.tolerance    = p.tolerance;
+    config.which        = p.which;
+
+    // the rows [begin, end) of the matrix with the global column indices, and the solver (the
+    // distributed one with a communicator) on them
+    auto solve = [&](const raft::resources& handle,
+                     bool distributed,
+                     int begin,
+                     int end,
+                     std::vector<T>& h_vals,
+                     std::vector<T>& h_vecs) {
+      auto stream = resource::get_cuda_stream(handle);
+      int n_rows  = end - begin;
+      int first   = indptr[begin];
+      int nnz     = indptr[end] - first;
+      std::vector<int> local_indptr(n_rows + 1);
+      for (int i = 0; i <= n_rows; i++) {
+        local_indptr[i] = indptr[begin + i] - first;
+      }
+      rmm::device_uvector<int> d_indptr(n_rows + 1, stream);
+      rmm::device_uvector<int> d_indices(nnz, stream);
+      rmm::device_uvector<T> d_values(nnz, stream);
+      raft::update_device(d_indptr.data(), local_indptr.data(), n_rows + 1, stream);
+      raft::update_device(d_indices.data(), indices.data() + first, nnz, stream);
+      raft::update_device(d_values.data(), values.data() + first, nnz, stream);
+      auto structure = raft::make_device_compressed_structure_view<int, int, int>(
+        d_indptr.data(), d_indices.data(), n_rows, n, nnz);
+      auto A =
+        raft::make_device_csr_matrix_view<const T, int, int, int>(d_values.data(), structure);
+
+      auto eigenvalues  = raft::make_device_vector<T, int>(handle, k);
+      auto eigenvectors = raft::make_device_matrix<T, int, raft::col_major>(handle, n_rows, k);
+      auto result       =
+        distributed
+          ? block_lanczos_distributed(handle, config, A, eigenvalues.view(), eigenvectors.view())
+          : block_lanczos(handle, config, A, eigenvalues.view(), eigenvectors.view());
+      h_vals.resize(k);
+      h_vecs.resize(size_t(n_rows) * k);
+      raft::update_host(h_vals.data(), eigenvalues.data_handle(), k, stream);
+      raft::update_host(h_vecs.data(), eigenvectors.data_handle(), h_vecs.size(), stream);
+      resource::sync_stream(handle);
+      return result.converged;
+    };
+
+    // the reference: single-GPU block Lanczos on the whole matrix, on the first device
+    std::vector<T> expected_vals, expected_vecs;
+    {
+      raft::resources handle;
+      ASSERT_TRUE(solve(handle, false, 0, n, expected_vals, expected_vecs));
+    }
+
+    nccl_clique clique(p.n_ranks);
+    std::vector<std::vector<T>> actual_vals(p.n_ranks);
+    std::vector<std::vector<T>> actual_vecs(p.n_ranks);
+    std::vector<int> begins(p.n_ranks + 1);
+    std::vector<char> converged(p.n_ranks);
+    for (int rank = 0; rank <= p.n_ranks; rank++) {
+      begins[rank] = int(int64_t(n) * rank / p.n_ranks);
+    }
+    clique.run([&](int rank, const raft::resources& handle) {
+      converged[rank] =
+        solve(handle, true, begins[rank], begins[rank + 1], actual_vals[rank], actual_vecs[rank]);
+    });
+
+    for (int rank = 0; rank < p.n_ranks; rank++) {
+      ASSERT_TRUE(converged[rank]) << "rank " << rank;
+      // the ranks solve the same projected problem
+      ASSERT_TRUE(hostVecMatch(actual_vals[0], actual_vals[rank], raft::Compare<T>()))
+        << "rank " << rank;
+    }
+    double a_norm = n + 1;
+    for (int c = 0; c < k; c++) {
+      ASSERT_NEAR(expected_vals[c], actual_vals[0][c], 10 * p.tolerance * a_norm)
+        << "eigenvalue " << c;
+      // the eigenvalues are simple: the unit eigenvectors agree up to their signs
+      double dot = 0;
+      for (int rank = 0; rank < p.n_ranks; rank++) {
+        int n_rows = begins[rank + 1] - begins[rank];
+        for (int i = 0; i < n_rows; i++) {
+          dot += double(actual_vecs[rank][size_t(c) * n_rows + i]) *
+                 expected_vecs[size_t(c) * n + begins[rank] + i];
+        }
+      }
+      ASSERT_NEAR(1.0, std::abs(dot), 10 * p.tolerance * a_norm) << "eigenvector " << c;
+    }
+  }
+};
+
+// one rank and two, at both ends, with blocks of one vector and more, restarting or not (ncv of
+// the default)
+const std::vector<BlockLanczosDistributedInputs<float>> inputsf = {
+  {1e-4f, 1, 300, 4, 4, 4, 32, lanczos_which::LARGEST},
+  {1e-4f, 2, 300, 4, 4, 4, 32, lanczos_which::LARGEST},
+  {1e-4f, 2, 301, 2, 6, 2, 24, lanczos_which::SMALLEST},
+  {1e-4f, 2, 1000, 8, 6, 3, 0, lanczos_which::LARGEST}};
+const std::vector<BlockLanczosDistributedInputs<double>> inputsd = {
+  {1e-8, 1, 200, 4, 4, 1, 24, lanczos_which::SMALLEST},
+  {1e-8, 2, 200, 4, 4, 1, 24, lanczos_which::SMALLEST},
+  {1e-8, 2, 501, 6, 8, 4, 32, lanczos_which::LARGEST}};
+
+typedef BlockLanczosDistributedTest<float> BlockLanczosDistributedTestF;
+TEST_P(BlockLanczosDistributedTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(BlockLanczosDistributedTests,
+                        BlockLanczosDistributedTestF,
+                        ::testing::ValuesIn(inputsf));
+
+typedef BlockLanczosDistributedTest<double> BlockLanczosDistributedTestD;
+TEST_P(BlockLanczosDistributedTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(BlockLanczosDistributedTests,
+                        BlockLanczosDistributedTestD,
+                        ::testing::ValuesIn(inputsd));
+
+}  // namespace raft::sparse::solver
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -23,6 +23,9 @@
 #include <raft/sparse/coo.hpp>
 
 #include <iostream>
+#include <map>
+#include <random>
+#include <utility>
 
 namespace raft {
 namespace sparse {
@@ -217,5 +220,104 @@ INSTANTIATE_TEST_CASE_P(SparseConvertCSRTest,
                         CSRAdjGraphTestL,
                         ::testing::ValuesIn(csradjgraph_inputs_l));
 
+/********************* unsorted COO with duplicates to CSR *********************/
+
+struct COOToSortedCSRInputs {
+  int n_rows;
+  int n_cols;
+  int nnz;
+  unsigned long long int seed;
+};
+
+class COOToSortedCSRTest : public ::testing::TestWithParam<COOToSortedCSRInputs> {
+ public:
+  COOToSortedCSRTest()
+    : stream(resource::get_cuda_stream(handle)),
+      params(::testing::TestWithParam<COOToSortedCSRInputs>::GetParam()),
+      rows(params.nnz, stream),
+      cols(params.nnz, stream),
+      vals(params.nnz, stream)
+  {
+  }
+
+ protected:
+  void SetUp() override
+  {
+    // few distinct values and a narrow range of positions: many duplicates, some cancelling out
+    std::mt19937 gen(params.seed);
+    std::uniform_int_distribution<int> row_dis(0, params.n_rows - 1);
+    std::uniform_int_distribution<int> col_dis(0, params.n_cols - 1);
+    std::uniform_int_distribution<int> val_dis(-2, 2);
+    std::vector<int> rows_h(params.nnz), cols_h(params.nnz);
+    std::vector<float> vals_h(params.nnz);
+    for (int i = 0; i < params.nnz; i++) {
+      rows_h[i] = row_dis(gen);
+      cols_h[i] = col_dis(gen);
+      vals_h[i] = val_dis(gen);
+      expected[{rows_h[i], cols_h[i]}] += vals_h[i];
+    }
+    for (auto it = expected.begin(); it != expected.end();) {
+      it = it->second == 0.0f ? expected.erase(it) : std::next(it);
+    }
+    raft::update_device(rows.data(), rows_h.data(), params.nnz, stream);
+    raft::update_device(cols.data(), cols_h.data(), params.nnz, stream);
+    raft::update_device(vals.data(), vals_h.data(), params.nnz, stream);
+  }
+
+  void Run()
+  {
+    auto coo_structure = raft::make_device_coordinate_structure_view<int, int, int>(
+      rows.data(), cols.data(), params.n_rows, params.n_cols, params.nnz);
+    auto coo = raft::make_device_coo_matrix_view<float>(vals.data(), coo_structure);
+    auto csr =
+      raft::make_device_csr_matrix<float, int, int, int>(handle, params.n_rows, params.n_cols);
+    convert::coo_to_sorted_csr(handle, coo, csr);
+
+    auto structure = csr.structure_view();
+    int nnz        = structure.get_nnz();
+    ASSERT_EQ(nnz, int(expected.size()));
+    std::vector<int> indptr_h(params.n_rows + 1), indices_h(nnz);
+    std::vector<float> vals_h(nnz);
+    raft::update_host(indptr_h.data(), structure.get_indptr().data(), params.n_rows + 1, stream);
+    raft::update_host(indices_h.data(), structure.get_indices().data(), nnz, stream);
+    raft::update_host(vals_h.data(), csr.get_elements().data(), nnz, stream);
+    RAFT_CUDA_TRY(cudaStreamSynchronize(stream));
+
+    auto it = expected.begin();
+    ASSERT_EQ(indptr_h[0], 0);
+    for (int r = 0; r < params.n_rows; r++) {
+      for (int e = indptr_h[r]; e < indptr_h[r + 1]; e++, it++) {
+        ASSERT_EQ(r, it->first.first) << "at entry " << e;
+        ASSERT_EQ(indices_h[e], it->first.second) << "at entry " << e;
+        ASSERT_EQ(vals_h[e], it->second) << "at entry " << e;
+      }
+    }
+    ASSERT_EQ(indptr_h[params.n_rows], nnz);
+  }
+
+ protected:
+  raft::resources handle;
+  cudaStream_t stream;
+
+  COOToSortedCSRInputs params;
+  rmm::device_uvector<int> rows;
+  rmm::device_uvector<int> cols;
+  rmm::device_uvector<float> vals;
+  std::map<std::pair<int, int>, float> expected;
+};
+
+TEST_P(COOToSortedCSRTest, Result) { Run(); }
+
+const std::vector<COOToSortedCSRInputs> coo_to_sorted_csr_inputs = {
+  {10, 10, 50, 1234ULL},
+  {7, 300, 2000, 1234ULL},
+  {1000, 3, 5000, 42ULL},
+  {256, 256, 100, 42ULL},
+};
+
+INSTANTIATE_TEST_CASE_P(SparseConvertCSRTest,
+                        COOToSortedCSRTest,
+                        ::testing::ValuesIn(coo_to_sorted_csr_inputs));
+
 }  // namespace sparse
 }  // namespace raft
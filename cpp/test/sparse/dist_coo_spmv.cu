@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -56,6 +56,7 @@ struct InputConfiguration {
 
 using dense_smem_strategy_t = detail::dense_smem_strategy<int, float, 1024>;
 using hash_strategy_t       = detail::hash_strategy<int, float, 1024>;
+using merge_path_strategy_t = detail::merge_path_strategy<int, float, 1024>;
 
 template <typename value_idx, typename value_t, typename strategy_t>
 struct SparseDistanceCOOSPMVInputs {
@@ -98,6 +99,12 @@ class SparseDistanceCOOSPMVTest
     return strategy_t(dist_config);
   }
 
+  template <typename U, std::enable_if_t<std::is_same_v<U, merge_path_strategy_t>>* = nullptr>
+  U make_strategy()
+  {
+    return strategy_t(dist_config);
+  }
+
   template <typename reduce_f, typename accum_f, typename write_f>
   void compute_dist(reduce_f reduce_func, accum_f accum_func, write_f write_func, bool rev = true)
   {
@@ -140,7 +147,11 @@ class SparseDistanceCOOSPMVTest
   {
     switch (params.input_configuration.metric) {
       case raft::distance::DistanceType::InnerProduct:
-        compute_dist(raft::mul_op(), raft::add_op(), raft::atomic_add_op(), true);
+        // the merge path strategy computes only the intersections (no reverse pass)
+        compute_dist(raft::mul_op(),
+                     raft::add_op(),
+                     raft::atomic_add_op(),
+                     !std::is_same_v<strategy_t, merge_path_strategy_t>);
         break;
       case raft::distance::DistanceType::L2Unexpanded:
         compute_dist(raft::sqdiff_op(), raft::add_op(), raft::atomic_add_op());
@@ -250,6 +261,16 @@ class SparseDistanceCOOSPMVTest
   SparseDistanceCOOSPMVInputs<value_idx, value_t, strategy_t> params;
 };
 
+// one long row and a few short ones
+const InputConfiguration<int, float> input_inner_product_skewed = {
+  8,
+  {0, 8, 9, 10, 11},
+  {0, 1, 2, 3, 4, 5, 6, 7, 0, 3, 7},
+  {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 1.0f, 2.0f, 1.0f},
+  {204.0, 1.0, 8.0, 8.0, 1.0, 1.0, 0.0, 0.0, 8.0, 0.0, 4.0, 0.0, 8.0, 0.0, 0.0, 1.0},
+  raft::distance::DistanceType::InnerProduct,
+  0.0};
+
 const InputConfiguration<int, float> input_inner_product = {
   2,
   {0, 2, 4, 6, 8},
@@ -692,6 +713,17 @@ INSTANTIATE_TEST_CASE_P(SparseDistanceCOOSPMVTests,
                         SparseDistanceCOOSPMVTestHashStrategyF,
                         ::testing::ValuesIn(inputs_hash_strategy));
 
+// test merge path strategy (annihilating semirings only)
+const std::vector<SparseDistanceCOOSPMVInputs<int, float, merge_path_strategy_t>>
+  inputs_merge_path_strategy = {{input_inner_product}, {input_inner_product_skewed}};
+
+typedef SparseDistanceCOOSPMVTest<int, float, merge_path_strategy_t>
+  SparseDistanceCOOSPMVTestMergePathStrategyF;
+TEST_P(SparseDistanceCOOSPMVTestMergePathStrategyF, Result) { compare(); }
+INSTANTIATE_TEST_CASE_P(SparseDistanceCOOSPMVTests,
+                        SparseDistanceCOOSPMVTestMergePathStrategyF,
+                        ::testing::ValuesIn(inputs_merge_path_strategy));
+
 };  // namespace distance
 };  // end namespace sparse
 };  // end namespace raft
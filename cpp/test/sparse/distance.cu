@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -15,6 +15,7 @@
  */
 
 #include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
 #include <raft/core/resource/cuda_stream.hpp>
 
 #include <cusparse_v2.h>
@@ -27,6 +28,10 @@
 
 #include "../test_utils.cuh"
 
+#include <cmath>
+#include <random>
+#include <vector>
+
 namespace raft {
 namespace sparse {
 namespace distance {
@@ -848,6 +853,129 @@ INSTANTIATE_TEST_CASE_P(SparseDistanceTests,
                         SparseDistanceTestF,
                         ::testing::ValuesIn(inputs_i32_f));
 
+struct BinaryDistanceInputs {
+  int x_rows;
+  int y_rows;
+  int n_cols;
+  double density;
+  raft::distance::DistanceType metric;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const BinaryDistanceInputs& p)
+{
+  return os << "x_rows=" << p.x_rows << " y_rows=" << p.y_rows << " n_cols=" << p.n_cols
+            << " density=" << p.density << " metric=" << int(p.metric);
+}
+
+/** The bitset and MinHash distances against the SpMV ones, on random binary rows. */
+class BinaryDistanceTest : public ::testing::TestWithParam<BinaryDistanceInputs> {
+ public:
+  BinaryDistanceTest()
+    : params(::testing::TestWithParam<BinaryDistanceInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle)),
+      x_indptr(0, stream),
+      x_indices(0, stream),
+      x_data(0, stream),
+      y_indptr(0, stream),
+      y_indices(0, stream),
+      y_data(0, stream)
+  {
+  }
+
+ protected:
+  void make_rows(int n_rows,
+                 std::mt19937& rng,
+                 rmm::device_uvector<int>& indptr,
+                 rmm::device_uvector<int>& indices,
+                 rmm::device_uvector<float>& data)
+  {
+    std::bernoulli_distribution present(params.density);
+    std::vector<int> indptr_h(1, 0), indices_h;
+    for (int i = 0; i < n_rows; i++) {
+      for (int j = 0; j < params.n_cols; j++) {
+        if (present(rng)) { indices_h.push_back(j); }
+      }
+      indptr_h.push_back(indices_h.size());
+    }
+    std::vector<float> data_h(indices_h.size(), 1.0f);
+    indptr.resize(indptr_h.size(), stream);
+    indices.resize(indices_h.size(), stream);
+    data.resize(data_h.size(), stream);
+    update_device(indptr.data(), indptr_h.data(), indptr_h.size(), stream);
+    update_device(indices.data(), indices_h.data(), indices_h.size(), stream);
+    update_device(data.data(), data_h.data(), data_h.size(), stream);
+  }
+
+  auto compute(const binary_distance_params& bin_params) -> std::vector<float>
+  {
+    auto x_structure = raft::make_device_compressed_structure_view<int, int, int>(
+      x_indptr.data(), x_indices.data(), params.x_rows, params.n_cols, int(x_indices.size()));
+    auto y_structure = raft::make_device_compressed_structure_view<int, int, int>(
+      y_indptr.data(), y_indices.data(), params.y_rows, params.n_cols, int(y_indices.size()));
+    auto x   = raft::make_device_csr_matrix_view<const float>(x_data.data(), x_structure);
+    auto y   = raft::make_device_csr_matrix_view<const float>(y_data.data(), y_structure);
+    auto out = raft::make_device_matrix<float, int>(handle, params.x_rows, params.y_rows);
+    binary_pairwise_distance(handle, x, y, out.view(), params.metric, bin_params);
+    std::vector<float> out_h(size_t(params.x_rows) * params.y_rows);
+    update_host(out_h.data(), out.data_handle(), out_h.size(), stream);
+    resource::sync_stream(handle, stream);
+    return out_h;
+  }
+
+  void SetUp() override
+  {
+    std::mt19937 rng(42);
+    make_rows(params.x_rows, rng, x_indptr, x_indices, x_data);
+    make_rows(params.y_rows, rng, y_indptr, y_indices, y_data);
+  }
+
+  void Run()
+  {
+    binary_distance_params bin_params;
+    bin_params.algo = binary_distance_algo::SPMV;
+    auto expected   = compute(bin_params);
+
+    bin_params.algo = binary_distance_algo::BITSET;
+    auto bitset     = compute(bin_params);
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_NEAR(expected[i], bitset[i], 1e-5) << "at " << i;
+    }
+
+    // the estimates are unbiased to within the standard error of the MinHash signatures
+    bin_params.algo     = binary_distance_algo::MINHASH;
+    bin_params.n_hashes = 1024;
+    auto minhash        = compute(bin_params);
+    double error        = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+      error += std::abs(double(expected[i]) - double(minhash[i]));
+    }
+    ASSERT_LT(error / expected.size(), 0.03);
+  }
+
+  raft::resources handle;
+  BinaryDistanceInputs params;
+  cudaStream_t stream;
+  rmm::device_uvector<int> x_indptr, x_indices;
+  rmm::device_uvector<float> x_data;
+  rmm::device_uvector<int> y_indptr, y_indices;
+  rmm::device_uvector<float> y_data;
+};
+
+const std::vector<BinaryDistanceInputs> binary_inputs = {
+  {100, 80, 300, 0.1, raft::distance::DistanceType::JaccardExpanded},
+  {100, 80, 300, 0.1, raft::distance::DistanceType::DiceExpanded},
+  {100, 80, 300, 0.1, raft::distance::DistanceType::HammingUnexpanded},
+  {37, 300, 1025, 0.3, raft::distance::DistanceType::JaccardExpanded},
+  {37, 300, 1025, 0.02, raft::distance::DistanceType::DiceExpanded},
+  // with empty rows
+  {10, 10, 40, 0.01, raft::distance::DistanceType::JaccardExpanded},
+};
+
+TEST_P(BinaryDistanceTest, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(SparseDistanceTests,
+                        BinaryDistanceTest,
+                        ::testing::ValuesIn(binary_inputs));
+
 };  // namespace distance
 };  // end namespace sparse
 };  // end namespace raft
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resource/cusparse_handle.hpp>
+#include <raft/sparse/detail/cusparse_wrappers.h>
+#include <raft/sparse/linalg/distributed_spmm.cuh>
+#include <raft/util/cuda_dev_essentials.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace raft::sparse::linalg {
+
+struct DistributedSpmvInputs {
+  int n_ranks;
+  int n_rows;
+  int nnz_per_row;
+  float alpha;
+  float beta;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const DistributedSpmvInputs& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", n_rows " << p.n_rows << ", nnz_per_row " << p.nnz_per_row
+     << ", alpha " << p.alpha << ", beta " << p.beta << "}";
+  return os;
+}
+
+/**
+ * The rows of a random square CSR matrix (with the columns anywhere, so that every rank has a
+ * halo) are split in contiguous blocks across the ranks of an in-process clique, with the same
+ * rows of x and y: every rank should get its rows of the cuSPARSE SpMV of the whole matrix.
+ */
+class DistributedSpmvTest : public ::testing::TestWithParam<DistributedSpmvInputs> {
+ protected:
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<DistributedSpmvInputs>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> column(0, p.n_rows - 1);
+    std::vector<int> indptr(p.n_rows + 1, 0);
+    std::vector<int> indices;
+    std::vector<float> values;
+    for (int i = 0; i < p.n_rows; i++) {
+      std::set<int> cols{i};
+      while (int(cols.size()) < std::min(p.nnz_per_row, p.n_rows)) {
+        cols.insert(column(gen));
+      }
+      for (int j : cols) {
+        indices.push_back(j);
+        values.push_back(uniform(gen));
+      }
+      indptr[i + 1] = indices.size();
+    }
+    std::vector<float> x(p.n_rows);
+    std::vector<float> y(p.n_rows);
+    for (int i = 0; i < p.n_rows; i++) {
+      x[i] = uniform(gen);
+      y[i] = uniform(gen);
+    }
+    const int nnz = indices.size();
+
+    // the reference: cuSPARSE SpMV of the whole matrix, on the first device
+    std::vector<float> expected(p.n_rows);
+    {
+      raft::resources handle;
+      auto stream     = resource::get_cuda_stream(handle);
+      auto cusparse_h = resource::get_cusparse_handle(handle);
+      auto op         = CUSPARSE_OPERATION_NON_TRANSPOSE;
+      auto alg        = CUSPARSE_SPMV_ALG_DEFAULT;
+      rmm::device_uvector<int> d_indptr(indptr.size(), stream);
+      rmm::device_uvector<int> d_indices(nnz, stream);
+      rmm::device_uvector<float> d_values(nnz, stream);
+      rmm::device_uvector<float> d_x(p.n_rows, stream);
+      rmm::device_uvector<float> d_y(p.n_rows, stream);
+      raft::update_device(d_indptr.data(), indptr.data(), indptr.size(), stream);
+      raft::update_device(d_indices.data(), indices.data(), nnz, stream);
+      raft::update_device(d_values.data(), values.data(), nnz, stream);
+      raft::update_device(d_x.data(), x.data(), p.n_rows, stream);
+      raft::update_device(d_y.data(), y.data(), p.n_rows, stream);
+
+      cusparseSpMatDescr_t matA;
+      cusparseDnVecDescr_t vecX;
+      cusparseDnVecDescr_t vecY;
+      RAFT_CUSPARSE_TRY(raft::sparse::detail::cusparsecreatecsr(
+        &matA, p.n_rows, p.n_rows, nnz, d_indptr.data(), d_indices.data(), d_values.data()));
+      RAFT_CUSPARSE_TRY(raft::sparse::detail::cusparsecreatednvec(&vecX, p.n_rows, d_x.data()));
+      RAFT_CUSPARSE_TRY(raft::sparse::detail::cusparsecreatednvec(&vecY, p.n_rows, d_y.data()));
+      size_t buffer_size = 0;
+      RAFT_CUSPARSE_TRY(raft::sparse::detail::cusparsespmv_buffersize(
+        cusparse_h, op, &p.alpha, matA, vecX, &p.beta, vecY, alg, &buffer_size, stream));
+      rmm::device_uvector<float> buffer(raft::ceildiv<size_t>(buffer_size, sizeof(float)), stream);
+      RAFT_CUSPARSE_TRY(raft::sparse::detail::cusparsespmv(
+        cusparse_h, op, &p.alpha, matA, vecX, &p.beta, vecY, alg, buffer.data(), stream));
+      RAFT_CUSPARSE_TRY(cusparseDestroySpMat(matA));
+      RAFT_CUSPARSE_TRY(cusparseDestroyDnVec(vecX));
+      RAFT_CUSPARSE_TRY(cusparseDestroyDnVec(vecY));
+      raft::update_host(expected.data(), d_y.data(), p.n_rows, stream);
+      resource::sync_stream(handle);
+    }
+
+    std::vector<float> actual(p.n_rows);
+    nccl_clique clique(p.n_ranks);
+    clique.run([&](int rank, const raft::resources& handle) {
+      auto stream     = resource::get_cuda_stream(handle);
+      const int begin = int64_t(p.n_rows) * rank / p.n_ranks;
+      const int rows  = int64_t(p.n_rows) * (rank + 1) / p.n_ranks - begin;
+      const int first = indptr[begin];
+      const int n_nz  = indptr[begin + rows] - first;
+      // the local rows, with the global column indices
+      std::vector<int> local_indptr(rows + 1);
+      for (int i = 0; i <= rows; i++) {
+        local_indptr[i] = indptr[begin + i] - first;
+      }
+      rmm::device_uvector<int> d_indptr(rows + 1, stream);
+      rmm::device_uvector<int> d_indices(n_nz, stream);
+      rmm::device_uvector<float> d_values(n_nz, stream);
+      auto d_x = raft::make_device_vector<float, int>(handle, rows);
+      auto d_y = raft::make_device_vector<float, int>(handle, rows);
+      raft::update_device(d_indptr.data(), local_indptr.data(), rows + 1, stream);
+      raft::update_device(d_indices.data(), indices.data() + first, n_nz, stream);
+      raft::update_device(d_values.data(), values.data() + first, n_nz, stream);
+      raft::update_device(d_x.data_handle(), x.data() + begin, rows, stream);
+      raft::update_device(d_y.data_handle(), y.data() + begin, rows, stream);
+
+      auto structure = raft::make_device_compressed_structure_view<int, int, int>(
+        d_indptr.data(), d_indices.data(), rows, p.n_rows, n_nz);
+      auto A = make_distributed_csr_matrix<float>(
+        handle, raft::make_device_csr_matrix_view<const float>(d_values.data(), structure));
+      distributed_spmv(
+        handle, A, &p.alpha, raft::make_const_mdspan(d_x.view()), &p.beta, d_y.view());
+      // the ranks write disjoint rows
+      raft::update_host(actual.data() + begin, d_y.data_handle(), rows, stream);
+      resource::sync_stream(handle);
+    });
+
+    ASSERT_TRUE(hostVecMatch(expected, actual, raft::CompareApprox<float>(1e-4)));
+  }
+};
+
+const std::vector<DistributedSpmvInputs> inputs = {{1, 1000, 8, 1.0f, 0.0f},
+                                                   {2, 1000, 8, 1.0f, 0.0f},
+                                                   {2, 1001, 1, 0.5f, 2.0f},
+                                                   {2, 10000, 32, -1.5f, 0.5f},
+                                                   {2, 7, 7, 1.0f, 1.0f}};
+
+TEST_P(DistributedSpmvTest, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(DistributedSpmvTests, DistributedSpmvTest, ::testing::ValuesIn(inputs));
+
+}  // namespace raft::sparse::linalg
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -135,7 +135,9 @@ class GramMatrixTest : public ::testing::TestWithParam<GramMatrixInputs> {
       x2_csr_indices(0, stream),
       x2_csr_data(0, stream),
       gram(0, stream),
-      gram_host(0)
+      gram_host(0),
+      alpha(0, stream),
+      prod(0, stream)
   {
     if (params.ld1 == 0) { params.ld1 = params.is_row_major ? params.n_cols : params.n1; }
     if (params.ld2 == 0) { params.ld2 = params.is_row_major ? params.n_cols : params.n2; }
@@ -155,6 +157,9 @@ class GramMatrixTest : public ::testing::TestWithParam<GramMatrixInputs> {
     raft::random::RngState r(42137ULL);
     raft::random::uniform(handle, r, x1.data(), x1.size(), math_t(0), math_t(1));
     raft::random::uniform(handle, r, x2.data(), x2.size(), math_t(0), math_t(1));
+    alpha.resize(params.n2, stream);
+    prod.resize(params.n1, stream);
+    raft::random::uniform(handle, r, alpha.data(), alpha.size(), math_t(-1), math_t(1));
 
     RAFT_CUDA_TRY(cudaStreamSynchronize(stream));
   }
@@ -231,8 +236,15 @@ class GramMatrixTest : public ::testing::TestWithParam<GramMatrixInputs> {
         : raft::make_device_strided_matrix_view<math_t, int, raft::layout_f_contiguous>(
             gram.data(), params.n1, params.n2, params.ld_out);
 
+    // K(x1, x2) * alpha in tiles of at most 100 elements
+    auto alpha_span = raft::make_device_vector_view<const math_t, int>(alpha.data(), params.n2);
+    auto prod_span  = raft::make_device_vector_view<math_t, int>(prod.data(), params.n1);
+    size_t tile     = 100;
+
     if (params.sparse_input == SparseType::DENSE) {
       (*kernel)(handle, x1_span, x2_span, out_span);
+      kernel->evaluate_times_vector(
+        handle, x1_span, x2_span, alpha_span, prod_span, nullptr, nullptr, tile);
     } else {
       x1_csr_indptr.reserve(params.n1 + 1, stream);
       x1_csr_indices.reserve(params.n1 * params.n_cols, stream);
@@ -252,6 +264,8 @@ class GramMatrixTest : public ::testing::TestWithParam<GramMatrixInputs> {
 
       if (params.sparse_input == SparseType::MIX) {
         (*kernel)(handle, x1_csr, x2_span, out_span);
+        kernel->evaluate_times_vector(
+          handle, x1_csr, x2_span, alpha_span, prod_span, nullptr, nullptr, tile);
       } else {
         x2_csr_indptr.reserve(params.n2 + 1, stream);
         x2_csr_indices.reserve(params.n2 * params.n_cols, stream);
@@ -270,6 +284,8 @@ class GramMatrixTest : public ::testing::TestWithParam<GramMatrixInputs> {
           x2_csr_structure);
 
         (*kernel)(handle, x1_csr, x2_csr, out_span);
+        kernel->evaluate_times_vector(
+          handle, x1_csr, x2_csr, alpha_span, prod_span, nullptr, nullptr, tile);
       }
     }
     // Something in gram is executing not on the 'stream' and therefore
@@ -292,6 +308,19 @@ class GramMatrixTest : public ::testing::TestWithParam<GramMatrixInputs> {
 
     ASSERT_TRUE(raft::devArrMatchHost(
       gram_host.data(), gram.data(), gram.size(), raft::CompareApprox<math_t>(1e-6f), stream));
+
+    std::vector<math_t> alpha_host(params.n2);
+    std::vector<math_t> prod_host(params.n1, 0);
+    raft::update_host(alpha_host.data(), alpha.data(), params.n2, stream);
+    resource::sync_stream(handle, stream);
+    for (int i = 0; i < params.n1; i++) {
+      for (int k = 0; k < params.n2; k++) {
+        prod_host[i] += gram_host[get_offset(i, k, params.ld_out, params.is_row_major)] *
+                        alpha_host[k];
+      }
+    }
+    ASSERT_TRUE(raft::devArrMatchHost(
+      prod_host.data(), prod.data(), params.n1, raft::CompareApprox<math_t>(1e-4f), stream));
   }
 
   raft::resources handle;
@@ -310,6 +339,9 @@ class GramMatrixTest : public ::testing::TestWithParam<GramMatrixInputs> {
 
   rmm::device_uvector<math_t> gram;
   std::vector<math_t> gram_host;
+
+  rmm::device_uvector<math_t> alpha;
+  rmm::device_uvector<math_t> prod;
 };
 
 typedef GramMatrixTest<float> GramMatrixTestFloatStandard;
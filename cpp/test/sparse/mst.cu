@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2020-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2020-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -135,8 +135,8 @@ class MSTTest : public ::testing::TestWithParam<MSTTestInput<vertex_t, edge_t, w
     vertex_t* indices = static_cast<vertex_t*>(csr_d.indices.data());
     weight_t* weights = static_cast<weight_t*>(csr_d.weights.data());
 
-    v = static_cast<vertex_t>((csr_d.offsets.size() / sizeof(vertex_t)) - 1);
-    e = static_cast<edge_t>(csr_d.indices.size() / sizeof(edge_t));
+    v = static_cast<vertex_t>((csr_d.offsets.size() / sizeof(edge_t)) - 1);
+    e = static_cast<edge_t>(csr_d.indices.size() / sizeof(vertex_t));
 
     rmm::device_uvector<vertex_t> mst_src(2 * v - 2, resource::get_cuda_stream(handle));
     rmm::device_uvector<vertex_t> mst_dst(2 * v - 2, resource::get_cuda_stream(handle));
@@ -386,5 +386,46 @@ TEST_P(MSTTestSequential, Sequential)
 
 INSTANTIATE_TEST_SUITE_P(MSTTests, MSTTestSequential, ::testing::ValuesIn(csr_in_h));
 
+// the same graphs with 64-bit edge indexing
+template <typename vertex_t, typename edge_t, typename weight_t>
+std::vector<MSTTestInput<vertex_t, edge_t, weight_t>> with_edge_type(
+  const std::vector<MSTTestInput<vertex_t, int, weight_t>>& inputs)
+{
+  std::vector<MSTTestInput<vertex_t, edge_t, weight_t>> outputs;
+  for (const auto& input : inputs) {
+    CSRHost<vertex_t, edge_t, weight_t> csr_h{
+      std::vector<edge_t>(input.csr_h.offsets.begin(), input.csr_h.offsets.end()),
+      input.csr_h.indices,
+      input.csr_h.weights};
+    outputs.push_back({csr_h, input.iterations});
+  }
+  return outputs;
+}
+
+typedef MSTTest<int, int64_t, float> MSTTestSequentialInt64Edges;
+TEST_P(MSTTestSequentialInt64Edges, Sequential)
+{
+  auto results_pair          = mst_gpu();
+  auto& symmetric_result     = results_pair.first;
+  auto& non_symmetric_result = results_pair.second;
+
+  auto prims_result = prims(mst_input.csr_h);
+
+  auto symmetric_sum = thrust::reduce(thrust::device,
+                                      symmetric_result.weights.data(),
+                                      symmetric_result.weights.data() + symmetric_result.n_edges);
+  auto non_symmetric_sum =
+    thrust::reduce(thrust::device,
+                   non_symmetric_result.weights.data(),
+                   non_symmetric_result.weights.data() + non_symmetric_result.n_edges);
+
+  ASSERT_TRUE(raft::match(2 * prims_result, symmetric_sum, raft::CompareApprox<float>(0.1)));
+  ASSERT_TRUE(raft::match(prims_result, non_symmetric_sum, raft::CompareApprox<float>(0.1)));
+}
+
+INSTANTIATE_TEST_SUITE_P(MSTTests,
+                         MSTTestSequentialInt64Edges,
+                         ::testing::ValuesIn(with_edge_type<int, int64_t, float>(csr_in_h)));
+
 }  // namespace mst
 }  // namespace raft
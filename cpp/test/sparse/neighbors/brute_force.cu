@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -169,7 +169,39 @@ const std::vector<SparseKNNInputs<int, float>> inputs_i32_f = {
    2,
    2,
    2,
-   raft::distance::DistanceType::L2SqrtExpanded}};
+   raft::distance::DistanceType::L2SqrtExpanded},
+  // the inner product metrics search an inverted index of the index matrix
+  {4,
+   {0, 2, 4, 6, 7},
+   {0, 1, 0, 2, 1, 3, 3},
+   {1.0f, 2.0f, 2.0f, 1.0f, 3.0f, 3.0f, 1.0f},
+   {6.0, 5.0, 5.0, 2.0, 18.0, 6.0, 3.0, 1.0},
+   {2, 0, 1, 0, 2, 0, 2, 3},
+   2,
+   2,
+   2,
+   raft::distance::DistanceType::InnerProduct},
+  {4,
+   {0, 2, 4, 6, 7},
+   {0, 1, 0, 2, 1, 3, 3},
+   {1.0f, 2.0f, 2.0f, 1.0f, 3.0f, 3.0f, 1.0f},
+   {0, 0.367544, 0, 0.6, 0, 0.292893, 0, 0.292893},
+   {0, 2, 1, 0, 2, 3, 3, 2},
+   2,
+   2,
+   2,
+   raft::distance::DistanceType::CosineExpanded},
+  // less candidates than k: padded with the smallest documents with no overlap
+  {4,
+   {0, 2, 4, 6, 7},
+   {0, 1, 0, 2, 1, 3, 3},
+   {1.0f, 2.0f, 2.0f, 1.0f, 3.0f, 3.0f, 1.0f},
+   {0, 0.367544, 0.6, 0, 0.6, 1.0, 0, 0.292893, 0.367544, 0, 0.292893, 1.0},
+   {0, 2, 1, 1, 0, 2, 2, 3, 0, 3, 2, 0},
+   3,
+   2,
+   2,
+   raft::distance::DistanceType::CosineExpanded}};
 typedef SparseKNNTest<int, float> SparseKNNTestF;
 TEST_P(SparseKNNTestF, Result) { compare(); }
 INSTANTIATE_TEST_CASE_P(SparseKNNTest, SparseKNNTestF, ::testing::ValuesIn(inputs_i32_f));
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -150,6 +150,33 @@ class ConnectComponentsTest
     ASSERT_TRUE(devArrMatch(
       out_edges.vals(), out_edges_batched.vals(), out_edges.nnz, CompareApprox<float>(1e-4)));
 
+    /**
+     * The stateful runs: the second one reuses the nearest neighbors of the first one.
+     */
+    raft::sparse::neighbors::cross_component_nn_state<value_idx, value_t> state(params.n_row,
+                                                                               stream);
+    for (int run = 0; run < 2; run++) {
+      raft::sparse::COO<value_t, value_idx> out_edges_state(stream);
+      raft::sparse::neighbors::cross_component_nn<value_idx, value_t>(handle,
+                                                                      out_edges_state,
+                                                                      data.data(),
+                                                                      colors.data(),
+                                                                      params.n_row,
+                                                                      params.n_col,
+                                                                      red_op,
+                                                                      state,
+                                                                      params.n_row / 2,
+                                                                      params.n_col / 2);
+
+      ASSERT_TRUE(out_edges.nnz == out_edges_state.nnz);
+      ASSERT_TRUE(
+        devArrMatch(out_edges.rows(), out_edges_state.rows(), out_edges.nnz, Compare<int>()));
+      ASSERT_TRUE(
+        devArrMatch(out_edges.cols(), out_edges_state.cols(), out_edges.nnz, Compare<int>()));
+      ASSERT_TRUE(devArrMatch(
+        out_edges.vals(), out_edges_state.vals(), out_edges.nnz, CompareApprox<float>(1e-4)));
+    }
+
     /**
      * Construct final edge list
      */
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,9 +22,14 @@
 #include <rmm/device_uvector.hpp>
 
 #include <raft/sparse/coo.hpp>
+#include <raft/sparse/linalg/symmetrize.cuh>
 #include <raft/sparse/neighbors/knn_graph.cuh>
 
 #include <iostream>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
 
 namespace raft {
 namespace sparse {
@@ -123,5 +128,84 @@ INSTANTIATE_TEST_CASE_P(KNNGraphTest,
                         KNNGraphTestF_int,
                         ::testing::ValuesIn(knn_graph_inputs_fint));
 
+// Checks the CSR graph built from the neighbor matrix against the COO symmetrization.
+class KNNGraphCSRTest : public ::testing::TestWithParam<int> {
+ protected:
+  raft::resources handle;
+};
+
+TEST_P(KNNGraphCSRTest, MatchesSymmetrize)
+{
+  using value_idx = int;
+  using value_t   = float;
+
+  auto stream     = resource::get_cuda_stream(handle);
+  const size_t m  = GetParam();
+  const size_t n  = 3;
+  const size_t k  = raft::sparse::neighbors::detail::build_k<size_t>(m, 15);
+  const auto nnz  = m * k;
+  const auto dist = raft::distance::DistanceType::L2SqrtUnexpanded;
+
+  std::mt19937 gen(1234);
+  std::uniform_real_distribution<value_t> uniform(-1, 1);
+  std::vector<value_t> h_X(m * n);
+  for (auto& v : h_X) {
+    v = uniform(gen);
+  }
+  rmm::device_uvector<value_t> X(m * n, stream);
+  update_device(X.data(), h_X.data(), h_X.size(), stream);
+
+  rmm::device_uvector<value_idx> knn_indices(nnz, stream);
+  rmm::device_uvector<value_t> knn_dists(nnz, stream);
+  raft::sparse::neighbors::detail::knn_graph_neighbors(
+    handle, X.data(), m, n, dist, k, knn_indices.data(), knn_dists.data());
+
+  // The legacy COO symmetrization
+  std::vector<value_idx> h_rows(nnz);
+  for (size_t i = 0; i < nnz; i++) {
+    h_rows[i] = i / k;
+  }
+  rmm::device_uvector<value_idx> rows(nnz, stream);
+  update_device(rows.data(), h_rows.data(), nnz, stream);
+  raft::sparse::COO<value_t, value_idx> coo(stream);
+  raft::sparse::linalg::symmetrize(
+    handle, rows.data(), knn_indices.data(), knn_dists.data(), m, k, nnz, coo);
+
+  rmm::device_uvector<value_idx> indptr(0, stream);
+  rmm::device_uvector<value_idx> indices(0, stream);
+  rmm::device_uvector<value_t> data(0, stream);
+  raft::sparse::linalg::symmetrize_knn_csr(
+    handle, knn_indices.data(), knn_dists.data(), m, int(k), indptr, indices, data);
+
+  std::vector<value_idx> coo_rows(coo.nnz), coo_cols(coo.nnz);
+  std::vector<value_t> coo_vals(coo.nnz);
+  update_host(coo_rows.data(), coo.rows(), coo.nnz, stream);
+  update_host(coo_cols.data(), coo.cols(), coo.nnz, stream);
+  update_host(coo_vals.data(), coo.vals(), coo.nnz, stream);
+  std::vector<value_idx> h_indptr(m + 1), h_indices(indices.size());
+  std::vector<value_t> h_data(data.size());
+  update_host(h_indptr.data(), indptr.data(), m + 1, stream);
+  update_host(h_indices.data(), indices.data(), indices.size(), stream);
+  update_host(h_data.data(), data.data(), data.size(), stream);
+  resource::sync_stream(handle, stream);
+
+  std::map<std::pair<value_idx, value_idx>, value_t> expected;
+  for (int i = 0; i < coo.nnz; i++) {
+    expected[{coo_rows[i], coo_cols[i]}] = coo_vals[i];
+  }
+  ASSERT_EQ(size_t(h_indptr[m]), h_indices.size());
+  ASSERT_EQ(expected.size(), h_indices.size());
+  for (size_t r = 0; r < m; r++) {
+    for (value_idx i = h_indptr[r]; i < h_indptr[r + 1]; i++) {
+      auto it = expected.find({value_idx(r), h_indices[i]});
+      ASSERT_TRUE(it != expected.end()) << "unexpected edge " << r << " -> " << h_indices[i];
+      ASSERT_EQ(it->second, h_data[i]);
+      expected.erase(it);
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(KNNGraphTest, KNNGraphCSRTest, ::testing::Values(4, 100, 1000));
+
 }  // namespace sparse
 }  // namespace raft
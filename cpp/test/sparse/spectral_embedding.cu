@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/sparse/linalg/spectral.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace raft {
+namespace sparse {
+
+template <typename T>
+struct SpectralEmbeddingInputs {
+  T tolerance;
+  int n, n_components, block_size;
+  unsigned long long seed;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const SpectralEmbeddingInputs<T>& p)
+{
+  os << "{n " << p.n << ", k " << p.n_components << ", block " << p.block_size << "}";
+  return os;
+}
+
+template <typename T>
+class SpectralEmbeddingTest : public ::testing::TestWithParam<SpectralEmbeddingInputs<T>> {
+ public:
+  SpectralEmbeddingTest()
+    : params(::testing::TestWithParam<SpectralEmbeddingInputs<T>>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void Run()
+  {
+    int n = params.n, k = params.n_components;
+    // the path graph, with the weights 1 + (i % 3) on the edge (i, i + 1)
+    std::vector<int> indptr(1, 0), indices;
+    std::vector<T> values;
+    std::vector<double> degrees(n, 0);
+    for (int i = 0; i < n; i++) {
+      for (int j : {i - 1, i + 1}) {
+        if (j < 0 || j >= n) { continue; }
+        T w = T(1 + std::min(i, j) % 3);
+        indices.push_back(j);
+        values.push_back(w);
+        degrees[i] += w;
+      }
+      indptr.push_back(int(indices.size()));
+    }
+    int nnz = int(values.size());
+
+    rmm::device_uvector<int> d_indptr(n + 1, stream);
+    rmm::device_uvector<int> d_indices(nnz, stream);
+    rmm::device_uvector<T> d_values(nnz, stream);
+    raft::update_device(d_indptr.data(), indptr.data(), n + 1, stream);
+    raft::update_device(d_indices.data(), indices.data(), nnz, stream);
+    raft::update_device(d_values.data(), values.data(), nnz, stream);
+    auto structure = raft::make_device_compressed_structure_view<int, int, int>(
+      d_indptr.data(), d_indices.data(), n, n, nnz);
+    auto graph =
+      raft::make_device_csr_matrix_view<const T, int, int, int>(d_values.data(), structure);
+
+    raft::sparse::spectral::embedding_config<T> config{k};
+    config.block_size   = params.block_size;
+    config.max_restarts = 500;
+    config.tolerance    = params.tolerance;
+    config.seed         = params.seed;
+    auto embedding      = raft::make_device_matrix<T, int, raft::col_major>(handle, n, k);
+
+    auto cold = raft::sparse::spectral::fit_embedding(handle, config, graph, embedding.view());
+    ASSERT_TRUE(cold.converged) << cold.n_restarts << " restarts";
+
+    std::vector<T> h_emb(size_t(n) * k);
+    raft::update_host(h_emb.data(), embedding.data_handle(), h_emb.size(), stream);
+    resource::sync_stream(handle, stream);
+
+    // every column v is a generalized eigenvector A v = lambda D v, D-orthogonal to the trivial
+    // one (the constant vector) and to the previous columns, of decreasing lambda
+    double previous = 1;
+    for (int c = 0; c < k; c++) {
+      const T* v = h_emb.data() + size_t(c) * n;
+      double vav = 0, vdv = 0, vd1 = 0;
+      std::vector<double> av(n, 0);
+      for (int i = 0; i < n; i++) {
+        for (int e = indptr[i]; e < indptr[i + 1]; e++) {
+          av[i] += double(values[e]) * v[indices[e]];
+        }
+        vav += v[i] * av[i];
+        vdv += degrees[i] * v[i] * v[i];
+        vd1 += degrees[i] * v[i];
+      }
+      ASSERT_GT(vdv, 0) << "column " << c;
+      double lambda = vav / vdv;
+      double res    = 0;
+      for (int i = 0; i < n; i++) {
+        double r = av[i] - lambda * degrees[i] * v[i];
+        res += r * r / degrees[i];
+      }
+      ASSERT_LT(std::sqrt(res / vdv), 10 * params.tolerance) << "column " << c;
+      ASSERT_LT(std::abs(vd1) / std::sqrt(vdv), 10 * params.tolerance) << "column " << c;
+      ASSERT_LT(lambda, previous) << "column " << c;
+      previous = lambda;
+    }
+
+    // restarting from the embedding takes no more products, with the same columns up to the sign
+    auto warm_embedding = raft::make_device_matrix<T, int, raft::col_major>(handle, n, k);
+    auto warm           = raft::sparse::spectral::fit_embedding(
+      handle, config, graph, warm_embedding.view(), raft::make_const_mdspan(embedding.view()));
+    ASSERT_TRUE(warm.converged);
+    ASSERT_LE(warm.n_products, cold.n_products);
+    std::vector<T> h_warm(size_t(n) * k);
+    raft::update_host(h_warm.data(), warm_embedding.data_handle(), h_warm.size(), stream);
+    resource::sync_stream(handle, stream);
+    for (int c = 0; c < k; c++) {
+      double dot = 0, norm_cold = 0, norm_warm = 0;
+      for (int i = 0; i < n; i++) {
+        size_t e = size_t(c) * n + i;
+        dot += degrees[i] * h_emb[e] * h_warm[e];
+        norm_cold += degrees[i] * h_emb[e] * h_emb[e];
+        norm_warm += degrees[i] * h_warm[e] * h_warm[e];
+      }
+      ASSERT_NEAR(1.0, std::abs(dot) / std::sqrt(norm_cold * norm_warm), 100 * params.tolerance)
+        << "column " << c;
+    }
+  }
+
+  raft::resources handle;
+  SpectralEmbeddingInputs<T> params;
+  cudaStream_t stream = 0;
+};
+
+const std::vector<SpectralEmbeddingInputs<float>> inputsf = {{1e-4f, 60, 3, 0, 1234ULL},
+                                                             {1e-4f, 80, 2, 2, 1234ULL}};
+const std::vector<SpectralEmbeddingInputs<double>> inputsd = {{1e-8, 60, 3, 0, 1234ULL},
+                                                              {1e-8, 100, 4, 3, 1234ULL}};
+
+typedef SpectralEmbeddingTest<float> SpectralEmbeddingTestF;
+TEST_P(SpectralEmbeddingTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(SpectralEmbeddingTests,
+                        SpectralEmbeddingTestF,
+                        ::testing::ValuesIn(inputsf));
+
+typedef SpectralEmbeddingTest<double> SpectralEmbeddingTestD;
+TEST_P(SpectralEmbeddingTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(SpectralEmbeddingTests,
+                        SpectralEmbeddingTestD,
+                        ::testing::ValuesIn(inputsd));
+
+}  // end namespace sparse
+}  // end namespace raft
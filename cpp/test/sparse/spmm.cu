@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <raft/core/device_csr_matrix.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/sparse/linalg/spmm.hpp>
+#include <raft/util/cudart_utils.hpp>
+
+#include <rmm/device_uvector.hpp>
+
+#include <cuda_fp16.h>
+
+#include "../test_utils.cuh"
+
+#include <random>
+#include <vector>
+
+namespace raft {
+namespace sparse {
+
+struct SpmmBatchedInputs {
+  int m;
+  int k;
+  int n;
+  int batch_count;
+  bool shared_x;
+  float density;
+  unsigned long long int seed;
+};
+
+inline ::std::ostream& operator<<(::std::ostream& os, const SpmmBatchedInputs& p)
+{
+  return os << "m=" << p.m << " k=" << p.k << " n=" << p.n << " batch=" << p.batch_count
+            << " shared_x=" << p.shared_x << " density=" << p.density;
+}
+
+/**
+ * Checks `spmm_batched` (and through it the half precision path) against a host product. The
+ * values are small multiples of 0.5, so that the products and their sums are exact in half
+ * precision as well.
+ */
+template <typename ValueType>
+class SpmmBatchedTest : public ::testing::TestWithParam<SpmmBatchedInputs> {
+ public:
+  SpmmBatchedTest()
+    : params(::testing::TestWithParam<SpmmBatchedInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void SetUp() override
+  {
+    std::mt19937 gen(params.seed);
+    std::uniform_real_distribution<float> coin(0.0f, 1.0f);
+    std::uniform_int_distribution<int> value(-4, 4);
+
+    // the sparse matrices: all have the same nnz, as required by the strided batch
+    int n_x = params.shared_x ? 1 : params.batch_count;
+    std::vector<int> pattern_indptr(params.m + 1, 0);
+    std::vector<int> indices;
+    for (int i = 0; i < params.m; i++) {
+      for (int j = 0; j < params.k; j++) {
+        if (coin(gen) < params.density) { indices.push_back(j); }
+      }
+      pattern_indptr[i + 1] = indices.size();
+    }
+    nnz = indices.size();
+
+    std::vector<float> x_h(size_t(n_x) * nnz);
+    for (auto& v : x_h) {
+      v = 0.5f * value(gen);
+    }
+    std::vector<int> indptr_h, indices_h;
+    for (int b = 0; b < n_x; b++) {
+      indptr_h.insert(indptr_h.end(), pattern_indptr.begin(), pattern_indptr.end());
+      indices_h.insert(indices_h.end(), indices.begin(), indices.end());
+    }
+
+    size_t y_size = size_t(params.k) * params.n;
+    size_t z_size = size_t(params.m) * params.n;
+    std::vector<float> y_h(y_size * params.batch_count);
+    for (auto& v : y_h) {
+      v = 0.5f * value(gen);
+    }
+
+    z_ref.assign(z_size * params.batch_count, 0.0f);
+    for (int b = 0; b < params.batch_count; b++) {
+      const float* x_b = x_h.data() + (params.shared_x ? 0 : size_t(b) * nnz);
+      for (int i = 0; i < params.m; i++) {
+        for (int e = pattern_indptr[i]; e < pattern_indptr[i + 1]; e++) {
+          for (int j = 0; j < params.n; j++) {
+            z_ref[b * z_size + size_t(i) * params.n + j] +=
+              x_b[e] * y_h[b * y_size + size_t(indices[e]) * params.n + j];
+          }
+        }
+      }
+    }
+
+    x_indptr  = make_device(indptr_h);
+    x_indices = make_device(indices_h);
+    x_data    = make_device(convert(x_h));
+    y_data    = make_device(convert(y_h));
+    z_data    = make_device(std::vector<ValueType>(z_ref.size(), ValueType(0.0f)));
+  }
+
+  void Run()
+  {
+    auto structure = raft::make_device_compressed_structure_view<int, int, int>(
+      x_indptr.data(), x_indices.data(), params.m, params.k, nnz);
+    auto x = raft::make_device_csr_matrix_view<const ValueType, int, int, int>(x_data.data(),
+                                                                                structure);
+    auto y = raft::make_device_matrix_view<const ValueType, int, raft::row_major>(
+      y_data.data(), params.k, params.n);
+    auto z = raft::make_device_matrix_view<ValueType, int, raft::row_major>(
+      z_data.data(), params.m, params.n);
+
+    float alpha = 1.0f;
+    float beta  = 0.0f;
+    raft::sparse::linalg::spmm_batched(
+      handle, false, false, &alpha, x, y, &beta, z, params.batch_count, params.shared_x);
+
+    std::vector<ValueType> z_h(z_ref.size());
+    raft::update_host(z_h.data(), z_data.data(), z_h.size(), stream);
+    resource::sync_stream(handle);
+
+    std::vector<float> z_f(z_h.size());
+    for (size_t i = 0; i < z_h.size(); i++) {
+      z_f[i] = static_cast<float>(z_h[i]);
+    }
+    ASSERT_TRUE(raft::hostVecMatch(z_ref, z_f, raft::CompareApprox<float>(1e-4f)));
+  }
+
+  std::vector<ValueType> convert(const std::vector<float>& v)
+  {
+    std::vector<ValueType> out(v.size());
+    for (size_t i = 0; i < v.size(); i++) {
+      out[i] = ValueType(v[i]);
+    }
+    return out;
+  }
+
+  template <typename T>
+  rmm::device_uvector<T> make_device(const std::vector<T>& v)
+  {
+    rmm::device_uvector<T> out(v.size(), stream);
+    raft::update_device(out.data(), v.data(), v.size(), stream);
+    return out;
+  }
+
+  raft::resources handle;
+  SpmmBatchedInputs params;
+  cudaStream_t stream;
+
+  int nnz = 0;
+  std::vector<float> z_ref;
+  rmm::device_uvector<int> x_indptr{0, stream};
+  rmm::device_uvector<int> x_indices{0, stream};
+  rmm::device_uvector<ValueType> x_data{0, stream};
+  rmm::device_uvector<ValueType> y_data{0, stream};
+  rmm::device_uvector<ValueType> z_data{0, stream};
+};
+
+const std::vector<SpmmBatchedInputs> spmm_batched_inputs = {
+  {32, 16, 8, 1, true, 0.2f, 1234ULL},
+  {32, 16, 8, 4, true, 0.2f, 1234ULL},
+  {64, 32, 16, 3, false, 0.1f, 1234ULL},
+  {100, 40, 33, 5, false, 0.3f, 42ULL},
+};
+
+using SpmmBatchedTestF = SpmmBatchedTest<float>;
+TEST_P(SpmmBatchedTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(SpmmBatchedTest,
+                        SpmmBatchedTestF,
+                        ::testing::ValuesIn(spmm_batched_inputs));
+
+using SpmmBatchedTestH = SpmmBatchedTest<half>;
+TEST_P(SpmmBatchedTestH, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(SpmmBatchedTest,
+                        SpmmBatchedTestH,
+                        ::testing::ValuesIn(spmm_batched_inputs));
+
+}  // namespace sparse
+}  // namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -188,6 +188,13 @@ const std::vector<adjustedRandIndexParam> large_inputs = {
   {2000000, 0, 0, true, 0.000001, true},
 };
 
+// label ranges large enough for the sparse contingency matrix
+const std::vector<adjustedRandIndexParam> sparse_inputs = {
+  {20000, 1, 2000, false, 0.000001, false},
+  {20000, 1, 2000, true, 0.000001, false},
+  {50000, 7, 3000, false, 0.000001, false},
+};
+
 typedef adjustedRandIndexTest<int, int> ARI_ii;
 TEST_P(ARI_ii, Result)
 {
@@ -202,6 +209,8 @@ TEST_P(ARI_il, Result)
 }
 INSTANTIATE_TEST_CASE_P(adjusted_rand_index, ARI_il, ::testing::ValuesIn(inputs));
 INSTANTIATE_TEST_CASE_P(adjusted_rand_index_large, ARI_il, ::testing::ValuesIn(large_inputs));
+INSTANTIATE_TEST_CASE_P(adjusted_rand_index_sparse, ARI_il, ::testing::ValuesIn(sparse_inputs));
+INSTANTIATE_TEST_CASE_P(adjusted_rand_index_sparse, ARI_ii, ::testing::ValuesIn(sparse_inputs));
 
 }  // end namespace stats
 }  // end namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -136,6 +136,48 @@ class ContingencyMatrixTest : public ::testing::TestWithParam<ContingencyMatrixP
                                   raft::Compare<T>()));
   }
 
+  void RunSparseTest()
+  {
+    int numElements = params.nElements;
+    rmm::device_uvector<T> dRows(numElements, stream);
+    rmm::device_uvector<T> dCols(numElements, stream);
+    rmm::device_uvector<int> dCounts(numElements, stream);
+    auto nnz = raft::stats::sparse_contingency_matrix(
+      handle,
+      raft::make_device_vector_view<const T>(dY.data(), numElements),
+      raft::make_device_vector_view<const T>(dYHat.data(), numElements),
+      raft::make_device_vector_view(dRows.data(), numElements),
+      raft::make_device_vector_view(dCols.data(), numElements),
+      raft::make_device_vector_view(dCounts.data(), numElements),
+      std::make_optional(minLabel),
+      std::make_optional(maxLabel));
+
+    std::vector<T> hRows(nnz);
+    std::vector<T> hCols(nnz);
+    std::vector<int> hCounts(nnz);
+    raft::update_host(hRows.data(), dRows.data(), nnz, stream);
+    raft::update_host(hCols.data(), dCols.data(), nnz, stream);
+    raft::update_host(hCounts.data(), dCounts.data(), nnz, stream);
+    raft::interruptible::synchronize(stream);
+
+    // scatter the entries, which must be unique, non-zero and sorted, into a dense matrix
+    std::vector<int> hOutput(numUniqueClasses * numUniqueClasses, 0);
+    for (int i = 0; i < nnz; i++) {
+      ASSERT_GT(hCounts[i], 0);
+      if (i > 0) {
+        ASSERT_TRUE(hRows[i - 1] < hRows[i] ||
+                    (hRows[i - 1] == hRows[i] && hCols[i - 1] < hCols[i]));
+      }
+      hOutput[(hRows[i] - minLabel) * numUniqueClasses + hCols[i] - minLabel] = hCounts[i];
+    }
+    dComputedOutput.resize(hOutput.size(), stream);
+    raft::update_device(dComputedOutput.data(), hOutput.data(), hOutput.size(), stream);
+    ASSERT_TRUE(raft::devArrMatch(dComputedOutput.data(),
+                                  dGoldenOutput.data(),
+                                  numUniqueClasses * numUniqueClasses,
+                                  raft::Compare<T>()));
+  }
+
   raft::resources handle;
   ContingencyMatrixParam params;
   int numUniqueClasses = -1;
@@ -163,5 +205,20 @@ const std::vector<ContingencyMatrixParam> inputs = {
 typedef ContingencyMatrixTest<int> ContingencyMatrixTestS;
 TEST_P(ContingencyMatrixTestS, Result) { RunTest(); }
 INSTANTIATE_TEST_CASE_P(ContingencyMatrix, ContingencyMatrixTestS, ::testing::ValuesIn(inputs));
+
+const std::vector<ContingencyMatrixParam> sparse_inputs = {
+  {10000, 1, 10, true, false, 0.000001},
+  {10000, 1, 5000, true, false, 0.000001},
+  {10000, 1, 20000, false, false, 0.000001},
+  {100000, 1, 100, false, false, 0.000001},
+  {1000000, 1, 1200, true, false, 0.000001},
+  {100000, 1, 100, false, true, 0.000001},
+};
+
+typedef ContingencyMatrixTest<int> SparseContingencyMatrixTestS;
+TEST_P(SparseContingencyMatrixTestS, Result) { RunSparseTest(); }
+INSTANTIATE_TEST_CASE_P(SparseContingencyMatrix,
+                        SparseContingencyMatrixTestS,
+                        ::testing::ValuesIn(sparse_inputs));
 }  // namespace stats
 }  // namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -24,24 +24,27 @@
 #include <raft/util/cuda_utils.cuh>
 #include <raft/util/cudart_utils.hpp>
 
+#include <algorithm>
+
 namespace raft {
 namespace stats {
 
 // Note: this kernel also updates the input vector to take care of OOB bins!
-RAFT_KERNEL naiveHistKernel(int* bins, int nbins, int* in, int nrows)
+RAFT_KERNEL naiveHistKernel(int* bins, int nbins, int* in, int nrows, int ncols)
 {
-  int tid        = threadIdx.x + blockIdx.x * blockDim.x;
-  int stride     = blockDim.x * gridDim.x;
-  auto offset    = blockIdx.y * nrows;
-  auto binOffset = blockIdx.y * nbins;
-  for (; tid < nrows; tid += stride) {
-    int id = in[offset + tid];
-    if (id < 0)
-      id = 0;
-    else if (id >= nbins)
-      id = nbins - 1;
-    in[offset + tid] = id;
-    raft::myAtomicAdd(bins + binOffset + id, 1);
+  int stride = blockDim.x * gridDim.x;
+  for (int col = blockIdx.y; col < ncols; col += gridDim.y) {
+    auto offset    = size_t(col) * nrows;
+    auto binOffset = size_t(col) * nbins;
+    for (int tid = threadIdx.x + blockIdx.x * blockDim.x; tid < nrows; tid += stride) {
+      int id = in[offset + tid];
+      if (id < 0)
+        id = 0;
+      else if (id >= nbins)
+        id = nbins - 1;
+      in[offset + tid] = id;
+      raft::myAtomicAdd(bins + binOffset + id, 1);
+    }
   }
 }
 
@@ -49,8 +52,8 @@ void naiveHist(int* bins, int nbins, int* in, int nrows, int ncols, cudaStream_t
 {
   const int TPB = 128;
   int nblksx    = raft::ceildiv(nrows, TPB);
-  dim3 blks(nblksx, ncols);
-  naiveHistKernel<<<blks, TPB, 0, stream>>>(bins, nbins, in, nrows);
+  dim3 blks(nblksx, std::min(ncols, 65535));
+  naiveHistKernel<<<blks, TPB, 0, stream>>>(bins, nbins, in, nrows, ncols);
   RAFT_CUDA_TRY(cudaGetLastError());
 }
 
@@ -298,6 +301,21 @@ const std::vector<HistInputs> inputs = {
   {oneM + 1, 21, 2 * oneK, true, HistTypeAuto, 1000, 50, 1234ULL},
   {oneM + 2, 21, 2 * oneK, false, HistTypeAuto, 0, 2 * oneK, 1234ULL},
   {oneM + 2, 21, 2 * oneK, true, HistTypeAuto, 1000, 50, 1234ULL},
+
+  {oneM, 1, 256, false, HistTypeSmemWarp, 0, 256, 1234ULL},
+  {oneM, 1, 256, true, HistTypeSmemWarp, 100, 5, 1234ULL},
+  {oneM + 1, 1, 256, false, HistTypeSmemWarp, 0, 256, 1234ULL},
+  {oneM + 1, 1, 256, true, HistTypeSmemWarp, 100, 5, 1234ULL},
+  {oneM + 2, 21, 256, false, HistTypeSmemWarp, 0, 256, 1234ULL},
+  {oneM + 2, 21, 256, true, HistTypeSmemWarp, 100, 5, 1234ULL},
+  {oneM, 21, 64, true, HistTypeAuto, 30, 2, 1234ULL},
+
+  // more columns than the largest y-dimension of a grid, processed in the same launch
+  {64, 70000, 256, false, HistTypeAuto, 0, 256, 1234ULL},
+  {65, 70000, 256, true, HistTypeSmem, 100, 5, 1234ULL},
+  {100, 70000, 256, false, HistTypeSmemBits8, 0, 256, 1234ULL},
+  {64, 70000, 100, false, HistTypeGmem, 0, 100, 1234ULL},
+  {63, 70000, 300, false, HistTypeSmemHash, 0, 300, 1234ULL},
 };
 
 TEST_P(HistTest, Result)
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/stats/moments_accumulator.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace raft {
+namespace stats {
+
+template <typename T>
+struct MomentsAccumulatorInputs {
+  T tolerance;
+  int n_rows, n_cols, batch_rows;
+  T offset;
+  bool sample;
+  unsigned long long int seed;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const MomentsAccumulatorInputs<T>& p)
+{
+  os << "{" << p.n_rows << ", " << p.n_cols << ", batch_rows " << p.batch_rows << ", offset "
+     << p.offset << ", sample " << p.sample << "}";
+  return os;
+}
+
+/**
+ * Feed the rows by batches to one accumulator, and by halves to two accumulators then merged:
+ * both must give the moments of the whole matrix (computed on the host in double precision).
+ */
+template <typename T>
+class MomentsAccumulatorTest : public ::testing::TestWithParam<MomentsAccumulatorInputs<T>> {
+ public:
+  MomentsAccumulatorTest()
+    : params(::testing::TestWithParam<MomentsAccumulatorInputs<T>>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void feed(moments_accumulator<T>& acc, const T* data, int64_t row0, int64_t row1)
+  {
+    for (int64_t r = row0; r < row1; r += params.batch_rows) {
+      int64_t rows = std::min<int64_t>(params.batch_rows, row1 - r);
+      acc.update(handle,
+                 raft::make_device_matrix_view<const T, int64_t>(
+                   data + r * params.n_cols, rows, params.n_cols));
+    }
+  }
+
+  void check(const moments_accumulator<T>& acc,
+             const std::vector<double>& exp_mean,
+             const std::vector<double>& exp_var,
+             const std::vector<double>& exp_cov)
+  {
+    int D = params.n_cols;
+    ASSERT_EQ(acc.count(), params.n_rows);
+    auto mean = raft::make_device_vector<T, int64_t>(handle, D);
+    auto var  = raft::make_device_vector<T, int64_t>(handle, D);
+    auto cov  = raft::make_device_matrix<T, int64_t>(handle, D, D);
+    acc.mean(handle, mean.view());
+    acc.var(handle, var.view(), params.sample);
+    acc.cov(handle, cov.view(), params.sample);
+    std::vector<T> h_mean(D), h_var(D), h_cov(size_t(D) * D);
+    raft::update_host(h_mean.data(), mean.data_handle(), D, stream);
+    raft::update_host(h_var.data(), var.data_handle(), D, stream);
+    raft::update_host(h_cov.data(), cov.data_handle(), h_cov.size(), stream);
+    resource::sync_stream(handle, stream);
+    auto cmp = raft::CompareApprox<T>(params.tolerance);
+    for (int j = 0; j < D; j++) {
+      ASSERT_TRUE(raft::match(T(exp_mean[j]), h_mean[j], cmp)) << "mean " << j;
+      ASSERT_TRUE(raft::match(T(exp_var[j]), h_var[j], cmp)) << "var " << j;
+      ASSERT_TRUE(raft::match(T(exp_var[j]), h_cov[size_t(j) * D + j], cmp)) << "cov " << j;
+    }
+    for (size_t e = 0; e < h_cov.size(); e++) {
+      ASSERT_TRUE(raft::match(T(exp_cov[e]), h_cov[e], cmp)) << "cov element " << e;
+    }
+  }
+
+  void Run()
+  {
+    int N = params.n_rows, D = params.n_cols;
+    // correlated columns, far from zero: the naive E[x^2] - E[x]^2 would lose the variances
+    std::mt19937 gen(params.seed);
+    std::normal_distribution<double> dist;
+    std::vector<T> h_data(size_t(N) * D);
+    for (int i = 0; i < N; i++) {
+      double common = dist(gen);
+      for (int j = 0; j < D; j++) {
+        h_data[size_t(i) * D + j] = params.offset + (j + 1) * (0.5 * common + dist(gen));
+      }
+    }
+    std::vector<double> exp_mean(D, 0), exp_var(D), exp_cov(size_t(D) * D, 0);
+    for (int i = 0; i < N; i++) {
+      for (int j = 0; j < D; j++) {
+        exp_mean[j] += double(h_data[size_t(i) * D + j]) / N;
+      }
+    }
+    for (int i = 0; i < N; i++) {
+      for (int j = 0; j < D; j++) {
+        for (int l = 0; l < D; l++) {
+          exp_cov[size_t(j) * D + l] +=
+            (h_data[size_t(i) * D + j] - exp_mean[j]) * (h_data[size_t(i) * D + l] - exp_mean[l]);
+        }
+      }
+    }
+    for (auto& c : exp_cov) {
+      c /= N - int(params.sample);
+    }
+    for (int j = 0; j < D; j++) {
+      exp_var[j] = exp_cov[size_t(j) * D + j];
+    }
+
+    auto data = raft::make_device_vector<T, int64_t>(handle, int64_t(N) * D);
+    raft::update_device(data.data_handle(), h_data.data(), h_data.size(), stream);
+
+    moments_accumulator<T> acc(handle, D, true);
+    feed(acc, data.data_handle(), 0, N);
+    check(acc, exp_mean, exp_var, exp_cov);
+
+    moments_accumulator<T> first(handle, D, true);
+    moments_accumulator<T> second(handle, D, true);
+    feed(first, data.data_handle(), 0, N / 3);
+    feed(second, data.data_handle(), N / 3, N);
+    first.merge(handle, second);
+    check(first, exp_mean, exp_var, exp_cov);
+
+    // again after a reset
+    acc.reset(handle);
+    ASSERT_EQ(acc.count(), 0);
+    feed(acc, data.data_handle(), 0, N);
+    check(acc, exp_mean, exp_var, exp_cov);
+  }
+
+  raft::resources handle;
+  MomentsAccumulatorInputs<T> params;
+  cudaStream_t stream = 0;
+};
+
+// batches dividing the rows, not dividing them, single rows and a single batch
+const std::vector<MomentsAccumulatorInputs<float>> inputsf = {
+  {0.001f, 10000, 8, 1000, 0.f, true, 1234ULL},
+  {0.001f, 10000, 8, 777, 1000.f, true, 1234ULL},
+  {0.001f, 300, 5, 1, 10.f, false, 1234ULL},
+  {0.001f, 3000, 33, 5000, 1000.f, false, 1234ULL}};
+const std::vector<MomentsAccumulatorInputs<double>> inputsd = {
+  {0.000001, 10000, 8, 777, 1e6, true, 1234ULL},
+  {0.000001, 300, 5, 1, 10.0, false, 1234ULL},
+  {0.000001, 3000, 33, 512, 1000.0, true, 1234ULL}};
+
+typedef MomentsAccumulatorTest<float> MomentsAccumulatorTestF;
+TEST_P(MomentsAccumulatorTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(MomentsAccumulatorTests,
+                        MomentsAccumulatorTestF,
+                        ::testing::ValuesIn(inputsf));
+
+typedef MomentsAccumulatorTest<double> MomentsAccumulatorTestD;
+TEST_P(MomentsAccumulatorTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(MomentsAccumulatorTests,
+                        MomentsAccumulatorTestD,
+                        ::testing::ValuesIn(inputsd));
+
+}  // end namespace stats
+}  // end namespace raft
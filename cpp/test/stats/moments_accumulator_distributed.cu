@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/stats/moments_accumulator.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace raft::stats {
+
+template <typename T>
+struct MomentsAllreduceInputs {
+  T tolerance;
+  int n_ranks;
+  int n_rows, n_cols, batch_rows;
+  bool with_cov;
+  bool empty_rank;
+};
+
+template <typename T>
+::std::ostream& operator<<(::std::ostream& os, const MomentsAllreduceInputs<T>& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", " << p.n_rows << ", " << p.n_cols << ", batch_rows "
+     << p.batch_rows << ", with_cov " << p.with_cov << ", empty_rank " << p.empty_rank << "}";
+  return os;
+}
+
+/**
+ * The rows are split in contiguous blocks across the ranks of an in-process clique (with
+ * `empty_rank`, the first rank gets none), and every rank feeds its block by batches: after
+ * allreduce, every rank should hold the moments of the accumulators of the blocks merged (in the
+ * order of the ranks) on one device.
+ */
+template <typename T>
+class MomentsAllreduceTest : public ::testing::TestWithParam<MomentsAllreduceInputs<T>> {
+ protected:
+  /** The mean, sample variance and (if with_cov) sample covariance, concatenated on the host. */
+  static auto moments(const raft::resources& handle, const moments_accumulator<T>& acc)
+    -> std::vector<T>
+  {
+    auto stream = resource::get_cuda_stream(handle);
+    int64_t D   = acc.n_cols();
+    auto mean   = raft::make_device_vector<T, int64_t>(handle, D);
+    auto var    = raft::make_device_vector<T, int64_t>(handle, D);
+    acc.mean(handle, mean.view());
+    acc.var(handle, var.view(), true);
+    std::vector<T> out(2 * D + (acc.with_cov() ? D * D : 0));
+    raft::update_host(out.data(), mean.data_handle(), D, stream);
+    raft::update_host(out.data() + D, var.data_handle(), D, stream);
+    if (acc.with_cov()) {
+      auto cov = raft::make_device_matrix<T, int64_t>(handle, D, D);
+      acc.cov(handle, cov.view(), true);
+      raft::update_host(out.data() + 2 * D, cov.data_handle(), D * D, stream);
+    }
+    resource::sync_stream(handle);
+    return out;
+  }
+
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<MomentsAllreduceInputs<T>>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    int n_rows = p.n_rows, n_cols = p.n_cols;
+    // correlated columns, far from zero
+    std::mt19937 gen(1234);
+    std::normal_distribution<double> dist;
+    std::vector<T> h_data(size_t(n_rows) * n_cols);
+    for (int i = 0; i < n_rows; i++) {
+      double common = dist(gen);
+      for (int j = 0; j < n_cols; j++) {
+        h_data[size_t(i) * n_cols + j] = 100.0 + (j + 1) * (0.5 * common + dist(gen));
+      }
+    }
+    int n_data_ranks = p.n_ranks - int(p.empty_rank);
+    auto shard_begin = [&](int rank) {
+      return int(int64_t(n_rows) * std::max(rank - int(p.empty_rank), 0) / n_data_ranks);
+    };
+    auto add_shard = [&](const raft::resources& handle, moments_accumulator<T>& acc, int rank) {
+      int begin = shard_begin(rank);
+      int rows  = shard_begin(rank + 1) - begin;
+      auto data = raft::make_device_matrix<T, int64_t>(handle, rows, n_cols);
+      raft::update_device(data.data_handle(),
+                          h_data.data() + size_t(begin) * n_cols,
+                          size_t(rows) * n_cols,
+                          resource::get_cuda_stream(handle));
+      for (int r = 0; r < rows; r += p.batch_rows) {
+        int batch = std::min(p.batch_rows, rows - r);
+        acc.update(handle,
+                   raft::make_device_matrix_view<const T, int64_t>(
+                     data.data_handle() + size_t(r) * n_cols, batch, n_cols));
+      }
+      resource::sync_stream(handle);
+    };
+
+    // the reference: the accumulators of the shards merged on the first device
+    std::vector<T> expected;
+    {
+      raft::resources handle;
+      moments_accumulator<T> merged(handle, n_cols, p.with_cov);
+      add_shard(handle, merged, 0);
+      for (int rank = 1; rank < p.n_ranks; rank++) {
+        moments_accumulator<T> other(handle, n_cols, p.with_cov);
+        add_shard(handle, other, rank);
+        merged.merge(handle, other);
+      }
+      ASSERT_EQ(merged.count(), int64_t(n_rows));
+      expected = moments(handle, merged);
+    }
+
+    nccl_clique clique(p.n_ranks);
+    std::vector<std::vector<T>> actual(p.n_ranks);
+    std::vector<int64_t> actual_counts(p.n_ranks);
+    clique.run([&](int rank, const raft::resources& handle) {
+      moments_accumulator<T> acc(handle, n_cols, p.with_cov);
+      add_shard(handle, acc, rank);
+      acc.allreduce(handle);
+      actual_counts[rank] = acc.count();
+      actual[rank]        = moments(handle, acc);
+    });
+
+    for (int rank = 0; rank < p.n_ranks; rank++) {
+      ASSERT_EQ(actual_counts[rank], int64_t(n_rows)) << "rank " << rank;
+      // the ranks hold the same moments
+      ASSERT_TRUE(hostVecMatch(actual[0], actual[rank], raft::Compare<T>())) << "rank " << rank;
+    }
+    ASSERT_TRUE(hostVecMatch(expected, actual[0], raft::CompareApprox<T>(p.tolerance)));
+  }
+};
+
+const std::vector<MomentsAllreduceInputs<float>> inputsf = {
+  {0.001f, 1, 10000, 8, 777, true, false},
+  {0.001f, 2, 10000, 8, 777, true, false},
+  {0.001f, 2, 3001, 33, 512, false, false},
+  {0.001f, 2, 3001, 33, 512, true, true},
+  {0.001f, 2, 300, 5, 1, false, true}};
+const std::vector<MomentsAllreduceInputs<double>> inputsd = {
+  {0.000001, 2, 10000, 8, 1000, true, false}, {0.000001, 2, 3001, 33, 512, true, true}};
+
+typedef MomentsAllreduceTest<float> MomentsAllreduceTestF;
+TEST_P(MomentsAllreduceTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(MomentsAllreduceTests, MomentsAllreduceTestF, ::testing::ValuesIn(inputsf));
+
+typedef MomentsAllreduceTest<double> MomentsAllreduceTestD;
+TEST_P(MomentsAllreduceTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(MomentsAllreduceTests, MomentsAllreduceTestD, ::testing::ValuesIn(inputsd));
+
+}  // namespace raft::stats
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2019-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2019-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -150,6 +150,11 @@ const std::vector<mutualInfoParam> inputs = {{199, 1, 10, false, 0.000001},
                                              {198, 1, 100, true, 0.000001},
                                              {300, 3, 99, true, 0.000001}};
 
+// label ranges large enough for the sparse contingency matrix
+const std::vector<mutualInfoParam> sparse_inputs = {{20000, 1, 2000, false, 0.000001},
+                                                    {20000, 1, 2000, true, 0.000001},
+                                                    {50000, 7, 3000, false, 0.000001}};
+
 // writing the test suite
 typedef mutualInfoTest<int> mutualInfoTestClass;
 TEST_P(mutualInfoTestClass, Result)
@@ -157,6 +162,7 @@ TEST_P(mutualInfoTestClass, Result)
   ASSERT_NEAR(computedmutualInfo, truthmutualInfo, params.tolerance);
 }
 INSTANTIATE_TEST_CASE_P(mutualInfo, mutualInfoTestClass, ::testing::ValuesIn(inputs));
+INSTANTIATE_TEST_CASE_P(mutualInfoSparse, mutualInfoTestClass, ::testing::ValuesIn(sparse_inputs));
 
 }  // end namespace stats
 }  // end namespace raft
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2023, NVIDIA CORPORATION.
+ * Copyright (c) 2023-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -136,6 +136,56 @@ class NeighborhoodRecallTest : public ::testing::TestWithParam<NeighborhoodRecal
                             raft::CompareApprox<double>(0.01)));
     ASSERT_TRUE(
       raft::match(recall_h, *recall_scalar.data_handle(), raft::CompareApprox<double>(0.01)));
+
+    // the recall of every query
+    auto per_query     = raft::make_device_vector<double, IdxT>(res, ps.n_rows);
+    auto s4            = 0;
+    auto unused_scalar = raft::make_host_scalar<double>(s4);
+    neighborhood_recall<IdxT, IdxT, double, DistanceT>(res,
+                                                       raft::make_const_mdspan(indices_1.view()),
+                                                       raft::make_const_mdspan(indices_2.view()),
+                                                       unused_scalar.view(),
+                                                       std::nullopt,
+                                                       std::nullopt,
+                                                       std::nullopt,
+                                                       per_query.view());
+    std::vector<double> per_query_h(ps.n_rows);
+    raft::update_host(
+      per_query_h.data(), per_query.data_handle(), ps.n_rows, raft::resource::get_cuda_stream(res));
+    raft::resource::sync_stream(res);
+    for (int i = 0; i < ps.n_rows; i++) {
+      std::vector<IdxT> row_1(indices_1_h.begin() + i * ps.k, indices_1_h.begin() + (i + 1) * ps.k);
+      std::vector<IdxT> row_2(indices_2_h.begin() + i * ps.k, indices_2_h.begin() + (i + 1) * ps.k);
+      [[maybe_unused]] auto [row_recall, mc, tc] =
+        raft::neighbors::calc_recall(row_2, row_1, 1, ps.k);
+      ASSERT_TRUE(raft::match(row_recall, per_query_h[i], raft::CompareApprox<double>(1e-9)))
+        << "query " << i;
+    }
+
+    // the neighbors of other indices at the same distances (in another order) are all matches
+    if (ps.k > ps.n_rows) { return; }
+    std::vector<IdxT> shifted_h(queries_size);
+    std::vector<DistanceT> permuted_h(queries_size);
+    for (int i = 0; i < ps.n_rows; i++) {
+      for (int j = 0; j < ps.k; j++) {
+        shifted_h[i * ps.k + j]  = indices_1_h[i * ps.k + j] + IdxT(ps.n_rows);
+        permuted_h[i * ps.k + j] = distances_1_h[i * ps.k + (ps.k - 1 - j)];
+      }
+    }
+    auto shifted  = raft::make_device_matrix<IdxT, IdxT>(res, ps.n_rows, ps.k);
+    auto permuted = raft::make_device_matrix<DistanceT, IdxT>(res, ps.n_rows, ps.k);
+    auto stream   = raft::resource::get_cuda_stream(res);
+    raft::update_device(shifted.data_handle(), shifted_h.data(), queries_size, stream);
+    raft::update_device(permuted.data_handle(), permuted_h.data(), queries_size, stream);
+    auto s5          = 0;
+    auto ties_scalar = raft::make_host_scalar<double>(s5);
+    neighborhood_recall<IdxT, IdxT, double, DistanceT>(res,
+                                                       raft::make_const_mdspan(shifted.view()),
+                                                       raft::make_const_mdspan(indices_1.view()),
+                                                       ties_scalar.view(),
+                                                       raft::make_const_mdspan(permuted.view()),
+                                                       raft::make_const_mdspan(distances_1.view()));
+    ASSERT_TRUE(raft::match(1.0, *ties_scalar.data_handle(), raft::CompareApprox<double>(1e-6)));
   }
 
   void SetUp() override
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../test_utils.cuh"
+#include <gtest/gtest.h>
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/core/resources.hpp>
+#include <raft/stats/quantile_sketch.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace raft {
+namespace stats {
+
+struct QuantileSketchInputs {
+  int n_rows, n_cols, batch_rows, compression;
+  double tolerance;
+  unsigned long long int seed;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const QuantileSketchInputs& p)
+{
+  os << "{" << p.n_rows << ", " << p.n_cols << ", batch_rows " << p.batch_rows
+     << ", compression " << p.compression << "}";
+  return os;
+}
+
+/**
+ * The columns are normal, exponential (skewed) and uniform. The estimated quantiles must have
+ * ranks (among the sorted columns) within `tolerance` of the probabilities, with the extreme
+ * ones exact; by batches to one sketch, and by parts to two sketches then merged.
+ */
+template <typename T>
+class QuantileSketchTest : public ::testing::TestWithParam<QuantileSketchInputs> {
+ public:
+  QuantileSketchTest()
+    : params(::testing::TestWithParam<QuantileSketchInputs>::GetParam()),
+      stream(resource::get_cuda_stream(handle))
+  {
+  }
+
+ protected:
+  void feed(quantile_sketch<T>& sketch, const T* data, int64_t row0, int64_t row1)
+  {
+    for (int64_t r = row0; r < row1; r += params.batch_rows) {
+      int64_t rows = std::min<int64_t>(params.batch_rows, row1 - r);
+      sketch.update(handle,
+                    raft::make_device_matrix_view<const T, int64_t>(
+                      data + r * params.n_cols, rows, params.n_cols));
+    }
+  }
+
+  void check(const quantile_sketch<T>& sketch, const std::vector<std::vector<T>>& sorted_cols)
+  {
+    int D = params.n_cols;
+    int N = params.n_rows;
+    ASSERT_EQ(sketch.count(), N);
+    std::vector<T> h_probs = {0, 0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999, 1};
+    int n_probs            = h_probs.size();
+    auto probs             = raft::make_device_vector<T, int64_t>(handle, n_probs);
+    auto out               = raft::make_device_matrix<T, int64_t>(handle, n_probs, D);
+    raft::update_device(probs.data_handle(), h_probs.data(), n_probs, stream);
+    sketch.quantiles(handle, raft::make_const_mdspan(probs.view()), out.view());
+    std::vector<T> h_out(size_t(n_probs) * D);
+    raft::update_host(h_out.data(), out.data_handle(), h_out.size(), stream);
+    resource::sync_stream(handle, stream);
+    for (int c = 0; c < D; c++) {
+      const auto& col = sorted_cols[c];
+      ASSERT_EQ(h_out[c], col.front()) << "the minimum of column " << c;
+      ASSERT_EQ(h_out[size_t(n_probs - 1) * D + c], col.back()) << "the maximum of column " << c;
+      for (int p = 1; p < n_probs - 1; p++) {
+        T x       = h_out[size_t(p) * D + c];
+        double lo = std::lower_bound(col.begin(), col.end(), x) - col.begin();
+        double hi = std::upper_bound(col.begin(), col.end(), x) - col.begin();
+        // the error on the ranks shrinks at the tails
+        double q   = h_probs[p];
+        double tol = params.tolerance * std::max(4 * q * (1 - q), 0.1);
+        ASSERT_NEAR(0.5 * (lo + hi) / N, q, tol) << "column " << c << ", quantile " << q;
+      }
+    }
+  }
+
+  void Run()
+  {
+    int N = params.n_rows, D = params.n_cols;
+    std::mt19937 gen(params.seed);
+    std::normal_distribution<double> normal(10.0, 3.0);
+    std::exponential_distribution<double> exponential(0.5);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::vector<T> h_data(size_t(N) * D);
+    std::vector<std::vector<T>> sorted_cols(D, std::vector<T>(N));
+    for (int i = 0; i < N; i++) {
+      for (int c = 0; c < D; c++) {
+        double x = c % 3 == 0 ? normal(gen) : c % 3 == 1 ? exponential(gen) : uniform(gen);
+        h_data[size_t(i) * D + c] = x;
+        sorted_cols[c][i]         = h_data[size_t(i) * D + c];
+      }
+    }
+    for (auto& col : sorted_cols) {
+      std::sort(col.begin(), col.end());
+    }
+    auto data = raft::make_device_vector<T, int64_t>(handle, int64_t(N) * D);
+    raft::update_device(data.data_handle(), h_data.data(), h_data.size(), stream);
+
+    quantile_sketch<T> sketch(handle, D, params.compression);
+    feed(sketch, data.data_handle(), 0, N);
+    check(sketch, sorted_cols);
+
+    quantile_sketch<T> first(handle, D, params.compression);
+    quantile_sketch<T> second(handle, D, params.compression);
+    feed(first, data.data_handle(), 0, N / 3);
+    feed(second, data.data_handle(), N / 3, N);
+    first.merge(handle, second);
+    check(first, sorted_cols);
+  }
+
+  raft::resources handle;
+  QuantileSketchInputs params;
+  cudaStream_t stream = 0;
+};
+
+const std::vector<QuantileSketchInputs> inputs = {{100000, 3, 10000, 200, 0.01, 1234ULL},
+                                                  {100000, 7, 7777, 100, 0.02, 1234ULL},
+                                                  {5000, 5, 1, 500, 0.01, 1234ULL},
+                                                  {20000, 4, 100000, 50, 0.04, 1234ULL}};
+
+typedef QuantileSketchTest<float> QuantileSketchTestF;
+TEST_P(QuantileSketchTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(QuantileSketchTests, QuantileSketchTestF, ::testing::ValuesIn(inputs));
+
+typedef QuantileSketchTest<double> QuantileSketchTestD;
+TEST_P(QuantileSketchTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(QuantileSketchTests, QuantileSketchTestD, ::testing::ValuesIn(inputs));
+
+}  // end namespace stats
+}  // end namespace raft
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../comms/nccl_clique.hpp"
+#include "../test_utils.cuh"
+
+#include <raft/core/device_mdarray.hpp>
+#include <raft/core/resource/cuda_stream.hpp>
+#include <raft/stats/quantile_sketch.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace raft::stats {
+
+struct QuantileAllreduceInputs {
+  double tolerance;
+  int n_ranks;
+  int n_rows, n_cols, batch_rows, compression;
+  bool empty_rank;
+};
+
+::std::ostream& operator<<(::std::ostream& os, const QuantileAllreduceInputs& p)
+{
+  os << "{n_ranks " << p.n_ranks << ", " << p.n_rows << ", " << p.n_cols << ", batch_rows "
+     << p.batch_rows << ", compression " << p.compression << ", empty_rank " << p.empty_rank
+     << "}";
+  return os;
+}
+
+/**
+ * The rows are split in contiguous blocks across the ranks of an in-process clique (with
+ * `empty_rank`, the first rank gets none), and every rank feeds its block by batches: after
+ * allreduce, every rank should hold the same sketch, whose extrema are those of a sketch fed with
+ * all the batches on one device and whose other quantiles have ranks (among the sorted columns)
+ * within `tolerance` of it.
+ */
+template <typename T>
+class QuantileAllreduceTest : public ::testing::TestWithParam<QuantileAllreduceInputs> {
+ protected:
+  /** The quantiles [n_probs, n_cols] of the sketch at `probs`, on the host. */
+  static auto quantiles(const raft::resources& handle,
+                        const quantile_sketch<T>& sketch,
+                        const std::vector<T>& h_probs) -> std::vector<T>
+  {
+    auto stream  = resource::get_cuda_stream(handle);
+    auto n_probs = int64_t(h_probs.size());
+    auto probs   = raft::make_device_vector<T, int64_t>(handle, n_probs);
+    auto out     = raft::make_device_matrix<T, int64_t>(handle, n_probs, sketch.n_cols());
+    raft::update_device(probs.data_handle(), h_probs.data(), n_probs, stream);
+    sketch.quantiles(handle, raft::make_const_mdspan(probs.view()), out.view());
+    std::vector<T> h_out(n_probs * sketch.n_cols());
+    raft::update_host(h_out.data(), out.data_handle(), h_out.size(), stream);
+    resource::sync_stream(handle);
+    return h_out;
+  }
+
+  void Run()
+  {
+    auto p = ::testing::TestWithParam<QuantileAllreduceInputs>::GetParam();
+    if (!nccl_clique::fits(p.n_ranks)) { GTEST_SKIP() << "not enough devices"; }
+
+    int N = p.n_rows, D = p.n_cols;
+    // normal, exponential (skewed) and uniform columns
+    std::mt19937 gen(1234);
+    std::normal_distribution<double> normal(10.0, 3.0);
+    std::exponential_distribution<double> exponential(0.5);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::vector<T> h_data(size_t(N) * D);
+    std::vector<std::vector<T>> sorted_cols(D, std::vector<T>(N));
+    for (int i = 0; i < N; i++) {
+      for (int c = 0; c < D; c++) {
+        double x = c % 3 == 0 ? normal(gen) : c % 3 == 1 ? exponential(gen) : uniform(gen);
+        h_data[size_t(i) * D + c] = x;
+        sorted_cols[c][i]         = h_data[size_t(i) * D + c];
+      }
+    }
+    for (auto& col : sorted_cols) {
+      std::sort(col.begin(), col.end());
+    }
+    int n_data_ranks = p.n_ranks - int(p.empty_rank);
+    auto shard_begin = [&](int rank) {
+      return int(int64_t(N) * std::max(rank - int(p.empty_rank), 0) / n_data_ranks);
+    };
+    auto add_shard = [&](const raft::resources& handle, quantile_sketch<T>& sketch, int rank) {
+      int begin = shard_begin(rank);
+      int rows  = shard_begin(rank + 1) - begin;
+      auto data = raft::make_device_matrix<T, int64_t>(handle, rows, D);
+      raft::update_device(data.data_handle(),
+                          h_data.data() + size_t(begin) * D,
+                          size_t(rows) * D,
+                          resource::get_cuda_stream(handle));
+      for (int r = 0; r < rows; r += p.batch_rows) {
+        int batch = std::min(p.batch_rows, rows - r);
+        sketch.update(handle,
+                      raft::make_device_matrix_view<const T, int64_t>(
+                        data.data_handle() + size_t(r) * D, batch, D));
+      }
+      resource::sync_stream(handle);
+    };
+
+    std::vector<T> h_probs = {0, 0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999, 1};
+    int n_probs            = h_probs.size();
+
+    // the reference: one sketch fed with all the batches on the first device
+    std::vector<T> expected;
+    {
+      raft::resources handle;
+      quantile_sketch<T> sketch(handle, D, p.compression);
+      for (int rank = 0; rank < p.n_ranks; rank++) {
+        add_shard(handle, sketch, rank);
+      }
+      ASSERT_EQ(sketch.count(), int64_t(N));
+      expected = quantiles(handle, sketch, h_probs);
+    }
+
+    nccl_clique clique(p.n_ranks);
+    std::vector<std::vector<T>> actual(p.n_ranks);
+    std::vector<int64_t> actual_counts(p.n_ranks);
+    clique.run([&](int rank, const raft::resources& handle) {
+      quantile_sketch<T> sketch(handle, D, p.compression);
+      add_shard(handle, sketch, rank);
+      sketch.allreduce(handle);
+      actual_counts[rank] = sketch.count();
+      actual[rank]        = quantiles(handle, sketch, h_probs);
+    });
+
+    for (int rank = 0; rank < p.n_ranks; rank++) {
+      ASSERT_EQ(actual_counts[rank], int64_t(N)) << "rank " << rank;
+      // the ranks hold the same sketch
+      ASSERT_TRUE(hostVecMatch(actual[0], actual[rank], raft::Compare<T>())) << "rank " << rank;
+    }
+    auto rank_of = [&](const std::vector<T>& col, T x) {
+      double lo = std::lower_bound(col.begin(), col.end(), x) - col.begin();
+      double hi = std::upper_bound(col.begin(), col.end(), x) - col.begin();
+      return 0.5 * (lo + hi) / N;
+    };
+    for (int c = 0; c < D; c++) {
+      const auto& col = sorted_cols[c];
+      ASSERT_EQ(actual[0][c], expected[c]) << "the minimum of column " << c;
+      size_t last = size_t(n_probs - 1) * D + c;
+      ASSERT_EQ(actual[0][last], expected[last]) << "the maximum of column " << c;
+      for (int i = 1; i < n_probs - 1; i++) {
+        size_t k = size_t(i) * D + c;
+        // the error on the ranks shrinks at the tails
+        double q   = h_probs[i];
+        double tol = p.tolerance * std::max(4 * q * (1 - q), 0.1);
+        ASSERT_NEAR(rank_of(col, actual[0][k]), rank_of(col, expected[k]), tol)
+          << "column " << c << ", quantile " << q;
+      }
+    }
+  }
+};
+
+const std::vector<QuantileAllreduceInputs> inputs = {{0.01, 1, 100000, 3, 10000, 200, false},
+                                                     {0.01, 2, 100000, 3, 10000, 200, false},
+                                                     {0.02, 2, 100000, 7, 7777, 100, true},
+                                                     {0.01, 2, 5000, 5, 1, 500, true},
+                                                     {0.04, 2, 20000, 4, 100000, 50, false}};
+
+typedef QuantileAllreduceTest<float> QuantileAllreduceTestF;
+TEST_P(QuantileAllreduceTestF, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(QuantileAllreduceTests,
+                        QuantileAllreduceTestF,
+                        ::testing::ValuesIn(inputs));
+
+typedef QuantileAllreduceTest<double> QuantileAllreduceTestD;
+TEST_P(QuantileAllreduceTestD, Result) { Run(); }
+INSTANTIATE_TEST_CASE_P(QuantileAllreduceTests,
+                        QuantileAllreduceTestD,
+                        ::testing::ValuesIn(inputs));
+
+}  // namespace raft::stats
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2021-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -186,6 +186,37 @@ class silhouetteScoreTest : public ::testing::TestWithParam<silhouetteScoreParam
       nLabels,
       chunk,
       params.metric);
+
+    // a workspace of a few tiles of chunk x chunk distances
+    tiledSilhouetteScore = raft::stats::silhouette_score_tiled(
+      handle,
+      raft::make_device_matrix_view<const DataT>(d_X.data(), nRows, nCols),
+      raft::make_device_vector_view<const LabelT>(d_labels.data(), nRows),
+      std::nullopt,
+      nLabels,
+      size_t(4) * chunk * chunk * sizeof(DataT),
+      params.metric);
+
+    sampledAll = raft::stats::silhouette_score_sampled(
+      handle,
+      raft::make_device_matrix_view<const DataT>(d_X.data(), nRows, nCols),
+      raft::make_device_vector_view<const LabelT>(d_labels.data(), nRows),
+      nLabels,
+      nRows,
+      0ULL,
+      0.95,
+      size_t(4) * chunk * chunk * sizeof(DataT),
+      params.metric);
+    sampledPart = raft::stats::silhouette_score_sampled(
+      handle,
+      raft::make_device_matrix_view<const DataT>(d_X.data(), nRows, nCols),
+      raft::make_device_vector_view<const LabelT>(d_labels.data(), nRows),
+      nLabels,
+      std::max(2, nRows / 2),
+      1234ULL,
+      0.95,
+      size_t(4) * chunk * chunk * sizeof(DataT),
+      params.metric);
   }
 
   // declaring the data values
@@ -201,6 +232,9 @@ class silhouetteScoreTest : public ::testing::TestWithParam<silhouetteScoreParam
   double truthSilhouetteScore    = 0;
   double computedSilhouetteScore = 0;
   double batchedSilhouetteScore  = 0;
+  double tiledSilhouetteScore    = 0;
+  score_estimate<DataT> sampledAll{};
+  score_estimate<DataT> sampledPart{};
   int chunk;
 };
 
@@ -220,6 +254,10 @@ TEST_P(silhouetteScoreTestClass, Result)
 {
   ASSERT_NEAR(computedSilhouetteScore, truthSilhouetteScore, params.tolerance);
   ASSERT_NEAR(batchedSilhouetteScore, truthSilhouetteScore, params.tolerance);
+  ASSERT_NEAR(tiledSilhouetteScore, truthSilhouetteScore, params.tolerance);
+  ASSERT_NEAR(sampledAll.score, truthSilhouetteScore, params.tolerance);
+  ASSERT_EQ(sampledAll.std_error, DataT(0));
+  ASSERT_TRUE(sampledPart.lower <= sampledPart.score && sampledPart.score <= sampledPart.upper);
 }
 INSTANTIATE_TEST_CASE_P(silhouetteScore, silhouetteScoreTestClass, ::testing::ValuesIn(inputs));
 
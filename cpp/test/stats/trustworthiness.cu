@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2023, NVIDIA CORPORATION.
+ * Copyright (c) 2018-2024, NVIDIA CORPORATION.
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -22,6 +22,8 @@
 #include <raft/util/cudart_utils.hpp>
 
 #include <raft/stats/trustworthiness_score.cuh>
+
+#include <cmath>
 #include <vector>
 
 namespace raft {
@@ -331,6 +333,36 @@ class TrustworthinessScoreTest : public ::testing::Test {
       raft::make_device_matrix_view<const float>(
         d_X_embedded.data(), n_sample, n_features_embedded),
       5);
+
+    // the same score with batches and tiles of distances of a few samples only
+    score_tiled = trustworthiness_score<raft::distance::DistanceType::L2SqrtUnexpanded, float>(
+      handle,
+      raft::make_device_matrix_view<const float>(d_X.data(), n_sample, n_features_origin),
+      raft::make_device_matrix_view<const float>(
+        d_X_embedded.data(), n_sample, n_features_embedded),
+      5,
+      512,
+      size_t(4096));
+
+    // the sampled estimate: exact with all the samples, an interval around it otherwise
+    estimate_all =
+      trustworthiness_score_sampled<raft::distance::DistanceType::L2SqrtUnexpanded, float>(
+        handle,
+        raft::make_device_matrix_view<const float>(d_X.data(), n_sample, n_features_origin),
+        raft::make_device_matrix_view<const float>(
+          d_X_embedded.data(), n_sample, n_features_embedded),
+        5,
+        n_sample);
+    estimate_part =
+      trustworthiness_score_sampled<raft::distance::DistanceType::L2SqrtUnexpanded, float>(
+        handle,
+        raft::make_device_matrix_view<const float>(d_X.data(), n_sample, n_features_origin),
+        raft::make_device_matrix_view<const float>(
+          d_X_embedded.data(), n_sample, n_features_embedded),
+        5,
+        20,
+        42ULL,
+        0.99);
   }
 
   void SetUp() override { basicTest(); }
@@ -344,9 +376,21 @@ class TrustworthinessScoreTest : public ::testing::Test {
   rmm::device_uvector<float> d_X_embedded;
 
   double score;
+  double score_tiled;
+  score_estimate<double> estimate_all;
+  score_estimate<double> estimate_part;
 };
 
 typedef TrustworthinessScoreTest TrustworthinessScoreTestF;
 TEST_F(TrustworthinessScoreTestF, Result) { ASSERT_TRUE(0.9375 < score && score < 0.9379); }
+TEST_F(TrustworthinessScoreTestF, Tiled) { ASSERT_NEAR(score_tiled, score, 1e-9); }
+TEST_F(TrustworthinessScoreTestF, Sampled)
+{
+  ASSERT_NEAR(estimate_all.score, score, 1e-9);
+  ASSERT_EQ(estimate_all.std_error, 0.0);
+  ASSERT_TRUE(estimate_part.lower <= estimate_part.score &&
+              estimate_part.score <= estimate_part.upper);
+  ASSERT_LT(std::abs(estimate_part.score - score), 0.1);
+}
 };  // namespace stats
 };  // namespace raft
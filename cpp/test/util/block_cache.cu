@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2024, NVIDIA CORPORATION.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <raft/core/device_resources.hpp>
+#include <raft/core/host_mdspan.hpp>
+#include <raft/util/block_cache.cuh>
+#include <raft/util/cudart_utils.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace raft::cache {
+
+class BlockCacheTest : public ::testing::TestWithParam<eviction_policy> {
+ protected:
+  raft::device_resources res;
+  // block b holds b + 1 values equal to 100 * b + i
+  std::vector<std::vector<float>> blocks;
+
+  void SetUp() override
+  {
+    for (int b = 0; b < 8; b++) {
+      blocks.emplace_back(b + 1);
+      std::iota(blocks.back().begin(), blocks.back().end(), 100.0f * b);
+    }
+  }
+
+  void check_block(const float* d_ptr, int b)
+  {
+    std::vector<float> h(blocks[b].size());
+    raft::update_host(h.data(), d_ptr, h.size(), resource::get_cuda_stream(res));
+    resource::sync_stream(res);
+    ASSERT_EQ(h, blocks[b]);
+  }
+};
+
+TEST_P(BlockCacheTest, EvictsWithinCapacity)
+{
+  // room for the blocks 0, 1 and 2 (6 values) but not for the block 3 on top of them
+  block_cache<float, int> cache(res, 6 * sizeof(float), GetParam());
+  for (int b = 0; b < 3; b++) {
+    check_block(cache.fetch(res, b, blocks[b].data(), blocks[b].size()), b);
+  }
+  ASSERT_EQ(cache.size(), 3u);
+  ASSERT_EQ(cache.used_bytes(), 6 * sizeof(float));
+  // a use of the block 0 protects it from the next eviction
+  ASSERT_TRUE(cache.find(0).has_value());
+
+  check_block(cache.fetch(res, 3, blocks[3].data(), blocks[3].size()), 3);
+  ASSERT_LE(cache.used_bytes(), cache.capacity_bytes());
+  ASSERT_TRUE(cache.contains(0));
+  ASSERT_TRUE(cache.contains(3));
+  ASSERT_FALSE(cache.contains(1));
+  ASSERT_EQ(cache.misses(), 4u);
+  ASSERT_EQ(cache.hits(), 1u);
+
+  // a hit returns the cached copy
+  check_block(cache.fetch(res, 0, nullptr, blocks[0].size()), 0);
+  ASSERT_EQ(cache.hits(), 2u);
+
+  cache.erase(3);
+  ASSERT_FALSE(cache.contains(3));
+  cache.clear();
+  ASSERT_EQ(cache.size(), 0u);
+  ASSERT_EQ(cache.used_bytes(), 0u);
+}
+
+TEST_P(BlockCacheTest, BatchKeepsItsBlocks)
+{
+  block_cache<float, int> cache(res, 12 * sizeof(float), GetParam());
+  auto source_of = [this](int b) { return std::make_pair(blocks[b].data(), blocks[b].size()); };
+
+  std::vector<int> keys{0, 1, 2, 4};
+  std::vector<float*> ptrs(keys.size());
+  auto n_hits = cache.fetch_batch(res,
+                                  raft::make_host_vector_view<const int, int>(keys.data(), 4),
+                                  source_of,
+                                  raft::make_host_vector_view<float*, int>(ptrs.data(), 4));
+  ASSERT_EQ(n_hits, 0);
+  for (size_t i = 0; i < keys.size(); i++) {
+    check_block(ptrs[i], keys[i]);
+  }
+
+  // the blocks 2 and 5 evict some of the others, but never each other
+  keys   = {2, 5};
+  n_hits = cache.fetch_batch(res,
+                             raft::make_host_vector_view<const int, int>(keys.data(), 2),
+                             source_of,
+                             raft::make_host_vector_view<float*, int>(ptrs.data(), 2));
+  ASSERT_EQ(n_hits, 1);
+  check_block(ptrs[0], 2);
+  check_block(ptrs[1], 5);
+  ASSERT_LE(cache.used_bytes(), cache.capacity_bytes());
+
+  // a batch larger than the cache cannot be kept together
+  keys = {6, 7};
+  EXPECT_THROW(cache.fetch_batch(res,
+                                 raft::make_host_vector_view<const int, int>(keys.data(), 2),
+                                 source_of,
+                                 raft::make_host_vector_view<float*, int>(ptrs.data(), 2)),
+               raft::logic_error);
+}
+
+INSTANTIATE_TEST_CASE_P(BlockCacheTests,
+                        BlockCacheTest,
+                        ::testing::Values(eviction_policy::LRU, eviction_policy::CLOCK));
+
+}  // namespace raft::cache
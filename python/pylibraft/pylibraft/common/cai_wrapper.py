@@ -1,5 +1,5 @@
 #
-# Copyright (c) 2022-2023, NVIDIA CORPORATION.
+# Copyright (c) 2022-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -31,13 +31,39 @@ class cai_wrapper(ai_wrapper):
 
         Parameters
         ----------
-        cai_arr : CUDA array interface array
+        cai_arr : CUDA array interface array, or a DLPack capsule producer
+                  (an object with `__dlpack__`) of device memory, which is
+                  imported without a copy
         """
+        if not hasattr(cai_arr, "__cuda_array_interface__") and hasattr(
+            cai_arr, "__dlpack__"
+        ):
+            cai_arr = _from_dlpack(cai_arr)
         helper = SimpleNamespace(
             __array_interface__=cai_arr.__cuda_array_interface__
         )
         super().__init__(helper)
         self.from_cai = True
+        # keeps the memory of an imported DLPack tensor alive
+        self.owner_ = cai_arr
+
+
+def _from_dlpack(arr):
+    """
+    Zero-copy view of a DLPack device tensor that exposes the CUDA array
+    interface.
+    """
+    try:
+        import cupy as cp
+    except ImportError as e:
+        raise AttributeError(
+            "DLPack inputs without __cuda_array_interface__ require cupy"
+        ) from e
+    if hasattr(arr, "__dlpack_device__"):
+        # kDLCUDA, kDLCUDAHost and kDLCUDAManaged
+        if arr.__dlpack_device__()[0] not in (2, 3, 13):
+            raise AttributeError("DLPack input is not in device memory")
+    return cp.from_dlpack(arr)
 
 
 def wrap_array(array):
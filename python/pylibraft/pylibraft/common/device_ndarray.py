@@ -1,4 +1,4 @@
-# Copyright (c) 2022-2023, NVIDIA CORPORATION.
+# Copyright (c) 2022-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -165,6 +165,28 @@ class device_ndarray:
 
         return host_cai
 
+    def __dlpack__(self, stream=None):
+        """
+        Returns a DLPack capsule of this device_ndarray (zero-copy), for
+        the consumers of the DLPack protocol, e.g. `torch.from_dlpack`.
+
+        Parameters
+        ----------
+        stream : int, optional
+                 The stream of the consumer, as in the DLPack protocol.
+        """
+        import cupy as cp
+
+        return cp.asarray(self).__dlpack__(stream=stream)
+
+    def __dlpack_device__(self):
+        """
+        Returns the (device type, device id) tuple of the DLPack protocol.
+        """
+        import cupy as cp
+
+        return (2, cp.cuda.runtime.getDevice())
+
     def copy_to_host(self):
         """
         Returns a new numpy.ndarray object on host with the current contents of
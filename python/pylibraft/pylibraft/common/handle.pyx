@@ -1,5 +1,5 @@
 #
-# Copyright (c) 2022-2023, NVIDIA CORPORATION.
+# Copyright (c) 2022-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -41,7 +41,9 @@ cdef class DeviceResources:
     Parameters
     ----------
     stream : Optional stream to use for ordering CUDA instructions
-             Accepts pylibraft.common.Stream() or uintptr_t (cudaStream_t)
+             Accepts pylibraft.common.Stream(), uintptr_t (cudaStream_t),
+             or the stream objects of cupy (`ptr`), torch (`cuda_stream`)
+             and of the `__cuda_stream__` protocol
 
     Examples
     --------
@@ -99,13 +101,10 @@ cdef class DeviceResources:
                 # Stream is pylibraft Stream()
                 s = stream.get_ptr()
                 c_stream = cuda_stream_view(<cudaStream_t>s)
-            elif isinstance(stream, int):
-                # Stream is a pointer, cast to cudaStream_t
-                s = stream
-                c_stream = cuda_stream_view(<cudaStream_t>s)
             else:
-                raise ValueError("stream should be common.Stream() or "
-                                 "uintptr_t to cudaStream_t")
+                # Stream is a pointer or a foreign stream object
+                s = _stream_ptr(stream)
+                c_stream = cuda_stream_view(<cudaStream_t>s)
 
             self.c_obj.reset(new handle_t(c_stream,
                              self.stream_pool))
@@ -196,6 +195,24 @@ cdef class Handle(DeviceResources):
                                       self.stream_pool))
 
 
+def _stream_ptr(stream):
+    """
+    The cudaStream_t of a stream given as a pointer or as the stream object
+    of another library.
+    """
+    if isinstance(stream, int):
+        return stream
+    if hasattr(stream, "__cuda_stream__"):
+        # (version, pointer) tuple of the CUDA stream protocol
+        return int(stream.__cuda_stream__()[1])
+    for attr in ("ptr", "cuda_stream"):
+        # cupy.cuda.Stream and torch.cuda.Stream
+        if isinstance(getattr(stream, attr, None), int):
+            return getattr(stream, attr)
+    raise ValueError("stream should be common.Stream(), uintptr_t to "
+                     "cudaStream_t or a cupy/torch stream")
+
+
 _HANDLE_PARAM_DOCSTRING = """
      handle : Optional RAFT resource handle for reusing CUDA resources.
         If a handle isn't supplied, CUDA resources will be
@@ -203,6 +220,11 @@ _HANDLE_PARAM_DOCSTRING = """
         function exits. If a handle is supplied, you will need to
         explicitly synchronize yourself by calling `handle.sync()`
         before accessing the output.
+     stream : Optional CUDA stream to run this function on, instead of a
+        handle: a pylibraft.common.Stream, a cudaStream_t pointer, or a
+        cupy/torch stream. The function then returns without
+        synchronizing, its work being ordered on that stream with the
+        caller's. Cannot be combined with `handle`.
 """.strip()
 
 
@@ -212,13 +234,19 @@ def auto_sync_handle(f):
 
     When a handle=None is passed to the wrapped function, this decorator
     will automatically create a default handle for the function, and
-    call sync on that handle when the function exits.
+    call sync on that handle when the function exits. A `stream` passed
+    instead creates the handle on that stream, which is not synchronized,
+    so the call is asynchronous with respect to the host.
 
     This will also insert the appropriate docstring for the handle parameter
     """
 
     @functools.wraps(f)
-    def wrapper(*args, handle=None, **kwargs):
+    def wrapper(*args, handle=None, stream=None, **kwargs):
+        if stream is not None:
+            if handle is not None:
+                raise ValueError("Only one of handle and stream can be given")
+            handle = DeviceResources(stream=stream)
         sync_handle = handle is None
         handle = handle if handle is not None else DeviceResources()
 
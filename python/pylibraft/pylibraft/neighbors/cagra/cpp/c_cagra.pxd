@@ -107,6 +107,14 @@ cdef extern from "raft/neighbors/cagra_types.hpp" \
                                                        int64_t,
                                                        row_major] dataset)
 
+cdef extern from "raft/neighbors/hnsw_types.hpp" \
+        namespace "raft::neighbors::hnsw" nogil:
+
+    ctypedef enum HnswHierarchy:
+        NONE "raft::neighbors::hnsw::HnswHierarchy::NONE",
+        GPU "raft::neighbors::hnsw::HnswHierarchy::GPU"
+
+
 cdef extern from "raft_runtime/neighbors/cagra.hpp" \
         namespace "raft::runtime::neighbors::cagra" nogil:
 
@@ -214,32 +222,38 @@ cdef extern from "raft_runtime/neighbors/cagra.hpp" \
     cdef void serialize_to_hnswlib(
         const device_resources& handle,
         string& str,
-        const index[float, uint32_t]& index) except +
+        const index[float, uint32_t]& index,
+        HnswHierarchy hierarchy) except +
 
     cdef void serialize_to_hnswlib(
         const device_resources& handle,
         string& str,
-        const index[uint8_t, uint32_t]& index) except +
+        const index[uint8_t, uint32_t]& index,
+        HnswHierarchy hierarchy) except +
 
     cdef void serialize_to_hnswlib(
         const device_resources& handle,
         string& str,
-        const index[int8_t, uint32_t]& index) except +
+        const index[int8_t, uint32_t]& index,
+        HnswHierarchy hierarchy) except +
 
     cdef void serialize_to_hnswlib_file(
         const device_resources& handle,
         const string& filename,
-        const index[float, uint32_t]& index) except +
+        const index[float, uint32_t]& index,
+        HnswHierarchy hierarchy) except +
 
     cdef void serialize_to_hnswlib_file(
         const device_resources& handle,
         const string& filename,
-        const index[uint8_t, uint32_t]& index) except +
+        const index[uint8_t, uint32_t]& index,
+        HnswHierarchy hierarchy) except +
 
     cdef void serialize_to_hnswlib_file(
         const device_resources& handle,
         const string& filename,
-        const index[int8_t, uint32_t]& index) except +
+        const index[int8_t, uint32_t]& index,
+        HnswHierarchy hierarchy) except +
 
     cdef void deserialize_file(const device_resources& handle,
                                const string& filename,
@@ -128,10 +128,19 @@ cdef class HnswIndexUint8(HnswIndex):
         return self.index.get()[0].metric()
 
 
+cdef c_cagra.HnswHierarchy _get_hierarchy(hierarchy) except *:
+    if hierarchy == "none":
+        return c_cagra.HnswHierarchy.NONE
+    elif hierarchy == "gpu":
+        return c_cagra.HnswHierarchy.GPU
+    else:
+        raise ValueError("Unsupported hierarchy: {}".format(hierarchy))
+
+
 @auto_sync_handle
-def save(filename, Index index, handle=None):
+def save(filename, Index index, hierarchy="none", handle=None):
     """
-    Saves the CAGRA index as an hnswlib base-layer-only index to a file.
+    Saves the CAGRA index as an hnswlib index to a file.
 
     Saving / loading the index is experimental. The serialization format is
     subject to change.
@@ -142,6 +151,13 @@ def save(filename, Index index, handle=None):
         Name of the file.
     index : Index
         Trained CAGRA index.
+    hierarchy : string, default="none"
+        Valid values for hierarchy: ["none", "gpu"], where
+            - none exports a base-layer-only index (the CAGRA graph), which
+              is searched from a fixed set of seeds,
+            - gpu builds the upper layers of a full hierarchical index on the
+              GPU, which is searched from its entry point like a regular
+              hnswlib index.
     {handle_docstring}
 
     Examples
@@ -169,6 +185,7 @@ def save(filename, Index index, handle=None):
         <device_resources*><size_t>handle.getHandle()
 
     cdef string c_filename = filename.encode('utf-8')
+    cdef c_cagra.HnswHierarchy c_hierarchy = _get_hierarchy(hierarchy)
 
     cdef IndexFloat idx_float
     cdef IndexInt8 idx_int8
@@ -183,19 +200,19 @@ def save(filename, Index index, handle=None):
         c_index_float = \
             <c_cagra.index[float, uint32_t] *><size_t> idx_float.index
         c_cagra.serialize_to_hnswlib_file(
-            deref(handle_), c_filename, deref(c_index_float))
+            deref(handle_), c_filename, deref(c_index_float), c_hierarchy)
     elif index.active_index_type == "byte":
         idx_int8 = index
         c_index_int8 = \
             <c_cagra.index[int8_t, uint32_t] *><size_t> idx_int8.index
         c_cagra.serialize_to_hnswlib_file(
-            deref(handle_), c_filename, deref(c_index_int8))
+            deref(handle_), c_filename, deref(c_index_int8), c_hierarchy)
     elif index.active_index_type == "ubyte":
         idx_uint8 = index
         c_index_uint8 = \
             <c_cagra.index[uint8_t, uint32_t] *><size_t> idx_uint8.index
         c_cagra.serialize_to_hnswlib_file(
-            deref(handle_), c_filename, deref(c_index_uint8))
+            deref(handle_), c_filename, deref(c_index_uint8), c_hierarchy)
     else:
         raise ValueError(
             "Index dtype %s not supported" % index.active_index_type)
@@ -287,9 +304,9 @@ def load(filename, dim, dtype, metric="sqeuclidean", handle=None):
 
 
 @auto_sync_handle
-def from_cagra(Index index, handle=None):
+def from_cagra(Index index, hierarchy="none", handle=None):
     """
-    Returns an hnswlib base-layer-only index from a CAGRA index.
+    Returns an hnswlib index from a CAGRA index.
 
     NOTE: This method uses the filesystem to write the CAGRA index in
           `/tmp/cagra_index.bin` before reading it as an hnswlib index,
@@ -302,6 +319,8 @@ def from_cagra(Index index, handle=None):
     ----------
     index : Index
         Trained CAGRA index.
+    hierarchy : string, default="none"
+        Valid values for hierarchy: ["none", "gpu"], see `save`.
     {handle_docstring}
 
     Examples
@@ -321,7 +340,7 @@ def from_cagra(Index index, handle=None):
     >>> hnsw_index = hnsw.from_cagra(index, handle=handle)
     """
     filename = "/tmp/cagra_index.bin"
-    save(filename, index, handle=handle)
+    save(filename, index, hierarchy=hierarchy, handle=handle)
     hnsw_index = load(filename, index.dim, np.dtype(index.active_index_type),
                       _get_metric_string(index.metric), handle=handle)
     os.remove(filename)
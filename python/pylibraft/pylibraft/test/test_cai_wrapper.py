@@ -1,4 +1,4 @@
-# Copyright (c) 2022, NVIDIA CORPORATION.
+# Copyright (c) 2022-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -38,3 +38,40 @@ def test_basic_accessors(order, dtype, shape):
     assert cai_wrap.shape == shape
     assert cai_wrap.c_contiguous == (order == "C")
     assert cai_wrap.f_contiguous == (order == "F")
+
+
+class _DLPackOnly:
+    """A device tensor exposing only the DLPack protocol."""
+
+    def __init__(self, arr):
+        self.arr = arr
+
+    def __dlpack__(self, stream=None):
+        return self.arr.__dlpack__(stream=stream)
+
+    def __dlpack_device__(self):
+        return self.arr.__dlpack_device__()
+
+
+def test_dlpack_input():
+    cupy = pytest.importorskip("cupy")
+
+    a = cupy.random.random_sample((10, 5), dtype=cupy.float32)
+    cai_wrap = cai_wrapper(_DLPackOnly(a))
+
+    assert cai_wrap.dtype == np.float32
+    assert cai_wrap.shape == (10, 5)
+    assert cai_wrap.c_contiguous
+    # zero-copy: the wrapper points at the memory of the input
+    assert cai_wrap.data == a.data.ptr
+
+
+def test_dlpack_output():
+    cupy = pytest.importorskip("cupy")
+
+    a = np.random.random((10, 5)).astype(np.float32)
+    db = device_ndarray(a)
+    imported = cupy.from_dlpack(db)
+
+    assert imported.data.ptr == db.__cuda_array_interface__["data"][0]
+    np.testing.assert_array_equal(cupy.asnumpy(imported), a)
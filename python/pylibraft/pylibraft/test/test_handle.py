@@ -1,4 +1,4 @@
-# Copyright (c) 2022-2023, NVIDIA CORPORATION.
+# Copyright (c) 2022-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -42,3 +42,32 @@ def test_handle_external_stream(stream):
 
     with pytest.raises(ValueError):
         handle = DeviceResources(stream=1.0)
+
+
+def test_stream_argument():
+    input1 = np.random.random_sample((50, 3)).astype(np.float32)
+    input1_device = device_ndarray(input1)
+    expected = device_ndarray.empty((50, 50), dtype=np.float32)
+    output_device = device_ndarray.empty((50, 50), dtype=np.float32)
+
+    pairwise_distance(input1_device, input1_device, expected, "euclidean")
+
+    # the call runs on the given stream with the caller's output and
+    # returns without synchronizing
+    stream = cupy.cuda.Stream(non_blocking=True)
+    pairwise_distance(
+        input1_device, input1_device, output_device, "euclidean", stream=stream
+    )
+    stream.synchronize()
+    np.testing.assert_allclose(
+        expected.copy_to_host(), output_device.copy_to_host()
+    )
+
+    with pytest.raises(ValueError):
+        pairwise_distance(
+            input1_device,
+            input1_device,
+            output_device,
+            handle=DeviceResources(),
+            stream=stream,
+        )
@@ -32,6 +32,7 @@ def run_hnsw_build_search_test(
     intermediate_graph_degree=128,
     graph_degree=64,
     search_params={},
+    hierarchy="none",
 ):
     dataset = generate_data((n_rows, n_cols), dtype)
     if metric == "inner_product":
@@ -47,7 +48,7 @@ def run_hnsw_build_search_test(
 
     assert index.trained
 
-    hnsw_index = hnsw.from_cagra(index)
+    hnsw_index = hnsw.from_cagra(index, hierarchy=hierarchy)
 
     queries = generate_data((n_queries, n_cols), dtype)
     out_idx = np.zeros((n_queries, k), dtype=np.uint32)
@@ -75,3 +76,48 @@ def test_hnsw(dtype, k, ef, num_threads):
     run_hnsw_build_search_test(
         dtype=dtype, k=k, search_params={"ef": ef, "num_threads": num_threads}
     )
+
+
+@pytest.mark.parametrize("dtype", [np.float32, np.int8, np.uint8])
+@pytest.mark.parametrize("k", [10, 20])
+@pytest.mark.parametrize("graph_degree", [32, 64])
+def test_hnsw_hierarchy(dtype, k, graph_degree):
+    # the upper layers of the index are built on the GPU
+    run_hnsw_build_search_test(
+        n_rows=20000,
+        dtype=dtype,
+        k=k,
+        graph_degree=graph_degree,
+        search_params={"ef": 40, "num_threads": 4},
+        hierarchy="gpu",
+    )
+
+
+def test_hnsw_ef():
+    # a sparse graph of a high dimensional dataset, so that the recall
+    # depends on the size of the candidate list
+    n_rows, n_cols, n_queries, k = 10000, 64, 100, 10
+    dataset = generate_data((n_rows, n_cols), np.float32)
+    queries = generate_data((n_queries, n_cols), np.float32)
+
+    build_params = cagra.IndexParams(
+        intermediate_graph_degree=32, graph_degree=16
+    )
+    hnsw_index = hnsw.from_cagra(cagra.build(build_params, dataset))
+
+    nn_skl = NearestNeighbors(
+        n_neighbors=k, algorithm="brute", metric="sqeuclidean"
+    )
+    nn_skl.fit(dataset)
+    skl_idx = nn_skl.kneighbors(queries, return_distance=False)
+
+    recalls = []
+    for ef in [k, 400, k]:
+        search_params = hnsw.SearchParams(ef=ef, num_threads=4)
+        _, out_idx = hnsw.search(search_params, hnsw_index, queries, k)
+        recalls.append(calc_recall(out_idx, skl_idx))
+
+    assert recalls[0] < recalls[1]
+    assert recalls[1] > 0.95
+    # the index keeps no state of the previous searches
+    assert recalls[2] == recalls[0]
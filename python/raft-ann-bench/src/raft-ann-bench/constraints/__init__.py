@@ -1,5 +1,5 @@
 #
-# Copyright (c) 2023, NVIDIA CORPORATION.
+# Copyright (c) 2023-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -48,6 +48,13 @@ def raft_cagra_search_constraints(params, build_params, k, batch_size):
     return ret
 
 
+def raft_cagra_refine_search_constraints(params, build_params, k, batch_size):
+    ret = True
+    if "itopk" in params:
+        ret = ret and params["itopk"] >= k * params.get("refine_ratio", 2)
+    return ret
+
+
 def hnswlib_search_constraints(params, build_params, k, batch_size):
     if "ef" in params:
         return params["ef"] >= k
@@ -1,4 +1,4 @@
-# Copyright (c) 2020-2022, NVIDIA CORPORATION.
+# Copyright (c) 2020-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -22,10 +22,13 @@ from .comms_utils import (
     perform_test_comms_allreduce,
     perform_test_comms_bcast,
     perform_test_comms_device_multicast_sendrecv,
+    perform_test_comms_device_p2p_batch,
     perform_test_comms_device_send_or_recv,
     perform_test_comms_device_sendrecv,
     perform_test_comms_gather,
     perform_test_comms_gatherv,
+    perform_test_comms_hierarchical,
+    perform_test_comms_low_precision,
     perform_test_comms_reduce,
     perform_test_comms_reducescatter,
     perform_test_comms_send_recv,
@@ -1,4 +1,4 @@
-# Copyright (c) 2019-2023, NVIDIA CORPORATION.
+# Copyright (c) 2019-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -72,7 +72,11 @@ cdef extern from "raft/comms/comms_test.hpp" namespace "raft::comms":
                                            int numTrials) except +
     bool test_pointToPoint_device_multicast_sendrecv(const device_resources &h,
                                                      int numTrials) except +
+    bool test_pointToPoint_device_p2p_batch(const device_resources &h,
+                                            int numTrials) except +
     bool test_commsplit(const device_resources &h, int n_colors) except +
+    bool test_hierarchical_collectives(const device_resources &h) except +
+    bool test_collective_low_precision(const device_resources &h) except +
 
 
 def perform_test_comms_allreduce(handle, root):
@@ -241,6 +245,52 @@ def perform_test_comms_device_multicast_sendrecv(handle, n_trials):
     return test_pointToPoint_device_multicast_sendrecv(deref(h), <int>n_trials)
 
 
+def perform_test_comms_device_p2p_batch(handle, n_trials):
+    """
+    Performs a batch of tagged p2p device transfers on the current worker
+
+    Parameters
+    ----------
+    handle : raft.common.Handle
+             handle containing comms_t to use
+    n_trilas : int
+               Number of test trials
+    """
+    cdef const device_resources *h = \
+        <device_resources *> <size_t> handle.getHandle()
+    return test_pointToPoint_device_p2p_batch(deref(h), <int>n_trials)
+
+
+def perform_test_comms_hierarchical(handle):
+    """
+    Performs the hierarchical (intra-node / inter-node) allreduce, allgather
+    and reducescatter on the current worker
+
+    Parameters
+    ----------
+    handle : raft.common.Handle
+             handle containing comms_t to use
+    """
+    cdef const device_resources *h = \
+        <device_resources *> <size_t> handle.getHandle()
+    return test_hierarchical_collectives(deref(h))
+
+
+def perform_test_comms_low_precision(handle):
+    """
+    Performs an allreduce, an allgather and a reducescatter of half and
+    bfloat16 buffers on the current worker
+
+    Parameters
+    ----------
+    handle : raft.common.Handle
+             handle containing comms_t to use
+    """
+    cdef const device_resources *h = \
+        <device_resources *> <size_t> handle.getHandle()
+    return test_collective_low_precision(deref(h))
+
+
 def perform_test_comm_split(handle, n_colors):
     """
     Performs a p2p send/recv on the current worker
@@ -0,0 +1,465 @@
+# Copyright (c) 2024, NVIDIA CORPORATION.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import math
+import operator
+import uuid
+
+import numpy as np
+
+from dask.distributed import get_worker
+
+from raft_dask.common.comms import get_raft_comm_state, local_handle
+
+_ALGOS = ("ivf_pq", "cagra")
+
+
+class DistributedIndex:
+    """
+    An approximate nearest neighbors index sharded across the workers of an
+    initialized :py:class:`raft_dask.common.Comms` session.
+
+    Every worker holds one shard: a regular single-GPU pylibraft index of the
+    dataset rows of the routing clusters it owns (the routing cluster `c` is
+    owned by the worker of rank `c % n_shards`, as the lists of the C++
+    `ivf_flat::distributed_index`). The shards are kept in the comms state
+    of the workers and searched with the handle of the session, so the index
+    is valid as long as the comms are.
+
+    Use :py:func:`build` to construct it, :py:func:`search` to query it, and
+    :py:meth:`free` to release the shards before destroying the comms.
+    """
+
+    def __init__(
+        self, comms, name, algo, metric, centers, shard_workers, shard_sizes
+    ):
+        self.comms = comms
+        self.name = name
+        self.algo = algo
+        self.metric = metric
+        self.centers = centers
+        self.shard_workers = shard_workers
+        self.shard_sizes = shard_sizes
+
+    @property
+    def n_shards(self):
+        return len(self.shard_workers)
+
+    @property
+    def n_routing_clusters(self):
+        return self.centers.shape[0]
+
+    @property
+    def dim(self):
+        return self.centers.shape[1]
+
+    @property
+    def size(self):
+        return int(sum(self.shard_sizes))
+
+    def free(self):
+        """
+        Release the shards from the memory of the workers.
+        """
+        self.comms.client.run(
+            _func_free_shard,
+            self.comms.sessionId,
+            self.name,
+            workers=self.shard_workers,
+            wait=True,
+        )
+
+    def __repr__(self):
+        return (
+            f"DistributedIndex(type={self.algo}, metric={self.metric}, "
+            f"size={self.size}, dim={self.dim}, n_shards={self.n_shards}, "
+            f"n_routing_clusters={self.n_routing_clusters})"
+        )
+
+
+def build(
+    comms,
+    dataset,
+    algo="ivf_pq",
+    index_params=None,
+    n_routing_clusters=None,
+    routing_trainset_size=65536,
+    seed=0,
+):
+    """
+    Build an index sharded across the workers of a comms session.
+
+    The dataset rows are partitioned by their nearest routing cluster, the
+    centers of which are trained by k-means on a sample of the dataset; the
+    chunks of the dataset are split on the workers that hold them and the
+    pieces are sent to the owners of their clusters, which build their shard
+    with pylibraft.
+
+    Parameters
+    ----------
+    comms : raft_dask.common.Comms
+        An initialized comms session; every worker of it holds one shard.
+    dataset : dask.array.Array, or an array interface / CUDA array interface
+        compliant matrix, shape (n_samples, dim)
+        The dataset. A local array is split into one chunk per worker.
+        The row `i` of the dataset has the neighbor id `i` in the search
+        results.
+    algo : str, one of "ivf_pq" (default), "cagra"
+        The pylibraft index of the shards.
+    index_params : dict, optional
+        The keyword arguments of the `IndexParams` of `algo`. The number of
+        the IVF-PQ lists defaults to a value that fits the smallest shard.
+    n_routing_clusters : int, optional
+        The number of the routing clusters (default 8 per worker). More
+        clusters give a finer routing of the queries but a less balanced
+        partition.
+    routing_trainset_size : int, optional
+        The number of the dataset rows sampled to train the routing
+        clusters.
+    seed : int, optional
+        The seed of the sampling.
+
+    Returns
+    -------
+    index : DistributedIndex
+
+    Examples
+    --------
+
+    >>> from dask.distributed import Client
+    >>> from dask_cuda import LocalCUDACluster
+    >>> import dask.array as da
+    >>> from raft_dask.common import Comms
+    >>> from raft_dask import neighbors
+    >>> client = Client(LocalCUDACluster())
+    >>> comms = Comms(client=client)
+    >>> comms.init()
+    >>> dataset = da.random.random((100000, 64), chunks=(25000, 64))
+    >>> dataset = dataset.astype("float32")
+    >>> index = neighbors.build(comms, dataset, "ivf_pq",
+    ...                         index_params={"n_lists": 256})
+    >>> queries = dataset[:1000].compute()
+    >>> distances, neighbors = neighbors.search(index, queries, k=10)
+    >>> index.free()
+    >>> comms.destroy()
+    """
+    import dask.array as da
+
+    if algo not in _ALGOS:
+        raise ValueError(f"algo must be one of {_ALGOS}, got {algo}")
+    index_params = dict(index_params) if index_params is not None else {}
+    client = comms.client
+
+    ranks = comms.worker_info(comms.worker_addresses)
+    shard_workers = sorted(
+        comms.worker_addresses, key=lambda w: ranks[w]["rank"]
+    )
+    n_shards = len(shard_workers)
+    if n_routing_clusters is None:
+        n_routing_clusters = 8 * n_shards
+    if n_routing_clusters < n_shards:
+        raise ValueError("Expected at least one routing cluster per worker")
+
+    if not isinstance(dataset, da.Array):
+        n_rows = dataset.shape[0]
+        dataset = da.from_array(
+            dataset,
+            chunks=(math.ceil(n_rows / n_shards), dataset.shape[1]),
+            asarray=False,
+        )
+    if dataset.ndim != 2:
+        raise ValueError("Expected a dataset of shape (n_samples, dim)")
+    dataset = dataset.rechunk({1: -1})
+    n_rows = dataset.shape[0]
+    if n_rows < n_routing_clusters:
+        raise ValueError("Expected more dataset rows than routing clusters")
+    chunk_rows = dataset.chunks[0]
+    offsets = np.concatenate([[0], np.cumsum(chunk_rows)[:-1]])
+
+    chunks = client.compute(dataset.to_delayed().ravel().tolist())
+
+    # routing clusters, trained on one worker
+    trainset_size = max(routing_trainset_size, n_routing_clusters)
+    samples = client.gather(
+        [
+            client.submit(
+                _sample_rows,
+                chunk,
+                math.ceil(trainset_size * rows / n_rows),
+                seed + i,
+                pure=False,
+            )
+            for i, (chunk, rows) in enumerate(zip(chunks, chunk_rows))
+        ]
+    )
+    centers = client.submit(
+        _fit_routing_centers,
+        np.concatenate(samples),
+        n_routing_clusters,
+        workers=[shard_workers[0]],
+        pure=False,
+    ).result()
+
+    # the pieces of every chunk, by the shard that owns their rows
+    splits = [
+        client.submit(
+            _split_chunk, chunk, int(offset), centers, n_shards, pure=False
+        )
+        for chunk, offset in zip(chunks, offsets)
+    ]
+
+    if algo == "ivf_pq" and "n_lists" not in index_params:
+        index_params["n_lists"] = max(
+            1, min(1024, n_rows // (n_shards * 64))
+        )
+    name = uuid.uuid4().hex
+    builds = [
+        client.submit(
+            _build_shard,
+            comms.sessionId,
+            name,
+            algo,
+            index_params,
+            [client.submit(operator.getitem, split, s) for split in splits],
+            workers=[w],
+            allow_other_workers=False,
+            pure=False,
+        )
+        for s, w in enumerate(shard_workers)
+    ]
+    shard_sizes = client.gather(builds)
+
+    metric = index_params.get("metric", "sqeuclidean")
+    return DistributedIndex(
+        comms, name, algo, metric, centers, shard_workers, shard_sizes
+    )
+
+
+def search(index, queries, k, search_params=None, routing_probes=None):
+    """
+    Find the k nearest neighbors of the queries in a sharded index.
+
+    Every query is sent to the workers owning its `routing_probes` nearest
+    routing clusters (all the workers by default), each worker searches its
+    shard for the queries it received, and their results are merged into the
+    k nearest neighbors of every query.
+
+    Parameters
+    ----------
+    index : DistributedIndex
+        The index built by :py:func:`build`.
+    queries : array interface / CUDA array interface compliant matrix,
+        shape (n_queries, dim)
+    k : int
+        The number of the neighbors.
+    search_params : dict, optional
+        The keyword arguments of the `SearchParams` of the algorithm of the
+        index.
+    routing_probes : int, optional
+        The number of the nearest routing clusters of a query, the owners of
+        which search it. Fewer probes send the queries to fewer workers
+        (i.e. less work and traffic) at the cost of the recall; by default
+        all the workers search all the queries.
+
+    Returns
+    -------
+    distances : numpy.ndarray, shape (n_queries, k)
+    neighbors : numpy.ndarray, int64, shape (n_queries, k)
+        The dataset rows of the neighbors, or -1 where there are fewer than
+        k neighbors.
+    """
+    search_params = dict(search_params) if search_params is not None else {}
+    client = index.comms.client
+    queries = _to_host(queries)
+    if queries.ndim != 2 or queries.shape[1] != index.dim:
+        raise ValueError("Expected queries of shape (n_queries, index.dim)")
+    n_queries = queries.shape[0]
+
+    routed = _route_queries(index, queries, routing_probes)
+    futures = []
+    for s, w in enumerate(index.shard_workers):
+        rows = np.nonzero(routed[:, s])[0]
+        if index.shard_sizes[s] == 0 or len(rows) == 0:
+            continue
+        futures.append(
+            (
+                rows,
+                client.submit(
+                    _search_shard,
+                    index.comms.sessionId,
+                    index.name,
+                    index.algo,
+                    search_params,
+                    queries[rows],
+                    k,
+                    workers=[w],
+                    allow_other_workers=False,
+                    pure=False,
+                ),
+            )
+        )
+
+    select_min = index.metric != "inner_product"
+    worst = np.inf if select_min else -np.inf
+    n_candidates = k * max(1, len(futures))
+    all_distances = np.full((n_queries, n_candidates), worst, np.float32)
+    all_neighbors = np.full((n_queries, n_candidates), -1, np.int64)
+    results = client.gather([f for _, f in futures])
+    for i, ((rows, _), (distances, neighbors)) in enumerate(
+        zip(futures, results)
+    ):
+        distances = np.where(neighbors < 0, worst, distances)
+        all_distances[rows, i * k : (i + 1) * k] = distances
+        all_neighbors[rows, i * k : (i + 1) * k] = neighbors
+
+    keys = all_distances if select_min else -all_distances
+    order = np.argsort(keys, axis=1, kind="stable")[:, :k]
+    return (
+        np.take_along_axis(all_distances, order, axis=1),
+        np.take_along_axis(all_neighbors, order, axis=1),
+    )
+
+
+def _route_queries(index, queries, routing_probes):
+    """The (n_queries, n_shards) mask of the shards searching a query."""
+    n_queries = queries.shape[0]
+    if routing_probes is None or routing_probes >= index.n_routing_clusters:
+        return np.ones((n_queries, index.n_shards), dtype=bool)
+    if routing_probes < 1:
+        raise ValueError("routing_probes must be positive")
+    q = queries.astype(np.float32)
+    c = index.centers
+    dists = (
+        (q * q).sum(axis=1)[:, None] - 2 * q @ c.T + (c * c).sum(axis=1)[None]
+    )
+    probes = np.argpartition(dists, routing_probes - 1, axis=1)
+    probes = probes[:, :routing_probes]
+    routed = np.zeros((n_queries, index.n_shards), dtype=bool)
+    routed[np.arange(n_queries)[:, None], probes % index.n_shards] = True
+    return routed
+
+
+def _to_host(arr):
+    if isinstance(arr, np.ndarray):
+        return arr
+    if hasattr(arr, "copy_to_host"):
+        # pylibraft device_ndarray
+        return arr.copy_to_host()
+    if hasattr(arr, "__cuda_array_interface__") and hasattr(arr, "get"):
+        # cupy
+        return arr.get()
+    return np.asarray(arr)
+
+
+def _sample_rows(chunk, n_samples, seed):
+    rows = _to_host(chunk)
+    rng = np.random.default_rng(seed)
+    n_samples = min(n_samples, rows.shape[0])
+    idx = np.sort(rng.choice(rows.shape[0], n_samples, replace=False))
+    return np.ascontiguousarray(rows[idx], dtype=np.float32)
+
+
+def _fit_routing_centers(samples, n_clusters):
+    from pylibraft.cluster.kmeans import KMeansParams, fit
+    from pylibraft.common import device_ndarray
+
+    centroids, _, _ = fit(
+        KMeansParams(n_clusters=n_clusters), device_ndarray(samples)
+    )
+    return _to_host(centroids)
+
+
+def _split_chunk(chunk, offset, centers, n_shards):
+    from pylibraft.common import device_ndarray
+    from pylibraft.distance import fused_l2_nn_argmin
+
+    rows = _to_host(chunk)
+    labels = _to_host(
+        fused_l2_nn_argmin(
+            device_ndarray(np.ascontiguousarray(rows, dtype=np.float32)),
+            device_ndarray(centers),
+        )
+    )
+    owners = labels.astype(np.int64) % n_shards
+    pieces = []
+    for s in range(n_shards):
+        local = np.nonzero(owners == s)[0]
+        pieces.append((rows[local], offset + local.astype(np.int64)))
+    return pieces
+
+
+def _algo_module(algo):
+    if algo == "ivf_pq":
+        from pylibraft.neighbors import ivf_pq
+
+        return ivf_pq
+    from pylibraft.neighbors import cagra
+
+    return cagra
+
+
+def _shards(sessionId, dask_worker):
+    state = get_raft_comm_state(sessionId, dask_worker=dask_worker)
+    return state.setdefault("ann_shards", {})
+
+
+def _build_shard(sessionId, name, algo, index_params, pieces):
+    from pylibraft.common import device_ndarray
+
+    worker = get_worker()
+    rows = np.concatenate([p[0] for p in pieces])
+    ids = np.concatenate([p[1] for p in pieces])
+    if rows.shape[0] == 0:
+        _shards(sessionId, worker)[name] = None
+        return 0
+
+    module = _algo_module(algo)
+    handle = local_handle(sessionId, dask_worker=worker)
+    shard = module.build(
+        module.IndexParams(**index_params),
+        device_ndarray(np.ascontiguousarray(rows)),
+        handle=handle,
+    )
+    handle.sync()
+    _shards(sessionId, worker)[name] = (shard, ids)
+    return int(rows.shape[0])
+
+
+def _search_shard(sessionId, name, algo, search_params, queries, k):
+    from pylibraft.common import device_ndarray
+
+    worker = get_worker()
+    shard, ids = _shards(sessionId, worker)[name]
+    module = _algo_module(algo)
+    handle = local_handle(sessionId, dask_worker=worker)
+    distances, neighbors = module.search(
+        module.SearchParams(**search_params),
+        shard,
+        device_ndarray(np.ascontiguousarray(queries)),
+        k,
+        handle=handle,
+    )
+    handle.sync()
+    distances = _to_host(distances)
+    neighbors = _to_host(neighbors).astype(np.int64)
+
+    # the local rows of the shard to the dataset rows
+    valid = (neighbors >= 0) & (neighbors < ids.shape[0])
+    neighbors = np.where(valid, ids[np.where(valid, neighbors, 0)], -1)
+    return distances, neighbors
+
+
+def _func_free_shard(sessionId, name, dask_worker=None):
+    _shards(sessionId, dask_worker).pop(name, None)
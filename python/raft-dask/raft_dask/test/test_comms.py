@@ -1,4 +1,4 @@
-# Copyright (c) 2019-2023, NVIDIA CORPORATION.
+# Copyright (c) 2019-2024, NVIDIA CORPORATION.
 #
 # Licensed under the Apache License, Version 2.0 (the "License");
 # you may not use this file except in compliance with the License.
@@ -29,10 +29,13 @@ try:
         perform_test_comms_allreduce,
         perform_test_comms_bcast,
         perform_test_comms_device_multicast_sendrecv,
+        perform_test_comms_device_p2p_batch,
         perform_test_comms_device_send_or_recv,
         perform_test_comms_device_sendrecv,
         perform_test_comms_gather,
         perform_test_comms_gatherv,
+        perform_test_comms_hierarchical,
+        perform_test_comms_low_precision,
         perform_test_comms_reduce,
         perform_test_comms_reducescatter,
         perform_test_comms_send_recv,
@@ -106,11 +109,26 @@ def func_test_device_multicast_sendrecv(sessionId, n_trials):
     return perform_test_comms_device_multicast_sendrecv(handle, n_trials)
 
 
+def func_test_device_p2p_batch(sessionId, n_trials):
+    handle = local_handle(sessionId, dask_worker=get_worker())
+    return perform_test_comms_device_p2p_batch(handle, n_trials)
+
+
 def func_test_comm_split(sessionId, n_trials):
     handle = local_handle(sessionId, dask_worker=get_worker())
     return perform_test_comm_split(handle, n_trials)
 
 
+def func_test_hierarchical(sessionId):
+    handle = local_handle(sessionId, dask_worker=get_worker())
+    return perform_test_comms_hierarchical(handle)
+
+
+def func_test_low_precision(sessionId):
+    handle = local_handle(sessionId, dask_worker=get_worker())
+    return perform_test_comms_low_precision(handle)
+
+
 def func_check_uid(sessionId, uniqueId, state_object):
     if not hasattr(state_object, "_raft_comm_state"):
         return 1
@@ -264,6 +282,42 @@ def test_comm_split(client):
     assert all([x.result() for x in dfs])
 
 
+@pytest.mark.nccl
+def test_hierarchical_collectives(client):
+
+    cb = Comms(comms_p2p=True, verbose=True)
+    cb.init()
+
+    dfs = [
+        client.submit(
+            func_test_hierarchical, cb.sessionId, pure=False, workers=[w]
+        )
+        for w in cb.worker_addresses
+    ]
+
+    wait(dfs, timeout=5)
+
+    assert all([x.result() for x in dfs])
+
+
+@pytest.mark.nccl
+def test_collectives_low_precision(client):
+
+    cb = Comms(verbose=True)
+    cb.init()
+
+    dfs = [
+        client.submit(
+            func_test_low_precision, cb.sessionId, pure=False, workers=[w]
+        )
+        for w in cb.worker_addresses
+    ]
+
+    wait(dfs, timeout=5)
+
+    assert all([x.result() for x in dfs])
+
+
 @pytest.mark.ucx
 @pytest.mark.parametrize("n_trials", [1, 5])
 def test_send_recv(n_trials, client):
@@ -354,3 +408,26 @@ def test_device_multicast_sendrecv(n_trials, client):
     wait(dfs, timeout=5)
 
     assert list(map(lambda x: x.result(), dfs))
+
+
+@pytest.mark.nccl
+@pytest.mark.parametrize("n_trials", [1, 5])
+def test_device_p2p_batch(n_trials, client):
+
+    cb = Comms(comms_p2p=True, verbose=True)
+    cb.init()
+
+    dfs = [
+        client.submit(
+            func_test_device_p2p_batch,
+            cb.sessionId,
+            n_trials,
+            pure=False,
+            workers=[w],
+        )
+        for w in cb.worker_addresses
+    ]
+
+    wait(dfs, timeout=5)
+
+    assert list(map(lambda x: x.result(), dfs))
@@ -0,0 +1,95 @@
+# Copyright (c) 2024, NVIDIA CORPORATION.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import numpy as np
+import pytest
+
+try:
+    import dask.array as da
+
+    from raft_dask import neighbors
+    from raft_dask.common import Comms
+
+    pytestmark = pytest.mark.mg
+except ImportError:
+    pytestmark = pytest.mark.skip
+
+
+def exact_neighbors(dataset, queries, k):
+    dists = (
+        (queries * queries).sum(axis=1)[:, None]
+        - 2 * queries @ dataset.T
+        + (dataset * dataset).sum(axis=1)[None]
+    )
+    return np.argsort(dists, axis=1)[:, :k]
+
+
+def recall(found, expected):
+    hits = sum(len(np.intersect1d(f, e)) for f, e in zip(found, expected))
+    return hits / expected.size
+
+
+@pytest.mark.nccl
+@pytest.mark.parametrize(
+    "algo,index_params,search_params",
+    [
+        ("ivf_pq", {"n_lists": 16, "pq_dim": 16}, {"n_probes": 16}),
+        ("cagra", {"graph_degree": 32}, {"itopk_size": 64}),
+    ],
+)
+@pytest.mark.parametrize("routing_probes", [None, 4])
+def test_sharded_ann(
+    client, algo, index_params, search_params, routing_probes
+):
+    cb = None
+    try:
+        cb = Comms(client=client)
+        cb.init()
+
+        rng = np.random.default_rng(42)
+        n_rows, dim, n_queries, k = 8000, 16, 100, 10
+        dataset = rng.random((n_rows, dim), dtype=np.float32)
+        queries = rng.random((n_queries, dim), dtype=np.float32)
+
+        index = neighbors.build(
+            cb,
+            da.from_array(dataset, chunks=(1000, dim)),
+            algo,
+            index_params=index_params,
+        )
+        assert index.size == n_rows
+        assert index.n_shards == len(cb.worker_addresses)
+
+        distances, found = neighbors.search(
+            index,
+            queries,
+            k,
+            search_params=search_params,
+            routing_probes=routing_probes,
+        )
+        assert distances.shape == (n_queries, k)
+        assert found.shape == (n_queries, k)
+        assert np.all((found >= 0) & (found < n_rows))
+        # sorted by the distance
+        assert np.all(np.diff(distances, axis=1) >= 0)
+
+        expected = exact_neighbors(dataset, queries, k)
+        min_recall = 0.9 if routing_probes is None else 0.7
+        assert recall(found, expected) >= min_recall
+
+        index.free()
+    finally:
+        if cb:
+            cb.destroy()